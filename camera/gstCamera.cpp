@@ -27,12 +27,19 @@
 #include <gst/app/gstappsink.h>
 
 #include <sstream> 
+#include <fstream>
 #include <unistd.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
 
 #include "cudaColorspace.h"
 #include "filesystem.h"
 #include "logging.h"
+#include "cudaNVTX.h"
+#include "videoMetrics.h"
 
 #include "NvInfer.h"
 
@@ -44,7 +51,9 @@ gstCamera::gstCamera( const videoOptions& options ) : videoSource(options)
 	mBus       = NULL;
 	mPipeline  = NULL;	
 	mFormatYUV = IMAGE_UNKNOWN;
-	
+	mSinkName  = "mysink";
+
+	mDecoderMJPEG  = videoOptions::DECODER_CPU;
 	mBufferManager = new gstBufferManager(&mOptions);
 }
 
@@ -52,6 +61,9 @@ gstCamera::gstCamera( const videoOptions& options ) : videoSource(options)
 // destructor	
 gstCamera::~gstCamera()
 {
+	// stop reporting the statistics before they're released
+	videoMetrics::Remove(this);
+
 	Close();
 
 	if( mAppSink != NULL )
@@ -128,6 +140,24 @@ gstCamera* gstCamera::Create( const char* camera )
 }
 
 
+// select the MJPEG decoder, depending on which of them are installed
+static videoOptions::Decoder selectDecoderMJPEG( videoOptions::Decoder requested )
+{
+#if defined(__aarch64__)
+	if( (requested == videoOptions::DECODER_AUTO || requested == videoOptions::DECODER_V4L2) && gst_element_available("nvv4l2decoder") && gst_element_available("jpegparse") )
+		return videoOptions::DECODER_V4L2;
+
+	if( (requested == videoOptions::DECODER_AUTO || requested == videoOptions::DECODER_NVJPEG) && gst_element_available("nvjpegdec") )
+		return videoOptions::DECODER_NVJPEG;
+#endif
+
+	if( requested != videoOptions::DECODER_AUTO && requested != videoOptions::DECODER_CPU )
+		LogWarning(LOG_GSTREAMER "gstCamera -- the %s MJPEG decoder isn't available, falling back to the CPU decoder (jpegdec)\n", videoOptions::DecoderToStr(requested));
+
+	return videoOptions::DECODER_CPU;
+}
+
+
 // buildLaunchStr
 bool gstCamera::buildLaunchStr()
 {
@@ -166,7 +196,7 @@ bool gstCamera::buildLaunchStr()
 		ss << "video/x-raw ! ";
 	#endif
 	
-		ss << "appsink name=mysink";
+		gst_build_appsink(mOptions, ss, mSinkName.c_str());
 	}
 	else
 	{
@@ -188,7 +218,7 @@ bool gstCamera::buildLaunchStr()
 		{
 			ss << "tee name=savetee savetee. ! queue ! ";
 			
-			if( !gst_build_filesink(mOptions.save, mOptions.codec, ss) )
+			if( !gst_build_filesink(mOptions.save, mOptions.codec, ss, mOptions.segmentTime, mOptions.segmentSize) )
 				return false;
 
 			ss << "savetee. ! queue ! ";
@@ -239,17 +269,31 @@ bool gstCamera::buildLaunchStr()
 		else if( mOptions.codec == videoOptions::CODEC_MPEG4 )
 			ss << GST_DECODER_MPEG4 << " ! " << codec_format;
 		else if( mOptions.codec == videoOptions::CODEC_MJPEG )
-			ss << "jpegdec ! video/x-raw ! "; //ss << "nvjpegdec ! video/x-raw ! "; //ss << "jpegparse ! nvv4l2decoder mjpeg=1 ! video/x-raw(memory:NVMM) ! nvvidconv ! video/x-raw ! "; //
+		{
+			// the V4L2 decoder outputs NVMM memory, so nvvidconv handles it below if NVMM is disabled
+			mDecoderMJPEG = selectDecoderMJPEG(mOptions.decoder);
+
+			if( mDecoderMJPEG == videoOptions::DECODER_V4L2 )
+				ss << "jpegparse ! nvv4l2decoder mjpeg=1 ! video/x-raw(memory:NVMM) ! ";
+			else if( mDecoderMJPEG == videoOptions::DECODER_NVJPEG )
+				ss << "nvjpegdec ! video/x-raw ! ";
+			else
+				ss << "jpegdec ! video/x-raw ! ";
+
+			LogVerbose(LOG_GSTREAMER "gstCamera -- using the %s decoder for MJPEG\n", videoOptions::DecoderToStr(mDecoderMJPEG));
+		}
+
+		const bool use_mjpeg_nvmm = (mOptions.codec == videoOptions::CODEC_MJPEG) && (mDecoderMJPEG == videoOptions::DECODER_V4L2);
 
 	#if defined(__aarch64__)
 		// video flipping/rotating for V4L2 devices (use nvvidconv if a hw codec is used for decode)
 		// V4L2 decoders can only output NVMM memory, if we aren't using NVMM have nvvidconv convert it 
-		if( mOptions.flipMethod != videoOptions::FLIP_NONE || (use_v4l2_decoder && !enable_nvmm) )
+		if( mOptions.flipMethod != videoOptions::FLIP_NONE || ((use_v4l2_decoder || use_mjpeg_nvmm) && !enable_nvmm) )
 		{
 			#if defined(ENABLE_NVMM) || defined(GST_CODECS_V4L2)
-				const bool use_nvvidconv = use_hw_decoder;
+				const bool use_nvvidconv = use_hw_decoder || use_mjpeg_nvmm;
 			#else
-				const bool use_nvvidconv = false;
+				const bool use_nvvidconv = use_mjpeg_nvmm;
 			#endif
 			
 			if( use_nvvidconv )
@@ -262,7 +306,7 @@ bool gstCamera::buildLaunchStr()
 		if( mOptions.flipMethod != videoOptions::FLIP_NONE )
 			ss << "videoflip method=" << videoOptions::FlipMethodToStr(mOptions.flipMethod) << " ! ";
 	#endif
-		ss << "appsink name=mysink";
+		gst_build_appsink(mOptions, ss, mSinkName.c_str());
 	}
 	
 	mLaunchStr = ss.str();
@@ -428,6 +472,117 @@ bool gstCamera::matchCaps( GstCaps* device_caps )
 }
 
 
+// path of the file that caches the caps of v4l2 devices between runs
+static std::string capsCachePath( bool create=false )
+{
+	std::string path;
+	const char* cacheDir = getenv("XDG_CACHE_HOME");
+
+	if( cacheDir != NULL && strlen(cacheDir) > 0 )
+	{
+		path = cacheDir;
+	}
+	else
+	{
+		const char* home = getenv("HOME");
+
+		if( !home )
+			return "";
+
+		path = pathJoin(home, ".cache");
+	}
+
+	if( create )
+		mkdir(path.c_str(), 0755);
+
+	path = pathJoin(path, "jetson-utils");
+
+	if( create )
+		mkdir(path.c_str(), 0755);
+
+	return pathJoin(path, "v4l2-caps.txt");
+}
+
+
+// identify the device by its driver and bus, so the cache is invalidated if a different camera gets plugged in
+static std::string capsCacheKey( const char* device )
+{
+	const int fd = open(device, O_RDONLY | O_NONBLOCK);
+
+	if( fd < 0 )
+		return "";
+
+	struct v4l2_capability caps;
+	memset(&caps, 0, sizeof(caps));
+
+	const int result = ioctl(fd, VIDIOC_QUERYCAP, &caps);
+	close(fd);
+
+	if( result < 0 )
+		return "";
+
+	std::ostringstream ss;
+	ss << device << "|" << caps.driver << "|" << caps.card << "|" << caps.bus_info << "|" << caps.version;
+	return ss.str();
+}
+
+
+// find the caps for a device in the cache (each line is the key, a tab, and the caps)
+static std::string capsCacheLoad( const std::string& key )
+{
+	std::ifstream file(capsCachePath());
+	std::string line;
+
+	while( std::getline(file, line) )
+	{
+		const size_t tab = line.find('\t');
+
+		if( tab != std::string::npos && line.compare(0, tab, key) == 0 && tab == key.length() )
+			return line.substr(tab + 1);
+	}
+
+	return "";
+}
+
+
+// add or replace the caps for a device in the cache
+static void capsCacheStore( const std::string& key, const char* caps )
+{
+	const std::string path = capsCachePath(true);
+
+	if( path.length() == 0 || !caps )
+		return;
+
+	std::vector<std::string> lines;
+	std::ifstream input(path);
+	std::string line;
+
+	while( std::getline(input, line) )
+	{
+		if( line.compare(0, key.length() + 1, key + "\t") != 0 )
+			lines.push_back(line);
+	}
+
+	input.close();
+	lines.push_back(key + "\t" + caps);
+
+	// write to a temporary file first, so other processes never see a partial cache
+	const std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+	std::ofstream output(tmpPath);
+
+	for( size_t n=0; n < lines.size(); n++ )
+		output << lines[n] << "\n";
+
+	output.close();
+
+	if( !output || rename(tmpPath.c_str(), path.c_str()) != 0 )
+	{
+		LogVerbose(LOG_GSTREAMER "gstCamera -- failed to write caps cache %s\n", path.c_str());
+		unlink(tmpPath.c_str());
+	}
+}
+
+
 // discover
 bool gstCamera::discover()
 {
@@ -448,6 +603,28 @@ bool gstCamera::discover()
 		return true;
 	}
 	
+	// use the caps cached from a previous run if the device is the same (enumerating the devices is slow)
+	const std::string cacheKey = capsCacheKey(mOptions.resource.location.c_str());
+
+	if( cacheKey.length() > 0 )
+	{
+		const std::string cachedCaps = capsCacheLoad(cacheKey);
+		GstCaps* device_caps = (cachedCaps.length() > 0) ? gst_caps_from_string(cachedCaps.c_str()) : NULL;
+
+		if( device_caps != NULL )
+		{
+			const bool matched = matchCaps(device_caps);
+			gst_caps_unref(device_caps);
+
+			if( matched )
+			{
+				LogVerbose(LOG_GSTREAMER "gstCamera -- using cached caps for v4l2 device %s\n", mOptions.resource.location.c_str());
+				LogVerbose(LOG_GSTREAMER "gstCamera -- selected device profile:  codec=%s format=%s width=%u height=%u\n", videoOptions::CodecToStr(mOptions.codec), imageFormatToStr(mFormatYUV), GetWidth(), GetHeight());
+				return true;
+			}
+		}
+	}
+
 	// create v4l2 device service
 	GstDeviceProvider* deviceProvider = gst_device_provider_factory_get_by_name("v4l2deviceprovider");
 	
@@ -507,6 +684,13 @@ bool gstCamera::discover()
 	
 	printCaps(device_caps);
 	
+	if( cacheKey.length() > 0 )
+	{
+		gchar* capsStr = gst_caps_to_string(device_caps);
+		capsCacheStore(cacheKey, capsStr);
+		g_free(capsStr);
+	}
+
 	// pick the best caps
 	if( !matchCaps(device_caps) )
 		return false;
@@ -548,6 +732,33 @@ bool gstCamera::init()
 	// launch pipeline
 	mPipeline = gst_parse_launch(mLaunchStr.c_str(), &err);
 
+	// if the hardware MJPEG decoder couldn't be created, try again with the CPU decoder
+	if( err != NULL && mOptions.codec == videoOptions::CODEC_MJPEG && mDecoderMJPEG != videoOptions::DECODER_CPU && mOptions.decoder == videoOptions::DECODER_AUTO )
+	{
+		LogWarning(LOG_GSTREAMER "gstCamera failed to create pipeline with the %s MJPEG decoder\n", videoOptions::DecoderToStr(mDecoderMJPEG));
+		LogWarning(LOG_GSTREAMER "   (%s)\n", err->message);
+		LogWarning(LOG_GSTREAMER "gstCamera -- falling back to the CPU decoder (jpegdec)\n");
+
+		g_error_free(err);
+		err = NULL;
+
+		if( mPipeline != NULL )
+		{
+			gst_object_unref(mPipeline);
+			mPipeline = NULL;
+		}
+
+		mOptions.decoder = videoOptions::DECODER_CPU;
+
+		if( !buildLaunchStr() )
+		{
+			LogError(LOG_GSTREAMER "gstCamera failed to build pipeline string\n");
+			return false;
+		}
+
+		mPipeline = gst_parse_launch(mLaunchStr.c_str(), &err);
+	}
+
 	if( err != NULL )
 	{
 		LogError(LOG_GSTREAMER "gstCamera failed to create pipeline\n");
@@ -577,7 +788,7 @@ bool gstCamera::init()
 	//gst_bus_add_watch(mBus, (GstBusFunc)gst_message_print, NULL);
 
 	// get the appsrc
-	GstElement* appsinkElement = gst_bin_get_by_name(GST_BIN(pipeline), "mysink");
+	GstElement* appsinkElement = gst_bin_get_by_name(GST_BIN(pipeline), mSinkName.c_str());
 	GstAppSink* appsink = GST_APP_SINK(appsinkElement);
 
 	if( !appsinkElement || !appsink)
@@ -670,18 +881,74 @@ void gstCamera::checkBuffer()
 		release_return;
 	}
 
+	// the base time maps the buffer's PTS to when it was captured
+	const uint64_t baseTime = gst_monotonic_base_time(GST_ELEMENT(mAppSink));
+
 	// enqueue the buffer for color conversion
-	if( !mBufferManager->Enqueue(gstBuffer, gstCaps) )
+	if( !mBufferManager->Enqueue(gstBuffer, gstCaps, baseTime, gst_sample_get_segment(gstSample)) )
 	{
 		LogError(LOG_GSTREAMER "gstCamera -- failed to handle incoming buffer\n");
 		release_return;
 	}
 	
 	mOptions.frameCount++;
+
+	// push the frame to the callback (before the sample gets released)
+	if( mCallback != NULL )
+		deliverFrame();
+
 	release_return;
 }
 
 
+// deliverFrame
+void gstCamera::deliverFrame()
+{
+	void* image = NULL;
+
+	// the frame was just enqueued, so this returns without waiting
+	if( !mBufferManager->Dequeue(&image, mCallbackFormat, 0) )
+	{
+		LogError(LOG_GSTREAMER "gstCamera -- failed to convert frame for the callback\n");
+		return;
+	}
+
+	mLastTimestamp = mBufferManager->GetLastTimestamp();
+	mLastCaptureTime = mBufferManager->GetLastTimestamps().capture;
+	mRawFormat = mBufferManager->GetRawFormat();
+
+	stampCapture(image, mCallbackFormat);
+
+	// the appsink thread is blocked until the callback returns, so no
+	// new frames can overwrite this one while the callback is using it
+	mCallback(this, image, GetWidth(), GetHeight(), (mCallbackFormat != IMAGE_UNKNOWN) ? mCallbackFormat : mRawFormat, mLastTimestamp, mCallbackUser);
+}
+
+
+// Convert
+bool gstCamera::Convert( void** output, imageFormat format )
+{
+	if( !mBufferManager->Convert(output, format) )
+	{
+		LogError(LOG_GSTREAMER "gstCamera -- failed to convert frame to %s\n", imageFormatToStr(format));
+		return false;
+	}
+
+	return true;
+}
+
+
+// SetCallback
+bool gstCamera::SetCallback( videoSourceCallback callback, imageFormat format, void* user )
+{
+	mCallbackFormat = format;
+	mCallbackUser   = user;
+	mCallback       = callback;
+
+	return true;
+}
+
+
 // Capture
 bool gstCamera::Capture( void** output, imageFormat format, uint64_t timeout )
 {
@@ -689,6 +956,15 @@ bool gstCamera::Capture( void** output, imageFormat format, uint64_t timeout )
 	if( !output )
 		return false;
 
+	NVTX_RANGE_FMT("gstCamera::Capture (%s)", mOptions.resource.string.c_str());
+
+	// the appsink thread is already dequeueing the frames for the callback
+	if( mCallback != NULL )
+	{
+		LogError(LOG_GSTREAMER "gstCamera -- Capture() can't be used while a frame callback is set\n");
+		return false;
+	}
+
 	// confirm the camera is streaming
 	if( !mStreaming )
 	{
@@ -704,8 +980,10 @@ bool gstCamera::Capture( void** output, imageFormat format, uint64_t timeout )
 	}
 
 	mLastTimestamp = mBufferManager->GetLastTimestamp();
+	mLastCaptureTime = mBufferManager->GetLastTimestamps().capture;
 	mRawFormat = mBufferManager->GetRawFormat();
 
+	stampCapture(*output, format);
 	return true;
 }
 
@@ -749,9 +1027,7 @@ bool gstCamera::Open()
 		return false;
 	}
 
-	checkMsgBus();
-	usleep(100*1000);
-	checkMsgBus();
+	gst_wait_state(mPipeline, mBus, GST_OPEN_TIMEOUT, this);
 
 	mStreaming = true;
 	return true;
@@ -771,7 +1047,6 @@ void gstCamera::Close()
 	if( result != GST_STATE_CHANGE_SUCCESS )
 		LogError(LOG_GSTREAMER "gstCamera failed to set pipeline state to PLAYING (error %u)\n", result);
 
-	usleep(250*1000);	
 	checkMsgBus();
 	mStreaming = false;
 	LogInfo(LOG_GSTREAMER "gstCamera -- pipeline stopped\n");
@@ -143,6 +143,36 @@ public:
 	 */
 	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT );
 
+	/**
+	 * Push the frames to a callback from the appsink thread.
+	 * @see videoSource::SetCallback()
+	 */
+	virtual bool SetCallback( videoSourceCallback callback, imageFormat format=IMAGE_RGB8, void* user=NULL );
+
+	/**
+	 * Convert the last captured frame into another format on first access.
+	 * @see videoSource::Convert()
+	 */
+	virtual bool Convert( void** image, imageFormat format );
+
+	/**
+	 * Return all the timestamps of the last captured frame, including its PTS/DTS,
+	 * the sensor timestamp (if the source attached one), and the capture time.
+	 */
+	inline const gstFrameTimestamp& GetLastTimestamps() const	{ return mBufferManager->GetLastTimestamps(); }
+
+	/**
+	 * Get a file descriptor that becomes readable when a new frame can be captured.
+	 * @see videoSource::GetEventFD()
+	 */
+	virtual int GetEventFD()							{ return mBufferManager->GetEventFD(); }
+
+	/**
+	 * Get the statistics of the frames that were recieved and captured.
+	 * @see videoSource::GetStats()
+	 */
+	virtual bool GetStats( videoSourceStats* stats ) const	{ mBufferManager->GetStats(stats); return true; }
+
 	/**
 	 * Capture the next image frame from the camera and convert it to float4 RGBA format,
 	 * with pixel intensities ranging between 0.0 and 255.0.
@@ -205,6 +235,9 @@ public:
 	static const uint32_t DefaultHeight = 720;
 	
 private:
+	friend class gstCameraSync;	// builds the pipeline branches of multiple cameras
+
+
 	static void onEOS(_GstAppSink* sink, void* user_data);
 	static GstFlowReturn onPreroll(_GstAppSink* sink, void* user_data);
 	static GstFlowReturn onBuffer(_GstAppSink* sink, void* user_data);
@@ -217,6 +250,7 @@ private:
 
 	void checkMsgBus();
 	void checkBuffer();
+	void deliverFrame();
 	
 	bool matchCaps( GstCaps* caps );
 	bool printCaps( GstCaps* caps );
@@ -227,7 +261,10 @@ private:
 	_GstElement* mPipeline;
 
 	std::string  mLaunchStr;
+	std::string  mSinkName;
 	imageFormat  mFormatYUV;
+
+	videoOptions::Decoder mDecoderMJPEG;	// the decoder that buildLaunchStr() picked for MJPEG
 	
 	gstBufferManager* mBufferManager;
 };
@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "gstCameraSync.h"
+#include "gstUtility.h"
+
+#include "timespec.h"
+#include "logging.h"
+
+#include <gst/app/gstappsink.h>
+
+#include <sstream>
+#include <string.h>
+
+
+// constructor
+gstCameraSync::gstCameraSync()
+{
+	mBus       = NULL;
+	mPipeline  = NULL;
+	mStreaming = false;
+	mTolerance = 0;
+	mLastSkew  = 0;
+}
+
+
+// destructor
+gstCameraSync::~gstCameraSync()
+{
+	Close();
+
+	if( mBus != NULL )
+	{
+		gst_object_unref(mBus);
+		mBus = NULL;
+	}
+
+	if( mPipeline != NULL )
+	{
+		gst_object_unref(mPipeline);
+		mPipeline = NULL;
+	}
+
+	// the cameras never had a pipeline of their own
+	const uint32_t numSensors = mCameras.size();
+
+	for( uint32_t n=0; n < numSensors; n++ )
+	{
+		mCameras[n]->mStreaming = false;
+		delete mCameras[n];
+	}
+
+	mCameras.clear();
+}
+
+
+// Create
+gstCameraSync* gstCameraSync::Create( const std::vector<uint32_t>& sensors, const videoOptions& options )
+{
+	if( !gstreamerInit() )
+	{
+		LogError(LOG_GSTREAMER "failed to initialize gstreamer API\n");
+		return NULL;
+	}
+
+	gstCameraSync* sync = new gstCameraSync();
+
+	if( !sync )
+		return NULL;
+
+	if( !sync->init(sensors, options) )
+	{
+		LogError(LOG_GSTREAMER "gstCameraSync -- failed to create synchronized capture of %zu sensors\n", sensors.size());
+		delete sync;
+		return NULL;
+	}
+
+	LogSuccess(LOG_GSTREAMER "gstCameraSync -- created synchronized capture of %zu sensors\n", sensors.size());
+	return sync;
+}
+
+
+// init
+bool gstCameraSync::init( const std::vector<uint32_t>& sensors, const videoOptions& options )
+{
+	const uint32_t numSensors = sensors.size();
+
+	if( numSensors == 0 )
+	{
+		LogError(LOG_GSTREAMER "gstCameraSync -- no sensors were provided\n");
+		return false;
+	}
+
+	// build the branch of each sensor
+	std::ostringstream ss;
+
+	for( uint32_t n=0; n < numSensors; n++ )
+	{
+		std::ostringstream resource;
+		resource << "csi://" << sensors[n];
+
+		videoOptions opt = options;
+
+		opt.resource   = resource.str();
+		opt.deviceType = videoOptions::DEVICE_CSI;
+		opt.ioType     = videoOptions::INPUT;
+		opt.save       = URI();
+		opt.loop       = 0;
+
+		gstCamera* camera = new gstCamera(opt);
+
+		if( !camera )
+			return false;
+
+		mCameras.push_back(camera);
+
+		std::ostringstream sinkName;
+		sinkName << "sink" << n;
+		camera->mSinkName = sinkName.str();
+
+		if( !camera->discover() || !camera->buildLaunchStr() )
+		{
+			LogError(LOG_GSTREAMER "gstCameraSync -- failed to build pipeline for %s\n", resource.str().c_str());
+			return false;
+		}
+
+		ss << camera->mLaunchStr << " ";
+	}
+
+	// frames are matched to within half of the frame period by default
+	mTolerance = 500000000.0 / mCameras[0]->GetFrameRate();
+
+	// create the pipeline with all of the branches
+	mLaunchStr = ss.str();
+
+	LogInfo(LOG_GSTREAMER "gstCameraSync -- pipeline string:\n");
+	LogInfo(LOG_GSTREAMER "%s\n", mLaunchStr.c_str());
+
+	GError* err = NULL;
+	mPipeline = gst_parse_launch(mLaunchStr.c_str(), &err);
+
+	if( err != NULL )
+	{
+		LogError(LOG_GSTREAMER "gstCameraSync -- failed to create pipeline\n");
+		LogError(LOG_GSTREAMER "   (%s)\n", err->message);
+		g_error_free(err);
+		return false;
+	}
+
+	GstPipeline* pipeline = GST_PIPELINE(mPipeline);
+
+	if( !pipeline )
+	{
+		LogError(LOG_GSTREAMER "gstCameraSync -- failed to cast GstElement into GstPipeline\n");
+		return false;
+	}
+
+	mBus = gst_pipeline_get_bus(pipeline);
+
+	if( !mBus )
+	{
+		LogError(LOG_GSTREAMER "gstCameraSync -- failed to retrieve GstBus from pipeline\n");
+		return false;
+	}
+
+	// hook up the appsinks to their cameras
+	mContexts.resize(numSensors);
+
+	for( uint32_t n=0; n < numSensors; n++ )
+	{
+		GstElement* appsinkElement = gst_bin_get_by_name(GST_BIN(pipeline), mCameras[n]->mSinkName.c_str());
+		GstAppSink* appsink = GST_APP_SINK(appsinkElement);
+
+		if( !appsinkElement || !appsink )
+		{
+			LogError(LOG_GSTREAMER "gstCameraSync -- failed to retrieve AppSink element '%s' from pipeline\n", mCameras[n]->mSinkName.c_str());
+			return false;
+		}
+
+		mCameras[n]->mAppSink = appsink;
+
+		mContexts[n].sync  = this;
+		mContexts[n].index = n;
+
+		GstAppSinkCallbacks cb;
+		memset(&cb, 0, sizeof(GstAppSinkCallbacks));
+
+		cb.eos         = onEOS;
+		cb.new_preroll = onPreroll;
+		cb.new_sample  = onBuffer;
+
+		gst_app_sink_set_callbacks(appsink, &cb, (void*)&mContexts[n], NULL);
+	}
+
+	return true;
+}
+
+
+// onEOS
+void gstCameraSync::onEOS( _GstAppSink* sink, void* user_data )
+{
+	sensorContext* ctx = (sensorContext*)user_data;
+
+	if( !ctx )
+		return;
+
+	LogWarning(LOG_GSTREAMER "gstCameraSync -- end of stream (EOS) for sensor %u\n", ctx->index);
+}
+
+
+// onPreroll
+GstFlowReturn gstCameraSync::onPreroll( _GstAppSink* sink, void* user_data )
+{
+	// pull and free the preroll buffer, otherwise the pipeline may hang during shutdown
+	GstSample* gstSample = gst_app_sink_pull_preroll(sink);
+
+	if( gstSample != NULL )
+		gst_sample_unref(gstSample);
+
+	return GST_FLOW_OK;
+}
+
+
+// onBuffer
+GstFlowReturn gstCameraSync::onBuffer( _GstAppSink* sink, void* user_data )
+{
+	sensorContext* ctx = (sensorContext*)user_data;
+
+	if( !ctx )
+		return GST_FLOW_OK;
+
+	// enqueue the frame into the camera's buffer manager (from this branch's streaming thread)
+	ctx->sync->mCameras[ctx->index]->checkBuffer();
+	return GST_FLOW_OK;
+}
+
+
+// dequeue
+bool gstCameraSync::dequeue( uint32_t sensor, void** image, imageFormat format, uint64_t timeout )
+{
+	gstCamera* camera = mCameras[sensor];
+
+	if( !camera->mBufferManager->Dequeue(image, format, timeout) )
+		return false;
+
+	camera->mLastTimestamp = camera->mBufferManager->GetLastTimestamp();
+	camera->mLastCaptureTime = camera->mBufferManager->GetLastTimestamps().capture;
+	camera->mRawFormat = camera->mBufferManager->GetRawFormat();
+
+	camera->stampCapture(*image, format);
+	return true;
+}
+
+
+// Capture
+bool gstCameraSync::Capture( void** images, imageFormat format, uint64_t timeout )
+{
+	if( !images )
+		return false;
+
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	checkMsgBus();
+
+	const uint32_t numSensors = mCameras.size();
+	const double deadline = (timeout == UINT64_MAX) ? 0.0 : timeDouble() + timeout;
+
+	// start with the latest frame from every sensor
+	std::vector<bool> needed(numSensors, true);
+
+	while( true )
+	{
+		for( uint32_t n=0; n < numSensors; n++ )
+		{
+			if( !needed[n] )
+				continue;
+
+			uint64_t remaining = timeout;
+
+			if( timeout != UINT64_MAX )
+			{
+				const double left = deadline - timeDouble();
+				remaining = (left > 0.0) ? (uint64_t)left : 0;
+			}
+
+			if( !dequeue(n, &images[n], format, remaining) )
+			{
+				LogError(LOG_GSTREAMER "gstCameraSync -- failed to retrieve a matching frame from sensor %u\n", n);
+				return false;
+			}
+
+			needed[n] = false;
+		}
+
+		// check if the capture times of the set are close enough together
+		uint64_t earliest = UINT64_MAX;
+		uint64_t latest = 0;
+
+		for( uint32_t n=0; n < numSensors; n++ )
+		{
+			const uint64_t captureTime = mCameras[n]->GetLastCaptureTime();
+
+			earliest = (captureTime < earliest) ? captureTime : earliest;
+			latest = (captureTime > latest) ? captureTime : latest;
+		}
+
+		mLastSkew = latest - earliest;
+
+		if( mLastSkew <= mTolerance )
+			return true;
+
+		// the frames that are too old to match the latest one get replaced by the next frame from their sensor
+		for( uint32_t n=0; n < numSensors; n++ )
+		{
+			if( latest - mCameras[n]->GetLastCaptureTime() > mTolerance )
+				needed[n] = true;
+		}
+	}
+}
+
+
+// Open
+bool gstCameraSync::Open()
+{
+	if( mStreaming )
+		return true;
+
+	LogInfo(LOG_GSTREAMER "opening gstCameraSync for streaming from %zu sensors, transitioning pipeline to GST_STATE_PLAYING\n", mCameras.size());
+
+	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_PLAYING);
+
+	if( result != GST_STATE_CHANGE_ASYNC && result != GST_STATE_CHANGE_SUCCESS )
+	{
+		LogError(LOG_GSTREAMER "gstCameraSync -- failed to set pipeline state to PLAYING (error %u)\n", result);
+		return false;
+	}
+
+	checkMsgBus();
+	mStreaming = true;
+
+	for( size_t n=0; n < mCameras.size(); n++ )
+		mCameras[n]->mStreaming = true;
+
+	return true;
+}
+
+
+// Close
+void gstCameraSync::Close()
+{
+	if( !mStreaming )
+		return;
+
+	LogInfo(LOG_GSTREAMER "gstCameraSync -- stopping pipeline, transitioning to GST_STATE_NULL\n");
+
+	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_NULL);
+
+	if( result != GST_STATE_CHANGE_SUCCESS )
+		LogError(LOG_GSTREAMER "gstCameraSync -- failed to stop pipeline (error %u)\n", result);
+
+	checkMsgBus();
+	mStreaming = false;
+
+	for( size_t n=0; n < mCameras.size(); n++ )
+		mCameras[n]->mStreaming = false;
+
+	LogInfo(LOG_GSTREAMER "gstCameraSync -- pipeline stopped\n");
+}
+
+
+// checkMsgBus
+void gstCameraSync::checkMsgBus()
+{
+	if( !mBus )
+		return;
+
+	while(true)
+	{
+		GstMessage* msg = gst_bus_pop(mBus);
+
+		if( !msg )
+			break;
+
+		gst_message_print(mBus, msg, this);
+		gst_message_unref(msg);
+	}
+}
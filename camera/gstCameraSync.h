@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GSTREAMER_CAMERA_SYNC_H__
+#define __GSTREAMER_CAMERA_SYNC_H__
+
+#include "gstCamera.h"
+
+#include <vector>
+
+
+/**
+ * Captures multiple MIPI CSI cameras in a single GStreamer pipeline, and returns
+ * sets of frames (one from each sensor) that are matched by their capture times.
+ *
+ * Each sensor gets an nvarguscamerasrc branch that's built the same way as it would be
+ * by gstCamera, and they all end in their own appsink.  Because the branches are in one
+ * pipeline, all of the sensors are started together by the same Argus daemon connection,
+ * and their timestamps share the pipeline clock.  Capture() then waits for a frame from
+ * every sensor, and if their capture times (see videoSource::GetLastCaptureTime()) differ
+ * by more than the tolerance, it keeps replacing the oldest frames with newer ones until
+ * the set matches - so the application gets a consistent stereo pair (or rig) without
+ * doing its own frame matching.
+ *
+ * @note the sensors themselves should be hardware-synchronized (e.g. with a shared trigger)
+ *       for the frames to be captured at the same time, otherwise they're only matched to
+ *       within a frame period.  This is only supported on Jetson.
+ *
+ * @ingroup camera
+ */
+class gstCameraSync
+{
+public:
+	/**
+	 * Create a synchronized capture from a list of CSI sensor ID's (e.g. `{0, 1}` for a stereo pair).
+	 * The width, height, framerate and flip method of the videoOptions are applied to every sensor.
+	 */
+	static gstCameraSync* Create( const std::vector<uint32_t>& sensors, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Destructor
+	 */
+	~gstCameraSync();
+
+	/**
+	 * Start streaming from all of the sensors.
+	 */
+	bool Open();
+
+	/**
+	 * Stop streaming from all of the sensors.
+	 */
+	void Close();
+
+	/**
+	 * Capture a matched set of frames, one from each sensor.
+	 * @see Capture()
+	 */
+	template<typename T> bool Capture( T** images, uint64_t timeout=videoSource::DEFAULT_TIMEOUT )	{ return Capture((void**)images, imageFormatFromType<T>(), timeout); }
+
+	/**
+	 * Capture a matched set of frames, one from each sensor.
+	 *
+	 * @param[out] images array of GetNumSensors() pointers that get set to the images of each sensor
+	 * @param[in] format the format to convert the images to (or `IMAGE_UNKNOWN` for NV12)
+	 * @param[in] timeout timeout in milliseconds for the whole set of frames to be matched
+	 *
+	 * @returns `true` if a set of frames with capture times within GetTolerance() was captured,
+	 *          `false` if there was an error or a timeout occurred.
+	 */
+	bool Capture( void** images, imageFormat format, uint64_t timeout=videoSource::DEFAULT_TIMEOUT );
+
+	/**
+	 * Return true if the sensors are streaming.
+	 */
+	inline bool IsStreaming() const					{ return mStreaming; }
+
+	/**
+	 * Get the number of sensors.
+	 */
+	inline uint32_t GetNumSensors() const				{ return mCameras.size(); }
+
+	/**
+	 * Get the camera of one of the sensors (to query its options, size, timestamps, ect.)
+	 * Frames shouldn't be captured from it directly, only through gstCameraSync::Capture().
+	 */
+	inline gstCamera* GetCamera( uint32_t sensor ) const	{ return mCameras[sensor]; }
+
+	/**
+	 * Get the width of the frames (in pixels).
+	 */
+	inline uint32_t GetWidth() const					{ return mCameras[0]->GetWidth(); }
+
+	/**
+	 * Get the height of the frames (in pixels).
+	 */
+	inline uint32_t GetHeight() const					{ return mCameras[0]->GetHeight(); }
+
+	/**
+	 * Get the capture time of a sensor's frame from the last set (in nanoseconds of CLOCK_MONOTONIC).
+	 */
+	inline uint64_t GetLastCaptureTime( uint32_t sensor ) const	{ return mCameras[sensor]->GetLastCaptureTime(); }
+
+	/**
+	 * Get the difference between the earliest and latest capture times in the last set (in nanoseconds).
+	 */
+	inline uint64_t GetLastSkew() const				{ return mLastSkew; }
+
+	/**
+	 * Get the maximum difference between the capture times of a set (in nanoseconds).
+	 * The default is half of the frame period.
+	 */
+	inline uint64_t GetTolerance() const				{ return mTolerance; }
+
+	/**
+	 * Set the maximum difference between the capture times of a set (in nanoseconds).
+	 */
+	inline void SetTolerance( uint64_t tolerance )		{ mTolerance = tolerance; }
+
+protected:
+	gstCameraSync();
+
+	bool init( const std::vector<uint32_t>& sensors, const videoOptions& options );
+	bool dequeue( uint32_t sensor, void** image, imageFormat format, uint64_t timeout );
+	void checkMsgBus();
+
+	// appsink callbacks
+	static void onEOS( _GstAppSink* sink, void* user_data );
+	static GstFlowReturn onPreroll( _GstAppSink* sink, void* user_data );
+	static GstFlowReturn onBuffer( _GstAppSink* sink, void* user_data );
+
+	struct sensorContext
+	{
+		gstCameraSync* sync;
+		uint32_t index;
+	};
+
+	_GstBus*     mBus;
+	_GstElement* mPipeline;
+	std::string  mLaunchStr;
+	bool         mStreaming;
+
+	std::vector<gstCamera*>    mCameras;
+	std::vector<sensorContext> mContexts;
+
+	uint64_t mTolerance;
+	uint64_t mLastSkew;
+};
+
+#endif
@@ -98,7 +98,7 @@ int main( int argc, char** argv )
 	
 	while( !signal_recieved )
 	{
-		uint8_t* img = (uint8_t*)camera->Capture(500);
+		uint8_t* img = (uint8_t*)camera->CaptureRaw(500);
 		
 		if( !img )
 		{
@@ -21,6 +21,13 @@
  */
 
 #include "v4l2Camera.h"
+#include "cudaColorspace.h"
+#include "cudaBayer.h"
+#include "cudaMappedMemory.h"
+#include "cudaMemoryPool.h"
+
+#include "logging.h"
+#include "cudaNVTX.h"
 
 #include <fcntl.h> 
 #include <unistd.h>
@@ -52,38 +59,44 @@ static int xioctl(int fd, int request, void* arg)
 
 
 // constructor
-v4l2Camera::v4l2Camera( const char* device_path ) : mDevicePath(device_path)
+v4l2Camera::v4l2Camera( const videoOptions& options, Memory memory ) : videoSource(options), mBufferRGB(0)
 {	
 	mFD = -1;
+	mFlipCapture = true;
 
 	mBuffersMMap     = NULL;
 	mBufferCountMMap = 0;
-	mRequestWidth    = 0;
-	mRequestHeight   = 0;
-	mRequestFormat   = 1;
-	//mRequestFormat   = -1;	// index into V4L2 format table
+	mMemory          = memory;
+	mHeldBuffer      = -1;
+	mRequestFormat   = -1;	// index into V4L2 format table
+	mDevicePath      = options.resource.location;
 	
-	mWidth      = 0;
-	mHeight     = 0;
 	mPitch      = 0;
 	mPixelDepth = 0;
+	mImageSize  = 0;
+	mStaging    = NULL;
 }
 
 
 // destructor	
 v4l2Camera::~v4l2Camera()
 {
-	// close file
+	// close file (which releases the buffers from the driver)
 	if( mFD >= 0 )
 	{
 		close(mFD);
 		mFD = -1;
 	}
+
+	freeBuffers();
+
+	if( mStaging != NULL )
+		cudaFreePooled(mStaging);
 }
 
 
-// ProcessEmit
-void* v4l2Camera::Capture( size_t timeout )
+// CaptureRaw
+void* v4l2Camera::CaptureRaw( size_t timeout )
 {
 	fd_set fds;
 	FD_ZERO(&fds);
@@ -102,6 +115,9 @@ void* v4l2Camera::Capture( size_t timeout )
 		tv.tv_usec = (timeout - (tv.tv_sec * 1000)) * 1000;
 	}
 	
+	// return the buffer from the previous Capture() to the driver
+	requeue();
+
 	//
 	const int result = select(mFD + 1, &fds, NULL, NULL, &tv);
 
@@ -109,45 +125,235 @@ void* v4l2Camera::Capture( size_t timeout )
 	if( result == -1 ) 
 	{
 		//if (EINTR == errno)
-		printf("v4l2 -- select() failed (errno=%i) (%s)\n", errno, strerror(errno));
+		LogError(LOG_V4L2 "select() failed (errno=%i) (%s)\n", errno, strerror(errno));
 		return NULL;
 	}
 	else if( result == 0 )
 	{
 		if( timeout > 0 )
-			printf("v4l2 -- select() timed out...\n");
+			LogWarning(LOG_V4L2 "select() timed out...\n");
 		return NULL;	// timeout, not necessarily an error (TRY_AGAIN)
 	}
 
+	return dequeue();
+}
+
+
+// requeue
+void v4l2Camera::requeue()
+{
+	if( mHeldBuffer < 0 )
+		return;
+
+	if( xioctl(mFD, VIDIOC_QBUF, &mBuffersMMap[mHeldBuffer].buf) < 0 )
+		LogError(LOG_V4L2 "ioctl(VIDIOC_QBUF) failed (errno=%i) (%s)\n", errno, strerror(errno));
+
+	mHeldBuffer = -1;
+}
+
+
+// dequeue
+void* v4l2Camera::dequeue()
+{
 	// dequeue input buffer from V4L2
 	struct v4l2_buffer buf;
 	memset(&buf, 0, sizeof(v4l2_buffer));
 
 	buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	buf.memory = V4L2_MEMORY_MMAP;	//V4L2_MEMORY_USERPTR;
+	buf.memory = (mMemory == MEMORY_USERPTR) ? V4L2_MEMORY_USERPTR : V4L2_MEMORY_MMAP;
 
 	if( xioctl(mFD, VIDIOC_DQBUF, &buf) < 0 )
 	{
-		printf("v4l2 -- ioctl(VIDIOC_DQBUF) failed (errno=%i) (%s)\n", errno, strerror(errno));
+		LogError(LOG_V4L2 "ioctl(VIDIOC_DQBUF) failed (errno=%i) (%s)\n", errno, strerror(errno));
 		return NULL;
 	}
 	
 	if( buf.index >= mBufferCountMMap )
 	{
-		printf("v4l2 -- invalid mmap buffer index (%u)\n", buf.index);
+		LogError(LOG_V4L2 "invalid capture buffer index (%u)\n", buf.index);
 		return NULL;
 	}
 	
 	// emit ringbuffer entry
-	//printf("v4l2 -- recieved %ux%u video frame (index=%u)\n", mWidth, mHeight, (uint32_t)buf.index);
+	//LogVerbose(LOG_V4L2 "recieved %ux%u video frame (index=%u)\n", mWidth, mHeight, (uint32_t)buf.index);
+
+	// hold onto the buffer until the next Capture(), so the driver
+	// doesn't overwrite the image while the caller is still using it
+	mBuffersMMap[buf.index].buf = buf;
+	mHeldBuffer = buf.index;
+
+	// the driver timestamps are normally CLOCK_MONOTONIC, taken when the frame started
+	const uint64_t timestamp = uint64_t(buf.timestamp.tv_sec) * uint64_t(1000000000) + uint64_t(buf.timestamp.tv_usec) * uint64_t(1000);
+
+	mLastTimestamp = timestamp;
+
+	if( (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC )
+		mLastCaptureTime = timestamp;
+	else
+		mLastCaptureTime = 0;
+
+	return mBuffersMMap[buf.index].ptr;
+}
+
+
+// Capture
+bool v4l2Camera::Capture( void** output, imageFormat format, uint64_t timeout )
+{
+	// verify the output pointer exists
+	if( !output )
+		return false;
+
+	// confirm the stream is open
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	NVTX_RANGE_FMT("v4l2Camera::Capture (%s)", mOptions.resource.string.c_str());
+
+	const uint32_t width  = mOptions.width;
+	const uint32_t height = mOptions.height;
+
+	// dequeue the next frame from the driver
+	void* frame = CaptureRaw(timeout);
+
+	if( !frame )
+		return false;
+
+	// allocate the ring buffers for the requested format
+	const size_t outputSize = imageFormatSize(format, width, height);
+
+	if( !mBufferRGB.Alloc(mOptions.numBuffers, outputSize, mOptions.zeroCopy ? RingBuffer::ZeroCopy : 0) )
+	{
+		LogError(LOG_V4L2 "v4l2Camera -- failed to allocate %u buffers (%zu bytes each)\n", mOptions.numBuffers, outputSize);
+		return false;
+	}
+
+	void* nextBuffer = mBufferRGB.Peek(RingBuffer::Write);
+
+	if( !nextBuffer )
+		return false;
 
-	void* image_ptr = mBuffersMMap[buf.index].ptr;
+	if( !convertFrame(frame, nextBuffer, format) )
+		return false;
+
+	*output = mBufferRGB.Next(RingBuffer::Write);
+	mOptions.frameCount++;
 
-	// re-queue buffer to V4L2
-	if( xioctl(mFD, VIDIOC_QBUF, &buf) < 0 )
-		printf("v4l2 -- ioctl(VIDIOC_QBUF) failed (errno=%i) (%s)\n", errno, strerror(errno));
+	if( !flipCapture(output, format) )
+		return false;
 
-	return image_ptr;
+	stampCapture(*output, format);
+	return true;
+}
+
+
+// convertFrame
+bool v4l2Camera::convertFrame( void* frame, void* output, imageFormat format )
+{
+	const uint32_t width  = mOptions.width;
+	const uint32_t height = mOptions.height;
+
+	// get the frame into GPU-accessible memory without any line padding
+	const bool planar = (mRawFormat == IMAGE_NV12 || mRawFormat == IMAGE_I420 || mRawFormat == IMAGE_YV12);
+
+	const size_t frameSize = imageFormatSize(mRawFormat, width, height);
+	const size_t packedPitch = planar ? width : (width * imageFormatDepth(mRawFormat)) / 8;
+
+	if( !IsZeroCopy() || mPitch != packedPitch )
+	{
+		if( !mStaging && !cudaAllocMappedPooled(&mStaging, frameSize) )
+			return false;
+
+		if( mPitch == packedPitch )
+		{
+			if( CUDA_FAILED(cudaMemcpy(mStaging, frame, frameSize, cudaMemcpyHostToDevice)) )
+				return false;
+		}
+		else if( mRawFormat == IMAGE_NV12 || !planar )
+		{
+			// NV12's interleaved chroma plane has the same pitch as the luma plane
+			const size_t rows = (mRawFormat == IMAGE_NV12) ? (height * 3) / 2 : height;
+
+			if( CUDA_FAILED(cudaMemcpy2D(mStaging, packedPitch, frame, mPitch, packedPitch, rows, cudaMemcpyHostToDevice)) )
+				return false;
+		}
+		else
+		{
+			// I420/YV12 have two chroma planes at half the pitch, which add up to 'height' rows
+			uint8_t* dst = (uint8_t*)mStaging;
+			uint8_t* src = (uint8_t*)frame;
+
+			if( CUDA_FAILED(cudaMemcpy2D(dst, width, src, mPitch, width, height, cudaMemcpyHostToDevice)) )
+				return false;
+
+			if( CUDA_FAILED(cudaMemcpy2D(dst + width * height, width / 2, src + mPitch * height, mPitch / 2, width / 2, height, cudaMemcpyHostToDevice)) )
+				return false;
+		}
+
+		frame = mStaging;
+	}
+
+	// convert into the output buffer
+	if( format == mRawFormat )
+	{
+		if( CUDA_FAILED(cudaMemcpy(output, frame, frameSize, cudaMemcpyDeviceToDevice)) )
+			return false;
+	}
+	else if( imageFormatIsBayer16(mRawFormat) )
+	{
+		// the 16-bit formats need their bit depth, which cudaConvertColor() doesn't know
+		if( CUDA_FAILED(cudaBayerDemosaic(frame, mRawFormat, output, format, width, height, mBayerOptions)) )
+			return false;
+	}
+	else if( CUDA_FAILED(cudaConvertColor(frame, mRawFormat, output, format, width, height)) )
+	{
+		LogError(LOG_V4L2 "v4l2Camera -- unsupported image format conversion (%s -> %s)\n", imageFormatToStr(mRawFormat), imageFormatToStr(format));
+		return false;
+	}
+
+	// the capture buffer gets re-queued to the driver by the next frame
+	if( CUDA_FAILED(cudaStreamSynchronize(NULL)) )
+		return false;
+
+	return true;
+}
+
+
+// FormatFromV4L2
+imageFormat v4l2Camera::FormatFromV4L2( uint32_t pixelformat )
+{
+	switch(pixelformat)
+	{
+		case V4L2_PIX_FMT_SBGGR8:	return IMAGE_BAYER_BGGR;
+		case V4L2_PIX_FMT_SGBRG8:	return IMAGE_BAYER_GBRG;
+		case V4L2_PIX_FMT_SGRBG8:	return IMAGE_BAYER_GRBG;
+		case V4L2_PIX_FMT_SRGGB8:	return IMAGE_BAYER_RGGB;
+		case V4L2_PIX_FMT_SBGGR10:
+		case V4L2_PIX_FMT_SBGGR12:
+		case V4L2_PIX_FMT_SBGGR16:	return IMAGE_BAYER_BGGR16;
+		case V4L2_PIX_FMT_SGBRG10:
+		case V4L2_PIX_FMT_SGBRG12:
+		case V4L2_PIX_FMT_SGBRG16:	return IMAGE_BAYER_GBRG16;
+		case V4L2_PIX_FMT_SGRBG10:
+		case V4L2_PIX_FMT_SGRBG12:
+		case V4L2_PIX_FMT_SGRBG16:	return IMAGE_BAYER_GRBG16;
+		case V4L2_PIX_FMT_SRGGB10:
+		case V4L2_PIX_FMT_SRGGB12:
+		case V4L2_PIX_FMT_SRGGB16:	return IMAGE_BAYER_RGGB16;
+		case V4L2_PIX_FMT_YUYV:		return IMAGE_YUYV;
+		case V4L2_PIX_FMT_YVYU:		return IMAGE_YVYU;
+		case V4L2_PIX_FMT_UYVY:		return IMAGE_UYVY;
+		case V4L2_PIX_FMT_NV12:		return IMAGE_NV12;
+		case V4L2_PIX_FMT_YUV420:	return IMAGE_I420;
+		case V4L2_PIX_FMT_YVU420:	return IMAGE_YV12;
+		case V4L2_PIX_FMT_RGB24:		return IMAGE_RGB8;
+		case V4L2_PIX_FMT_BGR24:		return IMAGE_BGR8;
+		case V4L2_PIX_FMT_GREY:		return IMAGE_GRAY8;
+	}
+
+	return IMAGE_UNKNOWN;
 }
 
 
@@ -164,13 +370,13 @@ bool v4l2Camera::initMMap()
 
 	if( xioctl(mFD, VIDIOC_REQBUFS, &req) < 0 )
 	{
-		printf("v4l2 -- does not support mmap (errno=%i) (%s)\n", errno, strerror(errno));
+		LogError(LOG_V4L2 "does not support mmap (errno=%i) (%s)\n", errno, strerror(errno));
 		return false;
 	}
 
 	if( req.count < 2 )
 	{
-		printf("v4l2 -- insufficient mmap memory\n");
+		LogError(LOG_V4L2 "insufficient mmap memory\n");
 		return false;
 	}
 
@@ -189,7 +395,7 @@ bool v4l2Camera::initMMap()
 		
 		if( xioctl(mFD, VIDIOC_QUERYBUF, &mBuffersMMap[n].buf) < 0 )
 		{
-			printf( "v4l2 -- failed retrieve mmap buffer info (errno=%i) (%s)\n", errno, strerror(errno));
+			LogError(LOG_V4L2 "failed retrieve mmap buffer info (errno=%i) (%s)\n", errno, strerror(errno));
 			return false;
 		}
 
@@ -199,19 +405,19 @@ bool v4l2Camera::initMMap()
 
 		if( mBuffersMMap[n].ptr == MAP_FAILED )
 		{
-			printf( "v4l2 -- failed to mmap buffer (errno=%i) (%s)\n", errno, strerror(errno));
+			LogError(LOG_V4L2 "failed to mmap buffer (errno=%i) (%s)\n", errno, strerror(errno));
 			return false;
 		}
 
 		if( xioctl(mFD, VIDIOC_QBUF, &mBuffersMMap[n].buf) < 0 )
 		{
-			printf( "v4l2 -- failed to queue mmap buffer (errno=%i) (%s)\n", errno, strerror(errno));
+			LogError(LOG_V4L2 "failed to queue mmap buffer (errno=%i) (%s)\n", errno, strerror(errno));
 			return false;
 		}
 	}
 
 	mBufferCountMMap = req.count;	
-	printf("v4l2 -- mapped %zu capture buffers with mmap\n", mBufferCountMMap); 	
+	LogVerbose(LOG_V4L2 "mapped %zu capture buffers with mmap\n", mBufferCountMMap); 	
 	return true;
 }
 
@@ -224,6 +430,16 @@ inline const char* v4l2_format_str( uint32_t fmt )
 	else if( fmt == V4L2_PIX_FMT_SRGGB8 )  return "SRGGB8 (V4L2_PIX_FMT_SRGGB8)";
 	else if( fmt == V4L2_PIX_FMT_SBGGR16 ) return "BYR2 (V4L2_PIX_FMT_SBGGR16)";
 	else if( fmt == V4L2_PIX_FMT_SRGGB10 ) return "RG10 (V4L2_PIX_FMT_SRGGB10)";
+	else if( fmt == V4L2_PIX_FMT_YUYV )    return "YUYV (V4L2_PIX_FMT_YUYV)";
+	else if( fmt == V4L2_PIX_FMT_YVYU )    return "YVYU (V4L2_PIX_FMT_YVYU)";
+	else if( fmt == V4L2_PIX_FMT_UYVY )    return "UYVY (V4L2_PIX_FMT_UYVY)";
+	else if( fmt == V4L2_PIX_FMT_NV12 )    return "NV12 (V4L2_PIX_FMT_NV12)";
+	else if( fmt == V4L2_PIX_FMT_YUV420 )  return "YU12 (V4L2_PIX_FMT_YUV420)";
+	else if( fmt == V4L2_PIX_FMT_YVU420 )  return "YV12 (V4L2_PIX_FMT_YVU420)";
+	else if( fmt == V4L2_PIX_FMT_RGB24 )   return "RGB3 (V4L2_PIX_FMT_RGB24)";
+	else if( fmt == V4L2_PIX_FMT_BGR24 )   return "BGR3 (V4L2_PIX_FMT_BGR24)";
+	else if( fmt == V4L2_PIX_FMT_GREY )    return "GREY (V4L2_PIX_FMT_GREY)";
+	else if( fmt == V4L2_PIX_FMT_MJPEG )   return "MJPG (V4L2_PIX_FMT_MJPEG)";
 	
 	return "UNKNOWN";
 }
@@ -231,23 +447,23 @@ inline const char* v4l2_format_str( uint32_t fmt )
 
 inline void v4l2_print_format( const v4l2_format& fmt, const char* text )
 {
-	printf("v4l2 -- %s\n", text);
-	printf("v4l2 --   width  %u\n", fmt.fmt.pix.width);
-	printf("v4l2 --   height %u\n", fmt.fmt.pix.height);
-	printf("v4l2 --   pitch  %u\n", fmt.fmt.pix.bytesperline);
-	printf("v4l2 --   size   %u\n", fmt.fmt.pix.sizeimage);
-	printf("v4l2 --   format 0x%X  %s\n", fmt.fmt.pix.pixelformat, v4l2_format_str(fmt.fmt.pix.pixelformat));
-	printf("v4l2 --   color  0x%X\n", fmt.fmt.pix.colorspace);
-	printf("v4l2 --   field  0x%X\n", fmt.fmt.pix.field);
+	LogVerbose(LOG_V4L2 "%s\n", text);
+	LogVerbose(LOG_V4L2 "  width  %u\n", fmt.fmt.pix.width);
+	LogVerbose(LOG_V4L2 "  height %u\n", fmt.fmt.pix.height);
+	LogVerbose(LOG_V4L2 "  pitch  %u\n", fmt.fmt.pix.bytesperline);
+	LogVerbose(LOG_V4L2 "  size   %u\n", fmt.fmt.pix.sizeimage);
+	LogVerbose(LOG_V4L2 "  format 0x%X  %s\n", fmt.fmt.pix.pixelformat, v4l2_format_str(fmt.fmt.pix.pixelformat));
+	LogVerbose(LOG_V4L2 "  color  0x%X\n", fmt.fmt.pix.colorspace);
+	LogVerbose(LOG_V4L2 "  field  0x%X\n", fmt.fmt.pix.field);
 }
 
 
 inline void v4l2_print_formatdesc( const v4l2_fmtdesc& desc )
 {
-	printf("v4l2 -- format #%u\n", desc.index);
-	printf("v4l2 --   desc   %s\n", desc.description);
-	printf("v4l2 --   flags  %s\n", (desc.flags == 0 ? "V4L2_FMT_FLAG_UNCOMPRESSED" : "V4L2_FMT_FLAG_COMPRESSED"));
-	printf("v4l2 --   fourcc 0x%X  %s\n", desc.pixelformat, v4l2_format_str(desc.pixelformat));
+	LogVerbose(LOG_V4L2 "format #%u\n", desc.index);
+	LogVerbose(LOG_V4L2 "  desc   %s\n", desc.description);
+	LogVerbose(LOG_V4L2 "  flags  %s\n", (desc.flags == 0 ? "V4L2_FMT_FLAG_UNCOMPRESSED" : "V4L2_FMT_FLAG_COMPRESSED"));
+	LogVerbose(LOG_V4L2 "  fourcc 0x%X  %s\n", desc.pixelformat, v4l2_format_str(desc.pixelformat));
 	
 }
 	
@@ -282,12 +498,25 @@ bool v4l2Camera::initStream()
 	if( xioctl(mFD, VIDIOC_G_FMT, &fmt) < 0 )
 	{
 		const int err = errno;
-		printf( "v4l2 -- failed to get video format of device (errno=%i) (%s)\n", errno, strerror(errno));
+		LogError(LOG_V4L2 "failed to get video format of device (errno=%i) (%s)\n", errno, strerror(errno));
 		return false;
 	}
 
 	v4l2_print_format(fmt, "preexisting format");
 
+	// if the current format can't be converted, switch to the first one that can
+	if( mRequestFormat < 0 && FormatFromV4L2(fmt.fmt.pix.pixelformat) == IMAGE_UNKNOWN )
+	{
+		for( size_t n=0; n < mFormats.size(); n++ )
+		{
+			if( FormatFromV4L2(mFormats[n].pixelformat) != IMAGE_UNKNOWN )
+			{
+				mRequestFormat = n;
+				break;
+			}
+		}
+	}
+
 #if 1
 	// setup new format
 	struct v4l2_format new_fmt;	
@@ -300,10 +529,10 @@ bool v4l2Camera::initStream()
 	new_fmt.fmt.pix.field       = fmt.fmt.pix.field;
 	new_fmt.fmt.pix.colorspace  = fmt.fmt.pix.colorspace;
 
-	if( mRequestWidth > 0 && mRequestHeight > 0 )
+	if( mOptions.width > 0 && mOptions.height > 0 )
 	{
-		new_fmt.fmt.pix.width  = mRequestWidth;
-		new_fmt.fmt.pix.height = mRequestHeight;
+		new_fmt.fmt.pix.width  = mOptions.width;
+		new_fmt.fmt.pix.height = mOptions.height;
 	}
 
 	if( mRequestFormat >= 0 && mRequestFormat < mFormats.size() )
@@ -314,7 +543,7 @@ bool v4l2Camera::initStream()
 	if( xioctl(mFD, VIDIOC_S_FMT, &new_fmt) < 0 )
 	{
 		const int err = errno;
-		printf( "v4l2 -- failed to set video format of device (errno=%i) (%s)\n", errno, strerror(errno));
+		LogError(LOG_V4L2 "failed to set video format of device (errno=%i) (%s)\n", errno, strerror(errno));
 		return false;
 	}
 
@@ -326,34 +555,85 @@ bool v4l2Camera::initStream()
 	if( xioctl(mFD, VIDIOC_G_FMT, &fmt) < 0 )
 	{
 		const int err = errno;
-		printf( "v4l2 -- failed to get video format of device (errno=%i) (%s)\n", errno, strerror(errno));
+		LogError(LOG_V4L2 "failed to get video format of device (errno=%i) (%s)\n", errno, strerror(errno));
 		return false;
 	}
 
 	v4l2_print_format(fmt, "confirmed new format");
 #endif
 
-	mWidth      = fmt.fmt.pix.width;
-	mHeight     = fmt.fmt.pix.height;
+	mRawFormat  = FormatFromV4L2(fmt.fmt.pix.pixelformat);
+
+	if( mRawFormat == IMAGE_UNKNOWN )
+	{
+		LogError(LOG_V4L2 "%s uses an unsupported pixel format (%s), use gstCamera for compressed formats\n", mDevicePath.c_str(), v4l2_format_str(fmt.fmt.pix.pixelformat));
+		return false;
+	}
+
+	// the unpacked 10/12-bit Bayer formats are LSB-aligned in 16 bits
+	switch( fmt.fmt.pix.pixelformat )
+	{
+		case V4L2_PIX_FMT_SBGGR10: case V4L2_PIX_FMT_SGBRG10: case V4L2_PIX_FMT_SGRBG10: case V4L2_PIX_FMT_SRGGB10:	mBayerOptions.bitDepth = 10; break;
+		case V4L2_PIX_FMT_SBGGR12: case V4L2_PIX_FMT_SGBRG12: case V4L2_PIX_FMT_SGRBG12: case V4L2_PIX_FMT_SRGGB12:	mBayerOptions.bitDepth = 12; break;
+		default:																				mBayerOptions.bitDepth = 16; break;
+	}
+
+	mOptions.width  = fmt.fmt.pix.width;
+	mOptions.height = fmt.fmt.pix.height;
+	mOptions.codec  = videoOptions::CODEC_RAW;
+
 	mPitch      = fmt.fmt.pix.bytesperline;
-	mPixelDepth = (mPitch * 8) / mWidth;
+	mPixelDepth = (mPitch * 8) / mOptions.width;
+	mImageSize  = fmt.fmt.pix.sizeimage;
 
-	// initMMap
-	if( !initMMap() )		// initUserPtr()
+	if( mImageSize == 0 )
+		mImageSize = mPitch * mOptions.height;
+
+	// allocate the capture buffers
+	if( mMemory != MEMORY_MMAP )
+	{
+		if( initUserPtr() )
+			return true;
+
+		if( mMemory == MEMORY_USERPTR )
+			return false;
+
+		LogVerbose(LOG_V4L2 "falling back to mmap capture buffers\n");
+	}
+
+	if( !initMMap() )
 		return false;
 
+	mMemory = MEMORY_MMAP;
 	return true;
 }
 
 
 // Create
-v4l2Camera* v4l2Camera::Create( const char* device_path )
+v4l2Camera* v4l2Camera::Create( const char* device_path, Memory memory )
+{
+	videoOptions opt;
+
+	if( !opt.resource.Parse(device_path) )
+		return NULL;
+
+	return Create(opt, memory);
+}
+
+
+// Create
+v4l2Camera* v4l2Camera::Create( const videoOptions& options, Memory memory )
 {
-	v4l2Camera* cam = new v4l2Camera(device_path);
+	videoOptions opt = options;
+
+	opt.deviceType = videoOptions::DEVICE_V4L2;
+	opt.ioType     = videoOptions::INPUT;
+
+	v4l2Camera* cam = new v4l2Camera(opt, memory);
 
 	if( !cam->init() )
 	{
-		printf("v4l2 -- failed to create instance %s\n", device_path);
+		LogError(LOG_V4L2 "failed to create instance %s\n", opt.resource.location.c_str());
 		delete cam;
 		return NULL;
 	}
@@ -370,7 +650,7 @@ bool v4l2Camera::init()
 
 	if( mFD < 0 )
 	{
-		printf( "v4l2 -- failed to open %s\n", mDevicePath.c_str());
+		LogError(LOG_V4L2 "failed to open %s\n", mDevicePath.c_str());
 		return false;
 	}
 
@@ -391,38 +671,50 @@ bool v4l2Camera::init()
 // Open
 bool v4l2Camera::Open()
 {
-	printf( "v4l2Camera::Open(%s)\n", mDevicePath.c_str());
+	if( mStreaming )
+		return true;
 
 	// begin streaming
 	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-	printf( "v4l2 -- starting streaming %s with ioctl(VIDIOC_STREAMON)...\n", mDevicePath.c_str());
+	LogVerbose(LOG_V4L2 "starting streaming %s with ioctl(VIDIOC_STREAMON)...\n", mDevicePath.c_str());
 
 	if( xioctl(mFD, VIDIOC_STREAMON, &type) < 0 )
 	{
-		printf( "v4l2 -- failed to start streaming (errno=%i) (%s)\n", errno, strerror(errno));
+		LogError(LOG_V4L2 "failed to start streaming (errno=%i) (%s)\n", errno, strerror(errno));
 		return false;
 	}
 
+	mStreaming = true;
 	return true;
 }
 
 
 // Close
-bool v4l2Camera::Close()
+void v4l2Camera::Close()
 {
+	if( !mStreaming )
+		return;
+
 	// stop streaming
 	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-	printf( "v4l2 -- stopping streaming %s with ioctl(VIDIOC_STREAMOFF)...\n", mDevicePath.c_str());
+	LogVerbose(LOG_V4L2 "stopping streaming %s with ioctl(VIDIOC_STREAMOFF)...\n", mDevicePath.c_str());
 
 	if( xioctl(mFD, VIDIOC_STREAMOFF, &type) < 0 )
 	{
-		printf( "v4l2 -- failed to stop streaming (errno=%i) (%s)\n", errno, strerror(errno));
-		//return false;
+		LogError(LOG_V4L2 "failed to stop streaming (errno=%i) (%s)\n", errno, strerror(errno));
 	}
 
-	return true;
+	// STREAMOFF returns all of the buffers to the application, so re-queue them
+	for( size_t n=0; n < mBufferCountMMap; n++ )
+	{
+		if( xioctl(mFD, VIDIOC_QBUF, &mBuffersMMap[n].buf) < 0 )
+			LogError(LOG_V4L2 "failed to re-queue buffer %zu (errno=%i) (%s)\n", n, errno, strerror(errno));
+	}
+
+	mHeldBuffer = -1;
+	mStreaming  = false;
 }
 
 
@@ -434,11 +726,11 @@ bool v4l2Camera::initCaps()
 
 	if( xioctl(mFD, VIDIOC_QUERYCAP, &caps) < 0 )
 	{
-		printf( "v4l2 -- failed to query caps (xioctl VIDIOC_QUERYCAP) for %s\n", mDevicePath.c_str());
+		LogError(LOG_V4L2 "failed to query caps (xioctl VIDIOC_QUERYCAP) for %s\n", mDevicePath.c_str());
 		return false;
 	}
 
-	#define PRINT_CAP(x) printf( "v4l2 -- %-18s %s\n", #x, (caps.capabilities & x) ? "yes" : "no")
+	#define PRINT_CAP(x) LogVerbose(LOG_V4L2 "%-18s %s\n", #x, (caps.capabilities & x) ? "yes" : "no")
 
 	PRINT_CAP(V4L2_CAP_VIDEO_CAPTURE);
 	PRINT_CAP(V4L2_CAP_READWRITE);
@@ -447,7 +739,7 @@ bool v4l2Camera::initCaps()
 	
 	if( !(caps.capabilities & V4L2_CAP_VIDEO_CAPTURE) )
 	{
-		printf( "v4l2 -- %s is not a video capture device\n", mDevicePath.c_str());
+		LogError(LOG_V4L2 "%s is not a video capture device\n", mDevicePath.c_str());
 		return false;
 	}
 
@@ -468,32 +760,93 @@ bool v4l2Camera::initUserPtr()
 
 	if ( xioctl(mFD, VIDIOC_REQBUFS, &req) < 0 ) 
 	{
-		const int err = errno;
-		printf( "v4l2 -- failed to request buffers (errno=%i) (%s)\n", errno, strerror(errno));
+		// EINVAL means that the driver doesn't support USERPTR
+		LogVerbose(LOG_V4L2 "driver doesn't support USERPTR buffers (errno=%i) (%s)\n", errno, strerror(errno));
+		return false;
+	}
+
+	if( req.count < 2 )
+	{
+		LogError(LOG_V4L2 "insufficient USERPTR buffers (%u)\n", req.count);
 		return false;
 	}
 
+	// allocate the buffers in mapped CPU/GPU memory (cudaHostAlloc is page-aligned)
+	mBuffersMMap = (v4l2_mmap*)malloc( req.count * sizeof(v4l2_mmap) );
+
+	if( !mBuffersMMap )
+		return false;
+
+	memset(mBuffersMMap, 0, req.count * sizeof(v4l2_mmap));
+	mMemory = MEMORY_USERPTR;
+
 	// queue ringbuffer
-#if 0
-	for( size_t n=0; n < mRingbuffer.size(); n++ )
+	for( size_t n=0; n < req.count; n++ )
 	{
-		struct v4l2_buffer buf;
-		memset(&buf, 0, sizeof(v4l2_buffer));
+		if( !cudaAllocMapped(&mBuffersMMap[n].ptr, mImageSize) )
+		{
+			LogError(LOG_V4L2 "failed to allocate %u-byte USERPTR buffer\n", mImageSize);
+			freeBuffers();
+			return false;
+		}
+
+		mBufferCountMMap++;
+
+		struct v4l2_buffer* buf = &mBuffersMMap[n].buf;
 		
-		buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		buf.memory = V4L2_MEMORY_USERPTR;
-		buf.index  = n;
-		buf.length = mRingbuffer[n]->GetSize();
+		buf->type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf->memory = V4L2_MEMORY_USERPTR;
+		buf->index  = n;
+		buf->length = mImageSize;
 
-		buf.m.userptr = (unsigned long)mRingbuffer[n]->GetCPU();
+		buf->m.userptr = (unsigned long)mBuffersMMap[n].ptr;
 
-		if( xioctl(mFD, VIDIOC_QBUF, &buf) < 0 )
+		if( xioctl(mFD, VIDIOC_QBUF, buf) < 0 )
 		{
-			printf( "v4l2 -- failed to queue buffer %zu (errno=%i) (%s)\n", n, errno, strerror(errno));
+			LogError(LOG_V4L2 "failed to queue buffer %zu (errno=%i) (%s)\n", n, errno, strerror(errno));
+			freeBuffers();
 			return false;
 		}
 	}
-#endif
 
+	LogVerbose(LOG_V4L2 "allocated %zu zero-copy capture buffers with USERPTR\n", mBufferCountMMap); 	
 	return true;
 }
+
+
+// freeBuffers
+void v4l2Camera::freeBuffers()
+{
+	if( !mBuffersMMap )
+		return;
+
+	for( size_t n=0; n < mBufferCountMMap; n++ )
+	{
+		if( !mBuffersMMap[n].ptr )
+			continue;
+
+		if( mMemory == MEMORY_USERPTR )
+			cudaFreeMapped(mBuffersMMap[n].ptr);
+		else if( mBuffersMMap[n].ptr != MAP_FAILED )
+			munmap(mBuffersMMap[n].ptr, mBuffersMMap[n].buf.length);
+	}
+
+	free(mBuffersMMap);
+
+	// release the buffers from the driver, so another memory type can be requested
+	if( mFD >= 0 )
+	{
+		struct v4l2_requestbuffers req;
+		memset(&req, 0, sizeof(v4l2_requestbuffers));
+
+		req.count  = 0;
+		req.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		req.memory = (mMemory == MEMORY_USERPTR) ? V4L2_MEMORY_USERPTR : V4L2_MEMORY_MMAP;
+
+		xioctl(mFD, VIDIOC_REQBUFS, &req);
+	}
+
+	mBuffersMMap     = NULL;
+	mBufferCountMMap = 0;
+	mHeldBuffer      = -1;
+}
@@ -23,6 +23,10 @@
 #ifndef __V4L2_CAPTURE_H__
 #define __V4L2_CAPTURE_H__
 
+#include "videoSource.h"
+#include "RingBuffer.h"
+#include "cudaBayer.h"
+
 #include <linux/videodev2.h>
 
 #include <stdint.h>
@@ -30,52 +34,101 @@
 #include <vector>
 
 
+/**
+ * V4L2 logging prefix
+ * @ingroup camera
+ */
+#define LOG_V4L2 "[v4l2]   "
+
 
 /**
- * Video4Linux2 (V4L2) camera capture streaming.
+ * Video4Linux2 (V4L2) camera capture streaming, without going through GStreamer.
+ *
+ * v4l2Camera implements the videoSource interface, and can be created from videoSource::Create()
+ * with the `v4l2raw://` protocol (e.g. `v4l2raw:///dev/video0`).  Frames are dequeued straight
+ * from the driver and converted on the GPU with cudaConvertColor() (which uses cudaBayerToRGB()
+ * for Bayer sensors and cudaYUYVToRGBA() ect. for packed YUV) into a ring buffer of the format
+ * that Capture() requests.  The uncompressed formats supported are Bayer (BGGR/GBRG/GRBG/RGGB in
+ * 8, 10, 12, or 16 bits, where the deeper ones use cudaBayerDemosaic()), YUYV/YVYU/UYVY, NV12, I420, RGB/BGR, and grayscale - compressed formats like MJPEG aren't,
+ * so use gstCamera (`v4l2://`) for those cameras instead.
+ *
+ * The capture buffers can either be allocated by the driver and mmap'd (MEMORY_MMAP),
+ * or be allocated in mapped CPU/GPU memory with cudaHostAlloc() and handed to the driver
+ * with V4L2_MEMORY_USERPTR (MEMORY_USERPTR).  In the USERPTR mode, the driver writes the
+ * frames straight into memory that CUDA can access, so they don't need to be copied.
+ * MEMORY_AUTO tries USERPTR first, and falls back to MMAP if the driver doesn't support it.
+ *
  * @note gstCamera, which convieniently handles both V4L2 and MIPI CSI cameras,
  * is used mostly in lieu of v4l2Camera. v4l2Camera is provided in the event that 
  * you would rather interface with V4L2 directly, rather than go through GStreamer.
+ *
+ * @see videoSource
  * @ingroup camera
  */
-class v4l2Camera
+class v4l2Camera : public videoSource
 {
 public:	
+	/**
+	 * How the capture buffers are allocated.
+	 */
+	enum Memory
+	{
+		MEMORY_AUTO = 0,	/**< Use USERPTR if the driver supports it, otherwise MMAP */
+		MEMORY_MMAP,		/**< Buffers allocated by the driver and mmap'd (CPU only) */
+		MEMORY_USERPTR	/**< Buffers allocated in mapped CPU/GPU memory, passed to the driver by pointer */
+	};
+
 	/**
 	 * Create V4L2 interface
 	 * @param path Filename of the video device (e.g. /dev/video0)
+	 * @param memory how the capture buffers should be allocated
 	 */
-	static v4l2Camera* Create( const char* device_path );
+	static v4l2Camera* Create( const char* device_path, Memory memory=MEMORY_AUTO );
+
+	/**
+	 * Create V4L2 interface from the provided video options.  The resource should be
+	 * the device path (e.g. `/dev/video0`, `v4l2:///dev/video0`, or `v4l2raw:///dev/video0`),
+	 * and videoOptions::width and videoOptions::height select the resolution (if set).
+	 */
+	static v4l2Camera* Create( const videoOptions& options, Memory memory=MEMORY_AUTO );
 
 	/**
 	 * Destructor
 	 */	
-	~v4l2Camera();
+	virtual ~v4l2Camera();
 
 	/**
- 	 * Start streaming
+	 * Capture the next image, converted to the requested format.
+	 * @see videoSource::Capture()
 	 */
-	bool Open();
-
+	template<typename T> bool Capture( T** image, uint64_t timeout=DEFAULT_TIMEOUT )		{ return Capture((void**)image, imageFormatFromType<T>(), timeout); }
+	
 	/**
-	 * Stop streaming
+	 * Capture the next image, converted to the requested format.
+	 * @see videoSource::Capture()
 	 */
-	bool Close();
+	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT );
 
 	/**
-	 * Return the next image.
+	 * Return the next image from the driver, in the camera's native format (see GetRawFormat()).
+	 *
+	 * The image stays valid until the next call to CaptureRaw() or Capture(), after which its
+	 * buffer gets queued back to the driver.  If IsZeroCopy() is true, the image can be
+	 * accessed from CUDA without copying it.
 	 */
-	void* Capture( size_t timeout=0 );
+	void* CaptureRaw( size_t timeout=0 );
 
 	/**
-	 * Get width, in pixels, of camera image.
+ 	 * Start streaming
+	 * @see videoSource::Open()
 	 */
-	inline uint32_t GetWidth() const					{ return mWidth; }
-	
+	virtual bool Open();
+
 	/**
-	 * Retrieve height, in pixels, of camera image.
+	 * Stop streaming
+	 * @see videoSource::Close()
 	 */
-	inline uint32_t GetHeight() const					{ return mHeight; }
+	virtual void Close();
 
 	/**
  	 * Return the size in bytes of one line of the image.
@@ -87,9 +140,51 @@ public:
 	 */
 	inline uint32_t GetPixelDepth() const				{ return mPixelDepth; }
 
+	/**
+	 * Return how the capture buffers were allocated (MEMORY_MMAP or MEMORY_USERPTR).
+	 */
+	inline Memory GetMemory() const					{ return mMemory; }
+
+	/**
+	 * Return true if the captured images are in mapped CPU/GPU memory that CUDA can access.
+	 */
+	inline bool IsZeroCopy() const					{ return (mMemory == MEMORY_USERPTR); }
+
+	/**
+	 * Return the interface type (v4l2Camera::Type)
+	 */
+	virtual inline uint32_t GetType() const				{ return Type; }
+
+	/**
+	 * Unique type identifier of v4l2Camera class.
+	 */
+	static const uint32_t Type = (1 << 9);
+
+	/**
+	 * Convert a V4L2 pixel format (fourcc) to imageFormat, or IMAGE_UNKNOWN if it isn't supported.
+	 */
+	static imageFormat FormatFromV4L2( uint32_t pixelformat );
+
+	/**
+	 * Get the demosaic settings used for the 16-bit Bayer formats.
+	 */
+	inline const cudaBayerOptions& GetBayerOptions() const	{ return mBayerOptions; }
+
+	/**
+	 * Set the demosaic settings used for the 16-bit Bayer formats (e.g. white balance and gamma).
+	 * The bit depth gets set from the camera's pixel format, but can be overridden here.
+	 */
+	inline void SetBayerOptions( const cudaBayerOptions& options )	{ mBayerOptions = options; }
+
+	/**
+	 * Return the file descriptor of the device (for polling it).
+	 */
+	inline int GetFD() const							{ return mFD; }
+
 private:
+	friend class v4l2CameraGroup;
 
-	v4l2Camera( const char* device_path );
+	v4l2Camera( const videoOptions& options, Memory memory );
 
 	bool init();
 	bool initCaps();
@@ -98,15 +193,17 @@ private:
 
 	bool initUserPtr();
 	bool initMMap();
+	void freeBuffers();
+
+	void* dequeue();
+	void  requeue();
+	bool  convertFrame( void* frame, void* output, imageFormat format );
 
 	int 	    mFD;
 	int	    mRequestFormat;
-	uint32_t mRequestWidth;
-	uint32_t mRequestHeight;
-	uint32_t mWidth;
-	uint32_t mHeight;
 	uint32_t mPitch;
 	uint32_t mPixelDepth;
+	uint32_t mImageSize;
 
 	struct v4l2_mmap
 	{
@@ -114,14 +211,21 @@ private:
 		void*  ptr;
 	};
 
-	v4l2_mmap* mBuffersMMap;
+	v4l2_mmap* mBuffersMMap;		// the capture buffers (either mmap'd or USERPTR)
 	size_t mBufferCountMMap;
 
+	Memory mMemory;
+	int    mHeldBuffer;			// buffer returned by the last CaptureRaw() (or -1)
+
 	std::vector<v4l2_fmtdesc> mFormats;
 	std::string mDevicePath;
+
+	RingBuffer mBufferRGB;			// converted frames returned by Capture()
+	void*      mStaging;			// GPU copy of mmap'd or padded frames
+
+	cudaBayerOptions mBayerOptions;
 };
 
 
 #endif
 
-
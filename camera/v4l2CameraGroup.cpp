@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "v4l2CameraGroup.h"
+#include "logging.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+
+// how often the capture thread wakes up to check if it should stop (in milliseconds)
+#define EPOLL_TIMEOUT 100
+
+
+// constructor
+v4l2CameraGroup::v4l2CameraGroup( imageFormat format )
+{
+	mFormat     = format;
+	mStreaming  = false;
+	mEpoll      = -1;
+	mThreadStop = false;
+}
+
+
+// destructor
+v4l2CameraGroup::~v4l2CameraGroup()
+{
+	Close();
+
+	if( mEpoll >= 0 )
+		close(mEpoll);
+
+	for( size_t n=0; n < mCameras.size(); n++ )
+	{
+		delete mCameras[n]->camera;
+		delete mCameras[n];
+	}
+}
+
+
+// Create
+v4l2CameraGroup* v4l2CameraGroup::Create( const std::vector<std::string>& devices, const videoOptions& options, imageFormat format )
+{
+	v4l2CameraGroup* group = new v4l2CameraGroup(format);
+
+	if( !group->init(devices, options) )
+	{
+		LogError(LOG_V4L2 "v4l2CameraGroup -- failed to create capture group\n");
+		delete group;
+		return NULL;
+	}
+
+	return group;
+}
+
+
+// init
+bool v4l2CameraGroup::init( const std::vector<std::string>& devices, const videoOptions& options )
+{
+	if( devices.size() == 0 )
+	{
+		LogError(LOG_V4L2 "v4l2CameraGroup -- no devices were specified\n");
+		return false;
+	}
+
+	mEpoll = epoll_create1(EPOLL_CLOEXEC);
+
+	if( mEpoll < 0 )
+	{
+		LogError(LOG_V4L2 "v4l2CameraGroup -- epoll_create1() failed (errno=%i) (%s)\n", errno, strerror(errno));
+		return false;
+	}
+
+	for( size_t n=0; n < devices.size(); n++ )
+	{
+		videoOptions opt = options;
+
+		if( !opt.resource.Parse(devices[n].c_str()) )
+			return false;
+
+		v4l2Camera* camera = v4l2Camera::Create(opt);
+
+		if( !camera )
+			return false;
+
+		cameraContext* ctx = new cameraContext();
+
+		ctx->camera  = camera;
+		ctx->dropped = 0;
+
+		mCameras.push_back(ctx);
+
+		// allocate the ring buffers that the frames get converted into
+		const videoOptions& camOpt = camera->GetOptions();
+		const size_t size = imageFormatSize(mFormat, camera->GetWidth(), camera->GetHeight());
+
+		if( !ctx->buffers.Alloc(camOpt.numBuffers, size, camOpt.zeroCopy ? RingBuffer::ZeroCopy : 0) )
+		{
+			LogError(LOG_V4L2 "v4l2CameraGroup -- failed to allocate %u buffers (%zu bytes each)\n", camOpt.numBuffers, size);
+			return false;
+		}
+
+		// the camera's index gets returned by epoll_wait() when it has a frame
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+
+		event.events   = EPOLLIN;
+		event.data.u32 = n;
+
+		if( epoll_ctl(mEpoll, EPOLL_CTL_ADD, camera->GetFD(), &event) < 0 )
+		{
+			LogError(LOG_V4L2 "v4l2CameraGroup -- epoll_ctl() failed for %s (errno=%i) (%s)\n", devices[n].c_str(), errno, strerror(errno));
+			return false;
+		}
+	}
+
+	LogVerbose(LOG_V4L2 "v4l2CameraGroup -- created capture group of %zu cameras\n", mCameras.size());
+	return true;
+}
+
+
+// Open
+bool v4l2CameraGroup::Open()
+{
+	if( mStreaming )
+		return true;
+
+	for( size_t n=0; n < mCameras.size(); n++ )
+	{
+		if( !mCameras[n]->camera->Open() )
+		{
+			for( size_t i=0; i < n; i++ )
+				mCameras[i]->camera->Close();
+
+			return false;
+		}
+	}
+
+	mThreadStop = false;
+
+	if( !mThread.Start(captureThread, this) )
+	{
+		LogError(LOG_V4L2 "v4l2CameraGroup -- failed to start the capture thread\n");
+
+		for( size_t n=0; n < mCameras.size(); n++ )
+			mCameras[n]->camera->Close();
+
+		return false;
+	}
+
+	mStreaming = true;
+	return true;
+}
+
+
+// Close
+void v4l2CameraGroup::Close()
+{
+	if( !mStreaming )
+		return;
+
+	// the thread checks for this at least every EPOLL_TIMEOUT
+	mThreadStop = true;
+	mThread.Stop(true);
+
+	for( size_t n=0; n < mCameras.size(); n++ )
+		mCameras[n]->camera->Close();
+
+	mStreaming = false;
+}
+
+
+// Capture
+bool v4l2CameraGroup::Capture( uint32_t camera, void** image, imageFormat format, uint64_t timeout )
+{
+	if( !image || camera >= mCameras.size() )
+		return false;
+
+	if( format != mFormat )
+	{
+		LogError(LOG_V4L2 "v4l2CameraGroup::Capture() -- requested format %s doesn't match the group's format %s\n", imageFormatToStr(format), imageFormatToStr(mFormat));
+		return false;
+	}
+
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	cameraContext* ctx = mCameras[camera];
+
+	// return the latest frame if it hasn't been read yet
+	void* latest = ctx->buffers.Next(RingBuffer::ReadLatestOnce);
+
+	while( !latest )
+	{
+		if( !ctx->event.Wait(timeout) )
+			return false;
+
+		latest = ctx->buffers.Next(RingBuffer::ReadLatestOnce);
+	}
+
+	*image = latest;
+	return true;
+}
+
+
+// captureFrame
+void v4l2CameraGroup::captureFrame( uint32_t index )
+{
+	cameraContext* ctx = mCameras[index];
+	v4l2Camera* camera = ctx->camera;
+
+	void* frame = camera->dequeue();
+
+	if( !frame )
+		return;
+
+	void* nextBuffer = ctx->buffers.Peek(RingBuffer::Write);
+
+	if( nextBuffer != NULL && camera->convertFrame(frame, nextBuffer, mFormat) )
+	{
+		ctx->buffers.Next(RingBuffer::Write);
+		camera->mOptions.frameCount++;
+		ctx->event.Wake();
+	}
+	else
+	{
+		ctx->dropped++;
+	}
+
+	// the frame has been converted, so the driver can have its buffer back
+	camera->requeue();
+}
+
+
+// captureThread
+void* v4l2CameraGroup::captureThread( void* user )
+{
+	v4l2CameraGroup* group = (v4l2CameraGroup*)user;
+
+	const int maxEvents = group->mCameras.size();
+	struct epoll_event* events = new epoll_event[maxEvents];
+
+	while( !group->mThreadStop )
+	{
+		const int numEvents = epoll_wait(group->mEpoll, events, maxEvents, EPOLL_TIMEOUT);
+
+		if( numEvents < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			LogError(LOG_V4L2 "v4l2CameraGroup -- epoll_wait() failed (errno=%i) (%s)\n", errno, strerror(errno));
+			break;
+		}
+
+		for( int n=0; n < numEvents; n++ )
+		{
+			const uint32_t index = events[n].data.u32;
+
+			if( events[n].events & EPOLLIN )
+			{
+				group->captureFrame(index);
+			}
+			else if( events[n].events & (EPOLLERR|EPOLLHUP) )
+			{
+				// stop polling the device, since the errors are level-triggered (e.g. if it was unplugged)
+				LogError(LOG_V4L2 "v4l2CameraGroup -- lost %s, it will no longer be captured\n", group->mCameras[index]->camera->GetResource().location.c_str());
+				epoll_ctl(group->mEpoll, EPOLL_CTL_DEL, group->mCameras[index]->camera->GetFD(), NULL);
+			}
+		}
+	}
+
+	delete[] events;
+	return NULL;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __V4L2_CAMERA_GROUP_H__
+#define __V4L2_CAMERA_GROUP_H__
+
+#include "v4l2Camera.h"
+#include "Thread.h"
+#include "Event.h"
+
+#include <vector>
+#include <string>
+
+
+/**
+ * Captures from multiple V4L2 cameras with one thread, instead of a thread per camera.
+ *
+ * The file descriptors of all the devices are registered with epoll, and the capture thread
+ * sleeps in epoll_wait() until any of them have a frame ready.  That frame gets dequeued from
+ * the driver, converted on the GPU into the camera's ring buffer, and the buffer is returned to
+ * the driver right away - so the cameras keep streaming even if the application falls behind.
+ * Capture() then returns the latest converted frame of a camera, waiting for a new one if it
+ * has already been returned.
+ *
+ * @see v4l2Camera for the supported pixel formats (the cameras are opened in the same way).
+ * @ingroup camera
+ */
+class v4l2CameraGroup
+{
+public:
+	/**
+	 * Create a capture group from a list of V4L2 devices (e.g. `/dev/video0`).
+	 * The width, height, and number of buffers from videoOptions are applied to every camera.
+	 * @param format the format that the frames get converted to (e.g. `IMAGE_RGB8`)
+	 */
+	static v4l2CameraGroup* Create( const std::vector<std::string>& devices, const videoOptions& options=videoOptions(), imageFormat format=IMAGE_RGB8 );
+
+	/**
+	 * Destructor
+	 */
+	~v4l2CameraGroup();
+
+	/**
+	 * Start streaming from all of the cameras, and start the capture thread.
+	 */
+	bool Open();
+
+	/**
+	 * Stop the capture thread, and stop streaming from all of the cameras.
+	 */
+	void Close();
+
+	/**
+	 * Capture the latest frame from one of the cameras.
+	 * @see Capture()
+	 */
+	template<typename T> bool Capture( uint32_t camera, T** image, uint64_t timeout=videoSource::DEFAULT_TIMEOUT )	{ return Capture(camera, (void**)image, imageFormatFromType<T>(), timeout); }
+
+	/**
+	 * Capture the latest frame from one of the cameras.
+	 *
+	 * @param[in] camera index of the camera (in the order that the devices were passed to Create())
+	 * @param[out] image pointer that gets set to the camera's image
+	 * @param[in] format the format of the image, which should match GetFormat()
+	 * @param[in] timeout timeout in milliseconds to wait for a new frame
+	 *
+	 * @returns `true` if a frame was captured, `false` if there was an error or a timeout occurred.
+	 */
+	bool Capture( uint32_t camera, void** image, imageFormat format, uint64_t timeout=videoSource::DEFAULT_TIMEOUT );
+
+	/**
+	 * Return true if the cameras are streaming.
+	 */
+	inline bool IsStreaming() const					{ return mStreaming; }
+
+	/**
+	 * Get the number of cameras.
+	 */
+	inline uint32_t GetNumCameras() const				{ return mCameras.size(); }
+
+	/**
+	 * Get one of the cameras (to query its options, size, ect.)
+	 * Frames shouldn't be captured from it directly, only through v4l2CameraGroup::Capture().
+	 */
+	inline v4l2Camera* GetCamera( uint32_t camera ) const	{ return mCameras[camera]->camera; }
+
+	/**
+	 * Get the format that the frames get converted to.
+	 */
+	inline imageFormat GetFormat() const				{ return mFormat; }
+
+	/**
+	 * Get the number of frames that had to be dropped by a camera, because all
+	 * of its ring buffers were leased or the conversion failed.
+	 */
+	inline uint64_t GetDroppedFrames( uint32_t camera ) const	{ return mCameras[camera]->dropped; }
+
+protected:
+	v4l2CameraGroup( imageFormat format );
+
+	bool init( const std::vector<std::string>& devices, const videoOptions& options );
+	void captureFrame( uint32_t camera );
+
+	static void* captureThread( void* user );
+
+	struct cameraContext
+	{
+		v4l2Camera* camera;
+		RingBuffer  buffers;
+		Event       event;
+		uint64_t    dropped;
+	};
+
+	std::vector<cameraContext*> mCameras;
+
+	imageFormat mFormat;
+	bool        mStreaming;
+	int         mEpoll;
+
+	Thread        mThread;
+	volatile bool mThreadStop;
+};
+
+#endif
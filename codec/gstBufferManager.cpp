@@ -22,8 +22,12 @@
 
 #include "gstBufferManager.h"
 #include "cudaColorspace.h"
+#include "cudaMappedMemory.h"
+#include "cudaDevice.h"
 #include "timespec.h"
 #include "logging.h"
+#include "profiler.h"
+#include "cudaNVTX.h"
 
 
 #ifdef ENABLE_NVMM
@@ -37,36 +41,266 @@ gstBufferManager::gstBufferManager( videoOptions* options )
 {	
 	mOptions    = options;
 	mFormatYUV  = IMAGE_UNKNOWN;
+	mColorimetry = COLORIMETRY_DEFAULT;
 	mFrameCount = 0;
 	mLastTimestamp = 0;
+	mLastYUV       = NULL;
+	mFormatClock   = 0;
 	mNvmmUsed   = false;
+	mCaps       = NULL;
+	mCapsNVMM   = false;
+
+	memset(&mLastTimestamps, 0, sizeof(gstFrameTimestamp));
+
+	mStatsReceived    = 0;
+	mStatsCaptured    = 0;
+	mStatsDropped     = 0;
+	mStatsDequeuedAt  = 0;
+	mStatsMaxQueue    = 0;
+	mStatsArrival     = 0;
+	mStatsInterval    = 0;
+	mStatsMaxInterval = 0;
+	mStatsJitter      = 0;
+	mStatsConvert     = 0;
+	mStatsMaxConvert  = 0;
+	mStatsSkipped     = 0;
+
+	mCaptureLast     = 0;
+	mCaptureInterval = 0;
+	mCaptureWaiting  = false;
+	mAcceptedLast    = 0;
+
+	mAsyncFrames = NULL;
+	mAsyncCount  = 0;
+	mAsyncNext   = 0;
+	mAsyncLatest = -1;
+	mAsyncSize   = 0;
+	mAsyncFormat = IMAGE_UNKNOWN;
+	mAsyncAlloc  = IMAGE_UNKNOWN;
+	mAsyncMisses = 0;
+	mAsyncStream = NULL;
+	mCopyStream  = NULL;
+
+	mFrames         = NULL;
+	mFrameSlots     = 0;
+	mFrameNext      = 0;
+	mFramePublished = -1;
+	mFrameLatest    = -1;
+	mFrameLeased    = -1;
 	
 #ifdef ENABLE_NVMM
 	mNvmmFD        = -1;
-	mNvmmEGL       = NULL;
 	mNvmmCUDA      = NULL;
 	mNvmmSize      = 0;
 	mNvmmReleaseFD = false;
+	mNvmmDequeued  = 0;
+
+	memset(mNvmmCache, 0, sizeof(mNvmmCache));
+
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_NVMM_CACHE; n++ )
+		mNvmmCache[n].fd = -1;
+
+	mVicNext   = 0;
+	mVicRGBA   = NULL;
+	mVicFailed = false;
+
+	memset(mVicBuffers, 0, sizeof(mVicBuffers));
+
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_VIC_BUFFERS; n++ )
+		mVicBuffers[n].fd = -1;
 #endif
 	
-	mBufferRGB.SetThreaded(false);
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_FORMATS; n++ )
+	{
+		mFormatRings[n].format   = IMAGE_UNKNOWN;
+		mFormatRings[n].latest   = NULL;
+		mFormatRings[n].lastUsed = 0;
+		mFormatRings[n].buffers.SetThreaded(false);
+	}
 }
 
 
 // destructor
 gstBufferManager::~gstBufferManager()
 {
+	cudaDeviceScope device(mOptions->cudaDevice);
+
+	freeAsync();
+	freeFrames();
+
+	if( mAsyncStream != NULL )
+	{
+		CUDA(cudaStreamDestroy(mAsyncStream));
+		mAsyncStream = NULL;
+	}
+
+	if( mCopyStream != NULL )
+	{
+		CUDA(cudaStreamDestroy(mCopyStream));
+		mCopyStream = NULL;
+	}
+
+#ifdef ENABLE_NVMM
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_NVMM_CACHE; n++ )
+		unmapNvmm(&mNvmmCache[n]);
+
+	freeVic();
+
+	if( mNvmmReleaseFD && mNvmmFD >= 0 )
+		NvReleaseFd(mNvmmFD);
+#endif
+
+	if( mCaps != NULL )
+	{
+		gst_caps_unref(mCaps);
+		mCaps = NULL;
+	}
+}
+
+
+// parseCaps
+bool gstBufferManager::parseCaps( GstCaps* caps )
+{
+	// appsink hands out the same caps object until they get renegotiated
+	if( caps == mCaps )
+		return true;
+
+	if( mCaps != NULL && gst_caps_is_equal(caps, mCaps) )
+	{
+		gst_caps_replace(&mCaps, caps);
+		return true;
+	}
+
+	gchar* capsStr = gst_caps_to_string(caps);
+	LogVerbose(LOG_GSTREAMER "gstBufferManager recieve caps:  %s\n", capsStr);
+	g_free(capsStr);
+
+	// retrieve caps structure
+	GstStructure* gstCapsStruct = gst_caps_get_structure(caps, 0);
+	
+	if( !gstCapsStruct )
+	{
+		LogError(LOG_GSTREAMER "gstBufferManager -- gst_caps had NULL structure...\n");
+		return false;
+	}
+	
+	// retrieve the width and height of the buffer
+	int width  = 0;
+	int height = 0;
+	
+	if( !gst_structure_get_int(gstCapsStruct, "width", &width) ||
+		!gst_structure_get_int(gstCapsStruct, "height", &height) )
+	{
+		LogError(LOG_GSTREAMER "gstBufferManager -- gst_caps missing width/height...\n");
+		return false;
+	}
 	
+	if( width < 1 || height < 1 )
+		return false;
+
+	// verify format 
+	const imageFormat format = gst_parse_format(gstCapsStruct);
+		
+	if( format == IMAGE_UNKNOWN )
+	{
+		LogError(LOG_GSTREAMER "gstBufferManager -- stream %s does not have a compatible decoded format\n", mOptions->resource.c_str());
+		return false;
+	}
+
+	if( mCaps != NULL && (format != mFormatYUV || (uint32_t)width != mOptions->width || (uint32_t)height != mOptions->height) )
+	{
+		LogInfo(LOG_GSTREAMER "gstBufferManager -- stream %s changed from %ux%u %s to %ix%i %s\n", mOptions->resource.c_str(), 
+			   mOptions->width, mOptions->height, imageFormatToStr(mFormatYUV), width, height, imageFormatToStr(format));
+	}
+
+	// the ringbuffers get reallocated by their next Alloc() when the size of the frames changes
+	mOptions->width  = width;
+	mOptions->height = height;
+	mFormatYUV = format;
+
+	// 10/16-bit video (e.g. HDR HEVC) is converted with the colorimetry from the caps,
+	// while the 8-bit formats keep using the default colorimetry like before
+	if( mFormatYUV == IMAGE_P010 || mFormatYUV == IMAGE_P016 )
+		mColorimetry = gst_parse_colorimetry(gstCapsStruct, COLORIMETRY_BT2020_LIMITED);
+	else
+		mColorimetry = COLORIMETRY_DEFAULT;
+
+#ifdef ENABLE_NVMM
+	GstCapsFeatures* gstCapsFeatures = gst_caps_get_features(caps, 0);
+	mCapsNVMM = gst_caps_features_contains(gstCapsFeatures, GST_CAPS_FEATURE_MEMORY_NVMM);
+#endif
+
+	gst_caps_replace(&mCaps, caps);
+	return true;
 }
 
 
 // Enqueue
-bool gstBufferManager::Enqueue( GstBuffer* gstBuffer, GstCaps* gstCaps )
+bool gstBufferManager::Enqueue( GstBuffer* gstBuffer, GstCaps* gstCaps, uint64_t baseTime, const GstSegment* segment )
 {
 	if( !gstBuffer || !gstCaps )
 		return false;
 
-	uint64_t timestamp = apptime_nano();
+	// the appsink thread allocates and converts on the stream's device
+	cudaDeviceScope device(mOptions->cudaDevice);
+
+	const uint64_t arrival = apptime_nano();
+
+	// skip frames that arrive faster than the application captures them, before any work is done on them
+	if( mOptions->adaptiveRate && skipFrame(arrival) )
+	{
+		updateStats(arrival, true);
+		return true;
+	}
+
+	gstFrameTimestamp timestamp;
+
+	timestamp.timestamp = arrival;
+	timestamp.pts       = GST_BUFFER_PTS(gstBuffer);
+	timestamp.dts       = GST_BUFFER_DTS(gstBuffer);
+	timestamp.sensor    = 0;
+	timestamp.capture   = 0;
+
+	if (GST_BUFFER_DTS_IS_VALID(gstBuffer) || GST_BUFFER_PTS_IS_VALID(gstBuffer))
+	{
+		timestamp.timestamp = GST_BUFFER_DTS_OR_PTS(gstBuffer);
+	}
+
+#if GST_CHECK_VERSION(1,14,0)
+	// sources like the camera can attach the time that the sensor captured the frame
+	GstReferenceTimestampMeta* sensorMeta = gst_buffer_get_reference_timestamp_meta(gstBuffer, NULL);
+
+	if( sensorMeta != NULL )
+		timestamp.sensor = sensorMeta->timestamp;
+#endif
+
+	// map the PTS into CLOCK_MONOTONIC through the pipeline's running time
+	if( timestamp.sensor != 0 )
+		timestamp.capture = timestamp.sensor;
+	else if( baseTime != GST_CLOCK_TIME_NONE && GST_BUFFER_PTS_IS_VALID(gstBuffer) )
+	{
+		uint64_t runningTime = timestamp.pts;
+
+	#if GST_CHECK_VERSION(1,0,0)
+		if( segment != NULL && segment->format == GST_FORMAT_TIME )
+			runningTime = gst_segment_to_running_time(segment, GST_FORMAT_TIME, timestamp.pts);
+	#endif
+
+		if( runningTime != GST_CLOCK_TIME_NONE )
+			timestamp.capture = baseTime + runningTime;
+	}
+
+	// otherwise fall back to the time that the buffer arrived
+	if( timestamp.capture == 0 )
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		timestamp.capture = (uint64_t)now.tv_sec * uint64_t(1000000000) + (uint64_t)now.tv_nsec;
+	}
+
+	// the caps are only parsed again when they get renegotiated (e.g. a change in resolution)
+	if( !parseCaps(gstCaps) )
+		return false;
 
 #if GST_CHECK_VERSION(1,0,0)	
 	// map the buffer memory for read access
@@ -102,57 +336,37 @@ bool gstBufferManager::Enqueue( GstBuffer* gstBuffer, GstCaps* gstCaps )
 		return false;
 	}
 #endif
-	// on the first frame, print out the recieve caps
 	if( mFrameCount == 0 )
-		LogVerbose(LOG_GSTREAMER "gstBufferManager recieve caps:  %s\n", gst_caps_to_string(gstCaps));
-
-	// retrieve caps structure
-	GstStructure* gstCapsStruct = gst_caps_get_structure(gstCaps, 0);
-	
-	if( !gstCapsStruct )
-	{
-		LogError(LOG_GSTREAMER "gstBufferManager -- gst_caps had NULL structure...\n");
-		return false;
-	}
-	
-	// retrieve the width and height of the buffer
-	int width  = 0;
-	int height = 0;
-	
-	if( !gst_structure_get_int(gstCapsStruct, "width", &width) ||
-		!gst_structure_get_int(gstCapsStruct, "height", &height) )
 	{
-		LogError(LOG_GSTREAMER "gstBufferManager -- gst_caps missing width/height...\n");
-		return false;
+		LogVerbose(LOG_GSTREAMER "gstBufferManager -- recieved first frame, codec=%s format=%s width=%u height=%u size=%zu\n", videoOptions::CodecToStr(mOptions->codec), imageFormatToStr(mFormatYUV), mOptions->width, mOptions->height, gstSize);
 	}
-	
-	if( width < 1 || height < 1 )
+
+	//LogDebug(LOG_GSTREAMER "gstBufferManager -- recieved %ix%i frame (%zu bytes)\n", width, height, gstSize);
+
+	// pick the slot of the frame ring to write (skipping the frames that Dequeue() holds)
+	if( !allocFrames() )
 		return false;
-	
-	mOptions->width = width;
-	mOptions->height = height;
 
-	// verify format 
-	if( mFrameCount == 0 )
+	const int slot = writeFrame();
+
+	if( slot < 0 )
 	{
-		mFormatYUV = gst_parse_format(gstCapsStruct);
-		
-		if( mFormatYUV == IMAGE_UNKNOWN )
-		{
-			LogError(LOG_GSTREAMER "gstBufferManager -- stream %s does not have a compatible decoded format\n", mOptions->resource.c_str());
-			return false;
-		}
-		
-		LogVerbose(LOG_GSTREAMER "gstBufferManager -- recieved first frame, codec=%s format=%s width=%u height=%u size=%zu\n", videoOptions::CodecToStr(mOptions->codec), imageFormatToStr(mFormatYUV), mOptions->width, mOptions->height, gstSize);
+		LogError(LOG_GSTREAMER "gstBufferManager -- failed to retrieve the next frame slot for writing (all %u are in use)\n", mFrameSlots);
+		return false;
 	}
 
-	//LogDebug(LOG_GSTREAMER "gstBufferManager -- recieved %ix%i frame (%zu bytes)\n", width, height, gstSize);
+	FrameSlot* frame = &mFrames[slot];
+
+	// wait for the GPU to be done with the slot's previous frame
+	if( CUDA_FAILED(cudaEventSynchronize(frame->event)) )
+		return false;
+
+	frame->sequence  = mFrameCount;
+	frame->timestamp = timestamp;
 		
 #ifdef ENABLE_NVMM
 	// check for NVMM buffer	
-	GstCapsFeatures* gstCapsFeatures = gst_caps_get_features(gstCaps, 0);
-	
-	if( gst_caps_features_contains(gstCapsFeatures, GST_CAPS_FEATURE_MEMORY_NVMM))
+	if( mCapsNVMM )
 	{
 		mNvmmUsed = true;
 		int nvmmFD = -1;
@@ -182,14 +396,6 @@ bool gstBufferManager::Enqueue( GstBuffer* gstBuffer, GstCaps* gstCaps )
 			LogVerbose(LOG_GSTREAMER "gstBufferManager -- NVMM buffer plane %u:  %ux%u\n", n, nvmmParams.width[n], nvmmParams.height[n]);
 	#endif
 
-		EGLImageKHR eglImage = NvEGLImageFromFd(NULL, nvmmFD);
-		
-		if( !eglImage )
-		{
-			LogError(LOG_GSTREAMER "gstBufferManager -- failed to map EGLImage from NVMM buffer\n");
-			return false;
-		}
-		
 		// nvfilter memory comes from nvvidconv, which handles NvReleaseFd() internally
 		GstMemory* gstMemory = gst_buffer_peek_memory(gstBuffer, 0);
 		
@@ -204,16 +410,10 @@ bool gstBufferManager::Enqueue( GstBuffer* gstBuffer, GstCaps* gstCaps )
 		// update latest frame so capture thread can grab it
 		mNvmmMutex.Lock();
 		
-		if( mNvmmEGL != NULL )
-		{
-			NvDestroyEGLImage(NULL, mNvmmEGL);
-			
-			if( mNvmmReleaseFD )
-				NvReleaseFd(mNvmmFD);
-		}
+		if( mNvmmFD >= 0 && mNvmmReleaseFD )
+			NvReleaseFd(mNvmmFD);	// the previous frame was never dequeued
 		
 		mNvmmFD = nvmmFD;
-		mNvmmEGL = eglImage;
 		mNvmmReleaseFD = nvmmReleaseFD;
 		
 		mNvmmMutex.Unlock();
@@ -227,55 +427,45 @@ bool gstBufferManager::Enqueue( GstBuffer* gstBuffer, GstCaps* gstCaps )
 	// handle CPU path (non-NVMM)
 	if( !mNvmmUsed )
 	{
-		// allocate image ringbuffer
-		if( !mBufferYUV.Alloc(mOptions->numBuffers, gstSize, RingBuffer::ZeroCopy) )
+		// allocate the slot's image (in GPU memory with a pinned staging buffer if zeroCopy is disabled)
+		if( !allocImage(frame, gstSize) )
 		{
-			LogError(LOG_GSTREAMER "gstBufferManager -- failed to allocate %u image buffers (%zu bytes each)\n", mOptions->numBuffers, gstSize);
+			LogError(LOG_GSTREAMER "gstBufferManager -- failed to allocate image buffer (%zu bytes)\n", gstSize);
 			return false;
 		}
 
-		// copy to next image ringbuffer
-		void* nextBuffer = mBufferYUV.Peek(RingBuffer::Write);
-
-		if( !nextBuffer )
+		if( mOptions->zeroCopy )
 		{
-			LogError(LOG_GSTREAMER "gstBufferManager -- failed to retrieve next image ringbuffer for writing\n");
-			return false;
+			memcpy(frame->image, gstData, gstSize);
 		}
-
-		memcpy(nextBuffer, gstData, gstSize);
-		mBufferYUV.Next(RingBuffer::Write);
-	}
-
-		// handle timestamps in either case (CPU or NVMM path)
-		size_t timestamp_size = sizeof(uint64_t);
-
-		// allocate timestamp ringbuffer (GPU only if not ZeroCopy)
-		if( !mTimestamps.Alloc(mOptions->numBuffers, timestamp_size, RingBuffer::ZeroCopy) )
+		else
 		{
-			LogError(LOG_GSTREAMER "gstBufferManager -- failed to allocate %u timestamp buffers (%zu bytes each)\n", mOptions->numBuffers, timestamp_size);
-			return false;
-		}
+			// on discrete GPUs, upload the frame once instead of the kernels reading it over PCIe
+			// (Dequeue() and the asynchronous conversion wait on the slot's event for the upload)
+			if( !mCopyStream && CUDA_FAILED(cudaStreamCreateWithFlags(&mCopyStream, cudaStreamNonBlocking)) )
+				return false;
 
-		// copy to next timestamp ringbuffer
-		void* nextTimestamp = mTimestamps.Peek(RingBuffer::Write);
+			memcpy(frame->staging, gstData, gstSize);
 
-		if( !nextTimestamp )
-		{
-			LogError(LOG_GSTREAMER "gstBufferManager -- failed to retrieve next timestamp ringbuffer for writing\n");
-			return false;
+			if( CUDA_FAILED(cudaMemcpyAsync(frame->image, frame->staging, gstSize, cudaMemcpyHostToDevice, mCopyStream)) ||
+			    CUDA_FAILED(cudaEventRecord(frame->event, mCopyStream)) )
+				return false;
 		}
 
-		if (GST_BUFFER_DTS_IS_VALID(gstBuffer) || GST_BUFFER_PTS_IS_VALID(gstBuffer))
-		{
-			timestamp = GST_BUFFER_DTS_OR_PTS(gstBuffer);
-		}
+		// start converting the frame, before it gets published to Dequeue()
+		convertAsync(frame);
+	}
+	else
+	{
+		freeImage(frame);	// NVMM frames only use the slot for their metadata
+	}
 
-		memcpy(nextTimestamp, (void*)&timestamp, timestamp_size);
-		mTimestamps.Next(RingBuffer::Write);
+	publishFrame(slot);
 
 	mWaitEvent.Wake();
 	mFrameCount++;
+
+	updateStats(arrival);
 	
 #if GST_CHECK_VERSION(1,0,0)
 	gst_buffer_unmap(gstBuffer, &map);
@@ -285,154 +475,1115 @@ bool gstBufferManager::Enqueue( GstBuffer* gstBuffer, GstCaps* gstCaps )
 }
 
 
-// Dequeue
-bool gstBufferManager::Dequeue( void** output, imageFormat format, uint64_t timeout )
+#ifdef ENABLE_NVMM
+// mapNvmm
+bool gstBufferManager::mapNvmm( int fd, NvmmResource* resource )
 {
-	// wait until a new frame is recieved
-	if( !mWaitEvent.Wait(timeout) )
+	memset(resource, 0, sizeof(NvmmResource));
+	resource->fd = -1;
+	
+	EGLImageKHR eglImage = NvEGLImageFromFd(NULL, fd);
+	
+	if( !eglImage )
+	{
+		LogError(LOG_GSTREAMER "gstBufferManager -- failed to map EGLImage from NVMM buffer\n");
 		return false;
-
-	void* latestYUV = NULL;
+	}
 	
-#ifdef ENABLE_NVMM
-	if( mNvmmUsed )
+	// map EGLImage into CUDA array
+	cudaGraphicsResource* eglResource = NULL;
+	
+	if( CUDA_FAILED(cudaGraphicsEGLRegisterImage(&eglResource, eglImage, cudaGraphicsRegisterFlagsReadOnly)) )
 	{
-		mNvmmMutex.Lock();
-		
-		const int nvmmFD = mNvmmFD;
-		const bool nvmmReleaseFD = mNvmmReleaseFD;
-		EGLImageKHR eglImage = (EGLImageKHR)mNvmmEGL;
-		
-		mNvmmFD = -1;
-		mNvmmEGL = NULL;
-		mNvmmReleaseFD = false;
-		
-		mNvmmMutex.Unlock();
-		
-		if( !eglImage )
-			return NULL;
-		
-		// map EGLImage into CUDA array
-		cudaGraphicsResource* eglResource = NULL;
-		cudaEglFrame eglFrame;
-		
-		if( CUDA_FAILED(cudaGraphicsEGLRegisterImage(&eglResource, eglImage, cudaGraphicsRegisterFlagsReadOnly)) )
-			return false;
+		NvDestroyEGLImage(NULL, eglImage);
+		return false;
+	}
+	
+	resource->fd       = fd;
+	resource->egl      = eglImage;
+	resource->resource = eglResource;
+	resource->width    = mOptions->width;
+	resource->height   = mOptions->height;
+	resource->lastUsed = mNvmmDequeued;
+	
+	// bind the NV12 planes to texture objects, so that the colorspace
+	// conversion can read them without copying to linear memory first
+	cudaEglFrame eglFrame;
+	
+	if( CUDA_FAILED(cudaGraphicsResourceGetMappedEglFrame(&eglFrame, eglResource, 0, 0)) )
+		return true;	// the copy path in Dequeue() gets used instead
+	
+	if( eglFrame.planeCount != 2 || eglFrame.planeDesc[0].numChannels != 1 || eglFrame.planeDesc[1].numChannels != 2 )
+		return true;
+	
+	cudaTextureObject_t textures[2] = {0, 0};
+	
+	for( uint32_t n=0; n < 2; n++ )
+	{
+		cudaResourceDesc resDesc;
+		memset(&resDesc, 0, sizeof(cudaResourceDesc));
 		
-		if( CUDA_FAILED(cudaGraphicsResourceGetMappedEglFrame(&eglFrame, eglResource, 0, 0)) )
-			return false;
-
-		if( eglFrame.planeCount != 2 )
-			LogWarning(LOG_GSTREAMER "gstBufferManager -- unexpected number of planes in NVMM buffer (%u vs 2 expected)\n", eglFrame.planeCount);
-
-		if( eglFrame.planeDesc[0].width != mOptions->width || eglFrame.planeDesc[0].height != mOptions->height )
+		if( eglFrame.frameType == cudaEglFrameTypeArray )
 		{
-			LogError(LOG_GSTREAMER "gstBufferManager -- NVMM EGLImage dimensions mismatch (%ux%u when expected %ux%u)", eglFrame.planeDesc[0].width, eglFrame.planeDesc[0].height, mOptions->width, mOptions->height);
-			return false;
+			resDesc.resType = cudaResourceTypeArray;
+			resDesc.res.array.array = eglFrame.frame.pArray[n];
 		}
-		
-		if( eglFrame.frameType != cudaEglFrameTypeArray )  // cudaEglFrameTypePitch
+		else
 		{
-			LogError(LOG_GSTREAMER "gstBufferManager -- NVMM had unexpected frame type (was pitched pointer, expected CUDA array)\n");
-			return false;
+			resDesc.resType = cudaResourceTypePitch2D;
+			resDesc.res.pitch2D.devPtr = eglFrame.frame.pPitch[n].ptr;
+			resDesc.res.pitch2D.desc = (n == 0) ? cudaCreateChannelDesc<uchar1>() : cudaCreateChannelDesc<uchar2>();
+			resDesc.res.pitch2D.width = eglFrame.planeDesc[n].width;
+			resDesc.res.pitch2D.height = eglFrame.planeDesc[n].height;
+			resDesc.res.pitch2D.pitchInBytes = eglFrame.frame.pPitch[n].pitch;
 		}
 		
-		// NV12 buffers have multiple planes (Y @ full res and UV @ half res)
-		const size_t maxPlanes = 16;
-		size_t planePitch[maxPlanes];
-		size_t planeSize[maxPlanes];
-		size_t sizeYUV = 0;
+		cudaTextureDesc texDesc;
+		memset(&texDesc, 0, sizeof(cudaTextureDesc));
+		
+		texDesc.addressMode[0] = cudaAddressModeClamp;
+		texDesc.addressMode[1] = cudaAddressModeClamp;
+
+		// the chroma gets filtered so cudaNV12ToRGB() can interpolate it vertically
+		texDesc.filterMode = (n == 0) ? cudaFilterModePoint : cudaFilterModeLinear;
+		texDesc.readMode = (n == 0) ? cudaReadModeElementType : cudaReadModeNormalizedFloat;
 		
-		for( uint32_t n=0; n < eglFrame.planeCount && n < maxPlanes; n++ )
+		if( CUDA_FAILED(cudaCreateTextureObject(&textures[n], &resDesc, &texDesc, NULL)) )
 		{
-			cudaChannelFormatDesc arrayDesc;
-			cudaExtent arrayExtent;
-			
-			CUDA(cudaArrayGetInfo(&arrayDesc, &arrayExtent, NULL, eglFrame.frame.pArray[n]));
+			if( textures[0] != 0 )
+				CUDA(cudaDestroyTextureObject(textures[0]));
 			
-			const size_t bpp = arrayDesc.x + arrayDesc.y + arrayDesc.z;
-			
-			planePitch[n] = (bpp * arrayExtent.width) / 8;
-			planeSize[n] = planePitch[n] * arrayExtent.height;
-			
-			sizeYUV += planeSize[n];
-			
-		#ifdef DEBUG
-			LogDebug(LOG_GSTREAMER "gstBufferManager -- plane=%u x=%i y=%i z=%i  w=%zu h=%zu d=%zu  pitch=%zu size=%zu\n", n, arrayDesc.x, arrayDesc.y, arrayDesc.z, arrayExtent.width, arrayExtent.height, arrayExtent.depth, planePitch[n], planeSize[n]);
-		#endif
+			return true;
 		}
+	}
+	
+	resource->lumaTex   = textures[0];
+	resource->chromaTex = textures[1];
+	
+	return true;
+}
 
-		// allocate CUDA memory for the image
-		if( !mNvmmCUDA || mNvmmSize != sizeYUV )
+
+// unmapNvmm
+void gstBufferManager::unmapNvmm( NvmmResource* resource )
+{
+	if( resource->lumaTex != 0 )
+		CUDA(cudaDestroyTextureObject(resource->lumaTex));
+	
+	if( resource->chromaTex != 0 )
+		CUDA(cudaDestroyTextureObject(resource->chromaTex));
+	
+	if( resource->resource != NULL )
+		CUDA(cudaGraphicsUnregisterResource((cudaGraphicsResource*)resource->resource));
+	
+	if( resource->egl != NULL )
+		NvDestroyEGLImage(NULL, (EGLImageKHR)resource->egl);
+	
+	memset(resource, 0, sizeof(NvmmResource));
+	resource->fd = -1;
+}
+
+
+// lookupNvmm
+gstBufferManager::NvmmResource* gstBufferManager::lookupNvmm( int fd )
+{
+	mNvmmDequeued++;
+	
+	NvmmResource* lru = &mNvmmCache[0];
+	
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_NVMM_CACHE; n++ )
+	{
+		NvmmResource* entry = &mNvmmCache[n];
+		
+		if( entry->fd == fd )
 		{
-			CUDA_FREE(mNvmmCUDA);
+			// the upstream pool gets re-created when the resolution changes
+			if( entry->width != mOptions->width || entry->height != mOptions->height )
+			{
+				unmapNvmm(entry);
+				lru = entry;
+				break;
+			}
 			
-			if( CUDA_FAILED(cudaMalloc(&mNvmmCUDA, sizeYUV)) )
-				return false;
+			entry->lastUsed = mNvmmDequeued;
+			return entry;
 		}
 		
-		// copy arrays into linear memory (so our CUDA kernels can use it)
-		size_t planeOffset = 0;
-		
-		for( uint32_t n=0; n < eglFrame.planeCount && n < maxPlanes; n++ )
+		if( entry->fd < 0 )
 		{
-			if( CUDA_FAILED(cudaMemcpy2DFromArrayAsync(((uint8_t*)mNvmmCUDA) + planeOffset, planePitch[n], eglFrame.frame.pArray[n], 0, 0, planePitch[n], eglFrame.planeDesc[n].height, cudaMemcpyDeviceToDevice)) )
-				return false;
-		
-			planeOffset += planeSize[n];
+			if( lru->fd >= 0 )
+				lru = entry;	// prefer empty slots
+		}
+		else if( lru->fd >= 0 && entry->lastUsed < lru->lastUsed )
+		{
+			lru = entry;
 		}
-
-		latestYUV = mNvmmCUDA;
-		
-		CUDA(cudaGraphicsUnregisterResource(eglResource));
-		NvDestroyEGLImage(NULL, eglImage);
-		
-		if( nvmmReleaseFD )
-			NvReleaseFd(nvmmFD);
 	}
-#endif
+	
+	// evict the least-recently used entry and map the new buffer
+	if( lru->fd >= 0 )
+	{
+		LogDebug(LOG_GSTREAMER "gstBufferManager -- evicting NVMM buffer fd=%i from cache\n", lru->fd);
+		unmapNvmm(lru);
+	}
+	
+	if( !mapNvmm(fd, lru) )
+		return NULL;
+	
+	return lru;
+}
 
-	// handle the CPU path (non-NVMM)
-	if( !mNvmmUsed )
-		latestYUV = mBufferYUV.Next(RingBuffer::ReadLatestOnce);
 
-	if( !latestYUV )
+// allocVic
+bool gstBufferManager::allocVic()
+{
+	if( mVicBuffers[0].fd >= 0 && mVicBuffers[0].width == mOptions->width && mVicBuffers[0].height == mOptions->height )
+		return true;
+
+	freeVic();
+
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_VIC_BUFFERS; n++ )
+	{
+		NvBufferCreateParams params;
+		memset(&params, 0, sizeof(NvBufferCreateParams));
+
+		params.width       = mOptions->width;
+		params.height      = mOptions->height;
+		params.layout      = NvBufferLayout_Pitch;
+		params.colorFormat = NvBufferColorFormat_ABGR32;	// RGBA in memory
+		params.payloadType = NvBufferPayload_SurfArray;
+		params.nvbuf_tag   = NvBufferTag_VIDEO_CONVERT;
+
+		int fd = -1;
+
+		if( NvBufferCreateEx(&fd, &params) != 0 )
+		{
+			LogError(LOG_GSTREAMER "gstBufferManager -- failed to create %ux%u RGBA NVMM buffer for the VIC\n", mOptions->width, mOptions->height);
+			return false;
+		}
+
+		if( !mapNvmm(fd, &mVicBuffers[n]) )
+		{
+			NvBufferDestroy(fd);
+			return false;
+		}
+	}
+
+	LogVerbose(LOG_GSTREAMER "gstBufferManager -- allocated %u RGBA buffers for the VIC (%ux%u)\n", GST_BUFFER_MANAGER_VIC_BUFFERS, mOptions->width, mOptions->height);
+	return true;
+}
+
+
+// freeVic
+void gstBufferManager::freeVic()
+{
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_VIC_BUFFERS; n++ )
+	{
+		const int fd = mVicBuffers[n].fd;
+
+		unmapNvmm(&mVicBuffers[n]);
+
+		if( fd >= 0 )
+			NvBufferDestroy(fd);
+	}
+
+	CUDA_FREE(mVicRGBA);
+	mVicNext = 0;
+}
+
+
+// transformNvmm (returns the converted image, or NULL if the VIC failed)
+void* gstBufferManager::transformNvmm( int fd, imageFormat format )
+{
+	if( !allocVic() )
+	{
+		LogWarning(LOG_GSTREAMER "gstBufferManager -- failed to allocate buffers for the VIC, falling back to CUDA\n");
+		freeVic();
+		mVicFailed = true;
+		return NULL;
+	}
+
+	// convert (and scale if needed) the NVMM frame to RGBA on the VIC
+	NvmmResource* vic = &mVicBuffers[mVicNext];
+	mVicNext = (mVicNext + 1) % GST_BUFFER_MANAGER_VIC_BUFFERS;
+
+	NvBufferTransformParams params;
+	memset(&params, 0, sizeof(NvBufferTransformParams));
+
+	params.transform_flag   = NVBUFFER_TRANSFORM_FILTER;
+	params.transform_filter = NvBufferTransform_Filter_Smart;
+
+	if( NvBufferTransform(fd, vic->fd, &params) != 0 )
+	{
+		LogWarning(LOG_GSTREAMER "gstBufferManager -- NvBufferTransform() failed, falling back to CUDA\n");
+		mVicFailed = true;
+		return NULL;
+	}
+
+	cudaEglFrame eglFrame;
+
+	if( CUDA_FAILED(cudaGraphicsResourceGetMappedEglFrame(&eglFrame, (cudaGraphicsResource*)vic->resource, 0, 0)) || eglFrame.frameType != cudaEglFrameTypePitch )
+	{
+		LogWarning(LOG_GSTREAMER "gstBufferManager -- failed to map the VIC output into CUDA, falling back to CUDA\n");
+		mVicFailed = true;
+		return NULL;
+	}
+
+	// allocate ringbuffer for the output
+	const size_t rgbBufferSize = imageFormatSize(format, mOptions->width, mOptions->height);
+	FormatRing* ring = getFormat(format);
+
+	if( !ring->buffers.Alloc(mOptions->numBuffers, rgbBufferSize, mOptions->zeroCopy ? RingBuffer::ZeroCopy : 0) )
+	{
+		LogError(LOG_GSTREAMER "gstBufferManager -- failed to allocate %u buffers (%zu bytes each)\n", mOptions->numBuffers, rgbBufferSize);
+		return NULL;
+	}
+
+	void* nextRGB = ring->buffers.Next(RingBuffer::Write);
+
+	// the VIC buffer is pitched, so copy it out before it gets reused for a later frame
+	// (other formats than RGBA get converted from it, which is much cheaper than from YUV)
+	const size_t rowSize = mOptions->width * sizeof(uchar4);
+
+	if( format != IMAGE_RGBA8 && !mVicRGBA && CUDA_FAILED(cudaMalloc(&mVicRGBA, rowSize * mOptions->height)) )
+		return NULL;
+
+	void* rgba = (format == IMAGE_RGBA8) ? nextRGB : mVicRGBA;
+
+	if( CUDA_FAILED(cudaMemcpy2D(rgba, rowSize, eglFrame.frame.pPitch[0].ptr, eglFrame.frame.pPitch[0].pitch, rowSize, mOptions->height, cudaMemcpyDeviceToDevice)) )
+		return NULL;
+
+	if( format != IMAGE_RGBA8 && CUDA_FAILED(cudaConvertColor(rgba, IMAGE_RGBA8, nextRGB, format, mOptions->width, mOptions->height)) )
+	{
+		LogError(LOG_GSTREAMER "gstBufferManager -- unsupported image format (%s)\n", imageFormatToStr(format));
+		return NULL;
+	}
+
+	return nextRGB;
+}
+#endif
+
+
+// statsAverage (moving average of the last ~16 samples)
+static inline uint64_t statsAverage( uint64_t average, uint64_t sample )
+{
+	if( average == 0 )
+		return sample;
+
+	return average - average / 16 + sample / 16;
+}
+
+
+// skipFrame (called from Enqueue() when videoOptions::adaptiveRate is enabled)
+bool gstBufferManager::skipFrame( uint64_t arrival )
+{
+	const uint64_t captureInterval = mCaptureInterval;
+
+	// the first frames, and the ones the application is waiting for, are always kept
+	if( mFrameCount == 0 || captureInterval == 0 || mCaptureWaiting )
+	{
+		mAcceptedLast = arrival;
 		return false;
+	}
 
-	// handle timestamp (both paths)
-	void* pLastTimestamp = NULL;
-	pLastTimestamp = mTimestamps.Next(RingBuffer::ReadLatestOnce);
+	// keep the frame that arrives closest to when the application is expected to capture next,
+	// so the frames are decimated down to the application's rate (with half a frame of slack)
+	const uint64_t streamInterval = mStatsInterval;
+	const uint64_t elapsed = arrival - mAcceptedLast;
 
-	if( !pLastTimestamp )
+	if( elapsed + streamInterval / 2 >= captureInterval )
 	{
-		LogWarning(LOG_GSTREAMER "gstBufferManager -- failed to retrieve timestamp buffer (default to 0)\n");
-		mLastTimestamp = 0;
+		mAcceptedLast = arrival;
+		return false;
+	}
+
+	return true;
+}
+
+
+// updateStats
+void gstBufferManager::updateStats( uint64_t arrival, bool skipped )
+{
+	if( skipped )
+	{
+		mStatsSkipped++;
+	}
+	else
+	{
+		const uint64_t received = ++mStatsReceived;
+		const uint64_t queued   = received - mStatsDequeuedAt;
+
+		if( queued > mStatsMaxQueue )
+			mStatsMaxQueue = queued;
+	}
+
+	const uint64_t lastArrival = mStatsArrival.exchange(arrival);
+
+	if( lastArrival == 0 || arrival < lastArrival )
+		return;
+
+	const uint64_t interval = arrival - lastArrival;
+	const uint64_t average  = mStatsInterval;
+
+	if( interval > mStatsMaxInterval )
+		mStatsMaxInterval = interval;
+
+	// the jitter is the average deviation of the intervals from their average
+	if( average > 0 )
+		mStatsJitter = statsAverage(mStatsJitter, (interval > average) ? (interval - average) : (average - interval));
+
+	mStatsInterval = statsAverage(average, interval);
+}
+
+
+// GetStats
+void gstBufferManager::GetStats( videoSourceStats* stats ) const
+{
+	if( !stats )
+		return;
+
+	const uint64_t received = mStatsReceived;
+	const uint64_t interval = mStatsInterval;
+
+	stats->framesReceived = received + mStatsSkipped;
+	stats->framesCaptured = mStatsCaptured;
+	stats->framesDropped  = mStatsDropped;
+	stats->framesSkipped  = mStatsSkipped;
+	stats->queueDepth     = received - mStatsDequeuedAt;
+	stats->maxQueueDepth  = mStatsMaxQueue;
+	stats->frameRate      = (interval > 0) ? 1000000000.0f / interval : 0.0f;
+	stats->interval       = interval * 0.000001f;
+	stats->maxInterval    = mStatsMaxInterval * 0.000001f;
+	stats->jitter         = mStatsJitter * 0.000001f;
+	stats->convertTime    = mStatsConvert * 0.000001f;
+	stats->maxConvertTime = mStatsMaxConvert * 0.000001f;
+	stats->captureInterval = mCaptureInterval * 0.000001f;
+}
+
+
+// Flush
+void gstBufferManager::Flush()
+{
+	mWaitEvent.Reset();
+
+#ifdef ENABLE_NVMM
+	mNvmmMutex.Lock();
+
+	if( mNvmmFD >= 0 && mNvmmReleaseFD )
+		NvReleaseFd(mNvmmFD);
+
+	mNvmmFD = -1;
+	mNvmmReleaseFD = false;
+
+	mNvmmMutex.Unlock();
+#endif
+
+	mAsyncMutex.Lock();
+	mAsyncLatest = -1;
+	mAsyncMutex.Unlock();
+
+	// frames that were flushed don't count as dropped
+	mStatsDequeuedAt = mStatsReceived.load();
+
+	// mark the latest frame as read
+	mFrameLatest = -1;
+}
+
+
+// allocFrames (the images of the slots are allocated when Enqueue() writes to them)
+bool gstBufferManager::allocFrames()
+{
+	if( mFrames != NULL )
+		return true;
+
+	// Dequeue() holds the latest dequeued frame and Enqueue() skips the one waiting
+	// to be dequeued, so it takes at least 3 slots to always have one to write into
+	mFrameSlots = (mOptions->numBuffers > 3) ? mOptions->numBuffers : 3;
+	mFrames     = new FrameSlot[mFrameSlots];
+
+	for( uint32_t n=0; n < mFrameSlots; n++ )
+	{
+		FrameSlot& frame = mFrames[n];
+
+		frame.image    = NULL;
+		frame.staging  = NULL;
+		frame.size     = 0;
+		frame.sequence = 0;
+		frame.event    = NULL;
+		frame.leases   = 0;
+
+		memset(&frame.timestamp, 0, sizeof(gstFrameTimestamp));
+	}
+
+	for( uint32_t n=0; n < mFrameSlots; n++ )
+	{
+		if( CUDA_FAILED(cudaEventCreateWithFlags(&mFrames[n].event, cudaEventDisableTiming)) )
+		{
+			freeFrames();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// freeFrames
+void gstBufferManager::freeFrames()
+{
+	if( !mFrames )
+		return;
+
+	for( uint32_t n=0; n < mFrameSlots; n++ )
+	{
+		if( mFrames[n].event != NULL )
+		{
+			CUDA(cudaEventSynchronize(mFrames[n].event));
+			CUDA(cudaEventDestroy(mFrames[n].event));
+		}
+
+		freeImage(&mFrames[n]);
+	}
+
+	delete[] mFrames;
+
+	mFrames         = NULL;
+	mFrameSlots     = 0;
+	mFrameNext      = 0;
+	mFramePublished = -1;
+	mFrameLatest    = -1;
+	mFrameLeased    = -1;
+}
+
+
+// allocImage (only called on slots that Enqueue() is writing, so the image isn't in use)
+bool gstBufferManager::allocImage( FrameSlot* frame, size_t size )
+{
+	const bool staged = !mOptions->zeroCopy;
+
+	if( frame->image != NULL && frame->size == size && (frame->staging != NULL) == staged )
+		return true;
+
+	freeImage(frame);
+
+	if( staged )
+	{
+		if( !cudaMemoryFits(size * 2) )
+		{
+			cudaMemoryReport();
+			return false;
+		}
+
+		if( CUDA_FAILED(cudaMalloc(&frame->image, size)) )
+			return false;
+
+		cudaMemoryTrack(frame->image, size, CUDA_MEMORY_RINGBUFFER);
+
+		if( CUDA_FAILED(cudaHostAlloc(&frame->staging, size, cudaHostAllocDefault)) )
+		{
+			freeImage(frame);
+			return false;
+		}
+
+		cudaMemoryTrack(frame->staging, size, CUDA_MEMORY_RINGBUFFER);
+	}
+	else if( !cudaAllocMapped(&frame->image, size, CUDA_MEMORY_RINGBUFFER) )
+	{
+		return false;
+	}
+
+	frame->size = size;
+	return true;
+}
+
+
+// freeImage
+void gstBufferManager::freeImage( FrameSlot* frame )
+{
+	if( frame->staging != NULL )
+	{
+		cudaMemoryUntrack(frame->image);
+		CUDA(cudaFree(frame->image));
+		cudaFreeMapped(frame->staging);
 	}
 	else
 	{
-		mLastTimestamp = *((uint64_t*)pLastTimestamp);
+		cudaFreeMapped(frame->image);
 	}
 
-	// output raw image if conversion format is unknown
-	if ( format == IMAGE_UNKNOWN )
+	frame->image   = NULL;
+	frame->staging = NULL;
+	frame->size    = 0;
+}
+
+
+// writeFrame (returns the next slot that isn't leased or waiting to be dequeued, or -1)
+int gstBufferManager::writeFrame()
+{
+	for( uint32_t n=0; n < mFrameSlots; n++ )
+	{
+		const uint32_t slot = (mFrameNext + n) % mFrameSlots;
+
+		if( (int)slot == mFramePublished || mFrames[slot].leases > 0 )
+			continue;
+
+		mFrameNext = (slot + 1) % mFrameSlots;
+		return slot;
+	}
+
+	return -1;
+}
+
+
+// publishFrame (makes the slot the latest frame for Dequeue())
+void gstBufferManager::publishFrame( int slot )
+{
+	mFramePublished = slot;
+	mFrameLatest = slot;
+}
+
+
+// acquireFrame (leases the latest frame and marks it as read, or returns -1 if there isn't a new one)
+int gstBufferManager::acquireFrame()
+{
+	while( true )
+	{
+		const int slot = mFrameLatest;
+
+		if( slot < 0 )
+			return -1;
+
+		// the lease is taken before the slot is claimed, so that Enqueue() can't pick
+		// it in between (it only picks slots older than the one it published last)
+		mFrames[slot].leases++;
+
+		int expected = slot;
+
+		if( mFrameLatest.compare_exchange_strong(expected, -1) )
+			return slot;
+
+		mFrames[slot].leases--;	// a newer frame was published meanwhile
+	}
+}
+
+
+// releaseFrame
+void gstBufferManager::releaseFrame( int slot )
+{
+	if( slot >= 0 && mFrames != NULL )
+		mFrames[slot].leases--;
+}
+
+
+// allocAsync
+bool gstBufferManager::allocAsync( imageFormat format )
+{
+	const size_t size = imageFormatSize(format, mOptions->width, mOptions->height);
+
+	if( mAsyncFrames != NULL && mAsyncCount == mOptions->numBuffers && mAsyncSize == size )
+		return true;
+
+	freeAsync();
+
+	if( !mAsyncStream )
+	{
+		if( CUDA_FAILED(cudaStreamCreateWithFlags(&mAsyncStream, cudaStreamNonBlocking)) )
+			return false;
+
+		NVTX_NAME_STREAM(mAsyncStream, mOptions->resource.string.c_str());
+	}
+
+	mAsyncFrames = new AsyncFrame[mOptions->numBuffers];
+	mAsyncCount  = mOptions->numBuffers;
+	mAsyncSize   = size;
+
+	memset(mAsyncFrames, 0, sizeof(AsyncFrame) * mAsyncCount);
+
+	for( uint32_t n=0; n < mAsyncCount; n++ )
+	{
+		if( mOptions->zeroCopy )
+		{
+			if( !cudaAllocMapped(&mAsyncFrames[n].image, size) )
+				return false;
+		}
+		else if( CUDA_FAILED(cudaMalloc(&mAsyncFrames[n].image, size)) )
+			return false;
+
+		if( CUDA_FAILED(cudaEventCreateWithFlags(&mAsyncFrames[n].event, cudaEventDisableTiming)) )
+			return false;
+	}
+
+	LogVerbose(LOG_GSTREAMER "gstBufferManager -- allocated %u buffers for asynchronous conversion to %s (%zu bytes each)\n", mAsyncCount, imageFormatToStr(format), size);
+	return true;
+}
+
+
+// freeAsync
+void gstBufferManager::freeAsync()
+{
+	if( !mAsyncFrames )
+		return;
+
+	if( mAsyncStream != NULL )
+		CUDA(cudaStreamSynchronize(mAsyncStream));
+
+	for( uint32_t n=0; n < mAsyncCount; n++ )
+	{
+		if( mOptions->zeroCopy )
+			CUDA_FREE_HOST(mAsyncFrames[n].image);
+		else
+			CUDA_FREE(mAsyncFrames[n].image);
+
+		if( mAsyncFrames[n].event != NULL )
+			CUDA(cudaEventDestroy(mAsyncFrames[n].event));
+	}
+
+	delete[] mAsyncFrames;
+
+	mAsyncFrames = NULL;
+	mAsyncCount  = 0;
+	mAsyncSize   = 0;
+	mAsyncNext   = 0;
+}
+
+
+// convertAsync (called from Enqueue() on the appsink thread)
+bool gstBufferManager::convertAsync( FrameSlot* slot )
+{
+	mAsyncMutex.Lock();
+	const imageFormat format = mAsyncFormat;
+	mAsyncMutex.Unlock();
+
+	// disabled until Dequeue() requests an RGB format
+	if( format == IMAGE_UNKNOWN )
+		return true;
+
+	// re-allocating frees the images, so Dequeue() can't be handed one of them meanwhile
+	if( format != mAsyncAlloc || mAsyncSize != imageFormatSize(format, mOptions->width, mOptions->height) )
+	{
+		mAsyncMutex.Lock();
+		mAsyncLatest = -1;
+		mAsyncMutex.Unlock();
+
+		freeAsync();
+		mAsyncAlloc = IMAGE_UNKNOWN;
+
+		if( !allocAsync(format) )
+		{
+			LogError(LOG_GSTREAMER "gstBufferManager -- failed to allocate buffers for asynchronous conversion\n");
+			freeAsync();
+			return false;
+		}
+
+		mAsyncAlloc = format;
+	}
+
+	const uint32_t index = mAsyncNext;
+	AsyncFrame& frame = mAsyncFrames[index];
+
+	// wait for the upload (this doesn't block the CPU)
+	if( CUDA_FAILED(cudaStreamWaitEvent(mAsyncStream, slot->event, 0)) )
+		return false;
+
+	if( CUDA_FAILED(cudaConvertColor(slot->image, mFormatYUV, frame.image, format, mOptions->width, mOptions->height, make_float2(0,255), mAsyncStream, mColorimetry)) )
+		return false;
+
+	if( CUDA_FAILED(cudaEventRecord(frame.event, mAsyncStream)) )
+		return false;
+
+	// the slot doesn't get written again until the conversion is done reading it
+	if( CUDA_FAILED(cudaEventRecord(slot->event, mAsyncStream)) )
+		return false;
+
+	frame.sequence = slot->sequence;
+
+	mAsyncNext = (mAsyncNext + 1) % mAsyncCount;
+
+	mAsyncMutex.Lock();
+	mAsyncLatest = index;
+	mAsyncMutex.Unlock();
+
+	return true;
+}
+
+
+// dequeueAsync (returns false if the frame needs to be converted by Dequeue() instead)
+bool gstBufferManager::dequeueAsync( void** output, imageFormat format, FrameSlot* slot )
+{
+	mAsyncMutex.Lock();
+
+	// have the following frames converted into this format as soon as they arrive
+	// (consumers alternating between formats keep the first one, and the others
+	// get converted by Dequeue() into their own rings instead of re-allocating)
+	const bool formatChanged = (format != mAsyncFormat);
+
+	if( !formatChanged )
+		mAsyncMisses = 0;
+	else if( mAsyncFormat == IMAGE_UNKNOWN || ++mAsyncMisses >= 2 )
+	{
+		mAsyncFormat = (format != mFormatYUV) ? format : IMAGE_UNKNOWN;
+		mAsyncMisses = 0;
+	}
+
+	const int index = formatChanged ? -1 : mAsyncLatest;
+
+	// keep a conversion that already started on a newer frame than the one being dequeued
+	if( index < 0 || mAsyncFrames[index].sequence <= slot->sequence )
+		mAsyncLatest = -1;
+
+	mAsyncMutex.Unlock();
+
+	if( index < 0 || mAsyncFrames[index].sequence != slot->sequence )
+		return false;
+
+	const AsyncFrame& frame = mAsyncFrames[index];
+
+	// wait only for this frame's conversion to finish
+	if( CUDA_FAILED(cudaEventSynchronize(frame.event)) )
+		return false;
+
+	mLastYUV = slot->image;
+
+	resetFormats();
+	getFormat(format)->latest = frame.image;
+
+	*output = frame.image;
+	return true;
+}
+
+
+// Dequeue
+bool gstBufferManager::Dequeue( void** output, imageFormat format, uint64_t timeout )
+{
+	// measure how often the application captures frames (for videoOptions::adaptiveRate)
+	const uint64_t called = apptime_nano();
+	const uint64_t lastCalled = mCaptureLast.exchange(called);
+
+	if( lastCalled != 0 && called > lastCalled )
+		mCaptureInterval = statsAverage(mCaptureInterval, called - lastCalled);
+
+	// wait until a new frame is recieved
+	mCaptureWaiting = true;
+	const bool received = mWaitEvent.Wait(timeout);
+	mCaptureWaiting = false;
+
+	if( !received )
+		return false;
+
+	NVTX_RANGE_FMT("gstBufferManager::Dequeue (%s)", mOptions->resource.string.c_str());
+	PROFILER_SCOPE_CUDA("gstBufferManager::Dequeue", NULL);
+
+	cudaDeviceScope device(mOptions->cudaDevice);
+
+	const uint64_t start = apptime_nano();
+
+	if( !dequeueFrame(output, format) )
+		return false;
+
+	// the frames that arrived since the last one was dequeued were skipped over
+	const uint64_t received = mStatsReceived;
+	const uint64_t pending  = received - mStatsDequeuedAt.exchange(received);
+
+	if( pending > 1 )
+		mStatsDropped += pending - 1;
+
+	mStatsCaptured++;
+
+	// the time it took to map and convert the frame (or wait for its conversion)
+	const uint64_t convertTime = apptime_nano() - start;
+
+	mStatsConvert = statsAverage(mStatsConvert, convertTime);
+
+	if( convertTime > mStatsMaxConvert )
+		mStatsMaxConvert = convertTime;
+
+	return true;
+}
+
+
+// dequeueFrame
+bool gstBufferManager::dequeueFrame( void** output, imageFormat format )
+{
+	// lease the latest frame, and return the lease on the previous one
+	const int slot = acquireFrame();
+
+	if( slot < 0 && !mNvmmUsed )
+		return false;
+
+	FrameSlot* frame = NULL;
+
+	if( slot >= 0 )
+	{
+		releaseFrame(mFrameLeased);
+		mFrameLeased = slot;
+
+		frame = &mFrames[slot];
+
+		mLastTimestamps = frame->timestamp;
+		mLastTimestamp  = frame->timestamp.timestamp;
+	}
+	else
+	{
+		LogWarning(LOG_GSTREAMER "gstBufferManager -- failed to retrieve the frame's timestamps (default to 0)\n");
+		memset(&mLastTimestamps, 0, sizeof(gstFrameTimestamp));
+		mLastTimestamp = 0;
+	}
+
+	// use the conversion that Enqueue() already started (CPU path only)
+	if( !mNvmmUsed && format != IMAGE_UNKNOWN && dequeueAsync(output, format, frame) )
+		return true;
+
+	void* latestYUV = NULL;
+	
+#ifdef ENABLE_NVMM
+	NvmmResource  tempResource;
+	NvmmResource* nvmmTextures = NULL;	// set when converting straight from the EGL frame
+	void*         vicOutput = NULL;		// set when the VIC converted the frame
+	
+	int  nvmmFD = -1;
+	bool nvmmReleaseFD = false;
+	
+	if( mNvmmUsed )
+	{
+		mNvmmMutex.Lock();
+		
+		nvmmFD = mNvmmFD;
+		nvmmReleaseFD = mNvmmReleaseFD;
+		
+		mNvmmFD = -1;
+		mNvmmReleaseFD = false;
+		
+		mNvmmMutex.Unlock();
+		
+		if( nvmmFD < 0 )
+			return false;
+
+		// convert the frame on the VIC instead of with CUDA (unless the VIC failed before)
+		if( mOptions->converter == videoOptions::CONVERTER_VIC && format != IMAGE_UNKNOWN && format != mFormatYUV && !mVicFailed )
+		{
+			vicOutput = transformNvmm(nvmmFD, format);
+
+			if( vicOutput != NULL && nvmmReleaseFD )
+				NvReleaseFd(nvmmFD);
+		}
+	}
+
+	if( mNvmmUsed && !vicOutput )
+	{
+		// FD's from nvvidconv belong to its buffer pool and stay valid, so their mapping
+		// gets cached.  Other FD's are released after this frame (and the number could be
+		// reused for a different buffer), so those get mapped for just this frame.
+		NvmmResource* nvmmResource = &tempResource;
+		
+		if( nvmmReleaseFD )
+		{
+			if( !mapNvmm(nvmmFD, &tempResource) )
+			{
+				NvReleaseFd(nvmmFD);
+				return false;
+			}
+		}
+		else
+		{
+			nvmmResource = lookupNvmm(nvmmFD);
+			
+			if( !nvmmResource )
+				return false;
+		}
+		
+		// retrieve the CUDA arrays of the EGLImage
+		cudaEglFrame eglFrame;
+		
+		if( CUDA_FAILED(cudaGraphicsResourceGetMappedEglFrame(&eglFrame, (cudaGraphicsResource*)nvmmResource->resource, 0, 0)) )
+			return false;
+
+		if( eglFrame.planeCount != 2 )
+			LogWarning(LOG_GSTREAMER "gstBufferManager -- unexpected number of planes in NVMM buffer (%u vs 2 expected)\n", eglFrame.planeCount);
+
+		if( eglFrame.planeDesc[0].width != mOptions->width || eglFrame.planeDesc[0].height != mOptions->height )
+		{
+			LogError(LOG_GSTREAMER "gstBufferManager -- NVMM EGLImage dimensions mismatch (%ux%u when expected %ux%u)", eglFrame.planeDesc[0].width, eglFrame.planeDesc[0].height, mOptions->width, mOptions->height);
+			return false;
+		}
+		
+		// when RGB output is requested, the colorspace conversion reads from the EGL frame
+		// directly through texture objects, so the planes don't get copied to mNvmmCUDA
+		// (only for cached mappings, because temporary mappings are released below)
+		if( format != IMAGE_UNKNOWN && format != mFormatYUV && mFormatYUV == IMAGE_NV12 && nvmmResource->lumaTex != 0 && !nvmmReleaseFD )
+			nvmmTextures = nvmmResource;
+		else
+		{
+			if( eglFrame.frameType != cudaEglFrameTypeArray )  // cudaEglFrameTypePitch
+			{
+				LogError(LOG_GSTREAMER "gstBufferManager -- NVMM had unexpected frame type (was pitched pointer, expected CUDA array)\n");
+				return false;
+			}
+		
+			// NV12 buffers have multiple planes (Y @ full res and UV @ half res)
+			const size_t maxPlanes = 16;
+			size_t planePitch[maxPlanes];
+			size_t planeSize[maxPlanes];
+			size_t sizeYUV = 0;
+		
+			for( uint32_t n=0; n < eglFrame.planeCount && n < maxPlanes; n++ )
+			{
+				cudaChannelFormatDesc arrayDesc;
+				cudaExtent arrayExtent;
+			
+				CUDA(cudaArrayGetInfo(&arrayDesc, &arrayExtent, NULL, eglFrame.frame.pArray[n]));
+			
+				const size_t bpp = arrayDesc.x + arrayDesc.y + arrayDesc.z;
+			
+				planePitch[n] = (bpp * arrayExtent.width) / 8;
+				planeSize[n] = planePitch[n] * arrayExtent.height;
+			
+				sizeYUV += planeSize[n];
+			
+			#ifdef DEBUG
+				LogDebug(LOG_GSTREAMER "gstBufferManager -- plane=%u x=%i y=%i z=%i  w=%zu h=%zu d=%zu  pitch=%zu size=%zu\n", n, arrayDesc.x, arrayDesc.y, arrayDesc.z, arrayExtent.width, arrayExtent.height, arrayExtent.depth, planePitch[n], planeSize[n]);
+			#endif
+			}
+
+			// allocate CUDA memory for the image
+			if( !mNvmmCUDA || mNvmmSize != sizeYUV )
+			{
+				CUDA_FREE(mNvmmCUDA);
+			
+				if( CUDA_FAILED(cudaMalloc(&mNvmmCUDA, sizeYUV)) )
+					return false;
+			
+				mNvmmSize = sizeYUV;
+			}
+		
+			// copy arrays into linear memory (so our CUDA kernels can use it)
+			size_t planeOffset = 0;
+		
+			for( uint32_t n=0; n < eglFrame.planeCount && n < maxPlanes; n++ )
+			{
+				if( CUDA_FAILED(cudaMemcpy2DFromArrayAsync(((uint8_t*)mNvmmCUDA) + planeOffset, planePitch[n], eglFrame.frame.pArray[n], 0, 0, planePitch[n], eglFrame.planeDesc[n].height, cudaMemcpyDeviceToDevice)) )
+					return false;
+		
+				planeOffset += planeSize[n];
+			}
+
+			latestYUV = mNvmmCUDA;
+		
+			if( nvmmReleaseFD )
+			{
+				unmapNvmm(&tempResource);
+				NvReleaseFd(nvmmFD);
+			}
+		}
+	}
+#endif
+
+	// handle the CPU path (non-NVMM), where the frame might still be uploading
+	if( !mNvmmUsed )
+	{
+		if( !frame->image || CUDA_FAILED(cudaEventSynchronize(frame->event)) )
+			return false;
+
+		latestYUV = frame->image;
+	}
+
+#ifdef ENABLE_NVMM
+	if( !latestYUV && !nvmmTextures && !vicOutput )
+#else
+	if( !latestYUV )
+#endif
+		return false;
+
+	// remember the raw frame, in case it gets converted later by Convert()
+	mLastYUV = latestYUV;
+	resetFormats();
+
+	// output the raw image if the conversion format is unknown (or already the raw format)
+	if( format == IMAGE_UNKNOWN || format == mFormatYUV )
 	{
 		*output = latestYUV;
 		return true;
 	}
 
-	// allocate ringbuffer for colorspace conversion
+#ifdef ENABLE_NVMM
+	if( vicOutput != NULL )
+	{
+		getFormat(format)->latest = vicOutput;
+
+		*output = vicOutput;
+		return true;
+	}
+
+	if( nvmmTextures != NULL )
+		return convertFrame(NULL, nvmmTextures->lumaTex, nvmmTextures->chromaTex, format, output);
+#endif
+
+	return convertFrame(latestYUV, 0, 0, format, output);
+}
+
+
+// Convert
+bool gstBufferManager::Convert( void** output, imageFormat format )
+{
+	if( !output )
+		return false;
+
+	cudaDeviceScope device(mOptions->cudaDevice);
+
+	// the raw frame is returned as-is
+	if( format == IMAGE_UNKNOWN || format == mFormatYUV )
+	{
+		if( !mLastYUV )
+		{
+			LogError(LOG_GSTREAMER "gstBufferManager -- the raw frame isn't available (it was converted directly from NVMM)\n");
+			return false;
+		}
+
+		*output = mLastYUV;
+		return true;
+	}
+
+	// only convert the frame the first time that this format is requested
+	FormatRing* ring = getFormat(format);
+
+	if( ring->latest != NULL )
+	{
+		*output = ring->latest;
+		return true;
+	}
+
+	if( !mLastYUV )
+	{
+		LogError(LOG_GSTREAMER "gstBufferManager -- there isn't a raw frame to convert (Dequeue() should be called first)\n");
+		return false;
+	}
+
+	return convertFrame(mLastYUV, 0, 0, format, output);
+}
+
+
+// convertFrame
+bool gstBufferManager::convertFrame( void* input, cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, imageFormat format, void** output )
+{
+	// allocate ringbuffer for colorspace conversion (each format has its own)
 	const size_t rgbBufferSize = imageFormatSize(format, mOptions->width, mOptions->height);
+	FormatRing* ring = getFormat(format);
 
-	if( !mBufferRGB.Alloc(mOptions->numBuffers, rgbBufferSize, mOptions->zeroCopy ? RingBuffer::ZeroCopy : 0) )
+	if( !ring->buffers.Alloc(mOptions->numBuffers, rgbBufferSize, mOptions->zeroCopy ? RingBuffer::ZeroCopy : 0) )
 	{
 		LogError(LOG_GSTREAMER "gstBufferManager -- failed to allocate %u buffers (%zu bytes each)\n", mOptions->numBuffers, rgbBufferSize);
 		return false;
 	}
 
 	// perform colorspace conversion
-	void* nextRGB = mBufferRGB.Next(RingBuffer::Write);
-
-	if( CUDA_FAILED(cudaConvertColor(latestYUV, mFormatYUV, nextRGB, format, mOptions->width, mOptions->height)) )
+	void* nextRGB = ring->buffers.Next(RingBuffer::Write);
+	cudaError_t result = cudaSuccess;
+	
+	if( lumaTex != 0 )
+		result = cudaConvertColor(lumaTex, chromaTex, mFormatYUV, nextRGB, format, mOptions->width, mOptions->height, NULL, mColorimetry);
+	else
+		result = cudaConvertColor(input, mFormatYUV, nextRGB, format, mOptions->width, mOptions->height, make_float2(0,255), NULL, mColorimetry);
+	
+	if( CUDA_FAILED(result) )
 	{
 		LogError(LOG_GSTREAMER "gstBufferManager -- unsupported image format (%s)\n", imageFormatToStr(format));
 		LogError(LOG_GSTREAMER "                    supported formats are:\n");
@@ -444,7 +1595,53 @@ bool gstBufferManager::Dequeue( void** output, imageFormat format, uint64_t time
 		return false;
 	}
 
+	ring->latest = nextRGB;
+
 	*output = nextRGB;
 	return true;
 }
 
+
+// getFormat
+gstBufferManager::FormatRing* gstBufferManager::getFormat( imageFormat format )
+{
+	FormatRing* evict = NULL;
+
+	mFormatClock++;
+
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_FORMATS; n++ )
+	{
+		FormatRing* ring = &mFormatRings[n];
+
+		if( ring->format == format )
+		{
+			ring->lastUsed = mFormatClock;
+			return ring;
+		}
+
+		// prefer an unused slot, otherwise the least-recently used format
+		if( !evict || (evict->format != IMAGE_UNKNOWN && (ring->format == IMAGE_UNKNOWN || ring->lastUsed < evict->lastUsed)) )
+			evict = ring;
+	}
+
+	if( evict->format != IMAGE_UNKNOWN )
+	{
+		LogVerbose(LOG_GSTREAMER "gstBufferManager -- more than %u formats requested, releasing the %s buffers\n", GST_BUFFER_MANAGER_FORMATS, imageFormatToStr(evict->format));
+		evict->buffers.Free();
+	}
+
+	evict->format   = format;
+	evict->latest   = NULL;
+	evict->lastUsed = mFormatClock;
+
+	return evict;
+}
+
+
+// resetFormats
+void gstBufferManager::resetFormats()
+{
+	for( uint32_t n=0; n < GST_BUFFER_MANAGER_FORMATS; n++ )
+		mFormatRings[n].latest = NULL;
+}
+
@@ -26,11 +26,14 @@
 #include "gstUtility.h"
 #include "imageFormat.h"
 #include "videoOptions.h"
+#include "videoSource.h"
 
 #include "Event.h"
 #include "Mutex.h"
 #include "RingBuffer.h"
 
+#include <atomic>
+
 
 #ifdef ENABLE_NVMM
 #if !GST_CHECK_VERSION(1,0,0)
@@ -46,6 +49,40 @@
 #define GST_CAPS_FEATURE_MEMORY_NVMM "memory:NVMM"
 //#endif
 
+/**
+ * Number of NVMM buffers that have their EGLImage and CUDA registration cached.
+ * This should be at least the size of the upstream buffer pool (nvvidconv uses 4-8).
+ * @ingroup codec
+ */
+#define GST_BUFFER_MANAGER_NVMM_CACHE 8
+
+/**
+ * Number of RGBA buffers that the VIC converts NVMM frames into (with videoOptions::CONVERTER_VIC).
+ * @ingroup codec
+ */
+#define GST_BUFFER_MANAGER_VIC_BUFFERS 2
+
+/**
+ * Number of formats that gstBufferManager keeps separate conversion ringbuffers for,
+ * so that consumers capturing different formats don't re-allocate them every frame.
+ * @ingroup codec
+ */
+#define GST_BUFFER_MANAGER_FORMATS 4
+
+
+/**
+ * Timestamps of a frame recieved by gstBufferManager (in nanoseconds).
+ * @ingroup codec
+ */
+struct gstFrameTimestamp
+{
+	uint64_t timestamp;	/**< The DTS or PTS of the buffer, or else its arrival time since the app started (see videoSource::GetLastTimestamp()) */
+	uint64_t pts;		/**< Presentation timestamp of the buffer in stream time (or GST_CLOCK_TIME_NONE) */
+	uint64_t dts;		/**< Decoding timestamp of the buffer in stream time (or GST_CLOCK_TIME_NONE) */
+	uint64_t sensor;	/**< Sensor timestamp attached by the source as a GstReferenceTimestampMeta (or 0 if there wasn't one) */
+	uint64_t capture;	/**< Capture time in CLOCK_MONOTONIC - the sensor timestamp, or else the PTS mapped through the pipeline clock, or else the arrival time */
+};
+
 
 /**
  * gstBufferManager recieves GStreamer buffers from appsink elements and unpacks/maps 
@@ -53,6 +90,23 @@
  *
  * It can handle both normal CPU-based GStreamer buffers and NVMM memory which can
  * be mapped directly to the GPU without requiring memory copies using the CPU.
+ * For NVMM frames, the NV12->RGB conversion reads the mapped EGL frame through
+ * texture objects, so the decoder's surface isn't copied on the GPU either.
+ * With videoOptions::CONVERTER_VIC, NVMM frames are instead converted to RGBA by
+ * the VIC engine with NvBufferTransform(), which leaves the GPU free for inference.
+ *
+ * The frames are passed from Enqueue() to Dequeue() through a single ring of frame
+ * descriptors, which keep the raw image together with its format, timestamps and
+ * sequence number (for NVMM frames, only the metadata).  Enqueue() is the only writer
+ * and Dequeue() the only reader, so the ring uses atomics instead of a mutex.  The
+ * latest dequeued frame is leased until the next one is dequeued, so that Enqueue()
+ * doesn't overwrite it while Convert() or the application is still reading it.
+ *
+ * For CPU-based buffers, once Dequeue() has been called with an RGB format, the
+ * following frames get converted into that format by Enqueue() as soon as they're
+ * recieved, using a CUDA stream private to the gstBufferManager.  Dequeue() then
+ * only has to wait for the frame's CUDA event, so the conversion overlaps with
+ * whatever work the application is doing with the previous frame.
  *
  * To disable the use of NVMM memory, set -DENABLE_NVMM=OFF when building with CMake:
  *
@@ -75,19 +129,46 @@ public:
 	
 	/**
 	 * Enqueue a GstBuffer from GStreamer.
+	 *
+	 * @param baseTime the base time of the pipeline if its clock is CLOCK_MONOTONIC (see gst_monotonic_base_time()),
+	 *                 which is used to map the buffer's PTS to the time that it was captured.
+	 * @param segment the segment of the sample, used to convert the PTS into running time.
 	 */
-	bool Enqueue( GstBuffer* buffer, GstCaps* caps );
+	bool Enqueue( GstBuffer* buffer, GstCaps* caps, uint64_t baseTime=GST_CLOCK_TIME_NONE, const GstSegment* segment=NULL );
 	
 	/**
 	 * Dequeue the next frame.
+	 *
+	 * If the format is `IMAGE_UNKNOWN` or the same as the raw format (see GetRawFormat(),
+	 * for example `IMAGE_NV12`), the raw YUV buffer itself is returned without a conversion.
 	 */
 	bool Dequeue( void** output, imageFormat format, uint64_t timeout=UINT64_MAX );
 
+	/**
+	 * Convert the frame that was last dequeued into another format.
+	 *
+	 * This allows the raw frame to be dequeued first, and then only be converted if it
+	 * turns out to be needed.  The conversion happens the first time that a format is
+	 * requested, and after that the same converted image is returned for that format.
+	 */
+	bool Convert( void** output, imageFormat format );
+
+	/**
+	 * Discard the frame that's waiting to be dequeued (if any), so that the next
+	 * call to Dequeue() waits for a new frame.  This is used after seeking.
+	 */
+	void Flush();
+
 	/**
 	 * Get timestamp of the latest dequeued frame.
 	 */
 	uint64_t GetLastTimestamp() const { return mLastTimestamp; }
 
+	/**
+	 * Get all the timestamps of the latest dequeued frame (PTS, DTS, sensor and capture time).
+	 */
+	inline const gstFrameTimestamp& GetLastTimestamps() const { return mLastTimestamps; }
+
 	/**
 	 * Get raw image format.
   	 */
@@ -97,27 +178,174 @@ public:
 	 * Get the total number of frames that have been recieved.
 	 */
 	inline uint64_t GetFrameCount() const	{ return mFrameCount; }
+
+	/**
+	 * Get the statistics of the frames that have been recieved and dequeued (see videoSource::GetStats()).
+	 * The counters are atomics that are updated by Enqueue() and Dequeue(), so this can be called from any thread.
+	 */
+	void GetStats( videoSourceStats* stats ) const;
+
+	/**
+	 * Get a file descriptor that's readable while a new frame is waiting to be dequeued.
+	 * @see Event::GetFD()
+	 */
+	inline int GetEventFD()				{ return mWaitEvent.GetFD(); }
 	
 protected:
 
+	/**
+	 * Ringbuffer of frames that have been converted to one format, along with the converted
+	 * image of the latest dequeued frame (so each format only gets converted once per frame).
+	 */
+	struct FormatRing
+	{
+		imageFormat format;	/**< Format of the images (or IMAGE_UNKNOWN if the slot is unused) */
+		RingBuffer  buffers;	/**< Ringbuffer of converted images */
+		void*       latest;	/**< The latest dequeued frame in this format (or NULL if it wasn't converted yet) */
+		uint64_t    lastUsed;	/**< When the format was last requested (the least-recently used one gets evicted) */
+	};
+
+	FormatRing* getFormat( imageFormat format );
+	void resetFormats();
+
+	bool convertFrame( void* input, cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, imageFormat format, void** output );
+
+	bool parseCaps( GstCaps* caps );
+	bool dequeueFrame( void** output, imageFormat format );
+	void updateStats( uint64_t arrival, bool skipped=false );
+	bool skipFrame( uint64_t arrival );
+
+	GstCaps*      mCaps;       /**< The caps that mFormatYUV and the size were parsed from (only re-parsed when they change) */
+	bool          mCapsNVMM;   /**< Do the current caps have the NVMM memory feature? */
+
 	imageFormat   mFormatYUV;  /**< The YUV colorspace format coming from appsink (typically NV12 or YUY2) */
-	RingBuffer    mBufferYUV;  /**< Ringbuffer of CPU-based YUV frames (non-NVMM) that come from appsink */
-	RingBuffer    mTimestamps; /**< Ringbuffer of timestamps that come from appsink */
-	RingBuffer    mBufferRGB;  /**< Ringbuffer of frames that have been converted to RGB colorspace */
+	cudaColorimetry mColorimetry; /**< The colorimetry used to convert mFormatYUV to RGB */
+	FormatRing    mFormatRings[GST_BUFFER_MANAGER_FORMATS];  /**< Ringbuffers of frames that have been converted to RGB colorspace */
+	uint64_t      mFormatClock; /**< Incremented each time a format is requested (for the LRU eviction) */
 	uint64_t      mLastTimestamp;  /**< Timestamp of the latest dequeued frame */
+	gstFrameTimestamp mLastTimestamps;  /**< All the timestamps of the latest dequeued frame */
+	void*         mLastYUV;        /**< Raw buffer of the latest dequeued frame (used by Convert()) */
 	Event	      mWaitEvent;  /**< Event that gets triggered when a new frame is recieved */
 	
 	videoOptions* mOptions;    /**< Options of the gstDecoder / gstCamera object */			
 	uint64_t	  mFrameCount; /**< Total number of frames that have been recieved */
 	bool 	      mNvmmUsed;   /**< Is NVMM memory actually used by the stream? */
+
+	std::atomic<uint64_t> mStatsReceived;    /**< Frames recieved by Enqueue() */
+	std::atomic<uint64_t> mStatsCaptured;    /**< Frames returned by Dequeue() */
+	std::atomic<uint64_t> mStatsDropped;     /**< Frames that were overwritten before they were dequeued */
+	std::atomic<uint64_t> mStatsDequeuedAt;  /**< The value of mStatsReceived when the last frame was dequeued */
+	std::atomic<uint64_t> mStatsMaxQueue;    /**< Most frames that were waiting to be dequeued at once */
+	std::atomic<uint64_t> mStatsArrival;     /**< When the last frame was recieved (in nanoseconds) */
+	std::atomic<uint64_t> mStatsInterval;    /**< Moving average of the time between frames (in nanoseconds) */
+	std::atomic<uint64_t> mStatsMaxInterval; /**< Longest time between frames (in nanoseconds) */
+	std::atomic<uint64_t> mStatsJitter;      /**< Moving average of the deviation from mStatsInterval (in nanoseconds) */
+	std::atomic<uint64_t> mStatsConvert;     /**< Moving average of the time Dequeue() took after the frame arrived (in nanoseconds) */
+	std::atomic<uint64_t> mStatsMaxConvert;  /**< Longest time that Dequeue() took after the frame arrived (in nanoseconds) */
+	std::atomic<uint64_t> mStatsSkipped;     /**< Frames that skipFrame() skipped before they were converted */
+
+	std::atomic<uint64_t> mCaptureLast;      /**< When Dequeue() was last called (in nanoseconds) */
+	std::atomic<uint64_t> mCaptureInterval;  /**< Moving average of the time between calls to Dequeue() (in nanoseconds) */
+	std::atomic<bool>     mCaptureWaiting;   /**< Is Dequeue() waiting for a frame? (then they're never skipped) */
+	uint64_t              mAcceptedLast;     /**< When the last frame that wasn't skipped arrived (only used by Enqueue()) */
+
+	/**
+	 * Descriptor of a frame recieved by Enqueue(), with the raw image and its metadata in one slot.
+	 */
+	struct FrameSlot
+	{
+		void*       image;	/**< The raw frame in GPU-accessible memory (NULL for NVMM frames) */
+		void*       staging;	/**< Pinned CPU buffer that the frame is uploaded from (NULL with zeroCopy) */
+		size_t      size;		/**< Size of the raw frame (in bytes) */
+		uint64_t    sequence;	/**< The value of GetFrameCount() when the frame was recieved */
+		gstFrameTimestamp timestamp;	/**< Timestamps of the frame */
+		cudaEvent_t event;	/**< Recorded after the last GPU work on the image (the upload and asynchronous conversion) */
+		std::atomic<uint32_t> leases;	/**< Number of leases held by Dequeue() (Enqueue() skips leased slots) */
+	};
+
+	bool allocFrames();
+	void freeFrames();
+
+	bool allocImage( FrameSlot* frame, size_t size );
+	void freeImage( FrameSlot* frame );
+
+	int  writeFrame();
+	void publishFrame( int slot );
+	int  acquireFrame();
+	void releaseFrame( int slot );
+
+	FrameSlot*       mFrames;          /**< Ring of frame descriptors between Enqueue() and Dequeue() */
+	uint32_t         mFrameSlots;      /**< Number of slots in mFrames */
+	uint32_t         mFrameNext;       /**< The next slot that Enqueue() tries to write (only used by Enqueue()) */
+	int              mFramePublished;  /**< The slot that Enqueue() published last (only used by Enqueue()) */
+	std::atomic<int> mFrameLatest;     /**< The published slot that hasn't been dequeued yet (or -1) */
+	int              mFrameLeased;     /**< The slot of the latest dequeued frame, which Dequeue() holds a lease on (or -1) */
+
+	/**
+	 * A frame that Enqueue() started converting on mAsyncStream.
+	 */
+	struct AsyncFrame
+	{
+		void*       image;	/**< The converted image */
+		cudaEvent_t event;	/**< Recorded on mAsyncStream after the conversion */
+		uint64_t    sequence;	/**< Sequence number of the frame that it was converted from */
+	};
+
+	bool allocAsync( imageFormat format );
+	void freeAsync();
+
+	bool convertAsync( FrameSlot* frame );
+	bool dequeueAsync( void** output, imageFormat format, FrameSlot* frame );
+
+	AsyncFrame*   mAsyncFrames;  /**< Ring of numBuffers converted frames */
+	uint32_t      mAsyncCount;   /**< Number of frames in mAsyncFrames */
+	uint32_t      mAsyncNext;    /**< The next frame in the ring to convert into */
+	int           mAsyncLatest;  /**< The latest converted frame that hasn't been dequeued (or -1) */
+	size_t        mAsyncSize;    /**< Size of each converted image (in bytes) */
+	imageFormat   mAsyncFormat;  /**< The format requested by Dequeue() (or IMAGE_UNKNOWN if disabled) */
+	uint32_t      mAsyncMisses;  /**< Number of consecutive Dequeue() calls that requested a different format */
+	imageFormat   mAsyncAlloc;   /**< The format that mAsyncFrames was allocated for */
+	cudaStream_t  mAsyncStream;  /**< Stream that the conversions are performed on */
+	cudaStream_t  mCopyStream;   /**< Stream that uploads the frames from staging (when zeroCopy is disabled) */
+	Mutex         mAsyncMutex;   /**< Protects mAsyncLatest and mAsyncFormat */
 	
 #ifdef ENABLE_NVMM
+	/**
+	 * EGLImage and CUDA graphics resource mapped from an NVMM buffer's dmabuf FD.
+	 */
+	struct NvmmResource
+	{
+		int      fd;
+		void*    egl;		/**< EGLImageKHR created from the FD */
+		void*    resource;	/**< cudaGraphicsResource registered to the EGLImage */
+		cudaTextureObject_t lumaTex;	/**< Texture object bound to the Y plane (or 0 if unavailable) */
+		cudaTextureObject_t chromaTex;	/**< Texture object bound to the interleaved UV plane */
+		uint32_t width;	/**< Frame width when the resource was mapped */
+		uint32_t height;	/**< Frame height when the resource was mapped */
+		uint64_t lastUsed;	/**< Frame number the resource was last used (for LRU eviction) */
+	};
+
+	bool mapNvmm( int fd, NvmmResource* resource );
+	void unmapNvmm( NvmmResource* resource );
+	NvmmResource* lookupNvmm( int fd );
+
+	bool allocVic();
+	void freeVic();
+	void* transformNvmm( int fd, imageFormat format );
+	
 	Mutex  mNvmmMutex;
 	int    mNvmmFD;
-	void*  mNvmmEGL;
 	void*  mNvmmCUDA;
 	size_t mNvmmSize;
 	bool   mNvmmReleaseFD;
+
+	NvmmResource mNvmmCache[GST_BUFFER_MANAGER_NVMM_CACHE];  /**< LRU cache of mapped NVMM buffers */
+	uint64_t     mNvmmDequeued;  /**< Number of NVMM frames dequeued (the LRU clock) */
+
+	NvmmResource mVicBuffers[GST_BUFFER_MANAGER_VIC_BUFFERS];  /**< RGBA buffers the VIC converts into (and their mappings) */
+	uint32_t     mVicNext;     /**< The next buffer in mVicBuffers to convert into */
+	void*        mVicRGBA;     /**< Linear RGBA image, for when the VIC output gets converted to other formats */
+	bool         mVicFailed;   /**< Set if the VIC failed, so the CUDA conversion gets used instead */
 #endif
 };
   
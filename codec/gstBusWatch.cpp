@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "gstBusWatch.h"
+
+#include "Thread.h"
+#include "Mutex.h"
+#include "logging.h"
+
+
+// the context and thread that are shared by all the watches
+static GMainContext* gBusContext  = NULL;
+static GMainLoop*    gBusMainLoop = NULL;
+static Thread*       gBusThread   = NULL;
+static Event         gBusStarted;
+static Mutex         gBusMutex;
+static uint32_t      gBusWatches  = 0;
+
+// maximum time to wait for the thread to start (in milliseconds)
+#define BUS_START_TIMEOUT 5000
+
+
+// constructor
+gstBusWatch::gstBusWatch( GstElement* pipeline, const char* name )
+{
+	mBus      = NULL;
+	mSource   = NULL;
+	mPipeline = pipeline;
+	mName     = (name != NULL) ? name : "gstreamer";
+	mEOS      = false;
+	mErrors   = 0;
+	mLatency  = 0;
+	mDropped  = 0;
+}
+
+
+// destructor
+gstBusWatch::~gstBusWatch()
+{
+	if( mSource != NULL )
+	{
+		// remove the source from inside the loop, so the destructor can't race with onMessage()
+		GSource* idle = g_idle_source_new();
+		g_source_set_callback(idle, onDestroy, this, NULL);
+		g_source_attach(idle, gBusContext);
+		g_source_unref(idle);
+
+		mDestroyEvent.Wait();
+
+		g_source_unref(mSource);
+		mSource = NULL;
+	}
+
+	if( mBus != NULL )
+	{
+		gst_object_unref(mBus);
+		mBus = NULL;
+	}
+
+	gBusMutex.Lock();
+
+	if( gBusWatches > 0 && --gBusWatches == 0 )
+		stopThread();
+
+	gBusMutex.Unlock();
+}
+
+
+// Create
+gstBusWatch* gstBusWatch::Create( GstElement* pipeline, const char* name )
+{
+	if( !pipeline )
+		return NULL;
+
+	gBusMutex.Lock();
+
+	if( !startThread() )
+	{
+		gBusMutex.Unlock();
+		return NULL;
+	}
+
+	gBusWatches++;
+	gBusMutex.Unlock();
+
+	gstBusWatch* watch = new gstBusWatch(pipeline, name);
+
+	watch->mBus = gst_element_get_bus(pipeline);
+
+	if( !watch->mBus )
+	{
+		LogError(LOG_GSTREAMER "%s -- failed to retrieve GstBus from pipeline\n", watch->mName.c_str());
+		delete watch;
+		return NULL;
+	}
+
+	watch->mSource = gst_bus_create_watch(watch->mBus);
+
+	if( !watch->mSource )
+	{
+		LogError(LOG_GSTREAMER "%s -- failed to create watch for the pipeline's bus\n", watch->mName.c_str());
+		delete watch;
+		return NULL;
+	}
+
+	g_source_set_callback(watch->mSource, (GSourceFunc)onMessage, watch, NULL);
+	g_source_attach(watch->mSource, gBusContext);
+
+	return watch;
+}
+
+
+// Reset
+void gstBusWatch::Reset()
+{
+	mEOS = false;
+	mErrors = 0;
+	mDropped = 0;
+	mStateEvent.Reset();
+}
+
+
+// WaitEOS
+bool gstBusWatch::WaitEOS( uint64_t timeout )
+{
+	const uint64_t deadline = gst_util_get_timestamp() + timeout;
+	const uint32_t errors = mErrors;
+
+	while( !mEOS )
+	{
+		if( mErrors != errors )
+			return false;
+
+		const uint64_t now = gst_util_get_timestamp();
+
+		if( now >= deadline )
+		{
+			LogWarning(LOG_GSTREAMER "%s -- timed out waiting for EOS after %.1f ms\n", mName.c_str(), double(timeout) / GST_MSECOND);
+			return false;
+		}
+
+		mStateEvent.WaitNs(deadline - now);
+	}
+
+	return true;
+}
+
+
+// onMessage (called from the bus thread)
+gboolean gstBusWatch::onMessage( GstBus* bus, GstMessage* message, gpointer user_data )
+{
+	gstBusWatch* watch = (gstBusWatch*)user_data;
+
+	if( !watch )
+		return G_SOURCE_REMOVE;
+
+	gst_message_print(bus, message, watch);
+
+	switch( GST_MESSAGE_TYPE(message) )
+	{
+		case GST_MESSAGE_EOS:
+		{
+			watch->mEOS = true;
+			watch->mStateEvent.Wake();
+			break;
+		}
+		case GST_MESSAGE_ERROR:
+		{
+			watch->mErrors++;
+			watch->mStateEvent.Wake();
+			break;
+		}
+		case GST_MESSAGE_LATENCY:
+		{
+			// an element's latency changed, so redistribute it and query the new total
+			gst_bin_recalculate_latency(GST_BIN(watch->mPipeline));
+
+			GstQuery* query = gst_query_new_latency();
+
+			if( gst_element_query(watch->mPipeline, query) )
+			{
+				gboolean live = FALSE;
+				GstClockTime minLatency = 0;
+
+				gst_query_parse_latency(query, &live, &minLatency, NULL);
+
+				if( GST_CLOCK_TIME_IS_VALID(minLatency) )
+				{
+					watch->mLatency = minLatency;
+					LogVerbose(LOG_GSTREAMER "%s -- pipeline latency is %.1f ms\n", watch->mName.c_str(), double(minLatency) / GST_MSECOND);
+				}
+			}
+
+			gst_query_unref(query);
+			break;
+		}
+	#if GST_CHECK_VERSION(1,0,0)
+		case GST_MESSAGE_QOS:
+		{
+			// each element reports the total it dropped, so keep the largest
+			GstFormat format = GST_FORMAT_UNDEFINED;
+			guint64 processed = 0;
+			guint64 dropped = 0;
+
+			gst_message_parse_qos_stats(message, &format, &processed, &dropped);
+
+			if( format == GST_FORMAT_BUFFERS && dropped != (guint64)-1 && dropped > watch->mDropped )
+				watch->mDropped = dropped;
+
+			break;
+		}
+	#endif
+		default:
+			break;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+
+// onDestroy (called from the bus thread)
+gboolean gstBusWatch::onDestroy( gpointer user_data )
+{
+	gstBusWatch* watch = (gstBusWatch*)user_data;
+
+	g_source_destroy(watch->mSource);
+	watch->mDestroyEvent.Wake();
+
+	return G_SOURCE_REMOVE;
+}
+
+
+// onLoopStarted (called from inside the main loop once it's running)
+static gboolean onLoopStarted( gpointer user_data )
+{
+	gBusStarted.Wake();
+	return G_SOURCE_REMOVE;
+}
+
+
+// runThread
+void* gstBusWatch::runThread( void* user_data )
+{
+	g_main_context_push_thread_default(gBusContext);
+	g_main_loop_run(gBusMainLoop);
+	g_main_context_pop_thread_default(gBusContext);
+
+	return NULL;
+}
+
+
+// startThread (gBusMutex should be locked)
+bool gstBusWatch::startThread()
+{
+	if( gBusThread != NULL )
+		return true;
+
+	if( !gstreamerInit() )
+	{
+		LogError(LOG_GSTREAMER "failed to initialize gstreamer API\n");
+		return false;
+	}
+
+	// make a main loop for a private context, so it doesn't interfere with the default one
+	gBusContext = g_main_context_new();
+	gBusMainLoop = g_main_loop_new(gBusContext, false);
+
+	if( !gBusMainLoop )
+	{
+		LogError(LOG_GSTREAMER "failed to create GMainLoop instance for the bus thread\n");
+		stopThread();
+		return false;
+	}
+
+	// signal when the loop is running, so that it can't be quit before it starts
+	GSource* source = g_idle_source_new();
+	g_source_set_callback(source, onLoopStarted, NULL, NULL);
+	g_source_attach(source, gBusContext);
+	g_source_unref(source);
+
+	gBusThread = new Thread();
+
+	if( !gBusThread->Start(runThread, NULL) )
+	{
+		LogError(LOG_GSTREAMER "failed to create thread for handling gstreamer bus messages\n");
+		delete gBusThread;
+		gBusThread = NULL;
+		stopThread();
+		return false;
+	}
+
+	if( !gBusStarted.Wait(BUS_START_TIMEOUT) )
+	{
+		LogError(LOG_GSTREAMER "timeout waiting for the gstreamer bus thread to start\n");
+		stopThread();
+		return false;
+	}
+
+	return true;
+}
+
+
+// stopThread (gBusMutex should be locked)
+void gstBusWatch::stopThread()
+{
+	if( gBusMainLoop != NULL )
+		g_main_loop_quit(gBusMainLoop);
+
+	if( gBusThread != NULL )
+	{
+		gBusThread->Stop(true);	// wait for the thread to exit
+		delete gBusThread;
+		gBusThread = NULL;
+	}
+
+	if( gBusMainLoop != NULL )
+	{
+		g_main_loop_unref(gBusMainLoop);
+		gBusMainLoop = NULL;
+	}
+
+	if( gBusContext != NULL )
+	{
+		g_main_context_unref(gBusContext);
+		gBusContext = NULL;
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GSTREAMER_BUS_WATCH_H__
+#define __GSTREAMER_BUS_WATCH_H__
+
+#include "gstUtility.h"
+#include "Event.h"
+
+#include <atomic>
+#include <string>
+
+
+/**
+ * Handles the messages from a pipeline's bus on a background thread, instead of the bus
+ * getting polled from Capture(), Render() and the appsink/appsrc callbacks.
+ *
+ * All of the watches share one thread, which runs a GMainLoop on a private GMainContext
+ * (so it doesn't interfere with the default context or the RTSP/WebRTC servers).  The messages
+ * get printed from there like before, and the state that the streaming code cares about is kept
+ * in atomics that can be read from any thread without locking:
+ *
+ *   - EOS and the number of errors posted by the pipeline
+ *   - the pipeline's latency (the elements' latencies get redistributed when they change)
+ *   - the number of buffers that the elements reported dropping in QoS messages
+ *
+ * Sync handlers that were set on the bus (like gstDecoder's for reconnecting RTSP) still get
+ * called first, from the thread that posted the message.
+ *
+ * @ingroup codec
+ */
+class gstBusWatch
+{
+public:
+	/**
+	 * Start watching the bus of a pipeline.
+	 * @param name the name to use for the pipeline in log messages (e.g. "gstDecoder")
+	 */
+	static gstBusWatch* Create( GstElement* pipeline, const char* name );
+
+	/**
+	 * Destructor (waits for a message that's being handled to finish)
+	 */
+	~gstBusWatch();
+
+	/**
+	 * Return true if the pipeline posted EOS since the last Reset().
+	 */
+	inline bool IsEOS() const				{ return mEOS; }
+
+	/**
+	 * Return the number of errors that the pipeline posted since the last Reset().
+	 */
+	inline uint32_t GetErrors() const			{ return mErrors; }
+
+	/**
+	 * Return the latency of the pipeline (in nanoseconds), or 0 if it's live without latency.
+	 */
+	inline uint64_t GetLatency() const			{ return mLatency; }
+
+	/**
+	 * Return the number of buffers that the elements reported dropping since the last Reset().
+	 */
+	inline uint64_t GetDropped() const			{ return mDropped; }
+
+	/**
+	 * Clear the EOS, error and QoS state (e.g. before the pipeline gets started again).
+	 */
+	void Reset();
+
+	/**
+	 * Wait for the pipeline to post EOS (or an error).
+	 * @param timeout the maximum time to wait (in nanoseconds)
+	 * @returns true if EOS was recieved, or false on error or timeout.
+	 */
+	bool WaitEOS( uint64_t timeout );
+
+protected:
+	gstBusWatch( GstElement* pipeline, const char* name );
+
+	static gboolean onMessage( GstBus* bus, GstMessage* message, gpointer user_data );
+	static gboolean onDestroy( gpointer user_data );
+
+	static bool startThread();
+	static void stopThread();
+	static void* runThread( void* user_data );
+
+	GstBus*     mBus;
+	GstElement* mPipeline;
+	GSource*    mSource;
+	std::string mName;
+
+	Event mStateEvent;		// signalled when EOS or an error is recieved
+	Event mDestroyEvent;	// signalled when the source was removed from the context
+
+	std::atomic<bool>     mEOS;
+	std::atomic<uint32_t> mErrors;
+	std::atomic<uint64_t> mLatency;
+	std::atomic<uint64_t> mDropped;
+};
+
+#endif
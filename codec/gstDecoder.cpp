@@ -26,10 +26,14 @@
 #include "cudaColorspace.h"
 #include "filesystem.h"
 #include "logging.h"
+#include "cudaNVTX.h"
+#include "videoMetrics.h"
 
 #include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
 #include <gst/pbutils/pbutils.h>
 
+#include <algorithm>
 #include <sstream>
 #include <unistd.h>
 #include <string.h>
@@ -95,13 +99,30 @@ gstDecoder::gstDecoder( const videoOptions& options ) : videoSource(options)
 {	
 	mAppSink    = NULL;
 	mBus        = NULL;
+	mBusWatch   = NULL;
 	mPipeline   = NULL;
 	mCustomSize = false;
 	mCustomRate = false;
+	mCustomWidth  = 0;
+	mCustomHeight = 0;
 	mEOS        = false;
 	mLoopCount  = 1;
+	mSinkName   = "mysink";
 	
 	mBufferManager = new gstBufferManager(&mOptions);
+
+	mIndexThread = NULL;
+	mIndexReady  = false;
+	mIndexStop   = false;
+
+	mPacketSrc = NULL;
+	mRtspSrc   = NULL;
+	mRtspQueue = NULL;
+	mReconnects = 0;
+	mReconnectThread  = NULL;
+	mReconnectPending = false;
+	mReconnectStop    = false;
+	mLastPacketTime   = 0;
 	
 	mWebRTCServer = NULL;
 	mWebRTCConnected = false;
@@ -111,7 +132,52 @@ gstDecoder::gstDecoder( const videoOptions& options ) : videoSource(options)
 // destructor
 gstDecoder::~gstDecoder()
 {
+	// stop reporting the statistics before they're released
+	videoMetrics::Remove(this);
+
+	// stop building the frame index
+	if( mIndexThread != NULL )
+	{
+		mIndexStop = true;
+		mIndexThread->Stop(true);
+		delete mIndexThread;
+		mIndexThread = NULL;
+	}
+
+	// stop reconnecting the RTSP source
+	if( mReconnectThread != NULL )
+	{
+		mReconnectStop = true;
+		mReconnectEvent.Wake();
+		mReconnectThread->Stop(true);
+		delete mReconnectThread;
+		mReconnectThread = NULL;
+	}
+
 	Close();
+
+	SAFE_DELETE(mBusWatch);
+
+	if( mBus != NULL )
+		gst_bus_set_sync_handler(mBus, NULL, NULL, NULL);
+
+	if( mPacketSrc != NULL )
+	{
+		gst_object_unref(mPacketSrc);
+		mPacketSrc = NULL;
+	}
+
+	if( mRtspSrc != NULL )
+	{
+		gst_object_unref(mRtspSrc);
+		mRtspSrc = NULL;
+	}
+
+	if( mRtspQueue != NULL )
+	{
+		gst_object_unref(mRtspQueue);
+		mRtspQueue = NULL;
+	}
 	
 	if( mWebRTCServer != NULL )
 	{
@@ -176,61 +242,10 @@ gstDecoder* gstDecoder::Create( const URI& resource, videoOptions::Codec codec )
 bool gstDecoder::init()
 {
 	GError* err  = NULL;
-	
-	if( !gstreamerInit() )
-	{
-		LogError(LOG_GSTREAMER "failed to initialize gstreamer API\n");
-		return NULL;
-	}
-
-	// first, check that the file exists
-	if( mOptions.resource.protocol == "file" )
-	{
-		if( !fileExists(mOptions.resource.location) )
-		{
-			LogError(LOG_GSTREAMER "gstDecoder -- couldn't find file '%s'\n", mOptions.resource.location.c_str());
-			return false;
-		}
-	}
-	
-	LogInfo(LOG_GSTREAMER "gstDecoder -- creating decoder for %s\n", mOptions.resource.location.c_str());
 
-	// flag if the user wants a specific resolution and framerate
-	if( mOptions.width != 0 || mOptions.height != 0 )
-		mCustomSize = true;
-
-	if( mOptions.frameRate != 0 )
-		mCustomRate = true;
-
-	// discover resource stats
-	if( !discover() )
-	{
-		if( mOptions.resource.protocol == "rtp" || mOptions.resource.protocol == "webrtc" )
-		{
-			LogWarning(LOG_GSTREAMER "gstDecoder -- resource discovery not supported for RTP/WebRTC streams\n");	
-
-			if( mOptions.codec == videoOptions::CODEC_UNKNOWN )
-			{
-				LogWarning(LOG_GSTREAMER "gstDecoder -- defaulting to H264 codec (you can change this with the --input-codec option)\n");
-				mOptions.codec = videoOptions::CODEC_H264;
-			}
-		}
-		else
-			LogError(LOG_GSTREAMER "gstDecoder -- resource discovery and auto-negotiation failed\n");
-
-		if( mOptions.codec == videoOptions::CODEC_UNKNOWN )
-		{
-			LogError(LOG_GSTREAMER "gstDecoder -- try manually setting the codec with the --input-codec option\n");
-			return false;
-		}
-	}
-	
-	// build pipeline string
-	if( !buildLaunchStr() )
-	{
-		LogError(LOG_GSTREAMER "gstDecoder -- failed to build pipeline string\n");
+	// discover the stream and build pipeline string
+	if( !initLaunchStr() )
 		return false;
-	}
 
 	// create pipeline
 	mPipeline = gst_parse_launch(mLaunchStr.c_str(), &err);
@@ -260,11 +275,14 @@ bool gstDecoder::init()
 		return false;
 	}
 
-	// add watch for messages (disabled when we poll the bus ourselves, instead of gmainloop)
-	//gst_bus_add_watch(mBus, (GstBusFunc)gst_message_print, NULL);
+	// handle the messages on the bus thread, so Capture() and the appsink callbacks don't poll the bus
+	mBusWatch = gstBusWatch::Create(mPipeline, "gstDecoder");
+
+	if( !mBusWatch )
+		return false;
 
 	// get the appsrc
-	GstElement* appsinkElement = gst_bin_get_by_name(GST_BIN(pipeline), "mysink");
+	GstElement* appsinkElement = gst_bin_get_by_name(GST_BIN(pipeline), mSinkName.c_str());
 	GstAppSink* appsink = GST_APP_SINK(appsinkElement);
 
 	if( !appsinkElement || !appsink)
@@ -275,6 +293,18 @@ bool gstDecoder::init()
 	
 	mAppSink = appsink;
 
+	// get the appsrc that the packets get pushed into
+	if( mOptions.resource.protocol == "packet" )
+	{
+		mPacketSrc = gst_bin_get_by_name(GST_BIN(pipeline), (mSinkName + "_packetsrc").c_str());
+
+		if( !mPacketSrc )
+		{
+			LogError(LOG_GSTREAMER "gstDecoder -- failed to retrieve appsrc element from pipeline\n");
+			return false;
+		}
+	}
+
 	// setup callbacks
 	GstAppSinkCallbacks cb;
 	memset(&cb, 0, sizeof(GstAppSinkCallbacks));
@@ -301,7 +331,316 @@ bool gstDecoder::init()
 		
 		mWebRTCServer->AddRoute(mOptions.resource.path.c_str(), onWebsocketMessage, this, WEBRTC_VIDEO|WEBRTC_RECEIVE|WEBRTC_PUBLIC);
 	}	
+
+	// link the RTSP source and setup reconnection
+	if( mOptions.resource.protocol == "rtsp" )
+	{
+		if( !initRTSP(mPipeline) )
+			return false;
+
+		// errors are caught as they're posted, because Capture() may be blocked waiting for frames
+		if( mOptions.reconnect > 0 )
+			gst_bus_set_sync_handler(mBus, onBusMessage, this, NULL);
+	}
+
+	return true;
+}
+
+
+// initRTSP
+bool gstDecoder::initRTSP( GstElement* pipeline )
+{
+	const std::string srcName = mSinkName + "_rtspsrc";
+	const std::string queueName = mSinkName + "_rtspqueue";
+
+	mRtspSrc = gst_bin_get_by_name(GST_BIN(pipeline), srcName.c_str());
+	mRtspQueue = gst_bin_get_by_name(GST_BIN(pipeline), queueName.c_str());
+
+	if( !mRtspSrc || !mRtspQueue )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to retrieve rtspsrc element from pipeline\n");
+		return false;
+	}
+
+	// rtspsrc creates a new pad each time it connects, so it gets linked manually
+	// (gst_parse_launch() only links the pads that appear the first time)
+	g_signal_connect(mRtspSrc, "pad-added", G_CALLBACK(onRtspPad), this);
+
+	// track when packets are received, and catch EOS before it reaches the appsink
+	GstPad* pad = gst_element_get_static_pad(mRtspQueue, "sink");
+
+	if( !pad )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to retrieve the sink pad of the RTSP queue\n");
+		return false;
+	}
+
+	gst_pad_add_probe(pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER|GST_PAD_PROBE_TYPE_BUFFER_LIST|GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM), onRtspProbe, this, NULL);
+	gst_object_unref(pad);
+
+	if( mOptions.reconnect == 0 )
+		return true;
+
+	mReconnectThread = new Thread();
+
+	if( !mReconnectThread->Start(reconnectThread, this) )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to start the RTSP reconnection thread\n");
+		return false;
+	}
+
+	return true;
+}
+
+
+// onRtspPad
+void gstDecoder::onRtspPad( GstElement* src, GstPad* pad, void* user_data )
+{
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	if( !dec || !dec->mRtspQueue )
+		return;
+
+	// skip audio or metadata streams from the camera
+	GstCaps* caps = gst_pad_get_current_caps(pad);
+
+	if( !caps )
+		caps = gst_pad_query_caps(pad, NULL);
+
+	if( caps != NULL )
+	{
+		const GstStructure* structure = gst_caps_get_structure(caps, 0);
+		const char* media = (structure != NULL) ? gst_structure_get_string(structure, "media") : NULL;
+
+		const bool video = !media || strcasecmp(media, "video") == 0;
+		gst_caps_unref(caps);
+
+		if( !video )
+		{
+			LogVerbose(LOG_GSTREAMER "gstDecoder -- ignoring RTSP %s stream\n", media);
+			return;
+		}
+	}
+
+	GstPad* sink = gst_element_get_static_pad(dec->mRtspQueue, "sink");
+
+	if( !sink )
+		return;
+
+	if( gst_pad_is_linked(sink) )
+	{
+		LogVerbose(LOG_GSTREAMER "gstDecoder -- ignoring additional RTSP video stream\n");
+	}
+	else
+	{
+		const GstPadLinkReturn result = gst_pad_link(pad, sink);
+
+		if( GST_PAD_LINK_FAILED(result) )
+			LogError(LOG_GSTREAMER "gstDecoder -- failed to link RTSP source pad (error %i)\n", (int)result);
+		else
+			LogVerbose(LOG_GSTREAMER "gstDecoder -- linked RTSP source pad %s\n", GST_PAD_NAME(pad));
+	}
+
+	gst_object_unref(sink);
+}
+
+
+// onRtspProbe
+GstPadProbeReturn gstDecoder::onRtspProbe( GstPad* pad, GstPadProbeInfo* info, void* user_data )
+{
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	if( !dec )
+		return GST_PAD_PROBE_OK;
+
+	if( info->type & (GST_PAD_PROBE_TYPE_BUFFER|GST_PAD_PROBE_TYPE_BUFFER_LIST) )
+	{
+		dec->mLastPacketTime = gst_util_get_timestamp();
+		return GST_PAD_PROBE_OK;
+	}
+
+	GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+
+	if( !event || GST_EVENT_TYPE(event) != GST_EVENT_EOS || dec->mOptions.reconnect == 0 )
+		return GST_PAD_PROBE_OK;
+
+	// the source gets restarted, so don't let the rest of the pipeline go EOS
+	LogWarning(LOG_GSTREAMER "gstDecoder -- RTSP stream ended, reconnecting to %s\n", dec->mOptions.resource.string.c_str());
+
+	dec->mReconnectPending = true;
+	dec->mReconnectEvent.Wake();
+
+	return GST_PAD_PROBE_DROP;
+}
+
+
+// onBusMessage (called from the thread that posted the message)
+GstBusSyncReply gstDecoder::onBusMessage( GstBus* bus, GstMessage* msg, void* user_data )
+{
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	if( !dec || !dec->mRtspSrc || GST_MESSAGE_TYPE(msg) != GST_MESSAGE_ERROR )
+		return GST_BUS_PASS;
+
+	GstObject* src = GST_MESSAGE_SRC(msg);
+
+	if( src == GST_OBJECT(dec->mRtspSrc) || gst_object_has_as_ancestor(src, GST_OBJECT(dec->mRtspSrc)) )
+	{
+		dec->mReconnectPending = true;
+		dec->mReconnectEvent.Wake();
+	}
+
+	// the message still gets printed by the bus watch
+	return GST_BUS_PASS;
+}
+
+
+// reconnectThread
+void* gstDecoder::reconnectThread( void* user )
+{
+	gstDecoder* dec = (gstDecoder*)user;
+
+	if( !dec )
+		return NULL;
+
+	const uint64_t interval = dec->mOptions.reconnect * GST_MSECOND;
+	uint64_t lastReconnect = 0;
+
+	while( !dec->mReconnectStop )
+	{
+		dec->mReconnectEvent.Wait((uint64_t)dec->mOptions.reconnect);
+
+		if( dec->mReconnectStop )
+			break;
+
+		const uint64_t now = gst_util_get_timestamp();
+
+		// the stall timer starts over whenever the pipeline isn't running
+		if( !dec->mStreaming )
+		{
+			dec->mReconnectPending = false;
+			dec->mLastPacketTime = now;
+			continue;
+		}
+
+		const bool stalled = (now - dec->mLastPacketTime) >= interval;
+
+		if( !dec->mReconnectPending && !stalled )
+			continue;
+
+		// don't retry faster than the reconnection interval
+		if( now - lastReconnect < interval )
+		{
+			dec->mReconnectEvent.Wait((uint64_t)((interval - (now - lastReconnect)) / GST_MSECOND));
+			
+			if( dec->mReconnectStop )
+				break;
+		}
+
+		if( stalled && !dec->mReconnectPending )
+			LogWarning(LOG_GSTREAMER "gstDecoder -- no RTSP packets received for %ums, reconnecting to %s\n", dec->mOptions.reconnect, dec->mOptions.resource.string.c_str());
+
+		dec->reconnectRTSP();
+		lastReconnect = gst_util_get_timestamp();
+	}
+
+	return NULL;
+}
+
+
+// reconnectRTSP
+void gstDecoder::reconnectRTSP()
+{
+	mReconnectMutex.Lock();
+
+	if( !mStreaming || !mRtspSrc )
+	{
+		mReconnectMutex.Unlock();
+		return;
+	}
+
+	mReconnectPending = false;
+
+	// restart only the source, which removes its old pads and adds new ones once connected
+	gst_element_set_state(mRtspSrc, GST_STATE_NULL);
+
+	if( !gst_element_sync_state_with_parent(mRtspSrc) )
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to restart the RTSP source\n");
+
+	mLastPacketTime = gst_util_get_timestamp();
+	mReconnects++;
+
+	mReconnectMutex.Unlock();
+
+	LogInfo(LOG_GSTREAMER "gstDecoder -- reconnecting RTSP stream %s (attempt %u)\n", mOptions.resource.string.c_str(), mReconnects);
+}
+
+
+// initLaunchStr
+bool gstDecoder::initLaunchStr()
+{
+	if( !gstreamerInit() )
+	{
+		LogError(LOG_GSTREAMER "failed to initialize gstreamer API\n");
+		return false;
+	}
+
+	// first, check that the file exists
+	if( mOptions.resource.protocol == "file" )
+	{
+		if( !fileExists(mOptions.resource.location) )
+		{
+			LogError(LOG_GSTREAMER "gstDecoder -- couldn't find file '%s'\n", mOptions.resource.location.c_str());
+			return false;
+		}
+	}
 	
+	LogInfo(LOG_GSTREAMER "gstDecoder -- creating decoder for %s\n", mOptions.resource.location.c_str());
+
+	// flag if the user wants a specific resolution and framerate
+	if( mOptions.width != 0 || mOptions.height != 0 )
+		mCustomSize = true;
+
+	if( mOptions.frameRate != 0 )
+		mCustomRate = true;
+
+	// discover resource stats
+	if( !discover() )
+	{
+		if( mOptions.resource.protocol == "rtp" || mOptions.resource.protocol == "webrtc" || mOptions.resource.protocol == "packet" )
+		{
+			LogWarning(LOG_GSTREAMER "gstDecoder -- resource discovery not supported for RTP/WebRTC/packet streams\n");	
+
+			if( mOptions.codec == videoOptions::CODEC_UNKNOWN )
+			{
+				LogWarning(LOG_GSTREAMER "gstDecoder -- defaulting to H264 codec (you can change this with the --input-codec option)\n");
+				mOptions.codec = videoOptions::CODEC_H264;
+			}
+		}
+		else
+			LogError(LOG_GSTREAMER "gstDecoder -- resource discovery and auto-negotiation failed\n");
+
+		if( mOptions.codec == videoOptions::CODEC_UNKNOWN )
+		{
+			LogError(LOG_GSTREAMER "gstDecoder -- try manually setting the codec with the --input-codec option\n");
+			return false;
+		}
+	}
+	
+	// remember the size that the pipeline should scale to
+	if( mCustomSize )
+	{
+		mCustomWidth  = mOptions.width;
+		mCustomHeight = mOptions.height;
+	}
+
+	// build pipeline string
+	if( !buildLaunchStr() )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to build pipeline string\n");
+		return false;
+	}
+
 	return true;
 }
 
@@ -343,8 +682,8 @@ static GstDiscovererVideoInfo* findVideoStreamInfo( GstDiscovererStreamInfo* inf
 // discover
 bool gstDecoder::discover()
 {
-	// RTP streams and WebRTC connections can't be discovered
-	if( mOptions.resource.protocol == "rtp" || mOptions.resource.protocol == "webrtc" )
+	// RTP streams, WebRTC connections and packets from the application can't be discovered
+	if( mOptions.resource.protocol == "rtp" || mOptions.resource.protocol == "webrtc" || mOptions.resource.protocol == "packet" )
 		return false;
 
 	// create a new discovery interface
@@ -400,6 +739,12 @@ bool gstDecoder::discover()
 
 	LogVerbose(LOG_GSTREAMER "gstDecoder -- discovered video resolution: %ux%u  (framerate %f Hz)\n", width, height, framerate);
 	
+	// when only the width or height was requested, keep the aspect ratio (rounded to even for NV12)
+	if( mCustomSize && mOptions.width == 0 )
+		mOptions.width = ((uint64_t(mOptions.height) * width / height) + 1) & ~1u;
+	else if( mCustomSize && mOptions.height == 0 )
+		mOptions.height = ((uint64_t(mOptions.width) * height / width) + 1) & ~1u;
+
 	// disable re-scaling if the user's custom size matches the feed's
 	if( mCustomSize && mOptions.width == width && mOptions.height == height )
 		mCustomSize = false;
@@ -475,6 +820,38 @@ bool gstDecoder::discover()
 }
 
 
+// demuxerFromExtension (returns NULL for elementary streams or unsupported containers)
+static const char* demuxerFromExtension( const std::string& ext )
+{
+	if( ext == "mkv" || ext == "webm" )
+		return "matroskademux";
+	else if( ext == "mp4" || ext == "qt" || ext == "mov" )
+		return "qtdemux";
+	else if( ext == "flv" )
+		return "flvdemux";
+	else if( ext == "avi" )
+		return "avidemux";
+
+	return NULL;
+}
+
+
+// parserFromCodec (returns NULL if the codec doesn't need a parser after the demuxer)
+static const char* parserFromCodec( videoOptions::Codec codec )
+{
+	if( codec == videoOptions::CODEC_H264 )
+		return "h264parse";
+	else if( codec == videoOptions::CODEC_H265 )
+		return "h265parse";
+	else if( codec == videoOptions::CODEC_MPEG2 )
+		return "mpegvideoparse";
+	else if( codec == videoOptions::CODEC_MPEG4 )
+		return "mpeg4videoparse";
+
+	return NULL;
+}
+
+
 // buildLaunchStr
 bool gstDecoder::buildLaunchStr()
 {
@@ -487,14 +864,10 @@ bool gstDecoder::buildLaunchStr()
 	{
 		ss << "filesrc location=" << mOptions.resource.location << " ! ";
 
-		if( uri.extension == "mkv" || uri.extension == "webm" )
-			ss << "matroskademux ! ";
-		else if( uri.extension == "mp4" || uri.extension == "qt" || uri.extension == "mov" )
-			ss << "qtdemux ! ";
-		else if( uri.extension == "flv" )
-			ss << "flvdemux ! ";
-		else if( uri.extension == "avi" )
-			ss << "avidemux ! ";
+		const char* demuxer = demuxerFromExtension(uri.extension);
+
+		if( demuxer != NULL )
+			ss << demuxer << " ! ";
 		else if( uri.extension != "h264" && uri.extension != "h265" )
 		{
 			LogError(LOG_GSTREAMER "gstDecoder -- unsupported video file extension (%s)\n", uri.extension.c_str());
@@ -510,14 +883,10 @@ bool gstDecoder::buildLaunchStr()
 
 		ss << "queue ! ";
 		
-		if( mOptions.codec == videoOptions::CODEC_H264 )
-			ss << "h264parse ! ";
-		else if( mOptions.codec == videoOptions::CODEC_H265 )
-			ss << "h265parse ! ";
-		else if( mOptions.codec == videoOptions::CODEC_MPEG2 )
-			ss << "mpegvideoparse ! ";
-		else if( mOptions.codec == videoOptions::CODEC_MPEG4 )
-			ss << "mpeg4videoparse ! ";
+		const char* parser = parserFromCodec(mOptions.codec);
+
+		if( parser != NULL )
+			ss << parser << " ! ";
 
 		mOptions.deviceType = videoOptions::DEVICE_FILE;
 	}
@@ -555,9 +924,19 @@ bool gstDecoder::buildLaunchStr()
 	{
 		if( uri.protocol == "rtsp" )
 		{
-			ss << "rtspsrc location=" << uri.string;
+			ss << "rtspsrc name=" << mSinkName << "_rtspsrc location=" << uri.string;
 			ss << " latency=" << mOptions.latency;
-			ss << " ! queue ! ";
+
+			if( mOptions.transport == videoOptions::TRANSPORT_UDP )
+				ss << " protocols=udp";
+			else if( mOptions.transport == videoOptions::TRANSPORT_TCP )
+				ss << " protocols=tcp";
+
+			if( mOptions.lowLatency )
+				ss << " drop-on-latency=true";
+
+			// the source pads get linked to the queue in onRtspPad()
+			ss << " queue name=" << mSinkName << "_rtspqueue ! ";
 		}
 		else
 		{
@@ -579,7 +958,29 @@ bool gstDecoder::buildLaunchStr()
 		else if( mOptions.codec == videoOptions::CODEC_MPEG4 )
 			ss << "rtpmp4vdepay ! ";	// rtpmp4gdepay
 		else if( mOptions.codec == videoOptions::CODEC_MJPEG )
-			ss << "rtpjpegdepay ! ";
+			ss << "rtpjpegdepay ! ";
+
+		mOptions.deviceType = videoOptions::DEVICE_IP;
+	}
+	else if( uri.protocol == "packet" )
+	{
+		ss << "appsrc name=" << mSinkName << "_packetsrc is-live=true format=time caps=\"";
+
+		if( mOptions.codec == videoOptions::CODEC_H264 )
+			ss << "video/x-h264,stream-format=(string)byte-stream\" ! h264parse ! ";
+		else if( mOptions.codec == videoOptions::CODEC_H265 )
+			ss << "video/x-h265,stream-format=(string)byte-stream\" ! h265parse ! ";
+		else if( mOptions.codec == videoOptions::CODEC_VP8 )
+			ss << "video/x-vp8\" ! ";
+		else if( mOptions.codec == videoOptions::CODEC_VP9 )
+			ss << "video/x-vp9\" ! ";
+		else if( mOptions.codec == videoOptions::CODEC_MJPEG )
+			ss << "image/jpeg\" ! jpegparse ! ";
+		else
+		{
+			LogError(LOG_GSTREAMER "gstDecoder -- packet:// streams only support h264, h265, vp8, vp9 and mjpeg (not %s)\n", videoOptions::CodecToStr(mOptions.codec));
+			return false;
+		}
 
 		mOptions.deviceType = videoOptions::DEVICE_IP;
 	}
@@ -590,6 +991,8 @@ bool gstDecoder::buildLaunchStr()
 		LogError(LOG_GSTREAMER "                 * file://\n");
 		LogError(LOG_GSTREAMER "                 * rtp://\n");
 		LogError(LOG_GSTREAMER "                 * rtsp://\n");
+		LogError(LOG_GSTREAMER "                 * webrtc://\n");
+		LogError(LOG_GSTREAMER "                 * packet://\n");
 
 		return false;
 	}
@@ -598,7 +1001,7 @@ bool gstDecoder::buildLaunchStr()
 	{
 		ss << "tee name=savetee savetee. ! queue ! ";
 		
-		if( !gst_build_filesink(mOptions.save, mOptions.codec, ss) )
+		if( !gst_build_filesink(mOptions.save, mOptions.codec, ss, mOptions.segmentTime, mOptions.segmentSize) )
 			return false;
 
 		ss << "savetee. ! queue ! ";
@@ -650,7 +1053,7 @@ bool gstDecoder::buildLaunchStr()
 		if( mOptions.flipMethod != videoOptions::FLIP_NONE )
 			ss << "videoflip method=" << videoOptions::FlipMethodToStr(mOptions.flipMethod) << " ! ";
 		
-		if( mOptions.width != 0 && mOptions.height != 0 )
+		if( mCustomSize )
 			ss << "videoscale ! ";
 		
 		ss << "video/x-raw";
@@ -660,8 +1063,17 @@ bool gstDecoder::buildLaunchStr()
 		ss << "(" << GST_CAPS_FEATURE_MEMORY_NVMM << ")";
 	#endif
 	
-		if( mOptions.width != 0 && mOptions.height != 0 )
-			ss << ", width=(int)" << mOptions.width << ", height=(int)" << mOptions.height << ", format=(string)NV12";
+		// the scaling happens here on the VIC (or videoscale), so that full-size frames never
+		// leave the decoder's memory - if only one dimension is known (i.e. RTP streams that
+		// couldn't be discovered), the other one gets fixated by the caps negotiation
+		if( mOptions.width != 0 )
+			ss << ", width=(int)" << mOptions.width;
+
+		if( mOptions.height != 0 )
+			ss << ", height=(int)" << mOptions.height;
+
+		if( mOptions.width != 0 || mOptions.height != 0 )
+			ss << ", format=(string)NV12";
 
 		ss <<" ! ";
 	}
@@ -687,7 +1099,7 @@ bool gstDecoder::buildLaunchStr()
 		ss << "videorate drop-only=true max-rate=" << (int)mOptions.frameRate << " ! ";
 
 	// add the app sink
-	ss << "appsink name=mysink"; // wait-on-eos=false;
+	gst_build_appsink(mOptions, ss, mSinkName.c_str()); // wait-on-eos=false;
 
 	mLaunchStr = ss.str();
 
@@ -699,6 +1111,291 @@ bool gstDecoder::buildLaunchStr()
 
 
 
+// buildIndex
+bool gstDecoder::buildIndex()
+{
+	// demux and parse the file without decoding it, recording the timestamps from the parser
+	std::ostringstream ss;
+
+	const char* demuxer = demuxerFromExtension(mOptions.resource.extension);
+	const char* parser  = parserFromCodec(mOptions.codec);
+
+	ss << "filesrc location=" << mOptions.resource.location << " ! ";
+
+	if( demuxer != NULL )
+		ss << demuxer << " ! ";
+
+	if( parser != NULL )
+		ss << parser << " ! ";
+
+	ss << "fakesink name=indexsink sync=false";
+
+	GError* err = NULL;
+	GstElement* pipeline = gst_parse_launch(ss.str().c_str(), &err);
+
+	if( err != NULL )
+	{
+		LogWarning(LOG_GSTREAMER "gstDecoder -- failed to create the pipeline for indexing %s\n", mOptions.resource.location.c_str());
+		LogWarning(LOG_GSTREAMER "   (%s)\n", err->message);
+		g_error_free(err);
+
+		if( pipeline != NULL )
+			gst_object_unref(pipeline);
+
+		return false;
+	}
+
+	GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "indexsink");
+	GstPad* pad = (sink != NULL) ? gst_element_get_static_pad(sink, "sink") : NULL;
+
+	if( !pad )
+	{
+		LogWarning(LOG_GSTREAMER "gstDecoder -- failed to retrieve the sink pad of the indexing pipeline\n");
+
+		if( sink != NULL )
+			gst_object_unref(sink);
+
+		gst_object_unref(pipeline);
+		return false;
+	}
+
+	gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, onIndexBuffer, this, NULL);
+
+	gst_object_unref(pad);
+	gst_object_unref(sink);
+
+	// run the pipeline until EOS (or until the decoder gets destroyed)
+	GstBus* bus = gst_element_get_bus(pipeline);
+	bool eos = false;
+
+	gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+	while( !mIndexStop )
+	{
+		GstMessage* msg = gst_bus_timed_pop_filtered(bus, 100 * GST_MSECOND, (GstMessageType)(GST_MESSAGE_EOS|GST_MESSAGE_ERROR));
+
+		if( !msg )
+			continue;
+
+		eos = (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS);
+
+		if( !eos )
+			gst_message_print(bus, msg, this);
+
+		gst_message_unref(msg);
+		break;
+	}
+
+	gst_element_set_state(pipeline, GST_STATE_NULL);
+
+	gst_object_unref(bus);
+	gst_object_unref(pipeline);
+
+	mIndexMutex.Lock();
+
+	if( eos )
+	{
+		// the parser outputs in decode order, so sort them into presentation order
+		std::sort(mFrameIndex.begin(), mFrameIndex.end());
+		std::sort(mKeyframeIndex.begin(), mKeyframeIndex.end());
+	}
+
+	const bool indexed = eos && mKeyframeIndex.size() > 0;
+
+	if( !indexed )
+	{
+		mFrameIndex.clear();
+		mKeyframeIndex.clear();
+	}
+
+	mIndexReady = indexed;
+	mIndexMutex.Unlock();
+
+	if( !indexed )
+	{
+		if( !mIndexStop )
+			LogWarning(LOG_GSTREAMER "gstDecoder -- failed to index %s (seeking will use the demuxer's keyframes)\n", mOptions.resource.location.c_str());
+
+		return false;
+	}
+
+	LogVerbose(LOG_GSTREAMER "gstDecoder -- indexed %zu frames (%zu keyframes) in %s\n", mFrameIndex.size(), mKeyframeIndex.size(), mOptions.resource.location.c_str());
+	return true;
+}
+
+
+// indexThread
+void* gstDecoder::indexThread( void* user )
+{
+	gstDecoder* dec = (gstDecoder*)user;
+
+	if( dec != NULL )
+		dec->buildIndex();
+
+	return NULL;
+}
+
+
+// onIndexBuffer
+GstPadProbeReturn gstDecoder::onIndexBuffer( GstPad* pad, GstPadProbeInfo* info, void* user_data )
+{
+	gstDecoder* dec = (gstDecoder*)user_data;
+	GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+
+	if( !dec || !buffer || !GST_BUFFER_PTS_IS_VALID(buffer) )
+		return GST_PAD_PROBE_OK;
+
+	const uint64_t timestamp = GST_BUFFER_PTS(buffer);
+
+	dec->mFrameIndex.push_back(timestamp);
+
+	if( !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT) )
+		dec->mKeyframeIndex.push_back(timestamp);
+
+	return GST_PAD_PROBE_OK;
+}
+
+
+// Seek
+bool gstDecoder::Seek( uint64_t timestamp, bool accurate )
+{
+	if( mOptions.deviceType != videoOptions::DEVICE_FILE || !mPipeline )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder::Seek() -- seeking is only supported for video files\n");
+		return false;
+	}
+
+	// the pipeline needs to be running to seek (after EOS, it still is)
+	if( !mStreaming && !mEOS )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	// the index doesn't change after it's published
+	mIndexMutex.Lock();
+	const bool indexed = mIndexReady;
+	mIndexMutex.Unlock();
+
+	uint64_t target = timestamp;
+	int flags = GST_SEEK_FLAG_FLUSH;
+
+	if( accurate )
+	{
+		// decode from the previous keyframe, dropping the frames before the timestamp
+		flags |= GST_SEEK_FLAG_ACCURATE;
+	}
+	else if( indexed )
+	{
+		// go directly to the keyframe at or before the timestamp
+		std::vector<uint64_t>::const_iterator keyframe = std::upper_bound(mKeyframeIndex.begin(), mKeyframeIndex.end(), timestamp);
+
+		if( keyframe != mKeyframeIndex.begin() )
+			keyframe--;
+
+		target = *keyframe;
+		flags |= GST_SEEK_FLAG_ACCURATE;
+	}
+	else
+	{
+		flags |= GST_SEEK_FLAG_KEY_UNIT | GST_SEEK_FLAG_SNAP_BEFORE;
+	}
+
+	const bool seek = gst_element_seek(mPipeline, 1.0, GST_FORMAT_TIME, (GstSeekFlags)flags,
+							     GST_SEEK_TYPE_SET, target,
+							     GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
+
+	if( !seek )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder::Seek() -- failed to seek stream to %.3f seconds\n", target * 0.000000001);
+		return false;
+	}
+
+	LogVerbose(LOG_GSTREAMER "gstDecoder -- seeked stream to %.3f seconds (%s)\n", target * 0.000000001, accurate ? "accurate" : "keyframe");
+
+	// don't return any frames from before the seek
+	mBufferManager->Flush();
+
+	mEOS = false;
+	mStreaming = true;
+
+	return true;
+}
+
+
+// SeekFrame
+bool gstDecoder::SeekFrame( uint64_t frame, bool accurate )
+{
+	uint64_t timestamp = 0;
+
+	mIndexMutex.Lock();
+	const bool indexed = mIndexReady;
+	mIndexMutex.Unlock();
+
+	if( indexed )
+	{
+		if( frame >= mFrameIndex.size() )
+		{
+			LogError(LOG_GSTREAMER "gstDecoder::SeekFrame() -- frame %lu is out of range (the video has %zu frames)\n", frame, mFrameIndex.size());
+			return false;
+		}
+
+		timestamp = mFrameIndex[frame];
+	}
+	else
+	{
+		if( mOptions.frameRate <= 0.0f )
+		{
+			LogError(LOG_GSTREAMER "gstDecoder::SeekFrame() -- the framerate of the video is unknown\n");
+			return false;
+		}
+
+		timestamp = (uint64_t)(frame * (1000000000.0 / mOptions.frameRate));
+	}
+
+	return Seek(timestamp, accurate);
+}
+
+
+// seekSegment
+bool gstDecoder::seekSegment( uint64_t start, uint64_t stop )
+{
+	if( mOptions.deviceType != videoOptions::DEVICE_FILE || !mPipeline )
+		return false;
+
+	// preroll the pipeline paused, so it doesn't start playing from the beginning of the file
+	if( !mStreaming && !mEOS )
+	{
+		if( gst_element_set_state(mPipeline, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE )
+		{
+			LogError(LOG_GSTREAMER "gstDecoder -- failed to set pipeline state to PAUSED\n");
+			return false;
+		}
+
+		gst_wait_state(mPipeline, NULL, GST_OPEN_TIMEOUT, this);
+	}
+
+	// the start should be a keyframe, and the pipeline sends EOS once it reaches the stop
+	const bool seek = gst_element_seek(mPipeline, 1.0, GST_FORMAT_TIME,
+							     (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE),
+							     GST_SEEK_TYPE_SET, start,
+							     (stop != GST_CLOCK_TIME_NONE) ? GST_SEEK_TYPE_SET : GST_SEEK_TYPE_NONE, stop);
+
+	if( !seek )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to seek stream to the segment at %.3f seconds\n", start * 0.000000001);
+		return false;
+	}
+
+	mBufferManager->Flush();
+
+	mEOS = false;
+	mStreaming = false;
+
+	return Open();
+}
+
+
 // onEOS
 void gstDecoder::onEOS( _GstAppSink* sink, void* user_data )
 {
@@ -738,7 +1435,6 @@ GstFlowReturn gstDecoder::onPreroll( _GstAppSink* sink, void* user_data )
 	gst_sample_unref(gstSample);
 #endif
 
-	dec->checkMsgBus();
 	return GST_FLOW_OK;
 }
 
@@ -754,7 +1450,6 @@ GstFlowReturn gstDecoder::onBuffer( _GstAppSink* sink, void* user_data )
 	gstDecoder* dec = (gstDecoder*)user_data;
 	
 	dec->checkBuffer();
-	dec->checkMsgBus();
 	
 	return GST_FLOW_OK;
 }
@@ -818,21 +1513,90 @@ void gstDecoder::checkBuffer()
 	}
 #endif
 	
+	// the base time maps the buffer's PTS to when it was captured
+	const uint64_t baseTime = gst_monotonic_base_time(GST_ELEMENT(mAppSink));
+
 	// enqueue the buffer for color conversion
-	if( !mBufferManager->Enqueue(gstBuffer, gstCaps) )
+#if GST_CHECK_VERSION(1,0,0)
+	if( !mBufferManager->Enqueue(gstBuffer, gstCaps, baseTime, gst_sample_get_segment(gstSample)) )
+#else
+	if( !mBufferManager->Enqueue(gstBuffer, gstCaps, baseTime) )
+#endif
 	{
 		LogError(LOG_GSTREAMER "gstDecoder -- failed to handle incoming buffer\n");
 		release_return;
 	}
+
+	// confirm that the frames were scaled by the pipeline (the buffer manager adopts the size of the caps)
+	if( mBufferManager->GetFrameCount() == 1 && mCustomSize && mCustomWidth != 0 && mCustomHeight != 0
+	    && (mOptions.width != mCustomWidth || mOptions.height != mCustomHeight) )
+	{
+		LogWarning(LOG_GSTREAMER "gstDecoder -- the pipeline output %ux%u frames instead of the requested %ux%u\n", mOptions.width, mOptions.height, mCustomWidth, mCustomHeight);
+	}
 	
 	mOptions.frameCount++;
+
+	// push the frame to the callback (before the sample gets released)
+	if( mCallback != NULL )
+		deliverFrame();
+
 	release_return;
 }
 
 
+// deliverFrame
+void gstDecoder::deliverFrame()
+{
+	void* image = NULL;
+
+	// the frame was just enqueued, so this returns without waiting
+	if( !mBufferManager->Dequeue(&image, mCallbackFormat, 0) )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to convert frame for the callback\n");
+		return;
+	}
+
+	mLastTimestamp = mBufferManager->GetLastTimestamp();
+	mLastCaptureTime = mBufferManager->GetLastTimestamps().capture;
+	mRawFormat = mBufferManager->GetRawFormat();
+
+	stampCapture(image, mCallbackFormat);
+
+	// the appsink thread is blocked until the callback returns, so no
+	// new frames can overwrite this one while the callback is using it
+	mCallback(this, image, GetWidth(), GetHeight(), (mCallbackFormat != IMAGE_UNKNOWN) ? mCallbackFormat : mRawFormat, mLastTimestamp, mCallbackUser);
+}
+
+
+// Convert
+bool gstDecoder::Convert( void** output, imageFormat format )
+{
+	if( !mBufferManager->Convert(output, format) )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to convert frame to %s\n", imageFormatToStr(format));
+		return false;
+	}
+
+	return true;
+}
+
+
+// SetCallback
+bool gstDecoder::SetCallback( videoSourceCallback callback, imageFormat format, void* user )
+{
+	mCallbackFormat = format;
+	mCallbackUser   = user;
+	mCallback       = callback;
+
+	return true;
+}
+
+
 // Capture
 bool gstDecoder::Capture( void** output, imageFormat format, uint64_t timeout )
 {
+	NVTX_RANGE_FMT("gstDecoder::Capture (%s)", mOptions.resource.string.c_str());
+
 	// update the webrtc server if needed
 	if( mWebRTCServer != NULL && !mWebRTCServer->IsThreaded() )
 		mWebRTCServer->ProcessRequests();
@@ -841,6 +1605,13 @@ bool gstDecoder::Capture( void** output, imageFormat format, uint64_t timeout )
 	if( !output )
 		return false;
 
+	// the appsink thread is already dequeueing the frames for the callback
+	if( mCallback != NULL )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- Capture() can't be used while a frame callback is set\n");
+		return false;
+	}
+
 	// confirm the stream is open
 	if( !mStreaming || mEOS )
 	{
@@ -856,8 +1627,10 @@ bool gstDecoder::Capture( void** output, imageFormat format, uint64_t timeout )
 	}
 	
 	mLastTimestamp = mBufferManager->GetLastTimestamp();
+	mLastCaptureTime = mBufferManager->GetLastTimestamps().capture;
 	mRawFormat = mBufferManager->GetRawFormat();
 	
+	stampCapture(*output, format);
 	return true;
 }
 
@@ -878,6 +1651,76 @@ static void queryPipelineState( GstElement* pipeline )
 }
 #endif
 
+// Push
+bool gstDecoder::Push( const void* data, size_t size, uint64_t pts )
+{
+	if( !mPacketSrc )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- Push() is only supported for packet:// streams (%s)\n", mOptions.resource.string.c_str());
+		return false;
+	}
+
+	if( !data || size == 0 )
+		return false;
+
+	// the first packet starts the pipeline
+	if( !mStreaming )
+	{
+		mPacketMutex.Lock();
+		const bool opened = Open();
+		mPacketMutex.Unlock();
+
+		if( !opened )
+			return false;
+	}
+
+	GstBuffer* gstBuffer = gst_buffer_new_allocate(NULL, size, NULL);
+
+	if( !gstBuffer )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to allocate a %zu byte buffer for a packet\n", size);
+		return false;
+	}
+
+	gst_buffer_fill(gstBuffer, 0, data, size);
+
+	// otherwise timestamp it with the running time of the pipeline
+	if( pts == GST_CLOCK_TIME_NONE )
+	{
+		GstClock* clock = gst_element_get_clock(mPipeline);
+
+		if( clock != NULL )
+		{
+			pts = gst_clock_get_time(clock) - gst_element_get_base_time(mPipeline);
+			gst_object_unref(clock);
+		}
+	}
+
+	GST_BUFFER_PTS(gstBuffer) = pts;
+
+	// appsrc takes ownership of the buffer
+	const GstFlowReturn result = gst_app_src_push_buffer(GST_APP_SRC(mPacketSrc), gstBuffer);
+
+	if( result != GST_FLOW_OK )
+	{
+		LogError(LOG_GSTREAMER "gstDecoder -- failed to push packet into the pipeline (%s)\n", gst_flow_get_name(result));
+		return false;
+	}
+
+	return true;
+}
+
+
+// EndOfStream
+bool gstDecoder::EndOfStream()
+{
+	if( !mPacketSrc )
+		return false;
+
+	return gst_app_src_end_of_stream(GST_APP_SRC(mPacketSrc)) == GST_FLOW_OK;
+}
+
+
 // Open
 bool gstDecoder::Open()
 {
@@ -914,6 +1757,15 @@ bool gstDecoder::Open()
 	if( mStreaming || (mWebRTCServer != NULL && !mWebRTCConnected) )  // with WebRTC, don't start the pipeline until peer connected
 		return true;
 
+	// index the frames of video files for seeking (the first time they're opened)
+	if( mOptions.deviceType == videoOptions::DEVICE_FILE && !mIndexThread && !mIndexReady )
+	{
+		mIndexThread = new Thread();
+
+		if( !mIndexThread->Start(indexThread, this) )
+			LogWarning(LOG_GSTREAMER "gstDecoder -- failed to start the thread for indexing %s\n", mOptions.resource.location.c_str());
+	}
+
 	// transition pipline to STATE_PLAYING
 	LogInfo(LOG_GSTREAMER "opening gstDecoder for streaming, transitioning pipeline to GST_STATE_PLAYING\n");
 	
@@ -940,9 +1792,7 @@ bool gstDecoder::Open()
 		return false;
 	}
 
-	checkMsgBus();
-	usleep(100 * 1000);
-	checkMsgBus();
+	gst_wait_state(mPipeline, NULL, GST_OPEN_TIMEOUT, this);	// the messages go to mBusWatch
 
 	mStreaming = true;
 	return true;
@@ -958,34 +1808,18 @@ void gstDecoder::Close()
 	// stop pipeline
 	LogInfo(LOG_GSTREAMER "gstDecoder -- stopping pipeline, transitioning to GST_STATE_NULL\n");
 
+	mReconnectMutex.Lock();
 	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_NULL);
+	mReconnectMutex.Unlock();
 
 	if( result != GST_STATE_CHANGE_SUCCESS )
 		LogError(LOG_GSTREAMER "gstDecoder -- failed to stop pipeline (error %u)\n", result);
 
-	usleep(250*1000);
-	checkMsgBus();
 	mStreaming = false;
 	LogInfo(LOG_GSTREAMER "gstDecoder -- pipeline stopped\n");
 }
 
 
-// checkMsgBus
-void gstDecoder::checkMsgBus()
-{
-	while(true)
-	{
-		GstMessage* msg = gst_bus_pop(mBus);
-
-		if( !msg )
-			break;
-
-		gst_message_print(mBus, msg, this);
-		gst_message_unref(msg);
-	}
-}
-
-
 // onWebsocketMessage (WebRTC)
 void gstDecoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size_t message_size, void* user_data )
 {
@@ -25,9 +25,16 @@
 
 #include "gstUtility.h"
 #include "gstBufferManager.h"
+#include "gstBusWatch.h"
 
 #include "videoSource.h"
 
+#include "Thread.h"
+#include "Mutex.h"
+
+#include <atomic>
+#include <vector>
+
 
 // Forward declarations
 class WebRTCServer;
@@ -42,6 +49,16 @@ struct _GstAppSink;
  * and RTP/RTSP network streams over UDP/IP. The supported decoder codecs
  * are H.264, H.265, VP8, VP9, MPEG-2, MPEG-4, and MJPEG.
  *
+ * RTSP streams can be received over UDP or TCP (videoOptions::transport), and
+ * reconnected after errors or stalls by restarting only the rtspsrc element
+ * (videoOptions::reconnect), so the decoder and the NVMM buffers it outputs
+ * (when built with ENABLE_NVMM) stay allocated across camera dropouts.
+ *
+ * With the `packet://` protocol, the application pushes the compressed stream itself
+ * (see Push()), for example after recieving it over its own network transport.
+ * The packets go through an appsrc into the hardware decoder, and the decoded frames
+ * are captured like any other stream.  The codec needs to be set (--input-codec).
+ *
  * @note gstDecoder implements the videoSource interface and is intended to
  * be used through that as opposed to directly.  videoSource implements
  * additional command-line parsing of videoOptions to construct instances.
@@ -51,6 +68,9 @@ struct _GstAppSink;
  */
 class gstDecoder : public videoSource
 {
+	friend class gstMultiDecoder;
+	friend class gstSegmentDecoder;
+
 public:
 	/**
 	 * Create a decoder from the provided video options.
@@ -79,6 +99,36 @@ public:
 	 */
 	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=UINT64_MAX );
 
+	/**
+	 * Push the frames to a callback from the appsink thread.
+	 * @see videoSource::SetCallback()
+	 */
+	virtual bool SetCallback( videoSourceCallback callback, imageFormat format=IMAGE_RGB8, void* user=NULL );
+
+	/**
+	 * Convert the last captured frame into another format on first access.
+	 * @see videoSource::Convert()
+	 */
+	virtual bool Convert( void** image, imageFormat format );
+
+	/**
+	 * Return all the timestamps of the last captured frame, including its PTS/DTS,
+	 * the sensor timestamp (if the source attached one), and the capture time.
+	 */
+	inline const gstFrameTimestamp& GetLastTimestamps() const	{ return mBufferManager->GetLastTimestamps(); }
+
+	/**
+	 * Get a file descriptor that becomes readable when a new frame can be captured.
+	 * @see videoSource::GetEventFD()
+	 */
+	virtual int GetEventFD()							{ return mBufferManager->GetEventFD(); }
+
+	/**
+	 * Get the statistics of the frames that were recieved and captured.
+	 * @see videoSource::GetStats()
+	 */
+	virtual bool GetStats( videoSourceStats* stats ) const	{ mBufferManager->GetStats(stats); return true; }
+
 	/**
 	 * Open the stream.
 	 * @see videoSource::Open()
@@ -100,6 +150,64 @@ public:
 	 */
 	inline bool IsEOS() const				{ return mEOS; }
 
+	/**
+	 * Seek a video file to the specified timestamp (in nanoseconds).
+	 *
+	 * By default, the stream seeks to the keyframe at or before the timestamp, which is the
+	 * fastest because only that keyframe has to be decoded.  With `accurate=true`, the decoder
+	 * starts from that keyframe and drops the frames before the timestamp.  Either way, the next
+	 * frame returned by Capture() is from the new position.  Seeking also clears the EOS state.
+	 *
+	 * The first Open() of a video file builds an index of its frames in the background, by
+	 * demuxing the file without decoding it.  Once that's done (see IsIndexed()), seeks go straight
+	 * to the exact keyframe, and SeekFrame() maps frame numbers to their timestamps (including with
+	 * variable framerates).  Until then, GStreamer's own keyframe seeking is used instead.
+	 *
+	 * @note seeking is only supported for video files (not RTP/RTSP/WebRTC streams).
+	 * @returns true if the seek succeeded, otherwise false.
+	 */
+	bool Seek( uint64_t timestamp, bool accurate=false );
+
+	/**
+	 * Seek a video file to the specified frame number (starting from 0).
+	 * If the frame index isn't ready yet, the timestamp is estimated from the framerate.
+	 * @see Seek() for more information.
+	 */
+	bool SeekFrame( uint64_t frame, bool accurate=false );
+
+	/**
+	 * Returns true once the frame index of the video file has been built (see Seek())
+	 */
+	inline bool IsIndexed() const				{ return mIndexReady; }
+
+	/**
+	 * Get the number of frames in the video file, or 0 if it hasn't been indexed yet.
+	 */
+	inline uint64_t GetIndexedFrames() const		{ return mIndexReady ? mFrameIndex.size() : 0; }
+
+	/**
+	 * Get the number of times that an RTSP stream has been reconnected (see videoOptions::reconnect)
+	 */
+	inline uint32_t GetReconnects() const			{ return mReconnects; }
+
+	/**
+	 * Push compressed data into the decoder of a `packet://` stream.  H.264/H.265 should be
+	 * Annex-B byte-stream, preferably one access unit per call (a parser re-frames it anyway),
+	 * and MJPEG should be one JPEG image per call.  The data gets copied, so it can be
+	 * reused as soon as this returns.  The stream gets opened by the first packet.
+	 *
+	 * @param pts the presentation timestamp (in nanoseconds of running time), or GST_CLOCK_TIME_NONE
+	 *            for the packet to be timestamped with the pipeline's clock when it's pushed.
+	 * @returns true if the packet was queued, or false on error (or if it isn't a packet:// stream)
+	 */
+	bool Push( const void* data, size_t size, uint64_t pts=GST_CLOCK_TIME_NONE );
+
+	/**
+	 * Signal the end of a `packet://` stream, after the last packet has been pushed.
+	 * Once the frames that were queued are decoded, IsEOS() returns true.
+	 */
+	bool EndOfStream();
+
 	/**
 	 * Return the interface type (gstDecoder::Type)
 	 */
@@ -133,12 +241,25 @@ public:
 protected:
 	gstDecoder( const videoOptions& options );
 	
-	void checkMsgBus();
 	void checkBuffer();
+	void deliverFrame();
 	bool buildLaunchStr();
 	
 	bool init();
+	bool initLaunchStr();
 	bool discover();
+
+	bool buildIndex();
+	bool seekSegment( uint64_t start, uint64_t stop );
+	static void* indexThread( void* user );
+	static GstPadProbeReturn onIndexBuffer( GstPad* pad, GstPadProbeInfo* info, void* user_data );
+
+	bool initRTSP( GstElement* pipeline );
+	void reconnectRTSP();
+	static void* reconnectThread( void* user );
+	static void onRtspPad( GstElement* src, GstPad* pad, void* user_data );
+	static GstPadProbeReturn onRtspProbe( GstPad* pad, GstPadProbeInfo* info, void* user_data );
+	static GstBusSyncReply onBusMessage( GstBus* bus, GstMessage* msg, void* user_data );
 	
 	inline bool isLooping() const { return (mOptions.loop < 0) || ((mOptions.loop > 0) && (mLoopCount < mOptions.loop)); }
 
@@ -152,17 +273,43 @@ protected:
 	static void onWebsocketMessage( WebRTCPeer* peer, const char* message, size_t message_size, void* user_data );
 
 	GstBus*      mBus;
+	gstBusWatch* mBusWatch;
 	GstElement*  mPipeline;
 	_GstAppSink* mAppSink;
 	
 	Event	  mWaitEvent;
 	std::string mLaunchStr;
+	std::string mSinkName;
 	bool        mCustomSize;
 	bool		  mCustomRate;
+	uint32_t    mCustomWidth;	// the size that the pipeline scales to (if mCustomSize is set)
+	uint32_t    mCustomHeight;
 	bool        mEOS;
 	size_t	  mLoopCount;
 		
 	gstBufferManager* mBufferManager;
+
+	Thread*       mIndexThread;
+	Mutex         mIndexMutex;
+	volatile bool mIndexReady;
+	volatile bool mIndexStop;
+
+	std::vector<uint64_t> mFrameIndex;	// presentation timestamps of every frame (sorted)
+	std::vector<uint64_t> mKeyframeIndex;	// presentation timestamps of the keyframes (sorted)
+
+	GstElement*   mPacketSrc;		// appsrc of packet:// streams
+	Mutex         mPacketMutex;	// serializes opening the stream from Push()
+
+	GstElement*   mRtspSrc;
+	GstElement*   mRtspQueue;
+	Thread*       mReconnectThread;
+	Event         mReconnectEvent;
+	Mutex         mReconnectMutex;	// serializes restarting the source with Close()
+	volatile bool mReconnectPending;
+	volatile bool mReconnectStop;
+	uint32_t      mReconnects;
+
+	std::atomic<uint64_t> mLastPacketTime;	// when the last RTP packet was received
 	
 	WebRTCServer* mWebRTCServer;
 	bool mWebRTCConnected;
@@ -29,13 +29,27 @@
 #include "filesystem.h"
 #include "timespec.h"
 #include "logging.h"
+#include "profiler.h"
+#include "cudaNVTX.h"
 
 #include "cudaColorspace.h"
+#include "cudaResize.h"
+#include "cudaDevice.h"
+#include "cudaYUV.h"
 
 #define GST_USE_UNSTABLE_API
 #include <gst/webrtc/webrtc.h>
 #include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+#include <gst/video/gstvideometa.h>
 
+#ifdef ENABLE_NVMM
+#include <nvbuf_utils.h>
+#include <cuda_egl_interop.h>
+#endif
+
+#include <algorithm>
 #include <sstream>
 #include <string.h>
 #include <strings.h>
@@ -73,24 +87,67 @@ bool gstEncoder::IsSupportedExtension( const char* ext )
 gstEncoder::gstEncoder( const videoOptions& options ) : videoOutput(options)
 {	
 	mAppSrc       = NULL;
-	mBus          = NULL;
+	mBusWatch     = NULL;
 	mBufferCaps   = NULL;
 	mPipeline     = NULL;
+	mTimestamp    = 0;
 	mRTSPServer   = NULL;
 	mWebRTCServer = NULL;
+	mPacketSink   = NULL;
+	mPacketCallback = NULL;
+	mPacketUserData = NULL;
 	mNeedData     = false;
+	mBackpressure = DROP_NEWEST;
+	mBackpressureTimeout = 1000;
+	mStream       = NULL;
+	mBufferEvent  = NULL;
+	mPeerBuffer   = NULL;
+	mPeerSize     = 0;
+	mFormatYUV    = IMAGE_I420;
+	mNvmmUsed     = false;
+	mBitrateMax   = mOptions.bitRate;
+
+#if defined(GST_CODECS_V4L2) && GST_CHECK_VERSION(1,0,0)
+	// the V4L2 encoders consume NV12 natively, so convert to it directly
+	// on the GPU and skip the I420->NV12 conversion inside nvvidconv
+	// (unless the VIC converter is used, then nvvidconv gets RGBA and converts it)
+	if( mOptions.codec != videoOptions::CODEC_MJPEG )
+		mFormatYUV = (mOptions.converter == videoOptions::CONVERTER_VIC) ? IMAGE_RGBA8 : IMAGE_NV12;
+#endif
+
+#if defined(ENABLE_NVMM) && defined(GST_CODECS_OMX)
+	// convert directly into NVMM buffers for the OMX hardware encoders
+	if( mOptions.codec != videoOptions::CODEC_MJPEG )
+	{
+		mFormatYUV = IMAGE_NV12;
+		mNvmmUsed  = true;
+	}
+#endif
 
-	mBufferYUV.SetThreaded(false);
+	// the pipeline releases the buffers it wraps from its own threads
+	mBufferYUV.SetThreaded(true);
 }
 
 
 // destructor	
 gstEncoder::~gstEncoder()
 {
+	cudaDeviceScope device(mOptions.cudaDevice);
+
 	Close();
 
+	for( size_t n=0; n < mLayers.size(); n++ )
+		delete mLayers[n];
+
+	for( size_t n=0; n < mLayerBuffers.size(); n++ )
+		CUDA(cudaFree(mLayerBuffers[n]));
+
+	mLayers.clear();
+	mLayerBuffers.clear();
+
 	if( mRTSPServer != NULL )
 	{
+		mRTSPServer->RemoveRoute(mPipeline);
 		mRTSPServer->Release();
 		mRTSPServer = NULL;
 	}
@@ -107,17 +164,37 @@ gstEncoder::~gstEncoder()
 		mAppSrc = NULL;
 	}
 
-	if( mBus != NULL )
+	if( mPacketSink != NULL )
 	{
-		gst_object_unref(mBus);
-		mBus = NULL;
+		gst_object_unref(mPacketSink);
+		mPacketSink = NULL;
 	}
 
+	SAFE_DELETE(mBusWatch);
+
 	if( mPipeline != NULL )
 	{
 		gst_object_unref(mPipeline);
 		mPipeline = NULL;
 	}
+
+#ifdef ENABLE_NVMM
+	freeNvmm();
+#endif
+
+	if( mBufferEvent != NULL )
+	{
+		CUDA(cudaEventDestroy(mBufferEvent));
+		mBufferEvent = NULL;
+	}
+
+	if( mStream != NULL )
+	{
+		CUDA(cudaStreamDestroy(mStream));
+		mStream = NULL;
+	}
+
+	CUDA_FREE(mPeerBuffer);
 }
 
 
@@ -152,6 +229,67 @@ gstEncoder* gstEncoder::Create( const URI& resource, videoOptions::Codec codec )
 }
 	
 
+// setEncoderOption (only sets properties that the encoder has, since they differ between elements)
+static bool setEncoderOption( GstElement* encoder, const char* name, const char* value )
+{
+	GParamSpec* param = g_object_class_find_property(G_OBJECT_GET_CLASS(encoder), name);
+
+	if( !param || !(param->flags & G_PARAM_WRITABLE) )
+		return false;
+
+	gst_util_set_object_arg(G_OBJECT(encoder), name, value);
+	LogVerbose(LOG_GSTREAMER "gstEncoder -- low latency:  %s=%s\n", name, value);
+	return true;
+}
+
+
+// setEncoderLowLatency
+static void setEncoderLowLatency( GstElement* pipeline, const videoOptions& options )
+{
+	GstElement* encoder = gst_bin_get_by_name(GST_BIN(pipeline), "encoder");
+
+	if( !encoder )
+		return;
+
+	// a GOP of one second (or the intra-refresh period), so that clients can join quickly
+	const uint32_t gop = (options.intraRefresh > 0) ? options.intraRefresh : (uint32_t)(options.frameRate + 0.5f);
+
+	char gopStr[32];
+	sprintf(gopStr, "%u", (gop > 0) ? gop : 30);
+
+	// nvv4l2h264enc/nvv4l2h265enc
+	setEncoderOption(encoder, "maxperf-enable", "true");
+	setEncoderOption(encoder, "preset-level", "1");		// UltraFastPreset
+	setEncoderOption(encoder, "num-B-Frames", "0");
+	setEncoderOption(encoder, "insert-sps-pps", "true");
+	setEncoderOption(encoder, "insert-vui", "true");
+	setEncoderOption(encoder, "poc-type", "2");			// no frame reordering
+	setEncoderOption(encoder, "control-rate", "1");		// CBR
+	setEncoderOption(encoder, "iframeinterval", gopStr);
+	setEncoderOption(encoder, "idrinterval", gopStr);
+
+	if( options.intraRefresh > 0 )
+		setEncoderOption(encoder, "slice-intrarefresh-interval", gopStr);
+
+	// x264enc/x265enc
+	setEncoderOption(encoder, "tune", "zerolatency");
+	setEncoderOption(encoder, "speed-preset", "ultrafast");
+	setEncoderOption(encoder, "bframes", "0");
+	setEncoderOption(encoder, "sliced-threads", "true");
+	setEncoderOption(encoder, "key-int-max", gopStr);
+
+	if( options.intraRefresh > 0 )
+		setEncoderOption(encoder, "intra-refresh", "true");
+
+	// vp8enc/vp9enc
+	setEncoderOption(encoder, "deadline", "1");			// realtime
+	setEncoderOption(encoder, "lag-in-frames", "0");
+	setEncoderOption(encoder, "keyframe-max-dist", gopStr);
+
+	gst_object_unref(encoder);
+}
+
+
 // init
 bool gstEncoder::init()
 {
@@ -162,6 +300,9 @@ bool gstEncoder::init()
 		return NULL;
 	}
 
+	// the CUDA stream, buffers and NVMM mappings all get created on the pinned device
+	cudaDeviceScope device(mOptions.cudaDevice);
+
 	// check for default codec
 	if( mOptions.codec == videoOptions::CODEC_UNKNOWN )
 	{
@@ -176,6 +317,8 @@ bool gstEncoder::init()
 	// set default bitrate if needed
 	if( mOptions.bitRate == 0 )
 		mOptions.bitRate = 4000000; 
+
+	mBitrateMax = mOptions.bitRate;
 	
 	// build pipeline string
 	if( !buildLaunchStr() )
@@ -204,17 +347,15 @@ bool gstEncoder::init()
 		return false;
 	}	
 	
-	// retrieve pipeline bus
-	mBus = gst_pipeline_get_bus(pipeline);
+	// configure the encoder for realtime streaming
+	if( mOptions.lowLatency && mOptions.codec != videoOptions::CODEC_MJPEG )
+		setEncoderLowLatency(mPipeline, mOptions);
 
-	if( !mBus )
-	{
-		LogError(LOG_GSTREAMER "gstEncoder -- failed to retrieve GstBus from pipeline\n");
+	// handle the messages on the bus thread, so Render() doesn't poll the bus
+	mBusWatch = gstBusWatch::Create(mPipeline, "gstEncoder");
+
+	if( !mBusWatch )
 		return false;
-	}
-	
-	// add watch for messages (disabled when we poll the bus ourselves, instead of gmainloop)
-	//gst_bus_add_watch(mBus, (GstBusFunc)gst_message_print, NULL);
 
 	// get the appsrc element
 	GstElement* appsrcElement = gst_bin_get_by_name(GST_BIN(pipeline), "mysource");
@@ -231,29 +372,216 @@ bool gstEncoder::init()
 	g_signal_connect(appsrcElement, "need-data", G_CALLBACK(onNeedData), this);
 	g_signal_connect(appsrcElement, "enough-data", G_CALLBACK(onEnoughData), this);
 
-	// create servers for RTSP/WebRTC streams
-	if( mOptions.resource.protocol == "rtsp" )
+	// get the appsink of the packet output (if there is one)
+	mPacketSink = gst_bin_get_by_name(GST_BIN(pipeline), "packetsink");
+
+	if( mPacketSink != NULL )
 	{
-		mRTSPServer = RTSPServer::Create(mOptions.resource.port);
-		
-		if( !mRTSPServer )
-			return false;
-		
-		mRTSPServer->AddRoute(mOptions.resource.path.c_str(), mPipeline);
+		GstAppSinkCallbacks cb;
+		memset(&cb, 0, sizeof(GstAppSinkCallbacks));
+		cb.new_sample = onPacket;
+
+		gst_app_sink_set_callbacks(GST_APP_SINK(mPacketSink), &cb, (void*)this, NULL);
 	}
-	else if( mOptions.resource.protocol == "webrtc" )
+
+	// create the CUDA stream and event used for colorspace conversion.  this is a blocking
+	// stream so that work the caller queued on the default stream is ordered before it,
+	// but only this encoder's conversion needs to be waited on (instead of the whole device)
+	if( CUDA_FAILED(cudaStreamCreate(&mStream)) )
+		return false;
+
+	NVTX_NAME_STREAM(mStream, mOptions.resource.string.c_str());
+
+	if( CUDA_FAILED(cudaEventCreateWithFlags(&mBufferEvent, cudaEventBlockingSync|cudaEventDisableTiming)) )
+		return false;
+
+	// create servers for RTSP/WebRTC streams (from the primary or extra outputs)
+	std::vector<const URI*> outputs(1, &mOptions.resource);
+
+	for( size_t n=0; n < mOptions.extraOutputs.size(); n++ )
+		outputs.push_back(&mOptions.extraOutputs[n]);
+
+	for( size_t n=0; n < outputs.size(); n++ )
 	{
-		mWebRTCServer = WebRTCServer::Create(mOptions.resource.port, mOptions.stunServer.c_str(),
-									  mOptions.sslCert.c_str(), mOptions.sslKey.c_str());
-		
-		if( !mWebRTCServer )
+		const URI& uri = *outputs[n];
+
+		if( uri.protocol == "rtsp" )
+		{
+			if( mRTSPServer != NULL )
+			{
+				LogError(LOG_GSTREAMER "gstEncoder -- only one RTSP output is supported per encoder (%s)\n", uri.string.c_str());
+				return false;
+			}
+
+			mRTSPServer = RTSPServer::Create(uri.port);
+			
+			if( !mRTSPServer )
+				return false;
+			
+			if( !mRTSPServer->AddRoute(uri.path.c_str(), mPipeline, mOptions.multicast) )
+				return false;
+		}
+		else if( uri.protocol == "webrtc" )
+		{
+			if( mWebRTCServer != NULL )
+			{
+				LogError(LOG_GSTREAMER "gstEncoder -- only one WebRTC output is supported per encoder (%s)\n", uri.string.c_str());
+				return false;
+			}
+
+			mWebRTCServer = WebRTCServer::Create(uri.port, mOptions.stunServer.c_str(),
+										  mOptions.sslCert.c_str(), mOptions.sslKey.c_str());
+			
+			if( !mWebRTCServer )
+				return false;
+			
+			mWebRTCServer->AddRoute(uri.path.c_str(), onWebsocketMessage, this, WEBRTC_VIDEO|WEBRTC_SEND|WEBRTC_PUBLIC|WEBRTC_MULTI_CLIENT);
+		}
+	}
+
+	// create the simulcast layers
+	return initLayers();
+}
+
+
+// layerURI (the primary URI with "_N" appended to the path)
+static std::string layerURI( const URI& uri, uint32_t layer )
+{
+	std::ostringstream ss;
+	ss << uri.protocol << "://" << uri.location << ":" << uri.port;
+
+	if( uri.path.size() == 0 || uri.path == "/" )
+		ss << "/" << layer;
+	else
+		ss << uri.path << "_" << layer;
+
+	return ss.str();
+}
+
+
+// initLayers
+bool gstEncoder::initLayers()
+{
+	if( mOptions.simulcast <= 1 )
+		return true;
+
+	const URI& uri = mOptions.resource;
+
+	if( uri.protocol != "rtsp" && uri.protocol != "webrtc" )
+	{
+		LogWarning(LOG_GSTREAMER "gstEncoder -- simulcast is only supported for RTSP and WebRTC outputs, ignoring it for %s\n", uri.string.c_str());
+		return true;
+	}
+
+	const uint32_t numLayers = std::min<uint32_t>(mOptions.simulcast, GST_ENCODER_MAX_LAYERS);
+
+	for( uint32_t n=1; n < numLayers; n++ )
+	{
+		// each layer is half the resolution with a quarter of the bitrate, and only goes to its own route
+		videoOptions opt = mOptions;
+
+		opt.resource  = layerURI(uri, n).c_str();
+		opt.save      = URI();
+		opt.simulcast = 1;
+		opt.width     = (mOptions.width >> n) & ~1;
+		opt.height    = (mOptions.height >> n) & ~1;
+		opt.bitRate   = std::max<uint32_t>(mOptions.bitRate >> (2 * n), GST_ENCODER_MIN_BITRATE);
+		opt.segmentTime = 0;
+		opt.segmentSize = 0;
+		opt.extraOutputs.clear();
+
+		gstEncoder* layer = gstEncoder::Create(opt);
+
+		if( !layer )
+		{
+			LogError(LOG_GSTREAMER "gstEncoder -- failed to create simulcast layer %s\n", opt.resource.string.c_str());
 			return false;
-		
-		mWebRTCServer->AddRoute(mOptions.resource.path.c_str(), onWebsocketMessage, this, WEBRTC_VIDEO|WEBRTC_SEND|WEBRTC_PUBLIC|WEBRTC_MULTI_CLIENT);
-	}		
+		}
+
+		// congested WebRTC viewers step down to the next layer
+		if( uri.protocol == "webrtc" )
+		{
+			gstEncoder* prev = (n == 1) ? this : mLayers.back();
+			prev->mLayerRoute = opt.resource.path;
+		}
+
+		LogInfo(LOG_GSTREAMER "gstEncoder -- simulcast layer %u @ %s (%u bps)\n", n, opt.resource.string.c_str(), opt.bitRate);
+
+		mLayers.push_back(layer);
+		mLayerBuffers.push_back(NULL);
+		mLayerSizes.push_back(0);
+	}
 
 	return true;
 }
+
+
+// renderLayers
+bool gstEncoder::renderLayers( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	bool result = true;
+
+	void* input = image;
+	uint32_t inputWidth = width;
+	uint32_t inputHeight = height;
+
+	for( size_t n=0; n < mLayers.size(); n++ )
+	{
+		const uint32_t layerWidth = (inputWidth / 2) & ~1;
+		const uint32_t layerHeight = (inputHeight / 2) & ~1;
+
+		if( layerWidth == 0 || layerHeight == 0 )
+			break;
+
+		const size_t layerSize = imageFormatSize(format, layerWidth, layerHeight);
+
+		if( layerSize != mLayerSizes[n] )
+		{
+			CUDA(cudaFree(mLayerBuffers[n]));
+			mLayerBuffers[n] = NULL;
+			mLayerSizes[n] = 0;
+
+			if( CUDA_FAILED(cudaMalloc(&mLayerBuffers[n], layerSize)) )
+				return false;
+
+			mLayerSizes[n] = layerSize;
+		}
+
+		// downscale from the previous layer (with area filtering, halving each layer is the same
+		// as downscaling from the full-resolution image).  this is queued on the default stream,
+		// which the layer's own colorspace conversion stream is ordered after.
+		if( CUDA_FAILED(cudaResize(input, inputWidth, inputHeight, mLayerBuffers[n], layerWidth, layerHeight, format, FILTER_AREA)) )
+		{
+			LogError(LOG_GSTREAMER "gstEncoder -- failed to downscale %s frame for simulcast layer %zu\n", imageFormatToStr(format), n+1);
+			return false;
+		}
+
+		// scale the regions of interest to the layer's resolution
+		if( mRegions.size() > 0 )
+		{
+			std::vector<RegionOfInterest> regions(mRegions);
+
+			for( size_t r=0; r < regions.size(); r++ )
+			{
+				regions[r].left   = (uint64_t)regions[r].left * layerWidth / width;
+				regions[r].right  = (uint64_t)regions[r].right * layerWidth / width;
+				regions[r].top    = (uint64_t)regions[r].top * layerHeight / height;
+				regions[r].bottom = (uint64_t)regions[r].bottom * layerHeight / height;
+			}
+
+			mLayers[n]->SetRegionsOfInterest(regions);
+		}
+
+		if( !mLayers[n]->Render(mLayerBuffers[n], layerWidth, layerHeight, format) )
+			result = false;
+
+		input = mLayerBuffers[n];
+		inputWidth = layerWidth;
+		inputHeight = layerHeight;
+	}
+
+	return result;
+}
 	
 
 // buildCapsStr
@@ -263,9 +591,13 @@ bool gstEncoder::buildCapsStr()
 
 #if GST_CHECK_VERSION(1,0,0)
 	ss << "video/x-raw";
+
+	if( mNvmmUsed )
+		ss << "(" << GST_CAPS_FEATURE_MEMORY_NVMM << ")";
+
 	ss << ", width=" << GetWidth();
 	ss << ", height=" << GetHeight();
-	ss << ", format=(string)I420";
+	ss << ", format=(string)" << (mFormatYUV == IMAGE_NV12 ? "NV12" : (mFormatYUV == IMAGE_RGBA8 ? "RGBA" : "I420"));
 	ss << ", framerate=" << (int)mOptions.frameRate << "/1";
 #else
 	ss << "video/x-raw-yuv";
@@ -291,27 +623,59 @@ bool gstEncoder::buildLaunchStr()
 	const URI& uri = GetResource();
 	std::string encoderOptions = "";
 
+	// gather the outputs that share the encoded stream
+	std::vector<const URI*> outputs;
+	bool networked = false;
+
+	if( mOptions.save.path.length() > 0 )
+		outputs.push_back(&mOptions.save);
+
+	outputs.push_back(&uri);
+
+	for( size_t n=0; n < mOptions.extraOutputs.size(); n++ )
+		outputs.push_back(&mOptions.extraOutputs[n]);
+
+	uint32_t packetOutputs = 0;
+
+	for( size_t n=0; n < outputs.size(); n++ )
+	{
+		if( outputs[n]->protocol == "packet" )
+			packetOutputs++;
+
+		// packets are usually sent over the application's own transport
+		if( videoOptions::DeviceTypeFromStr(outputs[n]->protocol.c_str()) == videoOptions::DEVICE_IP || outputs[n]->protocol == "packet" )
+			networked = true;
+	}
+
+	if( packetOutputs > 1 )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- only one packet:// output is supported per encoder\n");
+		return false;
+	}
+
 #ifdef GST_CODECS_V4L2
-	// the V4L2 encoders expect NVMM memory, so use nvvidconv to convert it
+	// the V4L2 encoders expect NVMM memory, so use nvvidconv to upload it
+	// (the input is already NV12, so this is a copy and not a color conversion,
+	//  except with the VIC converter where the RGBA->NV12 conversion happens here)
 	if( mOptions.codec != videoOptions::CODEC_MJPEG )
 		ss << "nvvidconv ! video/x-raw(memory:NVMM) ! ";
 	
 	// send keyframes/I-frames more frequently for network streams
-	if( mOptions.deviceType == videoOptions::DEVICE_IP )
+	if( networked )
 		encoderOptions = " idrinterval=30 ";
 #endif
 	
 	// select hardware codec to use
 	if( mOptions.codec == videoOptions::CODEC_H264 )
-		ss << GST_ENCODER_H264 << " bitrate=" << mOptions.bitRate << encoderOptions << " ! video/x-h264 ! ";	// TODO:  investigate quality-level setting
+		ss << GST_ENCODER_H264 << " name=encoder bitrate=" << mOptions.bitRate << encoderOptions << " ! video/x-h264 ! ";	// TODO:  investigate quality-level setting
 	else if( mOptions.codec == videoOptions::CODEC_H265 )
-		ss << GST_ENCODER_H265 << " bitrate=" << mOptions.bitRate << encoderOptions << " ! video/x-h265 ! ";
+		ss << GST_ENCODER_H265 << " name=encoder bitrate=" << mOptions.bitRate << encoderOptions << " ! video/x-h265 ! ";
 	else if( mOptions.codec == videoOptions::CODEC_VP8 )
-		ss << GST_ENCODER_VP8 << " bitrate=" << mOptions.bitRate << encoderOptions << " ! video/x-vp8 ! ";
+		ss << GST_ENCODER_VP8 << " name=encoder bitrate=" << mOptions.bitRate << encoderOptions << " ! video/x-vp8 ! ";
 	else if( mOptions.codec == videoOptions::CODEC_VP9 )
-		ss << GST_ENCODER_VP9 << " bitrate=" << mOptions.bitRate << encoderOptions << " ! video/x-vp9 ! ";
+		ss << GST_ENCODER_VP9 << " name=encoder bitrate=" << mOptions.bitRate << encoderOptions << " ! video/x-vp9 ! ";
 	else if( mOptions.codec == videoOptions::CODEC_MJPEG )
-		ss << GST_ENCODER_MJPEG << " ! image/jpeg ! ";
+		ss << GST_ENCODER_MJPEG << " name=encoder ! image/jpeg ! ";
 	else
 	{
 		LogError(LOG_GSTREAMER "gstEncoder -- unsupported codec requested (%s)\n", videoOptions::CodecToStr(mOptions.codec));
@@ -323,19 +687,41 @@ bool gstEncoder::buildLaunchStr()
 		LogError(LOG_GSTREAMER "                 * mjpeg\n");
 	}
 
-	if( mOptions.save.path.length() > 0 )
+	if( outputs.size() > 1 )
 	{
-		ss << "tee name=savetee savetee. ! queue ! ";
-		
-		if( !gst_build_filesink(mOptions.save, mOptions.codec, ss) )
-			return false;
+		// encode once, and split the bitstream between all of the outputs
+		ss << "tee name=encodertee ";
+
+		for( size_t n=0; n < outputs.size(); n++ )
+		{
+			ss << "encodertee. ! queue ! ";
 
-		ss << "savetee. ! queue ! ";
+			if( !buildSinkStr(*outputs[n], ss, outputs[n] == &uri) )
+				return false;
+
+			ss << " ";
+		}
 	}
-	
+	else if( !buildSinkStr(uri, ss, true) )
+	{
+		return false;
+	}
+
+	mLaunchStr = ss.str();
+
+	LogInfo(LOG_GSTREAMER "gstEncoder -- pipeline launch string:\n");
+	LogInfo(LOG_GSTREAMER "%s\n", mLaunchStr.c_str());
+
+	return true;
+}
+
+
+// buildSinkStr
+bool gstEncoder::buildSinkStr( const URI& uri, std::ostringstream& ss, bool primary )
+{
 	if( uri.protocol == "file" )
 	{
-		if( !gst_build_filesink(uri, mOptions.codec, ss) )
+		if( !gst_build_filesink(uri, mOptions.codec, ss, mOptions.segmentTime, mOptions.segmentSize, primary ? "splitsink" : NULL) )
 			return false;
 	}
 	else if( uri.protocol == "rtp" || uri.protocol == "rtsp" || uri.protocol == "webrtc" )
@@ -370,7 +756,16 @@ bool gstEncoder::buildLaunchStr()
 		}
 		else if( uri.protocol == "webrtc" )
 		{
-			ss << "application/x-rtp,media=video,encoding-name=" << videoOptions::CodecToStr(mOptions.codec) << ",clock-rate=90000,payload=96 ! ";
+			ss << "application/x-rtp,media=video,encoding-name=" << videoOptions::CodecToStr(mOptions.codec) << ",clock-rate=90000,payload=96";
+			ss << ",rtcp-fb-nack-pli=(boolean)true,rtcp-fb-goog-remb=(boolean)true";	// keyframe requests + congestion feedback
+
+		#if GST_CHECK_VERSION(1,20,0)
+			// transport-cc feedback needs the sequence number extension and the rtpgccbwe estimator
+			if( gst_element_available("rtpgccbwe") )
+				ss << ",extmap-1=(string)\"http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\"";
+		#endif
+
+			ss << " ! ";
 			ss << "tee name=videotee ! queue ! fakesink";  // webrtcbin's will be added when clients connect
 		}
 	}
@@ -399,18 +794,83 @@ bool gstEncoder::buildLaunchStr()
 		ss << "flvmux streamable=true ! queue ! rtmpsink location=";
 		ss << uri.string << " ";
 	}
+	else if( uri.protocol == "packet" )
+	{
+		// deliver whole access units, with the SPS/PPS inserted before each keyframe
+		if( mOptions.codec == videoOptions::CODEC_H264 )
+			ss << "h264parse config-interval=-1 ! video/x-h264,stream-format=byte-stream,alignment=au ! ";
+		else if( mOptions.codec == videoOptions::CODEC_H265 )
+			ss << "h265parse config-interval=-1 ! video/x-h265,stream-format=byte-stream,alignment=au ! ";
+		else if( mOptions.codec == videoOptions::CODEC_MJPEG )
+			ss << "jpegparse ! ";
+
+		ss << "appsink name=packetsink sync=false async=false max-buffers=" << GST_ENCODER_PACKET_QUEUE << " drop=true";
+	}
 	else
 	{
 		LogError(LOG_GSTREAMER "gstEncoder -- invalid protocol (%s)\n", uri.protocol.c_str());
 		return false;
 	}
 
-	mLaunchStr = ss.str();
+	return true;
+}
 
-	LogInfo(LOG_GSTREAMER "gstEncoder -- pipeline launch string:\n");
-	LogInfo(LOG_GSTREAMER "%s\n", mLaunchStr.c_str());
 
-	return true;
+// SetPacketCallback
+void gstEncoder::SetPacketCallback( PacketCallback callback, void* user_data )
+{
+	if( !mPacketSink && callback != NULL )
+		LogWarning(LOG_GSTREAMER "gstEncoder -- %s doesn't have a packet:// output, so the packet callback won't be called\n", GetResource().string.c_str());
+
+	mPacketMutex.Lock();
+	mPacketCallback = callback;
+	mPacketUserData = user_data;
+	mPacketMutex.Unlock();
+}
+
+
+// onPacket (called from the streaming thread)
+GstFlowReturn gstEncoder::onPacket( _GstAppSink* sink, void* user_data )
+{
+	gstEncoder* enc = (gstEncoder*)user_data;
+
+	if( !enc )
+		return GST_FLOW_OK;
+
+	GstSample* gstSample = gst_app_sink_pull_sample(sink);
+
+	if( !gstSample )
+		return GST_FLOW_OK;
+
+	GstBuffer* gstBuffer = gst_sample_get_buffer(gstSample);
+	GstMapInfo map;
+
+	if( !gstBuffer || !gst_buffer_map(gstBuffer, &map, GST_MAP_READ) )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to map the buffer of an encoded packet\n");
+		gst_sample_unref(gstSample);
+		return GST_FLOW_OK;
+	}
+
+	Packet packet;
+
+	packet.data     = map.data;
+	packet.size     = map.size;
+	packet.pts      = GST_BUFFER_PTS(gstBuffer);
+	packet.dts      = GST_BUFFER_DTS(gstBuffer);
+	packet.keyframe = !GST_BUFFER_FLAG_IS_SET(gstBuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+	enc->mPacketMutex.Lock();
+
+	if( enc->mPacketCallback != NULL )
+		enc->mPacketCallback(packet, enc->mPacketUserData);
+
+	enc->mPacketMutex.Unlock();
+
+	gst_buffer_unmap(gstBuffer, &map);
+	gst_sample_unref(gstSample);
+
+	return GST_FLOW_OK;
 }
 
 
@@ -424,6 +884,7 @@ void gstEncoder::onNeedData( GstElement* pipeline, guint size, gpointer user_dat
 
 	gstEncoder* enc = (gstEncoder*)user_data;
 	enc->mNeedData  = true;
+	enc->mNeedDataEvent.Wake();
 }
  
 
@@ -440,74 +901,131 @@ void gstEncoder::onEnoughData( GstElement* pipeline, gpointer user_data )
 }
 
 
-// encodeYUV
-bool gstEncoder::encodeYUV( void* buffer, size_t size )
+// checkBackpressure
+bool gstEncoder::checkBackpressure()
 {
-	if( !buffer || size == 0 )
+	if( mNeedData || mBackpressure == DROP_OLDEST )
+		return true;	// appsrc drops the oldest queued frame itself
+
+	if( mBackpressure != BLOCK )
 		return false;
-	
-	// confirm the stream is open
-	if( !mStreaming )
-	{
-		if( !Open() )
-			return false;
-	}
 
-	// check to see if data can be accepted
-	if( !mNeedData )
-	{
-		if( mOptions.frameCount % 25 == 0 )
-			LogVerbose(LOG_GSTREAMER "gstEncoder -- pipeline full, skipping frame %zu (%ux%u, %zu bytes)\n", mOptions.frameCount, mOptions.width, mOptions.height, size);
-		
-		return true;
-	}
+	const uint64_t deadline = gst_util_get_timestamp() + mBackpressureTimeout * GST_MSECOND;
 
-	// construct the buffer caps for this size image
-	if( !mBufferCaps )
+	while( !mNeedData )
 	{
-		if( !buildCapsStr() )
-		{
-			LogError(LOG_GSTREAMER "gstEncoder -- failed to build caps string\n");
-			return false;
-		}
+		const uint64_t now = gst_util_get_timestamp();
 
-		mBufferCaps = gst_caps_from_string(mCapsStr.c_str());
-
-		if( !mBufferCaps )
-		{
-			LogError(LOG_GSTREAMER "gstEncoder -- failed to parse caps from string:\n");
-			LogError(LOG_GSTREAMER "   %s\n", mCapsStr.c_str());
+		if( now >= deadline )
 			return false;
-		}
 
-	#if GST_CHECK_VERSION(1,0,0)
-		gst_app_src_set_caps(GST_APP_SRC(mAppSrc), mBufferCaps);
-	#endif
+		mNeedDataEvent.WaitNs(deadline - now);
 	}
 
-#if GST_CHECK_VERSION(1,0,0)
-	// allocate gstreamer buffer memory
-	GstBuffer* gstBuffer = gst_buffer_new_allocate(NULL, size, NULL);
-	
-	// map the buffer for write access
-	GstMapInfo map; 
+	return true;
+}
 
-	if( gst_buffer_map(gstBuffer, &map, GST_MAP_WRITE) ) 
-	{ 
-		if( map.size != size )
-		{
-			LogError(LOG_GSTREAMER "gstEncoder -- gst_buffer_map() size mismatch, got %zu bytes, expected %zu bytes\n", map.size, size);
-			gst_buffer_unref(gstBuffer);
-			return false;
-		}
-		
-		memcpy(map.data, buffer, size);
-		gst_buffer_unmap(gstBuffer, &map); 
-	} 
-	else
+
+// SetBackpressure
+bool gstEncoder::SetBackpressure( Backpressure policy, uint64_t timeout )
+{
+	if( policy == DROP_OLDEST )
 	{
-		LogError(LOG_GSTREAMER "gstEncoder -- failed to map gstreamer buffer memory (%zu bytes)\n", size);
-		gst_buffer_unref(gstBuffer);
+	#if GST_CHECK_VERSION(1,20,0)
+		// let appsrc hold a couple frames (the rest of the YUV buffers are being converted/encoded)
+		// and discard the oldest one when it's full, instead of signalling enough-data
+		if( mAppSrc != NULL )
+			g_object_set(G_OBJECT(mAppSrc), "max-bytes", (guint64)0, "max-buffers", (guint64)(GST_ENCODER_YUV_BUFFERS/2), "leaky-type", 2 /*GST_APP_LEAKY_TYPE_DOWNSTREAM*/, NULL);
+	#else
+		LogError(LOG_GSTREAMER "gstEncoder -- the DROP_OLDEST backpressure policy requires GStreamer 1.20 or newer\n");
+		return false;
+	#endif
+	}
+	else if( mBackpressure == DROP_OLDEST && mAppSrc != NULL )
+	{
+	#if GST_CHECK_VERSION(1,20,0)
+		g_object_set(G_OBJECT(mAppSrc), "max-bytes", (guint64)200000, "max-buffers", (guint64)0, "leaky-type", 0 /*GST_APP_LEAKY_TYPE_NONE*/, NULL);
+	#endif
+	}
+
+	mBackpressure = policy;
+	mBackpressureTimeout = timeout;
+
+	return true;
+}
+
+
+// buildBufferCaps
+bool gstEncoder::buildBufferCaps()
+{
+	if( mBufferCaps != NULL )
+		return true;
+
+	if( !buildCapsStr() )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to build caps string\n");
+		return false;
+	}
+
+	mBufferCaps = gst_caps_from_string(mCapsStr.c_str());
+
+	if( !mBufferCaps )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to parse caps from string:\n");
+		LogError(LOG_GSTREAMER "   %s\n", mCapsStr.c_str());
+		return false;
+	}
+
+#if GST_CHECK_VERSION(1,0,0)
+	gst_app_src_set_caps(GST_APP_SRC(mAppSrc), mBufferCaps);
+#endif
+
+	return true;
+}
+
+
+// encodeYUV
+bool gstEncoder::encodeYUV( void* buffer, size_t size )
+{
+	if( !buffer || size == 0 )
+		return false;
+
+	NVTX_RANGE_FMT("gstEncoder::encodeYUV (%s)", mOptions.resource.string.c_str());
+	
+	// confirm the stream is open
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	// construct the buffer caps for this size image
+	if( !buildBufferCaps() )
+		return false;
+
+#if GST_CHECK_VERSION(1,0,0)
+	// lease the buffer from the ringbuffer until the pipeline is done with it,
+	// so that it can be wrapped and pushed to appsrc without being copied
+	void* leased = mBufferYUV.Acquire(RingBuffer::ReadLatest);
+
+	if( leased != buffer )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to lease YUV buffer from the ringbuffer\n");
+		mBufferYUV.Release(leased);
+		return false;
+	}
+
+	YUVLease* lease = new YUVLease();
+
+	lease->encoder = this;
+	lease->buffer  = buffer;
+
+	GstBuffer* gstBuffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, buffer, size, 0, size, lease, onYUVRelease);
+
+	if( !gstBuffer )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to wrap YUV buffer (%zu bytes)\n", size);
+		onYUVRelease(lease);
 		return false;
 	}
 #else
@@ -528,6 +1046,61 @@ bool gstEncoder::encodeYUV( void* buffer, size_t size )
 	memcpy(GST_BUFFER_DATA(gstBuffer), buffer, size);
 #endif
 
+	return encodeBuffer(gstBuffer);
+}
+
+
+// onYUVRelease
+void gstEncoder::onYUVRelease( void* user_data )
+{
+	YUVLease* lease = (YUVLease*)user_data;
+
+	if( !lease )
+		return;
+
+	lease->encoder->mBufferYUV.Release(lease->buffer);
+	delete lease;
+}
+
+
+// SetRegionsOfInterest
+void gstEncoder::SetRegionsOfInterest( const std::vector<RegionOfInterest>& regions )
+{
+	mRegions = regions;
+}
+
+
+// encodeBuffer
+bool gstEncoder::encodeBuffer( GstBuffer* gstBuffer )
+{
+	// attach the regions of interest, clipped to the frame
+	for( size_t n=0; n < mRegions.size(); n++ )
+	{
+		const uint32_t left   = std::min(mRegions[n].left, mOptions.width);
+		const uint32_t top    = std::min(mRegions[n].top, mOptions.height);
+		const uint32_t right  = std::min(mRegions[n].right, mOptions.width);
+		const uint32_t bottom = std::min(mRegions[n].bottom, mOptions.height);
+
+		if( right <= left || bottom <= top )
+			continue;
+
+		GstVideoRegionOfInterestMeta* meta = gst_buffer_add_video_region_of_interest_meta(gstBuffer, "roi", left, top, right - left, bottom - top);
+
+	#if GST_CHECK_VERSION(1,14,0)
+		if( meta != NULL )
+			gst_video_region_of_interest_meta_add_param(meta, gst_structure_new("roi/vaapi", "delta-qp", G_TYPE_INT, mRegions[n].qpDelta, NULL));
+	#endif
+	}
+
+	// appsrc timestamps the buffer with the running time (do-timestamp), which metadata is tagged with
+	GstClock* clock = gst_element_get_clock(mPipeline);
+
+	if( clock != NULL )
+	{
+		mTimestamp = gst_clock_get_time(clock) - gst_element_get_base_time(mPipeline);
+		gst_object_unref(clock);
+	}
+
 	// queue buffer to gstreamer
 	while( true )
 	{
@@ -560,7 +1133,6 @@ bool gstEncoder::encodeYUV( void* buffer, size_t size )
 		}
 	}
 	
-	checkMsgBus();
 	return true;
 }
 
@@ -568,6 +1140,11 @@ bool gstEncoder::encodeYUV( void* buffer, size_t size )
 // Render
 bool gstEncoder::Render( void* image, uint32_t width, uint32_t height, imageFormat format )
 {	
+	NVTX_RANGE_FMT("gstEncoder::Render (%s)", mOptions.resource.string.c_str());
+	PROFILER_SCOPE_CUDA("gstEncoder::Render", mStream);
+
+	cudaDeviceScope device(mOptions.cudaDevice);
+
 	// update the webrtc server if needed
 	if( mWebRTCServer != NULL && !mWebRTCServer->IsThreaded() )
 		mWebRTCServer->ProcessRequests();	
@@ -579,6 +1156,12 @@ bool gstEncoder::Render( void* image, uint32_t width, uint32_t height, imageForm
 	if( !image || width == 0 || height == 0 )
 		return false;
 
+	// frames from another GPU get copied over to this one first
+	image = importPeer(image, width, height, format);
+
+	if( !image )
+		return false;
+
 	if( mOptions.width != width || mOptions.height != height )
 	{
 		if( mOptions.width != 0 || mOptions.height != 0 )
@@ -594,27 +1177,82 @@ bool gstEncoder::Render( void* image, uint32_t width, uint32_t height, imageForm
 		}
 	}
 
+	// skip frames that look the same as the last one encoded (see videoOptions::dedupFrames)
+	if( isDuplicate(image, width, height, format, mStream) )
+	{
+		mRegions.clear();
+		return videoOutput::Render(image, width, height, format);
+	}
+
+	// encode the lower resolution simulcast layers
+	if( mLayers.size() > 0 )
+		renderLayers(image, width, height, format);
+
 	// error checking / return
 	bool enc_success = false;
 
 	#define render_end()	\
+		mRegions.clear();	\
 		const bool substreams_success = videoOutput::Render(image, width, height, format); \
 		return enc_success & substreams_success;
 
+	// check if the encoder can accept the frame before converting it
+	if( !mStreaming && !Open() )
+	{
+		render_end();
+	}
+
+	if( !checkBackpressure() )
+	{
+		if( mOptions.frameCount % 25 == 0 )
+			LogVerbose(LOG_GSTREAMER "gstEncoder -- pipeline full, skipping frame %zu (%ux%u)\n", mOptions.frameCount, width, height);
+
+		enc_success = true;
+		render_end();
+	}
+
+#ifdef ENABLE_NVMM
+	// convert directly into NVMM memory
+	if( mNvmmUsed )
+	{
+		enc_success = renderNvmm(image, width, height, format);
+
+		if( mNvmmUsed )	// otherwise fall back to the CPU path below
+		{
+			render_end();
+		}
+	}
+#endif
+
 	// allocate color conversion buffer
-	const size_t i420Size = imageFormatSize(IMAGE_I420, width, height);
+	const size_t yuvSize = imageFormatSize(mFormatYUV, width, height);
+
+	if( yuvSize != mBufferYUV.GetBufferSize() && mBufferYUV.GetLeased() > 0 )
+	{
+		// the old buffers can't be freed until the pipeline is done with them
+		LogVerbose(LOG_GSTREAMER "gstEncoder -- waiting for the pipeline to release buffers, skipping frame %zu\n", mOptions.frameCount);
+		enc_success = true;
+		render_end();
+	}
 
-	if( !mBufferYUV.Alloc(2, i420Size, RingBuffer::ZeroCopy) )
+	if( !mBufferYUV.Alloc(GST_ENCODER_YUV_BUFFERS, yuvSize, RingBuffer::ZeroCopy) )
 	{
-		LogError(LOG_GSTREAMER "gstEncoder -- failed to allocate buffers (%zu bytes each)\n", i420Size);
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to allocate buffers (%zu bytes each)\n", yuvSize);
 		enc_success = false;
 		render_end();
 	}
 
-	// perform colorspace conversion
-	void* nextYUV = mBufferYUV.Next(RingBuffer::Write);
+	// reserve a buffer that isn't still queued in the pipeline
+	void* nextYUV = mBufferYUV.Peek(RingBuffer::Write);
 
-	if( CUDA_FAILED(cudaConvertColor(image, format, nextYUV, IMAGE_I420, width, height)) )
+	if( !nextYUV )
+	{
+		enc_success = false;
+		render_end();
+	}
+
+	// perform colorspace conversion
+	if( CUDA_FAILED(cudaConvertColor(image, format, nextYUV, mFormatYUV, width, height, make_float2(0,255), mStream)) )
 	{
 		LogError(LOG_GSTREAMER "gstEncoder::Render() -- unsupported image format (%s)\n", imageFormatToStr(format));
 		LogError(LOG_GSTREAMER "                        supported formats are:\n");
@@ -627,16 +1265,299 @@ bool gstEncoder::Render( void* image, uint32_t width, uint32_t height, imageForm
 		render_end();
 	}
 
-	CUDA(cudaDeviceSynchronize());	// TODO replace with cudaStream?
+	// wait for the conversion to finish before the pipeline reads the buffer
+	if( CUDA_FAILED(cudaEventRecord(mBufferEvent, mStream)) || CUDA_FAILED(cudaEventSynchronize(mBufferEvent)) )
+	{
+		enc_success = false;
+		render_end();
+	}
 	
+	mBufferYUV.Next(RingBuffer::Write);
+
 	// encode YUV buffer
-	enc_success = encodeYUV(nextYUV, i420Size);
+	enc_success = encodeYUV(nextYUV, yuvSize);
 
 	// render sub-streams
 	render_end();	
 }
 
 
+// importPeer
+void* gstEncoder::importPeer( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	int device = 0;
+	const int imageDevice = cudaPointerDevice(image);
+
+	if( imageDevice < 0 || CUDA_FAILED(cudaGetDevice(&device)) || imageDevice == device )
+		return image;
+
+	const size_t size = imageFormatSize(format, width, height);
+
+	if( size != mPeerSize )
+	{
+		CUDA_FREE(mPeerBuffer);
+		mPeerSize = 0;
+
+		if( CUDA_FAILED(cudaMalloc(&mPeerBuffer, size)) )
+			return NULL;
+
+		mPeerSize = size;
+		LogVerbose(LOG_GSTREAMER "gstEncoder -- copying frames from GPU %i to GPU %i (%zu bytes)\n", imageDevice, device, size);
+	}
+
+	// the copy is synchronous, because the frame also gets passed on to the other outputs
+	if( CUDA_FAILED(cudaMemcpyFromDevice(mPeerBuffer, image, size, mStream)) || CUDA_FAILED(cudaStreamSynchronize(mStream)) )
+		return NULL;
+
+	return mPeerBuffer;
+}
+
+
+#ifdef ENABLE_NVMM
+// renderNvmm
+bool gstEncoder::renderNvmm( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	// allocate the NVMM buffers (or re-allocate them if the size changed)
+	if( mNvmmBuffers.size() == 0 || mNvmmBuffers[0]->width != width || mNvmmBuffers[0]->height != height )
+	{
+		if( !allocNvmm(width, height) )
+		{
+			LogWarning(LOG_GSTREAMER "gstEncoder -- failed to allocate NVMM buffers, falling back to CPU memory\n");
+			freeNvmm();
+
+			if( mBufferCaps != NULL )
+			{
+				gst_caps_unref(mBufferCaps);
+				mBufferCaps = NULL;
+			}
+
+			mNvmmUsed = false;
+			return false;
+		}
+	}
+
+	// confirm the stream is open
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	NvmmBuffer* buffer = nextNvmm();
+
+	if( !buffer )
+	{
+		if( mOptions.frameCount % 25 == 0 )
+			LogVerbose(LOG_GSTREAMER "gstEncoder -- all NVMM buffers are in use, skipping frame %zu (%ux%u)\n", mOptions.frameCount, width, height);
+		
+		return true;
+	}
+
+	// perform colorspace conversion directly into the NVMM buffer
+	cudaError_t result = cudaErrorInvalidValue;
+
+	if( format == IMAGE_RGB8 )
+		result = cudaRGBToNV12((uchar3*)image, width * sizeof(uchar3), buffer->planes[0], buffer->pitch[0], buffer->planes[1], buffer->pitch[1], width, height, mStream);
+	else if( format == IMAGE_RGBA8 )
+		result = cudaRGBAToNV12((uchar4*)image, width * sizeof(uchar4), buffer->planes[0], buffer->pitch[0], buffer->planes[1], buffer->pitch[1], width, height, mStream);
+	else if( format == IMAGE_RGB32F )
+		result = cudaRGBToNV12((float3*)image, width * sizeof(float3), buffer->planes[0], buffer->pitch[0], buffer->planes[1], buffer->pitch[1], width, height, mStream);
+	else if( format == IMAGE_RGBA32F )
+		result = cudaRGBAToNV12((float4*)image, width * sizeof(float4), buffer->planes[0], buffer->pitch[0], buffer->planes[1], buffer->pitch[1], width, height, mStream);
+
+	if( CUDA_FAILED(result) )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder::Render() -- unsupported image format (%s)\n", imageFormatToStr(format));
+		LogError(LOG_GSTREAMER "                        supported formats are:\n");
+		LogError(LOG_GSTREAMER "                            * rgb8\n");		
+		LogError(LOG_GSTREAMER "                            * rgba8\n");		
+		LogError(LOG_GSTREAMER "                            * rgb32f\n");		
+		LogError(LOG_GSTREAMER "                            * rgba32f\n");
+		
+		onNvmmRelease(buffer);
+		return false;
+	}
+
+	// wait for the conversion to finish before the encoder consumes the buffer
+	if( CUDA_FAILED(cudaEventRecord(mBufferEvent, mStream)) || CUDA_FAILED(cudaEventSynchronize(mBufferEvent)) )
+	{
+		onNvmmRelease(buffer);
+		return false;
+	}
+
+	// construct the buffer caps for this size image
+	if( !buildBufferCaps() )
+	{
+		onNvmmRelease(buffer);
+		return false;
+	}
+
+	// wrap the NvBuffer handle, it gets returned to the pool when the pipeline releases it
+	GstBuffer* gstBuffer = gst_buffer_new_wrapped_full((GstMemoryFlags)0, buffer->nvbuf, buffer->nvbufSize, 0, buffer->nvbufSize, buffer, onNvmmRelease);
+
+	if( !gstBuffer )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to wrap NVMM buffer\n");
+		onNvmmRelease(buffer);
+		return false;
+	}
+
+	return encodeBuffer(gstBuffer);
+}
+
+
+// allocNvmm
+bool gstEncoder::allocNvmm( uint32_t width, uint32_t height )
+{
+	freeNvmm();
+
+	for( uint32_t n=0; n < GST_ENCODER_NVMM_BUFFERS; n++ )
+	{
+		NvmmBuffer* buffer = new NvmmBuffer();	// value-initialized to zero
+
+		buffer->fd = -1;
+		buffer->state = NVMM_FREE;
+
+		mNvmmBuffers.push_back(buffer);	// freeNvmm() cleans up partial allocations
+
+		NvBufferCreateParams createParams;
+		memset(&createParams, 0, sizeof(NvBufferCreateParams));
+
+		createParams.width       = width;
+		createParams.height      = height;
+		createParams.layout      = NvBufferLayout_Pitch;
+		createParams.colorFormat = NvBufferColorFormat_NV12;
+		createParams.payloadType = NvBufferPayload_SurfArray;
+		createParams.nvbuf_tag   = NvBufferTag_VIDEO_ENC;
+
+		if( NvBufferCreateEx(&buffer->fd, &createParams) != 0 )
+		{
+			LogError(LOG_GSTREAMER "gstEncoder -- failed to allocate NVMM buffer (%ux%u)\n", width, height);
+			buffer->fd = -1;
+			return false;
+		}
+
+		NvBufferParams bufferParams;
+
+		if( NvBufferGetParams(buffer->fd, &bufferParams) != 0 )
+		{
+			LogError(LOG_GSTREAMER "gstEncoder -- failed to get NVMM buffer params\n");
+			return false;
+		}
+
+		buffer->nvbuf     = bufferParams.nv_buffer;
+		buffer->nvbufSize = bufferParams.nv_buffer_size;
+
+		// map the NvBuffer into CUDA through EGL
+		EGLImageKHR eglImage = NvEGLImageFromFd(NULL, buffer->fd);
+
+		if( !eglImage )
+		{
+			LogError(LOG_GSTREAMER "gstEncoder -- failed to map EGLImage from NVMM buffer\n");
+			return false;
+		}
+
+		buffer->egl = eglImage;
+
+		cudaGraphicsResource* eglResource = NULL;
+
+		if( CUDA_FAILED(cudaGraphicsEGLRegisterImage(&eglResource, eglImage, cudaGraphicsRegisterFlagsNone)) )
+			return false;
+
+		buffer->resource = eglResource;
+
+		cudaEglFrame eglFrame;
+
+		if( CUDA_FAILED(cudaGraphicsResourceGetMappedEglFrame(&eglFrame, eglResource, 0, 0)) )
+			return false;
+
+		if( eglFrame.frameType != cudaEglFrameTypePitch || eglFrame.planeCount != 2 )
+		{
+			LogError(LOG_GSTREAMER "gstEncoder -- NVMM buffer had unexpected layout (expected 2 pitch-linear planes)\n");
+			return false;
+		}
+
+		for( uint32_t p=0; p < 2; p++ )
+		{
+			buffer->planes[p] = eglFrame.frame.pPitch[p].ptr;
+			buffer->pitch[p]  = eglFrame.frame.pPitch[p].pitch;
+		}
+
+		buffer->width   = width;
+		buffer->height  = height;
+	}
+
+	LogVerbose(LOG_GSTREAMER "gstEncoder -- allocated %u NVMM buffers (%ux%u NV12)\n", GST_ENCODER_NVMM_BUFFERS, width, height);
+	return true;
+}
+
+
+// freeNvmm
+void gstEncoder::freeNvmm()
+{
+	for( size_t n=0; n < mNvmmBuffers.size(); n++ )
+	{
+		// buffers still held by the pipeline are freed by onNvmmRelease() once they get released
+		// (if the pipeline released it in the meantime, the exchange fails and it's free to destroy)
+		int state = NVMM_IN_USE;
+
+		if( !mNvmmBuffers[n]->state.compare_exchange_strong(state, NVMM_ORPHANED) )
+			destroyNvmm(mNvmmBuffers[n]);
+	}
+
+	mNvmmBuffers.clear();
+}
+
+
+// nextNvmm
+gstEncoder::NvmmBuffer* gstEncoder::nextNvmm()
+{
+	for( size_t n=0; n < mNvmmBuffers.size(); n++ )
+	{
+		int state = NVMM_FREE;
+
+		if( mNvmmBuffers[n]->state.compare_exchange_strong(state, NVMM_IN_USE) )
+			return mNvmmBuffers[n];
+	}
+
+	return NULL;
+}
+
+
+// destroyNvmm
+void gstEncoder::destroyNvmm( NvmmBuffer* buffer )
+{
+	if( !buffer )
+		return;
+
+	if( buffer->resource != NULL )
+		CUDA(cudaGraphicsUnregisterResource((cudaGraphicsResource*)buffer->resource));
+
+	if( buffer->egl != NULL )
+		NvDestroyEGLImage(NULL, (EGLImageKHR)buffer->egl);
+
+	if( buffer->fd >= 0 )
+		NvBufferDestroy(buffer->fd);
+
+	delete buffer;
+}
+
+
+// onNvmmRelease
+void gstEncoder::onNvmmRelease( void* user_data )
+{
+	NvmmBuffer* buffer = (NvmmBuffer*)user_data;
+
+	if( !buffer )
+		return;
+
+	// the encoder may have been deleted already, so only the buffer's own state is used
+	if( buffer->state.exchange(NVMM_FREE) == NVMM_ORPHANED )
+		destroyNvmm(buffer);
+}
+#endif
+
+
 // Open
 bool gstEncoder::Open()
 {
@@ -646,24 +1567,13 @@ bool gstEncoder::Open()
 	// transition pipline to STATE_PLAYING
 	LogInfo(LOG_GSTREAMER "gstEncoder -- starting pipeline, transitioning to GST_STATE_PLAYING\n");
 
+	mBusWatch->Reset();	// clear the EOS from the last Close()
+
 	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_PLAYING);
 
 	if( result == GST_STATE_CHANGE_ASYNC )
 	{
 		LogDebug(LOG_GSTREAMER "gstEncoder -- queued state to GST_STATE_PLAYING => GST_STATE_CHANGE_ASYNC\n");
-		
-#if 0
-		GstMessage* asyncMsg = gst_bus_timed_pop_filtered(mBus, 5 * GST_SECOND, 
-    	 					      (GstMessageType)(GST_MESSAGE_ASYNC_DONE|GST_MESSAGE_ERROR)); 
-
-		if( asyncMsg != NULL )
-		{
-			gst_message_print(mBus, asyncMsg, this);
-			gst_message_unref(asyncMsg);
-		}
-		else
-			printf(LOG_GSTREAMER "gstEncoder -- NULL message after transitioning pipeline to PLAYING...\n");
-#endif
 	}
 	else if( result != GST_STATE_CHANGE_SUCCESS )
 	{
@@ -671,9 +1581,7 @@ bool gstEncoder::Open()
 		return false;
 	}
 
-	checkMsgBus();
-	usleep(100 * 1000);
-	checkMsgBus();
+	gst_wait_state(mPipeline, NULL, GST_OPEN_TIMEOUT, this);	// the messages go to mBusWatch
 
 	mStreaming = true;
 	return true;
@@ -694,8 +1602,8 @@ void gstEncoder::Close()
 
 	if( eos_result != 0 )
 		LogError(LOG_GSTREAMER "gstEncoder -- failed sending appsrc EOS (result %u)\n", eos_result);
-
-	sleep(1);
+	else
+		mBusWatch->WaitEOS(GST_EOS_TIMEOUT);  // the muxer needs EOS to finalize the file
 
 	// stop pipeline
 	LogInfo(LOG_GSTREAMER "gstEncoder -- transitioning pipeline to GST_STATE_NULL\n");
@@ -705,26 +1613,407 @@ void gstEncoder::Close()
 	if( result != GST_STATE_CHANGE_SUCCESS )
 		LogError(LOG_GSTREAMER "gstEncoder -- failed to set pipeline state to NULL (error %u)\n", result);
 
-	sleep(1);
-	checkMsgBus();	
 	mStreaming = false;
 	LogInfo(LOG_GSTREAMER "gstEncoder -- pipeline stopped\n");
+
+	for( size_t n=0; n < mLayers.size(); n++ )
+		mLayers[n]->Close();
 }
 
 
-// checkMsgBus
-void gstEncoder::checkMsgBus()
+// setEncoderProperty
+static bool setEncoderProperty( GstElement* pipeline, const char** names, uint32_t value )
 {
-	while(true)
+	if( !pipeline )
+		return false;
+
+	GstElement* encoder = gst_bin_get_by_name(GST_BIN(pipeline), "encoder");
+
+	if( !encoder )
+		return false;
+
+	// the hardware and software encoders name these properties differently
+	bool found = false;
+
+	for( uint32_t n=0; names[n] != NULL; n++ )
 	{
-		GstMessage* msg = gst_bus_pop(mBus);
+		GParamSpec* param = g_object_class_find_property(G_OBJECT_GET_CLASS(encoder), names[n]);
 
-		if( !msg )
-			break;
+		if( !param || !(param->flags & G_PARAM_WRITABLE) )
+			continue;
+
+		if( G_PARAM_SPEC_VALUE_TYPE(param) == G_TYPE_INT )
+			g_object_set(G_OBJECT(encoder), names[n], (int)value, NULL);
+		else
+			g_object_set(G_OBJECT(encoder), names[n], value, NULL);
+
+		found = true;
+		break;
+	}
+
+	gst_object_unref(encoder);
+	return found;
+}
+
+
+// SetBitrate
+bool gstEncoder::SetBitrate( uint32_t bitrate )
+{
+	static const char* names[] = { "bitrate", "target-bitrate", NULL };
+
+	if( bitrate == 0 || mOptions.codec == videoOptions::CODEC_MJPEG )
+		return false;
+
+	if( !setEncoderProperty(mPipeline, names, bitrate) )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to set encoder bitrate to %u\n", bitrate);
+		return false;
+	}
+
+	LogVerbose(LOG_GSTREAMER "gstEncoder -- changed bitrate from %u to %u\n", mOptions.bitRate, bitrate);
+	mOptions.bitRate = bitrate;
+	return true;
+}
+
+
+// SetKeyframeInterval
+bool gstEncoder::SetKeyframeInterval( uint32_t frames )
+{
+	static const char* names[] = { "iframeinterval", "key-int-max", "keyframe-max-dist", NULL };
+
+	if( frames == 0 || mOptions.codec == videoOptions::CODEC_MJPEG )
+		return false;
+
+	if( !setEncoderProperty(mPipeline, names, frames) )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to set encoder keyframe interval to %u\n", frames);
+		return false;
+	}
+
+	LogVerbose(LOG_GSTREAMER "gstEncoder -- changed keyframe interval to %u frames\n", frames);
+	return true;
+}
+
+
+// ForceKeyframe
+bool gstEncoder::ForceKeyframe()
+{
+	if( !mPipeline )
+		return false;
+
+	if( mOptions.codec == videoOptions::CODEC_MJPEG )
+		return true;	// every frame is a keyframe
+
+	GstElement* encoder = gst_bin_get_by_name(GST_BIN(mPipeline), "encoder");
+
+	if( !encoder )
+		return false;
+
+	GstPad* pad = gst_element_get_static_pad(encoder, "src");
+	gst_object_unref(encoder);
+
+	if( !pad )
+		return false;
+
+	// this is the same event as gst_video_event_new_upstream_force_key_unit()
+	GstStructure* structure = gst_structure_new("GstForceKeyUnit",
+									    "running-time", GST_TYPE_CLOCK_TIME, GST_CLOCK_TIME_NONE,
+									    "all-headers", G_TYPE_BOOLEAN, TRUE,
+									    "count", G_TYPE_UINT, 0, NULL);
+
+	const bool result = gst_pad_send_event(pad, gst_event_new_custom(GST_EVENT_CUSTOM_UPSTREAM, structure));
+	gst_object_unref(pad);
+
+	if( !result )
+		LogError(LOG_GSTREAMER "gstEncoder -- failed to send keyframe request to the encoder\n");
+	else
+		LogDebug(LOG_GSTREAMER "gstEncoder -- forcing keyframe\n");
+
+	return result;
+}
 
-		gst_message_print(mBus, msg, this);
-		gst_message_unref(msg);
+
+// updateBitrate
+void gstEncoder::updateBitrate( WebRTCPeer* peer, uint32_t bitrate )
+{
+	uint32_t target = mBitrateMax;
+
+	mPeersMutex.Lock();
+
+	if( peer != NULL && peer->user_data != NULL )
+		((gstWebRTC::PeerContext*)peer->user_data)->bitrate = bitrate;
+
+	// the stream is shared, so it's limited by the most congested peer
+	for( size_t n=0; n < mPeers.size(); n++ )
+	{
+		gstWebRTC::PeerContext* peer_context = (gstWebRTC::PeerContext*)mPeers[n]->user_data;
+
+		if( !peer_context || peer_context->bitrate == 0 || peer_context->redirected )
+			continue;
+
+		// with simulcast, move peers that can't keep up to the next lower layer
+		if( mLayerRoute.size() > 0 && peer_context->bitrate < mBitrateMax / 2 )
+		{
+			LogVerbose(LOG_WEBRTC "moving WebRTC peer %u to simulcast layer %s (%u bps estimate)\n", mPeers[n]->ID, mLayerRoute.c_str(), peer_context->bitrate);
+
+			const std::string message = "{\"type\": \"redirect\", \"data\": \"" + mLayerRoute + "\"}";
+			mPeers[n]->server->SendMessage(mPeers[n], message.c_str());
+
+			peer_context->redirected = true;
+			continue;
+		}
+
+		if( peer_context->bitrate < target )
+			target = peer_context->bitrate;
 	}
+
+	mPeersMutex.Unlock();
+
+	if( target < GST_ENCODER_MIN_BITRATE )
+		target = GST_ENCODER_MIN_BITRATE;
+
+	// ignore small fluctuations so the encoder isn't constantly reconfigured
+	const uint32_t current = mOptions.bitRate;
+	const uint32_t delta = (target > current) ? (target - current) : (current - target);
+
+	if( delta < current / 20 )
+		return;
+
+	LogVerbose(LOG_WEBRTC "congestion control adjusting bitrate to %u\n", target);
+	SetBitrate(target);
+}
+
+
+// onFeedbackRTCP
+void gstEncoder::onFeedbackRTCP( GObject* session, uint32_t type, uint32_t fbtype, uint32_t sender_ssrc, uint32_t media_ssrc, GstBuffer* fci, void* user_data )
+{
+	WebRTCPeer* peer = (WebRTCPeer*)user_data;
+
+	if( !peer || !peer->user_data || type != GST_RTCP_TYPE_PSFB )
+		return;
+
+	gstEncoder* encoder = (gstEncoder*)((gstWebRTC::PeerContext*)peer->user_data)->owner;
+
+	if( !encoder )
+		return;
+
+	if( fbtype == GST_RTCP_PSFB_TYPE_PLI || fbtype == GST_RTCP_PSFB_TYPE_FIR )
+	{
+		LogVerbose(LOG_WEBRTC "WebRTC peer %u requested a keyframe\n", peer->ID);
+		encoder->ForceKeyframe();
+	}
+	else if( fbtype == GST_RTCP_PSFB_TYPE_AFB && fci != NULL )
+	{
+		GstMapInfo map;
+
+		if( !gst_buffer_map(fci, &map, GST_MAP_READ) )
+			return;
+
+		// REMB:  'R' 'E' 'M' 'B', num SSRC (8 bits), exponent (6 bits), mantissa (18 bits)
+		if( map.size >= 8 && memcmp(map.data, "REMB", 4) == 0 )
+		{
+			const uint32_t exponent = map.data[5] >> 2;
+			const uint32_t mantissa = ((map.data[5] & 0x03) << 16) | (map.data[6] << 8) | map.data[7];
+			const uint64_t bitrate  = uint64_t(mantissa) << exponent;
+
+			encoder->updateBitrate(peer, (bitrate > UINT32_MAX) ? UINT32_MAX : bitrate);
+		}
+
+		gst_buffer_unmap(fci, &map);
+	}
+}
+
+
+// onBandwidthEstimate
+void gstEncoder::onBandwidthEstimate( GObject* estimator, GParamSpec* param, void* user_data )
+{
+	WebRTCPeer* peer = (WebRTCPeer*)user_data;
+
+	if( !peer || !peer->user_data )
+		return;
+
+	gstEncoder* encoder = (gstEncoder*)((gstWebRTC::PeerContext*)peer->user_data)->owner;
+
+	if( !encoder )
+		return;
+
+	uint32_t bitrate = 0;
+	g_object_get(estimator, "estimated-bitrate", &bitrate, NULL);
+
+	if( bitrate > 0 )
+		encoder->updateBitrate(peer, bitrate);
+}
+
+
+// onRequestAuxSender
+GstElement* gstEncoder::onRequestAuxSender( GstElement* webrtcbin, GObject* transport, void* user_data )
+{
+	// the transport-cc bandwidth estimator (from gst-plugins-rs) is optional
+	GstElement* estimator = gst_element_factory_make("rtpgccbwe", NULL);
+
+	if( !estimator )
+		return NULL;
+
+	g_signal_connect(estimator, "notify::estimated-bitrate", G_CALLBACK(onBandwidthEstimate), user_data);
+	return estimator;
+}
+
+
+// Split
+bool gstEncoder::Split()
+{
+	if( !mPipeline )
+		return false;
+
+	GstElement* splitsink = gst_bin_get_by_name(GST_BIN(mPipeline), "splitsink");
+
+	if( !splitsink )
+	{
+		LogError(LOG_GSTREAMER "gstEncoder -- Split() requires file output with segmentTime or segmentSize set\n");
+		return false;
+	}
+
+	LogVerbose(LOG_GSTREAMER "gstEncoder -- starting new file segment\n");
+
+	// the split happens on the next keyframe, so the segments stay decodable
+	g_signal_emit_by_name(splitsink, "split-after");
+	gst_object_unref(splitsink);
+
+	return true;
+}
+
+
+// onPeerProbe
+GstPadProbeReturn gstEncoder::onPeerProbe( GstPad* pad, GstPadProbeInfo* info, void* user_data )
+{
+	std::atomic<uint64_t>* counter = (std::atomic<uint64_t>*)user_data;
+
+	if( info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST )
+		*counter += gst_buffer_list_length(GST_PAD_PROBE_INFO_BUFFER_LIST(info));
+	else
+		(*counter)++;
+
+	return GST_PAD_PROBE_OK;
+}
+
+
+// GetPeerStats
+uint32_t gstEncoder::GetPeerStats( std::vector<PeerStats>& stats )
+{
+	stats.clear();
+
+	mPeersMutex.Lock();
+
+	for( size_t n=0; n < mPeers.size(); n++ )
+	{
+		WebRTCPeer* peer = mPeers[n];
+		gstWebRTC::PeerContext* peer_context = (gstWebRTC::PeerContext*)peer->user_data;
+
+		if( !peer_context || !peer_context->queue )
+			continue;
+
+		PeerStats peerStats;
+
+		guint queuedPackets = 0;
+		guint queuedBytes = 0;
+		guint64 queuedTime = 0;
+
+		g_object_get(peer_context->queue, "current-level-buffers", &queuedPackets, "current-level-bytes", &queuedBytes, "current-level-time", &queuedTime, NULL);
+
+		const uint64_t packetsQueued = peer_context->packetsQueued;
+		const uint64_t packetsSent = peer_context->packetsSent;
+
+		peerStats.id             = peer->ID;
+		peerStats.address        = peer->ip_address;
+		peerStats.packetsSent    = packetsSent;
+		peerStats.packetsDropped = (packetsQueued > packetsSent + queuedPackets) ? packetsQueued - packetsSent - queuedPackets : 0;
+		peerStats.queuedPackets  = queuedPackets;
+		peerStats.queuedBytes    = queuedBytes;
+		peerStats.queuedTime     = queuedTime;
+		peerStats.bitrate        = peer_context->bitrate;
+
+		stats.push_back(peerStats);
+	}
+
+	mPeersMutex.Unlock();
+	return stats.size();
+}
+
+
+// SendMetadata
+uint32_t gstEncoder::SendMetadata( const char* message )
+{
+	if( !message )
+		return 0;
+
+	uint32_t sent = 0;
+
+	mPeersMutex.Lock();
+
+	for( size_t n=0; n < mPeers.size(); n++ )
+	{
+		gstWebRTC::PeerContext* peer_context = (gstWebRTC::PeerContext*)mPeers[n]->user_data;
+
+		if( peer_context != NULL && gstWebRTC::SendData(peer_context->dataChannel, message, GST_ENCODER_METADATA_BUFFERED) )
+			sent++;
+	}
+
+	mPeersMutex.Unlock();
+
+	// viewers that were moved to a lower layer get the same metadata
+	for( size_t n=0; n < mLayers.size(); n++ )
+		sent += mLayers[n]->SendMetadata(message);
+
+	return sent;
+}
+
+
+// escape a string for JSON
+static void jsonString( std::ostringstream& ss, const std::string& str )
+{
+	ss << '"';
+
+	for( size_t n=0; n < str.size(); n++ )
+	{
+		const char c = str[n];
+
+		if( c == '"' || c == '\\' )
+			ss << '\\' << c;
+		else if( (unsigned char)c < 0x20 )
+			ss << ' ';
+		else
+			ss << c;
+	}
+
+	ss << '"';
+}
+
+
+// SendDetections
+uint32_t gstEncoder::SendDetections( const std::vector<Detection>& detections )
+{
+	if( mWebRTCServer == NULL )
+		return 0;
+
+	std::ostringstream ss;
+
+	ss << "{\"type\":\"detections\",\"frame\":" << mOptions.frameCount << ",\"pts\":" << mTimestamp;
+	ss << ",\"width\":" << GetWidth() << ",\"height\":" << GetHeight() << ",\"objects\":[";
+
+	for( size_t n=0; n < detections.size(); n++ )
+	{
+		const Detection& det = detections[n];
+
+		if( n > 0 )
+			ss << ',';
+
+		ss << "{\"box\":[" << det.left << ',' << det.top << ',' << det.right << ',' << det.bottom << "],\"label\":";
+		jsonString(ss, det.label);
+		ss << ",\"confidence\":" << det.confidence << '}';
+	}
+
+	ss << "]}";
+	return SendMetadata(ss.str().c_str());
 }
 
 
@@ -743,6 +2032,7 @@ void gstEncoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size
 		
 		// new peer context
 		peer_context = new gstWebRTC::PeerContext();
+		peer_context->owner = encoder;
 		peer->user_data = peer_context;
 		
 		// create a new queue element
@@ -752,6 +2042,9 @@ void gstEncoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size
 		gst_object_ref(peer_context->queue);
 		g_free(tmp);
 		
+		// a viewer that falls behind drops its own oldest packets instead of blocking the tee (and the other viewers)
+		g_object_set(peer_context->queue, "leaky", 2, "max-size-buffers", 0, "max-size-bytes", 0, "max-size-time", (guint64)GST_ENCODER_PEER_QUEUE_TIME, NULL);
+		
 		// create a new webrtcbin element
 		tmp = g_strdup_printf("webrtcbin-%u", peer->ID);
 		peer_context->webrtcbin = gst_element_factory_make("webrtcbin", tmp);
@@ -763,6 +2056,9 @@ void gstEncoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size
 		std::string stun_server = std::string("stun://") + peer->server->GetSTUNServer();
 		g_object_set(peer_context->webrtcbin, "stun-server", stun_server.c_str(), NULL);
 		g_object_set(peer_context->webrtcbin, "latency", encoder->mOptions.latency, NULL);   // this doesn't seem to have an impact?
+	#if GST_CHECK_VERSION(1,16,0)
+		g_object_set(peer_context->webrtcbin, "bundle-policy", GST_WEBRTC_BUNDLE_POLICY_MAX_BUNDLE, NULL);  // one ICE/DTLS transport per viewer
+	#endif
 	
 		// set latency on the rtpbin (https://github.com/centricular/gstwebrtc-demos/issues/102#issuecomment-575157321)
 		GstElement* rtpbin = gst_bin_get_by_name(GST_BIN(peer_context->webrtcbin), "rtpbin");
@@ -770,6 +2066,12 @@ void gstEncoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size
 		g_object_set(rtpbin, "latency", encoder->mOptions.latency, NULL);
 		gst_object_unref(rtpbin);
 		
+	#if GST_CHECK_VERSION(1,20,0)
+		// insert the transport-cc bandwidth estimator (if it's installed)
+		if( gst_element_available("rtpgccbwe") )
+			g_signal_connect(peer_context->webrtcbin, "request-aux-sender", G_CALLBACK(onRequestAuxSender), peer);
+	#endif
+		
 		// add queue and webrtcbin elements to the pipeline
 		gst_bin_add_many(GST_BIN(encoder->mPipeline), peer_context->queue, peer_context->webrtcbin, NULL);
 		
@@ -783,6 +2085,31 @@ void gstEncoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size
 		gst_object_unref(srcpad);
 		gst_object_unref(sinkpad);
 		
+		// count the packets going in and out of the send queue
+		sinkpad = gst_element_get_static_pad(peer_context->queue, "sink");
+		gst_pad_add_probe(sinkpad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER|GST_PAD_PROBE_TYPE_BUFFER_LIST), onPeerProbe, &peer_context->packetsQueued, NULL);
+		gst_object_unref(sinkpad);
+		
+		srcpad = gst_element_get_static_pad(peer_context->queue, "src");
+		gst_pad_add_probe(srcpad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER|GST_PAD_PROBE_TYPE_BUFFER_LIST), onPeerProbe, &peer_context->packetsSent, NULL);
+		gst_object_unref(srcpad);
+		
+		// subscribe to RTCP feedback (the session gets created when the sink pad is requested)
+		GObject* session = NULL;
+		rtpbin = gst_bin_get_by_name(GST_BIN(peer_context->webrtcbin), "rtpbin");
+		g_signal_emit_by_name(rtpbin, "get-internal-session", 0, &session);
+		gst_object_unref(rtpbin);
+		
+		if( session != NULL )
+		{
+			g_signal_connect(session, "on-feedback-rtcp", G_CALLBACK(onFeedbackRTCP), peer);
+			g_object_unref(session);
+		}
+		else
+		{
+			LogWarning(LOG_WEBRTC "couldn't get the RTP session of WebRTC peer %u (congestion control disabled)\n", peer->ID);
+		}
+		
 		// link the queue to the tee
 		GstElement* tee = gst_bin_get_by_name(GST_BIN(encoder->mPipeline), "videotee");
 		g_assert_nonnull(tee);
@@ -806,6 +2133,10 @@ void gstEncoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size
 		g_object_set(transceiver, "direction", GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_SENDONLY, NULL);
 		g_array_unref(transceivers);
 		
+		// add the metadata channel before negotiation starts, so it's included in the first offer
+		gst_element_set_state(peer_context->webrtcbin, GST_STATE_READY);
+		peer_context->dataChannel = gstWebRTC::CreateDataChannel(peer_context->webrtcbin, "metadata");
+
 		// subscribe to callbacks
 		g_signal_connect(peer_context->webrtcbin, "on-negotiation-needed", G_CALLBACK(gstWebRTC::onNegotiationNeeded), peer);
 		g_signal_connect(peer_context->webrtcbin, "on-ice-candidate", G_CALLBACK(gstWebRTC::onIceCandidate), peer);
@@ -816,12 +2147,28 @@ void gstEncoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size
 		ret = gst_element_sync_state_with_parent(peer_context->webrtcbin);
 		g_assert_true(ret);
 		
+		encoder->mPeersMutex.Lock();
+		encoder->mPeers.push_back(peer);
+		encoder->mPeersMutex.Unlock();
+		
+		// send the new viewer a keyframe so it can start decoding
+		encoder->ForceKeyframe();
 		return;
 	}
 	else if( peer->flags & WEBRTC_PEER_CLOSED )
 	{
 		LogVerbose(LOG_WEBRTC "WebRTC peer disconnected (%s, peer_id=%u)\n", peer->ip_address.c_str(), peer->ID);
 		
+		encoder->mPeersMutex.Lock();
+		encoder->mPeers.erase(std::remove(encoder->mPeers.begin(), encoder->mPeers.end(), peer), encoder->mPeers.end());
+		encoder->mPeersMutex.Unlock();
+		
+		if( peer_context->dataChannel != NULL )
+		{
+			g_object_unref(peer_context->dataChannel);
+			peer_context->dataChannel = NULL;
+		}
+
 		// remove webrtcbin from pipeline
 		gst_bin_remove(GST_BIN(encoder->mPipeline), peer_context->webrtcbin);
 		gst_element_set_state(peer_context->webrtcbin, GST_STATE_NULL);
@@ -843,6 +2190,9 @@ void gstEncoder::onWebsocketMessage( WebRTCPeer* peer, const char* message, size
 		delete peer_context;
 		peer->user_data = NULL;
 		
+		// the bitrate may no longer be limited by this peer
+		encoder->updateBitrate(NULL, 0);
+		
 		return;
 	}
 	
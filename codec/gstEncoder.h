@@ -24,14 +24,74 @@
 #define __GSTREAMER_ENCODER_H__
 
 #include "gstUtility.h"
+#include "gstBufferManager.h"	// ENABLE_NVMM, GST_CAPS_FEATURE_MEMORY_NVMM
+#include "gstBusWatch.h"
 #include "videoOutput.h"
 #include "RingBuffer.h"
+#include "Mutex.h"
+#include "Event.h"
+
+#include <atomic>
+#include <vector>
+
+
+/**
+ * Number of NVMM buffers allocated for zero-copy encoding (when ENABLE_NVMM is used)
+ * @ingroup codec
+ */
+#define GST_ENCODER_NVMM_BUFFERS 4
+
+/**
+ * Number of YUV buffers allocated for encoding from CPU memory.  These get wrapped
+ * without copying and are leased to the pipeline until it releases them.
+ * @ingroup codec
+ */
+#define GST_ENCODER_YUV_BUFFERS 4
+
+/**
+ * Lowest bitrate that WebRTC congestion control will reduce the encoder to (in bits per second)
+ * @ingroup codec
+ */
+#define GST_ENCODER_MIN_BITRATE 250000
+
+/**
+ * Maximum duration of RTP packets that get queued for each WebRTC viewer (in nanoseconds).
+ * If a viewer falls further behind than this, its oldest packets are dropped
+ * instead of holding up the other viewers.
+ * @ingroup codec
+ */
+#define GST_ENCODER_PEER_QUEUE_TIME (500 * GST_MSECOND)
+
+/**
+ * Maximum number of simulcast layers (including the full-resolution stream).
+ * @see videoOptions::simulcast
+ * @ingroup codec
+ */
+#define GST_ENCODER_MAX_LAYERS 3
+
+/**
+ * Maximum number of bytes that can be waiting in a WebRTC viewer's metadata channel.
+ * Metadata for viewers that are further behind than this is skipped, since it's only
+ * useful for the current frame.
+ * @see gstEncoder::SendMetadata()
+ * @ingroup codec
+ */
+#define GST_ENCODER_METADATA_BUFFERED (64 * 1024)
+
+
+/**
+ * Maximum number of encoded packets that can be waiting in the appsink of a `packet://`
+ * output before the oldest ones get dropped (if the packet callback is too slow).
+ * @ingroup codec
+ */
+#define GST_ENCODER_PACKET_QUEUE 8
 
 
 // Forward declarations
 class RTSPServer;
 class WebRTCServer;
 struct WebRTCPeer;
+struct _GstAppSink;
 
 
 /**
@@ -41,6 +101,36 @@ struct WebRTCPeer;
  * or stream over the network to a remote host via RTP/RTSP using UDP/IP.
  * The supported encoder codecs are H.264, H.265, VP8, VP9, and MJPEG.
  *
+ * The same encoded bitstream can be sent to several outputs at once (for example a
+ * file, an RTSP server and any number of WebRTC viewers) by listing them in
+ * videoOptions::extraOutputs.  The colorspace conversion and hardware encoding
+ * are only done once, and the bitstream gets split with a tee after the encoder.
+ *
+ * For WebRTC outputs, the bitrate adapts to the congestion feedback from the
+ * viewers (REMB, or transport-cc when the rtpgccbwe estimator is installed),
+ * using the lowest estimate of all the peers and never exceeding the original bitrate.
+ *
+ * With simulcast (videoOptions::simulcast), RTSP/WebRTC streams are also encoded at
+ * half and quarter resolution by child encoders, which are fed by downscaling each
+ * frame once per layer on the GPU.  WebRTC viewers whose congestion estimate is too
+ * low for the full stream are moved to the next layer, instead of lowering its bitrate.
+ *
+ * Each WebRTC viewer also gets a data channel for per-frame metadata (see SendDetections()),
+ * so that overlays like bounding boxes can be drawn by the browser on top of the video,
+ * instead of being rendered into the frames before encoding.
+ *
+ * Regions of interest (like the objects that were detected in a frame) can be encoded at
+ * a higher quality than the background with SetRegionsOfInterest(), which attaches them
+ * to the next frame as GstVideoRegionOfInterestMeta with a QP delta for the encoder.
+ *
+ * The `packet://` output hands the encoded access units to the application instead
+ * (see SetPacketCallback()), for sending them over its own transport without the
+ * stream getting muxed into a container or packetized into RTP first.
+ *
+ * When built with ENABLE_NVMM on JetPack 4 (OMX codecs), the colorspace conversion
+ * writes directly into NVMM buffers that are passed to the hardware encoder
+ * with `video/x-raw(memory:NVMM)` caps, avoiding any CPU-side copies of the frame.
+ *
  * @note gstEncoder implements the videoOutput interface and is intended to
  * be used through that as opposed to directly.  videoOutput implements
  * additional command-line parsing of videoOptions to construct instances.
@@ -61,6 +151,81 @@ public:
 	 */
 	static gstEncoder* Create( const URI& resource, videoOptions::Codec codec );
 	
+	/**
+	 * Policy for handling frames when the encoder can't keep up (backpressure).
+	 * @see SetBackpressure()
+	 */
+	enum Backpressure
+	{
+		DROP_NEWEST = 0,	/**< Skip the new frame (this is the default) */
+		DROP_OLDEST,		/**< Queue the new frame, and drop the oldest frame that's queued (requires GStreamer 1.20) */
+		BLOCK			/**< Wait for the encoder to accept the frame, up to a timeout */
+	};
+
+	/**
+	 * Send queue statistics of a WebRTC viewer.
+	 * @see GetPeerStats()
+	 */
+	struct PeerStats
+	{
+		uint32_t    id;			/**< The WebRTCPeer ID */
+		std::string address;		/**< IP address of the viewer */
+		uint64_t    packetsSent;	/**< Number of RTP packets that have been passed to the viewer's webrtcbin */
+		uint64_t    packetsDropped;	/**< Number of RTP packets that were dropped because the viewer fell behind */
+		uint32_t    queuedPackets;	/**< Number of RTP packets currently in the viewer's send queue */
+		uint32_t    queuedBytes;	/**< Number of bytes currently in the viewer's send queue */
+		uint64_t    queuedTime;		/**< Duration of the viewer's send queue (in nanoseconds) */
+		uint32_t    bitrate;		/**< The viewer's congestion estimate (in bits per second), or 0 if unknown */
+	};
+
+	/**
+	 * An object to be drawn by the WebRTC viewers on top of the video.
+	 * @see SendDetections()
+	 */
+	struct Detection
+	{
+		float       left;		/**< Left edge of the bounding box (in pixels of the rendered frame) */
+		float       top;		/**< Top edge of the bounding box (in pixels of the rendered frame) */
+		float       right;		/**< Right edge of the bounding box (in pixels of the rendered frame) */
+		float       bottom;		/**< Bottom edge of the bounding box (in pixels of the rendered frame) */
+		float       confidence;	/**< Confidence of the detection (between 0 and 1), or a negative value to hide it */
+		std::string label;		/**< Text to show above the box (may be empty) */
+	};
+
+	/**
+	 * A region of the frame to encode with a different quality than the rest.
+	 * @see SetRegionsOfInterest()
+	 */
+	struct RegionOfInterest
+	{
+		uint32_t left;		/**< Left edge of the region (in pixels of the rendered frame) */
+		uint32_t top;		/**< Top edge of the region (in pixels of the rendered frame) */
+		uint32_t right;	/**< Right edge of the region (exclusive) */
+		uint32_t bottom;	/**< Bottom edge of the region (exclusive) */
+		int      qpDelta;	/**< Offset to the quantizer (negative values are higher quality, e.g. -10) */
+	};
+
+	/**
+	 * An encoded access unit (one frame) from the `packet://` output.
+	 * H.264/H.265 are in Annex-B byte-stream format with the SPS/PPS repeated before
+	 * each keyframe, so that a decoder can start from any keyframe.
+	 * @see SetPacketCallback()
+	 */
+	struct Packet
+	{
+		const void* data;		/**< The encoded bitstream (only valid during the callback) */
+		size_t      size;		/**< Size of the bitstream (in bytes) */
+		uint64_t    pts;		/**< Presentation timestamp (running time in nanoseconds, or GST_CLOCK_TIME_NONE) */
+		uint64_t    dts;		/**< Decoding timestamp (running time in nanoseconds, or GST_CLOCK_TIME_NONE) */
+		bool        keyframe;	/**< True if the frame can be decoded on its own (IDR or I-frame) */
+	};
+
+	/**
+	 * Function that recieves the encoded packets, called from the GStreamer streaming thread.
+	 * @see SetPacketCallback()
+	 */
+	typedef void (*PacketCallback)( const Packet& packet, void* user_data );
+
 	/**
 	 * Destructor
 	 */
@@ -74,6 +239,11 @@ public:
 	
 	/**
 	 * Encode the next frame.
+	 *
+	 * If the dimensions are different than the previous frames, the caps get
+	 * renegotiated with the encoder and the stream continues at the new
+	 * resolution, without the pipeline being restarted.
+	 *
 	 * @see videoOutput::Render()
 	 */
 	virtual bool Render( void* image, uint32_t width, uint32_t height, imageFormat format );
@@ -90,6 +260,107 @@ public:
 	 */
 	virtual void Close();
 
+	/**
+	 * Change the encoder's target bitrate (in bits per second) while it's running.
+	 * This takes effect on the next frames, without restarting the pipeline.
+	 * @returns `true` on success, or `false` if the encoder doesn't support it (e.g. MJPEG).
+	 */
+	bool SetBitrate( uint32_t bitrate );
+
+	/**
+	 * Change the maximum number of frames between keyframes while the encoder is running.
+	 * @returns `true` on success, or `false` if the encoder doesn't support it (e.g. MJPEG).
+	 */
+	bool SetKeyframeInterval( uint32_t frames );
+
+	/**
+	 * Set the policy for handling frames when the encoder is busy.  Backpressure is
+	 * checked before the colorspace conversion, so frames that would be dropped
+	 * don't waste any GPU time.
+	 * @param policy the backpressure policy (DROP_NEWEST by default)
+	 * @param timeout for BLOCK, the max number of milliseconds that Render() waits
+	 *                for the encoder before dropping the frame anyway.
+	 * @returns `true` if the policy is supported, otherwise `false`.
+	 */
+	bool SetBackpressure( Backpressure policy, uint64_t timeout=1000 );
+
+	/**
+	 * Request that the encoder produces a keyframe (IDR frame) as soon as possible.
+	 * This gets called automatically when a WebRTC viewer joins or requests one
+	 * with PLI/FIR feedback, so that it can start decoding without waiting.
+	 * @returns `true` if the request was sent to the encoder, otherwise `false`.
+	 */
+	bool ForceKeyframe();
+
+	/**
+	 * Close the current file segment and start recording the next one, beginning
+	 * on the next keyframe.  This is only supported when the output is a video file
+	 * that's being split into segments (see videoOptions::segmentTime and segmentSize).
+	 * @returns `true` if the next segment was started, otherwise `false`.
+	 */
+	bool Split();
+
+	/**
+	 * Get the send queue statistics of each WebRTC viewer that's currently connected.
+	 * The encoded stream is packetized once and shared by all of the viewers, and each
+	 * viewer only has a send queue and its own DTLS/SRTP session (webrtcbin).
+	 * @returns the number of viewers.
+	 */
+	uint32_t GetPeerStats( std::vector<PeerStats>& stats );
+
+	/**
+	 * Send a text message (typically JSON) over the metadata data channel of each WebRTC viewer,
+	 * including the viewers of the simulcast layers.  The messages are sent unordered and without
+	 * retransmissions, and viewers that have more than GST_ENCODER_METADATA_BUFFERED bytes waiting
+	 * are skipped, so that stale metadata never delays the newer messages.
+	 * @returns the number of viewers that the message was sent to.
+	 */
+	uint32_t SendMetadata( const char* message );
+
+	/**
+	 * Send the objects that were detected in the last frame that was rendered to the WebRTC
+	 * viewers, which the default viewer page draws on top of the video.  The message has the form:
+	 *
+	 *    {"type": "detections", "frame": N, "pts": ns, "width": W, "height": H,
+	 *     "objects": [{"box": [left, top, right, bottom], "label": "...", "confidence": c}, ...]}
+	 *
+	 * where `frame` is GetFrameCount(), and `pts` is the running time of the frame in the pipeline.
+	 * @returns the number of viewers that the detections were sent to.
+	 */
+	uint32_t SendDetections( const std::vector<Detection>& detections );
+
+	/**
+	 * Set the regions of interest for the next frame that gets rendered (e.g. from the
+	 * detections in it), which apply to that frame only.  They get attached to the frame as
+	 * GstVideoRegionOfInterestMeta with the QP delta in a `roi/vaapi` parameter (the format
+	 * that the VA-API encoders read), and are scaled to the resolution of each simulcast layer.
+	 *
+	 * @note Encoders that don't read ROI metadata encode the frame normally.  This includes
+	 *       the V4L2 encoders on Jetson, whose GStreamer plugin doesn't expose its ROI controls,
+	 *       and x264enc.  Other encoders can be given the same regions by a pad probe.
+	 */
+	void SetRegionsOfInterest( const std::vector<RegionOfInterest>& regions );
+
+	/**
+	 * Set the function that recieves the encoded packets from a `packet://` output.
+	 * The packet's data points into the mapped GstBuffer and isn't copied, so the callback
+	 * should send or copy it before returning.  Packets that arrive while no callback
+	 * is set (or that queue up behind a slow callback) are dropped.
+	 */
+	void SetPacketCallback( PacketCallback callback, void* user_data=NULL );
+
+	/**
+	 * Return the number of simulcast layers, including this full-resolution one.
+	 * @see videoOptions::simulcast
+	 */
+	inline uint32_t GetNumLayers() const				{ return mLayers.size() + 1; }
+
+	/**
+	 * Return the encoder of a simulcast layer, where layer 0 is this encoder
+	 * and each layer after it is half the resolution of the previous one.
+	 */
+	inline gstEncoder* GetLayer( uint32_t layer )		{ return (layer == 0) ? this : (layer <= mLayers.size() ? mLayers[layer-1] : NULL); }
+
 	/**
 	 * Return the GStreamer pipeline object.
 	 */
@@ -134,32 +405,120 @@ protected:
 	gstEncoder( const videoOptions& options );
 	
 	bool init();
-
-	void checkMsgBus();
 	bool buildCapsStr();
 	bool buildLaunchStr();
+	bool buildSinkStr( const URI& uri, std::ostringstream& ss, bool primary );
 	bool encodeYUV( void* buffer, size_t size );
 
+	struct YUVLease
+	{
+		gstEncoder* encoder;
+		void*       buffer;	// the mBufferYUV slot that's wrapped by a GstBuffer
+	};
+
+	static void onYUVRelease( void* user_data );
+
+	bool checkBackpressure();
+	bool initLayers();
+	bool renderLayers( void* image, uint32_t width, uint32_t height, imageFormat format );
+	void* importPeer( void* image, uint32_t width, uint32_t height, imageFormat format );
+	bool encodeBuffer( GstBuffer* buffer );
+	bool buildBufferCaps();
+
 	// appsrc callbacks
 	static void onNeedData( GstElement* pipeline, uint32_t size, void* user_data );
 	static void onEnoughData( GstElement* pipeline, void* user_data );
 
+	// appsink callback (packet output)
+	static GstFlowReturn onPacket( _GstAppSink* sink, void* user_data );
+
 	// WebRTC callbacks
 	static void onWebsocketMessage( WebRTCPeer* peer, const char* message, size_t message_size, void* user_data );
+	static void onFeedbackRTCP( GObject* session, uint32_t type, uint32_t fbtype, uint32_t sender_ssrc, uint32_t media_ssrc, GstBuffer* fci, void* user_data );
+	static void onBandwidthEstimate( GObject* estimator, GParamSpec* param, void* user_data );
+	static GstElement* onRequestAuxSender( GstElement* webrtcbin, GObject* transport, void* user_data );
+	static GstPadProbeReturn onPeerProbe( GstPad* pad, GstPadProbeInfo* info, void* user_data );
+
+	// WebRTC congestion control
+	void updateBitrate( WebRTCPeer* peer, uint32_t bitrate );
 
-	GstBus*     mBus;
+	std::vector<WebRTCPeer*> mPeers;
+	Mutex    mPeersMutex;
+	uint32_t mBitrateMax;	// the original bitrate, which the congestion estimates are limited to
+
+	// simulcast layers
+	std::vector<gstEncoder*> mLayers;
+	std::vector<void*>       mLayerBuffers;	// the downscaled frames for each layer
+	std::vector<size_t>      mLayerSizes;
+	std::string              mLayerRoute;	// WebRTC route of the next lower layer, for congested viewers
+
+	std::vector<RegionOfInterest> mRegions;	// regions of interest for the next frame
+
+	gstBusWatch* mBusWatch;
 	GstCaps*    mBufferCaps;
 	GstElement* mAppSrc;
 	GstElement* mPipeline;
+	uint64_t    mTimestamp;		// running time of the last frame that was pushed (in nanoseconds)
 	bool        mNeedData;
+	Event       mNeedDataEvent;	// signalled by onNeedData()
+
+	Backpressure mBackpressure;
+	uint64_t     mBackpressureTimeout;	// in milliseconds
 	
 	std::string  mCapsStr;
 	std::string  mLaunchStr;
 
-	RingBuffer mBufferYUV;
+	RingBuffer  mBufferYUV;
+	imageFormat mFormatYUV;		// I420, or NV12 for the V4L2 encoders (RGBA with the VIC converter)
+
+	cudaStream_t mStream;		// stream the colorspace conversion is queued on
+	cudaEvent_t  mBufferEvent;	// signalled when the conversion into mBufferYUV is complete
+
+	void*  mPeerBuffer;			// frames rendered from another GPU get copied here first
+	size_t mPeerSize;
 	
 	RTSPServer*   mRTSPServer;
 	WebRTCServer* mWebRTCServer;
+
+	GstElement*    mPacketSink;		// appsink of the packet:// output
+	PacketCallback mPacketCallback;
+	void*          mPacketUserData;
+	Mutex          mPacketMutex;	// protects the callback from being changed while it's called
+
+	bool mNvmmUsed;		// true if frames are being encoded from NVMM buffers
+
+#ifdef ENABLE_NVMM
+	struct NvmmBuffer
+	{
+		int    fd;
+		void*  egl;
+		void*  resource;	// cudaGraphicsResource registered to the EGLImage
+		void*  nvbuf;		// NvBuffer handle for wrapping in a GstBuffer
+		size_t nvbufSize;
+		void*  planes[2];	// Y and interleaved UV planes (pitch-linear)
+		size_t pitch[2];
+		uint32_t width;
+		uint32_t height;
+		std::atomic<int> state;	// NvmmState (the release callback only touches the buffer, never the encoder)
+	};
+
+	enum NvmmState
+	{
+		NVMM_FREE = 0,		// the buffer can be rendered into
+		NVMM_IN_USE,		// the buffer is queued in the pipeline
+		NVMM_ORPHANED		// the encoder freed the buffer while it was queued, so the pipeline frees it on release
+	};
+	
+	bool renderNvmm( void* image, uint32_t width, uint32_t height, imageFormat format );
+	bool allocNvmm( uint32_t width, uint32_t height );
+	void freeNvmm();
+	NvmmBuffer* nextNvmm();
+
+	static void destroyNvmm( NvmmBuffer* buffer );
+	static void onNvmmRelease( void* user_data );
+
+	std::vector<NvmmBuffer*> mNvmmBuffers;	// only accessed from the thread calling Render()
+#endif
 };
  
  
@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "gstMultiDecoder.h"
+#include "logging.h"
+
+#include <gst/app/gstappsink.h>
+
+#include <sstream>
+#include <string.h>
+
+
+// constructor
+gstMultiDecoder::gstMultiDecoder()
+{
+	mBus        = NULL;
+	mPipeline   = NULL;
+	mStreaming  = false;
+	mThread     = NULL;
+	mThreadStop = false;
+
+	mCallback       = NULL;
+	mCallbackFormat = IMAGE_RGB8;
+	mCallbackUser   = NULL;
+}
+
+
+// destructor
+gstMultiDecoder::~gstMultiDecoder()
+{
+	Close();
+
+	if( mBus != NULL )
+	{
+		gst_bus_set_sync_handler(mBus, NULL, NULL, NULL);
+		gst_object_unref(mBus);
+		mBus = NULL;
+	}
+
+	if( mPipeline != NULL )
+	{
+		gst_object_unref(mPipeline);
+		mPipeline = NULL;
+	}
+
+	// the sources never had a pipeline of their own
+	const uint32_t numSources = mSources.size();
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		mSources[n]->mEOS = false;
+		mSources[n]->mStreaming = false;
+
+		delete mSources[n];
+	}
+
+	mSources.clear();
+}
+
+
+// Create
+gstMultiDecoder* gstMultiDecoder::Create( const std::vector<videoOptions>& sources )
+{
+	gstMultiDecoder* dec = new gstMultiDecoder();
+
+	if( !dec )
+		return NULL;
+
+	if( !dec->init(sources) )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to create decoder for %zu sources\n", sources.size());
+		delete dec;
+		return NULL;
+	}
+
+	return dec;
+}
+
+
+// Create
+gstMultiDecoder* gstMultiDecoder::Create( const std::vector<std::string>& resources, videoOptions::Codec codec )
+{
+	std::vector<videoOptions> sources(resources.size());
+
+	for( size_t n=0; n < resources.size(); n++ )
+	{
+		sources[n].resource = resources[n].c_str();
+		sources[n].codec    = codec;
+		sources[n].ioType   = videoOptions::INPUT;
+	}
+
+	return Create(sources);
+}
+
+
+// init
+bool gstMultiDecoder::init( const std::vector<videoOptions>& sources )
+{
+	const uint32_t numSources = sources.size();
+
+	if( numSources == 0 )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- no sources were provided\n");
+		return false;
+	}
+
+	// discover each source and build its branch of the pipeline
+	std::ostringstream ss;
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		videoOptions options = sources[n];
+
+		if( options.resource.protocol == "webrtc" )
+		{
+			LogError(LOG_GSTREAMER "gstMultiDecoder -- WebRTC sources aren't supported (%s)\n", options.resource.string.c_str());
+			return false;
+		}
+
+		if( options.save.path.length() > 0 )
+		{
+			LogWarning(LOG_GSTREAMER "gstMultiDecoder -- saving isn't supported, ignoring --input-save for %s\n", options.resource.string.c_str());
+			options.save = URI();
+		}
+
+		if( options.loop != 0 )
+		{
+			LogWarning(LOG_GSTREAMER "gstMultiDecoder -- looping isn't supported, ignoring --loop for %s\n", options.resource.string.c_str());
+			options.loop = 0;
+		}
+
+		options.deviceType = videoOptions::DeviceTypeFromStr(options.resource.protocol.c_str());
+
+		gstDecoder* source = new gstDecoder(options);
+
+		if( !source )
+			return false;
+
+		mSources.push_back(source);
+
+		// every branch ends in its own appsink
+		std::ostringstream sinkName;
+		sinkName << "sink" << n;
+		source->mSinkName = sinkName.str();
+
+		if( !source->initLaunchStr() )
+		{
+			LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to build pipeline for %s\n", options.resource.string.c_str());
+			return false;
+		}
+
+		ss << source->mLaunchStr << " ";
+	}
+
+	// create the pipeline with all of the branches
+	mLaunchStr = ss.str();
+
+	LogInfo(LOG_GSTREAMER "gstMultiDecoder -- pipeline string:\n");
+	LogInfo(LOG_GSTREAMER "%s\n", mLaunchStr.c_str());
+
+	GError* err = NULL;
+	mPipeline = gst_parse_launch(mLaunchStr.c_str(), &err);
+
+	if( err != NULL )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to create pipeline\n");
+		LogError(LOG_GSTREAMER "   (%s)\n", err->message);
+		g_error_free(err);
+		return false;
+	}
+
+	GstPipeline* pipeline = GST_PIPELINE(mPipeline);
+
+	if( !pipeline )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to cast GstElement into GstPipeline\n");
+		return false;
+	}
+
+	mBus = gst_pipeline_get_bus(pipeline);
+
+	if( !mBus )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to retrieve GstBus from pipeline\n");
+		return false;
+	}
+
+	// hook up the appsinks to their sources
+	mContexts.resize(numSources);
+	mPending.resize(numSources, false);
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		GstElement* appsinkElement = gst_bin_get_by_name(GST_BIN(pipeline), mSources[n]->mSinkName.c_str());
+		GstAppSink* appsink = GST_APP_SINK(appsinkElement);
+
+		if( !appsinkElement || !appsink )
+		{
+			LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to retrieve AppSink element '%s' from pipeline\n", mSources[n]->mSinkName.c_str());
+			return false;
+		}
+
+		mSources[n]->mAppSink = appsink;
+
+		mContexts[n].decoder = this;
+		mContexts[n].index   = n;
+
+		GstAppSinkCallbacks cb;
+		memset(&cb, 0, sizeof(GstAppSinkCallbacks));
+
+		cb.eos         = onEOS;
+		cb.new_preroll = onPreroll;
+	#if GST_CHECK_VERSION(1,0,0)
+		cb.new_sample  = onBuffer;
+	#else
+		cb.new_buffer  = onBuffer;
+	#endif
+
+		gst_app_sink_set_callbacks(appsink, &cb, (void*)&mContexts[n], NULL);
+	}
+
+	// link the RTSP sources and setup their reconnection
+	bool reconnect = false;
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		if( mSources[n]->mOptions.resource.protocol != "rtsp" )
+			continue;
+
+		if( !mSources[n]->initRTSP(mPipeline) )
+			return false;
+
+		if( mSources[n]->mOptions.reconnect > 0 )
+			reconnect = true;
+	}
+
+	if( reconnect )
+		gst_bus_set_sync_handler(mBus, onBusMessage, this, NULL);
+
+	return true;
+}
+
+
+// onBusMessage
+GstBusSyncReply gstMultiDecoder::onBusMessage( GstBus* bus, GstMessage* msg, void* user_data )
+{
+	gstMultiDecoder* dec = (gstMultiDecoder*)user_data;
+
+	if( !dec )
+		return GST_BUS_PASS;
+
+	// each source checks if the message came from its own rtspsrc
+	const uint32_t numSources = dec->mSources.size();
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		if( dec->mSources[n]->mOptions.reconnect > 0 )
+			gstDecoder::onBusMessage(bus, msg, dec->mSources[n]);
+	}
+
+	return GST_BUS_PASS;
+}
+
+
+// onEOS
+void gstMultiDecoder::onEOS( _GstAppSink* sink, void* user_data )
+{
+	sourceContext* ctx = (sourceContext*)user_data;
+
+	if( !ctx )
+		return;
+
+	LogWarning(LOG_GSTREAMER "gstMultiDecoder -- end of stream (EOS) for source %u\n", ctx->index);
+	ctx->decoder->mSources[ctx->index]->mEOS = true;
+}
+
+
+// onPreroll
+GstFlowReturn gstMultiDecoder::onPreroll( _GstAppSink* sink, void* user_data )
+{
+#if GST_CHECK_VERSION(1,0,0)
+	// pull and free the preroll buffer, otherwise the pipeline may hang during shutdown
+	GstSample* gstSample = gst_app_sink_pull_preroll(sink);
+
+	if( gstSample != NULL )
+		gst_sample_unref(gstSample);
+#endif
+
+	return GST_FLOW_OK;
+}
+
+
+// onBuffer
+GstFlowReturn gstMultiDecoder::onBuffer( _GstAppSink* sink, void* user_data )
+{
+	sourceContext* ctx = (sourceContext*)user_data;
+
+	if( !ctx )
+		return GST_FLOW_OK;
+
+	gstMultiDecoder* dec = ctx->decoder;
+
+	// enqueue the frame into the source's buffer manager (from this branch's streaming thread)
+	dec->mSources[ctx->index]->checkBuffer();
+
+	// let the delivery thread know which source has a new frame
+	dec->mMutex.Lock();
+	dec->mPending[ctx->index] = true;
+	dec->mMutex.Unlock();
+
+	dec->mFrameEvent.Wake();
+	return GST_FLOW_OK;
+}
+
+
+// dequeue
+bool gstMultiDecoder::dequeue( uint32_t source, void** image, imageFormat format, uint64_t timeout )
+{
+	gstDecoder* src = mSources[source];
+
+	if( !src->mBufferManager->Dequeue(image, format, timeout) )
+		return false;
+
+	src->mLastTimestamp = src->mBufferManager->GetLastTimestamp();
+	src->mLastCaptureTime = src->mBufferManager->GetLastTimestamps().capture;
+	src->mRawFormat = src->mBufferManager->GetRawFormat();
+
+	src->stampCapture(*image, format);
+	return true;
+}
+
+
+// Capture
+bool gstMultiDecoder::Capture( uint32_t source, void** image, imageFormat format, uint64_t timeout )
+{
+	if( !image )
+		return false;
+
+	if( source >= mSources.size() )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder::Capture() -- invalid source %u (there are %zu sources)\n", source, mSources.size());
+		return false;
+	}
+
+	if( mThread != NULL )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder::Capture() -- the frames are being delivered to the callback instead\n");
+		return false;
+	}
+
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	checkMsgBus();
+
+	if( !dequeue(source, image, format, timeout) )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to retrieve next image buffer from source %u\n", source);
+		return false;
+	}
+
+	return true;
+}
+
+
+// SetCallback
+void gstMultiDecoder::SetCallback( gstMultiDecoderCallback callback, imageFormat format, void* user )
+{
+	stopThread();
+
+	mCallback       = callback;
+	mCallbackFormat = format;
+	mCallbackUser   = user;
+
+	if( mStreaming )
+		startThread();
+}
+
+
+// startThread
+bool gstMultiDecoder::startThread()
+{
+	if( mThread != NULL || !mCallback )
+		return true;
+
+	mThreadStop = false;
+	mThread = new Thread();
+
+	if( !mThread->Start(deliveryThread, this) )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to start the callback thread\n");
+		delete mThread;
+		mThread = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+
+// stopThread
+void gstMultiDecoder::stopThread()
+{
+	if( !mThread )
+		return;
+
+	mThreadStop = true;
+	mFrameEvent.Wake();
+
+	mThread->Stop(true);
+	delete mThread;
+	mThread = NULL;
+}
+
+
+// deliveryThread
+void* gstMultiDecoder::deliveryThread( void* user )
+{
+	gstMultiDecoder* dec = (gstMultiDecoder*)user;
+
+	if( !dec )
+		return NULL;
+
+	const uint32_t numSources = dec->mSources.size();
+
+	while( !dec->mThreadStop )
+	{
+		// wake up periodically to poll the bus, even if the streams stalled
+		const bool newFrames = dec->mFrameEvent.Wait(100);
+
+		dec->checkMsgBus();
+
+		if( !newFrames || dec->mThreadStop )
+			continue;
+
+		// convert and deliver the new frame from each source that has one
+		for( uint32_t n=0; n < numSources && !dec->mThreadStop; n++ )
+		{
+			dec->mMutex.Lock();
+			const bool pending = dec->mPending[n];
+			dec->mPending[n] = false;
+			dec->mMutex.Unlock();
+
+			if( !pending )
+				continue;
+
+			void* image = NULL;
+
+			if( !dec->dequeue(n, &image, dec->mCallbackFormat, 0) )
+				continue;
+
+			dec->mCallback(n, image, dec->GetWidth(n), dec->GetHeight(n), dec->mCallbackFormat, dec->GetLastTimestamp(n), dec->mCallbackUser);
+		}
+	}
+
+	return NULL;
+}
+
+
+// Open
+bool gstMultiDecoder::Open()
+{
+	if( mStreaming )
+		return true;
+
+	LogInfo(LOG_GSTREAMER "opening gstMultiDecoder for streaming from %zu sources, transitioning pipeline to GST_STATE_PLAYING\n", mSources.size());
+
+	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_PLAYING);
+
+	if( result != GST_STATE_CHANGE_ASYNC && result != GST_STATE_CHANGE_SUCCESS )
+	{
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to set pipeline state to PLAYING (error %u)\n", result);
+		return false;
+	}
+
+	checkMsgBus();
+	mStreaming = true;
+
+	for( size_t n=0; n < mSources.size(); n++ )
+		mSources[n]->mStreaming = true;
+
+	return startThread();
+}
+
+
+// Close
+void gstMultiDecoder::Close()
+{
+	stopThread();
+
+	if( !mStreaming )
+		return;
+
+	LogInfo(LOG_GSTREAMER "gstMultiDecoder -- stopping pipeline, transitioning to GST_STATE_NULL\n");
+
+	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_NULL);
+
+	if( result != GST_STATE_CHANGE_SUCCESS )
+		LogError(LOG_GSTREAMER "gstMultiDecoder -- failed to stop pipeline (error %u)\n", result);
+
+	checkMsgBus();
+	mStreaming = false;
+
+	for( size_t n=0; n < mSources.size(); n++ )
+		mSources[n]->mStreaming = false;
+
+	LogInfo(LOG_GSTREAMER "gstMultiDecoder -- pipeline stopped\n");
+}
+
+
+// checkMsgBus
+void gstMultiDecoder::checkMsgBus()
+{
+	if( !mBus )
+		return;
+
+	while(true)
+	{
+		GstMessage* msg = gst_bus_pop(mBus);
+
+		if( !msg )
+			break;
+
+		gst_message_print(mBus, msg, this);
+		gst_message_unref(msg);
+	}
+}
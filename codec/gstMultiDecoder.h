@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GSTREAMER_MULTI_DECODER_H__
+#define __GSTREAMER_MULTI_DECODER_H__
+
+#include "gstDecoder.h"
+
+#include "Thread.h"
+#include "Event.h"
+#include "Mutex.h"
+
+#include <string>
+#include <vector>
+
+
+/**
+ * Callback that receives the frames decoded by gstMultiDecoder (see gstMultiDecoder::SetCallback())
+ *
+ * @param source the index of the source the frame came from (in the order they were passed to Create())
+ * @param image the decoded image in CUDA memory, which is only valid until the callback returns
+ * @param width the width of the image (in pixels)
+ * @param height the height of the image (in pixels)
+ * @param format the format of the image (the one that was passed to SetCallback())
+ * @param timestamp the timestamp of the frame (in nanoseconds)
+ * @param user the user pointer that was passed to SetCallback()
+ *
+ * @ingroup codec
+ */
+typedef void (*gstMultiDecoderCallback)( uint32_t source, void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, void* user );
+
+
+/**
+ * Decodes many video streams (e.g. dozens of RTSP cameras) in a single GStreamer pipeline.
+ *
+ * Each source is discovered and gets a branch in the pipeline that's built the same way as it
+ * would be by gstDecoder, which ends in its own appsink.  Because those branches are all in one
+ * pipeline, the sources share its clock and one bus that gets polled, and a single thread converts
+ * the frames and delivers them to the callback from SetCallback() - as opposed to having a pipeline,
+ * bus and conversion thread per stream with separate gstDecoder instances.  Frames can also be
+ * pulled from each source with Capture() instead of using the callback (but not both at once).
+ *
+ * @note looping, seeking, saving (`--input-save`) and WebRTC sources aren't supported, because
+ *       they would apply to every source in the shared pipeline.  Set videoOptions::lowLatency on
+ *       the sources to only ever deliver the newest frame from each of them.  RTSP sources with
+ *       videoOptions::reconnect set are restarted independently, without affecting the others.
+ *
+ * @ingroup codec
+ */
+class gstMultiDecoder
+{
+public:
+	/**
+	 * Create a multi-source decoder from the video options of each source.
+	 */
+	static gstMultiDecoder* Create( const std::vector<videoOptions>& sources );
+
+	/**
+	 * Create a multi-source decoder from a list of resource URIs (all with the same codec).
+	 */
+	static gstMultiDecoder* Create( const std::vector<std::string>& resources, videoOptions::Codec codec=videoOptions::CODEC_UNKNOWN );
+
+	/**
+	 * Destructor
+	 */
+	~gstMultiDecoder();
+
+	/**
+	 * Start streaming from all of the sources (and the callback thread, if a callback was set).
+	 */
+	bool Open();
+
+	/**
+	 * Stop streaming from all of the sources.
+	 */
+	void Close();
+
+	/**
+	 * Capture the next decoded frame from one of the sources.
+	 * @see videoSource::Capture()
+	 */
+	template<typename T> bool Capture( uint32_t source, T** image, uint64_t timeout=UINT64_MAX )	{ return Capture(source, (void**)image, imageFormatFromType<T>(), timeout); }
+
+	/**
+	 * Capture the next decoded frame from one of the sources.
+	 * @see videoSource::Capture()
+	 */
+	bool Capture( uint32_t source, void** image, imageFormat format, uint64_t timeout=UINT64_MAX );
+
+	/**
+	 * Set the callback that receives the frames from every source, which gets called from
+	 * one thread that's started by Open() (or immediately if the decoder is already open).
+	 * Set the callback to NULL to stop the thread and go back to using Capture().
+	 *
+	 * @param callback the function that gets called with each new frame
+	 * @param format the format that the frames get converted to
+	 * @param user pointer that gets passed to the callback
+	 */
+	void SetCallback( gstMultiDecoderCallback callback, imageFormat format=IMAGE_RGB8, void* user=NULL );
+
+	/**
+	 * Return true if the sources are streaming.
+	 */
+	inline bool IsStreaming() const					{ return mStreaming; }
+
+	/**
+	 * Return true if one of the sources has reached the end of its stream.
+	 */
+	inline bool IsEOS( uint32_t source ) const			{ return mSources[source]->IsEOS(); }
+
+	/**
+	 * Get the number of sources.
+	 */
+	inline uint32_t GetNumSources() const				{ return mSources.size(); }
+
+	/**
+	 * Get the video options of one of the sources (including its discovered size and framerate).
+	 */
+	inline const videoOptions& GetOptions( uint32_t source ) const	{ return mSources[source]->GetOptions(); }
+
+	/**
+	 * Get the width of one of the sources (in pixels).
+	 */
+	inline uint32_t GetWidth( uint32_t source ) const		{ return mSources[source]->GetWidth(); }
+
+	/**
+	 * Get the height of one of the sources (in pixels).
+	 */
+	inline uint32_t GetHeight( uint32_t source ) const		{ return mSources[source]->GetHeight(); }
+
+	/**
+	 * Get the timestamp of the last frame captured from one of the sources (in nanoseconds).
+	 */
+	inline uint64_t GetLastTimestamp( uint32_t source ) const	{ return mSources[source]->GetLastTimestamp(); }
+
+protected:
+	gstMultiDecoder();
+
+	bool init( const std::vector<videoOptions>& sources );
+
+	bool startThread();
+	void stopThread();
+	void checkMsgBus();
+	bool dequeue( uint32_t source, void** image, imageFormat format, uint64_t timeout );
+
+	static void* deliveryThread( void* user );
+
+	// appsink callbacks
+	static void onEOS( _GstAppSink* sink, void* user_data );
+	static GstFlowReturn onPreroll( _GstAppSink* sink, void* user_data );
+	static GstFlowReturn onBuffer( _GstAppSink* sink, void* user_data );
+
+	// bus callback (for RTSP reconnection)
+	static GstBusSyncReply onBusMessage( GstBus* bus, GstMessage* msg, void* user_data );
+
+	struct sourceContext
+	{
+		gstMultiDecoder* decoder;
+		uint32_t index;
+	};
+
+	GstBus*     mBus;
+	GstElement* mPipeline;
+	std::string mLaunchStr;
+	bool        mStreaming;
+
+	std::vector<gstDecoder*>   mSources;
+	std::vector<sourceContext> mContexts;
+	std::vector<bool>          mPending;	// sources with a new frame (protected by mMutex)
+
+	Thread*       mThread;
+	Event         mFrameEvent;
+	Mutex         mMutex;
+	volatile bool mThreadStop;
+
+	gstMultiDecoderCallback mCallback;
+	imageFormat             mCallbackFormat;
+	void*                   mCallbackUser;
+};
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gstSegmentDecoder.h"
+#include "logging.h"
+
+#include <gst/app/gstappsink.h>
+
+#include <algorithm>
+
+
+// constructor
+gstSegmentDecoder::gstSegmentDecoder( const videoOptions& options )
+{
+	mOptions        = options;
+	mNextSegment    = 0;
+	mCallback       = NULL;
+	mCallbackFormat = IMAGE_UNKNOWN;
+	mCallbackUser   = NULL;
+	mFramesDecoded  = 0;
+}
+
+
+// destructor
+gstSegmentDecoder::~gstSegmentDecoder()
+{
+	for( size_t n=0; n < mWorkers.size(); n++ )
+	{
+		SAFE_DELETE(mWorkers[n]->decoder);
+		delete mWorkers[n];
+	}
+}
+
+
+// Create
+gstSegmentDecoder* gstSegmentDecoder::Create( const videoOptions& options, uint32_t numDecoders )
+{
+	gstSegmentDecoder* dec = new gstSegmentDecoder(options);
+
+	if( !dec )
+		return NULL;
+
+	if( !dec->init(numDecoders) )
+	{
+		LogError(LOG_GSTREAMER "gstSegmentDecoder -- failed to create decoder for %s\n", options.resource.string.c_str());
+		delete dec;
+		return NULL;
+	}
+
+	return dec;
+}
+
+
+// Create
+gstSegmentDecoder* gstSegmentDecoder::Create( const char* filename, uint32_t numDecoders, videoOptions::Codec codec )
+{
+	videoOptions options;
+
+	options.resource = filename;
+	options.codec    = codec;
+	options.ioType   = videoOptions::INPUT;
+
+	return Create(options, numDecoders);
+}
+
+
+// init
+bool gstSegmentDecoder::init( uint32_t numDecoders )
+{
+	if( numDecoders == 0 )
+	{
+		LogError(LOG_GSTREAMER "gstSegmentDecoder -- the number of decoders needs to be at least 1\n");
+		return false;
+	}
+
+	// every frame is needed once, in whatever order the segments finish
+	mOptions.loop = 0;
+	mOptions.lowLatency = false;
+
+	for( uint32_t n=0; n < numDecoders; n++ )
+	{
+		Worker* worker = new Worker();
+
+		worker->owner   = this;
+		worker->decoder = gstDecoder::Create(mOptions);
+		worker->segment = 0;
+		worker->frames  = 0;
+		worker->active  = false;
+		worker->failed  = false;
+
+		mWorkers.push_back(worker);
+
+		if( !worker->decoder )
+			return false;
+
+		gstDecoder* decoder = worker->decoder;
+
+		if( decoder->mOptions.deviceType != videoOptions::DEVICE_FILE )
+		{
+			LogError(LOG_GSTREAMER "gstSegmentDecoder -- %s isn't a video file\n", mOptions.resource.string.c_str());
+			return false;
+		}
+
+		// decode as fast as possible, instead of at the framerate of the file
+		g_object_set(G_OBJECT(decoder->mAppSink), "sync", FALSE, NULL);
+
+		if( n == 0 )
+		{
+			// index the file once, and share it with the other decoders
+			if( !decoder->buildIndex() )
+			{
+				LogError(LOG_GSTREAMER "gstSegmentDecoder -- failed to index the frames of %s\n", mOptions.resource.string.c_str());
+				return false;
+			}
+
+			mFrameIndex = decoder->mFrameIndex;
+		}
+		else
+		{
+			decoder->mFrameIndex    = mWorkers[0]->decoder->mFrameIndex;
+			decoder->mKeyframeIndex = mWorkers[0]->decoder->mKeyframeIndex;
+			decoder->mIndexReady    = true;
+		}
+	}
+
+	return split(numDecoders * GST_SEGMENT_DECODER_SEGMENTS);
+}
+
+
+// split
+bool gstSegmentDecoder::split( uint32_t numSegments )
+{
+	const std::vector<uint64_t>& keyframes = mWorkers[0]->decoder->mKeyframeIndex;
+	const uint64_t numFrames = mFrameIndex.size();
+
+	if( numFrames == 0 || keyframes.size() == 0 )
+		return false;
+
+	const uint64_t segmentFrames = std::max<uint64_t>(numFrames / numSegments, 1);
+
+	// start a new segment at the first keyframe once the current one has enough frames
+	mSegments.clear();
+
+	for( size_t n=0; n < keyframes.size(); n++ )
+	{
+		const uint64_t frame = std::lower_bound(mFrameIndex.begin(), mFrameIndex.end(), keyframes[n]) - mFrameIndex.begin();
+
+		if( mSegments.size() > 0 )
+		{
+			Segment& prev = mSegments.back();
+
+			if( frame - prev.firstFrame < segmentFrames )
+				continue;
+
+			prev.numFrames = frame - prev.firstFrame;
+			prev.stop = keyframes[n];
+		}
+
+		Segment segment;
+
+		segment.firstFrame = (mSegments.size() > 0) ? frame : 0;	// include any frames before the first keyframe
+		segment.numFrames  = 0;
+		segment.start      = (mSegments.size() > 0) ? keyframes[n] : 0;
+		segment.stop       = GST_CLOCK_TIME_NONE;
+
+		mSegments.push_back(segment);
+	}
+
+	mSegments.back().numFrames = numFrames - mSegments.back().firstFrame;
+
+	LogVerbose(LOG_GSTREAMER "gstSegmentDecoder -- split %s into %zu segments (%lu frames, %zu keyframes)\n", mOptions.resource.string.c_str(), mSegments.size(), numFrames, keyframes.size());
+	return true;
+}
+
+
+// nextSegment
+bool gstSegmentDecoder::nextSegment( uint32_t* segment )
+{
+	mSegmentMutex.Lock();
+
+	const bool available = (mNextSegment < mSegments.size());
+
+	if( available )
+		*segment = mNextSegment++;
+
+	mSegmentMutex.Unlock();
+	return available;
+}
+
+
+// Run
+bool gstSegmentDecoder::Run( gstSegmentDecoderCallback callback, imageFormat format, void* user )
+{
+	if( !callback )
+		return false;
+
+	mCallback       = callback;
+	mCallbackFormat = format;
+	mCallbackUser   = user;
+	mFramesDecoded  = 0;
+	mNextSegment    = 0;
+
+	for( size_t n=0; n < mWorkers.size(); n++ )
+	{
+		mWorkers[n]->decoder->SetCallback(onFrame, format, mWorkers[n]);
+		mWorkers[n]->failed = false;
+
+		if( !mWorkers[n]->thread.Start(workerThread, mWorkers[n]) )
+		{
+			LogError(LOG_GSTREAMER "gstSegmentDecoder -- failed to start decoder thread %zu\n", n);
+			mWorkers[n]->failed = true;
+		}
+	}
+
+	bool success = true;
+
+	for( size_t n=0; n < mWorkers.size(); n++ )
+	{
+		mWorkers[n]->thread.Stop(true);
+
+		if( mWorkers[n]->failed )
+			success = false;
+	}
+
+	// segments that weren't taken by any thread (if they all failed to start)
+	if( mNextSegment < mSegments.size() )
+		success = false;
+
+	LogVerbose(LOG_GSTREAMER "gstSegmentDecoder -- decoded %lu of %lu frames from %s\n", (uint64_t)mFramesDecoded, GetNumFrames(), mOptions.resource.string.c_str());
+	return success;
+}
+
+
+// workerThread
+void* gstSegmentDecoder::workerThread( void* user )
+{
+	Worker* worker = (Worker*)user;
+
+	if( !worker )
+		return NULL;
+
+	gstSegmentDecoder* owner = worker->owner;
+	gstDecoder* decoder = worker->decoder;
+
+	uint32_t segment = 0;
+
+	while( owner->nextSegment(&segment) )
+	{
+		const Segment& seg = owner->mSegments[segment];
+
+		worker->segment = segment;
+		worker->frames  = 0;
+		worker->active  = true;
+
+		worker->done.Reset();
+
+		if( !decoder->seekSegment(seg.start, seg.stop) )
+		{
+			LogError(LOG_GSTREAMER "gstSegmentDecoder -- failed to start decoding segment %u\n", segment);
+			worker->active = false;
+			worker->failed = true;
+			break;
+		}
+
+		// the callback signals once it has all the frames of the segment (or else wait for EOS)
+		while( !worker->done.Wait(100) && !decoder->IsEOS() && decoder->IsStreaming() );
+
+		worker->active = false;
+
+		if( worker->frames < seg.numFrames )
+			LogWarning(LOG_GSTREAMER "gstSegmentDecoder -- segment %u was missing %lu of %lu frames\n", segment, seg.numFrames - worker->frames, seg.numFrames);
+	}
+
+	decoder->Close();
+	return NULL;
+}
+
+
+// onFrame
+void gstSegmentDecoder::onFrame( videoSource* source, void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, void* user )
+{
+	Worker* worker = (Worker*)user;
+
+	if( !worker || !worker->active )
+		return;
+
+	gstSegmentDecoder* owner = worker->owner;
+	const Segment& seg = owner->mSegments[worker->segment];
+
+	// look up the index of the frame from its presentation timestamp
+	const uint64_t pts = ((gstDecoder*)source)->GetLastTimestamps().pts;
+
+	if( pts == GST_CLOCK_TIME_NONE )
+		return;
+
+	std::vector<uint64_t>::const_iterator iter = std::lower_bound(owner->mFrameIndex.begin(), owner->mFrameIndex.end(), pts);
+
+	if( iter == owner->mFrameIndex.end() || (iter != owner->mFrameIndex.begin() && (*iter - pts) > (pts - *(iter-1))) )
+		iter--;	// the decoder might have rounded the timestamp differently
+
+	const uint64_t frame = iter - owner->mFrameIndex.begin();
+
+	// skip frames that belong to other segments (e.g. from before the seek)
+	if( frame < seg.firstFrame || frame >= seg.firstFrame + seg.numFrames )
+		return;
+
+	owner->mCallback(frame, image, width, height, format, pts, owner->mCallbackUser);
+	owner->mFramesDecoded++;
+
+	if( ++worker->frames >= seg.numFrames )
+	{
+		worker->active = false;
+		worker->done.Wake();
+	}
+}
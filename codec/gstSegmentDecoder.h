@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __GSTREAMER_SEGMENT_DECODER_H__
+#define __GSTREAMER_SEGMENT_DECODER_H__
+
+#include "gstDecoder.h"
+
+#include "Thread.h"
+#include "Event.h"
+#include "Mutex.h"
+
+#include <atomic>
+#include <vector>
+
+
+/**
+ * The number of segments that a file is split into for each decoder (see gstSegmentDecoder),
+ * so that decoders which finish early can pick up more of the work.
+ * @ingroup codec
+ */
+#define GST_SEGMENT_DECODER_SEGMENTS 4
+
+
+/**
+ * Callback that receives the frames decoded by gstSegmentDecoder (see gstSegmentDecoder::Run())
+ *
+ * @param frame the index of the frame in the file (starting from 0, in presentation order)
+ * @param image the decoded image in CUDA memory, which is only valid until the callback returns
+ * @param width the width of the image (in pixels)
+ * @param height the height of the image (in pixels)
+ * @param format the format of the image (the one that was passed to Run())
+ * @param timestamp the presentation timestamp of the frame (in nanoseconds)
+ * @param user the user pointer that was passed to Run()
+ *
+ * @ingroup codec
+ */
+typedef void (*gstSegmentDecoderCallback)( uint64_t frame, void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, void* user );
+
+
+/**
+ * Decodes a long video file for offline processing by splitting it into segments that start
+ * at keyframes, and decoding those concurrently with several gstDecoder instances (which the
+ * driver spreads across the hardware decoders, on devices that have more than one NVDEC engine).
+ *
+ * The frames of the file are indexed first (see gstDecoder::IsIndexed()), which only demuxes it,
+ * and the keyframes are grouped into segments with about the same number of frames each.  Every
+ * decoder then takes the next segment that hasn't been decoded yet, seeks to its first keyframe,
+ * and decodes until the next segment starts, as fast as it can (the appsinks don't sync to the clock).
+ * The frames are delivered to the callback tagged with their index in the file.
+ *
+ * @note the callback gets called from the threads of all the decoders at once, so the frames arrive
+ *       out of order (although they're in order within each segment), and it needs to be thread-safe.
+ *       Each decoder is blocked while its callback runs.  Files with open GOPs (where frames after a
+ *       keyframe reference the ones before it) can lose the few frames around the segment boundaries.
+ *
+ * @ingroup codec
+ */
+class gstSegmentDecoder
+{
+public:
+	/**
+	 * Create a segmented decoder for a video file, with the given number of decoders.
+	 */
+	static gstSegmentDecoder* Create( const videoOptions& options, uint32_t numDecoders=2 );
+
+	/**
+	 * Create a segmented decoder for a video file, with the given number of decoders.
+	 */
+	static gstSegmentDecoder* Create( const char* filename, uint32_t numDecoders=2, videoOptions::Codec codec=videoOptions::CODEC_UNKNOWN );
+
+	/**
+	 * Destructor
+	 */
+	~gstSegmentDecoder();
+
+	/**
+	 * Decode the whole file, and deliver every frame to the callback (from the decoder threads).
+	 * This blocks until all of the segments have been decoded.
+	 * @returns `true` if every segment was decoded, or `false` if there was an error.
+	 */
+	bool Run( gstSegmentDecoderCallback callback, imageFormat format=IMAGE_RGB8, void* user=NULL );
+
+	/**
+	 * Return the number of frames in the file.
+	 */
+	inline uint64_t GetNumFrames() const				{ return mFrameIndex.size(); }
+
+	/**
+	 * Return the number of frames that were delivered by the last call to Run().
+	 */
+	inline uint64_t GetFramesDecoded() const			{ return mFramesDecoded; }
+
+	/**
+	 * Return the number of segments that the file was split into.
+	 */
+	inline uint32_t GetNumSegments() const			{ return mSegments.size(); }
+
+	/**
+	 * Return the number of decoders.
+	 */
+	inline uint32_t GetNumDecoders() const			{ return mWorkers.size(); }
+
+	/**
+	 * Return the options of the file.
+	 */
+	inline const videoOptions& GetOptions() const		{ return mOptions; }
+
+protected:
+	gstSegmentDecoder( const videoOptions& options );
+
+	bool init( uint32_t numDecoders );
+	bool split( uint32_t numSegments );
+	bool nextSegment( uint32_t* segment );
+
+	struct Segment
+	{
+		uint64_t firstFrame;	// index of the first frame in the segment
+		uint64_t numFrames;
+		uint64_t start;		// timestamp of the keyframe it starts at (or 0 for the first)
+		uint64_t stop;		// timestamp of the next segment (or GST_CLOCK_TIME_NONE for the last)
+	};
+
+	struct Worker
+	{
+		gstSegmentDecoder* owner;
+		gstDecoder* decoder;
+		Thread      thread;
+		Event       done;
+		uint32_t    segment;
+		uint64_t    frames;	// frames delivered from the current segment
+		volatile bool active;
+		bool        failed;
+	};
+
+	static void* workerThread( void* user );
+	static void onFrame( videoSource* source, void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, void* user );
+
+	videoOptions mOptions;
+
+	std::vector<Worker*>  mWorkers;
+	std::vector<Segment>  mSegments;
+	std::vector<uint64_t> mFrameIndex;	// presentation timestamps of every frame (sorted)
+
+	Mutex    mSegmentMutex;
+	uint32_t mNextSegment;
+
+	gstSegmentDecoderCallback mCallback;
+	imageFormat mCallbackFormat;
+	void*       mCallbackUser;
+
+	std::atomic<uint64_t> mFramesDecoded;
+};
+
+#endif
@@ -21,6 +21,8 @@
  */
 
 #include "gstUtility.h"
+#include "ThreadPool.h"
+#include "Mutex.h"
 #include "logging.h"
 
 #include <gst/gst.h>
@@ -61,10 +63,50 @@ imageFormat gst_parse_format( GstStructure* caps )
 		return IMAGE_BAYER_GRBG;
 	else if( strcasecmp(format, "rggb") == 0 )
 		return IMAGE_BAYER_RGGB;
+	else if( strcasecmp(format, "p010_10le") == 0 )
+		return IMAGE_P010;
+	else if( strcasecmp(format, "p016_le") == 0 )
+		return IMAGE_P016;
+	else if( strcasecmp(format, "gray16_le") == 0 )
+		return IMAGE_GRAY16;
 	
 	return IMAGE_UNKNOWN;
 }
 
+cudaColorimetry gst_parse_colorimetry( GstStructure* caps, cudaColorimetry default_value )
+{
+	const char* str = gst_structure_get_string(caps, "colorimetry");
+
+	if( !str )
+		return default_value;
+
+	// the named colorimetries (bt601, bt709, bt2020, bt2100-pq/hlg) are limited range
+	if( strncasecmp(str, "bt2020", 6) == 0 || strncasecmp(str, "bt2100", 6) == 0 )
+		return COLORIMETRY_BT2020_LIMITED;
+	else if( strcasecmp(str, "bt709") == 0 )
+		return COLORIMETRY_BT709_LIMITED;
+	else if( strcasecmp(str, "bt601") == 0 )
+		return COLORIMETRY_BT601_LIMITED;
+
+	// otherwise it's range:matrix:transfer:primaries (see GstVideoColorRange and GstVideoColorMatrix)
+	int range  = 0;
+	int matrix = 0;
+
+	if( sscanf(str, "%d:%d", &range, &matrix) != 2 )
+		return default_value;
+
+	const bool full = (range == 1);
+
+	if( matrix == 3 )
+		return full ? COLORIMETRY_BT709_FULL : COLORIMETRY_BT709_LIMITED;
+	else if( matrix == 4 )
+		return full ? COLORIMETRY_BT601_FULL : COLORIMETRY_BT601_LIMITED;
+	else if( matrix == 6 )
+		return full ? COLORIMETRY_BT2020_FULL : COLORIMETRY_BT2020_LIMITED;
+
+	return default_value;
+}
+
 const char* gst_format_to_string( imageFormat format )
 {
 	switch(format)
@@ -80,6 +122,9 @@ const char* gst_format_to_string( imageFormat format )
 		case IMAGE_BAYER_GBRG:	return "gbrg";
 		case IMAGE_BAYER_GRBG:	return "grbg";
 		case IMAGE_BAYER_RGGB:	return "rggb";
+		case IMAGE_P010:	return "P010_10LE";
+		case IMAGE_P016:	return "P016_LE";
+		case IMAGE_GRAY16:	return "GRAY16_LE";
 	}
 	
 	return " ";
@@ -198,25 +243,36 @@ void rilog_debug_function(GstDebugCategory* category, GstDebugLevel level,
 }
 
 
+// the mutex is held during initialization, so callers block until a background init finishes
+static Mutex gstreamer_init_mutex;
+static bool  gstreamer_initialized = false;
+static bool  gstreamer_init_started = false;
+
+
 // gstreamerInit
 bool gstreamerInit()
 {
-	static bool gstreamer_initialized = false;
-
 	if( gstreamer_initialized )
 		return true;
 
+	gstreamer_init_mutex.Lock();
+	
+	if( gstreamer_initialized )
+	{
+		gstreamer_init_mutex.Unlock();
+		return true;
+	}
+	
 	int argc = 0;
 	//char* argv[] = { "none" };
 
 	if( !gst_init_check(&argc, NULL, NULL) )
 	{
 		LogError(LOG_GSTREAMER "failed to initialize gstreamer library with gst_init()\n");
+		gstreamer_init_mutex.Unlock();
 		return false;
 	}
 
-	gstreamer_initialized = true;
-
 	uint32_t ver[] = { 0, 0, 0, 0 };
 	gst_version( &ver[0], &ver[1], &ver[2], &ver[3] );
 
@@ -234,9 +290,34 @@ bool gstreamerInit()
 		gst_debug_set_colored(false);
 	}
 	
+	gstreamer_initialized = true;
+	gstreamer_init_mutex.Unlock();
+
 	return true;
 }
 
+
+// gstreamerInitTask
+static void gstreamerInitTask( void* user_param )
+{
+	gstreamerInit();
+}
+
+
+// gstreamerInitAsync
+void gstreamerInitAsync()
+{
+	gstreamer_init_mutex.Lock();
+
+	const bool started = gstreamer_init_started || gstreamer_initialized;
+	gstreamer_init_started = true;
+
+	gstreamer_init_mutex.Unlock();
+
+	if( !started )
+		ThreadPool::Global()->Submit(gstreamerInitTask);
+}
+
 //---------------------------------------------------------------------------------------------
 static void gst_print_one_tag(const GstTagList * list, const gchar * tag, gpointer user_data)
 {
@@ -367,8 +448,79 @@ gboolean gst_message_print(GstBus* bus, GstMessage* message, gpointer user_data)
 }
 
 
+// gst_bus_flush
+static void gst_bus_flush( GstBus* bus, void* user_data )
+{
+	if( !bus )
+		return;
+
+	while(true)
+	{
+		GstMessage* msg = gst_bus_pop(bus);
+
+		if( !msg )
+			break;
+
+		gst_message_print(bus, msg, user_data);
+		gst_message_unref(msg);
+	}
+}
+
+
+// gst_wait_state
+GstStateChangeReturn gst_wait_state( GstElement* element, GstBus* bus, uint64_t timeout, void* user_data )
+{
+	GstState state, pending;
+
+	// this blocks only while the state change is still in progress
+	const GstStateChangeReturn result = gst_element_get_state(element, &state, &pending, timeout);
+
+	if( result == GST_STATE_CHANGE_ASYNC )
+		LogVerbose(LOG_GSTREAMER "gstreamer state change to %s still pending after %.1f ms\n", gst_element_state_get_name(pending), double(timeout) / GST_MSECOND);
+
+	gst_bus_flush(bus, user_data);
+	return result;
+}
+
+
+// gst_wait_eos
+bool gst_wait_eos( GstBus* bus, uint64_t timeout, void* user_data )
+{
+	if( !bus )
+		return false;
+
+	const uint64_t deadline = gst_util_get_timestamp() + timeout;
+
+	while(true)
+	{
+		const uint64_t now = gst_util_get_timestamp();
+
+		if( now >= deadline )
+			break;
+
+		GstMessage* msg = gst_bus_timed_pop(bus, deadline - now);
+
+		if( !msg )
+			break;
+
+		const GstMessageType type = GST_MESSAGE_TYPE(msg);
+
+		gst_message_print(bus, msg, user_data);
+		gst_message_unref(msg);
+
+		if( type == GST_MESSAGE_EOS )
+			return true;
+		else if( type == GST_MESSAGE_ERROR )
+			return false;
+	}
+
+	LogWarning(LOG_GSTREAMER "gstreamer timed out waiting for EOS after %.1f ms\n", double(timeout) / GST_MSECOND);
+	return false;
+}
+
+
 // gst_build_filesink
-bool gst_build_filesink( const URI& uri, videoOptions::Codec codec, std::ostringstream& pipeline )
+bool gst_build_filesink( const URI& uri, videoOptions::Codec codec, std::ostringstream& pipeline, uint32_t segmentTime, uint32_t segmentSize, const char* name )
 {
 	if( uri.path.length() <= 0 || uri.protocol != "file" )
 	{
@@ -381,6 +533,45 @@ bool gst_build_filesink( const URI& uri, videoOptions::Codec codec, std::ostring
 			pipeline << "h264parse ! "; \
 		else if( codec == videoOptions::CODEC_H265 ) \
 			pipeline << "h265parse ! ";
+	
+	// remux the stream into segments that are split on keyframes
+	if( segmentTime > 0 || segmentSize > 0 )
+	{
+		if( uri.extension != "mp4" && uri.extension != "mkv" )
+		{
+			LogError(LOG_GSTREAMER "segmented recording is only supported for mp4 and mkv files (%s)\n", uri.location.c_str());
+			return false;
+		}
+
+		// the location needs an index for the segments
+		std::string location = uri.location;
+
+		if( location.find('%') == std::string::npos )
+			location.insert(location.size() - uri.extension.size() - 1, "_%05d");
+
+		ADD_CODEC_PARSER();
+
+		pipeline << "splitmuxsink location=" << location;
+
+		if( name != NULL )
+			pipeline << " name=" << name;
+
+		if( segmentTime > 0 )
+			pipeline << " max-size-time=" << (uint64_t(segmentTime) * GST_SECOND);
+
+		if( segmentSize > 0 )
+			pipeline << " max-size-bytes=" << (uint64_t(segmentSize) * 1024 * 1024);
+
+		// MKV can be played back up to where it was cut off, and MP4 needs
+		// to be fragmented for that (otherwise the moov atom is only at the end)
+		if( uri.extension == "mkv" )
+			pipeline << " muxer-factory=matroskamux";
+		else
+			pipeline << " muxer-factory=mp4mux muxer-properties=\"properties,fragment-duration=1000\"";
+
+		pipeline << " ";
+		return true;
+	}
 		
 	if( uri.extension == "mkv" )
 	{
@@ -428,3 +619,65 @@ bool gst_build_filesink( const URI& uri, videoOptions::Codec codec, std::ostring
 	pipeline << "filesink location=" << uri.location << " ";
 	return true;
 }
+
+
+// gst_build_appsink
+void gst_build_appsink( const videoOptions& options, std::ostringstream& pipeline, const char* name )
+{
+	if( !options.lowLatency )
+	{
+		pipeline << "appsink name=" << name;
+		return;
+	}
+
+	// only keep the newest decoded frame, instead of letting them queue up
+	pipeline << "queue leaky=downstream max-size-buffers=1 max-size-bytes=0 max-size-time=0 ! ";
+	pipeline << "appsink name=" << name << " max-buffers=1 drop=true";
+
+	// files still play back in realtime
+	if( options.deviceType != videoOptions::DEVICE_FILE )
+		pipeline << " sync=false";
+}
+
+
+// gst_element_available
+bool gst_element_available( const char* name )
+{
+	if( !name )
+		return false;
+
+	GstElementFactory* factory = gst_element_factory_find(name);
+
+	if( !factory )
+		return false;
+
+	gst_object_unref(factory);
+	return true;
+}
+
+
+// gst_monotonic_base_time
+uint64_t gst_monotonic_base_time( GstElement* element )
+{
+	if( !element )
+		return GST_CLOCK_TIME_NONE;
+
+	GstClock* clock = gst_element_get_clock(element);
+
+	if( !clock )
+		return GST_CLOCK_TIME_NONE;
+
+	uint64_t baseTime = GST_CLOCK_TIME_NONE;
+
+	if( GST_IS_SYSTEM_CLOCK(clock) )
+	{
+		GstClockType clockType = GST_CLOCK_TYPE_REALTIME;
+		g_object_get(G_OBJECT(clock), "clock-type", &clockType, NULL);
+
+		if( clockType == GST_CLOCK_TYPE_MONOTONIC )
+			baseTime = gst_element_get_base_time(element);
+	}
+
+	gst_object_unref(clock);
+	return baseTime;
+}
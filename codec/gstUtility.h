@@ -27,6 +27,7 @@
 #include <sstream>
 
 #include "videoOptions.h"
+#include "cudaColorimetry.h"
 #include "NvInfer.h"
 
 
@@ -44,6 +45,15 @@
  */
 bool gstreamerInit();
 
+/**
+ * Start initializing GStreamer (and loading its plugin registry) on a worker thread,
+ * so that it overlaps with the rest of the application's startup.  The next call to
+ * gstreamerInit() waits for it to finish.  It's safe to call this more than once.
+ * @internal
+ * @ingroup codec
+ */
+void gstreamerInitAsync();
+
 /**
  * gst_message_print
  * @internal
@@ -51,6 +61,38 @@ bool gstreamerInit();
  */
 gboolean gst_message_print(_GstBus* bus, _GstMessage* message, void* user_data);
 
+/**
+ * Maximum time that Open() waits for the pipeline to reach GST_STATE_PLAYING (in nanoseconds).
+ * @ingroup codec
+ */
+#define GST_OPEN_TIMEOUT (100 * GST_MSECOND)
+
+/**
+ * Maximum time that Close() waits for EOS to propagate through the pipeline (in nanoseconds).
+ * @ingroup codec
+ */
+#define GST_EOS_TIMEOUT (2 * GST_SECOND)
+
+/**
+ * gst_wait_state
+ * Wait until a pending state change of the element completes (or the timeout
+ * expires), then print the messages that were posted to the bus meanwhile.
+ * This returns as soon as the transition is done, instead of sleeping.
+ * @internal
+ * @ingroup codec
+ */
+GstStateChangeReturn gst_wait_state( GstElement* element, GstBus* bus, uint64_t timeout, void* user_data=NULL );
+
+/**
+ * gst_wait_eos
+ * Wait for EOS (or an error) to be posted to the bus, up to the timeout.
+ * Other messages received while waiting are printed and discarded.
+ * @returns `true` if EOS was received, otherwise `false`.
+ * @internal
+ * @ingroup codec
+ */
+bool gst_wait_eos( GstBus* bus, uint64_t timeout, void* user_data=NULL );
+
 /**
  * gst_parse_codec
  * @internal
@@ -65,6 +107,13 @@ videoOptions::Codec gst_parse_codec( GstStructure* caps );
  */
 imageFormat gst_parse_format( GstStructure* caps );
 
+/**
+ * gst_parse_colorimetry (returns default_value if the caps don't specify it)
+ * @internal
+ * @ingroup codec
+ */
+cudaColorimetry gst_parse_colorimetry( GstStructure* caps, cudaColorimetry default_value=COLORIMETRY_DEFAULT );
+
 /**
  * gst_codec_to_string
  * @internal
@@ -81,10 +130,38 @@ const char* gst_format_to_string( imageFormat format );
 
 /**
  * gst_build_filesink
+ * If segmentTime (seconds) or segmentSize (megabytes) are non-zero, the
+ * stream gets split into segments with splitmuxsink (mp4 and mkv only).
+ * MP4 segments are fragmented so they remain playable if recording is cut off.
+ * The splitmuxsink element is given the optional name, so it can be signalled.
+ * @internal
+ * @ingroup codec
+ */
+bool gst_build_filesink( const URI& uri, videoOptions::Codec codec, std::ostringstream& pipeline, uint32_t segmentTime=0, uint32_t segmentSize=0, const char* name=NULL );
+
+/**
+ * Append the appsink element (named `mysink` by default) to the end of a pipeline,
+ * with a leaky queue in front of it when videoOptions::lowLatency is set.
+ * @internal
+ * @ingroup codec
+ */
+void gst_build_appsink( const videoOptions& options, std::ostringstream& pipeline, const char* name="mysink" );
+
+/**
+ * Check if a GStreamer element is installed (i.e. that its plugin can be found)
+ * @internal
+ * @ingroup codec
+ */
+bool gst_element_available( const char* name );
+
+/**
+ * Return the base time of an element if its pipeline clock is based on CLOCK_MONOTONIC
+ * (like the default GstSystemClock), or GST_CLOCK_TIME_NONE if it isn't.  Adding the
+ * running time of a buffer to this gives the CLOCK_MONOTONIC time of the buffer.
  * @internal
  * @ingroup codec
  */
-bool gst_build_filesink( const URI& uri, videoOptions::Codec codec, std::ostringstream& pipeline );
+uint64_t gst_monotonic_base_time( GstElement* element );
 
 
 #if defined(__aarch64__)
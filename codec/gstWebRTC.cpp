@@ -109,7 +109,7 @@ void gstWebRTC::onCreateOffer( GstPromise* promise, void* user_data )
 
 	LogVerbose(LOG_WEBRTC "sending offer for %s to %s (peer_id=%u): \n%s\n", peer->path.c_str(), peer->ip_address.c_str(), peer->ID, json_string);
 	
-	soup_websocket_connection_send_text(peer->connection, json_string);
+	peer->server->SendMessage(peer, json_string);
 	
 	//g_free(json_string);
 	g_free(sdp_string);
@@ -141,12 +141,56 @@ void gstWebRTC::onIceCandidate( GstElement* webrtcbin, uint32_t mline_index, cha
 
 	LogVerbose(LOG_WEBRTC "sending ICE candidate for %s to %s (peer_id=%u): \n%s\n", peer->path.c_str(), peer->ip_address.c_str(), peer->ID, json_string);
 
-	soup_websocket_connection_send_text(peer->connection, json_string);
+	peer->server->SendMessage(peer, json_string);
 	
 	g_free(json_string);
 }
 
 
+// CreateDataChannel
+GObject* gstWebRTC::CreateDataChannel( GstElement* webrtcbin, const char* label )
+{
+	if( !webrtcbin || !label )
+		return NULL;
+
+	GstStructure* options = gst_structure_new("data-channel-options", 
+									  "ordered", G_TYPE_BOOLEAN, FALSE,
+									  "max-retransmits", G_TYPE_INT, 0, NULL);
+
+	GObject* channel = NULL;
+	g_signal_emit_by_name(webrtcbin, "create-data-channel", label, options, &channel);
+	gst_structure_free(options);
+
+	if( !channel )
+		LogWarning(LOG_WEBRTC "failed to create WebRTC data channel '%s' (metadata will be disabled)\n", label);
+
+	return channel;
+}
+
+
+// SendData
+bool gstWebRTC::SendData( GObject* dataChannel, const char* message, uint64_t maxBuffered )
+{
+	if( !dataChannel || !message )
+		return false;
+
+#if GST_CHECK_VERSION(1,16,0)
+	GstWebRTCDataChannelState state = GST_WEBRTC_DATA_CHANNEL_STATE_NEW;
+	guint64 buffered = 0;
+
+	g_object_get(dataChannel, "ready-state", &state, "buffered-amount", &buffered, NULL);
+
+	if( state != GST_WEBRTC_DATA_CHANNEL_STATE_OPEN || buffered > maxBuffered )
+		return false;
+
+	g_signal_emit_by_name(dataChannel, "send-string", message);
+	return true;
+#else
+	return false;
+#endif
+}
+
+
 // Deal with MDNS candidates in ICE messages
 // candidate:2612432513 1 udp 2113937151 968c736b-1028-4011-8977-df7a7c5eaea0.local 52811 typ host generation 0 ufrag thqf network-cost 999
 // https://gitlab.freedesktop.org/gstreamer/gst-plugins-bad/-/issues/1139
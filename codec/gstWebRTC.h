@@ -29,6 +29,8 @@
 #define GST_USE_UNSTABLE_API
 #include <gst/webrtc/webrtc.h>
 
+#include <atomic>
+
 
 /**
  * Static class for common WebRTC utility functions used with GStreamer.
@@ -43,10 +45,17 @@ public:
 	 */
 	struct PeerContext
 	{
-		PeerContext()	{ webrtcbin = NULL; queue = NULL; }
+		PeerContext()	{ webrtcbin = NULL; queue = NULL; dataChannel = NULL; owner = NULL; bitrate = 0; packetsQueued = 0; packetsSent = 0; redirected = false; }
 		
 		GstElement* webrtcbin;	// used by gstEncoder + gstDecoder
 		GstElement* queue;		// used by gstEncoder only
+		GObject*    dataChannel;	// GstWebRTCDataChannel for sending metadata (gstEncoder only)
+		void*       owner;		// the gstEncoder instance (gstEncoder only)
+		uint32_t    bitrate;	// congestion estimate from the peer's feedback (gstEncoder only)
+		bool        redirected;	// the peer was moved to a lower simulcast layer (gstEncoder only)
+
+		std::atomic<uint64_t> packetsQueued;	// RTP packets that entered the send queue (gstEncoder only)
+		std::atomic<uint64_t> packetsSent;		// RTP packets that left the send queue (gstEncoder only)
 	};
 
 	/**
@@ -73,6 +82,19 @@ public:
 	 * handle new peer connecting/closing messages.
 	 */
 	static void onWebsocketMessage( WebRTCPeer* peer, const char* message, size_t message_size, void* user_data );	
+
+	/**
+	 * Create a data channel on the webrtcbin of a peer, which needs to happen before the offer gets created.
+	 * Messages on it are unordered and never retransmitted, which is what per-frame metadata wants.
+	 * @returns the GstWebRTCDataChannel, or NULL if data channels aren't supported (they need the sctp plugin).
+	 */
+	static GObject* CreateDataChannel( GstElement* webrtcbin, const char* label );
+
+	/**
+	 * Send a string over a data channel, if it's open and has less than `maxBuffered` bytes waiting.
+	 * @returns true if the message was sent, otherwise false.
+	 */
+	static bool SendData( GObject* dataChannel, const char* message, uint64_t maxBuffered );
 };
 
 
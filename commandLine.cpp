@@ -22,6 +22,9 @@
 
 #include "commandLine.h"
 #include "logging.h"
+#include "profiler.h"
+#include "videoLatency.h"
+#include "ThreadPool.h"
 
 #include <string>
 #include <string.h>
@@ -98,6 +101,9 @@ commandLine::commandLine( const int pArgc, char** pArgv, const char* extraFlag )
 	AddFlag(extraFlag);
 
 	Log::ParseCmdLine(*this);
+	Profiler::ParseCmdLine(*this);
+	videoLatency::ParseCmdLine(*this);
+	ThreadPool::ParseCmdLine(*this);
 }
 
 
@@ -110,6 +116,9 @@ commandLine::commandLine( const int pArgc, char** pArgv, const char** extraArgs
 	AddArgs(extraArgs);
 
 	Log::ParseCmdLine(*this);
+	Profiler::ParseCmdLine(*this);
+	videoLatency::ParseCmdLine(*this);
+	ThreadPool::ParseCmdLine(*this);
 }
 
 
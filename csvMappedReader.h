@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+ 
+#ifndef __CSV_MAPPED_READER_H_
+#define __CSV_MAPPED_READER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+
+/**
+ * csvField
+ *
+ * A field of a line read by csvMappedReader, which points into the
+ * memory-mapped file instead of copying it (like a std::string_view).
+ * It's only valid while the reader is open.
+ *
+ * @ingroup csv
+ */
+struct csvField
+{
+	// constructors
+	csvField() : data(NULL), length(0)						{}
+	csvField( const char* str, size_t len ) : data(str), length(len)	{}
+
+	// copy to string
+	inline std::string str() const						{ return std::string(data, length); }
+	inline operator std::string() const					{ return str(); }
+
+	// compare to a string
+	inline bool operator == ( const char* str ) const			{ return strlen(str) == length && memcmp(data, str, length) == 0; }
+	inline bool operator != ( const char* str ) const			{ return !(*this == str); }
+
+	// cast to number
+	inline operator int() const							{ return toInt(); }
+	inline operator float() const 						{ return toFloat(); }
+	inline operator double() const						{ return toDouble(); }
+
+	// convert to number (return true if valid)
+	inline bool toInt( int* value ) const					{ return Parse(data, data + length, value); }
+	inline bool toFloat( float* value ) const				{ return Parse(data, data + length, value); }
+	inline bool toDouble( double* value ) const				{ return Parse(data, data + length, value); }
+
+	// convert to number (valid->false on error)
+	inline int toInt( bool* valid=NULL ) const				{ int x=0; const bool v=toInt(&x); if(valid) *valid=v; return x; }
+	inline float toFloat( bool* valid=NULL ) const			{ float x=0.0f; const bool v=toFloat(&x); if(valid) *valid=v; return x; }
+	inline double toDouble( bool* valid=NULL ) const			{ double x=0.0; const bool v=toDouble(&x); if(valid) *valid=v; return x; }
+
+	// parse a number from the characters in [begin, end), without copying them
+	// (returns false if the whole range isn't a valid number)
+	inline static bool Parse( const char* begin, const char* end, int* value );
+	inline static bool Parse( const char* begin, const char* end, int64_t* value );
+	inline static bool Parse( const char* begin, const char* end, uint32_t* value );
+	inline static bool Parse( const char* begin, const char* end, float* value );
+	inline static bool Parse( const char* begin, const char* end, double* value );
+
+	// data storage
+	const char* data;
+	size_t length;
+};
+
+
+/**
+ * csvMappedReader
+ *
+ * CSV reader for large files, which memory-maps the file and splits the lines
+ * in place (without copying them).  Numbers are parsed straight from the mapped
+ * memory, and ReadColumns() fills typed arrays without tokenizing the unused
+ * fields.  Like csvReader, consecutive delimiters are treated as one, and
+ * lines that start with '#' are skipped.  Unlike csvReader, it's re-entrant
+ * (strtok isn't used) and there's no limit on the length of the lines.
+ *
+ * @ingroup csv
+ */
+class csvMappedReader
+{
+public:
+	// open
+	inline static csvMappedReader* Open( const char* filename, const char* delimiters=",;\t " );
+
+	// destructor
+	inline ~csvMappedReader();
+
+	// close
+	inline void Close();
+
+	// is open and not EOF
+	inline bool IsOpen() const;
+	inline bool IsClosed() const;
+
+	// read line, fill list of fields (returns false at EOF)
+	inline bool Read( std::vector<csvField>& fields );
+
+	// read the remaining lines into arrays, where columns[n] receives field indices[n] of each line
+	// (fields that are missing or aren't valid numbers are set to 0, and counted in errors)
+	template<typename T> inline size_t ReadColumns( std::vector<T>* columns, const uint32_t* indices, size_t numColumns, size_t* errors=NULL );
+
+	// read the remaining lines into arrays in caller-allocated memory, up to maxLines
+	template<typename T> inline size_t ReadColumns( T** columns, const uint32_t* indices, size_t numColumns, size_t maxLines, size_t* errors=NULL );
+
+	// read one column of the remaining lines into an array
+	template<typename T> inline size_t ReadColumn( uint32_t index, std::vector<T>& column, size_t* errors=NULL )	{ return ReadColumns(&column, &index, 1, errors); }
+
+	// go back to the first line
+	inline void Rewind();
+
+	// set default delimiters
+	inline void SetDelimiters( const char* delimiters );
+
+	// retrieve the filename
+	inline const char* GetFilename() const		{ return mFilename.c_str(); }
+
+	// retrieve the size of the file (in bytes)
+	inline size_t GetSize() const				{ return mSize; }
+
+	// retrieve the number of lines read so far (including comments)
+	inline size_t GetLine() const				{ return mLine; }
+
+private:
+	inline csvMappedReader();
+
+	inline bool nextLine( const char** begin, const char** end );
+
+	const char* mData;
+	size_t mSize;
+	size_t mPos;
+	size_t mLine;
+
+	bool mDelimiters[256];
+	std::string mFilename;
+};
+
+
+// internal functions
+#include "csvMappedReader.hpp"
+
+#endif
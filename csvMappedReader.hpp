@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+ 
+#ifndef __CSV_MAPPED_READER_HPP_
+#define __CSV_MAPPED_READER_HPP_
+
+
+#include "csvMappedReader.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <limits>
+
+
+// null-terminated copy of a field (for the numbers that get parsed by the C library)
+struct csvFieldString
+{
+	csvFieldString( const char* begin, const char* end )
+	{
+		const size_t len = end - begin;
+
+		if( len < sizeof(buffer) )
+		{
+			memcpy(buffer, begin, len);
+			buffer[len] = '\0';
+			ptr = buffer;
+		}
+		else
+		{
+			string.assign(begin, len);
+			ptr = string.c_str();
+		}
+	}
+
+	char buffer[64];
+	std::string string;
+	const char* ptr;
+};
+
+
+// csvParseInteger (decimal integers, anything else like hex goes through strtoll)
+template<typename T>
+static inline bool csvParseInteger( const char* begin, const char* end, T* value )
+{
+	const char* p = begin;
+	const bool negative = (p < end && *p == '-');
+
+	if( p < end && (*p == '-' || *p == '+') )
+		p++;
+
+	if( p < end && !(negative && !std::numeric_limits<T>::is_signed) )
+	{
+		const uint64_t limit = negative ? uint64_t(std::numeric_limits<T>::max()) + 1 : uint64_t(std::numeric_limits<T>::max());
+		uint64_t x = 0;
+
+		for( ; p < end; p++ )
+		{
+			const unsigned int digit = *p - '0';
+
+			if( digit > 9 || x > (limit - digit) / 10 )
+				break;
+
+			x = x * 10 + digit;
+		}
+
+		if( p == end )
+		{
+			*value = negative ? T(0 - x) : T(x);
+			return true;
+		}
+	}
+
+	const csvFieldString str(begin, end);
+
+	char* e;
+	errno = 0;
+
+	const long long x = strtoll(str.ptr, &e, 0);
+
+	if( e == str.ptr || *e != '\0' || errno != 0 || x < (long long)std::numeric_limits<T>::min() || x > (long long)std::numeric_limits<T>::max() )
+		return false;
+
+	*value = T(x);
+	return true;
+}
+
+
+// csvParseFloat (decimals that can be converted exactly with one multiply or divide
+// are parsed directly, and the rest (like inf/nan, or too many digits) go through strtod)
+template<typename T>
+static inline bool csvParseFloat( const char* begin, const char* end, T* value )
+{
+	static const double pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+							  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	const char* p = begin;
+	const bool negative = (p < end && *p == '-');
+
+	if( p < end && (*p == '-' || *p == '+') )
+		p++;
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digits = 0;		// the number of digits in the mantissa (after leading zeros)
+	int total = 0;			// the number of digits before the exponent
+
+	for( ; p < end && (unsigned int)(*p - '0') <= 9; p++, total++ )
+	{
+		if( mantissa > 0 || *p != '0' )
+			digits++;
+
+		mantissa = mantissa * 10 + (*p - '0');
+	}
+
+	if( p < end && *p == '.' )
+	{
+		for( p++; p < end && (unsigned int)(*p - '0') <= 9; p++, total++ )
+		{
+			if( mantissa > 0 || *p != '0' )
+				digits++;
+
+			mantissa = mantissa * 10 + (*p - '0');
+			exponent--;
+		}
+	}
+
+	if( total > 0 && p < end && (*p == 'e' || *p == 'E') )
+	{
+		p++;
+
+		const bool negativeExp = (p < end && *p == '-');
+
+		if( p < end && (*p == '-' || *p == '+') )
+			p++;
+
+		int e = 0;
+		const char* expBegin = p;
+
+		for( ; p < end && (unsigned int)(*p - '0') <= 9; p++ )
+		{
+			if( e < 10000 )
+				e = e * 10 + (*p - '0');
+		}
+
+		if( p == expBegin )
+			return false;
+
+		exponent += negativeExp ? -e : e;
+	}
+
+	if( p == end && total > 0 && digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22 )
+	{
+		double x = double(mantissa);
+
+		if( exponent < 0 )
+			x /= pow10[-exponent];
+		else
+			x *= pow10[exponent];
+
+		*value = T(negative ? -x : x);
+		return true;
+	}
+
+	const csvFieldString str(begin, end);
+
+	char* e;
+	errno = 0;
+
+	const double x = strtod(str.ptr, &e);
+
+	if( e == str.ptr || *e != '\0' || errno != 0 )
+		return false;
+
+	*value = T(x);
+	return true;
+}
+
+
+// Parse
+inline bool csvField::Parse( const char* begin, const char* end, int* value )		{ return csvParseInteger(begin, end, value); }
+inline bool csvField::Parse( const char* begin, const char* end, int64_t* value )	{ return csvParseInteger(begin, end, value); }
+inline bool csvField::Parse( const char* begin, const char* end, uint32_t* value )	{ return csvParseInteger(begin, end, value); }
+inline bool csvField::Parse( const char* begin, const char* end, float* value )		{ return csvParseFloat(begin, end, value); }
+inline bool csvField::Parse( const char* begin, const char* end, double* value )		{ return csvParseFloat(begin, end, value); }
+
+
+//-------------------------------------------------------------------------------------
+// constructor
+inline csvMappedReader::csvMappedReader()
+{
+	mData = NULL;
+	mSize = 0;
+	mPos  = 0;
+	mLine = 0;
+
+	SetDelimiters(",;\t ");
+}
+
+// destructor
+inline csvMappedReader::~csvMappedReader()
+{
+	Close();
+}
+
+// open
+inline csvMappedReader* csvMappedReader::Open( const char* filename, const char* delimiters )
+{
+	if( !filename || !delimiters )
+		return NULL;
+
+	const int fd = open(filename, O_RDONLY);
+
+	if( fd < 0 )
+	{
+		LogError("csvMappedReader -- failed to open file %s\n", filename);
+		perror("csvMappedReader -- error");
+		return NULL;
+	}
+
+	struct stat info;
+
+	if( fstat(fd, &info) != 0 )
+	{
+		LogError("csvMappedReader -- failed to get the size of file %s\n", filename);
+		close(fd);
+		return NULL;
+	}
+
+	// empty files can't be mapped, so they just have no lines
+	void* data = NULL;
+
+	if( info.st_size > 0 )
+	{
+		data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if( data == MAP_FAILED )
+		{
+			LogError("csvMappedReader -- failed to map file %s\n", filename);
+			perror("csvMappedReader -- error");
+			close(fd);
+			return NULL;
+		}
+
+		// the file is read front to back, so let the kernel read ahead
+		madvise(data, info.st_size, MADV_SEQUENTIAL);
+	}
+
+	close(fd);
+
+	csvMappedReader* csv = new csvMappedReader();
+
+	csv->mData = (const char*)data;
+	csv->mSize = data ? info.st_size : 0;
+	csv->mFilename = filename;
+
+	csv->SetDelimiters(delimiters);
+	return csv;
+}
+
+// close
+inline void csvMappedReader::Close()
+{
+	if( mData != NULL )
+		munmap((void*)mData, mSize);
+
+	mData = NULL;
+	mSize = 0;
+	mPos  = 0;
+}
+
+// isOpen
+inline bool csvMappedReader::IsOpen() const
+{
+	return mPos < mSize;
+}
+
+// isClosed
+inline bool csvMappedReader::IsClosed() const
+{
+	return !IsOpen();
+}
+
+// Rewind
+inline void csvMappedReader::Rewind()
+{
+	mPos  = 0;
+	mLine = 0;
+}
+
+// SetDelimiters
+inline void csvMappedReader::SetDelimiters( const char* delimiters )
+{
+	memset(mDelimiters, 0, sizeof(mDelimiters));
+
+	for( const char* d=delimiters; *d != '\0'; d++ )
+		mDelimiters[(uint8_t)*d] = true;
+}
+
+// nextLine (skipping comments and blank lines)
+inline bool csvMappedReader::nextLine( const char** begin, const char** end )
+{
+	while( mPos < mSize )
+	{
+		const char* line = mData + mPos;
+		const char* eol  = (const char*)memchr(line, '\n', mSize - mPos);
+
+		if( !eol )
+			eol = mData + mSize;
+
+		mPos = std::min<size_t>(eol - mData + 1, mSize);
+		mLine++;
+
+		if( eol > line && eol[-1] == '\r' )
+			eol--;
+
+		if( eol == line || line[0] == '#' )
+			continue;
+
+		*begin = line;
+		*end   = eol;
+
+		return true;
+	}
+
+	return false;
+}
+
+// Read
+inline bool csvMappedReader::Read( std::vector<csvField>& fields )
+{
+	fields.clear();
+
+	const char* p;
+	const char* end;
+
+	while( nextLine(&p, &end) )
+	{
+		while( p < end )
+		{
+			while( p < end && mDelimiters[(uint8_t)*p] )
+				p++;
+
+			const char* field = p;
+
+			while( p < end && !mDelimiters[(uint8_t)*p] )
+				p++;
+
+			if( p > field )
+				fields.push_back(csvField(field, p - field));
+		}
+
+		// lines with only delimiters are skipped
+		if( fields.size() > 0 )
+			return true;
+	}
+
+	return false;
+}
+
+// ReadColumns
+template<typename T> 
+inline size_t csvMappedReader::ReadColumns( T** columns, const uint32_t* indices, size_t numColumns, size_t maxLines, size_t* errors )
+{
+	if( errors != NULL )
+		*errors = 0;
+
+	if( !columns || !indices || numColumns == 0 )
+		return 0;
+
+	uint32_t maxIndex = 0;
+
+	for( size_t n=0; n < numColumns; n++ )
+		maxIndex = std::max(maxIndex, indices[n]);
+
+	const char* p;
+	const char* end;
+
+	size_t lines = 0;
+
+	while( lines < maxLines && nextLine(&p, &end) )
+	{
+		size_t found = 0;
+
+		for( size_t n=0; n < numColumns; n++ )
+			columns[n][lines] = T(0);
+
+		// only tokenize up to the last field that's needed
+		for( uint32_t index=0; index <= maxIndex && p < end; index++ )
+		{
+			while( p < end && mDelimiters[(uint8_t)*p] )
+				p++;
+
+			const char* field = p;
+
+			while( p < end && !mDelimiters[(uint8_t)*p] )
+				p++;
+
+			if( p == field )
+				break;
+
+			for( size_t n=0; n < numColumns; n++ )
+			{
+				if( indices[n] == index && csvField::Parse(field, p, &columns[n][lines]) )
+					found++;
+			}
+		}
+
+		if( errors != NULL )
+			*errors += numColumns - found;
+
+		lines++;
+	}
+
+	return lines;
+}
+
+// ReadColumns
+template<typename T>
+inline size_t csvMappedReader::ReadColumns( std::vector<T>* columns, const uint32_t* indices, size_t numColumns, size_t* errors )
+{
+	if( errors != NULL )
+		*errors = 0;
+
+	if( !columns || !indices || numColumns == 0 || mPos >= mSize )
+		return 0;
+
+	std::vector<T*> ptrs(numColumns);
+	size_t total = 0;
+
+	while( mPos < mSize )
+	{
+		// estimate how many lines are left from the length of the lines so far
+		const size_t avgLength = (mLine > 0) ? std::max<size_t>(mPos / mLine, 1) : 16;
+		const size_t capacity  = (mSize - mPos) / avgLength + 1;
+
+		for( size_t n=0; n < numColumns; n++ )
+		{
+			columns[n].resize(total + capacity);
+			ptrs[n] = columns[n].data() + total;
+		}
+
+		size_t chunkErrors = 0;
+		total += ReadColumns(ptrs.data(), indices, numColumns, capacity, &chunkErrors);
+
+		if( errors != NULL )
+			*errors += chunkErrors;
+	}
+
+	for( size_t n=0; n < numColumns; n++ )
+		columns[n].resize(total);
+
+	return total;
+}
+
+#endif
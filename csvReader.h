@@ -25,6 +25,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include <string>
@@ -85,6 +86,10 @@ public:
 
 /**
  * csvReader
+ *
+ * @see csvMappedReader for reading large files, which memory-maps the
+ *      file and parses the fields without copying them.
+ *
  * @ingroup csv
  */
 class csvReader
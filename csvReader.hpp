@@ -68,7 +68,7 @@ inline bool csvData::toDouble( double* value ) const
 	char* e;
 	errno = 0;
 
-	const float x = strtof(string.c_str(), &e);
+	const double x = strtod(string.c_str(), &e);
 
 	if( *e != '\0' || errno != 0 )
 		return false;
@@ -159,12 +159,13 @@ inline bool csvData::Parse( std::vector<csvData>& tokens, const char* str, const
 	if( str_tokens[str_length-1] == '\n' )
 		str_tokens[str_length-1] = '\0';
 
-	char* token = strtok(str_tokens, delimiters);
+	char* saveptr = NULL;
+	char* token = strtok_r(str_tokens, delimiters, &saveptr);
 
 	while( token != NULL )
 	{
 		tokens.push_back(token);
-		token = strtok(NULL, delimiters);
+		token = strtok_r(NULL, delimiters, &saveptr);
 	}
 
 	free(str_tokens);
@@ -248,6 +249,7 @@ inline std::vector<csvData> csvReader::Read( const char* delimiters )
 {
 	std::vector<csvData> tokens;
 	Read(tokens, delimiters);
+	return tokens;
 }
 
 // readLine
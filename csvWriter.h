@@ -28,26 +28,41 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <errno.h>
 
 #include <string>
 #include <vector>
 #include <iostream>
+#include <sstream>
+
+#include "Event.h"
+#include "Mutex.h"
+#include "Thread.h"
 
 
 /**
  * csvWriter
+ *
+ * By default each cell is written through the file stream, and each line is flushed.
+ * In buffered mode (when the `bufferSize` is non-zero), the cells are instead recorded
+ * into an in-memory buffer as binary values, which costs about a memcpy per cell.
+ * When the buffer fills up (or Flush() is called), the cells get formatted and written
+ * in one block, either inline or by a background thread if `flushThread` is true.
+ * The calling thread only waits if the thread is still writing the previous buffer.
+ *
  * @ingroup csv
  */
 class csvWriter
 {
 public:
 	// constructor/destructor
-	csvWriter( const char* filename, const char* delimiter=", " );
+	csvWriter( const char* filename, const char* delimiter=", ", size_t bufferSize=0, bool flushThread=false );
 	~csvWriter();
 
 	// open
-	inline static csvWriter* Open( const char* filename, const char* delimiter=", " );
+	inline static csvWriter* Open( const char* filename, const char* delimiter=", ", size_t bufferSize=0, bool flushThread=false );
 
 	// close/flush
 	inline void Close();
@@ -88,11 +103,60 @@ public:
 	// retrieve the filename
 	inline const char* GetFilename() const;
 
+	// is buffered mode enabled
+	inline bool IsBuffered() const				{ return mBufferSize > 0; }
+
 private:
+	// types of the records in the buffer
+	enum RecordType { RECORD_INT, RECORD_UINT, RECORD_FLOAT, RECORD_DOUBLE, RECORD_STRING, RECORD_ENDL };
+
+	inline void record( uint8_t type, const void* data, size_t size );
+	inline void record( const char* str, size_t length );
+
+	// convert a value to a record (in buffered mode)
+	inline void buffer( bool value )				{ buffer((unsigned int)value); }
+	inline void buffer( char value )				{ record(&value, 1); }
+	inline void buffer( signed char value )			{ record((const char*)&value, 1); }
+	inline void buffer( unsigned char value )		{ record((const char*)&value, 1); }
+	inline void buffer( short value )				{ buffer((long long)value); }
+	inline void buffer( unsigned short value )		{ buffer((unsigned long long)value); }
+	inline void buffer( int value )				{ buffer((long long)value); }
+	inline void buffer( unsigned int value )		{ buffer((unsigned long long)value); }
+	inline void buffer( long value )				{ buffer((long long)value); }
+	inline void buffer( unsigned long value )		{ buffer((unsigned long long)value); }
+	inline void buffer( long long value )			{ record(RECORD_INT, &value, sizeof(value)); }
+	inline void buffer( unsigned long long value )	{ record(RECORD_UINT, &value, sizeof(value)); }
+	inline void buffer( float value )				{ record(RECORD_FLOAT, &value, sizeof(value)); }
+	inline void buffer( double value )				{ record(RECORD_DOUBLE, &value, sizeof(value)); }
+	inline void buffer( const char* value )			{ record(value, strlen(value)); }
+	inline void buffer( const std::string& value )	{ record(value.c_str(), value.size()); }
+
+	template<typename T> inline void buffer( const T& value );
+
+	inline void submit();
+	inline void waitIdle();
+	inline void format( const std::vector<char>& records );
+
+	static inline void* flushThread( void* param );
+
 	std::ofstream mFile;
 	std::string   mFilename;
 	std::string   mDelimiter;
 	bool		    mNewLine;
+
+	// buffered mode
+	std::vector<char> mBuffer;		// records from the calling thread
+	std::vector<char> mBackBuffer;	// records being written (empty when idle)
+	std::string mText;				// the formatted text
+	size_t mBufferSize;
+	bool   mFormatNewLine;			// the formatter is at the start of a line
+
+	Thread mThread;
+	Mutex  mMutex;
+	Event  mWakeEvent;				// raised when the back buffer is submitted
+	Event  mIdleEvent;				// raised when the back buffer was written
+	bool   mThreadRunning;
+	bool   mThreadStop;
 };
 
 
@@ -29,8 +29,14 @@
 
 
 // constructor
-csvWriter::csvWriter( const char* filename, const char* delimiter )
+csvWriter::csvWriter( const char* filename, const char* delimiter, size_t bufferSize, bool flushThread )
 {
+	mNewLine       = true;
+	mBufferSize    = 0;
+	mFormatNewLine = true;
+	mThreadRunning = false;
+	mThreadStop    = false;
+
 	if( !filename || !delimiter )
 		return;
 
@@ -44,7 +50,23 @@ csvWriter::csvWriter( const char* filename, const char* delimiter )
 
 	mFilename  = filename;
 	mDelimiter = delimiter;
-	mNewLine   = true;
+
+	if( bufferSize == 0 )
+		return;
+
+	// leave room for the record that crosses the threshold
+	mBufferSize = bufferSize;
+
+	mBuffer.reserve(bufferSize + 256);
+	mBackBuffer.reserve(bufferSize + 256);
+
+	if( flushThread )
+	{
+		mThreadRunning = mThread.Start(&csvWriter::flushThread, this);
+
+		if( !mThreadRunning )
+			LogError("csvWriter -- failed to start the flush thread for %s, it will be written inline\n", filename);
+	}
 }
 
 
@@ -56,12 +78,12 @@ csvWriter::~csvWriter()
 
 	
 // open
-inline csvWriter* csvWriter::Open( const char* filename, const char* delimiter )
+inline csvWriter* csvWriter::Open( const char* filename, const char* delimiter, size_t bufferSize, bool flushThread )
 {
 	if( !filename || !delimiter )
 		return NULL;
 
-	csvWriter* csv = new csvWriter(filename, delimiter);
+	csvWriter* csv = new csvWriter(filename, delimiter, bufferSize, flushThread);
 
 	if( !csv->IsOpen() )
 	{
@@ -79,12 +101,31 @@ inline void csvWriter::Close()
 		return;
 
 	Flush();
+
+	if( mThreadRunning )
+	{
+		mMutex.Lock();
+		mThreadStop = true;
+		mMutex.Unlock();
+
+		mWakeEvent.Wake();
+		mThread.Stop(true);
+
+		mThreadRunning = false;
+	}
+
 	mFile.close();
 }
 
 // flush
 inline void csvWriter::Flush()
 {
+	if( IsBuffered() )
+	{
+		submit();
+		waitIdle();
+	}
+
 	mFile.flush();
 }
 
@@ -103,6 +144,12 @@ inline bool csvWriter::IsClosed() const
 // EndLine
 inline void csvWriter::EndLine()
 {
+	if( IsBuffered() )
+	{
+		record(RECORD_ENDL, NULL, 0);
+		return;
+	}
+
 	mFile << std::endl;
 	mNewLine = true;
 }
@@ -111,6 +158,12 @@ inline void csvWriter::EndLine()
 template<typename T>
 inline csvWriter& csvWriter::Write( const T& value )
 {
+	if( IsBuffered() )
+	{
+		buffer(value);
+		return *this;
+	}
+
 	if( !mNewLine )
 		mFile << mDelimiter;
 	else
@@ -170,6 +223,208 @@ inline const char* csvWriter::GetFilename() const
 	return mFilename.c_str();
 }
 
+// record (a type byte followed by the value)
+inline void csvWriter::record( uint8_t type, const void* data, size_t size )
+{
+	const size_t offset = mBuffer.size();
+
+	mBuffer.resize(offset + 1 + size);
+	mBuffer[offset] = type;
+
+	if( size > 0 )
+		memcpy(mBuffer.data() + offset + 1, data, size);
+
+	if( mBuffer.size() >= mBufferSize )
+		submit();
+}
+
+// record (strings are prefixed by their length)
+inline void csvWriter::record( const char* str, size_t length )
+{
+	const uint32_t len = length;
+	const size_t offset = mBuffer.size();
+
+	mBuffer.resize(offset + 1 + sizeof(len) + len);
+	mBuffer[offset] = RECORD_STRING;
+
+	memcpy(mBuffer.data() + offset + 1, &len, sizeof(len));
+	memcpy(mBuffer.data() + offset + 1 + sizeof(len), str, len);
+
+	if( mBuffer.size() >= mBufferSize )
+		submit();
+}
+
+// buffer (other types are formatted by their stream operator)
+template<typename T>
+inline void csvWriter::buffer( const T& value )
+{
+	std::ostringstream str;
+	str << value;
+	buffer(str.str());
+}
+
+// submit (hand the buffer off to be written)
+inline void csvWriter::submit()
+{
+	if( mBuffer.size() == 0 )
+		return;
+
+	if( !mThreadRunning )
+	{
+		format(mBuffer);
+		mBuffer.clear();
+		return;
+	}
+
+	// wait for the previous buffer to be written
+	waitIdle();
+
+	mMutex.Lock();
+	mBuffer.swap(mBackBuffer);
+	mMutex.Unlock();
+
+	mWakeEvent.Wake();
+}
+
+// waitIdle (wait until the thread is done writing)
+inline void csvWriter::waitIdle()
+{
+	while( mThreadRunning )
+	{
+		mMutex.Lock();
+		const bool idle = mBackBuffer.empty();
+		mMutex.Unlock();
+
+		if( idle )
+			break;
+
+		mIdleEvent.Wait(100);
+	}
+}
+
+// flushThread
+inline void* csvWriter::flushThread( void* param )
+{
+	csvWriter* csv = (csvWriter*)param;
+
+	while( true )
+	{
+		csv->mMutex.Lock();
+		const bool stop = csv->mThreadStop;
+		const bool pending = !csv->mBackBuffer.empty();
+		csv->mMutex.Unlock();
+
+		// the calling thread doesn't touch the back buffer until it's empty again
+		if( pending )
+		{
+			csv->format(csv->mBackBuffer);
+
+			csv->mMutex.Lock();
+			csv->mBackBuffer.clear();
+			csv->mMutex.Unlock();
+
+			csv->mIdleEvent.Wake();
+		}
+		else if( stop )
+		{
+			break;
+		}
+		else
+		{
+			csv->mWakeEvent.Wait(100);
+		}
+	}
+
+	return NULL;
+}
+
+// format (convert the records to text, and write it to the file)
+inline void csvWriter::format( const std::vector<char>& records )
+{
+	const char* ptr = records.data();
+	const char* end = ptr + records.size();
+
+	mText.clear();
+
+	char str[32];
+
+	while( ptr < end )
+	{
+		const uint8_t type = *ptr++;
+
+		if( type == RECORD_ENDL )
+		{
+			mText += '\n';
+			mFormatNewLine = true;
+			continue;
+		}
+
+		if( !mFormatNewLine )
+			mText += mDelimiter;
+		else
+			mFormatNewLine = false;
+
+		// the numbers are formatted the same as the stream operators would
+		if( type == RECORD_INT || type == RECORD_UINT )
+		{
+			uint64_t value;
+			memcpy(&value, ptr, sizeof(value));
+			ptr += sizeof(value);
+
+			const bool negative = (type == RECORD_INT && int64_t(value) < 0);
+
+			if( negative )
+				value = 0 - value;
+
+			char* digits = str + sizeof(str);
+
+			do
+			{
+				*--digits = '0' + (value % 10);
+				value /= 10;
+			} while( value > 0 );
+
+			if( negative )
+				*--digits = '-';
+
+			mText.append(digits, str + sizeof(str) - digits);
+		}
+		else if( type == RECORD_FLOAT || type == RECORD_DOUBLE )
+		{
+			double value;
+
+			if( type == RECORD_FLOAT )
+			{
+				float x;
+				memcpy(&x, ptr, sizeof(x));
+				ptr += sizeof(x);
+				value = x;
+			}
+			else
+			{
+				memcpy(&value, ptr, sizeof(value));
+				ptr += sizeof(value);
+			}
+
+			const int len = snprintf(str, sizeof(str), "%g", value);
+
+			if( len > 0 )
+				mText.append(str, len);
+		}
+		else if( type == RECORD_STRING )
+		{
+			uint32_t len;
+			memcpy(&len, ptr, sizeof(len));
+			ptr += sizeof(len);
+
+			mText.append(ptr, len);
+			ptr += len;
+		}
+	}
+
+	mFile.write(mText.data(), mText.size());
+}
+
 //----------------------------------------------------------------
 namespace csv
 {
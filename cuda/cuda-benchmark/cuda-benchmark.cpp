@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaResize.h"
+#include "cudaColorspace.h"
+#include "cudaCrop.h"
+#include "cudaNormalize.h"
+#include "cudaOverlay.h"
+#include "cudaWarp.h"
+#include "cudaColormap.h"
+#include "cudaFont.h"
+
+#include "csvWriter.h"
+#include "commandLine.h"
+#include "logging.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <string.h>
+
+
+// resolutions that are swept by default
+static const uint32_t defaultResolutions[][2] = { {640, 480}, {1280, 720}, {1920, 1080}, {3840, 2160} };
+
+// benchmark settings
+static int iterations = 100;
+static int warmup = 10;
+static const char* filter = NULL;
+static double peakBandwidth = 0.0;	// theoretical GB/s of the device
+static csvWriter* csvFile = NULL;
+
+// a benchmarked operation, which gets launched on the stream
+typedef std::function<cudaError_t (cudaStream_t)> benchmarkFunc;
+
+
+int usage()
+{
+	printf("usage: cuda-benchmark [--help] [--width=W --height=H] [--iterations=N]\n");
+	printf("                      [--warmup=N] [--filter=STR] [--csv=FILE]\n\n");
+	printf("Benchmark the throughput of the cuda/ image operators.\n\n");
+	printf("optional arguments:\n");
+	printf("  --help            show this help message and exit\n");
+	printf("  --width=W         image width to test (by default 480p, 720p, 1080p and 4K are swept)\n");
+	printf("  --height=H        image height to test\n");
+	printf("  --iterations=N    number of timed launches of each operator (default 100)\n");
+	printf("  --warmup=N        number of untimed launches before timing (default 10)\n");
+	printf("  --filter=STR      only run the operators whose name contains STR\n");
+	printf("  --csv=FILE        save the results to a CSV file\n\n");
+	printf("%s", Log::Usage());
+
+	return 0;
+}
+
+
+// query the theoretical memory bandwidth of the device (in GB/s)
+static double queryBandwidth()
+{
+	int device = 0;
+	int memoryClock = 0;	// kHz
+	int busWidth = 0;		// bits
+
+	if( CUDA_FAILED(cudaGetDevice(&device)) )
+		return 0.0;
+
+	if( CUDA_FAILED(cudaDeviceGetAttribute(&memoryClock, cudaDevAttrMemoryClockRate, device)) )
+		return 0.0;
+
+	if( CUDA_FAILED(cudaDeviceGetAttribute(&busWidth, cudaDevAttrGlobalMemoryBusWidth, device)) )
+		return 0.0;
+
+	// double data rate
+	return 2.0 * memoryClock * 1000.0 * (busWidth / 8) / 1.0e9;
+}
+
+
+// time an operator and report its throughput
+static bool benchmark( const char* op, const std::string& config, uint32_t width, uint32_t height, 
+				   size_t bytes, cudaStream_t stream, const benchmarkFunc& func )
+{
+	if( filter != NULL && strstr(op, filter) == NULL )
+		return true;
+
+	// the first launch checks that the operator supports this config (quietly)
+	const Log::Level logLevel = Log::GetLevel();
+	Log::SetLevel(Log::SILENT);
+	const cudaError_t status = func(stream);
+	Log::SetLevel(logLevel);
+
+	if( status != cudaSuccess )
+	{
+		cudaGetLastError();
+		return false;
+	}
+
+	for( int n=1; n < warmup; n++ )
+		func(stream);
+
+	cudaEvent_t start;
+	cudaEvent_t stop;
+
+	CUDA(cudaEventCreate(&start));
+	CUDA(cudaEventCreate(&stop));
+
+	CUDA(cudaEventRecord(start, stream));
+
+	for( int n=0; n < iterations; n++ )
+		func(stream);
+
+	CUDA(cudaEventRecord(stop, stream));
+	CUDA(cudaEventSynchronize(stop));
+
+	float elapsed = 0.0f;
+	CUDA(cudaEventElapsedTime(&elapsed, start, stop));
+
+	CUDA(cudaEventDestroy(start));
+	CUDA(cudaEventDestroy(stop));
+
+	const double time = elapsed / iterations;	// ms
+	const double mpixels = (width * height) / (time * 1000.0);
+	const double bandwidth = bytes / (time * 1.0e6);
+
+	if( bytes > 0 && peakBandwidth > 0.0 )
+		printf("%-22s %-24s %4ux%-4u  %8.3f ms  %9.1f MP/s  %7.2f GB/s  %5.1f%%\n", op, config.c_str(), width, height, time, mpixels, bandwidth, bandwidth / peakBandwidth * 100.0);
+	else if( bytes > 0 )
+		printf("%-22s %-24s %4ux%-4u  %8.3f ms  %9.1f MP/s  %7.2f GB/s\n", op, config.c_str(), width, height, time, mpixels, bandwidth);
+	else
+		printf("%-22s %-24s %4ux%-4u  %8.3f ms  %9.1f MP/s\n", op, config.c_str(), width, height, time, mpixels);
+
+	if( csvFile != NULL )
+		csvFile->WriteLine(op, config, width, height, time, mpixels, bandwidth, (peakBandwidth > 0.0) ? bandwidth / peakBandwidth : 0.0);
+
+	return true;
+}
+
+
+// run all of the operators at one resolution
+static void benchmarkResolution( uint32_t width, uint32_t height, void* input, void* output, cudaFont* font, cudaStream_t stream )
+{
+	const uint32_t halfWidth = width / 2;
+	const uint32_t halfHeight = height / 2;
+
+	const float affine[2][3] = { {0.9f, 0.1f, 10.0f}, {-0.1f, 0.9f, 20.0f} };
+	const float perspective[3][3] = { {0.9f, 0.1f, 10.0f}, {-0.1f, 0.9f, 20.0f}, {0.0001f, 0.0f, 1.0f} };
+
+	const float2 focalLength = make_float2(width * 0.8f, width * 0.8f);
+	const float2 principalPoint = make_float2(width * 0.5f, height * 0.5f);
+	const float4 distortion = make_float4(-0.3f, 0.1f, 0.0f, 0.0f);
+
+	// cudaResize
+	const imageFormat resizeFormats[] = { IMAGE_RGB8, IMAGE_RGBA8, IMAGE_RGB32F, IMAGE_RGBA32F };
+	const cudaFilterMode resizeFilters[] = { FILTER_POINT, FILTER_LINEAR, FILTER_AREA };
+
+	for( uint32_t f=0; f < sizeof(resizeFormats) / sizeof(imageFormat); f++ )
+	{
+		for( uint32_t m=0; m < sizeof(resizeFilters) / sizeof(cudaFilterMode); m++ )
+		{
+			const imageFormat format = resizeFormats[f];
+			const cudaFilterMode mode = resizeFilters[m];
+
+			benchmark("cudaResize", std::string(imageFormatToStr(format)) + " 1/2 " + cudaFilterModeToStr(mode), width, height,
+					imageFormatSize(format, width, height) + imageFormatSize(format, halfWidth, halfHeight), stream,
+					[=](cudaStream_t s) { return cudaResize(input, width, height, output, halfWidth, halfHeight, format, mode, s); });
+		}
+	}
+
+	// cudaConvertColor (every pair of formats that's supported)
+	for( int i=0; i < IMAGE_COUNT; i++ )
+	{
+		for( int o=0; o < IMAGE_COUNT; o++ )
+		{
+			const imageFormat inputFormat = (imageFormat)i;
+			const imageFormat outputFormat = (imageFormat)o;
+
+			if( inputFormat == outputFormat )
+				continue;
+
+			benchmark("cudaConvertColor", std::string(imageFormatToStr(inputFormat)) + "->" + imageFormatToStr(outputFormat), width, height,
+					imageFormatSize(inputFormat, width, height) + imageFormatSize(outputFormat, width, height), stream,
+					[=](cudaStream_t s) { return cudaConvertColor(input, inputFormat, output, outputFormat, width, height, make_float2(0,255), s); });
+		}
+	}
+
+	// cudaCrop
+	const imageFormat rgbFormats[] = { IMAGE_RGB8, IMAGE_RGBA8, IMAGE_RGB32F, IMAGE_RGBA32F };
+	const int4 roi = make_int4(width / 4, height / 4, width / 4 + halfWidth, height / 4 + halfHeight);
+
+	for( uint32_t f=0; f < sizeof(rgbFormats) / sizeof(imageFormat); f++ )
+	{
+		const imageFormat format = rgbFormats[f];
+
+		benchmark("cudaCrop", std::string(imageFormatToStr(format)) + " 1/2", width, height,
+				imageFormatSize(format, halfWidth, halfHeight) * 2, stream,
+				[=](cudaStream_t s) { return cudaCrop(input, output, roi, width, height, format, s); });
+	}
+
+	// cudaNormalize
+	for( uint32_t f=0; f < sizeof(rgbFormats) / sizeof(imageFormat); f++ )
+	{
+		const imageFormat format = rgbFormats[f];
+
+		benchmark("cudaNormalize", imageFormatToStr(format), width, height,
+				imageFormatSize(format, width, height) * 2, stream,
+				[=](cudaStream_t s) { return cudaNormalize(input, make_float2(0,255), output, make_float2(0,1), width, height, format, s); });
+	}
+
+	// cudaOverlay
+	for( uint32_t f=0; f < sizeof(rgbFormats) / sizeof(imageFormat); f++ )
+	{
+		const imageFormat format = rgbFormats[f];
+
+		benchmark("cudaOverlay", std::string(imageFormatToStr(format)) + " 1/4", width, height,
+				imageFormatSize(format, halfWidth, halfHeight) * 2, stream,
+				[=](cudaStream_t s) { return cudaOverlay(input, halfWidth, halfHeight, output, width, height, format, width / 4, height / 4, s); });
+	}
+
+	// cudaWarp*
+	const size_t rgba8Size = imageFormatSize(IMAGE_RGBA8, width, height) * 2;
+	const size_t rgba32Size = imageFormatSize(IMAGE_RGBA32F, width, height) * 2;
+
+	benchmark("cudaWarpAffine", "rgba8", width, height, rgba8Size, stream,
+			[=](cudaStream_t s) { return cudaWarpAffine((uchar4*)input, (uchar4*)output, width, height, affine, false, s); });
+
+	benchmark("cudaWarpAffine", "rgba32f", width, height, rgba32Size, stream,
+			[=](cudaStream_t s) { return cudaWarpAffine((float4*)input, (float4*)output, width, height, affine, false, s); });
+
+	benchmark("cudaWarpPerspective", "rgba8", width, height, rgba8Size, stream,
+			[=](cudaStream_t s) { return cudaWarpPerspective((uchar4*)input, (uchar4*)output, width, height, perspective, false, s); });
+
+	benchmark("cudaWarpPerspective", "rgba32f", width, height, rgba32Size, stream,
+			[=](cudaStream_t s) { return cudaWarpPerspective((float4*)input, (float4*)output, width, height, perspective, false, s); });
+
+	benchmark("cudaWarpIntrinsic", "rgba8", width, height, rgba8Size, stream,
+			[=](cudaStream_t s) { return cudaWarpIntrinsic((uchar4*)input, (uchar4*)output, width, height, focalLength, principalPoint, distortion, s); });
+
+	benchmark("cudaWarpIntrinsic", "rgba32f", width, height, rgba32Size, stream,
+			[=](cudaStream_t s) { return cudaWarpIntrinsic((float4*)input, (float4*)output, width, height, focalLength, principalPoint, distortion, s); });
+
+	benchmark("cudaWarpFisheye", "rgba8", width, height, rgba8Size, stream,
+			[=](cudaStream_t s) { return cudaWarpFisheye((uchar4*)input, (uchar4*)output, width, height, 1.0f, s); });
+
+	benchmark("cudaWarpFisheye", "rgba32f", width, height, rgba32Size, stream,
+			[=](cudaStream_t s) { return cudaWarpFisheye((float4*)input, (float4*)output, width, height, 1.0f, s); });
+
+	// cudaColormap
+	const imageFormat colormapFormats[] = { IMAGE_RGB8, IMAGE_RGBA8, IMAGE_RGB32F, IMAGE_RGBA32F };
+
+	for( uint32_t f=0; f < sizeof(colormapFormats) / sizeof(imageFormat); f++ )
+	{
+		const imageFormat format = colormapFormats[f];
+
+		benchmark("cudaColormap", std::string("gray32f->") + imageFormatToStr(format), width, height,
+				imageFormatSize(IMAGE_GRAY32F, width, height) + imageFormatSize(format, width, height), stream,
+				[=](cudaStream_t s) { return cudaColormap((float*)input, output, width, height, make_float2(0,255), FORMAT_DEFAULT, format, COLORMAP_DEFAULT, s); });
+	}
+
+	// cudaFont (draws on the default stream, so this measures the whole call)
+	if( font != NULL )
+	{
+		const char* text = "The quick brown fox jumps over the lazy dog 0123456789";
+
+		benchmark("cudaFont", "OverlayText rgba8", width, height, 0, NULL,
+				[=](cudaStream_t s) { return font->OverlayText(output, IMAGE_RGBA8, width, height, text, 5, 5) ? cudaSuccess : cudaErrorInvalidValue; });
+	}
+}
+
+
+int main( int argc, char** argv )
+{
+	commandLine cmdLine(argc, argv);
+
+	if( cmdLine.GetFlag("help") )
+		return usage();
+
+	iterations = cmdLine.GetInt("iterations", iterations);
+	warmup = cmdLine.GetInt("warmup", warmup);
+	filter = cmdLine.GetString("filter");
+
+	if( iterations < 1 )
+		iterations = 1;
+
+	// the resolutions to test
+	std::vector< std::pair<uint32_t, uint32_t> > resolutions;
+
+	const int width = cmdLine.GetInt("width");
+	const int height = cmdLine.GetInt("height");
+
+	if( width > 0 && height > 0 )
+		resolutions.push_back(std::pair<uint32_t, uint32_t>(width, height));
+	else
+		for( uint32_t n=0; n < sizeof(defaultResolutions) / sizeof(defaultResolutions[0]); n++ )
+			resolutions.push_back(std::pair<uint32_t, uint32_t>(defaultResolutions[n][0], defaultResolutions[n][1]));
+
+	// open the CSV file
+	const char* csvPath = cmdLine.GetString("csv");
+
+	if( csvPath != NULL )
+	{
+		csvFile = csvWriter::Open(csvPath);
+
+		if( !csvFile )
+			return 1;
+
+		csvFile->WriteLine("operator", "config", "width", "height", "time_ms", "mpixels_per_sec", "gbytes_per_sec", "peak_fraction");
+	}
+
+	// query the device
+	cudaDeviceProp props;
+
+	if( CUDA_FAILED(cudaGetDeviceProperties(&props, 0)) )
+		return 1;
+
+	peakBandwidth = queryBandwidth();
+
+	printf("cuda-benchmark:  %s (SM %i.%i), theoretical bandwidth %.1f GB/s\n", props.name, props.major, props.minor, peakBandwidth);
+	printf("cuda-benchmark:  %i iterations, %i warmup\n\n", iterations, warmup);
+
+	// the font is optional, if it can't be loaded that benchmark is skipped
+	cudaFont* font = cudaFont::Create();
+
+	cudaStream_t stream = NULL;
+
+	if( CUDA_FAILED(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking)) )
+		return 1;
+
+	for( size_t r=0; r < resolutions.size(); r++ )
+	{
+		const uint32_t w = resolutions[r].first;
+		const uint32_t h = resolutions[r].second;
+
+		// the largest format is RGBA32F, and the buffers are device memory so
+		// the results measure the kernels (and not zero-copy memory)
+		const size_t bufferSize = imageFormatSize(IMAGE_RGBA32F, w, h);
+
+		void* input = NULL;
+		void* output = NULL;
+
+		if( CUDA_FAILED(cudaMalloc(&input, bufferSize)) || CUDA_FAILED(cudaMalloc(&output, bufferSize)) )
+		{
+			LogError("cuda-benchmark:  failed to allocate %zu bytes for %ux%u\n", bufferSize, w, h);
+			CUDA_FREE(input);
+			break;
+		}
+
+		CUDA(cudaMemset(input, 0x40, bufferSize));
+
+		printf("%-22s %-24s %-9s  %11s  %14s  %12s  %6s\n", "operator", "config", "size", "time", "throughput", "bandwidth", "peak");
+		benchmarkResolution(w, h, input, output, font, stream);
+		printf("\n");
+
+		CUDA_FREE(input);
+		CUDA_FREE(output);
+	}
+
+	CUDA(cudaStreamDestroy(stream));
+
+	SAFE_DELETE(font);
+	SAFE_DELETE(csvFile);
+
+	return 0;
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaAutotune.h"
+#include "logging.h"
+#include "Mutex.h"
+
+#include <map>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+
+// the tuned configurations of one device
+struct cudaAutotuneDevice
+{
+	std::string path;	// the cache file
+	std::map<std::string, dim3> configs;
+};
+
+static std::map<int, cudaAutotuneDevice*> gDevices;
+static Mutex gAutotuneMutex;
+
+static int gEnabled = -1;	// -1 until the environment variable has been checked
+
+
+// makeKey
+static std::string makeKey( const char* kernel, size_t pixelSize, uint32_t width, uint32_t height )
+{
+	char str[256];
+	snprintf(str, sizeof(str), "%s:%zu:%ux%u", kernel, pixelSize, width, height);
+	return str;
+}
+
+
+// cachePath
+static std::string cachePath( int device )
+{
+	const char* env = getenv("JETSON_UTILS_AUTOTUNE_CACHE");
+
+	if( env != NULL && strlen(env) > 0 )
+		return env;
+
+	const char* home = getenv("HOME");
+
+	if( !home )
+		return "";
+
+	cudaDeviceProp props;
+
+	if( CUDA_FAILED(cudaGetDeviceProperties(&props, device)) )
+		return "";
+
+	// the device name may contain spaces and slashes
+	std::string name = props.name;
+
+	for( size_t n=0; n < name.size(); n++ )
+	{
+		const char c = name[n];
+
+		if( !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.') )
+			name[n] = '_';
+	}
+
+	char file[512];
+	snprintf(file, sizeof(file), "%s/.cache/jetson-utils/autotune-%s-sm%d%d.txt", home, name.c_str(), props.major, props.minor);
+
+	return file;
+}
+
+
+// findDevice (the mutex should be locked)
+static cudaAutotuneDevice* findDevice()
+{
+	int device = 0;
+
+	if( cudaGetDevice(&device) != cudaSuccess )
+		return NULL;
+
+	std::map<int, cudaAutotuneDevice*>::iterator iter = gDevices.find(device);
+
+	if( iter != gDevices.end() )
+		return iter->second;
+
+	// load the cache file on first use
+	cudaAutotuneDevice* dev = new cudaAutotuneDevice();
+	dev->path = cachePath(device);
+	gDevices[device] = dev;
+
+	if( dev->path.size() == 0 )
+		return dev;
+
+	FILE* file = fopen(dev->path.c_str(), "r");
+
+	if( !file )
+		return dev;
+
+	char key[256];
+	unsigned int x = 0;
+	unsigned int y = 0;
+
+	while( fscanf(file, "%255s %u %u", key, &x, &y) == 3 )
+		dev->configs[key] = dim3(x, y, 1);
+
+	fclose(file);
+
+	LogVerbose(LOG_CUDA "loaded %zu autotuned kernel configurations from %s\n", dev->configs.size(), dev->path.c_str());
+	return dev;
+}
+
+
+// cudaAutotuneSetEnabled
+void cudaAutotuneSetEnabled( bool enabled )
+{
+	gEnabled = enabled ? 1 : 0;
+}
+
+
+// cudaAutotuneIsEnabled
+bool cudaAutotuneIsEnabled()
+{
+	if( gEnabled < 0 )
+	{
+		const char* env = getenv("JETSON_UTILS_AUTOTUNE");
+		gEnabled = (env != NULL && strcmp(env, "0") == 0) ? 0 : 1;
+	}
+
+	return (gEnabled > 0);
+}
+
+
+// cudaAutotuneCanTune
+bool cudaAutotuneCanTune( cudaStream_t stream )
+{
+	if( !cudaAutotuneIsEnabled() )
+		return false;
+
+#if CUDART_VERSION >= 10000
+	cudaStreamCaptureStatus status = cudaStreamCaptureStatusNone;
+
+	if( cudaStreamIsCapturing(stream, &status) != cudaSuccess || status != cudaStreamCaptureStatusNone )
+		return false;
+#endif
+
+	return true;
+}
+
+
+// cudaAutotuneCandidates
+const std::vector<dim3>& cudaAutotuneCandidates()
+{
+	static std::vector<dim3> candidates;
+
+	gAutotuneMutex.Lock();
+
+	if( candidates.size() == 0 )
+	{
+		candidates.push_back(dim3(8,8,1));
+		candidates.push_back(dim3(16,8,1));
+		candidates.push_back(dim3(16,16,1));
+		candidates.push_back(dim3(32,4,1));
+		candidates.push_back(dim3(32,8,1));
+		candidates.push_back(dim3(32,16,1));
+		candidates.push_back(dim3(64,2,1));
+		candidates.push_back(dim3(64,4,1));
+		candidates.push_back(dim3(128,1,1));
+		candidates.push_back(dim3(128,2,1));
+		candidates.push_back(dim3(256,1,1));
+	}
+
+	gAutotuneMutex.Unlock();
+	return candidates;
+}
+
+
+// cudaAutotuneLookup
+bool cudaAutotuneLookup( const char* kernel, size_t pixelSize, uint32_t width, uint32_t height, dim3* blockDim )
+{
+	if( !kernel || !blockDim )
+		return false;
+
+	bool found = false;
+
+	gAutotuneMutex.Lock();
+
+	cudaAutotuneDevice* dev = findDevice();
+
+	if( dev != NULL )
+	{
+		std::map<std::string, dim3>::iterator iter = dev->configs.find(makeKey(kernel, pixelSize, width, height));
+
+		if( iter != dev->configs.end() )
+		{
+			*blockDim = iter->second;
+			found = true;
+		}
+	}
+
+	gAutotuneMutex.Unlock();
+	return found;
+}
+
+
+// cudaAutotuneStore
+void cudaAutotuneStore( const char* kernel, size_t pixelSize, uint32_t width, uint32_t height, const dim3& blockDim )
+{
+	if( !kernel )
+		return;
+
+	const std::string key = makeKey(kernel, pixelSize, width, height);
+
+	gAutotuneMutex.Lock();
+
+	cudaAutotuneDevice* dev = findDevice();
+
+	if( !dev )
+	{
+		gAutotuneMutex.Unlock();
+		return;
+	}
+
+	dev->configs[key] = blockDim;
+
+	LogVerbose(LOG_CUDA "autotuned %s -> block (%u, %u)\n", key.c_str(), blockDim.x, blockDim.y);
+
+	// append the configuration to the cache
+	if( dev->path.size() > 0 )
+	{
+		const size_t dir = dev->path.rfind('/');
+
+		if( dir != std::string::npos )
+		{
+			const size_t parent = dev->path.rfind('/', dir - 1);
+
+			if( parent != std::string::npos && parent > 0 )
+				mkdir(dev->path.substr(0, parent).c_str(), 0755);
+
+			mkdir(dev->path.substr(0, dir).c_str(), 0755);
+		}
+
+		FILE* file = fopen(dev->path.c_str(), "a");
+
+		if( file != NULL )
+		{
+			fprintf(file, "%s %u %u\n", key.c_str(), blockDim.x, blockDim.y);
+			fclose(file);
+		}
+		else
+		{
+			LogWarning(LOG_CUDA "failed to save autotuned kernel configuration to %s\n", dev->path.c_str());
+		}
+	}
+
+	gAutotuneMutex.Unlock();
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_AUTOTUNE_H__
+#define __CUDA_AUTOTUNE_H__
+
+
+#include "cudaUtility.h"
+
+#include <vector>
+#include <float.h>
+
+
+/**
+ * The number of timed launches of each candidate block size when autotuning.
+ * @ingroup cuda
+ */
+#define CUDA_AUTOTUNE_ITERATIONS 5
+
+
+/**
+ * Enable or disable autotuning of the kernel launch configurations.
+ *
+ * Autotuning is enabled by default, unless the `JETSON_UTILS_AUTOTUNE` environment
+ * variable is set to 0.  While it's disabled, configurations that were already tuned
+ * (or loaded from the cache) are still used, and the defaults are used for the rest.
+ *
+ * @ingroup cuda
+ */
+void cudaAutotuneSetEnabled( bool enabled );
+
+/**
+ * Return true if autotuning is enabled.
+ * @ingroup cuda
+ */
+bool cudaAutotuneIsEnabled();
+
+/**
+ * Look up the tuned block size of a kernel for the current device.
+ *
+ * The configuration is keyed by the kernel name, the size of its pixels (in bytes),
+ * and the image resolution.  The tuned configurations of each device are cached in
+ * `~/.cache/jetson-utils/autotune-<device>.txt` (or the file that the
+ * `JETSON_UTILS_AUTOTUNE_CACHE` environment variable points to).
+ *
+ * @returns true if the kernel has been tuned for this configuration, otherwise false.
+ * @ingroup cuda
+ */
+bool cudaAutotuneLookup( const char* kernel, size_t pixelSize, uint32_t width, uint32_t height, dim3* blockDim );
+
+/**
+ * Record the tuned block size of a kernel for the current device (and save it to the cache).
+ * @ingroup cuda
+ */
+void cudaAutotuneStore( const char* kernel, size_t pixelSize, uint32_t width, uint32_t height, const dim3& blockDim );
+
+/**
+ * Return true if a kernel can be benchmarked on this stream now (autotuning
+ * is enabled, and the stream isn't being captured into a CUDA graph).
+ * @ingroup cuda
+ */
+bool cudaAutotuneCanTune( cudaStream_t stream );
+
+/**
+ * Return the block sizes that get benchmarked (2D shapes of 64 to 512 threads).
+ * @ingroup cuda
+ */
+const std::vector<dim3>& cudaAutotuneCandidates();
+
+
+/**
+ * Select the block size to launch a kernel with.
+ *
+ * The first time that a kernel is run for a pixel size and resolution, each of the
+ * candidate block sizes is benchmarked by calling `launch(blockDim)` on `stream`,
+ * and the fastest one is remembered.  Afterwards it's looked up from the cache.
+ *
+ * `launch` should queue the kernel with the given block size and return the result
+ * of cudaGetLastError().  Because the kernel runs several times while it's being
+ * tuned, this should only be used for kernels whose output doesn't depend on the
+ * previous contents of the output (i.e. that aren't run in-place).
+ *
+ * @returns the block size to launch the kernel with.
+ * @ingroup cuda
+ */
+template<typename Launch>
+inline dim3 cudaAutotune( const char* kernel, size_t pixelSize, uint32_t width, uint32_t height,
+					 const dim3& defaultBlock, cudaStream_t stream, Launch launch )
+{
+	dim3 blockDim = defaultBlock;
+
+	if( cudaAutotuneLookup(kernel, pixelSize, width, height, &blockDim) || !cudaAutotuneCanTune(stream) )
+		return blockDim;
+
+	cudaEvent_t start = NULL;
+	cudaEvent_t stop  = NULL;
+
+	if( cudaEventCreate(&start) != cudaSuccess || cudaEventCreate(&stop) != cudaSuccess )
+	{
+		if( start != NULL )
+			cudaEventDestroy(start);
+
+		return defaultBlock;
+	}
+
+	const std::vector<dim3>& candidates = cudaAutotuneCandidates();
+	float bestTime = FLT_MAX;
+
+	for( size_t n=0; n < candidates.size(); n++ )
+	{
+		// the first launch is a warmup, and checks that the configuration is valid
+		if( launch(candidates[n]) != cudaSuccess )
+			continue;
+
+		cudaEventRecord(start, stream);
+
+		for( uint32_t i=0; i < CUDA_AUTOTUNE_ITERATIONS; i++ )
+			launch(candidates[n]);
+
+		cudaEventRecord(stop, stream);
+
+		float time = 0.0f;
+
+		if( cudaEventSynchronize(stop) != cudaSuccess || cudaEventElapsedTime(&time, start, stop) != cudaSuccess )
+			continue;
+
+		if( time < bestTime )
+		{
+			bestTime = time;
+			blockDim = candidates[n];
+		}
+	}
+
+	cudaEventDestroy(start);
+	cudaEventDestroy(stop);
+
+	if( bestTime == FLT_MAX )
+		return defaultBlock;
+
+	cudaAutotuneStore(kernel, pixelSize, width, height, blockDim);
+	return blockDim;
+}
+
+#endif
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaBayer.h"
+#include "cudaVector.h"
+#include "cudaNVTX.h"
+
+
+// mirror a coordinate about the image border, which keeps the parity of the Bayer pattern
+inline __device__ int bayerMirror( int x, int size )
+{
+	if( x < 0 )
+		return -x;
+	else if( x >= size )
+		return 2 * (size - 1) - x;
+
+	return x;
+}
+
+// read a pixel of the Bayer image (with the black level removed)
+template<typename T>
+inline __device__ float bayerPixel( const T* input, int x, int y, int width, int height, float blackLevel )
+{
+	return float(input[bayerMirror(y, height) * width + bayerMirror(x, width)]) - blackLevel;
+}
+
+
+//-----------------------------------------------------------------------------------
+// Malvar-He-Cutler demosaic with white balance and gamma
+//
+//   H. Malvar, L. He, and R. Cutler, "High-quality linear interpolation for
+//   demosaicing of Bayer-patterned color images", ICASSP 2004.
+//
+// The missing colors of each pixel are bilinear estimates that are corrected by
+// the Laplacian of the pixel's own color channel, using fixed 5x5 filters (/8).
+//-----------------------------------------------------------------------------------
+template<typename T_in, typename T_out>
+__global__ void gpuBayerMHC( T_in* input, T_out* output, int width, int height, int redX, int redY,
+					    float blackLevel, float3 gain, float invGamma )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	#define P(dx, dy) bayerPixel(input, x + (dx), y + (dy), width, height, blackLevel)
+
+	const float C = P(0,0);
+
+	// axial neighbors at distance 1 and 2, and the diagonals
+	const float N1 = P(0,-1), S1 = P(0,1), W1 = P(-1,0), E1 = P(1,0);
+	const float N2 = P(0,-2), S2 = P(0,2), W2 = P(-2,0), E2 = P(2,0);
+	const float D1 = P(-1,-1) + P(1,-1) + P(-1,1) + P(1,1);
+
+	#undef P
+
+	// the position within the 2x2 pattern, relative to the red pixel
+	const bool oddX = (x ^ redX) & 1;
+	const bool oddY = (y ^ redY) & 1;
+
+	// green at red/blue pixels
+	const float greenRB = (4.0f * C + 2.0f * (N1 + S1 + W1 + E1) - (N2 + S2 + W2 + E2)) * 0.125f;
+
+	// red/blue at green pixels, from the horizontal or vertical neighbors
+	const float horz = (5.0f * C + 4.0f * (W1 + E1) - (W2 + E2) + 0.5f * (N2 + S2) - D1) * 0.125f;
+	const float vert = (5.0f * C + 4.0f * (N1 + S1) - (N2 + S2) + 0.5f * (W2 + E2) - D1) * 0.125f;
+
+	// red at blue pixels and blue at red pixels, from the diagonal neighbors
+	const float diag = (6.0f * C + 2.0f * D1 - 1.5f * (N2 + S2 + W2 + E2)) * 0.125f;
+
+	float3 rgb;
+
+	if( !oddX && !oddY )
+		rgb = make_float3(C, greenRB, diag);		// red pixel
+	else if( oddX && oddY )
+		rgb = make_float3(diag, greenRB, C);		// blue pixel
+	else if( oddX )
+		rgb = make_float3(horz, C, vert);			// green pixel on a red row
+	else
+		rgb = make_float3(vert, C, horz);			// green pixel on a blue row
+
+	// white balance (the gains are pre-scaled to normalize the range to 0-1)
+	rgb.x = fminf(fmaxf(rgb.x * gain.x, 0.0f), 1.0f);
+	rgb.y = fminf(fmaxf(rgb.y * gain.y, 0.0f), 1.0f);
+	rgb.z = fminf(fmaxf(rgb.z * gain.z, 0.0f), 1.0f);
+
+	if( invGamma != 1.0f )
+	{
+		rgb.x = __powf(rgb.x, invGamma);
+		rgb.y = __powf(rgb.y, invGamma);
+		rgb.z = __powf(rgb.z, invGamma);
+	}
+
+	typedef typename cudaVectorTypeInfo<T_out>::Base T_base;
+
+	// round to the nearest integer for uint8 outputs
+	const float bias = (sizeof(T_base) == 1) ? 0.5f : 0.0f;
+
+	output[y * width + x] = make_vec<T_out>(T_base(rgb.x * 255.0f + bias), T_base(rgb.y * 255.0f + bias), T_base(rgb.z * 255.0f + bias), T_base(255));
+}
+
+template<typename T_in, typename T_out>
+static cudaError_t launchBayerMHC( T_in* input, T_out* output, size_t width, size_t height, int redX, int redY, 
+							float whiteLevel, const cudaBayerOptions& options, cudaStream_t stream )
+{
+	const float range = whiteLevel - options.blackLevel;
+
+	if( range <= 0.0f || options.gamma <= 0.0f )
+		return cudaErrorInvalidValue;
+
+	const float3 gain = make_float3(options.whiteBalance.x / range, 
+							  options.whiteBalance.y / range, 
+							  options.whiteBalance.z / range);
+
+	const dim3 blockDim(32,8);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+
+	gpuBayerMHC<T_in, T_out><<<gridDim, blockDim, 0, stream>>>(input, output, width, height, redX, redY,
+												    options.blackLevel, gain, 1.0f / options.gamma);
+
+	return CUDA(cudaGetLastError());
+}
+
+template<typename T_in>
+static cudaError_t launchBayerMHC( T_in* input, void* output, imageFormat outputFormat, size_t width, size_t height, 
+							int redX, int redY, float whiteLevel, const cudaBayerOptions& options, cudaStream_t stream )
+{
+	if( outputFormat == IMAGE_RGB8 )
+		return launchBayerMHC(input, (uchar3*)output, width, height, redX, redY, whiteLevel, options, stream);
+	else if( outputFormat == IMAGE_RGBA8 )
+		return launchBayerMHC(input, (uchar4*)output, width, height, redX, redY, whiteLevel, options, stream);
+	else if( outputFormat == IMAGE_RGB32F )
+		return launchBayerMHC(input, (float3*)output, width, height, redX, redY, whiteLevel, options, stream);
+	else if( outputFormat == IMAGE_RGBA32F )
+		return launchBayerMHC(input, (float4*)output, width, height, redX, redY, whiteLevel, options, stream);
+
+	imageFormatErrorMsg(LOG_CUDA, "cudaBayerDemosaic()", outputFormat);
+	return cudaErrorInvalidValue;
+}
+
+
+// cudaBayerDemosaic
+cudaError_t cudaBayerDemosaic( void* input, imageFormat inputFormat, void* output, imageFormat outputFormat,
+						 size_t width, size_t height, const cudaBayerOptions& options, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaBayerDemosaic");
+
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width < 3 || height < 3 )
+		return cudaErrorInvalidValue;
+
+	// position of the red pixel within the 2x2 pattern
+	int redX = 0;
+	int redY = 0;
+
+	if( inputFormat == IMAGE_BAYER_BGGR || inputFormat == IMAGE_BAYER_BGGR16 )
+	{
+		redX = 1;
+		redY = 1;
+	}
+	else if( inputFormat == IMAGE_BAYER_GBRG || inputFormat == IMAGE_BAYER_GBRG16 )
+	{
+		redY = 1;
+	}
+	else if( inputFormat == IMAGE_BAYER_GRBG || inputFormat == IMAGE_BAYER_GRBG16 )
+	{
+		redX = 1;
+	}
+	else if( inputFormat != IMAGE_BAYER_RGGB && inputFormat != IMAGE_BAYER_RGGB16 )
+	{
+		LogError(LOG_CUDA "cudaBayerDemosaic() -- input format %s isn't a Bayer format\n", imageFormatToStr(inputFormat));
+		return cudaErrorInvalidValue;
+	}
+
+	if( imageFormatIsBayer16(inputFormat) )
+	{
+		if( options.bitDepth == 0 || options.bitDepth > 16 )
+			return cudaErrorInvalidValue;
+
+		return launchBayerMHC((uint16_t*)input, output, outputFormat, width, height, redX, redY, 
+						  float((1 << options.bitDepth) - 1), options, stream);
+	}
+
+	return launchBayerMHC((uint8_t*)input, output, outputFormat, width, height, redX, redY, 255.0f, options, stream);
+}
@@ -22,13 +22,50 @@
 
 #include "cudaBayer.h"
 #include "logging.h"
+#include "cudaNVTX.h"
 
 #include <nppi.h>
+#include <nppcore.h>
+
+#include <string.h>
+
+
+// nppStreamContext (fill an NPP stream context for the current device, so the global NPP stream isn't touched)
+static bool nppStreamContext( NppStreamContext& ctx, cudaStream_t stream )
+{
+	memset(&ctx, 0, sizeof(NppStreamContext));
+
+	ctx.hStream = stream;
+
+	if( CUDA_FAILED(cudaGetDevice(&ctx.nCudaDeviceId)) )
+		return false;
+
+	if( CUDA_FAILED(cudaDeviceGetAttribute(&ctx.nMultiProcessorCount, cudaDevAttrMultiProcessorCount, ctx.nCudaDeviceId)) ||
+	    CUDA_FAILED(cudaDeviceGetAttribute(&ctx.nMaxThreadsPerMultiProcessor, cudaDevAttrMaxThreadsPerMultiProcessor, ctx.nCudaDeviceId)) ||
+	    CUDA_FAILED(cudaDeviceGetAttribute(&ctx.nMaxThreadsPerBlock, cudaDevAttrMaxThreadsPerBlock, ctx.nCudaDeviceId)) ||
+	    CUDA_FAILED(cudaDeviceGetAttribute(&ctx.nCudaDevAttrComputeCapabilityMajor, cudaDevAttrComputeCapabilityMajor, ctx.nCudaDeviceId)) ||
+	    CUDA_FAILED(cudaDeviceGetAttribute(&ctx.nCudaDevAttrComputeCapabilityMinor, cudaDevAttrComputeCapabilityMinor, ctx.nCudaDeviceId)) )
+		return false;
+
+	int sharedMemPerBlock = 0;
+
+	if( CUDA_FAILED(cudaDeviceGetAttribute(&sharedMemPerBlock, cudaDevAttrMaxSharedMemoryPerBlock, ctx.nCudaDeviceId)) )
+		return false;
+
+	ctx.nSharedMemPerBlock = sharedMemPerBlock;
+
+	if( stream != NULL && CUDA_FAILED(cudaStreamGetFlags(stream, &ctx.nStreamFlags)) )
+		return false;
+
+	return true;
+}
 
 
 // cudaBayerToRGB
-cudaError_t cudaBayerToRGB( uint8_t* input, uchar3* output, size_t width, size_t height, imageFormat format )
+cudaError_t cudaBayerToRGB( uint8_t* input, uchar3* output, size_t width, size_t height, imageFormat format, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaBayerToRGB");
+
 	NppiSize size;
 	size.width = width;
 	size.height = height;
@@ -52,9 +89,15 @@ cudaError_t cudaBayerToRGB( uint8_t* input, uchar3* output, size_t width, size_t
 	else
 		return cudaErrorInvalidValue;
 	
-	const NppStatus result = nppiCFAToRGB_8u_C1C3R(input, width * sizeof(uint8_t), size, roi, 
-												   (uint8_t*)output, width * sizeof(uchar3),
-												   grid, NPPI_INTER_UNDEFINED);
+	// pass the stream through a context instead of the per-process nppSetStream()
+	NppStreamContext ctx;
+
+	if( !nppStreamContext(ctx, stream) )
+		return cudaErrorInvalidDevice;
+
+	const NppStatus result = nppiCFAToRGB_8u_C1C3R_Ctx(input, width * sizeof(uint8_t), size, roi, 
+													   (uint8_t*)output, width * sizeof(uchar3),
+													   grid, NPPI_INTER_UNDEFINED, ctx);
 	
 	if( result != 0 )
 	{
@@ -65,8 +108,10 @@ cudaError_t cudaBayerToRGB( uint8_t* input, uchar3* output, size_t width, size_t
 }
 
 
-cudaError_t cudaBayerToRGBA( uint8_t* input, uchar3* output, size_t width, size_t height, imageFormat format )
+cudaError_t cudaBayerToRGBA( uint8_t* input, uchar3* output, size_t width, size_t height, imageFormat format, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaBayerToRGBA");
+
 	return cudaErrorInvalidValue;
 	
 }
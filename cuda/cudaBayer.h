@@ -40,15 +40,78 @@
  * Demosaick an 8-bit Bayer image to uchar3 RGB.
  * @params format the Bayer pattern of the input image, should be one of: 	
  *                IMAGE_BAYER_BGGR, IMAGE_BAYER_GBRG, IMAGE_BAYER_GRBG, IMAGE_BAYER_RGGB
+ * @param stream CUDA stream that NPP should run the demosaick on (the default stream is used if NULL)
  */
-cudaError_t cudaBayerToRGB( uint8_t* input, uchar3* output, size_t width, size_t height, imageFormat format );
+cudaError_t cudaBayerToRGB( uint8_t* input, uchar3* output, size_t width, size_t height, imageFormat format, cudaStream_t stream=NULL );
 
 /**
  * Demosaick an 8-bit Bayer image to uchar4 RGBA.
  * @params format the Bayer pattern of the input image, should be one of: 	
  *                IMAGE_BAYER_BGGR, IMAGE_BAYER_GBRG, IMAGE_BAYER_GRBG, IMAGE_BAYER_RGGB
+ * @param stream CUDA stream that NPP should run the demosaick on (the default stream is used if NULL)
  */
-cudaError_t cudaBayerToRGBA( uint8_t* input, uchar3* output, size_t width, size_t height, imageFormat format );
+cudaError_t cudaBayerToRGBA( uint8_t* input, uchar3* output, size_t width, size_t height, imageFormat format, cudaStream_t stream=NULL );
+
+///@}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+/// @name Edge-aware Bayer demosaic (8-bit and 16-bit)
+/// @see cudaConvertColor() from cudaColorspace.h for automated format conversion
+/// @ingroup colorspace
+//////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+/**
+ * Settings of cudaBayerDemosaic() that are applied in the same kernel as the demosaic.
+ */
+struct cudaBayerOptions
+{
+	/**
+	 * The number of significant bits in the 16-bit Bayer formats, which are LSB-aligned
+	 * (e.g. 10 for RAW10, 12 for RAW12, or 16).  This is ignored for the 8-bit formats.
+	 */
+	uint32_t bitDepth;
+
+	/**
+	 * The black level that gets subtracted, in the same units as the input (default 0).
+	 */
+	float blackLevel;
+
+	/**
+	 * The white balance gains of the red, green, and blue channels (default 1,1,1).
+	 */
+	float3 whiteBalance;
+
+	/**
+	 * The gamma that the linear sensor values are encoded with, where output = input^(1/gamma).
+	 * The default of 1.0 leaves the values linear, 2.2 is typical for display.
+	 */
+	float gamma;
+
+	/**
+	 * Default settings (12-bit, no black level, white balance, or gamma)
+	 */
+	cudaBayerOptions() : bitDepth(12), blackLevel(0.0f), whiteBalance(make_float3(1.0f, 1.0f, 1.0f)), gamma(1.0f) {}
+};
+
+/**
+ * Demosaick an 8-bit or 16-bit Bayer image with the Malvar-He-Cutler algorithm.
+ *
+ * This is gradient-corrected linear interpolation over a 5x5 window, which has much less
+ * color fringing along edges than bilinear interpolation, while still only being one pass.
+ * The black level, white balance, and gamma from cudaBayerOptions are applied in the same kernel.
+ *
+ * @param input the Bayer image, in one of the 8-bit formats (e.g. IMAGE_BAYER_RGGB)
+ *              or the 16-bit formats (e.g. IMAGE_BAYER_RGGB16)
+ * @param output the RGB image, in IMAGE_RGB8, IMAGE_RGBA8, IMAGE_RGB32F, or IMAGE_RGBA32F
+ *               (the float formats have the same 0-255 range as the others)
+ * @param stream CUDA stream to run the kernel on (the default stream is used if NULL)
+ */
+cudaError_t cudaBayerDemosaic( void* input, imageFormat inputFormat, void* output, imageFormat outputFormat,
+						 size_t width, size_t height, const cudaBayerOptions& options=cudaBayerOptions(),
+						 cudaStream_t stream=NULL );
 
 ///@}
 
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaColorimetry.h"
+
+#include <string.h>
+#include <strings.h>
+
+
+// cudaColorimetryFromStr
+cudaColorimetry cudaColorimetryFromStr( const char* str, cudaColorimetry default_value )
+{
+	if( !str )
+		return default_value;
+
+	if( strcasecmp(str, "jpeg") == 0 || strcasecmp(str, "bt601-full") == 0 )
+		return COLORIMETRY_BT601_FULL;
+	else if( strcasecmp(str, "bt601") == 0 || strcasecmp(str, "bt601-limited") == 0 )
+		return COLORIMETRY_BT601_LIMITED;
+	else if( strcasecmp(str, "bt709-full") == 0 )
+		return COLORIMETRY_BT709_FULL;
+	else if( strcasecmp(str, "bt709") == 0 || strcasecmp(str, "bt709-limited") == 0 )
+		return COLORIMETRY_BT709_LIMITED;
+	else if( strcasecmp(str, "bt2020-full") == 0 )
+		return COLORIMETRY_BT2020_FULL;
+	else if( strcasecmp(str, "bt2020") == 0 || strcasecmp(str, "bt2020-limited") == 0 )
+		return COLORIMETRY_BT2020_LIMITED;
+
+	return default_value;
+}
+
+
+// cudaColorimetryToStr
+const char* cudaColorimetryToStr( cudaColorimetry colorimetry )
+{
+	switch(colorimetry)
+	{
+		case COLORIMETRY_BT601_FULL:		return "bt601-full";
+		case COLORIMETRY_BT601_LIMITED:	return "bt601-limited";
+		case COLORIMETRY_BT709_FULL:		return "bt709-full";
+		case COLORIMETRY_BT709_LIMITED:	return "bt709-limited";
+		case COLORIMETRY_BT2020_FULL:		return "bt2020-full";
+		case COLORIMETRY_BT2020_LIMITED:	return "bt2020-limited";
+	}
+
+	return "unknown";
+}
+
+
+// cudaColorimetryMatrix
+cudaYUVMatrix cudaColorimetryMatrix( cudaColorimetry colorimetry )
+{
+	// luma weights of red and blue
+	float kr = 0.299f;
+	float kb = 0.114f;
+
+	if( colorimetry == COLORIMETRY_BT709_FULL || colorimetry == COLORIMETRY_BT709_LIMITED )
+	{
+		kr = 0.2126f;
+		kb = 0.0722f;
+	}
+	else if( colorimetry == COLORIMETRY_BT2020_FULL || colorimetry == COLORIMETRY_BT2020_LIMITED )
+	{
+		kr = 0.2627f;
+		kb = 0.0593f;
+	}
+
+	const float kg = 1.0f - kr - kb;
+
+	const bool limited = (colorimetry == COLORIMETRY_BT601_LIMITED ||
+					  colorimetry == COLORIMETRY_BT709_LIMITED ||
+					  colorimetry == COLORIMETRY_BT2020_LIMITED);
+
+	// limited range has luma in [16,235] and chroma in [16,240]
+	const float lumaRange   = limited ? 219.0f / 255.0f : 1.0f;
+	const float chromaRange = limited ? 224.0f / 255.0f : 1.0f;
+
+	cudaYUVMatrix m;
+
+	m.yOffset = limited ? 16.0f : 0.0f;
+	m.yScale  = 1.0f / lumaRange;
+
+	m.rv = 2.0f * (1.0f - kr) / chromaRange;
+	m.gu = 2.0f * kb * (1.0f - kb) / kg / chromaRange;
+	m.gv = 2.0f * kr * (1.0f - kr) / kg / chromaRange;
+	m.bu = 2.0f * (1.0f - kb) / chromaRange;
+
+	const float us = chromaRange / (2.0f * (1.0f - kb));
+	const float vs = chromaRange / (2.0f * (1.0f - kr));
+
+	m.y = make_float3(kr * lumaRange, kg * lumaRange, kb * lumaRange);
+	m.u = make_float3(-kr * us, -kg * us, (1.0f - kb) * us);
+	m.v = make_float3((1.0f - kr) * vs, -kg * vs, -kb * vs);
+
+	return m;
+}
+
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_COLORIMETRY_CUH__
+#define __CUDA_COLORIMETRY_CUH__
+
+
+#include "cudaColorimetry.h"
+
+
+/**
+ * Clamp a color component to [0,255]
+ * @ingroup colorspace
+ */
+inline __device__ float cudaClampColor( float x )
+{
+	return fminf(fmaxf(x, 0.0f), 255.0f);
+}
+
+/**
+ * Convert a YUV pixel (with components between 0 and 255) to RGB.
+ * @ingroup colorspace
+ */
+inline __device__ float3 cudaYUVToRGB( const cudaYUVMatrix& m, float y, float u, float v )
+{
+	y = (y - m.yOffset) * m.yScale;
+	u -= 128.0f;
+	v -= 128.0f;
+
+	return make_float3(cudaClampColor(y + m.rv * v),
+				    cudaClampColor(y - m.gu * u - m.gv * v),
+				    cudaClampColor(y + m.bu * u));
+}
+
+/**
+ * Convert an RGB pixel to luma.
+ * @ingroup colorspace
+ */
+inline __device__ float cudaRGBToLuma( const cudaYUVMatrix& m, const float3& rgb )
+{
+	return cudaClampColor(m.y.x * rgb.x + m.y.y * rgb.y + m.y.z * rgb.z + m.yOffset);
+}
+
+/**
+ * Convert an RGB pixel to its U chroma component.
+ * @ingroup colorspace
+ */
+inline __device__ float cudaRGBToChromaU( const cudaYUVMatrix& m, const float3& rgb )
+{
+	return cudaClampColor(m.u.x * rgb.x + m.u.y * rgb.y + m.u.z * rgb.z + 128.0f);
+}
+
+/**
+ * Convert an RGB pixel to its V chroma component.
+ * @ingroup colorspace
+ */
+inline __device__ float cudaRGBToChromaV( const cudaYUVMatrix& m, const float3& rgb )
+{
+	return cudaClampColor(m.v.x * rgb.x + m.v.y * rgb.y + m.v.z * rgb.z + 128.0f);
+}
+
+
+#endif
+
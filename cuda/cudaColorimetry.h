@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_COLORIMETRY_H__
+#define __CUDA_COLORIMETRY_H__
+
+
+#include "cudaUtility.h"
+
+
+/**
+ * Enumeration of the YUV colorimetry (the matrix coefficients and the quantization range)
+ * used when converting between YUV and RGB.
+ *
+ * SD video and JPEG typically use BT.601, HD video uses BT.709, and UHD/HDR uses BT.2020.
+ * Video from cameras and codecs is usually limited range (luma in `[16,235]` and chroma in `[16,240]`),
+ * whereas JPEG and most webcams are full range (`[0,255]`).
+ *
+ * @see cudaColorimetryFromStr() and cudaColorimetryToStr()
+ * @ingroup colorspace
+ */
+enum cudaColorimetry
+{
+	COLORIMETRY_BT601_FULL,		/**< ITU-R BT.601 matrix, full range */
+	COLORIMETRY_BT601_LIMITED,	/**< ITU-R BT.601 matrix, limited range */
+	COLORIMETRY_BT709_FULL,		/**< ITU-R BT.709 matrix, full range */
+	COLORIMETRY_BT709_LIMITED,	/**< ITU-R BT.709 matrix, limited range */
+	COLORIMETRY_BT2020_FULL,		/**< ITU-R BT.2020 (non-constant luminance) matrix, full range */
+	COLORIMETRY_BT2020_LIMITED,	/**< ITU-R BT.2020 (non-constant luminance) matrix, limited range */
+
+	/**< Default colorimetry (BT.601 full range) */
+	COLORIMETRY_DEFAULT = COLORIMETRY_BT601_FULL
+};
+
+/**
+ * Parse a cudaColorimetry enum from a string (e.g. `"bt709"`, `"bt709-full"`, `"bt2020-limited"`).
+ * The range defaults to limited if it isn't specified, except for `"jpeg"` which is BT.601 full range.
+ * @returns The parsed cudaColorimetry, or default_value on error.
+ * @ingroup colorspace
+ */
+cudaColorimetry cudaColorimetryFromStr( const char* str, cudaColorimetry default_value=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert a cudaColorimetry enum to a string.
+ * @ingroup colorspace
+ */
+const char* cudaColorimetryToStr( cudaColorimetry colorimetry );
+
+
+/**
+ * The coefficients of a YUV<->RGB conversion for one colorimetry, with the range scaling folded in.
+ * These are computed on the host with cudaColorimetryMatrix() and passed to the kernels by value,
+ * so that conversions with different colorimetry can run concurrently on different streams.
+ * @ingroup colorspace
+ */
+struct cudaYUVMatrix
+{
+	float yOffset;	/**< Luma offset (16 for limited range, otherwise 0) */
+	float yScale;	/**< Luma scale from YUV to RGB (255/219 for limited range, otherwise 1) */
+
+	float rv;		/**< R = Y + rv * V */
+	float gu;		/**< G = Y - gu * U - gv * V */
+	float gv;		/**< G = Y - gu * U - gv * V */
+	float bu;		/**< B = Y + bu * U */
+
+	float3 y;		/**< Weights of RGB to Y (before the offset is added) */
+	float3 u;		/**< Weights of RGB to U (before 128 is added) */
+	float3 v;		/**< Weights of RGB to V (before 128 is added) */
+};
+
+/**
+ * Compute the YUV<->RGB coefficients of a colorimetry.
+ * @ingroup colorspace
+ */
+cudaYUVMatrix cudaColorimetryMatrix( cudaColorimetry colorimetry );
+
+
+#endif
+
@@ -22,8 +22,13 @@
 
 #include "cudaColormap.h"
 #include "cudaFilterMode.cuh"
+#include "cudaImageStats.h"
 #include "cudaVector.h"
 
+#include "logging.h"
+#include "cudaNVTX.h"
+#include "Mutex.h"
+
 
 // cudaColormapFromStr
 cudaColormapType cudaColormapFromStr( const char* str )
@@ -1638,6 +1643,9 @@ static const float4 colormapPalettes[] = {
 static float4* colormapPalettesGPU = NULL;
 static float4* colormapPalettesCPU = NULL;
 
+// the palettes are uploaded on first use, which can happen from multiple threads
+static Mutex colormapMutex;
+
 
 // cudaColormapInit
 cudaError_t cudaColormapInit()
@@ -1645,16 +1653,34 @@ cudaError_t cudaColormapInit()
 	if( colormapPalettesGPU != NULL )
 		return cudaSuccess;	 // already initialized
 
+	NVTX_RANGE("cudaColormapInit");
+	colormapMutex.Lock();
+
+	if( colormapPalettesGPU != NULL )
+	{
+		colormapMutex.Unlock();
+		return cudaSuccess;
+	}
+
 	// allocate memory
 	const size_t numMaps = COLORMAP_VIRIDIS_INVERTED + 1;
 	const size_t mapSize = sizeof(float4) * 256;
 	const size_t memSize = mapSize * numMaps;
 
-	if( CUDA_FAILED(cudaMalloc((void**)&colormapPalettesGPU, memSize)) )
+	float4* palettesGPU = NULL;
+
+	if( CUDA_FAILED(cudaMalloc((void**)&palettesGPU, memSize)) )
+	{
+		colormapMutex.Unlock();
 		return cudaErrorMemoryAllocation;
+	}
 
-	if( CUDA_FAILED(cudaMallocHost((void**)&colormapPalettesCPU, memSize)) )
+	if( !colormapPalettesCPU && CUDA_FAILED(cudaMallocHost((void**)&colormapPalettesCPU, memSize)) )
+	{
+		CUDA(cudaFree(palettesGPU));
+		colormapMutex.Unlock();
 		return cudaErrorMemoryAllocation;
+	}
 
 	// copy palettes to pinned memory
 	memcpy(colormapPalettesCPU, colormapPalettes, memSize/2);
@@ -1664,9 +1690,16 @@ cudaError_t cudaColormapInit()
 		for( uint32_t n=0; n < 256; n++ )
 			colormapPalettesCPU[((numMaps/2+c)*256)+n] = colormapPalettes[c*256+255-n];
 			
-	// copy palettes to GPU
-	if( CUDA_FAILED(cudaMemcpy(colormapPalettesGPU, colormapPalettesCPU, memSize, cudaMemcpyHostToDevice)) )
+	// copy palettes to GPU (the pointer is only published once they're there)
+	if( CUDA_FAILED(cudaMemcpy(palettesGPU, colormapPalettesCPU, memSize, cudaMemcpyHostToDevice)) )
+	{
+		CUDA(cudaFree(palettesGPU));
+		colormapMutex.Unlock();
 		return cudaErrorInvalidMemcpyDirection;
+	}
+
+	colormapPalettesGPU = palettesGPU;
+	colormapMutex.Unlock();
 
 	return cudaSuccess;
 }
@@ -1675,6 +1708,9 @@ cudaError_t cudaColormapInit()
 // cudaColormapFree
 cudaError_t cudaColormapFree()
 {
+	NVTX_RANGE("cudaColormapFree");
+	colormapMutex.Lock();
+
 	if( colormapPalettesGPU != NULL )
 	{
 		CUDA(cudaFree(colormapPalettesGPU));
@@ -1687,6 +1723,7 @@ cudaError_t cudaColormapFree()
 		colormapPalettesCPU = NULL;
 	}
 
+	colormapMutex.Unlock();
 	return cudaSuccess;
 }
 
@@ -1708,7 +1745,7 @@ float4* cudaColormapPalette( cudaColormapType colormap )
 template<typename T, cudaFilterMode filter>
 __global__ void gpuColormapPalette( float4* palette, float* input, int input_width, int input_height,
 							 T* output, int output_width, int output_height, 
-							 float multiplier, float min_value )
+							 float multiplier, float min_value, const float2* rangeGPU )
 {
 	const int x = blockIdx.x * blockDim.x + threadIdx.x;
 	const int y = blockIdx.y * blockDim.y + threadIdx.y;
@@ -1716,6 +1753,14 @@ __global__ void gpuColormapPalette( float4* palette, float* input, int input_wid
 	if( x >= output_width || y >= output_height )
 		return;
 
+	if( rangeGPU != NULL )
+	{
+		const float2 range = *rangeGPU;
+
+		min_value  = range.x;
+		multiplier = (range.y > range.x) ? 255.0f / (range.y - range.x) : 0.0f;
+	}
+
 	const float pixel = cudaFilterPixel<filter>(input, x, y, input_width, input_height, output_width, output_height);
 	const float value = fmaxf(fminf((pixel - min_value) * multiplier, 255.0f), 0.0f); // __saturatef(pixel - min_value) * 255.0f; 
 
@@ -1770,12 +1815,12 @@ __global__ void gpuColormapNone( T* input, int input_width, int input_height,
 
 
 
-// cudaColormap
-cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
-					 void* output, size_t output_width, size_t output_height,
-					 const float2& input_range, cudaDataFormat input_format,
-					 imageFormat output_format, cudaColormapType colormap, 
-					 cudaFilterMode filter,  cudaStream_t stream )
+// launchColormap
+static cudaError_t launchColormap( float* input, size_t input_width, size_t input_height,
+						     void* output, size_t output_width, size_t output_height,
+						     const float2& input_range, const float2* rangeGPU, 
+						     cudaDataFormat input_format, imageFormat output_format, 
+						     cudaColormapType colormap, cudaFilterMode filter, cudaStream_t stream )
 {
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
@@ -1799,7 +1844,8 @@ cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
 			return cudaErrorMemoryAllocation;
 	 
 		// calculate the multiplier to map from input_range -> [0,255]
-		const float multiplier = 255.0f / (input_range.y - input_range.x);
+		// (when the range is in device memory, the kernel does this instead)
+		const float multiplier = rangeGPU ? 0.0f : 255.0f / (input_range.y - input_range.x);
 
 		// launch kernel
 		const dim3 blockDim(8, 8);
@@ -1809,7 +1855,7 @@ cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
 			gpuColormapPalette<type, filterMode><<<gridDim, blockDim, 0, stream>>>( \
 								palette, input, input_width, input_height, \
 								(type*)output, output_width, output_height, \
-								multiplier, input_range.x);
+								multiplier, input_range.x, rangeGPU);
 
 		#define colormapKernel(type) \
 		{ \
@@ -1940,15 +1986,163 @@ cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
 }
 
 
+// cudaColormap
+cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
+					 void* output, size_t output_width, size_t output_height,
+					 const float2& input_range, cudaDataFormat input_format,
+					 imageFormat output_format, cudaColormapType colormap, 
+					 cudaFilterMode filter,  cudaStream_t stream )
+{
+	NVTX_RANGE("cudaColormap");
+
+	return launchColormap(input, input_width, input_height, output, output_width, output_height,
+					  input_range, NULL, input_format, output_format, colormap, filter, stream);
+}
+
+
+// cudaColormap (device range)
+cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
+					 void* output, size_t output_width, size_t output_height,
+					 const float2* input_range, imageFormat output_format, 
+					 cudaColormapType colormap, cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaColormap");
+
+	if( !input_range )
+		return cudaErrorInvalidDevicePointer;
+
+	if( colormap > COLORMAP_VIRIDIS_INVERTED )
+	{
+		LogError(LOG_CUDA "cudaColormap() -- a device input_range is only supported by the palettized colormaps (not %s)\n", cudaColormapToStr(colormap));
+		return cudaErrorInvalidValue;
+	}
+
+	return launchColormap(input, input_width, input_height, output, output_width, output_height,
+					  make_float2(0,0), input_range, FORMAT_DEFAULT, output_format, colormap, filter, stream);
+}
+
+
 // cudaColormap
 cudaError_t cudaColormap( float* input, void* output, size_t width, size_t height,
 					 const float2& input_range, cudaDataFormat input_format,
 					 imageFormat output_format, cudaColormapType colormap,
 					 cudaStream_t stream)
 {
+	NVTX_RANGE("cudaColormap");
+
 	return cudaColormap(input, width, height, output, width, height,
 					input_range, input_format, output_format, 
 					colormap, FILTER_POINT, stream);
 }
 
 
+// gpuColormapRange
+__global__ void gpuColormapRange( const uint32_t* histogram, const float2* minMax, float2* range,
+						    float lower, float upper, float smoothing, bool reset )
+{
+	const float2 limits = *minMax;
+	const float binWidth = (limits.y - limits.x) / COLORMAP_RANGE_BINS;
+
+	uint32_t total = 0;
+
+	for( int n=0; n < COLORMAP_RANGE_BINS; n++ )
+		total += histogram[n];
+
+	// find the bins that contain the percentiles
+	const float lowerCount = lower * total;
+	const float upperCount = upper * total;
+
+	int lowerBin = 0;
+	int upperBin = COLORMAP_RANGE_BINS - 1;
+
+	uint32_t count = 0;
+
+	for( int n=0; n < COLORMAP_RANGE_BINS; n++ )
+	{
+		if( count <= lowerCount )
+			lowerBin = n;
+
+		count += histogram[n];
+
+		if( count >= upperCount )
+		{
+			upperBin = n;
+			break;
+		}
+	}
+
+	const float2 value = make_float2(limits.x + lowerBin * binWidth, limits.x + (upperBin + 1) * binWidth);
+
+	if( reset )
+		*range = value;
+	else
+		*range = *range * smoothing + value * (1.0f - smoothing);
+}
+
+
+// constructor
+cudaColormapRange::cudaColormapRange( float lower, float upper, float smoothing )
+{
+	mHistogram = NULL;
+	mMinMax    = NULL;
+	mRange     = NULL;
+
+	mLower     = lower;
+	mUpper     = upper;
+	mSmoothing = smoothing;
+	mReset     = true;
+}
+
+
+// destructor
+cudaColormapRange::~cudaColormapRange()
+{
+	if( mHistogram != NULL )
+	{
+		CUDA(cudaFree(mHistogram));
+		mHistogram = NULL;
+	}
+}
+
+
+// Update
+cudaError_t cudaColormapRange::Update( float* input, size_t width, size_t height, cudaStream_t stream )
+{
+	if( !input )
+		return cudaErrorInvalidDevicePointer;
+
+	if( mLower < 0.0f || mUpper > 1.0f || mLower >= mUpper )
+	{
+		LogError(LOG_CUDA "cudaColormapRange::Update() -- invalid percentiles (%f, %f)\n", mLower, mUpper);
+		return cudaErrorInvalidValue;
+	}
+
+	// the histogram, min/max, and range share one allocation
+	if( !mHistogram )
+	{
+		const size_t histogramSize = COLORMAP_RANGE_BINS * sizeof(uint32_t);
+
+		if( CUDA_FAILED(cudaMalloc((void**)&mHistogram, histogramSize + sizeof(float2) * 2)) )
+			return cudaErrorMemoryAllocation;
+
+		mMinMax = (float2*)((uint8_t*)mHistogram + histogramSize);
+		mRange  = mMinMax + 1;
+	}
+
+	// bin the image over its full range, and then find the percentiles
+	cudaError_t result = cudaImageMinMax(input, width, height, IMAGE_GRAY32F, mMinMax, stream);
+
+	if( result != cudaSuccess )
+		return result;
+
+	result = cudaHistogram(input, width, height, IMAGE_GRAY32F, mHistogram, COLORMAP_RANGE_BINS, mMinMax, stream);
+
+	if( result != cudaSuccess )
+		return result;
+
+	gpuColormapRange<<<1, 1, 0, stream>>>(mHistogram, mMinMax, mRange, mLower, mUpper, mSmoothing, mReset || mSmoothing <= 0.0f);
+
+	mReset = false;
+	return CUDA(cudaGetLastError());
+}
+
@@ -145,6 +145,113 @@ cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
 					 cudaFilterMode filter=FILTER_LINEAR,
 					 cudaStream_t stream=NULL );
 
+/**
+ * Apply a colormap from an input image to RGB/RGBA, with the input range read from device memory.
+ * This lets the range be computed on the GPU (for example by cudaColormapRange) on the same
+ * stream, without synchronizing with the CPU.  Only the palettized colormaps are supported.
+ * @param input_range pointer to a float2 in GPU-accessible memory with the minimum and maximum values.
+ * @param colormap the colormap to apply (@see cudaColormapType)
+ * @param filter the interpolation mode used for rescaling.
+ * @ingroup colormap
+ */
+template<typename T>
+cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
+					 T* output, size_t output_width, size_t output_height,
+					 const float2* input_range, cudaColormapType colormap=COLORMAP_DEFAULT,
+					 cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL )		{ return cudaColormap(input, input_width, input_height, output, output_width, output_height, input_range, imageFormatFromType<T>(), colormap, filter, stream); }
+
+/**
+ * Apply a colormap from an input image to RGB/RGBA, with the input range read from device memory.
+ * This lets the range be computed on the GPU (for example by cudaColormapRange) on the same
+ * stream, without synchronizing with the CPU.  Only the palettized colormaps are supported.
+ * @param input_range pointer to a float2 in GPU-accessible memory with the minimum and maximum values.
+ * @param colormap the colormap to apply (@see cudaColormapType)
+ * @param filter the interpolation mode used for rescaling.
+ * @ingroup colormap
+ */
+cudaError_t cudaColormap( float* input, size_t input_width, size_t input_height,
+					 void* output, size_t output_width, size_t output_height,
+					 const float2* input_range, imageFormat output_format, 
+					 cudaColormapType colormap=COLORMAP_DEFAULT,
+					 cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+/**
+ * Number of histogram bins used by cudaColormapRange to find the percentiles.
+ * @ingroup colormap
+ */
+#define COLORMAP_RANGE_BINS 1024
+
+/**
+ * Automatic range selection for cudaColormap(), computed per-frame on the GPU.
+ *
+ * Update() finds the lower and upper percentiles of the input (for example 1% and 99%,
+ * which clips outliers like the speckles in depth maps), and keeps the result in device
+ * memory so that it can be passed straight to cudaColormap() on the same stream:
+ *
+ * @code
+ * cudaColormapRange range(0.01f, 0.99f, 0.9f);
+ *
+ * range.Update(depth, width, height, stream);
+ * cudaColormap(depth, width, height, rgb, width, height, range.GetRange(), COLORMAP_TURBO, FILTER_LINEAR, stream);
+ * @endcode
+ *
+ * To avoid flickering, the range can be smoothed over time with an exponential moving average.
+ * Non-finite values should be avoided in the input, because they'd expand the range.
+ *
+ * @ingroup colormap
+ */
+class cudaColormapRange
+{
+public:
+	/**
+	 * Create the auto-range state.
+	 * @param lower the lower percentile to clip at (between 0 and 1)
+	 * @param upper the upper percentile to clip at (between 0 and 1)
+	 * @param smoothing the weight of the previous range in the moving average (0 disables smoothing)
+	 */
+	cudaColormapRange( float lower=0.01f, float upper=0.99f, float smoothing=0.0f );
+
+	/**
+	 * Destructor
+	 */
+	~cudaColormapRange();
+
+	/**
+	 * Compute the range of the next frame (asynchronously on the stream).
+	 */
+	cudaError_t Update( float* input, size_t width, size_t height, cudaStream_t stream=NULL );
+
+	/**
+	 * Get the device pointer to the range, which is valid after Update() has been called.
+	 */
+	inline float2* GetRange() const				{ return mRange; }
+
+	/**
+	 * Restart the moving average, so the next Update() doesn't get smoothed with the previous frames.
+	 */
+	inline void Reset()						{ mReset = true; }
+
+	/**
+	 * Set the lower and upper percentiles to clip at (between 0 and 1).
+	 */
+	inline void SetPercentiles( float lower, float upper )	{ mLower = lower; mUpper = upper; }
+
+	/**
+	 * Set the weight of the previous range in the moving average (0 disables smoothing).
+	 */
+	inline void SetSmoothing( float smoothing )		{ mSmoothing = smoothing; }
+
+protected:
+	uint32_t* mHistogram;
+	float2*   mMinMax;
+	float2*   mRange;
+
+	float mLower;
+	float mUpper;
+	float mSmoothing;
+	bool  mReset;
+};
+
 /**
  * Initialize the colormap palettes by allocating them in CUDA memory.
  * @note cudaColormapInit() is automatically called the first time
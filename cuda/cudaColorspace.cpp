@@ -28,317 +28,383 @@
 #include "cudaGrayscale.h"
 
 #include "logging.h"
+#include "profiler.h"
+#include "cudaNVTX.h"
 
 
+// isTensorFormat (planar or half-precision DNN formats)
+static inline bool isTensorFormat( imageFormat format )
+{
+	return format == IMAGE_RGB32F_PLANAR || format == IMAGE_RGB16F_PLANAR || format == IMAGE_RGB16F || format == IMAGE_RGBA16F;
+}
+
 // cudaConvertColor
 cudaError_t cudaConvertColor( void* input, imageFormat inputFormat,
 					     void* output, imageFormat outputFormat,
 					     size_t width, size_t height,
-						 const float2& pixel_range)
+						 const float2& pixel_range,
+						 cudaStream_t stream,
+						 cudaColorimetry colorimetry)
 {
+	NVTX_RANGE("cudaConvertColor");
+	PROFILER_SCOPE_CUDA("cudaConvertColor", stream);
+
 	if( inputFormat == IMAGE_NV12 )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaNV12ToRGB(input, (uchar3*)output, width, height));
+			return CUDA(cudaNV12ToRGB(input, (uchar3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaNV12ToRGB(input, (float3*)output, width, height));
+			return CUDA(cudaNV12ToRGB(input, (float3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaNV12ToRGBA(input, (uchar4*)output, width, height));
+			return CUDA(cudaNV12ToRGBA(input, (uchar4*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaNV12ToRGBA(input, (float4*)output, width, height));
+			return CUDA(cudaNV12ToRGBA(input, (float4*)output, width, height, stream, colorimetry));
 	}
 	else if( inputFormat == IMAGE_I420 )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaI420ToRGB(input, (uchar3*)output, width, height));
+			return CUDA(cudaI420ToRGB(input, (uchar3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaI420ToRGB(input, (float3*)output, width, height));
+			return CUDA(cudaI420ToRGB(input, (float3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaI420ToRGBA(input, (uchar4*)output, width, height));
+			return CUDA(cudaI420ToRGBA(input, (uchar4*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaI420ToRGBA(input, (float4*)output, width, height));
+			return CUDA(cudaI420ToRGBA(input, (float4*)output, width, height, stream, colorimetry));
 	}
 	else if( inputFormat == IMAGE_YV12 )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaYV12ToRGB(input, (uchar3*)output, width, height));
+			return CUDA(cudaYV12ToRGB(input, (uchar3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaYV12ToRGB(input, (float3*)output, width, height));
+			return CUDA(cudaYV12ToRGB(input, (float3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaYV12ToRGBA(input, (uchar4*)output, width, height));
+			return CUDA(cudaYV12ToRGBA(input, (uchar4*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaYV12ToRGBA(input, (float4*)output, width, height));
+			return CUDA(cudaYV12ToRGBA(input, (float4*)output, width, height, stream, colorimetry));
 	}
 	else if( inputFormat == IMAGE_YUYV )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaYUYVToRGB(input, (uchar3*)output, width, height));
+			return CUDA(cudaYUYVToRGB(input, (uchar3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaYUYVToRGB(input, (float3*)output, width, height));
+			return CUDA(cudaYUYVToRGB(input, (float3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaYUYVToRGBA(input, (uchar4*)output, width, height));
+			return CUDA(cudaYUYVToRGBA(input, (uchar4*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaYUYVToRGBA(input, (float4*)output, width, height));
+			return CUDA(cudaYUYVToRGBA(input, (float4*)output, width, height, stream, colorimetry));
 	}
 	else if( inputFormat == IMAGE_YVYU )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaYVYUToRGB(input, (uchar3*)output, width, height));
+			return CUDA(cudaYVYUToRGB(input, (uchar3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaYVYUToRGB(input, (float3*)output, width, height));
+			return CUDA(cudaYVYUToRGB(input, (float3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaYVYUToRGBA(input, (uchar4*)output, width, height));
+			return CUDA(cudaYVYUToRGBA(input, (uchar4*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaYVYUToRGBA(input, (float4*)output, width, height));
+			return CUDA(cudaYVYUToRGBA(input, (float4*)output, width, height, stream, colorimetry));
 	}
 	else if( inputFormat == IMAGE_UYVY )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaUYVYToRGB(input, (uchar3*)output, width, height));
+			return CUDA(cudaUYVYToRGB(input, (uchar3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaUYVYToRGB(input, (float3*)output, width, height));
+			return CUDA(cudaUYVYToRGB(input, (float3*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaUYVYToRGBA(input, (uchar4*)output, width, height));
+			return CUDA(cudaUYVYToRGBA(input, (uchar4*)output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaUYVYToRGBA(input, (float4*)output, width, height));
+			return CUDA(cudaUYVYToRGBA(input, (float4*)output, width, height, stream, colorimetry));
+	}
+	else if( inputFormat == IMAGE_P010 || inputFormat == IMAGE_P016 )
+	{
+		return CUDA(cudaP010ToRGB(input, inputFormat, output, outputFormat, width, height, stream, colorimetry));
+	}
+	else if( inputFormat == IMAGE_GRAY16 || inputFormat == IMAGE_RGB16 || inputFormat == IMAGE_RGBA16 )
+	{
+		return CUDA(cudaRGB16ToRGB(input, inputFormat, output, outputFormat, width, height, make_float2(0,65535), stream));
 	}
 	else if( inputFormat == IMAGE_RGB8 )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaRGB8ToRGBA8((uchar3*)input, (uchar4*)output, width, height));
+			return CUDA(cudaRGB8ToRGBA8((uchar3*)input, (uchar4*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaRGB8ToRGB32((uchar3*)input, (float3*)output, width, height));
+			return CUDA(cudaRGB8ToRGB32((uchar3*)input, (float3*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaRGB8ToRGBA32((uchar3*)input, (float4*)output, width, height));
+			return CUDA(cudaRGB8ToRGBA32((uchar3*)input, (float4*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaRGB8ToBGR8((uchar3*)input, (uchar3*)output, width, height));
+			return CUDA(cudaRGB8ToBGR8((uchar3*)input, (uchar3*)output, width, height, stream));
 		else if( outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaRGB8ToRGBA8((uchar3*)input, (uchar4*)output, width, height, true));
+			return CUDA(cudaRGB8ToRGBA8((uchar3*)input, (uchar4*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaRGB8ToRGB32((uchar3*)input, (float3*)output, width, height, true));
+			return CUDA(cudaRGB8ToRGB32((uchar3*)input, (float3*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaRGB8ToRGBA32((uchar3*)input, (float4*)output, width, height, true));
+			return CUDA(cudaRGB8ToRGBA32((uchar3*)input, (float4*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaRGB8ToGray8((uchar3*)input, (uint8_t*)output, width, height));
+			return CUDA(cudaRGB8ToGray8((uchar3*)input, (uint8_t*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaRGB8ToGray32((uchar3*)input, (float*)output, width, height));
+			return CUDA(cudaRGB8ToGray32((uchar3*)input, (float*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_I420 )
-			return CUDA(cudaRGBToI420((uchar3*)input, output, width, height));
+			return CUDA(cudaRGBToI420((uchar3*)input, output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_YV12 )
-			return CUDA(cudaRGBToYV12((uchar3*)input, output, width, height));
+			return CUDA(cudaRGBToYV12((uchar3*)input, output, width, height, stream, colorimetry));
+		else if( outputFormat == IMAGE_NV12 )
+			return CUDA(cudaRGBToNV12((uchar3*)input, output, width, height, stream, colorimetry));
+		else if( isTensorFormat(outputFormat) )
+			return CUDA(cudaRGBToTensor((uchar3*)input, output, outputFormat, width, height, false, stream));
 	}
 	else if( inputFormat == IMAGE_RGBA8 )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaRGBA8ToRGB8((uchar4*)input, (uchar3*)output, width, height));
+			return CUDA(cudaRGBA8ToRGB8((uchar4*)input, (uchar3*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaRGBA8ToRGB32((uchar4*)input, (float3*)output, width, height));
+			return CUDA(cudaRGBA8ToRGB32((uchar4*)input, (float3*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaRGBA8ToRGBA32((uchar4*)input, (float4*)output, width, height));
+			return CUDA(cudaRGBA8ToRGBA32((uchar4*)input, (float4*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaRGBA8ToRGB8((uchar4*)input, (uchar3*)output, width, height, true));
+			return CUDA(cudaRGBA8ToRGB8((uchar4*)input, (uchar3*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaRGBA8ToBGRA8((uchar4*)input, (uchar4*)output, width, height));
+			return CUDA(cudaRGBA8ToBGRA8((uchar4*)input, (uchar4*)output, width, height, stream));
 		else if( outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaRGBA8ToRGB32((uchar4*)input, (float3*)output, width, height, true));
+			return CUDA(cudaRGBA8ToRGB32((uchar4*)input, (float3*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaRGBA8ToRGBA32((uchar4*)input, (float4*)output, width, height, true));
+			return CUDA(cudaRGBA8ToRGBA32((uchar4*)input, (float4*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaRGBA8ToGray8((uchar4*)input, (uint8_t*)output, width, height));
+			return CUDA(cudaRGBA8ToGray8((uchar4*)input, (uint8_t*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaRGBA8ToGray32((uchar4*)input, (float*)output, width, height));
+			return CUDA(cudaRGBA8ToGray32((uchar4*)input, (float*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_I420 )
-			return CUDA(cudaRGBAToI420((uchar4*)input, output, width, height));
+			return CUDA(cudaRGBAToI420((uchar4*)input, output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_YV12 )
-			return CUDA(cudaRGBAToYV12((uchar4*)input, output, width, height));
+			return CUDA(cudaRGBAToYV12((uchar4*)input, output, width, height, stream, colorimetry));
+		else if( outputFormat == IMAGE_NV12 )
+			return CUDA(cudaRGBAToNV12((uchar4*)input, output, width, height, stream, colorimetry));
+		else if( isTensorFormat(outputFormat) )
+			return CUDA(cudaRGBToTensor((uchar4*)input, output, outputFormat, width, height, false, stream));
 	}
 	else if( inputFormat == IMAGE_RGB32F )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaRGB32ToRGB8((float3*)input, (uchar3*)output, width, height, false, pixel_range));	
+			return CUDA(cudaRGB32ToRGB8((float3*)input, (uchar3*)output, width, height, false, pixel_range, stream));	
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaRGB32ToRGBA8((float3*)input, (uchar4*)output, width, height, false, pixel_range));	
+			return CUDA(cudaRGB32ToRGBA8((float3*)input, (uchar4*)output, width, height, false, pixel_range, stream));	
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaRGB32ToRGBA32((float3*)input, (float4*)output, width, height));
+			return CUDA(cudaRGB32ToRGBA32((float3*)input, (float4*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaRGB32ToRGB8((float3*)input, (uchar3*)output, width, height, true, pixel_range));	
+			return CUDA(cudaRGB32ToRGB8((float3*)input, (uchar3*)output, width, height, true, pixel_range, stream));	
 		else if( outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaRGB32ToRGBA8((float3*)input, (uchar4*)output, width, height, true, pixel_range));	
+			return CUDA(cudaRGB32ToRGBA8((float3*)input, (uchar4*)output, width, height, true, pixel_range, stream));	
 		else if( outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaRGB32ToBGR32((float3*)input, (float3*)output, width, height));
+			return CUDA(cudaRGB32ToBGR32((float3*)input, (float3*)output, width, height, stream));
 		else if( outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaRGB32ToRGBA32((float3*)input, (float4*)output, width, height, true));
+			return CUDA(cudaRGB32ToRGBA32((float3*)input, (float4*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaRGB32ToGray8((float3*)input, (uint8_t*)output, width, height, false, pixel_range));
+			return CUDA(cudaRGB32ToGray8((float3*)input, (uint8_t*)output, width, height, false, pixel_range, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaRGB32ToGray32((float3*)input, (float*)output, width, height));
+			return CUDA(cudaRGB32ToGray32((float3*)input, (float*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_I420 )
-			return CUDA(cudaRGBToI420((float3*)input, output, width, height));
+			return CUDA(cudaRGBToI420((float3*)input, output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_YV12 )
-			return CUDA(cudaRGBToYV12((float3*)input, output, width, height));
+			return CUDA(cudaRGBToYV12((float3*)input, output, width, height, stream, colorimetry));
+		else if( outputFormat == IMAGE_NV12 )
+			return CUDA(cudaRGBToNV12((float3*)input, output, width, height, stream, colorimetry));
+		else if( isTensorFormat(outputFormat) )
+			return CUDA(cudaRGBToTensor((float3*)input, output, outputFormat, width, height, false, stream));
 	}
 	else if( inputFormat == IMAGE_RGBA32F )
 	{
 		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaRGBA32ToRGB8((float4*)input, (uchar3*)output, width, height, false, pixel_range));	
+			return CUDA(cudaRGBA32ToRGB8((float4*)input, (uchar3*)output, width, height, false, pixel_range, stream));	
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaRGBA32ToRGBA8((float4*)input, (uchar4*)output, width, height, false, pixel_range));	
+			return CUDA(cudaRGBA32ToRGBA8((float4*)input, (uchar4*)output, width, height, false, pixel_range, stream));	
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaRGBA32ToRGB32((float4*)input, (float3*)output, width, height));
+			return CUDA(cudaRGBA32ToRGB32((float4*)input, (float3*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaRGBA32ToRGB8((float4*)input, (uchar3*)output, width, height, true, pixel_range));	
+			return CUDA(cudaRGBA32ToRGB8((float4*)input, (uchar3*)output, width, height, true, pixel_range, stream));	
 		else if( outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaRGBA32ToRGBA8((float4*)input, (uchar4*)output, width, height, true, pixel_range));	
+			return CUDA(cudaRGBA32ToRGBA8((float4*)input, (uchar4*)output, width, height, true, pixel_range, stream));	
 		else if( outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaRGBA32ToRGB32((float4*)input, (float3*)output, width, height, true));
+			return CUDA(cudaRGBA32ToRGB32((float4*)input, (float3*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaRGBA32ToBGRA32((float4*)input, (float4*)output, width, height));
+			return CUDA(cudaRGBA32ToBGRA32((float4*)input, (float4*)output, width, height, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaRGBA32ToGray8((float4*)input, (uint8_t*)output, width, height, false, pixel_range));
+			return CUDA(cudaRGBA32ToGray8((float4*)input, (uint8_t*)output, width, height, false, pixel_range, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaRGBA32ToGray32((float4*)input, (float*)output, width, height));
+			return CUDA(cudaRGBA32ToGray32((float4*)input, (float*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_I420 )
-			return CUDA(cudaRGBAToI420((float4*)input, output, width, height));
+			return CUDA(cudaRGBAToI420((float4*)input, output, width, height, stream, colorimetry));
 		else if( outputFormat == IMAGE_YV12 )
-			return CUDA(cudaRGBAToYV12((float4*)input, output, width, height));
-		
+			return CUDA(cudaRGBAToYV12((float4*)input, output, width, height, stream, colorimetry));
+		else if( outputFormat == IMAGE_NV12 )
+			return CUDA(cudaRGBAToNV12((float4*)input, output, width, height, stream, colorimetry));
+		else if( isTensorFormat(outputFormat) )
+			return CUDA(cudaRGBToTensor((float4*)input, output, outputFormat, width, height, false, stream));
 	}
 	else if( inputFormat == IMAGE_BGR8 )
 	{
 		if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaRGB8ToRGBA8((uchar3*)input, (uchar4*)output, width, height));
+			return CUDA(cudaRGB8ToRGBA8((uchar3*)input, (uchar4*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaRGB8ToRGB32((uchar3*)input, (float3*)output, width, height));
+			return CUDA(cudaRGB8ToRGB32((uchar3*)input, (float3*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaRGB8ToRGBA32((uchar3*)input, (float4*)output, width, height));
+			return CUDA(cudaRGB8ToRGBA32((uchar3*)input, (float4*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaRGB8ToBGR8((uchar3*)input, (uchar3*)output, width, height));
+			return CUDA(cudaRGB8ToBGR8((uchar3*)input, (uchar3*)output, width, height, stream));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaRGB8ToRGBA8((uchar3*)input, (uchar4*)output, width, height, true));
+			return CUDA(cudaRGB8ToRGBA8((uchar3*)input, (uchar4*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaRGB8ToRGB32((uchar3*)input, (float3*)output, width, height, true));
+			return CUDA(cudaRGB8ToRGB32((uchar3*)input, (float3*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaRGB8ToRGBA32((uchar3*)input, (float4*)output, width, height, true));
+			return CUDA(cudaRGB8ToRGBA32((uchar3*)input, (float4*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaRGB8ToGray8((uchar3*)input, (uint8_t*)output, width, height, true));
+			return CUDA(cudaRGB8ToGray8((uchar3*)input, (uint8_t*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaRGB8ToGray32((uchar3*)input, (float*)output, width, height, true));
+			return CUDA(cudaRGB8ToGray32((uchar3*)input, (float*)output, width, height, true, stream));
+		else if( isTensorFormat(outputFormat) )
+			return CUDA(cudaRGBToTensor((uchar3*)input, output, outputFormat, width, height, true, stream));
 	}
 	else if( inputFormat == IMAGE_BGRA8 )
 	{
 		if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaRGBA8ToRGB8((uchar4*)input, (uchar3*)output, width, height));
+			return CUDA(cudaRGBA8ToRGB8((uchar4*)input, (uchar3*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaRGBA8ToRGB32((uchar4*)input, (float3*)output, width, height));
+			return CUDA(cudaRGBA8ToRGB32((uchar4*)input, (float3*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaRGBA8ToRGBA32((uchar4*)input, (float4*)output, width, height));
+			return CUDA(cudaRGBA8ToRGBA32((uchar4*)input, (float4*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaRGBA8ToRGB8((uchar4*)input, (uchar3*)output, width, height, true));
+			return CUDA(cudaRGBA8ToRGB8((uchar4*)input, (uchar3*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaRGBA8ToBGRA8((uchar4*)input, (uchar4*)output, width, height));
+			return CUDA(cudaRGBA8ToBGRA8((uchar4*)input, (uchar4*)output, width, height, stream));
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaRGBA8ToRGB32((uchar4*)input, (float3*)output, width, height, true));
+			return CUDA(cudaRGBA8ToRGB32((uchar4*)input, (float3*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaRGBA8ToRGBA32((uchar4*)input, (float4*)output, width, height, true));
+			return CUDA(cudaRGBA8ToRGBA32((uchar4*)input, (float4*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaRGBA8ToGray8((uchar4*)input, (uint8_t*)output, width, height, true));
+			return CUDA(cudaRGBA8ToGray8((uchar4*)input, (uint8_t*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaRGBA8ToGray32((uchar4*)input, (float*)output, width, height, true));
+			return CUDA(cudaRGBA8ToGray32((uchar4*)input, (float*)output, width, height, true, stream));
+		else if( isTensorFormat(outputFormat) )
+			return CUDA(cudaRGBToTensor((uchar4*)input, output, outputFormat, width, height, true, stream));
 	}
 	else if( inputFormat == IMAGE_BGR32F )
 	{
 		if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaRGB32ToRGB8((float3*)input, (uchar3*)output, width, height, false, pixel_range));	
+			return CUDA(cudaRGB32ToRGB8((float3*)input, (uchar3*)output, width, height, false, pixel_range, stream));	
 		else if( outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaRGB32ToRGBA8((float3*)input, (uchar4*)output, width, height, false, pixel_range));	
+			return CUDA(cudaRGB32ToRGBA8((float3*)input, (uchar4*)output, width, height, false, pixel_range, stream));	
 		else if( outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaRGB32ToRGBA32((float3*)input, (float4*)output, width, height));
+			return CUDA(cudaRGB32ToRGBA32((float3*)input, (float4*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaRGB32ToRGB8((float3*)input, (uchar3*)output, width, height, true, pixel_range));	
+			return CUDA(cudaRGB32ToRGB8((float3*)input, (uchar3*)output, width, height, true, pixel_range, stream));	
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaRGB32ToRGBA8((float3*)input, (uchar4*)output, width, height, true, pixel_range));	
+			return CUDA(cudaRGB32ToRGBA8((float3*)input, (uchar4*)output, width, height, true, pixel_range, stream));	
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaRGB32ToBGR32((float3*)input, (float3*)output, width, height));
+			return CUDA(cudaRGB32ToBGR32((float3*)input, (float3*)output, width, height, stream));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaRGB32ToRGBA32((float3*)input, (float4*)output, width, height, true));
+			return CUDA(cudaRGB32ToRGBA32((float3*)input, (float4*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaRGB32ToGray8((float3*)input, (uint8_t*)output, width, height, true, pixel_range));
+			return CUDA(cudaRGB32ToGray8((float3*)input, (uint8_t*)output, width, height, true, pixel_range, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaRGB32ToGray32((float3*)input, (float*)output, width, height, true));
+			return CUDA(cudaRGB32ToGray32((float3*)input, (float*)output, width, height, true, stream));
+		else if( isTensorFormat(outputFormat) )
+			return CUDA(cudaRGBToTensor((float3*)input, output, outputFormat, width, height, true, stream));
 	}
 	else if( inputFormat == IMAGE_BGRA32F )
 	{
 		if( outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaRGBA32ToRGB8((float4*)input, (uchar3*)output, width, height, false, pixel_range));	
+			return CUDA(cudaRGBA32ToRGB8((float4*)input, (uchar3*)output, width, height, false, pixel_range, stream));	
 		else if( outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaRGBA32ToRGBA8((float4*)input, (uchar4*)output, width, height, false, pixel_range));	
+			return CUDA(cudaRGBA32ToRGBA8((float4*)input, (uchar4*)output, width, height, false, pixel_range, stream));	
 		else if( outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaRGBA32ToRGB32((float4*)input, (float3*)output, width, height));
+			return CUDA(cudaRGBA32ToRGB32((float4*)input, (float3*)output, width, height, false, stream));
 		else if( outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaRGBA32ToRGB8((float4*)input, (uchar3*)output, width, height, true, pixel_range));	
+			return CUDA(cudaRGBA32ToRGB8((float4*)input, (uchar3*)output, width, height, true, pixel_range, stream));	
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaRGBA32ToRGBA8((float4*)input, (uchar4*)output, width, height, true, pixel_range));	
+			return CUDA(cudaRGBA32ToRGBA8((float4*)input, (uchar4*)output, width, height, true, pixel_range, stream));	
 		else if( outputFormat == IMAGE_RGB32F )
-			return CUDA(cudaRGBA32ToRGB32((float4*)input, (float3*)output, width, height, true));
+			return CUDA(cudaRGBA32ToRGB32((float4*)input, (float3*)output, width, height, true, stream));
 		else if( outputFormat == IMAGE_RGBA32F )
-			return CUDA(cudaRGBA32ToBGRA32((float4*)input, (float4*)output, width, height));
+			return CUDA(cudaRGBA32ToBGRA32((float4*)input, (float4*)output, width, height, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaRGBA32ToGray8((float4*)input, (uint8_t*)output, width, height, true, pixel_range));
+			return CUDA(cudaRGBA32ToGray8((float4*)input, (uint8_t*)output, width, height, true, pixel_range, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaRGBA32ToGray32((float4*)input, (float*)output, width, height, true));		
+			return CUDA(cudaRGBA32ToGray32((float4*)input, (float*)output, width, height, true, stream));
+		else if( isTensorFormat(outputFormat) )
+			return CUDA(cudaRGBToTensor((float4*)input, output, outputFormat, width, height, true, stream));
 	}
 	else if( inputFormat == IMAGE_GRAY8 )
 	{
 		if( outputFormat == IMAGE_RGB8 || outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaGray8ToRGB8((uint8_t*)input, (uchar3*)output, width, height));
+			return CUDA(cudaGray8ToRGB8((uint8_t*)input, (uchar3*)output, width, height, stream));
 		else if( outputFormat == IMAGE_RGBA8 || outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaGray8ToRGBA8((uint8_t*)input, (uchar4*)output, width, height));
+			return CUDA(cudaGray8ToRGBA8((uint8_t*)input, (uchar4*)output, width, height, stream));
 		else if( outputFormat == IMAGE_RGB32F || outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaGray8ToRGB32((uint8_t*)input, (float3*)output, width, height));
+			return CUDA(cudaGray8ToRGB32((uint8_t*)input, (float3*)output, width, height, stream));
 		else if( outputFormat == IMAGE_RGBA32F || outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaGray8ToRGBA32((uint8_t*)input, (float4*)output, width, height));
+			return CUDA(cudaGray8ToRGBA32((uint8_t*)input, (float4*)output, width, height, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaGray8ToGray32((uint8_t*)input, (float*)output, width, height));
+			return CUDA(cudaGray8ToGray32((uint8_t*)input, (float*)output, width, height, stream));
 	}
 	else if( inputFormat == IMAGE_GRAY32F )
 	{
 		if( outputFormat == IMAGE_RGB8 || outputFormat == IMAGE_BGR8 )
-			return CUDA(cudaGray32ToRGB8((float*)input, (uchar3*)output, width, height, pixel_range));
+			return CUDA(cudaGray32ToRGB8((float*)input, (uchar3*)output, width, height, pixel_range, stream));
 		else if( outputFormat == IMAGE_RGBA8 || outputFormat == IMAGE_BGRA8 )
-			return CUDA(cudaGray32ToRGBA8((float*)input, (uchar4*)output, width, height, pixel_range));
+			return CUDA(cudaGray32ToRGBA8((float*)input, (uchar4*)output, width, height, pixel_range, stream));
 		else if( outputFormat == IMAGE_RGB32F || outputFormat == IMAGE_BGR32F )
-			return CUDA(cudaGray32ToRGB32((float*)input, (float3*)output, width, height));
+			return CUDA(cudaGray32ToRGB32((float*)input, (float3*)output, width, height, stream));
 		else if( outputFormat == IMAGE_RGBA32F || outputFormat == IMAGE_BGRA32F )
-			return CUDA(cudaGray32ToRGBA32((float*)input, (float4*)output, width, height));
+			return CUDA(cudaGray32ToRGBA32((float*)input, (float4*)output, width, height, stream));
 		else if( outputFormat == IMAGE_GRAY8 )
-			return CUDA(cudaGray32ToGray8((float*)input, (uint8_t*)output, width, height, pixel_range));
+			return CUDA(cudaGray32ToGray8((float*)input, (uint8_t*)output, width, height, pixel_range, stream));
 		else if( outputFormat == IMAGE_GRAY32F )
-			return CUDA(cudaMemcpy(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice));
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
 	}
-	else if( imageFormatIsBayer(inputFormat) )
+	else if( isTensorFormat(inputFormat) )
 	{
-		if( outputFormat == IMAGE_RGB8 )
-			return CUDA(cudaBayerToRGB((uint8_t*)input, (uchar3*)output, width, height, inputFormat));
+		if( outputFormat == inputFormat )
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(inputFormat, width, height), cudaMemcpyDeviceToDevice, stream));
+		else if( outputFormat == IMAGE_RGB8 )
+			return CUDA(cudaTensorToRGB(input, inputFormat, (uchar3*)output, width, height, false, pixel_range, stream));
 		else if( outputFormat == IMAGE_RGBA8 )
-			return CUDA(cudaBayerToRGBA((uint8_t*)input, (uchar3*)output, width, height, inputFormat));
+			return CUDA(cudaTensorToRGB(input, inputFormat, (uchar4*)output, width, height, false, pixel_range, stream));
+		else if( outputFormat == IMAGE_RGB32F )
+			return CUDA(cudaTensorToRGB(input, inputFormat, (float3*)output, width, height, false, stream));
+		else if( outputFormat == IMAGE_RGBA32F )
+			return CUDA(cudaTensorToRGB(input, inputFormat, (float4*)output, width, height, false, stream));
+		else if( outputFormat == IMAGE_BGR8 )
+			return CUDA(cudaTensorToRGB(input, inputFormat, (uchar3*)output, width, height, true, pixel_range, stream));
+		else if( outputFormat == IMAGE_BGRA8 )
+			return CUDA(cudaTensorToRGB(input, inputFormat, (uchar4*)output, width, height, true, pixel_range, stream));
+		else if( outputFormat == IMAGE_BGR32F )
+			return CUDA(cudaTensorToRGB(input, inputFormat, (float3*)output, width, height, true, stream));
+		else if( outputFormat == IMAGE_BGRA32F )
+			return CUDA(cudaTensorToRGB(input, inputFormat, (float4*)output, width, height, true, stream));
+	}
+	else if( imageFormatIsBayer(inputFormat) )
+	{
+		// 8-bit to RGB8 uses NPP, everything else uses the Malvar-He-Cutler kernel
+		if( outputFormat == IMAGE_RGB8 && !imageFormatIsBayer16(inputFormat) )
+			return CUDA(cudaBayerToRGB((uint8_t*)input, (uchar3*)output, width, height, inputFormat, stream));
+		else if( outputFormat == IMAGE_RGB8 || outputFormat == IMAGE_RGBA8 || outputFormat == IMAGE_RGB32F || outputFormat == IMAGE_RGBA32F )
+			return CUDA(cudaBayerDemosaic(input, inputFormat, output, outputFormat, width, height, cudaBayerOptions(), stream));
 	}
 
 	LogError(LOG_CUDA "cudaColorConvert() -- invalid input/output format combination (%s -> %s)\n", imageFormatToStr(inputFormat), imageFormatToStr(outputFormat));
@@ -346,3 +412,27 @@ cudaError_t cudaConvertColor( void* input, imageFormat inputFormat,
 }
 
 
+// cudaConvertColor (texture objects)
+cudaError_t cudaConvertColor( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, 
+					     imageFormat inputFormat, void* output, imageFormat outputFormat, 
+					     size_t width, size_t height, cudaStream_t stream,
+					     cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaConvertColor");
+	PROFILER_SCOPE_CUDA("cudaConvertColor", stream);
+
+	if( inputFormat == IMAGE_NV12 )
+	{
+		if( outputFormat == IMAGE_RGB8 )
+			return CUDA(cudaNV12ToRGB(lumaTex, chromaTex, (uchar3*)output, width, height, stream, colorimetry));
+		else if( outputFormat == IMAGE_RGB32F )
+			return CUDA(cudaNV12ToRGB(lumaTex, chromaTex, (float3*)output, width, height, stream, colorimetry));
+		else if( outputFormat == IMAGE_RGBA8 )
+			return CUDA(cudaNV12ToRGBA(lumaTex, chromaTex, (uchar4*)output, width, height, stream, colorimetry));
+		else if( outputFormat == IMAGE_RGBA32F )
+			return CUDA(cudaNV12ToRGBA(lumaTex, chromaTex, (float4*)output, width, height, stream, colorimetry));
+	}
+
+	LogError(LOG_CUDA "cudaColorConvert() -- invalid input/output format combination for texture input (%s -> %s)\n", imageFormatToStr(inputFormat), imageFormatToStr(outputFormat));
+	return cudaErrorInvalidValue;
+}
@@ -25,6 +25,7 @@
 
 #include "cudaUtility.h"
 #include "imageFormat.h"
+#include "cudaColorimetry.h"
 
 
 /**
@@ -39,8 +40,15 @@
  * Limitations and unsupported conversions include:
  *
  *     - The YUV formats don't support BGR/BGRA or grayscale (RGB/RGBA only)
- *     - YUV NV12, YUYV, YVYU, and UYVY can only be converted to RGB/RGBA (not from)
- *     - Bayer formats can only be converted to RGB8 (`uchar3`) and RGBA8 (`uchar4`)
+ *     - YUV YUYV, YVYU, and UYVY can only be converted to RGB/RGBA (not from)
+ *     - Bayer formats can only be converted to RGB/RGBA (8-bit and float).  16-bit Bayer is assumed
+ *       to be 12-bit (RAW12), use cudaBayerDemosaic() directly for other bit depths or white balance.
+ *     - The planar and FP16 tensor formats (`IMAGE_RGB32F_PLANAR`, `IMAGE_RGB16F_PLANAR`,
+ *       `IMAGE_RGB16F`, `IMAGE_RGBA16F`) can only be converted to/from RGB/RGBA and BGR/BGRA
+ *     - YUV P010/P016 can only be converted to RGB/RGBA (8-bit, float, and FP16)
+ *     - 16-bit `IMAGE_GRAY16`, `IMAGE_RGB16`, and `IMAGE_RGBA16` can only be converted to RGB/RGBA
+ *       (8-bit, float, and FP16) or grayscale, using the full 16-bit range.  Use cudaRGB16ToRGB()
+ *       directly for sensors with other bit depths.
  *
  * @param input CUDA device pointer to the input image
  * @param inputFormat format enum of the input image
@@ -54,12 +62,41 @@
  *                    `[0,1]` and `[-1,1]`, and these pixel values would be re-scaled for `[0,255]` output.
  *                    Note that this parameter is only used for float-to-uchar conversions where the data
  *                    is downcast (for example, `IMAGE_RGB32F` to `IMAGE_RGB8`).
+ * @param stream CUDA stream that the conversion kernels and copies get queued on (the default stream is used if NULL)
+ * @param colorimetry the matrix coefficients and range of the YUV image for conversions to/from YUV
+ *                    (BT.601, BT.709, or BT.2020 with full or limited range).  The default is BT.601 full range.
  * @ingroup colorspace
  */
 cudaError_t cudaConvertColor( void* input, imageFormat inputFormat,
 					     void* output, imageFormat outputFormat,
 					     size_t width, size_t height,
-						const float2& pixel_range=make_float2(0,255));
+						const float2& pixel_range=make_float2(0,255),
+						cudaStream_t stream=NULL,
+						cudaColorimetry colorimetry=COLORIMETRY_DEFAULT);
+
+/**
+ * Convert an image that's bound to texture objects into RGB/RGBA using the GPU.
+ *
+ * This reads directly from CUDA arrays or pitched memory (for example the planes
+ * of a mapped NVMM/EGL frame) without first copying the image into linear memory.
+ * Currently only `IMAGE_NV12` input is supported, with an 8-bit luma texture
+ * and a 2-channel (interleaved U/V) chroma texture at half resolution.
+ *
+ * @param lumaTex texture object bound to the Y plane
+ * @param chromaTex texture object bound to the interleaved UV plane
+ * @param inputFormat format enum of the input image (must be `IMAGE_NV12`)
+ * @param output CUDA device pointer to the output image
+ * @param outputFormat format enum of the output image (RGB8, RGBA8, RGB32F, or RGBA32F)
+ * @param width width of the input and output images (in pixels)
+ * @param height height of the input and output images (in pixels)
+ * @param stream CUDA stream that the conversion kernel gets queued on (the default stream is used if NULL)
+ * @param colorimetry the matrix coefficients and range of the YUV image (the default is BT.601 full range)
+ * @ingroup colorspace
+ */
+cudaError_t cudaConvertColor( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, 
+						imageFormat inputFormat, void* output, imageFormat outputFormat, 
+						size_t width, size_t height, cudaStream_t stream=NULL,
+						cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert between to image formats using the GPU.
@@ -80,15 +117,17 @@ cudaError_t cudaConvertColor( void* input, imageFormat inputFormat,
  *                    `[0,1]` and `[-1,1]`, and these pixel values would be re-scaled for `[0,255]` output.
  *                    Note that this parameter is only used for float-to-uchar conversions where the data
  *                    is downcast (for example, `IMAGE_RGB32F` to `IMAGE_RGB8`).
+ * @param stream CUDA stream that the conversion kernels and copies get queued on (the default stream is used if NULL)
  *
  * @ingroup colorspace
  */
 template<typename T_in, typename T_out> 
 cudaError_t cudaConvertColor( T_in* input, T_out* output,
 					     size_t width, size_t height,
-						const float2& pixel_range=make_float2(0,255))	
+						const float2& pixel_range=make_float2(0,255),
+						cudaStream_t stream=NULL)	
 { 
-	return cudaConvertColor(input, imageFormatFromType<T_in>(), output, imageFormatFromType<T_out>(), width, height, pixel_range); 
+	return cudaConvertColor(input, imageFormatFromType<T_in>(), output, imageFormatFromType<T_out>(), width, height, pixel_range, stream); 
 }
 	
 
@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaConnectedComponents.h"
+#include "cudaMemoryPool.h"
+
+#include "logging.h"
+#include "cudaNVTX.h"
+
+#include <limits.h>
+
+
+// label of the background pixels while the components are being merged
+#define LABEL_BACKGROUND 0xFFFFFFFF
+
+// index of the roots whose blobs were dropped (too small, or past the end of the list)
+#define LABEL_DROPPED 0xFFFFFFFF
+
+
+// foreground test of the mask pixels
+inline __device__ bool labelForeground( const uint8_t& px, float threshold )	{ return px > threshold; }
+inline __device__ bool labelForeground( const float& px, float threshold )	{ return px > threshold; }
+
+
+// follow the parent links up to the root of a component
+inline __device__ uint32_t labelFind( const uint32_t* labels, uint32_t n )
+{
+	uint32_t parent = labels[n];
+
+	while( parent != n )
+	{
+		n = parent;
+		parent = labels[n];
+	}
+
+	return n;
+}
+
+// merge the components of two pixels, so that the root with the lower index becomes the parent
+inline __device__ void labelUnion( uint32_t* labels, uint32_t a, uint32_t b )
+{
+	bool done = false;
+
+	while( !done )
+	{
+		a = labelFind(labels, a);
+		b = labelFind(labels, b);
+
+		if( a < b )
+		{
+			const uint32_t old = atomicMin(&labels[b], a);
+			done = (old == b);	// if b was still a root, it's linked now
+			b = old;
+		}
+		else if( b < a )
+		{
+			const uint32_t old = atomicMin(&labels[a], b);
+			done = (old == a);
+			a = old;
+		}
+		else
+		{
+			done = true;
+		}
+	}
+}
+
+
+// gpuLabelInit (each foreground pixel starts out as its own component)
+template<typename T>
+__global__ void gpuLabelInit( T* mask, uint32_t* labels, int width, int height, float threshold )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const uint32_t n = y * width + x;
+	labels[n] = labelForeground(mask[n], threshold) ? n : LABEL_BACKGROUND;
+}
+
+// gpuLabelMerge (link each pixel with its left and upper neighbors, and the upper diagonals for 8-connectivity)
+template<bool Diagonals>
+__global__ void gpuLabelMerge( uint32_t* labels, int width, int height )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const uint32_t n = y * width + x;
+
+	if( labels[n] == LABEL_BACKGROUND )
+		return;
+
+	if( x > 0 && labels[n - 1] != LABEL_BACKGROUND )
+		labelUnion(labels, n, n - 1);
+
+	if( y > 0 )
+	{
+		const uint32_t up = n - width;
+
+		if( labels[up] != LABEL_BACKGROUND )
+			labelUnion(labels, n, up);
+
+		if( Diagonals )
+		{
+			if( x > 0 && labels[up - 1] != LABEL_BACKGROUND )
+				labelUnion(labels, n, up - 1);
+
+			if( x < width - 1 && labels[up + 1] != LABEL_BACKGROUND )
+				labelUnion(labels, n, up + 1);
+		}
+	}
+}
+
+// gpuLabelCompress (point each pixel directly at its root, and count the pixels of each root)
+__global__ void gpuLabelCompress( uint32_t* labels, uint32_t* areas, uint32_t numPixels )
+{
+	const uint32_t n = blockIdx.x * blockDim.x + threadIdx.x;
+
+	if( n >= numPixels || labels[n] == LABEL_BACKGROUND )
+		return;
+
+	const uint32_t root = labelFind(labels, n);
+
+	labels[n] = root;
+	atomicAdd(&areas[root], 1);
+}
+
+// gpuBlobCompact (give each root that's big enough a slot in the blob list)
+__global__ void gpuBlobCompact( const uint32_t* labels, uint32_t* index, uint32_t numPixels,
+						  cudaBlob* blobs, ulonglong2* sums, uint32_t maxBlobs, uint32_t* numBlobs, uint32_t minArea )
+{
+	const uint32_t n = blockIdx.x * blockDim.x + threadIdx.x;
+
+	if( n >= numPixels || labels[n] != n )
+		return;
+
+	// the root's entry holds its area from gpuLabelCompress(), and gets replaced by its slot
+	const uint32_t area = index[n];
+
+	if( area < minArea )
+	{
+		index[n] = LABEL_DROPPED;
+		return;
+	}
+
+	const uint32_t slot = atomicAdd(numBlobs, 1);
+
+	if( slot >= maxBlobs )
+	{
+		index[n] = LABEL_DROPPED;
+		return;
+	}
+
+	index[n] = slot;
+
+	blobs[slot].bbox  = make_int4(INT_MAX, INT_MAX, -1, -1);
+	blobs[slot].area  = area;
+	blobs[slot].label = slot + 1;
+
+	sums[slot] = make_ulonglong2(0, 0);
+}
+
+// gpuBlobStats (reduce the bounding boxes and coordinate sums, and relabel the pixels with their slots)
+__global__ void gpuBlobStats( uint32_t* labels, const uint32_t* index, cudaBlob* blobs, ulonglong2* sums, int width, int height )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const uint32_t n = y * width + x;
+	const uint32_t root = labels[n];
+
+	if( root == LABEL_BACKGROUND )
+	{
+		labels[n] = 0;
+		return;
+	}
+
+	const uint32_t slot = index[root];
+
+	if( slot == LABEL_DROPPED )
+	{
+		labels[n] = 0;
+		return;
+	}
+
+	cudaBlob* blob = blobs + slot;
+
+	atomicMin(&blob->bbox.x, x);
+	atomicMin(&blob->bbox.y, y);
+	atomicMax(&blob->bbox.z, x);
+	atomicMax(&blob->bbox.w, y);
+
+	atomicAdd(&sums[slot].x, (unsigned long long)x);
+	atomicAdd(&sums[slot].y, (unsigned long long)y);
+
+	labels[n] = slot + 1;
+}
+
+// gpuBlobFinalize (compute the centroids, and clamp the number of blobs to the capacity)
+__global__ void gpuBlobFinalize( cudaBlob* blobs, const ulonglong2* sums, uint32_t maxBlobs, uint32_t* numBlobs )
+{
+	const uint32_t n = blockIdx.x * blockDim.x + threadIdx.x;
+	const uint32_t count = min(*numBlobs, maxBlobs);
+
+	if( n == 0 )
+		*numBlobs = count;
+
+	if( n >= count )
+		return;
+
+	cudaBlob* blob = blobs + n;
+	const float area = blob->area;
+
+	blob->centroid = make_float2(sums[n].x / area + 0.5f, sums[n].y / area + 0.5f);
+
+	// right and bottom are exclusive
+	blob->bbox.z += 1;
+	blob->bbox.w += 1;
+}
+
+
+// launchConnectedComponents
+template<typename T>
+static cudaError_t launchConnectedComponents( T* mask, size_t width, size_t height, uint32_t* labels, 
+									 cudaBlob* blobs, uint32_t maxBlobs, uint32_t* numBlobs,
+									 uint32_t minArea, uint32_t connectivity, float threshold, 
+									 cudaStream_t stream )
+{
+	const size_t numPixels = width * height;
+
+	if( numPixels >= LABEL_BACKGROUND )
+		return cudaErrorInvalidValue;
+
+	// scratch memory for the labels (if they weren't requested), the per-root areas/slots, and the sums
+	uint32_t*   scratchLabels = NULL;
+	uint32_t*   index = NULL;
+	ulonglong2* sums = NULL;
+
+	if( !labels && !cudaMallocPooled((void**)&scratchLabels, numPixels * sizeof(uint32_t)) )
+		return cudaErrorMemoryAllocation;
+
+	if( !labels )
+		labels = scratchLabels;
+
+	if( !cudaMallocPooled((void**)&index, numPixels * sizeof(uint32_t)) || 
+	    !cudaMallocPooled((void**)&sums, maxBlobs * sizeof(ulonglong2)) )
+	{
+		cudaFreePooled(scratchLabels);
+		cudaFreePooled(index);
+		return cudaErrorMemoryAllocation;
+	}
+
+	const dim3 blockDim(32, 8);
+	const dim3 gridDim(iDivUp(width, blockDim.x), iDivUp(height, blockDim.y));
+
+	const int linearBlock = 256;
+	const int linearGrid = iDivUp(numPixels, linearBlock);
+
+	CUDA(cudaMemsetAsync(index, 0, numPixels * sizeof(uint32_t), stream));
+	CUDA(cudaMemsetAsync(numBlobs, 0, sizeof(uint32_t), stream));
+
+	gpuLabelInit<T><<<gridDim, blockDim, 0, stream>>>(mask, labels, width, height, threshold);
+
+	if( connectivity == 8 )
+		gpuLabelMerge<true><<<gridDim, blockDim, 0, stream>>>(labels, width, height);
+	else
+		gpuLabelMerge<false><<<gridDim, blockDim, 0, stream>>>(labels, width, height);
+
+	gpuLabelCompress<<<linearGrid, linearBlock, 0, stream>>>(labels, index, numPixels);
+	gpuBlobCompact<<<linearGrid, linearBlock, 0, stream>>>(labels, index, numPixels, blobs, sums, maxBlobs, numBlobs, minArea);
+	gpuBlobStats<<<gridDim, blockDim, 0, stream>>>(labels, index, blobs, sums, width, height);
+	gpuBlobFinalize<<<iDivUp(maxBlobs, linearBlock), linearBlock, 0, stream>>>(blobs, sums, maxBlobs, numBlobs);
+
+	// the pool doesn't hand the blocks out again until the kernels are done with them
+	cudaFreePooled(scratchLabels, stream);
+	cudaFreePooled(index, stream);
+	cudaFreePooled(sums, stream);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaConnectedComponents
+cudaError_t cudaConnectedComponents( void* mask, size_t width, size_t height, imageFormat format,
+							  uint32_t* labels, cudaBlob* blobs, uint32_t maxBlobs, uint32_t* numBlobs,
+							  uint32_t minArea, uint32_t connectivity, float threshold, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaConnectedComponents");
+
+	if( !mask || !blobs || !numBlobs )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 || maxBlobs == 0 )
+		return cudaErrorInvalidValue;
+
+	if( connectivity != 4 && connectivity != 8 )
+	{
+		LogError(LOG_CUDA "cudaConnectedComponents() -- connectivity must be 4 or 8 (was %u)\n", connectivity);
+		return cudaErrorInvalidValue;
+	}
+
+	if( format == IMAGE_GRAY8 )
+		return launchConnectedComponents((uint8_t*)mask, width, height, labels, blobs, maxBlobs, numBlobs, minArea, connectivity, threshold, stream);
+	else if( format == IMAGE_GRAY32F )
+		return launchConnectedComponents((float*)mask, width, height, labels, blobs, maxBlobs, numBlobs, minArea, connectivity, threshold, stream);
+
+	imageFormatErrorMsg(LOG_CUDA, "cudaConnectedComponents()", format);
+	return cudaErrorInvalidValue;
+}
+
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_CONNECTED_COMPONENTS_H__
+#define __CUDA_CONNECTED_COMPONENTS_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * The statistics of one of the blobs found by cudaConnectedComponents().
+ * @ingroup cuda
+ */
+struct cudaBlob
+{
+	int4     bbox;		/**< Bounding box as `(left, top, right, bottom)`, with right and bottom exclusive (like cudaCrop()) */
+	float2   centroid;	/**< Center of mass of the blob's pixels */
+	uint32_t area;		/**< The number of pixels in the blob */
+	uint32_t label;	/**< The blob's value in the label image (its index in the blob list plus one) */
+};
+
+
+/**
+ * Find the connected components (blobs) of a binary mask on the GPU, and compute the bounding
+ * box, area, and centroid of each of them - so that the mask never needs to be read by the CPU.
+ *
+ * The components are labeled with a parallel union-find:  each foreground pixel is merged with
+ * its already-visited neighbors using atomicMin() on the parent links, and then the links are
+ * flattened to their roots.  The statistics are reduced per-label with atomics, and the blobs
+ * that are at least `minArea` pixels get compacted into the `blobs` list.  The order of the
+ * blobs in the list isn't deterministic.
+ *
+ * The mask can be gray8 or gray32f, where the pixels greater than `threshold` are foreground
+ * (for example, the masks from cudaMotion or from thresholding a segmentation).
+ *
+ * @param labels optional output image (`width * height` uint32 values in GPU memory) that
+ *               receives the label of each pixel - its blob's index in the list plus one,
+ *               or 0 for the background and the blobs that were dropped.  Can be NULL.
+ * @param blobs the output list of blobs (in GPU-accessible memory, like cudaAllocMapped())
+ * @param maxBlobs the capacity of the blob list (the blobs past it are dropped)
+ * @param numBlobs pointer to a counter in GPU-accessible memory that receives the number of
+ *                 blobs in the list.  It's written by the GPU, so synchronize the stream first.
+ * @param minArea the minimum number of pixels for a blob to be kept
+ * @param connectivity either 4 or 8 (which also connects the diagonal neighbors)
+ * @param threshold pixels with values greater than this are foreground
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ * @ingroup cuda
+ */
+cudaError_t cudaConnectedComponents( void* mask, size_t width, size_t height, imageFormat format,
+							  uint32_t* labels, cudaBlob* blobs, uint32_t maxBlobs, uint32_t* numBlobs,
+							  uint32_t minArea=1, uint32_t connectivity=8, float threshold=0.0f,
+							  cudaStream_t stream=NULL );
+
+
+#endif
+
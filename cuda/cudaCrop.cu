@@ -21,13 +21,16 @@
  */
 
 #include "cudaCrop.h"
+#include "cudaFilterMode.cuh"
+#include "cudaAutotune.h"
+#include "cudaNVTX.h"
 
 
 
 // gpuCrop
 template<typename T>
-__global__ void gpuCrop( T* input, T* output, int offsetX, int offsetY, 
-					int inWidth, int outWidth, int outHeight )
+__global__ void gpuCrop( T* input, size_t inputPitch, T* output, size_t outputPitch, 
+					int offsetX, int offsetY, int outWidth, int outHeight )
 {
 	const int out_x = blockIdx.x * blockDim.x + threadIdx.x;
 	const int out_y = blockIdx.y * blockDim.y + threadIdx.y;
@@ -38,13 +41,17 @@ __global__ void gpuCrop( T* input, T* output, int offsetX, int offsetY,
 	const int in_x = out_x + offsetX;
 	const int in_y = out_y + offsetY;
 
-	output[out_y * outWidth + out_x] = input[in_y * inWidth + in_x];
+	// pitches are in bytes (for packed images, pitch = width * sizeof(T))
+	const T* inputRow = (const T*)((const uint8_t*)input + in_y * inputPitch);
+	T* outputRow = (T*)((uint8_t*)output + out_y * outputPitch);
+
+	outputRow[out_x] = inputRow[in_x];
 }
 
 
 // launchCrop
 template<typename T>
-static cudaError_t launchCrop( T* input, T* output, const int4& roi, size_t inputWidth, size_t inputHeight )
+static cudaError_t launchCrop( T* input, size_t inputPitch, T* output, size_t outputPitch, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream )
 {
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
@@ -69,66 +76,120 @@ static cudaError_t launchCrop( T* input, T* output, const int4& roi, size_t inpu
 	if( roi.z > inputWidth || roi.w > inputHeight )
 		return cudaErrorInvalidValue;
 
+	if( inputPitch < inputWidth * sizeof(T) || outputPitch < outputWidth * sizeof(T) )
+		return cudaErrorInvalidPitchValue;
+
 	// launch kernel
-	const dim3 blockDim(8, 8);
-	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+	auto launch = [&]( const dim3& blockDim ) -> cudaError_t
+	{
+		const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+		gpuCrop<T><<<gridDim, blockDim, 0, stream>>>(input, inputPitch, output, outputPitch, roi.x, roi.y, outputWidth, outputHeight);
+		return cudaGetLastError();
+	};
 
-	gpuCrop<T><<<gridDim, blockDim>>>(input, output, roi.x, roi.y, inputWidth, outputWidth, outputHeight);
+	dim3 blockDim(8, 8);
 
-	return CUDA(cudaGetLastError());
+	if( input != output )
+		blockDim = cudaAutotune("cudaCrop", sizeof(T), outputWidth, outputHeight, blockDim, stream, launch);
+
+	return CUDA(launch(blockDim));
 }
 
 // cudaCrop (uint8 grayscale)
-cudaError_t cudaCrop( uint8_t* input, uint8_t* output, const int4& roi, size_t inputWidth, size_t inputHeight )
+cudaError_t cudaCrop( uint8_t* input, uint8_t* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream )
 {
-	return launchCrop<uint8_t>(input, output, roi, inputWidth, inputHeight);
+	NVTX_RANGE("cudaCrop");
+
+	return launchCrop<uint8_t>(input, inputWidth * sizeof(uint8_t), output, (roi.z - roi.x) * sizeof(uint8_t), roi, inputWidth, inputHeight, stream);
 }
 
 // cudaCrop (float grayscale)
-cudaError_t cudaCrop( float* input, float* output, const int4& roi, size_t inputWidth, size_t inputHeight )
+cudaError_t cudaCrop( float* input, float* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream )
 {
-	return launchCrop<float>(input, output, roi, inputWidth, inputHeight);
+	NVTX_RANGE("cudaCrop");
+
+	return launchCrop<float>(input, inputWidth * sizeof(float), output, (roi.z - roi.x) * sizeof(float), roi, inputWidth, inputHeight, stream);
 }
 
 // cudaCrop (uchar3)
-cudaError_t cudaCrop( uchar3* input, uchar3* output, const int4& roi, size_t inputWidth, size_t inputHeight )
+cudaError_t cudaCrop( uchar3* input, uchar3* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream )
 {
-	return launchCrop<uchar3>(input, output, roi, inputWidth, inputHeight);
+	NVTX_RANGE("cudaCrop");
+
+	return launchCrop<uchar3>(input, inputWidth * sizeof(uchar3), output, (roi.z - roi.x) * sizeof(uchar3), roi, inputWidth, inputHeight, stream);
 }
 
 // cudaCrop (uchar4)
-cudaError_t cudaCrop( uchar4* input, uchar4* output, const int4& roi, size_t inputWidth, size_t inputHeight )
+cudaError_t cudaCrop( uchar4* input, uchar4* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream )
 {
-	return launchCrop<uchar4>(input, output, roi, inputWidth, inputHeight);
+	NVTX_RANGE("cudaCrop");
+
+	return launchCrop<uchar4>(input, inputWidth * sizeof(uchar4), output, (roi.z - roi.x) * sizeof(uchar4), roi, inputWidth, inputHeight, stream);
 }
 
 // cudaCrop (float3)
-cudaError_t cudaCrop( float3* input, float3* output, const int4& roi, size_t inputWidth, size_t inputHeight )
+cudaError_t cudaCrop( float3* input, float3* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream )
 {
-	return launchCrop<float3>(input, output, roi, inputWidth, inputHeight);
+	NVTX_RANGE("cudaCrop");
+
+	return launchCrop<float3>(input, inputWidth * sizeof(float3), output, (roi.z - roi.x) * sizeof(float3), roi, inputWidth, inputHeight, stream);
 }
 
 // cudaCrop (float4)
-cudaError_t cudaCrop( float4* input, float4* output, const int4& roi, size_t inputWidth, size_t inputHeight )
+cudaError_t cudaCrop( float4* input, float4* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream )
 {
-	return launchCrop<float4>(input, output, roi, inputWidth, inputHeight);
+	NVTX_RANGE("cudaCrop");
+
+	return launchCrop<float4>(input, inputWidth * sizeof(float4), output, (roi.z - roi.x) * sizeof(float4), roi, inputWidth, inputHeight, stream);
 }
 
 //-----------------------------------------------------------------------------------
-cudaError_t cudaCrop( void* input, void* output, const int4& roi, size_t inputWidth, size_t inputHeight, imageFormat format )
+cudaError_t cudaCrop( void* input, void* output, const int4& roi, size_t inputWidth, size_t inputHeight, imageFormat format, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaCrop");
+
+	if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return cudaCrop((uchar3*)input, (uchar3*)output, roi, inputWidth, inputHeight, stream);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return cudaCrop((uchar4*)input, (uchar4*)output, roi, inputWidth, inputHeight, stream);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return cudaCrop((float3*)input, (float3*)output, roi, inputWidth, inputHeight, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return cudaCrop((float4*)input, (float4*)output, roi, inputWidth, inputHeight, stream);
+	else if( format == IMAGE_GRAY8 )
+		return cudaCrop((uint8_t*)input, (uint8_t*)output, roi, inputWidth, inputHeight, stream);
+	else if( format == IMAGE_GRAY32F )
+		return cudaCrop((float*)input, (float*)output, roi, inputWidth, inputHeight, stream);
+
+	LogError(LOG_CUDA "cudaCrop() -- invalid image format '%s'\n", imageFormatToStr(format));
+	LogError(LOG_CUDA "              supported formats are:\n");
+	LogError(LOG_CUDA "                  * gray8\n");
+	LogError(LOG_CUDA "                  * gray32f\n");
+	LogError(LOG_CUDA "                  * rgb8, bgr8\n");
+	LogError(LOG_CUDA "                  * rgba8, bgra8\n");
+	LogError(LOG_CUDA "                  * rgb32f, bgr32f\n");
+	LogError(LOG_CUDA "                  * rgba32f, bgra32f\n");
+
+	return cudaErrorInvalidValue;
+}
+
+// cudaCrop (pitched)
+cudaError_t cudaCrop( void* input, size_t inputPitch, void* output, size_t outputPitch, const int4& roi, size_t inputWidth, size_t inputHeight, imageFormat format, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaCrop");
+
 	if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
-		return cudaCrop((uchar3*)input, (uchar3*)output, roi, inputWidth, inputHeight);
+		return launchCrop<uchar3>((uchar3*)input, inputPitch, (uchar3*)output, outputPitch, roi, inputWidth, inputHeight, stream);
 	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
-		return cudaCrop((uchar4*)input, (uchar4*)output, roi, inputWidth, inputHeight);
+		return launchCrop<uchar4>((uchar4*)input, inputPitch, (uchar4*)output, outputPitch, roi, inputWidth, inputHeight, stream);
 	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
-		return cudaCrop((float3*)input, (float3*)output, roi, inputWidth, inputHeight);
+		return launchCrop<float3>((float3*)input, inputPitch, (float3*)output, outputPitch, roi, inputWidth, inputHeight, stream);
 	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
-		return cudaCrop((float4*)input, (float4*)output, roi, inputWidth, inputHeight);
+		return launchCrop<float4>((float4*)input, inputPitch, (float4*)output, outputPitch, roi, inputWidth, inputHeight, stream);
 	else if( format == IMAGE_GRAY8 )
-		return cudaCrop((uint8_t*)input, (uint8_t*)output, roi, inputWidth, inputHeight);
+		return launchCrop<uint8_t>((uint8_t*)input, inputPitch, (uint8_t*)output, outputPitch, roi, inputWidth, inputHeight, stream);
 	else if( format == IMAGE_GRAY32F )
-		return cudaCrop((float*)input, (float*)output, roi, inputWidth, inputHeight);
+		return launchCrop<float>((float*)input, inputPitch, (float*)output, outputPitch, roi, inputWidth, inputHeight, stream);
 
 	LogError(LOG_CUDA "cudaCrop() -- invalid image format '%s'\n", imageFormatToStr(format));
 	LogError(LOG_CUDA "              supported formats are:\n");
@@ -144,4 +205,177 @@ cudaError_t cudaCrop( void* input, void* output, const int4& roi, size_t inputWi
 
 
 
+//-----------------------------------------------------------------------------------
+// Batched crop + resize
+//-----------------------------------------------------------------------------------
+
+// CropReader (reads a pixel relative to the ROI as float3 RGB)
+template<typename T, bool isBGR>
+struct CropReader
+{
+	T*  ptr;
+	int width;
+	int left;
+	int top;
+
+	__device__ inline float3 operator()( int x, int y ) const
+	{
+		const float3 px = make_float3(ptr[(top + y) * width + left + x]);
+		return isBGR ? make_float3(px.z, px.y, px.x) : px;
+	}
+};
+
+static inline __device__ void cropStore( float* output, float value )	{ *output = value; }
+static inline __device__ void cropStore( __half* output, float value )	{ *output = __float2half(value); }
+
+// gpuCropResizeBatch
+template<typename T_in, typename T_out, bool isBGR, cudaFilterMode filter>
+__global__ void gpuCropResizeBatch( T_in* input, int inputWidth, int inputHeight, const int4* rois, 
+							 T_out* output, int outputWidth, int outputHeight, 
+							 float3 multiplier, float3 offset )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	// clamp the ROI to the image
+	const int4 roi = rois[blockIdx.z];
+
+	const int left   = max(min(roi.x, inputWidth - 1), 0);
+	const int top    = max(min(roi.y, inputHeight - 1), 0);
+	const int right  = max(min(roi.z, inputWidth), left + 1);
+	const int bottom = max(min(roi.w, inputHeight), top + 1);
+
+	const CropReader<T_in, isBGR> reader = {input, inputWidth, left, top};
+	const float3 px = cudaFilterPixelReader<filter, float3>(reader, x, y, right - left, bottom - top, outputWidth, outputHeight) * multiplier + offset;
+
+	const int n = outputWidth * outputHeight;
+	T_out* tensor = output + blockIdx.z * n * 3 + y * outputWidth + x;
+
+	cropStore(tensor, px.x);
+	cropStore(tensor + n, px.y);
+	cropStore(tensor + n * 2, px.z);
+}
+
+// launchCropResizeBatch
+template<typename T_in, bool isBGR, typename T_out>
+static cudaError_t launchCropResizeBatch( T_in* input, size_t inputWidth, size_t inputHeight, 
+								  const int4* rois, size_t numROIs,
+								  T_out* output, size_t outputWidth, size_t outputHeight,
+								  const float3& multiplier, const float3& offset,
+								  cudaFilterMode filter, cudaStream_t stream )
+{
+	// launch kernel (one z-slice of the grid per ROI)
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y), numROIs);
+
+	#define launch_crop_batch(filterMode)	\
+		gpuCropResizeBatch<T_in, T_out, isBGR, filterMode><<<gridDim, blockDim, 0, stream>>>(input, inputWidth, inputHeight, rois, output, outputWidth, outputHeight, multiplier, offset)
+
+	if( filter == FILTER_POINT )
+		launch_crop_batch(FILTER_POINT);
+	else if( filter == FILTER_LINEAR )
+		launch_crop_batch(FILTER_LINEAR);
+	else if( filter == FILTER_AREA )
+		launch_crop_batch(FILTER_AREA);
+	else
+		return cudaErrorInvalidValue;
+
+	return CUDA(cudaGetLastError());
+}
+
+// launchCropResizeBatch
+template<typename T>
+static cudaError_t launchCropResizeBatch( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+								  const int4* rois, size_t numROIs,
+								  T* output, size_t outputWidth, size_t outputHeight,
+								  const float2& range, const float3& mean, const float3& stdDev,
+								  cudaFilterMode filter, cudaStream_t stream )
+{
+	if( !input || !output || !rois )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || inputHeight == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( numROIs == 0 )
+		return cudaSuccess;
+
+	if( numROIs > 65535 )
+	{
+		LogError(LOG_CUDA "cudaCropResizeBatch() -- the batch size is limited to 65535 ROIs (%zu were requested)\n", numROIs);
+		return cudaErrorInvalidValue;
+	}
+
+	if( stdDev.x == 0.0f || stdDev.y == 0.0f || stdDev.z == 0.0f )
+	{
+		LogError(LOG_CUDA "cudaCropResizeBatch() -- stdDev must be non-zero\n");
+		return cudaErrorInvalidValue;
+	}
+
+	// fold the range scaling and mean/stdDev normalization into a single multiply-add
+	const float s = (range.y - range.x) / 255.0f;
+
+	const float3 multiplier = make_float3(s / stdDev.x, s / stdDev.y, s / stdDev.z);
+	const float3 offset = make_float3((range.x - mean.x) / stdDev.x,
+							    (range.x - mean.y) / stdDev.y,
+							    (range.x - mean.z) / stdDev.z);
+
+	#define crop_batch(type, isBGR) \
+		launchCropResizeBatch<type, isBGR, T>((type*)input, inputWidth, inputHeight, rois, numROIs, output, outputWidth, outputHeight, multiplier, offset, filter, stream)
+
+	if( format == IMAGE_RGB8 )
+		return crop_batch(uchar3, false);
+	else if( format == IMAGE_BGR8 )
+		return crop_batch(uchar3, true);
+	else if( format == IMAGE_RGBA8 )
+		return crop_batch(uchar4, false);
+	else if( format == IMAGE_BGRA8 )
+		return crop_batch(uchar4, true);
+	else if( format == IMAGE_RGB32F )
+		return crop_batch(float3, false);
+	else if( format == IMAGE_BGR32F )
+		return crop_batch(float3, true);
+	else if( format == IMAGE_RGBA32F )
+		return crop_batch(float4, false);
+	else if( format == IMAGE_BGRA32F )
+		return crop_batch(float4, true);
+
+	LogError(LOG_CUDA "cudaCropResizeBatch() -- invalid image format '%s'\n", imageFormatToStr(format));
+	LogError(LOG_CUDA "                         supported formats are:\n");
+	LogError(LOG_CUDA "                             * rgb8, bgr8\n");
+	LogError(LOG_CUDA "                             * rgba8, bgra8\n");
+	LogError(LOG_CUDA "                             * rgb32f, bgr32f\n");
+	LogError(LOG_CUDA "                             * rgba32f, bgra32f\n");
+
+	return cudaErrorInvalidValue;
+}
+
+// cudaCropResizeBatch (float)
+cudaError_t cudaCropResizeBatch( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+						   const int4* rois, size_t numROIs, 
+						   float* output, size_t outputWidth, size_t outputHeight,
+						   const float2& range, const float3& mean, const float3& stdDev,
+						   cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaCropResizeBatch");
+
+	return launchCropResizeBatch<float>(input, inputWidth, inputHeight, format, rois, numROIs, output, outputWidth, outputHeight, range, mean, stdDev, filter, stream);
+}
+
+// cudaCropResizeBatch (half)
+cudaError_t cudaCropResizeBatch( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+						   const int4* rois, size_t numROIs, 
+						   __half* output, size_t outputWidth, size_t outputHeight,
+						   const float2& range, const float3& mean, const float3& stdDev,
+						   cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaCropResizeBatch");
+
+	return launchCropResizeBatch<__half>(input, inputWidth, inputHeight, format, rois, numROIs, output, outputWidth, outputHeight, range, mean, stdDev, filter, stream);
+}
+
+
 
@@ -25,8 +25,11 @@
 
 
 #include "cudaUtility.h"
+#include "cudaFilterMode.h"
 #include "imageFormat.h"
 
+#include <cuda_fp16.h>
+
 
 /**
  * Crop a uint8 grayscale image to the specified region of interest (ROI).
@@ -46,10 +49,11 @@
  *
  * @param inputWidth width of the input image (in pixels)
  * @param inputWidth height of the input image (in pixels)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  *
  * @ingroup crop
  */
-cudaError_t cudaCrop( uint8_t* input, uint8_t* output, const int4& roi, size_t inputWidth, size_t inputHeight );
+cudaError_t cudaCrop( uint8_t* input, uint8_t* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream=NULL );
 
 /**
  * Crop a floating-point grayscale image to the specified region of interest (ROI).
@@ -69,10 +73,11 @@ cudaError_t cudaCrop( uint8_t* input, uint8_t* output, const int4& roi, size_t i
  *
  * @param inputWidth width of the input image (in pixels)
  * @param inputWidth height of the input image (in pixels)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  *
  * @ingroup crop
  */
-cudaError_t cudaCrop( float* input, float* output, const int4& roi, size_t inputWidth, size_t inputHeight );
+cudaError_t cudaCrop( float* input, float* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream=NULL );
 
 /**
  * Crop a uchar3 RGB/BGR image to the specified region of interest (ROI).
@@ -92,10 +97,11 @@ cudaError_t cudaCrop( float* input, float* output, const int4& roi, size_t input
  *
  * @param inputWidth width of the input image (in pixels)
  * @param inputWidth height of the input image (in pixels)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  *
  * @ingroup crop
  */
-cudaError_t cudaCrop( uchar3* input, uchar3* output, const int4& roi, size_t inputWidth, size_t inputHeight );
+cudaError_t cudaCrop( uchar3* input, uchar3* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream=NULL );
 
 /**
  * Crop a uchar4 RGBA/BGRA image to the specified region of interest (ROI).
@@ -115,10 +121,11 @@ cudaError_t cudaCrop( uchar3* input, uchar3* output, const int4& roi, size_t inp
  *
  * @param inputWidth width of the input image (in pixels)
  * @param inputWidth height of the input image (in pixels)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  *
  * @ingroup crop
  */
-cudaError_t cudaCrop( uchar4* input, uchar4* output, const int4& roi, size_t inputWidth, size_t inputHeight );
+cudaError_t cudaCrop( uchar4* input, uchar4* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream=NULL );
 
 /**
  * Crop a float3 RGB/BGR image to the specified region of interest (ROI).
@@ -138,10 +145,11 @@ cudaError_t cudaCrop( uchar4* input, uchar4* output, const int4& roi, size_t inp
  *
  * @param inputWidth width of the input image (in pixels)
  * @param inputWidth height of the input image (in pixels)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  *
  * @ingroup crop
  */
-cudaError_t cudaCrop( float3* input, float3* output, const int4& roi, size_t inputWidth, size_t inputHeight );
+cudaError_t cudaCrop( float3* input, float3* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream=NULL );
 
 /**
  * Crop a float4 RGBA/BGRA image to the specified region of interest (ROI).
@@ -161,10 +169,11 @@ cudaError_t cudaCrop( float3* input, float3* output, const int4& roi, size_t inp
  *
  * @param inputWidth width of the input image (in pixels)
  * @param inputWidth height of the input image (in pixels)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  *
  * @ingroup crop
  */
-cudaError_t cudaCrop( float4* input, float4* output, const int4& roi, size_t inputWidth, size_t inputHeight );
+cudaError_t cudaCrop( float4* input, float4* output, const int4& roi, size_t inputWidth, size_t inputHeight, cudaStream_t stream=NULL );
 
 /**
  * Crop a float4 RGBA/BGRA image to the specified region of interest (ROI).
@@ -186,10 +195,74 @@ cudaError_t cudaCrop( float4* input, float4* output, const int4& roi, size_t inp
  * @param inputWidth height of the input image (in pixels)
  * @param format format of the image - valid formats are gray8, gray32f, rgb8/bgr8, 
  *               rgba8/bgra8, rgb32f/bgr32f, and rgba32f/bgra32f.
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
+ *
+ * @ingroup crop
+ */
+cudaError_t cudaCrop( void* input, void* output, const int4& roi, size_t inputWidth, size_t inputHeight, imageFormat format, cudaStream_t stream=NULL );
+
+/**
+ * Crop a pitched image to the specified region of interest (ROI).
  *
+ * This is the same as the other version of cudaCrop() that takes an imageFormat,
+ * except that the input and output images can have row pitches that are larger than
+ * `width * bytesPerPixel` (for example memory from cudaMallocPitch() or decoder surfaces).
+ *
+ * @param inputPitch size of each row in the input image (in bytes)
+ * @param outputPitch size of each row in the output image (in bytes)
+ *
+ * @ingroup crop
+ */
+cudaError_t cudaCrop( void* input, size_t inputPitch, void* output, size_t outputPitch, const int4& roi, size_t inputWidth, size_t inputHeight, imageFormat format, cudaStream_t stream=NULL );
+
+/**
+ * Crop a batch of regions of interest (ROIs) from an image and resize each one to the same
+ * size, writing them into a single contiguous planar RGB batch tensor (NCHW) in one launch.
+ *
+ * Each crop is also normalized as `((pixel / 255) * (range.y - range.x) + range.x - mean) / stdDev`,
+ * which with the default arguments leaves the pixel values unchanged in `[0,255]`.
+ *
+ * @param[in] input Pointer to the input image in CUDA memory.
+ * @param inputWidth width of the input image (in pixels)
+ * @param inputHeight height of the input image (in pixels)
+ * @param format format of the input image - valid formats are rgb8/bgr8, rgba8/bgra8,
+ *               rgb32f/bgr32f, and rgba32f/bgra32f.  BGR inputs are swapped to RGB.
+ * @param[in] rois Array of `numROIs` crop rectangles in CUDA device memory, using
+ *                 the same `(left, top, right, bottom)` layout as cudaCrop().  Since the
+ *                 ROIs are read by the kernel, they get clamped to the image bounds.
+ * @param numROIs the number of ROIs in the batch (i.e. N)
+ * @param[out] output Pointer to the output tensor in CUDA memory, which should be
+ *                    `numROIs * 3 * outputWidth * outputHeight` elements in size.
+ * @param outputWidth width that each crop gets resized to (in pixels)
+ * @param outputHeight height that each crop gets resized to (in pixels)
+ * @param range the range the pixel values are first scaled to (e.g. `[0,1]`)
+ * @param mean the per-channel mean that gets subtracted (in RGB order)
+ * @param stdDev the per-channel standard deviation that gets divided by (in RGB order)
+ * @param filter the filtering mode used for resizing the crops
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
+ *
+ * @ingroup crop
+ */
+cudaError_t cudaCropResizeBatch( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+						   const int4* rois, size_t numROIs, 
+						   float* output, size_t outputWidth, size_t outputHeight,
+						   const float2& range=make_float2(0,255),
+						   const float3& mean=make_float3(0,0,0),
+						   const float3& stdDev=make_float3(1,1,1),
+						   cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+/**
+ * Crop a batch of ROIs and resize them into a half-precision planar RGB batch tensor (NCHW).
+ * @see cudaCropResizeBatch() for a description of the parameters.
  * @ingroup crop
  */
-cudaError_t cudaCrop( void* input, void* output, const int4& roi, size_t inputWidth, size_t inputHeight, imageFormat format );
+cudaError_t cudaCropResizeBatch( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+						   const int4* rois, size_t numROIs, 
+						   __half* output, size_t outputWidth, size_t outputHeight,
+						   const float2& range=make_float2(0,255),
+						   const float3& mean=make_float3(0,0,0),
+						   const float3& stdDev=make_float3(1,1,1),
+						   cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
 
 
 #endif
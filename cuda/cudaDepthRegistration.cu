@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaDepthRegistration.h"
+#include "cudaMath.h"
+#include "cudaNVTX.h"
+
+#include "logging.h"
+
+
+// the largest footprint that a depth pixel gets splatted over (in color pixels per side)
+#define REGISTER_MAX_SPLAT 8
+
+// the value of empty pixels in the z-buffer (before they're converted to zero)
+#define REGISTER_EMPTY 0xFFFFFFFF
+
+
+// calibration of the depth and color cameras
+struct registerParams
+{
+	float4 R[3];		// depth -> color transform (the first 3 rows of the 4x4 extrinsics)
+
+	float2 depthFocal;
+	float2 depthCenter;
+	float2 colorFocal;
+	float2 colorCenter;
+};
+
+
+// convert depth samples to float
+static inline __device__ float registerDepth( const float& d )		{ return d; }
+static inline __device__ float registerDepth( const uint16_t& d )	{ return float(d); }
+static inline __device__ float registerDepth( const __half& d )	{ return __half2float(d); }
+
+
+// transform a depth pixel into the color camera
+static inline __device__ float3 registerPoint( const registerParams& p, float x, float y, float z )
+{
+	const float3 pt = make_float3((x - p.depthCenter.x) * z / p.depthFocal.x,
+							(y - p.depthCenter.y) * z / p.depthFocal.y,
+							z);
+
+	return make_float3(p.R[0].x * pt.x + p.R[0].y * pt.y + p.R[0].z * pt.z + p.R[0].w,
+				    p.R[1].x * pt.x + p.R[1].y * pt.y + p.R[1].z * pt.z + p.R[1].w,
+				    p.R[2].x * pt.x + p.R[2].y * pt.y + p.R[2].z * pt.z + p.R[2].w);
+}
+
+
+// project a point in the color camera into its image
+static inline __device__ float2 registerProject( const registerParams& p, const float3& pt )
+{
+	return make_float2(pt.x * p.colorFocal.x / pt.z + p.colorCenter.x,
+				    pt.y * p.colorFocal.y / pt.z + p.colorCenter.y);
+}
+
+
+// gpuRegisterDepth (scatter each depth pixel into the z-buffer of the color camera)
+template<typename T>
+__global__ void gpuRegisterDepth( T* depth, int depth_width, int depth_height, float depth_scale,
+						    registerParams params, uint32_t* zbuffer, int color_width, int color_height )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= depth_width || y >= depth_height )
+		return;
+
+	const float z = registerDepth(depth[y * depth_width + x]) * depth_scale;
+
+	if( !(z > 0.0f) || isinf(z) )
+		return;
+
+	const float3 center = registerPoint(params, x, y, z);
+
+	if( center.z <= 0.0f )
+		return;
+
+	// project the corners of the pixel to find its footprint
+	const float3 a = registerPoint(params, x - 0.5f, y - 0.5f, z);
+	const float3 b = registerPoint(params, x + 0.5f, y + 0.5f, z);
+
+	if( a.z <= 0.0f || b.z <= 0.0f )
+		return;
+
+	const float2 pa = registerProject(params, a);
+	const float2 pb = registerProject(params, b);
+
+	const int u0 = max(int(floorf(fminf(pa.x, pb.x) + 0.5f)), 0);
+	const int v0 = max(int(floorf(fminf(pa.y, pb.y) + 0.5f)), 0);
+
+	const int u1 = min(min(int(floorf(fmaxf(pa.x, pb.x) + 0.5f)), u0 + REGISTER_MAX_SPLAT - 1), color_width - 1);
+	const int v1 = min(min(int(floorf(fmaxf(pa.y, pb.y) + 0.5f)), v0 + REGISTER_MAX_SPLAT - 1), color_height - 1);
+
+	// positive floats compare the same as their bits do as unsigned ints
+	const uint32_t bits = __float_as_uint(center.z);
+
+	for( int v=v0; v <= v1; v++ )
+		for( int u=u0; u <= u1; u++ )
+			atomicMin(zbuffer + v * color_width + u, bits);
+}
+
+
+// gpuRegisterDepthFinalize (convert the z-buffer to depth in place)
+__global__ void gpuRegisterDepthFinalize( uint32_t* zbuffer, int size )
+{
+	const int i = blockIdx.x * blockDim.x + threadIdx.x;
+
+	if( i >= size )
+		return;
+
+	const uint32_t bits = zbuffer[i];
+	((float*)zbuffer)[i] = (bits == REGISTER_EMPTY) ? 0.0f : __uint_as_float(bits);
+}
+
+
+// launchRegisterDepth
+template<typename T>
+static cudaError_t launchRegisterDepth( T* depth, uint32_t depth_width, uint32_t depth_height,
+								const float2& depth_focal, const float2& depth_center, const float extrinsics[4][4],
+								float* output, uint32_t color_width, uint32_t color_height,
+								const float2& color_focal, const float2& color_center,
+								float depth_scale, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRegisterDepth");
+
+	if( !depth || !output || !extrinsics )
+		return cudaErrorInvalidDevicePointer;
+
+	if( depth_width == 0 || depth_height == 0 || color_width == 0 || color_height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( depth_focal.x == 0.0f || depth_focal.y == 0.0f || color_focal.x == 0.0f || color_focal.y == 0.0f )
+	{
+		LogError(LOG_CUDA "cudaRegisterDepth() -- the focal lengths of the cameras can't be zero\n");
+		return cudaErrorInvalidValue;
+	}
+
+	registerParams params;
+
+	for( int n=0; n < 3; n++ )
+		params.R[n] = make_float4(extrinsics[n][0], extrinsics[n][1], extrinsics[n][2], extrinsics[n][3]);
+
+	params.depthFocal  = depth_focal;
+	params.depthCenter = depth_center;
+	params.colorFocal  = color_focal;
+	params.colorCenter = color_center;
+
+	// clear the z-buffer (which is the output)
+	const size_t size = color_width * color_height;
+
+	if( CUDA_FAILED(cudaMemsetAsync(output, 0xFF, size * sizeof(float), stream)) )
+		return cudaErrorInvalidValue;
+
+	// scatter the depth pixels
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(depth_width, blockDim.x), iDivUp(depth_height, blockDim.y));
+
+	gpuRegisterDepth<T><<<gridDim, blockDim, 0, stream>>>(depth, depth_width, depth_height, depth_scale,
+											    params, (uint32_t*)output, color_width, color_height);
+
+	// convert the z-buffer to depth
+	gpuRegisterDepthFinalize<<<iDivUp(size, 256), 256, 0, stream>>>((uint32_t*)output, size);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaRegisterDepth
+cudaError_t cudaRegisterDepth( float* depth, uint32_t depth_width, uint32_t depth_height,
+						 const float2& depth_focal, const float2& depth_center, const float extrinsics[4][4],
+						 float* output, uint32_t color_width, uint32_t color_height,
+						 const float2& color_focal, const float2& color_center,
+						 float depth_scale, cudaStream_t stream )
+{
+	return launchRegisterDepth(depth, depth_width, depth_height, depth_focal, depth_center, extrinsics,
+						  output, color_width, color_height, color_focal, color_center, depth_scale, stream);
+}
+
+
+// cudaRegisterDepth
+cudaError_t cudaRegisterDepth( uint16_t* depth, uint32_t depth_width, uint32_t depth_height,
+						 const float2& depth_focal, const float2& depth_center, const float extrinsics[4][4],
+						 float* output, uint32_t color_width, uint32_t color_height,
+						 const float2& color_focal, const float2& color_center,
+						 float depth_scale, cudaStream_t stream )
+{
+	return launchRegisterDepth(depth, depth_width, depth_height, depth_focal, depth_center, extrinsics,
+						  output, color_width, color_height, color_focal, color_center, depth_scale, stream);
+}
+
+
+// cudaRegisterDepth
+cudaError_t cudaRegisterDepth( __half* depth, uint32_t depth_width, uint32_t depth_height,
+						 const float2& depth_focal, const float2& depth_center, const float extrinsics[4][4],
+						 float* output, uint32_t color_width, uint32_t color_height,
+						 const float2& color_focal, const float2& color_center,
+						 float depth_scale, cudaStream_t stream )
+{
+	return launchRegisterDepth(depth, depth_width, depth_height, depth_focal, depth_center, extrinsics,
+						  output, color_width, color_height, color_focal, color_center, depth_scale, stream);
+}
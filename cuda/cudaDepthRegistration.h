@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_DEPTH_REGISTRATION_H__
+#define __CUDA_DEPTH_REGISTRATION_H__
+
+
+#include "cudaUtility.h"
+
+#include <cuda_fp16.h>
+
+
+/**
+ * Register a depth map to a color camera, for RGB-D sensors where the depth and color
+ * cameras are offset from each other (or have different intrinsics).
+ *
+ * Each depth pixel is unprojected with the depth intrinsics, transformed into the coordinate
+ * frame of the color camera by the extrinsics, and projected with the color intrinsics.
+ * The depth is splatted over the footprint of the pixel in the color image (so that a lower
+ * resolution depth map doesn't leave holes), and where several pixels land on the same spot
+ * the nearest one wins (a z-buffer with atomicMin).  Color pixels that no depth lands on are 0.
+ *
+ * The output has the depth along the color camera's z-axis (in the units of the depth after
+ * `depth_scale` is applied), so it can be passed to cudaPointCloud::Extract() with the color
+ * image, along with the color intrinsics in cudaPointCloud::SetCalibration().
+ *
+ * @param depth_focal the focal length of the depth camera (fx, fy) in pixels
+ * @param depth_center the principal point of the depth camera (cx, cy) in pixels
+ * @param extrinsics the 4x4 rigid transform from the depth to the color camera coordinates
+ *                   (row-major, with the translation in the last column, in the units of the depth)
+ * @param output the registered depth map at the color resolution (float, in CUDA memory)
+ * @param color_focal the focal length of the color camera (fx, fy) in pixels
+ * @param color_center the principal point of the color camera (cx, cy) in pixels
+ * @param depth_scale multiplier applied to the depth values (e.g. 0.001 for millimeters to meters)
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ *
+ * @ingroup pointCloud
+ */
+cudaError_t cudaRegisterDepth( float* depth, uint32_t depth_width, uint32_t depth_height,
+						 const float2& depth_focal, const float2& depth_center, const float extrinsics[4][4],
+						 float* output, uint32_t color_width, uint32_t color_height,
+						 const float2& color_focal, const float2& color_center,
+						 float depth_scale=1.0f, cudaStream_t stream=NULL );
+
+/**
+ * Register a 16-bit depth map to a color camera.
+ * @see the float version of cudaRegisterDepth() for a description of the parameters.
+ * @ingroup pointCloud
+ */
+cudaError_t cudaRegisterDepth( uint16_t* depth, uint32_t depth_width, uint32_t depth_height,
+						 const float2& depth_focal, const float2& depth_center, const float extrinsics[4][4],
+						 float* output, uint32_t color_width, uint32_t color_height,
+						 const float2& color_focal, const float2& color_center,
+						 float depth_scale=0.001f, cudaStream_t stream=NULL );
+
+/**
+ * Register a half-precision depth map to a color camera.
+ * @see the float version of cudaRegisterDepth() for a description of the parameters.
+ * @ingroup pointCloud
+ */
+cudaError_t cudaRegisterDepth( __half* depth, uint32_t depth_width, uint32_t depth_height,
+						 const float2& depth_focal, const float2& depth_center, const float extrinsics[4][4],
+						 float* output, uint32_t color_width, uint32_t color_height,
+						 const float2& color_focal, const float2& color_center,
+						 float depth_scale=1.0f, cudaStream_t stream=NULL );
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_DEVICE_H__
+#define __CUDA_DEVICE_H__
+
+
+#include "cudaUtility.h"
+
+
+/**
+ * Make a CUDA device current for the lifetime of the object, and restore the device
+ * that was current before once it goes out of scope.  This is used to pin the rings,
+ * conversions and kernels of a stream to a specific GPU on multi-GPU systems.
+ *
+ * A device of -1 leaves the current device unchanged (which is the default everywhere).
+ *
+ * @ingroup cuda
+ */
+class cudaDeviceScope
+{
+public:
+	/**
+	 * Switch to the device (or do nothing if it's -1 or is already current).
+	 */
+	inline cudaDeviceScope( int device ) : mPrevious(-1)
+	{
+		if( device < 0 || cudaGetDevice(&mPrevious) != cudaSuccess || mPrevious == device )
+		{
+			mPrevious = -1;
+			return;
+		}
+
+		if( CUDA_FAILED(cudaSetDevice(device)) )
+			mPrevious = -1;
+	}
+
+	/**
+	 * Restore the previous device.
+	 */
+	inline ~cudaDeviceScope()
+	{
+		if( mPrevious >= 0 )
+			cudaSetDevice(mPrevious);
+	}
+
+private:
+	int mPrevious;
+};
+
+
+/**
+ * Return the device that the memory was allocated on with cudaMalloc(), or -1 if
+ * it's host memory (including mapped zeroCopy memory) or the pointer is unknown to CUDA.
+ * @ingroup cuda
+ */
+inline int cudaPointerDevice( const void* ptr )
+{
+	cudaPointerAttributes attr;
+
+	if( !ptr || cudaPointerGetAttributes(&attr, ptr) != cudaSuccess )
+	{
+		cudaGetLastError();	// unregistered host memory reports an error that would stick around
+		return -1;
+	}
+
+	if( attr.type != cudaMemoryTypeDevice && attr.type != cudaMemoryTypeManaged )
+		return -1;
+
+	return attr.device;
+}
+
+
+/**
+ * Enable direct peer-to-peer access from the current device to the memory of another
+ * device, if the GPUs support it.  It only needs to be done once per pair of devices,
+ * and cudaMemcpyPeerAsync() still works without it (by staging through the host).
+ *
+ * @returns true if the devices can access each other's memory directly.
+ * @ingroup cuda
+ */
+inline bool cudaEnablePeerAccess( int peer )
+{
+	int device = 0;
+	int canAccess = 0;
+
+	if( cudaGetDevice(&device) != cudaSuccess || device == peer )
+		return device == peer;
+
+	if( cudaDeviceCanAccessPeer(&canAccess, device, peer) != cudaSuccess || !canAccess )
+		return false;
+
+	const cudaError_t result = cudaDeviceEnablePeerAccess(peer, 0);
+
+	if( result == cudaErrorPeerAccessAlreadyEnabled )
+	{
+		cudaGetLastError();
+		return true;
+	}
+
+	return !CUDA_FAILED(result);
+}
+
+
+/**
+ * Copy a frame that may live on another GPU into device memory on the current device.
+ * If the source is on a different device, it's copied peer-to-peer (and peer access
+ * gets enabled the first time two devices exchange frames), otherwise it's a regular
+ * device-to-device copy (which also covers mapped zeroCopy memory).
+ *
+ * @ingroup cuda
+ */
+inline cudaError_t cudaMemcpyFromDevice( void* dst, const void* src, size_t size, cudaStream_t stream=NULL )
+{
+	int device = 0;
+	const int srcDevice = cudaPointerDevice(src);
+
+	if( srcDevice < 0 || cudaGetDevice(&device) != cudaSuccess || srcDevice == device )
+		return cudaMemcpyAsync(dst, src, size, cudaMemcpyDeviceToDevice, stream);
+
+	static uint64_t peerEnabled = 0;	// pairs of devices that were already set up (up to 8 GPUs)
+	const uint64_t peerBit = (device < 8 && srcDevice < 8) ? (1ULL << (device * 8 + srcDevice)) : 0;
+
+	if( peerBit != 0 && !(peerEnabled & peerBit) )
+	{
+		if( cudaEnablePeerAccess(srcDevice) )
+			LogVerbose(LOG_CUDA "enabled peer access from GPU %i to GPU %i\n", device, srcDevice);
+
+		peerEnabled |= peerBit;
+	}
+
+	return cudaMemcpyPeerAsync(dst, device, src, srcDevice, size, stream);
+}
+
+#endif
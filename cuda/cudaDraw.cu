@@ -22,12 +22,12 @@
 
 #include "cudaDraw.h"
 #include "cudaAlphaBlend.cuh"
+#include "cudaNVTX.h"
 
 
 // TODO for rect/fill/line
 //    - make versions that only accept image (as both input/output)
 //    - add line width/line color
-//    - add overloads for single shape/multiple shapes
 //    - benchmarking of copy vs alternate kernel when input != output
 //    - overloads using int2 for coordinates
 //    - add a template parameter for alpha blending
@@ -65,15 +65,17 @@ __global__ void gpuDrawCircle( T* img, int imgWidth, int imgHeight, int offset_x
 }
 
 // cudaDrawCircle
-cudaError_t cudaDrawCircle( void* input, void* output, size_t width, size_t height, imageFormat format, int cx, int cy, float radius, const float4& color )
+cudaError_t cudaDrawCircle( void* input, void* output, size_t width, size_t height, imageFormat format, int cx, int cy, float radius, const float4& color, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaDrawCircle");
+
 	if( !input || !output || width == 0 || height == 0 || radius <= 0 )
 		return cudaErrorInvalidValue;
 
 	// if the input and output images are different, copy the input to the output
 	// this is because we only launch the kernel in the approximate area of the circle
 	if( input != output )
-		CUDA(cudaMemcpy(output, input, imageFormatSize(format, width, height), cudaMemcpyDeviceToDevice));
+		CUDA(cudaMemcpyAsync(output, input, imageFormatSize(format, width, height), cudaMemcpyDeviceToDevice, stream));
 		
 	// find a box around the circle
 	const int diameter = ceilf(radius * 2.0f);
@@ -85,7 +87,7 @@ cudaError_t cudaDrawCircle( void* input, void* output, size_t width, size_t heig
 	const dim3 gridDim(iDivUp(diameter,blockDim.x), iDivUp(diameter,blockDim.y));
 
 	#define LAUNCH_DRAW_CIRCLE(type) \
-		gpuDrawCircle<type><<<gridDim, blockDim>>>((type*)output, width, height, offset_x, offset_y, cx, cy, radius*radius, color)
+		gpuDrawCircle<type><<<gridDim, blockDim, 0, stream>>>((type*)output, width, height, offset_x, offset_y, cx, cy, radius*radius, color)
 	
 	if( format == IMAGE_RGB8 )
 		LAUNCH_DRAW_CIRCLE(uchar3);
@@ -135,8 +137,10 @@ __global__ void gpuDrawLine( T* img, int imgWidth, int imgHeight, int offset_x,
 }
 
 // cudaDrawLine
-cudaError_t cudaDrawLine( void* input, void* output, size_t width, size_t height, imageFormat format, int x1, int y1, int x2, int y2, const float4& color, float line_width )
+cudaError_t cudaDrawLine( void* input, void* output, size_t width, size_t height, imageFormat format, int x1, int y1, int x2, int y2, const float4& color, float line_width, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaDrawLine");
+
 	if( !input || !output || width == 0 || height == 0 || line_width <= 0 )
 		return cudaErrorInvalidValue;
 	
@@ -150,7 +154,7 @@ cudaError_t cudaDrawLine( void* input, void* output, size_t width, size_t height
 	// if the input and output images are different, copy the input to the output
 	// this is because we only launch the kernel in the approximate area of the circle
 	if( input != output )
-		CUDA(cudaMemcpy(output, input, imageFormatSize(format, width, height), cudaMemcpyDeviceToDevice));
+		CUDA(cudaMemcpyAsync(output, input, imageFormatSize(format, width, height), cudaMemcpyDeviceToDevice, stream));
 		
 	// find a box around the line
 	const int left = MIN(x1,x2) - line_width;
@@ -163,7 +167,7 @@ cudaError_t cudaDrawLine( void* input, void* output, size_t width, size_t height
 	const dim3 gridDim(iDivUp(right - left, blockDim.x), iDivUp(bottom - top, blockDim.y));
 
 	#define LAUNCH_DRAW_LINE(type) \
-		gpuDrawLine<type><<<gridDim, blockDim>>>((type*)output, width, height, left, top, x1, y1, x2, y2, color, line_width * line_width)
+		gpuDrawLine<type><<<gridDim, blockDim, 0, stream>>>((type*)output, width, height, left, top, x1, y1, x2, y2, color, line_width * line_width)
 	
 	if( format == IMAGE_RGB8 )
 		LAUNCH_DRAW_LINE(uchar3);
@@ -208,15 +212,17 @@ __global__ void gpuDrawRect( T* img, int imgWidth, int imgHeight, int x0, int y0
 
 
 // cudaDrawRect
-cudaError_t cudaDrawRect( void* input, void* output, size_t width, size_t height, imageFormat format, int left, int top, int right, int bottom, const float4& color, const float4& line_color, float line_width )
+cudaError_t cudaDrawRect( void* input, void* output, size_t width, size_t height, imageFormat format, int left, int top, int right, int bottom, const float4& color, const float4& line_color, float line_width, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaDrawRect");
+
 	if( !input || !output || width == 0 || height == 0 )
 		return cudaErrorInvalidValue;
 
 	// if the input and output images are different, copy the input to the output
 	// this is because we only launch the kernel in the approximate area of the circle
 	if( input != output )
-		CUDA(cudaMemcpy(output, input, imageFormatSize(format, width, height), cudaMemcpyDeviceToDevice));
+		CUDA(cudaMemcpyAsync(output, input, imageFormatSize(format, width, height), cudaMemcpyDeviceToDevice, stream));
 		
 	// make sure the coordinates are ordered
 	if( left > right )
@@ -249,7 +255,7 @@ cudaError_t cudaDrawRect( void* input, void* output, size_t width, size_t height
 		const dim3 gridDim(iDivUp(boxWidth,blockDim.x), iDivUp(boxHeight,blockDim.y));
 				
 		#define LAUNCH_DRAW_RECT(type) \
-			gpuDrawRect<type><<<gridDim, blockDim>>>((type*)output, width, height, left, top, boxWidth, boxHeight, color)
+			gpuDrawRect<type><<<gridDim, blockDim, 0, stream>>>((type*)output, width, height, left, top, boxWidth, boxHeight, color)
 		
 		if( format == IMAGE_RGB8 )
 			LAUNCH_DRAW_RECT(uchar3);
@@ -277,8 +283,327 @@ cudaError_t cudaDrawRect( void* input, void* output, size_t width, size_t height
 		};
 		
 		for( uint32_t n=0; n < 4; n++ )
-			CUDA(cudaDrawLine(output, width, height, format, lines[n][0], lines[n][1], lines[n][2], lines[n][3], line_color, line_width));
+			CUDA(cudaDrawLine(output, width, height, format, lines[n][0], lines[n][1], lines[n][2], lines[n][3], line_color, line_width, stream));
 	}
 	
 	return cudaGetLastError();
-}
\ No newline at end of file
+}
+
+
+//----------------------------------------------------------------------------
+// Batched drawing (each block culls the primitives against its tile, and then
+// each thread blends the overlapping primitives in order into its pixel)
+//----------------------------------------------------------------------------
+#define DRAW_TILE_SIZE    16
+#define DRAW_TILE_THREADS (DRAW_TILE_SIZE * DRAW_TILE_SIZE)
+
+// check if a primitive's bounding box overlaps the tile [left,right) [top,bottom)
+inline __device__ bool primitiveOverlaps( const cudaDrawPrimitive& p, int left, int top, int right, int bottom )
+{
+	int x0, y0, x1, y1;
+
+	if( p.type == CUDA_DRAW_CIRCLE )
+	{
+		if( p.size <= 0 )
+			return false;
+
+		x0 = p.x1 - p.size;
+		y0 = p.y1 - p.size;
+		x1 = p.x1 + p.size + 1;
+		y1 = p.y1 + p.size + 1;
+	}
+	else if( p.type == CUDA_DRAW_LINE )
+	{
+		// lines < 2 pixels in length are skipped, like cudaDrawLine() does
+		if( p.size <= 0 || dist2(p.x1, p.y1, p.x2, p.y2) < 4.0f )
+			return false;
+
+		x0 = MIN(p.x1, p.x2) - p.size;
+		y0 = MIN(p.y1, p.y2) - p.size;
+		x1 = MAX(p.x1, p.x2) + p.size + 1;
+		y1 = MAX(p.y1, p.y2) + p.size + 1;
+	}
+	else if( p.type == CUDA_DRAW_RECT )
+	{
+		x0 = MIN(p.x1, p.x2);
+		y0 = MIN(p.y1, p.y2);
+		x1 = MAX(p.x1, p.x2);
+		y1 = MAX(p.y1, p.y2);
+	}
+	else
+	{
+		return false;
+	}
+
+	return (x0 < right && x1 > left && y0 < bottom && y1 > top);
+}
+
+// check if a pixel is covered by a primitive (matches the individual kernels above)
+inline __device__ bool primitiveContains( const cudaDrawPrimitive& p, int x, int y )
+{
+	if( p.type == CUDA_DRAW_CIRCLE )
+	{
+		const int dx = x - p.x1;
+		const int dy = y - p.y1;
+
+		return (dx * dx + dy * dy < p.size * p.size);
+	}
+	else if( p.type == CUDA_DRAW_LINE )
+	{
+		return (lineDistanceSquared(x, y, p.x1, p.y1, p.x2, p.y2) <= p.size * p.size);
+	}
+	else if( p.type == CUDA_DRAW_RECT )
+	{
+		return (x >= MIN(p.x1, p.x2) && x < MAX(p.x1, p.x2) && y >= MIN(p.y1, p.y2) && y < MAX(p.y1, p.y2));
+	}
+
+	return false;
+}
+
+template<typename T>
+__global__ void gpuDrawPrimitives( T* input, T* output, int imgWidth, int imgHeight, const cudaDrawPrimitive* primitives, uint32_t count )
+{
+	__shared__ cudaDrawPrimitive tilePrimitives[DRAW_TILE_THREADS];
+	__shared__ bool tileOverlaps[DRAW_TILE_THREADS];
+
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+	const int tid = threadIdx.y * blockDim.x + threadIdx.x;
+
+	const int tileLeft = blockIdx.x * blockDim.x;
+	const int tileTop = blockIdx.y * blockDim.y;
+
+	const bool inside = (x < imgWidth && y < imgHeight);
+	const int idx = y * imgWidth + x;
+
+	T px;
+	bool modified = false;
+
+	if( inside )
+		px = input[idx];
+
+	// the threads in the block cooperatively load and cull a chunk of primitives at a time
+	for( uint32_t chunk=0; chunk < count; chunk += DRAW_TILE_THREADS )
+	{
+		const uint32_t n = chunk + tid;
+		bool overlaps = false;
+
+		if( n < count )
+		{
+			tilePrimitives[tid] = primitives[n];
+			overlaps = primitiveOverlaps(tilePrimitives[tid], tileLeft, tileTop, tileLeft + blockDim.x, tileTop + blockDim.y);
+		}
+
+		tileOverlaps[tid] = overlaps;
+
+		// skip the chunk if none of it overlaps this tile
+		if( !__syncthreads_or(overlaps) )
+			continue;
+
+		if( inside )
+		{
+			const uint32_t chunkCount = MIN(DRAW_TILE_THREADS, count - chunk);
+
+			for( uint32_t i=0; i < chunkCount; i++ )
+			{
+				if( tileOverlaps[i] && primitiveContains(tilePrimitives[i], x, y) )
+				{
+					px = cudaAlphaBlend(px, tilePrimitives[i].color);
+					modified = true;
+				}
+			}
+		}
+
+		__syncthreads();
+	}
+
+	if( inside && (modified || input != output) )
+		output[idx] = px;
+}
+
+// cudaDrawPrimitives
+cudaError_t cudaDrawPrimitives( void* input, void* output, size_t width, size_t height, imageFormat format, const cudaDrawPrimitive* primitives, uint32_t count, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaDrawPrimitives");
+
+	if( !input || !output || width == 0 || height == 0 || (count > 0 && !primitives) )
+		return cudaErrorInvalidValue;
+
+	if( count == 0 )
+	{
+		if( input != output )
+			return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(format, width, height), cudaMemcpyDeviceToDevice, stream));
+
+		return cudaSuccess;
+	}
+
+	// launch kernel over the whole image (which also copies input to output)
+	const dim3 blockDim(DRAW_TILE_SIZE, DRAW_TILE_SIZE);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+
+	#define LAUNCH_DRAW_PRIMITIVES(type) \
+		gpuDrawPrimitives<type><<<gridDim, blockDim, 0, stream>>>((type*)input, (type*)output, width, height, primitives, count)
+
+	if( format == IMAGE_RGB8 )
+		LAUNCH_DRAW_PRIMITIVES(uchar3);
+	else if( format == IMAGE_RGBA8 )
+		LAUNCH_DRAW_PRIMITIVES(uchar4);
+	else if( format == IMAGE_RGB32F )
+		LAUNCH_DRAW_PRIMITIVES(float3); 
+	else if( format == IMAGE_RGBA32F )
+		LAUNCH_DRAW_PRIMITIVES(float4);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaDrawPrimitives()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	return cudaGetLastError();
+}
+
+
+//----------------------------------------------------------------------------
+// cudaDrawList
+//----------------------------------------------------------------------------
+
+// constructor
+cudaDrawList::cudaDrawList()
+{
+	mDevicePrimitives = NULL;
+	mDeviceCapacity = 0;
+}
+
+
+// destructor
+cudaDrawList::~cudaDrawList()
+{
+	if( mDevicePrimitives != NULL )
+	{
+		CUDA(cudaFree(mDevicePrimitives));
+		mDevicePrimitives = NULL;
+	}
+}
+
+
+// AddCircle
+void cudaDrawList::AddCircle( int cx, int cy, float radius, const float4& color )
+{
+	if( radius <= 0 )
+		return;
+
+	cudaDrawPrimitive p;
+
+	p.type  = CUDA_DRAW_CIRCLE;
+	p.color = color;
+	p.x1    = cx;
+	p.y1    = cy;
+	p.x2    = cx;
+	p.y2    = cy;
+	p.size  = radius;
+
+	mPrimitives.push_back(p);
+}
+
+
+// AddLine
+void cudaDrawList::AddLine( int x1, int y1, int x2, int y2, const float4& color, float line_width )
+{
+	if( line_width <= 0 || dist(x1,y1,x2,y2) < 2.0 )
+		return;
+
+	cudaDrawPrimitive p;
+
+	p.type  = CUDA_DRAW_LINE;
+	p.color = color;
+	p.x1    = x1;
+	p.y1    = y1;
+	p.x2    = x2;
+	p.y2    = y2;
+	p.size  = line_width;
+
+	mPrimitives.push_back(p);
+}
+
+
+// AddRect
+void cudaDrawList::AddRect( int left, int top, int right, int bottom, const float4& color, const float4& line_color, float line_width )
+{
+	// make sure the coordinates are ordered
+	if( left > right )
+	{
+		const int swap = left;
+		left = right;
+		right = swap;
+	}
+	
+	if( top > bottom )
+	{
+		const int swap = top;
+		top = bottom;
+		bottom = swap;
+	}
+
+	if( right - left <= 0 || bottom - top <= 0 )
+	{
+		LogError(LOG_CUDA "cudaDrawList::AddRect() -- rect had width/height <= 0  left=%i top=%i right=%i bottom=%i\n", left, top, right, bottom);
+		return;
+	}
+
+	// rect fill
+	if( color.w > 0 )
+	{
+		cudaDrawPrimitive p;
+
+		p.type  = CUDA_DRAW_RECT;
+		p.color = color;
+		p.x1    = left;
+		p.y1    = top;
+		p.x2    = right;
+		p.y2    = bottom;
+		p.size  = 0.0f;
+
+		mPrimitives.push_back(p);
+	}
+
+	// rect outline
+	if( line_color.w > 0 && line_width > 0 )
+	{
+		AddLine(left, top, right, top, line_color, line_width);
+		AddLine(right, top, right, bottom, line_color, line_width);
+		AddLine(right, bottom, left, bottom, line_color, line_width);
+		AddLine(left, bottom, left, top, line_color, line_width);
+	}
+}
+
+
+// Draw
+cudaError_t cudaDrawList::Draw( void* input, void* output, size_t width, size_t height, imageFormat format, cudaStream_t stream )
+{
+	const uint32_t count = mPrimitives.size();
+
+	if( count == 0 )
+		return cudaDrawPrimitives(input, output, width, height, format, NULL, 0, stream);
+
+	// grow the device array if needed
+	if( count > mDeviceCapacity )
+	{
+		const uint32_t capacity = MAX(count, mDeviceCapacity * 2);
+
+		if( mDevicePrimitives != NULL )
+			CUDA(cudaFree(mDevicePrimitives));
+
+		mDevicePrimitives = NULL;
+		mDeviceCapacity = 0;
+
+		if( CUDA_FAILED(cudaMalloc((void**)&mDevicePrimitives, capacity * sizeof(cudaDrawPrimitive))) )
+			return cudaErrorMemoryAllocation;
+
+		mDeviceCapacity = capacity;
+	}
+
+	// upload all of the primitives at once (the copy is ordered in the stream
+	// before the kernel, and the CPU-side list can be modified after it returns)
+	CUDA(cudaMemcpyAsync(mDevicePrimitives, mPrimitives.data(), count * sizeof(cudaDrawPrimitive), cudaMemcpyHostToDevice, stream));
+
+	return cudaDrawPrimitives(input, output, width, height, format, mDevicePrimitives, count, stream);
+}
@@ -27,13 +27,15 @@
 #include "cudaUtility.h"
 #include "imageFormat.h"
 
+#include <vector>
+
 
 /**
  * cudaDrawCircle
  * @ingroup drawing
  */
 cudaError_t cudaDrawCircle( void* input, void* output, size_t width, size_t height, imageFormat format, 
-					   int cx, int cy, float radius, const float4& color );
+					   int cx, int cy, float radius, const float4& color, cudaStream_t stream=NULL );
 	
 /**
  * cudaDrawCircle
@@ -41,9 +43,9 @@ cudaError_t cudaDrawCircle( void* input, void* output, size_t width, size_t heig
  */
 template<typename T> 
 cudaError_t cudaDrawCircle( T* input, T* output, size_t width, size_t height, 
-				 	   int cx, int cy, float radius, const float4& color )	
+				 	   int cx, int cy, float radius, const float4& color, cudaStream_t stream=NULL )	
 { 
-	return cudaDrawCircle(input, output, width, height, imageFormatFromType<T>(), cx, cy, radius, color); 
+	return cudaDrawCircle(input, output, width, height, imageFormatFromType<T>(), cx, cy, radius, color, stream); 
 }	
 
 /**
@@ -51,9 +53,9 @@ cudaError_t cudaDrawCircle( T* input, T* output, size_t width, size_t height,
  * @ingroup drawing
  */
 inline cudaError_t cudaDrawCircle( void* image, size_t width, size_t height, imageFormat format, 
-							int cx, int cy, float radius, const float4& color )
+							int cx, int cy, float radius, const float4& color, cudaStream_t stream=NULL )
 {
-	return cudaDrawCircle(image, image, width, height, format, cx, cy, radius, color);
+	return cudaDrawCircle(image, image, width, height, format, cx, cy, radius, color, stream);
 }
 
 /**
@@ -62,9 +64,9 @@ inline cudaError_t cudaDrawCircle( void* image, size_t width, size_t height, ima
  */
 template<typename T> 
 cudaError_t cudaDrawCircle( T* image, size_t width, size_t height, 
-				 	   int cx, int cy, float radius, const float4& color )	
+				 	   int cx, int cy, float radius, const float4& color, cudaStream_t stream=NULL )	
 { 
-	return cudaDrawCircle(image, width, height, imageFormatFromType<T>(), cx, cy, radius, color); 
+	return cudaDrawCircle(image, width, height, imageFormatFromType<T>(), cx, cy, radius, color, stream); 
 }
 
 
@@ -73,7 +75,7 @@ cudaError_t cudaDrawCircle( T* image, size_t width, size_t height,
  * @ingroup drawing
  */
 cudaError_t cudaDrawLine( void* input, void* output, size_t width, size_t height, imageFormat format, 
-					 int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0 );
+					 int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0, cudaStream_t stream=NULL );
 	
 /**
  * cudaDrawLine
@@ -81,9 +83,9 @@ cudaError_t cudaDrawLine( void* input, void* output, size_t width, size_t height
  */
 template<typename T> 
 cudaError_t cudaDrawLine( T* input, T* output, size_t width, size_t height, 
-				 	 int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0 )	
+				 	 int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0, cudaStream_t stream=NULL )	
 { 
-	return cudaDrawLine(input, output, width, height, imageFormatFromType<T>(), x1, y1, x2, y2, color, line_width); 
+	return cudaDrawLine(input, output, width, height, imageFormatFromType<T>(), x1, y1, x2, y2, color, line_width, stream); 
 }
 
 /**
@@ -91,9 +93,9 @@ cudaError_t cudaDrawLine( T* input, T* output, size_t width, size_t height,
  * @ingroup drawing
  */
 inline cudaError_t cudaDrawLine( void* image, size_t width, size_t height, imageFormat format, 
-						   int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0 )
+						   int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0, cudaStream_t stream=NULL )
 {
-	return cudaDrawLine(image, image, width, height, format, x1, y1, x2, y2, color, line_width);
+	return cudaDrawLine(image, image, width, height, format, x1, y1, x2, y2, color, line_width, stream);
 }					
 	
 /**
@@ -102,9 +104,9 @@ inline cudaError_t cudaDrawLine( void* image, size_t width, size_t height, image
  */
 template<typename T> 
 cudaError_t cudaDrawLine( T* image, size_t width, size_t height, 
-				 	 int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0 )	
+				 	 int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0, cudaStream_t stream=NULL )	
 { 
-	return cudaDrawLine(image, width, height, imageFormatFromType<T>(), x1, y1, x2, y2, color, line_width); 
+	return cudaDrawLine(image, width, height, imageFormatFromType<T>(), x1, y1, x2, y2, color, line_width, stream); 
 }	
 
 
@@ -114,7 +116,7 @@ cudaError_t cudaDrawLine( T* image, size_t width, size_t height,
  */
 cudaError_t cudaDrawRect( void* input, void* output, size_t width, size_t height, imageFormat format, 
 					 int left, int top, int right, int bottom, const float4& color, 
-					 const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f );
+					 const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f, cudaStream_t stream=NULL );
 
 /**
  * cudaDrawRect
@@ -123,9 +125,9 @@ cudaError_t cudaDrawRect( void* input, void* output, size_t width, size_t height
 template<typename T> 
 cudaError_t cudaDrawRect( T* input, T* output, size_t width, size_t height, 
 				 	 int left, int top, int right, int bottom, const float4& color,
-					 const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f )	
+					 const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f, cudaStream_t stream=NULL )	
 { 
-	return cudaDrawRect(input, output, width, height, imageFormatFromType<T>(), left, top, right, bottom, color, line_color, line_width); 
+	return cudaDrawRect(input, output, width, height, imageFormatFromType<T>(), left, top, right, bottom, color, line_color, line_width, stream); 
 }
 
 /**
@@ -134,9 +136,9 @@ cudaError_t cudaDrawRect( T* input, T* output, size_t width, size_t height,
  */
 inline cudaError_t cudaDrawRect( void* image, size_t width, size_t height, imageFormat format, 
 						   int left, int top, int right, int bottom, const float4& color,
-						   const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f )
+						   const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f, cudaStream_t stream=NULL )
 {
-	return cudaDrawRect(image, image, width, height, format, left, top, right, bottom, color, line_color, line_width);
+	return cudaDrawRect(image, image, width, height, format, left, top, right, bottom, color, line_color, line_width, stream);
 }
 
 /**
@@ -146,9 +148,170 @@ inline cudaError_t cudaDrawRect( void* image, size_t width, size_t height, image
 template<typename T> 
 cudaError_t cudaDrawRect( T* image, size_t width, size_t height, 
 				 	 int left, int top, int right, int bottom, const float4& color,
-					 const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f )	
+					 const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f, cudaStream_t stream=NULL )	
 { 
-	return cudaDrawRect(image, image, width, height, imageFormatFromType<T>(), left, top, right, bottom, color, line_color, line_width); 
+	return cudaDrawRect(image, image, width, height, imageFormatFromType<T>(), left, top, right, bottom, color, line_color, line_width, stream); 
+}
+
+
+/**
+ * Types of shapes that can be rendered in a batch by cudaDrawPrimitives()
+ * @ingroup drawing
+ */
+enum cudaDrawType
+{
+	CUDA_DRAW_CIRCLE = 0,	/**< Circle centered at (x1,y1) with radius `size` */
+	CUDA_DRAW_LINE,		/**< Line from (x1,y1) to (x2,y2) with line width `size` */
+	CUDA_DRAW_RECT		/**< Filled rect with the corners (x1,y1) (left, top) and (x2,y2) (right, bottom) */
+};
+
+/**
+ * A single shape that gets rendered by cudaDrawPrimitives()
+ * @see cudaDrawList for building an array of these on the CPU.
+ * @ingroup drawing
+ */
+struct cudaDrawPrimitive
+{
+	float4   color;	/**< RGBA color of the shape (0-255) */
+	int      x1;		/**< Circle center / line start / rect left */
+	int      y1;		/**< Circle center / line start / rect top */
+	int      x2;		/**< Line end / rect right (unused for circles) */
+	int      y2;		/**< Line end / rect bottom (unused for circles) */
+	float    size;	/**< Circle radius / line width (unused for rects) */
+	uint32_t type;	/**< The cudaDrawType of the shape */
+};
+
+/**
+ * Render an array of shapes with a single kernel launch.
+ *
+ * The image is processed in tiles, and each tile only tests the shapes whose
+ * bounding box overlaps it.  The shapes are blended in the order they appear
+ * in the array, so later shapes are drawn on top of earlier ones.
+ *
+ * When `input` and `output` are different, the input is copied to the output
+ * as part of the same launch (instead of a separate full-frame memcpy).
+ *
+ * @param primitives array of shapes, which needs to be accessible from the GPU
+ *                   (i.e. device memory or mapped zero-copy memory).
+ * @param count the number of shapes in the primitives array.
+ * @ingroup drawing
+ */
+cudaError_t cudaDrawPrimitives( void* input, void* output, size_t width, size_t height, imageFormat format,
+						  const cudaDrawPrimitive* primitives, uint32_t count, cudaStream_t stream=NULL );
+
+/**
+ * Render an array of shapes with a single kernel launch.
+ * @see cudaDrawPrimitives()
+ * @ingroup drawing
+ */
+template<typename T> 
+cudaError_t cudaDrawPrimitives( T* input, T* output, size_t width, size_t height, 
+						  const cudaDrawPrimitive* primitives, uint32_t count, cudaStream_t stream=NULL )
+{
+	return cudaDrawPrimitives(input, output, width, height, imageFormatFromType<T>(), primitives, count, stream);
 }
 
+
+/**
+ * Batch of shapes that are accumulated on the CPU and then rendered together.
+ *
+ * Instead of launching a kernel (and potentially copying the frame) for each shape
+ * like cudaDrawCircle(), cudaDrawLine(), and cudaDrawRect() do, the shapes are
+ * added to the list and then uploaded and drawn at once with Draw(), so the
+ * overhead doesn't increase with the number of shapes.
+ *
+ * @code
+ * cudaDrawList list;
+ *
+ * for( int n=0; n < numObjects; n++ )
+ *     list.AddRect(left[n], top[n], right[n], bottom[n], fill_color, line_color, 2.0f);
+ *
+ * list.Draw(input, output, width, height, format);
+ * list.Clear();
+ * @endcode
+ *
+ * @ingroup drawing
+ */
+class cudaDrawList
+{
+public:
+	/**
+	 * Constructor
+	 */
+	cudaDrawList();
+
+	/**
+	 * Destructor
+	 */
+	~cudaDrawList();
+
+	/**
+	 * Add a circle to the list.
+	 */
+	void AddCircle( int cx, int cy, float radius, const float4& color );
+
+	/**
+	 * Add a line to the list.
+	 */
+	void AddLine( int x1, int y1, int x2, int y2, const float4& color, float line_width=1.0f );
+
+	/**
+	 * Add a rect to the list, with an optional filled color and outline.
+	 */
+	void AddRect( int left, int top, int right, int bottom, const float4& color,
+			    const float4& line_color=make_float4(0,0,0,0), float line_width=1.0f );
+
+	/**
+	 * Remove all of the shapes from the list.
+	 */
+	inline void Clear()								{ mPrimitives.clear(); }
+
+	/**
+	 * Get the number of shapes in the list.
+	 */
+	inline uint32_t GetCount() const					{ return mPrimitives.size(); }
+
+	/**
+	 * Get the shapes in the list (in CPU memory).
+	 */
+	inline const cudaDrawPrimitive* GetPrimitives() const	{ return mPrimitives.data(); }
+
+	/**
+	 * Upload the list to the GPU and render all of the shapes with one kernel launch.
+	 * The list isn't cleared afterwards, so it can be drawn again or added to.
+	 */
+	cudaError_t Draw( void* input, void* output, size_t width, size_t height, imageFormat format, cudaStream_t stream=NULL );
+
+	/**
+	 * Upload the list to the GPU and render all of the shapes with one kernel launch.
+	 */
+	template<typename T> cudaError_t Draw( T* input, T* output, size_t width, size_t height, cudaStream_t stream=NULL )
+	{
+		return Draw(input, output, width, height, imageFormatFromType<T>(), stream);
+	}
+
+	/**
+	 * Render all of the shapes in-place with one kernel launch.
+	 */
+	inline cudaError_t Draw( void* image, size_t width, size_t height, imageFormat format, cudaStream_t stream=NULL )
+	{
+		return Draw(image, image, width, height, format, stream);
+	}
+
+	/**
+	 * Render all of the shapes in-place with one kernel launch.
+	 */
+	template<typename T> cudaError_t Draw( T* image, size_t width, size_t height, cudaStream_t stream=NULL )
+	{
+		return Draw(image, image, width, height, imageFormatFromType<T>(), stream);
+	}
+
+protected:
+
+	std::vector<cudaDrawPrimitive> mPrimitives;
+
+	cudaDrawPrimitive* mDevicePrimitives;
+	uint32_t           mDeviceCapacity;
+};
+
 #endif
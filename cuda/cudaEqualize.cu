@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaEqualize.h"
+#include "cudaMemoryPool.h"
+
+#include "logging.h"
+#include "cudaNVTX.h"
+
+
+// the brightness is binned into 256 levels, with one thread per bin when building the mappings
+#define EQ_BINS 256
+
+// number of threads per block and maximum number of blocks used by the global histogram
+#define EQ_BLOCK_SIZE 256
+#define EQ_MAX_BLOCKS 1024
+
+
+// the brightness of a pixel, where the Order is 0 for RGB and YUYV/YVYU (luma first)
+// or 1 for BGR and UYVY (luma second), using the Rec. 601 weights for RGB
+template<int Order> inline __device__ float eqLuma( const uint8_t& px )	{ return px; }
+template<int Order> inline __device__ float eqLuma( const float& px )	{ return px; }
+template<int Order> inline __device__ float eqLuma( const uchar2& px )	{ return Order ? px.y : px.x; }
+
+template<int Order, typename T> inline __device__ float eqLumaRGB( const T& px )
+{
+	return Order ? (0.114f * px.x + 0.587f * px.y + 0.299f * px.z)
+			   : (0.299f * px.x + 0.587f * px.y + 0.114f * px.z);
+}
+
+template<int Order> inline __device__ float eqLuma( const uchar3& px )	{ return eqLumaRGB<Order>(px); }
+template<int Order> inline __device__ float eqLuma( const uchar4& px )	{ return eqLumaRGB<Order>(px); }
+template<int Order> inline __device__ float eqLuma( const float3& px )	{ return eqLumaRGB<Order>(px); }
+template<int Order> inline __device__ float eqLuma( const float4& px )	{ return eqLumaRGB<Order>(px); }
+
+
+// replace the brightness of a pixel (RGB gets the difference added to each channel,
+// which is the same as replacing Y in full-range YCbCr while keeping Cb and Cr)
+inline __device__ uint8_t eqClamp8( float v )		{ return (uint8_t)fminf(fmaxf(v + 0.5f, 0.0f), 255.0f); }
+inline __device__ float   eqClamp32( float v )	{ return fminf(fmaxf(v, 0.0f), 255.0f); }
+
+template<int Order> inline __device__ uint8_t eqStore( const uint8_t& px, float y, float v )	{ return eqClamp8(v); }
+template<int Order> inline __device__ float   eqStore( const float& px, float y, float v )	{ return v; }
+
+template<int Order> inline __device__ uchar2 eqStore( const uchar2& px, float y, float v )
+{
+	return Order ? make_uchar2(px.x, eqClamp8(v)) : make_uchar2(eqClamp8(v), px.y);
+}
+
+template<int Order> inline __device__ uchar3 eqStore( const uchar3& px, float y, float v )
+{
+	const float d = v - y;
+	return make_uchar3(eqClamp8(px.x + d), eqClamp8(px.y + d), eqClamp8(px.z + d));
+}
+
+template<int Order> inline __device__ uchar4 eqStore( const uchar4& px, float y, float v )
+{
+	const float d = v - y;
+	return make_uchar4(eqClamp8(px.x + d), eqClamp8(px.y + d), eqClamp8(px.z + d), px.w);
+}
+
+template<int Order> inline __device__ float3 eqStore( const float3& px, float y, float v )
+{
+	const float d = v - y;
+	return make_float3(eqClamp32(px.x + d), eqClamp32(px.y + d), eqClamp32(px.z + d));
+}
+
+template<int Order> inline __device__ float4 eqStore( const float4& px, float y, float v )
+{
+	const float d = v - y;
+	return make_float4(eqClamp32(px.x + d), eqClamp32(px.y + d), eqClamp32(px.z + d), px.w);
+}
+
+
+// the histogram bin of a brightness value
+inline __device__ int eqBin( float y )
+{
+	return max(0, min(int(y), EQ_BINS - 1));
+}
+
+// look up a brightness value in a mapping (the float formats are interpolated between the bins)
+inline __device__ float eqLookup( const float* lut, float y )
+{
+	y = fminf(fmaxf(y, 0.0f), float(EQ_BINS - 1));
+
+	const int   i = int(y);
+	const float f = y - i;
+
+	return (f > 0.0f) ? lut[i] + (lut[i+1] - lut[i]) * f : lut[i];
+}
+
+
+// turn a histogram in shared memory into an equalization mapping (one thread per bin).
+// if clipLimit > 0, the bins are clipped and the excess gets redistributed evenly.
+// if subtractMin is true, the mapping is stretched so that the darkest level maps to 0.
+inline __device__ void eqBuildLUT( uint32_t* hist, uint32_t numPixels, float clipLimit, bool subtractMin, float* lut )
+{
+	__shared__ uint32_t excess;
+	__shared__ uint32_t cdfMin;
+
+	const int t = threadIdx.x;
+
+	if( t == 0 )
+	{
+		excess = 0;
+		cdfMin = numPixels;
+	}
+
+	__syncthreads();
+
+	uint32_t count = hist[t];
+
+	if( clipLimit > 0.0f )
+	{
+		const uint32_t limit = max(uint32_t(clipLimit * numPixels / EQ_BINS), 1u);
+
+		if( count > limit )
+		{
+			atomicAdd(&excess, count - limit);
+			count = limit;
+		}
+
+		__syncthreads();
+
+		const uint32_t clipped = excess;
+		count += clipped / EQ_BINS + ((t < clipped % EQ_BINS) ? 1 : 0);
+	}
+
+	hist[t] = count;
+	__syncthreads();
+
+	// inclusive prefix sum for the cumulative distribution
+	for( int offset=1; offset < EQ_BINS; offset *= 2 )
+	{
+		const uint32_t prev = (t >= offset) ? hist[t - offset] : 0;
+		__syncthreads();
+		hist[t] += prev;
+		__syncthreads();
+	}
+
+	const uint32_t cdf = hist[t];
+
+	if( subtractMin )
+	{
+		if( cdf > 0 )
+			atomicMin(&cdfMin, cdf);
+
+		__syncthreads();
+	}
+
+	const uint32_t base = subtractMin ? cdfMin : 0;
+
+	if( numPixels > base )
+		lut[t] = fmaxf(float(cdf) - float(base), 0.0f) * float(EQ_BINS - 1) / float(numPixels - base);
+	else
+		lut[t] = t;	// the image is a single level, so leave it as-is
+}
+
+
+//-----------------------------------------------------------------------------------
+// mappings
+//-----------------------------------------------------------------------------------
+
+// gpuEqualizeHistogram (global histogram of the whole image)
+template<typename T, int Order>
+__global__ void gpuEqualizeHistogram( T* input, int numPixels, uint32_t* histogram )
+{
+	__shared__ uint32_t sharedHist[EQ_BINS];
+
+	for( int n=threadIdx.x; n < EQ_BINS; n += blockDim.x )
+		sharedHist[n] = 0;
+
+	__syncthreads();
+
+	for( int n=blockIdx.x * blockDim.x + threadIdx.x; n < numPixels; n += blockDim.x * gridDim.x )
+		atomicAdd(&sharedHist[eqBin(eqLuma<Order>(input[n]))], 1u);
+
+	__syncthreads();
+
+	for( int n=threadIdx.x; n < EQ_BINS; n += blockDim.x )
+	{
+		if( sharedHist[n] > 0 )
+			atomicAdd(&histogram[n], sharedHist[n]);
+	}
+}
+
+// gpuEqualizeLUT (the mapping of the global histogram)
+__global__ void gpuEqualizeLUT( const uint32_t* histogram, uint32_t numPixels, float* lut )
+{
+	__shared__ uint32_t hist[EQ_BINS];
+
+	hist[threadIdx.x] = histogram[threadIdx.x];
+	__syncthreads();
+
+	eqBuildLUT(hist, numPixels, 0.0f, true, lut);
+}
+
+// gpuClaheLUT (one block per tile)
+template<typename T, int Order>
+__global__ void gpuClaheLUT( T* input, int width, int height, int tileWidth, int tileHeight, float clipLimit, float* luts )
+{
+	__shared__ uint32_t hist[EQ_BINS];
+
+	hist[threadIdx.x] = 0;
+	__syncthreads();
+
+	const int x0 = blockIdx.x * tileWidth;
+	const int y0 = blockIdx.y * tileHeight;
+
+	// the tiles along the right and bottom edges can be partial (or empty)
+	const int tw = max(min(tileWidth, width - x0), 0);
+	const int th = max(min(tileHeight, height - y0), 0);
+
+	const int numPixels = tw * th;
+
+	for( int n=threadIdx.x; n < numPixels; n += blockDim.x )
+	{
+		const int x = x0 + n % tw;
+		const int y = y0 + n / tw;
+
+		atomicAdd(&hist[eqBin(eqLuma<Order>(input[y * width + x]))], 1u);
+	}
+
+	__syncthreads();
+
+	eqBuildLUT(hist, numPixels, clipLimit, false, luts + (blockIdx.y * gridDim.x + blockIdx.x) * EQ_BINS);
+}
+
+
+//-----------------------------------------------------------------------------------
+// remapping
+//-----------------------------------------------------------------------------------
+
+// gpuEqualizeApply (bilinear interpolation between the mappings of the 4 nearest tile centers)
+template<typename T, int Order>
+__global__ void gpuEqualizeApply( T* input, T* output, int width, int height, const float* luts, 
+						    int tilesX, int tilesY, float tileWidth, float tileHeight )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const T px = input[y * width + x];
+	const float luma = eqLuma<Order>(px);
+
+	const float tx = (x + 0.5f) / tileWidth - 0.5f;
+	const float ty = (y + 0.5f) / tileHeight - 0.5f;
+
+	const float fx = floorf(tx);
+	const float fy = floorf(ty);
+
+	const int tx0 = max(int(fx), 0);
+	const int ty0 = max(int(fy), 0);
+	const int tx1 = min(int(fx) + 1, tilesX - 1);
+	const int ty1 = min(int(fy) + 1, tilesY - 1);
+
+	const float ax = tx - fx;
+	const float ay = ty - fy;
+
+	const float v00 = eqLookup(luts + (ty0 * tilesX + tx0) * EQ_BINS, luma);
+	const float v01 = eqLookup(luts + (ty0 * tilesX + tx1) * EQ_BINS, luma);
+	const float v10 = eqLookup(luts + (ty1 * tilesX + tx0) * EQ_BINS, luma);
+	const float v11 = eqLookup(luts + (ty1 * tilesX + tx1) * EQ_BINS, luma);
+
+	const float v = (v00 * (1.0f - ax) + v01 * ax) * (1.0f - ay) 
+			    + (v10 * (1.0f - ax) + v11 * ax) * ay;
+
+	output[y * width + x] = eqStore<Order>(px, luma, v);
+}
+
+
+// launchEqualize (tilesX == 0 for global equalization)
+template<typename T, int Order>
+static cudaError_t launchEqualize( T* input, T* output, size_t width, size_t height, 
+							int tilesX, int tilesY, float clipLimit, cudaStream_t stream )
+{
+	const bool adaptive = (tilesX > 0);
+
+	if( !adaptive )
+	{
+		tilesX = 1;
+		tilesY = 1;
+	}
+
+	const size_t numLUTs = tilesX * tilesY;
+	float* luts = NULL;
+
+	if( !cudaMallocPooled((void**)&luts, numLUTs * EQ_BINS * sizeof(float) + EQ_BINS * sizeof(uint32_t)) )
+		return cudaErrorMemoryAllocation;
+
+	const int tileWidth  = iDivUp(width, tilesX);
+	const int tileHeight = iDivUp(height, tilesY);
+
+	if( adaptive )
+	{
+		gpuClaheLUT<T, Order><<<dim3(tilesX, tilesY), EQ_BINS, 0, stream>>>(input, width, height, tileWidth, tileHeight, clipLimit, luts);
+	}
+	else
+	{
+		const size_t numPixels = width * height;
+		uint32_t* histogram = (uint32_t*)(luts + EQ_BINS);
+
+		CUDA(cudaMemsetAsync(histogram, 0, EQ_BINS * sizeof(uint32_t), stream));
+
+		const int blocks = iDivUp(numPixels, EQ_BLOCK_SIZE);
+
+		gpuEqualizeHistogram<T, Order><<<(blocks < EQ_MAX_BLOCKS) ? blocks : EQ_MAX_BLOCKS, EQ_BLOCK_SIZE, 0, stream>>>(input, numPixels, histogram);
+		gpuEqualizeLUT<<<1, EQ_BINS, 0, stream>>>(histogram, numPixels, luts);
+	}
+
+	const dim3 blockDim(32, 8);
+	const dim3 gridDim(iDivUp(width, blockDim.x), iDivUp(height, blockDim.y));
+
+	gpuEqualizeApply<T, Order><<<gridDim, blockDim, 0, stream>>>(input, output, width, height, luts, 
+											    tilesX, tilesY, tileWidth, tileHeight);
+
+	// the pool doesn't hand the block out again until the kernels are done with it
+	cudaFreePooled(luts, stream);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// dispatchEqualize
+static cudaError_t dispatchEqualize( void* input, void* output, size_t width, size_t height, imageFormat format,
+							  int tilesX, int tilesY, float clipLimit, cudaStream_t stream, const char* name )
+{
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( format == IMAGE_GRAY8 )
+		return launchEqualize<uint8_t, 0>((uint8_t*)input, (uint8_t*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_GRAY32F )
+		return launchEqualize<float, 0>((float*)input, (float*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_RGB8 )
+		return launchEqualize<uchar3, 0>((uchar3*)input, (uchar3*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_BGR8 )
+		return launchEqualize<uchar3, 1>((uchar3*)input, (uchar3*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_RGBA8 )
+		return launchEqualize<uchar4, 0>((uchar4*)input, (uchar4*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_BGRA8 )
+		return launchEqualize<uchar4, 1>((uchar4*)input, (uchar4*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_RGB32F )
+		return launchEqualize<float3, 0>((float3*)input, (float3*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_BGR32F )
+		return launchEqualize<float3, 1>((float3*)input, (float3*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_RGBA32F )
+		return launchEqualize<float4, 0>((float4*)input, (float4*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_BGRA32F )
+		return launchEqualize<float4, 1>((float4*)input, (float4*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_YUYV || format == IMAGE_YVYU )
+		return launchEqualize<uchar2, 0>((uchar2*)input, (uchar2*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_UYVY )
+		return launchEqualize<uchar2, 1>((uchar2*)input, (uchar2*)output, width, height, tilesX, tilesY, clipLimit, stream);
+	else if( format == IMAGE_I420 || format == IMAGE_YV12 || format == IMAGE_NV12 )
+	{
+		// the Y plane comes first and is equalized like gray8, and the chroma planes are copied
+		const cudaError_t result = launchEqualize<uint8_t, 0>((uint8_t*)input, (uint8_t*)output, width, height, tilesX, tilesY, clipLimit, stream);
+
+		if( result != cudaSuccess || input == output )
+			return result;
+
+		const size_t lumaSize = width * height;
+
+		return CUDA(cudaMemcpyAsync((uint8_t*)output + lumaSize, (uint8_t*)input + lumaSize, 
+							   imageFormatSize(format, width, height) - lumaSize, 
+							   cudaMemcpyDeviceToDevice, stream));
+	}
+
+	imageFormatErrorMsg(LOG_CUDA, name, format);
+	return cudaErrorInvalidValue;
+}
+
+
+// cudaEqualizeHistogram
+cudaError_t cudaEqualizeHistogram( void* input, void* output, size_t width, size_t height, imageFormat format, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaEqualizeHistogram");
+	return dispatchEqualize(input, output, width, height, format, 0, 0, 0.0f, stream, "cudaEqualizeHistogram()");
+}
+
+
+// cudaCLAHE
+cudaError_t cudaCLAHE( void* input, void* output, size_t width, size_t height, imageFormat format,
+				   float clipLimit, const int2& tiles, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaCLAHE");
+
+	if( tiles.x <= 0 || tiles.y <= 0 || tiles.x > CUDA_CLAHE_MAX_TILES || tiles.y > CUDA_CLAHE_MAX_TILES )
+	{
+		LogError(LOG_CUDA "cudaCLAHE() -- the number of tiles must be between 1 and %i (was %ix%i)\n", CUDA_CLAHE_MAX_TILES, tiles.x, tiles.y);
+		return cudaErrorInvalidValue;
+	}
+
+	if( (size_t)tiles.x > width || (size_t)tiles.y > height )
+	{
+		LogError(LOG_CUDA "cudaCLAHE() -- there are more tiles (%ix%i) than pixels (%zux%zu)\n", tiles.x, tiles.y, width, height);
+		return cudaErrorInvalidValue;
+	}
+
+	if( clipLimit < 0.0f )
+	{
+		LogError(LOG_CUDA "cudaCLAHE() -- the clip limit can't be negative (was %f)\n", clipLimit);
+		return cudaErrorInvalidValue;
+	}
+
+	return dispatchEqualize(input, output, width, height, format, tiles.x, tiles.y, clipLimit, stream, "cudaCLAHE()");
+}
+
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_EQUALIZE_H__
+#define __CUDA_EQUALIZE_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * Contrast enhancement with histogram equalization, either globally over the whole
+ * image with cudaEqualizeHistogram(), or locally with CLAHE (contrast-limited adaptive
+ * histogram equalization) using cudaCLAHE().
+ *
+ * Only the brightness is equalized:  gray8 and gray32f images are equalized directly,
+ * RGB/BGR images have their luma (Rec. 601 weights) equalized and the difference added
+ * back to each channel so that the chroma is unchanged, and YUV images have their Y
+ * channel equalized (the chroma is copied).  The float formats are expected to be in
+ * the range 0-255.
+ *
+ * The supported formats are gray8, gray32f, rgb8, rgba8, rgb32f, rgba32f (and BGR),
+ * yuyv, yvyu, uyvy, i420, yv12, and nv12.  The input and output can be the same image.
+ *
+ * @defgroup equalize Histogram Equalization
+ * @ingroup cuda
+ */
+
+/**
+ * The maximum number of CLAHE tiles in each dimension.
+ * @ingroup equalize
+ */
+#define CUDA_CLAHE_MAX_TILES 64
+
+
+/**
+ * Equalize the histogram of an image's brightness over the whole image.
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ * @ingroup equalize
+ */
+cudaError_t cudaEqualizeHistogram( void* input, void* output, size_t width, size_t height, imageFormat format, cudaStream_t stream=NULL );
+
+/**
+ * Equalize the histogram of an image's brightness over the whole image.
+ * @ingroup equalize
+ */
+template<typename T> cudaError_t cudaEqualizeHistogram( T* input, T* output, size_t width, size_t height, cudaStream_t stream=NULL )
+{
+	return cudaEqualizeHistogram((void*)input, (void*)output, width, height, imageFormatFromType<T>(), stream);
+}
+
+/**
+ * Contrast-limited adaptive histogram equalization (CLAHE).
+ *
+ * The image is divided into a grid of tiles, and each tile gets its own equalization
+ * mapping from its histogram (computed in shared memory, one thread block per tile).
+ * The histogram bins are clipped at `clipLimit` times the average bin count, and the
+ * clipped counts get redistributed over all of the bins, which limits the amplification
+ * of noise in flat regions.  Each pixel is then mapped by bilinearly interpolating
+ * the mappings of the four nearest tiles, so that there aren't any seams between them.
+ *
+ * @param clipLimit the clip limit, relative to the average bin count (2-4 is typical,
+ *                  and 0 disables the clipping for plain adaptive equalization).
+ * @param tiles the number of tiles horizontally and vertically (up to CUDA_CLAHE_MAX_TILES).
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ * @ingroup equalize
+ */
+cudaError_t cudaCLAHE( void* input, void* output, size_t width, size_t height, imageFormat format,
+				   float clipLimit=2.0f, const int2& tiles=make_int2(8,8), cudaStream_t stream=NULL );
+
+/**
+ * Contrast-limited adaptive histogram equalization (CLAHE).
+ * @ingroup equalize
+ */
+template<typename T> cudaError_t cudaCLAHE( T* input, T* output, size_t width, size_t height, float clipLimit=2.0f,
+								    const int2& tiles=make_int2(8,8), cudaStream_t stream=NULL )
+{
+	return cudaCLAHE((void*)input, (void*)output, width, height, imageFormatFromType<T>(), clipLimit, tiles, stream);
+}
+
+
+#endif
+
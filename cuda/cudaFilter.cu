@@ -0,0 +1,612 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaFilter.h"
+#include "cudaFilterMode.cuh"
+#include "cudaMemoryPool.h"
+#include "cudaNVTX.h"
+
+
+#define FILTER_TILE     16							// output pixels per block side
+#define FILTER_TAPS     (CUDA_FILTER_MAX_RADIUS * 2 + 1)	// maximum taps per dimension
+#define FILTER_APRON    (FILTER_TILE + CUDA_FILTER_MAX_RADIUS * 2)	// tile size including the halo
+#define BOX_SEGMENT     64							// pixels per thread of the running sums
+
+
+// the taps of a separable kernel (passed by value, so that the launches on different streams don't share them)
+struct filterTaps
+{
+	float w[FILTER_TAPS];
+};
+
+// the offsets of a structuring element
+struct filterElement
+{
+	char2 offsets[FILTER_TAPS * FILTER_TAPS];
+	int count;
+};
+
+
+// dispatch the launch function by format
+#define FILTER_DISPATCH(func, name, ...) \
+	if( format == IMAGE_GRAY8 ) \
+		return func<uint8_t>(__VA_ARGS__); \
+	else if( format == IMAGE_GRAY32F ) \
+		return func<float>(__VA_ARGS__); \
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 ) \
+		return func<uchar3>(__VA_ARGS__); \
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 ) \
+		return func<uchar4>(__VA_ARGS__); \
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F ) \
+		return func<float3>(__VA_ARGS__); \
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F ) \
+		return func<float4>(__VA_ARGS__); \
+	imageFormatErrorMsg(LOG_CUDA, name, format); \
+	return cudaErrorInvalidValue;
+
+
+// check the arguments that all of the filters have in common
+static cudaError_t checkFilterArgs( void* input, void* output, size_t width, size_t height, const char* name )
+{
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( input == output )
+	{
+		LogError(LOG_CUDA "%s -- the input and output can't be the same image\n", name);
+		return cudaErrorInvalidValue;
+	}
+
+	return cudaSuccess;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// separable convolution
+//////////////////////////////////////////////////////////////////////////////////
+
+// gpuConvolveSeparable
+template<typename T>
+__global__ void gpuConvolveSeparable( T* input, T* output, int width, int height, filterTaps kx, filterTaps ky, int radius )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	__shared__ A rows[FILTER_APRON][FILTER_TILE];
+
+	const int x  = blockIdx.x * FILTER_TILE + threadIdx.x;
+	const int y  = blockIdx.y * FILTER_TILE + threadIdx.y;
+	const int xc = min(x, width - 1);
+	const int y0 = blockIdx.y * FILTER_TILE - radius;
+
+	// filter the rows of the tile (and of the halo above and below it) horizontally
+	for( int r=threadIdx.y; r < FILTER_TILE + radius * 2; r += FILTER_TILE )
+	{
+		const T* row = input + clamp(y0 + r, 0, height - 1) * width;
+		A sum = A();
+
+		for( int i=-radius; i <= radius; i++ )
+			sum += cudaFilterAccum<T>::load(row[clamp(xc + i, 0, width - 1)]) * kx.w[i + radius];
+
+		rows[r][threadIdx.x] = sum;
+	}
+
+	__syncthreads();
+
+	if( x >= width || y >= height )
+		return;
+
+	// filter the columns vertically
+	A sum = A();
+
+	for( int j=0; j <= radius * 2; j++ )
+		sum += rows[threadIdx.y + j][threadIdx.x] * ky.w[j];
+
+	output[y * width + x] = cudaFilterAccum<T>::store(cudaFilterAccum<T>::saturate(sum));
+}
+
+// launchConvolveSeparable
+template<typename T>
+static cudaError_t launchConvolveSeparable( void* input, void* output, size_t width, size_t height, const filterTaps& kx, const filterTaps& ky, int radius, cudaStream_t stream )
+{
+	const dim3 blockDim(FILTER_TILE, FILTER_TILE);
+	const dim3 gridDim(iDivUp(width, FILTER_TILE), iDivUp(height, FILTER_TILE));
+
+	gpuConvolveSeparable<T><<<gridDim, blockDim, 0, stream>>>((T*)input, (T*)output, width, height, kx, ky, radius);
+
+	return CUDA(cudaGetLastError());
+}
+
+// convolveSeparable
+static cudaError_t convolveSeparable( void* input, void* output, size_t width, size_t height, imageFormat format,
+							   const filterTaps& kx, const filterTaps& ky, int radius, cudaStream_t stream, const char* name )
+{
+	const cudaError_t result = checkFilterArgs(input, output, width, height, name);
+
+	if( result != cudaSuccess )
+		return result;
+
+	if( radius < 0 || radius > CUDA_FILTER_MAX_RADIUS )
+	{
+		LogError(LOG_CUDA "%s -- invalid radius %i (the maximum is %i)\n", name, radius, CUDA_FILTER_MAX_RADIUS);
+		return cudaErrorInvalidValue;
+	}
+
+	FILTER_DISPATCH(launchConvolveSeparable, name, input, output, width, height, kx, ky, radius, stream);
+}
+
+// cudaConvolveSeparable
+cudaError_t cudaConvolveSeparable( void* input, void* output, size_t width, size_t height, imageFormat format,
+						     const float* kernelX, const float* kernelY, int radius, cudaStream_t stream )
+{
+	if( !kernelX || !kernelY )
+		return cudaErrorInvalidValue;
+
+	if( radius < 0 || radius > CUDA_FILTER_MAX_RADIUS )
+	{
+		LogError(LOG_CUDA "cudaConvolveSeparable() -- invalid radius %i (the maximum is %i)\n", radius, CUDA_FILTER_MAX_RADIUS);
+		return cudaErrorInvalidValue;
+	}
+
+	filterTaps kx;
+	filterTaps ky;
+
+	for( int n=0; n <= radius * 2; n++ )
+	{
+		kx.w[n] = kernelX[n];
+		ky.w[n] = kernelY[n];
+	}
+
+	NVTX_RANGE("cudaConvolveSeparable");
+	return convolveSeparable(input, output, width, height, format, kx, ky, radius, stream, "cudaConvolveSeparable()");
+}
+
+// cudaGaussianBlur
+cudaError_t cudaGaussianBlur( void* input, void* output, size_t width, size_t height, imageFormat format,
+					     float sigma, int radius, cudaStream_t stream )
+{
+	if( sigma <= 0.0f )
+	{
+		LogError(LOG_CUDA "cudaGaussianBlur() -- invalid sigma %f (it should be positive)\n", sigma);
+		return cudaErrorInvalidValue;
+	}
+
+	if( radius <= 0 )
+		radius = min((int)ceilf(sigma * 3.0f), CUDA_FILTER_MAX_RADIUS);
+
+	if( radius > CUDA_FILTER_MAX_RADIUS )
+	{
+		LogError(LOG_CUDA "cudaGaussianBlur() -- invalid radius %i (the maximum is %i)\n", radius, CUDA_FILTER_MAX_RADIUS);
+		return cudaErrorInvalidValue;
+	}
+
+	// normalized Gaussian taps
+	filterTaps taps;
+	float sum = 0.0f;
+
+	for( int n=-radius; n <= radius; n++ )
+	{
+		taps.w[n + radius] = expf(-(n * n) / (2.0f * sigma * sigma));
+		sum += taps.w[n + radius];
+	}
+
+	for( int n=0; n <= radius * 2; n++ )
+		taps.w[n] /= sum;
+
+	NVTX_RANGE("cudaGaussianBlur");
+	return convolveSeparable(input, output, width, height, format, taps, taps, radius, stream, "cudaGaussianBlur()");
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// box filter (running sums)
+//////////////////////////////////////////////////////////////////////////////////
+
+// gpuBoxRows (each thread slides the window along a segment of a row)
+template<typename T>
+__global__ void gpuBoxRows( T* input, typename cudaFilterAccum<T>::Type* output, int width, int height, int radius )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	const int x0 = (blockIdx.x * blockDim.x + threadIdx.x) * BOX_SEGMENT;
+	const int y  = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x0 >= width || y >= height )
+		return;
+
+	const T* row = input + y * width;
+	A* out = output + y * width;
+
+	A sum = A();
+
+	for( int i=-radius; i <= radius; i++ )
+		sum += cudaFilterAccum<T>::load(row[clamp(x0 + i, 0, width - 1)]);
+
+	const int x1 = min(x0 + BOX_SEGMENT, width);
+
+	for( int x=x0; x < x1; x++ )
+	{
+		out[x] = sum;
+		sum += cudaFilterAccum<T>::load(row[min(x + radius + 1, width - 1)]) - cudaFilterAccum<T>::load(row[max(x - radius, 0)]);
+	}
+}
+
+// gpuBoxCols (each thread slides the window down a segment of a column)
+template<typename T>
+__global__ void gpuBoxCols( typename cudaFilterAccum<T>::Type* input, T* output, int width, int height, int radius, float scale )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	const int x  = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y0 = (blockIdx.y * blockDim.y + threadIdx.y) * BOX_SEGMENT;
+
+	if( x >= width || y0 >= height )
+		return;
+
+	A sum = A();
+
+	for( int j=-radius; j <= radius; j++ )
+		sum += input[clamp(y0 + j, 0, height - 1) * width + x];
+
+	const int y1 = min(y0 + BOX_SEGMENT, height);
+
+	for( int y=y0; y < y1; y++ )
+	{
+		output[y * width + x] = cudaFilterAccum<T>::store(cudaFilterAccum<T>::saturate(sum * scale));
+		sum += input[min(y + radius + 1, height - 1) * width + x] - input[max(y - radius, 0) * width + x];
+	}
+}
+
+// launchBoxFilter
+template<typename T>
+static cudaError_t launchBoxFilter( void* input, void* output, size_t width, size_t height, int radius, cudaStream_t stream )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	// the horizontal sums are kept at full precision
+	A* sums = NULL;
+
+	if( !cudaMallocPooled((void**)&sums, width * height * sizeof(A)) )
+		return cudaErrorMemoryAllocation;
+
+	const dim3 rowBlock(8, 32);
+	const dim3 rowGrid(iDivUp(iDivUp(width, BOX_SEGMENT), rowBlock.x), iDivUp(height, rowBlock.y));
+
+	gpuBoxRows<T><<<rowGrid, rowBlock, 0, stream>>>((T*)input, sums, width, height, radius);
+
+	const dim3 colBlock(32, 4);
+	const dim3 colGrid(iDivUp(width, colBlock.x), iDivUp(iDivUp(height, BOX_SEGMENT), colBlock.y));
+
+	const float scale = 1.0f / ((radius * 2 + 1) * (radius * 2 + 1));
+
+	gpuBoxCols<T><<<colGrid, colBlock, 0, stream>>>(sums, (T*)output, width, height, radius, scale);
+
+	// the pool doesn't hand the block out again until the kernels are done with it
+	cudaFreePooled(sums, stream);
+
+	return CUDA(cudaGetLastError());
+}
+
+// cudaBoxFilter
+cudaError_t cudaBoxFilter( void* input, void* output, size_t width, size_t height, imageFormat format,
+					  int radius, cudaStream_t stream )
+{
+	const cudaError_t result = checkFilterArgs(input, output, width, height, "cudaBoxFilter()");
+
+	if( result != cudaSuccess )
+		return result;
+
+	if( radius < 0 )
+		return cudaErrorInvalidValue;
+
+	NVTX_RANGE("cudaBoxFilter");
+	FILTER_DISPATCH(launchBoxFilter, "cudaBoxFilter()", input, output, width, height, radius, stream);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// gradients
+//////////////////////////////////////////////////////////////////////////////////
+
+// gpuGradient (3x3 derivative operator, smoothed with [a b a] across the derivative)
+template<typename T>
+__global__ void gpuGradient( T* input, typename cudaFilterAccum<T>::Type* dx, typename cudaFilterAccum<T>::Type* dy,
+					    int width, int height, float a, float b )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	__shared__ A tile[FILTER_TILE + 2][FILTER_TILE + 2];
+
+	const int x0 = blockIdx.x * FILTER_TILE - 1;
+	const int y0 = blockIdx.y * FILTER_TILE - 1;
+
+	for( int n=threadIdx.y * FILTER_TILE + threadIdx.x; n < (FILTER_TILE + 2) * (FILTER_TILE + 2); n += FILTER_TILE * FILTER_TILE )
+	{
+		const int r = n / (FILTER_TILE + 2);
+		const int c = n % (FILTER_TILE + 2);
+
+		tile[r][c] = cudaFilterAccum<T>::load(input[clamp(y0 + r, 0, height - 1) * width + clamp(x0 + c, 0, width - 1)]);
+	}
+
+	__syncthreads();
+
+	const int x = blockIdx.x * FILTER_TILE + threadIdx.x;
+	const int y = blockIdx.y * FILTER_TILE + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const int c = threadIdx.x + 1;
+	const int r = threadIdx.y + 1;
+
+	if( dx != NULL )
+	{
+		dx[y * width + x] = (tile[r-1][c+1] - tile[r-1][c-1]) * a
+					   + (tile[r][c+1]   - tile[r][c-1])   * b
+					   + (tile[r+1][c+1] - tile[r+1][c-1]) * a;
+	}
+
+	if( dy != NULL )
+	{
+		dy[y * width + x] = (tile[r+1][c-1] - tile[r-1][c-1]) * a
+					   + (tile[r+1][c]   - tile[r-1][c])   * b
+					   + (tile[r+1][c+1] - tile[r-1][c+1]) * a;
+	}
+}
+
+// launchGradient
+template<typename T>
+static cudaError_t launchGradient( void* input, void* dx, void* dy, size_t width, size_t height, float a, float b, cudaStream_t stream )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	const dim3 blockDim(FILTER_TILE, FILTER_TILE);
+	const dim3 gridDim(iDivUp(width, FILTER_TILE), iDivUp(height, FILTER_TILE));
+
+	gpuGradient<T><<<gridDim, blockDim, 0, stream>>>((T*)input, (A*)dx, (A*)dy, width, height, a, b);
+
+	return CUDA(cudaGetLastError());
+}
+
+// cudaGradient
+cudaError_t cudaGradient( void* input, imageFormat format, void* dx, void* dy, size_t width, size_t height,
+					 cudaGradientType type, cudaStream_t stream )
+{
+	if( !input || (!dx && !dy) )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const float a = (type == GRADIENT_SCHARR) ? 3.0f : 1.0f;
+	const float b = (type == GRADIENT_SCHARR) ? 10.0f : 2.0f;
+
+	NVTX_RANGE("cudaGradient");
+	FILTER_DISPATCH(launchGradient, "cudaGradient()", input, dx, dy, width, height, a, b, stream);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// morphology
+//////////////////////////////////////////////////////////////////////////////////
+
+// morphology operators (erode = min, dilate = max)
+template<bool dilate> struct morphOp;
+
+template<> struct morphOp<false>
+{
+	template<typename A> static __device__ inline A apply( const A& a, const A& b )	{ return fminf(a, b); }
+};
+
+template<> struct morphOp<true>
+{
+	template<typename A> static __device__ inline A apply( const A& a, const A& b )	{ return fmaxf(a, b); }
+};
+
+// gpuMorphologyRect (separable rectangular element)
+template<typename T, bool dilate>
+__global__ void gpuMorphologyRect( T* input, T* output, int width, int height, int rx, int ry )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	__shared__ A rows[FILTER_APRON][FILTER_TILE];
+
+	const int x  = blockIdx.x * FILTER_TILE + threadIdx.x;
+	const int y  = blockIdx.y * FILTER_TILE + threadIdx.y;
+	const int xc = min(x, width - 1);
+	const int y0 = blockIdx.y * FILTER_TILE - ry;
+
+	for( int r=threadIdx.y; r < FILTER_TILE + ry * 2; r += FILTER_TILE )
+	{
+		const T* row = input + clamp(y0 + r, 0, height - 1) * width;
+		A v = cudaFilterAccum<T>::load(row[clamp(xc - rx, 0, width - 1)]);
+
+		for( int i=-rx+1; i <= rx; i++ )
+			v = morphOp<dilate>::apply(v, cudaFilterAccum<T>::load(row[clamp(xc + i, 0, width - 1)]));
+
+		rows[r][threadIdx.x] = v;
+	}
+
+	__syncthreads();
+
+	if( x >= width || y >= height )
+		return;
+
+	A v = rows[threadIdx.y][threadIdx.x];
+
+	for( int j=1; j <= ry * 2; j++ )
+		v = morphOp<dilate>::apply(v, rows[threadIdx.y + j][threadIdx.x]);
+
+	output[y * width + x] = cudaFilterAccum<T>::store(v);
+}
+
+// gpuMorphology (arbitrary element, from a tile of the input in shared memory)
+template<typename T, bool dilate>
+__global__ void gpuMorphology( T* input, T* output, int width, int height, int rx, int ry, filterElement element )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	__shared__ T tile[FILTER_APRON][FILTER_APRON];
+
+	const int tileWidth  = FILTER_TILE + rx * 2;
+	const int tileHeight = FILTER_TILE + ry * 2;
+
+	const int x0 = blockIdx.x * FILTER_TILE - rx;
+	const int y0 = blockIdx.y * FILTER_TILE - ry;
+
+	for( int n=threadIdx.y * FILTER_TILE + threadIdx.x; n < tileWidth * tileHeight; n += FILTER_TILE * FILTER_TILE )
+	{
+		const int r = n / tileWidth;
+		const int c = n % tileWidth;
+
+		tile[r][c] = input[clamp(y0 + r, 0, height - 1) * width + clamp(x0 + c, 0, width - 1)];
+	}
+
+	__syncthreads();
+
+	const int x = blockIdx.x * FILTER_TILE + threadIdx.x;
+	const int y = blockIdx.y * FILTER_TILE + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const int c = threadIdx.x + rx;
+	const int r = threadIdx.y + ry;
+
+	A v = cudaFilterAccum<T>::load(tile[r + element.offsets[0].y][c + element.offsets[0].x]);
+
+	for( int n=1; n < element.count; n++ )
+		v = morphOp<dilate>::apply(v, cudaFilterAccum<T>::load(tile[r + element.offsets[n].y][c + element.offsets[n].x]));
+
+	output[y * width + x] = cudaFilterAccum<T>::store(v);
+}
+
+// launchMorphology
+template<typename T>
+static cudaError_t launchMorphology( void* input, void* output, size_t width, size_t height, bool dilate,
+							  int rx, int ry, const filterElement* element, cudaStream_t stream )
+{
+	const dim3 blockDim(FILTER_TILE, FILTER_TILE);
+	const dim3 gridDim(iDivUp(width, FILTER_TILE), iDivUp(height, FILTER_TILE));
+
+	if( !element )
+	{
+		if( dilate )
+			gpuMorphologyRect<T, true><<<gridDim, blockDim, 0, stream>>>((T*)input, (T*)output, width, height, rx, ry);
+		else
+			gpuMorphologyRect<T, false><<<gridDim, blockDim, 0, stream>>>((T*)input, (T*)output, width, height, rx, ry);
+	}
+	else
+	{
+		if( dilate )
+			gpuMorphology<T, true><<<gridDim, blockDim, 0, stream>>>((T*)input, (T*)output, width, height, rx, ry, *element);
+		else
+			gpuMorphology<T, false><<<gridDim, blockDim, 0, stream>>>((T*)input, (T*)output, width, height, rx, ry, *element);
+	}
+
+	return CUDA(cudaGetLastError());
+}
+
+// morphology
+static cudaError_t morphology( void* input, void* output, size_t width, size_t height, imageFormat format, bool dilate,
+						 const uint8_t* mask, int maskWidth, int maskHeight, cudaStream_t stream, const char* name )
+{
+	const cudaError_t result = checkFilterArgs(input, output, width, height, name);
+
+	if( result != cudaSuccess )
+		return result;
+
+	if( maskWidth <= 0 || maskHeight <= 0 || maskWidth > FILTER_TAPS || maskHeight > FILTER_TAPS )
+	{
+		LogError(LOG_CUDA "%s -- invalid structuring element size %ix%i (the maximum is %ix%i)\n", name, maskWidth, maskHeight, FILTER_TAPS, FILTER_TAPS);
+		return cudaErrorInvalidValue;
+	}
+
+	const int rx = maskWidth / 2;
+	const int ry = maskHeight / 2;
+
+	// collect the offsets of the element (if it isn't a full rectangle)
+	filterElement element;
+	element.count = 0;
+
+	if( mask != NULL )
+	{
+		for( int y=0; y < maskHeight; y++ )
+		{
+			for( int x=0; x < maskWidth; x++ )
+			{
+				if( mask[y * maskWidth + x] != 0 )
+					element.offsets[element.count++] = make_char2(x - rx, y - ry);
+			}
+		}
+
+		if( element.count == 0 )
+		{
+			LogError(LOG_CUDA "%s -- the structuring element is empty\n", name);
+			return cudaErrorInvalidValue;
+		}
+	}
+
+	const filterElement* elementPtr = (mask != NULL && element.count < maskWidth * maskHeight) ? &element : NULL;
+
+	FILTER_DISPATCH(launchMorphology, name, input, output, width, height, dilate, rx, ry, elementPtr, stream);
+}
+
+// cudaErode
+cudaError_t cudaErode( void* input, void* output, size_t width, size_t height, imageFormat format,
+				   const uint8_t* element, int elementWidth, int elementHeight, cudaStream_t stream )
+{
+	if( !element )
+		return cudaErrorInvalidValue;
+
+	NVTX_RANGE("cudaErode");
+	return morphology(input, output, width, height, format, false, element, elementWidth, elementHeight, stream, "cudaErode()");
+}
+
+// cudaErode
+cudaError_t cudaErode( void* input, void* output, size_t width, size_t height, imageFormat format,
+				   int radius, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaErode");
+	return morphology(input, output, width, height, format, false, NULL, radius * 2 + 1, radius * 2 + 1, stream, "cudaErode()");
+}
+
+// cudaDilate
+cudaError_t cudaDilate( void* input, void* output, size_t width, size_t height, imageFormat format,
+				    const uint8_t* element, int elementWidth, int elementHeight, cudaStream_t stream )
+{
+	if( !element )
+		return cudaErrorInvalidValue;
+
+	NVTX_RANGE("cudaDilate");
+	return morphology(input, output, width, height, format, true, element, elementWidth, elementHeight, stream, "cudaDilate()");
+}
+
+// cudaDilate
+cudaError_t cudaDilate( void* input, void* output, size_t width, size_t height, imageFormat format,
+				    int radius, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaDilate");
+	return morphology(input, output, width, height, format, true, NULL, radius * 2 + 1, radius * 2 + 1, stream, "cudaDilate()");
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_FILTER_H__
+#define __CUDA_FILTER_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * Spatial image filters (blurring, gradients, and morphology).
+ *
+ * The filters are separable where possible:  each thread block filters the rows of its
+ * tile (plus a halo) horizontally into shared memory, and then filters the columns from
+ * shared memory, so the intermediate result never goes through global memory.  The image
+ * edges are clamped (replicated).  The input and output must be different images.
+ *
+ * The supported formats are gray8, gray32f, rgb8, rgba8, rgb32f and rgba32f (and BGR),
+ * with the filters being applied to each channel independently.
+ *
+ * @defgroup spatialFilter Spatial Filtering
+ * @ingroup cuda
+ */
+
+/**
+ * The maximum radius of the convolution and morphology kernels (which can have up to
+ * `2 * CUDA_FILTER_MAX_RADIUS + 1` taps in each dimension).  cudaBoxFilter() has no limit.
+ * @ingroup spatialFilter
+ */
+#define CUDA_FILTER_MAX_RADIUS 16
+
+
+/**
+ * Convolve an image with a separable kernel, given as the horizontal and vertical taps.
+ * @param kernelX the `2 * radius + 1` horizontal taps (in host memory)
+ * @param kernelY the `2 * radius + 1` vertical taps (in host memory)
+ * @param radius the radius of the kernel (up to CUDA_FILTER_MAX_RADIUS)
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ * @ingroup spatialFilter
+ */
+cudaError_t cudaConvolveSeparable( void* input, void* output, size_t width, size_t height, imageFormat format,
+						     const float* kernelX, const float* kernelY, int radius, cudaStream_t stream=NULL );
+
+/**
+ * Blur an image with a Gaussian kernel.
+ * @param sigma the standard deviation of the Gaussian (in pixels)
+ * @param radius the radius of the kernel, or 0 to use `ceil(3 * sigma)` (up to CUDA_FILTER_MAX_RADIUS)
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ * @ingroup spatialFilter
+ */
+cudaError_t cudaGaussianBlur( void* input, void* output, size_t width, size_t height, imageFormat format,
+					     float sigma, int radius=0, cudaStream_t stream=NULL );
+
+/**
+ * Blur an image with a Gaussian kernel.
+ * @ingroup spatialFilter
+ */
+template<typename T> cudaError_t cudaGaussianBlur( T* input, T* output, size_t width, size_t height, float sigma, int radius=0, cudaStream_t stream=NULL )
+{
+	return cudaGaussianBlur((void*)input, (void*)output, width, height, imageFormatFromType<T>(), sigma, radius, stream);
+}
+
+/**
+ * Average each pixel over the `(2 * radius + 1)^2` box around it.
+ * This uses running sums, so the cost per pixel doesn't depend on the radius,
+ * which can be larger than CUDA_FILTER_MAX_RADIUS.
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ * @ingroup spatialFilter
+ */
+cudaError_t cudaBoxFilter( void* input, void* output, size_t width, size_t height, imageFormat format,
+					  int radius, cudaStream_t stream=NULL );
+
+/**
+ * Average each pixel over the `(2 * radius + 1)^2` box around it.
+ * @ingroup spatialFilter
+ */
+template<typename T> cudaError_t cudaBoxFilter( T* input, T* output, size_t width, size_t height, int radius, cudaStream_t stream=NULL )
+{
+	return cudaBoxFilter((void*)input, (void*)output, width, height, imageFormatFromType<T>(), radius, stream);
+}
+
+/**
+ * The 3x3 operators that cudaGradient() can use.
+ * @ingroup spatialFilter
+ */
+enum cudaGradientType
+{
+	GRADIENT_SOBEL,	/**< Sobel operator, the derivative taps are smoothed with [1 2 1] */
+	GRADIENT_SCHARR	/**< Scharr operator, the derivative taps are smoothed with [3 10 3] (more rotationally accurate) */
+};
+
+/**
+ * Compute the horizontal and vertical gradients of an image.
+ * The gradients are output as floating-point images with the same number of channels as
+ * the input (i.e. gray32f, rgb32f or rgba32f), and aren't normalized by the sum of the weights.
+ * @param dx the horizontal gradient (or NULL if it isn't needed)
+ * @param dy the vertical gradient (or NULL if it isn't needed)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
+ * @ingroup spatialFilter
+ */
+cudaError_t cudaGradient( void* input, imageFormat format, void* dx, void* dy, size_t width, size_t height,
+					 cudaGradientType type=GRADIENT_SOBEL, cudaStream_t stream=NULL );
+
+/**
+ * Erode an image (the minimum over the structuring element, per channel).
+ * @param element the structuring element, a `elementWidth * elementHeight` mask in host memory
+ *                where the non-zero entries are included.  The anchor is the center, so the
+ *                dimensions should be odd (up to `2 * CUDA_FILTER_MAX_RADIUS + 1`).
+ *                Rectangular elements (all non-zero) are applied separably.
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ * @ingroup spatialFilter
+ */
+cudaError_t cudaErode( void* input, void* output, size_t width, size_t height, imageFormat format,
+				   const uint8_t* element, int elementWidth, int elementHeight, cudaStream_t stream=NULL );
+
+/**
+ * Erode an image with a `(2 * radius + 1)^2` square structuring element.
+ * @ingroup spatialFilter
+ */
+cudaError_t cudaErode( void* input, void* output, size_t width, size_t height, imageFormat format,
+				   int radius, cudaStream_t stream=NULL );
+
+/**
+ * Dilate an image (the maximum over the structuring element, per channel).
+ * @see cudaErode() for the format of the structuring element.
+ * @ingroup spatialFilter
+ */
+cudaError_t cudaDilate( void* input, void* output, size_t width, size_t height, imageFormat format,
+				    const uint8_t* element, int elementWidth, int elementHeight, cudaStream_t stream=NULL );
+
+/**
+ * Dilate an image with a `(2 * radius + 1)^2` square structuring element.
+ * @ingroup spatialFilter
+ */
+cudaError_t cudaDilate( void* input, void* output, size_t width, size_t height, imageFormat format,
+				    int radius, cudaStream_t stream=NULL );
+
+#endif
@@ -21,7 +21,10 @@
  */
 
 
-#include "cudaFilterMode.h"
+#include "cudaFilterMode.cuh"
+#include "Mutex.h"
+
+#include <string.h>
 #include <strings.h>
 
 
@@ -35,6 +38,10 @@ cudaFilterMode cudaFilterModeFromStr( const char* str, cudaFilterMode default_va
 		return FILTER_LINEAR;
 	else if( strcasecmp(str, "point") == 0 || strcasecmp(str, "nearest") == 0 )
 		return FILTER_POINT;
+	else if( strcasecmp(str, "area") == 0 || strcasecmp(str, "box") == 0 )
+		return FILTER_AREA;
+	else if( strcasecmp(str, "cubic") == 0 || strcasecmp(str, "bicubic") == 0 )
+		return FILTER_CUBIC;
 
 	return default_value;
 }
@@ -45,10 +52,115 @@ const char* cudaFilterModeToStr( cudaFilterMode filter )
 {
 	if( filter == FILTER_LINEAR )
 		return "linear";
+	else if( filter == FILTER_AREA )
+		return "area";
+	else if( filter == FILTER_CUBIC )
+		return "cubic";
 
 	return "point";
 }
 
 
+// texture objects that have been created for filtering
+struct cudaFilterTextureEntry
+{
+	void*       image;
+	uint32_t    width;
+	uint32_t    height;
+	imageFormat format;
+
+	cudaTextureObject_t texture;
+};
+
+#define FILTER_TEXTURE_CACHE_SIZE 16
+
+static cudaFilterTextureEntry gFilterTextures[FILTER_TEXTURE_CACHE_SIZE];
+static uint32_t gFilterTextureNext = 0;
+static Mutex gFilterTextureMutex;
+
+
+// cudaFilterTexture
+bool cudaFilterTexture( cudaTextureObject_t* texture, void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !texture || !image || width == 0 || height == 0 )
+		return false;
+
+	if( format != IMAGE_GRAY8 && format != IMAGE_GRAY32F && format != IMAGE_RGBA8 && format != IMAGE_RGBA32F )
+		return false;
+
+	gFilterTextureMutex.Lock();
+
+	for( uint32_t n=0; n < FILTER_TEXTURE_CACHE_SIZE; n++ )
+	{
+		const cudaFilterTextureEntry& entry = gFilterTextures[n];
+
+		if( entry.texture != 0 && entry.image == image && entry.width == width && entry.height == height && entry.format == format )
+		{
+			*texture = entry.texture;
+			gFilterTextureMutex.Unlock();
+			return true;
+		}
+	}
 
+	// bind the image's linear memory to a texture with bilinear filtering
+	cudaResourceDesc resDesc;
+	memset(&resDesc, 0, sizeof(cudaResourceDesc));
 
+	resDesc.resType = cudaResourceTypePitch2D;
+	resDesc.res.pitch2D.devPtr = image;
+
+	if( format == IMAGE_GRAY8 )
+		resDesc.res.pitch2D.desc = cudaCreateChannelDesc<uint8_t>();
+	else if( format == IMAGE_GRAY32F )
+		resDesc.res.pitch2D.desc = cudaCreateChannelDesc<float>();
+	else if( format == IMAGE_RGBA8 )
+		resDesc.res.pitch2D.desc = cudaCreateChannelDesc<uchar4>();
+	else
+		resDesc.res.pitch2D.desc = cudaCreateChannelDesc<float4>();
+
+	resDesc.res.pitch2D.width = width;
+	resDesc.res.pitch2D.height = height;
+	resDesc.res.pitch2D.pitchInBytes = imageFormatSize(format, width, 1);
+
+	cudaTextureDesc texDesc;
+	memset(&texDesc, 0, sizeof(cudaTextureDesc));
+
+	texDesc.addressMode[0] = cudaAddressModeClamp;
+	texDesc.addressMode[1] = cudaAddressModeClamp;
+	texDesc.filterMode = cudaFilterModeLinear;
+	texDesc.readMode = (imageFormatBaseType(format) == IMAGE_UINT8) ? cudaReadModeNormalizedFloat : cudaReadModeElementType;
+	texDesc.normalizedCoords = 0;
+
+	cudaTextureObject_t tex = 0;
+
+	// this fails if the pointer or pitch doesn't meet the texture alignment,
+	// in which case the caller falls back to software filtering (so don't log it)
+	if( cudaCreateTextureObject(&tex, &resDesc, &texDesc, NULL) != cudaSuccess )
+	{
+		cudaGetLastError();	// clear the error
+		gFilterTextureMutex.Unlock();
+		return false;
+	}
+
+	// replace the oldest entry in the cache
+	cudaFilterTextureEntry& entry = gFilterTextures[gFilterTextureNext];
+
+	if( entry.texture != 0 )
+	{
+		// the texture could still be in use by a kernel
+		CUDA(cudaDeviceSynchronize());
+		CUDA(cudaDestroyTextureObject(entry.texture));
+	}
+
+	entry.image   = image;
+	entry.width   = width;
+	entry.height  = height;
+	entry.format  = format;
+	entry.texture = tex;
+
+	gFilterTextureNext = (gFilterTextureNext + 1) % FILTER_TEXTURE_CACHE_SIZE;
+	gFilterTextureMutex.Unlock();
+
+	*texture = tex;
+	return true;
+}
@@ -26,6 +26,7 @@
 
 #include "cudaFilterMode.h"
 #include "cudaMath.h"
+#include "imageFormat.h"
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -80,11 +81,96 @@ float4 cudaReadPixel<FORMAT_CHW>( float4* input, int x, int y, int width, int he
 
 ///@}
 
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Floating-point accumulators used by FILTER_AREA for each pixel type.
+/// @ingroup cudaFilter
+//////////////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+template<typename T> struct cudaFilterAccum;
+
+template<> struct cudaFilterAccum<uint8_t>
+{
+	typedef float Type;
+	static __device__ inline float load( uint8_t v )		{ return v; }
+	static __device__ inline uint8_t store( float v )	{ return v + 0.5f; }
+	static __device__ inline float saturate( float v )	{ return fminf(fmaxf(v, 0.0f), 255.0f); }
+};
+
+template<> struct cudaFilterAccum<float>
+{
+	typedef float Type;
+	static __device__ inline float load( float v )		{ return v; }
+	static __device__ inline float store( float v )		{ return v; }
+	static __device__ inline float saturate( float v )	{ return v; }
+};
+
+template<> struct cudaFilterAccum<float2>
+{
+	typedef float2 Type;
+	static __device__ inline float2 load( const float2& v )	{ return v; }
+	static __device__ inline float2 store( const float2& v )	{ return v; }
+	static __device__ inline float2 saturate( const float2& v )	{ return v; }
+};
+
+template<> struct cudaFilterAccum<uchar3>
+{
+	typedef float3 Type;
+	static __device__ inline float3 load( const uchar3& v )	{ return make_float3(v); }
+	static __device__ inline uchar3 store( const float3& v )	{ return make_uchar3(v + 0.5f); }
+	static __device__ inline float3 saturate( const float3& v )	{ return clamp(v, 0.0f, 255.0f); }
+};
+
+template<> struct cudaFilterAccum<uchar4>
+{
+	typedef float4 Type;
+	static __device__ inline float4 load( const uchar4& v )	{ return make_float4(v); }
+	static __device__ inline uchar4 store( const float4& v )	{ return make_uchar4(v + 0.5f); }
+	static __device__ inline float4 saturate( const float4& v )	{ return clamp(v, 0.0f, 255.0f); }
+};
+
+template<> struct cudaFilterAccum<float3>
+{
+	typedef float3 Type;
+	static __device__ inline float3 load( const float3& v )	{ return v; }
+	static __device__ inline float3 store( const float3& v )	{ return v; }
+	static __device__ inline float3 saturate( const float3& v )	{ return v; }
+};
+
+template<> struct cudaFilterAccum<float4>
+{
+	typedef float4 Type;
+	static __device__ inline float4 load( const float4& v )	{ return v; }
+	static __device__ inline float4 store( const float4& v )	{ return v; }
+	static __device__ inline float4 saturate( const float4& v )	{ return v; }
+};
+
+///@}
+
+/**
+ * Compute the Catmull-Rom weights of the 4 taps around a sample,
+ * where `t` is the fractional distance from the second tap.
+ * @ingroup cudaFilter
+ */
+__device__ inline void cudaCubicWeights( float t, float w[4] )
+{
+	const float t2 = t * t;
+	const float t3 = t2 * t;
+
+	w[0] = -0.5f * t3 + t2 - 0.5f * t;
+	w[1] =  1.5f * t3 - 2.5f * t2 + 1.0f;
+	w[2] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+	w[3] =  0.5f * t3 - 0.5f * t2;
+}
+
 /**
- * CUDA device function for sampling a pixel with bilinear or point filtering.
+ * CUDA device function for sampling a pixel with bilinear, bicubic or point filtering.
  * cudaFilterPixel() is for use inside of other CUDA kernels, and accepts a
  * cudaFilterMode template parameter which sets the filtering mode, in addition
  * to a cudaDataFormat template parameter which sets the format (HWC or CHW).
+ * Since a single coordinate carries no footprint, FILTER_AREA samples bilinearly.
  *
  * @param input pointer to image in CUDA device memory
  * @param x desired x-coordinate to sample
@@ -105,7 +191,39 @@ __device__ inline T cudaFilterPixel( T* input, float x, float y, int width, int
 
 		return cudaReadPixel<format>(input, x1, y1, width, height); //input[y1 * width + x1];
 	}
-	else // FILTER_LINEAR
+	else if( filter == FILTER_CUBIC )
+	{
+		const float bx = x - 0.5f;
+		const float by = y - 0.5f;
+
+		const float fx = floorf(bx);
+		const float fy = floorf(by);
+
+		float wx[4];
+		float wy[4];
+
+		cudaCubicWeights(bx - fx, wx);
+		cudaCubicWeights(by - fy, wy);
+
+		typename cudaFilterAccum<T>::Type sum = typename cudaFilterAccum<T>::Type();
+
+		#pragma unroll
+		for( int j=0; j < 4; j++ )
+		{
+			const int py = min(max(int(fy) + j - 1, 0), height - 1);
+
+			#pragma unroll
+			for( int i=0; i < 4; i++ )
+			{
+				const int px = min(max(int(fx) + i - 1, 0), width - 1);
+				sum += cudaFilterAccum<T>::load(cudaReadPixel<format>(input, px, py, width, height)) * (wx[i] * wy[j]);
+			}
+		}
+
+		// the negative lobes can overshoot the range of uint8 pixels
+		return cudaFilterAccum<T>::store(cudaFilterAccum<T>::saturate(sum));
+	}
+	else // FILTER_LINEAR or FILTER_AREA
 	{
 		const float bx = x - 0.5f;
 		const float by = y - 0.5f;
@@ -145,7 +263,59 @@ __device__ inline T cudaFilterPixel( T* input, float x, float y, int width, int
 }
 
 /**
- * CUDA device function for sampling a pixel with bilinear or point filtering.
+ * CUDA device function for area-averaging (box filtering) a pixel.
+ * The output pixel at (x,y) is the mean of the input pixels that its footprint
+ * covers, with partially-covered pixels weighted by their overlap.  This reads
+ * directly from global memory - cudaResize() uses a shared-memory tiled kernel.
+ *
+ * @param input pointer to image in CUDA device memory
+ * @param x desired x-coordinate to sample (in coordinate space of output image)
+ * @param y desired y-coordinate to sample (in coordinate space of output image)
+ * @param input_width width of the input image
+ * @param input_height height of the input image
+ * @param output_width width of the output image
+ * @param output_height height of the output image
+ *
+ * @returns the averaged pixel from the input image
+ * @ingroup cudaFilter
+ */
+template<cudaDataFormat format=FORMAT_HWC, typename T>
+__device__ inline T cudaFilterPixelArea( T* input, int x, int y,
+							    int input_width, int input_height,
+							    int output_width, int output_height )
+{
+	const float sx = float(input_width) / float(output_width);
+	const float sy = float(input_height) / float(output_height);
+
+	const float px0 = float(x) * sx;
+	const float py0 = float(y) * sy;
+	const float px1 = fminf(px0 + sx, float(input_width));
+	const float py1 = fminf(py0 + sy, float(input_height));
+
+	const int x_end = min(int(ceilf(px1)), input_width);
+	const int y_end = min(int(ceilf(py1)), input_height);
+
+	typename cudaFilterAccum<T>::Type sum = typename cudaFilterAccum<T>::Type();
+	float weight = 0.0f;
+
+	for( int iy=int(py0); iy < y_end; iy++ )
+	{
+		const float wy = fminf(float(iy+1), py1) - fmaxf(float(iy), py0);
+
+		for( int ix=int(px0); ix < x_end; ix++ )
+		{
+			const float w = (fminf(float(ix+1), px1) - fmaxf(float(ix), px0)) * wy;
+
+			sum += cudaFilterAccum<T>::load(cudaReadPixel<format>(input, ix, iy, input_width, input_height)) * w;
+			weight += w;
+		}
+	}
+
+	return cudaFilterAccum<T>::store(sum / weight);
+}
+
+/**
+ * CUDA device function for sampling a pixel with bilinear, point, or area filtering.
  * cudaFilterPixel() is for use inside of other CUDA kernels, and samples a
  * pixel from an input image from the scaled coordinates of an output image.
  *
@@ -165,6 +335,9 @@ __device__ inline T cudaFilterPixel( T* input, int x, int y,
 						       int input_width, int input_height,
 						       int output_width, int output_height )
 {
+	if( filter == FILTER_AREA )
+		return cudaFilterPixelArea<format>(input, x, y, input_width, input_height, output_width, output_height);
+
 	const float px = float(x) / float(output_width) * float(input_width);
 	const float py = float(y) / float(output_height) * float(input_height);
 
@@ -172,6 +345,181 @@ __device__ inline T cudaFilterPixel( T* input, int x, int y,
 }
 
 
-#endif
+/**
+ * CUDA device function for sampling a pixel with point, bilinear or area filtering
+ * through a pixel reader functor, for images that can't be addressed as a single
+ * array of T (for example YUV or half-precision images).  The reader is called as
+ * `reader(x,y)` with integer input coordinates, and returns the pixel as type T,
+ * which should be a floating-point type like float, float3 or float4.
+ *
+ * @param reader functor that returns the input pixel at integer coordinates
+ * @param x desired x-coordinate to sample (in coordinate space of output image)
+ * @param y desired y-coordinate to sample (in coordinate space of output image)
+ * @param input_width width of the input image
+ * @param input_height height of the input image
+ * @param output_width width of the output image
+ * @param output_height height of the output image
+ *
+ * @returns the filtered pixel from the input image
+ * @ingroup cudaFilter
+ */
+template<cudaFilterMode filter, typename T, typename Reader>
+__device__ inline T cudaFilterPixelReader( const Reader& reader, int x, int y,
+							     int input_width, int input_height,
+							     int output_width, int output_height )
+{
+	const float sx = float(input_width) / float(output_width);
+	const float sy = float(input_height) / float(output_height);
 
+	if( filter == FILTER_POINT )
+	{
+		return reader(int(float(x) * sx), int(float(y) * sy));
+	}
+	else if( filter == FILTER_AREA )
+	{
+		const float px0 = float(x) * sx;
+		const float py0 = float(y) * sy;
+		const float px1 = fminf(px0 + sx, float(input_width));
+		const float py1 = fminf(py0 + sy, float(input_height));
+
+		const int x_end = min(int(ceilf(px1)), input_width);
+		const int y_end = min(int(ceilf(py1)), input_height);
+
+		T sum = T();
+		float weight = 0.0f;
 
+		for( int iy=int(py0); iy < y_end; iy++ )
+		{
+			const float wy = fminf(float(iy+1), py1) - fmaxf(float(iy), py0);
+
+			for( int ix=int(px0); ix < x_end; ix++ )
+			{
+				const float w = (fminf(float(ix+1), px1) - fmaxf(float(ix), px0)) * wy;
+
+				sum += reader(ix, iy) * w;
+				weight += w;
+			}
+		}
+
+		return sum / weight;
+	}
+	else if( filter == FILTER_CUBIC )
+	{
+		const float bx = float(x) * sx - 0.5f;
+		const float by = float(y) * sy - 0.5f;
+
+		const float fx = floorf(bx);
+		const float fy = floorf(by);
+
+		float wx[4];
+		float wy[4];
+
+		cudaCubicWeights(bx - fx, wx);
+		cudaCubicWeights(by - fy, wy);
+
+		T sum = T();
+
+		#pragma unroll
+		for( int j=0; j < 4; j++ )
+		{
+			const int py = min(max(int(fy) + j - 1, 0), input_height - 1);
+
+			#pragma unroll
+			for( int i=0; i < 4; i++ )
+				sum += reader(min(max(int(fx) + i - 1, 0), input_width - 1), py) * (wx[i] * wy[j]);
+		}
+
+		return sum;
+	}
+	else // FILTER_LINEAR
+	{
+		const float bx = float(x) * sx - 0.5f;
+		const float by = float(y) * sy - 0.5f;
+
+		const float cx = bx < 0.0f ? 0.0f : bx;
+		const float cy = by < 0.0f ? 0.0f : by;
+
+		const int x1 = int(cx);
+		const int y1 = int(cy);
+			
+		const int x2 = x1 >= input_width - 1 ? x1 : x1 + 1;	// bounds check
+		const int y2 = y1 >= input_height - 1 ? y1 : y1 + 1;
+
+		// compute bilinear weights
+		const float x2f = cx - float(x1);
+		const float y2f = cy - float(y1);
+
+		const float x1f = 1.0f - x2f;
+		const float y1f = 1.0f - y2f;
+
+		return reader(x1, y1) * (x1f * y1f) + reader(x2, y1) * (x2f * y1f) + 
+			  reader(x1, y2) * (x1f * y2f) + reader(x2, y2) * (x2f * y2f);
+	}
+}
+
+
+/**
+ * CUDA device function for sampling a texture with the texture hardware.
+ * The texture should have bilinear filtering (see cudaFilterTexture()), and the
+ * coordinates are in pixels, with the centers of the pixels at +0.5
+ *
+ * With FILTER_CUBIC, the 16 taps of the Catmull-Rom filter are gathered with 9
+ * bilinear fetches, because the inner 2 taps of each axis can be combined into one.
+ * Otherwise the texture is sampled bilinearly.
+ *
+ * @ingroup cudaFilter
+ */
+template<cudaFilterMode filter, typename T>
+__device__ inline T cudaFilterTexturePixel( cudaTextureObject_t texture, float x, float y )
+{
+	if( filter != FILTER_CUBIC )
+		return tex2D<T>(texture, x, y);
+
+	const float bx = x - 0.5f;
+	const float by = y - 0.5f;
+
+	const float fx = floorf(bx);
+	const float fy = floorf(by);
+
+	float wx[4];
+	float wy[4];
+
+	cudaCubicWeights(bx - fx, wx);
+	cudaCubicWeights(by - fy, wy);
+
+	// the weights of the inner taps are always positive, so they can be merged
+	const float cx[3] = { fx - 0.5f, fx + 0.5f + wx[2] / (wx[1] + wx[2]), fx + 2.5f };
+	const float cy[3] = { fy - 0.5f, fy + 0.5f + wy[2] / (wy[1] + wy[2]), fy + 2.5f };
+
+	const float kx[3] = { wx[0], wx[1] + wx[2], wx[3] };
+	const float ky[3] = { wy[0], wy[1] + wy[2], wy[3] };
+
+	T sum = T();
+
+	#pragma unroll
+	for( int j=0; j < 3; j++ )
+	{
+		#pragma unroll
+		for( int i=0; i < 3; i++ )
+			sum += tex2D<T>(texture, cx[i], cy[j]) * (kx[i] * ky[j]);
+	}
+
+	return sum;
+}
+
+
+/**
+ * Get a texture object with bilinear filtering for a gray8, gray32f, rgba8 or rgba32f image,
+ * which can be sampled with cudaFilterTexturePixel().  The texture is read as float (for gray)
+ * or float4 (for rgba), and uint8 images are normalized to [0,1].  The addressing clamps to the edges.
+ *
+ * The texture objects are cached by image pointer and dimensions, so they're only
+ * created once for each buffer.
+ *
+ * @returns false if the image format or alignment isn't supported by textures.
+ * @ingroup cudaFilter
+ */
+bool cudaFilterTexture( cudaTextureObject_t* texture, void* image, uint32_t width, uint32_t height, imageFormat format );
+
+
+#endif
@@ -35,7 +35,9 @@
 enum cudaFilterMode
 {
 	FILTER_POINT,	 /**< Nearest-neighbor sampling */
-	FILTER_LINEAR	 /**< Bilinear filtering */
+	FILTER_LINEAR,	 /**< Bilinear filtering */
+	FILTER_AREA,	 /**< Area-averaging (box filter), for antialiased downscaling */
+	FILTER_CUBIC	 /**< Bicubic (Catmull-Rom) filtering, for sharper upscaling */
 };
 
 /**
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaFlip.h"
+#include "cudaNVTX.h"
+
+#include "logging.h"
+
+
+// the size of the tiles that get transposed through shared memory
+#define FLIP_TILE_DIM   32
+#define FLIP_BLOCK_ROWS 8
+
+
+// gpuFlip (mirror an image horizontally and/or vertically)
+template<typename T>
+__global__ void gpuFlip( T* input, T* output, int width, int height, bool flipX, bool flipY )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const int ix = flipX ? width - 1 - x : x;
+	const int iy = flipY ? height - 1 - y : y;
+
+	output[y * width + x] = input[iy * width + ix];
+}
+
+
+// gpuTranspose (the output pixel at (x,y) comes from the input pixel at (y,x), optionally mirrored)
+template<typename T, bool flipX, bool flipY>
+__global__ void gpuTranspose( T* input, T* output, int width, int height )
+{
+	__shared__ T tile[FLIP_TILE_DIM][FLIP_TILE_DIM+1];	// padded to avoid bank conflicts
+
+	const int x0 = blockIdx.x * FLIP_TILE_DIM;
+	const int y0 = blockIdx.y * FLIP_TILE_DIM;
+
+	// read a tile of the input (coalesced along its rows)
+	const int ix = x0 + threadIdx.x;
+
+	for( int j=threadIdx.y; j < FLIP_TILE_DIM; j += FLIP_BLOCK_ROWS )
+	{
+		const int iy = y0 + j;
+
+		if( ix < width && iy < height )
+			tile[j][threadIdx.x] = input[iy * width + ix];
+	}
+
+	__syncthreads();
+
+	// write the tile to the output (coalesced along its rows, which are the input's columns)
+	const int ty = flipY ? FLIP_TILE_DIM - 1 - threadIdx.x : threadIdx.x;
+	const int iy = y0 + ty;
+
+	if( iy >= height )
+		return;
+
+	const int ox = flipY ? height - 1 - iy : iy;
+
+	for( int j=threadIdx.y; j < FLIP_TILE_DIM; j += FLIP_BLOCK_ROWS )
+	{
+		const int tx = flipX ? FLIP_TILE_DIM - 1 - j : j;
+		const int ix = x0 + tx;
+
+		if( ix >= width )
+			continue;
+
+		const int oy = flipX ? width - 1 - ix : ix;
+		output[oy * height + ox] = tile[ty][tx];
+	}
+}
+
+
+// gpuFlipYUYV (mirror packed 4:2:2 macropixels horizontally, swapping the two luma samples)
+template<bool lumaOdd>
+__global__ void gpuFlipYUYV( uchar4* input, uchar4* output, int width, int height, bool flipY )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const int iy = flipY ? height - 1 - y : y;
+	uchar4 px = input[iy * width + (width - 1 - x)];
+
+	if( lumaOdd )
+	{
+		const uint8_t y0 = px.y;	// UYVY
+		px.y = px.w;
+		px.w = y0;
+	}
+	else
+	{
+		const uint8_t y0 = px.x;	// YUYV, YVYU
+		px.x = px.z;
+		px.z = y0;
+	}
+
+	output[y * width + x] = px;
+}
+
+
+// launchTranspose
+template<typename T, bool flipX, bool flipY>
+static void launchTranspose( void* input, void* output, size_t width, size_t height, cudaStream_t stream )
+{
+	const dim3 blockDim(FLIP_TILE_DIM, FLIP_BLOCK_ROWS);
+	const dim3 gridDim(iDivUp(width, FLIP_TILE_DIM), iDivUp(height, FLIP_TILE_DIM));
+
+	gpuTranspose<T, flipX, flipY><<<gridDim, blockDim, 0, stream>>>((T*)input, (T*)output, width, height);
+}
+
+
+// launchFlip
+template<typename T>
+static void launchFlip( void* input, void* output, size_t width, size_t height, cudaFlipMethod method, cudaStream_t stream )
+{
+	if( method == FLIP_METHOD_UPPER_LEFT_DIAGONAL )
+		launchTranspose<T, false, false>(input, output, width, height, stream);
+	else if( method == FLIP_METHOD_CLOCKWISE )
+		launchTranspose<T, false, true>(input, output, width, height, stream);
+	else if( method == FLIP_METHOD_COUNTERCLOCKWISE )
+		launchTranspose<T, true, false>(input, output, width, height, stream);
+	else if( method == FLIP_METHOD_UPPER_RIGHT_DIAGONAL )
+		launchTranspose<T, true, true>(input, output, width, height, stream);
+	else
+	{
+		const bool flipX = (method == FLIP_METHOD_HORIZONTAL || method == FLIP_METHOD_ROTATE_180);
+		const bool flipY = (method == FLIP_METHOD_VERTICAL || method == FLIP_METHOD_ROTATE_180);
+
+		const dim3 blockDim(32, 8);
+		const dim3 gridDim(iDivUp(width, blockDim.x), iDivUp(height, blockDim.y));
+
+		gpuFlip<T><<<gridDim, blockDim, 0, stream>>>((T*)input, (T*)output, width, height, flipX, flipY);
+	}
+}
+
+
+// flipPlane (flip one plane of an image, based on the size of its elements)
+static cudaError_t flipPlane( void* input, void* output, size_t width, size_t height, size_t elemSize, cudaFlipMethod method, cudaStream_t stream )
+{
+	switch(elemSize)
+	{
+		case 1:  launchFlip<uint8_t>(input, output, width, height, method, stream); break;
+		case 2:  launchFlip<ushort>(input, output, width, height, method, stream); break;
+		case 3:  launchFlip<uchar3>(input, output, width, height, method, stream); break;
+		case 4:  launchFlip<uint32_t>(input, output, width, height, method, stream); break;
+		case 6:  launchFlip<ushort3>(input, output, width, height, method, stream); break;
+		case 8:  launchFlip<uint2>(input, output, width, height, method, stream); break;
+		case 12: launchFlip<uint3>(input, output, width, height, method, stream); break;
+		case 16: launchFlip<uint4>(input, output, width, height, method, stream); break;
+		default: return cudaErrorInvalidValue;
+	}
+
+	return cudaGetLastError();
+}
+
+
+// cudaFlip
+cudaError_t cudaFlip( void* input, void* output, size_t width, size_t height,
+				  imageFormat format, cudaFlipMethod method, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaFlip");
+
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( method == FLIP_METHOD_NONE )
+	{
+		if( input == output )
+			return cudaSuccess;
+
+		return CUDA(cudaMemcpyAsync(output, input, imageFormatSize(format, width, height), cudaMemcpyDeviceToDevice, stream));
+	}
+
+	if( input == output )
+	{
+		LogError(LOG_CUDA "cudaFlip() -- the input and output images can't be the same\n");
+		return cudaErrorInvalidValue;
+	}
+
+	if( imageFormatIsBayer(format) )
+	{
+		LogError(LOG_CUDA "cudaFlip() -- %s can't be flipped (flip the image after it's demosaiced)\n", imageFormatToStr(format));
+		return cudaErrorInvalidValue;
+	}
+
+	// the packed 4:2:2 formats are flipped as macropixels (two pixels wide)
+	if( format == IMAGE_YUYV || format == IMAGE_YVYU || format == IMAGE_UYVY )
+	{
+		if( cudaFlipTransposes(method) )
+		{
+			LogError(LOG_CUDA "cudaFlip() -- %s only supports horizontal, vertical, or 180 degree flips\n", imageFormatToStr(format));
+			return cudaErrorInvalidValue;
+		}
+
+		if( width % 2 != 0 )
+		{
+			LogError(LOG_CUDA "cudaFlip() -- %s requires the width to be even\n", imageFormatToStr(format));
+			return cudaErrorInvalidValue;
+		}
+
+		if( method == FLIP_METHOD_VERTICAL )
+			return CUDA(flipPlane(input, output, width / 2, height, sizeof(uchar4), method, stream));
+
+		const dim3 blockDim(32, 8);
+		const dim3 gridDim(iDivUp(width / 2, blockDim.x), iDivUp(height, blockDim.y));
+		const bool flipY = (method == FLIP_METHOD_ROTATE_180);
+
+		if( format == IMAGE_UYVY )
+			gpuFlipYUYV<true><<<gridDim, blockDim, 0, stream>>>((uchar4*)input, (uchar4*)output, width / 2, height, flipY);
+		else
+			gpuFlipYUYV<false><<<gridDim, blockDim, 0, stream>>>((uchar4*)input, (uchar4*)output, width / 2, height, flipY);
+
+		return CUDA(cudaGetLastError());
+	}
+
+	// the planes of the image (element size in bytes, and the subsampling in x/y)
+	struct planeDesc
+	{
+		size_t elemSize;
+		size_t divX;
+		size_t divY;
+	};
+
+	planeDesc planes[3];
+	int numPlanes = 0;
+
+	if( format == IMAGE_I420 || format == IMAGE_YV12 )
+	{
+		planes[0] = {1, 1, 1};
+		planes[1] = {1, 2, 2};
+		planes[2] = {1, 2, 2};
+		numPlanes = 3;
+	}
+	else if( format == IMAGE_NV12 )
+	{
+		planes[0] = {1, 1, 1};
+		planes[1] = {2, 2, 2};
+		numPlanes = 2;
+	}
+	else if( format == IMAGE_P010 || format == IMAGE_P016 )
+	{
+		planes[0] = {2, 1, 1};
+		planes[1] = {4, 2, 2};
+		numPlanes = 2;
+	}
+	else if( format == IMAGE_RGB32F_PLANAR || format == IMAGE_RGB16F_PLANAR )
+	{
+		const size_t elemSize = (format == IMAGE_RGB32F_PLANAR) ? sizeof(float) : sizeof(uint16_t);
+
+		for( int n=0; n < 3; n++ )
+			planes[n] = {elemSize, 1, 1};
+
+		numPlanes = 3;
+	}
+	else if( format != IMAGE_UNKNOWN && imageFormatDepth(format) % 8 == 0 )
+	{
+		planes[0] = {imageFormatDepth(format) / 8, 1, 1};
+		numPlanes = 1;
+	}
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaFlip()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	// flip each of the planes
+	size_t offset = 0;
+
+	for( int n=0; n < numPlanes; n++ )
+	{
+		const size_t planeWidth  = width / planes[n].divX;
+		const size_t planeHeight = height / planes[n].divY;
+
+		const cudaError_t result = flipPlane((uint8_t*)input + offset, (uint8_t*)output + offset,
+									  planeWidth, planeHeight, planes[n].elemSize, method, stream);
+
+		if( result != cudaSuccess )
+		{
+			LogError(LOG_CUDA "cudaFlip() -- failed to flip plane %i of %s image\n", n, imageFormatToStr(format));
+			return CUDA(result);
+		}
+
+		offset += planeWidth * planeHeight * planes[n].elemSize;
+	}
+
+	return cudaSuccess;
+}
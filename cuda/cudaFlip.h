@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_FLIP_H__
+#define __CUDA_FLIP_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * Rotation and mirroring modes for cudaFlip().
+ * These have the same values as videoOptions::FlipMethod and the
+ * `flip-method` property of the nvvidconv element, so they can be cast.
+ * @ingroup cuda
+ */
+enum cudaFlipMethod
+{
+	FLIP_METHOD_NONE = 0,				/**< Identity (no rotation) */
+	FLIP_METHOD_COUNTERCLOCKWISE,		/**< Rotate counter-clockwise 90 degrees */
+	FLIP_METHOD_ROTATE_180,			/**< Rotate 180 degrees */
+	FLIP_METHOD_CLOCKWISE,			/**< Rotate clockwise 90 degrees */
+	FLIP_METHOD_HORIZONTAL,			/**< Flip horizontally */
+	FLIP_METHOD_UPPER_RIGHT_DIAGONAL,	/**< Flip across upper right/lower left diagonal */
+	FLIP_METHOD_VERTICAL,				/**< Flip vertically */
+	FLIP_METHOD_UPPER_LEFT_DIAGONAL	/**< Flip across upper left/lower right diagonal */
+};
+
+/**
+ * Return true if the flip method transposes the image (i.e. it swaps the width and height).
+ * @ingroup cuda
+ */
+inline bool cudaFlipTransposes( cudaFlipMethod method )
+{
+	return method == FLIP_METHOD_COUNTERCLOCKWISE || method == FLIP_METHOD_CLOCKWISE
+		|| method == FLIP_METHOD_UPPER_RIGHT_DIAGONAL || method == FLIP_METHOD_UPPER_LEFT_DIAGONAL;
+}
+
+/**
+ * Rotate, transpose, or mirror an image on the GPU.
+ *
+ * The rotations and diagonal flips transpose the image through tiles in shared memory,
+ * so that both the reads and writes are coalesced.  For these the output is `height x width`
+ * (use cudaFlipTransposes() to check), otherwise it's the same size as the input.
+ *
+ * All of the uncompressed formats are supported, and the planar YUV formats (I420, YV12,
+ * NV12, P010, P016) have each of their planes flipped.  The packed 4:2:2 formats (YUY2, YVYU,
+ * UYVY) share chroma between horizontal pairs of pixels, so they can only be mirrored or
+ * rotated 180 degrees.  Bayer images should be flipped after they're demosaiced.
+ *
+ * @param input the input image in CUDA memory
+ * @param output the output image in CUDA memory (it can't be the same as the input)
+ * @param width the width of the input image (in pixels)
+ * @param height the height of the input image (in pixels)
+ * @param format the format of the input and output images
+ * @param method the rotation or mirroring to apply
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ *
+ * @ingroup cuda
+ */
+cudaError_t cudaFlip( void* input, void* output, size_t width, size_t height,
+				  imageFormat format, cudaFlipMethod method, cudaStream_t stream=NULL );
+
+/**
+ * Rotate, transpose, or mirror an image on the GPU.
+ * @see the void* version of cudaFlip() for a description of the parameters.
+ * @ingroup cuda
+ */
+template<typename T> cudaError_t cudaFlip( T* input, T* output, size_t width, size_t height, cudaFlipMethod method, cudaStream_t stream=NULL )	{ return cudaFlip((void*)input, (void*)output, width, height, imageFormatFromType<T>(), method, stream); }
+
+#endif
@@ -23,15 +23,20 @@
 #include "cudaFont.h"
 #include "cudaVector.h"
 #include "cudaOverlay.h"
+#include "cudaDraw.h"
 #include "cudaMappedMemory.h"
 
 #include "imageIO.h"
 #include "filesystem.h"
 #include "logging.h"
+#include "profiler.h"
+#include "Mutex.h"
+#include "ThreadPool.h"
 
 #define STBTT_STATIC
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "../image/stb/stb_truetype.h"
+#include "cudaNVTX.h"
 
 
 //#define DEBUG_FONT
@@ -49,6 +54,19 @@ struct __align__(16) GlyphCommand
 };
 
 
+// Struct for one character to render from a batch (with its own color)
+struct __align__(16) GlyphBatchCommand
+{
+	short x;		// x coordinate origin in output image to begin drawing the glyph at 
+	short y;		// y coordinate origin in output image to begin drawing the glyph at 
+	short u;		// x texture coordinate in the baked font map where the glyph resides
+	short v;		// y texture coordinate in the baked font map where the glyph resides 
+	short width;	// width of the glyph in pixels
+	short height;	// height of the glyph in pixels
+	uchar4 color;	// color of the glyph (0-255)
+};
+
+
 // adaptFontSize
 float adaptFontSize( uint32_t dimension )
 {
@@ -70,10 +88,447 @@ float adaptFontSize( uint32_t dimension )
 }
 
 
+// SDF atlas settings (the glyphs are rendered at this size, and then scaled)
+#define SDF_BASE_SIZE   48.0f
+#define SDF_PADDING     6
+#define SDF_ONEDGE      128
+#define SDF_DIST_SCALE  (float(SDF_ONEDGE) / float(SDF_PADDING))
+
+
+// Baked font map that's shared between cudaFont instances
+struct cudaFontAtlas
+{
+	std::string path;
+	float       size;	// the size the atlas was baked at
+	bool        sdf;
+	uint32_t    refCount;
+
+	// the atlas is baked in the background, and waited on when it's first used
+	bool     baked;
+	bool     valid;
+	uint32_t firstGlyph;
+	uint32_t numGlyphs;
+	Mutex    bakeMutex;
+
+	uint8_t* mapCPU;
+	uint8_t* mapGPU;
+
+	int mapWidth;
+	int mapHeight;
+
+	struct Glyph
+	{
+		uint16_t x;
+		uint16_t y;
+		uint16_t width;
+		uint16_t height;
+
+		float xAdvance;
+		float xOffset;
+		float yOffset;
+	};
+
+	std::vector<Glyph> glyphs;
+};
+
+
+// process-wide cache of the loaded fonts (protected by the mutex)
+static std::vector<cudaFontAtlas*> gFontCache;
+static Mutex gFontCacheMutex;
+
+
+// read a TTF font file into memory
+static void* loadFontFile( const char* filename )
+{
+	// verify that the font file exists and get its size
+	const size_t ttf_size = fileSize(filename);
+
+	if( !ttf_size )
+	{
+		LogError(LOG_CUDA "font doesn't exist or empty file '%s'\n", filename);
+ 		return NULL;
+	}
+
+	// allocate memory to store the font file
+	void* ttf_buffer = malloc(ttf_size);
+
+	if( !ttf_buffer )
+	{
+		LogError(LOG_CUDA "failed to allocate %zu byte buffer for reading '%s'\n", ttf_size, filename);
+		return NULL;
+	}
+
+	// open the font file
+	FILE* ttf_file = fopen(filename, "rb");
+
+	if( !ttf_file )
+	{
+		LogError(LOG_CUDA "failed to open '%s' for reading\n", filename);
+		free(ttf_buffer);
+		return NULL;
+	}
+
+	// read the font file
+	const size_t ttf_read = fread(ttf_buffer, 1, ttf_size, ttf_file);
+
+	fclose(ttf_file);
+
+	if( ttf_read != ttf_size )
+	{
+		LogError(LOG_CUDA "failed to read contents of '%s'\n", filename);
+		LogError(LOG_CUDA "(read %zu bytes, expected %zu bytes)\n", ttf_read, ttf_size);
+
+		free(ttf_buffer);
+		return NULL;
+	}
+
+	return ttf_buffer;
+}
+
+
+// rasterize a fixed-size bitmap font map
+static bool bakeFontBitmap( cudaFontAtlas* atlas, const uint8_t* ttf, uint32_t firstGlyph, uint32_t numGlyphs )
+{
+	// buffer that stores the coordinates of the baked glyphs
+	std::vector<stbtt_bakedchar> bakeCoords(numGlyphs);
+
+	atlas->mapWidth  = 256;
+	atlas->mapHeight = 256;
+
+	// increase the size of the bitmap until all the glyphs fit
+	while(true)
+	{
+		// allocate memory for the packed font texture (alpha only)
+		const size_t fontMapSize = atlas->mapWidth * atlas->mapHeight * sizeof(unsigned char);
+
+		if( !cudaAllocMapped((void**)&atlas->mapCPU, (void**)&atlas->mapGPU, fontMapSize, CUDA_MEMORY_FONT) )
+		{
+			LogError(LOG_CUDA "failed to allocate %zu bytes to store %ix%i font map\n", fontMapSize, atlas->mapWidth, atlas->mapHeight);
+			return false;
+		}
+
+		// attempt to pack the bitmap
+		const int result = stbtt_BakeFontBitmap(ttf, 0, atlas->size, 
+										atlas->mapCPU, atlas->mapWidth, atlas->mapHeight,
+									     firstGlyph, numGlyphs, bakeCoords.data());
+
+		if( result == 0 )
+		{
+			LogError(LOG_CUDA "failed to bake font bitmap '%s'\n", atlas->path.c_str());
+			return false;
+		}
+		else if( result < 0 )
+		{
+			const int glyphsPacked = -result;
+
+			if( glyphsPacked == numGlyphs )
+			{
+				LogVerbose(LOG_CUDA "packed %u glyphs in %ux%u bitmap (font size=%.0fpx)\n", numGlyphs, atlas->mapWidth, atlas->mapHeight, atlas->size);
+				break;
+			}
+
+		#ifdef DEBUG_FONT
+			LogDebug(LOG_CUDA "fit only %i of %u font glyphs in %ux%u bitmap\n", glyphsPacked, numGlyphs, atlas->mapWidth, atlas->mapHeight);
+		#endif
+
+			cudaFreeMapped(atlas->mapCPU);
+		
+			atlas->mapCPU = NULL; 
+			atlas->mapGPU = NULL;
+
+			atlas->mapWidth *= 2;
+			atlas->mapHeight *= 2;
+
+		#ifdef DEBUG_FONT
+			LogDebug(LOG_CUDA "attempting to pack font with %ux%u bitmap...\n", atlas->mapWidth, atlas->mapHeight);
+		#endif
+			continue;
+		}
+		else
+		{
+		#ifdef DEBUG_FONT
+			LogDebug(LOG_CUDA "packed %u glyphs in %ux%u bitmap (font size=%.0fpx)\n", numGlyphs, atlas->mapWidth, atlas->mapHeight, atlas->size);
+		#endif		
+			break;
+		}
+	}
+
+	// store texture baking coordinates
+	atlas->glyphs.resize(numGlyphs);
+
+	for( uint32_t n=0; n < numGlyphs; n++ )
+	{
+		atlas->glyphs[n].x = bakeCoords[n].x0;
+		atlas->glyphs[n].y = bakeCoords[n].y0;
+
+		atlas->glyphs[n].width  = bakeCoords[n].x1 - bakeCoords[n].x0;
+		atlas->glyphs[n].height = bakeCoords[n].y1 - bakeCoords[n].y0;
+
+		atlas->glyphs[n].xAdvance = bakeCoords[n].xadvance;
+		atlas->glyphs[n].xOffset  = bakeCoords[n].xoff;
+		atlas->glyphs[n].yOffset  = bakeCoords[n].yoff;
+	}
+
+	return true;
+}
+
+
+// rasterize a signed-distance-field font map, which can be scaled to any size
+static bool bakeFontSDF( cudaFontAtlas* atlas, const uint8_t* ttf, uint32_t firstGlyph, uint32_t numGlyphs )
+{
+	stbtt_fontinfo font;
+
+	if( !stbtt_InitFont(&font, ttf, stbtt_GetFontOffsetForIndex(ttf, 0)) )
+	{
+		LogError(LOG_CUDA "failed to parse font '%s'\n", atlas->path.c_str());
+		return false;
+	}
+
+	const float scale = stbtt_ScaleForPixelHeight(&font, atlas->size);
+
+	// render the distance field of each glyph
+	std::vector<uint8_t*> bitmaps(numGlyphs, NULL);
+	atlas->glyphs.resize(numGlyphs);
+
+	for( uint32_t n=0; n < numGlyphs; n++ )
+	{
+		int width = 0, height = 0;
+		int xOffset = 0, yOffset = 0;
+		int advance = 0, lsb = 0;
+
+		stbtt_GetCodepointHMetrics(&font, n + firstGlyph, &advance, &lsb);
+
+		bitmaps[n] = stbtt_GetCodepointSDF(&font, scale, n + firstGlyph, SDF_PADDING, SDF_ONEDGE, SDF_DIST_SCALE,
+									&width, &height, &xOffset, &yOffset);
+
+		if( !bitmaps[n] )
+			width = height = 0;	// glyphs without an outline (like space)
+
+		atlas->glyphs[n].x = 0;
+		atlas->glyphs[n].y = 0;
+
+		atlas->glyphs[n].width  = width;
+		atlas->glyphs[n].height = height;
+
+		atlas->glyphs[n].xAdvance = advance * scale;
+		atlas->glyphs[n].xOffset  = xOffset;
+		atlas->glyphs[n].yOffset  = yOffset;
+	}
+
+	// pack the glyphs into rows (with a 1px border so that filtering doesn't bleed)
+	atlas->mapWidth  = 512;
+	atlas->mapHeight = 0;
+
+	int rowX = 1;
+	int rowY = 1;
+	int rowHeight = 0;
+
+	for( uint32_t n=0; n < numGlyphs; n++ )
+	{
+		cudaFontAtlas::Glyph& glyph = atlas->glyphs[n];
+
+		if( rowX + glyph.width + 1 > atlas->mapWidth )
+		{
+			rowX = 1;
+			rowY += rowHeight + 1;
+			rowHeight = 0;
+		}
+
+		glyph.x = rowX;
+		glyph.y = rowY;
+
+		rowX += glyph.width + 1;
+
+		if( rowHeight < glyph.height )
+			rowHeight = glyph.height;
+	}
+
+	atlas->mapHeight = rowY + rowHeight + 1;
+
+	// allocate the font map and copy the glyphs into it
+	const size_t fontMapSize = atlas->mapWidth * atlas->mapHeight * sizeof(unsigned char);
+
+	if( !cudaAllocMapped((void**)&atlas->mapCPU, (void**)&atlas->mapGPU, fontMapSize, CUDA_MEMORY_FONT) )
+	{
+		LogError(LOG_CUDA "failed to allocate %zu bytes to store %ix%i font map\n", fontMapSize, atlas->mapWidth, atlas->mapHeight);
+
+		for( uint32_t n=0; n < numGlyphs; n++ )
+			stbtt_FreeSDF(bitmaps[n], NULL);
+
+		return false;
+	}
+
+	for( uint32_t n=0; n < numGlyphs; n++ )
+	{
+		cudaFontAtlas::Glyph& glyph = atlas->glyphs[n];
+
+		if( !bitmaps[n] )
+			continue;
+
+		for( int y=0; y < glyph.height; y++ )
+			memcpy(atlas->mapCPU + (glyph.y + y) * atlas->mapWidth + glyph.x, bitmaps[n] + y * glyph.width, glyph.width);
+
+		stbtt_FreeSDF(bitmaps[n], NULL);
+
+		// the layout doesn't apply xOffset, so trim the left padding (leaving 1px)
+		const int trim = -glyph.xOffset - 1;
+
+		if( trim > 0 && trim < glyph.width )
+		{
+			glyph.x += trim;
+			glyph.width -= trim;
+			glyph.xOffset += trim;
+		}
+	}
+
+	LogVerbose(LOG_CUDA "packed %u SDF glyphs in %ux%u bitmap\n", numGlyphs, atlas->mapWidth, atlas->mapHeight);
+	return true;
+}
+
+
+// free a font atlas
+static void freeFontAtlas( cudaFontAtlas* atlas )
+{
+	if( !atlas )
+		return;
+
+	if( atlas->mapCPU != NULL )
+		cudaFreeMapped(atlas->mapCPU);
+
+	delete atlas;
+}
+
+
+// bake the atlas if it wasn't already (blocks while another thread is baking it)
+static bool bakeFontAtlas( cudaFontAtlas* atlas )
+{
+	atlas->bakeMutex.Lock();
+
+	if( !atlas->baked )
+	{
+		void* ttf = loadFontFile(atlas->path.c_str());
+
+		if( ttf != NULL )
+		{
+			if( atlas->sdf )
+				atlas->valid = bakeFontSDF(atlas, (uint8_t*)ttf, atlas->firstGlyph, atlas->numGlyphs);
+			else
+				atlas->valid = bakeFontBitmap(atlas, (uint8_t*)ttf, atlas->firstGlyph, atlas->numGlyphs);
+
+			free(ttf);
+		}
+
+		if( !atlas->valid )
+			LogError(LOG_CUDA "failed to load font '%s'\n", atlas->path.c_str());
+
+		atlas->baked = true;
+	}
+
+	atlas->bakeMutex.Unlock();
+	return atlas->valid;
+}
+
+
+static void releaseFontAtlas( cudaFontAtlas* atlas );
+
+// thread pool task that bakes an atlas ahead of its first use
+static void bakeFontTask( void* user_param )
+{
+	cudaFontAtlas* atlas = (cudaFontAtlas*)user_param;
+
+	bakeFontAtlas(atlas);
+	releaseFontAtlas(atlas);
+}
+
+
+// find the font in the cache, or start loading it if it wasn't already
+static cudaFontAtlas* acquireFontAtlas( const char* filename, float size, bool sdf, uint32_t firstGlyph, uint32_t numGlyphs )
+{
+	// SDF atlases can be used at any size, so they are only keyed by path
+	const float atlasSize = sdf ? SDF_BASE_SIZE : size;
+
+	gFontCacheMutex.Lock();
+
+	for( size_t n=0; n < gFontCache.size(); n++ )
+	{
+		cudaFontAtlas* atlas = gFontCache[n];
+
+		if( atlas->sdf == sdf && atlas->size == atlasSize && atlas->path == filename )
+		{
+			atlas->refCount++;
+			gFontCacheMutex.Unlock();
+			return atlas;
+		}
+	}
+
+	// check the file up-front, so that Create() can still fall back to the next font
+	if( fileSize(filename) == 0 )
+	{
+		gFontCacheMutex.Unlock();
+		LogError(LOG_CUDA "font doesn't exist or empty file '%s'\n", filename);
+		return NULL;
+	}
+
+	cudaFontAtlas* atlas = new cudaFontAtlas();
+
+	atlas->path       = filename;
+	atlas->size       = atlasSize;
+	atlas->sdf        = sdf;
+	atlas->refCount   = 2;	// one reference is held by the baking task
+	atlas->baked      = false;
+	atlas->valid      = false;
+	atlas->firstGlyph = firstGlyph;
+	atlas->numGlyphs  = numGlyphs;
+	atlas->mapCPU     = NULL;
+	atlas->mapGPU     = NULL;
+	atlas->mapWidth   = 0;
+	atlas->mapHeight  = 0;
+
+	gFontCache.push_back(atlas);
+	gFontCacheMutex.Unlock();
+
+	// rasterize the font in the background while the rest of the app initializes
+	if( !ThreadPool::Global()->Submit(bakeFontTask, atlas) )
+		bakeFontTask(atlas);
+
+	return atlas;
+}
+
+
+// release a reference to an atlas, and free it when it's no longer used
+static void releaseFontAtlas( cudaFontAtlas* atlas )
+{
+	if( !atlas )
+		return;
+
+	gFontCacheMutex.Lock();
+
+	if( --atlas->refCount == 0 )
+	{
+		for( size_t n=0; n < gFontCache.size(); n++ )
+		{
+			if( gFontCache[n] == atlas )
+			{
+				gFontCache.erase(gFontCache.begin() + n);
+				break;
+			}
+		}
+
+		freeFontAtlas(atlas);
+	}
+
+	gFontCacheMutex.Unlock();
+}
+
+
 // constructor
 cudaFont::cudaFont()
 {
-	mSize = 0.0f;
+	mSize  = 0.0f;
+	mScale = 1.0f;
+	mSDF   = false;
+	mAtlas = NULL;
+	mLoaded = false;
 	
 	mCommandCPU = NULL;
 	mCommandGPU = NULL;
@@ -86,8 +541,11 @@ cudaFont::cudaFont()
 	mRectsGPU   = NULL;
 	mRectIndex  = 0;
 
-	mFontMapWidth  = 256;
-	mFontMapHeight = 256;
+	mBatchGPU   = NULL;
+	mBatchSize  = 0;
+
+	mFontMapWidth  = 0;
+	mFontMapHeight = 0;
 }
 
 
@@ -95,9 +553,16 @@ cudaFont::cudaFont()
 // destructor
 cudaFont::~cudaFont()
 {
+	if( mBatchGPU != NULL )
+	{
+		cudaMemorySubtract(CUDA_MEMORY_FONT, mBatchSize);
+		CUDA(cudaFree(mBatchGPU));
+		mBatchGPU = NULL;
+	}
+
 	if( mRectsCPU != NULL )
 	{
-		CUDA(cudaFreeHost(mRectsCPU));
+		cudaFreeMapped(mRectsCPU);
 		
 		mRectsCPU = NULL; 
 		mRectsGPU = NULL;
@@ -105,24 +570,23 @@ cudaFont::~cudaFont()
 
 	if( mCommandCPU != NULL )
 	{
-		CUDA(cudaFreeHost(mCommandCPU));
+		cudaFreeMapped(mCommandCPU);
 		
 		mCommandCPU = NULL; 
 		mCommandGPU = NULL;
 	}
 
-	if( mFontMapCPU != NULL )
-	{
-		CUDA(cudaFreeHost(mFontMapCPU));
-		
-		mFontMapCPU = NULL; 
-		mFontMapGPU = NULL;
-	}
+	// the font map is owned by the cache
+	releaseFontAtlas(mAtlas);
+
+	mAtlas = NULL;
+	mFontMapCPU = NULL; 
+	mFontMapGPU = NULL;
 }
 
 
 // Create
-cudaFont* cudaFont::Create( float size )
+cudaFont* cudaFont::Create( float size, bool sdf )
 {
 	// default fonts	
 	std::vector<std::string> fonts;
@@ -130,18 +594,18 @@ cudaFont* cudaFont::Create( float size )
 	fonts.push_back("/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf");
 	fonts.push_back("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf");
 
-	return Create(fonts, size);
+	return Create(fonts, size, sdf);
 }
 
 
 // Create
-cudaFont* cudaFont::Create( const std::vector<std::string>& fonts, float size )
+cudaFont* cudaFont::Create( const std::vector<std::string>& fonts, float size, bool sdf )
 {
 	const uint32_t numFonts = fonts.size();
 
 	for( uint32_t n=0; n < numFonts; n++ )
 	{
-		cudaFont* font = Create(fonts[n].c_str(), size);
+		cudaFont* font = Create(fonts[n].c_str(), size, sdf);
 
 		if( font != NULL )
 			return font;
@@ -152,11 +616,11 @@ cudaFont* cudaFont::Create( const std::vector<std::string>& fonts, float size )
 
 
 // Create
-cudaFont* cudaFont::Create( const char* font, float size )
+cudaFont* cudaFont::Create( const char* font, float size, bool sdf )
 {
 	// verify parameters
 	if( !font )
-		return Create(size);
+		return Create(size, sdf);
 
 	// create new font
 	cudaFont* c = new cudaFont();
@@ -164,7 +628,7 @@ cudaFont* cudaFont::Create( const char* font, float size )
 	if( !c )
 		return NULL;
 		
-	if( !c->init(font, size) )
+	if( !c->init(font, size, sdf) )
 	{
 		delete c;
 		return NULL;
@@ -175,132 +639,105 @@ cudaFont* cudaFont::Create( const char* font, float size )
 
 
 // init
-bool cudaFont::init( const char* filename, float size )
+bool cudaFont::init( const char* filename, float size, bool sdf )
 {
 	// validate parameters
-	if( !filename )
-		return NULL;
-
-	// verify that the font file exists and get its size
-	const size_t ttf_size = fileSize(filename);
-
-	if( !ttf_size )
-	{
-		LogError(LOG_CUDA "font doesn't exist or empty file '%s'\n", filename);
- 		return false;
-	}
+	if( !filename || size <= 0.0f )
+		return false;
 
-	// allocate memory to store the font file
-	void* ttf_buffer = malloc(ttf_size);
+	// get the font map from the cache (the first time it gets baked in the background)
+	mAtlas = acquireFontAtlas(filename, size, sdf, FirstGlyph, NumGlyphs);
 
-	if( !ttf_buffer )
-	{
-		LogError(LOG_CUDA "failed to allocate %zu byte buffer for reading '%s'\n", ttf_size, filename);
+	if( !mAtlas )
 		return false;
-	}
 
-	// open the font file
-	FILE* ttf_file = fopen(filename, "rb");
+	mSDF  = sdf;
+	mSize = size;
 
-	if( !ttf_file )
-	{
-		LogError(LOG_CUDA "failed to open '%s' for reading\n", filename);
-		free(ttf_buffer);
+	// allocate memory for GPU command buffer	
+	if( !cudaAllocMapped(&mCommandCPU, &mCommandGPU, sizeof(GlyphCommand) * MaxCommands, CUDA_MEMORY_FONT) )
+		return false;
+	
+	// allocate memory for background rect buffers
+	if( !cudaAllocMapped((void**)&mRectsCPU, (void**)&mRectsGPU, sizeof(float4) * MaxCommands, CUDA_MEMORY_FONT) )
 		return false;
-	}
 
-	// read the font file
-	const size_t ttf_read = fread(ttf_buffer, 1, ttf_size, ttf_file);
+	return true;
+}
 
-	fclose(ttf_file);
 
-	if( ttf_read != ttf_size )
-	{
-		LogError(LOG_CUDA "failed to read contents of '%s'\n", filename);
-		LogError(LOG_CUDA "(read %zu bytes, expected %zu bytes)\n", ttf_read, ttf_size);
+// load (wait for the atlas to be baked, and scale the glyphs)
+bool cudaFont::load()
+{
+	if( mLoaded )
+		return true;
 
-		free(ttf_buffer);
+	if( !bakeFontAtlas(mAtlas) )
 		return false;
-	}
 
-	// buffer that stores the coordinates of the baked glyphs
-	stbtt_bakedchar bakeCoords[NumGlyphs];
+	mFontMapCPU    = mAtlas->mapCPU;
+	mFontMapGPU    = mAtlas->mapGPU;
+	mFontMapWidth  = mAtlas->mapWidth;
+	mFontMapHeight = mAtlas->mapHeight;
 
-	// increase the size of the bitmap until all the glyphs fit
-	while(true)
-	{
-		// allocate memory for the packed font texture (alpha only)
-		const size_t fontMapSize = mFontMapWidth * mFontMapHeight * sizeof(unsigned char);
+	updateGlyphs();
 
-		if( !cudaAllocMapped((void**)&mFontMapCPU, (void**)&mFontMapGPU, fontMapSize) )
-		{
-			LogError(LOG_CUDA "failed to allocate %zu bytes to store %ix%i font map\n", fontMapSize, mFontMapWidth, mFontMapHeight);
-			free(ttf_buffer);
-			return false;
-		}
+	mLoaded = true;
+	return true;
+}
+
+
+// SetSize
+bool cudaFont::SetSize( float size )
+{
+	if( size <= 0.0f || !mAtlas )
+		return false;
+
+	if( size == mSize )
+		return true;
 
-		// attempt to pack the bitmap
-		const int result = stbtt_BakeFontBitmap((uint8_t*)ttf_buffer, 0, size, 
-										mFontMapCPU, mFontMapWidth, mFontMapHeight,
-									     FirstGlyph, NumGlyphs, bakeCoords);
+	if( !mSDF )
+	{
+		// bitmap fonts need a font map baked at the new size
+		cudaFontAtlas* atlas = acquireFontAtlas(mAtlas->path.c_str(), size, false, FirstGlyph, NumGlyphs);
 
-		if( result == 0 )
-		{
-			LogError(LOG_CUDA "failed to bake font bitmap '%s'\n", filename);
-			free(ttf_buffer);
+		if( !atlas )
 			return false;
-		}
-		else if( result < 0 )
-		{
-			const int glyphsPacked = -result;
 
-			if( glyphsPacked == NumGlyphs )
-			{
-				LogVerbose(LOG_CUDA "packed %u glyphs in %ux%u bitmap (font size=%.0fpx)\n", NumGlyphs, mFontMapWidth, mFontMapHeight, size);
-				break;
-			}
+		releaseFontAtlas(mAtlas);
 
-		#ifdef DEBUG_FONT
-			LogDebug(LOG_CUDA "fit only %i of %u font glyphs in %ux%u bitmap\n", glyphsPacked, NumGlyphs, mFontMapWidth, mFontMapHeight);
-		#endif
+		mAtlas  = atlas;
+		mLoaded = false;
+	}
 
-			CUDA(cudaFreeHost(mFontMapCPU));
-		
-			mFontMapCPU = NULL; 
-			mFontMapGPU = NULL;
+	mSize = size;
 
-			mFontMapWidth *= 2;
-			mFontMapHeight *= 2;
+	if( mLoaded )
+		updateGlyphs();
 
-		#ifdef DEBUG_FONT
-			LogDebug(LOG_CUDA "attempting to pack font with %ux%u bitmap...\n", mFontMapWidth, mFontMapHeight);
-		#endif
-			continue;
-		}
-		else
-		{
-		#ifdef DEBUG_FONT
-			LogDebug(LOG_CUDA "packed %u glyphs in %ux%u bitmap (font size=%.0fpx)\n", NumGlyphs, mFontMapWidth, mFontMapHeight, size);
-		#endif		
-			break;
-		}
-	}
+	return true;
+}
 
-	// free the TTF font data
-	free(ttf_buffer);
 
-	// store texture baking coordinates
+// updateGlyphs
+void cudaFont::updateGlyphs()
+{
+	mScale = mSDF ? (mSize / mAtlas->size) : 1.0f;
+
+	// scale the glyph metrics to the size of the font
 	for( uint32_t n=0; n < NumGlyphs; n++ )
 	{
-		mGlyphInfo[n].x = bakeCoords[n].x0;
-		mGlyphInfo[n].y = bakeCoords[n].y0;
+		const cudaFontAtlas::Glyph& glyph = mAtlas->glyphs[n];
 
-		mGlyphInfo[n].width  = bakeCoords[n].x1 - bakeCoords[n].x0;
-		mGlyphInfo[n].height = bakeCoords[n].y1 - bakeCoords[n].y0;
+		mGlyphInfo[n].x = glyph.x;
+		mGlyphInfo[n].y = glyph.y;
 
-		mGlyphInfo[n].xAdvance = bakeCoords[n].xadvance;
-		mGlyphInfo[n].xOffset  = bakeCoords[n].xoff;
-		mGlyphInfo[n].yOffset  = bakeCoords[n].yoff;
+		mGlyphInfo[n].width  = ceilf(glyph.width * mScale);
+		mGlyphInfo[n].height = ceilf(glyph.height * mScale);
+
+		mGlyphInfo[n].xAdvance = glyph.xAdvance * mScale;
+		mGlyphInfo[n].xOffset  = glyph.xOffset * mScale;
+		mGlyphInfo[n].yOffset  = glyph.yOffset * mScale;
 
 	#ifdef DEBUG_FONT
 		// debug info
@@ -308,17 +745,6 @@ bool cudaFont::init( const char* filename, float size )
 		LogDebug("Glyph %u: '%c' width=%hu height=%hu xOffset=%.0f yOffset=%.0f xAdvance=%0.1f\n", n, c, mGlyphInfo[n].width, mGlyphInfo[n].height, mGlyphInfo[n].xOffset, mGlyphInfo[n].yOffset, mGlyphInfo[n].xAdvance);
 	#endif	
 	}
-
-	// allocate memory for GPU command buffer	
-	if( !cudaAllocMapped(&mCommandCPU, &mCommandGPU, sizeof(GlyphCommand) * MaxCommands) )
-		return false;
-	
-	// allocate memory for background rect buffers
-	if( !cudaAllocMapped((void**)&mRectsCPU, (void**)&mRectsGPU, sizeof(float4) * MaxCommands) )
-		return false;
-
-	mSize = size;
-	return true;
 }
 
 
@@ -339,55 +765,168 @@ inline __host__ __device__ float4 alpha_blend( const float4& bg, const float4& f
 } 
 
 
-template<typename T>
-__global__ void gpuOverlayText( unsigned char* font, int fontWidth, GlyphCommand* commands,
-						  T* input, T* output, int imgWidth, int imgHeight, float4 color ) 
+// sample the coverage (0-1) of a glyph pixel from the font map
+template<bool SDF>
+inline __device__ float sampleGlyph( const unsigned char* font, int fontWidth, int u, int v, int width, int height, int x, int y, float scale )
 {
-	const GlyphCommand cmd = commands[blockIdx.x];
+	if( !SDF )
+		return font[(v + y) * fontWidth + u + x] / 255.0f;
 
-	if( threadIdx.x >= cmd.width || threadIdx.y >= cmd.height )
-		return;
+	// bilinear sample of the distance field (clamped to the glyph's box)
+	const float maxU = fmaxf((width / scale) - 1.0f, 0.0f);
+	const float maxV = fmaxf((height / scale) - 1.0f, 0.0f);
 
-	const int x = cmd.x + threadIdx.x;
-	const int y = cmd.y + threadIdx.y;
+	const float su = fminf(fmaxf((x + 0.5f) / scale - 0.5f, 0.0f), maxU);
+	const float sv = fminf(fmaxf((y + 0.5f) / scale - 0.5f, 0.0f), maxV);
+
+	const int u0 = su;
+	const int v0 = sv;
+	const int u1 = fminf(u0 + 1, maxU);
+	const int v1 = fminf(v0 + 1, maxV);
+
+	const float fu = su - u0;
+	const float fv = sv - v0;
+
+	const float d00 = font[(v + v0) * fontWidth + u + u0];
+	const float d01 = font[(v + v0) * fontWidth + u + u1];
+	const float d10 = font[(v + v1) * fontWidth + u + u0];
+	const float d11 = font[(v + v1) * fontWidth + u + u1];
+
+	const float d = (d00 * (1.0f - fu) + d01 * fu) * (1.0f - fv) + 
+				 (d10 * (1.0f - fu) + d11 * fu) * fv;
+
+	// the distance changes by SDF_DIST_SCALE/scale per output pixel
+	return fminf(fmaxf((d - SDF_ONEDGE) * scale / SDF_DIST_SCALE + 0.5f, 0.0f), 1.0f);
+}
+
+
+// render one glyph (the block loops over the glyph if it's bigger than the block)
+template<typename T, bool SDF>
+inline __device__ void overlayGlyph( const unsigned char* font, int fontWidth, int cmd_x, int cmd_y, int cmd_u, int cmd_v, 
+							  int cmd_width, int cmd_height, float scale, const float4& color,
+							  T* input, T* output, int imgWidth, int imgHeight )
+{
+	for( int gy=threadIdx.y; gy < cmd_height; gy += blockDim.y )
+	{
+		const int y = cmd_y + gy;
+
+		if( y < 0 || y >= imgHeight )
+			continue;
+
+		for( int gx=threadIdx.x; gx < cmd_width; gx += blockDim.x )
+		{
+			const int x = cmd_x + gx;
+
+			if( x < 0 || x >= imgWidth )
+				continue;
+
+			const float px_glyph = sampleGlyph<SDF>(font, fontWidth, cmd_u, cmd_v, cmd_width, cmd_height, gx, gy, scale);
+
+			const float4 px_font = make_float4(px_glyph * color.x, px_glyph * color.y, px_glyph * color.z, px_glyph * color.w);
+			const float4 px_in   = cast_vec<float4>(input[y * imgWidth + x]);
+
+			output[y * imgWidth + x] = cast_vec<T>(alpha_blend(px_in, px_font));
+		}
+	}
+}
 
-	if( x < 0 || y < 0 || x >= imgWidth || y >= imgHeight )
-		return;
 
-	const int u = cmd.u + threadIdx.x;
-	const int v = cmd.v + threadIdx.y;
+template<typename T, bool SDF>
+__global__ void gpuOverlayText( unsigned char* font, int fontWidth, GlyphCommand* commands,
+						  T* input, T* output, int imgWidth, int imgHeight, float4 color, float scale ) 
+{
+	const GlyphCommand cmd = commands[blockIdx.x];
 
-	const float px_glyph = font[v * fontWidth + u];
+	overlayGlyph<T, SDF>(font, fontWidth, cmd.x, cmd.y, cmd.u, cmd.v, cmd.width, cmd.height, 
+					 scale, color, input, output, imgWidth, imgHeight);
+}
 
-	const float4 px_font = make_float4(px_glyph * color.x, px_glyph * color.y, px_glyph * color.z, px_glyph * color.w);
-	const float4 px_in   = cast_vec<float4>(input[y * imgWidth + x]);
 
-	output[y * imgWidth + x] = cast_vec<T>(alpha_blend(px_in, px_font));	 
+// limit the block size for large glyphs (each thread then renders multiple pixels)
+static inline dim3 glyphBlockDim( const int2& maxGlyphSize )
+{
+	return dim3(maxGlyphSize.x < 32 ? maxGlyphSize.x : 32, 
+			  maxGlyphSize.y < 32 ? maxGlyphSize.y : 32);
 }
 
 
 // cudaOverlayText
 cudaError_t cudaOverlayText( unsigned char* font, const int2& maxGlyphSize, size_t fontMapWidth,
 					    GlyphCommand* commands, size_t numCommands, const float4& fontColor, 
-					    void* input, void* output, imageFormat format, size_t imgWidth, size_t imgHeight)	
+					    void* input, void* output, imageFormat format, size_t imgWidth, size_t imgHeight,
+					    bool sdf, float scale )	
 {
+	NVTX_RANGE("cudaOverlayText");
+
 	if( !font || !commands || !input || !output || numCommands == 0 || fontMapWidth == 0 || imgWidth == 0 || imgHeight == 0 )
 		return cudaErrorInvalidValue;
 
-	const float4 color_scaled = make_float4( fontColor.x / 255.0f, fontColor.y / 255.0f, fontColor.z / 255.0f, fontColor.w / 255.0f );
-	
 	// setup arguments
-	const dim3 block(maxGlyphSize.x, maxGlyphSize.y);
+	const dim3 block = glyphBlockDim(maxGlyphSize);
+	const dim3 grid(numCommands);
+
+	#define LAUNCH_OVERLAY_TEXT(type) \
+		if( sdf ) \
+			gpuOverlayText<type, true><<<grid, block>>>(font, fontMapWidth, commands, (type*)input, (type*)output, imgWidth, imgHeight, fontColor, scale); \
+		else \
+			gpuOverlayText<type, false><<<grid, block>>>(font, fontMapWidth, commands, (type*)input, (type*)output, imgWidth, imgHeight, fontColor, scale)
+
+	if( format == IMAGE_RGB8 )
+		LAUNCH_OVERLAY_TEXT(uchar3);
+	else if( format == IMAGE_RGBA8 )
+		LAUNCH_OVERLAY_TEXT(uchar4);
+	else if( format == IMAGE_RGB32F )
+		LAUNCH_OVERLAY_TEXT(float3);
+	else if( format == IMAGE_RGBA32F )
+		LAUNCH_OVERLAY_TEXT(float4);
+	else
+		return cudaErrorInvalidValue;
+
+	return cudaGetLastError();
+}
+
+
+template<typename T, bool SDF>
+__global__ void gpuOverlayTextBatch( unsigned char* font, int fontWidth, GlyphBatchCommand* commands,
+							  T* image, int imgWidth, int imgHeight, float scale ) 
+{
+	const GlyphBatchCommand cmd = commands[blockIdx.x];
+	const float4 color = make_float4(cmd.color.x, cmd.color.y, cmd.color.z, cmd.color.w);
+
+	overlayGlyph<T, SDF>(font, fontWidth, cmd.x, cmd.y, cmd.u, cmd.v, cmd.width, cmd.height, 
+					 scale, color, image, image, imgWidth, imgHeight);
+}
+
+
+// cudaOverlayTextBatch
+cudaError_t cudaOverlayTextBatch( unsigned char* font, const int2& maxGlyphSize, size_t fontMapWidth,
+						    GlyphBatchCommand* commands, size_t numCommands, 
+						    void* image, imageFormat format, size_t imgWidth, size_t imgHeight,
+						    bool sdf, float scale, cudaStream_t stream )	
+{
+	NVTX_RANGE("cudaOverlayTextBatch");
+
+	if( !font || !commands || !image || numCommands == 0 || fontMapWidth == 0 || imgWidth == 0 || imgHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	// setup arguments
+	const dim3 block = glyphBlockDim(maxGlyphSize);
 	const dim3 grid(numCommands);
 
+	#define LAUNCH_OVERLAY_TEXT_BATCH(type) \
+		if( sdf ) \
+			gpuOverlayTextBatch<type, true><<<grid, block, 0, stream>>>(font, fontMapWidth, commands, (type*)image, imgWidth, imgHeight, scale); \
+		else \
+			gpuOverlayTextBatch<type, false><<<grid, block, 0, stream>>>(font, fontMapWidth, commands, (type*)image, imgWidth, imgHeight, scale)
+
 	if( format == IMAGE_RGB8 )
-		gpuOverlayText<uchar3><<<grid, block>>>(font, fontMapWidth, commands, (uchar3*)input, (uchar3*)output, imgWidth, imgHeight, color_scaled); 
+		LAUNCH_OVERLAY_TEXT_BATCH(uchar3);
 	else if( format == IMAGE_RGBA8 )
-		gpuOverlayText<uchar4><<<grid, block>>>(font, fontMapWidth, commands, (uchar4*)input, (uchar4*)output, imgWidth, imgHeight, color_scaled); 
+		LAUNCH_OVERLAY_TEXT_BATCH(uchar4);
 	else if( format == IMAGE_RGB32F )
-		gpuOverlayText<float3><<<grid, block>>>(font, fontMapWidth, commands, (float3*)input, (float3*)output, imgWidth, imgHeight, color_scaled); 
+		LAUNCH_OVERLAY_TEXT_BATCH(float3);
 	else if( format == IMAGE_RGBA32F )
-		gpuOverlayText<float4><<<grid, block>>>(font, fontMapWidth, commands, (float4*)input, (float4*)output, imgWidth, imgHeight, color_scaled); 
+		LAUNCH_OVERLAY_TEXT_BATCH(float4);
 	else
 		return cudaErrorInvalidValue;
 
@@ -395,6 +934,23 @@ cudaError_t cudaOverlayText( unsigned char* font, const int2& maxGlyphSize, size
 }
 
 
+// check that the image format is supported
+static bool validateFontFormat( imageFormat format, const char* function )
+{
+	if( format == IMAGE_RGB8 || format == IMAGE_RGBA8 || format == IMAGE_RGB32F || format == IMAGE_RGBA32F )
+		return true;
+
+	LogError(LOG_CUDA "cudaFont::%s() -- unsupported image format (%s)\n", function, imageFormatToStr(format));
+	LogError(LOG_CUDA "                           supported formats are:\n");
+	LogError(LOG_CUDA "                              * rgb8\n");		
+	LogError(LOG_CUDA "                              * rgba8\n");		
+	LogError(LOG_CUDA "                              * rgb32f\n");		
+	LogError(LOG_CUDA "                              * rgba32f\n");
+
+	return false;
+}
+
+
 // Overlay
 bool cudaFont::OverlayText( void* image, imageFormat format, uint32_t width, uint32_t height, 
 					   const std::vector< std::pair< std::string, int2 > >& strings, 
@@ -405,18 +961,11 @@ bool cudaFont::OverlayText( void* image, imageFormat format, uint32_t width, uin
 	if( !image || width == 0 || height == 0 || numStrings == 0 )
 		return false;
 
-	if( format != IMAGE_RGB8 && format != IMAGE_RGBA8 && format != IMAGE_RGB32F && format != IMAGE_RGBA32F )
-	{
-		LogError(LOG_CUDA "cudaFont::OverlayText() -- unsupported image format (%s)\n", imageFormatToStr(format));
-		LogError(LOG_CUDA "                           supported formats are:\n");
-		LogError(LOG_CUDA "                              * rgb8\n");		
-		LogError(LOG_CUDA "                              * rgba8\n");		
-		LogError(LOG_CUDA "                              * rgb32f\n");		
-		LogError(LOG_CUDA "                              * rgba32f\n");
-
+	if( !validateFontFormat(format, "OverlayText") || !load() )
 		return false;
-	}
 
+	NVTX_RANGE("cudaFont::OverlayText");
+	PROFILER_SCOPE_CUDA("cudaFont::OverlayText", NULL);
 	
 	const bool has_bg = bg_color.w > 0.0f;
 	int2 maxGlyphSize = make_int2(0,0);
@@ -562,7 +1111,7 @@ bool cudaFont::OverlayText( void* image, imageFormat format, uint32_t width, uin
 	// draw text characters
 	CUDA(cudaOverlayText( mFontMapGPU, maxGlyphSize, mFontMapWidth,
 				       ((GlyphCommand*)mCommandGPU) + mCmdIndex, numCommands, 
-					  color, image, image, format, width, height));
+					  color, image, image, format, width, height, mSDF, mScale));
 			
 	// advance the buffer indices
 	mCmdIndex += numCommands;
@@ -588,10 +1137,239 @@ bool cudaFont::OverlayText( void* image, imageFormat format, uint32_t width, uin
 }
 
 
+// AddText
+bool cudaFont::AddText( const char* str, int x, int y, const float4& color, const float4& bg_color, int bg_padding )
+{
+	if( !str )
+		return false;
+
+	QueuedText text;
+
+	text.str        = str;
+	text.pos        = make_int2(x,y);
+	text.color      = color;
+	text.background = bg_color;
+	text.padding    = bg_padding;
+
+	mTextQueue.push_back(text);
+	return true;
+}
+
+
+// Flush
+bool cudaFont::Flush( void* image, imageFormat format, uint32_t width, uint32_t height, cudaStream_t stream )
+{
+	const uint32_t numStrings = mTextQueue.size();
+
+	if( numStrings == 0 )
+		return true;
+
+	if( !image || width == 0 || height == 0 )
+	{
+		mTextQueue.clear();
+		return false;
+	}
+
+	if( !validateFontFormat(format, "Flush") || !load() )
+	{
+		mTextQueue.clear();
+		return false;
+	}
+
+	// count the characters and background rects
+	uint32_t maxChars = 0;
+	uint32_t maxRects = 0;
+
+	for( uint32_t s=0; s < numStrings; s++ )
+	{
+		maxChars += mTextQueue[s].str.size();
+
+		if( mTextQueue[s].background.w > 0.0f )
+			maxRects++;
+	}
+
+	// the command buffer has the background rects first, followed by the glyphs
+	const size_t rectsSize = maxRects * sizeof(cudaDrawPrimitive);
+	const size_t batchSize = rectsSize + maxChars * sizeof(GlyphBatchCommand);
+
+	if( mBatchCPU.size() < batchSize )
+		mBatchCPU.resize(batchSize);
+
+	cudaDrawPrimitive* rects = (cudaDrawPrimitive*)mBatchCPU.data();
+	GlyphBatchCommand* glyphs = (GlyphBatchCommand*)(mBatchCPU.data() + rectsSize);
+
+	int2 maxGlyphSize = make_int2(0,0);
+
+	uint32_t numCommands = 0;
+	uint32_t numRects = 0;
+
+	// generate glyph commands and bg rects
+	for( uint32_t s=0; s < numStrings; s++ )
+	{
+		const QueuedText& text = mTextQueue[s];
+		const uint32_t numChars = text.str.size();
+		
+		if( numChars == 0 )
+			continue;
+
+		// determine the max 'height' of the string
+		int maxHeight = 0;
+
+		for( uint32_t n=0; n < numChars; n++ )
+		{
+			char c = text.str[n];
+			
+			if( c < FirstGlyph || c > LastGlyph )
+				continue;
+			
+			c -= FirstGlyph;
+
+			const int yOffset = abs((int)mGlyphInfo[c].yOffset);
+
+			if( maxHeight < yOffset )
+				maxHeight = yOffset;
+		}
+
+		// get the starting position of the string
+		int2 pos = text.pos;
+
+		if( pos.x < 0 )
+			pos.x = 0;
+
+		if( pos.y < 0 )
+			pos.y = 0;
+		
+		pos.y += maxHeight;
+
+		// reset the background rect
+		const bool has_bg = text.background.w > 0.0f;
+		int4 bg = make_int4(width, height, 0, 0);
+
+		const uchar4 color = make_uchar4(text.color.x, text.color.y, text.color.z, text.color.w);
+		const uint32_t firstCommand = numCommands;
+
+		// make a glyph command for each character
+		for( uint32_t n=0; n < numChars; n++ )
+		{
+			char c = text.str[n];
+			
+			// make sure the character is in range
+			if( c < FirstGlyph || c > LastGlyph )
+				continue;
+			
+			c -= FirstGlyph;	// rebase char against glyph 0
+			
+			// fill the next command
+			GlyphBatchCommand* cmd = glyphs + numCommands;
+
+			cmd->x = pos.x;
+			cmd->y = pos.y + mGlyphInfo[c].yOffset;
+			cmd->u = mGlyphInfo[c].x;
+			cmd->v = mGlyphInfo[c].y;
+
+			cmd->width  = mGlyphInfo[c].width;
+			cmd->height = mGlyphInfo[c].height;
+			cmd->color  = color;
+		
+			// advance the text position
+			pos.x += mGlyphInfo[c].xAdvance;
+
+			// track the maximum glyph size
+			if( maxGlyphSize.x < mGlyphInfo[c].width )
+				maxGlyphSize.x = mGlyphInfo[c].width;
+
+			if( maxGlyphSize.y < mGlyphInfo[c].height )
+				maxGlyphSize.y = mGlyphInfo[c].height;
+
+			// expand the background rect
+			if( has_bg )
+			{
+				if( cmd->x < bg.x )
+					bg.x = cmd->x;
+
+				if( cmd->y < bg.y )
+					bg.y = cmd->y;
+
+				if( cmd->x + cmd->width > bg.z )
+					bg.z = cmd->x + cmd->width;
+
+				if( cmd->y + cmd->height > bg.w )
+					bg.w = cmd->y + cmd->height;
+			}
+
+			numCommands++;
+		}
+
+		if( has_bg && numCommands > firstCommand )
+		{
+			cudaDrawPrimitive* rect = rects + numRects;
+
+			rect->type  = CUDA_DRAW_RECT;
+			rect->color = text.background;
+			rect->x1    = bg.x - text.padding;
+			rect->y1    = bg.y - text.padding;
+			rect->x2    = bg.z + text.padding;
+			rect->y2    = bg.w + text.padding;
+			rect->size  = 0.0f;
+
+			numRects++;
+		}
+	}
+
+	mTextQueue.clear();
+
+	if( numCommands == 0 )
+		return true;
+
+	// grow the GPU command buffer if needed
+	if( batchSize > mBatchSize )
+	{
+		if( mBatchGPU != NULL )
+		{
+			cudaMemorySubtract(CUDA_MEMORY_FONT, mBatchSize);
+			CUDA(cudaFree(mBatchGPU));
+		}
+
+		mBatchGPU = NULL;
+		mBatchSize = 0;
+
+		if( CUDA_FAILED(cudaMalloc(&mBatchGPU, batchSize)) )
+		{
+			LogError(LOG_CUDA "cudaFont::Flush() -- failed to allocate %zu bytes for the command buffer\n", batchSize);
+			return false;
+		}
+
+		mBatchSize = batchSize;
+		cudaMemoryAdd(CUDA_MEMORY_FONT, batchSize);
+	}
+
+	// upload the whole batch at once
+	if( CUDA_FAILED(cudaMemcpyAsync(mBatchGPU, mBatchCPU.data(), batchSize, cudaMemcpyHostToDevice, stream)) )
+		return false;
+
+	// draw background rects
+	if( numRects > 0 )
+	{
+		if( CUDA_FAILED(cudaDrawPrimitives(image, image, width, height, format, (cudaDrawPrimitive*)mBatchGPU, numRects, stream)) )
+			return false;
+	}
+
+	// draw text characters
+	if( CUDA_FAILED(cudaOverlayTextBatch(mFontMapGPU, maxGlyphSize, mFontMapWidth,
+								  (GlyphBatchCommand*)((uint8_t*)mBatchGPU + rectsSize), numCommands,
+								  image, format, width, height, mSDF, mScale, stream)) )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
 // TextExtents
 int4 cudaFont::TextExtents( const char* str, int x, int y )
 {
-	if( !str )
+	if( !str || !load() )
 		return make_int4(0,0,0,0);
 
 	const size_t numChars = strlen(str);
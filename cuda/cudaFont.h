@@ -42,8 +42,22 @@
 float adaptFontSize( uint32_t dimension );
 
 
+/**
+ * Font map that is shared between cudaFont objects (internal use)
+ * @ingroup cudaFont
+ */
+struct cudaFontAtlas;
+
+
 /**
  * TTF font rasterization and image overlay rendering using CUDA.
+ *
+ * The rasterized font maps are kept in a process-wide cache keyed by the TTF path,
+ * so creating multiple fonts from the same file only loads it once.  By default the
+ * glyphs are baked into a bitmap at the requested size.  In SDF mode, they are
+ * instead baked once as signed distance fields, which can be scaled to render sharp
+ * text at any size - so every SDF font from the same file shares one font map.
+ *
  * @ingroup cudaFont
  */
 class cudaFont
@@ -52,15 +66,17 @@ public:
 	/**
 	 * Create new CUDA font overlay object using baked fonts.
 	 * @param size The desired height of the font, in pixels.
+	 * @param sdf If true, use a signed distance field font map that can be scaled.
 	 */
-	static cudaFont* Create( float size=32.0f );
+	static cudaFont* Create( float size=32.0f, bool sdf=false );
 
 	/**
 	 * Create new CUDA font overlay object using baked fonts.
 	 * @param font The name of the TTF font to use.
 	 * @param size The desired height of the font, in pixels.
+	 * @param sdf If true, use a signed distance field font map that can be scaled.
 	 */
-	static cudaFont* Create( const char* font, float size );
+	static cudaFont* Create( const char* font, float size, bool sdf=false );
 	
 	/**
 	 * Create new CUDA font overlay object using baked fonts.
@@ -68,8 +84,9 @@ public:
 	 *             If the first font isn't found on the system,
 	 *             then the next font from the list will be tried.
 	 * @param size The desired height of the font, in pixels.
+	 * @param sdf If true, use a signed distance field font map that can be scaled.
 	 */
-	static cudaFont* Create( const std::vector<std::string>& fonts, float size );
+	static cudaFont* Create( const std::vector<std::string>& fonts, float size, bool sdf=false );
 
 	/**
 	 * Destructor
@@ -120,10 +137,60 @@ public:
 		return OverlayText(image, imageFormatFromType<T>(), width, height, text, color, background, backgroundPadding); 
 	}
 
+	/**
+	 * Queue text to be rendered later by Flush(), instead of immediately.
+	 *
+	 * Many strings (each with their own position and colors) can be queued,
+	 * and then they all get drawn together with one upload to the GPU.  This
+	 * is faster than calling OverlayText() for each string, which uploads and
+	 * launches the kernels once for every call.
+	 */
+	bool AddText( const char* str, int x, int y, 
+			    const float4& color=make_float4(0, 0, 0, 255),
+			    const float4& background=make_float4(0, 0, 0, 0),
+			    int backgroundPadding=5 );
+
+	/**
+	 * Render all of the text that was queued with AddText() onto the image,
+	 * and then clear the queue.  The backgrounds are drawn with one kernel
+	 * launch and all of the glyphs with another, on the specified stream.
+	 */
+	bool Flush( void* image, imageFormat format, uint32_t width, uint32_t height, cudaStream_t stream=NULL );
+
+	/**
+	 * Render all of the text that was queued with AddText() onto the image.
+	 */
+	template<typename T> bool Flush( T* image, uint32_t width, uint32_t height, cudaStream_t stream=NULL )
+	{
+		return Flush(image, imageFormatFromType<T>(), width, height, stream);
+	}
+
+	/**
+	 * Return the number of strings that are queued for Flush()
+	 */
+	inline uint32_t GetQueuedText() const		{ return mTextQueue.size(); }
+
+	/**
+	 * Remove all of the queued text without rendering it.
+	 */
+	inline void ClearText()					{ mTextQueue.clear(); }
+
 	/**
 	 * Return the size of the font (height in pixels)
 	 */
 	inline float GetSize() const	{ return mSize; }
+
+	/**
+	 * Change the size of the font (height in pixels).
+	 * SDF fonts are just scaled, while bitmap fonts use a font map
+	 * baked at the new size (which gets loaded if it isn't cached).
+	 */
+	bool SetSize( float size );
+
+	/**
+	 * Return true if the font uses a signed distance field font map.
+	 */
+	inline bool IsSDF() const		{ return mSDF; }
 	
 	/**
 	 * Return the bounding rectangle of the given text string.
@@ -133,9 +200,16 @@ public:
 
 protected:
 	cudaFont();
-	bool init( const char* font, float size );
+	bool init( const char* font, float size, bool sdf );
+	bool load();
+	void updateGlyphs();
 		
 	float mSize;
+	float mScale;	// scale from the font map to mSize (SDF only)
+	bool  mSDF;
+
+	cudaFontAtlas* mAtlas;
+	bool mLoaded;	// the atlas was baked and the glyphs scaled
 		
 	uint8_t* mFontMapCPU;
 	uint8_t* mFontMapGPU;
@@ -151,6 +225,21 @@ protected:
 	float4* mRectsGPU;
 	int     mRectIndex;
 
+	struct QueuedText
+	{
+		std::string str;
+		int2   pos;
+		float4 color;
+		float4 background;
+		int    padding;
+	};
+
+	std::vector<QueuedText> mTextQueue;
+	std::vector<uint8_t>    mBatchCPU;	// staging for the batch command buffer
+
+	void*  mBatchGPU;
+	size_t mBatchSize;
+
 	static const uint32_t MaxCommands = 1024;
 	static const uint32_t FirstGlyph  = 32;
 	static const uint32_t LastGlyph   = 255;
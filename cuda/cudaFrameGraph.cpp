@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaFrameGraph.h"
+#include "logging.h"
+
+
+// constructor
+cudaFrameGraph::cudaFrameGraph( uint32_t maxGraphs )
+{
+	mCaptureStream  = NULL;
+	mMaxGraphs      = (maxGraphs > 0) ? maxGraphs : 1;
+	mFrame          = 0;
+	mReplays        = 0;
+	mUpdates        = 0;
+	mInstantiations = 0;
+}
+
+
+// destructor
+cudaFrameGraph::~cudaFrameGraph()
+{
+	Reset();
+
+	if( mCaptureStream != NULL )
+	{
+		CUDA(cudaStreamDestroy(mCaptureStream));
+		mCaptureStream = NULL;
+	}
+}
+
+
+// Reset
+void cudaFrameGraph::Reset()
+{
+	for( size_t n=0; n < mEntries.size(); n++ )
+		release(&mEntries[n]);
+
+	mEntries.clear();
+}
+
+
+// release
+void cudaFrameGraph::release( Entry* entry )
+{
+	if( entry->exec != NULL )
+	{
+		CUDA(cudaGraphExecDestroy(entry->exec));
+		entry->exec = NULL;
+	}
+
+	if( entry->graph != NULL )
+	{
+		CUDA(cudaGraphDestroy(entry->graph));
+		entry->graph = NULL;
+	}
+}
+
+
+// capture
+cudaError_t cudaFrameGraph::capture( cudaFrameGraphFunction function, void* user, cudaGraph_t* graph )
+{
+	// capture on a private stream, because the legacy default stream can't be captured
+	if( !mCaptureStream )
+	{
+		if( CUDA_FAILED(cudaStreamCreateWithFlags(&mCaptureStream, cudaStreamNonBlocking)) )
+			return cudaErrorInitializationError;
+	}
+
+#if CUDART_VERSION >= 10010
+	const cudaError_t beginResult = cudaStreamBeginCapture(mCaptureStream, cudaStreamCaptureModeThreadLocal);
+#else
+	const cudaError_t beginResult = cudaStreamBeginCapture(mCaptureStream);
+#endif
+
+	if( beginResult != cudaSuccess )
+		return CUDA(beginResult);
+
+	const cudaError_t result = function(mCaptureStream, user);
+
+	cudaGraph_t captured = NULL;
+	const cudaError_t endResult = cudaStreamEndCapture(mCaptureStream, &captured);
+
+	if( result != cudaSuccess || endResult != cudaSuccess )
+	{
+		if( captured != NULL )
+			cudaGraphDestroy(captured);
+
+		LogError(LOG_CUDA "cudaFrameGraph -- failed to capture the sequence (%s)\n", cudaGetErrorString((result != cudaSuccess) ? result : endResult));
+		return (result != cudaSuccess) ? result : endResult;
+	}
+
+	*graph = captured;
+	return cudaSuccess;
+}
+
+
+// instantiate
+cudaError_t cudaFrameGraph::instantiate( Entry* entry, cudaGraph_t graph )
+{
+	release(entry);
+
+	cudaGraphExec_t exec = NULL;
+
+#if CUDART_VERSION >= 12000
+	const cudaError_t result = cudaGraphInstantiate(&exec, graph, 0);
+#else
+	const cudaError_t result = cudaGraphInstantiate(&exec, graph, NULL, NULL, 0);
+#endif
+
+	if( result != cudaSuccess )
+	{
+		cudaGraphDestroy(graph);
+		return CUDA(result);
+	}
+
+	entry->graph = graph;
+	entry->exec  = exec;
+
+	mInstantiations++;
+	return cudaSuccess;
+}
+
+
+// update
+bool cudaFrameGraph::update( Entry* entry, cudaGraph_t graph )
+{
+	if( !entry->graph || !entry->exec )
+		return false;
+
+	// the graphs need the same nodes, in the same order
+	size_t numNodes = 0;
+	size_t numNewNodes = 0;
+
+	if( cudaGraphGetNodes(entry->graph, NULL, &numNodes) != cudaSuccess || cudaGraphGetNodes(graph, NULL, &numNewNodes) != cudaSuccess )
+		return false;
+
+	if( numNodes != numNewNodes || numNodes == 0 )
+		return false;
+
+	std::vector<cudaGraphNode_t> nodes(numNodes);
+	std::vector<cudaGraphNode_t> newNodes(numNodes);
+
+	if( cudaGraphGetNodes(entry->graph, nodes.data(), &numNodes) != cudaSuccess || cudaGraphGetNodes(graph, newNodes.data(), &numNewNodes) != cudaSuccess )
+		return false;
+
+	for( size_t n=0; n < numNodes; n++ )
+	{
+		cudaGraphNodeType type;
+		cudaGraphNodeType newType;
+
+		if( cudaGraphNodeGetType(nodes[n], &type) != cudaSuccess || cudaGraphNodeGetType(newNodes[n], &newType) != cudaSuccess )
+			return false;
+
+		if( type != newType )
+			return false;
+
+		if( type == cudaGraphNodeTypeKernel )
+		{
+			cudaKernelNodeParams params;
+			cudaKernelNodeParams newParams;
+
+			if( cudaGraphKernelNodeGetParams(nodes[n], &params) != cudaSuccess || cudaGraphKernelNodeGetParams(newNodes[n], &newParams) != cudaSuccess )
+				return false;
+
+			// a kernel's function can't be changed
+			if( params.func != newParams.func )
+				return false;
+
+			if( cudaGraphExecKernelNodeSetParams(entry->exec, nodes[n], &newParams) != cudaSuccess )
+				return false;
+		}
+	#if CUDART_VERSION >= 10020
+		else if( type == cudaGraphNodeTypeMemcpy )
+		{
+			cudaMemcpy3DParms params;
+
+			if( cudaGraphMemcpyNodeGetParams(newNodes[n], &params) != cudaSuccess )
+				return false;
+
+			if( cudaGraphExecMemcpyNodeSetParams(entry->exec, nodes[n], &params) != cudaSuccess )
+				return false;
+		}
+		else if( type == cudaGraphNodeTypeMemset )
+		{
+			cudaMemsetParams params;
+
+			if( cudaGraphMemsetNodeGetParams(newNodes[n], &params) != cudaSuccess )
+				return false;
+
+			if( cudaGraphExecMemsetNodeSetParams(entry->exec, nodes[n], &params) != cudaSuccess )
+				return false;
+		}
+	#endif
+		else if( type != cudaGraphNodeTypeEmpty )
+		{
+			return false;
+		}
+	}
+
+	// the new graph isn't needed, the exec keeps referring to the nodes of the old one
+	cudaGraphDestroy(graph);
+
+	mUpdates++;
+	return true;
+}
+
+
+// Run
+cudaError_t cudaFrameGraph::Run( cudaFrameGraphFunction function, void* user, cudaStream_t stream, const void* key )
+{
+	if( !function )
+		return cudaErrorInvalidValue;
+
+	mFrame++;
+
+	// replay a cached graph
+	if( key != NULL )
+	{
+		for( size_t n=0; n < mEntries.size(); n++ )
+		{
+			if( mEntries[n].key == key && mEntries[n].exec != NULL )
+			{
+				mEntries[n].lastUsed = mFrame;
+				mReplays++;
+
+				return CUDA(cudaGraphLaunch(mEntries[n].exec, stream));
+			}
+		}
+	}
+
+	// capture the sequence (this doesn't execute it)
+	cudaGraph_t graph = NULL;
+	const cudaError_t result = capture(function, user, &graph);
+
+	if( result != cudaSuccess )
+		return result;
+
+	Entry* entry = NULL;
+
+	if( mEntries.size() < mMaxGraphs )
+	{
+		Entry newEntry;
+
+		newEntry.key      = key;
+		newEntry.graph    = NULL;
+		newEntry.exec     = NULL;
+		newEntry.lastUsed = mFrame;
+
+		mEntries.push_back(newEntry);
+		entry = &mEntries.back();
+
+		if( instantiate(entry, graph) != cudaSuccess )
+		{
+			mEntries.pop_back();
+			return cudaErrorInvalidValue;
+		}
+	}
+	else
+	{
+		// re-use the least-recently-used graph
+		entry = &mEntries[0];
+
+		for( size_t n=1; n < mEntries.size(); n++ )
+		{
+			if( mEntries[n].lastUsed < entry->lastUsed )
+				entry = &mEntries[n];
+		}
+
+		entry->key = key;
+		entry->lastUsed = mFrame;
+
+		if( !update(entry, graph) )
+		{
+			LogVerbose(LOG_CUDA "cudaFrameGraph -- the sequence changed, instantiating a new graph\n");
+
+			if( instantiate(entry, graph) != cudaSuccess )
+			{
+				entry->key = NULL;
+				return cudaErrorInvalidValue;
+			}
+		}
+	}
+
+	return CUDA(cudaGraphLaunch(entry->exec, stream));
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_FRAME_GRAPH_H__
+#define __CUDA_FRAME_GRAPH_H__
+
+
+#include "cudaUtility.h"
+
+#include <vector>
+
+
+/**
+ * Function pointer typedef of a sequence of operations that's captured by cudaFrameGraph.
+ * All of the operations should be queued on `stream`.
+ * @ingroup cuda
+ */
+typedef cudaError_t (*cudaFrameGraphFunction)( cudaStream_t stream, void* user );
+
+
+/**
+ * Captures a fixed per-frame sequence of CUDA operations (for example convert, resize,
+ * normalize, overlay) into a CUDA graph, and replays it each frame with a single launch.
+ *
+ * Run() queues the sequence on a stream.  Graphs are cached by a key, which is usually
+ * the image pointer that changes between frames (like the input from a videoSource,
+ * which cycles through a small ring of buffers).  When the key matches a cached graph,
+ * it's launched without calling the function at all.  Otherwise the sequence is captured
+ * again (which doesn't execute it), and the kernel parameters of the new capture are
+ * patched into the least-recently-used executable graph with cudaGraphExecKernelNodeSetParams()
+ * instead of instantiating a new one.  If the structure of the sequence changed, the graph
+ * is instantiated again.
+ *
+ * With a NULL key, the sequence is captured and patched every frame, which still saves the
+ * cost of submitting each launch individually.
+ *
+ * The function must only queue work on the stream that it's given:  it can't synchronize,
+ * allocate memory, or use the legacy default stream while it's being captured.
+ * Everything that it reads from host memory is read again every time the graph is replayed.
+ *
+ * @ingroup cuda
+ */
+class cudaFrameGraph
+{
+public:
+	/**
+	 * Create an empty graph cache.
+	 * @param maxGraphs the maximum number of executable graphs that are kept (one per key).
+	 */
+	cudaFrameGraph( uint32_t maxGraphs=8 );
+
+	/**
+	 * Destructor
+	 */
+	~cudaFrameGraph();
+
+	/**
+	 * Run the sequence on `stream` (see above for how it's captured and replayed).
+	 */
+	cudaError_t Run( cudaFrameGraphFunction function, void* user, cudaStream_t stream, const void* key=NULL );
+
+	/**
+	 * Run the sequence on `stream`, with the function being any callable
+	 * (like a lambda) that takes a cudaStream_t and returns a cudaError_t.
+	 */
+	template<typename F> cudaError_t Run( F function, cudaStream_t stream, const void* key=NULL )
+	{
+		return Run(&callFunction<F>, &function, stream, key);
+	}
+
+	/**
+	 * Release all of the graphs, so the sequence gets captured again next time.
+	 */
+	void Reset();
+
+	/**
+	 * Return the number of times that a graph was replayed from the cache.
+	 */
+	inline uint64_t GetReplays() const		{ return mReplays; }
+
+	/**
+	 * Return the number of times that the sequence was captured and patched into an existing graph.
+	 */
+	inline uint64_t GetUpdates() const		{ return mUpdates; }
+
+	/**
+	 * Return the number of times that a graph was instantiated.
+	 */
+	inline uint64_t GetInstantiations() const	{ return mInstantiations; }
+
+protected:
+	struct Entry
+	{
+		const void*     key;
+		cudaGraph_t     graph;	// the graph that the exec was instantiated from
+		cudaGraphExec_t exec;
+		uint64_t        lastUsed;
+	};
+
+	template<typename F> static cudaError_t callFunction( cudaStream_t stream, void* user )
+	{
+		return (*(F*)user)(stream);
+	}
+
+	cudaError_t capture( cudaFrameGraphFunction function, void* user, cudaGraph_t* graph );
+	cudaError_t instantiate( Entry* entry, cudaGraph_t graph );
+	bool update( Entry* entry, cudaGraph_t graph );
+	void release( Entry* entry );
+
+	std::vector<Entry> mEntries;
+	cudaStream_t mCaptureStream;
+
+	uint32_t mMaxGraphs;
+	uint64_t mFrame;
+	uint64_t mReplays;
+	uint64_t mUpdates;
+	uint64_t mInstantiations;
+};
+
+#endif
@@ -0,0 +1,732 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaFusedChain.h"
+#include "logging.h"
+#include "Mutex.h"
+
+#include <cuda.h>
+#include <nvrtc.h>
+
+#include <map>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+
+//
+// NVRTC can't include the cuda/ headers (they pull in host headers like stdio.h),
+// so the sampling, alpha blending and colormap functions from cudaFilterMode.cuh,
+// cudaAlphaBlend.cuh and cudaColormap.cu are reproduced here for float4 pixels.
+//
+static const char* fusedPrelude =
+"struct fusedOp { float4 a; int4 i; const void* ptr; float pad[2]; };\n"
+"struct fusedParams { float4 map; fusedOp ops[FUSED_MAX_OPS]; };\n"
+"\n"
+"__device__ inline float4 fused_read( const void* input, int x, int y, int width )\n"
+"{\n"
+"	const IN_T* ptr = (const IN_T*)input + (y * width + x) * IN_CHANNELS;\n"
+"#if IN_CHANNELS == 1\n"
+"	return make_float4(ptr[0], ptr[0], ptr[0], 255.0f);\n"
+"#elif IN_CHANNELS == 3\n"
+"	float4 px = make_float4(ptr[0], ptr[1], ptr[2], 255.0f);\n"
+"#else\n"
+"	float4 px = make_float4(ptr[0], ptr[1], ptr[2], ptr[3]);\n"
+"#endif\n"
+"#if IN_CHANNELS > 1\n"
+"#if IN_BGR\n"
+"	const float tmp = px.x; px.x = px.z; px.z = tmp;\n"
+"#endif\n"
+"	return px;\n"
+"#endif\n"
+"}\n"
+"\n"
+"__device__ inline float4 fused_sample( const void* input, float x, float y, int width, int height )\n"
+"{\n"
+"#if FILTER_LINEAR\n"
+"	const float bx = x - 0.5f;\n"
+"	const float by = y - 0.5f;\n"
+"	const float cx = bx < 0.0f ? 0.0f : bx;\n"
+"	const float cy = by < 0.0f ? 0.0f : by;\n"
+"	const int x1 = int(cx);\n"
+"	const int y1 = int(cy);\n"
+"	const int x2 = x1 >= width - 1 ? x1 : x1 + 1;\n"
+"	const int y2 = y1 >= height - 1 ? y1 : y1 + 1;\n"
+"	const float x2f = cx - float(x1);\n"
+"	const float y2f = cy - float(y1);\n"
+"	const float x1f = 1.0f - x2f;\n"
+"	const float y1f = 1.0f - y2f;\n"
+"	const float4 s0 = fused_read(input, x1, y1, width);\n"
+"	const float4 s1 = fused_read(input, x2, y1, width);\n"
+"	const float4 s2 = fused_read(input, x1, y2, width);\n"
+"	const float4 s3 = fused_read(input, x2, y2, width);\n"
+"	return make_float4(s0.x * x1f * y1f + s1.x * x2f * y1f + s2.x * x1f * y2f + s3.x * x2f * y2f,\n"
+"	                   s0.y * x1f * y1f + s1.y * x2f * y1f + s2.y * x1f * y2f + s3.y * x2f * y2f,\n"
+"	                   s0.z * x1f * y1f + s1.z * x2f * y1f + s2.z * x1f * y2f + s3.z * x2f * y2f,\n"
+"	                   s0.w * x1f * y1f + s1.w * x2f * y1f + s2.w * x1f * y2f + s3.w * x2f * y2f);\n"
+"#else\n"
+"	return fused_read(input, min(int(x), width - 1), min(int(y), height - 1), width);\n"
+"#endif\n"
+"}\n"
+"\n"
+"__device__ inline void fused_write( void* output, int x, int y, int width, float4 px )\n"
+"{\n"
+"	OUT_T* ptr = (OUT_T*)output + (y * width + x) * OUT_CHANNELS;\n"
+"#if OUT_CHANNELS == 1\n"
+"	const float v[1] = { px.x * 0.2989f + px.y * 0.5870f + px.z * 0.1140f };\n"
+"#elif OUT_BGR\n"
+"	const float v[4] = { px.z, px.y, px.x, px.w };\n"
+"#else\n"
+"	const float v[4] = { px.x, px.y, px.z, px.w };\n"
+"#endif\n"
+"	#pragma unroll\n"
+"	for( int n=0; n < OUT_CHANNELS; n++ )\n"
+"#if OUT_FLOAT\n"
+"		ptr[n] = v[n];\n"
+"#else\n"
+"		ptr[n] = (unsigned char)(fmaxf(fminf(v[n], 255.0f), 0.0f) + 0.5f);\n"
+"#endif\n"
+"}\n"
+"\n"
+"__device__ inline float4 fused_normalize( float4 px, const fusedOp& op )\n"
+"{\n"
+"	return make_float4((px.x - op.a.x) * op.a.y + op.a.z,\n"
+"	                   (px.y - op.a.x) * op.a.y + op.a.z,\n"
+"	                   (px.z - op.a.x) * op.a.y + op.a.z, px.w);\n"
+"}\n"
+"\n"
+"__device__ inline float4 fused_colormap( float4 px, const fusedOp& op )\n"
+"{\n"
+"	const float value = fmaxf(fminf((px.x - op.a.x) * op.a.y, 255.0f), 0.0f);\n"
+"	return ((const float4*)op.ptr)[(int)value];\n"
+"}\n"
+"\n"
+"__device__ inline float4 fused_overlay( float4 px, int x, int y, const fusedOp& op )\n"
+"{\n"
+"	const int ox = x - op.i.x;\n"
+"	const int oy = y - op.i.y;\n"
+"	if( ox < 0 || oy < 0 || ox >= op.i.z || oy >= op.i.w )\n"
+"		return px;\n"
+"	const int idx = oy * op.i.z + ox;\n"
+"	float4 src;\n"
+"	if( op.a.x > 0.0f )\n"
+"		src = ((const float4*)op.ptr)[idx];\n"
+"	else\n"
+"	{\n"
+"		const uchar4 s = ((const uchar4*)op.ptr)[idx];\n"
+"		src = make_float4(s.x, s.y, s.z, s.w);\n"
+"	}\n"
+"	const float alph = src.w / 255.0f;\n"
+"	const float inva = 1.0f - alph;\n"
+"	return make_float4(alph * src.x + inva * px.x, alph * src.y + inva * px.y, alph * src.z + inva * px.z, 255.0f);\n"
+"}\n"
+"\n";
+
+
+// compiled kernels that are shared between the chains (keyed by device and source hash)
+static std::map<std::string, CUfunction> gFunctions;
+static Mutex gFunctionMutex;
+
+
+// isSupported
+static bool isSupported( imageFormat format )
+{
+	switch(format)
+	{
+		case IMAGE_RGB8:
+		case IMAGE_RGBA8:
+		case IMAGE_BGR8:
+		case IMAGE_BGRA8:
+		case IMAGE_RGB32F:
+		case IMAGE_RGBA32F:
+		case IMAGE_BGR32F:
+		case IMAGE_BGRA32F:
+		case IMAGE_GRAY8:
+		case IMAGE_GRAY32F:	return true;
+		default:			return false;
+	}
+}
+
+
+// hashSource (64-bit FNV-1a)
+static uint64_t hashSource( const std::string& str )
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for( size_t n=0; n < str.size(); n++ )
+	{
+		hash ^= (uint8_t)str[n];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+// cacheDir
+static std::string cacheDir()
+{
+	const char* env = getenv("JETSON_UTILS_FUSED_CACHE");
+
+	if( env != NULL && strlen(env) > 0 )
+		return env;
+
+	const char* home = getenv("HOME");
+
+	if( !home )
+		return "";
+
+	const std::string cache = std::string(home) + "/.cache";
+	const std::string dir = cache + "/jetson-utils";
+
+	mkdir(cache.c_str(), 0755);
+	mkdir(dir.c_str(), 0755);
+
+	return dir;
+}
+
+
+// readFile
+static bool readFile( const std::string& path, std::vector<char>& buffer )
+{
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if( !file )
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if( size <= 0 )
+	{
+		fclose(file);
+		return false;
+	}
+
+	buffer.resize(size + 1);	// NULL-terminated for PTX
+
+	const bool result = (fread(buffer.data(), 1, size, file) == (size_t)size);
+	buffer[size] = 0;
+
+	fclose(file);
+	return result;
+}
+
+
+// compileSource
+static bool compileSource( const std::string& source, int major, int minor, std::vector<char>& binary, bool* cubin )
+{
+	nvrtcProgram program;
+
+	if( nvrtcCreateProgram(&program, source.c_str(), "cudaFusedChain.cu", 0, NULL, NULL) != NVRTC_SUCCESS )
+	{
+		LogError(LOG_CUDA "cudaFusedChain -- failed to create NVRTC program\n");
+		return false;
+	}
+
+	// compile straight to SASS when NVRTC supports it, otherwise to PTX (which the driver JITs)
+	char arch[64];
+
+#if CUDART_VERSION >= 11010
+	snprintf(arch, sizeof(arch), "--gpu-architecture=sm_%d%d", major, minor);
+	*cubin = true;
+#else
+	snprintf(arch, sizeof(arch), "--gpu-architecture=compute_%d%d", major, minor);
+	*cubin = false;
+#endif
+
+	const char* options[] = { arch, "--std=c++11" };
+	const nvrtcResult result = nvrtcCompileProgram(program, 2, options);
+
+	if( result != NVRTC_SUCCESS )
+	{
+		size_t logSize = 0;
+		nvrtcGetProgramLogSize(program, &logSize);
+
+		std::vector<char> log(logSize + 1, 0);
+		nvrtcGetProgramLog(program, log.data());
+
+		LogError(LOG_CUDA "cudaFusedChain -- failed to compile the fused kernel (%s)\n%s\n", nvrtcGetErrorString(result), log.data());
+		nvrtcDestroyProgram(&program);
+		return false;
+	}
+
+	size_t size = 0;
+
+#if CUDART_VERSION >= 11010
+	if( nvrtcGetCUBINSize(program, &size) == NVRTC_SUCCESS && size > 0 )
+	{
+		binary.resize(size);
+		nvrtcGetCUBIN(program, binary.data());
+	}
+#else
+	if( nvrtcGetPTXSize(program, &size) == NVRTC_SUCCESS && size > 0 )
+	{
+		binary.resize(size);
+		nvrtcGetPTX(program, binary.data());
+	}
+#endif
+
+	nvrtcDestroyProgram(&program);
+	return (size > 0);
+}
+
+
+// loadFunction
+static CUfunction loadFunction( const std::string& source )
+{
+	int device = 0;
+
+	if( CUDA_FAILED(cudaGetDevice(&device)) )
+		return NULL;
+
+	cudaDeviceProp props;
+
+	if( CUDA_FAILED(cudaGetDeviceProperties(&props, device)) )
+		return NULL;
+
+	char key[128];
+	snprintf(key, sizeof(key), "fused-%016llx-sm%d%d", (unsigned long long)hashSource(source), props.major, props.minor);
+
+	char deviceKey[160];
+	snprintf(deviceKey, sizeof(deviceKey), "%d:%s", device, key);
+
+	gFunctionMutex.Lock();
+
+	std::map<std::string, CUfunction>::iterator iter = gFunctions.find(deviceKey);
+
+	if( iter != gFunctions.end() )
+	{
+		gFunctionMutex.Unlock();
+		return iter->second;
+	}
+
+	// make sure that the runtime's primary context is current for the driver API
+	cudaFree(0);
+
+	const std::string dir = cacheDir();
+	const std::string path = (dir.size() > 0) ? (dir + "/" + key) : "";
+
+	std::vector<char> binary;
+	CUmodule module = NULL;
+
+	// try to load it from the cache first
+	if( path.size() > 0 && (readFile(path + ".cubin", binary) || readFile(path + ".ptx", binary)) )
+	{
+		if( cuModuleLoadData(&module, binary.data()) != CUDA_SUCCESS )
+		{
+			LogWarning(LOG_CUDA "cudaFusedChain -- failed to load cached kernel %s, recompiling\n", path.c_str());
+			module = NULL;
+		}
+	}
+
+	if( !module )
+	{
+		bool cubin = false;
+
+		if( !compileSource(source, props.major, props.minor, binary, &cubin) )
+		{
+			gFunctionMutex.Unlock();
+			return NULL;
+		}
+
+		const CUresult result = cuModuleLoadData(&module, binary.data());
+
+		if( result != CUDA_SUCCESS )
+		{
+			const char* error = NULL;
+			cuGetErrorString(result, &error);
+
+			LogError(LOG_CUDA "cudaFusedChain -- failed to load the fused kernel (%s)\n", error != NULL ? error : "unknown error");
+			gFunctionMutex.Unlock();
+			return NULL;
+		}
+
+		LogVerbose(LOG_CUDA "cudaFusedChain -- compiled fused kernel %s\n", key);
+
+		if( path.size() > 0 )
+		{
+			const std::string file = path + (cubin ? ".cubin" : ".ptx");
+			FILE* fp = fopen(file.c_str(), "wb");
+
+			if( fp != NULL )
+			{
+				fwrite(binary.data(), 1, cubin ? binary.size() : strlen(binary.data()), fp);
+				fclose(fp);
+			}
+			else
+			{
+				LogWarning(LOG_CUDA "cudaFusedChain -- failed to save the compiled kernel to %s\n", file.c_str());
+			}
+		}
+	}
+
+	CUfunction function = NULL;
+
+	if( cuModuleGetFunction(&function, module, "fused_chain") != CUDA_SUCCESS )
+	{
+		LogError(LOG_CUDA "cudaFusedChain -- failed to find the fused_chain kernel in module %s\n", key);
+		cuModuleUnload(module);
+		gFunctionMutex.Unlock();
+		return NULL;
+	}
+
+	// the module stays loaded for the lifetime of the process
+	gFunctions[deviceKey] = function;
+	gFunctionMutex.Unlock();
+
+	return function;
+}
+
+
+// constructor
+cudaFusedChain::cudaFusedChain()
+{
+	mFunction = NULL;
+	mFunctionFormats[0] = IMAGE_UNKNOWN;
+	mFunctionFormats[1] = IMAGE_UNKNOWN;
+
+	Clear();
+}
+
+
+// destructor
+cudaFusedChain::~cudaFusedChain()
+{
+
+}
+
+
+// Clear
+void cudaFusedChain::Clear()
+{
+	mOps.clear();
+
+	mROI    = make_int4(0,0,0,0);
+	mCrop   = false;
+	mFilter = FILTER_LINEAR;
+	mDirty  = true;
+}
+
+
+// addOp
+bool cudaFusedChain::addOp( const Op& op )
+{
+	if( mOps.size() >= CUDA_FUSED_MAX_OPS )
+	{
+		LogError(LOG_CUDA "cudaFusedChain -- the chain already has the maximum of %i operators\n", CUDA_FUSED_MAX_OPS);
+		return false;
+	}
+
+	mOps.push_back(op);
+	mDirty = true;
+
+	return true;
+}
+
+
+// Crop
+bool cudaFusedChain::Crop( const int4& roi )
+{
+	if( roi.z <= roi.x || roi.w <= roi.y || roi.x < 0 || roi.y < 0 )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::Crop() -- invalid ROI (%i, %i, %i, %i)\n", roi.x, roi.y, roi.z, roi.w);
+		return false;
+	}
+
+	mROI  = roi;
+	mCrop = true;
+
+	return true;
+}
+
+
+// Resize
+bool cudaFusedChain::Resize( cudaFilterMode filter )
+{
+	if( filter != FILTER_POINT && filter != FILTER_LINEAR )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::Resize() -- only FILTER_POINT and FILTER_LINEAR are supported\n");
+		return false;
+	}
+
+	if( filter != mFilter )
+		mDirty = true;
+
+	mFilter = filter;
+	return true;
+}
+
+
+// Normalize
+bool cudaFusedChain::Normalize( const float2& input_range, const float2& output_range )
+{
+	if( input_range.y <= input_range.x )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::Normalize() -- invalid input range\n");
+		return false;
+	}
+
+	Op op;
+	memset(&op.params, 0, sizeof(OpParams));
+
+	op.type = OP_NORMALIZE;
+	op.params.a = make_float4(input_range.x, (output_range.y - output_range.x) / (input_range.y - input_range.x), output_range.x, 0.0f);
+
+	return addOp(op);
+}
+
+
+// Colormap
+bool cudaFusedChain::Colormap( cudaColormapType colormap, const float2& range )
+{
+	float4* palette = cudaColormapPalette(colormap);
+
+	if( !palette )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::Colormap() -- '%s' isn't a palette colormap\n", cudaColormapToStr(colormap));
+		return false;
+	}
+
+	Op op;
+	memset(&op.params, 0, sizeof(OpParams));
+
+	op.type = OP_COLORMAP;
+	op.params.a = make_float4(range.x, (range.y > range.x) ? 255.0f / (range.y - range.x) : 0.0f, 0.0f, 0.0f);
+	op.params.ptr = palette;
+
+	return addOp(op);
+}
+
+
+// Overlay
+bool cudaFusedChain::Overlay( void* image, uint32_t width, uint32_t height, imageFormat format, int x, int y )
+{
+	if( format != IMAGE_RGBA8 && format != IMAGE_RGBA32F )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::Overlay() -- the overlay needs to be rgba8 or rgba32f\n");
+		return false;
+	}
+
+	Op op;
+	memset(&op.params, 0, sizeof(OpParams));
+
+	op.type = OP_OVERLAY;
+	op.params.a.x = (format == IMAGE_RGBA32F) ? 1.0f : 0.0f;
+
+	if( !addOp(op) )
+		return false;
+
+	return SetOverlay(mOps.size() - 1, image, width, height, x, y);
+}
+
+
+// SetOverlay
+bool cudaFusedChain::SetOverlay( uint32_t index, void* image, uint32_t width, uint32_t height, int x, int y )
+{
+	if( index >= mOps.size() || mOps[index].type != OP_OVERLAY )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::SetOverlay() -- operator %u isn't an overlay\n", index);
+		return false;
+	}
+
+	if( !image || width == 0 || height == 0 )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::SetOverlay() -- invalid overlay image\n");
+		return false;
+	}
+
+	mOps[index].params.i   = make_int4(x, y, width, height);
+	mOps[index].params.ptr = image;
+
+	return true;
+}
+
+
+// Expression
+bool cudaFusedChain::Expression( const char* code, const float4& params )
+{
+	if( !code || strlen(code) == 0 )
+		return false;
+
+	Op op;
+	memset(&op.params, 0, sizeof(OpParams));
+
+	op.type = OP_EXPRESSION;
+	op.code = code;
+	op.params.a = params;
+
+	return addOp(op);
+}
+
+
+// SetParams
+bool cudaFusedChain::SetParams( uint32_t index, const float4& params )
+{
+	if( index >= mOps.size() || mOps[index].type != OP_EXPRESSION )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::SetParams() -- operator %u isn't an expression\n", index);
+		return false;
+	}
+
+	mOps[index].params.a = params;
+	return true;
+}
+
+
+// GenerateSource
+std::string cudaFusedChain::GenerateSource( imageFormat input_format, imageFormat output_format ) const
+{
+	const bool inFloat  = (imageFormatBaseType(input_format) == IMAGE_FLOAT);
+	const bool outFloat = (imageFormatBaseType(output_format) == IMAGE_FLOAT);
+
+	char defines[512];
+
+	snprintf(defines, sizeof(defines),
+		    "#define IN_T %s\n#define IN_CHANNELS %zu\n#define IN_BGR %i\n"
+		    "#define OUT_T %s\n#define OUT_CHANNELS %zu\n#define OUT_BGR %i\n#define OUT_FLOAT %i\n"
+		    "#define FILTER_LINEAR %i\n#define FUSED_MAX_OPS %i\n\n",
+		    inFloat ? "float" : "unsigned char", imageFormatChannels(input_format), (int)imageFormatIsBGR(input_format),
+		    outFloat ? "float" : "unsigned char", imageFormatChannels(output_format), (int)imageFormatIsBGR(output_format), (int)outFloat,
+		    (int)(mFilter == FILTER_LINEAR), CUDA_FUSED_MAX_OPS);
+
+	std::string source = defines;
+	source += fusedPrelude;
+
+	// the custom expressions each get their own function
+	for( size_t n=0; n < mOps.size(); n++ )
+	{
+		if( mOps[n].type != OP_EXPRESSION )
+			continue;
+
+		char func[128];
+		snprintf(func, sizeof(func), "__device__ inline void fused_expression%zu( float4& px, int x, int y, const float4& params )\n{\n", n);
+
+		source += func;
+		source += mOps[n].code;
+		source += "\n}\n\n";
+	}
+
+	source += "extern \"C\" __global__ void fused_chain( const void* input, int input_width, int input_height,\n"
+			"                                        void* output, int output_width, int output_height, fusedParams params )\n"
+			"{\n"
+			"	const int x = blockIdx.x * blockDim.x + threadIdx.x;\n"
+			"	const int y = blockIdx.y * blockDim.y + threadIdx.y;\n"
+			"	if( x >= output_width || y >= output_height )\n"
+			"		return;\n"
+			"	float4 px = fused_sample(input, x * params.map.x + params.map.z, y * params.map.y + params.map.w, input_width, input_height);\n";
+
+	for( size_t n=0; n < mOps.size(); n++ )
+	{
+		char line[128];
+
+		switch(mOps[n].type)
+		{
+			case OP_NORMALIZE:	snprintf(line, sizeof(line), "	px = fused_normalize(px, params.ops[%zu]);\n", n); break;
+			case OP_COLORMAP:	snprintf(line, sizeof(line), "	px = fused_colormap(px, params.ops[%zu]);\n", n); break;
+			case OP_OVERLAY:	snprintf(line, sizeof(line), "	px = fused_overlay(px, x, y, params.ops[%zu]);\n", n); break;
+			case OP_EXPRESSION:	snprintf(line, sizeof(line), "	fused_expression%zu(px, x, y, params.ops[%zu].a);\n", n, n); break;
+		}
+
+		source += line;
+	}
+
+	source += "	fused_write(output, x, y, output_width, px);\n}\n";
+	return source;
+}
+
+
+// Process
+cudaError_t cudaFusedChain::Process( void* input, uint32_t input_width, uint32_t input_height, imageFormat input_format,
+						       void* output, uint32_t output_width, uint32_t output_height, imageFormat output_format,
+						       cudaStream_t stream )
+{
+	if( !input || !output || input_width == 0 || input_height == 0 || output_width == 0 || output_height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( !isSupported(input_format) || !isSupported(output_format) )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::Process() -- unsupported image formats (%s -> %s)\n", imageFormatToStr(input_format), imageFormatToStr(output_format));
+		return cudaErrorInvalidValue;
+	}
+
+	if( mCrop && (mROI.z > (int)input_width || mROI.w > (int)input_height) )
+	{
+		LogError(LOG_CUDA "cudaFusedChain::Process() -- the crop ROI is outside of the input image\n");
+		return cudaErrorInvalidValue;
+	}
+
+	// get the kernel for these formats (compiled, or loaded from the cache)
+	if( mDirty || !mFunction || mFunctionFormats[0] != input_format || mFunctionFormats[1] != output_format )
+	{
+		mFunction = loadFunction(GenerateSource(input_format, output_format));
+
+		if( !mFunction )
+			return cudaErrorInvalidSource;
+
+		mFunctionFormats[0] = input_format;
+		mFunctionFormats[1] = output_format;
+		mDirty = false;
+	}
+
+	// map the output coordinates to the input (or the crop region)
+	const int4 roi = mCrop ? mROI : make_int4(0, 0, input_width, input_height);
+
+	Params params;
+	memset(&params, 0, sizeof(Params));
+
+	params.map = make_float4(float(roi.z - roi.x) / float(output_width),
+						float(roi.w - roi.y) / float(output_height),
+						float(roi.x), float(roi.y));
+
+	for( size_t n=0; n < mOps.size(); n++ )
+		params.ops[n] = mOps[n].params;
+
+	int inputWidth   = input_width;
+	int inputHeight  = input_height;
+	int outputWidth  = output_width;
+	int outputHeight = output_height;
+
+	void* args[] = { &input, &inputWidth, &inputHeight, &output, &outputWidth, &outputHeight, &params };
+
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(output_width,blockDim.x), iDivUp(output_height,blockDim.y));
+
+	const CUresult result = cuLaunchKernel((CUfunction)mFunction, gridDim.x, gridDim.y, 1, blockDim.x, blockDim.y, 1,
+								    0, (CUstream)stream, args, NULL);
+
+	if( result != CUDA_SUCCESS )
+	{
+		const char* error = NULL;
+		cuGetErrorString(result, &error);
+
+		LogError(LOG_CUDA "cudaFusedChain::Process() -- failed to launch the fused kernel (%s)\n", error != NULL ? error : "unknown error");
+		return cudaErrorLaunchFailure;
+	}
+
+	return cudaSuccess;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_FUSED_CHAIN_H__
+#define __CUDA_FUSED_CHAIN_H__
+
+
+#include "cudaUtility.h"
+#include "cudaFilterMode.h"
+#include "cudaColormap.h"
+#include "imageFormat.h"
+
+#include <string>
+#include <vector>
+
+
+/**
+ * The maximum number of operators in a cudaFusedChain.
+ * @ingroup cuda
+ */
+#define CUDA_FUSED_MAX_OPS 16
+
+
+/**
+ * Chain of per-pixel operators that gets compiled at runtime (with NVRTC) into a single
+ * fused kernel, so that a sequence like crop -> resize -> normalize -> colormap -> overlay
+ * reads the input once and writes the output once, without any intermediate images.
+ *
+ * The input is first sampled from the crop region (the whole image by default), scaled to
+ * the size of the output with point or bilinear filtering.  Then each pixel is passed as a
+ * float4 (in the range of the input format, i.e. [0,255] for uint8 formats) through the
+ * operators in the order that they were added, and converted to the output format.
+ *
+ * The generated source only depends on the operators and on the input/output formats.
+ * The coefficients (the crop region, normalization ranges, overlay images, ect) are kernel
+ * parameters, so they can be changed between frames without compiling again.  Compiled
+ * kernels are shared between chains in the process, and cached on disk in
+ * `~/.cache/jetson-utils/fused-<hash>-sm<XY>` (or the directory that the
+ * `JETSON_UTILS_FUSED_CACHE` environment variable points to), so the compilation
+ * only happens the first time that a chain is run on a device.
+ *
+ * The supported formats are rgb8, rgba8, rgb32f, rgba32f, their BGR equivalents, gray8 and gray32f.
+ *
+ * @ingroup cuda
+ */
+class cudaFusedChain
+{
+public:
+	/**
+	 * Create an empty chain (which converts the input to the output format).
+	 */
+	cudaFusedChain();
+
+	/**
+	 * Destructor
+	 */
+	~cudaFusedChain();
+
+	/**
+	 * Sample the input from a region of interest, given as (left, top, right, bottom).
+	 * This can be changed between frames without recompiling.
+	 */
+	bool Crop( const int4& roi );
+
+	/**
+	 * Set the filtering mode used to scale the input to the size of the output
+	 * (FILTER_POINT or FILTER_LINEAR, which is the default).
+	 */
+	bool Resize( cudaFilterMode filter=FILTER_LINEAR );
+
+	/**
+	 * Append an operator that linearly rescales the RGB channels from the input range to the output range.
+	 */
+	bool Normalize( const float2& input_range, const float2& output_range );
+
+	/**
+	 * Append an operator that maps the first channel through a colormap palette (see cudaColormap.h).
+	 * The values in `range` get mapped to the start and end of the palette.
+	 */
+	bool Colormap( cudaColormapType colormap, const float2& range );
+
+	/**
+	 * Append an operator that alpha blends an rgba8 or rgba32f image on top, at the position (x,y)
+	 * in the output.  The image pointer and position can be changed between frames with SetOverlay().
+	 */
+	bool Overlay( void* image, uint32_t width, uint32_t height, imageFormat format, int x, int y );
+
+	/**
+	 * Change the image or position of an overlay operator that was added with Overlay().
+	 * @param index the index of the operator in the chain.
+	 */
+	bool SetOverlay( uint32_t index, void* image, uint32_t width, uint32_t height, int x, int y );
+
+	/**
+	 * Append a custom operator, given as a snippet of CUDA code that modifies the float4 `px`.
+	 * The snippet can also use the output coordinates `x` and `y`, and the float4 `params`.
+	 * For example, `px.x = px.x * params.x + params.y;`
+	 */
+	bool Expression( const char* code, const float4& params=make_float4(0,0,0,0) );
+
+	/**
+	 * Change the float4 params of an operator that was added with Expression().
+	 */
+	bool SetParams( uint32_t index, const float4& params );
+
+	/**
+	 * Remove all of the operators, and reset the crop region and filtering mode.
+	 */
+	void Clear();
+
+	/**
+	 * Run the fused kernel on `stream`.  The first time it's run with these formats,
+	 * the kernel is loaded from the cache or compiled.
+	 */
+	cudaError_t Process( void* input, uint32_t input_width, uint32_t input_height, imageFormat input_format,
+					 void* output, uint32_t output_width, uint32_t output_height, imageFormat output_format,
+					 cudaStream_t stream=0 );
+
+	/**
+	 * Return the number of operators in the chain.
+	 */
+	inline uint32_t GetNumOps() const		{ return mOps.size(); }
+
+	/**
+	 * Return the CUDA source of the fused kernel for these formats (for debugging).
+	 */
+	std::string GenerateSource( imageFormat input_format, imageFormat output_format ) const;
+
+protected:
+	enum OpType
+	{
+		OP_NORMALIZE,
+		OP_COLORMAP,
+		OP_OVERLAY,
+		OP_EXPRESSION
+	};
+
+	// the runtime parameters of an operator (this layout is mirrored in the generated source)
+	struct OpParams
+	{
+		float4 a;
+		int4   i;
+		const void* ptr;
+		float  pad[2];
+	};
+
+	// the runtime parameters of the kernel
+	struct Params
+	{
+		float4 map;	// (scale_x, scale_y, offset_x, offset_y) from the output to the input coordinates
+		OpParams ops[CUDA_FUSED_MAX_OPS];
+	};
+
+	struct Op
+	{
+		OpType type;
+		std::string code;	// OP_EXPRESSION only
+		OpParams params;
+	};
+
+	bool addOp( const Op& op );
+
+	std::vector<Op> mOps;
+
+	int4 mROI;
+	bool mCrop;
+	cudaFilterMode mFilter;
+
+	void* mFunction;	// CUfunction of the current formats
+	imageFormat mFunctionFormats[2];
+	bool mDirty;
+};
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaGrid.h"
+#include "cudaFilterMode.cuh"
+#include "logging.h"
+#include "cudaNVTX.h"
+
+#include <math.h>
+
+
+// the tiles get passed to the kernel by value
+struct cudaGridParams
+{
+	void*  images[CUDA_GRID_MAX_TILES];
+	int    widths[CUDA_GRID_MAX_TILES];
+	int    heights[CUDA_GRID_MAX_TILES];
+	float2 offsets[CUDA_GRID_MAX_TILES];	// position of the scaled image in the output
+	float  scales[CUDA_GRID_MAX_TILES];	// input pixels per output pixel
+	int    count;
+	int    columns;
+	int    rows;
+	float  cellWidth;
+	float  cellHeight;
+};
+
+
+// gpuGrid
+template<typename T, cudaFilterMode filter>
+__global__ void gpuGrid( cudaGridParams params, T* output, int outputWidth, int outputHeight )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const int col = min(int(x / params.cellWidth), params.columns - 1);
+	const int row = min(int(y / params.cellHeight), params.rows - 1);
+	const int n   = row * params.columns + col;
+
+	T px = T();
+
+	if( n < params.count && params.images[n] != NULL )
+	{
+		const float u = (x + 0.5f - params.offsets[n].x) * params.scales[n];
+		const float v = (y + 0.5f - params.offsets[n].y) * params.scales[n];
+
+		if( u >= 0.0f && v >= 0.0f && u < params.widths[n] && v < params.heights[n] )
+			px = cudaFilterPixel<filter>((T*)params.images[n], u, v, params.widths[n], params.heights[n]);
+	}
+
+	output[y * outputWidth + x] = px;
+}
+
+
+// cudaGrid
+cudaError_t cudaGrid( const cudaGridTile* tiles, uint32_t numTiles,
+				  void* output, uint32_t outputWidth, uint32_t outputHeight, imageFormat format,
+				  uint32_t columns, cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaGrid");
+
+	if( !tiles || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( numTiles == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( numTiles > CUDA_GRID_MAX_TILES )
+	{
+		LogError(LOG_CUDA "cudaGrid() -- %u tiles exceeds the maximum of %u (CUDA_GRID_MAX_TILES)\n", numTiles, CUDA_GRID_MAX_TILES);
+		return cudaErrorInvalidValue;
+	}
+
+	if( columns == 0 )
+		columns = (uint32_t)ceilf(sqrtf((float)numTiles));
+
+	if( columns > numTiles )
+		columns = numTiles;
+
+	cudaGridParams params;
+
+	params.count      = numTiles;
+	params.columns    = columns;
+	params.rows       = iDivUp(numTiles, columns);
+	params.cellWidth  = float(outputWidth) / float(params.columns);
+	params.cellHeight = float(outputHeight) / float(params.rows);
+
+	for( uint32_t n=0; n < numTiles; n++ )
+	{
+		params.images[n]  = tiles[n].image;
+		params.widths[n]  = tiles[n].width;
+		params.heights[n] = tiles[n].height;
+
+		if( !tiles[n].image || tiles[n].width == 0 || tiles[n].height == 0 )
+		{
+			params.images[n] = NULL;
+			continue;
+		}
+
+		// fit the image inside of its cell, keeping the aspect ratio
+		const float scale = fminf(params.cellWidth / tiles[n].width, params.cellHeight / tiles[n].height);
+
+		const float col = n % columns;
+		const float row = n / columns;
+
+		params.scales[n]  = 1.0f / scale;
+		params.offsets[n] = make_float2(col * params.cellWidth + (params.cellWidth - tiles[n].width * scale) * 0.5f,
+								  row * params.cellHeight + (params.cellHeight - tiles[n].height * scale) * 0.5f);
+	}
+
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+	#define LAUNCH_GRID(type) \
+		if( filter == FILTER_POINT ) \
+			gpuGrid<type, FILTER_POINT><<<gridDim, blockDim, 0, stream>>>(params, (type*)output, outputWidth, outputHeight); \
+		else \
+			gpuGrid<type, FILTER_LINEAR><<<gridDim, blockDim, 0, stream>>>(params, (type*)output, outputWidth, outputHeight)
+
+	if( format == IMAGE_RGB8 )
+		LAUNCH_GRID(uchar3);
+	else if( format == IMAGE_RGBA8 )
+		LAUNCH_GRID(uchar4);
+	else if( format == IMAGE_RGB32F )
+		LAUNCH_GRID(float3); 
+	else if( format == IMAGE_RGBA32F )
+		LAUNCH_GRID(float4);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaGrid()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	return CUDA(cudaGetLastError());
+}
+
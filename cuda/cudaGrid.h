@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_GRID_H__
+#define __CUDA_GRID_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+#include "cudaFilterMode.h"
+
+
+/**
+ * The maximum number of tiles that cudaGrid() can lay out in one pass.
+ * @ingroup resize
+ */
+#define CUDA_GRID_MAX_TILES 16
+
+
+/**
+ * One of the images that gets tiled into the grid by cudaGrid().
+ * @ingroup resize
+ */
+struct cudaGridTile
+{
+	void*    image;		/**< The tile's image (in GPU-accessible memory), or NULL to leave the tile empty */
+	uint32_t width;	/**< Width of the image */
+	uint32_t height;	/**< Height of the image */
+};
+
+
+/**
+ * Lay out multiple images in a tiled grid, in a single pass.
+ *
+ * The grid has the requested number of columns (or ceil(sqrt(numTiles)) columns if
+ * that's zero) and enough rows to fit all of the tiles, and they are placed in row-major
+ * order.  Each image is scaled to fit its cell while keeping its aspect ratio and is
+ * centered inside of it.  The rest of the output is cleared to zero.
+ *
+ * The tiles can have different sizes, but all of the tiles and the output should have
+ * the same format, which can be rgb8, rgba8, rgb32f, or rgba32f.
+ *
+ * @param tiles array of the images to tile (up to CUDA_GRID_MAX_TILES)
+ * @param numTiles the number of tiles in the array
+ * @param columns the number of columns in the grid (or 0 to pick it automatically)
+ * @param filter FILTER_POINT or FILTER_LINEAR
+ * @ingroup resize
+ */
+cudaError_t cudaGrid( const cudaGridTile* tiles, uint32_t numTiles,
+				  void* output, uint32_t outputWidth, uint32_t outputHeight, imageFormat format,
+				  uint32_t columns=0, cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+
+#endif
+
@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaISP.h"
+#include "cudaVector.h"
+
+#include <math.h>
+
+
+// the 2D block size of the ISP kernel (a multiple of the warp size)
+#define ISP_BLOCK_X 32
+#define ISP_BLOCK_Y 8
+
+// pixels brighter than this (or darker) are left out of the auto white balance
+#define ISP_AWB_MAX 0.95f
+#define ISP_AWB_MIN 0.02f
+
+// limits of the auto white balance gains
+#define ISP_GAIN_MIN 0.25f
+#define ISP_GAIN_MAX 8.0f
+
+
+// the settings that the kernel gets by value
+struct ispKernelParams
+{
+	float3 gains;			// manual white balance gains
+	float  ccm[3][3];
+	float  denoise;
+	float  motionThreshold;
+	bool   autoGains;		// use the gains from device memory instead
+	bool   accumulate;		// collect the auto white balance statistics
+	bool   history;			// the denoise history is valid
+};
+
+
+// sum a float4 across the warp (the result ends up in lane 0)
+inline __device__ float4 ispWarpSum( float4 value )
+{
+	for( int offset=16; offset > 0; offset /= 2 )
+	{
+		value.x += __shfl_down_sync(0xFFFFFFFF, value.x, offset);
+		value.y += __shfl_down_sync(0xFFFFFFFF, value.y, offset);
+		value.z += __shfl_down_sync(0xFFFFFFFF, value.z, offset);
+		value.w += __shfl_down_sync(0xFFFFFFFF, value.w, offset);
+	}
+
+	return value;
+}
+
+
+// apply the gamma lookup table with linear interpolation
+inline __device__ float ispGamma( const float* lut, float x )
+{
+	const float pos = x * float(CUDA_ISP_LUT_SIZE - 1);
+	const int   idx = min(int(pos), CUDA_ISP_LUT_SIZE - 2);
+
+	const float a = __ldg(lut + idx);
+	const float b = __ldg(lut + idx + 1);
+
+	return a + (b - a) * (pos - float(idx));
+}
+
+
+//-----------------------------------------------------------------------------------
+// fused ISP kernel (white balance, CCM, temporal denoise, gamma, and AWB statistics)
+//-----------------------------------------------------------------------------------
+template<typename T>
+__global__ void gpuISP( T* input, T* output, int width, int height, ispKernelParams params,
+				    const float* lut, const float3* autoGains, float3* history, float4* stats )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	// every thread has to take part in the reduction, so don't return early
+	const bool valid = (x < width && y < height);
+	const int  pixel = y * width + x;
+
+	float4 sample = make_float4(0,0,0,0);
+
+	if( valid )
+	{
+		const T px = input[pixel];
+		float3 rgb = make_float3(px.x, px.y, px.z) * (1.0f / 255.0f);
+
+		// statistics of the unsaturated pixels, for the next frame's white balance
+		if( params.accumulate )
+		{
+			const float maxValue = fmaxf(rgb.x, fmaxf(rgb.y, rgb.z));
+			const float minValue = fminf(rgb.x, fminf(rgb.y, rgb.z));
+
+			if( maxValue < ISP_AWB_MAX && minValue > ISP_AWB_MIN )
+				sample = make_float4(rgb.x, rgb.y, rgb.z, 1.0f);
+		}
+
+		// white balance
+		const float3 gains = params.autoGains ? *autoGains : params.gains;
+		rgb = make_float3(rgb.x * gains.x, rgb.y * gains.y, rgb.z * gains.z);
+
+		// color correction
+		rgb = make_float3(params.ccm[0][0] * rgb.x + params.ccm[0][1] * rgb.y + params.ccm[0][2] * rgb.z,
+					   params.ccm[1][0] * rgb.x + params.ccm[1][1] * rgb.y + params.ccm[1][2] * rgb.z,
+					   params.ccm[2][0] * rgb.x + params.ccm[2][1] * rgb.y + params.ccm[2][2] * rgb.z);
+
+		rgb.x = fminf(fmaxf(rgb.x, 0.0f), 1.0f);
+		rgb.y = fminf(fmaxf(rgb.y, 0.0f), 1.0f);
+		rgb.z = fminf(fmaxf(rgb.z, 0.0f), 1.0f);
+
+		// temporal denoise, which is skipped for moving pixels to avoid ghosting
+		if( history != NULL )
+		{
+			if( params.history )
+			{
+				const float3 prev = history[pixel];
+				const float  diff = fmaxf(fabsf(rgb.x - prev.x), fmaxf(fabsf(rgb.y - prev.y), fabsf(rgb.z - prev.z)));
+
+				if( diff < params.motionThreshold )
+				{
+					// fade the blend out as the difference approaches the threshold
+					const float weight = params.denoise * (1.0f - diff / params.motionThreshold);
+					rgb = rgb + (prev - rgb) * weight;
+				}
+			}
+
+			history[pixel] = rgb;
+		}
+
+		// gamma
+		rgb = make_float3(ispGamma(lut, rgb.x), ispGamma(lut, rgb.y), ispGamma(lut, rgb.z)) * 255.0f;
+
+		typedef typename cudaVectorTypeInfo<T>::Base T_base;
+		const float bias = (sizeof(T_base) == 1) ? 0.5f : 0.0f;
+
+		output[pixel] = make_vec<T>(T_base(rgb.x + bias), T_base(rgb.y + bias), T_base(rgb.z + bias), T_base(alpha(px)));
+	}
+
+	if( !params.accumulate )
+		return;
+
+	// reduce the statistics across the block, and add them with one atomic per channel
+	__shared__ float4 warpSums[(ISP_BLOCK_X * ISP_BLOCK_Y) / 32];
+
+	const int thread = threadIdx.y * blockDim.x + threadIdx.x;
+	const int lane = thread % 32;
+	const int warp = thread / 32;
+
+	sample = ispWarpSum(sample);
+
+	if( lane == 0 )
+		warpSums[warp] = sample;
+
+	__syncthreads();
+
+	if( warp == 0 )
+	{
+		sample = (lane < (ISP_BLOCK_X * ISP_BLOCK_Y) / 32) ? warpSums[lane] : make_float4(0,0,0,0);
+		sample = ispWarpSum(sample);
+
+		if( lane == 0 && sample.w > 0.0f )
+		{
+			atomicAdd(&stats->x, sample.x);
+			atomicAdd(&stats->y, sample.y);
+			atomicAdd(&stats->z, sample.z);
+			atomicAdd(&stats->w, sample.w);
+		}
+	}
+}
+
+
+// turn the statistics into the gains for the next frame (gray world), and clear them
+__global__ void gpuISPUpdateGains( float4* stats, float3* gains, float speed )
+{
+	const float4 sum = *stats;
+
+	if( sum.w > 0.0f && sum.x > 0.0f && sum.z > 0.0f )
+	{
+		const float3 target = make_float3(fminf(fmaxf(sum.y / sum.x, ISP_GAIN_MIN), ISP_GAIN_MAX), 1.0f,
+								    fminf(fmaxf(sum.y / sum.z, ISP_GAIN_MIN), ISP_GAIN_MAX));
+
+		const float3 current = *gains;
+		*gains = current + (target - current) * speed;
+	}
+
+	*stats = make_float4(0,0,0,0);
+}
+
+
+template<typename T>
+static cudaError_t launchISP( T* input, T* output, size_t width, size_t height, const ispKernelParams& params,
+						const float* lut, float3* gains, float3* history, float4* stats, float speed, cudaStream_t stream )
+{
+	const dim3 blockDim(ISP_BLOCK_X, ISP_BLOCK_Y);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+
+	gpuISP<T><<<gridDim, blockDim, 0, stream>>>(input, output, width, height, params, lut, gains, history, stats);
+
+	if( params.accumulate )
+		gpuISPUpdateGains<<<1, 1, 0, stream>>>(stats, gains, speed);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// constructor
+cudaISP::cudaISP()
+{
+	mLUT          = NULL;
+	mGains        = NULL;
+	mStats        = NULL;
+	mHistory      = NULL;
+	mHistorySize  = 0;
+	mHistoryValid = false;
+
+	mParams.whiteBalance          = make_float3(1.0f, 1.0f, 1.0f);
+	mParams.denoise               = 0.0f;
+	mParams.motionThreshold       = 0.1f;
+	mParams.autoWhiteBalance      = false;
+	mParams.autoWhiteBalanceSpeed = 0.1f;
+
+	for( int i=0; i < 3; i++ )
+		for( int j=0; j < 3; j++ )
+			mParams.colorMatrix[i][j] = (i == j) ? 1.0f : 0.0f;
+}
+
+
+// destructor
+cudaISP::~cudaISP()
+{
+	CUDA_FREE(mLUT);
+	CUDA_FREE(mGains);
+	CUDA_FREE(mStats);
+	CUDA_FREE(mHistory);
+}
+
+
+// Create
+cudaISP* cudaISP::Create()
+{
+	cudaISP* isp = new cudaISP();
+
+	if( !isp->init() )
+	{
+		LogError(LOG_CUDA "cudaISP -- failed to initialize\n");
+		delete isp;
+		return NULL;
+	}
+
+	return isp;
+}
+
+
+// init
+bool cudaISP::init()
+{
+	if( CUDA_FAILED(cudaMalloc((void**)&mLUT, CUDA_ISP_LUT_SIZE * sizeof(float))) )
+		return false;
+
+	if( CUDA_FAILED(cudaMalloc((void**)&mGains, sizeof(float3))) )
+		return false;
+
+	if( CUDA_FAILED(cudaMalloc((void**)&mStats, sizeof(float4))) )
+		return false;
+
+	Reset();
+	return SetGamma(1.0f);
+}
+
+
+// Reset
+void cudaISP::Reset()
+{
+	const float3 gains = make_float3(1.0f, 1.0f, 1.0f);
+
+	CUDA(cudaMemcpy(mGains, &gains, sizeof(float3), cudaMemcpyHostToDevice));
+	CUDA(cudaMemset(mStats, 0, sizeof(float4)));
+
+	mHistoryValid = false;
+}
+
+
+// SetWhiteBalance
+void cudaISP::SetWhiteBalance( float red, float green, float blue )
+{
+	mParams.whiteBalance     = make_float3(red, green, blue);
+	mParams.autoWhiteBalance = false;
+}
+
+
+// SetAutoWhiteBalance
+void cudaISP::SetAutoWhiteBalance( bool enable, float speed )
+{
+	// start the auto white balance from the current manual gains
+	if( enable && !mParams.autoWhiteBalance )
+	{
+		CUDA(cudaMemcpy(mGains, &mParams.whiteBalance, sizeof(float3), cudaMemcpyHostToDevice));
+		CUDA(cudaMemset(mStats, 0, sizeof(float4)));
+	}
+
+	mParams.autoWhiteBalance      = enable;
+	mParams.autoWhiteBalanceSpeed = speed;
+}
+
+
+// GetWhiteBalance
+float3 cudaISP::GetWhiteBalance() const
+{
+	if( !mParams.autoWhiteBalance )
+		return mParams.whiteBalance;
+
+	float3 gains = make_float3(1.0f, 1.0f, 1.0f);
+	CUDA(cudaMemcpy(&gains, mGains, sizeof(float3), cudaMemcpyDeviceToHost));
+	return gains;
+}
+
+
+// SetDenoise
+void cudaISP::SetDenoise( float strength, float motionThreshold )
+{
+	mParams.denoise         = fminf(fmaxf(strength, 0.0f), 1.0f);
+	mParams.motionThreshold = motionThreshold;
+}
+
+
+// SetGamma
+bool cudaISP::SetGamma( float gamma )
+{
+	if( gamma <= 0.0f )
+	{
+		LogError(LOG_CUDA "cudaISP::SetGamma() -- invalid gamma (%f)\n", gamma);
+		return false;
+	}
+
+	float lut[CUDA_ISP_LUT_SIZE];
+
+	for( uint32_t n=0; n < CUDA_ISP_LUT_SIZE; n++ )
+		lut[n] = powf(float(n) / float(CUDA_ISP_LUT_SIZE - 1), 1.0f / gamma);
+
+	return SetGammaLUT(lut, CUDA_ISP_LUT_SIZE);
+}
+
+
+// SetGammaLUT
+bool cudaISP::SetGammaLUT( const float* lut, uint32_t size )
+{
+	if( !lut || size < 2 )
+		return false;
+
+	// resample the curve to the size of the table
+	float table[CUDA_ISP_LUT_SIZE];
+
+	for( uint32_t n=0; n < CUDA_ISP_LUT_SIZE; n++ )
+	{
+		const float pos = float(n) / float(CUDA_ISP_LUT_SIZE - 1) * float(size - 1);
+		const uint32_t idx = (uint32_t(pos) < size - 1) ? uint32_t(pos) : size - 2;
+
+		table[n] = lut[idx] + (lut[idx + 1] - lut[idx]) * (pos - float(idx));
+	}
+
+	if( CUDA_FAILED(cudaMemcpy(mLUT, table, sizeof(table), cudaMemcpyHostToDevice)) )
+		return false;
+
+	return true;
+}
+
+
+// Process
+cudaError_t cudaISP::Process( void* input, void* output, size_t width, size_t height, imageFormat format, cudaStream_t stream )
+{
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	// (re)allocate the denoise history when it's first enabled or the size changes
+	float3* history = NULL;
+
+	if( mParams.denoise > 0.0f )
+	{
+		const size_t historySize = width * height * sizeof(float3);
+
+		if( mHistorySize != historySize )
+		{
+			CUDA_FREE(mHistory);
+
+			if( CUDA_FAILED(cudaMalloc((void**)&mHistory, historySize)) )
+			{
+				mHistorySize = 0;
+				return cudaErrorMemoryAllocation;
+			}
+
+			mHistorySize  = historySize;
+			mHistoryValid = false;
+		}
+
+		history = mHistory;
+	}
+	else
+	{
+		mHistoryValid = false;
+	}
+
+	ispKernelParams params;
+
+	params.gains           = mParams.whiteBalance;
+	params.denoise         = mParams.denoise;
+	params.motionThreshold = fmaxf(mParams.motionThreshold, 1e-6f);
+	params.autoGains       = mParams.autoWhiteBalance;
+	params.accumulate      = mParams.autoWhiteBalance && mParams.autoWhiteBalanceSpeed > 0.0f;
+	params.history         = mHistoryValid;
+
+	memcpy(params.ccm, mParams.colorMatrix, sizeof(params.ccm));
+
+	const float speed = fminf(mParams.autoWhiteBalanceSpeed, 1.0f);
+	cudaError_t result = cudaErrorInvalidValue;
+
+	if( format == IMAGE_RGB8 )
+		result = launchISP((uchar3*)input, (uchar3*)output, width, height, params, mLUT, mGains, history, (float4*)mStats, speed, stream);
+	else if( format == IMAGE_RGBA8 )
+		result = launchISP((uchar4*)input, (uchar4*)output, width, height, params, mLUT, mGains, history, (float4*)mStats, speed, stream);
+	else if( format == IMAGE_RGB32F )
+		result = launchISP((float3*)input, (float3*)output, width, height, params, mLUT, mGains, history, (float4*)mStats, speed, stream);
+	else if( format == IMAGE_RGBA32F )
+		result = launchISP((float4*)input, (float4*)output, width, height, params, mLUT, mGains, history, (float4*)mStats, speed, stream);
+	else
+		imageFormatErrorMsg(LOG_CUDA, "cudaISP::Process()", format);
+
+	if( result == cudaSuccess && history != NULL )
+		mHistoryValid = true;
+
+	return result;
+}
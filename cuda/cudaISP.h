@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_ISP_H__
+#define __CUDA_ISP_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * The number of entries in the gamma lookup table of cudaISP.
+ * @ingroup colorspace
+ */
+#define CUDA_ISP_LUT_SIZE 1024
+
+
+/**
+ * Per-frame settings of cudaISP, which are passed to the kernel by value.
+ * @ingroup colorspace
+ */
+struct cudaISPParams
+{
+	/**
+	 * The red, green, and blue white balance gains (ignored while autoWhiteBalance is enabled).
+	 */
+	float3 whiteBalance;
+
+	/**
+	 * 3x3 color correction matrix (row-major), applied after white balance in linear RGB.
+	 */
+	float colorMatrix[3][3];
+
+	/**
+	 * Strength of the temporal denoise from 0 (disabled) to 1.  This is the weight that
+	 * the previous frames get in the blend, so higher values are smoother but have more lag.
+	 */
+	float denoise;
+
+	/**
+	 * Difference (0-1) above which a pixel is considered to be moving, and the temporal
+	 * denoise gets skipped for it to avoid ghosting.
+	 */
+	float motionThreshold;
+
+	/**
+	 * If true, the white balance gains are estimated on the GPU with the gray world assumption.
+	 */
+	bool autoWhiteBalance;
+
+	/**
+	 * How fast the auto white balance adapts, from 0 (frozen) to 1 (instant).
+	 */
+	float autoWhiteBalanceSpeed;
+};
+
+
+/**
+ * Image signal processing (ISP) stage for RGB frames coming out of demosaic (see cudaBayer.h).
+ *
+ * Each frame is processed by a single fused kernel that does the following in linear RGB:
+ *
+ *   - white balance, with either manual gains or auto white balance (gray world)
+ *   - 3x3 color correction matrix (which can be set from the mat33.h types)
+ *   - lightweight motion-adaptive temporal denoise (an IIR blend with the previous frames)
+ *   - gamma encoding with a lookup table (CUDA_ISP_LUT_SIZE entries with interpolation)
+ *
+ * For auto white balance, the same kernel accumulates the channel averages of the unsaturated
+ * pixels, and a tiny follow-up kernel turns them into the gains for the next frame - so the
+ * gains stay in device memory and Process() never needs to synchronize with the CPU.
+ *
+ * The settings are copied from cudaISPParams on every call to Process(), so they can be
+ * changed per-frame with SetParams() (or the individual setters).  The input and output
+ * can be the same image, and its format can be rgb8, rgba8, rgb32f, or rgba32f (0-255).
+ *
+ * @ingroup colorspace
+ */
+class cudaISP
+{
+public:
+	/**
+	 * Create the ISP with the default settings (unity gains and CCM, no denoise, linear gamma).
+	 */
+	static cudaISP* Create();
+
+	/**
+	 * Destructor
+	 */
+	~cudaISP();
+
+	/**
+	 * Process a frame.  The input and output have the same format and size, and can be the same image.
+	 * @param stream CUDA stream to run on (the default stream is used if NULL)
+	 */
+	cudaError_t Process( void* input, void* output, size_t width, size_t height, imageFormat format, cudaStream_t stream=NULL );
+
+	/**
+	 * Process a frame, with the format deduced from the type.
+	 */
+	template<typename T> cudaError_t Process( T* input, T* output, size_t width, size_t height, cudaStream_t stream=NULL )		{ return Process((void*)input, (void*)output, width, height, imageFormatFromType<T>(), stream); }
+
+	/**
+	 * Get the settings.
+	 */
+	inline const cudaISPParams& GetParams() const		{ return mParams; }
+
+	/**
+	 * Set all of the settings.
+	 */
+	inline void SetParams( const cudaISPParams& params )	{ mParams = params; }
+
+	/**
+	 * Set the manual white balance gains (and disable auto white balance).
+	 */
+	void SetWhiteBalance( float red, float green, float blue );
+
+	/**
+	 * Enable or disable auto white balance.
+	 */
+	void SetAutoWhiteBalance( bool enable, float speed=0.1f );
+
+	/**
+	 * Get the white balance gains that were last used, including the auto white balance gains.
+	 * Because those are kept in device memory, this synchronizes with the GPU.
+	 */
+	float3 GetWhiteBalance() const;
+
+	/**
+	 * Set the 3x3 color correction matrix (row-major, e.g. from mat33.h).
+	 */
+	template<typename T> void SetColorMatrix( const T matrix[3][3] )
+	{
+		for( int i=0; i < 3; i++ )
+			for( int j=0; j < 3; j++ )
+				mParams.colorMatrix[i][j] = float(matrix[i][j]);
+	}
+
+	/**
+	 * Set the temporal denoise strength (0 disables it) and the motion threshold.
+	 */
+	void SetDenoise( float strength, float motionThreshold=0.1f );
+
+	/**
+	 * Set the gamma, which rebuilds the lookup table as output = input^(1/gamma).
+	 * A gamma of 1.0 is linear, and 2.2 is typical for display.
+	 */
+	bool SetGamma( float gamma );
+
+	/**
+	 * Set an arbitrary tone curve, which is resampled to CUDA_ISP_LUT_SIZE entries.
+	 * @param lut array of `size` values from 0 to 1, for the inputs evenly spaced from 0 to 1.
+	 */
+	bool SetGammaLUT( const float* lut, uint32_t size );
+
+	/**
+	 * Reset the temporal denoise history and the auto white balance.
+	 */
+	void Reset();
+
+protected:
+	cudaISP();
+
+	bool init();
+
+	cudaISPParams mParams;
+
+	float*  mLUT;		// CUDA_ISP_LUT_SIZE gamma entries (device)
+	float3* mGains;		// white balance gains of the last frame (device)
+	float*  mStats;		// channel sums and pixel count for auto white balance (device)
+
+	float3* mHistory;		// linear RGB of the previous frames for temporal denoise (device)
+	size_t  mHistorySize;
+	bool    mHistoryValid;
+};
+
+
+#endif
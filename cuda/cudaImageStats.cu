@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaImageStats.h"
+#include "cudaVector.h"
+
+#include "logging.h"
+#include "cudaNVTX.h"
+
+#include <float.h>
+
+
+// number of threads per block used by the reductions
+#define STATS_BLOCK_SIZE 256
+
+// maximum number of blocks launched by the reductions (each thread strides over the image)
+#define STATS_MAX_BLOCKS 1024
+
+
+// get the color channels of a pixel (the alpha channel is ignored)
+inline __device__ int statsChannels( const uint8_t& px, float* c )	{ c[0] = px; return 1; }
+inline __device__ int statsChannels( const float& px, float* c )	{ c[0] = px; return 1; }
+inline __device__ int statsChannels( const uchar3& px, float* c )	{ c[0] = px.x; c[1] = px.y; c[2] = px.z; return 3; }
+inline __device__ int statsChannels( const uchar4& px, float* c )	{ c[0] = px.x; c[1] = px.y; c[2] = px.z; return 3; }
+inline __device__ int statsChannels( const float3& px, float* c )	{ c[0] = px.x; c[1] = px.y; c[2] = px.z; return 3; }
+inline __device__ int statsChannels( const float4& px, float* c )	{ c[0] = px.x; c[1] = px.y; c[2] = px.z; return 3; }
+
+
+// get the luminance of a pixel (gray pixels are returned as-is)
+inline __device__ float statsLuma( const uint8_t& px, const float3& w )	{ return px; }
+inline __device__ float statsLuma( const float& px, const float3& w )	{ return px; }
+inline __device__ float statsLuma( const uchar3& px, const float3& w )	{ return w.x * px.x + w.y * px.y + w.z * px.z; }
+inline __device__ float statsLuma( const uchar4& px, const float3& w )	{ return w.x * px.x + w.y * px.y + w.z * px.z; }
+inline __device__ float statsLuma( const float3& px, const float3& w )	{ return w.x * px.x + w.y * px.y + w.z * px.z; }
+inline __device__ float statsLuma( const float4& px, const float3& w )	{ return w.x * px.x + w.y * px.y + w.z * px.z; }
+
+
+// float atomicMin/atomicMax, using the ordering of the IEEE-754 bit patterns
+// (positive floats sort like signed ints, and negative floats sort in reverse like unsigned ints)
+inline __device__ void atomicMinFloat( float* address, float value )
+{
+	if( value >= 0.0f )
+		atomicMin((int*)address, __float_as_int(value));
+	else
+		atomicMax((unsigned int*)address, __float_as_uint(value));
+}
+
+inline __device__ void atomicMaxFloat( float* address, float value )
+{
+	if( value >= 0.0f )
+		atomicMax((int*)address, __float_as_int(value));
+	else
+		atomicMin((unsigned int*)address, __float_as_uint(value));
+}
+
+
+// reduce a pair of values across a warp (the result ends up in lane 0)
+template<bool MinMax>
+inline __device__ float2 warpReduce( float2 value )
+{
+	for( int offset=16; offset > 0; offset /= 2 )
+	{
+		const float x = __shfl_down_sync(0xFFFFFFFF, value.x, offset);
+		const float y = __shfl_down_sync(0xFFFFFFFF, value.y, offset);
+
+		if( MinMax )
+			value = make_float2(fminf(value.x, x), fmaxf(value.y, y));
+		else
+			value = make_float2(value.x + x, value.y + y);
+	}
+
+	return value;
+}
+
+
+// reduce a pair of values across the block (the result ends up in thread 0)
+template<bool MinMax>
+inline __device__ float2 blockReduce( float2 value )
+{
+	__shared__ float2 warpResults[STATS_BLOCK_SIZE / 32];
+
+	const int lane = threadIdx.x % 32;
+	const int warp = threadIdx.x / 32;
+
+	value = warpReduce<MinMax>(value);
+
+	if( lane == 0 )
+		warpResults[warp] = value;
+
+	__syncthreads();
+
+	if( warp == 0 )
+	{
+		if( lane < STATS_BLOCK_SIZE / 32 )
+			value = warpResults[lane];
+		else
+			value = MinMax ? make_float2(FLT_MAX, -FLT_MAX) : make_float2(0.0f, 0.0f);
+
+		value = warpReduce<MinMax>(value);
+	}
+
+	return value;
+}
+
+
+// number of blocks to launch for a reduction over N pixels
+static inline int statsBlocks( size_t numPixels )
+{
+	const int blocks = iDivUp(numPixels, STATS_BLOCK_SIZE);
+	return (blocks < STATS_MAX_BLOCKS) ? blocks : STATS_MAX_BLOCKS;
+}
+
+
+// gpuImageStatsInit
+__global__ void gpuImageStatsInit( float2* result, float2 value )
+{
+	*result = value;
+}
+
+
+//-----------------------------------------------------------------------------------
+// cudaImageMinMax
+//-----------------------------------------------------------------------------------
+template<typename T>
+__global__ void gpuImageMinMax( T* input, int numPixels, float2* minMax )
+{
+	float2 value = make_float2(FLT_MAX, -FLT_MAX);
+
+	for( int n=blockIdx.x * blockDim.x + threadIdx.x; n < numPixels; n += blockDim.x * gridDim.x )
+	{
+		float c[3];
+		const int channels = statsChannels(input[n], c);
+
+		for( int k=0; k < channels; k++ )
+		{
+			value.x = fminf(value.x, c[k]);
+			value.y = fmaxf(value.y, c[k]);
+		}
+	}
+
+	value = blockReduce<true>(value);
+
+	if( threadIdx.x == 0 )
+	{
+		atomicMinFloat(&minMax->x, value.x);
+		atomicMaxFloat(&minMax->y, value.y);
+	}
+}
+
+template<typename T>
+static cudaError_t launchImageMinMax( T* input, size_t numPixels, float2* minMax, cudaStream_t stream )
+{
+	gpuImageStatsInit<<<1, 1, 0, stream>>>(minMax, make_float2(FLT_MAX, -FLT_MAX));
+	gpuImageMinMax<T><<<statsBlocks(numPixels), STATS_BLOCK_SIZE, 0, stream>>>(input, numPixels, minMax);
+
+	return CUDA(cudaGetLastError());
+}
+
+cudaError_t cudaImageMinMax( void* input, size_t width, size_t height, imageFormat format, float2* minMax, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaImageMinMax");
+
+	if( !input || !minMax )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const size_t numPixels = width * height;
+
+	if( format == IMAGE_GRAY8 )
+		return launchImageMinMax((uint8_t*)input, numPixels, minMax, stream);
+	else if( format == IMAGE_GRAY32F )
+		return launchImageMinMax((float*)input, numPixels, minMax, stream);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return launchImageMinMax((uchar3*)input, numPixels, minMax, stream);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return launchImageMinMax((uchar4*)input, numPixels, minMax, stream);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return launchImageMinMax((float3*)input, numPixels, minMax, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return launchImageMinMax((float4*)input, numPixels, minMax, stream);
+
+	imageFormatErrorMsg(LOG_CUDA, "cudaImageMinMax()", format);
+	return cudaErrorInvalidValue;
+}
+
+
+//-----------------------------------------------------------------------------------
+// cudaImageMeanStdDev
+//-----------------------------------------------------------------------------------
+
+// the sums are accumulated relative to the first channel of the first pixel,
+// which avoids most of the cancellation in (sum(x^2) - sum(x)^2) with floats
+template<typename T>
+inline __device__ float statsPivot( T* input )
+{
+	float c[3];
+	statsChannels(input[0], c);
+	return c[0];
+}
+
+template<typename T>
+__global__ void gpuImageSums( T* input, int numPixels, float2* sums )
+{
+	const float pivot = statsPivot(input);
+	float2 value = make_float2(0.0f, 0.0f);
+
+	for( int n=blockIdx.x * blockDim.x + threadIdx.x; n < numPixels; n += blockDim.x * gridDim.x )
+	{
+		float c[3];
+		const int channels = statsChannels(input[n], c);
+
+		for( int k=0; k < channels; k++ )
+		{
+			const float d = c[k] - pivot;
+
+			value.x += d;
+			value.y += d * d;
+		}
+	}
+
+	value = blockReduce<false>(value);
+
+	if( threadIdx.x == 0 )
+	{
+		atomicAdd(&sums->x, value.x);
+		atomicAdd(&sums->y, value.y);
+	}
+}
+
+template<typename T>
+__global__ void gpuImageMeanStdDev( T* input, float numValues, float2* meanStdDev )
+{
+	const float2 sums = *meanStdDev;
+
+	const float mean = sums.x / numValues;
+	const float var  = sums.y / numValues - mean * mean;
+
+	*meanStdDev = make_float2(statsPivot(input) + mean, sqrtf(fmaxf(var, 0.0f)));
+}
+
+template<typename T>
+static cudaError_t launchImageMeanStdDev( T* input, size_t numPixels, int channels, float2* meanStdDev, cudaStream_t stream )
+{
+	gpuImageStatsInit<<<1, 1, 0, stream>>>(meanStdDev, make_float2(0.0f, 0.0f));
+	gpuImageSums<T><<<statsBlocks(numPixels), STATS_BLOCK_SIZE, 0, stream>>>(input, numPixels, meanStdDev);
+	gpuImageMeanStdDev<T><<<1, 1, 0, stream>>>(input, float(numPixels * channels), meanStdDev);
+
+	return CUDA(cudaGetLastError());
+}
+
+cudaError_t cudaImageMeanStdDev( void* input, size_t width, size_t height, imageFormat format, float2* meanStdDev, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaImageMeanStdDev");
+
+	if( !input || !meanStdDev )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const size_t numPixels = width * height;
+
+	if( format == IMAGE_GRAY8 )
+		return launchImageMeanStdDev((uint8_t*)input, numPixels, 1, meanStdDev, stream);
+	else if( format == IMAGE_GRAY32F )
+		return launchImageMeanStdDev((float*)input, numPixels, 1, meanStdDev, stream);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return launchImageMeanStdDev((uchar3*)input, numPixels, 3, meanStdDev, stream);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return launchImageMeanStdDev((uchar4*)input, numPixels, 3, meanStdDev, stream);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return launchImageMeanStdDev((float3*)input, numPixels, 3, meanStdDev, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return launchImageMeanStdDev((float4*)input, numPixels, 3, meanStdDev, stream);
+
+	imageFormatErrorMsg(LOG_CUDA, "cudaImageMeanStdDev()", format);
+	return cudaErrorInvalidValue;
+}
+
+
+//-----------------------------------------------------------------------------------
+// cudaHistogram
+//-----------------------------------------------------------------------------------
+template<typename T>
+__global__ void gpuHistogram( T* input, int numPixels, uint32_t* histogram, int numBins, 
+						float rangeMin, float binScale, const float2* rangeGPU, float3 weights )
+{
+	extern __shared__ uint32_t sharedHist[];
+
+	if( rangeGPU != NULL )
+	{
+		const float2 range = *rangeGPU;
+
+		rangeMin = range.x;
+		binScale = (range.y > range.x) ? float(numBins) / (range.y - range.x) : 0.0f;
+	}
+
+	for( int n=threadIdx.x; n < numBins; n += blockDim.x )
+		sharedHist[n] = 0;
+
+	__syncthreads();
+
+	for( int n=blockIdx.x * blockDim.x + threadIdx.x; n < numPixels; n += blockDim.x * gridDim.x )
+	{
+		const int bin = int((statsLuma(input[n], weights) - rangeMin) * binScale);
+		atomicAdd(&sharedHist[max(0, min(bin, numBins - 1))], 1u);
+	}
+
+	__syncthreads();
+
+	for( int n=threadIdx.x; n < numBins; n += blockDim.x )
+	{
+		if( sharedHist[n] > 0 )
+			atomicAdd(&histogram[n], sharedHist[n]);
+	}
+}
+
+template<typename T>
+static cudaError_t launchHistogram( T* input, size_t numPixels, uint32_t* histogram, uint32_t numBins, 
+							 const float2& range, const float2* rangeGPU, const float3& weights, cudaStream_t stream )
+{
+	const cudaError_t result = CUDA(cudaMemsetAsync(histogram, 0, numBins * sizeof(uint32_t), stream));
+
+	if( result != cudaSuccess )
+		return result;
+
+	const float binScale = (range.y > range.x) ? float(numBins) / (range.y - range.x) : 0.0f;
+
+	gpuHistogram<T><<<statsBlocks(numPixels), STATS_BLOCK_SIZE, numBins * sizeof(uint32_t), stream>>>(
+		input, numPixels, histogram, numBins, range.x, binScale, rangeGPU, weights);
+
+	return CUDA(cudaGetLastError());
+}
+
+static cudaError_t dispatchHistogram( void* input, size_t width, size_t height, imageFormat format, 
+							   uint32_t* histogram, uint32_t numBins, const float2& range, 
+							   const float2* rangeGPU, cudaStream_t stream )
+{
+	if( !input || !histogram )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( numBins == 0 || numBins > CUDA_HISTOGRAM_MAX_BINS )
+	{
+		LogError(LOG_CUDA "cudaHistogram() -- numBins must be between 1 and %i (was %u)\n", CUDA_HISTOGRAM_MAX_BINS, numBins);
+		return cudaErrorInvalidValue;
+	}
+
+	const size_t numPixels = width * height;
+
+	const float3 rgb = make_float3(0.299f, 0.587f, 0.114f);
+	const float3 bgr = make_float3(0.114f, 0.587f, 0.299f);
+
+	if( format == IMAGE_GRAY8 )
+		return launchHistogram((uint8_t*)input, numPixels, histogram, numBins, range, rangeGPU, rgb, stream);
+	else if( format == IMAGE_GRAY32F )
+		return launchHistogram((float*)input, numPixels, histogram, numBins, range, rangeGPU, rgb, stream);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return launchHistogram((uchar3*)input, numPixels, histogram, numBins, range, rangeGPU, (format == IMAGE_RGB8) ? rgb : bgr, stream);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return launchHistogram((uchar4*)input, numPixels, histogram, numBins, range, rangeGPU, (format == IMAGE_RGBA8) ? rgb : bgr, stream);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return launchHistogram((float3*)input, numPixels, histogram, numBins, range, rangeGPU, (format == IMAGE_RGB32F) ? rgb : bgr, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return launchHistogram((float4*)input, numPixels, histogram, numBins, range, rangeGPU, (format == IMAGE_RGBA32F) ? rgb : bgr, stream);
+
+	imageFormatErrorMsg(LOG_CUDA, "cudaHistogram()", format);
+	return cudaErrorInvalidValue;
+}
+
+cudaError_t cudaHistogram( void* input, size_t width, size_t height, imageFormat format, 
+					  uint32_t* histogram, uint32_t numBins, const float2& range, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaHistogram");
+
+	if( range.y <= range.x )
+	{
+		LogError(LOG_CUDA "cudaHistogram() -- invalid range (%f, %f)\n", range.x, range.y);
+		return cudaErrorInvalidValue;
+	}
+
+	return dispatchHistogram(input, width, height, format, histogram, numBins, range, NULL, stream);
+}
+
+cudaError_t cudaHistogram( void* input, size_t width, size_t height, imageFormat format, 
+					  uint32_t* histogram, uint32_t numBins, const float2* range, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaHistogram");
+
+	if( !range )
+		return cudaErrorInvalidDevicePointer;
+
+	return dispatchHistogram(input, width, height, format, histogram, numBins, make_float2(0,0), range, stream);
+}
+
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_IMAGE_STATS_H__
+#define __CUDA_IMAGE_STATS_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * The maximum number of bins supported by cudaHistogram().
+ * @ingroup cuda
+ */
+#define CUDA_HISTOGRAM_MAX_BINS 4096
+
+
+/**
+ * Compute the minimum and maximum pixel values of an image on the GPU.
+ *
+ * The range is over all of the color channels (the alpha channel is ignored),
+ * and it's written to device memory so that it can be used by other kernels on
+ * the same stream without synchronizing with the CPU.
+ *
+ * The supported formats are gray8, gray32f, rgb8/bgr8, rgba8/bgra8, rgb32f/bgr32f,
+ * and rgba32f/bgra32f.
+ *
+ * @param minMax pointer to a float2 in GPU-accessible memory that receives the
+ *               minimum (x) and maximum (y) values.
+ * @ingroup cuda
+ */
+cudaError_t cudaImageMinMax( void* input, size_t width, size_t height, imageFormat format,
+					    float2* minMax, cudaStream_t stream=NULL );
+
+/**
+ * Compute the mean and standard deviation of an image's pixel values on the GPU.
+ *
+ * The statistics are over all of the color channels (the alpha channel is ignored),
+ * and they're written to device memory like cudaImageMinMax() does.
+ *
+ * @param meanStdDev pointer to a float2 in GPU-accessible memory that receives the
+ *                   mean (x) and standard deviation (y).
+ * @ingroup cuda
+ */
+cudaError_t cudaImageMeanStdDev( void* input, size_t width, size_t height, imageFormat format,
+						   float2* meanStdDev, cudaStream_t stream=NULL );
+
+/**
+ * Compute the histogram of an image on the GPU.
+ *
+ * Gray images are binned directly, and color images are binned by their luminance
+ * (Rec. 601 weights).  The values in `range` are divided evenly into `numBins` bins,
+ * and values outside of the range are counted in the first or last bin.
+ *
+ * @param histogram array of `numBins` counters in GPU-accessible memory (which gets cleared first).
+ * @param numBins the number of bins (up to CUDA_HISTOGRAM_MAX_BINS)
+ * @param range the range of pixel values covered by the histogram.
+ * @ingroup cuda
+ */
+cudaError_t cudaHistogram( void* input, size_t width, size_t height, imageFormat format,
+					  uint32_t* histogram, uint32_t numBins=256, const float2& range=make_float2(0,255),
+					  cudaStream_t stream=NULL );
+
+/**
+ * Compute the histogram of an image on the GPU, with the range of the bins read from device memory.
+ * This can be chained after cudaImageMinMax() to bin the image over its own range
+ * without synchronizing with the CPU.  If the range is empty, every pixel is counted in the first bin.
+ *
+ * @param range pointer to a float2 in GPU-accessible memory with the range of pixel values.
+ * @ingroup cuda
+ */
+cudaError_t cudaHistogram( void* input, size_t width, size_t height, imageFormat format, 
+					  uint32_t* histogram, uint32_t numBins, const float2* range,
+					  cudaStream_t stream=NULL );
+
+
+#endif
@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaIpc.h"
+#include "cudaMemoryStats.h"
+#include "logging.h"
+#include "Mutex.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// an allocation from cudaAllocShared()
+struct cudaSharedAlloc
+{
+	size_t size;
+	std::string name;
+};
+
+// memory that was opened with cudaIpcImport()
+struct cudaImportedAlloc
+{
+	uint32_t type;
+	std::string key;	// the shared memory name, or the bytes of the CUDA IPC handle
+	uint8_t* base;
+	size_t size;		// the size of the mapping (only known for CUDA_IPC_HOST)
+	uint32_t refCount;
+};
+
+static std::map<void*, cudaSharedAlloc> gSharedAllocs;
+static std::vector<cudaImportedAlloc> gImportedAllocs;
+static uint32_t gSharedCount = 0;
+static Mutex gIpcMutex;
+
+
+// cudaAllocShared
+bool cudaAllocShared( void** ptr, size_t size )
+{
+	if( !ptr || size == 0 )
+		return false;
+
+	if( !cudaMemoryFits(size) )
+	{
+		LogError(LOG_CUDA "cudaAllocShared() -- allocating %zu bytes would exceed the memory budget\n", size);
+		cudaMemoryReport();
+		return false;
+	}
+
+	gIpcMutex.Lock();
+	const uint32_t index = gSharedCount++;
+	gIpcMutex.Unlock();
+
+	char name[CUDA_IPC_MAX_NAME];
+	snprintf(name, sizeof(name), "/cuda-ipc-%d-%u", (int)getpid(), index);
+
+	const int fd = shm_open(name, O_CREAT|O_EXCL|O_RDWR, 0666);
+
+	if( fd < 0 )
+	{
+		LogError(LOG_CUDA "cudaAllocShared() -- failed to create shared memory '%s' (error %i)\n", name, errno);
+		return false;
+	}
+
+	if( ftruncate(fd, size) != 0 )
+	{
+		LogError(LOG_CUDA "cudaAllocShared() -- failed to allocate %zu bytes of shared memory '%s'\n", size, name);
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+
+	void* mapping = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if( mapping == MAP_FAILED )
+	{
+		LogError(LOG_CUDA "cudaAllocShared() -- failed to map shared memory '%s'\n", name);
+		shm_unlink(name);
+		return false;
+	}
+
+	// the new shared memory is zeroed, so it only needs mapped into CUDA
+	if( CUDA_FAILED(cudaHostRegister(mapping, size, cudaHostRegisterMapped|cudaHostRegisterPortable)) )
+	{
+		LogError(LOG_CUDA "cudaAllocShared() -- failed to register shared memory '%s' with CUDA\n", name);
+		munmap(mapping, size);
+		shm_unlink(name);
+		return false;
+	}
+
+	cudaSharedAlloc alloc;
+
+	alloc.size = size;
+	alloc.name = name;
+
+	gIpcMutex.Lock();
+	gSharedAllocs[mapping] = alloc;
+	gIpcMutex.Unlock();
+
+	cudaMemoryTrack(mapping, size, CUDA_MEMORY_MAPPED);
+	LogDebug(LOG_CUDA "cudaAllocShared %zu bytes, %p (%s)\n", size, mapping, name);
+
+	*ptr = mapping;
+	return true;
+}
+
+
+// cudaFreeShared
+bool cudaFreeShared( void* ptr )
+{
+	if( !ptr )
+		return false;
+
+	gIpcMutex.Lock();
+
+	std::map<void*, cudaSharedAlloc>::iterator iter = gSharedAllocs.find(ptr);
+
+	if( iter == gSharedAllocs.end() )
+	{
+		gIpcMutex.Unlock();
+		return false;
+	}
+
+	const cudaSharedAlloc alloc = iter->second;
+	gSharedAllocs.erase(iter);
+	gIpcMutex.Unlock();
+
+	cudaMemoryUntrack(ptr);
+
+	CUDA(cudaHostUnregister(ptr));
+	munmap(ptr, alloc.size);
+	shm_unlink(alloc.name.c_str());
+
+	return true;
+}
+
+
+// cudaIpcExport
+bool cudaIpcExport( void* ptr, size_t size, cudaIpcHandle* handle )
+{
+	if( !ptr || !handle )
+		return false;
+
+	memset(handle, 0, sizeof(cudaIpcHandle));
+
+	handle->magic = CUDA_IPC_MAGIC;
+	handle->pid   = getpid();
+	handle->size  = size;
+
+	// check if the memory is from cudaAllocShared()
+	gIpcMutex.Lock();
+
+	std::map<void*, cudaSharedAlloc>::iterator iter = gSharedAllocs.upper_bound(ptr);
+
+	if( iter != gSharedAllocs.begin() )
+	{
+		--iter;
+
+		const size_t offset = (uint8_t*)ptr - (uint8_t*)iter->first;
+
+		if( offset + size <= iter->second.size )
+		{
+			handle->type   = CUDA_IPC_HOST;
+			handle->device = -1;
+			handle->offset = offset;
+
+			strncpy(handle->name, iter->second.name.c_str(), CUDA_IPC_MAX_NAME - 1);
+			gIpcMutex.Unlock();
+			return true;
+		}
+	}
+
+	gIpcMutex.Unlock();
+
+	// otherwise it needs to be device memory
+	cudaPointerAttributes attributes;
+
+	if( CUDA_FAILED(cudaPointerGetAttributes(&attributes, ptr)) )
+		return false;
+
+#if CUDART_VERSION >= 10000
+	const bool device = (attributes.type == cudaMemoryTypeDevice);
+#else
+	const bool device = (attributes.memoryType == cudaMemoryTypeDevice) && !attributes.isManaged;
+#endif
+
+	if( !device )
+	{
+		LogError(LOG_CUDA "cudaIpcExport() -- %p isn't device memory or from cudaAllocShared(), so it can't be shared\n", ptr);
+		return false;
+	}
+
+	// IPC handles are for the whole allocation, so find where it starts
+	CUdeviceptr base = 0;
+	size_t baseSize = 0;
+
+	if( cuMemGetAddressRange(&base, &baseSize, (CUdeviceptr)ptr) != CUDA_SUCCESS )
+	{
+		LogError(LOG_CUDA "cudaIpcExport() -- failed to get the allocation of %p\n", ptr);
+		return false;
+	}
+
+	if( CUDA_FAILED(cudaIpcGetMemHandle(&handle->handle, (void*)base)) )
+	{
+		LogError(LOG_CUDA "cudaIpcExport() -- CUDA IPC isn't supported for this memory (use cudaAllocShared() instead)\n");
+		return false;
+	}
+
+	handle->type   = CUDA_IPC_DEVICE;
+	handle->device = attributes.device;
+	handle->offset = (CUdeviceptr)ptr - base;
+
+	return true;
+}
+
+
+// cudaIpcOpen (maps the allocation of a handle into this process)
+static bool cudaIpcOpen( const cudaIpcHandle& handle, cudaImportedAlloc& alloc )
+{
+	if( handle.type == CUDA_IPC_HOST )
+	{
+		const int fd = shm_open(alloc.key.c_str(), O_RDWR, 0);
+
+		if( fd < 0 )
+		{
+			LogError(LOG_CUDA "cudaIpcImport() -- failed to open shared memory '%s' (it may have been freed)\n", alloc.key.c_str());
+			return false;
+		}
+
+		struct stat info;
+
+		if( fstat(fd, &info) != 0 || handle.offset + handle.size > (uint64_t)info.st_size )
+		{
+			LogError(LOG_CUDA "cudaIpcImport() -- shared memory '%s' is smaller than the handle\n", alloc.key.c_str());
+			close(fd);
+			return false;
+		}
+
+		void* mapping = mmap(NULL, info.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+
+		if( mapping == MAP_FAILED )
+		{
+			LogError(LOG_CUDA "cudaIpcImport() -- failed to map shared memory '%s'\n", alloc.key.c_str());
+			return false;
+		}
+
+		if( CUDA_FAILED(cudaHostRegister(mapping, info.st_size, cudaHostRegisterMapped|cudaHostRegisterPortable)) )
+		{
+			munmap(mapping, info.st_size);
+			return false;
+		}
+
+		alloc.base = (uint8_t*)mapping;
+		alloc.size = info.st_size;
+	}
+	else if( handle.type == CUDA_IPC_DEVICE )
+	{
+		void* base = NULL;
+
+		if( CUDA_FAILED(cudaIpcOpenMemHandle(&base, handle.handle, cudaIpcMemLazyEnablePeerAccess)) )
+		{
+			LogError(LOG_CUDA "cudaIpcImport() -- failed to open CUDA IPC handle from process %i\n", handle.pid);
+			return false;
+		}
+
+		alloc.base = (uint8_t*)base;
+		alloc.size = handle.offset + handle.size;
+	}
+	else
+	{
+		LogError(LOG_CUDA "cudaIpcImport() -- invalid handle type (%u)\n", handle.type);
+		return false;
+	}
+
+	return true;
+}
+
+
+// cudaIpcImport
+void* cudaIpcImport( const cudaIpcHandle& handle )
+{
+	if( handle.magic != CUDA_IPC_MAGIC )
+	{
+		LogError(LOG_CUDA "cudaIpcImport() -- invalid handle\n");
+		return NULL;
+	}
+
+	if( handle.type == CUDA_IPC_DEVICE && handle.pid == getpid() )
+	{
+		LogError(LOG_CUDA "cudaIpcImport() -- device memory can't be imported by the process that exported it\n");
+		return NULL;
+	}
+
+	const std::string key = (handle.type == CUDA_IPC_HOST) ? std::string(handle.name, strnlen(handle.name, CUDA_IPC_MAX_NAME))
+											    : std::string((const char*)&handle.handle, sizeof(cudaIpcMemHandle_t));
+
+	gIpcMutex.Lock();
+
+	// reuse the mapping if this allocation was already imported
+	// (CUDA only allows each IPC handle to be opened once per process)
+	for( size_t n=0; n < gImportedAllocs.size(); n++ )
+	{
+		cudaImportedAlloc& alloc = gImportedAllocs[n];
+
+		if( alloc.type != handle.type || alloc.key != key )
+			continue;
+
+		if( handle.type == CUDA_IPC_HOST && handle.offset + handle.size > alloc.size )
+		{
+			gIpcMutex.Unlock();
+			LogError(LOG_CUDA "cudaIpcImport() -- shared memory '%s' is smaller than the handle\n", key.c_str());
+			return NULL;
+		}
+
+		if( handle.type == CUDA_IPC_DEVICE && handle.offset + handle.size > alloc.size )
+			alloc.size = handle.offset + handle.size;
+
+		alloc.refCount++;
+		gIpcMutex.Unlock();
+		return alloc.base + handle.offset;
+	}
+
+	cudaImportedAlloc alloc;
+
+	alloc.type = handle.type;
+	alloc.key = key;
+	alloc.base = NULL;
+	alloc.size = 0;
+	alloc.refCount = 1;
+
+	if( !cudaIpcOpen(handle, alloc) )
+	{
+		gIpcMutex.Unlock();
+		return NULL;
+	}
+
+	gImportedAllocs.push_back(alloc);
+	gIpcMutex.Unlock();
+
+	return alloc.base + handle.offset;
+}
+
+
+// cudaIpcRelease
+bool cudaIpcRelease( void* ptr )
+{
+	if( !ptr )
+		return false;
+
+	gIpcMutex.Lock();
+
+	for( size_t n=0; n < gImportedAllocs.size(); n++ )
+	{
+		cudaImportedAlloc alloc = gImportedAllocs[n];
+
+		if( (uint8_t*)ptr < alloc.base || (uint8_t*)ptr >= alloc.base + alloc.size )
+			continue;
+
+		if( --gImportedAllocs[n].refCount > 0 )
+		{
+			gIpcMutex.Unlock();
+			return true;
+		}
+
+		gImportedAllocs.erase(gImportedAllocs.begin() + n);
+		gIpcMutex.Unlock();
+
+		if( alloc.type == CUDA_IPC_HOST )
+		{
+			CUDA(cudaHostUnregister(alloc.base));
+			munmap(alloc.base, alloc.size);
+		}
+		else
+		{
+			CUDA(cudaIpcCloseMemHandle(alloc.base));
+		}
+
+		return true;
+	}
+
+	gIpcMutex.Unlock();
+	return false;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_IPC_H__
+#define __CUDA_IPC_H__
+
+
+#include "cudaUtility.h"
+
+
+/**
+ * Identifies a cudaIpcHandle (and the version of its layout).
+ * @ingroup cudaMemory
+ */
+#define CUDA_IPC_MAGIC 0x43495031	/* "CIP1" */
+
+/**
+ * Maximum length of the shared memory name in a cudaIpcHandle.
+ * @ingroup cudaMemory
+ */
+#define CUDA_IPC_MAX_NAME 64
+
+
+/**
+ * Handle for sharing CUDA memory with another process without copying it.
+ * It's plain data, so it can be sent over a pipe or socket (or pickled from Python).
+ *
+ * Device memory (from cudaMalloc) is shared with CUDA IPC handles, which needs a discrete GPU
+ * (or a Jetson whose CUDA version supports them).  Mapped memory can only be shared if it was
+ * allocated with cudaAllocShared(), where it's backed by POSIX shared memory (like shmFrameWriter),
+ * and this works on any system including Jetson's integrated GPUs.
+ *
+ * @see cudaIpcExport() and cudaIpcImport()
+ * @ingroup cudaMemory
+ */
+struct cudaIpcHandle
+{
+	uint32_t magic;		/**< CUDA_IPC_MAGIC */
+	uint32_t type;		/**< CUDA_IPC_DEVICE or CUDA_IPC_HOST */
+	int32_t  device;	/**< The GPU that device memory was allocated on */
+	int32_t  pid;		/**< The process that exported the memory */
+	uint64_t size;		/**< Size of the shared range (in bytes) */
+	uint64_t offset;	/**< Offset of the range from the start of the allocation (in bytes) */
+
+	cudaIpcMemHandle_t handle;		/**< CUDA IPC handle of the allocation (CUDA_IPC_DEVICE) */
+	char name[CUDA_IPC_MAX_NAME];	/**< Name of the POSIX shared memory (CUDA_IPC_HOST) */
+};
+
+/**
+ * Types of memory that a cudaIpcHandle can refer to.
+ * @ingroup cudaMemory
+ */
+enum cudaIpcType
+{
+	CUDA_IPC_DEVICE = 0,	/**< Device memory, shared with cudaIpcGetMemHandle() */
+	CUDA_IPC_HOST			/**< Mapped memory from cudaAllocShared(), shared with POSIX shared memory */
+};
+
+
+/**
+ * Allocate mapped memory (like cudaAllocMapped()) that can be shared with other processes.
+ * It's created in POSIX shared memory and registered with CUDA, so that another process
+ * can map the same physical pages with cudaIpcImport() - on Jetson, this is the way to
+ * share frames between processes without copying, since CUDA IPC handles aren't supported.
+ * The memory is zeroed, and must be released with cudaFreeShared().
+ * @ingroup cudaMemory
+ */
+bool cudaAllocShared( void** ptr, size_t size );
+
+/**
+ * Free memory that was allocated with cudaAllocShared().  Processes that already imported it
+ * keep their mapping until they release it, but it can't be imported again afterwards.
+ * @returns `false` if the pointer wasn't allocated with cudaAllocShared().
+ * @ingroup cudaMemory
+ */
+bool cudaFreeShared( void* ptr );
+
+/**
+ * Create a handle that another process can use to access this memory without copying it.
+ * The memory must either be device memory, or mapped memory from cudaAllocShared() -
+ * other mapped memory (like from cudaAllocMapped()) can't be shared and returns an error.
+ * The pointer can be anywhere inside of an allocation, and the allocation needs to stay
+ * alive until the other processes are done with it (this isn't tracked across processes).
+ * @ingroup cudaMemory
+ */
+bool cudaIpcExport( void* ptr, size_t size, cudaIpcHandle* handle );
+
+/**
+ * Open a handle from cudaIpcExport() in another process, and return the pointer to the memory
+ * (which can be used from both the CPU and GPU for CUDA_IPC_HOST, and the GPU for CUDA_IPC_DEVICE).
+ * Importing the same allocation more than once is reference counted, and each import needs
+ * to be released with cudaIpcRelease().  Device memory can't be imported by the process that
+ * exported it (CUDA doesn't allow that), but it already has the pointer.
+ * @returns the pointer, or NULL on error.
+ * @ingroup cudaMemory
+ */
+void* cudaIpcImport( const cudaIpcHandle& handle );
+
+/**
+ * Release memory that was opened with cudaIpcImport().
+ * @returns `false` if the pointer wasn't imported.
+ * @ingroup cudaMemory
+ */
+bool cudaIpcRelease( void* ptr );
+
+
+#endif
@@ -25,6 +25,7 @@
 
 
 #include "cudaUtility.h"
+#include "cudaMemoryStats.h"
 #include "imageFormat.h"
 #include "logging.h"
 
@@ -37,15 +38,24 @@
  * @param[out] cpuPtr Returned CPU pointer to the shared memory.
  * @param[out] gpuPtr Returned GPU pointer to the shared memory.
  * @param[in] size Size (in bytes) of the shared memory to allocate.
+ * @param[in] category The category that the memory gets accounted for in (see cudaMemoryUsage()).
  *
- * @returns `true` if the allocation succeeded, `false` otherwise.
+ * @returns `true` if the allocation succeeded, `false` otherwise (including when
+ *          it would go over the budget set with cudaMemorySetBudget()).
  * @ingroup cudaMemory
  */
-inline bool cudaAllocMapped( void** cpuPtr, void** gpuPtr, size_t size )
+inline bool cudaAllocMapped( void** cpuPtr, void** gpuPtr, size_t size, cudaMemoryCategory category=CUDA_MEMORY_MAPPED )
 {
 	if( !cpuPtr || !gpuPtr || size == 0 )
 		return false;
 
+	if( !cudaMemoryFits(size) )
+	{
+		LogError(LOG_CUDA "cudaAllocMapped() -- allocating %zu bytes would exceed the memory budget\n", size);
+		cudaMemoryReport();
+		return false;
+	}
+
 	//CUDA(cudaSetDeviceFlags(cudaDeviceMapHost));
 
 	if( CUDA_FAILED(cudaHostAlloc(cpuPtr, size, cudaHostAllocMapped)) )
@@ -54,6 +64,8 @@ inline bool cudaAllocMapped( void** cpuPtr, void** gpuPtr, size_t size )
 	if( CUDA_FAILED(cudaHostGetDevicePointer(gpuPtr, *cpuPtr, 0)) )
 		return false;
 
+	cudaMemoryTrack(*cpuPtr, size, category);
+
 	memset(*cpuPtr, 0, size);
 	LogDebug(LOG_CUDA "cudaAllocMapped %zu bytes, CPU %p GPU %p\n", size, *cpuPtr, *gpuPtr);
 	return true;
@@ -68,11 +80,12 @@ inline bool cudaAllocMapped( void** cpuPtr, void** gpuPtr, size_t size )
  *
  * @param[out] ptr Returned pointer to the shared CPU/GPU memory.
  * @param[in] size Size (in bytes) of the shared memory to allocate.
+ * @param[in] category The category that the memory gets accounted for in (see cudaMemoryUsage()).
  *
  * @returns `true` if the allocation succeeded, `false` otherwise.
  * @ingroup cudaMemory
  */
-inline bool cudaAllocMapped( void** ptr, size_t size )
+inline bool cudaAllocMapped( void** ptr, size_t size, cudaMemoryCategory category=CUDA_MEMORY_MAPPED )
 {
 	void* cpuPtr = NULL;
 	void* gpuPtr = NULL;
@@ -80,7 +93,7 @@ inline bool cudaAllocMapped( void** ptr, size_t size )
 	if( !ptr || size == 0 )
 		return false;
 
-	if( !cudaAllocMapped(&cpuPtr, &gpuPtr, size) )
+	if( !cudaAllocMapped(&cpuPtr, &gpuPtr, size, category) )
 		return false;
 
 	if( cpuPtr != gpuPtr )
@@ -191,4 +204,42 @@ template<typename T> inline bool cudaAllocMapped( T** ptr, size_t size )
 	return cudaAllocMapped((void**)ptr, size);
 }
 
+/**
+ * Free memory that was allocated with cudaAllocMapped(), and remove it from the
+ * memory accounting (see cudaMemoryUsage()).  This should be used instead of cudaFreeHost().
+ *
+ * @returns `true` if the memory was freed, `false` if there was an error.
+ * @ingroup cudaMemory
+ */
+inline bool cudaFreeMapped( void* ptr )
+{
+	if( !ptr )
+		return true;
+
+	cudaMemoryUntrack(ptr);
+	return !CUDA_FAILED(cudaFreeHost(ptr));
+}
+
+/**
+ * Check if a CUDA device is an integrated GPU (like Jetson) that shares
+ * physical memory with the CPU, where mapped zeroCopy memory is as fast as device memory.
+ * On discrete GPUs, kernels that read mapped memory have to go over PCIe for it.
+ *
+ * @param device the CUDA device to check (or -1 for the current device)
+ * @returns `true` if the GPU is integrated, `false` if it's discrete (or there was an error).
+ * @ingroup cudaMemory
+ */
+inline bool cudaIsIntegrated( int device=-1 )
+{
+	int integrated = 0;
+
+	if( device < 0 && CUDA_FAILED(cudaGetDevice(&device)) )
+		return false;
+
+	if( CUDA_FAILED(cudaDeviceGetAttribute(&integrated, cudaDevAttrIntegrated, device)) )
+		return false;
+
+	return integrated != 0;
+}
+
 #endif
@@ -24,6 +24,7 @@
 #define __CUDA_HELPER_MATH_H_
 
 #include "cuda_runtime.h"
+#include "cuda_fp16.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 /// @name Vector Math
@@ -1726,6 +1727,288 @@ inline __device__ __host__ float4 smoothstep(float4 a, float4 b, float4 x)
     return (y*y*(make_float4(3.0f) - (make_float4(2.0f)*y)));
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// half-precision vectors
+// - half3 and half4 are the pixels of the RGB16F and RGBA16F formats
+// - the arithmetic is done on pairs of components with the half2 intrinsics
+//   (which are emulated in fp32 on GPUs older than sm_53)
+////////////////////////////////////////////////////////////////////////////////
+
+struct half3
+{
+    __half x, y, z;
+};
+
+struct __align__(8) half4
+{
+    __half x, y, z, w;
+};
+
+inline __host__ __device__ half3 make_half3(__half x, __half y, __half z)
+{
+    half3 t; t.x = x; t.y = y; t.z = z; return t;
+}
+inline __host__ __device__ half3 make_half3(float3 a)
+{
+    return make_half3(__float2half(a.x), __float2half(a.y), __float2half(a.z));
+}
+inline __host__ __device__ half3 make_half3(float4 a)
+{
+    return make_half3(__float2half(a.x), __float2half(a.y), __float2half(a.z));
+}
+inline __host__ __device__ half3 make_half3(uchar3 a)
+{
+    return make_half3(make_float3(a));
+}
+inline __host__ __device__ half3 make_half3(uchar4 a)
+{
+    return make_half3(make_float3(a));
+}
+inline __host__ __device__ half3 make_half3(half4 a)
+{
+    return make_half3(a.x, a.y, a.z);
+}
+
+inline __host__ __device__ half4 make_half4(__half x, __half y, __half z, __half w)
+{
+    half4 t; t.x = x; t.y = y; t.z = z; t.w = w; return t;
+}
+inline __host__ __device__ half4 make_half4(float4 a)
+{
+    return make_half4(__float2half(a.x), __float2half(a.y), __float2half(a.z), __float2half(a.w));
+}
+inline __host__ __device__ half4 make_half4(float3 a)
+{
+    return make_half4(make_float4(a));
+}
+inline __host__ __device__ half4 make_half4(uchar4 a)
+{
+    return make_half4(make_float4(a));
+}
+inline __host__ __device__ half4 make_half4(uchar3 a)
+{
+    return make_half4(make_float4(a));
+}
+inline __host__ __device__ half4 make_half4(half3 a)
+{
+    return make_half4(a.x, a.y, a.z, __float2half(0.0f));
+}
+
+inline __host__ __device__ float3 make_float3(half3 a)
+{
+    return make_float3(__half2float(a.x), __half2float(a.y), __half2float(a.z));
+}
+inline __host__ __device__ float3 make_float3(half4 a)
+{
+    return make_float3(__half2float(a.x), __half2float(a.y), __half2float(a.z));
+}
+inline __host__ __device__ float4 make_float4(half3 a)
+{
+    return make_float4(__half2float(a.x), __half2float(a.y), __half2float(a.z), 0.0f);
+}
+inline __host__ __device__ float4 make_float4(half4 a)
+{
+    return make_float4(__half2float(a.x), __half2float(a.y), __half2float(a.z), __half2float(a.w));
+}
+inline __host__ __device__ uchar3 make_uchar3(half3 a)
+{
+    return make_uchar3(make_float3(a));
+}
+inline __host__ __device__ uchar3 make_uchar3(half4 a)
+{
+    return make_uchar3(make_float3(a));
+}
+inline __host__ __device__ uchar4 make_uchar4(half3 a)
+{
+    return make_uchar4(make_float4(a));
+}
+inline __host__ __device__ uchar4 make_uchar4(half4 a)
+{
+    return make_uchar4(make_float4(a));
+}
+
+#ifdef __CUDACC__
+
+// pairwise operations on half2 (with fp32 fallbacks for older GPUs)
+inline __device__ __half2 hadd2(__half2 a, __half2 b)
+{
+#if __CUDA_ARCH__ >= 530
+    return __hadd2(a, b);
+#else
+    const float2 fa = __half22float2(a), fb = __half22float2(b);
+    return __floats2half2_rn(fa.x + fb.x, fa.y + fb.y);
+#endif
+}
+inline __device__ __half2 hsub2(__half2 a, __half2 b)
+{
+#if __CUDA_ARCH__ >= 530
+    return __hsub2(a, b);
+#else
+    const float2 fa = __half22float2(a), fb = __half22float2(b);
+    return __floats2half2_rn(fa.x - fb.x, fa.y - fb.y);
+#endif
+}
+inline __device__ __half2 hmul2(__half2 a, __half2 b)
+{
+#if __CUDA_ARCH__ >= 530
+    return __hmul2(a, b);
+#else
+    const float2 fa = __half22float2(a), fb = __half22float2(b);
+    return __floats2half2_rn(fa.x * fb.x, fa.y * fb.y);
+#endif
+}
+inline __device__ __half2 hfma2(__half2 a, __half2 b, __half2 c)
+{
+#if __CUDA_ARCH__ >= 530
+    return __hfma2(a, b, c);
+#else
+    const float2 fa = __half22float2(a), fb = __half22float2(b), fc = __half22float2(c);
+    return __floats2half2_rn(fa.x * fb.x + fc.x, fa.y * fb.y + fc.y);
+#endif
+}
+inline __device__ __half2 hdiv2(__half2 a, __half2 b)
+{
+#if __CUDA_ARCH__ >= 530
+    return __h2div(a, b);
+#else
+    const float2 fa = __half22float2(a), fb = __half22float2(b);
+    return __floats2half2_rn(fa.x / fb.x, fa.y / fb.y);
+#endif
+}
+inline __device__ __half2 hmin2(__half2 a, __half2 b)
+{
+#if __CUDA_ARCH__ >= 800
+    return __hmin2(a, b);
+#else
+    const float2 fa = __half22float2(a), fb = __half22float2(b);
+    return __halves2half2(fa.x < fb.x ? __low2half(a) : __low2half(b), fa.y < fb.y ? __high2half(a) : __high2half(b));
+#endif
+}
+inline __device__ __half2 hmax2(__half2 a, __half2 b)
+{
+#if __CUDA_ARCH__ >= 800
+    return __hmax2(a, b);
+#else
+    const float2 fa = __half22float2(a), fb = __half22float2(b);
+    return __halves2half2(fa.x > fb.x ? __low2half(a) : __low2half(b), fa.y > fb.y ? __high2half(a) : __high2half(b));
+#endif
+}
+
+// split half3/half4 into half2 pairs (the z component of half3 is duplicated into both lanes)
+inline __device__ __half2 half2_xy(half3 a) { return __halves2half2(a.x, a.y); }
+inline __device__ __half2 half2_zz(half3 a) { return __half2half2(a.z); }
+inline __device__ __half2 half2_xy(half4 a) { return __halves2half2(a.x, a.y); }
+inline __device__ __half2 half2_zw(half4 a) { return __halves2half2(a.z, a.w); }
+
+inline __device__ half3 make_half3(__half2 xy, __half2 zz)
+{
+    return make_half3(__low2half(xy), __high2half(xy), __low2half(zz));
+}
+inline __device__ half4 make_half4(__half2 xy, __half2 zw)
+{
+    return make_half4(__low2half(xy), __high2half(xy), __low2half(zw), __high2half(zw));
+}
+
+// apply a half2 operation to each pair of components
+#define HALF_VECTOR_OP(name, op) \
+inline __device__ half3 name(half3 a, half3 b) \
+{ \
+    return make_half3(op(half2_xy(a), half2_xy(b)), op(half2_zz(a), half2_zz(b))); \
+} \
+inline __device__ half4 name(half4 a, half4 b) \
+{ \
+    return make_half4(op(half2_xy(a), half2_xy(b)), op(half2_zw(a), half2_zw(b))); \
+} \
+inline __device__ half3 name(half3 a, __half b) \
+{ \
+    const __half2 s = __half2half2(b); \
+    return make_half3(op(half2_xy(a), s), op(half2_zz(a), s)); \
+} \
+inline __device__ half4 name(half4 a, __half b) \
+{ \
+    const __half2 s = __half2half2(b); \
+    return make_half4(op(half2_xy(a), s), op(half2_zw(a), s)); \
+} \
+inline __device__ half3 name(__half a, half3 b) \
+{ \
+    const __half2 s = __half2half2(a); \
+    return make_half3(op(s, half2_xy(b)), op(s, half2_zz(b))); \
+} \
+inline __device__ half4 name(__half a, half4 b) \
+{ \
+    const __half2 s = __half2half2(a); \
+    return make_half4(op(s, half2_xy(b)), op(s, half2_zw(b))); \
+}
+
+HALF_VECTOR_OP(operator+, hadd2)
+HALF_VECTOR_OP(operator-, hsub2)
+HALF_VECTOR_OP(operator*, hmul2)
+HALF_VECTOR_OP(operator/, hdiv2)
+HALF_VECTOR_OP(fminf, hmin2)
+HALF_VECTOR_OP(fmaxf, hmax2)
+
+#undef HALF_VECTOR_OP
+
+inline __device__ half3 operator-(half3 a)
+{
+    const __half2 zero = __float2half2_rn(0.0f);
+    return make_half3(hsub2(zero, half2_xy(a)), hsub2(zero, half2_zz(a)));
+}
+inline __device__ half4 operator-(half4 a)
+{
+    const __half2 zero = __float2half2_rn(0.0f);
+    return make_half4(hsub2(zero, half2_xy(a)), hsub2(zero, half2_zw(a)));
+}
+
+inline __device__ void operator+=(half3 &a, half3 b) { a = a + b; }
+inline __device__ void operator+=(half4 &a, half4 b) { a = a + b; }
+inline __device__ void operator-=(half3 &a, half3 b) { a = a - b; }
+inline __device__ void operator-=(half4 &a, half4 b) { a = a - b; }
+inline __device__ void operator*=(half3 &a, half3 b) { a = a * b; }
+inline __device__ void operator*=(half4 &a, half4 b) { a = a * b; }
+inline __device__ void operator*=(half3 &a, __half b) { a = a * b; }
+inline __device__ void operator*=(half4 &a, __half b) { a = a * b; }
+inline __device__ void operator/=(half3 &a, __half b) { a = a / b; }
+inline __device__ void operator/=(half4 &a, __half b) { a = a / b; }
+
+// a + t*(b-a) with one fused multiply-add per pair
+inline __device__ half3 lerp(half3 a, half3 b, __half t)
+{
+    const __half2 s = __half2half2(t);
+    return make_half3(hfma2(s, hsub2(half2_xy(b), half2_xy(a)), half2_xy(a)),
+                      hfma2(s, hsub2(half2_zz(b), half2_zz(a)), half2_zz(a)));
+}
+inline __device__ half4 lerp(half4 a, half4 b, __half t)
+{
+    const __half2 s = __half2half2(t);
+    return make_half4(hfma2(s, hsub2(half2_xy(b), half2_xy(a)), half2_xy(a)),
+                      hfma2(s, hsub2(half2_zw(b), half2_zw(a)), half2_zw(a)));
+}
+
+inline __device__ half3 clamp(half3 v, __half a, __half b)
+{
+    const __half2 lo = __half2half2(a), hi = __half2half2(b);
+    return make_half3(hmax2(lo, hmin2(half2_xy(v), hi)), hmax2(lo, hmin2(half2_zz(v), hi)));
+}
+inline __device__ half4 clamp(half4 v, __half a, __half b)
+{
+    const __half2 lo = __half2half2(a), hi = __half2half2(b);
+    return make_half4(hmax2(lo, hmin2(half2_xy(v), hi)), hmax2(lo, hmin2(half2_zw(v), hi)));
+}
+
+inline __device__ __half dot(half3 a, half3 b)
+{
+    const __half2 p = hfma2(__halves2half2(a.z, __float2half(0.0f)), half2_zz(b), hmul2(half2_xy(a), half2_xy(b)));
+    return __float2half(__low2float(p) + __high2float(p));
+}
+inline __device__ __half dot(half4 a, half4 b)
+{
+    const __half2 p = hfma2(half2_zw(a), half2_zw(b), hmul2(half2_xy(a), half2_xy(b)));
+    return __float2half(__low2float(p) + __high2float(p));
+}
+
+#endif
+
 ///@}
 
 #endif
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaMemoryPool.h"
+#include "cudaMappedMemory.h"
+#include "logging.h"
+#include "Mutex.h"
+
+#include <map>
+#include <vector>
+
+
+// a cached allocation
+struct cudaPoolBlock
+{
+	void*       ptr;
+	size_t      size;	// bucket size of the block
+	cudaEvent_t event;	// recorded when the block was freed
+};
+
+// a pool of mapped or device memory
+struct cudaPool
+{
+	const char* name;
+	bool mapped;
+	size_t idleBytes;
+	size_t usedBytes;
+	size_t peakBytes;
+	uint64_t hits;
+	uint64_t misses;
+
+	std::map<size_t, std::vector<cudaPoolBlock>> idle;	// free blocks, by bucket size
+	std::map<void*, cudaPoolBlock> used;				// allocated blocks, by pointer
+};
+
+static cudaPool gMappedPool = { "mapped", true, 0, 0, 0, 0, 0 };
+static cudaPool gDevicePool = { "device", false, 0, 0, 0, 0, 0 };
+
+static Mutex gPoolMutex;
+
+
+// round up the size into a bucket (4 buckets per power-of-two, from 4KB)
+static size_t cudaPoolBucket( size_t size )
+{
+	const size_t minSize = 4096;
+
+	if( size <= minSize )
+		return minSize;
+
+	size_t pow2 = minSize;
+
+	while( pow2 * 2 < size )
+		pow2 *= 2;
+
+	const size_t step = pow2 / 4;
+	return ((size + step - 1) / step) * step;
+}
+
+
+// cudaPoolAlloc
+static bool cudaPoolAlloc( cudaPool& pool, void** ptr, size_t size )
+{
+	if( !ptr || size == 0 )
+		return false;
+
+	const size_t bucket = cudaPoolBucket(size);
+
+	cudaPoolBlock block;
+	
+	block.ptr   = NULL;
+	block.size  = bucket;
+	block.event = NULL;
+
+	// check for an idle block of the same size
+	gPoolMutex.Lock();
+
+	std::map<size_t, std::vector<cudaPoolBlock>>::iterator iter = pool.idle.find(bucket);
+	
+	if( iter != pool.idle.end() && iter->second.size() > 0 )
+	{
+		block = iter->second.back();
+		iter->second.pop_back();
+		pool.idleBytes -= bucket;
+		pool.hits++;
+	}
+	else
+	{
+		pool.misses++;
+	}
+
+	gPoolMutex.Unlock();
+
+	if( block.ptr != NULL )
+	{
+		// wait for the GPU to finish the work that was queued before it was freed
+		CUDA(cudaEventSynchronize(block.event));
+	}
+	else
+	{
+		// allocate a new block
+		if( pool.mapped )
+		{
+			if( !cudaAllocMapped(&block.ptr, bucket, CUDA_MEMORY_POOL) )
+				return false;
+		}
+		else
+		{
+			if( !cudaMemoryFits(bucket) || CUDA_FAILED(cudaMalloc(&block.ptr, bucket)) )
+				return false;
+
+			cudaMemoryTrack(block.ptr, bucket, CUDA_MEMORY_POOL);
+		}
+
+		if( CUDA_FAILED(cudaEventCreateWithFlags(&block.event, cudaEventDisableTiming)) )
+		{
+			if( pool.mapped )
+			{
+				cudaFreeMapped(block.ptr);
+			}
+			else
+			{
+				cudaMemoryUntrack(block.ptr);
+				CUDA(cudaFree(block.ptr));
+			}
+
+			return false;
+		}
+
+		LogDebug(LOG_CUDA "cudaPool -- allocated new %s block of %zu bytes (%zu bytes requested)\n", pool.name, bucket, size);
+	}
+
+	// keep the same semantics as cudaAllocMapped()
+	if( pool.mapped )
+		memset(block.ptr, 0, size);
+
+	gPoolMutex.Lock();
+	pool.used[block.ptr] = block;
+	pool.usedBytes += bucket;
+
+	if( pool.usedBytes > pool.peakBytes )
+		pool.peakBytes = pool.usedBytes;
+
+	gPoolMutex.Unlock();
+
+	*ptr = block.ptr;
+	return true;
+}
+
+
+// cudaAllocMappedPooled
+bool cudaAllocMappedPooled( void** ptr, size_t size )
+{
+	return cudaPoolAlloc(gMappedPool, ptr, size);
+}
+
+
+// cudaMallocPooled
+bool cudaMallocPooled( void** ptr, size_t size )
+{
+	return cudaPoolAlloc(gDevicePool, ptr, size);
+}
+
+
+// cudaPoolFree
+static bool cudaPoolFree( cudaPool& pool, void* ptr, cudaStream_t stream )
+{
+	std::map<void*, cudaPoolBlock>::iterator iter = pool.used.find(ptr);
+
+	if( iter == pool.used.end() )
+		return false;
+
+	cudaPoolBlock block = iter->second;
+	pool.used.erase(iter);
+
+	// the block can be re-used once the work queued on the stream before this point is complete
+	CUDA(cudaEventRecord(block.event, stream));
+
+	pool.idle[block.size].push_back(block);
+	pool.usedBytes -= block.size;
+	pool.idleBytes += block.size;
+
+	return true;
+}
+
+
+// cudaFreePooled
+bool cudaFreePooled( void* ptr, cudaStream_t stream )
+{
+	if( !ptr )
+		return false;
+
+	gPoolMutex.Lock();
+	const bool found = cudaPoolFree(gMappedPool, ptr, stream) || cudaPoolFree(gDevicePool, ptr, stream);
+	gPoolMutex.Unlock();
+
+	return found;
+}
+
+
+// cudaPoolGetStats
+static void cudaPoolGetStats( const cudaPool& pool, cudaPoolStats* stats )
+{
+	if( !stats )
+		return;
+
+	stats->usedBytes = pool.usedBytes;
+	stats->idleBytes = pool.idleBytes;
+	stats->peakBytes = pool.peakBytes;
+	stats->hits      = pool.hits;
+	stats->misses    = pool.misses;
+}
+
+
+// cudaPoolGetStats
+void cudaPoolGetStats( cudaPoolStats* mapped, cudaPoolStats* device )
+{
+	gPoolMutex.Lock();
+	cudaPoolGetStats(gMappedPool, mapped);
+	cudaPoolGetStats(gDevicePool, device);
+	gPoolMutex.Unlock();
+}
+
+
+// cudaPoolTrim
+static void cudaPoolTrim( cudaPool& pool )
+{
+	for( std::map<size_t, std::vector<cudaPoolBlock>>::iterator iter = pool.idle.begin(); iter != pool.idle.end(); iter++ )
+	{
+		const size_t numBlocks = iter->second.size();
+
+		for( size_t n=0; n < numBlocks; n++ )
+		{
+			const cudaPoolBlock& block = iter->second[n];
+
+			CUDA(cudaEventSynchronize(block.event));
+			CUDA(cudaEventDestroy(block.event));
+
+			if( pool.mapped )
+			{
+				cudaFreeMapped(block.ptr);
+			}
+			else
+			{
+				cudaMemoryUntrack(block.ptr);
+				CUDA(cudaFree(block.ptr));
+			}
+		}
+	}
+
+	if( pool.idleBytes > 0 )
+		LogVerbose(LOG_CUDA "cudaPool -- released %zu bytes of idle %s memory (%zu bytes still in use)\n", pool.idleBytes, pool.name, pool.usedBytes);
+
+	pool.idle.clear();
+	pool.idleBytes = 0;
+}
+
+
+// cudaPoolTrim
+void cudaPoolTrim()
+{
+	gPoolMutex.Lock();
+	cudaPoolTrim(gMappedPool);
+	cudaPoolTrim(gDevicePool);
+	gPoolMutex.Unlock();
+}
+
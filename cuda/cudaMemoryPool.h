@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_MEMORY_POOL_H_
+#define __CUDA_MEMORY_POOL_H_
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * Allocate ZeroCopy mapped memory from a pool of cached allocations.
+ *
+ * This has the same semantics as cudaAllocMapped() (including the memory being
+ * cleared to zero), but memory released with cudaFreePooled() is kept and handed
+ * out again to later requests of a similar size, instead of being returned to
+ * the driver.  Steady-state pipelines that allocate and free the same image
+ * sizes every frame will then stop calling cudaHostAlloc()/cudaFreeHost().
+ *
+ * Requests are rounded up into size buckets (4 buckets per power-of-two), so
+ * a block may be slightly larger than what was requested.
+ *
+ * @param[out] ptr Returned pointer to the shared CPU/GPU memory.
+ * @param[in] size Size (in bytes) of the shared memory to allocate.
+ *
+ * @returns `true` if the allocation succeeded, `false` otherwise.
+ * @ingroup cudaMemory
+ */
+bool cudaAllocMappedPooled( void** ptr, size_t size );
+
+/**
+ * Allocate ZeroCopy mapped memory from a pool of cached allocations,
+ * with the size calculated by imageFormatSize().
+ * @see cudaAllocMappedPooled()
+ * @ingroup cudaMemory
+ */
+inline bool cudaAllocMappedPooled( void** ptr, size_t width, size_t height, imageFormat format )
+{
+	return cudaAllocMappedPooled(ptr, imageFormatSize(format, width, height));
+}
+
+/**
+ * Allocate ZeroCopy mapped memory from a pool of cached allocations,
+ * with the size calculated as `width * height * sizeof(T)`.
+ * @see cudaAllocMappedPooled()
+ * @ingroup cudaMemory
+ */
+template<typename T> inline bool cudaAllocMappedPooled( T** ptr, size_t width, size_t height )
+{
+	return cudaAllocMappedPooled((void**)ptr, width * height * sizeof(T));
+}
+
+/**
+ * Allocate GPU device memory from a pool of cached allocations.
+ *
+ * This is the pooled equivalent of cudaMalloc(), and like cudaMalloc()
+ * the memory isn't cleared.  Release it with cudaFreePooled().
+ *
+ * @param[out] ptr Returned pointer to the GPU memory.
+ * @param[in] size Size (in bytes) of the memory to allocate.
+ *
+ * @returns `true` if the allocation succeeded, `false` otherwise.
+ * @ingroup cudaMemory
+ */
+bool cudaMallocPooled( void** ptr, size_t size );
+
+/**
+ * Return memory from cudaAllocMappedPooled() or cudaMallocPooled() to its pool.
+ *
+ * The block isn't handed out again until the work that was queued on the GPU
+ * before it was freed has completed, so it's safe to free memory that pending
+ * kernels are still using (the same as with cudaFreeHost() and cudaFree()).
+ *
+ * @param stream the stream that the work using the memory was queued on.  The legacy
+ *               NULL stream doesn't order against streams created with
+ *               cudaStreamNonBlocking, so memory that's used by kernels on those
+ *               streams needs to be freed on the same stream.
+ *
+ * @returns `true` if the pointer belonged to one of the pools, or `false` if it
+ *          wasn't allocated from a pool (in which case nothing is done, and the
+ *          caller should free it with cudaFreeHost() or cudaFree() instead).
+ * @ingroup cudaMemory
+ */
+bool cudaFreePooled( void* ptr, cudaStream_t stream=0 );
+
+/**
+ * Statistics about the usage of a memory pool (see cudaPoolGetStats())
+ * @ingroup cudaMemory
+ */
+struct cudaPoolStats
+{
+	size_t   usedBytes;	/**< Bytes that are currently allocated from the pool */
+	size_t   idleBytes;	/**< Bytes of freed blocks that are cached for re-use */
+	size_t   peakBytes;	/**< The highest that usedBytes has been */
+	uint64_t hits;		/**< Number of allocations that re-used an idle block */
+	uint64_t misses;	/**< Number of allocations that needed a new block from the driver */
+};
+
+/**
+ * Retrieve the statistics of the mapped and device memory pools.
+ * Either pointer can be NULL if those statistics aren't needed.
+ * @ingroup cudaMemory
+ */
+void cudaPoolGetStats( cudaPoolStats* mapped, cudaPoolStats* device );
+
+/**
+ * Release the memory of all the idle blocks in the pools back to the driver.
+ * Blocks that are still allocated remain valid and return to the pool when freed.
+ * @ingroup cudaMemory
+ */
+void cudaPoolTrim();
+
+#endif
+
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaMemoryStats.h"
+#include "cudaUtility.h"
+#include "logging.h"
+#include "Mutex.h"
+
+#include <map>
+
+
+// a tracked allocation
+struct cudaMemoryBlock
+{
+	size_t bytes;
+	cudaMemoryCategory category;
+};
+
+static size_t gMemoryUsage[CUDA_MEMORY_CATEGORIES] = { 0 };
+static size_t gMemoryTotal  = 0;
+static size_t gMemoryPeak   = 0;
+static size_t gMemoryBudget = 0;
+
+static std::map<void*, cudaMemoryBlock> gMemoryBlocks;
+static Mutex gMemoryMutex;
+
+
+// cudaMemoryCategoryToStr
+const char* cudaMemoryCategoryToStr( cudaMemoryCategory category )
+{
+	switch(category)
+	{
+		case CUDA_MEMORY_MAPPED:	 return "mapped";
+		case CUDA_MEMORY_RINGBUFFER: return "ringbuffer";
+		case CUDA_MEMORY_POOL:	 return "pool";
+		case CUDA_MEMORY_TEXTURE:  return "texture";
+		case CUDA_MEMORY_FONT:	 return "font";
+		default:				 return "unknown";
+	}
+}
+
+
+// cudaMemoryUsage
+size_t cudaMemoryUsage( cudaMemoryCategory category )
+{
+	if( category < 0 || category >= CUDA_MEMORY_CATEGORIES )
+		return 0;
+
+	gMemoryMutex.Lock();
+	const size_t bytes = gMemoryUsage[category];
+	gMemoryMutex.Unlock();
+
+	return bytes;
+}
+
+
+// cudaMemoryUsage
+size_t cudaMemoryUsage()
+{
+	gMemoryMutex.Lock();
+	const size_t bytes = gMemoryTotal;
+	gMemoryMutex.Unlock();
+
+	return bytes;
+}
+
+
+// cudaMemoryPeak
+size_t cudaMemoryPeak()
+{
+	gMemoryMutex.Lock();
+	const size_t bytes = gMemoryPeak;
+	gMemoryMutex.Unlock();
+
+	return bytes;
+}
+
+
+// cudaMemorySetBudget
+void cudaMemorySetBudget( size_t bytes )
+{
+	gMemoryMutex.Lock();
+	gMemoryBudget = bytes;
+	gMemoryMutex.Unlock();
+
+	if( bytes > 0 )
+		LogVerbose(LOG_CUDA "memory budget set to %zu MB\n", bytes / (1024 * 1024));
+}
+
+
+// cudaMemoryGetBudget
+size_t cudaMemoryGetBudget()
+{
+	gMemoryMutex.Lock();
+	const size_t bytes = gMemoryBudget;
+	gMemoryMutex.Unlock();
+
+	return bytes;
+}
+
+
+// cudaMemoryFits
+bool cudaMemoryFits( size_t bytes )
+{
+	gMemoryMutex.Lock();
+	const bool fits = (gMemoryBudget == 0) || (gMemoryTotal + bytes <= gMemoryBudget);
+	gMemoryMutex.Unlock();
+
+	return fits;
+}
+
+
+// cudaMemoryAdd
+void cudaMemoryAdd( cudaMemoryCategory category, size_t bytes )
+{
+	if( category < 0 || category >= CUDA_MEMORY_CATEGORIES )
+		return;
+
+	gMemoryMutex.Lock();
+
+	gMemoryUsage[category] += bytes;
+	gMemoryTotal += bytes;
+
+	if( gMemoryTotal > gMemoryPeak )
+		gMemoryPeak = gMemoryTotal;
+
+	gMemoryMutex.Unlock();
+}
+
+
+// cudaMemorySubtract
+void cudaMemorySubtract( cudaMemoryCategory category, size_t bytes )
+{
+	if( category < 0 || category >= CUDA_MEMORY_CATEGORIES )
+		return;
+
+	gMemoryMutex.Lock();
+
+	bytes = (bytes < gMemoryUsage[category]) ? bytes : gMemoryUsage[category];
+
+	gMemoryUsage[category] -= bytes;
+	gMemoryTotal -= bytes;
+
+	gMemoryMutex.Unlock();
+}
+
+
+// cudaMemoryTrack
+void cudaMemoryTrack( void* ptr, size_t bytes, cudaMemoryCategory category )
+{
+	if( !ptr )
+		return;
+
+	cudaMemoryBlock block;
+
+	block.bytes    = bytes;
+	block.category = category;
+
+	gMemoryMutex.Lock();
+	gMemoryBlocks[ptr] = block;
+	gMemoryMutex.Unlock();
+
+	cudaMemoryAdd(category, bytes);
+}
+
+
+// cudaMemoryUntrack
+void cudaMemoryUntrack( void* ptr )
+{
+	if( !ptr )
+		return;
+
+	gMemoryMutex.Lock();
+
+	std::map<void*, cudaMemoryBlock>::iterator iter = gMemoryBlocks.find(ptr);
+
+	if( iter == gMemoryBlocks.end() )
+	{
+		gMemoryMutex.Unlock();
+		return;
+	}
+
+	const cudaMemoryBlock block = iter->second;
+	gMemoryBlocks.erase(iter);
+
+	gMemoryMutex.Unlock();
+
+	cudaMemorySubtract(block.category, block.bytes);
+}
+
+
+// cudaMemoryReport
+void cudaMemoryReport()
+{
+	size_t usage[CUDA_MEMORY_CATEGORIES];
+
+	gMemoryMutex.Lock();
+
+	for( int n=0; n < CUDA_MEMORY_CATEGORIES; n++ )
+		usage[n] = gMemoryUsage[n];
+
+	const size_t total  = gMemoryTotal;
+	const size_t peak   = gMemoryPeak;
+	const size_t budget = gMemoryBudget;
+
+	gMemoryMutex.Unlock();
+
+	const double MB = 1024.0 * 1024.0;
+
+	LogInfo(LOG_CUDA "memory usage:\n");
+
+	for( int n=0; n < CUDA_MEMORY_CATEGORIES; n++ )
+		LogInfo(LOG_CUDA "   %-12s %9.2f MB\n", cudaMemoryCategoryToStr((cudaMemoryCategory)n), usage[n] / MB);
+
+	LogInfo(LOG_CUDA "   %-12s %9.2f MB (peak %.2f MB)\n", "total", total / MB, peak / MB);
+
+	if( budget > 0 )
+		LogInfo(LOG_CUDA "   %-12s %9.2f MB (%.1f%% used)\n", "budget", budget / MB, total * 100.0 / budget);
+
+	size_t gpuFree = 0;
+	size_t gpuTotal = 0;
+
+	if( cudaMemGetInfo(&gpuFree, &gpuTotal) == cudaSuccess )
+		LogInfo(LOG_CUDA "   %-12s %9.2f MB free of %.2f MB\n", "GPU", gpuFree / MB, gpuTotal / MB);
+}
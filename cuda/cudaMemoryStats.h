@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_MEMORY_STATS_H__
+#define __CUDA_MEMORY_STATS_H__
+
+
+#include <stddef.h>
+
+
+/**
+ * The categories of memory that get accounted for by cudaMemoryUsage().
+ * @ingroup cudaMemory
+ */
+enum cudaMemoryCategory
+{
+	CUDA_MEMORY_MAPPED = 0,		/**< Other allocations from cudaAllocMapped() */
+	CUDA_MEMORY_RINGBUFFER,		/**< Buffers of RingBuffer (the frames of videoSource/videoOutput streams) */
+	CUDA_MEMORY_POOL,			/**< Blocks cached by cudaAllocMappedPooled() and cudaMallocPooled() */
+	CUDA_MEMORY_TEXTURE,		/**< OpenGL textures and their interop buffers (glTexture) */
+	CUDA_MEMORY_FONT,			/**< Glyph atlases and command buffers of cudaFont */
+	CUDA_MEMORY_CATEGORIES		/**< The number of categories */
+};
+
+/**
+ * Convert a cudaMemoryCategory to a string.
+ * @ingroup cudaMemory
+ */
+const char* cudaMemoryCategoryToStr( cudaMemoryCategory category );
+
+/**
+ * Get the number of bytes currently allocated in a category.
+ * @ingroup cudaMemory
+ */
+size_t cudaMemoryUsage( cudaMemoryCategory category );
+
+/**
+ * Get the total number of bytes currently allocated in all of the categories.
+ * @ingroup cudaMemory
+ */
+size_t cudaMemoryUsage();
+
+/**
+ * Get the highest total number of bytes that were allocated at once.
+ * @ingroup cudaMemory
+ */
+size_t cudaMemoryPeak();
+
+/**
+ * Set a budget for the total memory of all the categories (in bytes), or 0 for no budget.
+ *
+ * Once allocations would go over the budget, cudaAllocMapped() fails and RingBuffer::Alloc()
+ * shrinks the number of buffers that it allocates (down to 2, and fails after that).
+ * Creating a videoSource also fails if the budget has already been used up.  This way running
+ * out of memory is caught early (with a report of where it went), instead of at a random
+ * allocation later on.  The budget can also be set with `--memory-budget=MB` from the command line.
+ *
+ * @ingroup cudaMemory
+ */
+void cudaMemorySetBudget( size_t bytes );
+
+/**
+ * Get the memory budget (in bytes), or 0 if there isn't one.
+ * @ingroup cudaMemory
+ */
+size_t cudaMemoryGetBudget();
+
+/**
+ * Check if an allocation of this size would fit in the memory budget
+ * (this is always true if there isn't a budget).
+ * @ingroup cudaMemory
+ */
+bool cudaMemoryFits( size_t bytes );
+
+/**
+ * Add bytes to the usage of a category (when memory gets allocated).
+ * @ingroup cudaMemory
+ */
+void cudaMemoryAdd( cudaMemoryCategory category, size_t bytes );
+
+/**
+ * Subtract bytes from the usage of a category (when memory gets freed).
+ * @ingroup cudaMemory
+ */
+void cudaMemorySubtract( cudaMemoryCategory category, size_t bytes );
+
+/**
+ * Add an allocation to the usage of a category, and remember its size by pointer
+ * so that cudaMemoryUntrack() can subtract it again.  This is used by cudaAllocMapped().
+ * @ingroup cudaMemory
+ */
+void cudaMemoryTrack( void* ptr, size_t bytes, cudaMemoryCategory category );
+
+/**
+ * Subtract an allocation that was added with cudaMemoryTrack() from its category.
+ * Pointers that weren't tracked are ignored.  This is used by cudaFreeMapped().
+ * @ingroup cudaMemory
+ */
+void cudaMemoryUntrack( void* ptr );
+
+/**
+ * Log a report of the memory used by each category, the budget, and the
+ * free/total memory of the GPU (from cudaMemGetInfo()).
+ * @ingroup cudaMemory
+ */
+void cudaMemoryReport();
+
+#endif
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaMotion.h"
+#include "cudaMappedMemory.h"
+#include "cudaVector.h"
+#include "cudaNVTX.h"
+
+
+// luminance of a pixel (between 0 and 255)
+static __device__ inline float motionLuma( uint8_t v )			{ return v; }
+static __device__ inline float motionLuma( float v )			{ return v; }
+static __device__ inline float motionLuma( const uchar3& v )	{ return 0.299f * v.x + 0.587f * v.y + 0.114f * v.z; }
+static __device__ inline float motionLuma( const uchar4& v )	{ return 0.299f * v.x + 0.587f * v.y + 0.114f * v.z; }
+static __device__ inline float motionLuma( const float3& v )	{ return 0.299f * v.x + 0.587f * v.y + 0.114f * v.z; }
+static __device__ inline float motionLuma( const float4& v )	{ return 0.299f * v.x + 0.587f * v.y + 0.114f * v.z; }
+
+
+// gpuMotion (one thread per cell)
+template<typename T>
+__global__ void gpuMotion( T* input, int width, int height, float* background, uint8_t* mask, uint32_t* count,
+					  int maskWidth, int maskHeight, int scale, float threshold, float rate, bool init )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= maskWidth || y >= maskHeight )
+		return;
+
+	// average the luminance of the cell
+	const int x0 = x * scale;
+	const int y0 = y * scale;
+	const int x1 = min(x0 + scale, width);
+	const int y1 = min(y0 + scale, height);
+
+	float sum = 0.0f;
+
+	for( int py=y0; py < y1; py++ )
+		for( int px=x0; px < x1; px++ )
+			sum += motionLuma(input[py * width + px]);
+
+	const float value = sum / ((x1 - x0) * (y1 - y0));
+	const int idx = y * maskWidth + x;
+
+	// compare against the background, and update it
+	// (the first frame initializes the background, and counts as all of it changing)
+	const float bg = init ? value : background[idx];
+	const bool changed = init || fabsf(value - bg) > threshold;
+
+	background[idx] = bg + (value - bg) * rate;
+	mask[idx] = changed ? 255 : 0;
+
+	if( changed )
+		atomicAdd(count, 1u);
+}
+
+// launchMotion
+template<typename T>
+static cudaError_t launchMotion( void* input, int width, int height, float* background, uint8_t* mask, uint32_t* count,
+						   int maskWidth, int maskHeight, int scale, float threshold, float rate, bool init, cudaStream_t stream )
+{
+	const dim3 blockDim(16, 8);
+	const dim3 gridDim(iDivUp(maskWidth, blockDim.x), iDivUp(maskHeight, blockDim.y));
+
+	gpuMotion<T><<<gridDim, blockDim, 0, stream>>>((T*)input, width, height, background, mask, count,
+										  maskWidth, maskHeight, scale, threshold, rate, init);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// constructor
+cudaMotion::cudaMotion( float threshold, uint32_t scale, float learningRate )
+{
+	mBackground = NULL;
+	mMask       = NULL;
+	mCount      = NULL;
+	mEvent      = NULL;
+
+	mWidth        = 0;
+	mHeight       = 0;
+	mScale        = (scale > 0) ? scale : 1;
+	mMaskWidth    = 0;
+	mMaskHeight   = 0;
+	mMinRegion    = 2;
+	mThreshold    = threshold;
+	mLearningRate = learningRate;
+	mMinScore     = 0.002f;
+	mScore        = 0.0f;
+
+	mInitialized  = false;
+	mPending      = false;
+	mRegionsValid = false;
+}
+
+
+// destructor
+cudaMotion::~cudaMotion()
+{
+	free();
+
+	if( mEvent != NULL )
+	{
+		CUDA(cudaEventDestroy(mEvent));
+		mEvent = NULL;
+	}
+}
+
+
+// free
+void cudaMotion::free()
+{
+	if( mPending )
+		sync();
+
+	CUDA_FREE(mBackground);
+	CUDA_FREE_HOST(mMask);
+	CUDA_FREE_HOST(mCount);
+
+	mWidth       = 0;
+	mHeight      = 0;
+	mMaskWidth   = 0;
+	mMaskHeight  = 0;
+	mInitialized = false;
+}
+
+
+// alloc
+bool cudaMotion::alloc( uint32_t width, uint32_t height )
+{
+	if( width == mWidth && height == mHeight && mBackground != NULL )
+		return true;
+
+	free();
+
+	const uint32_t maskWidth  = iDivUp(width, mScale);
+	const uint32_t maskHeight = iDivUp(height, mScale);
+
+	if( CUDA_FAILED(cudaMalloc(&mBackground, maskWidth * maskHeight * sizeof(float))) )
+		return false;
+
+	if( !cudaAllocMapped(&mMask, maskWidth * maskHeight) || !cudaAllocMapped(&mCount, sizeof(uint32_t)) )
+		return false;
+
+	if( !mEvent && CUDA_FAILED(cudaEventCreateWithFlags(&mEvent, cudaEventDisableTiming)) )
+		return false;
+
+	mWidth      = width;
+	mHeight     = height;
+	mMaskWidth  = maskWidth;
+	mMaskHeight = maskHeight;
+
+	return true;
+}
+
+
+// Reset
+void cudaMotion::Reset()
+{
+	mInitialized = false;
+}
+
+
+// Process
+cudaError_t cudaMotion::Process( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaMotion");
+
+	if( !image )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	// the results of the previous frame get overwritten
+	if( mPending )
+		sync();
+
+	if( !alloc(width, height) )
+		return cudaErrorMemoryAllocation;
+
+	const bool init = !mInitialized;
+
+	if( CUDA_FAILED(cudaMemsetAsync(mCount, 0, sizeof(uint32_t), stream)) )
+		return cudaErrorInvalidValue;
+
+	cudaError_t result = cudaErrorInvalidValue;
+
+	#define LAUNCH_MOTION(type) \
+		result = launchMotion<type>(image, width, height, mBackground, mMask, mCount, mMaskWidth, mMaskHeight, \
+							   mScale, mThreshold, mLearningRate, init, stream)
+
+	if( format == IMAGE_GRAY8 || format == IMAGE_I420 || format == IMAGE_YV12 || format == IMAGE_NV12 )
+		LAUNCH_MOTION(uint8_t);		// the luma plane comes first
+	else if( format == IMAGE_GRAY32F )
+		LAUNCH_MOTION(float);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		LAUNCH_MOTION(uchar3);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		LAUNCH_MOTION(uchar4);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		LAUNCH_MOTION(float3);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		LAUNCH_MOTION(float4);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaMotion::Process()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	#undef LAUNCH_MOTION
+
+	if( result != cudaSuccess )
+		return result;
+
+	if( CUDA_FAILED(cudaEventRecord(mEvent, stream)) )
+		return cudaErrorInvalidValue;
+
+	mInitialized  = true;
+	mPending      = true;
+	mRegionsValid = false;
+
+	return cudaSuccess;
+}
+
+
+// sync
+bool cudaMotion::sync()
+{
+	if( !mPending )
+		return true;
+
+	mPending = false;
+
+	if( CUDA_FAILED(cudaEventSynchronize(mEvent)) )
+	{
+		mScore = 0.0f;
+		return false;
+	}
+
+	mScore = float(*mCount) / float(mMaskWidth * mMaskHeight);
+	return true;
+}
+
+
+// GetScore
+float cudaMotion::GetScore()
+{
+	sync();
+	return mScore;
+}
+
+
+// GetRegions
+const std::vector<int4>& cudaMotion::GetRegions()
+{
+	sync();
+
+	if( mRegionsValid )
+		return mRegions;
+
+	mRegions.clear();
+	mRegionsValid = true;
+
+	if( !mMask || mScore <= 0.0f )
+		return mRegions;
+
+	// flood fill the changed cells (with 8-connectivity)
+	const int maskWidth  = mMaskWidth;
+	const int maskHeight = mMaskHeight;
+
+	std::vector<uint8_t> visited(maskWidth * maskHeight, 0);
+	std::vector<int> stack;
+
+	for( int n=0; n < maskWidth * maskHeight; n++ )
+	{
+		if( !mMask[n] || visited[n] )
+			continue;
+
+		int4 box = make_int4(n % maskWidth, n / maskWidth, n % maskWidth, n / maskWidth);
+		uint32_t cells = 0;
+
+		visited[n] = 1;
+		stack.push_back(n);
+
+		while( !stack.empty() )
+		{
+			const int idx = stack.back();
+			const int x = idx % maskWidth;
+			const int y = idx / maskWidth;
+
+			stack.pop_back();
+			cells++;
+
+			box.x = min(box.x, x);
+			box.y = min(box.y, y);
+			box.z = max(box.z, x);
+			box.w = max(box.w, y);
+
+			for( int dy=-1; dy <= 1; dy++ )
+			{
+				for( int dx=-1; dx <= 1; dx++ )
+				{
+					const int nx = x + dx;
+					const int ny = y + dy;
+
+					if( nx < 0 || ny < 0 || nx >= maskWidth || ny >= maskHeight )
+						continue;
+
+					const int nidx = ny * maskWidth + nx;
+
+					if( mMask[nidx] && !visited[nidx] )
+					{
+						visited[nidx] = 1;
+						stack.push_back(nidx);
+					}
+				}
+			}
+		}
+
+		if( cells < mMinRegion )
+			continue;
+
+		// convert from cells to pixels
+		mRegions.push_back(make_int4(box.x * mScale, box.y * mScale,
+							    min((box.z + 1) * mScale, mWidth),
+							    min((box.w + 1) * mScale, mHeight)));
+	}
+
+	return mRegions;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_MOTION_H__
+#define __CUDA_MOTION_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+#include <vector>
+
+
+/**
+ * Motion detector for skipping (or cropping) the processing of frames where nothing moved.
+ *
+ * Each frame is downsampled into cells of `scale x scale` pixels, whose average luminance
+ * is compared against a background model (a running average of the previous frames).
+ * Cells that differ by more than the threshold are marked as changed.  This all happens in a
+ * single kernel launch per frame, and only the small mask of cells is ever read by the CPU.
+ *
+ * The results are computed lazily:  Process() only queues the kernel, and the first call to
+ * GetScore(), HasMotion() or GetRegions() afterwards waits for it to complete.  The changed
+ * regions are found from the mask (with 8-connectivity) only when GetRegions() is called.
+ *
+ * The supported formats are gray8, gray32f, rgb8, rgba8, rgb32f, rgba32f (and BGR), and
+ * the planar YUV formats (I420, YV12, NV12), which only have their luma plane read.
+ *
+ * @ingroup cuda
+ */
+class cudaMotion
+{
+public:
+	/**
+	 * Create a motion detector.
+	 * @param threshold the difference in average luminance (between 0 and 255) for a cell to be changed
+	 * @param scale the size of the cells (in pixels)
+	 * @param learningRate how quickly the background adapts to the new frames (1.0 is frame differencing)
+	 */
+	cudaMotion( float threshold=20.0f, uint32_t scale=8, float learningRate=0.05f );
+
+	/**
+	 * Destructor
+	 */
+	~cudaMotion();
+
+	/**
+	 * Compare a frame against the background, and update the background with it.
+	 * The first frame (or the first one after Reset() or a change in size) initializes the background,
+	 * and is reported as the whole frame having changed (so that it still gets processed).
+	 */
+	cudaError_t Process( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream=0 );
+
+	/**
+	 * Compare a frame against the background, and update the background with it.
+	 */
+	template<typename T> cudaError_t Process( T* image, uint32_t width, uint32_t height, cudaStream_t stream=0 )		{ return Process((void*)image, width, height, imageFormatFromType<T>(), stream); }
+
+	/**
+	 * Return the fraction of cells that changed in the last frame (between 0 and 1).
+	 */
+	float GetScore();
+
+	/**
+	 * Return true if the score of the last frame is more than the minimum score.
+	 * @see SetMinScore()
+	 */
+	inline bool HasMotion()							{ return GetScore() > mMinScore; }
+
+	/**
+	 * Return the bounding boxes of the regions that changed in the last frame, as
+	 * `(left, top, right, bottom)` in the coordinates of the input image (right and bottom
+	 * are exclusive, like cudaCrop()).  Regions smaller than the minimum size are ignored.
+	 * @see SetMinRegion()
+	 */
+	const std::vector<int4>& GetRegions();
+
+	/**
+	 * Relearn the background from the next frame.
+	 */
+	void Reset();
+
+	/**
+	 * Set the difference in average luminance (between 0 and 255) for a cell to be changed.
+	 */
+	inline void SetThreshold( float threshold )				{ mThreshold = threshold; }
+
+	/**
+	 * Set how quickly the background adapts to the new frames (between 0 and 1).
+	 */
+	inline void SetLearningRate( float rate )				{ mLearningRate = rate; }
+
+	/**
+	 * Set the score that HasMotion() needs to exceed (the default is 0.002, or 0.2% of the cells).
+	 */
+	inline void SetMinScore( float score )					{ mMinScore = score; }
+
+	/**
+	 * Set the minimum number of cells in a region returned by GetRegions() (the default is 2).
+	 */
+	inline void SetMinRegion( uint32_t cells )				{ mMinRegion = cells; }
+
+	/**
+	 * Return the mask of changed cells (255 if a cell changed, otherwise 0) in mapped memory.
+	 * It's only valid after GetScore() or GetRegions() were called for the last frame.
+	 */
+	inline uint8_t* GetMask() const						{ return mMask; }
+
+	/**
+	 * Return the width of the mask (in cells).
+	 */
+	inline uint32_t GetMaskWidth() const					{ return mMaskWidth; }
+
+	/**
+	 * Return the height of the mask (in cells).
+	 */
+	inline uint32_t GetMaskHeight() const					{ return mMaskHeight; }
+
+protected:
+	bool alloc( uint32_t width, uint32_t height );
+	void free();
+	bool sync();
+
+	float*    mBackground;
+	uint8_t*  mMask;
+	uint32_t* mCount;
+
+	cudaEvent_t mEvent;
+
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mScale;
+	uint32_t mMaskWidth;
+	uint32_t mMaskHeight;
+	uint32_t mMinRegion;
+
+	float mThreshold;
+	float mLearningRate;
+	float mMinScore;
+	float mScore;
+
+	bool mInitialized;
+	bool mPending;
+	bool mRegionsValid;
+
+	std::vector<int4> mRegions;
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __CUDA_NVTX_H_
+#define __CUDA_NVTX_H_
+
+
+/**
+ * NVTX range annotations for profiling with Nsight Systems.
+ *
+ * These are compiled in when jetson-utils is built with the `ENABLE_NVTX`
+ * CMake option, and otherwise expand to nothing.  The ranges mark the capture,
+ * conversion and rendering stages, and each of the cuda/ launchers, so the
+ * kernels show up in the timeline under the operation that launched them.
+ *
+ * The streams and their ranges are named after the resource URI of the stream
+ * that they belong to, so different pipelines can be told apart.
+ *
+ * @ingroup cudaError
+ */
+#ifdef ENABLE_NVTX
+
+#include <nvToolsExt.h>
+#include <nvToolsExtCudaRt.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+
+
+/**
+ * Pushes an NVTX range for the lifetime of the object.
+ * @ingroup cudaError
+ */
+class nvtxScope
+{
+public:
+	inline nvtxScope( const char* format, ... ) __attribute__((format(printf, 2, 3)))
+	{
+		char str[256];
+
+		va_list args;
+		va_start(args, format);
+		vsnprintf(str, sizeof(str), format, args);
+		va_end(args);
+
+		nvtxRangePushA(str);
+	}
+
+	inline ~nvtxScope()
+	{
+		nvtxRangePop();
+	}
+};
+
+#define NVTX_CONCAT_(a, b)		a##b
+#define NVTX_CONCAT(a, b)		NVTX_CONCAT_(a, b)
+
+/**
+ * Mark the rest of the current scope as an NVTX range.
+ * @ingroup cudaError
+ */
+#define NVTX_RANGE(name)			nvtxScope NVTX_CONCAT(__nvtxScope, __LINE__)(name)
+
+/**
+ * Mark the rest of the current scope as an NVTX range, with a printf-style name.
+ * @ingroup cudaError
+ */
+#define NVTX_RANGE_FMT(format, ...)	nvtxScope NVTX_CONCAT(__nvtxScope, __LINE__)(format, __VA_ARGS__)
+
+/**
+ * Begin an NVTX range that's ended by NVTX_POP() (for ranges that don't match a scope).
+ * @ingroup cudaError
+ */
+#define NVTX_PUSH(name)				nvtxRangePushA(name)
+
+/**
+ * End the range that was begun with NVTX_PUSH().
+ * @ingroup cudaError
+ */
+#define NVTX_POP()					nvtxRangePop()
+
+/**
+ * Name a CUDA stream in the profiler timeline.
+ * @ingroup cudaError
+ */
+#define NVTX_NAME_STREAM(stream, name)	nvtxNameCudaStreamA(stream, name)
+
+#else
+
+#define NVTX_RANGE(name)
+#define NVTX_RANGE_FMT(format, ...)
+#define NVTX_PUSH(name)
+#define NVTX_POP()
+#define NVTX_NAME_STREAM(stream, name)
+
+#endif
+#endif
+
@@ -22,12 +22,14 @@
 
 #include "cudaNormalize.h"
 #include "cudaVector.h"
+#include "cudaAutotune.h"
+#include "cudaNVTX.h"
 
 
 // gpuNormalize
 template <typename T>
-__global__ void gpuNormalize( T* input, T* output, int width, int height, 
-					     float2 input_range, float scaling_factor )
+__global__ void gpuNormalize( T* input, size_t inputPitch, T* output, size_t outputPitch, 
+					     int width, int height, float2 input_range, float scaling_factor )
 {
 	const int x = blockIdx.x * blockDim.x + threadIdx.x;
 	const int y = blockIdx.y * blockDim.y + threadIdx.y;
@@ -35,20 +37,20 @@ __global__ void gpuNormalize( T* input, T* output, int width, int height,
 	if( x >= width || y >= height )
 		return;
 
-	const T px = input[ y * width + x ];
+	const T px = ((T*)((uint8_t*)input + y * inputPitch))[x];
 
 	#define rescale(v) ((v - input_range.x) * scaling_factor)
 
-	output[y*width+x] = make_vec<T>(rescale(px.x),
+	((T*)((uint8_t*)output + y * outputPitch))[x] = make_vec<T>(rescale(px.x),
 							  rescale(px.y),
 							  rescale(px.z),
 							  rescale(alpha(px, input_range.y)));
 }
 
 template<typename T>
-static cudaError_t launchNormalizeRGB( T* input, const float2& input_range,
-						  T* output, const float2& output_range,
-						  size_t  width,  size_t height )
+static cudaError_t launchNormalizeRGB( T* input, size_t inputPitch, const float2& input_range,
+						  T* output, size_t outputPitch, const float2& output_range,
+						  size_t  width,  size_t height, cudaStream_t stream )
 {
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
@@ -56,40 +58,54 @@ static cudaError_t launchNormalizeRGB( T* input, const float2& input_range,
 	if( width == 0 || height == 0  )
 		return cudaErrorInvalidValue;
 
+	if( inputPitch < width * sizeof(T) || outputPitch < width * sizeof(T) )
+		return cudaErrorInvalidPitchValue;
+
 	const float multiplier = output_range.y / input_range.y;
 
 	// launch kernel
-	const dim3 blockDim(32,8);
-	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+	auto launch = [&]( const dim3& blockDim ) -> cudaError_t
+	{
+		const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+		gpuNormalize<T><<<gridDim, blockDim, 0, stream>>>(input, inputPitch, output, outputPitch, width, height, input_range, multiplier);
+		return cudaGetLastError();
+	};
+
+	dim3 blockDim(32,8);
 
-	gpuNormalize<T><<<gridDim, blockDim>>>(input, output, width, height, input_range, multiplier);
+	if( input != output )
+		blockDim = cudaAutotune("cudaNormalize", sizeof(T), width, height, blockDim, stream, launch);
 
-	return CUDA(cudaGetLastError());
+	return CUDA(launch(blockDim));
 }
 
 
 // cudaNormalize (float3)
 cudaError_t cudaNormalize( float3* input, const float2& input_range,
 					  float3* output, const float2& output_range,
-					  size_t  width,  size_t height )
+					  size_t  width,  size_t height, cudaStream_t stream )
 {
-	return launchNormalizeRGB<float3>(input, input_range, output, output_range, width, height);
+	NVTX_RANGE("cudaNormalize");
+
+	return launchNormalizeRGB<float3>(input, width * sizeof(float3), input_range, output, width * sizeof(float3), output_range, width, height, stream);
 }
 
 
 // cudaNormalize (float4)
 cudaError_t cudaNormalize( float4* input, const float2& input_range,
 					  float4* output, const float2& output_range,
-					  size_t  width,  size_t height )
+					  size_t  width,  size_t height, cudaStream_t stream )
 {
-	return launchNormalizeRGB<float4>(input, input_range, output, output_range, width, height);
+	NVTX_RANGE("cudaNormalize");
+
+	return launchNormalizeRGB<float4>(input, width * sizeof(float4), input_range, output, width * sizeof(float4), output_range, width, height, stream);
 }
 
 
 //-----------------------------------------------------------------------------------
 template <typename T>
-__global__ void gpuNormalizeGray( T* input, T* output, int width, int height, 
-					     float2 input_range, float scaling_factor )
+__global__ void gpuNormalizeGray( T* input, size_t inputPitch, T* output, size_t outputPitch, 
+					     int width, int height, float2 input_range, float scaling_factor )
 {
 	const int x = blockIdx.x * blockDim.x + threadIdx.x;
 	const int y = blockIdx.y * blockDim.y + threadIdx.y;
@@ -97,14 +113,14 @@ __global__ void gpuNormalizeGray( T* input, T* output, int width, int height,
 	if( x >= width || y >= height )
 		return;
 
-	const T px = rescale(input[ y * width + x ]);
-	output[y*width+x] = px;
+	const T px = rescale(((T*)((uint8_t*)input + y * inputPitch))[x]);
+	((T*)((uint8_t*)output + y * outputPitch))[x] = px;
 }
 
 template<typename T>
-static cudaError_t launchNormalizeGray( T* input, const float2& input_range,
-						  	     T* output, const float2& output_range,
-						  		size_t width, size_t height )
+static cudaError_t launchNormalizeGray( T* input, size_t inputPitch, const float2& input_range,
+						  	     T* output, size_t outputPitch, const float2& output_range,
+						  		size_t width, size_t height, cudaStream_t stream )
 {
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
@@ -112,38 +128,75 @@ static cudaError_t launchNormalizeGray( T* input, const float2& input_range,
 	if( width == 0 || height == 0  )
 		return cudaErrorInvalidValue;
 
+	if( inputPitch < width * sizeof(T) || outputPitch < width * sizeof(T) )
+		return cudaErrorInvalidPitchValue;
+
 	const float multiplier = output_range.y / input_range.y;
 
 	// launch kernel
-	const dim3 blockDim(32,8);
-	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+	auto launch = [&]( const dim3& blockDim ) -> cudaError_t
+	{
+		const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+		gpuNormalizeGray<T><<<gridDim, blockDim, 0, stream>>>(input, inputPitch, output, outputPitch, width, height, input_range, multiplier);
+		return cudaGetLastError();
+	};
+
+	dim3 blockDim(32,8);
 
-	gpuNormalizeGray<T><<<gridDim, blockDim>>>(input, output, width, height, input_range, multiplier);
+	if( input != output )
+		blockDim = cudaAutotune("cudaNormalizeGray", sizeof(T), width, height, blockDim, stream, launch);
 
-	return CUDA(cudaGetLastError());
+	return CUDA(launch(blockDim));
 }
 
 
 // cudaNormalize (float)
 cudaError_t cudaNormalize( float* input, const float2& input_range,
 					  float* output, const float2& output_range,
-					  size_t width, size_t height )
+					  size_t width, size_t height, cudaStream_t stream )
 {
-	return launchNormalizeGray<float>(input, input_range, output, output_range, width, height);
+	NVTX_RANGE("cudaNormalize");
+
+	return launchNormalizeGray<float>(input, width * sizeof(float), input_range, output, width * sizeof(float), output_range, width, height, stream);
 }
 
 
 //-----------------------------------------------------------------------------------
 cudaError_t cudaNormalize( void* input,  const float2& input_range,
 					  void* output, const float2& output_range,
-					  size_t width, size_t height, imageFormat format )
+					  size_t width, size_t height, imageFormat format, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaNormalize");
+
+	if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return cudaNormalize((float3*)input, input_range, (float3*)output, output_range, width, height, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return cudaNormalize((float4*)input, input_range, (float4*)output, output_range, width, height, stream);
+	else if( format == IMAGE_GRAY32F )
+		return cudaNormalize((float*)input, input_range, (float*)output, output_range, width, height, stream);
+
+	LogError(LOG_CUDA "cudaNormalize() -- invalid image format '%s'\n", imageFormatToStr(format));
+	LogError(LOG_CUDA "                   supported formats are:\n");
+	LogError(LOG_CUDA "                       * gray32f\n");
+	LogError(LOG_CUDA "                       * rgb32f, bgr32f\n");
+	LogError(LOG_CUDA "                       * rgba32f, bgra32f\n");
+
+	return cudaErrorInvalidValue;
+}
+
+// cudaNormalize (pitched)
+cudaError_t cudaNormalize( void* input,  size_t inputPitch,  const float2& input_range,
+					  void* output, size_t outputPitch, const float2& output_range,
+					  size_t width, size_t height, imageFormat format, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaNormalize");
+
 	if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
-		return cudaNormalize((float3*)input, input_range, (float3*)output, output_range, width, height);
+		return launchNormalizeRGB<float3>((float3*)input, inputPitch, input_range, (float3*)output, outputPitch, output_range, width, height, stream);
 	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
-		return cudaNormalize((float4*)input, input_range, (float4*)output, output_range, width, height);
+		return launchNormalizeRGB<float4>((float4*)input, inputPitch, input_range, (float4*)output, outputPitch, output_range, width, height, stream);
 	else if( format == IMAGE_GRAY32F )
-		return cudaNormalize((float*)input, input_range, (float*)output, output_range, width, height);
+		return launchNormalizeGray<float>((float*)input, inputPitch, input_range, (float*)output, outputPitch, output_range, width, height, stream);
 
 	LogError(LOG_CUDA "cudaNormalize() -- invalid image format '%s'\n", imageFormatToStr(format));
 	LogError(LOG_CUDA "                   supported formats are:\n");
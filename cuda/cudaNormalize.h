@@ -33,33 +33,36 @@
  * For example, convert an image with values between `[0,1]` to `[0,255]`
  * @param input_range the range of pixel values of the input image (e.g. `[0,1]`)
  * @param output_range the desired range of pixel values of the output image (e.g. `[0,255]`)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  * @ingroup normalization
  */
 cudaError_t cudaNormalize( float* input,  const float2& input_range,
 					  float* output, const float2& output_range,
-					  size_t width,  size_t height );
+					  size_t width,  size_t height, cudaStream_t stream=NULL );
 
 /**
  * Normalize the pixel intensities of a float3 RGB/BGR image between two scales.
  * For example, convert an image with values between `[0,1]` to `[0,255]`
  * @param input_range the range of pixel values of the input image (e.g. `[0,1]`)
  * @param output_range the desired range of pixel values of the output image (e.g. `[0,255]`)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  * @ingroup normalization
  */
 cudaError_t cudaNormalize( float3* input,  const float2& input_range,
 					  float3* output, const float2& output_range,
-					  size_t  width,  size_t height );
+					  size_t  width,  size_t height, cudaStream_t stream=NULL );
 
 /**
  * Normalize the pixel intensities of a float4 RGBA/BGRA image between two scales.
  * For example, convert an image with values between `[0,1]` to `[0,255]`
  * @param input_range the range of pixel values of the input image (e.g. `[0,1]`)
  * @param output_range the desired range of pixel values of the output image (e.g. `[0,255]`)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  * @ingroup normalization
  */
 cudaError_t cudaNormalize( float4* input,  const float2& input_range,
 					  float4* output, const float2& output_range,
-					  size_t  width,  size_t height );
+					  size_t  width,  size_t height, cudaStream_t stream=NULL );
 
 /**
  * Normalize the pixel intensities of an image between two scales.
@@ -67,12 +70,28 @@ cudaError_t cudaNormalize( float4* input,  const float2& input_range,
  * @param input_range the range of pixel values of the input image (e.g. `[0,1]`)
  * @param output_range the desired range of pixel values of the output image (e.g. `[0,255]`)
  * @param format the image format - valid formats are gray32f, rgb32f/bgr32f, and rgba32f/bgra32f.
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
  * @ingroup normalization
  */
 cudaError_t cudaNormalize( void* input,  const float2& input_range,
 					  void* output, const float2& output_range,
-					  size_t width, size_t height, imageFormat format );
+					  size_t width, size_t height, imageFormat format, cudaStream_t stream=NULL );
 
+/**
+ * Normalize the pixel intensities of a pitched image between two scales.
+ * The pitches are the size of each row in bytes, which can be larger than
+ * `width * bytesPerPixel` (for example with memory from cudaMallocPitch()).
+ * @param inputPitch size of each row in the input image (in bytes)
+ * @param input_range the range of pixel values of the input image (e.g. `[0,1]`)
+ * @param outputPitch size of each row in the output image (in bytes)
+ * @param output_range the desired range of pixel values of the output image (e.g. `[0,255]`)
+ * @param format the image format - valid formats are gray32f, rgb32f/bgr32f, and rgba32f/bgra32f.
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
+ * @ingroup normalization
+ */
+cudaError_t cudaNormalize( void* input,  size_t inputPitch,  const float2& input_range,
+					  void* output, size_t outputPitch, const float2& output_range,
+					  size_t width, size_t height, imageFormat format, cudaStream_t stream=NULL );
 
 #endif
 
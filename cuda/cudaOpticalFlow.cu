@@ -0,0 +1,693 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaOpticalFlow.h"
+#include "cudaColormap.h"
+#include "cudaMappedMemory.h"
+#include "cudaVector.h"
+#include "cudaNVTX.h"
+
+#ifdef ENABLE_VPI
+#include <string.h>
+
+#include <vpi/Image.h>
+#include <vpi/Status.h>
+#include <vpi/Stream.h>
+#include <vpi/algo/ConvertImageFormat.h>
+#include <vpi/algo/OpticalFlowDense.h>
+#endif
+
+
+// the pyramid levels of the previous and current frames, passed to the kernel by value
+struct flowPyramids
+{
+	const float* prev[CUDA_PYRAMID_MAX_LEVELS];
+	const float* next[CUDA_PYRAMID_MAX_LEVELS];
+	int width[CUDA_PYRAMID_MAX_LEVELS];
+	int height[CUDA_PYRAMID_MAX_LEVELS];
+	int levels;
+};
+
+
+// luminance of the input pixels (the BGR formats use the same weights, which doesn't matter for tracking)
+inline __device__ float flowLuma( const uint8_t& px )	{ return px; }
+inline __device__ float flowLuma( const float& px )	{ return px; }
+inline __device__ float flowLuma( const uchar3& px )	{ return 0.299f * px.x + 0.587f * px.y + 0.114f * px.z; }
+inline __device__ float flowLuma( const uchar4& px )	{ return 0.299f * px.x + 0.587f * px.y + 0.114f * px.z; }
+inline __device__ float flowLuma( const float3& px )	{ return 0.299f * px.x + 0.587f * px.y + 0.114f * px.z; }
+inline __device__ float flowLuma( const float4& px )	{ return 0.299f * px.x + 0.587f * px.y + 0.114f * px.z; }
+
+inline __device__ void flowStore( float* out, float v )	{ *out = v; }
+inline __device__ void flowStore( uint8_t* out, float v )	{ *out = (uint8_t)fminf(fmaxf(v + 0.5f, 0.0f), 255.0f); }
+
+
+// gpuFlowLuma
+template<typename T, typename S>
+__global__ void gpuFlowLuma( T* input, S* output, int width, int height )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	flowStore(output + y * width + x, flowLuma(input[y * width + x]));
+}
+
+// launchFlowLuma
+template<typename S>
+static cudaError_t launchFlowLuma( void* input, imageFormat format, S* output, int width, int height, cudaStream_t stream )
+{
+	const dim3 blockDim(32, 8);
+	const dim3 gridDim(iDivUp(width, blockDim.x), iDivUp(height, blockDim.y));
+
+	#define LAUNCH_FLOW_LUMA(type) \
+		gpuFlowLuma<type, S><<<gridDim, blockDim, 0, stream>>>((type*)input, output, width, height)
+
+	if( format == IMAGE_GRAY8 || format == IMAGE_I420 || format == IMAGE_YV12 || format == IMAGE_NV12 )
+		LAUNCH_FLOW_LUMA(uint8_t);	// the luma plane comes first
+	else if( format == IMAGE_GRAY32F )
+		LAUNCH_FLOW_LUMA(float);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		LAUNCH_FLOW_LUMA(uchar3);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		LAUNCH_FLOW_LUMA(uchar4);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		LAUNCH_FLOW_LUMA(float3);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		LAUNCH_FLOW_LUMA(float4);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaOpticalFlow::Process()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// bilinear sample with the pixel centers at integer coordinates (and the edges clamped)
+inline __device__ float flowSample( const float* img, int width, int height, float x, float y )
+{
+	x = fminf(fmaxf(x, 0.0f), width - 1.0f);
+	y = fminf(fmaxf(y, 0.0f), height - 1.0f);
+
+	const int x0 = int(x);
+	const int y0 = int(y);
+	const int x1 = min(x0 + 1, width - 1);
+	const int y1 = min(y0 + 1, height - 1);
+
+	const float ax = x - x0;
+	const float ay = y - y0;
+
+	const float top = img[y0 * width + x0] * (1.0f - ax) + img[y0 * width + x1] * ax;
+	const float bot = img[y1 * width + x0] * (1.0f - ax) + img[y1 * width + x1] * ax;
+
+	return top * (1.0f - ay) + bot * ay;
+}
+
+
+// gpuFlowLK (pyramidal Lucas-Kanade, one thread per grid point from the coarsest level to the finest)
+__global__ void gpuFlowLK( flowPyramids pyr, float2* flow, int flowWidth, int flowHeight, int gridSize, int radius, int iterations )
+{
+	const int gx = blockIdx.x * blockDim.x + threadIdx.x;
+	const int gy = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( gx >= flowWidth || gy >= flowHeight )
+		return;
+
+	// the center of the grid cell at level 0
+	const float2 p0 = make_float2(gx * gridSize + (gridSize - 1) * 0.5f,
+						     gy * gridSize + (gridSize - 1) * 0.5f);
+
+	float2 guess = make_float2(0.0f, 0.0f);	// in the coordinates of the current level
+
+	for( int level = pyr.levels - 1; level >= 0; level-- )
+	{
+		const float* I = pyr.prev[level];
+		const float* J = pyr.next[level];
+
+		const int w = pyr.width[level];
+		const int h = pyr.height[level];
+
+		const float scale = 1.0f / float(1 << level);
+		const float2 p = make_float2((p0.x + 0.5f) * scale - 0.5f, (p0.y + 0.5f) * scale - 0.5f);
+
+		// spatial gradient matrix of the window in the previous frame
+		float Gxx = 0.0f, Gxy = 0.0f, Gyy = 0.0f;
+
+		for( int j=-radius; j <= radius; j++ )
+		{
+			for( int i=-radius; i <= radius; i++ )
+			{
+				const float Ix = (flowSample(I, w, h, p.x + i + 1, p.y + j) - flowSample(I, w, h, p.x + i - 1, p.y + j)) * 0.5f;
+				const float Iy = (flowSample(I, w, h, p.x + i, p.y + j + 1) - flowSample(I, w, h, p.x + i, p.y + j - 1)) * 0.5f;
+
+				Gxx += Ix * Ix;
+				Gxy += Ix * Iy;
+				Gyy += Iy * Iy;
+			}
+		}
+
+		const float det = Gxx * Gyy - Gxy * Gxy;
+
+		// skip the refinement of windows without texture (the guess from the coarser level is kept)
+		if( det > 1e-3f )
+		{
+			const float invDet = 1.0f / det;
+			float2 d = make_float2(0.0f, 0.0f);
+
+			for( int k=0; k < iterations; k++ )
+			{
+				float bx = 0.0f, by = 0.0f;
+
+				for( int j=-radius; j <= radius; j++ )
+				{
+					for( int i=-radius; i <= radius; i++ )
+					{
+						const float Ix = (flowSample(I, w, h, p.x + i + 1, p.y + j) - flowSample(I, w, h, p.x + i - 1, p.y + j)) * 0.5f;
+						const float Iy = (flowSample(I, w, h, p.x + i, p.y + j + 1) - flowSample(I, w, h, p.x + i, p.y + j - 1)) * 0.5f;
+
+						const float It = flowSample(I, w, h, p.x + i, p.y + j) 
+									- flowSample(J, w, h, p.x + guess.x + d.x + i, p.y + guess.y + d.y + j);
+
+						bx += It * Ix;
+						by += It * Iy;
+					}
+				}
+
+				const float2 delta = make_float2((Gyy * bx - Gxy * by) * invDet, (Gxx * by - Gxy * bx) * invDet);
+
+				d.x += delta.x;
+				d.y += delta.y;
+
+				if( delta.x * delta.x + delta.y * delta.y < 1e-4f )
+					break;
+			}
+
+			guess.x += d.x;
+			guess.y += d.y;
+		}
+
+		if( level > 0 )
+		{
+			guess.x *= 2.0f;
+			guess.y *= 2.0f;
+		}
+	}
+
+	flow[gy * flowWidth + gx] = guess;
+}
+
+
+// constructor
+cudaOpticalFlow::cudaOpticalFlow()
+{
+	mBackend    = BACKEND_CUDA;
+	mGridSize   = 4;
+	mWidth      = 0;
+	mHeight     = 0;
+	mFlowWidth  = 0;
+	mFlowHeight = 0;
+	mLevels     = 3;
+	mWindow     = 4;
+	mIterations = 8;
+	mFrames     = 0;
+	mCurrent    = 0;
+	mFlow       = NULL;
+	mLuma8      = NULL;
+
+	mVPIStream       = NULL;
+	mVPIPayload      = NULL;
+	mVPILuma         = NULL;
+	mVPIMotion       = NULL;
+	mVPIMotionLinear = NULL;
+
+	for( int n=0; n < 2; n++ )
+	{
+		mLuma[n]      = NULL;
+		mVPIFrames[n] = NULL;
+	}
+}
+
+
+// destructor
+cudaOpticalFlow::~cudaOpticalFlow()
+{
+	free();
+}
+
+
+// Create
+cudaOpticalFlow* cudaOpticalFlow::Create( uint32_t gridSize, Backend backend )
+{
+	if( gridSize == 0 )
+	{
+		LogError(LOG_CUDA "cudaOpticalFlow -- the grid size can't be 0\n");
+		return NULL;
+	}
+
+	if( backend == BACKEND_OFA && !HasOFA() )
+	{
+		LogError(LOG_CUDA "cudaOpticalFlow -- the OFA backend isn't available (jetson-utils was built without ENABLE_VPI)\n");
+		return NULL;
+	}
+
+	const bool ofaGrid = (gridSize == 1 || gridSize == 2 || gridSize == 4 || gridSize == 8);
+
+	if( backend == BACKEND_OFA && !ofaGrid )
+	{
+		LogError(LOG_CUDA "cudaOpticalFlow -- the OFA backend needs a grid size of 1, 2, 4 or 8 (was %u)\n", gridSize);
+		return NULL;
+	}
+
+	if( backend == BACKEND_AUTO )
+		backend = (HasOFA() && ofaGrid) ? BACKEND_OFA : BACKEND_CUDA;
+
+	cudaOpticalFlow* flow = new cudaOpticalFlow();
+
+	flow->mBackend  = backend;
+	flow->mGridSize = gridSize;
+
+	LogVerbose(LOG_CUDA "cudaOpticalFlow -- created with %s backend and %ux%u grid\n", BackendToStr(backend), gridSize, gridSize);
+	return flow;
+}
+
+
+// BackendToStr
+const char* cudaOpticalFlow::BackendToStr( Backend backend )
+{
+	switch(backend)
+	{
+		case BACKEND_AUTO:	return "auto";
+		case BACKEND_CUDA:	return "CUDA";
+		case BACKEND_OFA:	return "OFA";
+	}
+
+	return "unknown";
+}
+
+
+// HasOFA
+bool cudaOpticalFlow::HasOFA()
+{
+#ifdef ENABLE_VPI
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+// alloc
+bool cudaOpticalFlow::alloc( uint32_t width, uint32_t height )
+{
+	if( mWidth == width && mHeight == height )
+		return true;
+
+	free();
+
+	mFlowWidth  = iDivUp(width, mGridSize);
+	mFlowHeight = iDivUp(height, mGridSize);
+
+	if( !cudaAllocMapped(&mFlow, mFlowWidth * mFlowHeight * sizeof(float2)) )
+		return false;
+
+	if( mBackend == BACKEND_OFA )
+	{
+		if( !initOFA(width, height) )
+		{
+			LogWarning(LOG_CUDA "cudaOpticalFlow -- failed to initialize the OFA backend, falling back to CUDA\n");
+			freeOFA();
+			mBackend = BACKEND_CUDA;
+		}
+	}
+
+	if( mBackend == BACKEND_CUDA )
+	{
+		for( int n=0; n < 2; n++ )
+		{
+			if( CUDA_FAILED(cudaMalloc(&mLuma[n], width * height * sizeof(float))) )
+				return false;
+		}
+	}
+
+	mWidth  = width;
+	mHeight = height;
+
+	Reset();
+	return true;
+}
+
+
+// free
+void cudaOpticalFlow::free()
+{
+	freeOFA();
+
+	for( int n=0; n < 2; n++ )
+	{
+		CUDA_FREE(mLuma[n]);
+		mPyramid[n].Free();
+	}
+
+	CUDA_FREE_HOST(mFlow);
+
+	mWidth      = 0;
+	mHeight     = 0;
+	mFlowWidth  = 0;
+	mFlowHeight = 0;
+}
+
+
+// Reset
+void cudaOpticalFlow::Reset()
+{
+	mFrames  = 0;
+	mCurrent = 0;
+}
+
+
+// Process
+cudaError_t cudaOpticalFlow::Process( void* frame, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaOpticalFlow::Process");
+
+	if( !frame )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( !alloc(width, height) )
+	{
+		LogError(LOG_CUDA "cudaOpticalFlow -- failed to allocate memory for %ux%u frames\n", width, height);
+		return cudaErrorMemoryAllocation;
+	}
+
+	const cudaError_t result = (mBackend == BACKEND_OFA) ? processOFA(frame, format, stream)
+											   : processCUDA(frame, format, stream);
+
+	if( result != cudaSuccess )
+		return result;
+
+	// the current frame becomes the previous one
+	mCurrent = 1 - mCurrent;
+	mFrames++;
+
+	return cudaSuccess;
+}
+
+
+// processCUDA
+cudaError_t cudaOpticalFlow::processCUDA( void* frame, imageFormat format, cudaStream_t stream )
+{
+	const uint32_t next = mCurrent;
+	const uint32_t prev = 1 - mCurrent;
+
+	cudaError_t result = launchFlowLuma(frame, format, mLuma[next], mWidth, mHeight, stream);
+
+	if( result != cudaSuccess )
+		return result;
+
+	// limit the levels so that the coarsest one is still bigger than the window
+	uint32_t levels = (mLevels > 0) ? mLevels : 1;
+
+	while( levels > 1 && ((mWidth >> (levels - 1)) < mWindow * 4 || (mHeight >> (levels - 1)) < mWindow * 4) )
+		levels--;
+
+	if( levels > CUDA_PYRAMID_MAX_LEVELS )
+		levels = CUDA_PYRAMID_MAX_LEVELS;
+
+	result = mPyramid[next].Build(mLuma[next], mWidth, mHeight, IMAGE_GRAY32F, levels, stream);
+
+	if( result != cudaSuccess )
+		return result;
+
+	if( mFrames == 0 || mPyramid[prev].GetLevels() != levels )
+		return CUDA(cudaMemsetAsync(mFlow, 0, mFlowWidth * mFlowHeight * sizeof(float2), stream));
+
+	flowPyramids pyr;
+
+	pyr.levels = levels;
+
+	for( uint32_t n=0; n < levels; n++ )
+	{
+		pyr.prev[n]   = (float*)mPyramid[prev].GetLevel(n);
+		pyr.next[n]   = (float*)mPyramid[next].GetLevel(n);
+		pyr.width[n]  = mPyramid[next].GetWidth(n);
+		pyr.height[n] = mPyramid[next].GetHeight(n);
+	}
+
+	const dim3 blockDim(16, 8);
+	const dim3 gridDim(iDivUp(mFlowWidth, blockDim.x), iDivUp(mFlowHeight, blockDim.y));
+
+	gpuFlowLK<<<gridDim, blockDim, 0, stream>>>(pyr, mFlow, mFlowWidth, mFlowHeight, mGridSize, mWindow, mIterations);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// Render
+cudaError_t cudaOpticalFlow::Render( void* output, uint32_t width, uint32_t height, imageFormat format, float maxFlow, cudaStream_t stream )
+{
+	if( !mFlow )
+		return cudaErrorInvalidDevicePointer;
+
+	return cudaColormap((float*)mFlow, mFlowWidth, mFlowHeight, output, width, height,
+					make_float2(-maxFlow, maxFlow), FORMAT_DEFAULT, format, 
+					COLORMAP_FLOW, FILTER_LINEAR, stream);
+}
+
+
+#ifdef ENABLE_VPI
+
+// check the status of a VPI call
+#define VPI_CHECK(x)	vpiCheckStatus((x), #x)
+
+static bool vpiCheckStatus( VPIStatus status, const char* txt )
+{
+	if( status == VPI_SUCCESS )
+		return true;
+
+	char msg[VPI_MAX_STATUS_MESSAGE_LENGTH];
+	vpiGetLastStatusMessage(msg, sizeof(msg));
+
+	LogError(LOG_CUDA "cudaOpticalFlow -- %s failed (%s)\n", txt, vpiStatusGetName(status));
+	LogError(LOG_CUDA "cudaOpticalFlow -- %s\n", msg);
+
+	return false;
+}
+
+
+// gpuFlowConvertOFA (the OFA motion vectors are S10.5 fixed-point)
+__global__ void gpuFlowConvertOFA( const short2* input, size_t inputPitch, float2* output, int width, int height )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const short2 mv = ((const short2*)((const uint8_t*)input + y * inputPitch))[x];
+	output[y * width + x] = make_float2(mv.x / 32.0f, mv.y / 32.0f);
+}
+
+
+// initOFA
+bool cudaOpticalFlow::initOFA( uint32_t width, uint32_t height )
+{
+	VPIStream stream = NULL;
+
+	if( !VPI_CHECK(vpiStreamCreate(0, &stream)) )
+		return false;
+
+	mVPIStream = stream;
+
+	// the OFA input is NV12 block-linear, which the VIC converts the luma into
+	if( !cudaAllocMapped(&mLuma8, width * height) )
+		return false;
+
+	VPIImageData data;
+	memset(&data, 0, sizeof(data));
+
+	data.bufferType = VPI_IMAGE_BUFFER_CUDA_PITCH_LINEAR;
+	data.buffer.pitch.format = VPI_IMAGE_FORMAT_U8;
+	data.buffer.pitch.numPlanes = 1;
+	data.buffer.pitch.planes[0].pixelType  = VPI_PIXEL_TYPE_U8;
+	data.buffer.pitch.planes[0].width      = width;
+	data.buffer.pitch.planes[0].height     = height;
+	data.buffer.pitch.planes[0].pitchBytes = width;
+	data.buffer.pitch.planes[0].data       = mLuma8;
+
+	VPIImage luma = NULL;
+
+	if( !VPI_CHECK(vpiImageCreateWrapper(&data, NULL, VPI_BACKEND_CUDA | VPI_BACKEND_VIC, &luma)) )
+		return false;
+
+	mVPILuma = luma;
+
+	for( int n=0; n < 2; n++ )
+	{
+		VPIImage img = NULL;
+
+		if( !VPI_CHECK(vpiImageCreate(width, height, VPI_IMAGE_FORMAT_NV12_ER_BL, 0, &img)) )
+			return false;
+
+		mVPIFrames[n] = img;
+	}
+
+	VPIImage motion = NULL;
+	VPIImage motionLinear = NULL;
+
+	if( !VPI_CHECK(vpiImageCreate(mFlowWidth, mFlowHeight, VPI_IMAGE_FORMAT_2S16_BL, 0, &motion)) )
+		return false;
+
+	mVPIMotion = motion;
+
+	if( !VPI_CHECK(vpiImageCreate(mFlowWidth, mFlowHeight, VPI_IMAGE_FORMAT_2S16, 0, &motionLinear)) )
+		return false;
+
+	mVPIMotionLinear = motionLinear;
+
+	const int32_t gridSize = mGridSize;
+	VPIPayload payload = NULL;
+
+	if( !VPI_CHECK(vpiCreateOpticalFlowDense(VPI_BACKEND_OFA, width, height, VPI_IMAGE_FORMAT_NV12_ER_BL,
+									 &gridSize, 1, VPI_OPTFLOW_QUALITY_MEDIUM, &payload)) )
+		return false;
+
+	mVPIPayload = payload;
+	return true;
+}
+
+
+// freeOFA
+void cudaOpticalFlow::freeOFA()
+{
+	if( mVPIStream != NULL )
+		vpiStreamSync((VPIStream)mVPIStream);
+
+	vpiPayloadDestroy((VPIPayload)mVPIPayload);
+	vpiImageDestroy((VPIImage)mVPIMotionLinear);
+	vpiImageDestroy((VPIImage)mVPIMotion);
+	vpiImageDestroy((VPIImage)mVPIFrames[0]);
+	vpiImageDestroy((VPIImage)mVPIFrames[1]);
+	vpiImageDestroy((VPIImage)mVPILuma);
+	vpiStreamDestroy((VPIStream)mVPIStream);
+
+	mVPIPayload      = NULL;
+	mVPIMotionLinear = NULL;
+	mVPIMotion       = NULL;
+	mVPIFrames[0]    = NULL;
+	mVPIFrames[1]    = NULL;
+	mVPILuma         = NULL;
+	mVPIStream       = NULL;
+
+	CUDA_FREE_HOST(mLuma8);
+}
+
+
+// processOFA
+cudaError_t cudaOpticalFlow::processOFA( void* frame, imageFormat format, cudaStream_t stream )
+{
+	const uint32_t next = mCurrent;
+	const uint32_t prev = 1 - mCurrent;
+
+	cudaError_t result = launchFlowLuma(frame, format, mLuma8, mWidth, mHeight, stream);
+
+	if( result != cudaSuccess )
+		return result;
+
+	// VPI runs on its own stream, so the luma needs to be finished first
+	result = CUDA(cudaStreamSynchronize(stream));
+
+	if( result != cudaSuccess )
+		return result;
+
+	VPIStream vpiStream = (VPIStream)mVPIStream;
+
+	if( !VPI_CHECK(vpiSubmitConvertImageFormat(vpiStream, VPI_BACKEND_VIC, (VPIImage)mVPILuma, (VPIImage)mVPIFrames[next], NULL)) )
+		return cudaErrorUnknown;
+
+	if( mFrames == 0 )
+	{
+		if( !VPI_CHECK(vpiStreamSync(vpiStream)) )
+			return cudaErrorUnknown;
+
+		return CUDA(cudaMemsetAsync(mFlow, 0, mFlowWidth * mFlowHeight * sizeof(float2), stream));
+	}
+
+	if( !VPI_CHECK(vpiSubmitOpticalFlowDense(vpiStream, VPI_BACKEND_OFA, (VPIPayload)mVPIPayload, 
+									 (VPIImage)mVPIFrames[prev], (VPIImage)mVPIFrames[next], (VPIImage)mVPIMotion)) )
+		return cudaErrorUnknown;
+
+	if( !VPI_CHECK(vpiSubmitConvertImageFormat(vpiStream, VPI_BACKEND_VIC, (VPIImage)mVPIMotion, (VPIImage)mVPIMotionLinear, NULL)) )
+		return cudaErrorUnknown;
+
+	if( !VPI_CHECK(vpiStreamSync(vpiStream)) )
+		return cudaErrorUnknown;
+
+	// convert the motion vectors to float2
+	VPIImageData data;
+
+	if( !VPI_CHECK(vpiImageLockData((VPIImage)mVPIMotionLinear, VPI_LOCK_READ, VPI_IMAGE_BUFFER_CUDA_PITCH_LINEAR, &data)) )
+		return cudaErrorUnknown;
+
+	const dim3 blockDim(32, 8);
+	const dim3 gridDim(iDivUp(mFlowWidth, blockDim.x), iDivUp(mFlowHeight, blockDim.y));
+
+	gpuFlowConvertOFA<<<gridDim, blockDim, 0, stream>>>((short2*)data.buffer.pitch.planes[0].data, data.buffer.pitch.planes[0].pitchBytes,
+											  mFlow, mFlowWidth, mFlowHeight);
+
+	result = CUDA(cudaGetLastError());
+
+	// the image stays locked until the conversion is done with it
+	if( result == cudaSuccess )
+		result = CUDA(cudaStreamSynchronize(stream));
+
+	vpiImageUnlock((VPIImage)mVPIMotionLinear);
+	return result;
+}
+
+#else
+
+// initOFA
+bool cudaOpticalFlow::initOFA( uint32_t width, uint32_t height )
+{
+	return false;
+}
+
+// freeOFA
+void cudaOpticalFlow::freeOFA()
+{
+	CUDA_FREE_HOST(mLuma8);
+}
+
+// processOFA
+cudaError_t cudaOpticalFlow::processOFA( void* frame, imageFormat format, cudaStream_t stream )
+{
+	return cudaErrorNotSupported;
+}
+
+#endif
+
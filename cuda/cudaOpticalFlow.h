@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_OPTICAL_FLOW_H__
+#define __CUDA_OPTICAL_FLOW_H__
+
+
+#include "cudaUtility.h"
+#include "cudaPyramid.h"
+#include "imageFormat.h"
+
+
+/**
+ * Dense optical flow between consecutive frames (for example from a videoSource),
+ * computed on a grid with one flow vector per `gridSize x gridSize` block of pixels.
+ *
+ * There are two backends:
+ *
+ *   - BACKEND_OFA uses the hardware optical flow accelerator on Orin through VPI
+ *     (the library needs to be built with `-DENABLE_VPI=ON`).  The grid size must be
+ *     1, 2, 4 or 8, and the frames are converted to NV12 block-linear with the VIC.
+ *
+ *   - BACKEND_CUDA is pyramidal Lucas-Kanade in CUDA, which runs on every GPU.  The luma
+ *     of each frame is built into a Gaussian pyramid (see cudaPyramid) and kept for the next
+ *     frame, and one thread per grid point iterates from the coarsest level to the finest.
+ *
+ * BACKEND_AUTO picks the OFA when it's available, and otherwise falls back to CUDA.
+ *
+ * The flow vectors are float2 displacements (in pixels of the input) from the previous
+ * frame to the current one, in mapped memory, and can be visualized with Render() which uses
+ * cudaColormap() with COLORMAP_FLOW.  The first frame (or the first one after Reset() or a
+ * change in size) has no previous frame, so its flow is zero and IsValid() returns false.
+ *
+ * The supported formats are gray8, gray32f, rgb8, rgba8, rgb32f, rgba32f (and BGR), and
+ * the planar YUV formats (I420, YV12, NV12), which only have their luma plane read.
+ *
+ * @ingroup cuda
+ */
+class cudaOpticalFlow
+{
+public:
+	/**
+	 * The implementations of the optical flow.
+	 */
+	enum Backend
+	{
+		BACKEND_AUTO = 0,	/**< Use the OFA if it's available, otherwise CUDA */
+		BACKEND_CUDA,		/**< Pyramidal Lucas-Kanade in CUDA */
+		BACKEND_OFA		/**< Hardware optical flow accelerator (Orin with VPI) */
+	};
+
+	/**
+	 * Create the optical flow stage.
+	 * @param gridSize the size of the blocks of pixels that get one flow vector each
+	 * @param backend the implementation to use (if BACKEND_OFA isn't available, Create() fails)
+	 */
+	static cudaOpticalFlow* Create( uint32_t gridSize=4, Backend backend=BACKEND_AUTO );
+
+	/**
+	 * Destructor
+	 */
+	~cudaOpticalFlow();
+
+	/**
+	 * Compute the flow from the previous frame to this one, and keep this frame for the next call.
+	 * With BACKEND_OFA this waits for the stream (to hand the frame over to VPI) and for the OFA.
+	 */
+	cudaError_t Process( void* frame, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream=0 );
+
+	/**
+	 * Compute the flow from the previous frame to this one.
+	 */
+	template<typename T> cudaError_t Process( T* frame, uint32_t width, uint32_t height, cudaStream_t stream=0 )	{ return Process((void*)frame, width, height, imageFormatFromType<T>(), stream); }
+
+	/**
+	 * Visualize the flow into an rgb8, rgba8, rgb32f or rgba32f image (of any size) with COLORMAP_FLOW.
+	 * @param maxFlow the displacement (in pixels) that gets the most saturated colors
+	 */
+	cudaError_t Render( void* output, uint32_t width, uint32_t height, imageFormat format, float maxFlow=10.0f, cudaStream_t stream=0 );
+
+	/**
+	 * Visualize the flow with COLORMAP_FLOW.
+	 */
+	template<typename T> cudaError_t Render( T* output, uint32_t width, uint32_t height, float maxFlow=10.0f, cudaStream_t stream=0 )	{ return Render((void*)output, width, height, imageFormatFromType<T>(), maxFlow, stream); }
+
+	/**
+	 * Forget the previous frame, so the next one starts over.
+	 */
+	void Reset();
+
+	/**
+	 * Return the flow field (GetFlowWidth() x GetFlowHeight() float2 vectors in mapped memory).
+	 * It's written asynchronously by Process(), so synchronize with the stream before reading it on the CPU.
+	 */
+	inline float2* GetFlow() const					{ return mFlow; }
+
+	/**
+	 * Return the number of columns of the flow field.
+	 */
+	inline uint32_t GetFlowWidth() const				{ return mFlowWidth; }
+
+	/**
+	 * Return the number of rows of the flow field.
+	 */
+	inline uint32_t GetFlowHeight() const				{ return mFlowHeight; }
+
+	/**
+	 * Return the size of the blocks of pixels that get one flow vector each.
+	 */
+	inline uint32_t GetGridSize() const				{ return mGridSize; }
+
+	/**
+	 * Return the backend that's being used (BACKEND_CUDA or BACKEND_OFA).
+	 */
+	inline Backend GetBackend() const					{ return mBackend; }
+
+	/**
+	 * Return true if the last flow field was computed from two frames.
+	 */
+	inline bool IsValid() const						{ return mFrames > 1; }
+
+	/**
+	 * Set the number of pyramid levels used by BACKEND_CUDA (the default is 3).
+	 * More levels can track larger motions.
+	 */
+	inline void SetLevels( uint32_t levels )			{ mLevels = levels; }
+
+	/**
+	 * Set the radius of the Lucas-Kanade window used by BACKEND_CUDA (the default is 4, or 9x9).
+	 */
+	inline void SetWindow( uint32_t radius )			{ mWindow = radius; }
+
+	/**
+	 * Set the maximum number of Lucas-Kanade iterations per level used by BACKEND_CUDA (the default is 8).
+	 */
+	inline void SetIterations( uint32_t iterations )		{ mIterations = iterations; }
+
+	/**
+	 * Return true if the library was built with the OFA backend (it still needs an Orin to run).
+	 */
+	static bool HasOFA();
+
+	/**
+	 * Convert a Backend enum to a string.
+	 */
+	static const char* BackendToStr( Backend backend );
+
+protected:
+	cudaOpticalFlow();
+
+	bool alloc( uint32_t width, uint32_t height );
+	void free();
+
+	bool initOFA( uint32_t width, uint32_t height );
+	void freeOFA();
+
+	cudaError_t processCUDA( void* frame, imageFormat format, cudaStream_t stream );
+	cudaError_t processOFA( void* frame, imageFormat format, cudaStream_t stream );
+
+	Backend  mBackend;
+	uint32_t mGridSize;
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mFlowWidth;
+	uint32_t mFlowHeight;
+	uint32_t mLevels;
+	uint32_t mWindow;
+	uint32_t mIterations;
+	uint32_t mFrames;
+	uint32_t mCurrent;
+
+	float2*  mFlow;
+
+	// BACKEND_CUDA (the luma and pyramid of the current and previous frames)
+	float*      mLuma[2];
+	cudaPyramid mPyramid[2];
+
+	// BACKEND_OFA (the VPI objects are kept opaque, so VPI isn't needed to include this header)
+	uint8_t* mLuma8;
+	void*    mVPIStream;
+	void*    mVPIPayload;
+	void*    mVPILuma;
+	void*    mVPIFrames[2];
+	void*    mVPIMotion;
+	void*    mVPIMotionLinear;
+};
+
+
+#endif
+
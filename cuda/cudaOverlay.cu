@@ -22,6 +22,9 @@
 
 #include "cudaOverlay.h"
 #include "cudaAlphaBlend.cuh"
+#include "cudaFilterMode.cuh"
+#include "cudaAutotune.h"
+#include "cudaNVTX.h"
 
 
 // cudaOverlay
@@ -57,8 +60,10 @@ __global__ void gpuOverlayAlpha( T* input, int inputWidth, int inputHeight, T* o
 
 cudaError_t cudaOverlay( void* input, size_t inputWidth, size_t inputHeight,
 					void* output, size_t outputWidth, size_t outputHeight,
-					imageFormat format, int x, int y )
+					imageFormat format, int x, int y, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaOverlay");
+
 	if( !input || !output || inputWidth == 0 || inputHeight == 0 || outputWidth == 0 || outputHeight == 0 )
 		return cudaErrorInvalidValue;
 	
@@ -77,27 +82,130 @@ cudaError_t cudaOverlay( void* input, size_t inputWidth, size_t inputHeight,
 	if( y + overlayHeight >= outputHeight )
 		overlayHeight = outputHeight - y;
 	
-	const dim3 blockDim(8, 8);
-	const dim3 gridDim(iDivUp(overlayWidth,blockDim.x), iDivUp(overlayHeight,blockDim.y));
-
 	#define launch_overlay(kernel, type)	\
-		kernel<type><<<gridDim, blockDim>>>((type*)input, inputWidth, inputHeight, (type*)output, outputWidth, outputHeight, x, y)
-	
+		kernel<type><<<gridDim, blockDim, 0, stream>>>((type*)input, inputWidth, inputHeight, (type*)output, outputWidth, outputHeight, x, y)
+
+	auto launch = [&]( const dim3& blockDim ) -> cudaError_t
+	{
+		const dim3 gridDim(iDivUp(overlayWidth,blockDim.x), iDivUp(overlayHeight,blockDim.y));
+
+		if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+			launch_overlay(gpuOverlay, uchar3);
+		else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+			launch_overlay(gpuOverlayAlpha, uchar4);
+		else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+			launch_overlay(gpuOverlay, float3);
+		else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+			launch_overlay(gpuOverlayAlpha, float4);
+		else if( format == IMAGE_GRAY8 )
+			launch_overlay(gpuOverlay, uint8_t);
+		else if( format == IMAGE_GRAY16 )
+			launch_overlay(gpuOverlay, uint16_t);
+		else if( format == IMAGE_GRAY32F )
+			launch_overlay(gpuOverlay, float);
+
+		return cudaGetLastError();
+	};
+
+	dim3 blockDim(8, 8);
+
+	// alpha blending depends on the previous contents of the output, so those aren't tuned
+	if( input != output && imageFormatChannels(format) != 4 )
+		blockDim = cudaAutotune("cudaOverlay", imageFormatSize(format, 1, 1), overlayWidth, overlayHeight, blockDim, stream, launch);
+
+	return CUDA(launch(blockDim));
+}	
+
+
+//----------------------------------------------------------------------------
+// gpuOverlayBatch (blockIdx.z selects the tile, and the threads stride over its rectangle)
+template<typename T, cudaFilterMode filter>
+__global__ void gpuOverlayBatch( const cudaOverlayTile* tiles, T* output, int outputWidth, int outputHeight )
+{
+	const cudaOverlayTile tile = tiles[blockIdx.z];
+
+	if( !tile.image || tile.width == 0 || tile.height == 0 || tile.alpha <= 0.0f )
+		return;
+
+	const int dstWidth  = (tile.outputWidth > 0) ? tile.outputWidth : tile.width;
+	const int dstHeight = (tile.outputHeight > 0) ? tile.outputHeight : tile.height;
+
+	const float scaleX = float(tile.width) / float(dstWidth);
+	const float scaleY = float(tile.height) / float(dstHeight);
+
+	// crop the destination rectangle to the output
+	const int x0 = max(tile.x, 0);
+	const int y0 = max(tile.y, 0);
+	const int x1 = min(tile.x + dstWidth, outputWidth);
+	const int y1 = min(tile.y + dstHeight, outputHeight);
+
+	const float opacity = fminf(tile.alpha, 1.0f);
+
+	for( int y = y0 + blockIdx.y * blockDim.y + threadIdx.y; y < y1; y += gridDim.y * blockDim.y )
+	{
+		for( int x = x0 + blockIdx.x * blockDim.x + threadIdx.x; x < x1; x += gridDim.x * blockDim.x )
+		{
+			const T src = cudaFilterPixel<filter>((T*)tile.image, (x - tile.x + 0.5f) * scaleX, (y - tile.y + 0.5f) * scaleY, tile.width, tile.height);
+			const float a = alpha(src, 255) * opacity;
+
+			if( a >= 255.0f )
+				output[y * outputWidth + x] = make_vec<T>(src.x, src.y, src.z, 255);
+			else if( a > 0.0f )
+				output[y * outputWidth + x] = cudaAlphaBlend(output[y * outputWidth + x], make_float4(src.x, src.y, src.z, a));
+		}
+	}
+}
+
+// cudaOverlayBatch
+cudaError_t cudaOverlayBatch( const cudaOverlayTile* tiles, uint32_t numTiles,
+					    void* output, size_t outputWidth, size_t outputHeight, imageFormat format,
+					    cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaOverlayBatch");
+
+	if( !tiles || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( numTiles == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( numTiles > 65535 )
+	{
+		LogError(LOG_CUDA "cudaOverlayBatch() -- %u tiles exceeds the maximum of 65535\n", numTiles);
+		return cudaErrorInvalidValue;
+	}
+
+	// the tiles are in device memory, so their sizes aren't known here - size the grid for a mosaic
+	// that fills the output (ceil(sqrt(N)) tiles across), and larger tiles get strided over
+	const int columns = (int)ceilf(sqrtf((float)numTiles));
+
+	const dim3 blockDim(16, 8);
+	const dim3 gridDim(iDivUp(iDivUp(outputWidth, columns), blockDim.x), iDivUp(iDivUp(outputHeight, columns), blockDim.y), numTiles);
+
+	#define LAUNCH_OVERLAY_BATCH(type) \
+		if( filter == FILTER_POINT ) \
+			gpuOverlayBatch<type, FILTER_POINT><<<gridDim, blockDim, 0, stream>>>(tiles, (type*)output, outputWidth, outputHeight); \
+		else if( filter == FILTER_CUBIC ) \
+			gpuOverlayBatch<type, FILTER_CUBIC><<<gridDim, blockDim, 0, stream>>>(tiles, (type*)output, outputWidth, outputHeight); \
+		else \
+			gpuOverlayBatch<type, FILTER_LINEAR><<<gridDim, blockDim, 0, stream>>>(tiles, (type*)output, outputWidth, outputHeight)
+
 	if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
-		launch_overlay(gpuOverlay, uchar3);
+		LAUNCH_OVERLAY_BATCH(uchar3);
 	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
-		launch_overlay(gpuOverlayAlpha, uchar4);
+		LAUNCH_OVERLAY_BATCH(uchar4);
 	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
-		launch_overlay(gpuOverlay, float3);
+		LAUNCH_OVERLAY_BATCH(float3);
 	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
-		launch_overlay(gpuOverlayAlpha, float4);
-	else if( format == IMAGE_GRAY8 )
-		launch_overlay(gpuOverlay, uint8_t);
-	else if( format == IMAGE_GRAY32F )
-		launch_overlay(gpuOverlay, float);
-	
+		LAUNCH_OVERLAY_BATCH(float4);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaOverlayBatch()", format);
+		return cudaErrorInvalidValue;
+	}
+
 	return CUDA(cudaGetLastError());
-}	
+}
 							 
 							 
 //----------------------------------------------------------------------------						 
@@ -162,7 +270,7 @@ __global__ void gpuRectFillBox( T* input, T* output, int imgWidth, int imgHeight
 }
 
 template<typename T>
-cudaError_t launchRectFill( T* input, T* output, size_t width, size_t height, float4* rects, int numRects, const float4& color )
+cudaError_t launchRectFill( T* input, T* output, size_t width, size_t height, float4* rects, int numRects, const float4& color, cudaStream_t stream )
 {
 	// if input and output are the same image, then we can use the faster method
 	// which draws 1 box per kernel, but doesn't copy pixels that aren't inside boxes
@@ -177,7 +285,7 @@ cudaError_t launchRectFill( T* input, T* output, size_t width, size_t height, fl
 			const dim3 blockDim(8, 8);
 			const dim3 gridDim(iDivUp(boxWidth,blockDim.x), iDivUp(boxHeight,blockDim.y));
 
-			gpuRectFillBox<T><<<gridDim, blockDim>>>(input, output, width, height, (int)rects[n].x, (int)rects[n].y, boxWidth, boxHeight, color); 
+			gpuRectFillBox<T><<<gridDim, blockDim, 0, stream>>>(input, output, width, height, (int)rects[n].x, (int)rects[n].y, boxWidth, boxHeight, color); 
 		}
 	}
 	else
@@ -186,26 +294,229 @@ cudaError_t launchRectFill( T* input, T* output, size_t width, size_t height, fl
 		const dim3 blockDim(8, 8);
 		const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
 
-		gpuRectFill<T><<<gridDim, blockDim>>>(input, output, width, height, rects, numRects, color);
+		gpuRectFill<T><<<gridDim, blockDim, 0, stream>>>(input, output, width, height, rects, numRects, color);
 	}
 
 	return cudaGetLastError();
 }
 
 // cudaRectFill
-cudaError_t cudaRectFill( void* input, void* output, size_t width, size_t height, imageFormat format, float4* rects, int numRects, const float4& color )
+cudaError_t cudaRectFill( void* input, void* output, size_t width, size_t height, imageFormat format, float4* rects, int numRects, const float4& color, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRectFill");
+
 	if( !input || !output || width == 0 || height == 0 || !rects || numRects == 0 )
 		return cudaErrorInvalidValue;
 
 	if( format == IMAGE_RGB8 )
-		return launchRectFill<uchar3>((uchar3*)input, (uchar3*)output, width, height, rects, numRects, color); 
+		return launchRectFill<uchar3>((uchar3*)input, (uchar3*)output, width, height, rects, numRects, color, stream); 
 	else if( format == IMAGE_RGBA8 )
-		return launchRectFill<uchar4>((uchar4*)input, (uchar4*)output, width, height, rects, numRects, color); 
+		return launchRectFill<uchar4>((uchar4*)input, (uchar4*)output, width, height, rects, numRects, color, stream); 
 	else if( format == IMAGE_RGB32F )
-		return launchRectFill<float3>((float3*)input, (float3*)output, width, height, rects, numRects, color); 
+		return launchRectFill<float3>((float3*)input, (float3*)output, width, height, rects, numRects, color, stream); 
 	else if( format == IMAGE_RGBA32F )
-		return launchRectFill<float4>((float4*)input, (float4*)output, width, height, rects, numRects, color); 
+		return launchRectFill<float4>((float4*)input, (float4*)output, width, height, rects, numRects, color, stream); 
 	else
 		return cudaErrorInvalidValue;
 }
+
+
+//----------------------------------------------------------------------------
+// segmentation overlay
+//----------------------------------------------------------------------------
+
+// color of a class ID (transparent if it's out of range)
+static __device__ inline float4 segClassColor( const float4* palette, int numClasses, int classID )
+{
+	return (classID < numClasses) ? palette[classID] : make_float4(0,0,0,0);
+}
+
+// class with the highest score at a cell (CHW layout)
+static __device__ inline int segArgmax( const float* logits, int offset, int pixels, int numClasses )
+{
+	int maxClass = 0;
+	float maxScore = logits[offset];
+
+	for( int c=1; c < numClasses; c++ )
+	{
+		const float score = logits[c * pixels + offset];
+
+		if( score > maxScore )
+		{
+			maxScore = score;
+			maxClass = c;
+		}
+	}
+
+	return maxClass;
+}
+
+// sample the color of the class map at an output pixel
+template<cudaFilterMode filter>
+static __device__ inline float4 segSample( uint8_t* classMap, int mapWidth, int mapHeight, const float4* palette, int numClasses, int x, int y, float sx, float sy )
+{
+	float4 color;
+
+	if( filter == FILTER_POINT )
+	{
+		const int cx = min(int(float(x) * sx), mapWidth - 1);
+		const int cy = min(int(float(y) * sy), mapHeight - 1);
+
+		color = segClassColor(palette, numClasses, classMap[cy * mapWidth + cx]);
+	}
+	else
+	{
+		// blend the colors of the 4 nearest cells
+		const float bx = fmaxf(float(x) * sx - 0.5f, 0.0f);
+		const float by = fmaxf(float(y) * sy - 0.5f, 0.0f);
+
+		const int x1 = int(bx);
+		const int y1 = int(by);
+
+		const int x2 = x1 >= mapWidth - 1 ? x1 : x1 + 1;
+		const int y2 = y1 >= mapHeight - 1 ? y1 : y1 + 1;
+
+		const float x2f = bx - float(x1);
+		const float y2f = by - float(y1);
+		const float x1f = 1.0f - x2f;
+		const float y1f = 1.0f - y2f;
+
+		color = segClassColor(palette, numClasses, classMap[y1 * mapWidth + x1]) * (x1f * y1f)
+			 + segClassColor(palette, numClasses, classMap[y1 * mapWidth + x2]) * (x2f * y1f)
+			 + segClassColor(palette, numClasses, classMap[y2 * mapWidth + x1]) * (x1f * y2f)
+			 + segClassColor(palette, numClasses, classMap[y2 * mapWidth + x2]) * (x2f * y2f);
+	}
+
+	return color;
+}
+
+// sample the color of the class with the highest score at an output pixel
+template<cudaFilterMode filter>
+static __device__ inline float4 segSample( float* logits, int mapWidth, int mapHeight, const float4* palette, int numClasses, int x, int y, float sx, float sy )
+{
+	const int pixels = mapWidth * mapHeight;
+	int classID = 0;
+
+	if( filter == FILTER_POINT )
+	{
+		const int cx = min(int(float(x) * sx), mapWidth - 1);
+		const int cy = min(int(float(y) * sy), mapHeight - 1);
+
+		classID = segArgmax(logits, cy * mapWidth + cx, pixels, numClasses);
+	}
+	else
+	{
+		// interpolate the scores of each class, and pick the highest
+		const float bx = fmaxf(float(x) * sx - 0.5f, 0.0f);
+		const float by = fmaxf(float(y) * sy - 0.5f, 0.0f);
+
+		const int x1 = int(bx);
+		const int y1 = int(by);
+
+		const int x2 = x1 >= mapWidth - 1 ? x1 : x1 + 1;
+		const int y2 = y1 >= mapHeight - 1 ? y1 : y1 + 1;
+
+		const float x2f = bx - float(x1);
+		const float y2f = by - float(y1);
+		const float x1f = 1.0f - x2f;
+		const float y1f = 1.0f - y2f;
+
+		float maxScore = 0.0f;
+
+		for( int c=0; c < numClasses; c++ )
+		{
+			const float* plane = logits + c * pixels;
+
+			const float score = plane[y1 * mapWidth + x1] * (x1f * y1f)
+						   + plane[y1 * mapWidth + x2] * (x2f * y1f)
+						   + plane[y2 * mapWidth + x1] * (x1f * y2f)
+						   + plane[y2 * mapWidth + x2] * (x2f * y2f);
+
+			if( c == 0 || score > maxScore )
+			{
+				maxScore = score;
+				classID = c;
+			}
+		}
+	}
+
+	return palette[classID];
+}
+
+// gpuOverlaySegmentation
+template<typename S, typename T, cudaFilterMode filter>
+__global__ void gpuOverlaySegmentation( S* map, int mapWidth, int mapHeight, T* output, int outputWidth, int outputHeight,
+							     const float4* palette, int numClasses, float sx, float sy )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const float4 color = segSample<filter>(map, mapWidth, mapHeight, palette, numClasses, x, y, sx, sy);
+
+	if( color.w <= 0.0f )
+		return;
+
+	const int idx = y * outputWidth + x;
+	output[idx] = cudaAlphaBlend(output[idx], color);
+}
+
+// launchOverlaySegmentation
+template<typename S>
+static cudaError_t launchOverlaySegmentation( S* map, size_t mapWidth, size_t mapHeight,
+									 void* output, size_t outputWidth, size_t outputHeight, imageFormat format,
+									 const float4* palette, uint32_t numClasses, cudaFilterMode filter, cudaStream_t stream )
+{
+	if( !map || !output || !palette || mapWidth == 0 || mapHeight == 0 || outputWidth == 0 || outputHeight == 0 || numClasses == 0 )
+		return cudaErrorInvalidValue;
+
+	const float sx = float(mapWidth) / float(outputWidth);
+	const float sy = float(mapHeight) / float(outputHeight);
+
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth, blockDim.x), iDivUp(outputHeight, blockDim.y));
+
+	#define launch_segmentation(type) \
+		if( filter == FILTER_POINT ) \
+			gpuOverlaySegmentation<S, type, FILTER_POINT><<<gridDim, blockDim, 0, stream>>>(map, mapWidth, mapHeight, (type*)output, outputWidth, outputHeight, palette, numClasses, sx, sy); \
+		else \
+			gpuOverlaySegmentation<S, type, FILTER_LINEAR><<<gridDim, blockDim, 0, stream>>>(map, mapWidth, mapHeight, (type*)output, outputWidth, outputHeight, palette, numClasses, sx, sy);
+
+	if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		launch_segmentation(uchar3)
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		launch_segmentation(uchar4)
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		launch_segmentation(float3)
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		launch_segmentation(float4)
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaOverlaySegmentation()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	#undef launch_segmentation
+
+	return CUDA(cudaGetLastError());
+}
+
+// cudaOverlaySegmentation
+cudaError_t cudaOverlaySegmentation( uint8_t* classMap, size_t mapWidth, size_t mapHeight,
+							  void* output, size_t outputWidth, size_t outputHeight, imageFormat format,
+							  const float4* palette, uint32_t numClasses, cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaOverlaySegmentation");
+	return launchOverlaySegmentation<uint8_t>(classMap, mapWidth, mapHeight, output, outputWidth, outputHeight, format, palette, numClasses, filter, stream);
+}
+
+// cudaOverlaySegmentation
+cudaError_t cudaOverlaySegmentation( float* logits, size_t mapWidth, size_t mapHeight,
+							  void* output, size_t outputWidth, size_t outputHeight, imageFormat format,
+							  const float4* palette, uint32_t numClasses, cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaOverlaySegmentation");
+	return launchOverlaySegmentation<float>(logits, mapWidth, mapHeight, output, outputWidth, outputHeight, format, palette, numClasses, filter, stream);
+}
@@ -26,6 +26,7 @@
 
 #include "cudaUtility.h"
 #include "imageFormat.h"
+#include "cudaFilterMode.h"
 
 
 /**
@@ -36,7 +37,7 @@
  */
 cudaError_t cudaOverlay( void* input, size_t inputWidth, size_t inputHeight,
 					void* output, size_t outputWidth, size_t outputHeight,
-					imageFormat format, int x, int y );
+					imageFormat format, int x, int y, cudaStream_t stream=NULL );
 			
 /**
  * Overlay the input image composted onto the output image at location (x,y)
@@ -47,9 +48,9 @@ cudaError_t cudaOverlay( void* input, size_t inputWidth, size_t inputHeight,
 template<typename T> 
 cudaError_t cudaOverlay( T* input, size_t inputWidth, size_t inputHeight,
 					T* output, size_t outputWidth, size_t outputHeight,
-					int x, int y )
+					int x, int y, cudaStream_t stream=NULL )
 { 
-	return cudaOverlay(input, inputWidth, inputHeight, output, outputWidth, outputHeight, imageFormatFromType<T>(), x, y); 
+	return cudaOverlay(input, inputWidth, inputHeight, output, outputWidth, outputHeight, imageFormatFromType<T>(), x, y, stream); 
 }
 
 /**
@@ -61,10 +62,50 @@ cudaError_t cudaOverlay( T* input, size_t inputWidth, size_t inputHeight,
 template<typename T> 
 cudaError_t cudaOverlay( T* input, const int2& inputDims,
 					T* output, const int2& outputDims,
-					int x, int y )
+					int x, int y, cudaStream_t stream=NULL )
 { 
-	return cudaOverlay(input, inputDims.x, inputDims.y, output, outputDims.x, outputDims.y, imageFormatFromType<T>(), x, y); 
+	return cudaOverlay(input, inputDims.x, inputDims.y, output, outputDims.x, outputDims.y, imageFormatFromType<T>(), x, y, stream); 
 }
+
+
+/**
+ * One of the images that gets composited by cudaOverlayBatch().
+ * @ingroup overlay
+ */
+struct cudaOverlayTile
+{
+	void*    image;		/**< The tile's image (in GPU-accessible memory), or NULL to skip the tile */
+	uint32_t width;	/**< Width of the image */
+	uint32_t height;	/**< Height of the image */
+	int      x;		/**< Left edge of the destination rectangle in the output (can be negative) */
+	int      y;		/**< Top edge of the destination rectangle in the output (can be negative) */
+	uint32_t outputWidth;	/**< Width of the destination rectangle (or 0 for the width of the image) */
+	uint32_t outputHeight;	/**< Height of the destination rectangle (or 0 for the height of the image) */
+	float    alpha;	/**< Opacity of the tile from 0 to 1 (multiplied by the image's own alpha channel, if any) */
+};
+
+/**
+ * Composite multiple images onto the output image in a single launch, for example the
+ * thumbnails of a mosaic or picture-in-picture layout.
+ *
+ * Each tile is scaled to its destination rectangle with the filter, and alpha blended
+ * with cudaAlphaBlend() using the tile's opacity times its alpha channel (opaque tiles are
+ * just copied).  The parts of the tiles that fall outside of the output are cropped.  The
+ * tiles are composited concurrently, so if they overlap the order in which they're blended
+ * is undefined.
+ *
+ * The tiles and the output should all have the same format, which can be rgb8, rgba8,
+ * rgb32f, or rgba32f (or BGR).
+ *
+ * @param tiles array of the tiles in GPU-accessible memory (e.g. from cudaAllocMapped()),
+ *              so that it can be updated every frame without a copy.
+ * @param numTiles the number of tiles in the array
+ * @param filter FILTER_POINT, FILTER_LINEAR, or FILTER_CUBIC (for tiles that get scaled)
+ * @ingroup overlay
+ */
+cudaError_t cudaOverlayBatch( const cudaOverlayTile* tiles, uint32_t numTiles,
+					    void* output, size_t outputWidth, size_t outputHeight, imageFormat format,
+					    cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
 		
 	
 /**
@@ -73,7 +114,7 @@ cudaError_t cudaOverlay( T* input, const int2& inputDims,
  * @ingroup overlay
  */
 cudaError_t cudaRectFill( void* input, void* output, size_t width, size_t height, imageFormat format, 
-						  float4* rects, int numRects, const float4& color );
+						  float4* rects, int numRects, const float4& color, cudaStream_t stream=NULL );
 
 /**
  * cudaRectFill
@@ -82,9 +123,56 @@ cudaError_t cudaRectFill( void* input, void* output, size_t width, size_t height
  */
 template<typename T> 
 cudaError_t cudaRectFill( T* input, T* output, size_t width, size_t height, 
-				 		  float4* rects, int numRects, const float4& color )	
+				 		  float4* rects, int numRects, const float4& color, cudaStream_t stream=NULL )	
 { 
-	return cudaRectFill(input, output, width, height, imageFormatFromType<T>(), rects, numRects, color); 
+	return cudaRectFill(input, output, width, height, imageFormatFromType<T>(), rects, numRects, color, stream); 
+}
+
+
+/**
+ * Overlay the class map from a segmentation network onto an image, in place.
+ * The class map is upscaled to the size of the image, mapped through the class palette,
+ * and alpha blended with the image in a single kernel, instead of colorizing it, resizing it,
+ * and then overlaying it (which needs two full-resolution temporary images).
+ *
+ * @param classMap the class ID of each cell of the segmentation, in CUDA memory
+ * @param palette the RGBA color of each class (in CUDA memory), with the alpha (between 0 and 255)
+ *                setting its opacity.  Classes with an alpha of 0, or with IDs that are greater
+ *                than or equal to numClasses, aren't drawn.
+ * @param filter FILTER_POINT for blocky cells, or FILTER_LINEAR to blend the colors of
+ *               the neighboring cells (which smooths the edges between the classes).
+ * @param format the format of the image - rgb8, rgba8, rgb32f, or rgba32f (or BGR)
+ * @ingroup overlay
+ */
+cudaError_t cudaOverlaySegmentation( uint8_t* classMap, size_t mapWidth, size_t mapHeight,
+							  void* output, size_t outputWidth, size_t outputHeight, imageFormat format,
+							  const float4* palette, uint32_t numClasses,
+							  cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+/**
+ * Overlay the output of a segmentation network onto an image, in place, from its per-class
+ * scores (the logits or probabilities, in CHW layout with numClasses channels).  Each pixel is
+ * drawn in the color of the class with the highest score.  With FILTER_LINEAR, the scores are
+ * interpolated before the highest one is picked, which gives smooth boundaries between the classes.
+ * @see the other cudaOverlaySegmentation() for the rest of the parameters.
+ * @ingroup overlay
+ */
+cudaError_t cudaOverlaySegmentation( float* logits, size_t mapWidth, size_t mapHeight,
+							  void* output, size_t outputWidth, size_t outputHeight, imageFormat format,
+							  const float4* palette, uint32_t numClasses,
+							  cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+/**
+ * Overlay the class map (uint8_t) or scores (float) from a segmentation network onto an image, in place.
+ * @ingroup overlay
+ */
+template<typename S, typename T>
+cudaError_t cudaOverlaySegmentation( S* classMap, size_t mapWidth, size_t mapHeight,
+							  T* output, size_t outputWidth, size_t outputHeight,
+							  const float4* palette, uint32_t numClasses,
+							  cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL )
+{
+	return cudaOverlaySegmentation(classMap, mapWidth, mapHeight, (void*)output, outputWidth, outputHeight, imageFormatFromType<T>(), palette, numClasses, filter, stream);
 }
 
 
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaPerceptualHash.h"
+#include "cudaMappedMemory.h"
+#include "cudaMemoryPool.h"
+#include "cudaVector.h"
+#include "cudaNVTX.h"
+
+
+// the size of the thumbnail that gets hashed
+#define PHASH_SIZE 32
+
+
+// luminance of a pixel (between 0 and 255)
+static __device__ inline float hashLuma( uint8_t v )			{ return v; }
+static __device__ inline float hashLuma( float v )			{ return v; }
+static __device__ inline float hashLuma( const uchar3& v )		{ return 0.299f * v.x + 0.587f * v.y + 0.114f * v.z; }
+static __device__ inline float hashLuma( const uchar4& v )		{ return 0.299f * v.x + 0.587f * v.y + 0.114f * v.z; }
+static __device__ inline float hashLuma( const float3& v )		{ return 0.299f * v.x + 0.587f * v.y + 0.114f * v.z; }
+static __device__ inline float hashLuma( const float4& v )		{ return 0.299f * v.x + 0.587f * v.y + 0.114f * v.z; }
+
+
+// gpuHashThumbnail (one block per pixel of the thumbnail, which averages its area of the image)
+template<typename T>
+__global__ void gpuHashThumbnail( T* input, int width, int height, float* thumbnail )
+{
+	__shared__ float sums[256];
+
+	const int x0 = (blockIdx.x * width) / PHASH_SIZE;
+	const int y0 = (blockIdx.y * height) / PHASH_SIZE;
+	const int x1 = max(((blockIdx.x + 1) * width) / PHASH_SIZE, x0 + 1);
+	const int y1 = max(((blockIdx.y + 1) * height) / PHASH_SIZE, y0 + 1);
+
+	const int tid = threadIdx.y * blockDim.x + threadIdx.x;
+
+	float sum = 0.0f;
+
+	for( int y=y0 + threadIdx.y; y < y1; y += blockDim.y )
+		for( int x=x0 + threadIdx.x; x < x1; x += blockDim.x )
+			sum += hashLuma(input[y * width + x]);
+
+	sums[tid] = sum;
+	__syncthreads();
+
+	for( int n=128; n > 0; n >>= 1 )
+	{
+		if( tid < n )
+			sums[tid] += sums[tid + n];
+
+		__syncthreads();
+	}
+
+	if( tid == 0 )
+		thumbnail[blockIdx.y * PHASH_SIZE + blockIdx.x] = sums[0] / ((x1 - x0) * (y1 - y0));
+}
+
+
+// gpuHashBits (one block of PHASH_SIZE x PHASH_SIZE threads)
+__global__ void gpuHashBits( const float* thumbnail, uint64_t* hash, cudaPerceptualHashType type )
+{
+	__shared__ float cells[PHASH_SIZE][PHASH_SIZE + 1];
+	__shared__ float rows[8][PHASH_SIZE];
+	__shared__ float coeffs[64];
+
+	const int x = threadIdx.x;
+	const int y = threadIdx.y;
+
+	cells[y][x] = thumbnail[y * PHASH_SIZE + x];
+	__syncthreads();
+
+	if( type == PHASH_DCT )
+	{
+		// separable DCT-II, where only the 8 lowest frequencies along each axis are needed
+		if( y < 8 )
+		{
+			float sum = 0.0f;
+
+			for( int i=0; i < PHASH_SIZE; i++ )
+				sum += cells[x][i] * cospif((2 * i + 1) * y / float(PHASH_SIZE * 2));
+
+			rows[y][x] = sum;
+		}
+
+		__syncthreads();
+
+		if( y < 8 && x < 8 )
+		{
+			float sum = 0.0f;
+
+			for( int j=0; j < PHASH_SIZE; j++ )
+				sum += rows[x][j] * cospif((2 * j + 1) * y / float(PHASH_SIZE * 2));
+
+			coeffs[y * 8 + x] = sum;
+		}
+	}
+	else if( y < 8 && x < 8 )
+	{
+		// downsample the thumbnail again to 8x8
+		const int scale = PHASH_SIZE / 8;
+		float sum = 0.0f;
+
+		for( int j=0; j < scale; j++ )
+			for( int i=0; i < scale; i++ )
+				sum += cells[y * scale + j][x * scale + i];
+
+		coeffs[y * 8 + x] = sum;
+	}
+
+	__syncthreads();
+
+	if( x != 0 || y != 0 )
+		return;
+
+	// the DC term of the DCT is the overall brightness, so it's left out of the mean
+	const int first = (type == PHASH_DCT) ? 1 : 0;
+	float mean = 0.0f;
+
+	for( int n=first; n < 64; n++ )
+		mean += coeffs[n];
+
+	mean /= (64 - first);
+
+	uint64_t bits = 0;
+
+	for( int n=0; n < 64; n++ )
+	{
+		if( coeffs[n] > mean )
+			bits |= (1ULL << n);
+	}
+
+	*hash = bits;
+}
+
+
+// launchPerceptualHash
+template<typename T>
+static cudaError_t launchPerceptualHash( void* input, int width, int height, uint64_t* hash, cudaPerceptualHashType type, cudaStream_t stream )
+{
+	float* thumbnail = NULL;
+
+	if( !cudaMallocPooled((void**)&thumbnail, PHASH_SIZE * PHASH_SIZE * sizeof(float)) )
+		return cudaErrorMemoryAllocation;
+
+	gpuHashThumbnail<T><<<dim3(PHASH_SIZE, PHASH_SIZE), dim3(16, 16), 0, stream>>>((T*)input, width, height, thumbnail);
+	gpuHashBits<<<1, dim3(PHASH_SIZE, PHASH_SIZE), 0, stream>>>(thumbnail, hash, type);
+
+	// the pool doesn't hand the block out again until the kernels are done with it
+	cudaFreePooled(thumbnail, stream);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaPerceptualHash
+cudaError_t cudaPerceptualHash( void* input, uint32_t width, uint32_t height, imageFormat format, uint64_t* hash,
+						  cudaPerceptualHashType type, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaPerceptualHash");
+
+	if( !input || !hash )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( format == IMAGE_GRAY8 || format == IMAGE_I420 || format == IMAGE_YV12 || format == IMAGE_NV12 )
+		return launchPerceptualHash<uint8_t>(input, width, height, hash, type, stream);	// the luma plane comes first
+	else if( format == IMAGE_GRAY32F )
+		return launchPerceptualHash<float>(input, width, height, hash, type, stream);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return launchPerceptualHash<uchar3>(input, width, height, hash, type, stream);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return launchPerceptualHash<uchar4>(input, width, height, hash, type, stream);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return launchPerceptualHash<float3>(input, width, height, hash, type, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return launchPerceptualHash<float4>(input, width, height, hash, type, stream);
+
+	imageFormatErrorMsg(LOG_CUDA, "cudaPerceptualHash()", format);
+	return cudaErrorInvalidValue;
+}
+
+
+// constructor
+cudaDedup::cudaDedup( uint32_t maxDistance, cudaPerceptualHashType type )
+{
+	mHash       = NULL;
+	mEvent      = NULL;
+	mType       = type;
+	mReference  = 0;
+	mDuplicates = 0;
+
+	mMaxDistance = maxDistance;
+	mDistance    = 0;
+
+	mInitialized = false;
+	mPending     = false;
+	mDuplicate   = false;
+}
+
+
+// destructor
+cudaDedup::~cudaDedup()
+{
+	if( mPending )
+		sync();
+
+	CUDA_FREE_HOST(mHash);
+
+	if( mEvent != NULL )
+	{
+		CUDA(cudaEventDestroy(mEvent));
+		mEvent = NULL;
+	}
+}
+
+
+// Reset
+void cudaDedup::Reset()
+{
+	if( mPending )
+		sync();
+
+	mInitialized = false;
+}
+
+
+// Process
+cudaError_t cudaDedup::Process( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream )
+{
+	// the hash of the previous frame gets overwritten
+	if( mPending )
+		sync();
+
+	if( !mHash && !cudaAllocMapped(&mHash, sizeof(uint64_t)) )
+		return cudaErrorMemoryAllocation;
+
+	if( !mEvent && CUDA_FAILED(cudaEventCreateWithFlags(&mEvent, cudaEventDisableTiming)) )
+		return cudaErrorInvalidValue;
+
+	const cudaError_t result = cudaPerceptualHash(image, width, height, format, mHash, mType, stream);
+
+	if( result != cudaSuccess )
+		return result;
+
+	if( CUDA_FAILED(cudaEventRecord(mEvent, stream)) )
+		return cudaErrorInvalidValue;
+
+	mPending = true;
+	return cudaSuccess;
+}
+
+
+// sync
+bool cudaDedup::sync()
+{
+	if( !mPending )
+		return true;
+
+	mPending = false;
+
+	// frames that fail to be hashed are kept
+	if( CUDA_FAILED(cudaEventSynchronize(mEvent)) )
+	{
+		mDistance  = 64;
+		mDuplicate = false;
+		return false;
+	}
+
+	const uint64_t hash = *mHash;
+
+	mDistance  = mInitialized ? cudaHashDistance(hash, mReference) : 64;
+	mDuplicate = mInitialized && mDistance <= mMaxDistance;
+
+	// the frames that are kept become the reference for the next ones
+	if( mDuplicate )
+	{
+		mDuplicates++;
+	}
+	else
+	{
+		mReference   = hash;
+		mInitialized = true;
+	}
+
+	return true;
+}
+
+
+// IsDuplicate
+bool cudaDedup::IsDuplicate()
+{
+	sync();
+	return mDuplicate;
+}
+
+
+// GetDistance
+uint32_t cudaDedup::GetDistance()
+{
+	sync();
+	return mDistance;
+}
+
+
+// GetHash
+uint64_t cudaDedup::GetHash()
+{
+	sync();
+	return mHash != NULL ? *mHash : 0;
+}
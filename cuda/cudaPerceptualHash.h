@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_PERCEPTUAL_HASH_H__
+#define __CUDA_PERCEPTUAL_HASH_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * Methods for computing the perceptual hash of an image with cudaPerceptualHash().
+ * @ingroup cuda
+ */
+enum cudaPerceptualHashType
+{
+	PHASH_DCT = 0,		/**< Compare the 8x8 lowest frequencies of the DCT of a 32x32 thumbnail against their mean (pHash) */
+	PHASH_MEAN		/**< Compare the pixels of an 8x8 thumbnail against their mean (aHash, faster but less robust) */
+};
+
+/**
+ * Compute a 64-bit perceptual hash of an image, so that images which look alike have hashes that
+ * differ in only a few bits (see cudaHashDistance()).  The luminance of the image is downsampled
+ * to a 32x32 thumbnail by averaging, so the hash doesn't depend on the resolution, and small changes
+ * like noise or compression artifacts hardly affect it.
+ *
+ * The supported formats are gray8, gray32f, rgb8, rgba8, rgb32f, rgba32f (and BGR), and
+ * the planar YUV formats (I420, YV12, NV12), which only have their luma plane read.
+ *
+ * @param hash the output hash, which needs to be accessible from CUDA (e.g. from cudaAllocMapped()).
+ *             It's written asynchronously on the stream, so synchronize it before reading from the CPU.
+ *
+ * @ingroup cuda
+ */
+cudaError_t cudaPerceptualHash( void* input, uint32_t width, uint32_t height, imageFormat format, uint64_t* hash,
+						  cudaPerceptualHashType type=PHASH_DCT, cudaStream_t stream=0 );
+
+/**
+ * Compute a 64-bit perceptual hash of an image.
+ * @see cudaPerceptualHash()
+ * @ingroup cuda
+ */
+template<typename T> cudaError_t cudaPerceptualHash( T* input, uint32_t width, uint32_t height, uint64_t* hash,
+										   cudaPerceptualHashType type=PHASH_DCT, cudaStream_t stream=0 )	{ return cudaPerceptualHash((void*)input, width, height, imageFormatFromType<T>(), hash, type, stream); }
+
+/**
+ * Return the Hamming distance between two perceptual hashes (the number of bits that differ, between 0 and 64).
+ * Images whose hashes are within a distance of about 5 are usually near-duplicates.
+ * @ingroup cuda
+ */
+inline uint32_t cudaHashDistance( uint64_t a, uint64_t b )		{ return __builtin_popcountll(a ^ b); }
+
+
+/**
+ * Filter for near-duplicate frames (for example when recording datasets from a camera, where most
+ * consecutive frames look the same).  Each frame is hashed with cudaPerceptualHash() and compared
+ * against the hash of the last frame that was kept, and it's a duplicate if the Hamming distance
+ * is within the threshold.  Otherwise the frame is kept and becomes the new reference, so scenes that
+ * change slowly over many frames still get a new frame kept once they've changed enough.
+ *
+ * Like cudaMotion, Process() only queues the kernels, and the first call to IsDuplicate(),
+ * GetDistance() or GetHash() afterwards waits for them to complete.
+ *
+ * @ingroup cuda
+ */
+class cudaDedup
+{
+public:
+	/**
+	 * Create a duplicate filter.
+	 * @param maxDistance frames whose hash is within this Hamming distance of the last kept frame are duplicates
+	 * @param type the perceptual hash method
+	 */
+	cudaDedup( uint32_t maxDistance=5, cudaPerceptualHashType type=PHASH_DCT );
+
+	/**
+	 * Destructor
+	 */
+	~cudaDedup();
+
+	/**
+	 * Hash a frame and compare it against the last frame that was kept.
+	 * The first frame (or the first one after Reset()) is always kept.
+	 */
+	cudaError_t Process( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream=0 );
+
+	/**
+	 * Hash a frame and compare it against the last frame that was kept.
+	 */
+	template<typename T> cudaError_t Process( T* image, uint32_t width, uint32_t height, cudaStream_t stream=0 )		{ return Process((void*)image, width, height, imageFormatFromType<T>(), stream); }
+
+	/**
+	 * Return true if the last frame was a near-duplicate of the last frame that was kept.
+	 */
+	bool IsDuplicate();
+
+	/**
+	 * Return the Hamming distance between the last frame and the last frame that was kept before it.
+	 */
+	uint32_t GetDistance();
+
+	/**
+	 * Return the perceptual hash of the last frame.
+	 */
+	uint64_t GetHash();
+
+	/**
+	 * Return the number of frames that were duplicates.
+	 */
+	inline uint64_t GetDuplicateCount() const			{ return mDuplicates; }
+
+	/**
+	 * Keep the next frame, regardless of its distance.
+	 */
+	void Reset();
+
+	/**
+	 * Set the Hamming distance (between 0 and 64) that frames need to exceed to be kept.
+	 */
+	inline void SetMaxDistance( uint32_t distance )		{ mMaxDistance = distance; }
+
+protected:
+	bool sync();
+
+	uint64_t* mHash;
+	uint64_t  mReference;
+	uint64_t  mDuplicates;
+
+	cudaEvent_t mEvent;
+	cudaPerceptualHashType mType;
+
+	uint32_t mMaxDistance;
+	uint32_t mDistance;
+
+	bool mInitialized;
+	bool mPending;
+	bool mDuplicate;
+};
+
+#endif
@@ -0,0 +1,386 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaPointCloud.h"
+#include "cudaVector.h"
+
+#include "logging.h"
+
+
+// number of threads per block used by the compaction kernels
+#define COMPACT_BLOCK_SIZE 256
+
+// number of threads used by the single-block prefix sum
+#define COMPACT_SCAN_SIZE 1024
+
+// empty slot in the voxel hash table
+#define VOXEL_EMPTY 0xFFFFFFFFFFFFFFFFULL
+
+// bits used for each axis of the voxel coordinates in the hash keys
+#define VOXEL_BITS 21
+
+
+// points are invalid if their depth was zero, negative, or non-finite (pos.z = -depth)
+inline __device__ bool validPoint( const cudaPointCloud::Vertex& point )
+{
+	return isfinite(point.pos.z) && point.pos.z < 0.0f;
+}
+
+
+// source of points to compact from the point cloud
+struct PointSource
+{
+	const cudaPointCloud::Vertex* points;
+
+	__device__ inline bool valid( int i ) const					{ return validPoint(points[i]); }
+	__device__ inline cudaPointCloud::Vertex get( int i ) const		{ return points[i]; }
+};
+
+
+// accumulated points of a voxel
+struct VoxelAccum
+{
+	float3   pos;
+	uint32_t color[3];
+	uint32_t count;
+	uint32_t classID;
+};
+
+
+// source of points to compact from the occupied slots of the voxel hash table
+struct VoxelSource
+{
+	const unsigned long long* keys;
+	const VoxelAccum* accum;
+
+	__device__ inline bool valid( int i ) const	{ return keys[i] != VOXEL_EMPTY; }
+
+	__device__ inline cudaPointCloud::Vertex get( int i ) const
+	{
+		const VoxelAccum voxel = accum[i];
+		const float scale = 1.0f / float(voxel.count);
+
+		cudaPointCloud::Vertex point;
+
+		point.pos     = voxel.pos * scale;
+		point.color   = make_uchar3(voxel.color[0] / voxel.count, voxel.color[1] / voxel.count, voxel.color[2] / voxel.count);
+		point.classID = voxel.classID;
+
+		return point;
+	}
+};
+
+
+// gpuCompactCount
+template<typename Source>
+__global__ void gpuCompactCount( Source source, int n, uint32_t* counts )
+{
+	const int i = blockIdx.x * blockDim.x + threadIdx.x;
+	const int count = __syncthreads_count(i < n && source.valid(i));
+
+	if( threadIdx.x == 0 )
+		counts[blockIdx.x] = count;
+}
+
+
+// gpuCompactScan (exclusive prefix sum of the block counts, with the total stored at counts[n])
+__global__ void gpuCompactScan( uint32_t* counts, int n )
+{
+	__shared__ uint32_t sums[COMPACT_SCAN_SIZE];
+
+	// each thread sums a contiguous chunk of the counts
+	const int chunk = (n + COMPACT_SCAN_SIZE - 1) / COMPACT_SCAN_SIZE;
+	const int begin = threadIdx.x * chunk;
+	const int end   = min(begin + chunk, n);
+
+	uint32_t sum = 0;
+
+	for( int i=begin; i < end; i++ )
+		sum += counts[i];
+
+	sums[threadIdx.x] = sum;
+	__syncthreads();
+
+	// inclusive scan of the chunk sums
+	for( int offset=1; offset < COMPACT_SCAN_SIZE; offset *= 2 )
+	{
+		const uint32_t value = (threadIdx.x >= offset) ? sums[threadIdx.x - offset] : 0;
+		__syncthreads();
+
+		sums[threadIdx.x] += value;
+		__syncthreads();
+	}
+
+	// exclusive scan within each chunk
+	uint32_t offset = sums[threadIdx.x] - sum;
+
+	for( int i=begin; i < end; i++ )
+	{
+		const uint32_t count = counts[i];
+		counts[i] = offset;
+		offset += count;
+	}
+
+	if( threadIdx.x == COMPACT_SCAN_SIZE - 1 )
+		counts[n] = sums[threadIdx.x];
+}
+
+
+// gpuCompactScatter
+template<typename Source>
+__global__ void gpuCompactScatter( Source source, int n, const uint32_t* offsets, cudaPointCloud::Vertex* output )
+{
+	__shared__ uint32_t warpCounts[COMPACT_BLOCK_SIZE / 32];
+
+	const int i = blockIdx.x * blockDim.x + threadIdx.x;
+	const bool valid = (i < n) && source.valid(i);
+
+	const int lane = threadIdx.x % 32;
+	const int warp = threadIdx.x / 32;
+
+	const uint32_t ballot = __ballot_sync(0xFFFFFFFF, valid);
+
+	if( lane == 0 )
+		warpCounts[warp] = __popc(ballot);
+
+	__syncthreads();
+
+	if( !valid )
+		return;
+
+	// the output index is the block's offset + the valid points before this one in the block
+	uint32_t index = offsets[blockIdx.x] + __popc(ballot & ((1u << lane) - 1));
+
+	for( int w=0; w < warp; w++ )
+		index += warpCounts[w];
+
+	output[index] = source.get(i);
+}
+
+
+// size of the scratch memory used by compactPoints() for N inputs
+static inline size_t compactSize( uint32_t n )
+{
+	return (iDivUp(n, COMPACT_BLOCK_SIZE) + 1) * sizeof(uint32_t);
+}
+
+
+// compactPoints
+template<typename Source>
+static cudaError_t compactPoints( const Source& source, uint32_t n, uint32_t* counts, 
+						    cudaPointCloud::Vertex* output, uint32_t* numOutput )
+{
+	const int numBlocks = iDivUp(n, COMPACT_BLOCK_SIZE);
+
+	gpuCompactCount<Source><<<numBlocks, COMPACT_BLOCK_SIZE>>>(source, n, counts);
+	gpuCompactScan<<<1, COMPACT_SCAN_SIZE>>>(counts, numBlocks);
+	gpuCompactScatter<Source><<<numBlocks, COMPACT_BLOCK_SIZE>>>(source, n, counts, output);
+
+	const cudaError_t result = cudaGetLastError();
+
+	if( result != cudaSuccess )
+		return result;
+
+	// the number of points is needed on the CPU to render/save them
+	return cudaMemcpy(numOutput, counts + numBlocks, sizeof(uint32_t), cudaMemcpyDeviceToHost);
+}
+
+
+// Compact
+bool cudaPointCloud::Compact()
+{
+	if( mNumPoints == 0 )
+		return true;
+
+	// the points are scattered into a temporary buffer, since other
+	// blocks could still be reading the points that would be overwritten
+	const size_t pointsSize = mNumPoints * sizeof(Vertex);
+
+	if( !allocFilter(pointsSize + compactSize(mNumPoints)) )
+		return false;
+
+	Vertex* points = (Vertex*)mFilterGPU;
+	uint32_t* counts = (uint32_t*)((uint8_t*)mFilterGPU + pointsSize);
+
+	Vertex* input = mapPoints();
+
+	if( !input )
+		return false;
+
+	PointSource source;
+	source.points = input;
+
+	uint32_t numPoints = 0;
+
+	if( CUDA_FAILED(compactPoints(source, mNumPoints, counts, points, &numPoints)) )
+	{
+		LogError(LOG_CUDA "cudaPointCloud::Compact() -- failed to compact the point cloud\n");
+		unmapPoints();
+		return false;
+	}
+
+	const cudaError_t result = cudaMemcpy(input, points, numPoints * sizeof(Vertex), cudaMemcpyDeviceToDevice);
+	unmapPoints();
+
+	if( CUDA_FAILED(result) )
+		return false;
+
+	mNumPoints = numPoints;
+
+	return true;
+}
+
+
+// pack the voxel coordinates of a point into a hash key
+inline __device__ unsigned long long voxelKey( const float3& pos, float scale )
+{
+	const int offset = 1 << (VOXEL_BITS - 1);
+	const int limit  = (1 << VOXEL_BITS) - 1;
+
+	const unsigned long long x = min(max(int(floorf(pos.x * scale)) + offset, 0), limit);
+	const unsigned long long y = min(max(int(floorf(pos.y * scale)) + offset, 0), limit);
+	const unsigned long long z = min(max(int(floorf(pos.z * scale)) + offset, 0), limit);
+
+	return (x << (VOXEL_BITS * 2)) | (y << VOXEL_BITS) | z;
+}
+
+
+// hash function for the voxel keys (from MurmurHash3's 64-bit finalizer)
+inline __device__ uint32_t voxelHash( unsigned long long key )
+{
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	key *= 0xC4CEB9FE1A85EC53ULL;
+	key ^= key >> 33;
+
+	return (uint32_t)key;
+}
+
+
+// gpuVoxelInsert
+__global__ void gpuVoxelInsert( const cudaPointCloud::Vertex* points, int numPoints, float scale,
+						  unsigned long long* keys, VoxelAccum* accum, uint32_t tableSize )
+{
+	const int i = blockIdx.x * blockDim.x + threadIdx.x;
+
+	if( i >= numPoints )
+		return;
+
+	const cudaPointCloud::Vertex point = points[i];
+
+	if( !validPoint(point) )
+		return;
+
+	// find the voxel's slot in the table with linear probing
+	const unsigned long long key = voxelKey(point.pos, scale);
+	const uint32_t mask = tableSize - 1;
+
+	uint32_t slot = voxelHash(key) & mask;
+
+	for( uint32_t n=0; n < tableSize; n++ )
+	{
+		const unsigned long long prev = atomicCAS(&keys[slot], VOXEL_EMPTY, key);
+
+		if( prev == VOXEL_EMPTY || prev == key )
+		{
+			VoxelAccum* voxel = accum + slot;
+
+			if( prev == VOXEL_EMPTY )
+				voxel->classID = point.classID;
+
+			atomicAdd(&voxel->pos.x, point.pos.x);
+			atomicAdd(&voxel->pos.y, point.pos.y);
+			atomicAdd(&voxel->pos.z, point.pos.z);
+
+			atomicAdd(&voxel->color[0], (uint32_t)point.color.x);
+			atomicAdd(&voxel->color[1], (uint32_t)point.color.y);
+			atomicAdd(&voxel->color[2], (uint32_t)point.color.z);
+
+			atomicAdd(&voxel->count, 1u);
+			return;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+}
+
+
+// Downsample
+bool cudaPointCloud::Downsample( float voxelSize )
+{
+	if( voxelSize <= 0.0f )
+		return Compact();
+
+	if( mNumPoints == 0 )
+		return true;
+
+	// the hash table is a power-of-two with at least 1.5x as many slots as points
+	uint32_t tableSize = 1;
+
+	while( tableSize < mNumPoints + mNumPoints / 2 )
+		tableSize *= 2;
+
+	const size_t keysSize  = tableSize * sizeof(unsigned long long);
+	const size_t accumSize = tableSize * sizeof(VoxelAccum);
+
+	if( !allocFilter(keysSize + accumSize + compactSize(tableSize)) )
+		return false;
+
+	unsigned long long* keys = (unsigned long long*)mFilterGPU;
+	VoxelAccum* accum = (VoxelAccum*)((uint8_t*)mFilterGPU + keysSize);
+	uint32_t* counts = (uint32_t*)((uint8_t*)accum + accumSize);
+
+	if( CUDA_FAILED(cudaMemset(keys, 0xFF, keysSize)) || CUDA_FAILED(cudaMemset(accum, 0, accumSize)) )
+		return false;
+
+	Vertex* points = mapPoints();
+
+	if( !points )
+		return false;
+
+	// accumulate the points into their voxels
+	gpuVoxelInsert<<<iDivUp(mNumPoints, COMPACT_BLOCK_SIZE), COMPACT_BLOCK_SIZE>>>(points, mNumPoints, 1.0f / voxelSize, keys, accum, tableSize);
+
+	// pack the centroids of the occupied voxels into the point cloud
+	// (this can write straight to the points because they were already consumed)
+	VoxelSource source;
+
+	source.keys  = keys;
+	source.accum = accum;
+
+	uint32_t numPoints = 0;
+
+	const cudaError_t result = compactPoints(source, tableSize, counts, points, &numPoints);
+	unmapPoints();
+
+	if( CUDA_FAILED(result) )
+	{
+		LogError(LOG_CUDA "cudaPointCloud::Downsample() -- failed to downsample the point cloud\n");
+		return false;
+	}
+
+	mNumPoints = numPoints;
+
+	return true;
+}
+
@@ -22,6 +22,7 @@
 
 #include "cudaPointCloud.h"
 #include "cudaMappedMemory.h"
+#include "cudaMemoryPool.h"
 
 #include "glUtility.h"
 #include "glBuffer.h"
@@ -30,6 +31,13 @@
 #include "mat33.h"
 #include "logging.h"
 
+#include "ThreadPool.h"
+#include "filesystem.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
 
 // constructor
 cudaPointCloud::cudaPointCloud()
@@ -39,26 +47,44 @@ cudaPointCloud::cudaPointCloud()
 	mBufferGL    = NULL;
 	mCameraGL    = NULL;
 	mDepthResize = NULL;
+	mFilterGPU   = NULL;
 
-	mDepthSize = 0;
+	mDepthSize  = 0;
+	mFilterSize = 0;
 	mNumPoints = 0;
 	mMaxPoints = 0;
 
+	mPointSize   = 1.0f;
+	mRenderLimit = 0;
+
 	mHasRGB         = false;
 	mHasNewPoints	 = false;
 	mHasCalibration = false;
+	mHasRegistration = false;
+	mPointsGL       = false;
+	mMappedGL       = false;
+
+	mSavesPending = 0;
 }
 
 
 // destructor
 cudaPointCloud::~cudaPointCloud()
 {
+	WaitSaves();
+
 	if( mDepthResize != NULL )
 	{
 		CUDA(cudaFree(mDepthResize));
 		mDepthResize = NULL;
 	}
 
+	if( mFilterGPU != NULL )
+	{
+		CUDA(cudaFree(mFilterGPU));
+		mFilterGPU = NULL;
+	}
+
 	if( mCameraGL != NULL )
 	{
 		delete mCameraGL;
@@ -78,9 +104,11 @@ void cudaPointCloud::Free()
 		mBufferGL = NULL;
 	}
 
+	mPointsGL = false;
+
 	if( mPointsCPU != NULL )
 	{
-		CUDA(cudaFreeHost(mPointsCPU));
+		cudaFreeMapped(mPointsCPU);
 
 		mPointsCPU = NULL;
 		mPointsGPU = NULL;
@@ -97,6 +125,7 @@ void cudaPointCloud::Clear()
 		CUDA(cudaMemset(mPointsGPU, 0, GetMaxSize()));
 
 	mNumPoints = 0;
+	mPointsGL  = false;
 }
 
 
@@ -156,6 +185,79 @@ bool cudaPointCloud::allocBufferGL()
 }
 
 
+// mapPoints
+cudaPointCloud::Vertex* cudaPointCloud::mapPoints( bool discard )
+{
+	// once the GL buffer exists, the points are kept in it (if it can be mapped)
+	if( mBufferGL != NULL && mBufferGL->GetSize() == GetMaxSize() && (discard || mPointsGL) )
+	{
+		void* ptr = mBufferGL->Map(GL_MAP_CUDA, discard ? GL_WRITE_DISCARD : GL_READ_WRITE);
+
+		if( ptr != NULL )
+		{
+			mMappedGL = true;
+			return (Vertex*)ptr;
+		}
+
+		if( !discard )
+		{
+			LogError(LOG_CUDA "cudaPointCloud -- failed to map the points from the OpenGL buffer\n");
+			return NULL;
+		}
+	}
+
+	mMappedGL = false;
+	return mPointsGPU;
+}
+
+
+// unmapPoints
+void cudaPointCloud::unmapPoints()
+{
+	if( mMappedGL )
+	{
+		mBufferGL->Unmap();
+
+		mMappedGL     = false;
+		mPointsGL     = true;
+		mHasNewPoints = false;
+	}
+	else
+	{
+		mPointsGL     = false;
+		mHasNewPoints = true;
+	}
+}
+
+
+// syncPoints
+bool cudaPointCloud::syncPoints()
+{
+	if( !mPointsGL )
+		return true;
+
+	void* ptr = mBufferGL->Map(GL_MAP_CUDA, GL_READ_ONLY);
+
+	if( !ptr )
+		return false;
+
+	CUDA(cudaMemcpy(mPointsGPU, ptr, GetSize(), cudaMemcpyDeviceToDevice));
+
+	mBufferGL->Unmap();
+	mPointsGL = false;	// the GL buffer is still up to date
+
+	return true;
+}
+
+
+// GetData
+cudaPointCloud::Vertex* cudaPointCloud::GetData()
+{
+	syncPoints();
+	return mPointsCPU;
+}
+
+
 // allocDepthResize
 bool cudaPointCloud::allocDepthResize( size_t size )
 {
@@ -179,6 +281,33 @@ bool cudaPointCloud::allocDepthResize( size_t size )
 }
 
 
+// allocFilter
+bool cudaPointCloud::allocFilter( size_t size )
+{
+	if( size == 0 )
+		return false;
+
+	if( mFilterGPU != NULL && size <= mFilterSize )
+		return true;
+
+	if( mFilterGPU != NULL )
+	{
+		CUDA(cudaFree(mFilterGPU));
+		mFilterGPU = NULL;
+	}
+
+	if( CUDA_FAILED(cudaMalloc(&mFilterGPU, size)) )
+	{
+		LogError(LOG_CUDA "cudaPointCloud -- failed to allocate %zu bytes for filtering\n", size);
+		mFilterSize = 0;
+		return false;
+	}
+
+	mFilterSize = size;
+	return true;
+}
+
+
 // Render
 bool cudaPointCloud::Render()
 {
@@ -201,7 +330,7 @@ bool cudaPointCloud::Render()
 		mCameraGL->StoreDefaults();
 	}
 
-	// copy to OpenGL if needed
+	// copy to OpenGL if needed (only when the points weren't extracted into the buffer)
 	if( mHasNewPoints )
 	{
 		void* ptr = mBufferGL->Map(GL_MAP_CUDA, GL_WRITE_DISCARD);
@@ -219,14 +348,25 @@ bool cudaPointCloud::Render()
 	mCameraGL->Activate();
 	mBufferGL->Bind();
 
+	// lower the level of detail of large clouds by skipping points
+	uint32_t stride = 1;
+
+	if( mRenderLimit > 0 && mNumPoints > mRenderLimit )
+		stride = iDivUp(mNumPoints, mRenderLimit);
+
+	const uint32_t numPoints = iDivUp(mNumPoints, stride);
+
+	GL(glPointSize(mPointSize * sqrtf((float)stride)));
+
 	GL(glEnableClientState(GL_VERTEX_ARRAY));
-	GL(glVertexPointer(3, GL_FLOAT, sizeof(Vertex), 0));
+	GL(glVertexPointer(3, GL_FLOAT, sizeof(Vertex) * stride, 0));
 
 	GL(glEnableClientState(GL_COLOR_ARRAY));
-	GL(glColorPointer(3, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, color)));
+	GL(glColorPointer(3, GL_UNSIGNED_BYTE, sizeof(Vertex) * stride, (void*)offsetof(Vertex, color)));
 
 	// draw the points
-	GL(glDrawArrays(GL_POINTS, 0, mNumPoints));
+	GL(glDrawArrays(GL_POINTS, 0, numPoints));
+	GL(glPointSize(1.0f));
 
 	// disable the buffer and camera
 	GL(glDisableClientState(GL_COLOR_ARRAY));
@@ -248,6 +388,20 @@ void cudaPointCloud::SetCalibration( const float2& focalLength, const float2& pr
 }
 
 
+// SetRegistration
+void cudaPointCloud::SetRegistration( const float2& focalLength, const float2& principalPoint, const float extrinsics[4][4] )
+{
+	mDepthFocalLength    = focalLength;
+	mDepthPrincipalPoint = principalPoint;
+
+	for( int i=0; i < 4; i++ )
+		for( int j=0; j < 4; j++ )
+			mExtrinsics[i][j] = extrinsics[i][j];
+
+	mHasRegistration = true;
+}
+
+
 // SetCalibration
 void cudaPointCloud::SetCalibration( const float K[3][3] )
 {
@@ -314,14 +468,150 @@ bool cudaPointCloud::SetCalibration( const char* filename )
 }
 
 
-// Save
-bool cudaPointCloud::Save( const char* filename )
+// number of points that are formatted by each task when saving
+#define PCD_SAVE_CHUNK 16384
+
+// a range of points that gets formatted to text in parallel
+struct pcdSaveChunk
 {
-	if( !filename || mNumPoints == 0 || !mPointsCPU )
-		return false;
+	const cudaPointCloud::Vertex* points;
+	size_t count;
+	bool rgb;
+	std::string text;
+};
+
+// formatPCD
+static void formatPCD( size_t index, void* user_param )
+{
+	pcdSaveChunk* chunk = (pcdSaveChunk*)user_param + index;
+
+	char line[128];
+	chunk->text.reserve(chunk->count * 48);
+
+	for( size_t n=0; n < chunk->count; n++ )
+	{
+		const cudaPointCloud::Vertex* point = chunk->points + n;
+		int len = 0;
+
+		// output XYZ coordinates
+		if( chunk->rgb )
+		{
+			// pack the color into 24 bits
+			const uint32_t rgb_packed = (uint32_t(point->color.x) << 16 |
+	      					         uint32_t(point->color.y) << 8 | 
+							         uint32_t(point->color.z));
+
+			len = snprintf(line, sizeof(line), "%f %f %f %u\n", point->pos.x, point->pos.y, point->pos.z, rgb_packed);
+		}
+		else
+		{
+			len = snprintf(line, sizeof(line), "%f %f %f\n", point->pos.x, point->pos.y, point->pos.z);
+		}
+
+		if( len > 0 )
+			chunk->text.append(line, std::min<size_t>(len, sizeof(line)-1));
+	}
+}
+
+
+// LZF compression (as used by binary_compressed PCD's)
+#define LZF_HASH_BITS 14
+#define LZF_MAX_LIT   32		// the longest run of literals
+#define LZF_MAX_OFF   8192		// the furthest back a match can be
+#define LZF_MAX_REF   264		// the longest match
+
+// lzfCompress (the output should be at least lzfBound() bytes)
+static size_t lzfCompress( const uint8_t* in, size_t inLen, uint8_t* out )
+{
+	std::vector<int64_t> table(1 << LZF_HASH_BITS, -1);
+
+	size_t ip  = 0;
+	size_t op  = 1;		// out[0] is the length of the first run of literals
+	size_t lit = 0;
+
+	out[0] = 0;
+
+	while( ip < inLen )
+	{
+		size_t len = 0;
+		int64_t ref = -1;
+
+		if( ip + 2 < inLen )
+		{
+			const uint32_t h = ((in[ip] << 16 | in[ip+1] << 8 | in[ip+2]) * 2654435761u) >> (32 - LZF_HASH_BITS);
+
+			ref = table[h];
+			table[h] = ip;
+
+			if( ref >= 0 && ip - ref <= LZF_MAX_OFF && memcmp(in + ref, in + ip, 3) == 0 )
+			{
+				const size_t maxLen = std::min<size_t>(LZF_MAX_REF, inLen - ip);
+
+				for( len=3; len < maxLen && in[ref+len] == in[ip+len]; len++ );
+			}
+		}
+
+		if( len == 0 )
+		{
+			// append a literal, and start a new run once this one is full
+			out[op++] = in[ip++];
+
+			if( ++lit == LZF_MAX_LIT )
+			{
+				out[op - lit - 1] = lit - 1;
+				out[op++] = 0;
+				lit = 0;
+			}
+
+			continue;
+		}
+
+		// close the run of literals (or drop it if it's empty)
+		if( lit > 0 )
+			out[op - lit - 1] = lit - 1;
+		else
+			op--;
 
-	// open the PCD file
-	FILE* file = fopen(filename, "w");
+		// encode the back-reference
+		const size_t off = ip - ref - 1;
+		const size_t l   = len - 2;
+
+		if( l < 7 )
+		{
+			out[op++] = (off >> 8) + (l << 5);
+		}
+		else
+		{
+			out[op++] = (off >> 8) + (7 << 5);
+			out[op++] = l - 7;
+		}
+
+		out[op++] = off & 0xFF;
+		out[op++] = 0;
+
+		lit = 0;
+		ip += len;
+	}
+
+	if( lit > 0 )
+		out[op - lit - 1] = lit - 1;
+	else
+		op--;
+
+	return op;
+}
+
+// lzfBound (the worst case size of incompressible data)
+static inline size_t lzfBound( size_t size )
+{
+	return size + size / LZF_MAX_LIT + 2;
+}
+
+
+// savePoints (used by Save() and SaveAsync() to write the points to disk)
+static bool savePoints( const char* filename, const cudaPointCloud::Vertex* points, uint32_t numPoints, bool rgb, cudaPointCloud::FileFormat format )
+{
+	FILE* file = fopen(filename, "wb");
 
 	if( !file )
 	{
@@ -329,59 +619,275 @@ bool cudaPointCloud::Save( const char* filename )
 		return false;
 	}
 
+	bool result = true;
+
+	// the PLY properties match the layout of the Vertex struct
+	if( format == cudaPointCloud::PLY_BINARY )
+	{
+		fprintf(file, "ply\n");
+		fprintf(file, "format binary_little_endian 1.0\n");
+		fprintf(file, "element vertex %u\n", numPoints);
+		fprintf(file, "property float x\n");
+		fprintf(file, "property float y\n");
+		fprintf(file, "property float z\n");
+		fprintf(file, "property uchar red\n");
+		fprintf(file, "property uchar green\n");
+		fprintf(file, "property uchar blue\n");
+		fprintf(file, "property uchar class\n");
+		fprintf(file, "end_header\n");
+
+		result = (fwrite(points, sizeof(cudaPointCloud::Vertex), numPoints, file) == numPoints);
+
+		fclose(file);
+		return result;
+	}
+
 	// write the PCD header
+	const char* data = "ascii";
+
+	if( format == cudaPointCloud::PCD_BINARY )
+		data = "binary";
+	else if( format == cudaPointCloud::PCD_BINARY_COMPRESSED )
+		data = "binary_compressed";
+
 	fprintf(file, "# .PCD v0.7 - Point Cloud Data file format\n");
 	fprintf(file, "VERSION 0.7\n");
 
-	if( mHasRGB )
+	if( rgb )
 	{
 		fprintf(file, "FIELDS x y z rgb\n");
 		fprintf(file, "SIZE 4 4 4 4\n");
 		fprintf(file, "TYPE F F F U\n");
+		fprintf(file, "COUNT 1 1 1 1\n");
 	}
 	else
 	{
 		fprintf(file, "FIELDS x y z\n");
 		fprintf(file, "SIZE 4 4 4\n");
 		fprintf(file, "TYPE F F F\n");
+		fprintf(file, "COUNT 1 1 1\n");
 	}
 
-	fprintf(file, "COUNT 1 1 1 1\n");
-	fprintf(file, "WIDTH %u\n", mNumPoints);
+	fprintf(file, "WIDTH %u\n", numPoints);
 	fprintf(file, "HEIGHT 1\n");
 	fprintf(file, "VIEWPOINT 0 0 0 1 0 0 0\n");
-	fprintf(file, "POINTS %u\n", mNumPoints);
-	fprintf(file, "DATA ascii\n");
-
-	// wait for the GPU to finish any processing
-	CUDA(cudaDeviceSynchronize());
+	fprintf(file, "POINTS %u\n", numPoints);
+	fprintf(file, "DATA %s\n", data);
 
-	// write out points to the PCD file
-	for( size_t n=0; n < mNumPoints; n++ )
+	if( format == cudaPointCloud::PCD_ASCII )
 	{
-		Vertex* point = GetData(n);
+		// format the points in chunks on the thread pool
+		const size_t numChunks = (numPoints + PCD_SAVE_CHUNK - 1) / PCD_SAVE_CHUNK;
+		std::vector<pcdSaveChunk> chunks(numChunks);
 
-		// output XYZ coordinates
-		fprintf(file, "%f %f %f", point->pos.x, point->pos.y, point->pos.z);
+		for( size_t n=0; n < numChunks; n++ )
+		{
+			chunks[n].points = points + n * PCD_SAVE_CHUNK;
+			chunks[n].count  = std::min<size_t>(PCD_SAVE_CHUNK, numPoints - n * PCD_SAVE_CHUNK);
+			chunks[n].rgb    = rgb;
+		}
 
-		// output RGB color
-		if( mHasRGB )
+		ThreadPool* pool = ThreadPool::Global();
+
+		if( pool != NULL )
 		{
-			// pack the color into 24 bits
-			const uint32_t rgb_packed = (uint32_t(point->color.x) << 16 |
-	      					         uint32_t(point->color.y) << 8 | 
-							         uint32_t(point->color.z));
-		
-			fprintf(file, " %u", rgb_packed);
+			pool->ParallelFor(numChunks, formatPCD, chunks.data());
+		}
+		else
+		{
+			for( size_t n=0; n < numChunks; n++ )
+				formatPCD(n, chunks.data());
 		}
 
-		fprintf(file, "\n");
+		// write out points to the PCD file in order
+		for( size_t n=0; n < numChunks && result; n++ )
+			result = (fwrite(chunks[n].text.data(), 1, chunks[n].text.size(), file) == chunks[n].text.size());
+
+		fclose(file);
+		return result;
 	}
-		
+
+	// binary PCD's have the fields of each point packed together (with the color as 0x00RRGGBB),
+	// and binary_compressed PCD's have all the points of each field together (x, then y, ect.)
+	const uint32_t numFields = rgb ? 4 : 3;
+	const size_t size = numPoints * numFields * sizeof(uint32_t);
+
+	std::vector<uint32_t> fields(numPoints * numFields);
+	const bool compressed = (format == cudaPointCloud::PCD_BINARY_COMPRESSED);
+
+	const size_t pointStride = compressed ? 1 : numFields;
+	const size_t fieldStride = compressed ? numPoints : 1;
+
+	for( uint32_t n=0; n < numPoints; n++ )
+	{
+		uint32_t* field = fields.data() + n * pointStride;
+
+		memcpy(field, &points[n].pos.x, sizeof(float));
+		memcpy(field + fieldStride, &points[n].pos.y, sizeof(float));
+		memcpy(field + fieldStride * 2, &points[n].pos.z, sizeof(float));
+
+		if( rgb )
+			field[fieldStride * 3] = uint32_t(points[n].color.x) << 16 | uint32_t(points[n].color.y) << 8 | uint32_t(points[n].color.z);
+	}
+
+	if( compressed )
+	{
+		// the compressed data is prefixed by the compressed and uncompressed sizes
+		std::vector<uint8_t> lzf(lzfBound(size));
+		const uint32_t sizes[] = { (uint32_t)lzfCompress((uint8_t*)fields.data(), size, lzf.data()), (uint32_t)size };
+
+		result = (fwrite(sizes, sizeof(sizes), 1, file) == 1) &&
+			    (fwrite(lzf.data(), 1, sizes[0], file) == sizes[0]);
+	}
+	else
+	{
+		result = (fwrite(fields.data(), 1, size, file) == size);
+	}
+
 	fclose(file);
+	return result;
+}
+
+
+// resolve the default file format from the extension
+static cudaPointCloud::FileFormat saveFormat( const char* filename, cudaPointCloud::FileFormat format )
+{
+	if( format != cudaPointCloud::FORMAT_DEFAULT )
+		return format;
+
+	if( fileHasExtension(filename, "ply") )
+		return cudaPointCloud::PLY_BINARY;
+
+	return cudaPointCloud::PCD_ASCII;
+}
+
+
+// Save
+bool cudaPointCloud::Save( const char* filename, FileFormat format )
+{
+	if( !filename || mNumPoints == 0 || !mPointsCPU )
+		return false;
+
+	if( !syncPoints() )
+		return false;
+
+	// wait for the GPU to finish any processing
+	CUDA(cudaDeviceSynchronize());
+
+	return savePoints(filename, GetData(), mNumPoints, mHasRGB, saveFormat(filename, format));
+}
+
+
+// a snapshot of the points that's written by the thread pool
+struct pcdSaveRequest
+{
+	cudaPointCloud* cloud;
+	cudaPointCloud::Vertex* points;
+	cudaPointCloud::FileFormat format;
+	cudaEvent_t event;		// recorded after the points were copied
+	std::string filename;
+	uint32_t numPoints;
+	bool rgb;
+};
+
+
+// SaveAsync
+bool cudaPointCloud::SaveAsync( const char* filename, FileFormat format )
+{
+	if( !filename || mNumPoints == 0 || !mPointsCPU )
+		return false;
+
+	if( !syncPoints() )
+		return false;
+
+	// copy the points into a snapshot that the task owns
+	pcdSaveRequest* request = new pcdSaveRequest();
+
+	request->cloud     = this;
+	request->points    = NULL;
+	request->format    = saveFormat(filename, format);
+	request->event     = NULL;
+	request->filename  = filename;
+	request->numPoints = mNumPoints;
+	request->rgb       = mHasRGB;
+
+	const size_t size = mNumPoints * sizeof(Vertex);
+
+	if( !cudaAllocMappedPooled((void**)&request->points, size) )
+	{
+		LogError(LOG_CUDA "cudaPointCloud::SaveAsync() -- failed to allocate %zu bytes to snapshot the points\n", size);
+		delete request;
+		return false;
+	}
+
+	if( CUDA_FAILED(cudaMemcpyAsync(request->points, GetData(), size, cudaMemcpyDefault, NULL)) ||
+	    CUDA_FAILED(cudaEventCreateWithFlags(&request->event, cudaEventDisableTiming)) ||
+	    CUDA_FAILED(cudaEventRecord(request->event, NULL)) )
+	{
+		LogError(LOG_CUDA "cudaPointCloud::SaveAsync() -- failed to snapshot the points for %s\n", filename);
+
+		if( request->event != NULL )
+			CUDA(cudaEventDestroy(request->event));
+
+		cudaFreePooled(request->points);
+		delete request;
+		return false;
+	}
+
+	mSaveMutex.Lock();
+	mSavesPending++;
+	mSaveMutex.Unlock();
+
+	// if the task couldn't be submitted, save it on this thread instead
+	ThreadPool* pool = ThreadPool::Global();
+
+	if( !pool || !pool->Submit(&cudaPointCloud::saveTask, request) )
+		saveTask(request);
+
 	return true;
 }
 
 
+// saveTask
+void cudaPointCloud::saveTask( void* param )
+{
+	pcdSaveRequest* request = (pcdSaveRequest*)param;
+	cudaPointCloud* cloud = request->cloud;
+
+	// wait for the copy to finish, then write the file
+	CUDA(cudaEventSynchronize(request->event));
+	CUDA(cudaEventDestroy(request->event));
+
+	if( !savePoints(request->filename.c_str(), request->points, request->numPoints, request->rgb, request->format) )
+		LogError(LOG_CUDA "cudaPointCloud::SaveAsync() -- failed to save %s\n", request->filename.c_str());
+
+	cudaFreePooled(request->points);
+	delete request;
+
+	cloud->mSaveMutex.Lock();
+	cloud->mSavesPending--;
+	cloud->mSaveMutex.Unlock();
+
+	cloud->mSaveEvent.Wake();
+}
+
+
+// WaitSaves
+void cudaPointCloud::WaitSaves()
+{
+	while( true )
+	{
+		mSaveMutex.Lock();
+		const size_t pending = mSavesPending;
+		mSaveMutex.Unlock();
+
+		if( pending == 0 )
+			break;
+
+		mSaveEvent.Wait(100);
+	}
+}
+
+
 
 
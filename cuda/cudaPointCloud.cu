@@ -21,21 +21,44 @@
  */
 
 #include "cudaPointCloud.h"
-#include "cudaColormap.h"
+#include "cudaFilterMode.cuh"
+#include "cudaDepthRegistration.h"
 
 #include "logging.h"
 
 
-// float4 to uchar3
-inline __host__ __device__ uchar3 make_uchar3( float4 a )
+// convert color pixels to uchar3
+inline __device__ uchar3 pointColor( const uchar3& a )	{ return a; }
+inline __device__ uchar3 pointColor( const uchar4& a )	{ return make_uchar3(a.x, a.y, a.z); }
+inline __device__ uchar3 pointColor( const float3& a )	{ return make_uchar3(fminf(a.x, 255.0f), fminf(a.y, 255.0f), fminf(a.z, 255.0f)); }
+inline __device__ uchar3 pointColor( const float4& a )	{ return make_uchar3(fminf(a.x, 255.0f), fminf(a.y, 255.0f), fminf(a.z, 255.0f)); }
+
+
+// convert depth samples to float
+inline __device__ float pointDepth( const float& d )		{ return d; }
+inline __device__ float pointDepth( const uint16_t& d )	{ return float(d); }
+inline __device__ float pointDepth( const __half& d )		{ return __half2float(d); }
+
+
+// reads the depth map for cudaFilterPixelReader()
+template<typename T>
+struct PointDepthReader
 {
-    return make_uchar3(fminf(a.x, 255.0f), fminf(a.y, 255.0f), fminf(a.z, 255.0f));
-}
+	T* depth;
+	int width;
+	float scale;
+
+	__device__ inline float operator()( int x, int y ) const
+	{
+		return pointDepth(depth[y * width + x]) * scale;
+	}
+};
 
 
 // gpuPointCloudExtract
-template<bool useRGB>
-__global__ void gpuPointCloudExtract( float* depth, float4* rgba, int width, int height, 
+template<typename T, typename C, bool resize>
+__global__ void gpuPointCloudExtract( PointDepthReader<T> depth, int depth_width, int depth_height,
+							   C* color, int width, int height, 
 							   float2 fx, float2 cx, cudaPointCloud::Vertex* points )
 {
 	const int x = blockIdx.x * blockDim.x + threadIdx.x;
@@ -45,8 +68,9 @@ __global__ void gpuPointCloudExtract( float* depth, float4* rgba, int width, int
 	if( x >= width || y >= height )
 		return;
 
-	// read depth map sample
-	const float depth_sample = depth[i];
+	// read depth map sample (upsampling it to the color resolution if needed)
+	const float depth_sample = resize ? cudaFilterPixelReader<FILTER_LINEAR, float>(depth, x, y, depth_width, depth_height, width, height)
+							    : depth(x, y);
 
 	// create output point
 	cudaPointCloud::Vertex point;
@@ -59,8 +83,8 @@ __global__ void gpuPointCloudExtract( float* depth, float4* rgba, int width, int
 				     	depth_sample * -1.0f);
 
 	// read RGB if needed
-	if( useRGB )
-		point.color = make_uchar3(rgba[i]);
+	if( color != NULL )
+		point.color = pointColor(color[i]);
 	else
 		point.color = make_uchar3(255,255,255);
 
@@ -69,9 +93,34 @@ __global__ void gpuPointCloudExtract( float* depth, float4* rgba, int width, int
 }
 
 
-// Extract
-bool cudaPointCloud::Extract( float* depth, uint32_t depth_width, uint32_t depth_height,
-						float4* rgba, uint32_t color_width, uint32_t color_height )
+// launchPointCloudExtract
+template<typename T, typename C>
+static cudaError_t launchPointCloudExtract( T* depth, int depth_width, int depth_height, float depth_scale,
+								    C* color, int width, int height,
+								    float2 fx, float2 cx, cudaPointCloud::Vertex* points )
+{
+	PointDepthReader<T> reader;
+
+	reader.depth = depth;
+	reader.width = depth_width;
+	reader.scale = depth_scale;
+
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+
+	if( depth_width != width || depth_height != height )
+		gpuPointCloudExtract<T, C, true><<<gridDim, blockDim>>>(reader, depth_width, depth_height, color, width, height, fx, cx, points);
+	else
+		gpuPointCloudExtract<T, C, false><<<gridDim, blockDim>>>(reader, depth_width, depth_height, color, width, height, fx, cx, points);
+
+	return cudaGetLastError();
+}
+
+
+// extract
+template<typename T>
+bool cudaPointCloud::extract( T* depth, uint32_t depth_width, uint32_t depth_height, float depth_scale,
+						void* color, uint32_t color_width, uint32_t color_height, imageFormat color_format )
 {
 	if( !depth )
 	{
@@ -79,44 +128,28 @@ bool cudaPointCloud::Extract( float* depth, uint32_t depth_width, uint32_t depth
 		return false;
 	}
 
-	if( depth_width == 0 || depth_height == 0 || color_width == 0 || color_height == 0 )
+	if( depth_width == 0 || depth_height == 0 )
 	{
 		LogError(LOG_CUDA "cudaPointCloud::Extract() -- depth width/height parameters are zero\n");
 		return false;
 	}
 
-	if( rgba != NULL && (color_width == 0 || color_height == 0) )
+	if( color != NULL && (color_width == 0 || color_height == 0) )
 	{
 		LogError(LOG_CUDA "cudaPointCloud::Extract() -- color width/height parameters are zero\n");
 		return false;
 	}
 
 	// determine if RGB used
-	if( rgba != NULL )
+	if( color != NULL )
 		mHasRGB = true;
 
-	// upsample depth if needed
-	if( mHasRGB && (depth_width != color_width || depth_height != color_height) )
-	{
-		if( !allocDepthResize(color_width * color_height * sizeof(float)) )
-			return false;
-
-		if( CUDA_FAILED(cudaColormap(depth, depth_width, depth_height,
-							    mDepthResize, color_width, color_height,
-							    make_float2(0.0f,0.0f), FORMAT_DEFAULT,
-							    IMAGE_GRAY32F, COLORMAP_NONE, FILTER_LINEAR)) ) 
-		{
-			LogError(LOG_CUDA "cudaPointCloud::Extract() -- failed to resize depth image\n");
-			return false; 
-		}
-
-		depth        = mDepthResize;
-		depth_width  = color_width;
-		depth_height = color_height;
-	}
+	// the points are extracted at the color resolution
+	const uint32_t width  = (color != NULL) ? color_width : depth_width;
+	const uint32_t height = (color != NULL) ? color_height : depth_height;
 
 	// allocate point cloud memory
-	const uint32_t numPoints = depth_width * depth_height;
+	const uint32_t numPoints = width * height;
 
 	if( !Reserve(numPoints) )
 		return false;
@@ -124,45 +157,111 @@ bool cudaPointCloud::Extract( float* depth, uint32_t depth_width, uint32_t depth
 	// default calibration if needed
 	if( !mHasCalibration )
 	{
-		const float f_w = (float)depth_width;
-		const float f_h = (float)depth_height;
+		const float f_w = (float)width;
+		const float f_h = (float)height;
 
 		mFocalLength = make_float2(f_h, f_h);
 		mPrincipalPoint = make_float2(f_w * 0.5f, f_h * 0.5f);
 	}
 
-	// launch kernel
-	const dim3 blockDim(8, 8);
-	const dim3 gridDim(iDivUp(depth_width,blockDim.x), iDivUp(depth_height,blockDim.y));
+	// register the depth to the color camera, and extract from that instead
+	// (the registered depth is in mDepthResize, so this doesn't register it again)
+	if( mHasRegistration && color != NULL && (void*)depth != (void*)mDepthResize )
+	{
+		if( !allocDepthResize(numPoints * sizeof(float)) )
+			return false;
+
+		if( CUDA_FAILED(cudaRegisterDepth(depth, depth_width, depth_height, mDepthFocalLength, mDepthPrincipalPoint, mExtrinsics,
+								    mDepthResize, width, height, mFocalLength, mPrincipalPoint, depth_scale)) )
+		{
+			LogError(LOG_CUDA "cudaPointCloud::Extract() -- failed to register the depth map to the color camera\n");
+			return false;
+		}
+
+		return extract(mDepthResize, width, height, 1.0f, color, color_width, color_height, color_format);
+	}
+
+	// get the buffer to extract into (which is the GL buffer after Render() was called)
+	Vertex* points = mapPoints(true);
 
-	if( mHasRGB )
-		gpuPointCloudExtract<true><<<gridDim, blockDim>>>(depth, rgba, depth_width, depth_height, mFocalLength, mPrincipalPoint, mPointsGPU);
+	if( !points )
+		return false;
+
+	// launch kernel
+	#define launchExtract(type) \
+		launchPointCloudExtract(depth, depth_width, depth_height, depth_scale, (type*)color, width, height, mFocalLength, mPrincipalPoint, points)
+
+	cudaError_t result = cudaSuccess;
+
+	if( color == NULL )
+		result = launchExtract(uchar3);
+	else if( color_format == IMAGE_RGB8 )
+		result = launchExtract(uchar3);
+	else if( color_format == IMAGE_RGBA8 )
+		result = launchExtract(uchar4);
+	else if( color_format == IMAGE_RGB32F )
+		result = launchExtract(float3);
+	else if( color_format == IMAGE_RGBA32F )
+		result = launchExtract(float4);
 	else
-		gpuPointCloudExtract<false><<<gridDim, blockDim>>>(depth, rgba, depth_width, depth_height, mFocalLength, mPrincipalPoint, mPointsGPU);
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaPointCloud::Extract()", color_format);
+		unmapPoints();
+		return false;
+	}
+
+	unmapPoints();
 
 	// check for launch errors
-	if( CUDA_FAILED(cudaGetLastError()) )
+	if( CUDA_FAILED(result) )
 	{
-		LogError(LOG_CUDA "cudaPointCloud::Extract() -- failed to extra point cloud with CUDA\n");
+		LogError(LOG_CUDA "cudaPointCloud::Extract() -- failed to extract point cloud with CUDA\n");
 		return false;
 	}
 	
 	mNumPoints = numPoints;
-	mHasNewPoints = true;
-
 	return true;
 }
 
 
 // Extract
-bool cudaPointCloud::Extract( float* depth, float4* rgba, uint32_t width, uint32_t height )
+bool cudaPointCloud::Extract( float* depth, uint32_t depth_width, uint32_t depth_height,
+						void* color, uint32_t color_width, uint32_t color_height,
+						imageFormat color_format, float depth_scale )
 {
-	return Extract(depth, width, height, rgba, width, height);
+	return extract(depth, depth_width, depth_height, depth_scale, color, color_width, color_height, color_format);
+}
+
+
+// Extract
+bool cudaPointCloud::Extract( uint16_t* depth, uint32_t depth_width, uint32_t depth_height,
+						void* color, uint32_t color_width, uint32_t color_height,
+						imageFormat color_format, float depth_scale )
+{
+	return extract(depth, depth_width, depth_height, depth_scale, color, color_width, color_height, color_format);
 }
 
 
+// Extract
+bool cudaPointCloud::Extract( __half* depth, uint32_t depth_width, uint32_t depth_height,
+						void* color, uint32_t color_width, uint32_t color_height,
+						imageFormat color_format, float depth_scale )
+{
+	return extract(depth, depth_width, depth_height, depth_scale, color, color_width, color_height, color_format);
+}
 
 
+// Extract
+bool cudaPointCloud::Extract( float* depth, uint32_t depth_width, uint32_t depth_height,
+						float4* rgba, uint32_t color_width, uint32_t color_height )
+{
+	return extract(depth, depth_width, depth_height, 1.0f, rgba, color_width, color_height, IMAGE_RGBA32F);
+}
 
 
+// Extract
+bool cudaPointCloud::Extract( float* depth, float4* rgba, uint32_t width, uint32_t height )
+{
+	return Extract(depth, width, height, rgba, width, height);
+}
 
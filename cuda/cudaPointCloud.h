@@ -25,6 +25,12 @@
 
 
 #include "cudaUtility.h"
+#include "imageFormat.h"
+
+#include "Event.h"
+#include "Mutex.h"
+
+#include <cuda_fp16.h>
 
 
 // forward declarations
@@ -63,6 +69,18 @@ public:
 
 	} __attribute__((packed));
 
+	/**
+	 * File formats that Save() can write.
+	 */
+	enum FileFormat
+	{
+		FORMAT_DEFAULT = 0,		/**< PLY_BINARY for .ply files, otherwise PCD_ASCII */
+		PCD_ASCII,			/**< PCD with the points formatted as text (the most compatible, but the slowest) */
+		PCD_BINARY,			/**< PCD with the points written as binary */
+		PCD_BINARY_COMPRESSED,	/**< PCD with the fields of the points stored separately and compressed with LZF */
+		PLY_BINARY			/**< little-endian binary PLY, written straight from the Vertex array */
+	};
+
 	/**
 	 * Create
 	 */
@@ -103,6 +121,63 @@ public:
 	bool Extract( float* depth, uint32_t depth_width, uint32_t depth_height,
 			    float4* rgba, uint32_t color_width, uint32_t color_height );
 
+	/**
+	 * Extract point cloud from depth map and optional color image.
+	 *
+	 * If the depth and color dimensions differ, the depth is resampled with bilinear
+	 * filtering inside the extraction kernel (no intermediate copy of the depth is made).
+	 * If SetRegistration() was called, the depth is instead registered to the color camera
+	 * with cudaRegisterDepth() first, which accounts for the offset between the sensors.
+	 *
+	 * @param depth_scale multiplier applied to the depth values
+	 * @param color_format format of the color image (rgb8, rgba8, rgb32f, or rgba32f)
+	 */
+	bool Extract( float* depth, uint32_t depth_width, uint32_t depth_height,
+			    void* color, uint32_t color_width, uint32_t color_height,
+			    imageFormat color_format, float depth_scale=1.0f );
+
+	/**
+	 * Extract point cloud from a 16-bit depth map and optional color image.
+	 * This is the layout typically produced by stereo and ToF sensors, where
+	 * for example a `depth_scale` of 0.001 converts millimeters to meters.
+	 *
+	 * @param depth_scale multiplier applied to the depth values
+	 * @param color_format format of the color image (rgb8, rgba8, rgb32f, or rgba32f)
+	 */
+	bool Extract( uint16_t* depth, uint32_t depth_width, uint32_t depth_height,
+			    void* color, uint32_t color_width, uint32_t color_height,
+			    imageFormat color_format, float depth_scale=0.001f );
+
+	/**
+	 * Extract point cloud from a half-precision depth map and optional color image.
+	 *
+	 * @param depth_scale multiplier applied to the depth values
+	 * @param color_format format of the color image (rgb8, rgba8, rgb32f, or rgba32f)
+	 */
+	bool Extract( __half* depth, uint32_t depth_width, uint32_t depth_height,
+			    void* color, uint32_t color_width, uint32_t color_height,
+			    imageFormat color_format, float depth_scale=1.0f );
+
+	/**
+	 * Remove the points that have invalid depth (zero, negative, or non-finite)
+	 * and pack the remaining points densely at the start of the array.
+	 *
+	 * The compaction uses a prefix sum over the points (instead of an atomic counter),
+	 * so it's deterministic and preserves the order of the points.  Afterwards,
+	 * GetNumPoints() returns the number of valid points.
+	 */
+	bool Compact();
+
+	/**
+	 * Downsample the point cloud with a voxel grid, replacing the points in each
+	 * voxel by their centroid (with the average color).  Points with invalid depth
+	 * are dropped, and the output points are packed densely in device memory.
+	 *
+	 * @param voxelSize the size of the voxels along each axis (in the units of the depth).
+	 *                  If it's zero or negative, this is the same as calling Compact().
+	 */
+	bool Downsample( float voxelSize );
+
 	/**
 	 * Retrieve the number of points being used.
 	 */
@@ -125,13 +200,17 @@ public:
 
 	/**
 	 * Retrieve memory pointer to point cloud data.
+	 *
+	 * @note after Render() has been called, the points get extracted straight
+	 *       into the OpenGL vertex buffer, in which case GetData() first copies
+	 *       them back into the point cloud's memory.
 	 */
-	inline Vertex* GetData() const			{ return mPointsCPU; }
+	Vertex* GetData();
 
 	/**
 	 * Retrieve memory pointer to a specific point.
 	 */
-	inline Vertex* GetData( size_t index ) const	{ return mPointsCPU + index; }
+	inline Vertex* GetData( size_t index )		{ return GetData() + index; }
  
 	/**
 	 * Does the point cloud have RGB data?
@@ -140,13 +219,61 @@ public:
 
 	/**
 	 * Render the point cloud with OpenGL
+	 *
+	 * The first call creates a vertex buffer that's registered with CUDA,
+	 * and afterwards Extract(), Compact() and Downsample() operate directly on
+	 * the vertex buffer (so these should then be called from the thread that
+	 * has the OpenGL context).  This avoids copying the points every frame.
 	 */
 	bool Render();
 
 	/**
-	 * Save point cloud to PCD file.
+	 * Set the size of the points (in pixels) when rendering, the default is 1.
+	 */
+	inline void SetPointSize( float size )			{ mPointSize = size; }
+
+	/**
+	 * Set the maximum number of points that Render() draws (or 0 for no limit).
+	 *
+	 * Clouds with more points are drawn at a lower level of detail, using every
+	 * Nth point with the point size increased by sqrt(N) to cover the same area.
 	 */
-	bool Save( const char* filename );
+	inline void SetRenderLimit( uint32_t maxPoints )	{ mRenderLimit = maxPoints; }
+
+	/**
+	 * Retrieve the size of the points when rendering.
+	 */
+	inline float GetPointSize() const				{ return mPointSize; }
+
+	/**
+	 * Retrieve the maximum number of points that Render() draws (0 for no limit).
+	 */
+	inline uint32_t GetRenderLimit() const			{ return mRenderLimit; }
+
+	/**
+	 * Save point cloud to a PCD or PLY file.
+	 *
+	 * The binary formats are written with one fwrite() for the whole cloud, which is much
+	 * faster than formatting each point as text with PCD_ASCII (the default for .pcd files).
+	 */
+	bool Save( const char* filename, FileFormat format=FORMAT_DEFAULT );
+
+	/**
+	 * Save point cloud to a PCD or PLY file in the background.
+	 *
+	 * The points are copied into a snapshot (with an async memcpy on the GPU), and written
+	 * to disk by the thread pool, so the point cloud can be modified again right away.
+	 * Errors that occur while writing the file are logged.
+	 *
+	 * @returns false if the snapshot couldn't be made, otherwise true.
+	 * @see WaitSaves() to wait until the files are done being written.
+	 */
+	bool SaveAsync( const char* filename, FileFormat format=FORMAT_DEFAULT );
+
+	/**
+	 * Wait until the files queued with SaveAsync() have been written.
+	 */
+	void WaitSaves();
 
 	/**
 	 * Set the intrinsic camera calibration.
@@ -163,11 +290,40 @@ public:
 	 */
 	void SetCalibration( const float2& focalLength, const float2& principalPoint );
 
+	/**
+	 * Set the calibration of a depth camera that's offset from the color camera, so that
+	 * Extract() registers the depth map to the color camera (see cudaRegisterDepth()) before
+	 * extracting the points.  SetCalibration() should then be set to the color intrinsics,
+	 * and the points are in the coordinate frame of the color camera.
+	 *
+	 * @param focalLength the focal length of the depth camera (fx, fy) in pixels
+	 * @param principalPoint the principal point of the depth camera (cx, cy) in pixels
+	 * @param extrinsics the 4x4 rigid transform from the depth to the color camera coordinates
+	 *                   (row-major, with the translation in the last column, in the units of the depth)
+	 */
+	void SetRegistration( const float2& focalLength, const float2& principalPoint, const float extrinsics[4][4] );
+
+	/**
+	 * Disable depth registration, so that Extract() resizes the depth map to the color resolution.
+	 */
+	inline void ClearRegistration()				{ mHasRegistration = false; }
+
 protected:
 	cudaPointCloud();
 
 	bool allocBufferGL();
 	bool allocDepthResize( size_t size );
+	bool allocFilter( size_t size );
+
+	Vertex* mapPoints( bool discard=false );
+	void    unmapPoints();
+	bool    syncPoints();
+
+	static void saveTask( void* param );
+
+	template<typename T>
+	bool extract( T* depth, uint32_t depth_width, uint32_t depth_height, float depth_scale,
+			    void* color, uint32_t color_width, uint32_t color_height, imageFormat color_format );
 	
 	Vertex* mPointsCPU;
 	Vertex* mPointsGPU;
@@ -181,12 +337,29 @@ protected:
 	float2 mFocalLength;
 	float2 mPrincipalPoint;
 
+	float2 mDepthFocalLength;
+	float2 mDepthPrincipalPoint;
+	float  mExtrinsics[4][4];
+
 	float* mDepthResize;
 	size_t mDepthSize;
 
+	void*  mFilterGPU;
+	size_t mFilterSize;
+
+	float    mPointSize;
+	uint32_t mRenderLimit;
+
 	bool mHasRGB;
-	bool mHasNewPoints;
+	bool mHasNewPoints;	// the GL buffer is out of date
 	bool mHasCalibration;
+	bool mHasRegistration;
+	bool mPointsGL;	// the latest points are only in the GL buffer
+	bool mMappedGL;
+
+	size_t mSavesPending;	// SaveAsync() requests that haven't been written yet
+	Mutex  mSaveMutex;
+	Event  mSaveEvent;		// raised when a request has been written
 };
 
 #endif
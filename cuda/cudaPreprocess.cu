@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaPreprocess.h"
+#include "cudaFilterMode.cuh"
+#include "cudaNVTX.h"
+
+
+//-----------------------------------------------------------------------------------
+// Pixel readers - each one returns the RGB value of an input pixel in [0,255]
+//-----------------------------------------------------------------------------------
+static inline __device__ float clamp( float x )	{ return fminf(fmaxf(x, 0.0f), 255.0f); }
+
+// YUVToRGB (same BT.601 coefficients as cudaYUV)
+static inline __device__ float3 YUVToRGB( float y, float u, float v )
+{
+	u -= 128.0f;
+	v -= 128.0f;
+
+	return make_float3(clamp(y + 1.402f * v),
+				    clamp(y - 0.344f * u - 0.714f * v),
+				    clamp(y + 1.772f * u));
+}
+
+// packed RGB/BGR/RGBA/BGRA (uchar3, uchar4, float3, float4)
+template<typename T, bool bgr>
+struct PreprocessReaderRGB
+{
+	T*  ptr;
+	int width;
+
+	__device__ inline float3 operator()( int x, int y ) const
+	{
+		const float3 px = make_float3(ptr[y * width + x]);
+		return bgr ? make_float3(px.z, px.y, px.x) : px;
+	}
+};
+
+// NV12 (luma plane followed by interleaved UV plane)
+struct PreprocessReaderNV12
+{
+	uint8_t* luma;
+	uint8_t* chroma;
+	int      width;
+
+	__device__ inline float3 operator()( int x, int y ) const
+	{
+		const int uv = (y >> 1) * width + (x & ~1);
+		return YUVToRGB(luma[y * width + x], chroma[uv], chroma[uv + 1]);
+	}
+};
+
+// I420/YV12 (luma plane followed by separate U and V planes)
+struct PreprocessReaderI420
+{
+	uint8_t* luma;
+	uint8_t* u;
+	uint8_t* v;
+	int      width;
+
+	__device__ inline float3 operator()( int x, int y ) const
+	{
+		const int uv = (y >> 1) * (width >> 1) + (x >> 1);
+		return YUVToRGB(luma[y * width + x], u[uv], v[uv]);
+	}
+};
+
+// YUYV/YVYU/UYVY (packed 4:2:2, two pixels per 4-byte macropixel)
+template<int lumaOffset, int uOffset, int vOffset>
+struct PreprocessReaderYUV422
+{
+	uint8_t* ptr;
+	int      width;
+
+	__device__ inline float3 operator()( int x, int y ) const
+	{
+		const uint8_t* macropixel = ptr + (y * width + (x & ~1)) * 2;
+		return YUVToRGB(macropixel[lumaOffset + (x & 1) * 2], macropixel[uOffset], macropixel[vOffset]);
+	}
+};
+
+
+static inline __device__ void preprocessStore( float* output, float value )	{ *output = value; }
+static inline __device__ void preprocessStore( __half* output, float value )	{ *output = __float2half(value); }
+
+
+// gpuPreprocess
+template<typename T, cudaFilterMode filter, typename Reader>
+__global__ void gpuPreprocess( Reader reader, int inputWidth, int inputHeight, 
+						 T* output, int outputWidth, int outputHeight, 
+						 float3 multiplier, float3 offset )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const float3 px = cudaFilterPixelReader<filter, float3>(reader, x, y, inputWidth, inputHeight, outputWidth, outputHeight) * multiplier + offset;
+
+	const int n = outputWidth * outputHeight;
+	const int m = y * outputWidth + x;
+
+	preprocessStore(output + m, px.x);
+	preprocessStore(output + n + m, px.y);
+	preprocessStore(output + n * 2 + m, px.z);
+}
+
+// launchPreprocess
+template<typename T, typename Reader>
+static cudaError_t launchPreprocess( const Reader& reader, size_t inputWidth, size_t inputHeight,
+							  T* output, size_t outputWidth, size_t outputHeight,
+							  const float3& multiplier, const float3& offset,
+							  cudaFilterMode filter, cudaStream_t stream )
+{
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+	#define launch_preprocess(filterMode)	\
+		gpuPreprocess<T, filterMode, Reader><<<gridDim, blockDim, 0, stream>>>(reader, inputWidth, inputHeight, output, outputWidth, outputHeight, multiplier, offset)
+
+	if( filter == FILTER_POINT )
+		launch_preprocess(FILTER_POINT);
+	else if( filter == FILTER_LINEAR )
+		launch_preprocess(FILTER_LINEAR);
+	else if( filter == FILTER_AREA )
+		launch_preprocess(FILTER_AREA);
+	else
+		return cudaErrorInvalidValue;
+
+	return CUDA(cudaGetLastError());
+}
+
+// preprocessNormalization
+static cudaError_t preprocessNormalization( const float2& range, const float3& mean, const float3& stdDev, 
+								    float3& multiplier, float3& offset )
+{
+	if( stdDev.x == 0.0f || stdDev.y == 0.0f || stdDev.z == 0.0f )
+	{
+		LogError(LOG_CUDA "cudaPreprocess() -- stdDev must be non-zero\n");
+		return cudaErrorInvalidValue;
+	}
+
+	// fold the range scaling and mean/stdDev normalization into a single multiply-add
+	const float s = (range.y - range.x) / 255.0f;
+
+	multiplier = make_float3(s / stdDev.x, s / stdDev.y, s / stdDev.z);
+	offset = make_float3((range.x - mean.x) / stdDev.x,
+					 (range.x - mean.y) / stdDev.y,
+					 (range.x - mean.z) / stdDev.z);
+
+	return cudaSuccess;
+}
+
+// preprocessFormatError
+static cudaError_t preprocessFormatError( const char* function, imageFormat format )
+{
+	LogError(LOG_CUDA "%s() -- invalid input image format '%s'\n", function, imageFormatToStr(format));
+	LogError(LOG_CUDA "                    supported formats are:\n");
+	LogError(LOG_CUDA "                       * rgb8, bgr8\n");
+	LogError(LOG_CUDA "                       * rgba8, bgra8\n");
+	LogError(LOG_CUDA "                       * rgb32f, bgr32f\n");
+	LogError(LOG_CUDA "                       * rgba32f, bgra32f\n");
+	LogError(LOG_CUDA "                       * nv12, i420, yv12\n");
+	LogError(LOG_CUDA "                       * yuyv, yvyu, uyvy\n");
+
+	return cudaErrorInvalidValue;
+}
+
+// launchPreprocess
+template<typename T>
+static cudaError_t launchPreprocess( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+							  T* output, size_t outputWidth, size_t outputHeight,
+							  const float2& range, const float3& mean, const float3& stdDev,
+							  cudaFilterMode filter, cudaStream_t stream )
+{
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || outputWidth == 0 || inputHeight == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	float3 multiplier;
+	float3 offset;
+
+	const cudaError_t result = preprocessNormalization(range, mean, stdDev, multiplier, offset);
+
+	if( result != cudaSuccess )
+		return result;
+
+	#define preprocess(reader) \
+		launchPreprocess<T>(reader, inputWidth, inputHeight, output, outputWidth, outputHeight, multiplier, offset, filter, stream)
+
+	const int width = inputWidth;
+	uint8_t* luma = (uint8_t*)input;
+
+	if( format == IMAGE_RGB8 )
+		return preprocess((PreprocessReaderRGB<uchar3, false>{(uchar3*)input, width}));
+	else if( format == IMAGE_BGR8 )
+		return preprocess((PreprocessReaderRGB<uchar3, true>{(uchar3*)input, width}));
+	else if( format == IMAGE_RGBA8 )
+		return preprocess((PreprocessReaderRGB<uchar4, false>{(uchar4*)input, width}));
+	else if( format == IMAGE_BGRA8 )
+		return preprocess((PreprocessReaderRGB<uchar4, true>{(uchar4*)input, width}));
+	else if( format == IMAGE_RGB32F )
+		return preprocess((PreprocessReaderRGB<float3, false>{(float3*)input, width}));
+	else if( format == IMAGE_BGR32F )
+		return preprocess((PreprocessReaderRGB<float3, true>{(float3*)input, width}));
+	else if( format == IMAGE_RGBA32F )
+		return preprocess((PreprocessReaderRGB<float4, false>{(float4*)input, width}));
+	else if( format == IMAGE_BGRA32F )
+		return preprocess((PreprocessReaderRGB<float4, true>{(float4*)input, width}));
+	else if( format == IMAGE_NV12 )
+		return preprocess((PreprocessReaderNV12{luma, luma + inputWidth * inputHeight, width}));
+	else if( format == IMAGE_I420 || format == IMAGE_YV12 )
+	{
+		uint8_t* u = luma + inputWidth * inputHeight;
+		uint8_t* v = u + (inputWidth / 2) * (inputHeight / 2);
+
+		if( format == IMAGE_YV12 )
+		{
+			uint8_t* tmp = u;
+			u = v;
+			v = tmp;
+		}
+
+		return preprocess((PreprocessReaderI420{luma, u, v, width}));
+	}
+	else if( format == IMAGE_YUYV )
+		return preprocess((PreprocessReaderYUV422<0, 1, 3>{luma, width}));
+	else if( format == IMAGE_YVYU )
+		return preprocess((PreprocessReaderYUV422<0, 3, 1>{luma, width}));
+	else if( format == IMAGE_UYVY )
+		return preprocess((PreprocessReaderYUV422<1, 0, 2>{luma, width}));
+
+	return preprocessFormatError("cudaPreprocess", format);
+}
+
+// cudaPreprocess (float)
+cudaError_t cudaPreprocess( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+				        float* output, size_t outputWidth, size_t outputHeight,
+				        const float2& range, const float3& mean, const float3& stdDev,
+				        cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaPreprocess");
+
+	return launchPreprocess<float>(input, inputWidth, inputHeight, format, output, outputWidth, outputHeight, range, mean, stdDev, filter, stream);
+}
+
+// cudaPreprocess (half)
+cudaError_t cudaPreprocess( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+				        __half* output, size_t outputWidth, size_t outputHeight,
+				        const float2& range, const float3& mean, const float3& stdDev,
+				        cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaPreprocess");
+
+	return launchPreprocess<__half>(input, inputWidth, inputHeight, format, output, outputWidth, outputHeight, range, mean, stdDev, filter, stream);
+}
+
+
+
+//-----------------------------------------------------------------------------------
+// Batched pre-processing - one launch for the whole batch, with blockIdx.z selecting
+// the input image and the output tensor that it gets written to
+//-----------------------------------------------------------------------------------
+template<typename Reader>
+struct PreprocessBatch
+{
+	Reader readers[CUDA_PREPROCESS_MAX_BATCH];
+	int    widths[CUDA_PREPROCESS_MAX_BATCH];
+	int    heights[CUDA_PREPROCESS_MAX_BATCH];
+};
+
+// gpuPreprocessBatch
+template<typename T, cudaFilterMode filter, typename Reader>
+__global__ void gpuPreprocessBatch( PreprocessBatch<Reader> batch, T* output, int outputWidth, int outputHeight, 
+							 float3 multiplier, float3 offset )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+	const int z = blockIdx.z;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const float3 px = cudaFilterPixelReader<filter, float3>(batch.readers[z], x, y, batch.widths[z], batch.heights[z], outputWidth, outputHeight) * multiplier + offset;
+
+	const int n = outputWidth * outputHeight;
+	const int m = y * outputWidth + x;
+
+	output += n * 3 * z;
+
+	preprocessStore(output + m, px.x);
+	preprocessStore(output + n + m, px.y);
+	preprocessStore(output + n * 2 + m, px.z);
+}
+
+// launchPreprocessBatch
+template<typename T, typename Reader>
+static cudaError_t launchPreprocessBatch( const PreprocessBatch<Reader>& batch, uint32_t batchSize,
+								  T* output, size_t outputWidth, size_t outputHeight,
+								  const float3& multiplier, const float3& offset,
+								  cudaFilterMode filter, cudaStream_t stream )
+{
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y), batchSize);
+
+	#define launch_preprocess_batch(filterMode)	\
+		gpuPreprocessBatch<T, filterMode, Reader><<<gridDim, blockDim, 0, stream>>>(batch, output, outputWidth, outputHeight, multiplier, offset)
+
+	if( filter == FILTER_POINT )
+		launch_preprocess_batch(FILTER_POINT);
+	else if( filter == FILTER_LINEAR )
+		launch_preprocess_batch(FILTER_LINEAR);
+	else if( filter == FILTER_AREA )
+		launch_preprocess_batch(FILTER_AREA);
+	else
+		return cudaErrorInvalidValue;
+
+	return CUDA(cudaGetLastError());
+}
+
+// reader types (the template commas would otherwise split the macro arguments below)
+typedef PreprocessReaderRGB<uchar3, false> PreprocessReaderRGB8;
+typedef PreprocessReaderRGB<uchar3, true>  PreprocessReaderBGR8;
+typedef PreprocessReaderRGB<uchar4, false> PreprocessReaderRGBA8;
+typedef PreprocessReaderRGB<uchar4, true>  PreprocessReaderBGRA8;
+typedef PreprocessReaderRGB<float3, false> PreprocessReaderRGB32F;
+typedef PreprocessReaderRGB<float3, true>  PreprocessReaderBGR32F;
+typedef PreprocessReaderRGB<float4, false> PreprocessReaderRGBA32F;
+typedef PreprocessReaderRGB<float4, true>  PreprocessReaderBGRA32F;
+typedef PreprocessReaderYUV422<0, 1, 3>    PreprocessReaderYUYV;
+typedef PreprocessReaderYUV422<0, 3, 1>    PreprocessReaderYVYU;
+typedef PreprocessReaderYUV422<1, 0, 2>    PreprocessReaderUYVY;
+
+// launchPreprocessBatch
+template<typename T>
+static cudaError_t launchPreprocessBatch( const cudaPreprocessImage* inputs, uint32_t batchSize, imageFormat format,
+								  T* output, size_t outputWidth, size_t outputHeight,
+								  const float2& range, const float3& mean, const float3& stdDev,
+								  cudaFilterMode filter, cudaStream_t stream )
+{
+	if( !inputs || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( batchSize == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( batchSize > CUDA_PREPROCESS_MAX_BATCH )
+	{
+		LogError(LOG_CUDA "cudaPreprocessBatch() -- batch size of %u exceeds the maximum (CUDA_PREPROCESS_MAX_BATCH=%i)\n", batchSize, CUDA_PREPROCESS_MAX_BATCH);
+		return cudaErrorInvalidValue;
+	}
+
+	for( uint32_t n=0; n < batchSize; n++ )
+	{
+		if( !inputs[n].image )
+			return cudaErrorInvalidDevicePointer;
+
+		if( inputs[n].width == 0 || inputs[n].height == 0 )
+			return cudaErrorInvalidValue;
+	}
+
+	float3 multiplier;
+	float3 offset;
+
+	const cudaError_t result = preprocessNormalization(range, mean, stdDev, multiplier, offset);
+
+	if( result != cudaSuccess )
+		return result;
+
+	#define preprocess_batch(Reader, ...) \
+	{ \
+		PreprocessBatch<Reader> batch; \
+		for( uint32_t n=0; n < batchSize; n++ ) \
+		{ \
+			const int width = inputs[n].width; \
+			const int height = inputs[n].height; \
+			uint8_t* luma = (uint8_t*)inputs[n].image; \
+			uint8_t* u = luma + width * height; \
+			uint8_t* v = u + (width / 2) * (height / 2); \
+			if( format == IMAGE_YV12 ) { uint8_t* tmp = u; u = v; v = tmp; } \
+			batch.readers[n] = Reader{__VA_ARGS__}; \
+			batch.widths[n]  = width; \
+			batch.heights[n] = height; \
+		} \
+		return launchPreprocessBatch<T, Reader>(batch, batchSize, output, outputWidth, outputHeight, multiplier, offset, filter, stream); \
+	}
+
+	if( format == IMAGE_RGB8 )
+		preprocess_batch(PreprocessReaderRGB8, (uchar3*)luma, width)
+	else if( format == IMAGE_BGR8 )
+		preprocess_batch(PreprocessReaderBGR8, (uchar3*)luma, width)
+	else if( format == IMAGE_RGBA8 )
+		preprocess_batch(PreprocessReaderRGBA8, (uchar4*)luma, width)
+	else if( format == IMAGE_BGRA8 )
+		preprocess_batch(PreprocessReaderBGRA8, (uchar4*)luma, width)
+	else if( format == IMAGE_RGB32F )
+		preprocess_batch(PreprocessReaderRGB32F, (float3*)luma, width)
+	else if( format == IMAGE_BGR32F )
+		preprocess_batch(PreprocessReaderBGR32F, (float3*)luma, width)
+	else if( format == IMAGE_RGBA32F )
+		preprocess_batch(PreprocessReaderRGBA32F, (float4*)luma, width)
+	else if( format == IMAGE_BGRA32F )
+		preprocess_batch(PreprocessReaderBGRA32F, (float4*)luma, width)
+	else if( format == IMAGE_NV12 )
+		preprocess_batch(PreprocessReaderNV12, luma, u, width)
+	else if( format == IMAGE_I420 || format == IMAGE_YV12 )
+		preprocess_batch(PreprocessReaderI420, luma, u, v, width)
+	else if( format == IMAGE_YUYV )
+		preprocess_batch(PreprocessReaderYUYV, luma, width)
+	else if( format == IMAGE_YVYU )
+		preprocess_batch(PreprocessReaderYVYU, luma, width)
+	else if( format == IMAGE_UYVY )
+		preprocess_batch(PreprocessReaderUYVY, luma, width)
+
+	return preprocessFormatError("cudaPreprocessBatch", format);
+}
+
+// cudaPreprocessBatch (float)
+cudaError_t cudaPreprocessBatch( const cudaPreprocessImage* inputs, uint32_t batchSize, imageFormat format,
+					        float* output, size_t outputWidth, size_t outputHeight,
+					        const float2& range, const float3& mean, const float3& stdDev,
+					        cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaPreprocessBatch");
+
+	return launchPreprocessBatch<float>(inputs, batchSize, format, output, outputWidth, outputHeight, range, mean, stdDev, filter, stream);
+}
+
+// cudaPreprocessBatch (half)
+cudaError_t cudaPreprocessBatch( const cudaPreprocessImage* inputs, uint32_t batchSize, imageFormat format,
+					        __half* output, size_t outputWidth, size_t outputHeight,
+					        const float2& range, const float3& mean, const float3& stdDev,
+					        cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaPreprocessBatch");
+
+	return launchPreprocessBatch<__half>(inputs, batchSize, format, output, outputWidth, outputHeight, range, mean, stdDev, filter, stream);
+}
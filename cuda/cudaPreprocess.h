@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_PREPROCESS_H__
+#define __CUDA_PREPROCESS_H__
+
+
+#include "cudaUtility.h"
+#include "cudaFilterMode.h"
+#include "imageFormat.h"
+
+#include <cuda_fp16.h>
+
+
+/**
+ * Fused DNN pre-processing:  colorspace conversion, resizing, normalization and
+ * HWC->CHW re-ordering in a single kernel, without any intermediate buffers.
+ *
+ * The input image is sampled directly in its native format (including YUV), rescaled
+ * to the output size with the requested filter, and each RGB channel is normalized as
+ * `((pixel / 255) * (range.y - range.x) + range.x - mean) / stdDev` before being
+ * written to a planar RGB tensor (NCHW with N=1) of `outputWidth * outputHeight * 3`.
+ *
+ * For example, the common ImageNet normalization is `range=[0,1]`,
+ * `mean=(0.485, 0.456, 0.406)` and `stdDev=(0.229, 0.224, 0.225)`.
+ *
+ * Supported input formats are rgb8, bgr8, rgba8, bgra8, rgb32f, bgr32f, rgba32f,
+ * bgra32f, nv12, i420, yv12, yuyv, yvyu and uyvy.  Floating-point inputs are
+ * expected to be in the range `[0,255]`.
+ *
+ * @param input input image in CUDA device memory
+ * @param inputWidth width of the input image (in pixels)
+ * @param inputHeight height of the input image (in pixels)
+ * @param format format of the input image
+ * @param output planar RGB output tensor in CUDA device memory
+ * @param outputWidth width of the output tensor (in pixels)
+ * @param outputHeight height of the output tensor (in pixels)
+ * @param range the range the pixel values are first scaled to (e.g. `[0,1]`)
+ * @param mean the per-channel mean that gets subtracted (in RGB order)
+ * @param stdDev the per-channel standard deviation that gets divided by (in RGB order)
+ * @param filter the filtering mode used for resizing (FILTER_AREA is recommended for large downscales)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
+ * @ingroup normalization
+ */
+cudaError_t cudaPreprocess( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+				        float* output, size_t outputWidth, size_t outputHeight,
+				        const float2& range=make_float2(0,1),
+				        const float3& mean=make_float3(0,0,0),
+				        const float3& stdDev=make_float3(1,1,1),
+				        cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+/**
+ * Fused DNN pre-processing with FP16 output.
+ * @see cudaPreprocess() for a description of the parameters.
+ * @ingroup normalization
+ */
+cudaError_t cudaPreprocess( void* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+				        __half* output, size_t outputWidth, size_t outputHeight,
+				        const float2& range=make_float2(0,1),
+				        const float3& mean=make_float3(0,0,0),
+				        const float3& stdDev=make_float3(1,1,1),
+				        cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+
+/**
+ * The maximum number of images that cudaPreprocessBatch() can process in one launch.
+ * @ingroup normalization
+ */
+#define CUDA_PREPROCESS_MAX_BATCH 16
+
+/**
+ * Input image descriptor for cudaPreprocessBatch().
+ * @ingroup normalization
+ */
+struct cudaPreprocessImage
+{
+	void*    image;		/**< Pointer to the image in CUDA device memory */
+	uint32_t width;		/**< Width of the image (in pixels) */
+	uint32_t height;		/**< Height of the image (in pixels) */
+};
+
+/**
+ * Fused DNN pre-processing of a batch of images into one contiguous planar tensor
+ * (NCHW with N=batchSize), using a single kernel launch for the whole batch.
+ *
+ * The input images may each have a different size, but they must all share the same
+ * format.  Image `n` of the batch gets written to `output + n * outputWidth * outputHeight * 3`.
+ * Up to CUDA_PREPROCESS_MAX_BATCH images can be processed per call.
+ *
+ * @see cudaPreprocess() for a description of the other parameters and the supported formats.
+ * @ingroup normalization
+ */
+cudaError_t cudaPreprocessBatch( const cudaPreprocessImage* inputs, uint32_t batchSize, imageFormat format,
+					        float* output, size_t outputWidth, size_t outputHeight,
+					        const float2& range=make_float2(0,1),
+					        const float3& mean=make_float3(0,0,0),
+					        const float3& stdDev=make_float3(1,1,1),
+					        cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+/**
+ * Fused DNN pre-processing of a batch of images with FP16 output.
+ * @see cudaPreprocessBatch() for a description of the parameters.
+ * @ingroup normalization
+ */
+cudaError_t cudaPreprocessBatch( const cudaPreprocessImage* inputs, uint32_t batchSize, imageFormat format,
+					        __half* output, size_t outputWidth, size_t outputHeight,
+					        const float2& range=make_float2(0,1),
+					        const float3& mean=make_float3(0,0,0),
+					        const float3& stdDev=make_float3(1,1,1),
+					        cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+
+#endif
+
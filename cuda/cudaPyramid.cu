@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaPyramid.h"
+#include "cudaFilterMode.cuh"
+#include "cudaMappedMemory.h"
+#include "cudaNVTX.h"
+
+
+#define PYRAMID_TILE  8						// output pixels per block side
+#define PYRAMID_MID   (PYRAMID_TILE * 2 + 4)		// middle-level pixels per block side (with a halo of 2)
+#define PYRAMID_ROWS  (PYRAMID_MID * 2 + 4)		// input rows per block (with a halo of 2)
+#define PYRAMID_ALIGN 512						// alignment of each level in the allocation
+
+
+// the 5-tap Gaussian [1 4 6 4 1] / 16
+#define PYRAMID_WEIGHTS { 0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f }
+
+
+// gpuPyramidDown (filters and decimates one level)
+template<typename T>
+__global__ void gpuPyramidDown( T* input, int width, int height, T* output, int outputWidth, int outputHeight )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const float w[5] = PYRAMID_WEIGHTS;
+	A sum = A();
+
+	#pragma unroll
+	for( int j=0; j < 5; j++ )
+	{
+		const int iy = clamp(y * 2 + j - 2, 0, height - 1);
+		A row = A();
+
+		#pragma unroll
+		for( int i=0; i < 5; i++ )
+			row += cudaFilterAccum<T>::load(input[iy * width + clamp(x * 2 + i - 2, 0, width - 1)]) * w[i];
+
+		sum += row * w[j];
+	}
+
+	output[y * outputWidth + x] = cudaFilterAccum<T>::store(sum);
+}
+
+
+// gpuPyramidDown2 (filters and decimates two levels, keeping the middle one in shared memory)
+template<typename T>
+__global__ void gpuPyramidDown2( T* input, int width, int height,
+						   T* middle, int middleWidth, int middleHeight,
+						   T* output, int outputWidth, int outputHeight )
+{
+	typedef typename cudaFilterAccum<T>::Type A;
+
+	__shared__ A rows[PYRAMID_ROWS][PYRAMID_MID];	// input rows, filtered horizontally
+	__shared__ A tile[PYRAMID_MID][PYRAMID_MID];		// middle level
+	__shared__ A cols[PYRAMID_MID][PYRAMID_TILE];	// middle level, filtered horizontally
+
+	const float w[5] = PYRAMID_WEIGHTS;
+
+	const int thread = threadIdx.y * blockDim.x + threadIdx.x;
+	const int threads = blockDim.x * blockDim.y;
+
+	// origins of the block in each level (the tiles start 2 pixels early for the halo)
+	const int ox = blockIdx.x * PYRAMID_TILE;
+	const int oy = blockIdx.y * PYRAMID_TILE;
+	const int mx = ox * 2 - 2;
+	const int my = oy * 2 - 2;
+	const int iy = my * 2 - 2;
+
+	// filter the input rows horizontally, at the (clamped) columns of the middle tile
+	for( int n=thread; n < PYRAMID_ROWS * PYRAMID_MID; n += threads )
+	{
+		const int r = n / PYRAMID_MID;
+		const int c = n % PYRAMID_MID;
+
+		const int y = clamp(iy + r, 0, height - 1);
+		const int x = clamp(mx + c, 0, middleWidth - 1) * 2 - 2;
+
+		A sum = A();
+
+		#pragma unroll
+		for( int i=0; i < 5; i++ )
+			sum += cudaFilterAccum<T>::load(input[y * width + clamp(x + i, 0, width - 1)]) * w[i];
+
+		rows[r][c] = sum;
+	}
+
+	__syncthreads();
+
+	// filter vertically into the middle tile, and write out the part that this block owns
+	for( int n=thread; n < PYRAMID_MID * PYRAMID_MID; n += threads )
+	{
+		const int r = n / PYRAMID_MID;
+		const int c = n % PYRAMID_MID;
+
+		// the halo rows past the edges are copies of the edge rows
+		const int rr = clamp(my + r, 0, middleHeight - 1) - my;
+
+		A sum = A();
+
+		#pragma unroll
+		for( int j=0; j < 5; j++ )
+			sum += rows[rr * 2 + j][c] * w[j];
+
+		// round like the stored level, so the result is the same as one level at a time
+		const T px = cudaFilterAccum<T>::store(sum);
+		tile[r][c] = cudaFilterAccum<T>::load(px);
+
+		const int x = mx + c;
+		const int y = my + r;
+
+		if( r >= 2 && c >= 2 && r < PYRAMID_MID - 2 && c < PYRAMID_MID - 2 && x < middleWidth && y < middleHeight )
+			middle[y * middleWidth + x] = px;
+	}
+
+	__syncthreads();
+
+	// filter the middle tile horizontally, at the columns of the output
+	for( int n=thread; n < PYRAMID_MID * PYRAMID_TILE; n += threads )
+	{
+		const int r = n / PYRAMID_TILE;
+		const int c = n % PYRAMID_TILE;
+		const int x = (ox + c) * 2 - 2;
+
+		A sum = A();
+
+		#pragma unroll
+		for( int i=0; i < 5; i++ )
+			sum += tile[r][clamp(x + i, 0, middleWidth - 1) - mx] * w[i];
+
+		cols[r][c] = sum;
+	}
+
+	__syncthreads();
+
+	// filter vertically into the output
+	for( int n=thread; n < PYRAMID_TILE * PYRAMID_TILE; n += threads )
+	{
+		const int r = n / PYRAMID_TILE;
+		const int c = n % PYRAMID_TILE;
+
+		const int x = ox + c;
+		const int y = oy + r;
+
+		if( x >= outputWidth || y >= outputHeight )
+			continue;
+
+		A sum = A();
+
+		#pragma unroll
+		for( int j=0; j < 5; j++ )
+			sum += cols[clamp(y * 2 + j - 2, 0, middleHeight - 1) - my][c] * w[j];
+
+		output[y * outputWidth + x] = cudaFilterAccum<T>::store(sum);
+	}
+}
+
+
+// launchPyramid
+template<typename T>
+static cudaError_t launchPyramid( void* const* levels, const uint32_t* widths, const uint32_t* heights, uint32_t numLevels, cudaStream_t stream )
+{
+	uint32_t n = 1;
+
+	while( n < numLevels )
+	{
+		if( n + 1 < numLevels )
+		{
+			// two levels at a time
+			const dim3 blockDim(16, 16);
+			const dim3 gridDim(iDivUp(widths[n+1], PYRAMID_TILE), iDivUp(heights[n+1], PYRAMID_TILE));
+
+			gpuPyramidDown2<T><<<gridDim, blockDim, 0, stream>>>((T*)levels[n-1], widths[n-1], heights[n-1],
+														(T*)levels[n], widths[n], heights[n],
+														(T*)levels[n+1], widths[n+1], heights[n+1]);
+			n += 2;
+		}
+		else
+		{
+			const dim3 blockDim(8, 8);
+			const dim3 gridDim(iDivUp(widths[n], blockDim.x), iDivUp(heights[n], blockDim.y));
+
+			gpuPyramidDown<T><<<gridDim, blockDim, 0, stream>>>((T*)levels[n-1], widths[n-1], heights[n-1],
+													  (T*)levels[n], widths[n], heights[n]);
+			n += 1;
+		}
+
+		const cudaError_t result = cudaGetLastError();
+
+		if( result != cudaSuccess )
+			return CUDA(result);
+	}
+
+	return cudaSuccess;
+}
+
+
+// constructor
+cudaPyramid::cudaPyramid()
+{
+	mData   = NULL;
+	mSize   = 0;
+	mFormat = IMAGE_UNKNOWN;
+	mLevels = 0;
+
+	for( uint32_t n=0; n < CUDA_PYRAMID_MAX_LEVELS; n++ )
+	{
+		mPtr[n]    = NULL;
+		mWidth[n]  = 0;
+		mHeight[n] = 0;
+	}
+}
+
+
+// destructor
+cudaPyramid::~cudaPyramid()
+{
+	Free();
+}
+
+
+// Free
+void cudaPyramid::Free()
+{
+	if( mData != NULL )
+	{
+		cudaFreeMapped(mData);
+		mData = NULL;
+	}
+
+	for( uint32_t n=0; n < CUDA_PYRAMID_MAX_LEVELS; n++ )
+		mPtr[n] = NULL;
+
+	mSize   = 0;
+	mLevels = 0;
+}
+
+
+// Alloc
+bool cudaPyramid::Alloc( uint32_t width, uint32_t height, imageFormat format, uint32_t levels )
+{
+	if( width == 0 || height == 0 || levels == 0 || levels > CUDA_PYRAMID_MAX_LEVELS )
+	{
+		LogError(LOG_CUDA "cudaPyramid::Alloc() -- invalid dimensions or number of levels (%u, max is %u)\n", levels, CUDA_PYRAMID_MAX_LEVELS);
+		return false;
+	}
+
+	if( mLevels == levels && mFormat == format && mWidth[0] == width && mHeight[0] == height )
+		return true;
+
+	Free();
+
+	// the size of each level is rounded up
+	size_t offsets[CUDA_PYRAMID_MAX_LEVELS];
+	size_t size = 0;
+
+	mWidth[0]  = width;
+	mHeight[0] = height;
+
+	for( uint32_t n=1; n < levels; n++ )
+	{
+		mWidth[n]  = (mWidth[n-1] + 1) / 2;
+		mHeight[n] = (mHeight[n-1] + 1) / 2;
+
+		offsets[n] = size;
+		size += ((imageFormatSize(format, mWidth[n], mHeight[n]) + PYRAMID_ALIGN - 1) / PYRAMID_ALIGN) * PYRAMID_ALIGN;
+	}
+
+	if( size > 0 )
+	{
+		if( !cudaAllocMapped(&mData, size) )
+		{
+			LogError(LOG_CUDA "cudaPyramid::Alloc() -- failed to allocate %zu bytes for %u levels\n", size, levels);
+			return false;
+		}
+
+		for( uint32_t n=1; n < levels; n++ )
+			mPtr[n] = (uint8_t*)mData + offsets[n];
+	}
+
+	mSize   = size;
+	mFormat = format;
+	mLevels = levels;
+
+	return true;
+}
+
+
+// Build
+cudaError_t cudaPyramid::Build( void* input, uint32_t width, uint32_t height, imageFormat format, uint32_t levels, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaPyramid");
+
+	if( !input )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( !Alloc(width, height, format, levels) )
+		return cudaErrorMemoryAllocation;
+
+	mPtr[0] = input;
+
+	if( format == IMAGE_GRAY8 )
+		return launchPyramid<uint8_t>(mPtr, mWidth, mHeight, mLevels, stream);
+	else if( format == IMAGE_GRAY32F )
+		return launchPyramid<float>(mPtr, mWidth, mHeight, mLevels, stream);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return launchPyramid<uchar3>(mPtr, mWidth, mHeight, mLevels, stream);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return launchPyramid<uchar4>(mPtr, mWidth, mHeight, mLevels, stream);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return launchPyramid<float3>(mPtr, mWidth, mHeight, mLevels, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return launchPyramid<float4>(mPtr, mWidth, mHeight, mLevels, stream);
+
+	imageFormatErrorMsg(LOG_CUDA, "cudaPyramid::Build()", format);
+	return cudaErrorInvalidValue;
+}
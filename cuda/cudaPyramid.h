@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_PYRAMID_H__
+#define __CUDA_PYRAMID_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * The maximum number of levels in a cudaPyramid (including the input).
+ * @ingroup cuda
+ */
+#define CUDA_PYRAMID_MAX_LEVELS 16
+
+
+/**
+ * Gaussian image pyramid for multi-scale processing (like detection or optical flow).
+ *
+ * Each level is half the size of the previous one (rounded up), and is filtered with a
+ * separable 5-tap Gaussian [1 4 6 4 1]/16 before being decimated, with the edges clamped.
+ * Level 0 is the input image itself, and the other levels are kept in a single contiguous
+ * allocation of mapped memory, with the start of each level aligned to 512 bytes.
+ *
+ * Build() computes two levels per kernel launch:  each thread block loads its footprint
+ * of the previous level, and filters it into the next two levels in shared memory,
+ * so the intermediate level is written out but never read back.  A pyramid of up to
+ * 5 levels takes 2 launches, instead of resizing the full-resolution image for every level.
+ *
+ * The supported formats are gray8, gray32f, rgb8, rgba8, rgb32f and rgba32f (and BGR).
+ *
+ * @ingroup cuda
+ */
+class cudaPyramid
+{
+public:
+	/**
+	 * Create an empty pyramid (the memory is allocated by Build() or Alloc()).
+	 */
+	cudaPyramid();
+
+	/**
+	 * Destructor
+	 */
+	~cudaPyramid();
+
+	/**
+	 * Build the pyramid from an input image (asynchronously on the stream).
+	 * The memory gets reallocated if the dimensions, format, or number of levels changed.
+	 * @param levels the number of levels, including the input (between 1 and CUDA_PYRAMID_MAX_LEVELS)
+	 */
+	cudaError_t Build( void* input, uint32_t width, uint32_t height, imageFormat format, uint32_t levels, cudaStream_t stream=0 );
+
+	/**
+	 * Build the pyramid from an input image (asynchronously on the stream).
+	 */
+	template<typename T> cudaError_t Build( T* input, uint32_t width, uint32_t height, uint32_t levels, cudaStream_t stream=0 )
+	{
+		return Build((void*)input, width, height, imageFormatFromType<T>(), levels, stream);
+	}
+
+	/**
+	 * Allocate the memory for a pyramid ahead of time.
+	 */
+	bool Alloc( uint32_t width, uint32_t height, imageFormat format, uint32_t levels );
+
+	/**
+	 * Release the memory.
+	 */
+	void Free();
+
+	/**
+	 * Return the number of levels (including the input).
+	 */
+	inline uint32_t GetLevels() const					{ return mLevels; }
+
+	/**
+	 * Return a pointer to a level (level 0 is the input that was passed to Build()).
+	 */
+	inline void* GetLevel( uint32_t level ) const			{ return (level < mLevels) ? mPtr[level] : NULL; }
+
+	/**
+	 * Return the width of a level.
+	 */
+	inline uint32_t GetWidth( uint32_t level ) const		{ return (level < mLevels) ? mWidth[level] : 0; }
+
+	/**
+	 * Return the height of a level.
+	 */
+	inline uint32_t GetHeight( uint32_t level ) const		{ return (level < mLevels) ? mHeight[level] : 0; }
+
+	/**
+	 * Return the image format of the levels.
+	 */
+	inline imageFormat GetFormat() const				{ return mFormat; }
+
+	/**
+	 * Return the allocation that holds levels 1 and up.
+	 */
+	inline void* GetData() const						{ return mData; }
+
+	/**
+	 * Return the size of the allocation (in bytes).
+	 */
+	inline size_t GetSize() const						{ return mSize; }
+
+protected:
+	void* mData;
+	size_t mSize;
+
+	imageFormat mFormat;
+	uint32_t mLevels;
+
+	void* mPtr[CUDA_PYRAMID_MAX_LEVELS];
+	uint32_t mWidth[CUDA_PYRAMID_MAX_LEVELS];
+	uint32_t mHeight[CUDA_PYRAMID_MAX_LEVELS];
+};
+
+#endif
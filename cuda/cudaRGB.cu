@@ -22,6 +22,26 @@
 
 #include "cudaRGB.h"
 #include "cudaVector.h"
+#include "cudaVectorIO.h"
+#include "cudaNVTX.h"
+
+#include <cuda_fp16.h>
+
+
+//-----------------------------------------------------------------------------------
+// RGB <-> RGB (per-pixel operator for the vectorized kernels)
+//-----------------------------------------------------------------------------------
+template<typename T_in, typename T_out, bool isBGR>
+struct RGBToRGBOp
+{
+	inline __device__ T_out operator()( const T_in& px ) const
+	{
+		if( isBGR )
+			return make_vec<T_out>(px.z, px.y, px.x, alpha(px));
+		else
+			return make_vec<T_out>(px.x, px.y, px.z, alpha(px));
+	}
+};
 
 
 //-----------------------------------------------------------------------------------
@@ -47,37 +67,48 @@ __global__ void RGBToBGR(T* srcImage, T* dstImage, int width, int height)
 }
 
 template<typename T> 
-static cudaError_t launchRGBToBGR( T* srcDev, T* dstDev, size_t width, size_t height )
+static cudaError_t launchRGBToBGR( T* srcDev, T* dstDev, size_t width, size_t height, cudaStream_t stream )
 {
 	if( !srcDev || !dstDev )
 		return cudaErrorInvalidDevicePointer;
 
+	if( cudaCanVectorize(srcDev, dstDev) )
+		return cudaLaunchVectorized(srcDev, dstDev, width * height, RGBToRGBOp<T, T, true>(), stream);
+
 	const dim3 blockDim(32,8,1);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y), 1);
 
-	RGBToBGR<T><<<gridDim, blockDim>>>(srcDev, dstDev, width, height);
+	RGBToBGR<T><<<gridDim, blockDim, 0, stream>>>(srcDev, dstDev, width, height);
 	
 	return CUDA(cudaGetLastError());
 }
 
-cudaError_t cudaRGB8ToBGR8( uchar3* input, uchar3* output, size_t width, size_t height )
+cudaError_t cudaRGB8ToBGR8( uchar3* input, uchar3* output, size_t width, size_t height, cudaStream_t stream )
 {
-	return launchRGBToBGR<uchar3>(input, output, width, height);
+	NVTX_RANGE("cudaRGB8ToBGR8");
+
+	return launchRGBToBGR<uchar3>(input, output, width, height, stream);
 }
 
-cudaError_t cudaRGB32ToBGR32( float3* input, float3* output, size_t width, size_t height )
+cudaError_t cudaRGB32ToBGR32( float3* input, float3* output, size_t width, size_t height, cudaStream_t stream )
 {
-	return launchRGBToBGR<float3>(input, output, width, height);
+	NVTX_RANGE("cudaRGB32ToBGR32");
+
+	return launchRGBToBGR<float3>(input, output, width, height, stream);
 }
 
-cudaError_t cudaRGBA8ToBGRA8( uchar4* input, uchar4* output, size_t width, size_t height )
+cudaError_t cudaRGBA8ToBGRA8( uchar4* input, uchar4* output, size_t width, size_t height, cudaStream_t stream )
 {
-	return launchRGBToBGR<uchar4>(input, output, width, height);
+	NVTX_RANGE("cudaRGBA8ToBGRA8");
+
+	return launchRGBToBGR<uchar4>(input, output, width, height, stream);
 }
 
-cudaError_t cudaRGBA32ToBGRA32( float4* input, float4* output, size_t width, size_t height )
+cudaError_t cudaRGBA32ToBGRA32( float4* input, float4* output, size_t width, size_t height, cudaStream_t stream )
 {
-	return launchRGBToBGR<float4>(input, output, width, height);
+	NVTX_RANGE("cudaRGBA32ToBGRA32");
+
+	return launchRGBToBGR<float4>(input, output, width, height, stream);
 }
 
 //-----------------------------------------------------------------------------------
@@ -106,90 +137,109 @@ __global__ void RGBToRGB(T_in* srcImage, T_out* dstImage, int width, int height)
 }
 
 template<typename T_in, typename T_out, bool isBGR> 
-static cudaError_t launchRGBToRGB( T_in* srcDev, T_out* dstDev, size_t width, size_t height )
+static cudaError_t launchRGBToRGB( T_in* srcDev, T_out* dstDev, size_t width, size_t height, cudaStream_t stream )
 {
 	if( !srcDev || !dstDev )
 		return cudaErrorInvalidDevicePointer;
 
+	if( cudaCanVectorize(srcDev, dstDev) )
+		return cudaLaunchVectorized(srcDev, dstDev, width * height, RGBToRGBOp<T_in, T_out, isBGR>(), stream);
+
 	const dim3 blockDim(32,8,1);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y), 1);
 
-	RGBToRGB<T_in, T_out, isBGR><<<gridDim, blockDim>>>(srcDev, dstDev, width, height);
+	RGBToRGB<T_in, T_out, isBGR><<<gridDim, blockDim, 0, stream>>>(srcDev, dstDev, width, height);
 	
 	return CUDA(cudaGetLastError());
 }
 
 
 // cudaRGB8ToRGB32 (uchar3 -> float3)
-cudaError_t cudaRGB8ToRGB32( uchar3* srcDev, float3* dstDev, size_t width, size_t height, bool swapRedBlue )
+cudaError_t cudaRGB8ToRGB32( uchar3* srcDev, float3* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGB8ToRGB32");
+
 	if( swapRedBlue )
-		return launchRGBToRGB<uchar3, float3, true>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar3, float3, true>(srcDev, dstDev, width, height, stream);
 	else
-		return launchRGBToRGB<uchar3, float3, false>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar3, float3, false>(srcDev, dstDev, width, height, stream);
 }
 
 // cudaRGB8ToRGBA32 (uchar3 -> float4)
-cudaError_t cudaRGB8ToRGBA32( uchar3* srcDev, float4* dstDev, size_t width, size_t height, bool swapRedBlue )
+cudaError_t cudaRGB8ToRGBA32( uchar3* srcDev, float4* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGB8ToRGBA32");
+
 	if( swapRedBlue )
-		return launchRGBToRGB<uchar3, float4, true>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar3, float4, true>(srcDev, dstDev, width, height, stream);
 	else
-		return launchRGBToRGB<uchar3, float4, false>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar3, float4, false>(srcDev, dstDev, width, height, stream);
 }
 
 // cudaRGBA8ToRGB32 (uchar4 -> float3)
-cudaError_t cudaRGBA8ToRGB32( uchar4* srcDev, float3* dstDev, size_t width, size_t height, bool swapRedBlue )
+cudaError_t cudaRGBA8ToRGB32( uchar4* srcDev, float3* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGBA8ToRGB32");
+
 	if( swapRedBlue )
-		return launchRGBToRGB<uchar4, float3, true>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar4, float3, true>(srcDev, dstDev, width, height, stream);
 	else
-		return launchRGBToRGB<uchar4, float3, false>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar4, float3, false>(srcDev, dstDev, width, height, stream);
 }
 
 // cudaRGBA8ToRGBA32 (uchar4 -> float4)
-cudaError_t cudaRGBA8ToRGBA32( uchar4* srcDev, float4* dstDev, size_t width, size_t height, bool swapRedBlue )
+cudaError_t cudaRGBA8ToRGBA32( uchar4* srcDev, float4* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGBA8ToRGBA32");
+
 	if( swapRedBlue )
-		return launchRGBToRGB<uchar4, float4, true>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar4, float4, true>(srcDev, dstDev, width, height, stream);
 	else
-		return launchRGBToRGB<uchar4, float4, false>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar4, float4, false>(srcDev, dstDev, width, height, stream);
 }
 
 // cudaRGB8ToRGBA8 (uchar3 -> uchar4)
-cudaError_t cudaRGB8ToRGBA8( uchar3* srcDev, uchar4* dstDev, size_t width, size_t height, bool swapRedBlue )
+cudaError_t cudaRGB8ToRGBA8( uchar3* srcDev, uchar4* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGB8ToRGBA8");
+
 	if( swapRedBlue )
-		return launchRGBToRGB<uchar3, uchar4, true>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar3, uchar4, true>(srcDev, dstDev, width, height, stream);
 	else
-		return launchRGBToRGB<uchar3, uchar4, false>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar3, uchar4, false>(srcDev, dstDev, width, height, stream);
 }
 
 // cudaRGBA8ToRGB8 (uchar4 -> uchar3)
-cudaError_t cudaRGBA8ToRGB8( uchar4* srcDev, uchar3* dstDev, size_t width, size_t height, bool swapRedBlue )
+cudaError_t cudaRGBA8ToRGB8( uchar4* srcDev, uchar3* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGBA8ToRGB8");
+
 	if( swapRedBlue )
-		return launchRGBToRGB<uchar4, uchar3, true>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar4, uchar3, true>(srcDev, dstDev, width, height, stream);
 	else
-		return launchRGBToRGB<uchar4, uchar3, false>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<uchar4, uchar3, false>(srcDev, dstDev, width, height, stream);
 }
 
 // cudaRGB32ToRGBA32 (float3 -> float4)
-cudaError_t cudaRGB32ToRGBA32( float3* srcDev, float4* dstDev, size_t width, size_t height, bool swapRedBlue )
+cudaError_t cudaRGB32ToRGBA32( float3* srcDev, float4* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGB32ToRGBA32");
+
 	if( swapRedBlue )
-		return launchRGBToRGB<float3, float4, true>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<float3, float4, true>(srcDev, dstDev, width, height, stream);
 	else
-		return launchRGBToRGB<float3, float4, false>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<float3, float4, false>(srcDev, dstDev, width, height, stream);
 }
 
 // cudaRGBA32ToRGB32 (float4 -> float3)
-cudaError_t cudaRGBA32ToRGB32( float4* srcDev, float3* dstDev, size_t width, size_t height, bool swapRedBlue )
+cudaError_t cudaRGBA32ToRGB32( float4* srcDev, float3* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGBA32ToRGB32");
+
 	if( swapRedBlue )
-		return launchRGBToRGB<float4, float3, true>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<float4, float3, true>(srcDev, dstDev, width, height, stream);
 	else
-		return launchRGBToRGB<float4, float3, false>(srcDev, dstDev, width, height);
+		return launchRGBToRGB<float4, float3, false>(srcDev, dstDev, width, height, stream);
 }
 
 //-----------------------------------------------------------------------------------
@@ -220,8 +270,23 @@ __global__ void RGBToRGB_Norm(T_in* srcImage, T_out* dstImage, int width, int he
 		dstImage[pixel] = make_vec<T_out>(rescale(px.x), rescale(px.y), rescale(px.z), rescale(alpha(px,input_range.y)));
 }
 
+template<typename T_in, typename T_out, bool isBGRA>
+struct RGBToRGB_NormOp
+{
+	float2 input_range;
+	float  scaling_factor;
+
+	inline __device__ T_out operator()( const T_in& px ) const
+	{
+		if( isBGRA )
+			return make_vec<T_out>(rescale(px.z), rescale(px.y), rescale(px.x), rescale(alpha(px,input_range.y)));
+		else
+			return make_vec<T_out>(rescale(px.x), rescale(px.y), rescale(px.z), rescale(alpha(px,input_range.y)));
+	}
+};
+
 template<typename T_in, typename T_out, bool isBGR> 
-static cudaError_t launchRGBToRGB_Norm( T_in* srcDev, T_out* dstDev, size_t width, size_t height, const float2& inputRange )
+static cudaError_t launchRGBToRGB_Norm( T_in* srcDev, T_out* dstDev, size_t width, size_t height, const float2& inputRange, cudaStream_t stream )
 {
 	if( !srcDev || !dstDev )
 		return cudaErrorInvalidDevicePointer;
@@ -231,47 +296,279 @@ static cudaError_t launchRGBToRGB_Norm( T_in* srcDev, T_out* dstDev, size_t widt
 
 	const float multiplier = 255.0f / (inputRange.y - inputRange.x);
 
+	if( cudaCanVectorize(srcDev, dstDev) )
+	{
+		RGBToRGB_NormOp<T_in, T_out, isBGR> op;
+
+		op.input_range    = inputRange;
+		op.scaling_factor = multiplier;
+
+		return cudaLaunchVectorized(srcDev, dstDev, width * height, op, stream);
+	}
+
 	const dim3 blockDim(32,8,1);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y), 1);
 
-	RGBToRGB_Norm<T_in, T_out, isBGR><<<gridDim, blockDim>>>( srcDev, dstDev, width, height, inputRange, multiplier);
+	RGBToRGB_Norm<T_in, T_out, isBGR><<<gridDim, blockDim, 0, stream>>>( srcDev, dstDev, width, height, inputRange, multiplier);
 	
 	return CUDA(cudaGetLastError());
 }
 
 
 // cudaRGB32ToRGB8 (float3 -> uchar3)
-cudaError_t cudaRGB32ToRGB8( float3* srcDev, uchar3* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange )
+cudaError_t cudaRGB32ToRGB8( float3* srcDev, uchar3* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGB32ToRGB8");
+
 	if( swapRedBlue )
-		return launchRGBToRGB_Norm<float3, uchar3, true>(srcDev, dstDev, width, height, inputRange);
+		return launchRGBToRGB_Norm<float3, uchar3, true>(srcDev, dstDev, width, height, inputRange, stream);
 	else
-		return launchRGBToRGB_Norm<float3, uchar3, false>(srcDev, dstDev, width, height, inputRange);
+		return launchRGBToRGB_Norm<float3, uchar3, false>(srcDev, dstDev, width, height, inputRange, stream);
 }
 
 // cudaRGB32ToRGBA8 (float3 -> uchar4)
-cudaError_t cudaRGB32ToRGBA8( float3* srcDev, uchar4* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange )
+cudaError_t cudaRGB32ToRGBA8( float3* srcDev, uchar4* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGB32ToRGBA8");
+
 	if( swapRedBlue )
-		return launchRGBToRGB_Norm<float3, uchar4, true>(srcDev, dstDev, width, height, inputRange);
+		return launchRGBToRGB_Norm<float3, uchar4, true>(srcDev, dstDev, width, height, inputRange, stream);
 	else
-		return launchRGBToRGB_Norm<float3, uchar4, false>(srcDev, dstDev, width, height, inputRange);
+		return launchRGBToRGB_Norm<float3, uchar4, false>(srcDev, dstDev, width, height, inputRange, stream);
 }
 
 // cudaRGBA32ToRGB8 (float4 -> uchar3)
-cudaError_t cudaRGBA32ToRGB8( float4* srcDev, uchar3* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange )
+cudaError_t cudaRGBA32ToRGB8( float4* srcDev, uchar3* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGBA32ToRGB8");
+
 	if( swapRedBlue )
-		return launchRGBToRGB_Norm<float4, uchar3, true>(srcDev, dstDev, width, height, inputRange);
+		return launchRGBToRGB_Norm<float4, uchar3, true>(srcDev, dstDev, width, height, inputRange, stream);
 	else
-		return launchRGBToRGB_Norm<float4, uchar3, false>(srcDev, dstDev, width, height, inputRange);
+		return launchRGBToRGB_Norm<float4, uchar3, false>(srcDev, dstDev, width, height, inputRange, stream);
 }
 
 // cudaRGBA32ToRGBA8 (float4 -> uchar4)
-cudaError_t cudaRGBA32ToRGBA8( float4* srcDev, uchar4* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange )
+cudaError_t cudaRGBA32ToRGBA8( float4* srcDev, uchar4* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaRGBA32ToRGBA8");
+
 	if( swapRedBlue )
-		return launchRGBToRGB_Norm<float4, uchar4, true>(srcDev, dstDev, width, height, inputRange);
+		return launchRGBToRGB_Norm<float4, uchar4, true>(srcDev, dstDev, width, height, inputRange, stream);
+	else
+		return launchRGBToRGB_Norm<float4, uchar4, false>(srcDev, dstDev, width, height, inputRange, stream);
+}
+
+
+//-----------------------------------------------------------------------------------
+// RGB/RGBA to planar or FP16 tensors
+//-----------------------------------------------------------------------------------
+static inline __device__ void tensorStore( float* ptr, float value )	{ *ptr = value; }
+static inline __device__ void tensorStore( __half* ptr, float value )	{ *ptr = __float2half(value); }
+
+static inline __device__ float tensorLoad( float* ptr )				{ return *ptr; }
+static inline __device__ float tensorLoad( __half* ptr )			{ return __half2float(*ptr); }
+
+template<typename T_in, typename T_out, int channels, bool planar, bool isBGR>
+__global__ void RGBToTensor(T_in* srcImage, T_out* dstImage, int width, int height)
+{
+	const int x = (blockIdx.x * blockDim.x) + threadIdx.x;
+	const int y = (blockIdx.y * blockDim.y) + threadIdx.y;
+	
+	const int pixel = y * width + x;
+
+	if( x >= width )
+		return; 
+
+	if( y >= height )
+		return;
+
+	const T_in px = srcImage[pixel];
+
+	const float rgba[4] = { float(isBGR ? px.z : px.x), float(px.y), 
+					    float(isBGR ? px.x : px.z), float(alpha(px)) };
+
+	const int planeSize = width * height;
+
+	#pragma unroll
+	for( int c=0; c < channels; c++ )
+		tensorStore(dstImage + (planar ? c * planeSize + pixel : pixel * channels + c), rgba[c]);
+}
+
+template<typename T_in> 
+static cudaError_t launchRGBToTensor( T_in* srcDev, void* dstDev, imageFormat format, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
+{
+	if( !srcDev || !dstDev )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const dim3 blockDim(32,8,1);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y), 1);
+
+	#define launch_tensor(T_out, channels, planar) \
+	{ \
+		if( swapRedBlue ) \
+			RGBToTensor<T_in, T_out, channels, planar, true><<<gridDim, blockDim, 0, stream>>>(srcDev, (T_out*)dstDev, width, height); \
+		else \
+			RGBToTensor<T_in, T_out, channels, planar, false><<<gridDim, blockDim, 0, stream>>>(srcDev, (T_out*)dstDev, width, height); \
+	}
+
+	if( format == IMAGE_RGB32F_PLANAR )
+		launch_tensor(float, 3, true)
+	else if( format == IMAGE_RGB16F_PLANAR )
+		launch_tensor(__half, 3, true)
+	else if( format == IMAGE_RGB16F )
+		launch_tensor(__half, 3, false)
+	else if( format == IMAGE_RGBA16F )
+		launch_tensor(__half, 4, false)
 	else
-		return launchRGBToRGB_Norm<float4, uchar4, false>(srcDev, dstDev, width, height, inputRange);
+	{
+		LogError(LOG_CUDA "cudaRGBToTensor() -- invalid output format '%s'\n", imageFormatToStr(format));
+		return cudaErrorInvalidValue;
+	}
+
+	return CUDA(cudaGetLastError());
+}
+
+// cudaRGBToTensor (uchar3)
+cudaError_t cudaRGBToTensor( uchar3* srcDev, void* dstDev, imageFormat format, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRGBToTensor");
+
+	return launchRGBToTensor<uchar3>(srcDev, dstDev, format, width, height, swapRedBlue, stream);
+}
+
+// cudaRGBToTensor (uchar4)
+cudaError_t cudaRGBToTensor( uchar4* srcDev, void* dstDev, imageFormat format, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRGBToTensor");
+
+	return launchRGBToTensor<uchar4>(srcDev, dstDev, format, width, height, swapRedBlue, stream);
+}
+
+// cudaRGBToTensor (float3)
+cudaError_t cudaRGBToTensor( float3* srcDev, void* dstDev, imageFormat format, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRGBToTensor");
+
+	return launchRGBToTensor<float3>(srcDev, dstDev, format, width, height, swapRedBlue, stream);
+}
+
+// cudaRGBToTensor (float4)
+cudaError_t cudaRGBToTensor( float4* srcDev, void* dstDev, imageFormat format, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRGBToTensor");
+
+	return launchRGBToTensor<float4>(srcDev, dstDev, format, width, height, swapRedBlue, stream);
+}
+
+
+//-----------------------------------------------------------------------------------
+// planar or FP16 tensors to RGB/RGBA
+//-----------------------------------------------------------------------------------
+template<typename T_in, int channels, bool planar, typename T_out, bool isBGR>
+__global__ void TensorToRGB(T_in* srcImage, T_out* dstImage, int width, int height,
+					   float2 input_range, float scaling_factor)
+{
+	const int x = (blockIdx.x * blockDim.x) + threadIdx.x;
+	const int y = (blockIdx.y * blockDim.y) + threadIdx.y;
+	
+	const int pixel = y * width + x;
+
+	if( x >= width )
+		return; 
+
+	if( y >= height )
+		return;
+
+	const int planeSize = width * height;
+
+	float rgba[4];
+	rgba[3] = input_range.y;
+
+	#pragma unroll
+	for( int c=0; c < channels; c++ )
+		rgba[c] = tensorLoad(srcImage + (planar ? c * planeSize + pixel : pixel * channels + c));
+
+	#pragma unroll
+	for( int c=0; c < 4; c++ )
+		rgba[c] = (rgba[c] - input_range.x) * scaling_factor;
+
+	if( isBGR )
+		dstImage[pixel] = make_vec<T_out>(rgba[2], rgba[1], rgba[0], rgba[3]);
+	else
+		dstImage[pixel] = make_vec<T_out>(rgba[0], rgba[1], rgba[2], rgba[3]);
+}
+
+template<typename T_out> 
+static cudaError_t launchTensorToRGB( void* srcDev, imageFormat format, T_out* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange, cudaStream_t stream )
+{
+	if( !srcDev || !dstDev )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const float multiplier = 255.0f / (inputRange.y - inputRange.x);
+
+	const dim3 blockDim(32,8,1);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y), 1);
+
+	#define launch_rgb(T_in, channels, planar) \
+	{ \
+		if( swapRedBlue ) \
+			TensorToRGB<T_in, channels, planar, T_out, true><<<gridDim, blockDim, 0, stream>>>((T_in*)srcDev, dstDev, width, height, inputRange, multiplier); \
+		else \
+			TensorToRGB<T_in, channels, planar, T_out, false><<<gridDim, blockDim, 0, stream>>>((T_in*)srcDev, dstDev, width, height, inputRange, multiplier); \
+	}
+
+	if( format == IMAGE_RGB32F_PLANAR )
+		launch_rgb(float, 3, true)
+	else if( format == IMAGE_RGB16F_PLANAR )
+		launch_rgb(__half, 3, true)
+	else if( format == IMAGE_RGB16F )
+		launch_rgb(__half, 3, false)
+	else if( format == IMAGE_RGBA16F )
+		launch_rgb(__half, 4, false)
+	else
+	{
+		LogError(LOG_CUDA "cudaTensorToRGB() -- invalid input format '%s'\n", imageFormatToStr(format));
+		return cudaErrorInvalidValue;
+	}
+
+	return CUDA(cudaGetLastError());
+}
+
+// cudaTensorToRGB (uchar3)
+cudaError_t cudaTensorToRGB( void* srcDev, imageFormat format, uchar3* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaTensorToRGB");
+
+	return launchTensorToRGB<uchar3>(srcDev, format, dstDev, width, height, swapRedBlue, inputRange, stream);
+}
+
+// cudaTensorToRGB (uchar4)
+cudaError_t cudaTensorToRGB( void* srcDev, imageFormat format, uchar4* dstDev, size_t width, size_t height, bool swapRedBlue, const float2& inputRange, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaTensorToRGB");
+
+	return launchTensorToRGB<uchar4>(srcDev, format, dstDev, width, height, swapRedBlue, inputRange, stream);
+}
+
+// cudaTensorToRGB (float3)
+cudaError_t cudaTensorToRGB( void* srcDev, imageFormat format, float3* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaTensorToRGB");
+
+	return launchTensorToRGB<float3>(srcDev, format, dstDev, width, height, swapRedBlue, make_float2(0,255), stream);
+}
+
+// cudaTensorToRGB (float4)
+cudaError_t cudaTensorToRGB( void* srcDev, imageFormat format, float4* dstDev, size_t width, size_t height, bool swapRedBlue, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaTensorToRGB");
+
+	return launchTensorToRGB<float4>(srcDev, format, dstDev, width, height, swapRedBlue, make_float2(0,255), stream);
 }
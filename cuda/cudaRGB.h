@@ -25,6 +25,7 @@
 
 
 #include "cudaUtility.h"
+#include "imageFormat.h"
 
 
 
@@ -41,28 +42,28 @@
  * This function swaps the red and blue channels, so if the input is RGB it will 
  * be converted to RGB, and if the input is BGR it will be converted to RGB.
  */
-cudaError_t cudaRGB8ToBGR8( uchar3* input, uchar3* output, size_t width, size_t height );
+cudaError_t cudaRGB8ToBGR8( uchar3* input, uchar3* output, size_t width, size_t height, cudaStream_t stream=NULL );
 
 /**
  * Convert float3 RGB image to float3 BGR (or convert BGR to RGB).
  * This function swaps the red and blue channels, so if the input is RGB it will 
  * be converted to RGB, and if the input is BGR it will be converted to RGB.
  */
-cudaError_t cudaRGB32ToBGR32( float3* input, float3* output, size_t width, size_t height );
+cudaError_t cudaRGB32ToBGR32( float3* input, float3* output, size_t width, size_t height, cudaStream_t stream=NULL );
 
 /**
  * Convert uchar4 RGBA image to uchar4 BGRA (or convert BGRA to RGBA).
  * This function swaps the red and blue channels, so if the input is RGBA it will 
  * be converted to RGBA, and if the input is BGR it will be converted to RGBA.
  */
-cudaError_t cudaRGBA8ToBGRA8( uchar4* input, uchar4* output, size_t width, size_t height );
+cudaError_t cudaRGBA8ToBGRA8( uchar4* input, uchar4* output, size_t width, size_t height, cudaStream_t stream=NULL );
 
 /**
  * Convert float4 RGBA image to float4 BGRA (or convert BGRA to RGBA).
  * This function swaps the red and blue channels, so if the input is RGBA it will 
  * be converted to RGBA, and if the input is BGR it will be converted to RGBA.
  */
-cudaError_t cudaRGBA32ToBGRA32( float4* input, float4* output, size_t width, size_t height );
+cudaError_t cudaRGBA32ToBGRA32( float4* input, float4* output, size_t width, size_t height, cudaStream_t stream=NULL );
 
 
 ///@}
@@ -82,7 +83,7 @@ cudaError_t cudaRGBA32ToBGRA32( float4* input, float4* output, size_t width, siz
  *                    i.e if the input is RGB and output is BGR, or vice versa.  
  *                    The default is false, and the channels will remain the same.
  */
-cudaError_t cudaRGB8ToRGBA8( uchar3* input, uchar4* output, size_t width, size_t height, bool swapRedBlue=false );
+cudaError_t cudaRGB8ToRGBA8( uchar3* input, uchar4* output, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
 
 /**
  * Convert uchar4 RGBA/BGRA image to uchar3 RGB/BGR image
@@ -91,7 +92,7 @@ cudaError_t cudaRGB8ToRGBA8( uchar3* input, uchar4* output, size_t width, size_t
  *                    i.e if the input is RGB and output is BGR, or vice versa.  
  *                    The default is false, and the channels will remain the same.
  */
-cudaError_t cudaRGBA8ToRGB8( uchar4* input, uchar3* output, size_t width, size_t height, bool swapRedBlue=false );
+cudaError_t cudaRGBA8ToRGB8( uchar4* input, uchar3* output, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
 
 ///@}
 
@@ -111,7 +112,7 @@ cudaError_t cudaRGBA8ToRGB8( uchar4* input, uchar3* output, size_t width, size_t
  *                    i.e if the input is RGB and output is BGR, or vice versa.  
  *                    The default is false, and the channels will remain the same.
  */
-cudaError_t cudaRGB32ToRGBA32( float3* input, float4* output, size_t width, size_t height, bool swapRedBlue=false );
+cudaError_t cudaRGB32ToRGBA32( float3* input, float4* output, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
 
 /**
  * Convert float4 RGBA/BGRA image into float3 RGB/BGR image.
@@ -120,7 +121,7 @@ cudaError_t cudaRGB32ToRGBA32( float3* input, float4* output, size_t width, size
  *                    i.e if the input is RGB and output is BGR, or vice versa.  
  *                    The default is false, and the channels will remain the same.
  */
-cudaError_t cudaRGBA32ToRGB32( float4* input, float3* output, size_t width, size_t height, bool swapRedBlue=false );
+cudaError_t cudaRGBA32ToRGB32( float4* input, float3* output, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
 
 ///@}
 
@@ -140,7 +141,7 @@ cudaError_t cudaRGBA32ToRGB32( float4* input, float3* output, size_t width, size
  *                    i.e if the input is RGB and output is BGR, or vice versa.  
  *                    The default is false, and the channels will remain the same.
  */
-cudaError_t cudaRGB8ToRGB32( uchar3* input, float3* output, size_t width, size_t height, bool swapRedBlue=false );
+cudaError_t cudaRGB8ToRGB32( uchar3* input, float3* output, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
 
 /**
  * Convert uchar3 RGB/BGR image to float4 RGBA/BGRA image
@@ -149,7 +150,7 @@ cudaError_t cudaRGB8ToRGB32( uchar3* input, float3* output, size_t width, size_t
  *                    i.e if the input is RGB and output is BGR, or vice versa.  
  *                    The default is false, and the channels will remain the same.
  */
-cudaError_t cudaRGB8ToRGBA32( uchar3* input, float4* output, size_t width, size_t height, bool swapRedBlue=false );
+cudaError_t cudaRGB8ToRGBA32( uchar3* input, float4* output, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
 
 /**
  * Convert uchar4 RGBA/BGRA image to float3 RGB/BGR image
@@ -158,7 +159,7 @@ cudaError_t cudaRGB8ToRGBA32( uchar3* input, float4* output, size_t width, size_
  *                    i.e if the input is RGB and output is BGR, or vice versa.  
  *                    The default is false, and the channels will remain the same.
  */
-cudaError_t cudaRGBA8ToRGB32( uchar4* input, float3* output, size_t width, size_t height, bool swapRedBlue=false );
+cudaError_t cudaRGBA8ToRGB32( uchar4* input, float3* output, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
 
 /**
  * Convert uchar4 RGBA/BGRA image to float4 RGBA/BGRA image
@@ -167,7 +168,7 @@ cudaError_t cudaRGBA8ToRGB32( uchar4* input, float3* output, size_t width, size_
  *                    i.e if the input is RGB and output is BGR, or vice versa.  
  *                    The default is false, and the channels will remain the same.
  */
-cudaError_t cudaRGBA8ToRGBA32( uchar4* input, float4* output, size_t width, size_t height, bool swapRedBlue=false );
+cudaError_t cudaRGBA8ToRGBA32( uchar4* input, float4* output, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
 
 ///@}
 
@@ -193,7 +194,7 @@ cudaError_t cudaRGBA8ToRGBA32( uchar4* input, float4* output, size_t width, size
  *                   Other common input ranges are [-1, 1] or [0,1].
  */
 cudaError_t cudaRGB32ToRGB8( float3* input, uchar3* output, size_t width, size_t height, 
-					    bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255) );
+					    bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255), cudaStream_t stream=NULL );
 
 /**
  * Convert float3 RGB/BGR image into uchar4 RGBA/BGRA image.
@@ -208,7 +209,7 @@ cudaError_t cudaRGB32ToRGB8( float3* input, uchar3* output, size_t width, size_t
  *                   Other common input ranges are [-1, 1] or [0,1].
  */
 cudaError_t cudaRGB32ToRGBA8( float3* input, uchar4* output, size_t width, size_t height, 
-						bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255) );
+						bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255), cudaStream_t stream=NULL );
 
 /**
  * Convert float4 RGBA/BGRA image into uchar3 image.
@@ -223,7 +224,7 @@ cudaError_t cudaRGB32ToRGBA8( float3* input, uchar4* output, size_t width, size_
  *                   Other common input ranges are [-1, 1] or [0,1].
  */
 cudaError_t cudaRGBA32ToRGB8( float4* input, uchar3* output, size_t width, size_t height, 
-						bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255) );
+						bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255), cudaStream_t stream=NULL );
 
 /**
  * Convert float4 RGBA/BGRA image into uchar4 RGBA/BGRA image.
@@ -238,7 +239,111 @@ cudaError_t cudaRGBA32ToRGB8( float4* input, uchar3* output, size_t width, size_
  *                   Other common input ranges are [-1, 1] or [0,1].
  */
 cudaError_t cudaRGBA32ToRGBA8( float4* input, uchar4* output, size_t width, size_t height, 
-						 bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255) );
+						 bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255), cudaStream_t stream=NULL );
+
+///@}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+/// @name RGB/RGBA images to planar or half-precision DNN tensors (or vice versa)
+/// @see cudaConvertColor() from cudaColorspace.h for automated format conversion
+/// @ingroup colorspace
+//////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+/**
+ * Convert uchar3 RGB/BGR image into a planar or half-precision RGB tensor.
+ *
+ * @param outputFormat the format of the output tensor, which should be one of
+ *                     IMAGE_RGB32F_PLANAR, IMAGE_RGB16F_PLANAR, IMAGE_RGB16F or IMAGE_RGBA16F.
+ *                     The pixel values are not rescaled, and remain in the range [0,255].
+ *
+ * @param swapRedBlue if true, swap the input's red and blue channels in the output -
+ *                    i.e if the input is BGR, the output tensor will still be RGB.
+ *                    The default is false, and the channels will remain the same.
+ */
+cudaError_t cudaRGBToTensor( uchar3* input, void* output, imageFormat outputFormat, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
+
+/**
+ * Convert uchar4 RGBA/BGRA image into a planar or half-precision RGB tensor.
+ * @see cudaRGBToTensor(uchar3*) for a description of the parameters.
+ */
+cudaError_t cudaRGBToTensor( uchar4* input, void* output, imageFormat outputFormat, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
+
+/**
+ * Convert float3 RGB/BGR image into a planar or half-precision RGB tensor.
+ * @see cudaRGBToTensor(uchar3*) for a description of the parameters.
+ */
+cudaError_t cudaRGBToTensor( float3* input, void* output, imageFormat outputFormat, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
+
+/**
+ * Convert float4 RGBA/BGRA image into a planar or half-precision RGB tensor.
+ * @see cudaRGBToTensor(uchar3*) for a description of the parameters.
+ */
+cudaError_t cudaRGBToTensor( float4* input, void* output, imageFormat outputFormat, size_t width, size_t height, bool swapRedBlue=false, cudaStream_t stream=NULL );
+
+/**
+ * Convert a planar or half-precision RGB tensor into uchar3 RGB/BGR image.
+ *
+ * @param inputFormat the format of the input tensor, which should be one of
+ *                    IMAGE_RGB32F_PLANAR, IMAGE_RGB16F_PLANAR, IMAGE_RGB16F or IMAGE_RGBA16F.
+ *
+ * @param swapRedBlue if true, swap the input's red and blue channels in the output -
+ *                    i.e if the output is BGR.
+ *                    The default is false, and the channels will remain the same.
+ *
+ * @param pixelRange specifies the pixel value range of the input tensor, which is
+ *                   used to rescale the fixed-point pixel outputs to [0,255].
+ *                   The default input range is [0,255], where no rescaling occurs.
+ */
+cudaError_t cudaTensorToRGB( void* input, imageFormat inputFormat, uchar3* output, size_t width, size_t height, 
+					    bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255), cudaStream_t stream=NULL );
+
+/**
+ * Convert a planar or half-precision RGB tensor into uchar4 RGBA/BGRA image.
+ * @see cudaTensorToRGB(uchar3*) for a description of the parameters.
+ */
+cudaError_t cudaTensorToRGB( void* input, imageFormat inputFormat, uchar4* output, size_t width, size_t height, 
+					    bool swapRedBlue=false, const float2& pixelRange=make_float2(0,255), cudaStream_t stream=NULL );
+
+/**
+ * Convert a planar or half-precision RGB tensor into float3 RGB/BGR image.
+ * @see cudaTensorToRGB(uchar3*) for a description of the parameters (pixelRange is unused).
+ */
+cudaError_t cudaTensorToRGB( void* input, imageFormat inputFormat, float3* output, size_t width, size_t height, 
+					    bool swapRedBlue=false, cudaStream_t stream=NULL );
+
+/**
+ * Convert a planar or half-precision RGB tensor into float4 RGBA/BGRA image.
+ * @see cudaTensorToRGB(uchar3*) for a description of the parameters (pixelRange is unused).
+ */
+cudaError_t cudaTensorToRGB( void* input, imageFormat inputFormat, float4* output, size_t width, size_t height, 
+					    bool swapRedBlue=false, cudaStream_t stream=NULL );
+
+///@}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+/// @name 16-bit grayscale and RGB/RGBA to 8-bit, float, or half-precision
+/// @see cudaConvertColor() from cudaColorspace.h for automated format conversion
+/// @ingroup colorspace
+//////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+/**
+ * Convert a 16-bit image (IMAGE_GRAY16, IMAGE_RGB16, or IMAGE_RGBA16) into an 8-bit, float,
+ * or half-precision image (IMAGE_RGB8, IMAGE_RGBA8, IMAGE_RGB32F, IMAGE_RGBA32F, IMAGE_RGB16F,
+ * IMAGE_RGBA16F, IMAGE_GRAY8, or IMAGE_GRAY32F).  Grayscale inputs are replicated to each color
+ * channel, and RGB inputs converted to grayscale use the BT.601 luma weights.
+ *
+ * @param pixelRange the range of the input pixel values that gets rescaled to [0,255].
+ *                   The default is the full 16-bit range [0,65535], but for example
+ *                   a 14-bit thermal sensor would use [0,16383].
+ */
+cudaError_t cudaRGB16ToRGB( void* input, imageFormat inputFormat, void* output, imageFormat outputFormat, size_t width, size_t height, 
+					   const float2& pixelRange=make_float2(0,65535), cudaStream_t stream=NULL );
 
 ///@}
 
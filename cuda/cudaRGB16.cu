@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaRGB.h"
+#include "cudaNVTX.h"
+
+#include "logging.h"
+
+#include <cuda_fp16.h>
+
+
+// store a color component (between 0 and 255) in the output type
+static inline __device__ void storeComponent( uint8_t* ptr, float value )	{ *ptr = (uint8_t)(value + 0.5f); }
+static inline __device__ void storeComponent( float* ptr, float value )		{ *ptr = value; }
+static inline __device__ void storeComponent( __half* ptr, float value )	{ *ptr = __float2half(value); }
+
+
+//-----------------------------------------------------------------------------------
+// 16-bit gray/RGB/RGBA to 8-bit, float, or half
+//-----------------------------------------------------------------------------------
+template<int inputChannels, typename T, int outputChannels>
+__global__ void RGB16ToRGB( const uint16_t* input, T* output, int width, int height, float offset, float scale )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const int pixel = y * width + x;
+	const uint16_t* in = input + pixel * inputChannels;
+
+	float px[4];
+
+	#pragma unroll
+	for( int c=0; c < 3; c++ )
+		px[c] = fminf(fmaxf((in[inputChannels == 1 ? 0 : c] - offset) * scale, 0.0f), 255.0f);
+
+	px[3] = (inputChannels == 4) ? fminf(fmaxf((in[3] - offset) * scale, 0.0f), 255.0f) : 255.0f;
+
+	T* out = output + pixel * outputChannels;
+
+	if( outputChannels == 1 )
+	{
+		storeComponent(out, (inputChannels == 1) ? px[0] : 0.299f * px[0] + 0.587f * px[1] + 0.114f * px[2]);
+		return;
+	}
+
+	#pragma unroll
+	for( int c=0; c < outputChannels; c++ )
+		storeComponent(out + c, px[c]);
+}
+
+
+// launchRGB16ToRGB
+template<int inputChannels>
+static cudaError_t launchRGB16ToRGB( void* input, void* output, imageFormat outputFormat, size_t width, size_t height, const float2& pixelRange, cudaStream_t stream )
+{
+	const float offset = pixelRange.x;
+	const float scale  = 255.0f / (pixelRange.y - pixelRange.x);
+
+	const dim3 blockDim(32,8,1);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y), 1);
+
+	#define launch_rgb16(T, outputChannels) \
+		RGB16ToRGB<inputChannels, T, outputChannels><<<gridDim, blockDim, 0, stream>>>((uint16_t*)input, (T*)output, width, height, offset, scale)
+
+	if( outputFormat == IMAGE_RGB8 )
+		launch_rgb16(uint8_t, 3);
+	else if( outputFormat == IMAGE_RGBA8 )
+		launch_rgb16(uint8_t, 4);
+	else if( outputFormat == IMAGE_RGB32F )
+		launch_rgb16(float, 3);
+	else if( outputFormat == IMAGE_RGBA32F )
+		launch_rgb16(float, 4);
+	else if( outputFormat == IMAGE_RGB16F )
+		launch_rgb16(__half, 3);
+	else if( outputFormat == IMAGE_RGBA16F )
+		launch_rgb16(__half, 4);
+	else if( outputFormat == IMAGE_GRAY8 )
+		launch_rgb16(uint8_t, 1);
+	else if( outputFormat == IMAGE_GRAY32F )
+		launch_rgb16(float, 1);
+	else
+	{
+		LogError(LOG_CUDA "cudaRGB16ToRGB() -- invalid output format '%s'\n", imageFormatToStr(outputFormat));
+		LogError(LOG_CUDA "                   supported formats are rgb8, rgba8, rgb32f, rgba32f, rgb16f, rgba16f, gray8, gray32f\n");
+		return cudaErrorInvalidValue;
+	}
+
+	#undef launch_rgb16
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaRGB16ToRGB
+cudaError_t cudaRGB16ToRGB( void* input, imageFormat inputFormat, void* output, imageFormat outputFormat, size_t width, size_t height, const float2& pixelRange, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRGB16ToRGB");
+
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 || pixelRange.y <= pixelRange.x )
+		return cudaErrorInvalidValue;
+
+	if( inputFormat == IMAGE_GRAY16 )
+		return launchRGB16ToRGB<1>(input, output, outputFormat, width, height, pixelRange, stream);
+	else if( inputFormat == IMAGE_RGB16 )
+		return launchRGB16ToRGB<3>(input, output, outputFormat, width, height, pixelRange, stream);
+	else if( inputFormat == IMAGE_RGBA16 )
+		return launchRGB16ToRGB<4>(input, output, outputFormat, width, height, pixelRange, stream);
+
+	LogError(LOG_CUDA "cudaRGB16ToRGB() -- invalid input format '%s' (expected gray16, rgb16, or rgba16)\n", imageFormatToStr(inputFormat));
+	return cudaErrorInvalidValue;
+}
+
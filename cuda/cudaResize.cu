@@ -22,6 +22,11 @@
 
 #include "cudaResize.h"
 #include "cudaFilterMode.cuh"
+#include "cudaVector.h"
+#include "cudaAutotune.h"
+#include "cudaNVTX.h"
+
+#include <cuda_fp16.h>
 
 
 // gpuResize
@@ -37,11 +42,159 @@ __global__ void gpuResize( T* input, int inputWidth, int inputHeight, T* output,
 	output[y * outputWidth + x] = cudaFilterPixel<filter>(input, x, y, inputWidth, inputHeight, outputWidth, outputHeight); 
 }
 
+
+#define AREA_BLOCK_DIM 16	// output pixels per block side
+#define AREA_TILE_DIM  32	// input pixels per shared-memory tile side
+
+// gpuResizeArea
+template<typename T>
+__global__ void gpuResizeArea( T* input, int inputWidth, int inputHeight, T* output, int outputWidth, int outputHeight, float2 scale )
+{
+	__shared__ T tile[AREA_TILE_DIM][AREA_TILE_DIM];
+
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	// footprint of this thread's output pixel in the input image
+	const float px0 = float(x) * scale.x;
+	const float py0 = float(y) * scale.y;
+	const float px1 = fminf(px0 + scale.x, float(inputWidth));
+	const float py1 = fminf(py0 + scale.y, float(inputHeight));
+
+	// footprint of the whole block in the input image
+	const int bx0 = int(float(blockIdx.x * blockDim.x) * scale.x);
+	const int by0 = int(float(blockIdx.y * blockDim.y) * scale.y);
+	const int bx1 = min(int(ceilf(float(min(int((blockIdx.x + 1) * blockDim.x), outputWidth)) * scale.x)), inputWidth);
+	const int by1 = min(int(ceilf(float(min(int((blockIdx.y + 1) * blockDim.y), outputHeight)) * scale.y)), inputHeight);
+
+	const int thread = threadIdx.y * blockDim.x + threadIdx.x;
+	const int threads = blockDim.x * blockDim.y;
+
+	typename cudaFilterAccum<T>::Type sum = typename cudaFilterAccum<T>::Type();
+	float weight = 0.0f;
+
+	for( int ty=by0; ty < by1; ty += AREA_TILE_DIM )
+	{
+		for( int tx=bx0; tx < bx1; tx += AREA_TILE_DIM )
+		{
+			// cooperatively load the next tile of the footprint (coalesced along rows)
+			for( int n=thread; n < AREA_TILE_DIM * AREA_TILE_DIM; n += threads )
+			{
+				const int ix = tx + n % AREA_TILE_DIM;
+				const int iy = ty + n / AREA_TILE_DIM;
+
+				if( ix < bx1 && iy < by1 )
+					tile[n / AREA_TILE_DIM][n % AREA_TILE_DIM] = input[iy * inputWidth + ix];
+			}
+
+			__syncthreads();
+
+			// accumulate the part of this pixel's footprint that overlaps the tile
+			const int x_begin = max(int(px0), tx);
+			const int y_begin = max(int(py0), ty);
+			const int x_end = min(min(int(ceilf(px1)), tx + AREA_TILE_DIM), bx1);
+			const int y_end = min(min(int(ceilf(py1)), ty + AREA_TILE_DIM), by1);
+
+			for( int iy=y_begin; iy < y_end; iy++ )
+			{
+				const float wy = fminf(float(iy+1), py1) - fmaxf(float(iy), py0);
+
+				for( int ix=x_begin; ix < x_end; ix++ )
+				{
+					const float w = (fminf(float(ix+1), px1) - fmaxf(float(ix), px0)) * wy;
+
+					sum += cudaFilterAccum<T>::load(tile[iy - ty][ix - tx]) * w;
+					weight += w;
+				}
+			}
+
+			__syncthreads();
+		}
+	}
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	output[y * outputWidth + x] = cudaFilterAccum<T>::store(sum / weight);
+}
+
+// gpuResizeTexture (the interpolation is done by the texture unit)
+template<typename T, typename T_texel, cudaFilterMode filter>
+__global__ void gpuResizeTexture( cudaTextureObject_t input, float scale, float2 ratio, T* output, int outputWidth, int outputHeight )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const T_texel px = cudaFilterTexturePixel<filter, T_texel>(input, (float(x) + 0.5f) * ratio.x, (float(y) + 0.5f) * ratio.y);
+	output[y * outputWidth + x] = cudaFilterAccum<T>::store(cudaFilterAccum<T>::saturate(px * scale));
+}
+
+// launchResizeTexture (returns cudaErrorNotSupported if the input can't be bound to a texture)
+template<typename T, typename T_texel>
+static cudaError_t launchResizeTexture( T* input, size_t inputWidth, size_t inputHeight, imageFormat format,
+							     T* output, size_t outputWidth, size_t outputHeight,
+							     cudaFilterMode filter, cudaStream_t stream )
+{
+	cudaTextureObject_t texture = 0;
+
+	if( !cudaFilterTexture(&texture, input, inputWidth, inputHeight, format) )
+		return cudaErrorNotSupported;
+
+	// uint8 textures are read as normalized floats
+	const float scale = (imageFormatBaseType(format) == IMAGE_UINT8) ? 255.0f : 1.0f;
+
+	const float2 ratio = make_float2(float(inputWidth) / float(outputWidth),
+							   float(inputHeight) / float(outputHeight));
+
+	auto launch = [&]( const dim3& blockDim ) -> cudaError_t
+	{
+		const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+		if( filter == FILTER_CUBIC )
+			gpuResizeTexture<T, T_texel, FILTER_CUBIC><<<gridDim, blockDim, 0, stream>>>(texture, scale, ratio, output, outputWidth, outputHeight);
+		else
+			gpuResizeTexture<T, T_texel, FILTER_LINEAR><<<gridDim, blockDim, 0, stream>>>(texture, scale, ratio, output, outputWidth, outputHeight);
+
+		return cudaGetLastError();
+	};
+
+	const dim3 blockDim = cudaAutotune((filter == FILTER_CUBIC) ? "cudaResize-tex-cubic" : "cudaResize-tex-linear", sizeof(T), outputWidth, outputHeight, dim3(8,8), stream, launch);
+
+	return CUDA(launch(blockDim));
+}
+
+// launchResizeTexture (only the formats that can be bound to textures are specialized)
+template<typename T>
+static cudaError_t launchResizeTexture( T* input, size_t inputWidth, size_t inputHeight,
+							     T* output, size_t outputWidth, size_t outputHeight,
+							     cudaFilterMode filter, cudaStream_t stream )
+{
+	return cudaErrorNotSupported;
+}
+
+#define RESIZE_TEXTURE(T, T_texel, format)	\
+	template<> cudaError_t launchResizeTexture<T>( T* input, size_t inputWidth, size_t inputHeight, \
+										  T* output, size_t outputWidth, size_t outputHeight, \
+										  cudaFilterMode filter, cudaStream_t stream ) \
+	{ \
+		return launchResizeTexture<T, T_texel>(input, inputWidth, inputHeight, format, output, outputWidth, outputHeight, filter, stream); \
+	}
+
+RESIZE_TEXTURE(uint8_t, float, IMAGE_GRAY8);
+RESIZE_TEXTURE(float, float, IMAGE_GRAY32F);
+RESIZE_TEXTURE(uchar4, float4, IMAGE_RGBA8);
+RESIZE_TEXTURE(float4, float4, IMAGE_RGBA32F);
+
+#undef RESIZE_TEXTURE
+
 // launchResize
 template<typename T>
 static cudaError_t launchResize( T* input, size_t inputWidth, size_t inputHeight,
 				             T* output, size_t outputWidth, size_t outputHeight,
-						   cudaFilterMode filter )
+						   cudaFilterMode filter, cudaStream_t stream )
 {
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
@@ -49,77 +202,314 @@ static cudaError_t launchResize( T* input, size_t inputWidth, size_t inputHeight
 	if( inputWidth == 0 || outputWidth == 0 || inputHeight == 0 || outputHeight == 0 )
 		return cudaErrorInvalidValue;
 
-	if( outputWidth < inputWidth && outputHeight < inputHeight )
+	if( filter == FILTER_AREA )
+	{
+		const dim3 blockDim(AREA_BLOCK_DIM, AREA_BLOCK_DIM);
+		const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+		const float2 scale = make_float2(float(inputWidth) / float(outputWidth),
+								   float(inputHeight) / float(outputHeight));
+
+		gpuResizeArea<T><<<gridDim, blockDim, 0, stream>>>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, scale);
+		return CUDA(cudaGetLastError());
+	}
+
+	if( filter == FILTER_LINEAR && outputWidth < inputWidth && outputHeight < inputHeight )
+		filter = FILTER_POINT;
+
+	// use the texture hardware for filtering if the format and alignment allow it
+	if( filter != FILTER_POINT && input != output )
+	{
+		const cudaError_t result = launchResizeTexture<T>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter, stream);
+
+		if( result != cudaErrorNotSupported )
+			return result;
+	}
+
+	// launch kernel
+	#define launch_resize(filterMode)	\
+		gpuResize<T, filterMode><<<gridDim, blockDim, 0, stream>>>(input, inputWidth, inputHeight, output, outputWidth, outputHeight)
+
+	auto launch = [&]( const dim3& blockDim ) -> cudaError_t
+	{
+		const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+		if( filter == FILTER_POINT )
+			launch_resize(FILTER_POINT);
+		else if( filter == FILTER_LINEAR )
+			launch_resize(FILTER_LINEAR);
+		else if( filter == FILTER_CUBIC )
+			launch_resize(FILTER_CUBIC);
+
+		return cudaGetLastError();
+	};
+
+	dim3 blockDim(8, 8);
+
+	if( input != output )
+		blockDim = cudaAutotune((filter == FILTER_POINT) ? "cudaResize-point" : (filter == FILTER_CUBIC) ? "cudaResize-cubic" : "cudaResize-linear", sizeof(T), outputWidth, outputHeight, blockDim, stream, launch);
+
+	return CUDA(launch(blockDim));
+}
+
+
+// ResizeReaderPitched (reads pitched pixels as the filter's accumulator type)
+template<typename T>
+struct ResizeReaderPitched
+{
+	T*     ptr;
+	size_t pitch;
+
+	__device__ inline typename cudaFilterAccum<T>::Type operator()( int x, int y ) const
+	{
+		return cudaFilterAccum<T>::load(((T*)((uint8_t*)ptr + y * pitch))[x]);
+	}
+};
+
+// gpuResizePitched
+template<typename T, cudaFilterMode filter>
+__global__ void gpuResizePitched( T* input, int inputWidth, int inputHeight, size_t inputPitch, 
+						    T* output, int outputWidth, int outputHeight, size_t outputPitch )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const ResizeReaderPitched<T> reader = {input, inputPitch};
+	T* outputRow = (T*)((uint8_t*)output + y * outputPitch);
+
+	outputRow[x] = cudaFilterAccum<T>::store(cudaFilterAccum<T>::saturate(cudaFilterPixelReader<filter, typename cudaFilterAccum<T>::Type>(reader, x, y, inputWidth, inputHeight, outputWidth, outputHeight)));
+}
+
+// launchResizePitched
+template<typename T>
+static cudaError_t launchResizePitched( T* input, size_t inputWidth, size_t inputHeight, size_t inputPitch,
+				                    T* output, size_t outputWidth, size_t outputHeight, size_t outputPitch,
+						          cudaFilterMode filter, cudaStream_t stream )
+{
+	// packed images use the regular kernels
+	if( inputPitch == inputWidth * sizeof(T) && outputPitch == outputWidth * sizeof(T) )
+		return launchResize<T>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter, stream);
+
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || outputWidth == 0 || inputHeight == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( inputPitch < inputWidth * sizeof(T) || outputPitch < outputWidth * sizeof(T) )
+		return cudaErrorInvalidPitchValue;
+
+	if( filter == FILTER_LINEAR && outputWidth < inputWidth && outputHeight < inputHeight )
 		filter = FILTER_POINT;
 
 	// launch kernel
 	const dim3 blockDim(8, 8);
 	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
 
-	#define launch_resize(filterMode)	\
-		gpuResize<T, filterMode><<<gridDim, blockDim>>>(input, inputWidth, inputHeight, output, outputWidth, outputHeight)
+	#define launch_resize_pitched(filterMode)	\
+		gpuResizePitched<T, filterMode><<<gridDim, blockDim, 0, stream>>>(input, inputWidth, inputHeight, inputPitch, output, outputWidth, outputHeight, outputPitch)
+	
+	if( filter == FILTER_POINT )
+		launch_resize_pitched(FILTER_POINT);
+	else if( filter == FILTER_LINEAR )
+		launch_resize_pitched(FILTER_LINEAR);
+	else if( filter == FILTER_AREA )
+		launch_resize_pitched(FILTER_AREA);
+	else if( filter == FILTER_CUBIC )
+		launch_resize_pitched(FILTER_CUBIC);
+
+	return CUDA(cudaGetLastError());
+}
+
+// ResizeReaderHalf (reads interleaved half-precision pixels as float4)
+template<int channels>
+struct ResizeReaderHalf
+{
+	__half* ptr;
+	int     width;
+
+	__device__ inline float4 operator()( int x, int y ) const
+	{
+		float px[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+		#pragma unroll
+		for( int c=0; c < channels; c++ )
+			px[c] = __half2float(ptr[(y * width + x) * channels + c]);
+
+		return make_float4(px[0], px[1], px[2], px[3]);
+	}
+};
+
+// gpuResizeHalf
+template<int channels, cudaFilterMode filter>
+__global__ void gpuResizeHalf( __half* input, int inputWidth, int inputHeight, __half* output, int outputWidth, int outputHeight )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const ResizeReaderHalf<channels> reader = {input, inputWidth};
+	const float4 px = cudaFilterPixelReader<filter, float4>(reader, x, y, inputWidth, inputHeight, outputWidth, outputHeight);
+	const float  pf[4] = {px.x, px.y, px.z, px.w};
+
+	#pragma unroll
+	for( int c=0; c < channels; c++ )
+		output[(y * outputWidth + x) * channels + c] = __float2half(pf[c]);
+}
+
+// launchResizeHalf
+template<int channels>
+static cudaError_t launchResizeHalf( __half* input, size_t inputWidth, size_t inputHeight,
+				                 __half* output, size_t outputWidth, size_t outputHeight,
+						       cudaFilterMode filter, cudaStream_t stream )
+{
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || outputWidth == 0 || inputHeight == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( filter == FILTER_LINEAR && outputWidth < inputWidth && outputHeight < inputHeight )
+		filter = FILTER_POINT;
+
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+	#define launch_resize_half(filterMode)	\
+		gpuResizeHalf<channels, filterMode><<<gridDim, blockDim, 0, stream>>>(input, inputWidth, inputHeight, output, outputWidth, outputHeight)
 	
 	if( filter == FILTER_POINT )
-		launch_resize(FILTER_POINT);
+		launch_resize_half(FILTER_POINT);
 	else if( filter == FILTER_LINEAR )
-		launch_resize(FILTER_LINEAR);
+		launch_resize_half(FILTER_LINEAR);
+	else if( filter == FILTER_AREA )
+		launch_resize_half(FILTER_AREA);
+	else if( filter == FILTER_CUBIC )
+		launch_resize_half(FILTER_CUBIC);
 
 	return CUDA(cudaGetLastError());
 }
 
+// launchResizePlanar (resizes each of the 3 planes separately)
+template<typename T>
+static cudaError_t launchResizePlanar( T* input, size_t inputWidth, size_t inputHeight,
+				                   T* output, size_t outputWidth, size_t outputHeight,
+						         cudaFilterMode filter, cudaStream_t stream )
+{
+	for( int c=0; c < 3; c++ )
+	{
+		T* inputPlane  = input + c * inputWidth * inputHeight;
+		T* outputPlane = output + c * outputWidth * outputHeight;
+
+		const cudaError_t result = launchResize<T>(inputPlane, inputWidth, inputHeight, outputPlane, outputWidth, outputHeight, filter, stream);
+
+		if( result != cudaSuccess )
+			return result;
+	}
+
+	return cudaSuccess;
+}
+
+template<>
+cudaError_t launchResizePlanar<__half>( __half* input, size_t inputWidth, size_t inputHeight,
+							     __half* output, size_t outputWidth, size_t outputHeight,
+							     cudaFilterMode filter, cudaStream_t stream )
+{
+	for( int c=0; c < 3; c++ )
+	{
+		__half* inputPlane  = input + c * inputWidth * inputHeight;
+		__half* outputPlane = output + c * outputWidth * outputHeight;
+
+		const cudaError_t result = launchResizeHalf<1>(inputPlane, inputWidth, inputHeight, outputPlane, outputWidth, outputHeight, filter, stream);
+
+		if( result != cudaSuccess )
+			return result;
+	}
+
+	return cudaSuccess;
+}
+
 // cudaResize (uint8 grayscale)
-cudaError_t cudaResize( uint8_t* input, size_t inputWidth, size_t inputHeight, uint8_t* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter )
+cudaError_t cudaResize( uint8_t* input, size_t inputWidth, size_t inputHeight, uint8_t* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter, cudaStream_t stream )
 {
-	return launchResize<uint8_t>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter);
+	NVTX_RANGE("cudaResize");
+
+	return launchResize<uint8_t>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter, stream);
 }
 
 // cudaResize (float grayscale)
-cudaError_t cudaResize( float* input, size_t inputWidth, size_t inputHeight, float* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter )
+cudaError_t cudaResize( float* input, size_t inputWidth, size_t inputHeight, float* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter, cudaStream_t stream )
 {
-	return launchResize<float>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter);
+	NVTX_RANGE("cudaResize");
+
+	return launchResize<float>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter, stream);
 }
 
 // cudaResize (uchar3)
-cudaError_t cudaResize( uchar3* input, size_t inputWidth, size_t inputHeight, uchar3* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter )
+cudaError_t cudaResize( uchar3* input, size_t inputWidth, size_t inputHeight, uchar3* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter, cudaStream_t stream )
 {
-	return launchResize<uchar3>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter);
+	NVTX_RANGE("cudaResize");
+
+	return launchResize<uchar3>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter, stream);
 }
 
 // cudaResize (uchar4)
-cudaError_t cudaResize( uchar4* input, size_t inputWidth, size_t inputHeight, uchar4* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter )
+cudaError_t cudaResize( uchar4* input, size_t inputWidth, size_t inputHeight, uchar4* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter, cudaStream_t stream )
 {
-	return launchResize<uchar4>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter);
+	NVTX_RANGE("cudaResize");
+
+	return launchResize<uchar4>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter, stream);
 }
 
 // cudaResize (float3)
-cudaError_t cudaResize( float3* input, size_t inputWidth, size_t inputHeight, float3* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter )
+cudaError_t cudaResize( float3* input, size_t inputWidth, size_t inputHeight, float3* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter, cudaStream_t stream )
 {
-	return launchResize<float3>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter);
+	NVTX_RANGE("cudaResize");
+
+	return launchResize<float3>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter, stream);
 }
 
 // cudaResize (float4)
-cudaError_t cudaResize( float4* input, size_t inputWidth, size_t inputHeight, float4* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter )
+cudaError_t cudaResize( float4* input, size_t inputWidth, size_t inputHeight, float4* output, size_t outputWidth, size_t outputHeight, cudaFilterMode filter, cudaStream_t stream )
 {
-	return launchResize<float4>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter);
+	NVTX_RANGE("cudaResize");
+
+	return launchResize<float4>(input, inputWidth, inputHeight, output, outputWidth, outputHeight, filter, stream);
 }
 
 //-----------------------------------------------------------------------------------
 cudaError_t cudaResize( void* input,  size_t inputWidth,  size_t inputHeight,
 				    void* output, size_t outputWidth, size_t outputHeight, 
-				    imageFormat format, cudaFilterMode filter )
+				    imageFormat format, cudaFilterMode filter, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaResize");
+
 	if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
-		return cudaResize((uchar3*)input, inputWidth, inputHeight, (uchar3*)output, outputWidth, outputHeight, filter);
+		return cudaResize((uchar3*)input, inputWidth, inputHeight, (uchar3*)output, outputWidth, outputHeight, filter, stream);
 	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
-		return cudaResize((uchar4*)input, inputWidth, inputHeight, (uchar4*)output, outputWidth, outputHeight, filter);
+		return cudaResize((uchar4*)input, inputWidth, inputHeight, (uchar4*)output, outputWidth, outputHeight, filter, stream);
 	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
-		return cudaResize((float3*)input, inputWidth, inputHeight, (float3*)output, outputWidth, outputHeight, filter);
+		return cudaResize((float3*)input, inputWidth, inputHeight, (float3*)output, outputWidth, outputHeight, filter, stream);
 	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
-		return cudaResize((float4*)input, inputWidth, inputHeight, (float4*)output, outputWidth, outputHeight, filter);
+		return cudaResize((float4*)input, inputWidth, inputHeight, (float4*)output, outputWidth, outputHeight, filter, stream);
 	else if( format == IMAGE_GRAY8 )
-		return cudaResize((uint8_t*)input, inputWidth, inputHeight, (uint8_t*)output, outputWidth, outputHeight, filter);
+		return cudaResize((uint8_t*)input, inputWidth, inputHeight, (uint8_t*)output, outputWidth, outputHeight, filter, stream);
 	else if( format == IMAGE_GRAY32F )
-		return cudaResize((float*)input, inputWidth, inputHeight, (float*)output, outputWidth, outputHeight, filter);
+		return cudaResize((float*)input, inputWidth, inputHeight, (float*)output, outputWidth, outputHeight, filter, stream);
+	else if( format == IMAGE_RGB32F_PLANAR )
+		return launchResizePlanar<float>((float*)input, inputWidth, inputHeight, (float*)output, outputWidth, outputHeight, filter, stream);
+	else if( format == IMAGE_RGB16F_PLANAR )
+		return launchResizePlanar<__half>((__half*)input, inputWidth, inputHeight, (__half*)output, outputWidth, outputHeight, filter, stream);
+	else if( format == IMAGE_RGB16F )
+		return launchResizeHalf<3>((__half*)input, inputWidth, inputHeight, (__half*)output, outputWidth, outputHeight, filter, stream);
+	else if( format == IMAGE_RGBA16F )
+		return launchResizeHalf<4>((__half*)input, inputWidth, inputHeight, (__half*)output, outputWidth, outputHeight, filter, stream);
 
 	LogError(LOG_CUDA "cudaResize() -- invalid image format '%s'\n", imageFormatToStr(format));
 	LogError(LOG_CUDA "                supported formats are:\n");
@@ -129,10 +519,211 @@ cudaError_t cudaResize( void* input,  size_t inputWidth,  size_t inputHeight,
 	LogError(LOG_CUDA "                    * rgba8, bgra8\n");
 	LogError(LOG_CUDA "                    * rgb32f, bgr32f\n");
 	LogError(LOG_CUDA "                    * rgba32f, bgra32f\n");
+	LogError(LOG_CUDA "                    * rgb32f-planar, rgb16f-planar\n");
+	LogError(LOG_CUDA "                    * rgb16f, rgba16f\n");
 
 	return cudaErrorInvalidValue;
 }
 
+// cudaResize (pitched)
+cudaError_t cudaResize( void* input,  size_t inputWidth,  size_t inputHeight,  size_t inputPitch,
+				    void* output, size_t outputWidth, size_t outputHeight, size_t outputPitch,
+				    imageFormat format, cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaResize");
+
+	if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return launchResizePitched<uchar3>((uchar3*)input, inputWidth, inputHeight, inputPitch, (uchar3*)output, outputWidth, outputHeight, outputPitch, filter, stream);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return launchResizePitched<uchar4>((uchar4*)input, inputWidth, inputHeight, inputPitch, (uchar4*)output, outputWidth, outputHeight, outputPitch, filter, stream);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return launchResizePitched<float3>((float3*)input, inputWidth, inputHeight, inputPitch, (float3*)output, outputWidth, outputHeight, outputPitch, filter, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return launchResizePitched<float4>((float4*)input, inputWidth, inputHeight, inputPitch, (float4*)output, outputWidth, outputHeight, outputPitch, filter, stream);
+	else if( format == IMAGE_GRAY8 )
+		return launchResizePitched<uint8_t>((uint8_t*)input, inputWidth, inputHeight, inputPitch, (uint8_t*)output, outputWidth, outputHeight, outputPitch, filter, stream);
+	else if( format == IMAGE_GRAY32F )
+		return launchResizePitched<float>((float*)input, inputWidth, inputHeight, inputPitch, (float*)output, outputWidth, outputHeight, outputPitch, filter, stream);
+
+	LogError(LOG_CUDA "cudaResize() -- invalid image format '%s' for pitched resize\n", imageFormatToStr(format));
+	LogError(LOG_CUDA "                supported formats are:\n");
+	LogError(LOG_CUDA "                    * gray8\n");
+	LogError(LOG_CUDA "                    * gray32f\n");
+	LogError(LOG_CUDA "                    * rgb8, bgr8\n");
+	LogError(LOG_CUDA "                    * rgba8, bgra8\n");
+	LogError(LOG_CUDA "                    * rgb32f, bgr32f\n");
+	LogError(LOG_CUDA "                    * rgba32f, bgra32f\n");
+
+	return cudaErrorInvalidValue;
+}
+
+
 
 
 
+
+// ResizeReaderROI (reads pixels of the input ROI as the filter's accumulator type)
+template<typename T>
+struct ResizeReaderROI
+{
+	T*  ptr;
+	int width;
+	int left;
+	int top;
+
+	__device__ inline typename cudaFilterAccum<T>::Type operator()( int x, int y ) const
+	{
+		return cudaFilterAccum<T>::load(ptr[(y + top) * width + x + left]);
+	}
+};
+
+// gpuResizeROI (the grid covers the `region` rectangle of the output image)
+template<typename T, cudaFilterMode filter>
+__global__ void gpuResizeROI( T* input, int inputWidth, int4 inputROI,
+					     T* output, int outputWidth, int4 outputROI, int4 region,
+					     T fill, bool hasFill )
+{
+	const int x = region.x + blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = region.y + blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= region.z || y >= region.w )
+		return;
+
+	if( x < outputROI.x || y < outputROI.y || x >= outputROI.z || y >= outputROI.w )
+	{
+		if( hasFill )
+			output[y * outputWidth + x] = fill;
+
+		return;
+	}
+
+	const ResizeReaderROI<T> reader = {input, inputWidth, inputROI.x, inputROI.y};
+
+	output[y * outputWidth + x] = cudaFilterAccum<T>::store(cudaFilterAccum<T>::saturate(
+		cudaFilterPixelReader<filter, typename cudaFilterAccum<T>::Type>(reader, x - outputROI.x, y - outputROI.y, 
+												         inputROI.z - inputROI.x, inputROI.w - inputROI.y, 
+												         outputROI.z - outputROI.x, outputROI.w - outputROI.y)));
+}
+
+// resizeFillColor (converts the fill color to the pixel type)
+template<typename T> static inline T resizeFillColor( const float4& color )	{ return cast_vec<T>(color); }
+template<> inline uint8_t resizeFillColor<uint8_t>( const float4& color )	{ return color.x; }
+template<> inline float resizeFillColor<float>( const float4& color )		{ return color.x; }
+
+// checkResizeROI
+static inline bool checkResizeROI( const int4& roi, size_t width, size_t height )
+{
+	return roi.x >= 0 && roi.y >= 0 && roi.z > roi.x && roi.w > roi.y && roi.z <= (int)width && roi.w <= (int)height;
+}
+
+// launchResizeROI
+template<typename T>
+static cudaError_t launchResizeROI( T* input, size_t inputWidth, size_t inputHeight, const int4& inputROI,
+				                T* output, size_t outputWidth, size_t outputHeight, const int4& outputROI,
+						      cudaFilterMode filter, const float4* fill, cudaStream_t stream )
+{
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || outputWidth == 0 || inputHeight == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( !checkResizeROI(inputROI, inputWidth, inputHeight) || !checkResizeROI(outputROI, outputWidth, outputHeight) )
+	{
+		LogError(LOG_CUDA "cudaResize() -- invalid ROI (%i, %i, %i, %i) -> (%i, %i, %i, %i)\n", 
+			    inputROI.x, inputROI.y, inputROI.z, inputROI.w, outputROI.x, outputROI.y, outputROI.z, outputROI.w);
+
+		return cudaErrorInvalidValue;
+	}
+
+	if( filter == FILTER_LINEAR && (outputROI.z - outputROI.x) < (inputROI.z - inputROI.x) && (outputROI.w - outputROI.y) < (inputROI.w - inputROI.y) )
+		filter = FILTER_POINT;
+
+	const T fillColor = fill != NULL ? resizeFillColor<T>(*fill) : T();
+
+	// without a fill color, only the output ROI needs to be covered
+	const int4 region = fill != NULL ? make_int4(0, 0, outputWidth, outputHeight) : outputROI;
+
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(region.z - region.x, blockDim.x), iDivUp(region.w - region.y, blockDim.y));
+
+	#define launch_resize_roi(filterMode)	\
+		gpuResizeROI<T, filterMode><<<gridDim, blockDim, 0, stream>>>(input, inputWidth, inputROI, output, outputWidth, outputROI, region, fillColor, fill != NULL)
+	
+	if( filter == FILTER_POINT )
+		launch_resize_roi(FILTER_POINT);
+	else if( filter == FILTER_LINEAR )
+		launch_resize_roi(FILTER_LINEAR);
+	else if( filter == FILTER_AREA )
+		launch_resize_roi(FILTER_AREA);
+	else if( filter == FILTER_CUBIC )
+		launch_resize_roi(FILTER_CUBIC);
+
+	return CUDA(cudaGetLastError());
+}
+
+// cudaResize (ROI)
+cudaError_t cudaResize( void* input,  size_t inputWidth,  size_t inputHeight,  const int4& inputROI,
+				    void* output, size_t outputWidth, size_t outputHeight, const int4& outputROI,
+				    imageFormat format, cudaFilterMode filter, const float4* fill, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaResize");
+
+	if( input == output )
+	{
+		LogError(LOG_CUDA "cudaResize() -- the ROI version can't be used in-place\n");
+		return cudaErrorInvalidValue;
+	}
+
+	if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return launchResizeROI<uchar3>((uchar3*)input, inputWidth, inputHeight, inputROI, (uchar3*)output, outputWidth, outputHeight, outputROI, filter, fill, stream);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return launchResizeROI<uchar4>((uchar4*)input, inputWidth, inputHeight, inputROI, (uchar4*)output, outputWidth, outputHeight, outputROI, filter, fill, stream);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return launchResizeROI<float3>((float3*)input, inputWidth, inputHeight, inputROI, (float3*)output, outputWidth, outputHeight, outputROI, filter, fill, stream);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return launchResizeROI<float4>((float4*)input, inputWidth, inputHeight, inputROI, (float4*)output, outputWidth, outputHeight, outputROI, filter, fill, stream);
+	else if( format == IMAGE_GRAY8 )
+		return launchResizeROI<uint8_t>((uint8_t*)input, inputWidth, inputHeight, inputROI, (uint8_t*)output, outputWidth, outputHeight, outputROI, filter, fill, stream);
+	else if( format == IMAGE_GRAY32F )
+		return launchResizeROI<float>((float*)input, inputWidth, inputHeight, inputROI, (float*)output, outputWidth, outputHeight, outputROI, filter, fill, stream);
+
+	LogError(LOG_CUDA "cudaResize() -- invalid image format '%s' for ROI resize\n", imageFormatToStr(format));
+	LogError(LOG_CUDA "                supported formats are:\n");
+	LogError(LOG_CUDA "                    * gray8\n");
+	LogError(LOG_CUDA "                    * gray32f\n");
+	LogError(LOG_CUDA "                    * rgb8, bgr8\n");
+	LogError(LOG_CUDA "                    * rgba8, bgra8\n");
+	LogError(LOG_CUDA "                    * rgb32f, bgr32f\n");
+	LogError(LOG_CUDA "                    * rgba32f, bgra32f\n");
+
+	return cudaErrorInvalidValue;
+}
+
+// cudaResizeLetterbox
+cudaError_t cudaResizeLetterbox( void* input,  size_t inputWidth,  size_t inputHeight,
+					        void* output, size_t outputWidth, size_t outputHeight,
+					        imageFormat format, cudaFilterMode filter,
+					        const float4& fill, int4* outputROI, cudaStream_t stream )
+{
+	if( inputWidth == 0 || outputWidth == 0 || inputHeight == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	// scale to the limiting dimension and center the image
+	const float scale = fminf(float(outputWidth) / float(inputWidth), float(outputHeight) / float(inputHeight));
+
+	const int width  = max(min(int(float(inputWidth) * scale + 0.5f), int(outputWidth)), 1);
+	const int height = max(min(int(float(inputHeight) * scale + 0.5f), int(outputHeight)), 1);
+
+	const int left = (int(outputWidth) - width) / 2;
+	const int top  = (int(outputHeight) - height) / 2;
+
+	const int4 roi = make_int4(left, top, left + width, top + height);
+
+	if( outputROI != NULL )
+		*outputROI = roi;
+
+	return cudaResize(input, inputWidth, inputHeight, make_int4(0, 0, inputWidth, inputHeight),
+				   output, outputWidth, outputHeight, roi, format, filter, &fill, stream);
+}
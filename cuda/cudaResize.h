@@ -35,77 +35,144 @@
  * To use bilinear filtering for upscaling, set filter to FILTER_LINEAR.
  * If the image is being downscaled, or if FILTER_POINT is set (default),
  * then nearest-neighbor sampling will be used instead.
+ * For antialiased downscaling, set filter to FILTER_AREA (area-averaging).
+ * For sharper upscaling, set filter to FILTER_CUBIC (bicubic).
  * @ingroup resize
  */
 cudaError_t cudaResize( uint8_t* input,  size_t inputWidth,  size_t inputHeight,
 				    uint8_t* output, size_t outputWidth, size_t outputHeight,
-				    cudaFilterMode filter=FILTER_POINT );
+				    cudaFilterMode filter=FILTER_POINT, cudaStream_t stream=NULL );
 
 /**
  * Rescale a floating-point grayscale image on the GPU.
  * To use bilinear filtering for upscaling, set filter to FILTER_LINEAR.
  * If the image is being downscaled, or if FILTER_POINT is set (default),
  * then nearest-neighbor sampling will be used instead.
+ * For antialiased downscaling, set filter to FILTER_AREA (area-averaging).
+ * For sharper upscaling, set filter to FILTER_CUBIC (bicubic).
  * @ingroup resize
  */
 cudaError_t cudaResize( float* input,  size_t inputWidth,  size_t inputHeight,
 				    float* output, size_t outputWidth, size_t outputHeight,
-				    cudaFilterMode filter=FILTER_POINT );
+				    cudaFilterMode filter=FILTER_POINT, cudaStream_t stream=NULL );
 
 /**
  * Rescale a uchar3 RGB/BGR image on the GPU.
  * To use bilinear filtering for upscaling, set filter to FILTER_LINEAR.
  * If the image is being downscaled, or if FILTER_POINT is set (default),
  * then nearest-neighbor sampling will be used instead.
+ * For antialiased downscaling, set filter to FILTER_AREA (area-averaging).
+ * For sharper upscaling, set filter to FILTER_CUBIC (bicubic).
  * @ingroup resize
  */
 cudaError_t cudaResize( uchar3* input,  size_t inputWidth,  size_t inputHeight,
 				    uchar3* output, size_t outputWidth, size_t outputHeight,
-				    cudaFilterMode filter=FILTER_POINT );
+				    cudaFilterMode filter=FILTER_POINT, cudaStream_t stream=NULL );
 
 /**
  * Rescale a float3 RGB/BGR image on the GPU.
  * To use bilinear filtering for upscaling, set filter to FILTER_LINEAR.
  * If the image is being downscaled, or if FILTER_POINT is set (default),
  * then nearest-neighbor sampling will be used instead.
+ * For antialiased downscaling, set filter to FILTER_AREA (area-averaging).
+ * For sharper upscaling, set filter to FILTER_CUBIC (bicubic).
  * @ingroup resize
  */
 cudaError_t cudaResize( float3* input,  size_t inputWidth,  size_t inputHeight,
 				    float3* output, size_t outputWidth, size_t outputHeight,
-				    cudaFilterMode filter=FILTER_POINT );
+				    cudaFilterMode filter=FILTER_POINT, cudaStream_t stream=NULL );
 
 /**
  * Rescale a uchar4 RGBA/BGRA image on the GPU.
  * To use bilinear filtering for upscaling, set filter to FILTER_LINEAR.
  * If the image is being downscaled, or if FILTER_POINT is set (default),
  * then nearest-neighbor sampling will be used instead.
+ * For antialiased downscaling, set filter to FILTER_AREA (area-averaging).
+ * For sharper upscaling, set filter to FILTER_CUBIC (bicubic).
  * @ingroup resize
  */
 cudaError_t cudaResize( uchar4* input,  size_t inputWidth,  size_t inputHeight,
 				    uchar4* output, size_t outputWidth, size_t outputHeight,
-				    cudaFilterMode filter=FILTER_POINT );
+				    cudaFilterMode filter=FILTER_POINT, cudaStream_t stream=NULL );
 
 /**
  * Rescale a float4 RGBA/BGRA image on the GPU.
  * To use bilinear filtering for upscaling, set filter to FILTER_LINEAR.
  * If the image is being downscaled, or if FILTER_POINT is set (default),
  * then nearest-neighbor sampling will be used instead.
+ * For antialiased downscaling, set filter to FILTER_AREA (area-averaging).
+ * For sharper upscaling, set filter to FILTER_CUBIC (bicubic).
  * @ingroup resize
  */
 cudaError_t cudaResize( float4* input,  size_t inputWidth,  size_t inputHeight,
 				    float4* output, size_t outputWidth, size_t outputHeight,
-				    cudaFilterMode filter=FILTER_POINT );
+				    cudaFilterMode filter=FILTER_POINT, cudaStream_t stream=NULL );
 
 /**
- * Rescale an image on the GPU (supports grayscale, RGB/BGR, RGBA/BGRA)
+ * Rescale an image on the GPU (supports grayscale, RGB/BGR, RGBA/BGRA, and
+ * the planar/FP16 tensor formats RGB32F_PLANAR, RGB16F_PLANAR, RGB16F, RGBA16F)
  * To use bilinear filtering for upscaling, set filter to FILTER_LINEAR.
  * If the image is being downscaled, or if FILTER_POINT is set (default),
  * then nearest-neighbor sampling will be used instead.
+ * For antialiased downscaling, set filter to FILTER_AREA (area-averaging).
+ * For sharper upscaling, set filter to FILTER_CUBIC (bicubic).
+ *
+ * With FILTER_LINEAR and FILTER_CUBIC, gray8, gray32f, rgba8 and rgba32f images are
+ * sampled through a texture object, so the interpolation is done by the texture hardware
+ * (the other formats, or buffers that don't meet the texture alignment, are filtered in software).
  * @ingroup resize
  */
 cudaError_t cudaResize( void* input,  size_t inputWidth,  size_t inputHeight,
 				    void* output, size_t outputWidth, size_t outputHeight, 
-				    imageFormat format, cudaFilterMode filter=FILTER_POINT );
+				    imageFormat format, cudaFilterMode filter=FILTER_POINT, cudaStream_t stream=NULL );
+
+/**
+ * Rescale a pitched image on the GPU (supports grayscale, RGB/BGR, and RGBA/BGRA).
+ * The input and output pitches are the size of each row in bytes, which can be larger
+ * than `width * bytesPerPixel` (for example with memory from cudaMallocPitch() or
+ * decoder surfaces), so the image doesn't first need to be repacked.
+ * The filtering behaves the same as the other versions of cudaResize().
+ * @ingroup resize
+ */
+cudaError_t cudaResize( void* input,  size_t inputWidth,  size_t inputHeight,  size_t inputPitch,
+				    void* output, size_t outputWidth, size_t outputHeight, size_t outputPitch,
+				    imageFormat format, cudaFilterMode filter=FILTER_POINT, cudaStream_t stream=NULL );
+
+/**
+ * Rescale a region of interest (ROI) of the input image into a ROI of the output image on the GPU,
+ * and optionally fill the rest of the output image with a border color, all in a single kernel.
+ * This can be used for letterboxing (see cudaResizeLetterbox()) or for crop-resizing into an
+ * arbitrary rectangle of the output, without the temporary buffers of cudaCrop() and cudaOverlay().
+ *
+ * The ROI's are `int4` rectangles of the form `(left, top, right, bottom)` like cudaCrop(),
+ * and must be inside their images.  The filtering behaves the same as the other versions
+ * of cudaResize() (supports grayscale, RGB/BGR, and RGBA/BGRA).
+ *
+ * @param fill color of the output pixels outside of outputROI (in the range of the format,
+ *             so 0-255 for uint8 formats), or NULL to leave those pixels unchanged.
+ * @ingroup resize
+ */
+cudaError_t cudaResize( void* input,  size_t inputWidth,  size_t inputHeight,  const int4& inputROI,
+				    void* output, size_t outputWidth, size_t outputHeight, const int4& outputROI,
+				    imageFormat format, cudaFilterMode filter=FILTER_POINT, const float4* fill=NULL, 
+				    cudaStream_t stream=NULL );
+
+/**
+ * Rescale an image to fit inside the output image while preserving its aspect ratio,
+ * centering it and filling the unused borders of the output with the fill color
+ * (which is commonly used to prepare the input of DNN models).  This is done in a
+ * single pass with the ROI version of cudaResize().
+ *
+ * @param fill color of the borders (in the range of the format, so 0-255 for uint8 formats)
+ * @param outputROI if not NULL, returns the `(left, top, right, bottom)` rectangle that
+ *                  the image was scaled into, for mapping coordinates back to the input.
+ * @ingroup resize
+ */
+cudaError_t cudaResizeLetterbox( void* input,  size_t inputWidth,  size_t inputHeight,
+					        void* output, size_t outputWidth, size_t outputHeight,
+					        imageFormat format, cudaFilterMode filter=FILTER_LINEAR,
+					        const float4& fill=make_float4(0,0,0,0), int4* outputROI=NULL,
+					        cudaStream_t stream=NULL );
 
 #endif
 
@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaStereo.h"
+#include "cudaMemoryPool.h"
+
+#include "logging.h"
+#include "cudaNVTX.h"
+
+
+// the census window is 9x7 (which fits in 64 bits without the center pixel)
+#define CENSUS_RADIUS_X 4
+#define CENSUS_RADIUS_Y 3
+
+// the cost given to disparities that reach past the edge of the right image
+#define CENSUS_MAX_COST 64
+
+// padding of the aggregation's disparity range (bigger than any cost plus penalty)
+#define SGM_INFINITY 0x3FFFFFFF
+
+
+// luminance of the input pixels
+inline __device__ float stereoLuma( const uint8_t& px )	{ return px; }
+inline __device__ float stereoLuma( const float& px )	{ return px; }
+inline __device__ float stereoLuma( const uchar3& px )	{ return 0.299f * px.x + 0.587f * px.y + 0.114f * px.z; }
+inline __device__ float stereoLuma( const uchar4& px )	{ return 0.299f * px.x + 0.587f * px.y + 0.114f * px.z; }
+inline __device__ float stereoLuma( const float3& px )	{ return 0.299f * px.x + 0.587f * px.y + 0.114f * px.z; }
+inline __device__ float stereoLuma( const float4& px )	{ return 0.299f * px.x + 0.587f * px.y + 0.114f * px.z; }
+
+
+// gpuCensus
+template<typename T>
+__global__ void gpuCensus( T* input, uint64_t* output, int width, int height )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const float center = stereoLuma(input[y * width + x]);
+	uint64_t census = 0;
+
+	for( int j=-CENSUS_RADIUS_Y; j <= CENSUS_RADIUS_Y; j++ )
+	{
+		const int yy = min(max(y + j, 0), height - 1);
+
+		for( int i=-CENSUS_RADIUS_X; i <= CENSUS_RADIUS_X; i++ )
+		{
+			if( i == 0 && j == 0 )
+				continue;
+
+			const int xx = min(max(x + i, 0), width - 1);
+			census = (census << 1) | (stereoLuma(input[yy * width + xx]) < center);
+		}
+	}
+
+	output[y * width + x] = census;
+}
+
+
+// gpuStereoCost (the Hamming distance between the census of the left pixel and the right pixel d to its left)
+__global__ void gpuStereoCost( const uint64_t* left, const uint64_t* right, uint8_t* cost, int width, int height, int maxDisparity )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const uint64_t census = left[y * width + x];
+	uint8_t* out = cost + (size_t(y) * width + x) * maxDisparity;
+
+	for( int d=0; d < maxDisparity; d++ )
+		out[d] = (x - d >= 0) ? __popcll(census ^ right[y * width + x - d]) : CENSUS_MAX_COST;
+}
+
+
+// gpuStereoAggregate (one block per path through the image, with a thread for each disparity)
+__global__ void gpuStereoAggregate( const uint8_t* cost, uint16_t* sum, int width, int height, int maxDisparity,
+							 int dx, int dy, int P1, int P2 )
+{
+	__shared__ int prev[CUDA_STEREO_MAX_DISPARITY + 2];	// the previous pixel's costs (padded on both sides)
+	__shared__ int warpMin[CUDA_STEREO_MAX_DISPARITY / 32];
+
+	const int d = threadIdx.x;
+	const int line = blockIdx.x;
+	const int numWarps = maxDisparity / 32;
+
+	// the paths start on the image borders that they point away from
+	const int x0 = (dx >= 0) ? 0 : width - 1;
+	const int y0 = (dy >= 0) ? 0 : height - 1;
+
+	int x, y;
+
+	if( dy == 0 )
+	{
+		x = x0;
+		y = line;
+	}
+	else if( dx == 0 || line < width )
+	{
+		x = line;
+		y = y0;
+	}
+	else
+	{
+		x = x0;
+		y = y0 + dy * (line - width + 1);
+	}
+
+	// the first pixel of the path just takes its own cost
+	prev[d + 1] = 0;
+
+	if( d == 0 )
+	{
+		prev[0] = SGM_INFINITY;
+		prev[maxDisparity + 1] = SGM_INFINITY;
+	}
+
+	int prevMin = 0;
+	__syncthreads();
+
+	while( x >= 0 && x < width && y >= 0 && y < height )
+	{
+		const size_t idx = (size_t(y) * width + x) * maxDisparity + d;
+
+		const int L = cost[idx] + min(min(prev[d + 1], prevMin + P2), min(prev[d], prev[d + 2]) + P1) - prevMin;
+
+		sum[idx] += L;
+
+		// the minimum over the disparities, for the next pixel
+		int m = L;
+
+		for( int offset=16; offset > 0; offset >>= 1 )
+			m = min(m, __shfl_xor_sync(0xFFFFFFFF, m, offset));
+
+		__syncthreads();	// everyone is done reading prev
+
+		prev[d + 1] = L;
+
+		if( (d & 31) == 0 )
+			warpMin[d >> 5] = m;
+
+		__syncthreads();
+
+		prevMin = warpMin[0];
+
+		for( int n=1; n < numWarps; n++ )
+			prevMin = min(prevMin, warpMin[n]);
+
+		x += dx;
+		y += dy;
+	}
+}
+
+
+// gpuStereoSelectLeft (winner-takes-all with a parabola fit around the minimum)
+__global__ void gpuStereoSelectLeft( const uint16_t* sum, float* disparity, int width, int height, int maxDisparity )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const uint16_t* S = sum + (size_t(y) * width + x) * maxDisparity;
+	const int range = min(maxDisparity, x + 1);
+
+	int best = 0;
+
+	for( int d=1; d < range; d++ )
+	{
+		if( S[d] < S[best] )
+			best = d;
+	}
+
+	float result = best;
+
+	if( best > 0 && best < range - 1 )
+	{
+		const int denom = S[best - 1] + S[best + 1] - 2 * S[best];
+
+		if( denom > 0 )
+			result += float(S[best - 1] - S[best + 1]) / (2.0f * denom);
+	}
+
+	disparity[y * width + x] = result;
+}
+
+
+// gpuStereoSelectRight (the disparity of the right pixels, using the costs of the left pixels that map to them)
+__global__ void gpuStereoSelectRight( const uint16_t* sum, uint16_t* disparity, int width, int height, int maxDisparity )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const uint16_t* S = sum + (size_t(y) * width + x) * maxDisparity;
+	const int range = min(maxDisparity, width - x);
+
+	int best = 0;
+	int bestCost = S[0];
+
+	for( int d=1; d < range; d++ )
+	{
+		const int c = S[d * maxDisparity + d];	// the left pixel x+d at disparity d
+
+		if( c < bestCost )
+		{
+			best = d;
+			bestCost = c;
+		}
+	}
+
+	disparity[y * width + x] = best;
+}
+
+
+// gpuStereoCheck (invalidate the pixels where the left and right disparities disagree)
+__global__ void gpuStereoCheck( float* disparity, const uint16_t* right, int width, int height, float threshold )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const float d = disparity[y * width + x];
+
+	if( d <= 0.0f )
+		return;
+
+	const int xr = int(x - d + 0.5f);
+
+	if( xr < 0 || fabsf(right[y * width + xr] - d) > threshold )
+		disparity[y * width + x] = 0.0f;
+}
+
+
+// launchStereoSGM
+template<typename T>
+static cudaError_t launchStereoSGM( T* left, T* right, int width, int height, float* disparity, 
+							 int maxDisparity, int P1, int P2, int paths, float lrThreshold, cudaStream_t stream )
+{
+	const size_t numPixels = size_t(width) * height;
+
+	// scratch memory for the census transforms, the cost volume, the aggregated costs, and the right disparity
+	uint64_t* census = NULL;
+	uint8_t*  cost = NULL;
+	uint16_t* sum = NULL;
+	uint16_t* rightDisparity = NULL;
+
+	if( !cudaMallocPooled((void**)&census, numPixels * 2 * sizeof(uint64_t)) ||
+	    !cudaMallocPooled((void**)&cost, numPixels * maxDisparity * sizeof(uint8_t)) ||
+	    !cudaMallocPooled((void**)&sum, numPixels * maxDisparity * sizeof(uint16_t)) ||
+	    (lrThreshold >= 0.0f && !cudaMallocPooled((void**)&rightDisparity, numPixels * sizeof(uint16_t))) )
+	{
+		cudaFreePooled(census);
+		cudaFreePooled(cost);
+		cudaFreePooled(sum);
+		return cudaErrorMemoryAllocation;
+	}
+
+	const dim3 blockDim(32, 8);
+	const dim3 gridDim(iDivUp(width, blockDim.x), iDivUp(height, blockDim.y));
+
+	gpuCensus<T><<<gridDim, blockDim, 0, stream>>>(left, census, width, height);
+	gpuCensus<T><<<gridDim, blockDim, 0, stream>>>(right, census + numPixels, width, height);
+	gpuStereoCost<<<gridDim, blockDim, 0, stream>>>(census, census + numPixels, cost, width, height, maxDisparity);
+
+	CUDA(cudaMemsetAsync(sum, 0, numPixels * maxDisparity * sizeof(uint16_t), stream));
+
+	// the horizontal and vertical paths, followed by the diagonals
+	const int2 directions[] = { {1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {-1,1}, {1,-1}, {-1,-1} };
+
+	for( int n=0; n < paths; n++ )
+	{
+		const int dx = directions[n].x;
+		const int dy = directions[n].y;
+
+		const int lines = (dy == 0) ? height : (dx == 0) ? width : (width + height - 1);
+
+		gpuStereoAggregate<<<lines, maxDisparity, 0, stream>>>(cost, sum, width, height, maxDisparity, dx, dy, P1, P2);
+	}
+
+	gpuStereoSelectLeft<<<gridDim, blockDim, 0, stream>>>(sum, disparity, width, height, maxDisparity);
+
+	if( lrThreshold >= 0.0f )
+	{
+		gpuStereoSelectRight<<<gridDim, blockDim, 0, stream>>>(sum, rightDisparity, width, height, maxDisparity);
+		gpuStereoCheck<<<gridDim, blockDim, 0, stream>>>(disparity, rightDisparity, width, height, lrThreshold);
+	}
+
+	// the pool doesn't hand the blocks out again until the kernels are done with them
+	cudaFreePooled(census, stream);
+	cudaFreePooled(cost, stream);
+	cudaFreePooled(sum, stream);
+	cudaFreePooled(rightDisparity, stream);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaStereoSGM
+cudaError_t cudaStereoSGM( void* left, void* right, uint32_t width, uint32_t height, imageFormat format,
+					  float* disparity, uint32_t maxDisparity, uint32_t P1, uint32_t P2,
+					  uint32_t paths, float lrThreshold, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaStereoSGM");
+
+	if( !left || !right || !disparity )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( maxDisparity == 0 || maxDisparity > CUDA_STEREO_MAX_DISPARITY || (maxDisparity % 32) != 0 )
+	{
+		LogError(LOG_CUDA "cudaStereoSGM() -- maxDisparity must be a multiple of 32 up to %i (was %u)\n", CUDA_STEREO_MAX_DISPARITY, maxDisparity);
+		return cudaErrorInvalidValue;
+	}
+
+	if( paths != 4 && paths != 8 )
+	{
+		LogError(LOG_CUDA "cudaStereoSGM() -- paths must be 4 or 8 (was %u)\n", paths);
+		return cudaErrorInvalidValue;
+	}
+
+	// keep the aggregated costs within 16 bits
+	if( P1 > P2 || (CENSUS_MAX_COST + P2) * paths > 0xFFFF )
+	{
+		LogError(LOG_CUDA "cudaStereoSGM() -- invalid penalties (P1=%u P2=%u)\n", P1, P2);
+		return cudaErrorInvalidValue;
+	}
+
+	#define LAUNCH_STEREO_SGM(type) \
+		launchStereoSGM<type>((type*)left, (type*)right, width, height, disparity, maxDisparity, P1, P2, paths, lrThreshold, stream)
+
+	if( format == IMAGE_GRAY8 )
+		return LAUNCH_STEREO_SGM(uint8_t);
+	else if( format == IMAGE_GRAY32F )
+		return LAUNCH_STEREO_SGM(float);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		return LAUNCH_STEREO_SGM(uchar3);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		return LAUNCH_STEREO_SGM(uchar4);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		return LAUNCH_STEREO_SGM(float3);
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		return LAUNCH_STEREO_SGM(float4);
+
+	imageFormatErrorMsg(LOG_CUDA, "cudaStereoSGM()", format);
+	return cudaErrorInvalidValue;
+}
+
+
+// gpuDisparityToDepth
+__global__ void gpuDisparityToDepth( float* disparity, float* depth, int width, int height, float scale )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const float d = disparity[y * width + x];
+	depth[y * width + x] = (d > 0.0f) ? scale / d : 0.0f;
+}
+
+
+// cudaDisparityToDepth
+cudaError_t cudaDisparityToDepth( float* disparity, float* depth, uint32_t width, uint32_t height,
+						    float focalLength, float baseline, cudaStream_t stream )
+{
+	if( !disparity || !depth )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const dim3 blockDim(32, 8);
+	const dim3 gridDim(iDivUp(width, blockDim.x), iDivUp(height, blockDim.y));
+
+	gpuDisparityToDepth<<<gridDim, blockDim, 0, stream>>>(disparity, depth, width, height, focalLength * baseline);
+
+	return CUDA(cudaGetLastError());
+}
+
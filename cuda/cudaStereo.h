@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_STEREO_H__
+#define __CUDA_STEREO_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * The maximum number of disparities that cudaStereoSGM() can search.
+ * @ingroup cuda
+ */
+#define CUDA_STEREO_MAX_DISPARITY 256
+
+
+/**
+ * Compute the disparity between a rectified stereo pair with semi-global matching (SGM).
+ *
+ * The matching cost is the Hamming distance between 9x7 census transforms of the left and
+ * right images, which is robust to the exposure and gain differences between the cameras.
+ * The costs are aggregated along 4 or 8 paths (horizontal, vertical, and the diagonals),
+ * with a penalty of `P1` for disparity changes of one pixel and `P2` for larger jumps.
+ * The winning disparity gets a sub-pixel refinement by fitting a parabola to its neighbors.
+ *
+ * With the left-right check enabled, the disparity is also computed from the right image's
+ * point of view, and the pixels where the two disagree by more than `lrThreshold` (which are
+ * mostly occlusions and mismatches) are invalidated.  Invalid pixels have a disparity of 0.
+ *
+ * The images should already be rectified (for example with cudaRemap()), so that the
+ * matches are on the same row and the right image is shifted to the left.  They can be
+ * gray8, gray32f, or RGB/BGR/RGBA/BGRA in uint8 or float (only the luminance gets used).
+ *
+ * @note the cost volume takes `width * height * maxDisparity * 3` bytes of scratch memory
+ *       from the memory pool, so use the lowest `maxDisparity` that covers the scene.
+ *
+ * @param left the left image of the pair (in GPU memory)
+ * @param right the right image of the pair (in GPU memory)
+ * @param disparity the output disparity map in pixels (`width * height` floats in GPU memory)
+ * @param maxDisparity the number of disparities to search, a multiple of 32 up to CUDA_STEREO_MAX_DISPARITY
+ * @param P1 the penalty for a disparity change of one pixel between neighbors
+ * @param P2 the penalty for a disparity change of more than one pixel between neighbors
+ * @param paths the number of aggregation paths (either 4 or 8)
+ * @param lrThreshold the maximum disagreement (in pixels) of the left-right check, or a negative value to disable it
+ * @param stream CUDA stream to launch the kernels on (the default stream is used if NULL)
+ * @ingroup cuda
+ */
+cudaError_t cudaStereoSGM( void* left, void* right, uint32_t width, uint32_t height, imageFormat format,
+					  float* disparity, uint32_t maxDisparity=64, uint32_t P1=10, uint32_t P2=120,
+					  uint32_t paths=8, float lrThreshold=1.0f, cudaStream_t stream=NULL );
+
+/**
+ * Compute the disparity between a rectified stereo pair with semi-global matching (SGM).
+ * @see the untemplated version of cudaStereoSGM() for a description of the parameters.
+ * @ingroup cuda
+ */
+template<typename T> cudaError_t cudaStereoSGM( T* left, T* right, uint32_t width, uint32_t height,
+							    float* disparity, uint32_t maxDisparity=64, uint32_t P1=10, uint32_t P2=120,
+							    uint32_t paths=8, float lrThreshold=1.0f, cudaStream_t stream=NULL )
+{
+	return cudaStereoSGM((void*)left, (void*)right, width, height, imageFormatFromType<T>(), disparity, maxDisparity, P1, P2, paths, lrThreshold, stream);
+}
+
+/**
+ * Convert a disparity map to depth with `depth = focalLength * baseline / disparity`.
+ *
+ * The depth is in the units of the baseline, and the invalid pixels (where the disparity is 0)
+ * get a depth of 0.  The output can be passed directly to cudaPointCloud::Extract() along
+ * with the left camera's intrinsics in cudaPointCloud::SetCalibration().
+ *
+ * @param disparity the disparity map from cudaStereoSGM() (in GPU memory)
+ * @param depth the output depth map (`width * height` floats in GPU memory, can be the same as `disparity`)
+ * @param focalLength the horizontal focal length of the rectified cameras (in pixels)
+ * @param baseline the distance between the camera centers (e.g. in meters)
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
+ * @ingroup cuda
+ */
+cudaError_t cudaDisparityToDepth( float* disparity, float* depth, uint32_t width, uint32_t height,
+						    float focalLength, float baseline, cudaStream_t stream=NULL );
+
+
+#endif
+
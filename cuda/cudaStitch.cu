@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaStitch.h"
+#include "cudaFilterMode.cuh"
+#include "logging.h"
+#include "cudaNVTX.h"
+
+
+// the inputs get passed to the kernel by value
+struct cudaStitchParams
+{
+	void*         images[CUDA_STITCH_MAX_INPUTS];
+	int           widths[CUDA_STITCH_MAX_INPUTS];
+	int           heights[CUDA_STITCH_MAX_INPUTS];
+	const float2* maps[CUDA_STITCH_MAX_INPUTS];
+	const float*  masks[CUDA_STITCH_MAX_INPUTS];
+	int           count;
+};
+
+
+// gpuStitch
+template<typename T, cudaFilterMode filter>
+__global__ void gpuStitch( cudaStitchParams params, T* output, int outputWidth, int outputHeight )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const int idx = y * outputWidth + x;
+
+	typename cudaFilterAccum<T>::Type sum = typename cudaFilterAccum<T>::Type();
+	float weight = 0.0f;
+
+	for( int n=0; n < params.count; n++ )
+	{
+		const float2 uv = params.maps[n][idx];
+
+		const int u = uv.x;
+		const int v = uv.y;
+
+		if( u < 0 || v < 0 || u >= params.widths[n] || v >= params.heights[n] )
+			continue;
+
+		const float w = params.masks[n] != NULL ? params.masks[n][idx] : 1.0f;
+
+		if( w <= 0.0f )
+			continue;
+
+		T* input = (T*)params.images[n];
+		T px;
+
+		if( filter == FILTER_POINT )
+			px = input[v * params.widths[n] + u];
+		else
+			px = cudaFilterPixel<FILTER_LINEAR>(input, uv.x + 0.5f, uv.y + 0.5f, params.widths[n], params.heights[n]);
+
+		sum += cudaFilterAccum<T>::load(px) * w;
+		weight += w;
+	}
+
+	if( weight > 0.0f )
+		output[idx] = cudaFilterAccum<T>::store(sum / weight);
+}
+
+
+// cudaStitch
+cudaError_t cudaStitch( const cudaStitchInput* inputs, uint32_t numInputs,
+				    void* output, uint32_t outputWidth, uint32_t outputHeight, imageFormat format,
+				    cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaStitch");
+
+	if( !inputs || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( numInputs == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( numInputs > CUDA_STITCH_MAX_INPUTS )
+	{
+		LogError(LOG_CUDA "cudaStitch() -- %u inputs exceeds the maximum of %u (CUDA_STITCH_MAX_INPUTS)\n", numInputs, CUDA_STITCH_MAX_INPUTS);
+		return cudaErrorInvalidValue;
+	}
+
+	cudaStitchParams params;
+	params.count = numInputs;
+
+	for( uint32_t n=0; n < numInputs; n++ )
+	{
+		if( !inputs[n].image || !inputs[n].map || inputs[n].width == 0 || inputs[n].height == 0 )
+		{
+			LogError(LOG_CUDA "cudaStitch() -- input %u is missing its image, map, or dimensions\n", n);
+			return cudaErrorInvalidValue;
+		}
+
+		params.images[n]  = inputs[n].image;
+		params.widths[n]  = inputs[n].width;
+		params.heights[n] = inputs[n].height;
+		params.maps[n]    = inputs[n].map;
+		params.masks[n]   = inputs[n].mask;
+	}
+
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+	#define LAUNCH_STITCH(type) \
+		if( filter == FILTER_POINT ) \
+			gpuStitch<type, FILTER_POINT><<<gridDim, blockDim, 0, stream>>>(params, (type*)output, outputWidth, outputHeight); \
+		else \
+			gpuStitch<type, FILTER_LINEAR><<<gridDim, blockDim, 0, stream>>>(params, (type*)output, outputWidth, outputHeight)
+
+	if( format == IMAGE_RGB8 )
+		LAUNCH_STITCH(uchar3);
+	else if( format == IMAGE_RGBA8 )
+		LAUNCH_STITCH(uchar4);
+	else if( format == IMAGE_RGB32F )
+		LAUNCH_STITCH(float3); 
+	else if( format == IMAGE_RGBA32F )
+		LAUNCH_STITCH(float4);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaStitch()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// gpuStitchMask
+__global__ void gpuStitchMask( const float2* map, int inputWidth, int inputHeight,
+						 float* mask, int outputWidth, int outputHeight, float feather )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const int idx = y * outputWidth + x;
+	const float2 uv = map[idx];
+
+	// distance to the nearest edge of the input image
+	const float dx = fminf(uv.x + 0.5f, inputWidth - 0.5f - uv.x);
+	const float dy = fminf(uv.y + 0.5f, inputHeight - 0.5f - uv.y);
+	const float d  = fminf(dx, dy);
+
+	mask[idx] = fminf(fmaxf(d / feather, 0.0f), 1.0f);
+}
+
+
+// cudaStitchMask
+cudaError_t cudaStitchMask( const float2* map, uint32_t inputWidth, uint32_t inputHeight,
+					   float* mask, uint32_t outputWidth, uint32_t outputHeight,
+					   float feather, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaStitchMask");
+
+	if( !map || !mask )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || inputHeight == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( feather < 1.0f )
+		feather = 1.0f;
+
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+	gpuStitchMask<<<gridDim, blockDim, 0, stream>>>(map, inputWidth, inputHeight, mask, outputWidth, outputHeight, feather);
+
+	return CUDA(cudaGetLastError());
+}
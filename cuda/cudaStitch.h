@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_STITCH_H__
+#define __CUDA_STITCH_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+#include "cudaFilterMode.h"
+
+
+/**
+ * The maximum number of images that cudaStitch() can combine in one pass.
+ * @ingroup warping
+ */
+#define CUDA_STITCH_MAX_INPUTS 8
+
+
+/**
+ * One of the camera images that gets stitched into the panorama by cudaStitch().
+ * @ingroup warping
+ */
+struct cudaStitchInput
+{
+	void*         image;	/**< The input image (in GPU-accessible memory) */
+	uint32_t      width;	/**< Width of the input image */
+	uint32_t      height;	/**< Height of the input image */
+	const float2* map;		/**< For each panorama pixel, the coordinates in this image to sample (see cudaRemap()) */
+	const float*  mask;		/**< For each panorama pixel, the blending weight of this image (or NULL for 1.0) */
+};
+
+
+/**
+ * Stitch multiple images into one panorama in a single pass.
+ *
+ * Each input has a lookup table that's the size of the panorama, which holds the
+ * coordinates of the input pixel to sample for each panorama pixel (these can be
+ * made with the cudaWarpMap functions from cudaWarp.h, or exported from a calibration
+ * tool).  Panorama pixels whose coordinates fall outside of an input aren't covered by
+ * that input.  Where multiple inputs overlap, they are blended by their mask weights,
+ * which can be generated with cudaStitchMask() to feather the seams.  Panorama pixels
+ * that none of the inputs cover are left unchanged.
+ *
+ * All of the inputs and the output should have the same format, which can be rgb8,
+ * rgba8, rgb32f, or rgba32f.
+ *
+ * @param inputs array of the inputs to stitch (up to CUDA_STITCH_MAX_INPUTS)
+ * @param numInputs the number of inputs in the array
+ * @param filter FILTER_POINT or FILTER_LINEAR
+ * @ingroup warping
+ */
+cudaError_t cudaStitch( const cudaStitchInput* inputs, uint32_t numInputs,
+				    void* output, uint32_t outputWidth, uint32_t outputHeight, imageFormat format,
+				    cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+
+/**
+ * Generate the blending mask of a stitching input from its lookup table.
+ *
+ * The weight ramps from 0 at the edges of the input image up to 1 at `feather` pixels
+ * inside of the edges, so that the seams between overlapping inputs are feathered.
+ * Panorama pixels that the input doesn't cover have a weight of 0.
+ *
+ * @param map the input's lookup table (with outputWidth * outputHeight entries)
+ * @param inputWidth width of the input image
+ * @param inputHeight height of the input image
+ * @param mask the output mask (in GPU memory, with outputWidth * outputHeight entries)
+ * @param feather the width of the blending region (in input pixels)
+ * @ingroup warping
+ */
+cudaError_t cudaStitchMask( const float2* map, uint32_t inputWidth, uint32_t inputHeight,
+					   float* mask, uint32_t outputWidth, uint32_t outputHeight,
+					   float feather=32.0f, cudaStream_t stream=NULL );
+
+
+#endif
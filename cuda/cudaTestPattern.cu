@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaTestPattern.h"
+#include "cudaVector.h"
+#include "cudaNVTX.h"
+
+#include "logging.h"
+
+#include <strings.h>
+
+
+// cudaTestPatternFromStr
+cudaTestPatternType cudaTestPatternFromStr( const char* str, cudaTestPatternType default_value )
+{
+	if( !str )
+		return default_value;
+
+	if( strcasecmp(str, "bars") == 0 || strcasecmp(str, "pattern") == 0 )
+		return TEST_PATTERN_BARS;
+	else if( strcasecmp(str, "gradient") == 0 )
+		return TEST_PATTERN_GRADIENT;
+	else if( strcasecmp(str, "checkerboard") == 0 || strcasecmp(str, "checkers") == 0 )
+		return TEST_PATTERN_CHECKERBOARD;
+	else if( strcasecmp(str, "noise") == 0 )
+		return TEST_PATTERN_NOISE;
+	else if( strcasecmp(str, "solid") == 0 )
+		return TEST_PATTERN_SOLID;
+
+	return default_value;
+}
+
+
+// cudaTestPatternToStr
+const char* cudaTestPatternToStr( cudaTestPatternType pattern )
+{
+	switch(pattern)
+	{
+		case TEST_PATTERN_BARS:		return "bars";
+		case TEST_PATTERN_GRADIENT:	return "gradient";
+		case TEST_PATTERN_CHECKERBOARD:	return "checkerboard";
+		case TEST_PATTERN_NOISE:		return "noise";
+		case TEST_PATTERN_SOLID:		return "solid";
+	}
+
+	return "bars";
+}
+
+
+// hash used for the noise pattern
+__device__ inline uint32_t testPatternHash( uint32_t x )
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+// convert a hue in [0,6) to RGB in [0,255]
+__device__ inline float3 testPatternHue( float h )
+{
+	const float r = fminf(fmaxf(fabsf(h - 3.0f) - 1.0f, 0.0f), 1.0f);
+	const float g = fminf(fmaxf(2.0f - fabsf(h - 2.0f), 0.0f), 1.0f);
+	const float b = fminf(fmaxf(2.0f - fabsf(h - 4.0f), 0.0f), 1.0f);
+
+	return make_float3(r * 255.0f, g * 255.0f, b * 255.0f);
+}
+
+// compute the color of a pixel in the pattern
+__device__ inline float3 testPatternColor( int x, int y, int width, int height, cudaTestPatternType pattern, uint32_t frame )
+{
+	switch(pattern)
+	{
+		case TEST_PATTERN_BARS:
+		{
+			// SMPTE-style 75% bars:  white, yellow, cyan, green, magenta, red, blue
+			const float3 bars[] = { {191,191,191}, {191,191,0}, {0,191,191}, {0,191,0}, {191,0,191}, {191,0,0}, {0,0,191} };
+			const int bar = (((x + frame * 2) % width) * 7) / width;
+			return bars[bar];
+		}
+		case TEST_PATTERN_GRADIENT:
+		{
+			const float u = float(x) / width;
+			const float v = float(y) / height;
+			const float t = (frame % 256) / 256.0f;
+			return make_float3(fmodf(u + t, 1.0f) * 255.0f, v * 255.0f, fmodf(u + v + t, 1.0f) * 127.5f);
+		}
+		case TEST_PATTERN_CHECKERBOARD:
+		{
+			const int size = max(width / 16, 1);
+			const int checker = (((x + frame) / size) + ((y + frame) / size)) & 1;
+			return checker ? make_float3(255,255,255) : make_float3(0,0,0);
+		}
+		case TEST_PATTERN_NOISE:
+		{
+			const uint32_t h = testPatternHash((y * width + x) ^ testPatternHash(frame));
+			return make_float3(h & 0xFF, (h >> 8) & 0xFF, (h >> 16) & 0xFF);
+		}
+		case TEST_PATTERN_SOLID:
+			return testPatternHue((frame % 360) / 60.0f);
+	}
+
+	return make_float3(0,0,0);
+}
+
+
+// gpuTestPattern
+template<typename T, bool isBGR>
+__global__ void gpuTestPattern( T* output, int width, int height, cudaTestPatternType pattern, uint32_t frame )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const float3 px = testPatternColor(x, y, width, height, pattern, frame);
+
+	if( isBGR )
+		output[y * width + x] = make_vec<T>(px.z, px.y, px.x, 255);
+	else
+		output[y * width + x] = make_vec<T>(px.x, px.y, px.z, 255);
+}
+
+// gpuTestPatternGray
+template<typename T>
+__global__ void gpuTestPatternGray( T* output, int width, int height, cudaTestPatternType pattern, uint32_t frame, float scale )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	const float3 px = testPatternColor(x, y, width, height, pattern, frame);
+	output[y * width + x] = (T)((px.x * 0.2989f + px.y * 0.5870f + px.z * 0.1140f) * scale);
+}
+
+// launchTestPattern
+template<typename T, bool isBGR>
+static cudaError_t launchTestPattern( T* output, size_t width, size_t height, cudaTestPatternType pattern, uint64_t frame, cudaStream_t stream )
+{
+	const dim3 blockDim(32,8);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+
+	gpuTestPattern<T, isBGR><<<gridDim, blockDim, 0, stream>>>(output, width, height, pattern, (uint32_t)frame);
+
+	return CUDA(cudaGetLastError());
+}
+
+// launchTestPatternGray
+template<typename T>
+static cudaError_t launchTestPatternGray( T* output, size_t width, size_t height, cudaTestPatternType pattern, uint64_t frame, cudaStream_t stream, float scale=1.0f )
+{
+	const dim3 blockDim(32,8);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+
+	gpuTestPatternGray<T><<<gridDim, blockDim, 0, stream>>>(output, width, height, pattern, (uint32_t)frame, scale);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaTestPattern
+cudaError_t cudaTestPattern( void* output, size_t width, size_t height, imageFormat format, 
+					    cudaTestPatternType pattern, uint64_t frame, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaTestPattern");
+
+	if( !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	switch(format)
+	{
+		case IMAGE_RGB8:	return launchTestPattern<uchar3, false>((uchar3*)output, width, height, pattern, frame, stream);
+		case IMAGE_BGR8:	return launchTestPattern<uchar3, true>((uchar3*)output, width, height, pattern, frame, stream);
+		case IMAGE_RGBA8:	return launchTestPattern<uchar4, false>((uchar4*)output, width, height, pattern, frame, stream);
+		case IMAGE_BGRA8:	return launchTestPattern<uchar4, true>((uchar4*)output, width, height, pattern, frame, stream);
+		case IMAGE_RGB32F:	return launchTestPattern<float3, false>((float3*)output, width, height, pattern, frame, stream);
+		case IMAGE_BGR32F:	return launchTestPattern<float3, true>((float3*)output, width, height, pattern, frame, stream);
+		case IMAGE_RGBA32F:	return launchTestPattern<float4, false>((float4*)output, width, height, pattern, frame, stream);
+		case IMAGE_BGRA32F:	return launchTestPattern<float4, true>((float4*)output, width, height, pattern, frame, stream);
+		case IMAGE_GRAY8:	return launchTestPatternGray<uint8_t>((uint8_t*)output, width, height, pattern, frame, stream);
+		case IMAGE_GRAY16:	return launchTestPatternGray<uint16_t>((uint16_t*)output, width, height, pattern, frame, stream, 65535.0f / 255.0f);
+		case IMAGE_GRAY32F:	return launchTestPatternGray<float>((float*)output, width, height, pattern, frame, stream);
+		default:			break;
+	}
+
+	LogError(LOG_CUDA "cudaTestPattern() -- invalid image format '%s'\n", imageFormatToStr(format));
+	LogError(LOG_CUDA "                     supported formats are:\n");
+	LogError(LOG_CUDA "                         * gray8, gray16, gray32f\n");
+	LogError(LOG_CUDA "                         * rgb8, bgr8, rgba8, bgra8\n");
+	LogError(LOG_CUDA "                         * rgb32f, bgr32f, rgba32f, bgra32f\n");
+
+	return cudaErrorInvalidValue;
+}
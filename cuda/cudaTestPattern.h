@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_TEST_PATTERN_H__
+#define __CUDA_TEST_PATTERN_H__
+
+
+#include "cudaUtility.h"
+#include "imageFormat.h"
+
+
+/**
+ * Enumeration of the synthetic test patterns that cudaTestPattern() can generate.
+ * @see cudaTestPatternFromStr() and cudaTestPatternToStr()
+ * @ingroup cuda
+ */
+enum cudaTestPatternType
+{
+	TEST_PATTERN_BARS,		/**< Vertical color bars that scroll horizontally */
+	TEST_PATTERN_GRADIENT,	/**< Diagonal color gradient that shifts over time */
+	TEST_PATTERN_CHECKERBOARD,	/**< Black and white checkerboard that moves diagonally */
+	TEST_PATTERN_NOISE,		/**< Random noise that changes every frame (worst case for encoders) */
+	TEST_PATTERN_SOLID,		/**< Solid color that cycles through the hues */
+
+	/**< Default pattern (bars) */
+	TEST_PATTERN_DEFAULT = TEST_PATTERN_BARS
+};
+
+/**
+ * Parse a cudaTestPatternType enum from a string.
+ * @returns The parsed cudaTestPatternType, or default_value on error.
+ * @ingroup cuda
+ */
+cudaTestPatternType cudaTestPatternFromStr( const char* pattern, cudaTestPatternType default_value=TEST_PATTERN_DEFAULT );
+
+/**
+ * Convert a cudaTestPatternType enum to a string.
+ * @ingroup cuda
+ */
+const char* cudaTestPatternToStr( cudaTestPatternType pattern );
+
+/**
+ * Generate frame number `frame` of an animated test pattern.
+ *
+ * The pattern moves with each frame, so that encoders and motion-dependent
+ * processing see realistic work.  Float formats are generated in the range `[0,255]`,
+ * and gray16 is scaled to the full 16-bit range.
+ *
+ * @param format the image format - valid formats are gray8, gray16, gray32f, rgb8/bgr8,
+ *               rgba8/bgra8, rgb32f/bgr32f, and rgba32f/bgra32f.  Other formats
+ *               can be generated in rgba8 and converted with cudaConvertColor().
+ * @param stream CUDA stream to launch the kernel on (the default stream is used if NULL)
+ * @ingroup cuda
+ */
+cudaError_t cudaTestPattern( void* output, size_t width, size_t height, imageFormat format,
+					    cudaTestPatternType pattern, uint64_t frame, cudaStream_t stream=NULL );
+
+
+#endif
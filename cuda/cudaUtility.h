@@ -31,6 +31,7 @@
 #include <stdint.h>
 
 #include "logging.h"
+#include "cudaMemoryStats.h"
 
 
 /**
@@ -117,7 +118,7 @@ inline cudaError_t cudaCheckError(cudaError_t retval, const char* txt, const cha
  * Check for non-NULL pointer before freeing it, and then set the pointer to NULL.
  * @ingroup cudaError
  */
-#define CUDA_FREE_HOST(x)	if(x != NULL) { cudaFreeHost(x); x = NULL; }
+#define CUDA_FREE_HOST(x)	if(x != NULL) { cudaMemoryUntrack(x); cudaFreeHost(x); x = NULL; }
 
 /**
  * Check for non-NULL pointer before deleting it, and then set the pointer to NULL.
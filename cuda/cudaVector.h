@@ -39,7 +39,7 @@
 
 ///@{
 
-// get base type (uint8 or float) from vector
+// get base type (uint8, float, or half) from vector
 template<class T> struct cudaVectorTypeInfo;
 
 template<> struct cudaVectorTypeInfo<uchar>  { typedef uint8_t Base; };
@@ -50,13 +50,17 @@ template<> struct cudaVectorTypeInfo<float>  { typedef float Base; };
 template<> struct cudaVectorTypeInfo<float3> { typedef float Base; };
 template<> struct cudaVectorTypeInfo<float4> { typedef float Base; };
 
+template<> struct cudaVectorTypeInfo<__half> { typedef __half Base; };
+template<> struct cudaVectorTypeInfo<half3>  { typedef __half Base; };
+template<> struct cudaVectorTypeInfo<half4>  { typedef __half Base; };
+
 
 // static compile-time assertion
 template<typename T> struct cuda_assert_false : std::false_type { };
 
 
 // make_vec<T> templates
-template<typename T> inline __host__ __device__ T make_vec( typename cudaVectorTypeInfo<T>::Base x, typename cudaVectorTypeInfo<T>::Base y, typename cudaVectorTypeInfo<T>::Base z, typename cudaVectorTypeInfo<T>::Base w )	{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4");  }
+template<typename T> inline __host__ __device__ T make_vec( typename cudaVectorTypeInfo<T>::Base x, typename cudaVectorTypeInfo<T>::Base y, typename cudaVectorTypeInfo<T>::Base z, typename cudaVectorTypeInfo<T>::Base w )	{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4, half3, half4");  }
 
 template<> inline __host__ __device__ uchar  make_vec( uint8_t x, uint8_t y, uint8_t z, uint8_t w )	{ return x; }
 template<> inline __host__ __device__ uchar3 make_vec( uint8_t x, uint8_t y, uint8_t z, uint8_t w )	{ return make_uchar3(x,y,z); }
@@ -66,36 +70,64 @@ template<> inline __host__ __device__ float  make_vec( float x, float y, float z
 template<> inline __host__ __device__ float3 make_vec( float x, float y, float z, float w )		{ return make_float3(x,y,z); }
 template<> inline __host__ __device__ float4 make_vec( float x, float y, float z, float w )		{ return make_float4(x,y,z,w); }
 
+template<> inline __host__ __device__ __half make_vec( __half x, __half y, __half z, __half w )	{ return x; }
+template<> inline __host__ __device__ half3  make_vec( __half x, __half y, __half z, __half w )	{ return make_half3(x,y,z); }
+template<> inline __host__ __device__ half4  make_vec( __half x, __half y, __half z, __half w )	{ return make_half4(x,y,z,w); }
+
 
 // cast_vec<T> templates
-template<typename T> inline __host__ __device__ T cast_vec( const uchar3& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4");  }
-template<typename T> inline __host__ __device__ T cast_vec( const uchar4& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4");  }
-template<typename T> inline __host__ __device__ T cast_vec( const float3& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4");  }
-template<typename T> inline __host__ __device__ T cast_vec( const float4& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4");  }
+template<typename T> inline __host__ __device__ T cast_vec( const uchar3& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4, half3, half4");  }
+template<typename T> inline __host__ __device__ T cast_vec( const uchar4& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4, half3, half4");  }
+template<typename T> inline __host__ __device__ T cast_vec( const float3& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4, half3, half4");  }
+template<typename T> inline __host__ __device__ T cast_vec( const float4& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4, half3, half4");  }
+template<typename T> inline __host__ __device__ T cast_vec( const half3& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4, half3, half4");  }
+template<typename T> inline __host__ __device__ T cast_vec( const half4& a )				{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4, half3, half4");  }
 
 template<> inline __host__ __device__ uchar3 cast_vec( const uchar3& a )					{ return make_uchar3(a); }
 template<> inline __host__ __device__ uchar4 cast_vec( const uchar3& a )					{ return make_uchar4(a); }
 template<> inline __host__ __device__ float3 cast_vec( const uchar3& a )					{ return make_float3(a); }
 template<> inline __host__ __device__ float4 cast_vec( const uchar3& a )					{ return make_float4(a); }
+template<> inline __host__ __device__ half3  cast_vec( const uchar3& a )					{ return make_half3(a); }
+template<> inline __host__ __device__ half4  cast_vec( const uchar3& a )					{ return make_half4(a); }
 
 template<> inline __host__ __device__ uchar3 cast_vec( const uchar4& a )					{ return make_uchar3(a); }
 template<> inline __host__ __device__ uchar4 cast_vec( const uchar4& a )					{ return make_uchar4(a); }
 template<> inline __host__ __device__ float3 cast_vec( const uchar4& a )					{ return make_float3(a); }
 template<> inline __host__ __device__ float4 cast_vec( const uchar4& a )					{ return make_float4(a); }
+template<> inline __host__ __device__ half3  cast_vec( const uchar4& a )					{ return make_half3(a); }
+template<> inline __host__ __device__ half4  cast_vec( const uchar4& a )					{ return make_half4(a); }
 
 template<> inline __host__ __device__ uchar3 cast_vec( const float3& a )					{ return make_uchar3(a); }
 template<> inline __host__ __device__ uchar4 cast_vec( const float3& a )					{ return make_uchar4(a); }
 template<> inline __host__ __device__ float3 cast_vec( const float3& a )					{ return make_float3(a); }
 template<> inline __host__ __device__ float4 cast_vec( const float3& a )					{ return make_float4(a); }
+template<> inline __host__ __device__ half3  cast_vec( const float3& a )					{ return make_half3(a); }
+template<> inline __host__ __device__ half4  cast_vec( const float3& a )					{ return make_half4(a); }
 
 template<> inline __host__ __device__ uchar3 cast_vec( const float4& a )					{ return make_uchar3(a); }
 template<> inline __host__ __device__ uchar4 cast_vec( const float4& a )					{ return make_uchar4(a); }
 template<> inline __host__ __device__ float3 cast_vec( const float4& a )					{ return make_float3(a); }
 template<> inline __host__ __device__ float4 cast_vec( const float4& a )					{ return make_float4(a); }
+template<> inline __host__ __device__ half3  cast_vec( const float4& a )					{ return make_half3(a); }
+template<> inline __host__ __device__ half4  cast_vec( const float4& a )					{ return make_half4(a); }
+
+template<> inline __host__ __device__ uchar3 cast_vec( const half3& a )					{ return make_uchar3(a); }
+template<> inline __host__ __device__ uchar4 cast_vec( const half3& a )					{ return make_uchar4(a); }
+template<> inline __host__ __device__ float3 cast_vec( const half3& a )					{ return make_float3(a); }
+template<> inline __host__ __device__ float4 cast_vec( const half3& a )					{ return make_float4(a); }
+template<> inline __host__ __device__ half3  cast_vec( const half3& a )					{ return a; }
+template<> inline __host__ __device__ half4  cast_vec( const half3& a )					{ return make_half4(a); }
+
+template<> inline __host__ __device__ uchar3 cast_vec( const half4& a )					{ return make_uchar3(a); }
+template<> inline __host__ __device__ uchar4 cast_vec( const half4& a )					{ return make_uchar4(a); }
+template<> inline __host__ __device__ float3 cast_vec( const half4& a )					{ return make_float3(a); }
+template<> inline __host__ __device__ float4 cast_vec( const half4& a )					{ return make_float4(a); }
+template<> inline __host__ __device__ half3  cast_vec( const half4& a )					{ return make_half3(a); }
+template<> inline __host__ __device__ half4  cast_vec( const half4& a )					{ return a; }
 
 
 // extract alpha color component
-template<typename T> inline __device__ typename cudaVectorTypeInfo<T>::Base alpha( T vec, typename cudaVectorTypeInfo<T>::Base default_alpha=255 )	{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4");  }
+template<typename T> inline __device__ typename cudaVectorTypeInfo<T>::Base alpha( T vec, typename cudaVectorTypeInfo<T>::Base default_alpha=255 )	{ static_assert(cuda_assert_false<T>::value, "invalid vector type - supported types are uchar3, uchar4, float3, float4, half3, half4");  }
 
 template<> inline __host__ __device__ uint8_t alpha( uchar3 vec, uint8_t default_alpha )		{ return default_alpha; }
 template<> inline __host__ __device__ uint8_t alpha( uchar4 vec, uint8_t default_alpha )		{ return vec.w; }
@@ -103,6 +135,9 @@ template<> inline __host__ __device__ uint8_t alpha( uchar4 vec, uint8_t default
 template<> inline __host__ __device__ float alpha( float3 vec, float default_alpha )			{ return default_alpha; }
 template<> inline __host__ __device__ float alpha( float4 vec, float default_alpha )			{ return vec.w; }
 
+template<> inline __host__ __device__ __half alpha( half3 vec, __half default_alpha )		{ return default_alpha; }
+template<> inline __host__ __device__ __half alpha( half4 vec, __half default_alpha )		{ return vec.w; }
+
 ///@}
 
 #endif
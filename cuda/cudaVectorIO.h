@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_VECTOR_IO_H__
+#define __CUDA_VECTOR_IO_H__
+
+
+#include "cudaUtility.h"
+
+#include <stdint.h>
+#include <type_traits>
+
+
+//////////////////////////////////////////////////////////////////////////////////
+/// @name Vectorized Memory Access
+/// @internal
+/// @ingroup cuda
+//////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+/**
+ * The number of pixels that each thread processes in the vectorized kernels.
+ * 8 pixels of uchar3/uchar4 are 24/32 bytes, which get moved with 64/128-bit accesses.
+ */
+#define CUDA_VECTOR_PIXELS 8
+
+/**
+ * The widest word (up to 128 bits) that evenly divides a run of `bytes` bytes.
+ */
+template<size_t bytes> struct cudaVectorWord
+{
+	typedef typename std::conditional<(bytes % 16 == 0), uint4,
+		   typename std::conditional<(bytes % 8 == 0), uint2,
+		   typename std::conditional<(bytes % 4 == 0), uint32_t, uint8_t>::type>::type>::type type;
+};
+
+/**
+ * A run of N consecutive pixels, that's loaded and stored with the widest
+ * accesses that the size of the run allows (see cudaLoadPixels() and cudaStorePixels()).
+ */
+template<typename T, int N> struct cudaPixelRun
+{
+	typedef typename cudaVectorWord<sizeof(T) * N>::type Word;
+	static const int Words = (sizeof(T) * N) / sizeof(Word);
+
+	union
+	{
+		Word words[Words];
+		T    px[N];
+	};
+};
+
+/**
+ * Load a run of pixels (the pointer should be aligned to cudaPixelRun<T,N>::Word).
+ */
+template<typename T, int N> inline __device__ void cudaLoadPixels( const T* ptr, cudaPixelRun<T,N>& run )
+{
+	typedef typename cudaPixelRun<T,N>::Word Word;
+
+	#pragma unroll
+	for( int n=0; n < cudaPixelRun<T,N>::Words; n++ )
+		run.words[n] = ((const Word*)ptr)[n];
+}
+
+/**
+ * Store a run of pixels (the pointer should be aligned to cudaPixelRun<T,N>::Word).
+ */
+template<typename T, int N> inline __device__ void cudaStorePixels( T* ptr, const cudaPixelRun<T,N>& run )
+{
+	typedef typename cudaPixelRun<T,N>::Word Word;
+
+	#pragma unroll
+	for( int n=0; n < cudaPixelRun<T,N>::Words; n++ )
+		((Word*)ptr)[n] = run.words[n];
+}
+
+/**
+ * Check if a pointer is aligned for loading/storing runs of N pixels.
+ */
+template<typename T, int N> inline __host__ __device__ bool cudaIsVectorAligned( const void* ptr )
+{
+	return ((size_t)ptr % sizeof(typename cudaPixelRun<T,N>::Word)) == 0;
+}
+
+/**
+ * Pointwise kernel that applies `op` to every pixel, CUDA_VECTOR_PIXELS at a time.
+ * The threads past the last full run process the remaining pixels one by one.
+ */
+template<typename T_in, typename T_out, typename Op>
+__global__ void cudaVectorKernel( const T_in* input, T_out* output, size_t numPixels, Op op )
+{
+	const size_t first = ((size_t)blockIdx.x * blockDim.x + threadIdx.x) * CUDA_VECTOR_PIXELS;
+
+	if( first + CUDA_VECTOR_PIXELS <= numPixels )
+	{
+		cudaPixelRun<T_in, CUDA_VECTOR_PIXELS> in;
+		cudaPixelRun<T_out, CUDA_VECTOR_PIXELS> out;
+
+		cudaLoadPixels(input + first, in);
+
+		#pragma unroll
+		for( int n=0; n < CUDA_VECTOR_PIXELS; n++ )
+			out.px[n] = op(in.px[n]);
+
+		cudaStorePixels(output + first, out);
+	}
+	else
+	{
+		for( size_t n=first; n < numPixels; n++ )
+			output[n] = op(input[n]);
+	}
+}
+
+/**
+ * Check if cudaLaunchVectorized() can be used with these pointers.
+ */
+template<typename T_in, typename T_out>
+inline bool cudaCanVectorize( const T_in* input, const T_out* output )
+{
+	return cudaIsVectorAligned<T_in, CUDA_VECTOR_PIXELS>(input) && cudaIsVectorAligned<T_out, CUDA_VECTOR_PIXELS>(output);
+}
+
+/**
+ * Launch cudaVectorKernel() over a contiguous image of `numPixels` pixels.
+ * The pointers should pass cudaCanVectorize() first.
+ */
+template<typename T_in, typename T_out, typename Op>
+inline cudaError_t cudaLaunchVectorized( const T_in* input, T_out* output, size_t numPixels, Op op, cudaStream_t stream )
+{
+	const dim3 blockDim(256,1,1);
+	const dim3 gridDim(iDivUp(iDivUp(numPixels, CUDA_VECTOR_PIXELS), blockDim.x), 1, 1);
+
+	cudaVectorKernel<T_in, T_out, Op><<<gridDim, blockDim, 0, stream>>>(input, output, numPixels, op);
+
+	return CUDA(cudaGetLastError());
+}
+
+///@}
+
+#endif
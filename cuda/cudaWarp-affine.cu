@@ -20,8 +20,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "cudaWarp.h"
-#include "mat33.h"
+#include "cudaWarp.cuh"
+#include "cudaNVTX.h"
 
 
 // gpuPerspectiveWarp
@@ -35,14 +35,10 @@ __global__ void gpuPerspectiveWarp( T* input, T* output, int width, int height,
 	if( x >= width || y >= height )
 		return;
 	
-	const float3 vec = make_float3(x, y, 1.0f);
-				 
-	const float3 vec_out = make_float3( m0.x * vec.x + m0.y * vec.y + m0.z * vec.z,
-								 m1.x * vec.x + m1.y * vec.y + m1.z * vec.z,
-								 m2.x * vec.x + m2.y * vec.y + m2.z * vec.z );
-	
-	const int u = vec_out.x / vec_out.z;
-	const int v = vec_out.y / vec_out.z;
+	const float2 uv = cudaWarpPerspectiveCoord(x, y, m0, m1, m2);
+
+	const int u = uv.x;
+	const int v = uv.y;
 	
 	T px;
 
@@ -59,39 +55,12 @@ __global__ void gpuPerspectiveWarp( T* input, T* output, int width, int height,
 } 
 
 
-// setup the transformation for the CUDA kernel
-inline static void invertTransform( float3 cuda_mat[3], const float transform[3][3], bool transform_inverted )
-{
-	// invert the matrix if it isn't already
-	if( !transform_inverted )
-	{
-		float inv[3][3];
-
-		mat33_inverse(inv, transform);
-
-		for( uint32_t i=0; i < 3; i++ )
-		{
-			cuda_mat[i].x = inv[i][0];
-			cuda_mat[i].y = inv[i][1];
-			cuda_mat[i].z = inv[i][2];
-		}
-	}
-	else
-	{
-		for( uint32_t i=0; i < 3; i++ )
-		{
-			cuda_mat[i].x = transform[i][0];
-			cuda_mat[i].y = transform[i][1];
-			cuda_mat[i].z = transform[i][2];
-		}
-	}
-}
-
-
 // cudaWarpPerspective
 cudaError_t cudaWarpPerspective( uchar4* input, uchar4* output, uint32_t width, uint32_t height,
-						   const float transform[3][3], bool transform_inverted )
+						   const float transform[3][3], bool transform_inverted, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpPerspective");
+
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
 
@@ -106,7 +75,7 @@ cudaError_t cudaWarpPerspective( uchar4* input, uchar4* output, uint32_t width,
 	const dim3 blockDim(8, 8);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
 
-	gpuPerspectiveWarp<<<gridDim, blockDim>>>(input, output, width, height, 
+	gpuPerspectiveWarp<<<gridDim, blockDim, 0, stream>>>(input, output, width, height, 
 	                                          cuda_mat[0], cuda_mat[1], cuda_mat[2]);
 
 	return CUDA(cudaGetLastError());
@@ -115,8 +84,10 @@ cudaError_t cudaWarpPerspective( uchar4* input, uchar4* output, uint32_t width,
 
 // cudaWarpPerspective
 cudaError_t cudaWarpPerspective( float4* input, float4* output, uint32_t width, uint32_t height,
-						   const float transform[3][3], bool transform_inverted )
+						   const float transform[3][3], bool transform_inverted, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpPerspective");
+
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
 
@@ -131,7 +102,7 @@ cudaError_t cudaWarpPerspective( float4* input, float4* output, uint32_t width,
 	const dim3 blockDim(8, 8);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
 
-	gpuPerspectiveWarp<<<gridDim, blockDim>>>(input, output, width, height, 
+	gpuPerspectiveWarp<<<gridDim, blockDim, 0, stream>>>(input, output, width, height, 
 	                                          cuda_mat[0], cuda_mat[1], cuda_mat[2]);
 
 	return CUDA(cudaGetLastError());
@@ -140,8 +111,10 @@ cudaError_t cudaWarpPerspective( float4* input, float4* output, uint32_t width,
 
 // cudaWarpAffine
 cudaError_t cudaWarpAffine( float4* input, float4* output, uint32_t width, uint32_t height,
-					   const float transform[2][3], bool transform_inverted )
+					   const float transform[2][3], bool transform_inverted, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpAffine");
+
 	float psp_transform[3][3];
 
 	// convert the affine transform to 3x3
@@ -153,14 +126,16 @@ cudaError_t cudaWarpAffine( float4* input, float4* output, uint32_t width, uint3
 	psp_transform[2][1] = 0;
 	psp_transform[2][2] = 1;
 
-	return CUDA(cudaWarpPerspective(input, output, width, height, psp_transform, transform_inverted));
+	return CUDA(cudaWarpPerspective(input, output, width, height, psp_transform, transform_inverted, stream));
 }
 
 
 // cudaWarpAffine
 cudaError_t cudaWarpAffine( uchar4* input, uchar4* output, uint32_t width, uint32_t height,
-					   const float transform[2][3], bool transform_inverted )
+					   const float transform[2][3], bool transform_inverted, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpAffine");
+
 	float psp_transform[3][3];
 
 	// convert the affine transform to 3x3
@@ -172,7 +147,7 @@ cudaError_t cudaWarpAffine( uchar4* input, uchar4* output, uint32_t width, uint3
 	psp_transform[2][1] = 0;
 	psp_transform[2][2] = 1;
 
-	return CUDA(cudaWarpPerspective(input, output, width, height, psp_transform, transform_inverted));
+	return CUDA(cudaWarpPerspective(input, output, width, height, psp_transform, transform_inverted, stream));
 }
 
 
@@ -190,14 +165,10 @@ __global__ void gpuPerspectiveWarp2( T* input, int inputWidth, int inputHeight,
 	if( x >= outputWidth || y >= outputHeight )
 		return;
 	
-	const float3 vec = make_float3(x, y, 1.0f);
-				 
-	const float3 vec_out = make_float3( m0.x * vec.x + m0.y * vec.y + m0.z * vec.z,
-								 m1.x * vec.x + m1.y * vec.y + m1.z * vec.z,
-								 m2.x * vec.x + m2.y * vec.y + m2.z * vec.z );
-	
-	const int u = vec_out.x / vec_out.z;
-	const int v = vec_out.y / vec_out.z;
+	const float2 uv = cudaWarpPerspectiveCoord(x, y, m0, m1, m2);
+
+	const int u = uv.x;
+	const int v = uv.y;
 
 	if( u < inputWidth && v < inputHeight && u >= 0 && v >= 0 )
 		output[y * outputWidth + x] = input[v * inputWidth + u];
@@ -205,8 +176,10 @@ __global__ void gpuPerspectiveWarp2( T* input, int inputWidth, int inputHeight,
 
 cudaError_t cudaWarpPerspective( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat inputFormat,
 						   void* output, uint32_t outputWidth, uint32_t outputHeight, imageFormat outputFormat,
-					        const float transform[3][3], bool transform_inverted )
+					        const float transform[3][3], bool transform_inverted, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpPerspective");
+
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
 
@@ -228,7 +201,7 @@ cudaError_t cudaWarpPerspective( void* input, uint32_t inputWidth, uint32_t inpu
 	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
 
 	#define LAUNCH_PERSPECTIVE_WARP2(type) \
-		gpuPerspectiveWarp2<type><<<gridDim, blockDim>>>((type*)input, inputWidth, inputHeight, (type*)output, outputWidth, outputHeight, cuda_mat[0], cuda_mat[1], cuda_mat[2])
+		gpuPerspectiveWarp2<type><<<gridDim, blockDim, 0, stream>>>((type*)input, inputWidth, inputHeight, (type*)output, outputWidth, outputHeight, cuda_mat[0], cuda_mat[1], cuda_mat[2])
 	
 	if( outputFormat == IMAGE_RGB8 )
 		LAUNCH_PERSPECTIVE_WARP2(uchar3);
@@ -247,3 +220,50 @@ cudaError_t cudaWarpPerspective( void* input, uint32_t inputWidth, uint32_t inpu
 	return cudaGetLastError();
 }
 						   
+
+
+// cudaWarpPerspective (with filtering)
+cudaError_t cudaWarpPerspective( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat inputFormat,
+						   void* output, uint32_t outputWidth, uint32_t outputHeight, imageFormat outputFormat,
+					        const float transform[3][3], cudaFilterMode filter, bool transform_inverted, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpPerspective");
+
+	if( inputFormat != outputFormat )
+	{
+		LogError(LOG_CUDA "cudaWarpPerspective() -- input and output images must be of the same datatype/format\n");
+		return cudaErrorInvalidValue;
+	}
+
+	// setup the transform
+	cudaWarpPerspectiveMapper mapper;
+	float3 cuda_mat[3];
+
+	invertTransform(cuda_mat, transform, transform_inverted);
+
+	mapper.m0 = cuda_mat[0];
+	mapper.m1 = cuda_mat[1];
+	mapper.m2 = cuda_mat[2];
+
+	return cudaWarpLaunch(input, inputWidth, inputHeight, output, outputWidth, outputHeight,
+					  outputFormat, filter, mapper, stream, "cudaWarpPerspective()");
+}
+
+
+// cudaWarpMapPerspective
+cudaError_t cudaWarpMapPerspective( float2* map, uint32_t width, uint32_t height,
+						     const float transform[3][3], bool transform_inverted, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpMapPerspective");
+
+	cudaWarpPerspectiveMapper mapper;
+	float3 cuda_mat[3];
+
+	invertTransform(cuda_mat, transform, transform_inverted);
+
+	mapper.m0 = cuda_mat[0];
+	mapper.m1 = cuda_mat[1];
+	mapper.m2 = cuda_mat[2];
+
+	return cudaWarpMapLaunch(map, width, height, mapper, stream);
+}
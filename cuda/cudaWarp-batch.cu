@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaWarp.cuh"
+#include "cudaNVTX.h"
+
+
+//-----------------------------------------------------------------------------------
+// Batched affine warps - one launch for the whole batch, with blockIdx.z selecting
+// the transform and the crop of the output tensor that it gets written to
+//-----------------------------------------------------------------------------------
+struct WarpAffineBatch
+{
+	float3 m0[CUDA_WARP_MAX_BATCH];	// first two rows of the inverted transforms
+	float3 m1[CUDA_WARP_MAX_BATCH];
+};
+
+// warpAffineSample (the pixels outside of the input are zero)
+template<cudaFilterMode filter, typename T>
+__device__ inline typename cudaFilterAccum<T>::Type warpAffineSample( T* input, int width, int height, float u, float v )
+{
+	typedef typename cudaFilterAccum<T>::Type Accum;
+
+	if( filter == FILTER_POINT )
+	{
+		const int x = floorf(u + 0.5f);
+		const int y = floorf(v + 0.5f);
+
+		if( x < 0 || y < 0 || x >= width || y >= height )
+			return Accum();
+
+		return cudaFilterAccum<T>::load(input[y * width + x]);
+	}
+
+	const float fx = floorf(u);
+	const float fy = floorf(v);
+
+	const int x1 = fx;
+	const int y1 = fy;
+
+	if( x1 < -1 || y1 < -1 || x1 >= width || y1 >= height )
+		return Accum();
+
+	const float wx = u - fx;
+	const float wy = v - fy;
+
+	const float weights[4] = { (1.0f - wx) * (1.0f - wy), wx * (1.0f - wy), (1.0f - wx) * wy, wx * wy };
+
+	Accum sum = Accum();
+
+	#pragma unroll
+	for( int n=0; n < 4; n++ )
+	{
+		const int x = x1 + (n & 1);
+		const int y = y1 + (n >> 1);
+
+		if( x >= 0 && y >= 0 && x < width && y < height )
+			sum += cudaFilterAccum<T>::load(input[y * width + x]) * weights[n];
+	}
+
+	return sum;
+}
+
+// gpuWarpAffineBatch
+template<typename T, cudaFilterMode filter>
+__global__ void gpuWarpAffineBatch( T* input, int inputWidth, int inputHeight, WarpAffineBatch batch,
+							 T* output, int outputWidth, int outputHeight )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+	const int z = blockIdx.z;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const float3 m0 = batch.m0[z];
+	const float3 m1 = batch.m1[z];
+
+	const float u = m0.x * x + m0.y * y + m0.z;
+	const float v = m1.x * x + m1.y * y + m1.z;
+
+	output[(z * outputHeight + y) * outputWidth + x] = cudaFilterAccum<T>::store(cudaFilterAccum<T>::saturate(
+		warpAffineSample<filter>(input, inputWidth, inputHeight, u, v)));
+}
+
+static inline __device__ void warpStore( float* output, float value )	{ *output = value; }
+static inline __device__ void warpStore( __half* output, float value )	{ *output = __float2half(value); }
+
+// gpuWarpAffineBatchNormalize (writes each crop as a normalized planar RGB tensor)
+template<typename T, typename T_out, cudaFilterMode filter, bool bgr>
+__global__ void gpuWarpAffineBatchNormalize( T* input, int inputWidth, int inputHeight, WarpAffineBatch batch,
+								     T_out* output, int outputWidth, int outputHeight,
+								     float3 multiplier, float3 offset )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+	const int z = blockIdx.z;
+
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const float3 m0 = batch.m0[z];
+	const float3 m1 = batch.m1[z];
+
+	const float u = m0.x * x + m0.y * y + m0.z;
+	const float v = m1.x * x + m1.y * y + m1.z;
+
+	float3 px = make_float3(warpAffineSample<filter>(input, inputWidth, inputHeight, u, v));
+
+	if( bgr )
+		px = make_float3(px.z, px.y, px.x);
+
+	px = px * multiplier + offset;
+
+	const int n = outputWidth * outputHeight;
+	const int m = y * outputWidth + x;
+
+	output += n * 3 * z;
+
+	warpStore(output + m, px.x);
+	warpStore(output + n + m, px.y);
+	warpStore(output + n * 2 + m, px.z);
+}
+
+// setupWarpAffineBatch
+static cudaError_t setupWarpAffineBatch( WarpAffineBatch& batch, const float transforms[][2][3], uint32_t batchSize, 
+								 bool transform_inverted, const char* function )
+{
+	if( !transforms )
+		return cudaErrorInvalidValue;
+
+	if( batchSize == 0 )
+		return cudaErrorInvalidValue;
+
+	if( batchSize > CUDA_WARP_MAX_BATCH )
+	{
+		LogError(LOG_CUDA "%s -- batch size of %u exceeds the maximum (CUDA_WARP_MAX_BATCH=%i)\n", function, batchSize, CUDA_WARP_MAX_BATCH);
+		return cudaErrorInvalidValue;
+	}
+
+	for( uint32_t n=0; n < batchSize; n++ )
+	{
+		// convert the affine transform to 3x3
+		float psp_transform[3][3];
+
+		for( uint32_t i=0; i < 2; i++ )
+			for( uint32_t j=0; j < 3; j++ )
+				psp_transform[i][j] = transforms[n][i][j];
+
+		psp_transform[2][0] = 0;
+		psp_transform[2][1] = 0;
+		psp_transform[2][2] = 1;
+
+		float3 cuda_mat[3];
+		invertTransform(cuda_mat, psp_transform, transform_inverted);
+
+		batch.m0[n] = cuda_mat[0];
+		batch.m1[n] = cuda_mat[1];
+	}
+
+	return cudaSuccess;
+}
+
+
+// cudaWarpAffineBatch
+cudaError_t cudaWarpAffineBatch( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat format,
+						   const float transforms[][2][3], uint32_t batchSize,
+						   void* output, uint32_t outputWidth, uint32_t outputHeight,
+						   cudaFilterMode filter, bool transform_inverted, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpAffineBatch");
+
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || inputHeight == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	WarpAffineBatch batch;
+	const cudaError_t result = setupWarpAffineBatch(batch, transforms, batchSize, transform_inverted, "cudaWarpAffineBatch()");
+
+	if( result != cudaSuccess )
+		return result;
+
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y), batchSize);
+
+	#define LAUNCH_WARP_AFFINE_BATCH(type) \
+		if( filter == FILTER_POINT ) \
+			gpuWarpAffineBatch<type, FILTER_POINT><<<gridDim, blockDim, 0, stream>>>((type*)input, inputWidth, inputHeight, batch, (type*)output, outputWidth, outputHeight); \
+		else \
+			gpuWarpAffineBatch<type, FILTER_LINEAR><<<gridDim, blockDim, 0, stream>>>((type*)input, inputWidth, inputHeight, batch, (type*)output, outputWidth, outputHeight)
+
+	if( format == IMAGE_GRAY8 )
+		LAUNCH_WARP_AFFINE_BATCH(uint8_t);
+	else if( format == IMAGE_GRAY32F )
+		LAUNCH_WARP_AFFINE_BATCH(float);
+	else if( format == IMAGE_RGB8 || format == IMAGE_BGR8 )
+		LAUNCH_WARP_AFFINE_BATCH(uchar3);
+	else if( format == IMAGE_RGBA8 || format == IMAGE_BGRA8 )
+		LAUNCH_WARP_AFFINE_BATCH(uchar4);
+	else if( format == IMAGE_RGB32F || format == IMAGE_BGR32F )
+		LAUNCH_WARP_AFFINE_BATCH(float3); 
+	else if( format == IMAGE_RGBA32F || format == IMAGE_BGRA32F )
+		LAUNCH_WARP_AFFINE_BATCH(float4);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaWarpAffineBatch()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	#undef LAUNCH_WARP_AFFINE_BATCH
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// launchWarpAffineBatchNormalize
+template<typename T_out>
+static cudaError_t launchWarpAffineBatchNormalize( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat format,
+									      const float transforms[][2][3], uint32_t batchSize,
+									      T_out* output, uint32_t outputWidth, uint32_t outputHeight,
+									      const float2& range, const float3& mean, const float3& stdDev,
+									      cudaFilterMode filter, bool transform_inverted, cudaStream_t stream )
+{
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || inputHeight == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	if( stdDev.x == 0.0f || stdDev.y == 0.0f || stdDev.z == 0.0f )
+	{
+		LogError(LOG_CUDA "cudaWarpAffineBatch() -- stdDev must be non-zero\n");
+		return cudaErrorInvalidValue;
+	}
+
+	WarpAffineBatch batch;
+	const cudaError_t result = setupWarpAffineBatch(batch, transforms, batchSize, transform_inverted, "cudaWarpAffineBatch()");
+
+	if( result != cudaSuccess )
+		return result;
+
+	// fold the range scaling and mean/stdDev normalization into a single multiply-add
+	const float s = (range.y - range.x) / 255.0f;
+
+	const float3 multiplier = make_float3(s / stdDev.x, s / stdDev.y, s / stdDev.z);
+	const float3 offset = make_float3((range.x - mean.x) / stdDev.x,
+							    (range.x - mean.y) / stdDev.y,
+							    (range.x - mean.z) / stdDev.z);
+
+	// launch kernel
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y), batchSize);
+
+	#define LAUNCH_WARP_AFFINE_NORMALIZE(type, bgr) \
+		if( filter == FILTER_POINT ) \
+			gpuWarpAffineBatchNormalize<type, T_out, FILTER_POINT, bgr><<<gridDim, blockDim, 0, stream>>>((type*)input, inputWidth, inputHeight, batch, output, outputWidth, outputHeight, multiplier, offset); \
+		else \
+			gpuWarpAffineBatchNormalize<type, T_out, FILTER_LINEAR, bgr><<<gridDim, blockDim, 0, stream>>>((type*)input, inputWidth, inputHeight, batch, output, outputWidth, outputHeight, multiplier, offset)
+
+	if( format == IMAGE_RGB8 )
+		LAUNCH_WARP_AFFINE_NORMALIZE(uchar3, false);
+	else if( format == IMAGE_BGR8 )
+		LAUNCH_WARP_AFFINE_NORMALIZE(uchar3, true);
+	else if( format == IMAGE_RGBA8 )
+		LAUNCH_WARP_AFFINE_NORMALIZE(uchar4, false);
+	else if( format == IMAGE_BGRA8 )
+		LAUNCH_WARP_AFFINE_NORMALIZE(uchar4, true);
+	else if( format == IMAGE_RGB32F )
+		LAUNCH_WARP_AFFINE_NORMALIZE(float3, false);
+	else if( format == IMAGE_BGR32F )
+		LAUNCH_WARP_AFFINE_NORMALIZE(float3, true);
+	else if( format == IMAGE_RGBA32F )
+		LAUNCH_WARP_AFFINE_NORMALIZE(float4, false);
+	else if( format == IMAGE_BGRA32F )
+		LAUNCH_WARP_AFFINE_NORMALIZE(float4, true);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, "cudaWarpAffineBatch()", format);
+		return cudaErrorInvalidValue;
+	}
+
+	#undef LAUNCH_WARP_AFFINE_NORMALIZE
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaWarpAffineBatch (float tensor)
+cudaError_t cudaWarpAffineBatch( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat format,
+						   const float transforms[][2][3], uint32_t batchSize,
+						   float* output, uint32_t outputWidth, uint32_t outputHeight,
+						   const float2& range, const float3& mean, const float3& stdDev,
+						   cudaFilterMode filter, bool transform_inverted, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpAffineBatch");
+
+	return launchWarpAffineBatchNormalize<float>(input, inputWidth, inputHeight, format, transforms, batchSize,
+										output, outputWidth, outputHeight, range, mean, stdDev,
+										filter, transform_inverted, stream);
+}
+
+
+// cudaWarpAffineBatch (half tensor)
+cudaError_t cudaWarpAffineBatch( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat format,
+						   const float transforms[][2][3], uint32_t batchSize,
+						   __half* output, uint32_t outputWidth, uint32_t outputHeight,
+						   const float2& range, const float3& mean, const float3& stdDev,
+						   cudaFilterMode filter, bool transform_inverted, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpAffineBatch");
+
+	return launchWarpAffineBatchNormalize<__half>(input, inputWidth, inputHeight, format, transforms, batchSize,
+										 output, outputWidth, outputHeight, range, mean, stdDev,
+										 filter, transform_inverted, stream);
+}
@@ -20,7 +20,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "cudaWarp.h"
+#include "cudaWarp.cuh"
+#include "cudaNVTX.h"
 
 
 // cudaFisheye
@@ -33,36 +34,17 @@ __global__ void cudaFisheye( T* input, T* output, int width, int height, float f
 	if( uv_out.x >= width || uv_out.y >= height )
 		return;
 	
-	const float fWidth  = width;
-	const float fHeight = height;
+	const float2 uv = cudaWarpFisheyeCoord(uv_out.x, uv_out.y, width, height, focus);
 	
-	// convert to cartesian coordinates
-	const float cx = ((uv_out.x / fWidth) - 0.5f)  * 2.0f;	
-	const float cy = (0.5f - (uv_out.y / fHeight)) * 2.0f;
-
-	const float theta = atan2f(cy, cx);
-	const float r     = atanf(sqrtf(cx*cx+cy*cy) * focus);
-	
-	const float tx = r * __cosf(theta);
-	const float ty = r * __sinf(theta);
-	
-	// convert back out of cartesian coordinates
-	float u = (tx * 0.5f + 0.5f) * fWidth;
-	float v = (0.5f - (ty * 0.5f)) * fHeight;
-
-	if( u < 0.0f ) u = 0.0f;
-	if( v < 0.0f ) v = 0.0f;
-
-	if( u > fWidth  - 1.0f ) u = fWidth - 1.0f;
-	if( v > fHeight - 1.0f ) v = fHeight - 1.0f;
-	
-	output[uv_out.y * width + uv_out.x] = input[(int)v * width + (int)u];
+	output[uv_out.y * width + uv_out.x] = input[(int)uv.y * width + (int)uv.x];
 } 
 
 
 // cudaWarpFisheye
-cudaError_t cudaWarpFisheye( uchar4* input, uchar4* output, uint32_t width, uint32_t height, float focus )
+cudaError_t cudaWarpFisheye( uchar4* input, uchar4* output, uint32_t width, uint32_t height, float focus, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpFisheye");
+
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
 
@@ -73,15 +55,17 @@ cudaError_t cudaWarpFisheye( uchar4* input, uchar4* output, uint32_t width, uint
 	const dim3 blockDim(8, 8);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
 
-	cudaFisheye<<<gridDim, blockDim>>>(input, output, width, height, focus);
+	cudaFisheye<<<gridDim, blockDim, 0, stream>>>(input, output, width, height, focus);
 
 	return CUDA(cudaGetLastError());
 }
 
 
 // cudaWarpFisheye
-cudaError_t cudaWarpFisheye( float4* input, float4* output, uint32_t width, uint32_t height, float focus )
+cudaError_t cudaWarpFisheye( float4* input, float4* output, uint32_t width, uint32_t height, float focus, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpFisheye");
+
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
 
@@ -92,9 +76,22 @@ cudaError_t cudaWarpFisheye( float4* input, float4* output, uint32_t width, uint
 	const dim3 blockDim(8, 8);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
 
-	cudaFisheye<<<gridDim, blockDim>>>(input, output, width, height, focus);
+	cudaFisheye<<<gridDim, blockDim, 0, stream>>>(input, output, width, height, focus);
 
 	return CUDA(cudaGetLastError());
 }
 
 
+// cudaWarpMapFisheye
+cudaError_t cudaWarpMapFisheye( float2* map, uint32_t width, uint32_t height, float focus, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpMapFisheye");
+
+	cudaWarpFisheyeMapper mapper;
+
+	mapper.width  = width;
+	mapper.height = height;
+	mapper.focus  = focus;
+
+	return cudaWarpMapLaunch(map, width, height, mapper, stream);
+}
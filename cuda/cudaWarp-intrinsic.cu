@@ -20,7 +20,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "cudaWarp.h"
+#include "cudaWarp.cuh"
+#include "cudaNVTX.h"
 
 
 // gpuIntrinsicWarp
@@ -34,26 +35,9 @@ __global__ void gpuIntrinsicWarp( T* input, T* output, int width, int height,
 	if( uv_out.x >= width || uv_out.y >= height )
 		return;
 	
-	const float u = uv_out.x;
-	const float v = uv_out.y;
+	const float2 uv = cudaWarpIntrinsicCoord(uv_out.x, uv_out.y, focalLength, principalPoint, k1, k2, p1, p2);
 
-	const float _fx = 1.0f / focalLength.x;
-	const float _fy = 1.0f / focalLength.y;
-	
-	const float y      = (v - principalPoint.y)*_fy;
-	const float y2     = y*y;
-	const float _2p1y  = 2.0*p1*y;
-	const float _3p1y2 = 3.0*p1*y2;
-	const float p2y2   = p2*y2;
-
-	const float x  = (u - principalPoint.x)*_fx;
-	const float x2 = x*x;
-	const float r2 = x2 + y2;
-	const float d  = 1.0 + (k1 + k2*r2)*r2;
-	const float _u = focalLength.x*(x*(d + _2p1y) + p2y2 + (3.0*p2)*x2) + principalPoint.x;
-	const float _v = focalLength.y*(y*(d + (2.0*p2)*x) + _3p1y2 + p1*x2) + principalPoint.y;
-
-	const int2 uv_in = make_int2( _u, _v );
+	const int2 uv_in = make_int2( uv.x, uv.y );
 	
 	if( uv_in.x >= width || uv_in.y >= height || uv_in.x < 0 || uv_in.y < 0 )
 		return;
@@ -64,8 +48,10 @@ __global__ void gpuIntrinsicWarp( T* input, T* output, int width, int height,
 
 // cudaWarpIntrinsic
 cudaError_t cudaWarpIntrinsic( uchar4* input, uchar4* output, uint32_t width, uint32_t height,
-						 const float2& focalLength, const float2& principalPoint, const float4& distortion )
+						 const float2& focalLength, const float2& principalPoint, const float4& distortion, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpIntrinsic");
+
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
 
@@ -76,7 +62,7 @@ cudaError_t cudaWarpIntrinsic( uchar4* input, uchar4* output, uint32_t width, ui
 	const dim3 blockDim(8, 8);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
 
-	gpuIntrinsicWarp<<<gridDim, blockDim>>>(input, output, width, height,
+	gpuIntrinsicWarp<<<gridDim, blockDim, 0, stream>>>(input, output, width, height,
 									focalLength, principalPoint,
 									distortion.x, distortion.y, distortion.z, distortion.w);
 
@@ -86,8 +72,10 @@ cudaError_t cudaWarpIntrinsic( uchar4* input, uchar4* output, uint32_t width, ui
 
 // cudaWarpIntrinsic
 cudaError_t cudaWarpIntrinsic( float4* input, float4* output, uint32_t width, uint32_t height,
-						 const float2& focalLength, const float2& principalPoint, const float4& distortion )
+						 const float2& focalLength, const float2& principalPoint, const float4& distortion, cudaStream_t stream )
 {
+	NVTX_RANGE("cudaWarpIntrinsic");
+
 	if( !input || !output )
 		return cudaErrorInvalidDevicePointer;
 
@@ -98,7 +86,7 @@ cudaError_t cudaWarpIntrinsic( float4* input, float4* output, uint32_t width, ui
 	const dim3 blockDim(8, 8);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
 
-	gpuIntrinsicWarp<<<gridDim, blockDim>>>(input, output, width, height,
+	gpuIntrinsicWarp<<<gridDim, blockDim, 0, stream>>>(input, output, width, height,
 									focalLength, principalPoint,
 									distortion.x, distortion.y, distortion.z, distortion.w);
 
@@ -106,7 +94,35 @@ cudaError_t cudaWarpIntrinsic( float4* input, float4* output, uint32_t width, ui
 }
 
 
+// cudaWarpIntrinsic (with filtering)
+cudaError_t cudaWarpIntrinsic( void* input, void* output, uint32_t width, uint32_t height, imageFormat format,
+						 const float2& focalLength, const float2& principalPoint, const float4& distortion,
+						 cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpIntrinsic");
+
+	cudaWarpIntrinsicMapper mapper;
 
+	mapper.focalLength    = focalLength;
+	mapper.principalPoint = principalPoint;
+	mapper.distortion     = distortion;
 
+	return cudaWarpLaunch(input, width, height, output, width, height,
+					  format, filter, mapper, stream, "cudaWarpIntrinsic()");
+}
 
 
+// cudaWarpMapIntrinsic
+cudaError_t cudaWarpMapIntrinsic( float2* map, uint32_t width, uint32_t height,
+						    const float2& focalLength, const float2& principalPoint, const float4& distortion, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpMapIntrinsic");
+
+	cudaWarpIntrinsicMapper mapper;
+
+	mapper.focalLength    = focalLength;
+	mapper.principalPoint = principalPoint;
+	mapper.distortion     = distortion;
+
+	return cudaWarpMapLaunch(map, width, height, mapper, stream);
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaWarp.cuh"
+#include "logging.h"
+#include "cudaNVTX.h"
+
+
+// cudaWarpTexture
+bool cudaWarpTexture( cudaTextureObject_t* texture, void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	// the warp kernels sample the texture as float4
+	if( format != IMAGE_RGBA8 && format != IMAGE_RGBA32F )
+		return false;
+
+	return cudaFilterTexture(texture, image, width, height, format);
+}
+
+
+// cudaRemap
+cudaError_t cudaRemap( void* input, uint32_t inputWidth, uint32_t inputHeight,
+				   void* output, uint32_t outputWidth, uint32_t outputHeight,
+				   imageFormat format, const float2* map, cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRemap");
+
+	if( !map )
+		return cudaErrorInvalidDevicePointer;
+
+	cudaWarpLUTMapper mapper;
+
+	mapper.map   = map;
+	mapper.width = outputWidth;
+
+	return cudaWarpLaunch(input, inputWidth, inputHeight, output, outputWidth, outputHeight,
+					  format, filter, mapper, stream, "cudaRemap()");
+}
+
+
+// cudaRemap (half-precision map)
+cudaError_t cudaRemap( void* input, uint32_t inputWidth, uint32_t inputHeight,
+				   void* output, uint32_t outputWidth, uint32_t outputHeight,
+				   imageFormat format, const __half2* map, cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRemap");
+
+	if( !map )
+		return cudaErrorInvalidDevicePointer;
+
+	cudaWarpLUTHalfMapper mapper;
+
+	mapper.map   = map;
+	mapper.width = outputWidth;
+
+	return cudaWarpLaunch(input, inputWidth, inputHeight, output, outputWidth, outputHeight,
+					  format, filter, mapper, stream, "cudaRemap()");
+}
+
+
+// cudaRemap (fixed-point map)
+cudaError_t cudaRemap( void* input, uint32_t inputWidth, uint32_t inputHeight,
+				   void* output, uint32_t outputWidth, uint32_t outputHeight,
+				   imageFormat format, const short2* map, int fractionBits, 
+				   cudaFilterMode filter, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaRemap");
+
+	if( !map )
+		return cudaErrorInvalidDevicePointer;
+
+	if( fractionBits < 0 || fractionBits > 14 )
+		return cudaErrorInvalidValue;
+
+	cudaWarpLUTFixedMapper mapper;
+
+	mapper.map   = map;
+	mapper.width = outputWidth;
+	mapper.scale = 1.0f / float(1 << fractionBits);
+
+	return cudaWarpLaunch(input, inputWidth, inputHeight, output, outputWidth, outputHeight,
+					  format, filter, mapper, stream, "cudaRemap()");
+}
+
+
+//----------------------------------------------------------------------------
+// Map conversion
+//----------------------------------------------------------------------------
+template<typename T>
+__global__ void gpuWarpMapConvert( const float2* input, T* output, int size, float scale )
+{
+	const int n = blockIdx.x * blockDim.x + threadIdx.x;
+
+	if( n >= size )
+		return;
+
+	const float2 uv = input[n];
+
+	output[n] = make_short2(fminf(fmaxf(rintf(uv.x * scale), -32768.0f), 32767.0f),
+					    fminf(fmaxf(rintf(uv.y * scale), -32768.0f), 32767.0f));
+}
+
+template<>
+__global__ void gpuWarpMapConvert( const float2* input, __half2* output, int size, float scale )
+{
+	const int n = blockIdx.x * blockDim.x + threadIdx.x;
+
+	if( n >= size )
+		return;
+
+	const float2 uv = input[n];
+	output[n] = __floats2half2_rn(uv.x, uv.y);
+}
+
+__global__ void gpuWarpMapFromXY( const float* mapX, const float* mapY, float2* output, int size )
+{
+	const int n = blockIdx.x * blockDim.x + threadIdx.x;
+
+	if( n >= size )
+		return;
+
+	output[n] = make_float2(mapX[n], mapY[n]);
+}
+
+
+// cudaWarpMapConvert (half-precision)
+cudaError_t cudaWarpMapConvert( const float2* input, __half2* output, uint32_t width, uint32_t height, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpMapConvert");
+
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const uint32_t size = width * height;
+
+	gpuWarpMapConvert<__half2><<<iDivUp(size,256), 256, 0, stream>>>(input, output, size, 1.0f);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaWarpMapConvert (fixed-point)
+cudaError_t cudaWarpMapConvert( const float2* input, short2* output, uint32_t width, uint32_t height, int fractionBits, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpMapConvert");
+
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 || fractionBits < 0 || fractionBits > 14 )
+		return cudaErrorInvalidValue;
+
+	const uint32_t size = width * height;
+
+	gpuWarpMapConvert<short2><<<iDivUp(size,256), 256, 0, stream>>>(input, output, size, float(1 << fractionBits));
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// cudaWarpMapFromXY
+cudaError_t cudaWarpMapFromXY( const float* mapX, const float* mapY, float2* map, uint32_t width, uint32_t height, cudaStream_t stream )
+{
+	NVTX_RANGE("cudaWarpMapFromXY");
+
+	if( !mapX || !mapY || !map )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const uint32_t size = width * height;
+
+	gpuWarpMapFromXY<<<iDivUp(size,256), 256, 0, stream>>>(mapX, mapY, map, size);
+
+	return CUDA(cudaGetLastError());
+}
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CUDA_WARP_CUH__
+#define __CUDA_WARP_CUH__
+
+
+#include "cudaWarp.h"
+#include "cudaFilterMode.cuh"
+#include "mat33.h"
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name CUDA device functions for mapping output pixel coordinates to input coordinates.
+/// @ingroup warping
+//////////////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+/**
+ * Find the input coordinates of an output pixel with an (inverted) 3x3 perspective transform.
+ */
+inline __device__ float2 cudaWarpPerspectiveCoord( float x, float y, const float3& m0, const float3& m1, const float3& m2 )
+{
+	const float3 vec = make_float3(x, y, 1.0f);
+				 
+	const float3 vec_out = make_float3( m0.x * vec.x + m0.y * vec.y + m0.z * vec.z,
+								 m1.x * vec.x + m1.y * vec.y + m1.z * vec.z,
+								 m2.x * vec.x + m2.y * vec.y + m2.z * vec.z );
+
+	return make_float2(vec_out.x / vec_out.z, vec_out.y / vec_out.z);
+}
+
+/**
+ * Find the input coordinates of an output pixel with the pinhole camera model,
+ * using radial (k1, k2) and tangential (p1, p2) distortion coefficients.
+ */
+inline __device__ float2 cudaWarpIntrinsicCoord( float u, float v, const float2& focalLength, const float2& principalPoint,
+									    float k1, float k2, float p1, float p2 )
+{
+	const float _fx = 1.0f / focalLength.x;
+	const float _fy = 1.0f / focalLength.y;
+	
+	const float y      = (v - principalPoint.y)*_fy;
+	const float y2     = y*y;
+	const float _2p1y  = 2.0*p1*y;
+	const float _3p1y2 = 3.0*p1*y2;
+	const float p2y2   = p2*y2;
+
+	const float x  = (u - principalPoint.x)*_fx;
+	const float x2 = x*x;
+	const float r2 = x2 + y2;
+	const float d  = 1.0 + (k1 + k2*r2)*r2;
+	const float _u = focalLength.x*(x*(d + _2p1y) + p2y2 + (3.0*p2)*x2) + principalPoint.x;
+	const float _v = focalLength.y*(y*(d + (2.0*p2)*x) + _3p1y2 + p1*x2) + principalPoint.y;
+
+	return make_float2(_u, _v);
+}
+
+/**
+ * Find the input coordinates of an output pixel for fisheye dewarping
+ * (the coordinates are clamped to the image, so they're always valid).
+ */
+inline __device__ float2 cudaWarpFisheyeCoord( int x, int y, float width, float height, float focus )
+{
+	// convert to cartesian coordinates
+	const float cx = ((x / width) - 0.5f)  * 2.0f;	
+	const float cy = (0.5f - (y / height)) * 2.0f;
+
+	const float theta = atan2f(cy, cx);
+	const float r     = atanf(sqrtf(cx*cx+cy*cy) * focus);
+	
+	const float tx = r * __cosf(theta);
+	const float ty = r * __sinf(theta);
+	
+	// convert back out of cartesian coordinates
+	float u = (tx * 0.5f + 0.5f) * width;
+	float v = (0.5f - (ty * 0.5f)) * height;
+
+	if( u < 0.0f ) u = 0.0f;
+	if( v < 0.0f ) v = 0.0f;
+
+	if( u > width  - 1.0f ) u = width - 1.0f;
+	if( v > height - 1.0f ) v = height - 1.0f;
+
+	return make_float2(u, v);
+}
+
+///@}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Coordinate mappers that get passed to the generic warp kernels.
+/// @ingroup warping
+//////////////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+struct cudaWarpPerspectiveMapper
+{
+	float3 m0, m1, m2;
+
+	__device__ inline float2 operator()( int x, int y ) const	{ return cudaWarpPerspectiveCoord(x, y, m0, m1, m2); }
+};
+
+struct cudaWarpIntrinsicMapper
+{
+	float2 focalLength;
+	float2 principalPoint;
+	float4 distortion;
+
+	__device__ inline float2 operator()( int x, int y ) const	{ return cudaWarpIntrinsicCoord(x, y, focalLength, principalPoint, distortion.x, distortion.y, distortion.z, distortion.w); }
+};
+
+struct cudaWarpFisheyeMapper
+{
+	float width;
+	float height;
+	float focus;
+
+	__device__ inline float2 operator()( int x, int y ) const	{ return cudaWarpFisheyeCoord(x, y, width, height, focus); }
+};
+
+struct cudaWarpLUTMapper
+{
+	const float2* map;
+	int width;
+
+	__device__ inline float2 operator()( int x, int y ) const	{ return map[y * width + x]; }
+};
+
+struct cudaWarpLUTHalfMapper
+{
+	const __half2* map;
+	int width;
+
+	__device__ inline float2 operator()( int x, int y ) const	{ return __half22float2(map[y * width + x]); }
+};
+
+struct cudaWarpLUTFixedMapper
+{
+	const short2* map;
+	int width;
+	float scale;	// 1 / (1 << fractionBits)
+
+	__device__ inline float2 operator()( int x, int y ) const	{ const short2 uv = map[y * width + x]; return make_float2(uv.x * scale, uv.y * scale); }
+};
+
+///@}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Generic warp kernels, which sample the input at the mapper's coordinates.
+/// @ingroup warping
+//////////////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+// gpuWarp (pixels that map outside of the input are left unchanged)
+template<typename T, cudaFilterMode filter, typename Mapper>
+__global__ void gpuWarp( T* input, int inputWidth, int inputHeight,
+					T* output, int outputWidth, int outputHeight, Mapper mapper )
+{
+	const int x = blockDim.x * blockIdx.x + threadIdx.x;
+	const int y = blockDim.y * blockIdx.y + threadIdx.y;
+				   
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const float2 uv = mapper(x, y);
+
+	const int u = uv.x;
+	const int v = uv.y;
+
+	if( u < 0 || v < 0 || u >= inputWidth || v >= inputHeight )
+		return;
+
+	if( filter == FILTER_POINT )
+		output[y * outputWidth + x] = input[v * inputWidth + u];
+	else
+		output[y * outputWidth + x] = cudaFilterPixel<FILTER_LINEAR>(input, uv.x + 0.5f, uv.y + 0.5f, inputWidth, inputHeight);
+}
+
+// gpuWarpTexture (bilinear filtering is done by the texture unit)
+template<typename T, typename Mapper>
+__global__ void gpuWarpTexture( cudaTextureObject_t input, float scale, int inputWidth, int inputHeight,
+						  T* output, int outputWidth, int outputHeight, Mapper mapper )
+{
+	const int x = blockDim.x * blockIdx.x + threadIdx.x;
+	const int y = blockDim.y * blockIdx.y + threadIdx.y;
+				   
+	if( x >= outputWidth || y >= outputHeight )
+		return;
+
+	const float2 uv = mapper(x, y);
+
+	const int u = uv.x;
+	const int v = uv.y;
+
+	if( u < 0 || v < 0 || u >= inputWidth || v >= inputHeight )
+		return;
+
+	const float4 px = tex2D<float4>(input, uv.x + 0.5f, uv.y + 0.5f);
+	output[y * outputWidth + x] = cudaFilterAccum<T>::store(px * scale);
+}
+
+// gpuWarpMap (store the mapper's coordinates in a lookup table)
+template<typename Mapper>
+__global__ void gpuWarpMap( float2* map, int width, int height, Mapper mapper )
+{
+	const int x = blockDim.x * blockIdx.x + threadIdx.x;
+	const int y = blockDim.y * blockIdx.y + threadIdx.y;
+				   
+	if( x >= width || y >= height )
+		return;
+
+	map[y * width + x] = mapper(x, y);
+}
+
+///@}
+
+
+/**
+ * Get a texture object with bilinear filtering for an rgba8 or rgba32f image.
+ * The texture objects are cached by image pointer and dimensions, so they're only
+ * created once for each buffer that gets warped.
+ * @returns false if the image format or alignment isn't supported by textures.
+ * @ingroup warping
+ */
+bool cudaWarpTexture( cudaTextureObject_t* texture, void* image, uint32_t width, uint32_t height, imageFormat format );
+
+
+/**
+ * Launch the generic warp kernel for the given mapper and filter mode.
+ * With FILTER_LINEAR, rgba8/rgba32f images are sampled through a texture,
+ * and the other formats use software bilinear filtering instead.
+ * The supported formats are gray8, gray32f, rgb8, rgba8, rgb32f, and rgba32f.
+ * @ingroup warping
+ */
+template<typename Mapper>
+cudaError_t cudaWarpLaunch( void* input, uint32_t inputWidth, uint32_t inputHeight,
+					   void* output, uint32_t outputWidth, uint32_t outputHeight,
+					   imageFormat format, cudaFilterMode filter, const Mapper& mapper, 
+					   cudaStream_t stream, const char* function )
+{
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( inputWidth == 0 || inputHeight == 0 || outputWidth == 0 || outputHeight == 0 )
+		return cudaErrorInvalidValue;
+
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(outputWidth,blockDim.x), iDivUp(outputHeight,blockDim.y));
+
+	// use the texture hardware for bilinear filtering if possible
+	cudaTextureObject_t texture = 0;
+
+	if( filter != FILTER_POINT && cudaWarpTexture(&texture, input, inputWidth, inputHeight, format) )
+	{
+		if( format == IMAGE_RGBA8 )
+			gpuWarpTexture<uchar4><<<gridDim, blockDim, 0, stream>>>(texture, 255.0f, inputWidth, inputHeight, (uchar4*)output, outputWidth, outputHeight, mapper);
+		else
+			gpuWarpTexture<float4><<<gridDim, blockDim, 0, stream>>>(texture, 1.0f, inputWidth, inputHeight, (float4*)output, outputWidth, outputHeight, mapper);
+
+		return CUDA(cudaGetLastError());
+	}
+
+	#define LAUNCH_WARP(type) \
+		if( filter == FILTER_POINT ) \
+			gpuWarp<type, FILTER_POINT><<<gridDim, blockDim, 0, stream>>>((type*)input, inputWidth, inputHeight, (type*)output, outputWidth, outputHeight, mapper); \
+		else \
+			gpuWarp<type, FILTER_LINEAR><<<gridDim, blockDim, 0, stream>>>((type*)input, inputWidth, inputHeight, (type*)output, outputWidth, outputHeight, mapper)
+
+	if( format == IMAGE_GRAY8 )
+		LAUNCH_WARP(uint8_t);
+	else if( format == IMAGE_GRAY32F )
+		LAUNCH_WARP(float);
+	else if( format == IMAGE_RGB8 )
+		LAUNCH_WARP(uchar3);
+	else if( format == IMAGE_RGBA8 )
+		LAUNCH_WARP(uchar4);
+	else if( format == IMAGE_RGB32F )
+		LAUNCH_WARP(float3); 
+	else if( format == IMAGE_RGBA32F )
+		LAUNCH_WARP(float4);
+	else
+	{
+		imageFormatErrorMsg(LOG_CUDA, function, format);
+		return cudaErrorInvalidValue;
+	}
+
+	#undef LAUNCH_WARP
+
+	return CUDA(cudaGetLastError());
+}
+
+
+/**
+ * Launch the kernel that fills a lookup table with the mapper's coordinates.
+ * @ingroup warping
+ */
+template<typename Mapper>
+cudaError_t cudaWarpMapLaunch( float2* map, uint32_t width, uint32_t height, const Mapper& mapper, cudaStream_t stream )
+{
+	if( !map )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	const dim3 blockDim(8, 8);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y));
+
+	gpuWarpMap<<<gridDim, blockDim, 0, stream>>>(map, width, height, mapper);
+
+	return CUDA(cudaGetLastError());
+}
+
+
+// setup the transformation for the CUDA kernel
+inline static void invertTransform( float3 cuda_mat[3], const float transform[3][3], bool transform_inverted )
+{
+	// invert the matrix if it isn't already
+	if( !transform_inverted )
+	{
+		float inv[3][3];
+
+		mat33_inverse(inv, transform);
+
+		for( uint32_t i=0; i < 3; i++ )
+		{
+			cuda_mat[i].x = inv[i][0];
+			cuda_mat[i].y = inv[i][1];
+			cuda_mat[i].z = inv[i][2];
+		}
+	}
+	else
+	{
+		for( uint32_t i=0; i < 3; i++ )
+		{
+			cuda_mat[i].x = transform[i][0];
+			cuda_mat[i].y = transform[i][1];
+			cuda_mat[i].z = transform[i][2];
+		}
+	}
+}
+
+
+#endif
@@ -26,6 +26,9 @@
 
 #include "cudaUtility.h"
 #include "imageFormat.h"
+#include "cudaFilterMode.h"
+
+#include <cuda_fp16.h>
 
 
 /**
@@ -35,7 +38,7 @@
  * @ingroup warping
  */
 cudaError_t cudaWarpAffine( uchar4* input, uchar4* output, uint32_t width, uint32_t height,
-					   const float transform[2][3], bool transform_inverted=false );
+					   const float transform[2][3], bool transform_inverted=false, cudaStream_t stream=NULL );
 
 
 /**
@@ -45,7 +48,63 @@ cudaError_t cudaWarpAffine( uchar4* input, uchar4* output, uint32_t width, uint3
  * @ingroup warping
  */
 cudaError_t cudaWarpAffine( float4* input, float4* output, uint32_t width, uint32_t height,
-					   const float transform[2][3], bool transform_inverted=false );
+					   const float transform[2][3], bool transform_inverted=false, cudaStream_t stream=NULL );
+
+
+/**
+ * The maximum number of transforms that cudaWarpAffineBatch() can process in one launch.
+ * @ingroup warping
+ */
+#define CUDA_WARP_MAX_BATCH 64
+
+/**
+ * Warp a batch of fixed-size crops out of an image with a 2x3 affine transform for each,
+ * using a single kernel launch (for example to align the faces or license plates that
+ * were detected in a frame).  Crop `n` gets written to the output image `n` of the batch,
+ * which starts `n * outputWidth * outputHeight` pixels into the output buffer.
+ *
+ * The transforms are in row-major order (transforms[n][row][column]) and map input
+ * coordinates to the crop's coordinates, unless transform_inverted is true.
+ * The pixels that map outside of the input image are set to zero.
+ * Up to CUDA_WARP_MAX_BATCH transforms can be processed per call.
+ *
+ * The supported formats are gray8, gray32f, rgb8/bgr8, rgba8/bgra8, rgb32f/bgr32f, and
+ * rgba32f/bgra32f.  The filter can be FILTER_POINT or FILTER_LINEAR (the other modes
+ * are sampled bilinearly).
+ * @ingroup warping
+ */
+cudaError_t cudaWarpAffineBatch( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat format,
+						   const float transforms[][2][3], uint32_t batchSize,
+						   void* output, uint32_t outputWidth, uint32_t outputHeight,
+						   cudaFilterMode filter=FILTER_LINEAR, bool transform_inverted=false, 
+						   cudaStream_t stream=NULL );
+
+/**
+ * Warp a batch of crops out of an image like above, and write them normalized into one
+ * planar RGB tensor (NCHW with N=batchSize) for DNN inference, in a single kernel launch.
+ * Each channel is normalized as `((pixel / 255) * (range.y - range.x) + range.x - mean) / stdDev`
+ * like cudaPreprocess(), and the input format can be rgb8, bgr8, rgba8, bgra8, rgb32f,
+ * bgr32f, rgba32f, or bgra32f (BGR images are swapped to RGB order).
+ * @ingroup warping
+ */
+cudaError_t cudaWarpAffineBatch( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat format,
+						   const float transforms[][2][3], uint32_t batchSize,
+						   float* output, uint32_t outputWidth, uint32_t outputHeight,
+						   const float2& range, const float3& mean=make_float3(0,0,0),
+						   const float3& stdDev=make_float3(1,1,1), cudaFilterMode filter=FILTER_LINEAR, 
+						   bool transform_inverted=false, cudaStream_t stream=NULL );
+
+/**
+ * Warp a batch of crops into a normalized planar RGB tensor with FP16 output.
+ * @see cudaWarpAffineBatch() for a description of the parameters.
+ * @ingroup warping
+ */
+cudaError_t cudaWarpAffineBatch( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat format,
+						   const float transforms[][2][3], uint32_t batchSize,
+						   __half* output, uint32_t outputWidth, uint32_t outputHeight,
+						   const float2& range, const float3& mean=make_float3(0,0,0),
+						   const float3& stdDev=make_float3(1,1,1), cudaFilterMode filter=FILTER_LINEAR, 
+						   bool transform_inverted=false, cudaStream_t stream=NULL );
 
 
 /**
@@ -56,7 +115,7 @@ cudaError_t cudaWarpAffine( float4* input, float4* output, uint32_t width, uint3
  */
 cudaError_t cudaWarpPerspective( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat inputFormat,
 						   void* output, uint32_t outputWidth, uint32_t outputHeight, imageFormat outputFormat,
-					        const float transform[3][3], bool transform_inverted=false );
+					        const float transform[3][3], bool transform_inverted=false, cudaStream_t stream=NULL );
 		
 		
 /**
@@ -68,11 +127,29 @@ cudaError_t cudaWarpPerspective( void* input, uint32_t inputWidth, uint32_t inpu
 template<typename T> 
 cudaError_t cudaWarpPerspective( T* input, uint32_t inputWidth, uint32_t inputHeight,
 						   T* output, uint32_t outputWidth, uint32_t outputHeight,
-					        const float transform[3][3], bool transform_inverted=false )
+					        const float transform[3][3], bool transform_inverted=false, cudaStream_t stream=NULL )
 { 
-	return cudaWarpPerspective(input, inputWidth, inputHeight, imageFormatFromType<T>(), output, outputWidth, outputHeight, imageFormatFromType<T>(), transform, transform_inverted);
+	return cudaWarpPerspective(input, inputWidth, inputHeight, imageFormatFromType<T>(), output, outputWidth, outputHeight, imageFormatFromType<T>(), transform, transform_inverted, stream);
 }	
 
+
+/**
+ * Apply a 3x3 perspective warp to an image, with point or bilinear filtering.
+ * The 3x3 matrix transform is in row-major order (transform[row][column])
+ * If the transform has already been inverted, set transform_inverted to true.
+ *
+ * With FILTER_LINEAR, rgba8 and rgba32f images are read through a texture object
+ * so that the bilinear interpolation is done by the texture hardware (the other
+ * formats, or buffers that don't meet the texture alignment, are filtered in software).
+ * The pixels that map outside of the input image are left unchanged.
+ *
+ * @ingroup warping
+ */
+cudaError_t cudaWarpPerspective( void* input, uint32_t inputWidth, uint32_t inputHeight, imageFormat inputFormat,
+						   void* output, uint32_t outputWidth, uint32_t outputHeight, imageFormat outputFormat,
+					        const float transform[3][3], cudaFilterMode filter, bool transform_inverted=false, 
+						   cudaStream_t stream=NULL );
+
 						   
 /**
  * Apply 3x3 perspective warp to an 8-bit fixed-point RGBA image.
@@ -83,7 +160,7 @@ cudaError_t cudaWarpPerspective( T* input, uint32_t inputWidth, uint32_t inputHe
  * @ingroup warping
  */
 cudaError_t cudaWarpPerspective( uchar4* input, uchar4* output, uint32_t width, uint32_t height,
-					        const float transform[3][3], bool transform_inverted=false );
+					        const float transform[3][3], bool transform_inverted=false, cudaStream_t stream=NULL );
 
 
 /**
@@ -95,7 +172,7 @@ cudaError_t cudaWarpPerspective( uchar4* input, uchar4* output, uint32_t width,
  * @ingroup warping
  */
 cudaError_t cudaWarpPerspective( float4* input, float4* output, uint32_t width, uint32_t height,
-					        const float transform[3][3], bool transform_inverted=false );
+					        const float transform[3][3], bool transform_inverted=false, cudaStream_t stream=NULL );
 
 
 /**
@@ -104,7 +181,7 @@ cudaError_t cudaWarpPerspective( float4* input, float4* output, uint32_t width,
  * @ingroup warping
  */
 cudaError_t cudaWarpIntrinsic( uchar4* input, uchar4* output, uint32_t width, uint32_t height,
-						 const float2& focalLength, const float2& principalPoint, const float4& distortion );
+						 const float2& focalLength, const float2& principalPoint, const float4& distortion, cudaStream_t stream=NULL );
 											  
 
 /**
@@ -113,15 +190,26 @@ cudaError_t cudaWarpIntrinsic( uchar4* input, uchar4* output, uint32_t width, ui
  * @ingroup warping
  */
 cudaError_t cudaWarpIntrinsic( float4* input, float4* output, uint32_t width, uint32_t height,
-						 const float2& focalLength, const float2& principalPoint, const float4& distortion );
+						 const float2& focalLength, const float2& principalPoint, const float4& distortion, cudaStream_t stream=NULL );
 											  
 
+/**
+ * Apply instrinsic lens distortion correction to an image, with point or bilinear filtering.
+ * Pinhole camera model with radial (barrel) distortion and tangential distortion.
+ * Bilinear filtering uses the texture hardware for rgba8/rgba32f, like cudaWarpPerspective().
+ * @ingroup warping
+ */
+cudaError_t cudaWarpIntrinsic( void* input, void* output, uint32_t width, uint32_t height, imageFormat format,
+						 const float2& focalLength, const float2& principalPoint, const float4& distortion,
+						 cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+
 /**
  * Apply fisheye lens dewarping to an 8-bit fixed-point RGBA image.
  * @param[in] focus focus of the lens (in mm).
  * @ingroup warping
  */
-cudaError_t cudaWarpFisheye( uchar4* input, uchar4* output, uint32_t width, uint32_t height, float focus );
+cudaError_t cudaWarpFisheye( uchar4* input, uchar4* output, uint32_t width, uint32_t height, float focus, cudaStream_t stream=NULL );
 
 
 /**
@@ -129,7 +217,119 @@ cudaError_t cudaWarpFisheye( uchar4* input, uchar4* output, uint32_t width, uint
  * @param[in] focus focus of the lens (in mm).
  * @ingroup warping
  */
-cudaError_t cudaWarpFisheye( float4* input, float4* output, uint32_t width, uint32_t height, float focus );
+cudaError_t cudaWarpFisheye( float4* input, float4* output, uint32_t width, uint32_t height, float focus, cudaStream_t stream=NULL );
+
+
+/**
+ * Precompute the lookup table of a perspective warp for use with cudaRemap().
+ * For each output pixel, the map stores the coordinates of the input pixel that gets
+ * sampled, so a fixed warp only needs one gather per pixel when it's applied.
+ * @param map GPU-accessible array of width * height coordinates (i.e. allocated with cudaMalloc()).
+ * @param width the width of the output image (and the map).
+ * @param height the height of the output image (and the map).
+ * @ingroup warping
+ */
+cudaError_t cudaWarpMapPerspective( float2* map, uint32_t width, uint32_t height,
+						     const float transform[3][3], bool transform_inverted=false, cudaStream_t stream=NULL );
+
+
+/**
+ * Precompute the lookup table of an intrinsic lens distortion correction for use with cudaRemap().
+ * This is useful when the camera calibration is fixed, so the distortion model doesn't get
+ * evaluated again for every frame.
+ * @param map GPU-accessible array of width * height coordinates (i.e. allocated with cudaMalloc()).
+ * @ingroup warping
+ */
+cudaError_t cudaWarpMapIntrinsic( float2* map, uint32_t width, uint32_t height,
+						    const float2& focalLength, const float2& principalPoint, const float4& distortion, 
+						    cudaStream_t stream=NULL );
+
+
+/**
+ * Precompute the lookup table of a fisheye lens dewarping for use with cudaRemap().
+ * @param map GPU-accessible array of width * height coordinates (i.e. allocated with cudaMalloc()).
+ * @param[in] focus focus of the lens (in mm).
+ * @ingroup warping
+ */
+cudaError_t cudaWarpMapFisheye( float2* map, uint32_t width, uint32_t height, float focus, cudaStream_t stream=NULL );
+
+
+/**
+ * Warp an image using a lookup table of input coordinates for each output pixel,
+ * like the ones generated by cudaWarpMapPerspective(), cudaWarpMapIntrinsic(), and
+ * cudaWarpMapFisheye(), or loaded from a calibration tool with cudaWarpMapFromXY().
+ * The map should have outputWidth * outputHeight entries, and the pixels whose
+ * coordinates are outside of the input image are left unchanged.
+ *
+ * The supported formats are gray8, gray32f, rgb8, rgba8, rgb32f, and rgba32f.
+ * Bilinear filtering uses the texture hardware for rgba8/rgba32f, like cudaWarpPerspective().
+ * @ingroup warping
+ */
+cudaError_t cudaRemap( void* input, uint32_t inputWidth, uint32_t inputHeight,
+				   void* output, uint32_t outputWidth, uint32_t outputHeight,
+				   imageFormat format, const float2* map, cudaFilterMode filter=FILTER_LINEAR, 
+				   cudaStream_t stream=NULL );
+
+/**
+ * Warp an image using a lookup table of input coordinates for each output pixel.
+ * @see cudaRemap()
+ * @ingroup warping
+ */
+template<typename T> 
+cudaError_t cudaRemap( T* input, uint32_t inputWidth, uint32_t inputHeight,
+				   T* output, uint32_t outputWidth, uint32_t outputHeight,
+				   const float2* map, cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL )
+{
+	return cudaRemap(input, inputWidth, inputHeight, output, outputWidth, outputHeight, imageFormatFromType<T>(), map, filter, stream);
+}
+
+/**
+ * Warp an image using a half-precision lookup table (which uses half the memory bandwidth).
+ * Half-precision coordinates only have 11 bits of precision, so they're in 1/4 pixel steps up
+ * to 512 and 1 pixel steps up to 2048 - for larger images, the fixed-point map is more accurate.
+ * @see cudaRemap() and cudaWarpMapConvert()
+ * @ingroup warping
+ */
+cudaError_t cudaRemap( void* input, uint32_t inputWidth, uint32_t inputHeight,
+				   void* output, uint32_t outputWidth, uint32_t outputHeight,
+				   imageFormat format, const __half2* map, cudaFilterMode filter=FILTER_LINEAR, 
+				   cudaStream_t stream=NULL );
+
+/**
+ * Warp an image using a fixed-point lookup table (which uses half the memory bandwidth).
+ * Each coordinate is stored as a signed 16-bit integer with `fractionBits` sub-pixel bits,
+ * so with the default of 4 bits the coordinates are in 1/16 pixel steps up to +/- 2047.
+ * @see cudaRemap() and cudaWarpMapConvert()
+ * @ingroup warping
+ */
+cudaError_t cudaRemap( void* input, uint32_t inputWidth, uint32_t inputHeight,
+				   void* output, uint32_t outputWidth, uint32_t outputHeight,
+				   imageFormat format, const short2* map, int fractionBits=4, 
+				   cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+/**
+ * Compress a floating-point lookup table (with width * height entries) to half-precision.
+ * @ingroup warping
+ */
+cudaError_t cudaWarpMapConvert( const float2* input, __half2* output, uint32_t width, uint32_t height, cudaStream_t stream=NULL );
+
+/**
+ * Compress a floating-point lookup table (with width * height entries) to fixed-point.
+ * Coordinates that don't fit in 16 bits are clamped (and end up outside of the image).
+ * @ingroup warping
+ */
+cudaError_t cudaWarpMapConvert( const float2* input, short2* output, uint32_t width, uint32_t height, 
+						  int fractionBits=4, cudaStream_t stream=NULL );
+
+/**
+ * Interleave separate X and Y coordinate maps (for example, the maps from OpenCV's
+ * initUndistortRectifyMap() or another calibration tool) into a cudaRemap() lookup table.
+ * @param mapX GPU-accessible array of width * height input X coordinates.
+ * @param mapY GPU-accessible array of width * height input Y coordinates.
+ * @ingroup warping
+ */
+cudaError_t cudaWarpMapFromXY( const float* mapX, const float* mapY, float2* map, 
+						 uint32_t width, uint32_t height, cudaStream_t stream=NULL );
 
 							
 #endif
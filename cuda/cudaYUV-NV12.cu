@@ -22,38 +22,19 @@
 
 #include "cudaYUV.h"
 #include "cudaVector.h"
-
-#define COLOR_COMPONENT_MASK            0x3FF
-#define COLOR_COMPONENT_BIT_SIZE        10
-
-#define FIXED_DECIMAL_POINT             24
-#define FIXED_POINT_MULTIPLIER          1.0f
-#define FIXED_COLOR_COMPONENT_MASK      0xffffffff
+#include "cudaVectorIO.h"
+#include "cudaNVTX.h"
+#include "cudaColorimetry.cuh"
 
 
 //-----------------------------------------------------------------------------------
 // YUV to RGB colorspace conversion
 //-----------------------------------------------------------------------------------
-static inline __device__ float clamp( float x )	{ return fminf(fmaxf(x, 0.0f), 255.0f); }
-
-// YUV2RGB
 template<typename T>
-static inline __device__ T YUV2RGB(const uint3& yuvi)
+static inline __device__ T YUV2RGB( const cudaYUVMatrix& matrix, float y, float u, float v )
 {
-	const float luma = float(yuvi.x);
-	const float u    = float(yuvi.y) - 512.0f;
-	const float v    = float(yuvi.z) - 512.0f;
-	const float s    = 1.0f / 1024.0f * 255.0f;	// TODO clamp for uchar output?
-
-#if 1
-	return make_vec<T>(clamp((luma + 1.402f * v) * s),
-				    clamp((luma - 0.344f * u - 0.714f * v) * s),
-				    clamp((luma + 1.772f * u) * s), 255);
-#else
-	return make_vec<T>(clamp((luma + 1.140f * v) * s),
-				    clamp((luma - 0.395f * u - 0.581f * v) * s),
-				    clamp((luma + 2.032f * u) * s), 255);
-#endif
+	const float3 rgb = cudaYUVToRGB(matrix, y, u, v);
+	return make_vec<T>(rgb.x, rgb.y, rgb.z, 255);
 }
 
 
@@ -61,81 +42,79 @@ static inline __device__ T YUV2RGB(const uint3& yuvi)
 // NV12 to RGB
 //-----------------------------------------------------------------------------------
 template<typename T>
-__global__ void NV12ToRGB(uint32_t* srcImage, size_t nSourcePitch,
-                          T* dstImage,        size_t nDestPitch,
-                          uint32_t width,     uint32_t height)
+__global__ void NV12ToRGB(uint8_t* srcImage, size_t srcPitch,
+                          T* dstImage, uint32_t width, uint32_t height,
+                          cudaYUVMatrix matrix)
 {
-	int x, y;
-	uint32_t yuv101010Pel[2];
-	uint32_t processingPitch = ((width) + 63) & ~63;
-	uint8_t *srcImageU8     = (uint8_t *)srcImage;
+	// each thread converts 2 pixels, since CbCr are decimated horizontally
+	const uint32_t x = blockIdx.x * (blockDim.x << 1) + (threadIdx.x << 1);
+	const uint32_t y = blockIdx.y *  blockDim.y       +  threadIdx.y;
 
-	processingPitch = nSourcePitch;
+	if( x >= width || y >= height )
+		return;
 
-	// Pad borders with duplicate pixels, and we multiply by 2 because we process 2 pixels per thread
-	x = blockIdx.x * (blockDim.x << 1) + (threadIdx.x << 1);
-	y = blockIdx.y *  blockDim.y       +  threadIdx.y;
+	const uint8_t* chromaPlane = srcImage + srcPitch * height;
+	const uint32_t y_chroma = y >> 1;
 
-	if( x >= width )
-		return; //x = width - 1;
+	uint32_t chromaCb = chromaPlane[y_chroma * srcPitch + x];
+	uint32_t chromaCr = chromaPlane[y_chroma * srcPitch + x + 1];
 
-	if( y >= height )
-		return; // y = height - 1;
+	if( (y & 1) && y_chroma < ((height >> 1) - 1) ) // interpolate chroma vertically on odd scanlines
+	{
+		chromaCb = (chromaCb + chromaPlane[(y_chroma + 1) * srcPitch + x    ] + 1) >> 1;
+		chromaCr = (chromaCr + chromaPlane[(y_chroma + 1) * srcPitch + x + 1] + 1) >> 1;
+	}
 
-	// Read 2 Luma components at a time, so we don't waste processing since CbCr are decimated this way.
-	// if we move to texture we could read 4 luminance values
-	yuv101010Pel[0] = (srcImageU8[y * processingPitch + x    ]) << 2;
-	yuv101010Pel[1] = (srcImageU8[y * processingPitch + x + 1]) << 2;
+	dstImage[y * width + x]     = YUV2RGB<T>(matrix, srcImage[y * srcPitch + x], chromaCb, chromaCr);
+	dstImage[y * width + x + 1] = YUV2RGB<T>(matrix, srcImage[y * srcPitch + x + 1], chromaCb, chromaCr);
+}
 
-	uint32_t chromaOffset    = processingPitch * height;
-	int y_chroma = y >> 1;
 
-	if (y & 1)  // odd scanline ?
-	{
-		uint32_t chromaCb;
-		uint32_t chromaCr;
+// NV12ToRGBVec (each thread converts a run of N pixels from a row)
+template<typename T, int N>
+__global__ void NV12ToRGBVec(const uint8_t* srcImage, T* dstImage, uint32_t width, uint32_t height, cudaYUVMatrix matrix)
+{
+	const uint32_t x = (blockIdx.x * blockDim.x + threadIdx.x) * N;
+	const uint32_t y = blockIdx.y * blockDim.y + threadIdx.y;
 
-		chromaCb = srcImageU8[chromaOffset + y_chroma * processingPitch + x    ];
-		chromaCr = srcImageU8[chromaOffset + y_chroma * processingPitch + x + 1];
+	// the width is a multiple of N, so every thread has a full run
+	if( x >= width || y >= height )
+		return;
 
-		if (y_chroma < ((height >> 1) - 1)) // interpolate chroma vertically
-		{
-			chromaCb = (chromaCb + srcImageU8[chromaOffset + (y_chroma + 1) * processingPitch + x    ] + 1) >> 1;
-			chromaCr = (chromaCr + srcImageU8[chromaOffset + (y_chroma + 1) * processingPitch + x + 1] + 1) >> 1;
-		}
+	const uint8_t* chromaPlane = srcImage + width * height;
+	const uint32_t y_chroma = y >> 1;
 
-		yuv101010Pel[0] |= (chromaCb << (COLOR_COMPONENT_BIT_SIZE       + 2));
-		yuv101010Pel[0] |= (chromaCr << ((COLOR_COMPONENT_BIT_SIZE << 1) + 2));
+	cudaPixelRun<uint8_t, N> luma;
+	cudaPixelRun<uint8_t, N> chroma;
 
-		yuv101010Pel[1] |= (chromaCb << (COLOR_COMPONENT_BIT_SIZE       + 2));
-		yuv101010Pel[1] |= (chromaCr << ((COLOR_COMPONENT_BIT_SIZE << 1) + 2));
-	}
-	else
+	cudaLoadPixels(srcImage + y * width + x, luma);
+	cudaLoadPixels(chromaPlane + y_chroma * width + x, chroma);
+
+	if( (y & 1) && y_chroma < ((height >> 1) - 1) ) // interpolate chroma vertically
 	{
-		yuv101010Pel[0] |= ((uint32_t)srcImageU8[chromaOffset + y_chroma * processingPitch + x    ] << (COLOR_COMPONENT_BIT_SIZE       + 2));
-		yuv101010Pel[0] |= ((uint32_t)srcImageU8[chromaOffset + y_chroma * processingPitch + x + 1] << ((COLOR_COMPONENT_BIT_SIZE << 1) + 2));
+		cudaPixelRun<uint8_t, N> next;
+		cudaLoadPixels(chromaPlane + (y_chroma + 1) * width + x, next);
 
-		yuv101010Pel[1] |= ((uint32_t)srcImageU8[chromaOffset + y_chroma * processingPitch + x    ] << (COLOR_COMPONENT_BIT_SIZE       + 2));
-		yuv101010Pel[1] |= ((uint32_t)srcImageU8[chromaOffset + y_chroma * processingPitch + x + 1] << ((COLOR_COMPONENT_BIT_SIZE << 1) + 2));
+		#pragma unroll
+		for( int n=0; n < N; n++ )
+			chroma.px[n] = (uint32_t(chroma.px[n]) + uint32_t(next.px[n]) + 1) >> 1;
+	}
+
+	cudaPixelRun<T, N> rgb;
+
+	#pragma unroll
+	for( int n=0; n < N; n++ )
+	{
+		// CbCr are interleaved, and shared by each pair of pixels
+		rgb.px[n] = YUV2RGB<T>(matrix, luma.px[n], chroma.px[n & ~1], chroma.px[n | 1]);
 	}
 
-	// this steps performs the color conversion
-	const uint3 yuvi_0 = make_uint3((yuv101010Pel[0] &   COLOR_COMPONENT_MASK),
-	                               ((yuv101010Pel[0] >>  COLOR_COMPONENT_BIT_SIZE)       & COLOR_COMPONENT_MASK),
-					               ((yuv101010Pel[0] >> (COLOR_COMPONENT_BIT_SIZE << 1)) & COLOR_COMPONENT_MASK));
-  
-	const uint3 yuvi_1 = make_uint3((yuv101010Pel[1] &   COLOR_COMPONENT_MASK),
-							       ((yuv101010Pel[1] >>  COLOR_COMPONENT_BIT_SIZE)       & COLOR_COMPONENT_MASK),
-								   ((yuv101010Pel[1] >> (COLOR_COMPONENT_BIT_SIZE << 1)) & COLOR_COMPONENT_MASK));
-								   
-	// YUV to RGB transformation conversion
-	dstImage[y * width + x]     = YUV2RGB<T>(yuvi_0);
-	dstImage[y * width + x + 1] = YUV2RGB<T>(yuvi_1);
+	cudaStorePixels(dstImage + y * width + x, rgb);
 }
 
 
 template<typename T> 
-static cudaError_t launchNV12ToRGB( void* srcDev, T* dstDev, size_t width, size_t height )
+static cudaError_t launchNV12ToRGB( void* srcDev, T* dstDev, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
 	if( !srcDev || !dstDev )
 		return cudaErrorInvalidDevicePointer;
@@ -143,91 +122,244 @@ static cudaError_t launchNV12ToRGB( void* srcDev, T* dstDev, size_t width, size_
 	if( width == 0 || height == 0 )
 		return cudaErrorInvalidValue;
 
+	const cudaYUVMatrix matrix = cudaColorimetryMatrix(colorimetry);
+
+	// use the vectorized kernel when the rows are made of whole runs
+	if( width % CUDA_VECTOR_PIXELS == 0 && cudaIsVectorAligned<uint8_t, CUDA_VECTOR_PIXELS>(srcDev) && cudaIsVectorAligned<T, CUDA_VECTOR_PIXELS>(dstDev) )
+	{
+		const dim3 blockDim(32,8,1);
+		const dim3 gridDim(iDivUp(width / CUDA_VECTOR_PIXELS, blockDim.x), iDivUp(height, blockDim.y), 1);
+
+		NV12ToRGBVec<T, CUDA_VECTOR_PIXELS><<<gridDim, blockDim, 0, stream>>>((uint8_t*)srcDev, dstDev, width, height, matrix);
+
+		return CUDA(cudaGetLastError());
+	}
+
 	const size_t srcPitch = width * sizeof(uint8_t);
-	const size_t dstPitch = width * sizeof(T);
+
+	const dim3 blockDim(32,8,1);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height, blockDim.y), 1);
+
+	NV12ToRGB<T><<<gridDim, blockDim, 0, stream>>>( (uint8_t*)srcDev, srcPitch, dstDev, width, height, matrix );
 	
+	return CUDA(cudaGetLastError());
+}
+
+// cudaNV12ToRGB (uchar3)
+cudaError_t cudaNV12ToRGB( void* srcDev, uchar3* destDev, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaNV12ToRGB");
+
+	return launchNV12ToRGB<uchar3>(srcDev, destDev, width, height, stream, colorimetry);
+}
+
+// cudaNV12ToRGB (float3)
+cudaError_t cudaNV12ToRGB( void* srcDev, float3* destDev, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaNV12ToRGB");
+
+	return launchNV12ToRGB<float3>(srcDev, destDev, width, height, stream, colorimetry);
+}
+
+// cudaNV12ToRGBA (uchar4)
+cudaError_t cudaNV12ToRGBA( void* srcDev, uchar4* destDev, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaNV12ToRGBA");
+
+	return launchNV12ToRGB<uchar4>(srcDev, destDev, width, height, stream, colorimetry);
+}
+
+// cudaNV12ToRGBA (float4)
+cudaError_t cudaNV12ToRGBA( void* srcDev, float4* destDev, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaNV12ToRGBA");
+
+	return launchNV12ToRGB<float4>(srcDev, destDev, width, height, stream, colorimetry);
+}
+
+
+//-----------------------------------------------------------------------------------
+// NV12 to RGB (from texture objects)
+//-----------------------------------------------------------------------------------
+template <typename T>
+__global__ void NV12ToRGBTex( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, T* dstImage, int width, int height, cudaYUVMatrix matrix )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	// the chroma texture is linearly filtered, so sampling between chroma rows at (y+0.5)/2
+	// interpolates it vertically, while x stays on the texel center to share CbCr per pair
+	const uint8_t luma   = tex2D<uint8_t>(lumaTex, x, y);
+	const float2  chroma = tex2D<float2>(chromaTex, (x / 2) + 0.5f, (y + 0.5f) * 0.5f);
+
+	dstImage[y * width + x] = YUV2RGB<T>(matrix, luma, chroma.x * 255.0f, chroma.y * 255.0f);
+}
+
+template<typename T> 
+static cudaError_t launchNV12ToRGBTex( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, T* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	if( !lumaTex || !chromaTex || !output )
+		return cudaErrorInvalidValue;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
 	const dim3 blockDim(32,8,1);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height, blockDim.y), 1);
 
-	NV12ToRGB<T><<<gridDim, blockDim>>>( (uint32_t*)srcDev, srcPitch, dstDev, dstPitch, width, height );
+	NV12ToRGBTex<T><<<gridDim, blockDim, 0, stream>>>(lumaTex, chromaTex, output, width, height, cudaColorimetryMatrix(colorimetry));
 	
 	return CUDA(cudaGetLastError());
 }
 
 // cudaNV12ToRGB (uchar3)
-cudaError_t cudaNV12ToRGB( void* srcDev, uchar3* destDev, size_t width, size_t height )
+cudaError_t cudaNV12ToRGB( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, uchar3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchNV12ToRGB<uchar3>(srcDev, destDev, width, height);
+	NVTX_RANGE("cudaNV12ToRGB");
+
+	return launchNV12ToRGBTex<uchar3>(lumaTex, chromaTex, output, width, height, stream, colorimetry);
 }
 
 // cudaNV12ToRGB (float3)
-cudaError_t cudaNV12ToRGB( void* srcDev, float3* destDev, size_t width, size_t height )
+cudaError_t cudaNV12ToRGB( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, float3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchNV12ToRGB<float3>(srcDev, destDev, width, height);
+	NVTX_RANGE("cudaNV12ToRGB");
+
+	return launchNV12ToRGBTex<float3>(lumaTex, chromaTex, output, width, height, stream, colorimetry);
 }
 
 // cudaNV12ToRGBA (uchar4)
-cudaError_t cudaNV12ToRGBA( void* srcDev, uchar4* destDev, size_t width, size_t height )
+cudaError_t cudaNV12ToRGBA( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, uchar4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchNV12ToRGB<uchar4>(srcDev, destDev, width, height);
+	NVTX_RANGE("cudaNV12ToRGBA");
+
+	return launchNV12ToRGBTex<uchar4>(lumaTex, chromaTex, output, width, height, stream, colorimetry);
 }
 
 // cudaNV12ToRGBA (float4)
-cudaError_t cudaNV12ToRGBA( void* srcDev, float4* destDev, size_t width, size_t height )
+cudaError_t cudaNV12ToRGBA( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, float4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchNV12ToRGB<float4>(srcDev, destDev, width, height);
+	NVTX_RANGE("cudaNV12ToRGBA");
+
+	return launchNV12ToRGBTex<float4>(lumaTex, chromaTex, output, width, height, stream, colorimetry);
 }
 
 
-#if 0
-// cudaNV12SetupColorspace
-cudaError_t cudaNV12SetupColorspace( float hue )
+//-----------------------------------------------------------------------------------
+// RGB to NV12
+//-----------------------------------------------------------------------------------
+// each thread converts a 2x2 block, writing 4 luma samples and one interleaved U/V pair
+template <typename T>
+__global__ void RGBToNV12( T* src, int srcAlignedWidth, uint8_t* y_plane, int yPitch, uint8_t* uv_plane, int uvPitch, int width, int height, cudaYUVMatrix matrix )
 {
-	const float hueSin = sin(hue);
-	const float hueCos = cos(hue);
+	const int x = (blockIdx.x * blockDim.x + threadIdx.x) * 2;
+	const int y = (blockIdx.y * blockDim.y + threadIdx.y) * 2;
 
-	float hueCSC[9];
+	const int x1 = x + 1;
+	const int y1 = y + 1;
 
-	const bool itu601 = false;
+	if( x1 >= width || y1 >= height )
+		return;
 
-	if( itu601 /*CSC == ITU601*/)
-	{
-		//CCIR 601
-		hueCSC[0] = 1.1644f;
-		hueCSC[1] = hueSin * 1.5960f;
-		hueCSC[2] = hueCos * 1.5960f;
-		hueCSC[3] = 1.1644f;
-		hueCSC[4] = (hueCos * -0.3918f) - (hueSin * 0.8130f);
-		hueCSC[5] = (hueSin *  0.3918f) - (hueCos * 0.8130f);
-		hueCSC[6] = 1.1644f;
-		hueCSC[7] = hueCos *  2.0172f;
-		hueCSC[8] = hueSin * -2.0172f;
-	}
-	else /*if(CSC == ITU709)*/
-	{
-		//CCIR 709
-		hueCSC[0] = 1.0f;
-		hueCSC[1] = hueSin * 1.57480f;
-		hueCSC[2] = hueCos * 1.57480f;
-		hueCSC[3] = 1.0;
-		hueCSC[4] = (hueCos * -0.18732f) - (hueSin * 0.46812f);
-		hueCSC[5] = (hueSin *  0.18732f) - (hueCos * 0.46812f);
-		hueCSC[6] = 1.0f;
-		hueCSC[7] = hueCos *  1.85560f;
-		hueCSC[8] = hueSin * -1.85560f;
-	}
+	const float3 px00 = make_float3(src[y * srcAlignedWidth + x]);
+	const float3 px01 = make_float3(src[y * srcAlignedWidth + x1]);
+	const float3 px10 = make_float3(src[y1 * srcAlignedWidth + x]);
+	const float3 px11 = make_float3(src[y1 * srcAlignedWidth + x1]);
+
+	y_plane[y * yPitch + x]   = cudaRGBToLuma(matrix, px00);
+	y_plane[y * yPitch + x1]  = cudaRGBToLuma(matrix, px01);
+	y_plane[y1 * yPitch + x]  = cudaRGBToLuma(matrix, px10);
+	y_plane[y1 * yPitch + x1] = cudaRGBToLuma(matrix, px11);
+
+	// subsample chroma from the average of the 2x2 block
+	const float3 avg = (px00 + px01 + px10 + px11) * 0.25f;
+
+	uint8_t* uv = uv_plane + (y / 2) * uvPitch + x;
+
+	uv[0] = cudaRGBToChromaU(matrix, avg);
+	uv[1] = cudaRGBToChromaV(matrix, avg);
+}
+
+template<typename T>
+static cudaError_t launchRGBToNV12( T* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	if( !input || !inputPitch || !outputY || !outputPitchY || !outputUV || !outputPitchUV || !width || !height )
+		return cudaErrorInvalidValue;
 
+	const dim3 block(32, 8);
+	const dim3 grid(iDivUp(width, block.x * 2), iDivUp(height, block.y * 2));
 
-	if( CUDA_FAILED(cudaMemcpyToSymbol(constHueColorSpaceMat, hueCSC, sizeof(float) * 9)) )
-		return cudaErrorInvalidSymbol;
+	const int inputAlignedWidth = inputPitch / sizeof(T);
 
-	uint32_t cudaAlpha = ((uint32_t)0xff<< 24);
+	RGBToNV12<T><<<grid, block, 0, stream>>>(input, inputAlignedWidth, (uint8_t*)outputY, outputPitchY, (uint8_t*)outputUV, outputPitchUV, width, height, cudaColorimetryMatrix(colorimetry));
 
-	if( CUDA_FAILED(cudaMemcpyToSymbol(constAlpha, &cudaAlpha, sizeof(uint32_t))) )
-		return cudaErrorInvalidSymbol;
+	return CUDA(cudaGetLastError());
+}
+
+// cudaRGBToNV12 (uchar3)
+cudaError_t cudaRGBToNV12( uchar3* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaRGBToNV12");
+
+	return launchRGBToNV12<uchar3>(input, inputPitch, outputY, outputPitchY, outputUV, outputPitchUV, width, height, stream, colorimetry);
+}
+
+// cudaRGBToNV12 (uchar3)
+cudaError_t cudaRGBToNV12( uchar3* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaRGBToNV12");
+
+	return cudaRGBToNV12(input, width * sizeof(uchar3), output, width * sizeof(uint8_t), (uint8_t*)output + width * height, width * sizeof(uint8_t), width, height, stream, colorimetry);
+}
+
+// cudaRGBToNV12 (float3)
+cudaError_t cudaRGBToNV12( float3* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaRGBToNV12");
+
+	return launchRGBToNV12<float3>(input, inputPitch, outputY, outputPitchY, outputUV, outputPitchUV, width, height, stream, colorimetry);
+}
+
+// cudaRGBToNV12 (float3)
+cudaError_t cudaRGBToNV12( float3* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaRGBToNV12");
+
+	return cudaRGBToNV12(input, width * sizeof(float3), output, width * sizeof(uint8_t), (uint8_t*)output + width * height, width * sizeof(uint8_t), width, height, stream, colorimetry);
+}
+
+// cudaRGBAToNV12 (uchar4)
+cudaError_t cudaRGBAToNV12( uchar4* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaRGBAToNV12");
+
+	return launchRGBToNV12<uchar4>(input, inputPitch, outputY, outputPitchY, outputUV, outputPitchUV, width, height, stream, colorimetry);
+}
+
+// cudaRGBAToNV12 (uchar4)
+cudaError_t cudaRGBAToNV12( uchar4* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaRGBAToNV12");
+
+	return cudaRGBAToNV12(input, width * sizeof(uchar4), output, width * sizeof(uint8_t), (uint8_t*)output + width * height, width * sizeof(uint8_t), width, height, stream, colorimetry);
+}
+
+// cudaRGBAToNV12 (float4)
+cudaError_t cudaRGBAToNV12( float4* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaRGBAToNV12");
+
+	return launchRGBToNV12<float4>(input, inputPitch, outputY, outputPitchY, outputUV, outputPitchUV, width, height, stream, colorimetry);
+}
+
+// cudaRGBAToNV12 (float4)
+cudaError_t cudaRGBAToNV12( float4* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaRGBAToNV12");
 
-	nv12ColorspaceSetup = true;
-	return cudaSuccess;
+	return cudaRGBAToNV12(input, width * sizeof(float4), output, width * sizeof(uint8_t), (uint8_t*)output + width * height, width * sizeof(uint8_t), width, height, stream, colorimetry);
 }
-#endif
 
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cudaYUV.h"
+#include "cudaNVTX.h"
+#include "cudaColorimetry.cuh"
+
+#include "logging.h"
+
+#include <cuda_fp16.h>
+
+
+// store a color component (between 0 and 255) in the output type
+static inline __device__ void storeComponent( uint8_t* ptr, float value )	{ *ptr = (uint8_t)(value + 0.5f); }
+static inline __device__ void storeComponent( float* ptr, float value )		{ *ptr = value; }
+static inline __device__ void storeComponent( __half* ptr, float value )	{ *ptr = __float2half(value); }
+
+
+//-----------------------------------------------------------------------------------
+// P010/P016 to RGB
+//-----------------------------------------------------------------------------------
+template<typename T, int channels>
+__global__ void P010ToRGB( const uint16_t* input, T* output, int width, int height, float scale, cudaYUVMatrix matrix )
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if( x >= width || y >= height )
+		return;
+
+	// the UV plane follows the Y plane, with interleaved U/V pairs at half resolution
+	const uint16_t* chroma = input + width * height + (y / 2) * width + (x / 2) * 2;
+
+	const float3 rgb = cudaYUVToRGB(matrix, input[y * width + x] * scale, chroma[0] * scale, chroma[1] * scale);
+
+	T* px = output + (y * width + x) * channels;
+
+	storeComponent(px + 0, rgb.x);
+	storeComponent(px + 1, rgb.y);
+	storeComponent(px + 2, rgb.z);
+
+	if( channels == 4 )
+		storeComponent(px + 3, 255.0f);
+}
+
+
+// cudaP010ToRGB
+cudaError_t cudaP010ToRGB( void* input, imageFormat inputFormat, void* output, imageFormat outputFormat, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
+{
+	NVTX_RANGE("cudaP010ToRGB");
+
+	if( !input || !output )
+		return cudaErrorInvalidDevicePointer;
+
+	if( width == 0 || height == 0 )
+		return cudaErrorInvalidValue;
+
+	if( inputFormat != IMAGE_P010 && inputFormat != IMAGE_P016 )
+	{
+		LogError(LOG_CUDA "cudaP010ToRGB() -- invalid input format '%s' (expected p010 or p016)\n", imageFormatToStr(inputFormat));
+		return cudaErrorInvalidValue;
+	}
+
+	// P010 has 10-bit samples in the upper bits (with the lower 6 bits zero)
+	const float scale = (inputFormat == IMAGE_P010) ? 255.0f / float(1023 << 6) : 255.0f / 65535.0f;
+	const cudaYUVMatrix matrix = cudaColorimetryMatrix(colorimetry);
+
+	const dim3 blockDim(32,8,1);
+	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height,blockDim.y), 1);
+
+	#define launch_p010(T, channels) \
+		P010ToRGB<T, channels><<<gridDim, blockDim, 0, stream>>>((uint16_t*)input, (T*)output, width, height, scale, matrix)
+
+	if( outputFormat == IMAGE_RGB8 )
+		launch_p010(uint8_t, 3);
+	else if( outputFormat == IMAGE_RGBA8 )
+		launch_p010(uint8_t, 4);
+	else if( outputFormat == IMAGE_RGB32F )
+		launch_p010(float, 3);
+	else if( outputFormat == IMAGE_RGBA32F )
+		launch_p010(float, 4);
+	else if( outputFormat == IMAGE_RGB16F )
+		launch_p010(__half, 3);
+	else if( outputFormat == IMAGE_RGBA16F )
+		launch_p010(__half, 4);
+	else
+	{
+		LogError(LOG_CUDA "cudaP010ToRGB() -- invalid output format '%s'\n", imageFormatToStr(outputFormat));
+		LogError(LOG_CUDA "                  supported formats are rgb8, rgba8, rgb32f, rgba32f, rgb16f, rgba16f\n");
+		return cudaErrorInvalidValue;
+	}
+
+	#undef launch_p010
+
+	return CUDA(cudaGetLastError());
+}
+
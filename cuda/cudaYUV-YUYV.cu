@@ -22,32 +22,11 @@
 
 #include "cudaYUV.h"
 #include "imageFormat.h"
+#include "cudaVectorIO.h"
+#include "cudaNVTX.h"
+#include "cudaColorimetry.cuh"
 
 
-//-----------------------------------------------------------------------------------
-// YUV to RGB colorspace conversion
-//-----------------------------------------------------------------------------------
-static inline __device__ float clamp( float x )	
-{ 
-	return fminf(fmaxf(x, 0.0f), 255.0f); 
-}
-
-static inline __device__ float3 YUV2RGB(float Y, float U, float V)
-{
-	U -= 128.0f;
-	V -= 128.0f;
-
-#if 1
-	return make_float3(clamp(Y + 1.4065f * V),
-    				    clamp(Y - 0.3455f * U - 0.7169f * V),
-				    clamp(Y + 1.7790f * U));
-#else
-	return make_float3(clamp(Y + 1.402f * V),
-    				    clamp(Y - 0.344f * U - 0.714f * V),
-				    clamp(Y + 1.772f * U));
-#endif
-}
-
 //-----------------------------------------------------------------------------------
 // YUYV/UYVY are macropixel formats, and two RGB pixels are output at once.
 // Define vectors with 6 and 8 elements so they can be written at one time.
@@ -98,7 +77,7 @@ template<> inline __host__ __device__ float8 make_vec( float x0, float y0, float
 // YUYV/UYVY to RGBA
 //-----------------------------------------------------------------------------------
 template <typename T, imageFormat format>
-__global__ void YUYVToRGBA( uchar4* src, T* dst, int halfWidth, int height )
+__global__ void YUYVToRGBA( uchar4* src, T* dst, int halfWidth, int height, cudaYUVMatrix matrix )
 {
 	const int x = blockIdx.x * blockDim.x + threadIdx.x;
 	const int y = blockIdx.y * blockDim.y + threadIdx.y;
@@ -138,102 +117,189 @@ __global__ void YUYVToRGBA( uchar4* src, T* dst, int halfWidth, int height )
 	}
 
 	// this function outputs two pixels from one YUYV macropixel
-	const float3 px0 = YUV2RGB(y0, u, v);
-	const float3 px1 = YUV2RGB(y1, u, v);
+	const float3 px0 = cudaYUVToRGB(matrix, y0, u, v);
+	const float3 px1 = cudaYUVToRGB(matrix, y1, u, v);
 
 	dst[y * halfWidth + x] = make_vec<T>(px0.x, px0.y, px0.z, 255,
 								  px1.x, px1.y, px1.z, 255);
 } 
 
+// YUYVToRGBAVec (each thread converts a run of N macropixels)
+template <typename T, imageFormat format, int N>
+__global__ void YUYVToRGBAVec( const uchar4* src, T* dst, int numMacroPx, cudaYUVMatrix matrix )
+{
+	const int first = (blockIdx.x * blockDim.x + threadIdx.x) * N;
+
+	// the number of macropixels is a multiple of N, so every thread has a full run
+	if( first >= numMacroPx )
+		return;
+
+	cudaPixelRun<uchar4, N> in;
+	cudaPixelRun<T, N> out;
+
+	cudaLoadPixels(src + first, in);
+
+	#pragma unroll
+	for( int n=0; n < N; n++ )
+	{
+		const uchar4 macroPx = in.px[n];
+		float y0, y1, u, v;
+
+		if( format == IMAGE_YUYV )
+		{
+			y0 = macroPx.x; y1 = macroPx.z;
+			u  = macroPx.y; v  = macroPx.w;
+		}
+		else if( format == IMAGE_YVYU )
+		{
+			y0 = macroPx.x; y1 = macroPx.z;
+			u  = macroPx.w; v  = macroPx.y;
+		}
+		else // if( format == IMAGE_UYVY )
+		{
+			y0 = macroPx.y; y1 = macroPx.w;
+			u  = macroPx.x; v  = macroPx.z;
+		}
+
+		const float3 px0 = cudaYUVToRGB(matrix, y0, u, v);
+		const float3 px1 = cudaYUVToRGB(matrix, y1, u, v);
+
+		out.px[n] = make_vec<T>(px0.x, px0.y, px0.z, 255,
+						    px1.x, px1.y, px1.z, 255);
+	}
+
+	cudaStorePixels(dst + first, out);
+}
+
 template<typename T, imageFormat format>
-static cudaError_t launchYUYVToRGB( void* input, T* output, size_t width, size_t height)
+static cudaError_t launchYUYVToRGB( void* input, T* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
 	if( !input || !output || !width || !height )
 		return cudaErrorInvalidValue;
 
 	const int  halfWidth = width / 2;	// two pixels are output at once
+	const cudaYUVMatrix matrix = cudaColorimetryMatrix(colorimetry);
+
+	// convert runs of macropixels (4 macropixels = 16 bytes) when the image is made of whole runs
+	const int numMacroPx = halfWidth * height;
+	const int runLength  = CUDA_VECTOR_PIXELS / 2;
+
+	if( width % 2 == 0 && numMacroPx % runLength == 0 && cudaIsVectorAligned<uchar4, CUDA_VECTOR_PIXELS/2>(input) && cudaIsVectorAligned<T, CUDA_VECTOR_PIXELS/2>(output) )
+	{
+		const dim3 blockDim(256,1,1);
+		const dim3 gridDim(iDivUp(numMacroPx / runLength, blockDim.x), 1, 1);
+
+		YUYVToRGBAVec<T, format, CUDA_VECTOR_PIXELS/2><<<gridDim, blockDim, 0, stream>>>((uchar4*)input, output, numMacroPx, matrix);
+
+		return CUDA(cudaGetLastError());
+	}
+
 	const dim3 blockDim(8,8);
 	const dim3 gridDim(iDivUp(halfWidth, blockDim.x), iDivUp(height, blockDim.y));
 
-	YUYVToRGBA<T, format><<<gridDim, blockDim>>>((uchar4*)input, output, halfWidth, height);
+	YUYVToRGBA<T, format><<<gridDim, blockDim, 0, stream>>>((uchar4*)input, output, halfWidth, height, matrix);
 
 	return CUDA(cudaGetLastError());
 }
 
 
 // cudaYUYVToRGB (uchar3)
-cudaError_t cudaYUYVToRGB( void* input, uchar3* output, size_t width, size_t height )
+cudaError_t cudaYUYVToRGB( void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<uchar6, IMAGE_YUYV>(input, (uchar6*)output, width, height);
+	NVTX_RANGE("cudaYUYVToRGB");
+
+	return launchYUYVToRGB<uchar6, IMAGE_YUYV>(input, (uchar6*)output, width, height, stream, colorimetry);
 }
 
 // cudaYUYVToRGB (float3)
-cudaError_t cudaYUYVToRGB( void* input, float3* output, size_t width, size_t height )
+cudaError_t cudaYUYVToRGB( void* input, float3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<float6, IMAGE_YUYV>(input, (float6*)output, width, height);
+	NVTX_RANGE("cudaYUYVToRGB");
+
+	return launchYUYVToRGB<float6, IMAGE_YUYV>(input, (float6*)output, width, height, stream, colorimetry);
 }
 
 // cudaYUYVToRGBA (uchar4)
-cudaError_t cudaYUYVToRGBA( void* input, uchar4* output, size_t width, size_t height )
+cudaError_t cudaYUYVToRGBA( void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<uchar8, IMAGE_YUYV>(input, (uchar8*)output, width, height);
+	NVTX_RANGE("cudaYUYVToRGBA");
+
+	return launchYUYVToRGB<uchar8, IMAGE_YUYV>(input, (uchar8*)output, width, height, stream, colorimetry);
 }
 
 // cudaYUYVToRGBA (float4)
-cudaError_t cudaYUYVToRGBA( void* input, float4* output, size_t width, size_t height )
+cudaError_t cudaYUYVToRGBA( void* input, float4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<float8, IMAGE_YUYV>(input, (float8*)output, width, height);
+	NVTX_RANGE("cudaYUYVToRGBA");
+
+	return launchYUYVToRGB<float8, IMAGE_YUYV>(input, (float8*)output, width, height, stream, colorimetry);
 }
 
 //-----------------------------------------------------------------------------------
 
 // cudaUYVYToRGB (uchar3)
-cudaError_t cudaUYVYToRGB( void* input, uchar3* output, size_t width, size_t height )
+cudaError_t cudaUYVYToRGB( void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<uchar6, IMAGE_UYVY>(input, (uchar6*)output, width, height);
+	NVTX_RANGE("cudaUYVYToRGB");
+
+	return launchYUYVToRGB<uchar6, IMAGE_UYVY>(input, (uchar6*)output, width, height, stream, colorimetry);
 }
 
 // cudaUYVYToRGB (float3)
-cudaError_t cudaUYVYToRGB( void* input, float3* output, size_t width, size_t height )
+cudaError_t cudaUYVYToRGB( void* input, float3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<float6, IMAGE_UYVY>(input, (float6*)output, width, height);
+	NVTX_RANGE("cudaUYVYToRGB");
+
+	return launchYUYVToRGB<float6, IMAGE_UYVY>(input, (float6*)output, width, height, stream, colorimetry);
 }
 
 // cudaUYVYToRGBA (uchar4)
-cudaError_t cudaUYVYToRGBA( void* input, uchar4* output, size_t width, size_t height )
+cudaError_t cudaUYVYToRGBA( void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<uchar8, IMAGE_UYVY>(input, (uchar8*)output, width, height);
+	NVTX_RANGE("cudaUYVYToRGBA");
+
+	return launchYUYVToRGB<uchar8, IMAGE_UYVY>(input, (uchar8*)output, width, height, stream, colorimetry);
 }
 
 // cudaUYVYToRGBA (float4)
-cudaError_t cudaUYVYToRGBA( void* input, float4* output, size_t width, size_t height )
+cudaError_t cudaUYVYToRGBA( void* input, float4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<float8, IMAGE_UYVY>(input, (float8*)output, width, height);
+	NVTX_RANGE("cudaUYVYToRGBA");
+
+	return launchYUYVToRGB<float8, IMAGE_UYVY>(input, (float8*)output, width, height, stream, colorimetry);
 }
 
 //-----------------------------------------------------------------------------------
 
 // cudaYVYUToRGB (uchar3)
-cudaError_t cudaYVYUToRGB( void* input, uchar3* output, size_t width, size_t height )
+cudaError_t cudaYVYUToRGB( void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<uchar6, IMAGE_YVYU>(input, (uchar6*)output, width, height);
+	NVTX_RANGE("cudaYVYUToRGB");
+
+	return launchYUYVToRGB<uchar6, IMAGE_YVYU>(input, (uchar6*)output, width, height, stream, colorimetry);
 }
 
 // cudaYUYVToRGB (float3)
-cudaError_t cudaYVYUToRGB( void* input, float3* output, size_t width, size_t height )
+cudaError_t cudaYVYUToRGB( void* input, float3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<float6, IMAGE_YVYU>(input, (float6*)output, width, height);
+	NVTX_RANGE("cudaYVYUToRGB");
+
+	return launchYUYVToRGB<float6, IMAGE_YVYU>(input, (float6*)output, width, height, stream, colorimetry);
 }
 
 // cudaYUYVToRGBA (uchar4)
-cudaError_t cudaYVYUToRGBA( void* input, uchar4* output, size_t width, size_t height )
+cudaError_t cudaYVYUToRGBA( void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<uchar8, IMAGE_YVYU>(input, (uchar8*)output, width, height);
+	NVTX_RANGE("cudaYVYUToRGBA");
+
+	return launchYUYVToRGB<uchar8, IMAGE_YVYU>(input, (uchar8*)output, width, height, stream, colorimetry);
 }
 
 // cudaYUYVToRGBA (float4)
-cudaError_t cudaYVYUToRGBA( void* input, float4* output, size_t width, size_t height )
+cudaError_t cudaYVYUToRGBA( void* input, float4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchYUYVToRGB<float8, IMAGE_YVYU>(input, (float8*)output, width, height);
+	NVTX_RANGE("cudaYVYUToRGBA");
+
+	return launchYUYVToRGB<float8, IMAGE_YVYU>(input, (float8*)output, width, height, stream, colorimetry);
 }
 
@@ -22,40 +22,19 @@
 
 #include "cudaYUV.h"
 #include "cudaVector.h"
+#include "cudaNVTX.h"
+#include "cudaColorimetry.cuh"
 
 
 
-//-----------------------------------------------------------------------------------
-// YUV to RGB colorspace conversion
-//-----------------------------------------------------------------------------------
-static inline __device__ float clamp( float x )	
-{ 
-	return fminf(fmaxf(x, 0.0f), 255.0f); 
-}
-
-static inline __device__ float3 YUV2RGB(float Y, float U, float V)
-{
-	U -= 128.0f;
-	V -= 128.0f;
-
-#if 1
-	return make_float3(clamp(Y + 1.402f * V),
-    				    clamp(Y - 0.344f * U - 0.714f * V),
-				    clamp(Y + 1.772f * U));
-#else
-	return make_float3(clamp(Y + 1.140f * V),
-			    	    clamp(Y - 0.395f * U - 0.581f * V),
-			         clamp(Y + 2.3032f * U));
-#endif
-}
-
 //-------------------------------------------------------------------------------------
 // I420/YV12 to RGB
 //-------------------------------------------------------------------------------------
 template <typename T, bool formatYV12>
 __global__ void I420ToRGB(uint8_t* srcImage, int srcPitch,
                           T* dstImage,     	int dstPitch,
-                          int width,         int height) 
+                          int width,         int height,
+                          cudaYUVMatrix matrix)
 {
 	const int x = blockIdx.x * blockDim.x + threadIdx.x;
 	const int y = blockIdx.y * blockDim.y + threadIdx.y;
@@ -93,13 +72,13 @@ __global__ void I420ToRGB(uint8_t* srcImage, int srcPitch,
 	const float U = u_plane[y2 * srcPitch2 + x2];
 	const float V = v_plane[y2 * srcPitch2 + x2];
 
-	const float3 RGB = YUV2RGB(Y, U, V);
+	const float3 RGB = cudaYUVToRGB(matrix, Y, U, V);
 
 	dstImage[y * width + x] = make_vec<T>(RGB.x, RGB.y, RGB.z, 255);
 }
 
 template <typename T, bool formatYV12>
-static cudaError_t launch420ToRGB(void* srcDev, T* dstDev, size_t width, size_t height) 
+static cudaError_t launch420ToRGB(void* srcDev, T* dstDev, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
 	if( !srcDev || !dstDev )
 		return cudaErrorInvalidDevicePointer;
@@ -114,80 +93,84 @@ static cudaError_t launch420ToRGB(void* srcDev, T* dstDev, size_t width, size_t
 	//const dim3 gridDim((width+(2*blockDim.x-1))/(2*blockDim.x), (height+(blockDim.y-1))/blockDim.y, 1);
 	const dim3 gridDim(iDivUp(width,blockDim.x), iDivUp(height, blockDim.y));
 
-	I420ToRGB<T, formatYV12><<<gridDim, blockDim>>>( (uint8_t*)srcDev, srcPitch, dstDev, dstPitch, width, height );
+	I420ToRGB<T, formatYV12><<<gridDim, blockDim, 0, stream>>>( (uint8_t*)srcDev, srcPitch, dstDev, dstPitch, width, height, cudaColorimetryMatrix(colorimetry) );
 
 	return CUDA(cudaGetLastError());
 }
 
 
 // cudaI420ToRGB (uchar3)
-cudaError_t cudaI420ToRGB(void* input, uchar3* output, size_t width, size_t height) 
+cudaError_t cudaI420ToRGB(void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
-    return launch420ToRGB<uchar3, false>(input, output, width, height);
+	NVTX_RANGE("cudaI420ToRGB");
+
+    return launch420ToRGB<uchar3, false>(input, output, width, height, stream, colorimetry);
 }
 
 // cudaI420ToRGB (float3)
-cudaError_t cudaI420ToRGB(void* input, float3* output, size_t width, size_t height) 
+cudaError_t cudaI420ToRGB(void* input, float3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
-    return launch420ToRGB<float3, false>(input, output, width, height);
+	NVTX_RANGE("cudaI420ToRGB");
+
+    return launch420ToRGB<float3, false>(input, output, width, height, stream, colorimetry);
 }
 
 // cudaI420ToRGBA (uchar4)
-cudaError_t cudaI420ToRGBA(void* input, uchar4* output, size_t width, size_t height) 
+cudaError_t cudaI420ToRGBA(void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
-    return launch420ToRGB<uchar4, false>(input, output, width, height);
+	NVTX_RANGE("cudaI420ToRGBA");
+
+    return launch420ToRGB<uchar4, false>(input, output, width, height, stream, colorimetry);
 }
 
 // cudaI420ToRGBA (float4)
-cudaError_t cudaI420ToRGBA(void* input, float4* output, size_t width, size_t height) 
+cudaError_t cudaI420ToRGBA(void* input, float4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
-    return launch420ToRGB<float4, false>(input, output, width, height);
+	NVTX_RANGE("cudaI420ToRGBA");
+
+    return launch420ToRGB<float4, false>(input, output, width, height, stream, colorimetry);
 }
 
 //-----------------------------------------------------------------------------------
 
 // cudaYV12ToRGB (uchar3)
-cudaError_t cudaYV12ToRGB(void* input, uchar3* output, size_t width, size_t height) 
+cudaError_t cudaYV12ToRGB(void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
-    return launch420ToRGB<uchar3, true>(input, output, width, height);
+	NVTX_RANGE("cudaYV12ToRGB");
+
+    return launch420ToRGB<uchar3, true>(input, output, width, height, stream, colorimetry);
 }
 
 // cudaYV12ToRGB (float3)
-cudaError_t cudaYV12ToRGB(void* input, float3* output, size_t width, size_t height) 
+cudaError_t cudaYV12ToRGB(void* input, float3* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
-    return launch420ToRGB<float3, true>(input, output, width, height);
+	NVTX_RANGE("cudaYV12ToRGB");
+
+    return launch420ToRGB<float3, true>(input, output, width, height, stream, colorimetry);
 }
 
 // cudaYV12ToRGBA (uchar4)
-cudaError_t cudaYV12ToRGBA(void* input, uchar4* output, size_t width, size_t height) 
+cudaError_t cudaYV12ToRGBA(void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
-    return launch420ToRGB<uchar4, true>(input, output, width, height);
+	NVTX_RANGE("cudaYV12ToRGBA");
+
+    return launch420ToRGB<uchar4, true>(input, output, width, height, stream, colorimetry);
 }
 
 // cudaYV12ToRGBA (float4)
-cudaError_t cudaYV12ToRGBA(void* input, float4* output, size_t width, size_t height) 
+cudaError_t cudaYV12ToRGBA(void* input, float4* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry ) 
 {
-    return launch420ToRGB<float4, true>(input, output, width, height);
+	NVTX_RANGE("cudaYV12ToRGBA");
+
+    return launch420ToRGB<float4, true>(input, output, width, height, stream, colorimetry);
 }
 
 
 //-------------------------------------------------------------------------------------
 // RGB to I420/YV12
 //-------------------------------------------------------------------------------------
-inline __device__ void rgb_to_y(const uint8_t r, const uint8_t g, const uint8_t b, uint8_t& y)
-{
-	y = static_cast<uint8_t>(((int)(30 * r) + (int)(59 * g) + (int)(11 * b)) / 100);
-}
-
-inline __device__ void rgb_to_yuv(const uint8_t r, const uint8_t g, const uint8_t b, uint8_t& y, uint8_t& u, uint8_t& v)
-{
-	rgb_to_y(r, g, b, y);
-	u = static_cast<uint8_t>(((int)(-17 * r) - (int)(33 * g) + (int)(50 * b) + 12800) / 100);
-	v = static_cast<uint8_t>(((int)(50 * r) - (int)(42 * g) - (int)(8 * b) + 12800) / 100);
-}
-
 template <typename T, bool formatYV12>
-__global__ void RGBToYV12( T* src, int srcAlignedWidth, uint8_t* dst, int dstPitch, int width, int height )
+__global__ void RGBToYV12( T* src, int srcAlignedWidth, uint8_t* dst, int dstPitch, int width, int height, cudaYUVMatrix matrix )
 {
 	const int x = (blockIdx.x * blockDim.x + threadIdx.x) * 2;
 	const int y = (blockIdx.y * blockDim.y + threadIdx.y) * 2;
@@ -215,34 +198,28 @@ __global__ void RGBToYV12( T* src, int srcAlignedWidth, uint8_t* dst, int dstPit
 		u_plane = v_plane + (planeSize / 4);
 	}
 
-	T px;
-	uint8_t y_val, u_val, v_val;
-
-	px = src[y * srcAlignedWidth + x];
-	rgb_to_y(px.x, px.y, px.z, y_val);
-	y_plane[y * dstPitch + x] = y_val;
+	const float3 px00 = make_float3(src[y * srcAlignedWidth + x]);
+	const float3 px01 = make_float3(src[y * srcAlignedWidth + x1]);
+	const float3 px10 = make_float3(src[y1 * srcAlignedWidth + x]);
+	const float3 px11 = make_float3(src[y1 * srcAlignedWidth + x1]);
 
-	px = src[y * srcAlignedWidth + x1];
-	rgb_to_y(px.x, px.y, px.z, y_val);
-	y_plane[y * dstPitch + x1] = y_val;
+	y_plane[y * dstPitch + x]   = cudaRGBToLuma(matrix, px00);
+	y_plane[y * dstPitch + x1]  = cudaRGBToLuma(matrix, px01);
+	y_plane[y1 * dstPitch + x]  = cudaRGBToLuma(matrix, px10);
+	y_plane[y1 * dstPitch + x1] = cudaRGBToLuma(matrix, px11);
 
-	px = src[y1 * srcAlignedWidth + x];
-	rgb_to_y(px.x, px.y, px.z, y_val);
-	y_plane[y1 * dstPitch + x] = y_val;
-	
-	px = src[y1 * srcAlignedWidth + x1];
-	rgb_to_yuv(px.x, px.y, px.z, y_val, u_val, v_val);
-	y_plane[y1 * dstPitch + x1] = y_val;
+	// subsample chroma from the average of the 2x2 block
+	const float3 avg = (px00 + px01 + px10 + px11) * 0.25f;
 
 	const int uvPitch = dstPitch / 2;
 	const int uvIndex = (y / 2) * uvPitch + (x / 2);
 
-	u_plane[uvIndex] = u_val;
-	v_plane[uvIndex] = v_val;
+	u_plane[uvIndex] = cudaRGBToChromaU(matrix, avg);
+	v_plane[uvIndex] = cudaRGBToChromaV(matrix, avg);
 } 
 
 template<typename T, bool formatYV12>
-static cudaError_t launchRGBTo420( T* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height)
+static cudaError_t launchRGBTo420( T* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
 	if( !input || !inputPitch || !output || !outputPitch || !width || !height )
 		return cudaErrorInvalidValue;
@@ -252,108 +229,140 @@ static cudaError_t launchRGBTo420( T* input, size_t inputPitch, void* output, si
 
 	const int inputAlignedWidth = inputPitch / sizeof(T);
 
-	RGBToYV12<T, formatYV12><<<grid, block>>>(input, inputAlignedWidth, (uint8_t*)output, outputPitch, width, height);
+	RGBToYV12<T, formatYV12><<<grid, block, 0, stream>>>(input, inputAlignedWidth, (uint8_t*)output, outputPitch, width, height, cudaColorimetryMatrix(colorimetry));
 
 	return CUDA(cudaGetLastError());
 }
 
 
 // cudaRGBToI420 (uchar3)
-cudaError_t cudaRGBToI420( uchar3* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height )
+cudaError_t cudaRGBToI420( uchar3* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchRGBTo420<uchar3,true>( input, inputPitch, output, outputPitch, width, height );
+	NVTX_RANGE("cudaRGBToI420");
+
+	return launchRGBTo420<uchar3,true>( input, inputPitch, output, outputPitch, width, height, stream, colorimetry );
 }
 
 // cudaRGBToI420 (uchar3)
-cudaError_t cudaRGBToI420( uchar3* input, void* output, size_t width, size_t height )
+cudaError_t cudaRGBToI420( uchar3* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return cudaRGBToI420( input, width * sizeof(uchar3), output, width * sizeof(uint8_t), width, height );
+	NVTX_RANGE("cudaRGBToI420");
+
+	return cudaRGBToI420( input, width * sizeof(uchar3), output, width * sizeof(uint8_t), width, height, stream, colorimetry );
 }
 
 // cudaRGBToI420 (float3)
-cudaError_t cudaRGBToI420( float3* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height )
+cudaError_t cudaRGBToI420( float3* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchRGBTo420<float3,true>( input, inputPitch, output, outputPitch, width, height );
+	NVTX_RANGE("cudaRGBToI420");
+
+	return launchRGBTo420<float3,true>( input, inputPitch, output, outputPitch, width, height, stream, colorimetry );
 }
 
 // cudaRGBAToI420 (float3)
-cudaError_t cudaRGBToI420( float3* input, void* output, size_t width, size_t height )
+cudaError_t cudaRGBToI420( float3* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return cudaRGBToI420( input, width * sizeof(float3), output, width * sizeof(uint8_t), width, height );
+	NVTX_RANGE("cudaRGBToI420");
+
+	return cudaRGBToI420( input, width * sizeof(float3), output, width * sizeof(uint8_t), width, height, stream, colorimetry );
 }
 
 // cudaRGBAToI420 (uchar4)
-cudaError_t cudaRGBAToI420( uchar4* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height )
+cudaError_t cudaRGBAToI420( uchar4* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchRGBTo420<uchar4,true>( input, inputPitch, output, outputPitch, width, height );
+	NVTX_RANGE("cudaRGBAToI420");
+
+	return launchRGBTo420<uchar4,true>( input, inputPitch, output, outputPitch, width, height, stream, colorimetry );
 }
 
 // cudaRGBAToI420 (uchar4)
-cudaError_t cudaRGBAToI420( uchar4* input, void* output, size_t width, size_t height )
+cudaError_t cudaRGBAToI420( uchar4* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return cudaRGBAToI420( input, width * sizeof(uchar4), output, width * sizeof(uint8_t), width, height );
+	NVTX_RANGE("cudaRGBAToI420");
+
+	return cudaRGBAToI420( input, width * sizeof(uchar4), output, width * sizeof(uint8_t), width, height, stream, colorimetry );
 }
 
 // cudaRGBAToI420 (float4)
-cudaError_t cudaRGBAToI420( float4* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height )
+cudaError_t cudaRGBAToI420( float4* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchRGBTo420<float4,true>( input, inputPitch, output, outputPitch, width, height );
+	NVTX_RANGE("cudaRGBAToI420");
+
+	return launchRGBTo420<float4,true>( input, inputPitch, output, outputPitch, width, height, stream, colorimetry );
 }
 
 // cudaRGBAToI420 (float4)
-cudaError_t cudaRGBAToI420( float4* input, void* output, size_t width, size_t height )
+cudaError_t cudaRGBAToI420( float4* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return cudaRGBAToI420( input, width * sizeof(float4), output, width * sizeof(uint8_t), width, height );
+	NVTX_RANGE("cudaRGBAToI420");
+
+	return cudaRGBAToI420( input, width * sizeof(float4), output, width * sizeof(uint8_t), width, height, stream, colorimetry );
 }
 
 //-----------------------------------------------------------------------------------
 
 // cudaRGBToYV12 (uchar3)
-cudaError_t cudaRGBToYV12( uchar3* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height )
+cudaError_t cudaRGBToYV12( uchar3* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchRGBTo420<uchar3,false>( input, inputPitch, output, outputPitch, width, height );
+	NVTX_RANGE("cudaRGBToYV12");
+
+	return launchRGBTo420<uchar3,false>( input, inputPitch, output, outputPitch, width, height, stream, colorimetry );
 }
 
 // cudaRGBToYV12 (uchar3)
-cudaError_t cudaRGBToYV12( uchar3* input, void* output, size_t width, size_t height )
+cudaError_t cudaRGBToYV12( uchar3* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return cudaRGBToYV12( input, width * sizeof(uchar3), output, width * sizeof(uint8_t), width, height );
+	NVTX_RANGE("cudaRGBToYV12");
+
+	return cudaRGBToYV12( input, width * sizeof(uchar3), output, width * sizeof(uint8_t), width, height, stream, colorimetry );
 }
 
 // cudaRGBToYV12 (float3)
-cudaError_t cudaRGBToYV12( float3* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height )
+cudaError_t cudaRGBToYV12( float3* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchRGBTo420<float3,false>( input, inputPitch, output, outputPitch, width, height );
+	NVTX_RANGE("cudaRGBToYV12");
+
+	return launchRGBTo420<float3,false>( input, inputPitch, output, outputPitch, width, height, stream, colorimetry );
 }
 
 // cudaRGBToYV12 (float3)
-cudaError_t cudaRGBToYV12( float3* input, void* output, size_t width, size_t height )
+cudaError_t cudaRGBToYV12( float3* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return cudaRGBToYV12( input, width * sizeof(float3), output, width * sizeof(uint8_t), width, height );
+	NVTX_RANGE("cudaRGBToYV12");
+
+	return cudaRGBToYV12( input, width * sizeof(float3), output, width * sizeof(uint8_t), width, height, stream, colorimetry );
 }
 
 // cudaRGBAToYV12 (uchar4)
-cudaError_t cudaRGBAToYV12( uchar4* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height )
+cudaError_t cudaRGBAToYV12( uchar4* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchRGBTo420<uchar4,false>( input, inputPitch, output, outputPitch, width, height );
+	NVTX_RANGE("cudaRGBAToYV12");
+
+	return launchRGBTo420<uchar4,false>( input, inputPitch, output, outputPitch, width, height, stream, colorimetry );
 }
 
 // cudaRGBAToYV12 (uchar4)
-cudaError_t cudaRGBAToYV12( uchar4* input, void* output, size_t width, size_t height )
+cudaError_t cudaRGBAToYV12( uchar4* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return cudaRGBAToYV12( input, width * sizeof(uchar4), output, width * sizeof(uint8_t), width, height );
+	NVTX_RANGE("cudaRGBAToYV12");
+
+	return cudaRGBAToYV12( input, width * sizeof(uchar4), output, width * sizeof(uint8_t), width, height, stream, colorimetry );
 }
 
 // cudaRGBAToYV12 (float4)
-cudaError_t cudaRGBAToYV12( float4* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height )
+cudaError_t cudaRGBAToYV12( float4* input, size_t inputPitch, void* output, size_t outputPitch, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return launchRGBTo420<float4,false>( input, inputPitch, output, outputPitch, width, height );
+	NVTX_RANGE("cudaRGBAToYV12");
+
+	return launchRGBTo420<float4,false>( input, inputPitch, output, outputPitch, width, height, stream, colorimetry );
 }
 
 // cudaRGBAToYV12 (float4)
-cudaError_t cudaRGBAToYV12( float4* input, void* output, size_t width, size_t height )
+cudaError_t cudaRGBAToYV12( float4* input, void* output, size_t width, size_t height, cudaStream_t stream, cudaColorimetry colorimetry )
 {
-	return cudaRGBAToYV12( input, width * sizeof(float4), output, width * sizeof(uint8_t), width, height );
+	NVTX_RANGE("cudaRGBAToYV12");
+
+	return cudaRGBAToYV12( input, width * sizeof(float4), output, width * sizeof(uint8_t), width, height, stream, colorimetry );
 }
 
 
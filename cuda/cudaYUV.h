@@ -25,6 +25,14 @@
 
 
 #include "cudaUtility.h"
+#include "cudaColorimetry.h"
+#include "imageFormat.h"
+
+
+// The YUV conversion functions below take an optional cudaColorimetry that selects the
+// matrix coefficients (BT.601, BT.709, or BT.2020) and the range (full or limited).
+// The coefficients are passed to the kernels as arguments, so conversions that use
+// different colorimetry can run concurrently on different streams.
 
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -38,22 +46,22 @@
 /**
  * Convert a YUV I420 planar image to RGB uchar3.
  */
-cudaError_t cudaI420ToRGB(void* input, uchar3* output, size_t width, size_t height);
+cudaError_t cudaI420ToRGB(void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUV I420 planar image to RGB float3.
  */
-cudaError_t cudaI420ToRGB(void* input, float3* output, size_t width, size_t height);
+cudaError_t cudaI420ToRGB(void* input, float3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUV I420 planar image to RGBA uchar4.
  */
-cudaError_t cudaI420ToRGBA(void* input, uchar4* output, size_t width, size_t height);
+cudaError_t cudaI420ToRGBA(void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUV I420 planar image to RGB float4.
  */
-cudaError_t cudaI420ToRGBA(void* input, float4* output, size_t width, size_t height);
+cudaError_t cudaI420ToRGBA(void* input, float4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 ///@}
 
@@ -69,22 +77,22 @@ cudaError_t cudaI420ToRGBA(void* input, float4* output, size_t width, size_t hei
 /**
  * Convert a YUV YV12 planar image to RGB uchar3.
  */
-cudaError_t cudaYV12ToRGB(void* input, uchar3* output, size_t width, size_t height);
+cudaError_t cudaYV12ToRGB(void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUV YV12 planar image to RGB float3.
  */
-cudaError_t cudaYV12ToRGB(void* input, float3* output, size_t width, size_t height);
+cudaError_t cudaYV12ToRGB(void* input, float3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUV YV12 planar image to RGBA uchar4.
  */
-cudaError_t cudaYV12ToRGBA(void* input, uchar4* output, size_t width, size_t height);
+cudaError_t cudaYV12ToRGBA(void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUV YV12 planar image to RGB float4.
  */
-cudaError_t cudaYV12ToRGBA(void* input, float4* output, size_t width, size_t height);
+cudaError_t cudaYV12ToRGBA(void* input, float4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 ///@}
 
@@ -100,22 +108,22 @@ cudaError_t cudaYV12ToRGBA(void* input, float4* output, size_t width, size_t hei
 /**
  * Convert an RGB uchar3 buffer into YUV I420 planar.
  */
-cudaError_t cudaRGBToI420( uchar3* input, void* output, size_t width, size_t height );
+cudaError_t cudaRGBToI420( uchar3* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an RGB float3 buffer into YUV I420 planar.
  */
-cudaError_t cudaRGBToI420( float3* input, void* output, size_t width, size_t height );
+cudaError_t cudaRGBToI420( float3* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an RGBA uchar4 buffer into YUV I420 planar.
  */
-cudaError_t cudaRGBAToI420( uchar4* input, void* output, size_t width, size_t height );
+cudaError_t cudaRGBAToI420( uchar4* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an RGBA float4 buffer into YUV I420 planar.
  */
-cudaError_t cudaRGBAToI420( float4* input, void* output, size_t width, size_t height );
+cudaError_t cudaRGBAToI420( float4* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 ///@}
 
@@ -131,22 +139,22 @@ cudaError_t cudaRGBAToI420( float4* input, void* output, size_t width, size_t he
 /**
  * Convert an RGB uchar3 buffer into YUV YV12 planar.
  */
-cudaError_t cudaRGBToYV12( uchar3* input, void* output, size_t width, size_t height );
+cudaError_t cudaRGBToYV12( uchar3* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an RGB float3 buffer into YUV YV12 planar.
  */
-cudaError_t cudaRGBToYV12( float3* input, void* output, size_t width, size_t height );
+cudaError_t cudaRGBToYV12( float3* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an RGBA uchar4 buffer into YUV YV12 planar.
  */
-cudaError_t cudaRGBAToYV12( uchar4* input, void* output, size_t width, size_t height );
+cudaError_t cudaRGBAToYV12( uchar4* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an RGBA float4 buffer into YUV YV12 planar.
  */
-cudaError_t cudaRGBAToYV12( float4* input, void* output, size_t width, size_t height );
+cudaError_t cudaRGBAToYV12( float4* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 ///@}
 
@@ -162,22 +170,22 @@ cudaError_t cudaRGBAToYV12( float4* input, void* output, size_t width, size_t he
 /**
  * Convert a YUYV 422 packed image into RGB uchar3.
  */
-cudaError_t cudaYUYVToRGB( void* input, uchar3* output, size_t width, size_t height );
+cudaError_t cudaYUYVToRGB( void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUYV 422 packed image into RGB float3.
  */
-cudaError_t cudaYUYVToRGB( void* input, float3* output, size_t width, size_t height );
+cudaError_t cudaYUYVToRGB( void* input, float3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUYV 422 packed image into RGBA uchar4.
  */
-cudaError_t cudaYUYVToRGBA( void* input, uchar4* output, size_t width, size_t height );
+cudaError_t cudaYUYVToRGBA( void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YUYV 422 packed image into RGBA float4.
  */
-cudaError_t cudaYUYVToRGBA( void* input, float4* output, size_t width, size_t height );
+cudaError_t cudaYUYVToRGBA( void* input, float4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 ///@}
 
@@ -193,22 +201,22 @@ cudaError_t cudaYUYVToRGBA( void* input, float4* output, size_t width, size_t he
 /**
  * Convert a YVYU 422 packed image into RGB uchar3.
  */
-cudaError_t cudaYVYUToRGB( void* input, uchar3* output, size_t width, size_t height );
+cudaError_t cudaYVYUToRGB( void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YVYU 422 packed image into RGB float3.
  */
-cudaError_t cudaYVYUToRGB( void* input, float3* output, size_t width, size_t height );
+cudaError_t cudaYVYUToRGB( void* input, float3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YVYU 422 packed image into RGBA uchar4.
  */
-cudaError_t cudaYVYUToRGBA( void* input, uchar4* output, size_t width, size_t height );
+cudaError_t cudaYVYUToRGBA( void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a YVYU 422 packed image into RGBA float4.
  */
-cudaError_t cudaYVYUToRGBA( void* input, float4* output, size_t width, size_t height );
+cudaError_t cudaYVYUToRGBA( void* input, float4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 ///@}
 
@@ -224,22 +232,22 @@ cudaError_t cudaYVYUToRGBA( void* input, float4* output, size_t width, size_t he
 /**
  * Convert a UYVY 422 packed image into RGB uchar3.
  */
-cudaError_t cudaUYVYToRGB( void* input, uchar3* output, size_t width, size_t height );
+cudaError_t cudaUYVYToRGB( void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a UYVY 422 packed image into RGB float3.
  */
-cudaError_t cudaUYVYToRGB( void* input, float3* output, size_t width, size_t height );
+cudaError_t cudaUYVYToRGB( void* input, float3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a UYVY 422 packed image into RGBA uchar4.
  */
-cudaError_t cudaUYVYToRGBA( void* input, uchar4* output, size_t width, size_t height );
+cudaError_t cudaUYVYToRGBA( void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert a UYVY 422 packed image into RGBA float4.
  */
-cudaError_t cudaUYVYToRGBA( void* input, float4* output, size_t width, size_t height );
+cudaError_t cudaUYVYToRGBA( void* input, float4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 ///@}
 
@@ -256,25 +264,137 @@ cudaError_t cudaUYVYToRGBA( void* input, float4* output, size_t width, size_t he
  * Convert an NV12 texture (semi-planar 4:2:0) to RGB uchar3 format.
  * NV12 = 8-bit Y plane followed by an interleaved U/V plane with 2x2 subsampling.
  */
-cudaError_t cudaNV12ToRGB( void* input, uchar3* output, size_t width, size_t height );
+cudaError_t cudaNV12ToRGB( void* input, uchar3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an NV12 image that's bound to texture objects (an 8-bit luma texture and
+ * 2-channel interleaved U/V chroma texture) to RGB uchar3 format.  This can read directly
+ * from the CUDA arrays of a mapped NVMM/EGL frame without copying them to linear memory first.
+ * The chroma texture needs cudaFilterModeLinear and cudaReadModeNormalizedFloat, which is
+ * used to interpolate the chroma vertically (the luma texture uses point sampling).
+ */
+cudaError_t cudaNV12ToRGB( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, uchar3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an NV12 texture (semi-planar 4:2:0) to RGB float3 format.
  * NV12 = 8-bit Y plane followed by an interleaved U/V plane with 2x2 subsampling.
  */
-cudaError_t cudaNV12ToRGB( void* input, float3* output, size_t width, size_t height );
+cudaError_t cudaNV12ToRGB( void* input, float3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an NV12 image that's bound to texture objects (an 8-bit luma texture and
+ * 2-channel interleaved U/V chroma texture) to RGB float3 format.  This can read directly
+ * from the CUDA arrays of a mapped NVMM/EGL frame without copying them to linear memory first.
+ */
+cudaError_t cudaNV12ToRGB( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, float3* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an NV12 texture (semi-planar 4:2:0) to RGBA uchar4 format.
  * NV12 = 8-bit Y plane followed by an interleaved U/V plane with 2x2 subsampling.
  */
-cudaError_t cudaNV12ToRGBA( void* input, uchar4* output, size_t width, size_t height );
+cudaError_t cudaNV12ToRGBA( void* input, uchar4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an NV12 image that's bound to texture objects (an 8-bit luma texture and
+ * 2-channel interleaved U/V chroma texture) to RGBA uchar4 format.  This can read directly
+ * from the CUDA arrays of a mapped NVMM/EGL frame without copying them to linear memory first.
+ */
+cudaError_t cudaNV12ToRGBA( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, uchar4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 /**
  * Convert an NV12 texture (semi-planar 4:2:0) to RGBA float4 format.
  * NV12 = 8-bit Y plane followed by an interleaved U/V plane with 2x2 subsampling.
  */
-cudaError_t cudaNV12ToRGBA( void* input, float4* output, size_t width, size_t height );
+cudaError_t cudaNV12ToRGBA( void* input, float4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an NV12 image that's bound to texture objects (an 8-bit luma texture and
+ * 2-channel interleaved U/V chroma texture) to RGBA float4 format.  This can read directly
+ * from the CUDA arrays of a mapped NVMM/EGL frame without copying them to linear memory first.
+ */
+cudaError_t cudaNV12ToRGBA( cudaTextureObject_t lumaTex, cudaTextureObject_t chromaTex, float4* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+///@}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+/// @name RGB to YUV NV12 4:2:0
+/// @see cudaConvertColor() from cudaColorspace.h for automated format conversion
+/// @ingroup colorspace
+//////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+/**
+ * Convert an RGB uchar3 buffer into NV12 (semi-planar 4:2:0).
+ * NV12 = 8-bit Y plane followed by an interleaved U/V plane with 2x2 subsampling.
+ */
+cudaError_t cudaRGBToNV12( uchar3* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an RGB uchar3 buffer into NV12, with separate pitched Y and UV planes
+ * (for example, when writing into a mapped NVMM/EGL frame).
+ */
+cudaError_t cudaRGBToNV12( uchar3* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an RGB float3 buffer into NV12 (semi-planar 4:2:0).
+ * NV12 = 8-bit Y plane followed by an interleaved U/V plane with 2x2 subsampling.
+ */
+cudaError_t cudaRGBToNV12( float3* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an RGB float3 buffer into NV12, with separate pitched Y and UV planes
+ * (for example, when writing into a mapped NVMM/EGL frame).
+ */
+cudaError_t cudaRGBToNV12( float3* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an RGBA uchar4 buffer into NV12 (semi-planar 4:2:0).
+ * NV12 = 8-bit Y plane followed by an interleaved U/V plane with 2x2 subsampling.
+ */
+cudaError_t cudaRGBAToNV12( uchar4* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an RGBA uchar4 buffer into NV12, with separate pitched Y and UV planes
+ * (for example, when writing into a mapped NVMM/EGL frame).
+ */
+cudaError_t cudaRGBAToNV12( uchar4* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an RGBA float4 buffer into NV12 (semi-planar 4:2:0).
+ * NV12 = 8-bit Y plane followed by an interleaved U/V plane with 2x2 subsampling.
+ */
+cudaError_t cudaRGBAToNV12( float4* input, void* output, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+/**
+ * Convert an RGBA float4 buffer into NV12, with separate pitched Y and UV planes
+ * (for example, when writing into a mapped NVMM/EGL frame).
+ */
+cudaError_t cudaRGBAToNV12( float4* input, size_t inputPitch, void* outputY, size_t outputPitchY, void* outputUV, size_t outputPitchUV, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
+
+///@}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+/// @name YUV P010/P016 4:2:0 (10-bit and 16-bit) to RGB
+/// @see cudaConvertColor() from cudaColorspace.h for automated format conversion
+/// @ingroup colorspace
+//////////////////////////////////////////////////////////////////////////////////
+
+///@{
+
+/**
+ * Convert a P010 or P016 image (a 16-bit Y plane followed by an interleaved 16-bit U/V plane
+ * with 2x2 subsampling) to RGB.  P010 has 10-bit samples in the most significant bits of each word.
+ *
+ * The samples are scaled to the range [0,255] of the output, so the float and half-precision
+ * outputs keep the extra precision, while the 8-bit outputs get rounded.
+ *
+ * @param inputFormat IMAGE_P010 or IMAGE_P016
+ * @param outputFormat IMAGE_RGB8, IMAGE_RGBA8, IMAGE_RGB32F, IMAGE_RGBA32F, IMAGE_RGB16F, or IMAGE_RGBA16F
+ */
+cudaError_t cudaP010ToRGB( void* input, imageFormat inputFormat, void* output, imageFormat outputFormat, size_t width, size_t height, cudaStream_t stream=NULL, cudaColorimetry colorimetry=COLORIMETRY_DEFAULT );
 
 ///@}
 
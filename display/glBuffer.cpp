@@ -38,12 +38,35 @@ glBuffer::glBuffer()
 	mNumElements = 0;
 	mElementSize = 0;
 	mInteropCUDA = NULL;
+
+	mPersistentPtr = NULL;
+	mRegions  = 1;
+	mRegion   = 0;
+	mMapCount = 0;
+
+	memset(mFences, 0, sizeof(mFences));
 }
 
 
 // destructor
 glBuffer::~glBuffer()
 {
+	for( uint32_t n=0; n < GL_BUFFER_MAX_REGIONS; n++ )
+	{
+		if( mFences[n] != NULL )
+		{
+			glDeleteSync((GLsync)mFences[n]);
+			mFences[n] = NULL;
+		}
+	}
+
+	if( mPersistentPtr != NULL && Bind() )
+	{
+		GL(glUnmapBuffer(mType));
+		Unbind();
+		mPersistentPtr = NULL;
+	}
+
 	if( mID != 0 )
 	{
 		GL(glDeleteBuffers(1, &mID));
@@ -99,6 +122,43 @@ glBuffer* glBuffer::Create( uint32_t type, uint32_t numElements, uint32_t elemen
 }
 
 
+// CreatePersistent
+glBuffer* glBuffer::CreatePersistent( uint32_t type, uint32_t numElements, uint32_t elementSize, uint32_t regions )
+{
+	if( regions == 0 || regions > GL_BUFFER_MAX_REGIONS )
+	{
+		LogError(LOG_GL "glBuffer::CreatePersistent() -- invalid number of regions (%u, must be between 1 and %u)\n", regions, GL_BUFFER_MAX_REGIONS);
+		return NULL;
+	}
+
+	if( !GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage )
+	{
+		LogWarning(LOG_GL "glBuffer -- GL_ARB_buffer_storage isn't supported, creating a regular buffer instead of a persistent one\n");
+		return Create(type, numElements, elementSize, NULL, GL_STREAM_DRAW);
+	}
+
+	glBuffer* buf = new glBuffer();
+
+	if( !buf )
+	{
+		LogError(LOG_GL "failed to construct new glBuffer object\n");
+		return NULL;
+	}
+
+	if( !buf->initPersistent(type, numElements * elementSize, regions) )
+	{
+		LogError(LOG_GL "failed to create persistent buffer (%u bytes x %u regions)\n", numElements * elementSize, regions);
+		delete buf;
+		return NULL;
+	}
+
+	buf->mNumElements = numElements;
+	buf->mElementSize = elementSize;
+
+	return buf;
+}
+
+
 // init
 bool glBuffer::init( uint32_t type, uint32_t size, void* data, uint32_t usage )
 {
@@ -118,6 +178,64 @@ bool glBuffer::init( uint32_t type, uint32_t size, void* data, uint32_t usage )
 }
 
 
+// initPersistent
+bool glBuffer::initPersistent( uint32_t type, uint32_t size, uint32_t regions )
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	GL_VERIFY(glGenBuffers(1, &mID));
+	GL_VERIFY(glBindBuffer(type, mID));
+	GL_VERIFY(glBufferStorage(type, size * regions, NULL, flags));
+
+	// the storage stays mapped until the buffer is deleted
+	mPersistentPtr = glMapBufferRange(type, 0, size * regions, flags);
+
+	if( !mPersistentPtr )
+	{
+		LogError(LOG_GL "glMapBufferRange() failed to persistently map buffer\n");
+		GL_CHECK("glMapBufferRange()\n");
+		glBindBuffer(type, 0);
+		return false;
+	}
+
+	GL_VERIFY(glBindBuffer(type, 0));
+
+	mType    = type;
+	mSize    = size;
+	mUsage   = GL_STREAM_DRAW;
+	mRegions = regions;
+
+	mNumElements = size;
+	mElementSize = 1;
+
+	return true;
+}
+
+
+// nextRegion
+void glBuffer::nextRegion()
+{
+	// the draws that source from the previous region have been queued by now, so fence it
+	if( mMapCount > 0 )
+	{
+		mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		mRegion = (mRegion + 1) % mRegions;
+	}
+
+	mMapCount++;
+
+	// wait for GL to finish drawing from this region the last time it was used
+	if( mFences[mRegion] != NULL )
+	{
+		if( glClientWaitSync((GLsync)mFences[mRegion], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED )
+			LogWarning(LOG_GL "glBuffer::Map() -- timed out waiting for persistent buffer region to be released\n");
+
+		glDeleteSync((GLsync)mFences[mRegion]);
+		mFences[mRegion] = NULL;
+	}
+}
+
+
 // Bind
 bool glBuffer::Bind()
 {
@@ -162,6 +280,33 @@ void* glBuffer::Map( uint32_t device, uint32_t flags )
 		return NULL;
 	}
 
+	if( mPersistentPtr != NULL )
+	{
+		if( flags != GL_WRITE_ONLY && flags != GL_WRITE_DISCARD )
+		{
+			LogError(LOG_GL "glBuffer::Map() -- persistent buffers can only be mapped with GL_WRITE_ONLY or GL_WRITE_DISCARD\n");
+			return NULL;
+		}
+
+		if( device != GL_MAP_CPU && device != GL_MAP_CUDA )
+		{
+			LogError(LOG_GL "glBuffer::Map() -- invalid device (must be GL_MAP_CPU or GL_MAP_CUDA)\n");
+			return NULL;
+		}
+
+		nextRegion();
+
+		// the storage is already mapped and coherent, so the CPU can write straight into it
+		if( device == GL_MAP_CPU )
+		{
+			mMapDevice = device;
+			return (uint8_t*)mPersistentPtr + GetOffset();
+		}
+
+		// discarding would invalidate the other regions that GL may still be drawing from
+		flags = GL_WRITE_ONLY;
+	}
+
 	if( !Bind() )
 		return NULL;
 
@@ -219,13 +364,13 @@ void* glBuffer::Map( uint32_t device, uint32_t flags )
 			return NULL;
 		}
 		
-		if( mSize != mappedSize )
-			LogWarning(LOG_GL "glBuffer::Map() -- CUDA size mismatch %zu bytes  (expected=%u)\n", mappedSize, mSize);
+		if( mSize * mRegions != mappedSize )
+			LogWarning(LOG_GL "glBuffer::Map() -- CUDA size mismatch %zu bytes  (expected=%u)\n", mappedSize, mSize * mRegions);
 		
 		mMapDevice = device;
 		mMapFlags = flags;	// these only need tracked for GPU	
 
-		return devPtr;
+		return (uint8_t*)devPtr + GetOffset();
 	}
 
 	LogError(LOG_GL "glBuffer::Map() -- invalid device (must be GL_MAP_CPU or GL_MAP_CUDA)\n");
@@ -239,6 +384,13 @@ void glBuffer::Unmap()
 	if( mMapDevice != GL_MAP_CPU && mMapDevice != GL_MAP_CUDA )
 		return;
 
+	// persistent mappings are coherent, so there's nothing to flush or unmap
+	if( mPersistentPtr != NULL && mMapDevice == GL_MAP_CPU )
+	{
+		mMapDevice = 0;
+		return;
+	}
+
 	if( !Bind() )
 		return;
 
@@ -277,7 +429,7 @@ bool glBuffer::Copy( void* ptr, uint32_t offset, uint32_t size, uint32_t flags )
 	
 	if( flags == GL_FROM_CPU )
 	{
-		// TODO for faster CPU path, see http://hacksoflife.blogspot.com/2015/06/glmapbuffer-no-longer-cool.html
+		// persistent buffers copy into the next region without a driver round trip (see CreatePersistent())
 		void* dst = Map(GL_MAP_CPU, mapFlags);
 
 		if( !dst )
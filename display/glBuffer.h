@@ -106,6 +106,19 @@
 #define GL_READ_WRITE 		GL_READ_WRITE_ARB
 #endif
 
+/**
+ * Default number of regions that persistently-mapped buffers are divided into
+ * (triple-buffered, so the CPU can fill one region while GL draws from the others)
+ * @ingroup OpenGL
+ */
+#define GL_BUFFER_PERSISTENT_REGIONS	3
+
+/**
+ * Maximum number of regions that persistently-mapped buffers can be divided into
+ * @ingroup OpenGL
+ */
+#define GL_BUFFER_MAX_REGIONS		8
+
 
 /**
  * OpenGL buffer with CUDA interoperability.
@@ -132,6 +145,27 @@ public:
 	 * @param usage GL_STATIC_DRAW (never updated), GL_STREAM_DRAW (occasional updates), or GL_DYNAMIC_DRAW (per-frame updates)
 	 */
 	static glBuffer* Create( uint32_t type, uint32_t numElements, uint32_t elementSize, void* data=NULL, uint32_t usage=GL_STATIC_DRAW );
+
+	/**
+	 * Allocate a persistently-mapped OpenGL buffer for streaming new data every frame.
+	 *
+	 * The storage is mapped once for the lifetime of the buffer (GL_MAP_PERSISTENT_BIT and
+	 * GL_MAP_COHERENT_BIT) and divided into multiple regions of numElements each.  Every
+	 * call to Map() returns the next region in the ring after waiting on the fence that was
+	 * placed the last time it was drawn from, so uploads don't make map/unmap round trips
+	 * through the driver and the CPU doesn't overwrite vertices that GL is still using.
+	 * Draws should source from GetOffset() (or start at vertex GetFirst()) after Unmap().
+	 *
+	 * Persistent buffers are write-only, and the previous contents of a region are undefined
+	 * when it's mapped again.  If GL_ARB_buffer_storage isn't supported, a regular buffer with
+	 * GL_STREAM_DRAW usage and only one region is created instead.
+	 *
+	 * @param type either GL_VERTEX_BUFFER for a vertex buffer, or GL_INDEX_BUFFER for an index buffer
+	 * @param numElements the number of elements (i.e. vertices or indices) in each region
+	 * @param elementSize the size in bytes of each element
+	 * @param regions the number of regions in the ring (up to GL_BUFFER_MAX_REGIONS)
+	 */
+	static glBuffer* CreatePersistent( uint32_t type, uint32_t numElements, uint32_t elementSize, uint32_t regions=GL_BUFFER_PERSISTENT_REGIONS );
 	
 	/**
 	 * Free the buffer
@@ -160,6 +194,7 @@ public:
 
 	/**
 	 * Retrieve the total size in bytes of the buffer
+	 * @note for persistent buffers, this is the size of one region
 	 */
 	inline uint32_t GetSize() const		{ return mSize; }
 
@@ -179,6 +214,29 @@ public:
 	 */
 	inline uint32_t GetElementSize() const	{ return mElementSize; }
 
+	/**
+	 * Return true if the buffer was created with CreatePersistent() and is persistently mapped
+	 */
+	inline bool IsPersistent() const		{ return mPersistentPtr != NULL; }
+
+	/**
+	 * Retrieve the number of regions in the buffer (this is 1 unless the buffer is persistent)
+	 */
+	inline uint32_t GetRegions() const		{ return mRegions; }
+
+	/**
+	 * Retrieve the byte offset into the buffer of the region last returned by Map().
+	 * This should be added to the offsets passed to glVertexAttribPointer() and similar.
+	 * For buffers that aren't persistent, the offset is always 0.
+	 */
+	inline uint32_t GetOffset() const		{ return mRegion * mSize; }
+
+	/**
+	 * Retrieve the index of the first element in the region last returned by Map(),
+	 * for passing to glDrawArrays().  For buffers that aren't persistent, this is always 0.
+	 */
+	inline uint32_t GetFirst() const		{ return mRegion * mNumElements; }
+
 	/**
 	 * Map the buffer for accessing from the CPU or CUDA.
 	 *
@@ -193,6 +251,9 @@ public:
 	 * @returns CPU pointer to buffer if GL_MAP_CPU was specified,
 	 *          CUDA device pointer to buffer if GL_MAP_CUDA was specified,
 	 *          or NULL if an error occurred mapping the buffer.                  
+	 *
+	 * @note persistent buffers only accept GL_WRITE_ONLY or GL_WRITE_DISCARD,
+	 *       and return a pointer to the next region (see CreatePersistent())
 	 */
 	void* Map( uint32_t device, uint32_t flags );
 
@@ -265,6 +326,8 @@ private:
 	glBuffer();
 
 	bool init( uint32_t type, uint32_t size, void* data, uint32_t usage);
+	bool initPersistent( uint32_t type, uint32_t size, uint32_t regions );
+	void nextRegion();
 	
 	uint32_t mID;
 	uint32_t mSize;
@@ -278,6 +341,12 @@ private:
 	uint32_t mMapFlags;
 
 	cudaGraphicsResource* mInteropCUDA;
+
+	void*    mPersistentPtr;
+	void*    mFences[GL_BUFFER_MAX_REGIONS];	// GLsync
+	uint32_t mRegions;
+	uint32_t mRegion;
+	uint64_t mMapCount;
 };
 
 
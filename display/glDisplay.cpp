@@ -21,8 +21,15 @@
  */
  
 #include "glDisplay.h"
+#include "glShader.h"
 #include "cudaNormalize.h"
+#include "cudaColorspace.h"
+#include "cudaDevice.h"
 #include "timespec.h"
+#include "profiler.h"
+#include "cudaNVTX.h"
+
+#include <cuda_gl_interop.h>
 
 #include <X11/Xatom.h>
 #include <X11/cursorfont.h>
@@ -77,9 +84,49 @@ glDisplay::glDisplay( const videoOptions& options ) : videoOutput(options)
 	mBgColor[2]    = 0.0f;
 	mBgColor[3]    = 1.0f;
 
-	mNormalizedCUDA   = NULL;
-	mNormalizedWidth  = 0;
-	mNormalizedHeight = 0;
+	mShaderYUV   = NULL;
+	mBatch       = NULL;
+	mBatchFailed = false;
+
+	mHeadless    = (options.resource.location == "headless");
+	mDisplayEGL  = EGL_NO_DISPLAY;
+	mSurfaceEGL  = EGL_NO_SURFACE;
+	mContextEGL  = EGL_NO_CONTEXT;
+
+	mFramebufferGL      = 0;
+	mFramebufferTex     = 0;
+	mFramebufferCUDA    = NULL;
+	mFramebufferInterop = NULL;
+
+	mFramebufferSize[0] = 0;
+	mFramebufferSize[1] = 0;
+
+	mCaptureEnabled = false;
+	mCaptureSize[0] = 0;
+	mCaptureSize[1] = 0;
+
+	mTimingEnabled     = false;
+	mTimingOverlay     = false;
+	mTimersAllocated   = false;
+	mTimersFailed      = false;
+	mTimerActive       = -1;
+	mTimerFrame        = 0;
+	mRefreshRate       = 60.0f;
+	mUploadTime        = 0.0f;
+	mTimingHistoryNext = 0;
+
+	memset(mTimers, 0, sizeof(mTimers));
+	memset(&mTiming, 0, sizeof(mTiming));
+	memset(mTimingHistory, 0, sizeof(mTimingHistory));
+
+	mRenderThread    = NULL;
+	mRenderStop      = false;
+	mMailboxWrite    = 0;
+	mMailboxPending  = 1;
+	mMailboxRead     = 2;
+	mMailboxNewFrame = false;
+
+	memset(mMailbox, 0, sizeof(mMailbox));
 
 	// initial input states
 	mMousePos[0]  = 0;
@@ -93,6 +140,17 @@ glDisplay::glDisplay( const videoOptions& options ) : videoOutput(options)
 
 	memset(mMouseButtons, 0, sizeof(mMouseButtons));
 	memset(mKeyStates, 0, sizeof(mKeyStates));
+
+	// event queue
+	mEventHead = 0;
+	mEventTail = 0;
+
+	mEventQueueEnabled = false;
+	mEventsDropped     = 0;
+
+	mRootOffset[0]  = 0;
+	mRootOffset[1]  = 0;
+	mRootOffsetValid = false;
  
 	// set some static video flags
 	mOptions.codec = videoOptions::CODEC_RAW;
@@ -109,6 +167,21 @@ glDisplay::glDisplay( const videoOptions& options ) : videoOutput(options)
 // Destructor
 glDisplay::~glDisplay()
 {
+	// stop the render thread (which hands the GL context back to this thread)
+	SetRenderThread(false);
+
+	// the interop resources are released on the device they were registered with
+	cudaDeviceScope device(mOptions.cudaDevice);
+
+	for( uint32_t n=0; n < 3; n++ )
+	{
+		if( mMailbox[n].image != NULL )
+		{
+			CUDA(cudaFree(mMailbox[n].image));
+			mMailbox[n].image = NULL;
+		}
+	}
+
 	// remove this instance from the global list
 	const size_t numDisplays = gDisplays.size();
 
@@ -125,6 +198,17 @@ glDisplay::~glDisplay()
 	RemoveAllWidgets();
 
 	// release textures used during rendering
+	for( size_t n=0; n < mTextureRings.size(); n++ )
+	{
+		for( uint32_t i=0; i < GL_DISPLAY_INTEROP_BUFFERS; i++ )
+		{
+			if( mTextureRings[n].fences[i] != NULL )
+				glDeleteSync(mTextureRings[n].fences[i]);
+		}
+	}
+
+	mTextureRings.clear();
+
 	const size_t numTextures = mTextures.size();
 
 	for( size_t n=0; n < numTextures; n++ )
@@ -138,15 +222,46 @@ glDisplay::~glDisplay()
 
 	mTextures.clear();
 
-	// free CUDA memory used for normalization
-	if( mNormalizedCUDA != NULL )
+	// free the YUV shader
+	if( mShaderYUV != NULL )
+	{
+		delete mShaderYUV;
+		mShaderYUV = NULL;
+	}
+
+	// free the primitive batch
+	if( mBatch != NULL )
 	{
-		CUDA(cudaFree(mNormalizedCUDA));
-		mNormalizedCUDA = NULL;
+		delete mBatch;
+		mBatch = NULL;
 	}
 
+	// free the GPU timer queries
+	freeTimers();
+
+	// free the offscreen framebuffer
+	freeFramebuffer();
+
 	// destroy the OpenGL context
-	glXDestroyContext(mDisplayX, mContextGL);
+	if( mHeadless )
+	{
+		if( mDisplayEGL != EGL_NO_DISPLAY )
+		{
+			releaseCurrent();
+
+			if( mContextEGL != EGL_NO_CONTEXT )
+				eglDestroyContext(mDisplayEGL, mContextEGL);
+
+			if( mSurfaceEGL != EGL_NO_SURFACE )
+				eglDestroySurface(mDisplayEGL, mSurfaceEGL);
+
+			eglTerminate(mDisplayEGL);
+		}
+	}
+	else
+	{
+		glXDestroyContext(mDisplayX, mContextGL);
+	}
 }
 
 
@@ -187,28 +302,52 @@ glDisplay* glDisplay::Create( const videoOptions& options )
 	if( !vp )
 		return NULL;
 		
-	if( !vp->initWindow() )
+	if( vp->IsHeadless() )
 	{
-		LogError(LOG_GL "failed to create X11 Window.\n");
-		delete vp;
-		return NULL;
+		if( !vp->initHeadless() )
+		{
+			LogError(LOG_GL "failed to create headless EGL context.\n");
+			delete vp;
+			return NULL;
+		}
 	}
-	
-	if( !vp->initGL() )
+	else
 	{
-		LogError(LOG_GL "failed to initialize OpenGL.\n");
-		delete vp;
-		return NULL;
+		if( !vp->initWindow() )
+		{
+			LogError(LOG_GL "failed to create X11 Window.\n");
+			delete vp;
+			return NULL;
+		}
+	
+		if( !vp->initGL() )
+		{
+			LogError(LOG_GL "failed to initialize OpenGL.\n");
+			delete vp;
+			return NULL;
+		}
 	}
 	
 	GLenum err = glewInit();
-	
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLEW still loads the GL entry points without a GLX display
+	if( vp->IsHeadless() && err == GLEW_ERROR_NO_GLX_DISPLAY )
+		err = GLEW_OK;
+#endif
+
 	if (GLEW_OK != err)
 	{
 		LogError(LOG_GL "GLEW Error: %s\n", glewGetErrorString(err));
 		delete vp;
 		return NULL;
 	}
+
+	if( vp->IsHeadless() && !vp->allocFramebuffer(vp->GetWidth(), vp->GetHeight()) )
+	{
+		delete vp;
+		return NULL;
+	}
 	
 	vp->mID = gDisplays.size();
 	gDisplays.push_back(vp);
@@ -228,6 +367,9 @@ glDisplay* glDisplay::Create( const videoOptions& options )
 // initWindow
 bool glDisplay::initWindow()
 {
+	// Xlib is used from the render thread if it gets enabled
+	XInitThreads();
+
 	if( !mDisplayX )
 		mDisplayX = XOpenDisplay(0);
 
@@ -360,6 +502,365 @@ bool glDisplay::initGL()
 }
 
 
+// initHeadless
+bool glDisplay::initHeadless()
+{
+	mDisplayEGL = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	if( mDisplayEGL == EGL_NO_DISPLAY )
+	{
+		LogError(LOG_GL "glDisplay -- failed to get the EGL display\n");
+		return false;
+	}
+
+	EGLint major = 0;
+	EGLint minor = 0;
+
+	if( !eglInitialize(mDisplayEGL, &major, &minor) )
+	{
+		LogError(LOG_GL "glDisplay -- failed to initialize EGL (error=0x%X)\n", eglGetError());
+		return false;
+	}
+
+	// desktop GL is needed for the fixed-function rendering
+	if( !eglBindAPI(EGL_OPENGL_API) )
+	{
+		LogError(LOG_GL "glDisplay -- EGL doesn't support the OpenGL API (error=0x%X)\n", eglGetError());
+		return false;
+	}
+
+	const EGLint configAttribs[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint numConfigs = 0;
+
+	if( !eglChooseConfig(mDisplayEGL, configAttribs, &config, 1, &numConfigs) || numConfigs == 0 )
+	{
+		LogError(LOG_GL "glDisplay -- failed to find a compatible EGL config\n");
+		return false;
+	}
+
+	// everything is rendered into an FBO, so the surface is only needed
+	// to make the context current when surfaceless contexts aren't supported
+	const char* extensions = eglQueryString(mDisplayEGL, EGL_EXTENSIONS);
+
+	if( !extensions || !strstr(extensions, "EGL_KHR_surfaceless_context") )
+	{
+		const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+
+		mSurfaceEGL = eglCreatePbufferSurface(mDisplayEGL, config, pbufferAttribs);
+
+		if( mSurfaceEGL == EGL_NO_SURFACE )
+		{
+			LogError(LOG_GL "glDisplay -- failed to create EGL pbuffer surface (error=0x%X)\n", eglGetError());
+			return false;
+		}
+	}
+
+	mContextEGL = eglCreateContext(mDisplayEGL, config, EGL_NO_CONTEXT, NULL);
+
+	if( mContextEGL == EGL_NO_CONTEXT )
+	{
+		LogError(LOG_GL "glDisplay -- failed to create EGL context (error=0x%X)\n", eglGetError());
+		return false;
+	}
+
+	if( !makeCurrent() )
+	{
+		LogError(LOG_GL "glDisplay -- failed to make the EGL context current (error=0x%X)\n", eglGetError());
+		return false;
+	}
+
+	// there's no screen, so the size is only limited by the framebuffer
+	if( mOptions.width == 0 )
+		mOptions.width = 1280;
+
+	if( mOptions.height == 0 )
+		mOptions.height = 720;
+
+	mScreenWidth  = 16384;
+	mScreenHeight = 16384;
+
+	mViewport[0] = 0; 
+	mViewport[1] = 0; 
+	mViewport[2] = mOptions.width; 
+	mViewport[3] = mOptions.height;
+
+	mStreaming   = true;
+	mInitialShow = true;
+
+	LogInfo(LOG_GL "glDisplay -- EGL %i.%i headless display (%ux%u, %s)\n", major, minor, mOptions.width, mOptions.height, (mSurfaceEGL != EGL_NO_SURFACE) ? "pbuffer" : "surfaceless");
+
+	GL(glEnable(GL_LINE_SMOOTH));
+	GL(glHint(GL_LINE_SMOOTH_HINT, GL_NICEST));
+
+	return true;
+}
+
+
+// makeCurrent
+bool glDisplay::makeCurrent()
+{
+	if( mHeadless )
+		return eglMakeCurrent(mDisplayEGL, mSurfaceEGL, mSurfaceEGL, mContextEGL);
+
+	return glXMakeCurrent(mDisplayX, mWindowX, mContextGL);
+}
+
+
+// releaseCurrent
+void glDisplay::releaseCurrent()
+{
+	if( mHeadless )
+		eglMakeCurrent(mDisplayEGL, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	else
+		glXMakeCurrent(mDisplayX, None, NULL);
+}
+
+
+// allocFramebuffer
+bool glDisplay::allocFramebuffer( uint32_t width, uint32_t height )
+{
+	if( mFramebufferGL != 0 && mFramebufferSize[0] == width && mFramebufferSize[1] == height )
+		return true;
+
+	freeFramebuffer();
+
+	// color texture
+	GL_VERIFY(glGenTextures(1, &mFramebufferTex));
+	GL_VERIFY(glBindTexture(GL_TEXTURE_2D, mFramebufferTex));
+	GL_VERIFY(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL));
+	GL_VERIFY(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+	GL_VERIFY(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	GL_VERIFY(glBindTexture(GL_TEXTURE_2D, 0));
+
+	// in headless mode the FBO stays bound, so all of the rendering goes to it
+	// (otherwise it's only the target that Capture() blits the backbuffer into)
+	GL_VERIFY(glGenFramebuffers(1, &mFramebufferGL));
+	GL_VERIFY(glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferGL));
+	GL_VERIFY(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mFramebufferTex, 0));
+
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	if( !mHeadless )
+		GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+	if( status != GL_FRAMEBUFFER_COMPLETE )
+	{
+		LogError(LOG_GL "glDisplay -- offscreen framebuffer is incomplete (status=0x%X)\n", status);
+		return false;
+	}
+
+	// CUDA reads the color texture into linear memory at the end of each frame
+	if( CUDA_FAILED(cudaGraphicsGLRegisterImage(&mFramebufferInterop, mFramebufferTex, GL_TEXTURE_2D, cudaGraphicsRegisterFlagsReadOnly)) )
+	{
+		LogError(LOG_GL "glDisplay -- failed to register the offscreen framebuffer with CUDA\n");
+		return false;
+	}
+
+	if( mHeadless && CUDA_FAILED(cudaMalloc(&mFramebufferCUDA, width * height * sizeof(uchar4))) )
+	{
+		LogError(LOG_GL "glDisplay -- failed to allocate the CUDA framebuffer (%ux%u)\n", width, height);
+		return false;
+	}
+
+	mFramebufferSize[0] = width;
+	mFramebufferSize[1] = height;
+
+	LogVerbose(LOG_GL "glDisplay -- allocated %ux%u offscreen framebuffer\n", width, height);
+	return true;
+}
+
+
+// freeFramebuffer
+void glDisplay::freeFramebuffer()
+{
+	if( mFramebufferInterop != NULL )
+	{
+		CUDA(cudaGraphicsUnregisterResource(mFramebufferInterop));
+		mFramebufferInterop = NULL;
+	}
+
+	if( mFramebufferCUDA != NULL )
+	{
+		CUDA(cudaFree(mFramebufferCUDA));
+		mFramebufferCUDA = NULL;
+	}
+
+	if( mFramebufferGL != 0 )
+	{
+		GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+		GL(glDeleteFramebuffers(1, &mFramebufferGL));
+		mFramebufferGL = 0;
+	}
+
+	if( mFramebufferTex != 0 )
+	{
+		GL(glDeleteTextures(1, &mFramebufferTex));
+		mFramebufferTex = 0;
+	}
+
+	mFramebufferSize[0] = 0;
+	mFramebufferSize[1] = 0;
+}
+
+
+// readFramebuffer
+bool glDisplay::readFramebuffer( void* output )
+{
+	if( !mFramebufferInterop || !output )
+		return false;
+
+	// mapping the texture waits for the GL commands that render to it
+	if( CUDA_FAILED(cudaGraphicsMapResources(1, &mFramebufferInterop)) )
+		return false;
+
+	cudaArray_t array = NULL;
+	const size_t pitch = mFramebufferSize[0] * sizeof(uchar4);
+
+	cudaError_t result = cudaGraphicsSubResourceGetMappedArray(&array, mFramebufferInterop, 0, 0);
+
+	if( result == cudaSuccess )
+		result = cudaMemcpy2DFromArray(output, pitch, array, 0, 0, pitch, mFramebufferSize[1], cudaMemcpyDeviceToDevice);
+
+	CUDA(cudaGraphicsUnmapResources(1, &mFramebufferInterop));
+
+	if( CUDA_FAILED(result) )
+	{
+		LogError(LOG_GL "glDisplay -- failed to copy the offscreen framebuffer with CUDA\n");
+		return false;
+	}
+
+	return true;
+}
+
+
+// SetCapture
+void glDisplay::SetCapture( bool enabled )
+{
+	if( enabled == mCaptureEnabled )
+		return;
+
+	mCaptureEnabled = enabled;
+	LogVerbose(LOG_GL "glDisplay -- %s capturing of the composited frames\n", enabled ? "enabled" : "disabled");
+}
+
+
+// captureFrame
+bool glDisplay::captureFrame()
+{
+	const uint32_t width  = GetWidth();
+	const uint32_t height = GetHeight();
+
+	if( width == 0 || height == 0 )
+		return false;
+
+	// windowed displays flip the backbuffer into the framebuffer
+	// (headless displays have already rendered into it)
+	if( !mHeadless )
+	{
+		if( !allocFramebuffer(width, height) )
+			return false;
+
+		GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+		GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mFramebufferGL));
+		GL(glBlitFramebuffer(0, 0, width, height, 0, height, width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+		GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	}
+
+	// the buffers only get reallocated while Capture() isn't reading from them
+	if( mCaptureSize[0] != width || mCaptureSize[1] != height )
+	{
+		mCaptureMutex.Lock();
+
+		const bool allocated = mCaptureRing.Alloc(GL_DISPLAY_CAPTURE_BUFFERS, width * height * sizeof(uchar4));
+
+		mCaptureSize[0] = allocated ? width : 0;
+		mCaptureSize[1] = allocated ? height : 0;
+
+		mCaptureMutex.Unlock();
+
+		if( !allocated )
+		{
+			LogError(LOG_GL "glDisplay -- failed to allocate the capture buffers (%ux%u)\n", width, height);
+			return false;
+		}
+	}
+
+	// the ring buffer skips over the frame that Capture() is converting
+	void* frame = mCaptureRing.Peek(RingBuffer::Write);
+
+	if( !frame || !readFramebuffer(frame) )
+		return false;
+
+	mCaptureRing.Next(RingBuffer::Write);
+	mCaptureEvent.Wake();
+
+	return true;
+}
+
+
+// Capture
+bool glDisplay::Capture( void** output, imageFormat format, uint64_t timeout )
+{
+	if( !output )
+		return false;
+
+	if( !mCaptureEnabled )
+		SetCapture(true);
+
+	if( !mCaptureEvent.Wait(timeout) )
+		return false;
+
+	mCaptureMutex.Lock();
+
+	const uint32_t width  = mCaptureSize[0];
+	const uint32_t height = mCaptureSize[1];
+
+	void* frame = (width > 0 && height > 0) ? mCaptureRing.Acquire(RingBuffer::ReadLatest) : NULL;
+
+	if( !frame )
+	{
+		mCaptureMutex.Unlock();
+		return false;
+	}
+
+	bool result = false;
+
+	if( mCaptureOutput.Alloc(GL_DISPLAY_CAPTURE_BUFFERS, imageFormatSize(format, width, height)) )
+	{
+		void* image = mCaptureOutput.Next(RingBuffer::Write);
+
+		if( image != NULL )
+		{
+			if( format == IMAGE_RGBA8 )
+				result = !CUDA_FAILED(cudaMemcpy(image, frame, width * height * sizeof(uchar4), cudaMemcpyDeviceToDevice));
+			else
+				result = !CUDA_FAILED(cudaConvertColor(frame, IMAGE_RGBA8, image, format, width, height)) && !CUDA_FAILED(cudaStreamSynchronize(NULL));
+
+			*output = image;
+		}
+	}
+
+	mCaptureRing.Release(frame);
+	mCaptureMutex.Unlock();
+
+	if( !result )
+		LogError(LOG_GL "glDisplay::Capture() -- failed to capture frame in %s format\n", imageFormatToStr(format));
+
+	return result;
+}
+
+
 // Open
 bool glDisplay::Open()
 {
@@ -376,9 +877,284 @@ bool glDisplay::Open()
 }
 
 
+// SetTiming
+void glDisplay::SetTiming( bool enabled )
+{
+	if( enabled == mTimingEnabled )
+		return;
+
+	if( enabled )
+	{
+		// start the statistics over
+		for( uint32_t n=0; n < GL_DISPLAY_TIMING_FRAMES; n++ )
+		{
+			mTimers[n].count   = 0;
+			mTimers[n].started = false;
+			mTimers[n].pending = false;
+		}
+
+		memset(&mTiming, 0, sizeof(mTiming));
+		memset(mTimingHistory, 0, sizeof(mTimingHistory));
+
+		mTimingHistoryNext = 0;
+		mUploadTime = 0.0f;
+	}
+	else
+	{
+		endTimer();
+		mTimingOverlay = false;
+	}
+
+	mTimingEnabled = enabled;
+}
+
+
+// SetTimingOverlay
+void glDisplay::SetTimingOverlay( bool enabled )
+{
+	if( enabled )
+		SetTiming(true);
+
+	mTimingOverlay = enabled;
+}
+
+
+// SetRefreshRate
+void glDisplay::SetRefreshRate( float hz )
+{
+	if( hz <= 0.0f )
+	{
+		LogError(LOG_GL "glDisplay::SetRefreshRate() -- invalid refresh rate (%f Hz)\n", hz);
+		return;
+	}
+
+	mRefreshRate = hz;
+}
+
+
+// allocTimers
+bool glDisplay::allocTimers()
+{
+	if( mTimersAllocated )
+		return true;
+
+	if( mTimersFailed )
+		return false;
+
+	if( !GLEW_VERSION_3_3 && !GLEW_ARB_timer_query )
+	{
+		LogWarning(LOG_GL "glDisplay -- GL timer queries aren't supported, only the CPU times will be measured\n");
+		mTimersFailed = true;
+		return false;
+	}
+
+	for( uint32_t n=0; n < GL_DISPLAY_TIMING_FRAMES; n++ )
+	{
+		GL(glGenQueries(GL_DISPLAY_TIMING_QUERIES, mTimers[n].queries));
+		GL(glGenQueries(1, &mTimers[n].begin));
+		GL(glGenQueries(1, &mTimers[n].end));
+
+		mTimers[n].count   = 0;
+		mTimers[n].started = false;
+		mTimers[n].pending = false;
+	}
+
+	mTimersAllocated = true;
+	return true;
+}
+
+
+// freeTimers
+void glDisplay::freeTimers()
+{
+	if( !mTimersAllocated )
+		return;
+
+	for( uint32_t n=0; n < GL_DISPLAY_TIMING_FRAMES; n++ )
+	{
+		GL(glDeleteQueries(GL_DISPLAY_TIMING_QUERIES, mTimers[n].queries));
+		GL(glDeleteQueries(1, &mTimers[n].begin));
+		GL(glDeleteQueries(1, &mTimers[n].end));
+	}
+
+	memset(mTimers, 0, sizeof(mTimers));
+	mTimersAllocated = false;
+}
+
+
+// beginTimer (timer queries can't be nested, so returns false if one is already active)
+bool glDisplay::beginTimer( uint32_t category )
+{
+	if( !mTimingEnabled || !mTimersAllocated || mTimerActive >= 0 )
+		return false;
+
+	timerFrame* timers = &mTimers[mTimerFrame];
+
+	if( !timers->started || timers->count >= GL_DISPLAY_TIMING_QUERIES )
+		return false;
+
+	GL(glBeginQuery(GL_TIME_ELAPSED, timers->queries[timers->count]));
+
+	timers->categories[timers->count] = category;
+	mTimerActive = timers->count++;
+
+	return true;
+}
+
+
+// endTimer
+void glDisplay::endTimer()
+{
+	if( mTimerActive < 0 )
+		return;
+
+	GL(glEndQuery(GL_TIME_ELAPSED));
+	mTimerActive = -1;
+}
+
+
+// readTimers
+void glDisplay::readTimers( uint32_t frame )
+{
+	timerFrame* timers = &mTimers[frame];
+
+	if( !timers->pending )
+		return;
+
+	timers->pending = false;
+
+	// the queries are GL_DISPLAY_TIMING_FRAMES old by now, so this shouldn't have to wait -
+	// but if the GPU is that far behind, skip the frame instead of stalling on it
+	GLint available = 0;
+	GL(glGetQueryObjectiv(timers->end, GL_QUERY_RESULT_AVAILABLE, &available));
+
+	if( !available )
+	{
+		LogVerbose(LOG_GL "glDisplay -- GPU timer queries weren't ready after %u frames, skipping\n", GL_DISPLAY_TIMING_FRAMES);
+		return;
+	}
+
+	GLuint64 upload = 0;
+	GLuint64 draw   = 0;
+
+	for( uint32_t n=0; n < timers->count; n++ )
+	{
+		GLuint64 elapsed = 0;
+		GL(glGetQueryObjectui64v(timers->queries[n], GL_QUERY_RESULT, &elapsed));
+
+		if( timers->categories[n] == TIMER_UPLOAD )
+			upload += elapsed;
+		else
+			draw += elapsed;
+	}
+
+	GLuint64 begin = 0;
+	GLuint64 end   = 0;
+
+	GL(glGetQueryObjectui64v(timers->begin, GL_QUERY_RESULT, &begin));
+	GL(glGetQueryObjectui64v(timers->end, GL_QUERY_RESULT, &end));
+
+	mTiming.upload = upload * 0.000001f;
+	mTiming.draw   = draw * 0.000001f;
+	mTiming.gpu    = (end > begin) ? (end - begin) * 0.000001f : 0.0f;
+}
+
+
+// beginFrameTiming
+void glDisplay::beginFrameTiming()
+{
+	if( !mTimingEnabled || !allocTimers() )
+		return;
+
+	// collect the results from the last time this set of queries was used
+	readTimers(mTimerFrame);
+
+	timerFrame* timers = &mTimers[mTimerFrame];
+
+	timers->count   = 0;
+	timers->started = true;
+
+	GL(glQueryCounter(timers->begin, GL_TIMESTAMP));
+}
+
+
+// endFrameTiming
+void glDisplay::endFrameTiming( float swapTime, float frameTime )
+{
+	if( !mTimingEnabled )
+		return;
+
+	const float period = 1000.0f / mRefreshRate;
+
+	mTiming.uploadCPU = mUploadTime;
+	mTiming.swap      = swapTime;
+	mTiming.frame     = frameTime;
+	mTiming.missed    = (frameTime > period * 1.5f) ? (uint32_t)(frameTime / period + 0.5f) - 1 : 0;
+
+	mTiming.missedTotal += mTiming.missed;
+	mTiming.frames++;
+
+	mTimingHistory[mTimingHistoryNext][0] = frameTime;
+	mTimingHistory[mTimingHistoryNext][1] = mTiming.gpu;
+
+	mTimingHistoryNext = (mTimingHistoryNext + 1) % GL_DISPLAY_TIMING_HISTORY;
+	mUploadTime = 0.0f;
+
+	if( mTimersAllocated )
+	{
+		mTimers[mTimerFrame].started = false;
+		mTimerFrame = (mTimerFrame + 1) % GL_DISPLAY_TIMING_FRAMES;
+	}
+}
+
+
+// renderTiming
+void glDisplay::renderTiming()
+{
+	const float barWidth    = 2.0f;
+	const float graphWidth  = GL_DISPLAY_TIMING_HISTORY * barWidth;
+	const float graphHeight = 80.0f;
+
+	const float x = 10.0f;
+	const float y = mViewport[3] - graphHeight - 10.0f;
+
+	// the graph spans two refresh periods
+	const float period = 1000.0f / mRefreshRate;
+	const float scale  = graphHeight / (period * 2.0f);
+
+	RenderRect(x, y, graphWidth, graphHeight, 0.0f, 0.0f, 0.0f, 0.5f);
+
+	// draw the oldest frames on the left and the newest on the right
+	for( uint32_t n=0; n < GL_DISPLAY_TIMING_HISTORY; n++ )
+	{
+		const float* sample = mTimingHistory[(mTimingHistoryNext + n) % GL_DISPLAY_TIMING_HISTORY];
+
+		if( sample[0] <= 0.0f )
+			continue;
+
+		const float frameHeight = fminf(sample[0] * scale, graphHeight);
+		const float gpuHeight   = fminf(sample[1] * scale, graphHeight);
+
+		if( sample[0] > period * 1.5f )
+			RenderRect(x + n * barWidth, y + graphHeight - frameHeight, barWidth, frameHeight, 1.0f, 0.0f, 0.0f, 0.8f);
+		else
+			RenderRect(x + n * barWidth, y + graphHeight - frameHeight, barWidth, frameHeight, 0.0f, 1.0f, 0.0f, 0.8f);
+
+		if( gpuHeight > 0.0f )
+			RenderRect(x + n * barWidth, y + graphHeight - gpuHeight, barWidth, gpuHeight, 0.0f, 0.5f, 1.0f, 0.8f);
+	}
+
+	// mark the refresh period
+	RenderLine(x, y + graphHeight - period * scale, x + graphWidth, y + graphHeight - period * scale, 1.0f, 1.0f, 1.0f, 0.8f, 1.0f);
+}
+
+
 // SetTitle
 void glDisplay::SetTitle( const char* str )
 {
+	if( mHeadless )
+		return;
+
 	XStoreName(mDisplayX, mWindowX, str);
 }
 
@@ -422,10 +1198,24 @@ void glDisplay::ResetViewport()
 // activateViewport
 void glDisplay::activateViewport()
 {
-	GL(glViewport(mViewport[0], mViewport[1], mViewport[2], mViewport[3]));
+	// the queued primitives use the old projection
+	flushBatch();
+
 	GL(glMatrixMode(GL_PROJECTION));
 	GL(glLoadIdentity());
-	GL(glOrtho(0.0f, mViewport[2], mViewport[3], 0.0f, 0.0f, 1.0f));
+
+	if( mHeadless )
+	{
+		// the offscreen framebuffer is rendered upside-down, so that
+		// its first row in memory is the top of the image for CUDA
+		GL(glViewport(mViewport[0], GetHeight() - mViewport[1] - mViewport[3], mViewport[2], mViewport[3]));
+		GL(glOrtho(0.0f, mViewport[2], 0.0f, mViewport[3], 0.0f, 1.0f));
+	}
+	else
+	{
+		GL(glViewport(mViewport[0], mViewport[1], mViewport[2], mViewport[3]));
+		GL(glOrtho(0.0f, mViewport[2], mViewport[3], 0.0f, 0.0f, 1.0f));
+	}
 }
 
 
@@ -441,7 +1231,19 @@ void glDisplay::BeginRender( bool processEvents )
 
 	mRendering = true;
 
-	GL(glXMakeCurrent(mDisplayX, mWindowX, mContextGL));
+	GL(makeCurrent());
+
+	// follow the display size in headless mode
+	if( mHeadless )
+	{
+		if( !allocFramebuffer(GetWidth(), GetHeight()) )
+			LogError(LOG_GL "glDisplay -- failed to resize the offscreen framebuffer to %ux%u\n", GetWidth(), GetHeight());
+
+		GL(glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferGL));
+	}
+
+	// start the GPU timer for the frame
+	beginFrameTiming();
 
 	GL(glClearColor(mBgColor[0], mBgColor[1], mBgColor[2], mBgColor[3]));
 	GL(glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT));
@@ -469,8 +1271,38 @@ void glDisplay::EndRender()
 			RenderOutline(x, y, width, height, 1, 1, 1);
 	}
 
-	// present the backbuffer
-	glXSwapBuffers(mDisplayX, mWindowX);
+	// graph the frame timing
+	if( mTimingOverlay )
+		renderTiming();
+
+	// draw the queued lines/rects
+	beginTimer(TIMER_DRAW);
+	flushBatch();
+	endTimer();
+
+	// mark the end of the frame for the GPU timer
+	if( mTimingEnabled && mTimersAllocated && mTimers[mTimerFrame].started )
+	{
+		GL(glQueryCounter(mTimers[mTimerFrame].end, GL_TIMESTAMP));
+		mTimers[mTimerFrame].pending = true;
+	}
+
+	// keep a copy of the composited frame for Capture()
+	if( mCaptureEnabled )
+		captureFrame();
+
+	// present the backbuffer, or pass the composited frame to the sub-streams
+	const timespec swapTime = timestamp();
+
+	if( mHeadless )
+	{
+		if( readFramebuffer(mFramebufferCUDA) )
+			videoOutput::Render(mFramebufferCUDA, mFramebufferSize[0], mFramebufferSize[1], IMAGE_RGBA8);
+	}
+	else
+	{
+		glXSwapBuffers(mDisplayX, mWindowX);
+	}
 
 	// measure framerate
 	timespec currTime;
@@ -483,130 +1315,412 @@ void glDisplay::EndRender()
 	mLastTime  = currTime;
 	mRendering = false;
 
+	endFrameTiming(timeFloat(timeDiff(swapTime, currTime)), ns * 0.000001f);
+
 	mOptions.frameRate = GetFPS();
 }
 
 
-// allocTexture
-glTexture* glDisplay::allocTexture( uint32_t width, uint32_t height, imageFormat format )
+// allocTexture
+glTexture* glDisplay::allocTexture( uint32_t width, uint32_t height, imageFormat format, GLsync** fence )
+{
+	if( width == 0 || height == 0 )
+		return NULL;
+
+	// convert imageFormat to GL format
+	uint32_t glFormat = 0;
+
+	if( imageFormatIsYUV(format) )
+	{
+		// YUV is stored as raw bytes, and gets converted by the shader
+		glFormat = GL_LUMINANCE8;
+
+		if( format == IMAGE_I420 || format == IMAGE_YV12 || format == IMAGE_NV12 )
+			height = height + height / 2;	// chroma planes are below the luma plane
+		else
+			width = width * 2;			// packed 4:2:2 is 2 bytes per pixel
+	}
+	else if( format == IMAGE_RGB8 )
+		glFormat = GL_RGB8;
+	else if( format == IMAGE_RGBA8 )
+		glFormat = GL_RGBA8;
+	else if( format == IMAGE_RGB32F )
+		glFormat = GL_RGB32F_ARB;
+	else if( format == IMAGE_RGBA32F )
+		glFormat = GL_RGBA32F_ARB;
+	else
+	{
+		LogError(LOG_GL "glDisplay::Render() -- unsupported image format (%s)\n", imageFormatToStr(format));
+		LogError(LOG_GL "                       supported formats are:\n");
+		LogError(LOG_GL "                           * rgb8\n");		
+		LogError(LOG_GL "                           * rgba8\n");		
+		LogError(LOG_GL "                           * rgb32\n");		
+		LogError(LOG_GL "                           * rgba32\n");
+		LogError(LOG_GL "                           * i420, yv12, nv12\n");
+		LogError(LOG_GL "                           * yuyv, yvyu, uyvy\n");
+
+		return NULL;
+	}
+		
+	// check to see if a compatible set of textures has already been allocated
+	textureRing* ring = NULL;
+
+	for( size_t n=0; n < mTextureRings.size(); n++ )
+	{
+		if( mTextureRings[n].width == width && mTextureRings[n].height == height && mTextureRings[n].format == glFormat )
+		{
+			ring = &mTextureRings[n];
+			break;
+		}
+	}
+
+	if( !ring )
+	{
+		textureRing newRing;
+
+		newRing.width  = width;
+		newRing.height = height;
+		newRing.format = glFormat;
+		newRing.next   = 0;
+
+		for( uint32_t n=0; n < GL_DISPLAY_INTEROP_BUFFERS; n++ )
+		{
+			glTexture* tex = glTexture::Create(width, height, glFormat);
+
+			if( !tex )
+			{
+				LogError(LOG_GL "glDisplay.Render() failed to create OpenGL interop texture\n");
+				return NULL;
+			}
+
+			// the YUV shader reads individual bytes, so they can't be filtered
+			if( glFormat == GL_LUMINANCE8 )
+			{
+				tex->Bind();
+				GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+				GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+				tex->Unbind();
+			}
+
+			mTextures.push_back(tex);
+
+			newRing.textures[n] = tex;
+			newRing.fences[n]   = NULL;
+		}
+
+		mTextureRings.push_back(newRing);
+		ring = &mTextureRings.back();
+	}
+
+	// take the next texture in the ring, after GL is done drawing it from the previous time
+	const uint32_t idx = ring->next;
+	ring->next = (idx + 1) % GL_DISPLAY_INTEROP_BUFFERS;
+
+	if( ring->fences[idx] != NULL )
+	{
+		if( glClientWaitSync(ring->fences[idx], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED )
+			LogWarning(LOG_GL "glDisplay.Render() -- timed out waiting for interop texture to be released\n");
+
+		glDeleteSync(ring->fences[idx]);
+		ring->fences[idx] = NULL;
+	}
+
+	if( fence != NULL )
+		*fence = &ring->fences[idx];
+
+	return ring->textures[idx];
+}
+
+
+// Render
+void glDisplay::Render( glTexture* texture, float x, float y )
+{
+	if( !texture )
+		return;
+
+	beginTimer(TIMER_DRAW);
+	flushBatch();
+	texture->Render(x,y);
+	endTimer();
+}
+
+
+// Render
+void glDisplay::Render( glTextureTiled* texture, const float4& view, const float4& rect, cudaStream_t stream )
+{
+	if( !texture )
+		return;
+
+	// the tiles are registered for interop with the display's GPU
+	cudaDeviceScope device(mOptions.cudaDevice);
+
+	beginTimer(TIMER_DRAW);
+	flushBatch();
+	texture->Render(view, rect, stream);
+	endTimer();
+}
+
+
+// YUV to RGB fragment shader (the texture holds the raw bytes of the image)
+static const char* yuvFragmentShader = 
+	"#version 120\n"
+	"uniform sampler2D image;\n"
+	"uniform int  format;\n"		// 0=I420, 1=YV12, 2=NV12, 3=YUYV, 4=YVYU, 5=UYVY
+	"uniform vec2 imageSize;\n"
+	"uniform vec2 textureSize;\n"
+	"float fetch( vec2 p ) { return texture2D(image, (p + 0.5) / textureSize).r; }\n"
+	"vec2 offsetToPixel( float offset ) { return vec2(mod(offset, textureSize.x), floor(offset / textureSize.x)); }\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 px = min(floor(gl_TexCoord[0].xy * imageSize), imageSize - 1.0);\n"
+	"	vec2 c = floor(px * 0.5);\n"
+	"	float y, u, v;\n"
+	"	if( format == 2 )\n"
+	"	{\n"
+	"		y = fetch(px);\n"
+	"		u = fetch(vec2(c.x * 2.0, imageSize.y + c.y));\n"
+	"		v = fetch(vec2(c.x * 2.0 + 1.0, imageSize.y + c.y));\n"
+	"	}\n"
+	"	else if( format < 2 )\n"
+	"	{\n"
+	"		float lumaSize = imageSize.x * imageSize.y;\n"
+	"		float offset = lumaSize + c.y * imageSize.x * 0.5 + c.x;\n"
+	"		y = fetch(px);\n"
+	"		u = fetch(offsetToPixel(offset));\n"
+	"		v = fetch(offsetToPixel(offset + lumaSize * 0.25));\n"
+	"		if( format == 1 ) { float t = u; u = v; v = t; }\n"
+	"	}\n"
+	"	else\n"
+	"	{\n"
+	"		float base = c.x * 4.0;\n"
+	"		float odd = (px.x - c.x * 2.0) * 2.0;\n"
+	"		if( format == 5 ) { y = fetch(vec2(base + 1.0 + odd, px.y)); u = fetch(vec2(base, px.y)); v = fetch(vec2(base + 2.0, px.y)); }\n"
+	"		else { y = fetch(vec2(base + odd, px.y)); u = fetch(vec2(base + 1.0, px.y)); v = fetch(vec2(base + 3.0, px.y)); }\n"
+	"		if( format == 4 ) { float t = u; u = v; v = t; }\n"
+	"	}\n"
+	"	u -= 0.5;\n"
+	"	v -= 0.5;\n"
+	"	gl_FragColor = vec4(clamp(vec3(y + 1.402 * v, y - 0.344 * u - 0.714 * v, y + 1.772 * u), 0.0, 1.0), 1.0);\n"
+	"}\n";
+
+
+// yuvShaderFormat
+static inline int yuvShaderFormat( imageFormat format )
+{
+	switch(format)
+	{
+		case IMAGE_I420:	return 0;
+		case IMAGE_YV12:	return 1;
+		case IMAGE_NV12:	return 2;
+		case IMAGE_YUYV:	return 3;
+		case IMAGE_YVYU:	return 4;
+		case IMAGE_UYVY:	return 5;
+		default:			return -1;
+	}
+}
+
+
+// allocShaderYUV
+glShader* glDisplay::allocShaderYUV()
 {
-	if( width == 0 || height == 0 )
-		return NULL;
+	if( mShaderYUV != NULL )
+		return mShaderYUV;
 
-	// convert imageFormat to GL format
-	uint32_t glFormat = 0;
+	mShaderYUV = glShader::Create(NULL, yuvFragmentShader);
 
-	if( format == IMAGE_RGB8 )
-		glFormat = GL_RGB8;
-	else if( format == IMAGE_RGBA8 )
-		glFormat = GL_RGBA8;
-	else if( format == IMAGE_RGB32F )
-		glFormat = GL_RGB32F_ARB;
-	else if( format == IMAGE_RGBA32F )
-		glFormat = GL_RGBA32F_ARB;
-	else
-	{
-		LogError(LOG_GL "glDisplay::Render() -- unsupported image format (%s)\n", imageFormatToStr(format));
-		LogError(LOG_GL "                       supported formats are:\n");
-		LogError(LOG_GL "                           * rgb8\n");		
-		LogError(LOG_GL "                           * rgba8\n");		
-		LogError(LOG_GL "                           * rgb32\n");		
-		LogError(LOG_GL "                           * rgba32\n");
+	if( !mShaderYUV )
+		LogError(LOG_GL "glDisplay.Render() failed to create YUV shader\n");
 
-		return NULL;
-	}
-		
-	// check to see if a compatible texture has already been allocated
-	const size_t numTextures = mTextures.size();
+	return mShaderYUV;
+}
 
-	for( size_t n=0; n < numTextures; n++ )
-	{
-		glTexture* tex = mTextures[n];
 
-		if( tex->GetWidth() == width && tex->GetHeight() == height && tex->GetFormat() == glFormat )
-			return tex;
-	}
+// allocBatch
+glRenderBatch* glDisplay::allocBatch()
+{
+	if( mBatch != NULL || mBatchFailed )
+		return mBatch;
 
-	glTexture* tex = glTexture::Create(width, height, glFormat);
+	mBatch = glRenderBatch::Create();
 
-	if( !tex )
+	// fall back to immediate mode
+	if( !mBatch )
 	{
-		LogError(LOG_GL "glDisplay.Render() failed to create OpenGL interop texture\n");
-		return NULL;
+		LogWarning(LOG_GL "glDisplay -- falling back to immediate mode for lines and rects\n");
+		mBatchFailed = true;
 	}
 
-	mTextures.push_back(tex);
-	return tex;
+	return mBatch;
 }
 
 
-// Render
-void glDisplay::Render( glTexture* texture, float x, float y )
+// flushBatch
+void glDisplay::flushBatch()
 {
-	if( !texture )
-		return;
-
-	texture->Render(x,y);
+	if( mBatch != NULL )
+		mBatch->Flush();
 }
 
 
 // RenderImage
-void glDisplay::RenderImage( void* img, uint32_t width, uint32_t height, imageFormat format, float x, float y, bool normalize )
+void glDisplay::RenderImage( void* img, uint32_t width, uint32_t height, imageFormat format, float x, float y, bool normalize, cudaStream_t stream )
 {
 	if( !img || width == 0 || height == 0 )
 		return;
 	
+	NVTX_RANGE("glDisplay::RenderImage");
+	PROFILER_SCOPE_CUDA("glDisplay::RenderImage", stream);
+
+	// the textures are registered for interop with the display's GPU
+	cudaDeviceScope device(mOptions.cudaDevice);
+
 	// obtain the OpenGL texture to use
-	glTexture* interopTex = allocTexture(width, height, format);
+	GLsync* fence = NULL;
+	glTexture* interopTex = allocTexture(width, height, format, &fence);
 
 	if( !interopTex )
 		return;
 	
-	// normalize pixels from [0,255] -> [0,1]
-	if( normalize && (format == IMAGE_RGB32F || format == IMAGE_RGBA32F) )
+	const bool yuv = imageFormatIsYUV(format);
+
+	if( yuv && yuvShaderFormat(format) < 0 )
 	{
-		if( !mNormalizedCUDA || mNormalizedWidth < width || mNormalizedHeight < height )
-		{
-			if( mNormalizedCUDA != NULL )
-			{
-				CUDA(cudaFree(mNormalizedCUDA));
-				mNormalizedCUDA = NULL;
-			}
+		LogError(LOG_GL "glDisplay.Render() -- unsupported YUV format (%s)\n", imageFormatToStr(format));
+		return;
+	}
 
-			if( CUDA_FAILED(cudaMalloc(&mNormalizedCUDA, width * height * sizeof(float) * 4)) )	// just allocate this as float4 for simplicity
-			{
-				LogError(LOG_GL "glDisplay.Render() failed to allocate CUDA memory for normalization\n");
-				return;
-			}
+	// map from CUDA to openGL using GL interop
+	const timespec uploadTime = timestamp();
+	beginTimer(TIMER_UPLOAD);
+	NVTX_PUSH("glDisplay::Upload");
 
-			mNormalizedWidth = width;
-			mNormalizedHeight = height;
-		}
+	void* tex_map = interopTex->Map(GL_MAP_CUDA, GL_WRITE_DISCARD, stream); //interopTex->MapCUDA();
+
+	if( !tex_map )
+	{
+		NVTX_POP();
+		endTimer();
+		return;
+	}
+
+	// frames from another GPU get copied peer-to-peer into the texture first
+	int currentDevice = 0;
+	const int imgDevice = cudaPointerDevice(img);
+	const bool peer = imgDevice >= 0 && cudaGetDevice(&currentDevice) == cudaSuccess && imgDevice != currentDevice;
 
-		// rescale image pixel intensities for display
+	if( peer || !normalize || (format != IMAGE_RGB32F && format != IMAGE_RGBA32F) )
+	{
+		CUDA(cudaMemcpyFromDevice(tex_map, img, interopTex->GetSize(), stream));
+		img = tex_map;
+	}
+
+	if( normalize && (format == IMAGE_RGB32F || format == IMAGE_RGBA32F) )
+	{
+		// rescale image pixel intensities from [0,255] -> [0,1] straight into the texture
 		if( CUDA_FAILED(cudaNormalize(img, make_float2(0.0f, 255.0f), 
-							  mNormalizedCUDA, make_float2(0.0f, 1.0f), 
-	 						  width, height, format)) )
+							  tex_map, make_float2(0.0f, 1.0f), 
+	 						  width, height, format, stream)) )
 		{
 			LogError(LOG_GL "glDisplay.Render() failed to normalize image\n");
+		}
+	}
+
+	interopTex->Unmap();
+	NVTX_POP();
+	endTimer();
+
+	if( mTimingEnabled )
+		mUploadTime += timeFloat(timeDiff(uploadTime, timestamp()));
+
+	// draw the texture (on top of any primitives that were queued before it)
+	beginTimer(TIMER_DRAW);
+	flushBatch();
+
+	if( yuv )
+	{
+		glShader* shader = allocShaderYUV();
+
+		if( !shader || !shader->Bind() )
+		{
+			endTimer();
 			return;
 		}
 
-		img = mNormalizedCUDA;
+		shader->SetUniform("image", 0);
+		shader->SetUniform("format", yuvShaderFormat(format));
+		shader->SetUniform("imageSize", (float)width, (float)height);
+		shader->SetUniform("textureSize", (float)interopTex->GetWidth(), (float)interopTex->GetHeight());
+
+		interopTex->Render(x, y, width, height);
+		shader->Unbind();
+	}
+	else
+	{
+		interopTex->Render(x,y);
 	}
 
-	// map from CUDA to openGL using GL interop
-	void* tex_map = interopTex->Map(GL_MAP_CUDA, GL_WRITE_DISCARD); //interopTex->MapCUDA();
+	endTimer();
+
+	// the texture can be reused once GL has finished drawing it
+	*fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+// RenderGrid
+void glDisplay::RenderGrid( const cudaGridTile* tiles, uint32_t numTiles, imageFormat format, uint32_t columns, bool normalize, cudaStream_t stream )
+{
+	if( !tiles || numTiles == 0 )
+		return;
+
+	if( !imageFormatIsRGB(format) )
+	{
+		imageFormatErrorMsg(LOG_GL, "glDisplay::RenderGrid()", format);
+		return;
+	}
+
+	// the grid texture covers the whole viewport
+	const uint32_t width  = mViewport[2];
+	const uint32_t height = mViewport[3];
+
+	if( width == 0 || height == 0 )
+		return;
+
+	GLsync* fence = NULL;
+	glTexture* interopTex = allocTexture(width, height, format, &fence);
+
+	if( !interopTex )
+		return;
+
+	// tile the images straight into the texture
+	const timespec uploadTime = timestamp();
+	beginTimer(TIMER_UPLOAD);
 
-	if( tex_map != NULL )
+	void* tex_map = interopTex->Map(GL_MAP_CUDA, GL_WRITE_DISCARD, stream);
+
+	if( !tex_map )
 	{
-		CUDA(cudaMemcpy(tex_map, img, interopTex->GetSize(), cudaMemcpyDeviceToDevice));
-		//CUDA(cudaDeviceSynchronize());
-		interopTex->Unmap();
+		endTimer();
+		return;
 	}
 
-	// draw the texture
-	interopTex->Render(x,y);
+	if( CUDA_FAILED(cudaGrid(tiles, numTiles, tex_map, width, height, format, columns, FILTER_LINEAR, stream)) )
+		LogError(LOG_GL "glDisplay::RenderGrid() -- failed to tile the images\n");
+	else if( normalize && (format == IMAGE_RGB32F || format == IMAGE_RGBA32F) )
+		CUDA(cudaNormalize(tex_map, make_float2(0.0f, 255.0f), tex_map, make_float2(0.0f, 1.0f), width, height, format, stream));
+
+	interopTex->Unmap();
+	endTimer();
+
+	if( mTimingEnabled )
+		mUploadTime += timeFloat(timeDiff(uploadTime, timestamp()));
+
+	// draw the grid
+	beginTimer(TIMER_DRAW);
+	flushBatch();
+	interopTex->Render(0, 0);
+	endTimer();
+
+	*fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
 
 
@@ -639,21 +1753,18 @@ bool glDisplay::Render( void* image, uint32_t width, uint32_t height, imageForma
 	if( !image )
 		return false;
 
+	NVTX_RANGE_FMT("glDisplay::Render (%s)", mOptions.resource.string.c_str());
+
 	bool display_success = true;
 
 	// determine input format
-	if( imageFormatIsRGB(format) )
+	if( imageFormatIsRGB(format) || yuvShaderFormat(format) >= 0 )
 	{
-		// resize the window once to match the feed, but let the user resize/maximize
-		// only resize again if the window is then smaller than the feed
-		if( !mResizedToFeed || ((GetWidth() < width || GetHeight() < height) && (width < mScreenWidth && height < mScreenHeight)) )
-		{
-			SetSize(width, height);
-			mResizedToFeed = true;
-		}
-
-		// render and present the frame
-		RenderOnce(image, width, height, format, 0, 0);
+		// either present the frame now, or pass it to the render thread
+		if( mRenderThread != NULL )
+			display_success = submitFrame(image, width, height, format);
+		else
+			display_success = renderFrame(image, width, height, format);
 	}
 	else
 	{
@@ -663,34 +1774,202 @@ bool glDisplay::Render( void* image, uint32_t width, uint32_t height, imageForma
 		LogError(LOG_GL "                           * rgba8\n");		
 		LogError(LOG_GL "                           * rgb32\n");		
 		LogError(LOG_GL "                           * rgba32\n");
+		LogError(LOG_GL "                           * i420, yv12, nv12\n");
+		LogError(LOG_GL "                           * yuyv, yvyu, uyvy\n");
 		
 		display_success = false;
 	}
 
-	// render sub-streams
-	const bool substreams_success = videoOutput::Render(image, width, height, format);
+	// render sub-streams (headless displays pass on the composited frame from EndRender() instead)
+	const bool substreams_success = mHeadless ? true : videoOutput::Render(image, width, height, format);
 	return display_success & substreams_success;
 }
 
 
+// renderFrame
+bool glDisplay::renderFrame( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	// resize the window once to match the feed, but let the user resize/maximize
+	// only resize again if the window is then smaller than the feed
+	if( !mResizedToFeed || ((GetWidth() < width || GetHeight() < height) && (width < mScreenWidth && height < mScreenHeight)) )
+	{
+		SetSize(width, height);
+		mResizedToFeed = true;
+	}
+
+	// render and present the frame
+	RenderOnce(image, width, height, format, 0, 0);
+	return true;
+}
+
+
+// submitFrame
+bool glDisplay::submitFrame( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	cudaDeviceScope device(mOptions.cudaDevice);
+
+	// the write slot is only used by this thread, so it can be filled without the lock
+	mailboxFrame& frame = mMailbox[mMailboxWrite];
+	const size_t size = imageFormatSize(format, width, height);
+
+	if( !frame.image || frame.size < size )
+	{
+		if( frame.image != NULL )
+			CUDA(cudaFree(frame.image));
+
+		frame.image = NULL;
+		frame.size  = 0;
+
+		if( CUDA_FAILED(cudaMalloc(&frame.image, size)) )
+		{
+			LogError(LOG_GL "glDisplay::Render() -- failed to allocate %zu bytes for the render thread\n", size);
+			return false;
+		}
+
+		frame.size = size;
+	}
+
+	if( CUDA_FAILED(cudaMemcpyFromDevice(frame.image, image, size)) )
+		return false;
+
+	frame.width  = width;
+	frame.height = height;
+	frame.format = format;
+
+	// publish the frame, replacing the pending one if it hasn't been rendered yet
+	mRenderMutex.Lock();
+	std::swap(mMailboxWrite, mMailboxPending);
+	mMailboxNewFrame = true;
+	mRenderMutex.Unlock();
+
+	mRenderEvent.Wake();
+	return true;
+}
+
+
+// renderThread
+void* glDisplay::renderThread( void* user )
+{
+	((glDisplay*)user)->renderLoop();
+	return NULL;
+}
+
+
+// renderLoop
+void glDisplay::renderLoop()
+{
+	cudaDeviceScope device(mOptions.cudaDevice);
+
+	while( !mRenderStop )
+	{
+		// keep processing window events if no frames are arriving
+		if( !mRenderEvent.Wait(50) )
+		{
+			ProcessEvents();
+			continue;
+		}
+
+		mRenderMutex.Lock();
+
+		const bool newFrame = mMailboxNewFrame;
+
+		if( newFrame )
+		{
+			std::swap(mMailboxRead, mMailboxPending);
+			mMailboxNewFrame = false;
+		}
+
+		mRenderMutex.Unlock();
+
+		if( !newFrame )
+			continue;
+
+		const mailboxFrame& frame = mMailbox[mMailboxRead];
+		renderFrame(frame.image, frame.width, frame.height, frame.format);
+	}
+
+	// release the context so the other thread can take it back
+	releaseCurrent();
+}
+
+
+// SetRenderThread
+bool glDisplay::SetRenderThread( bool enabled )
+{
+	if( enabled == (mRenderThread != NULL) )
+		return true;
+
+	if( enabled )
+	{
+		// a GL context can only be current on one thread at a time
+		releaseCurrent();
+
+		mRenderStop = false;
+		mRenderThread = new Thread();
+
+		if( !mRenderThread->Start(renderThread, this) )
+		{
+			LogError(LOG_GL "glDisplay -- failed to start the render thread\n");
+
+			delete mRenderThread;
+			mRenderThread = NULL;
+
+			makeCurrent();
+			return false;
+		}
+
+		LogVerbose(LOG_GL "glDisplay -- started the render thread\n");
+	}
+	else
+	{
+		mRenderStop = true;
+		mRenderEvent.Wake();
+		mRenderThread->Stop(true);
+
+		delete mRenderThread;
+		mRenderThread = NULL;
+
+		makeCurrent();
+		LogVerbose(LOG_GL "glDisplay -- stopped the render thread\n");
+	}
+
+	return true;
+}
+
+
 // RenderLine
 void glDisplay::RenderLine( float x1, float y1, float x2, float y2, float r, float g, float b, float a, float thickness )
 {
-	glDrawLine(x1, y1, x2, y2, r, g, b, a);
+	glRenderBatch* batch = allocBatch();
+
+	if( batch != NULL )
+		batch->AddLine(x1, y1, x2, y2, r, g, b, a, thickness);
+	else
+		glDrawLine(x1, y1, x2, y2, r, g, b, a, thickness);
 }
 
 
 // RenderOutline
 void glDisplay::RenderOutline( float left, float top, float width, float height, float r, float g, float b, float a, float thickness )
 {
-	glDrawOutline(left, top, width, height, r, g, b, a);
+	glRenderBatch* batch = allocBatch();
+
+	if( batch != NULL )
+		batch->AddOutline(left, top, width, height, r, g, b, a, thickness);
+	else
+		glDrawOutline(left, top, width, height, r, g, b, a, thickness);
 }
 
 
 // RenderRect
 void glDisplay::RenderRect( float left, float top, float width, float height, float r, float g, float b, float a )
 {
-	glDrawRect(left, top, width, height, r, g, b, a);
+	glRenderBatch* batch = allocBatch();
+
+	if( batch != NULL )
+		batch->AddRect(left, top, width, height, r, g, b, a);
+	else
+		glDrawRect(left, top, width, height, r, g, b, a);
 }
 
 
@@ -731,6 +2010,9 @@ void glDisplay::SetBackgroundColor( float r, float g, float b, float a )
 // IsMaximied
 bool glDisplay::IsMaximized()
 {
+	if( mHeadless )
+		return false;
+
 	Atom _NET_WM_STATE = XInternAtom(mDisplayX, "_NET_WM_STATE", False);
 	Atom _NET_WM_STATE_MAXIMIZED_VERT = XInternAtom(mDisplayX, "_NET_WM_STATE_MAXIMIZED_VERT", False);
 	Atom _NET_WM_STATE_MAXIMIZED_HORZ = XInternAtom(mDisplayX, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
@@ -771,6 +2053,9 @@ bool glDisplay::IsMaximized()
 // SetMaximized
 void glDisplay::SetMaximized( bool maximized )
 {
+	if( mHeadless )
+		return;
+
 	Atom _NET_WM_STATE = XInternAtom(mDisplayX, "_NET_WM_STATE", False);
 	Atom _NET_WM_STATE_MAXIMIZED_VERT = XInternAtom(mDisplayX, "_NET_WM_STATE_MAXIMIZED_VERT", False);
 	Atom _NET_WM_STATE_MAXIMIZED_HORZ = XInternAtom(mDisplayX, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
@@ -799,6 +2084,9 @@ void glDisplay::SetMaximized( bool maximized )
 // IsFullscreen
 bool glDisplay::IsFullscreen()
 {
+	if( mHeadless )
+		return false;
+
 	Atom _NET_WM_STATE = XInternAtom(mDisplayX, "_NET_WM_STATE", False);
 	Atom _NET_WM_STATE_FULLSCREEN = XInternAtom(mDisplayX, "_NET_WM_STATE_FULLSCREEN", False);
 
@@ -836,6 +2124,9 @@ bool glDisplay::IsFullscreen()
 // SetFullscreen
 void glDisplay::SetFullscreen( bool fullscreen )
 {
+	if( mHeadless )
+		return;
+
 	Atom _NET_WM_STATE = XInternAtom(mDisplayX, "_NET_WM_STATE", False);
 	Atom _NET_WM_STATE_FULLSCREEN = XInternAtom(mDisplayX, "_NET_WM_STATE_FULLSCREEN", False);
 
@@ -873,6 +2164,18 @@ void glDisplay::SetSize( uint32_t width, uint32_t height )
 	if( height > mScreenHeight )
 		height = mScreenHeight;
 
+	// headless displays reallocate the framebuffer in the next BeginRender()
+	if( mHeadless )
+	{
+		LogVerbose(LOG_GL "glDisplay -- set the headless display size to %ux%u\n", width, height); 
+
+		mOptions.width = width;
+		mOptions.height = height;
+
+		ResetViewport();
+		return;
+	}
+
 	// un-maximized the window if new size not fullscreen
 	if( width != mScreenWidth || height != mScreenHeight )
 		SetMaximized(false);
@@ -904,7 +2207,7 @@ void glDisplay::SetCursor( uint32_t cursor )
 		return;
 	}
 
-	if( cursor == mActiveCursor )
+	if( cursor == mActiveCursor || mHeadless )
 		return;
 
 	//printf(LOG_GL "glDisplay -- SetCursor(%u)\n", cursor);
@@ -1111,12 +2414,35 @@ void glDisplay::ProcessEvents()
 	mMouseWheel     = 0;
 	mKeyText		= 0;*/
 
+	if( mHeadless )
+		return;
+
 	XEvent evt;
 
 	while( XEventsQueued(mDisplayX, QueuedAlready) > 0 )
 	{
 		XNextEvent(mDisplayX, &evt);
 
+		// coalesce runs of motion/resize events, since only the latest one matters
+		if( evt.type == MotionNotify || evt.type == ConfigureNotify )
+		{
+			XEvent next;
+
+			while( XEventsQueued(mDisplayX, QueuedAlready) > 0 )
+			{
+				XPeekEvent(mDisplayX, &next);
+
+				if( next.type != evt.type )
+					break;
+
+				// keep the motion events where the buttons changed (for dragging)
+				if( evt.type == MotionNotify && next.xmotion.state != evt.xmotion.state )
+					break;
+
+				XNextEvent(mDisplayX, &evt);
+			}
+		}
+
 		if( evt.type == KeyPress || evt.type == KeyRelease )
 		{
 			const int keyPressed = (evt.type == KeyPress) ? KEY_PRESSED : KEY_RELEASED;
@@ -1217,11 +2543,19 @@ void glDisplay::ProcessEvents()
 
 			dispatchEvent(MOUSE_MOVE, evt.xmotion.x, evt.xmotion.y);
 
-			// absolute coordinates
-			XWindowAttributes attr;
-			XGetWindowAttributes(mDisplayX, evt.xmotion.root, &attr);
+			// absolute coordinates (the root window's position is cached, because
+			// XGetWindowAttributes() is a round-trip to the X server)
+			if( !mRootOffsetValid )
+			{
+				XWindowAttributes attr;
+				XGetWindowAttributes(mDisplayX, evt.xmotion.root, &attr);
+
+				mRootOffset[0] = attr.x;
+				mRootOffset[1] = attr.y;
+				mRootOffsetValid = true;
+			}
 
-			dispatchEvent(MOUSE_ABSOLUTE, evt.xmotion.x_root + attr.x, evt.xmotion.y_root + attr.y);
+			dispatchEvent(MOUSE_ABSOLUTE, evt.xmotion.x_root + mRootOffset[0], evt.xmotion.y_root + mRootOffset[1]);
 
 			// handle drag events
 			if( mDragMode != DragDisabled && (evt.xmotion.state & Button1Mask) )
@@ -1317,9 +2651,93 @@ void glDisplay::RemoveEventHandler( glEventHandler callback, void* user )
 	}
 }
 
+// SetEventQueue
+void glDisplay::SetEventQueue( bool enabled )
+{
+	mEventQueueEnabled = enabled;
+}
+
+
+// PollEvent
+bool glDisplay::PollEvent( glEvent* event )
+{
+	if( !event )
+		return false;
+
+	const uint32_t head = mEventHead.load(std::memory_order_relaxed);
+
+	// the acquire pairs with the producer's release in pushEvent()
+	if( head == mEventTail.load(std::memory_order_acquire) )
+		return false;
+
+	*event = mEventQueue[head % GL_DISPLAY_EVENT_QUEUE];
+	mEventHead.store(head + 1, std::memory_order_release);
+
+	return true;
+}
+
+
+// DispatchEvents
+uint32_t glDisplay::DispatchEvents()
+{
+	uint32_t count = 0;
+	glEvent event;
+
+	while( PollEvent(&event) )
+	{
+		const uint32_t numHandlers = mEventHandlers.size();
+
+		for( uint32_t n=0; n < numHandlers; n++ )
+		{
+			// the display's own handler already ran in ProcessEvents()
+			if( mEventHandlers[n].callback == &onEvent && mEventHandlers[n].user == this )
+				continue;
+
+			mEventHandlers[n].callback(event.type, event.a, event.b, mEventHandlers[n].user);
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
+
+// pushEvent
+void glDisplay::pushEvent( uint16_t msg, int a, int b )
+{
+	const uint32_t tail = mEventTail.load(std::memory_order_relaxed);
+
+	if( tail - mEventHead.load(std::memory_order_acquire) >= GL_DISPLAY_EVENT_QUEUE )
+	{
+		if( mEventsDropped++ == 0 )
+			LogWarning(LOG_GL "glDisplay -- the event queue is full, dropping events (call PollEvent() or DispatchEvents())\n");
+
+		return;
+	}
+
+	glEvent& event = mEventQueue[tail % GL_DISPLAY_EVENT_QUEUE];
+
+	event.type = msg;
+	event.a    = a;
+	event.b    = b;
+
+	mEventTail.store(tail + 1, std::memory_order_release);
+}
+
+
 // dispatchEvent
 void glDisplay::dispatchEvent( uint16_t msg, int a, int b )
 {
+	// when queueing, only the display's own handler runs here, and
+	// the others get called later by the application's DispatchEvents()
+	if( mEventQueueEnabled )
+	{
+		onEvent(msg, a, b, this);
+		pushEvent(msg, a, b);
+		return;
+	}
+
 	const uint32_t numHandlers = mEventHandlers.size();
 
 	for( uint32_t n=0; n < numHandlers; n++ )
@@ -27,13 +27,92 @@
 
 #include "glUtility.h"
 #include "glTexture.h"
+#include "glTextureTiled.h"
+#include "glShader.h"
+#include "glRenderBatch.h"
 #include "glEvents.h"
 #include "glWidget.h"
 
+#include "cudaGrid.h"
+
+#include "Thread.h"
+#include "Event.h"
+#include "Mutex.h"
+#include "RingBuffer.h"
+
+#include <EGL/egl.h>
+#include <atomic>
 #include <time.h>
 #include <vector>
 
 
+/**
+ * The number of interop textures that glDisplay cycles through for each image size and format,
+ * so that CUDA can write the next frame while OpenGL is still drawing the previous ones.
+ * @ingroup OpenGL
+ */
+#define GL_DISPLAY_INTEROP_BUFFERS 3
+
+
+/**
+ * The capacity of the glDisplay event queue (see glDisplay::SetEventQueue())
+ * @ingroup OpenGL
+ */
+#define GL_DISPLAY_EVENT_QUEUE 256
+
+
+/**
+ * The number of composited frames that glDisplay keeps for Capture()
+ * @ingroup OpenGL
+ */
+#define GL_DISPLAY_CAPTURE_BUFFERS 3
+
+
+/**
+ * The number of frames that the GPU timer queries stay in flight for before their
+ * results are read back, so that reading them never stalls the pipeline (see glDisplay::SetTiming())
+ * @ingroup OpenGL
+ */
+#define GL_DISPLAY_TIMING_FRAMES 3
+
+
+/**
+ * The maximum number of GPU timer queries per frame (any further uploads/draws go unmeasured)
+ * @ingroup OpenGL
+ */
+#define GL_DISPLAY_TIMING_QUERIES 32
+
+
+/**
+ * The number of frames that are graphed by the timing overlay (see glDisplay::SetTimingOverlay())
+ * @ingroup OpenGL
+ */
+#define GL_DISPLAY_TIMING_HISTORY 120
+
+
+/**
+ * Per-frame timing statistics of glDisplay, with all of the times in milliseconds.
+ *
+ * The GPU times come from GL timer queries, which are read back GL_DISPLAY_TIMING_FRAMES
+ * later so they don't stall the pipeline - hence they lag the CPU times by a couple frames.
+ *
+ * @see glDisplay::SetTiming()
+ * @ingroup OpenGL
+ */
+struct glDisplayTiming
+{
+	float    upload;		/**< GPU time spent copying the images from CUDA into their textures */
+	float    uploadCPU;	/**< CPU time spent mapping, copying and unmapping the images */
+	float    draw;		/**< GPU time spent drawing the textures, lines and rects */
+	float    gpu;		/**< GPU time between BeginRender() and EndRender() */
+	float    swap;		/**< CPU time blocked in the buffer swap (i.e. waiting for vsync) */
+	float    frame;		/**< time between the last two frames that were presented */
+	uint32_t missed;		/**< number of vsyncs that the last frame missed */
+	uint64_t missedTotal;	/**< total number of missed vsyncs since timing was enabled */
+	uint64_t frames;		/**< number of frames measured since timing was enabled */
+};
+
+
 /**
  * OpenGL display window and image/video renderer with CUDA interoperability.
  *
@@ -41,6 +120,13 @@
  * be used through that as opposed to directly.  videoOutput implements
  * additional command-line parsing of videoOptions to construct instances.
  *
+ * With the `display://headless` resource, glDisplay runs without an X11 window.
+ * It creates an EGL context and renders into an offscreen framebuffer, which
+ * CUDA reads at the end of each frame into an RGBA8 image (see GetFramebuffer()).
+ * That composited image, with its overlays and widgets, is passed on to the
+ * sub-streams added with AddOutput() (for example a gstEncoder), so the frames
+ * never have to be read back to the CPU.
+ *
  * @see videoOutput
  * @ingroup OpenGL
  */
@@ -102,6 +188,123 @@ public:
 	 */
 	inline uint32_t GetID() const				{ return mID; }
 
+	/**
+	 * Enable or disable the dedicated render thread.
+	 *
+	 * When enabled, the render thread owns the OpenGL context, processes the window events,
+	 * and presents the frames submitted through Render(image, width, height, format).
+	 * That Render() call only copies the image into a mailbox and returns, and the render
+	 * thread always draws the latest submitted frame (older unrendered frames get dropped),
+	 * so the caller isn't throttled to the display rate by vsync.
+	 *
+	 * While it's enabled, the other rendering functions (BeginRender(), RenderImage(),
+	 * RenderOnce(), widgets, ect.) must not be called from other threads.
+	 *
+	 * @returns true on success, or false if the thread couldn't be started.
+	 */
+	bool SetRenderThread( bool enabled );
+
+	/**
+	 * Returns true if the dedicated render thread is enabled.
+	 * @see SetRenderThread()
+	 */
+	inline bool IsRenderThreaded() const		{ return mRenderThread != NULL; }
+
+	/**
+	 * Returns true if the display is running offscreen with EGL (without an X11 window).
+	 */
+	inline bool IsHeadless() const			{ return mHeadless; }
+
+	/**
+	 * Retrieve the CUDA device pointer to the last frame that was composited in headless mode.
+	 * The image is IMAGE_RGBA8 with the size of the display, and is overwritten by EndRender().
+	 * @returns the framebuffer image, or NULL if the display isn't headless.
+	 */
+	inline uchar4* GetFramebuffer() const		{ return mFramebufferCUDA; }
+
+	/**
+	 * Enable or disable capturing of the composited frames (see Capture())
+	 */
+	void SetCapture( bool enabled );
+
+	/**
+	 * Returns true if the composited frames are being captured (see SetCapture())
+	 */
+	inline bool IsCapturing() const			{ return mCaptureEnabled; }
+
+	/**
+	 * Wait for the next composited frame, including any overlays, text and widgets.
+	 *
+	 * While capturing is enabled, EndRender() flips the backbuffer into a framebuffer
+	 * that's registered with CUDA (by a blit on the GPU) just before presenting it,
+	 * and that gets copied to CUDA memory without the frame ever going through the CPU.
+	 * Capture() then returns the latest of those frames, in the requested format.
+	 * Capture() is typically called from a different thread than the one rendering.
+	 *
+	 * The first call to Capture() enables capturing if it wasn't already enabled.
+	 * glDisplayCapture wraps this as a videoSource (with `display://` resources).
+	 *
+	 * @param image output pointer that gets set to the captured image
+	 *              (in CUDA device memory, valid until the next call to Capture())
+	 * @param format the format to capture in (rgb8, rgba8, rgb32f, rgba32f, ect.)
+	 * @param timeout the time in milliseconds to wait for the next frame
+	 * @returns true if a frame was captured, or false on timeout or error
+	 */
+	bool Capture( void** image, imageFormat format, uint64_t timeout=1000 );
+
+	/**
+	 * Retrieve the width of the last captured frame.
+	 */
+	inline uint32_t GetCaptureWidth() const		{ return mCaptureSize[0]; }
+
+	/**
+	 * Retrieve the height of the last captured frame.
+	 */
+	inline uint32_t GetCaptureHeight() const		{ return mCaptureSize[1]; }
+
+	/**
+	 * Enable or disable the per-frame timing statistics (see GetTiming())
+	 *
+	 * While enabled, GL timer queries are placed around the texture uploads and draws,
+	 * and the CPU time spent in the buffer swap is measured.  A frame counts as having
+	 * missed vsync when it took longer than 1.5x the refresh period (see SetRefreshRate()).
+	 */
+	void SetTiming( bool enabled );
+
+	/**
+	 * Returns true if the per-frame timing statistics are enabled (see SetTiming())
+	 */
+	inline bool IsTiming() const				{ return mTimingEnabled; }
+
+	/**
+	 * Retrieve the timing statistics of the last frame (see SetTiming())
+	 */
+	inline const glDisplayTiming& GetTiming() const	{ return mTiming; }
+
+	/**
+	 * Enable or disable the on-screen timing overlay, which graphs the frame times
+	 * (green, or red when vsync was missed) over the GPU times (blue) of the last
+	 * GL_DISPLAY_TIMING_HISTORY frames in the bottom-left corner, with the refresh
+	 * period marked by a white line.  Enabling the overlay also enables SetTiming().
+	 */
+	void SetTimingOverlay( bool enabled );
+
+	/**
+	 * Returns true if the timing overlay is shown (see SetTimingOverlay())
+	 */
+	inline bool IsTimingOverlay() const		{ return mTimingOverlay; }
+
+	/**
+	 * Set the refresh rate of the monitor (in Hz) that missed vsyncs are counted against.
+	 * The default is 60Hz.
+	 */
+	void SetRefreshRate( float hz );
+
+	/**
+	 * Get the refresh rate of the monitor (in Hz) that missed vsyncs are counted against.
+	 */
+	inline float GetRefreshRate() const		{ return mRefreshRate; }
+
 	/**
 	 * Return the interface type (glDisplay::Type)
 	 */
@@ -144,6 +347,15 @@ public:
 	 */
 	void Render( glTexture* texture, float x=5.0f, float y=30.0f );
 
+	/**
+	 * Render a region of a tiled texture (for panning and zooming around images that are
+	 * bigger than a single texture can be, like panoramas).  Only the visible tiles get uploaded.
+	 * @param view the region of the image to show as `(left, top, right, bottom)` in image pixels
+	 * @param rect the screen rectangle to draw into as `(left, top, right, bottom)`
+	 * @see glTextureTiled::Render()
+	 */
+	void Render( glTextureTiled* texture, const float4& view, const float4& rect, cudaStream_t stream=NULL );
+
 	/**
 	 * Render a CUDA float4 image using OpenGL interop
 	 * If normalize is true, the image's pixel values will be rescaled from the range of [0-255] to [0-1]
@@ -170,9 +382,32 @@ public:
 	 * Render a CUDA image (uchar3, uchar4, float3, float4) using OpenGL interop.
 	 * If normalize is true, the image's pixel values will be rescaled from the range of [0-255] to [0-1]
 	 * If normalize is false, the image's pixel values are assumed to already be in the range of [0-1]
-	 * Note that if normalization is selected to be performed, it will be done in-place on the image
+	 * The normalization is done as the image is copied into the interop texture, so the image itself isn't modified.
+	 *
+	 * YUV images (I420, YV12, NV12, YUYV, YVYU, UYVY) can also be rendered, in which case
+	 * they are uploaded as-is and converted to RGB by a GLSL shader while the texture is drawn.
+	 *
+	 * The copy into the interop texture is queued on the CUDA stream, and each image size/format
+	 * cycles through GL_DISPLAY_INTEROP_BUFFERS textures that are fenced after they're drawn,
+	 * so the CPU only waits if OpenGL falls that many frames behind.
 	 */
-	void RenderImage( void* image, uint32_t width, uint32_t height, imageFormat format, float x=0.0f, float y=30.0f, bool normalize=true );
+	void RenderImage( void* image, uint32_t width, uint32_t height, imageFormat format, float x=0.0f, float y=30.0f, bool normalize=true, cudaStream_t stream=NULL );
+
+	/**
+	 * Render multiple CUDA images tiled in a grid that covers the current viewport.
+	 *
+	 * The images are scaled into their cells by cudaGrid() in one kernel that writes
+	 * straight into a single interop texture, which is then drawn once.  This is much
+	 * cheaper than a RenderImage() and SetViewport() for each image (for example when
+	 * monitoring several cameras).  The images can have different sizes, but they all
+	 * need to have the same format (rgb8, rgba8, rgb32f, or rgba32f).
+	 *
+	 * @param tiles the images to render (up to CUDA_GRID_MAX_TILES)
+	 * @param numTiles the number of images
+	 * @param columns the number of columns in the grid (or 0 to pick it automatically)
+	 * @param normalize if true, float images are rescaled from [0-255] to [0-1]
+	 */
+	void RenderGrid( const cudaGridTile* tiles, uint32_t numTiles, imageFormat format, uint32_t columns=0, bool normalize=true, cudaStream_t stream=NULL );
 
 	/**
 	 * Begin the frame, render one CUDA image using OpenGL interop, and end the frame.
@@ -202,6 +437,11 @@ public:
 
 	/**
 	 * Render a line in screen coordinates with the specified color
+	 *
+	 * The lines and rects are batched together and drawn with one instanced
+	 * draw call, which happens before the next image is rendered and at the end
+	 * of the frame (or when the viewport changes).  This keeps the drawing order.
+	 *
 	 * @note the RGBA color values are expected to be in the range of [0-1]
 	 */
 	void RenderLine( float x1, float y1, float x2, float y2, float r, float g, float b, float a=1.0f, float thickness=2.0f );
@@ -344,6 +584,9 @@ public:
 	 * is not typically necessary to explicitly call it unless you passed `false`
 	 * to BeginFrame() and wish to process events at another time of your choosing.
 	 *
+	 * Consecutive mouse motion and window resize events are coalesced, so only
+	 * the latest one gets dispatched (the drag deltas are accumulated).
+	 *
 	 * @see glEventType
 	 * @see glEventHandler 
 	 */
@@ -366,6 +609,39 @@ public:
 	 */
 	void RemoveEventHandler( glEventHandler callback, void* user=NULL );
 
+	/**
+	 * Enable or disable queueing of the events for the application to poll.
+	 *
+	 * When enabled, ProcessEvents() only updates the display's own state (input
+	 * states, widgets, ect.) and pushes the events into a lock-free queue, instead
+	 * of calling the registered event handlers.  The application then retrieves
+	 * them with PollEvent(), or calls DispatchEvents() to run the handlers from its
+	 * own thread.  This is intended for the render thread (see SetRenderThread()),
+	 * so that it never waits on the application's handlers.
+	 *
+	 * The queue holds GL_DISPLAY_EVENT_QUEUE events, and new events are dropped if it's full.
+	 * It supports one thread calling ProcessEvents() and one thread polling.
+	 */
+	void SetEventQueue( bool enabled );
+
+	/**
+	 * Returns true if the events are being queued (see SetEventQueue())
+	 */
+	inline bool IsEventQueued() const			{ return mEventQueueEnabled; }
+
+	/**
+	 * Pop the next event from the queue (see SetEventQueue())
+	 * @returns true if an event was retrieved, or false if the queue is empty.
+	 */
+	bool PollEvent( glEvent* event );
+
+	/**
+	 * Pop all of the queued events and call the registered event handlers with them,
+	 * from the calling thread (see SetEventQueue())
+	 * @returns the number of events that were dispatched
+	 */
+	uint32_t DispatchEvents();
+
 	///@}
 
 	//////////////////////////////////////////////////////////////////////////////////
@@ -590,12 +866,41 @@ protected:
 		
 	bool initWindow();
 	bool initGL();
+	bool initHeadless();
+
+	bool makeCurrent();
+	void releaseCurrent();
+
+	bool allocFramebuffer( uint32_t width, uint32_t height );
+	void freeFramebuffer();
+	bool readFramebuffer( void* output );
+	bool captureFrame();
+
+	glTexture* allocTexture( uint32_t width, uint32_t height, imageFormat format, GLsync** fence=NULL );	
+	glShader*  allocShaderYUV();
+
+	glRenderBatch* allocBatch();
+	void flushBatch();
 
-	glTexture* allocTexture( uint32_t width, uint32_t height, imageFormat format );	
+	bool allocTimers();
+	void freeTimers();
+	bool beginTimer( uint32_t category );
+	void endTimer();
+	void readTimers( uint32_t frame );
+	void beginFrameTiming();
+	void endFrameTiming( float swapTime, float frameTime );
+	void renderTiming();
+
+	bool renderFrame( void* image, uint32_t width, uint32_t height, imageFormat format );
+	bool submitFrame( void* image, uint32_t width, uint32_t height, imageFormat format );
+	void renderLoop();
+
+	static void* renderThread( void* user );
 
 	void activateViewport();
 
 	void dispatchEvent( uint16_t msg, int a, int b );
+	void pushEvent( uint16_t msg, int a, int b );
 	static bool onEvent( uint16_t msg, int a, int b, void* user );
 
 	struct eventHandler
@@ -604,6 +909,42 @@ protected:
 		void* user;
 	};
 
+	struct mailboxFrame
+	{
+		void*       image;
+		size_t      size;
+		uint32_t    width;
+		uint32_t    height;
+		imageFormat format;
+	};
+
+	enum timerCategory
+	{
+		TIMER_UPLOAD = 0,
+		TIMER_DRAW
+	};
+
+	struct timerFrame
+	{
+		GLuint   queries[GL_DISPLAY_TIMING_QUERIES];
+		uint8_t  categories[GL_DISPLAY_TIMING_QUERIES];
+		GLuint   begin;
+		GLuint   end;
+		uint32_t count;
+		bool     started;
+		bool     pending;
+	};
+
+	struct textureRing
+	{
+		uint32_t   width;
+		uint32_t   height;
+		uint32_t   format;
+		uint32_t   next;
+		glTexture* textures[GL_DISPLAY_INTEROP_BUFFERS];
+		GLsync     fences[GL_DISPLAY_INTEROP_BUFFERS];
+	};
+
 	static const int screenIdx = 0;
 		
 	Display*     mDisplayX;
@@ -635,13 +976,69 @@ protected:
 	bool	    mMouseButtons[16];
 	bool     mKeyStates[1024];
 
-	float*   mNormalizedCUDA;
-	uint32_t mNormalizedWidth;
-	uint32_t mNormalizedHeight;
+	glShader* mShaderYUV;
+
+	glRenderBatch* mBatch;
+	bool           mBatchFailed;
+
+	bool       mHeadless;
+	EGLDisplay mDisplayEGL;
+	EGLSurface mSurfaceEGL;
+	EGLContext mContextEGL;
+
+	uint32_t mFramebufferGL;
+	uint32_t mFramebufferTex;
+	uint32_t mFramebufferSize[2];
+	uchar4*  mFramebufferCUDA;
+
+	cudaGraphicsResource* mFramebufferInterop;
+
+	bool       mCaptureEnabled;
+	uint32_t   mCaptureSize[2];
+	RingBuffer mCaptureRing;
+	RingBuffer mCaptureOutput;
+	Mutex      mCaptureMutex;
+	Event      mCaptureEvent;
+
+	bool            mTimingEnabled;
+	bool            mTimingOverlay;
+	bool            mTimersAllocated;
+	bool            mTimersFailed;
+	int             mTimerActive;
+	uint32_t        mTimerFrame;
+	float           mRefreshRate;
+	float           mUploadTime;
+	timerFrame      mTimers[GL_DISPLAY_TIMING_FRAMES];
+	glDisplayTiming mTiming;
+	float           mTimingHistory[GL_DISPLAY_TIMING_HISTORY][2];	// frame time, gpu time
+	uint32_t        mTimingHistoryNext;
 
 	std::vector<glWidget*> mWidgets;
 	std::vector<glTexture*> mTextures;
+	std::vector<textureRing> mTextureRings;
+
+	Thread*      mRenderThread;
+	Mutex        mRenderMutex;
+	Event        mRenderEvent;
+	volatile bool mRenderStop;
+
+	mailboxFrame mMailbox[3];	// latest-wins triple buffer (write, pending, read)
+	uint32_t     mMailboxWrite;
+	uint32_t     mMailboxPending;
+	uint32_t     mMailboxRead;
+	bool         mMailboxNewFrame;
 	std::vector<eventHandler> mEventHandlers;
+
+	glEvent mEventQueue[GL_DISPLAY_EVENT_QUEUE];
+
+	std::atomic<uint32_t> mEventHead;	// only modified by the consumer
+	std::atomic<uint32_t> mEventTail;	// only modified by the producer
+
+	bool     mEventQueueEnabled;
+	uint32_t mEventsDropped;
+
+	int  mRootOffset[2];
+	bool mRootOffsetValid;
 };
 
 /**
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "glDisplayCapture.h"
+#include "glDisplay.h"
+
+#include "timespec.h"
+#include "logging.h"
+
+#include <stdlib.h>
+
+
+// constructor
+glDisplayCapture::glDisplayCapture( glDisplay* display, const videoOptions& options ) : videoSource(options)
+{
+	mDisplay   = display;
+	mRawFormat = IMAGE_RGBA8;
+
+	mOptions.width      = display->GetWidth();
+	mOptions.height     = display->GetHeight();
+	mOptions.deviceType = videoOptions::DEVICE_DISPLAY;
+	mOptions.codec      = videoOptions::CODEC_RAW;
+}
+
+
+// destructor
+glDisplayCapture::~glDisplayCapture()
+{
+	Close();
+}
+
+
+// Create
+glDisplayCapture* glDisplayCapture::Create( const videoOptions& options )
+{
+	const uint32_t id = atoi(options.resource.location.c_str());
+	glDisplay* display = glGetDisplay(id);
+
+	if( !display )
+	{
+		LogError(LOG_GL "glDisplayCapture -- display %u doesn't exist (it needs to be created first)\n", id);
+		return NULL;
+	}
+
+	return Create(display, options);
+}
+
+
+// Create
+glDisplayCapture* glDisplayCapture::Create( glDisplay* display, const videoOptions& options )
+{
+	if( !display )
+		return NULL;
+
+	return new glDisplayCapture(display, options);
+}
+
+
+// Open
+bool glDisplayCapture::Open()
+{
+	if( mStreaming )
+		return true;
+
+	mDisplay->SetCapture(true);
+	mStreaming = true;
+
+	return true;
+}
+
+
+// Close
+void glDisplayCapture::Close()
+{
+	if( !mStreaming )
+		return;
+
+	mDisplay->SetCapture(false);
+	mStreaming = false;
+}
+
+
+// Capture
+bool glDisplayCapture::Capture( void** image, imageFormat format, uint64_t timeout )
+{
+	if( !image )
+		return false;
+
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	if( !mDisplay->Capture(image, format, timeout) )
+		return false;
+
+	const timespec time = timestamp();
+
+	mOptions.width  = mDisplay->GetCaptureWidth();
+	mOptions.height = mDisplay->GetCaptureHeight();
+	mLastTimestamp  = (uint64_t)time.tv_sec * uint64_t(1000000000) + (uint64_t)time.tv_nsec;
+
+	return true;
+}
+
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GL_DISPLAY_CAPTURE_H__
+#define __GL_DISPLAY_CAPTURE_H__
+
+
+#include "videoSource.h"
+
+
+// forward declarations
+class glDisplay;
+
+
+/**
+ * Video source that captures the composited frames of a glDisplay,
+ * including the overlays, text and widgets that were rendered on top.
+ *
+ * The frames stay in CUDA memory the whole time (see glDisplay::Capture()),
+ * so this can feed a videoOutput like gstEncoder to record the display.
+ * It's created by videoSource::Create() for `display://N` resources,
+ * where N is the ID of a glDisplay that already exists in the process.
+ *
+ * @note glDisplayCapture implements the videoSource interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see glDisplay::Capture()
+ * @see videoSource
+ * @ingroup OpenGL
+ */
+class glDisplayCapture : public videoSource
+{
+public:
+	/**
+	 * Create a glDisplayCapture instance from the provided video options.
+	 * The resource location is the ID of the display (see glGetDisplay())
+	 */
+	static glDisplayCapture* Create( const videoOptions& options );
+
+	/**
+	 * Create a glDisplayCapture instance for the display.
+	 */
+	static glDisplayCapture* Create( glDisplay* display, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~glDisplayCapture();
+
+	/**
+	 * Capture the next composited frame.
+	 * @see videoSource::Capture()
+	 */
+	template<typename T> bool Capture( T** image, uint64_t timeout=DEFAULT_TIMEOUT )		{ return Capture((void**)image, imageFormatFromType<T>(), timeout); }
+	
+	/**
+	 * Capture the next composited frame.
+	 * @see videoSource::Capture()
+	 */
+	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT );
+
+	/**
+	 * Start capturing the display.
+	 * @see videoSource::Open()
+	 */
+	virtual bool Open();
+
+	/**
+	 * Stop capturing the display.
+	 * @see videoSource::Close()
+	 */
+	virtual void Close();
+
+	/**
+	 * Retrieve the display that's being captured.
+	 */
+	inline glDisplay* GetDisplay() const		{ return mDisplay; }
+
+	/**
+	 * Return the interface type (glDisplayCapture::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of glDisplayCapture class.
+	 */
+	static const uint32_t Type = (1 << 8);
+
+protected:
+	glDisplayCapture( glDisplay* display, const videoOptions& options );
+
+	glDisplay* mDisplay;
+};
+
+#endif
+
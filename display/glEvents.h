@@ -274,6 +274,18 @@ enum glEventType
 };
 
 
+/**
+ * An event message that was queued by glDisplay (see glDisplay::PollEvent())
+ * @ingroup OpenGL
+ */
+struct glEvent
+{
+	uint16_t type;	/**< The event type (see glEventType) */
+	int      a;	/**< The first message value */
+	int      b;	/**< The second message value */
+};
+
+
 /**
  * Event message handler callback for recieving UI messages from a window.
  *
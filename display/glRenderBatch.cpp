@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "glUtility.h"
+#include "glRenderBatch.h"
+
+
+// expands each instance of the unit quad into a rect or a line with thickness
+static const char* batchVertexShader = 
+	"#version 120\n"
+	"attribute vec2  corner;\n"
+	"attribute vec4  coords;\n"
+	"attribute vec4  color;\n"
+	"attribute float thickness;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 pos;\n"
+	"	if( thickness <= 0.0 )\n"
+	"		pos = mix(coords.xy, coords.zw, corner);\n"
+	"	else\n"
+	"	{\n"
+	"		vec2 dir = coords.zw - coords.xy;\n"
+	"		float len = length(dir);\n"
+	"		vec2 normal = (len > 0.0) ? vec2(-dir.y, dir.x) / len : vec2(0.0, 1.0);\n"
+	"		pos = mix(coords.xy, coords.zw, corner.x) + normal * (corner.y - 0.5) * thickness;\n"
+	"	}\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * vec4(pos, 0.0, 1.0);\n"
+	"	gl_FrontColor = color;\n"
+	"}\n";
+
+static const char* batchFragmentShader = 
+	"#version 120\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = gl_Color;\n"
+	"}\n";
+
+
+// constructor
+glRenderBatch::glRenderBatch()
+{
+	mShader       = NULL;
+	mCornerVBO    = 0;
+	mInstanceVBO  = 0;
+	mInstanceSize = 0;
+
+	mCornerAttrib    = -1;
+	mCoordsAttrib    = -1;
+	mColorAttrib     = -1;
+	mThicknessAttrib = -1;
+}
+
+
+// destructor
+glRenderBatch::~glRenderBatch()
+{
+	if( mCornerVBO != 0 )
+	{
+		GL(glDeleteBuffers(1, &mCornerVBO));
+		mCornerVBO = 0;
+	}
+
+	if( mInstanceVBO != 0 )
+	{
+		GL(glDeleteBuffers(1, &mInstanceVBO));
+		mInstanceVBO = 0;
+	}
+
+	if( mShader != NULL )
+	{
+		delete mShader;
+		mShader = NULL;
+	}
+}
+
+
+// Create
+glRenderBatch* glRenderBatch::Create()
+{
+	glRenderBatch* batch = new glRenderBatch();
+
+	if( !batch->init() )
+	{
+		LogError(LOG_GL "failed to create batch renderer\n");
+		delete batch;
+		return NULL;
+	}
+
+	return batch;
+}
+
+
+// init
+bool glRenderBatch::init()
+{
+	mShader = glShader::Create(batchVertexShader, batchFragmentShader);
+
+	if( !mShader )
+		return false;
+
+	mCornerAttrib    = mShader->GetAttribute("corner");
+	mCoordsAttrib    = mShader->GetAttribute("coords");
+	mColorAttrib     = mShader->GetAttribute("color");
+	mThicknessAttrib = mShader->GetAttribute("thickness");
+
+	if( mCornerAttrib < 0 || mCoordsAttrib < 0 || mColorAttrib < 0 || mThicknessAttrib < 0 )
+	{
+		LogError(LOG_GL "glRenderBatch -- failed to find the shader attributes\n");
+		return false;
+	}
+
+	// the unit quad that gets instanced (as a triangle strip)
+	const float corners[] = { 0.0f, 0.0f,  1.0f, 0.0f,  0.0f, 1.0f,  1.0f, 1.0f };
+
+	GL_VERIFY(glGenBuffers(1, &mCornerVBO));
+	GL_VERIFY(glBindBuffer(GL_ARRAY_BUFFER, mCornerVBO));
+	GL_VERIFY(glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW));
+
+	GL_VERIFY(glGenBuffers(1, &mInstanceVBO));
+	GL_VERIFY(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+	return true;
+}
+
+
+// AddLine
+void glRenderBatch::AddLine( float x1, float y1, float x2, float y2, float r, float g, float b, float a, float thickness )
+{
+	const Instance instance = { {x1, y1, x2, y2}, {r, g, b, a}, thickness };
+	mInstances.push_back(instance);
+}
+
+
+// AddRect
+void glRenderBatch::AddRect( float x, float y, float width, float height, float r, float g, float b, float a )
+{
+	const Instance instance = { {x, y, x + width, y + height}, {r, g, b, a}, 0.0f };
+	mInstances.push_back(instance);
+}
+
+
+// AddOutline
+void glRenderBatch::AddOutline( float x, float y, float width, float height, float r, float g, float b, float a, float thickness )
+{
+	const float right  = x + width;
+	const float bottom = y + height;
+	const float half   = thickness * 0.5f;
+
+	// the horizontal edges are extended to cover the corners (which keeps them from overlapping)
+	AddLine(x - half, y, right + half, y, r, g, b, a, thickness);
+	AddLine(x - half, bottom, right + half, bottom, r, g, b, a, thickness);
+	AddLine(x, y + half, x, bottom - half, r, g, b, a, thickness);
+	AddLine(right, y + half, right, bottom - half, r, g, b, a, thickness);
+}
+
+
+// Flush
+void glRenderBatch::Flush()
+{
+	const size_t count = mInstances.size();
+
+	if( count == 0 )
+		return;
+
+	if( !mShader->Bind() )
+	{
+		mInstances.clear();
+		return;
+	}
+
+	// upload the instances (orphaning the old buffer so this doesn't wait on the last draw)
+	const size_t size = count * sizeof(Instance);
+
+	GL(glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO));
+
+	if( size > mInstanceSize )
+	{
+		GL(glBufferData(GL_ARRAY_BUFFER, size, mInstances.data(), GL_STREAM_DRAW));
+		mInstanceSize = size;
+	}
+	else
+	{
+		GL(glBufferData(GL_ARRAY_BUFFER, mInstanceSize, NULL, GL_STREAM_DRAW));
+		GL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, mInstances.data()));
+	}
+
+	// per-instance attributes
+	GL(glEnableVertexAttribArray(mCoordsAttrib));
+	GL(glEnableVertexAttribArray(mColorAttrib));
+	GL(glEnableVertexAttribArray(mThicknessAttrib));
+
+	GL(glVertexAttribPointer(mCoordsAttrib, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, coords)));
+	GL(glVertexAttribPointer(mColorAttrib, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, color)));
+	GL(glVertexAttribPointer(mThicknessAttrib, 1, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, thickness)));
+
+	GL(glVertexAttribDivisor(mCoordsAttrib, 1));
+	GL(glVertexAttribDivisor(mColorAttrib, 1));
+	GL(glVertexAttribDivisor(mThicknessAttrib, 1));
+
+	// per-vertex quad corners
+	GL(glBindBuffer(GL_ARRAY_BUFFER, mCornerVBO));
+	GL(glEnableVertexAttribArray(mCornerAttrib));
+	GL(glVertexAttribPointer(mCornerAttrib, 2, GL_FLOAT, GL_FALSE, 0, NULL));
+
+	// draw everything
+	GL(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count));
+
+	// restore the state
+	GL(glVertexAttribDivisor(mCoordsAttrib, 0));
+	GL(glVertexAttribDivisor(mColorAttrib, 0));
+	GL(glVertexAttribDivisor(mThicknessAttrib, 0));
+
+	GL(glDisableVertexAttribArray(mCornerAttrib));
+	GL(glDisableVertexAttribArray(mCoordsAttrib));
+	GL(glDisableVertexAttribArray(mColorAttrib));
+	GL(glDisableVertexAttribArray(mThicknessAttrib));
+
+	GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+	mShader->Unbind();
+
+	mInstances.clear();
+}
+
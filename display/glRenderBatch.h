@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GL_RENDER_BATCH_H__
+#define __GL_RENDER_BATCH_H__
+
+
+#include "glShader.h"
+
+#include <vector>
+
+
+/**
+ * Batched renderer for 2D lines and rectangles.
+ *
+ * The primitives are queued on the CPU with AddLine(), AddRect() and AddOutline(),
+ * and then drawn all at once by Flush() with a single instanced draw call, where
+ * each primitive is one instance of a quad that gets expanded by the vertex shader.
+ * The primitives are drawn in the order that they were added.
+ *
+ * glDisplay uses this for RenderLine(), RenderRect() and RenderOutline() (and glWidget),
+ * and flushes it before it draws images and at the end of the frame.
+ *
+ * @note the RGBA color values are expected to be in the range of [0-1]
+ * @ingroup OpenGL
+ */
+class glRenderBatch
+{
+public:
+	/**
+	 * Create the batch renderer (requires the OpenGL context to be current).
+	 */
+	static glRenderBatch* Create();
+
+	/**
+	 * Destructor
+	 */
+	~glRenderBatch();
+
+	/**
+	 * Queue a line with the specified thickness (in pixels).
+	 */
+	void AddLine( float x1, float y1, float x2, float y2, float r, float g, float b, float a=1.0f, float thickness=2.0f );
+
+	/**
+	 * Queue a filled rectangle.
+	 */
+	void AddRect( float x, float y, float width, float height, float r, float g, float b, float a=1.0f );
+
+	/**
+	 * Queue the outline of a rectangle, with the specified line thickness (in pixels).
+	 */
+	void AddOutline( float x, float y, float width, float height, float r, float g, float b, float a=1.0f, float thickness=2.0f );
+
+	/**
+	 * Draw all of the queued primitives with the current projection, and clear the queue.
+	 */
+	void Flush();
+
+	/**
+	 * Clear the queued primitives without drawing them.
+	 */
+	inline void Clear()						{ mInstances.clear(); }
+
+	/**
+	 * Retrieve the number of queued primitives.
+	 */
+	inline uint32_t GetCount() const			{ return mInstances.size(); }
+
+private:
+	glRenderBatch();
+
+	bool init();
+
+	struct Instance
+	{
+		float coords[4];	// rect (left, top, right, bottom) or line (x1, y1, x2, y2)
+		float color[4];
+		float thickness;	// zero for filled rects
+	};
+
+	std::vector<Instance> mInstances;
+
+	glShader* mShader;
+
+	uint32_t mCornerVBO;
+	uint32_t mInstanceVBO;
+	size_t   mInstanceSize;
+
+	int mCornerAttrib;
+	int mCoordsAttrib;
+	int mColorAttrib;
+	int mThicknessAttrib;
+};
+
+#endif
+
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+ 
+#include "glUtility.h"
+#include "glShader.h"
+
+
+// compileShader
+static uint32_t compileShader( uint32_t type, const char* source )
+{
+	const uint32_t id = glCreateShader(type);
+
+	if( !id )
+	{
+		LogError(LOG_GL "failed to create shader object\n");
+		return 0;
+	}
+
+	GL(glShaderSource(id, 1, &source, NULL));
+	GL(glCompileShader(id));
+
+	GLint status = 0;
+	GL(glGetShaderiv(id, GL_COMPILE_STATUS, &status));
+
+	if( !status )
+	{
+		char log[1024];
+		GL(glGetShaderInfoLog(id, sizeof(log), NULL, log));
+
+		LogError(LOG_GL "failed to compile %s shader:\n%s\n", (type == GL_VERTEX_SHADER) ? "vertex" : "fragment", log);
+		GL(glDeleteShader(id));
+		return 0;
+	}
+
+	return id;
+}
+
+
+// constructor
+glShader::glShader()
+{
+	mID       = 0;
+	mVertex   = 0;
+	mFragment = 0;
+}
+
+
+// destructor
+glShader::~glShader()
+{
+	if( mID != 0 )
+	{
+		GL(glDeleteProgram(mID));
+		mID = 0;
+	}
+
+	if( mVertex != 0 )
+	{
+		GL(glDeleteShader(mVertex));
+		mVertex = 0;
+	}
+
+	if( mFragment != 0 )
+	{
+		GL(glDeleteShader(mFragment));
+		mFragment = 0;
+	}
+}
+
+
+// Create
+glShader* glShader::Create( const char* vertexSource, const char* fragmentSource )
+{
+	glShader* shader = new glShader();
+
+	if( !shader->init(vertexSource, fragmentSource) )
+	{
+		LogError(LOG_GL "failed to create shader program\n");
+		delete shader;
+		return NULL;
+	}
+
+	return shader;
+}
+
+
+// init
+bool glShader::init( const char* vertexSource, const char* fragmentSource )
+{
+	if( !fragmentSource )
+		return false;
+
+	if( vertexSource != NULL )
+	{
+		mVertex = compileShader(GL_VERTEX_SHADER, vertexSource);
+
+		if( !mVertex )
+			return false;
+	}
+
+	mFragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+	if( !mFragment )
+		return false;
+
+	// link the program
+	mID = glCreateProgram();
+
+	if( !mID )
+		return false;
+
+	if( mVertex != 0 )
+		GL(glAttachShader(mID, mVertex));
+
+	GL(glAttachShader(mID, mFragment));
+	GL(glLinkProgram(mID));
+
+	GLint status = 0;
+	GL(glGetProgramiv(mID, GL_LINK_STATUS, &status));
+
+	if( !status )
+	{
+		char log[1024];
+		GL(glGetProgramInfoLog(mID, sizeof(log), NULL, log));
+
+		LogError(LOG_GL "failed to link shader program:\n%s\n", log);
+		return false;
+	}
+
+	return true;
+}
+
+
+// Bind
+bool glShader::Bind()
+{
+	if( !mID )
+		return false;
+
+	GL_VERIFY(glUseProgram(mID));
+	return true;
+}
+
+
+// Unbind
+void glShader::Unbind()
+{
+	glUseProgram(0);
+}
+
+
+// GetAttribute
+int glShader::GetAttribute( const char* name ) const
+{
+	return glGetAttribLocation(mID, name);
+}
+
+
+// SetUniform
+void glShader::SetUniform( const char* name, int value )
+{
+	GL(glUniform1i(glGetUniformLocation(mID, name), value));
+}
+
+
+// SetUniform
+void glShader::SetUniform( const char* name, float value )
+{
+	GL(glUniform1f(glGetUniformLocation(mID, name), value));
+}
+
+
+// SetUniform
+void glShader::SetUniform( const char* name, float x, float y )
+{
+	GL(glUniform2f(glGetUniformLocation(mID, name), x, y));
+}
+
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+ 
+#ifndef __GL_SHADER_H__
+#define __GL_SHADER_H__
+
+
+#include "cudaUtility.h"
+
+
+/**
+ * OpenGL GLSL shader program, made of a vertex shader and a fragment shader.
+ * @ingroup OpenGL
+ */
+class glShader
+{
+public:
+	/**
+	 * Compile and link a shader program from GLSL source strings.
+	 * @param vertexSource the vertex shader source, or NULL to use the fixed-function vertex pipeline
+	 * @param fragmentSource the fragment shader source
+	 * @returns the new shader, or NULL if there was a compile or link error (which gets logged)
+	 */
+	static glShader* Create( const char* vertexSource, const char* fragmentSource );
+
+	/**
+	 * Free the shader program
+	 */
+	~glShader();
+
+	/**
+	 * Activate using the shader program
+	 */
+	bool Bind();
+
+	/**
+	 * Deactivate using the shader program
+	 */
+	void Unbind();
+
+	/**
+	 * Set an integer (or sampler) uniform variable.
+	 * @note the shader should be bound when setting uniforms.
+	 */
+	void SetUniform( const char* name, int value );
+
+	/**
+	 * Set a float uniform variable.
+	 * @note the shader should be bound when setting uniforms.
+	 */
+	void SetUniform( const char* name, float value );
+
+	/**
+	 * Set a vec2 uniform variable.
+	 * @note the shader should be bound when setting uniforms.
+	 */
+	void SetUniform( const char* name, float x, float y );
+
+	/**
+	 * Retrieve the location of a vertex attribute (or -1 if it isn't used by the shader).
+	 */
+	int GetAttribute( const char* name ) const;
+
+	/**
+	 * Retrieve the OpenGL resource handle of the shader program.
+	 */
+	inline uint32_t GetID() const		{ return mID; }
+
+private:
+	glShader();
+
+	bool init( const char* vertexSource, const char* fragmentSource );
+
+	uint32_t mID;
+	uint32_t mVertex;
+	uint32_t mFragment;
+};
+
+#endif
+
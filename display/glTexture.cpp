@@ -226,6 +226,7 @@ glTexture::glTexture()
 
 	mMapDevice = 0;
 	mMapFlags  = 0;
+	mMapStream = NULL;
 
 	mInteropPack   = NULL;
 	mInteropUnpack = NULL;
@@ -250,18 +251,21 @@ glTexture::~glTexture()
 	if( mPackDMA != 0 )
 	{
 		GL(glDeleteBuffers(1, &mPackDMA));
+		cudaMemorySubtract(CUDA_MEMORY_TEXTURE, mSize);
 		mPackDMA = 0;
 	}
 
 	if( mUnpackDMA != 0 )
 	{
 		GL(glDeleteBuffers(1, &mUnpackDMA));
+		cudaMemorySubtract(CUDA_MEMORY_TEXTURE, mSize);
 		mUnpackDMA = 0;
 	}
 
 	if( mID != 0 )
 	{
 		GL(glDeleteTextures(1, &mID));
+		cudaMemorySubtract(CUDA_MEMORY_TEXTURE, mSize);
 		mID = 0;
 	}
 }
@@ -289,6 +293,13 @@ bool glTexture::init( uint32_t width, uint32_t height, uint32_t format, void* da
 
 	if( size == 0 )
 		return NULL;
+
+	if( !cudaMemoryFits(size) )
+	{
+		LogError(LOG_GL "creating %ux%u texture (%u bytes) would exceed the memory budget\n", width, height, size);
+		cudaMemoryReport();
+		return false;
+	}
 		
 	// generate texture objects
 	uint32_t id = 0;
@@ -315,6 +326,8 @@ bool glTexture::init( uint32_t width, uint32_t height, uint32_t format, void* da
 	mFormat = format;
 	mSize   = size;
 
+	cudaMemoryAdd(CUDA_MEMORY_TEXTURE, size);
+
 	GL(glBindTexture(GL_TEXTURE_2D, 0));
 	GL(glDisable(GL_TEXTURE_2D));
 
@@ -338,6 +351,8 @@ uint32_t glTexture::allocDMA( uint32_t type )
 	GL_VERIFY(glBufferDataARB(type, mSize, NULL, GL_DYNAMIC_DRAW_ARB));
 	GL_VERIFY(glBindBufferARB(type, 0));
 
+	cudaMemoryAdd(CUDA_MEMORY_TEXTURE, mSize);
+
 	if( type == GL_PIXEL_PACK_BUFFER_ARB )
 		mPackDMA = dma;
 	else if( type == GL_PIXEL_UNPACK_BUFFER_ARB )
@@ -394,6 +409,13 @@ void glTexture::Unbind()
 
 // Render
 void glTexture::Render( const float4& rect )
+{
+	Render(rect, make_float4(0.0f, 0.0f, 1.0f, 1.0f));
+}
+
+
+// Render
+void glTexture::Render( const float4& rect, const float4& texCoords )
 {
 	if( !Bind() )
 		return;
@@ -402,16 +424,16 @@ void glTexture::Render( const float4& rect )
 
 		glColor4f(1.0f,1.0f,1.0f,1.0f);
 
-		glTexCoord2f(0.0f, 0.0f); 
+		glTexCoord2f(texCoords.x, texCoords.y); 
 		glVertex2f(rect.x, rect.y);
 
-		glTexCoord2f(1.0f, 0.0f); 
+		glTexCoord2f(texCoords.z, texCoords.y); 
 		glVertex2f(rect.z, rect.y);	
 
-		glTexCoord2f(1.0f, 1.0f); 
+		glTexCoord2f(texCoords.z, texCoords.w); 
 		glVertex2f(rect.z, rect.w);
 
-		glTexCoord2f(0.0f, 1.0f); 
+		glTexCoord2f(texCoords.x, texCoords.w); 
 		glVertex2f(rect.x, rect.w);
 
 	glEnd();
@@ -445,7 +467,7 @@ static inline uint32_t dmaTypeFromFlags( uint32_t flags )
 
 
 // Map
-void* glTexture::Map( uint32_t device, uint32_t flags )
+void* glTexture::Map( uint32_t device, uint32_t flags, cudaStream_t stream )
 {
 	if( mMapDevice != 0 )
 	{
@@ -521,7 +543,7 @@ void* glTexture::Map( uint32_t device, uint32_t flags )
 		if( mMapFlags != 0 && mMapFlags != flags )	// TODO two buffers, but one set of flags
 			CUDA(cudaGraphicsResourceSetMapFlags(interop, cudaGraphicsRegisterFlagsFromGL(flags)));
 
-		if( CUDA_FAILED(cudaGraphicsMapResources(1, &interop)) )
+		if( CUDA_FAILED(cudaGraphicsMapResources(1, &interop, stream)) )
 			return NULL;
 
 		// map CUDA device pointer
@@ -529,7 +551,7 @@ void* glTexture::Map( uint32_t device, uint32_t flags )
 
 		if( CUDA_FAILED(cudaGraphicsResourceGetMappedPointer(&dmaPtr, &mappedSize, interop)) )
 		{
-			CUDA(cudaGraphicsUnmapResources(1, &interop));
+			CUDA(cudaGraphicsUnmapResources(1, &interop, stream));
 			return NULL;
 		}
 		
@@ -539,6 +561,7 @@ void* glTexture::Map( uint32_t device, uint32_t flags )
 
 	mMapDevice = device;
 	mMapFlags  = flags;
+	mMapStream = stream;
 
 	return dmaPtr;
 }
@@ -571,7 +594,7 @@ void glTexture::Unmap()
 		if( !interop )
 			return;
 
-		CUDA(cudaGraphicsUnmapResources(1, &interop));
+		CUDA(cudaGraphicsUnmapResources(1, &interop, mMapStream));
 
 		if( mMapFlags != GL_READ_ONLY )
 		{
@@ -582,6 +605,7 @@ void glTexture::Unmap()
 	}
 
 	mMapDevice = 0;
+	mMapStream = NULL;
 	Unbind();
 }
 
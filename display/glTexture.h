@@ -89,6 +89,13 @@ public:
 	 * Render the texture to the specific screen rectangle.
 	 */
 	void Render( const float4& rect );
+
+	/**
+	 * Render a region of the texture to the specific screen rectangle.
+	 * @param texCoords the region of the texture as `(left, top, right, bottom)` in normalized
+	 *                  texture coordinates, where `(0,0,1,1)` is the whole texture.
+	 */
+	void Render( const float4& rect, const float4& texCoords );
 	
 	/**
 	 * Retrieve the OpenGL resource handle of the texture.
@@ -126,14 +133,20 @@ public:
 	 *                 - GL_WRITE_ONLY
 	 *                 - GL_WRITE_DISCARD
 	 *
+	 * @param stream the CUDA stream to map the buffer on (for GL_MAP_CUDA).
+	 *               CUDA work queued on this stream before Map() completes before the mapping,
+	 *               and work queued before Unmap() completes before OpenGL uses the texture,
+	 *               without blocking the CPU.
+	 *
 	 * @returns CPU pointer to buffer if GL_MAP_CPU was specified,
 	 *          CUDA device pointer to buffer if GL_MAP_CUDA was specified,
 	 *          or NULL if an error occurred mapping the buffer.                  
 	 */
-	void* Map( uint32_t device, uint32_t flags );
+	void* Map( uint32_t device, uint32_t flags, cudaStream_t stream=NULL );
 
 	/**
 	 * Unmap the texture from CPU/CUDA access.
+	 * If it was mapped with GL_MAP_CUDA, it gets unmapped on the same stream it was mapped on.
 	 * @note the texture will be unbound after calling Unmap()
 	 */
 	void Unmap();
@@ -218,6 +231,8 @@ private:
 	uint32_t mMapDevice;
 	uint32_t mMapFlags;
 
+	cudaStream_t mMapStream;
+
 	cudaGraphicsResource* mInteropPack;
 	cudaGraphicsResource* mInteropUnpack;
 };
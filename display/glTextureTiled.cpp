@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "glTextureTiled.h"
+#include "glUtility.h"
+
+#include "cudaResize.h"
+#include "cudaNormalize.h"
+
+
+// glFormatFromImage
+static uint32_t glFormatFromImage( imageFormat format )
+{
+	if( format == IMAGE_RGB8 )
+		return GL_RGB8;
+	else if( format == IMAGE_RGBA8 )
+		return GL_RGBA8;
+	else if( format == IMAGE_RGB32F )
+		return GL_RGB32F_ARB;
+	else if( format == IMAGE_RGBA32F )
+		return GL_RGBA32F_ARB;
+
+	return 0;
+}
+
+
+// constructor
+glTextureTiled::glTextureTiled()
+{
+	mImage       = NULL;
+	mWidth       = 0;
+	mHeight      = 0;
+	mFormat      = IMAGE_UNKNOWN;
+	mGLFormat    = 0;
+	mTileSize    = 0;
+	mMaxTiles    = 0;
+	mMaxUploads  = 0;
+	mLevels      = 0;
+	mFrameCount  = 0;
+	mUploadCount = 0;
+}
+
+
+// destructor
+glTextureTiled::~glTextureTiled()
+{
+	for( size_t n=0; n < mTiles.size(); n++ )
+		delete mTiles[n].texture;
+
+	mTiles.clear();
+}
+
+
+// Create
+glTextureTiled* glTextureTiled::Create( void* image, uint32_t width, uint32_t height, imageFormat format, uint32_t tileSize, uint32_t maxTiles )
+{
+	GLint maxTextureSize = 0;
+	GL(glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize));
+
+	if( tileSize == 0 || (maxTextureSize > 0 && tileSize > (uint32_t)maxTextureSize) )
+	{
+		LogError(LOG_GL "glTextureTiled -- invalid tile size %u (GL_MAX_TEXTURE_SIZE is %i)\n", tileSize, maxTextureSize);
+		return NULL;
+	}
+
+	if( maxTiles == 0 )
+	{
+		LogError(LOG_GL "glTextureTiled -- maxTiles must be at least 1\n");
+		return NULL;
+	}
+
+	glTextureTiled* tex = new glTextureTiled();
+
+	tex->mTileSize = tileSize;
+	tex->mMaxTiles = maxTiles;
+	tex->mTiles.reserve(maxTiles);
+
+	if( !tex->SetImage(image, width, height, format) )
+	{
+		delete tex;
+		return NULL;
+	}
+
+	LogVerbose(LOG_GL "glTextureTiled -- created %ux%u tiled texture (%s, %u levels of %ux%u tiles, caching up to %u)\n", 
+			 width, height, imageFormatToStr(format), tex->mLevels, tileSize, tileSize, maxTiles);
+
+	return tex;
+}
+
+
+// SetImage
+bool glTextureTiled::SetImage( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !image || width == 0 || height == 0 )
+	{
+		LogError(LOG_GL "glTextureTiled::SetImage() -- invalid image\n");
+		return false;
+	}
+
+	const uint32_t glFormat = glFormatFromImage(format);
+
+	if( glFormat == 0 )
+	{
+		imageFormatErrorMsg(LOG_GL, "glTextureTiled::SetImage()", format);
+		return false;
+	}
+
+	// the tile textures can be reused as long as their format is the same
+	if( glFormat != mGLFormat )
+	{
+		for( size_t n=0; n < mTiles.size(); n++ )
+			delete mTiles[n].texture;
+
+		mTiles.clear();
+	}
+
+	mImage    = image;
+	mWidth    = width;
+	mHeight   = height;
+	mFormat   = format;
+	mGLFormat = glFormat;
+
+	// the coarsest level fits in one tile
+	mLevels = 1;
+
+	while( (uint64_t(mTileSize) << (mLevels - 1)) < ((width > height) ? width : height) )
+		mLevels++;
+
+	Invalidate();
+	return true;
+}
+
+
+// Invalidate
+void glTextureTiled::Invalidate()
+{
+	for( size_t n=0; n < mTiles.size(); n++ )
+	{
+		mTiles[n].level    = UINT32_MAX;	// never matches, so the tile gets reused first
+		mTiles[n].lastUsed = 0;
+	}
+}
+
+
+// findTile
+glTextureTiled::Tile* glTextureTiled::findTile( uint32_t level, uint32_t x, uint32_t y )
+{
+	for( size_t n=0; n < mTiles.size(); n++ )
+	{
+		if( mTiles[n].level == level && mTiles[n].x == x && mTiles[n].y == y )
+			return &mTiles[n];
+	}
+
+	return NULL;
+}
+
+
+// uploadTile
+glTextureTiled::Tile* glTextureTiled::uploadTile( uint32_t level, uint32_t x, uint32_t y, cudaStream_t stream )
+{
+	Tile* tile = NULL;
+
+	if( mTiles.size() < mMaxTiles )
+	{
+		glTexture* texture = glTexture::Create(mTileSize, mTileSize, mGLFormat);
+
+		if( !texture )
+			return NULL;
+
+		Tile newTile;
+		newTile.texture = texture;
+
+		mTiles.push_back(newTile);
+		tile = &mTiles.back();
+	}
+	else
+	{
+		// evict the least-recently used tile (but not one that was drawn this frame)
+		for( size_t n=0; n < mTiles.size(); n++ )
+		{
+			if( mTiles[n].lastUsed != mFrameCount && (!tile || mTiles[n].lastUsed < tile->lastUsed) )
+				tile = &mTiles[n];
+		}
+
+		if( !tile )
+		{
+			LogWarning(LOG_GL "glTextureTiled -- more than %u tiles are visible at once (increase maxTiles)\n", mMaxTiles);
+			return NULL;
+		}
+	}
+
+	// the footprint of the tile in the image, and the part of the tile that it scales into
+	const uint32_t footprint = mTileSize << level;
+
+	const int4 inputROI = make_int4(x * footprint, y * footprint, 
+							  min((x + 1) * footprint, mWidth), 
+							  min((y + 1) * footprint, mHeight));
+
+	const int2 outputSize = make_int2(iDivUp(inputROI.z - inputROI.x, 1 << level),
+							    iDivUp(inputROI.w - inputROI.y, 1 << level));
+
+	tile->level    = UINT32_MAX;	// invalid until the upload succeeds
+	tile->x        = x;
+	tile->y        = y;
+	tile->lastUsed = mFrameCount;
+	tile->region   = make_float4(inputROI.x, inputROI.y, inputROI.z, inputROI.w);
+	tile->extent   = make_float2(float(outputSize.x) / float(mTileSize), float(outputSize.y) / float(mTileSize));
+
+	void* texMap = tile->texture->Map(GL_MAP_CUDA, GL_WRITE_DISCARD, stream);
+
+	if( !texMap )
+		return NULL;
+
+	// downscale the footprint with area-averaging (level 0 is a straight copy)
+	if( CUDA_FAILED(cudaResize(mImage, mWidth, mHeight, inputROI,
+						  texMap, mTileSize, mTileSize, make_int4(0, 0, outputSize.x, outputSize.y),
+						  mFormat, (level > 0) ? FILTER_AREA : FILTER_POINT, NULL, stream)) )
+	{
+		tile->texture->Unmap();
+		return NULL;
+	}
+
+	if( mFormat == IMAGE_RGB32F || mFormat == IMAGE_RGBA32F )
+	{
+		if( CUDA_FAILED(cudaNormalize(texMap, make_float2(0.0f, 255.0f), texMap, make_float2(0.0f, 1.0f),
+							     mTileSize, mTileSize, mFormat, stream)) )
+		{
+			tile->texture->Unmap();
+			return NULL;
+		}
+	}
+
+	tile->texture->Unmap();
+	tile->level = level;
+
+	mUploadCount++;
+	return tile;
+}
+
+
+// drawTile
+void glTextureTiled::drawTile( const Tile* tile, const float4& region, const float4& view, const float4& rect )
+{
+	// map the region from image coordinates into the tile's texture coordinates
+	const float2 texScale = make_float2(tile->extent.x / (tile->region.z - tile->region.x),
+							      tile->extent.y / (tile->region.w - tile->region.y));
+
+	const float4 texCoords = make_float4((region.x - tile->region.x) * texScale.x,
+								  (region.y - tile->region.y) * texScale.y,
+								  (region.z - tile->region.x) * texScale.x,
+								  (region.w - tile->region.y) * texScale.y);
+
+	// and from image coordinates into screen coordinates
+	const float2 screenScale = make_float2((rect.z - rect.x) / (view.z - view.x),
+								    (rect.w - rect.y) / (view.w - view.y));
+
+	const float4 screen = make_float4(rect.x + (region.x - view.x) * screenScale.x,
+							    rect.y + (region.y - view.y) * screenScale.y,
+							    rect.x + (region.z - view.x) * screenScale.x,
+							    rect.y + (region.w - view.y) * screenScale.y);
+
+	tile->texture->Render(screen, texCoords);
+}
+
+
+// Render
+bool glTextureTiled::Render( const float4& view, const float4& rect, cudaStream_t stream )
+{
+	if( !mImage || view.z <= view.x || view.w <= view.y || rect.z <= rect.x || rect.w <= rect.y )
+		return false;
+
+	mFrameCount++;
+
+	// pick the level where a texel is about the size of a screen pixel
+	const float scale = fmaxf((view.z - view.x) / (rect.z - rect.x), (view.w - view.y) / (rect.w - rect.y));
+
+	uint32_t level = 0;
+
+	while( level + 1 < mLevels && float(1 << (level + 1)) <= scale )
+		level++;
+
+	// the coarsest level is always kept, so there's something to fall back to
+	const uint32_t coarsest = mLevels - 1;
+	uint32_t uploads = 0;
+
+	Tile* top = findTile(coarsest, 0, 0);
+
+	if( !top )
+	{
+		top = uploadTile(coarsest, 0, 0, stream);
+		uploads++;
+	}
+
+	if( top != NULL )
+		top->lastUsed = mFrameCount;
+
+	// the range of tiles that the view overlaps
+	const uint32_t footprint = mTileSize << level;
+
+	const int x0 = max(int(floorf(view.x / footprint)), 0);
+	const int y0 = max(int(floorf(view.y / footprint)), 0);
+	const int x1 = min(int(ceilf(view.z / footprint)), int(iDivUp(mWidth, footprint)));
+	const int y1 = min(int(ceilf(view.w / footprint)), int(iDivUp(mHeight, footprint)));
+
+	bool complete = true;
+
+	for( int y=y0; y < y1; y++ )
+	{
+		for( int x=x0; x < x1; x++ )
+		{
+			// the part of the tile's footprint that's inside the image and the view
+			const float4 region = make_float4(fmaxf(x * footprint, view.x),
+									    fmaxf(y * footprint, view.y),
+									    fminf(fminf((x + 1) * footprint, mWidth), view.z),
+									    fminf(fminf((y + 1) * footprint, mHeight), view.w));
+
+			if( region.z <= region.x || region.w <= region.y )
+				continue;
+
+			Tile* tile = findTile(level, x, y);
+
+			if( !tile && (mMaxUploads == 0 || uploads < mMaxUploads) )
+			{
+				tile = uploadTile(level, x, y, stream);
+				uploads++;
+			}
+
+			// draw the region from a coarser level until the tile gets uploaded
+			if( !tile )
+			{
+				complete = false;
+
+				for( uint32_t n=level+1; n < mLevels && !tile; n++ )
+					tile = findTile(n, (x * footprint) / (mTileSize << n), (y * footprint) / (mTileSize << n));
+			}
+
+			if( !tile )
+				continue;
+
+			tile->lastUsed = mFrameCount;
+			drawTile(tile, region, view, rect);
+		}
+	}
+
+	return complete;
+}
+
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __GL_TEXTURE_TILED_H__
+#define __GL_TEXTURE_TILED_H__
+
+
+#include "glTexture.h"
+#include "imageFormat.h"
+
+#include <vector>
+
+
+/**
+ * Tiled (virtual) texture for viewing images that are too big for a single glTexture,
+ * like stitched panoramas and orthomosaics that exceed GL_MAX_TEXTURE_SIZE.
+ *
+ * The image stays in CUDA memory, and only the tiles that are visible get uploaded,
+ * at the mip level that matches how far the view is zoomed out.  Each tile is a
+ * `tileSize x tileSize` glTexture that's filled through CUDA interop by downscaling
+ * its footprint of the image with cudaResize() (FILTER_AREA), so the full-resolution
+ * image never has to be resident in OpenGL.  The tiles are kept in a cache with LRU
+ * eviction, so panning only uploads the tiles that scrolled into view.
+ *
+ * To keep the frame rate smooth while zooming, the number of tiles uploaded per frame
+ * can be limited with SetMaxUploads().  Tiles that don't get uploaded yet are drawn
+ * from a coarser level that's already cached (the coarsest level is one tile, which
+ * is always uploaded), and get refined over the next frames.
+ *
+ * The supported formats are rgb8, rgba8, rgb32f and rgba32f (the float formats are
+ * normalized from [0,255] to [0,1] like glDisplay::RenderImage() does by default).
+ *
+ * @ingroup OpenGL
+ */
+class glTextureTiled
+{
+public:
+	/**
+	 * Create a tiled texture for an image in CUDA memory (requires the OpenGL context to be current).
+	 *
+	 * @param image the image in CUDA memory, which needs to stay valid while the texture is used
+	 * @param tileSize the width and height of the tiles in pixels (up to GL_MAX_TEXTURE_SIZE)
+	 * @param maxTiles the number of tiles that can be cached at once
+	 */
+	static glTextureTiled* Create( void* image, uint32_t width, uint32_t height, imageFormat format,
+							 uint32_t tileSize=512, uint32_t maxTiles=64 );
+
+	/**
+	 * Destructor
+	 */
+	~glTextureTiled();
+
+	/**
+	 * Render a region of the image to a screen rectangle.
+	 *
+	 * @param view the region of the image to show as `(left, top, right, bottom)` in image pixels
+	 *             (this sets the pan and zoom, and can extend past the edges of the image)
+	 * @param rect the screen rectangle to draw into as `(left, top, right, bottom)`
+	 * @param stream the CUDA stream that the tiles get uploaded on
+	 * @returns true if every visible tile was drawn at the needed level, false if some
+	 *          were drawn from a coarser level (or failed to upload)
+	 */
+	bool Render( const float4& view, const float4& rect, cudaStream_t stream=NULL );
+
+	/**
+	 * Change the source image (for example after it was updated), which discards the cached tiles.
+	 */
+	bool SetImage( void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	/**
+	 * Discard the cached tiles, so they get uploaded again from the image (after it was modified).
+	 */
+	void Invalidate();
+
+	/**
+	 * Set the maximum number of tiles uploaded per Render() call (or 0 for no limit, the default).
+	 */
+	inline void SetMaxUploads( uint32_t maxUploads )	{ mMaxUploads = maxUploads; }
+
+	/**
+	 * Get the width of the image in pixels.
+	 */
+	inline uint32_t GetWidth() const			{ return mWidth; }
+
+	/**
+	 * Get the height of the image in pixels.
+	 */
+	inline uint32_t GetHeight() const			{ return mHeight; }
+
+	/**
+	 * Get the format of the image.
+	 */
+	inline imageFormat GetFormat() const		{ return mFormat; }
+
+	/**
+	 * Get the width and height of the tiles in pixels.
+	 */
+	inline uint32_t GetTileSize() const		{ return mTileSize; }
+
+	/**
+	 * Get the number of mip levels (the coarsest level fits in one tile).
+	 */
+	inline uint32_t GetLevels() const			{ return mLevels; }
+
+	/**
+	 * Get the number of tiles that are currently cached.
+	 */
+	inline uint32_t GetCachedTiles() const		{ return mTiles.size(); }
+
+	/**
+	 * Get the total number of tiles that have been uploaded.
+	 */
+	inline uint64_t GetUploadCount() const		{ return mUploadCount; }
+
+protected:
+	glTextureTiled();
+
+	/**
+	 * A tile of the image at one mip level.
+	 */
+	struct Tile
+	{
+		glTexture* texture;	/**< The tile's texture (tileSize x tileSize) */
+		uint32_t   level;	/**< Mip level (each level halves the resolution) */
+		uint32_t   x;		/**< Column of the tile at its level */
+		uint32_t   y;		/**< Row of the tile at its level */
+		float4     region;	/**< The part of the image that the tile covers as `(left, top, right, bottom)` */
+		float2     extent;	/**< The part of the texture that the region was scaled into (normalized) */
+		uint64_t   lastUsed;	/**< The Render() call the tile was last drawn in (for LRU eviction) */
+	};
+
+	Tile* findTile( uint32_t level, uint32_t x, uint32_t y );
+	Tile* uploadTile( uint32_t level, uint32_t x, uint32_t y, cudaStream_t stream );
+	void  drawTile( const Tile* tile, const float4& region, const float4& view, const float4& rect );
+
+	void*       mImage;
+	uint32_t    mWidth;
+	uint32_t    mHeight;
+	imageFormat mFormat;
+	uint32_t    mGLFormat;
+
+	uint32_t    mTileSize;
+	uint32_t    mMaxTiles;
+	uint32_t    mMaxUploads;
+	uint32_t    mLevels;
+
+	std::vector<Tile> mTiles;
+	uint64_t    mFrameCount;
+	uint64_t    mUploadCount;
+};
+
+
+#endif
+
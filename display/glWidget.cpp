@@ -158,17 +158,36 @@ void glWidget::Render()
 	{
 		if( mFillColor[3] > 0.0f )
 		{
-			glDrawRect(mX, mY, mWidth, mHeight,
-					 mFillColor[0], mFillColor[1],
-					 mFillColor[2], mFillColor[3]);
+			if( mDisplay != NULL )
+			{
+				mDisplay->RenderRect(mX, mY, mWidth, mHeight,
+								 mFillColor[0], mFillColor[1],
+								 mFillColor[2], mFillColor[3]);
+			}
+			else
+			{
+				glDrawRect(mX, mY, mWidth, mHeight,
+						 mFillColor[0], mFillColor[1],
+						 mFillColor[2], mFillColor[3]);
+			}
 		}
 
 		if( mLineColor[3] > 0.0f && mLineWidth > 0.0f )
 		{
-			glDrawOutline(mX, mY, mWidth, mHeight,
-					    mLineColor[0], mLineColor[1],
-					    mLineColor[2], mLineColor[3],
-					    mLineWidth);
+			if( mDisplay != NULL )
+			{
+				mDisplay->RenderOutline(mX, mY, mWidth, mHeight,
+								    mLineColor[0], mLineColor[1],
+								    mLineColor[2], mLineColor[3],
+								    mLineWidth);
+			}
+			else
+			{
+				glDrawOutline(mX, mY, mWidth, mHeight,
+						    mLineColor[0], mLineColor[1],
+						    mLineColor[2], mLineColor[3],
+						    mLineWidth);
+			}
 		}
 	}
 
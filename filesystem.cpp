@@ -27,7 +27,13 @@
 #include <sys/stat.h>
 #include <algorithm>
 #include <strings.h>
+#include <string.h>
+#include <dirent.h>
 #include <glob.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 
 #include "logging.h"
 
@@ -391,3 +397,265 @@ std::string fileChangeExtension(const std::string& filename, const std::string&
 	return fileRemoveExtension(filename).append(newExtension);
 }
 
+
+// the size of the batches of directory entries read by dirStream
+#define DIR_STREAM_BUFFER (256 * 1024)
+
+// the layout of the entries returned by getdents64()
+struct linux_dirent64
+{
+	uint64_t       d_ino;
+	int64_t        d_off;
+	unsigned short d_reclen;
+	unsigned char  d_type;
+	char           d_name[];
+};
+
+
+// expand a leading ~ to the home directory (like glob() does)
+static std::string expandHome( const std::string& path )
+{
+	if( path.size() == 0 || path[0] != '~' )
+		return path;
+
+	const char* home = getenv("HOME");
+
+	if( !home )
+		return path;
+
+	return std::string(home) + path.substr(1);
+}
+
+
+// constructor
+dirStream::dirStream()
+{
+	mFD       = -1;
+	mManifest = NULL;
+	mMask     = 0;
+	mBuffer   = NULL;
+	mBytes    = 0;
+	mOffset   = 0;
+}
+
+
+// destructor
+dirStream::~dirStream()
+{
+	Close();
+}
+
+
+// IsManifest
+bool dirStream::IsManifest( const std::string& path )
+{
+	const std::string ext = fileExtension(path);
+
+	if( strcasecmp(ext.c_str(), "txt") != 0 && strcasecmp(ext.c_str(), "lst") != 0 )
+		return false;
+
+	return fileIsType(expandHome(path), FILE_REGULAR);
+}
+
+
+// Open
+bool dirStream::Open( const std::string& path_in, uint32_t mask )
+{
+	Close();
+
+	const std::string path = expandHome(path_in);
+
+	if( path.size() == 0 )
+		return false;
+
+	mMask = mask;
+
+	// manifest files list one path per line
+	if( IsManifest(path) )
+	{
+		mManifest = fopen(path.c_str(), "r");
+
+		if( !mManifest )
+		{
+			LogError("dirStream -- failed to open manifest '%s'\n", path.c_str());
+			return false;
+		}
+
+		const std::string::size_type slashIdx = path.find_last_of("/");
+		mDir = (slashIdx != std::string::npos) ? path.substr(0, slashIdx + 1) : "";
+
+		return true;
+	}
+
+	// split off the wildcard pattern from the directory
+	if( fileIsType(path, FILE_DIR|FILE_LINK) )
+	{
+		mDir = path;
+		mPattern = "";
+	}
+	else
+	{
+		const std::string::size_type slashIdx = path.find_last_of("/");
+
+		mDir = (slashIdx != std::string::npos) ? path.substr(0, slashIdx + 1) : "./";
+		mPattern = (slashIdx != std::string::npos) ? path.substr(slashIdx + 1) : path;
+	}
+
+	mFD = open(mDir.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+
+	if( mFD < 0 )
+	{
+		LogError("dirStream -- failed to open directory '%s'\n", mDir.c_str());
+		return false;
+	}
+
+	mBuffer = (char*)malloc(DIR_STREAM_BUFFER);
+
+	if( !mBuffer )
+	{
+		LogError("dirStream -- failed to allocate %zu byte buffer\n", (size_t)DIR_STREAM_BUFFER);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+
+// Next
+bool dirStream::Next( std::string& path )
+{
+	if( mManifest != NULL )
+	{
+		char line[4096];
+
+		while( fgets(line, sizeof(line), mManifest) != NULL )
+		{
+			// strip surrounding whitespace, and skip blank lines and comments
+			size_t len = strlen(line);
+
+			while( len > 0 && isspace(line[len-1]) )
+				line[--len] = '\0';
+
+			const char* str = line;
+
+			while( isspace(*str) )
+				str++;
+
+			if( *str == '\0' || *str == '#' )
+				continue;
+
+			path = (str[0] == '/' || str[0] == '~') ? expandHome(str) : pathJoin(mDir, str);
+			return true;
+		}
+
+		return false;
+	}
+
+	if( mFD < 0 )
+		return false;
+
+	while( true )
+	{
+		// read the next batch of entries
+		if( mOffset >= mBytes )
+		{
+			const long bytes = syscall(SYS_getdents64, mFD, mBuffer, DIR_STREAM_BUFFER);
+
+			if( bytes < 0 )
+			{
+				LogError("dirStream -- failed to read directory '%s'\n", mDir.c_str());
+				return false;
+			}
+
+			if( bytes == 0 )
+				return false;
+
+			mBytes  = bytes;
+			mOffset = 0;
+		}
+
+		const linux_dirent64* entry = (const linux_dirent64*)(mBuffer + mOffset);
+		mOffset += entry->d_reclen;
+
+		const char* name = entry->d_name;
+
+		if( strcmp(name, ".") == 0 || strcmp(name, "..") == 0 )
+			continue;
+
+		if( mPattern.size() > 0 && fnmatch(mPattern.c_str(), name, 0) != 0 )
+			continue;
+
+		const std::string filename = pathJoin(mDir, name);
+
+		// the type is usually in the entry, so most files don't need to be stat'd
+		if( mMask != 0 )
+		{
+			uint32_t type = FILE_MISSING;
+
+			if( entry->d_type == DT_REG )
+				type = FILE_REGULAR;
+			else if( entry->d_type == DT_DIR )
+				type = FILE_DIR;
+			else
+				type = fileType(filename);	// links are followed
+
+			if( (type & mMask) == 0 )
+				continue;
+		}
+
+		path = filename;
+		return true;
+	}
+}
+
+
+// Rewind
+bool dirStream::Rewind()
+{
+	if( mManifest != NULL )
+	{
+		rewind(mManifest);
+		return true;
+	}
+
+	if( mFD < 0 )
+		return false;
+
+	if( lseek(mFD, 0, SEEK_SET) != 0 )
+	{
+		LogError("dirStream -- failed to rewind directory '%s'\n", mDir.c_str());
+		return false;
+	}
+
+	mBytes  = 0;
+	mOffset = 0;
+
+	return true;
+}
+
+
+// Close
+void dirStream::Close()
+{
+	if( mManifest != NULL )
+	{
+		fclose(mManifest);
+		mManifest = NULL;
+	}
+
+	if( mFD >= 0 )
+	{
+		close(mFD);
+		mFD = -1;
+	}
+
+	if( mBuffer != NULL )
+	{
+		free(mBuffer);
+		mBuffer = NULL;
+	}
+
+	mBytes  = 0;
+	mOffset = 0;
+}
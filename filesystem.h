@@ -25,6 +25,7 @@
 
 #include <string>
 #include <vector>
+#include <stdio.h>
 
 
 
@@ -206,6 +207,73 @@ std::string fileRemoveExtension( const std::string& filename );
  */
 std::string fileChangeExtension( const std::string& filename, const std::string& newExtension );
 
+/**
+ * Enumerate the files in a directory one at a time, without building or sorting the whole
+ * list up-front like listDir() does.  The directory is read in large batches directly with
+ * getdents64(), so memory use stays constant no matter how many files there are, and the
+ * first files are available immediately.  The files are returned in the order that the
+ * filesystem stores them in (i.e. they aren't sorted).
+ *
+ * The path can be a directory, a directory with a wildcard pattern for the filenames
+ * (e.g. `~/workspace/*.jpg`), or a manifest file (`.txt` or `.lst`) that lists one path
+ * per line, which are returned in the order that they're listed.  Relative paths in a
+ * manifest are relative to the directory that the manifest is in.
+ *
+ * @ingroup filesystem
+ */
+class dirStream
+{
+public:
+	/**
+	 * Constructor
+	 */
+	dirStream();
+
+	/**
+	 * Destructor
+	 */
+	~dirStream();
+
+	/**
+	 * Open a directory, wildcard pattern, or manifest file.
+	 * @param mask filter by file type (@see fileTypes).  Entries in a manifest aren't filtered.
+	 */
+	bool Open( const std::string& path, uint32_t mask=0 );
+
+	/**
+	 * Get the path of the next file, or return false if there aren't any more.
+	 */
+	bool Next( std::string& path );
+
+	/**
+	 * Start enumerating from the beginning again.
+	 */
+	bool Rewind();
+
+	/**
+	 * Close the directory or manifest.
+	 */
+	void Close();
+
+	/**
+	 * Return true if the path is a manifest file listing other files.
+	 */
+	static bool IsManifest( const std::string& path );
+
+protected:
+	int   mFD;		// the directory being read (or -1)
+	FILE* mManifest;	// the manifest being read (or NULL)
+
+	uint32_t mMask;
+
+	std::string mDir;
+	std::string mPattern;
+
+	char*  mBuffer;	// batch of entries from getdents64()
+	size_t mBytes;
+	size_t mOffset;
+};
+
 
 #endif
 
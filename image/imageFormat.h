@@ -26,12 +26,14 @@
 
 // include vector types (float4, float3, uchar4, uchar3, ect.)
 #include "cudaUtility.h"		
+#include <cuda_fp16.h>
 
 
 /**
  * The imageFormat enum is used to identify the pixel format and colorspace
  * of an image.  Supported data types are based on `uint8` and `float`, with
  * colorspaces including RGB/RGBA, BGR/BGRA, grayscale, YUV, and Bayer.
+ * For DNN tensors, there are also planar (CHW) and half-precision RGB formats.
  *
  * There are also a variety of helper functions available that provide info about
  * each format at runtime - for example, the pixel bit depth (imageFormatDepth())
@@ -79,6 +81,25 @@ enum imageFormat
 	IMAGE_GRAY8,					/**< uint8 grayscale  (`'gray8'`)   */
 	IMAGE_GRAY32F,					/**< float grayscale  (`'gray32f'`) */
 
+	// DNN tensors
+	IMAGE_RGB32F_PLANAR,			/**< float RGB32F planar CHW  (`'rgb32f-planar'`) */
+	IMAGE_RGB16F_PLANAR,			/**< half  RGB16F planar CHW  (`'rgb16f-planar'`) */
+	IMAGE_RGB16F,					/**< half  RGB16F interleaved (`'rgb16f'`) */
+	IMAGE_RGBA16F,					/**< half  RGBA16F interleaved (`'rgba16f'`) */
+
+	// 16-bit Bayer (appended so the values of the other formats don't change)
+	IMAGE_BAYER_BGGR16,				/**< 16-bit Bayer BGGR (`'bayer-bggr16'`), LSB-aligned RAW10/RAW12 ect. */
+	IMAGE_BAYER_GBRG16,				/**< 16-bit Bayer GBRG (`'bayer-gbrg16'`), LSB-aligned RAW10/RAW12 ect. */
+	IMAGE_BAYER_GRBG16,				/**< 16-bit Bayer GRBG (`'bayer-grbg16'`), LSB-aligned RAW10/RAW12 ect. */
+	IMAGE_BAYER_RGGB16,				/**< 16-bit Bayer RGGB (`'bayer-rggb16'`), LSB-aligned RAW10/RAW12 ect. */
+
+	// 10/16-bit YUV, grayscale, and RGB (appended so the values of the other formats don't change)
+	IMAGE_P010,					/**< YUV P010 4:2:0 semi-planar (`'p010'`), 10-bit MSB-aligned in 16-bit words */
+	IMAGE_P016,					/**< YUV P016 4:2:0 semi-planar (`'p016'`), 16-bit */
+	IMAGE_GRAY16,					/**< uint16 grayscale (`'gray16'`) */
+	IMAGE_RGB16,					/**< ushort3 RGB16  (`'rgb16'`), 16 bits per channel */
+	IMAGE_RGBA16,					/**< ushort4 RGBA16 (`'rgba16'`), 16 bits per channel */
+
 	// extras
 	IMAGE_COUNT,					/**< The number of image formats */
 	IMAGE_UNKNOWN=999,				/**< Unknown/undefined format */
@@ -87,8 +108,9 @@ enum imageFormat
 
 /**
  * The imageBaseType enum is used to identify the base data type of an
- * imageFormat - either uint8 or float.  For example, the IMAGE_RGB8 
- * format has a base type of uint8, while IMAGE_RGB32F is float.
+ * imageFormat - either uint8, uint16, float, or half.  For example, the IMAGE_RGB8 
+ * format has a base type of uint8, while IMAGE_RGB16 is uint16, IMAGE_RGB32F
+ * is float, and IMAGE_RGB16F is half.
  *
  * You can retrieve the base type of each format with imageFormatBaseType()
  *
@@ -97,11 +119,13 @@ enum imageFormat
 enum imageBaseType
 {
 	IMAGE_UINT8,
-	IMAGE_FLOAT
+	IMAGE_FLOAT,
+	IMAGE_HALF,
+	IMAGE_UINT16
 };
 
 /**
- * Get the base type of an image format (uint8 or float).
+ * Get the base type of an image format (uint8, uint16, float, or half).
  * @see imageBaseType
  * @ingroup imageFormat
  */
@@ -174,7 +198,8 @@ inline bool imageFormatIsBGR( imageFormat format );
  * Check if an image format is one of the YUV formats.
  *
  * @returns true if the imageFormat is a YUV format 
- *               (IMAGE_YUYV, IMAGE_YVYU, IMAGE_UYVY, IMAGE_I420, IMAGE_YV12, IMAGE_NV12)
+ *               (IMAGE_YUYV, IMAGE_YVYU, IMAGE_UYVY, IMAGE_I420, IMAGE_YV12, IMAGE_NV12,
+ *                IMAGE_P010, IMAGE_P016)
  *               otherwise, returns false.
  * @ingroup imageFormat
  */
@@ -193,12 +218,23 @@ inline bool imageFormatIsGray( imageFormat format );
  * Check if an image format is one of the Bayer formats.
  *
  * @returns true if the imageFormat is a Bayer format
- *               (IMAGE_BAYER_BGGR, IMAGE_BAYER_GBRG, IMAGE_BAYER_GRBG, IMAGE_BAYER_RGGB)
+ *               (IMAGE_BAYER_BGGR, IMAGE_BAYER_GBRG, IMAGE_BAYER_GRBG, IMAGE_BAYER_RGGB,
+ *                or one of their 16-bit versions like IMAGE_BAYER_RGGB16)
  *               otherwise, returns false.
  * @ingroup imageFormat
  */
 inline bool imageFormatIsBayer( imageFormat format );
 
+/**
+ * Check if an image format is one of the 16-bit Bayer formats.
+ *
+ * @returns true if the imageFormat is a 16-bit Bayer format
+ *               (IMAGE_BAYER_BGGR16, IMAGE_BAYER_GBRG16, IMAGE_BAYER_GRBG16, IMAGE_BAYER_RGGB16)
+ *               otherwise, returns false.
+ * @ingroup imageFormat
+ */
+inline bool imageFormatIsBayer16( imageFormat format );
+
 /**
  * Print out an error message that the image format isn't supported.
  * It assumes the supported formats are rgb8, rgba8, rgb32f, rgba32f.
@@ -217,13 +253,19 @@ inline void imageFormatErrorMsg( const char* module, const char* function, image
 
 ///@{
 
-// get the IMAGE_RGB* formats from uchar3/uchar4/float3/float4
+// half-precision vector types (defined in cudaMath.h)
+struct half3;
+struct half4;
+
+// get the IMAGE_RGB* formats from uchar3/uchar4/float3/float4/half3/half4
 template<typename T> inline imageFormat imageFormatFromType();
 
 template<> inline imageFormat imageFormatFromType<uchar3>();
 template<> inline imageFormat imageFormatFromType<uchar4>();
 template<> inline imageFormat imageFormatFromType<float3>();
 template<> inline imageFormat imageFormatFromType<float4>();
+template<> inline imageFormat imageFormatFromType<half3>();
+template<> inline imageFormat imageFormatFromType<half4>();
 
 // templated version of base type / vector type
 template<imageFormat format> struct imageFormatType;
@@ -234,6 +276,9 @@ template<> struct imageFormatType<IMAGE_RGBA8>   { typedef uint8_t Base; typedef
 template<> struct imageFormatType<IMAGE_RGB32F>  { typedef float Base; typedef float3 Vector; };
 template<> struct imageFormatType<IMAGE_RGBA32F> { typedef float Base; typedef float4 Vector; };
 
+template<> struct imageFormatType<IMAGE_RGB16F>  { typedef __half Base; typedef half3 Vector; };
+template<> struct imageFormatType<IMAGE_RGBA16F> { typedef __half Base; typedef half4 Vector; };
+
 ///@}
 
 // inline implementations
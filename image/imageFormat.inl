@@ -52,6 +52,19 @@ inline const char* imageFormatToStr( imageFormat format )
 		case IMAGE_BAYER_RGGB:	return "bayer-rggb";
 		case IMAGE_GRAY8:	 	return "gray8";
 		case IMAGE_GRAY32F:  	return "gray32f";
+		case IMAGE_RGB32F_PLANAR: return "rgb32f-planar";
+		case IMAGE_RGB16F_PLANAR: return "rgb16f-planar";
+		case IMAGE_RGB16F:		return "rgb16f";
+		case IMAGE_RGBA16F:		return "rgba16f";
+		case IMAGE_BAYER_BGGR16:	return "bayer-bggr16";
+		case IMAGE_BAYER_GBRG16:	return "bayer-gbrg16";
+		case IMAGE_BAYER_GRBG16:	return "bayer-grbg16";
+		case IMAGE_BAYER_RGGB16:	return "bayer-rggb16";
+		case IMAGE_P010:		return "p010";
+		case IMAGE_P016:		return "p016";
+		case IMAGE_GRAY16:		return "gray16";
+		case IMAGE_RGB16:		return "rgb16";
+		case IMAGE_RGBA16:		return "rgba16";
 		case IMAGE_UNKNOWN: 	return "unknown";
 	};
 	
@@ -83,6 +96,9 @@ inline bool imageFormatIsYUV( imageFormat format )
 {
 	if( format >= IMAGE_YUYV && format <= IMAGE_NV12 )
 		return true;
+
+	if( format == IMAGE_P010 || format == IMAGE_P016 )
+		return true;
 		
 	return false;
 }
@@ -90,7 +106,7 @@ inline bool imageFormatIsYUV( imageFormat format )
 // imageFormatIsGray
 inline bool imageFormatIsGray( imageFormat format )
 {
-	if( format == IMAGE_GRAY8 || format == IMAGE_GRAY32F )
+	if( format == IMAGE_GRAY8 || format == IMAGE_GRAY16 || format == IMAGE_GRAY32F )
 		return true;
 	
 	return false;
@@ -104,6 +120,15 @@ inline bool imageFormatIsBayer( imageFormat format )
 	if( format >= IMAGE_BAYER_BGGR && format <= IMAGE_BAYER_RGGB )
 		return true;
 		
+	return imageFormatIsBayer16(format);
+}
+
+// imageFormatIsBayer16
+inline bool imageFormatIsBayer16( imageFormat format )
+{
+	if( format >= IMAGE_BAYER_BGGR16 && format <= IMAGE_BAYER_RGGB16 )
+		return true;
+
 	return false;
 }
 
@@ -131,6 +156,8 @@ inline imageFormat imageFormatFromStr( const char* str )
 		return IMAGE_GRAY8;
 	else if( strcasecmp(str, "grey32f") == 0 )
 		return IMAGE_GRAY32F;
+	else if( strcasecmp(str, "grey16") == 0 )
+		return IMAGE_GRAY16;
 
 	return IMAGE_UNKNOWN;
 }
@@ -145,7 +172,16 @@ inline imageBaseType imageFormatBaseType( imageFormat format )
 		case IMAGE_RGB32F:
 		case IMAGE_BGR32F:		
 		case IMAGE_RGBA32F: 
-		case IMAGE_BGRA32F:		return IMAGE_FLOAT;
+		case IMAGE_BGRA32F:
+		case IMAGE_RGB32F_PLANAR:	return IMAGE_FLOAT;
+		case IMAGE_RGB16F_PLANAR:
+		case IMAGE_RGB16F:
+		case IMAGE_RGBA16F:		return IMAGE_HALF;
+		case IMAGE_P010:
+		case IMAGE_P016:
+		case IMAGE_GRAY16:
+		case IMAGE_RGB16:
+		case IMAGE_RGBA16:		return IMAGE_UINT16;
 	}
 
 	return IMAGE_UINT8;
@@ -177,6 +213,19 @@ inline size_t imageFormatChannels( imageFormat format )
 		case IMAGE_BAYER_GBRG:
 		case IMAGE_BAYER_GRBG:
 		case IMAGE_BAYER_RGGB:	return 1;
+		case IMAGE_RGB32F_PLANAR:
+		case IMAGE_RGB16F_PLANAR:
+		case IMAGE_RGB16F:		return 3;
+		case IMAGE_RGBA16F:		return 4;
+		case IMAGE_BAYER_BGGR16:
+		case IMAGE_BAYER_GBRG16:
+		case IMAGE_BAYER_GRBG16:
+		case IMAGE_BAYER_RGGB16:	return 1;
+		case IMAGE_P010:
+		case IMAGE_P016:		return 3;
+		case IMAGE_GRAY16:		return 1;
+		case IMAGE_RGB16:		return 3;
+		case IMAGE_RGBA16:		return 4;
 	}
 
 	return 0;
@@ -208,6 +257,19 @@ inline size_t imageFormatDepth( imageFormat format )
 		case IMAGE_BAYER_GBRG:
 		case IMAGE_BAYER_GRBG:
 		case IMAGE_BAYER_RGGB:	return sizeof(unsigned char) * 8;
+		case IMAGE_RGB32F_PLANAR: return sizeof(float) * 3 * 8;
+		case IMAGE_RGB16F_PLANAR:
+		case IMAGE_RGB16F:		return sizeof(uint16_t) * 3 * 8;
+		case IMAGE_RGBA16F:		return sizeof(uint16_t) * 4 * 8;
+		case IMAGE_BAYER_BGGR16:
+		case IMAGE_BAYER_GBRG16:
+		case IMAGE_BAYER_GRBG16:
+		case IMAGE_BAYER_RGGB16:	return sizeof(uint16_t) * 8;
+		case IMAGE_P010:
+		case IMAGE_P016:		return 24;
+		case IMAGE_GRAY16:		return sizeof(uint16_t) * 8;
+		case IMAGE_RGB16:		return sizeof(uint16_t) * 3 * 8;
+		case IMAGE_RGBA16:		return sizeof(uint16_t) * 4 * 8;
 	}
 
 	return 0;
@@ -231,7 +293,7 @@ template<typename T> struct __image_format_assert_false : std::false_type { };
 // imageFormatFromType
 template<typename T> inline imageFormat imageFormatFromType()	
 { 
-	static_assert(__image_format_assert_false<T>::value, "invalid image format type - supported types are uchar3, uchar4, float3, float4"); 
+	static_assert(__image_format_assert_false<T>::value, "invalid image format type - supported types are uchar3, uchar4, float3, float4, half3, half4"); 
 	return IMAGE_UNKNOWN;
 }
 
@@ -239,6 +301,8 @@ template<> inline imageFormat imageFormatFromType<uchar3>()	{ return IMAGE_RGB8;
 template<> inline imageFormat imageFormatFromType<uchar4>()	{ return IMAGE_RGBA8; }
 template<> inline imageFormat imageFormatFromType<float3>()	{ return IMAGE_RGB32F; }
 template<> inline imageFormat imageFormatFromType<float4>()	{ return IMAGE_RGBA32F; }
+template<> inline imageFormat imageFormatFromType<half3>()	{ return IMAGE_RGB16F; }
+template<> inline imageFormat imageFormatFromType<half4>()	{ return IMAGE_RGBA16F; }
 
 
 // imageFormatErrorMsg
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "imageIO-jpeg.h"
+#include "imageIO.h"
+
+#include "cudaColorspace.h"
+#include "cudaMemoryPool.h"
+
+#include "logging.h"
+
+
+#ifdef ENABLE_NVJPEG
+
+#include "Mutex.h"
+
+#include <nvjpeg.h>
+
+
+// NVJPEG() error-checking macro (like the CUDA() macro)
+#define NVJPEG(x)	nvjpegCheckError((x), #x, __FILE__, __LINE__)
+
+static inline bool nvjpegCheckError( nvjpegStatus_t status, const char* txt, const char* file, int line )
+{
+	if( status == NVJPEG_STATUS_SUCCESS )
+		return true;
+
+	LogError(LOG_IMAGE "nvJPEG error %i\n", (int)status);
+	LogError(LOG_IMAGE "   %s\n", txt);
+	LogError(LOG_IMAGE "   %s:%i\n", file, line);
+
+	return false;
+}
+
+
+// the nvJPEG library handle is created on first use, and the decoder
+// state can't be used concurrently so decodes are serialized
+static nvjpegHandle_t    gJpegHandle = NULL;
+static nvjpegJpegState_t gJpegState  = NULL;
+static bool              gJpegFailed = false;
+static Mutex             gJpegMutex;
+
+static nvjpegEncoderState_t  gJpegEncoder = NULL;
+static nvjpegEncoderParams_t gJpegParams  = NULL;
+
+
+// jpegInit (the caller should hold the mutex)
+static bool jpegInit()
+{
+	if( gJpegHandle != NULL )
+		return true;
+
+	if( gJpegFailed )
+		return false;
+
+	if( !NVJPEG(nvjpegCreateSimple(&gJpegHandle)) )
+	{
+		gJpegFailed = true;
+		gJpegHandle = NULL;
+		return false;
+	}
+
+	if( !NVJPEG(nvjpegJpegStateCreate(gJpegHandle, &gJpegState)) )
+	{
+		nvjpegDestroy(gJpegHandle);
+		gJpegFailed = true;
+		gJpegHandle = NULL;
+		return false;
+	}
+
+	LogVerbose(LOG_IMAGE "nvJPEG initialized for GPU-accelerated JPEG decoding/encoding\n");
+	return true;
+}
+
+
+// jpegHardwareAvailable
+bool jpegHardwareAvailable()
+{
+	gJpegMutex.Lock();
+	const bool result = jpegInit();
+	gJpegMutex.Unlock();
+
+	return result;
+}
+
+
+// jpegHardwareInfo
+bool jpegHardwareInfo( const void* data, size_t size, int* width, int* height )
+{
+	if( !data || size == 0 || !width || !height )
+		return false;
+
+	int numComponents = 0;
+	nvjpegChromaSubsampling_t subsampling;
+
+	int widths[NVJPEG_MAX_COMPONENT];
+	int heights[NVJPEG_MAX_COMPONENT];
+
+	gJpegMutex.Lock();
+
+	const bool result = jpegInit() && nvjpegGetImageInfo(gJpegHandle, (const unsigned char*)data, size, &numComponents, 
+										    &subsampling, widths, heights) == NVJPEG_STATUS_SUCCESS;
+	gJpegMutex.Unlock();
+
+	if( !result || subsampling == NVJPEG_CSS_UNKNOWN || widths[0] <= 0 || heights[0] <= 0 )
+		return false;
+
+	*width  = widths[0];
+	*height = heights[0];
+
+	return true;
+}
+
+
+// jpegHardwareDecode
+bool jpegHardwareDecode( const void* data, size_t size, void* output, int width, int height, imageFormat format )
+{
+	if( !data || size == 0 || !output || width <= 0 || height <= 0 )
+		return false;
+
+	if( !imageFormatIsRGB(format) )
+		return false;
+
+	// nvJPEG outputs interleaved rgb8, so other formats get converted from a temporary buffer
+	void* rgb = output;
+
+	if( format != IMAGE_RGB8 && !cudaMallocPooled(&rgb, imageFormatSize(IMAGE_RGB8, width, height)) )
+		return false;
+
+	nvjpegImage_t image;
+	memset(&image, 0, sizeof(nvjpegImage_t));
+
+	image.channel[0] = (unsigned char*)rgb;
+	image.pitch[0]   = width * sizeof(uchar3);
+
+	gJpegMutex.Lock();
+
+	bool result = jpegInit() && NVJPEG(nvjpegDecode(gJpegHandle, gJpegState, (const unsigned char*)data, size, 
+									    NVJPEG_OUTPUT_RGBI, &image, NULL));
+
+	gJpegMutex.Unlock();
+
+	if( result && format != IMAGE_RGB8 )
+		result = CUDA_SUCCESS(cudaConvertColor(rgb, IMAGE_RGB8, output, format, width, height));
+
+	if( result )
+		result = CUDA_SUCCESS(cudaStreamSynchronize(NULL));
+
+	if( rgb != output )
+		cudaFreePooled(rgb);
+
+	return result;
+}
+
+
+// jpegHardwareEncode
+bool jpegHardwareEncode( const void* input, int width, int height, imageFormat format, int quality, std::vector<unsigned char>& jpeg )
+{
+	if( !input || width <= 0 || height <= 0 )
+		return false;
+
+	if( format != IMAGE_RGB8 && format != IMAGE_RGBA8 )
+		return false;
+
+	// nvJPEG takes interleaved rgb8, so rgba8 gets converted into a temporary buffer
+	void* rgb = (void*)input;
+
+	if( format != IMAGE_RGB8 )
+	{
+		if( !cudaMallocPooled(&rgb, imageFormatSize(IMAGE_RGB8, width, height)) )
+			return false;
+
+		if( CUDA_FAILED(cudaConvertColor((void*)input, format, rgb, IMAGE_RGB8, width, height)) )
+		{
+			cudaFreePooled(rgb);
+			return false;
+		}
+	}
+
+	nvjpegImage_t image;
+	memset(&image, 0, sizeof(nvjpegImage_t));
+
+	image.channel[0] = (unsigned char*)rgb;
+	image.pitch[0]   = width * sizeof(uchar3);
+
+	gJpegMutex.Lock();
+
+	bool result = jpegInit();
+
+	// create the encoder on first use
+	if( result && !gJpegEncoder )
+	{
+		if( !NVJPEG(nvjpegEncoderStateCreate(gJpegHandle, &gJpegEncoder, NULL)) ||
+		    !NVJPEG(nvjpegEncoderParamsCreate(gJpegHandle, &gJpegParams, NULL)) ||
+		    !NVJPEG(nvjpegEncoderParamsSetSamplingFactors(gJpegParams, NVJPEG_CSS_420, NULL)) )
+		{
+			gJpegEncoder = NULL;
+			result = false;
+		}
+	}
+
+	size_t length = 0;
+
+	result = result && NVJPEG(nvjpegEncoderParamsSetQuality(gJpegParams, quality, NULL))
+			      && NVJPEG(nvjpegEncodeImage(gJpegHandle, gJpegEncoder, gJpegParams, &image, NVJPEG_INPUT_RGBI, width, height, NULL))
+			      && NVJPEG(nvjpegEncodeRetrieveBitstream(gJpegHandle, gJpegEncoder, NULL, &length, NULL));
+
+	if( result )
+	{
+		jpeg.resize(length);
+		result = NVJPEG(nvjpegEncodeRetrieveBitstream(gJpegHandle, gJpegEncoder, jpeg.data(), &length, NULL));
+	}
+
+	if( result )
+		result = CUDA_SUCCESS(cudaStreamSynchronize(NULL));
+
+	gJpegMutex.Unlock();
+
+	if( rgb != input )
+		cudaFreePooled(rgb);
+
+	if( !result )
+		return false;
+
+	jpeg.resize(length);
+	return true;
+}
+
+#else
+
+// jpegHardwareAvailable
+bool jpegHardwareAvailable()
+{
+	return false;
+}
+
+// jpegHardwareInfo
+bool jpegHardwareInfo( const void* data, size_t size, int* width, int* height )
+{
+	return false;
+}
+
+// jpegHardwareDecode
+bool jpegHardwareDecode( const void* data, size_t size, void* output, int width, int height, imageFormat format )
+{
+	return false;
+}
+
+// jpegHardwareEncode
+bool jpegHardwareEncode( const void* input, int width, int height, imageFormat format, int quality, std::vector<unsigned char>& jpeg )
+{
+	return false;
+}
+
+#endif
+
+
+
+// jpegScaleDenom
+int jpegScaleDenom( int width, int height, int min_width, int min_height )
+{
+	if( min_width <= 0 || min_height <= 0 )
+		return 1;
+
+	// the decoder rounds the scaled dimensions up
+	for( int denom=8; denom > 1; denom /= 2 )
+	{
+		if( (width + denom - 1) / denom >= min_width && (height + denom - 1) / denom >= min_height )
+			return denom;
+	}
+
+	return 1;
+}
+
+
+#ifdef ENABLE_LIBJPEG
+
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <stdlib.h>
+
+
+// libjpeg reports errors by calling error_exit(), which jumps back to the decoder
+struct jpegErrorManager
+{
+	struct jpeg_error_mgr pub;
+	jmp_buf jump;
+};
+
+static void jpegErrorExit( j_common_ptr cinfo )
+{
+	char msg[JMSG_LENGTH_MAX];
+	(*cinfo->err->format_message)(cinfo, msg);
+
+	LogError(LOG_IMAGE "libjpeg -- %s\n", msg);
+	longjmp(((jpegErrorManager*)cinfo->err)->jump, 1);
+}
+
+static void jpegOutputMessage( j_common_ptr cinfo )
+{
+	char msg[JMSG_LENGTH_MAX];
+	(*cinfo->err->format_message)(cinfo, msg);
+
+	LogWarning(LOG_IMAGE "libjpeg -- %s\n", msg);
+}
+
+
+// jpegScaledAvailable
+bool jpegScaledAvailable()
+{
+	return true;
+}
+
+
+// jpegDecodeScaled
+unsigned char* jpegDecodeScaled( const void* data, size_t size, int min_width, int min_height, int channels, int* width, int* height )
+{
+	if( !data || size == 0 || (channels != 3 && channels != 4) || !width || !height )
+		return NULL;
+
+	struct jpeg_decompress_struct cinfo;
+	struct jpegErrorManager jerr;
+
+	unsigned char* volatile image = NULL;
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = jpegErrorExit;
+	jerr.pub.output_message = jpegOutputMessage;
+
+	if( setjmp(jerr.jump) )
+	{
+		jpeg_destroy_decompress(&cinfo);
+		free(image);
+		return NULL;
+	}
+
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, (unsigned char*)data, size);
+	jpeg_read_header(&cinfo, TRUE);
+
+	// only decode the DCT coefficients needed for the reduced size
+	cinfo.scale_num       = 1;
+	cinfo.scale_denom     = jpegScaleDenom(cinfo.image_width, cinfo.image_height, min_width, min_height);
+	cinfo.out_color_space = JCS_RGB;
+	cinfo.dct_method      = JDCT_ISLOW;
+
+	jpeg_start_decompress(&cinfo);
+
+	const int imgWidth  = cinfo.output_width;
+	const int imgHeight = cinfo.output_height;
+	const size_t pitch  = imgWidth * channels;
+
+	image = (unsigned char*)malloc(pitch * imgHeight);
+
+	if( !image )
+	{
+		LogError(LOG_IMAGE "libjpeg -- failed to allocate %zu bytes for %ix%i image\n", pitch * imgHeight, imgWidth, imgHeight);
+		jpeg_destroy_decompress(&cinfo);
+		return NULL;
+	}
+
+	while( cinfo.output_scanline < cinfo.output_height )
+	{
+		unsigned char* row = image + cinfo.output_scanline * pitch;
+		jpeg_read_scanlines(&cinfo, &row, 1);
+
+		// expand RGB to RGBA in-place (from the end, so the pixels aren't overwritten before they're read)
+		if( channels == 4 )
+		{
+			for( int x=imgWidth-1; x >= 0; x-- )
+			{
+				row[x * 4 + 3] = 255;
+				row[x * 4 + 2] = row[x * 3 + 2];
+				row[x * 4 + 1] = row[x * 3 + 1];
+				row[x * 4 + 0] = row[x * 3 + 0];
+			}
+		}
+	}
+
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+
+	*width  = imgWidth;
+	*height = imgHeight;
+
+	return image;
+}
+
+#else
+
+// jpegScaledAvailable
+bool jpegScaledAvailable()
+{
+	return false;
+}
+
+// jpegDecodeScaled
+unsigned char* jpegDecodeScaled( const void* data, size_t size, int min_width, int min_height, int channels, int* width, int* height )
+{
+	return NULL;
+}
+
+#endif
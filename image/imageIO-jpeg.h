@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __IMAGE_IO_JPEG_H_
+#define __IMAGE_IO_JPEG_H_
+
+
+#include "imageFormat.h"
+
+#include <vector>
+
+
+/**
+ * @internal Returns true if GPU-accelerated JPEG decoding/encoding is available
+ * (i.e. jetson-utils was built with nvJPEG, see the ENABLE_NVJPEG CMake option).
+ * @ingroup image
+ */
+bool jpegHardwareAvailable();
+
+/**
+ * @internal Parse the dimensions of a compressed JPEG image in CPU memory.
+ * @returns `true` if the image can be decoded by jpegHardwareDecode(), otherwise `false`.
+ * @ingroup image
+ */
+bool jpegHardwareInfo( const void* data, size_t size, int* width, int* height );
+
+/**
+ * @internal Decode a compressed JPEG image in CPU memory with nvJPEG, directly into
+ * a CUDA buffer in the requested format (rgb8, rgba8, rgb32f, or rgba32f).
+ * The output buffer should be at least `imageFormatSize(format, width, height)` bytes,
+ * using the dimensions returned by jpegHardwareInfo().  The decode is complete when
+ * this function returns.
+ * @returns `true` on success, or `false` if an error occurred (in which case the
+ *          caller should fall back to decoding the image on the CPU).
+ * @ingroup image
+ */
+bool jpegHardwareDecode( const void* data, size_t size, void* output, int width, int height, imageFormat format );
+
+/**
+ * @internal Encode an image in CUDA memory to a compressed JPEG with nvJPEG.
+ * The input format should be rgb8 or rgba8 (the alpha channel is dropped), and
+ * the compressed bitstream is returned in CPU memory once encoding is complete.
+ * @param quality the JPEG quality level (between 1 and 100)
+ * @returns `true` on success, or `false` if an error occurred (in which case the
+ *          caller should fall back to encoding the image on the CPU).
+ * @ingroup image
+ */
+bool jpegHardwareEncode( const void* input, int width, int height, imageFormat format, int quality, std::vector<unsigned char>& jpeg );
+
+/**
+ * @internal Returns true if JPEGs can be decoded at a reduced resolution on the CPU
+ * (i.e. jetson-utils was built with libjpeg, see the ENABLE_LIBJPEG CMake option).
+ * @ingroup image
+ */
+bool jpegScaledAvailable();
+
+/**
+ * @internal Return the largest DCT scaling denominator (1, 2, 4, or 8) that keeps an
+ * image of the given size at least `min_width x min_height` after it's scaled down.
+ * @ingroup image
+ */
+int jpegScaleDenom( int width, int height, int min_width, int min_height );
+
+/**
+ * @internal Decode a compressed JPEG image in CPU memory at a reduced resolution, that's
+ * still at least `min_width x min_height`.  The image is scaled down by 1/2, 1/4 or 1/8 in
+ * the DCT domain while it's decoded, so most of the decoding work is skipped.
+ * @param channels the number of channels to output (3 for rgb8 or 4 for rgba8)
+ * @param[out] width the width of the decoded image
+ * @param[out] height the height of the decoded image
+ * @returns the decoded image in CPU memory (which should be released with free()),
+ *          or NULL if an error occurred.
+ * @ingroup image
+ */
+unsigned char* jpegDecodeScaled( const void* data, size_t size, int min_width, int min_height, int channels, int* width, int* height );
+
+#endif
+
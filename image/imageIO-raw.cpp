@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "imageIO-raw.h"
+#include "imageIO.h"
+
+#include "logging.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+
+// npyFormat (the image format of a NumPy type string and number of channels)
+static imageFormat npyFormat( const char* descr, int channels )
+{
+	static const struct { const char* descr; imageFormat formats[4]; } table[] = {
+		{ "u1", { IMAGE_GRAY8,   IMAGE_UNKNOWN, IMAGE_RGB8,   IMAGE_RGBA8   } },
+		{ "u2", { IMAGE_GRAY16,  IMAGE_UNKNOWN, IMAGE_RGB16,  IMAGE_RGBA16  } },
+		{ "f2", { IMAGE_UNKNOWN, IMAGE_UNKNOWN, IMAGE_RGB16F, IMAGE_RGBA16F } },
+		{ "f4", { IMAGE_GRAY32F, IMAGE_UNKNOWN, IMAGE_RGB32F, IMAGE_RGBA32F } }
+	};
+
+	if( channels < 1 || channels > 4 )
+		return IMAGE_UNKNOWN;
+
+	// the byte order is '<' (little-endian), '|' (not applicable), or '=' (native)
+	if( descr[0] != '<' && descr[0] != '|' && descr[0] != '=' )
+		return IMAGE_UNKNOWN;
+
+	for( size_t n=0; n < sizeof(table) / sizeof(table[0]); n++ )
+	{
+		if( strcmp(descr + 1, table[n].descr) == 0 )
+			return table[n].formats[channels-1];
+	}
+
+	return IMAGE_UNKNOWN;
+}
+
+
+// npyDescr (the NumPy type string of an image format)
+static const char* npyDescr( imageFormat format )
+{
+	const char* descr = NULL;
+
+	switch( imageFormatBaseType(format) )
+	{
+		case IMAGE_UINT8:  descr = "|u1"; break;
+		case IMAGE_UINT16: descr = "<u2"; break;
+		case IMAGE_HALF:   descr = "<f2"; break;
+		case IMAGE_FLOAT:  descr = "<f4"; break;
+	}
+
+	// the formats that aren't interleaved gray/rgb/rgba can't be represented
+	if( !descr || npyFormat(descr, imageFormatChannels(format)) != format )
+		return NULL;
+
+	return descr;
+}
+
+
+// npyWrite
+bool npyWrite( const char* filename, const void* data, int width, int height, imageFormat format )
+{
+	const char* descr = npyDescr(format);
+
+	if( !descr )
+	{
+		LogError(LOG_IMAGE "saveImage() -- unsupported image format for .npy (%s)\n", imageFormatToStr(format));
+		LogError(LOG_IMAGE "               supported formats are gray, rgb, and rgba in uint8, uint16, half, or float\n");
+		return false;
+	}
+
+	const int channels = imageFormatChannels(format);
+
+	// the header is a python dict, padded with spaces so the data is 64-byte aligned
+	char dict[128];
+
+	if( channels == 1 )
+		snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (%i, %i), }", descr, height, width);
+	else
+		snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (%i, %i, %i), }", descr, height, width, channels);
+
+	std::string header = dict;
+
+	while( (10 + header.size() + 1) % 64 != 0 )
+		header += ' ';
+
+	header += '\n';
+
+	const char magic[] = { '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+					   (char)(header.size() & 0xFF), (char)(header.size() >> 8) };
+
+	FILE* file = fopen(filename, "wb");
+
+	if( !file )
+	{
+		LogError(LOG_IMAGE "saveImage() -- failed to open '%s' for writing\n", filename);
+		return false;
+	}
+
+	const size_t size = imageFormatSize(format, width, height);
+
+	const bool result = fwrite(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+					fwrite(header.c_str(), 1, header.size(), file) == header.size() &&
+					fwrite(data, 1, size, file) == size;
+
+	fclose(file);
+	return result;
+}
+
+
+// npyReadHeader
+bool npyReadHeader( FILE* file, int* width, int* height, imageFormat* format )
+{
+	unsigned char magic[10];
+
+	if( fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, "\x93NUMPY", 6) != 0 )
+	{
+		LogError(LOG_IMAGE "loadImage() -- file isn't a valid .npy array\n");
+		return false;
+	}
+
+	// version 1.0 has a 16-bit header length, and 2.0/3.0 have a 32-bit length
+	size_t headerLength = magic[8] | (magic[9] << 8);
+
+	if( magic[6] >= 2 )
+	{
+		unsigned char ext[2];
+
+		if( fread(ext, 1, sizeof(ext), file) != sizeof(ext) )
+			return false;
+
+		headerLength |= (ext[0] << 16) | ((size_t)ext[1] << 24);
+	}
+
+	if( headerLength == 0 || headerLength > 65536 )
+		return false;
+
+	std::string header(headerLength, '\0');
+
+	if( fread(&header[0], 1, headerLength, file) != headerLength )
+		return false;
+
+	// parse the fields of the dict
+	const size_t descrKey = header.find("'descr'");
+	const size_t shapeKey = header.find("'shape'");
+
+	if( descrKey == std::string::npos || shapeKey == std::string::npos )
+	{
+		LogError(LOG_IMAGE "loadImage() -- invalid .npy header '%s'\n", header.c_str());
+		return false;
+	}
+
+	if( header.find("'fortran_order': True") != std::string::npos )
+	{
+		LogError(LOG_IMAGE "loadImage() -- .npy arrays in fortran order aren't supported\n");
+		return false;
+	}
+
+	const size_t descrBegin = header.find('\'', descrKey + 7);
+	const size_t descrEnd   = header.find('\'', descrBegin + 1);
+	const size_t shapeBegin = header.find('(', shapeKey);
+
+	if( descrBegin == std::string::npos || descrEnd == std::string::npos || shapeBegin == std::string::npos )
+	{
+		LogError(LOG_IMAGE "loadImage() -- invalid .npy header '%s'\n", header.c_str());
+		return false;
+	}
+
+	const std::string descr = header.substr(descrBegin + 1, descrEnd - descrBegin - 1);
+
+	int shape[4] = { 0, 0, 0, 0 };
+	int dims = 0;
+
+	const char* str = header.c_str() + shapeBegin + 1;
+
+	while( dims < 4 )
+	{
+		char* end = NULL;
+		const long value = strtol(str, &end, 10);
+
+		if( end == str )
+			break;
+
+		shape[dims++] = value;
+		str = end;
+
+		while( *str == ',' || *str == ' ' || *str == 'L' )
+			str++;
+	}
+
+	const int channels = (dims == 3) ? shape[2] : 1;
+	const imageFormat fmt = npyFormat(descr.c_str(), channels);
+
+	if( (dims != 2 && dims != 3) || shape[0] <= 0 || shape[1] <= 0 || fmt == IMAGE_UNKNOWN )
+	{
+		LogError(LOG_IMAGE "loadImage() -- unsupported .npy array (shape %i dimensions, dtype '%s')\n", dims, descr.c_str());
+		LogError(LOG_IMAGE "               supported arrays are (H, W) or (H, W, C) with C = 1, 3, 4 in uint8, uint16, half, or float\n");
+		return false;
+	}
+
+	*width  = shape[1];
+	*height = shape[0];
+	*format = fmt;
+
+	return true;
+}
+
+
+// pfmWrite
+bool pfmWrite( const char* filename, const void* data, int width, int height, imageFormat format )
+{
+	if( format != IMAGE_GRAY32F && format != IMAGE_RGB32F && format != IMAGE_RGBA32F )
+	{
+		LogError(LOG_IMAGE "saveImage() -- unsupported image format for .pfm (%s)\n", imageFormatToStr(format));
+		LogError(LOG_IMAGE "               supported formats are gray32f, rgb32f, and rgba32f\n");
+		return false;
+	}
+
+	FILE* file = fopen(filename, "wb");
+
+	if( !file )
+	{
+		LogError(LOG_IMAGE "saveImage() -- failed to open '%s' for writing\n", filename);
+		return false;
+	}
+
+	// a negative scale means the data is little-endian
+	const int channels = imageFormatChannels(format);
+	const int outputChannels = (channels == 1) ? 1 : 3;
+
+	bool result = fprintf(file, "%s\n%i %i\n-1.0\n", (channels == 1) ? "Pf" : "PF", width, height) > 0;
+
+	// the rows are stored from the bottom of the image up
+	const float* img = (const float*)data;
+	std::vector<float> row;
+
+	if( channels != outputChannels )
+		row.resize(width * outputChannels);
+
+	for( int y=height-1; y >= 0 && result; y-- )
+	{
+		const float* src = img + y * width * channels;
+
+		if( channels != outputChannels )
+		{
+			for( int x=0; x < width; x++ )
+				memcpy(row.data() + x * 3, src + x * 4, sizeof(float) * 3);
+
+			src = row.data();
+		}
+
+		result = (fwrite(src, sizeof(float) * outputChannels, width, file) == (size_t)width);
+	}
+
+	fclose(file);
+	return result;
+}
+
+
+// pfmReadHeader
+bool pfmReadHeader( FILE* file, int* width, int* height, imageFormat* format, bool* bigEndian )
+{
+	char type[3] = { 0 };
+	int w = 0;
+	int h = 0;
+	float scale = 0.0f;
+
+	if( fscanf(file, "%2s %i %i %f", type, &w, &h, &scale) != 4 || fgetc(file) == EOF )
+	{
+		LogError(LOG_IMAGE "loadImage() -- file isn't a valid .pfm image\n");
+		return false;
+	}
+
+	if( (strcmp(type, "PF") != 0 && strcmp(type, "Pf") != 0) || w <= 0 || h <= 0 || scale == 0.0f )
+	{
+		LogError(LOG_IMAGE "loadImage() -- invalid .pfm header (%s %i %i %f)\n", type, w, h, scale);
+		return false;
+	}
+
+	*width  = w;
+	*height = h;
+	*format = (type[1] == 'F') ? IMAGE_RGB32F : IMAGE_GRAY32F;
+	*bigEndian = (scale > 0.0f);
+
+	return true;
+}
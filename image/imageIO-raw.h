@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __IMAGE_IO_RAW_H_
+#define __IMAGE_IO_RAW_H_
+
+
+#include "imageFormat.h"
+
+#include <stdio.h>
+
+
+/**
+ * @internal Write an image in CPU-accessible memory to a NumPy .npy file, with the
+ * shape `(height, width)` or `(height, width, channels)`.  The pixels are written
+ * as-is with a single fwrite(), so the supported formats are the interleaved
+ * gray, rgb, and rgba formats of uint8, uint16, half, and float.
+ * @ingroup image
+ */
+bool npyWrite( const char* filename, const void* data, int width, int height, imageFormat format );
+
+/**
+ * @internal Read the header of a NumPy .npy file, leaving the file positioned at the
+ * start of the pixels.  Arrays that are 2D `(height, width)` or 3D `(height, width, channels)`
+ * with 1, 3, or 4 channels of little-endian uint8, uint16, half or float are supported.
+ * @ingroup image
+ */
+bool npyReadHeader( FILE* file, int* width, int* height, imageFormat* format );
+
+/**
+ * @internal Write a float image in CPU-accessible memory to a Portable Float Map (.pfm) file.
+ * The format should be gray32f, rgb32f, or rgba32f (the alpha channel is dropped).
+ * @ingroup image
+ */
+bool pfmWrite( const char* filename, const void* data, int width, int height, imageFormat format );
+
+/**
+ * @internal Read the header of a Portable Float Map (.pfm) file, leaving the file positioned
+ * at the start of the pixels.  The format is gray32f or rgb32f, and the rows are stored from
+ * the bottom of the image up (with the byte order indicated by `bigEndian`).
+ * @ingroup image
+ */
+bool pfmReadHeader( FILE* file, int* width, int* height, imageFormat* format, bool* bigEndian );
+
+#endif
@@ -21,8 +21,11 @@
  */
  
 #include "imageIO.h"
+#include "imageIO-jpeg.h"
+#include "imageIO-raw.h"
 
 #include "cudaMappedMemory.h"
+#include "cudaMemoryPool.h"
 #include "cudaColorspace.h"
 
 #include "filesystem.h"
@@ -38,6 +41,7 @@
 #include "stb/stb_image_resize.h"
 
 #include <memory>
+#include <vector>
 
 
 namespace {
@@ -133,43 +137,104 @@ static StbBuffer loadImageIO( const char* filename, int* width, int* height, int
 }
 
 
-// loadImage
-bool loadImage( const char* filename, void** output, int* width, int* height, imageFormat format )
+// allocImage (re-use the existing buffer if it's big enough)
+static bool allocImage( void** output, size_t* outputSize, size_t size )
 {
-	// validate parameters
-	if( !filename || !output || !width || !height )
+	if( *output != NULL && *outputSize < size )
 	{
-		LogError(LOG_IMAGE "loadImage() - invalid parameter(s)\n");
-		return NULL;
+		cudaFreeMapped(*output);
+
+		*output = NULL;
+		*outputSize = 0;
 	}
 
-	// check that the requested format is supported
-	if( !imageFormatIsRGB(format) )
+	if( *output == NULL )
 	{
-		LogError(LOG_IMAGE "loadImage() -- unsupported output image format requested (%s)\n", imageFormatToStr(format));
-		LogError(LOG_IMAGE "               supported output formats are:\n");
-		LogError(LOG_IMAGE "                   * rgb8\n");		
-		LogError(LOG_IMAGE "                   * rgba8\n");		
-		LogError(LOG_IMAGE "                   * rgb32\n");		
-		LogError(LOG_IMAGE "                   * rgba32\n");
+		if( !cudaAllocMapped(output, size) )
+			return false;
 
-		return NULL;
+		*outputSize = size;
 	}
 
-	// attempt to load the data from disk
-	int imgWidth = *width;
-	int imgHeight = *height;
-	int imgChannels = imageFormatChannels(format);
+	return true;
+}
 
-	auto img = loadImageIO(filename, &imgWidth, &imgHeight, &imgChannels);
-	
-	if( !img )
-		return false;	
 
-	// allocate CUDA buffer for the image
+// JPEG file extensions (for the decoders that only support JPEG)
+static const char* jpegExtensions[] = { "jpg", "jpeg", NULL };
+
+
+// readImageFile (internal, read a compressed file into memory)
+static bool readImageFile( const char* filename, std::vector<unsigned char>& data )
+{
+	const std::string path = locateFile(filename);
+
+	if( path.length() == 0 )
+		return false;
+
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if( !file )
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	const long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	data.resize(fileSize > 0 ? fileSize : 0);
+	const bool read = (fileSize > 0) && (fread(data.data(), 1, fileSize, file) == (size_t)fileSize);
+	fclose(file);
+
+	return read;
+}
+
+
+// loadImageGPU (internal, decode JPEG's with nvJPEG)
+static bool loadImageGPU( const char* filename, void** output, size_t* outputSize, int* width, int* height, imageFormat format )
+{
+	if( !fileHasExtension(filename, jpegExtensions) || !jpegHardwareAvailable() )
+		return false;
+
+	// read the compressed file into memory
+	std::vector<unsigned char> data;
+
+	if( !readImageFile(filename, data) )
+		return false;
+
+	// decode the image straight into the CUDA buffer
+	int imgWidth = 0;
+	int imgHeight = 0;
+
+	if( !jpegHardwareInfo(data.data(), data.size(), &imgWidth, &imgHeight) )
+		return false;
+
+	const size_t imgSize = imageFormatSize(format, imgWidth, imgHeight);
+
+	if( !allocImage(output, outputSize, imgSize) )
+	{
+		LogError(LOG_IMAGE "loadImage() -- failed to allocate %zu bytes for image '%s'\n", imgSize, filename);
+		return false;
+	}
+
+	if( !jpegHardwareDecode(data.data(), data.size(), *output, imgWidth, imgHeight, format) )
+		return false;
+
+	LogVerbose(LOG_IMAGE "loaded '%s'  (%ix%i, decoded with nvJPEG)\n", filename, imgWidth, imgHeight);
+
+	*width  = imgWidth;
+	*height = imgHeight;
+
+	return true;
+}
+
+
+// uploadImage (internal, copy an 8-bit image from the CPU into the CUDA buffer in the output format)
+static bool uploadImage( const char* filename, const unsigned char* img, int imgWidth, int imgHeight, int imgChannels, void** output, size_t* outputSize, imageFormat format )
+{
+	// allocate CUDA buffer for the image (unless the existing one is big enough)
 	const size_t imgSize = imageFormatSize(format, imgWidth, imgHeight);
 
-	if( !cudaAllocMapped((void**)output, imgSize) )
+	if( !allocImage(output, outputSize, imgSize) )
 	{
 		LogError(LOG_IMAGE "loadImage() -- failed to allocate %zu bytes for image '%s'\n", imgSize, filename);
 		return false;
@@ -183,28 +248,253 @@ bool loadImage( const char* filename, void** output, int* width, int* height, im
 
 		void* inputImgGPU = NULL;
 
-		if( !cudaAllocMapped(&inputImgGPU, inputImageSize) )
+		if( !cudaAllocMappedPooled(&inputImgGPU, inputImageSize) )
 		{
 			LogError(LOG_IMAGE "loadImage() -- failed to allocate %zu bytes for image '%s'\n", inputImageSize, filename);
 			return false;
 		}
 
-		memcpy(inputImgGPU, img.get(), imageFormatSize(inputFormat, imgWidth, imgHeight));
+		memcpy(inputImgGPU, img, imageFormatSize(inputFormat, imgWidth, imgHeight));
 
 		if( CUDA_FAILED(cudaConvertColor(inputImgGPU, inputFormat, *output, format, imgWidth, imgHeight)) )
 		{
 			printf(LOG_IMAGE "loadImage() -- failed to convert image from %s to %s ('%s')\n", imageFormatToStr(inputFormat), imageFormatToStr(format), filename);
+			cudaFreePooled(inputImgGPU);
 			return false;
 		}
 
-		CUDA(cudaFreeHost(inputImgGPU));
+		// make sure the conversion is complete before the image is returned
+		CUDA(cudaDeviceSynchronize());
+		cudaFreePooled(inputImgGPU);
 	}
 	else
 	{
 		// uint8 output can be straight copied to GPU memory
-		memcpy(*output, img.get(), imgSize);
+		memcpy(*output, img, imgSize);
+	}
+
+	return true;
+}
+
+
+// loadImageRaw (internal, read .npy and .pfm files without decoding them)
+static bool loadImageRaw( const char* filename, void** output, size_t* outputSize, int* width, int* height, imageFormat format )
+{
+	const std::string path = locateFile(filename);
+
+	if( path.length() == 0 )
+	{
+		LogError(LOG_IMAGE "failed to find file '%s'\n", filename);
+		return false;
+	}
+
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if( !file )
+	{
+		LogError(LOG_IMAGE "failed to open file '%s'\n", path.c_str());
+		return false;
+	}
+
+	int imgWidth = 0;
+	int imgHeight = 0;
+	bool bigEndian = false;
+	imageFormat fileFormat = IMAGE_UNKNOWN;
+
+	const bool pfm = fileHasExtension(path, "pfm");
+	const bool header = pfm ? pfmReadHeader(file, &imgWidth, &imgHeight, &fileFormat, &bigEndian)
+					    : npyReadHeader(file, &imgWidth, &imgHeight, &fileFormat);
+
+	if( !header )
+	{
+		LogError(LOG_IMAGE "failed to load image '%s'\n", path.c_str());
+		fclose(file);
+		return false;
+	}
+
+	// read straight into the output if it's already in the requested format
+	const size_t imgSize = imageFormatSize(format, imgWidth, imgHeight);
+	const size_t fileSize = imageFormatSize(fileFormat, imgWidth, imgHeight);
+
+	if( !allocImage(output, outputSize, imgSize) )
+	{
+		LogError(LOG_IMAGE "loadImage() -- failed to allocate %zu bytes for image '%s'\n", imgSize, filename);
+		fclose(file);
+		return false;
+	}
+
+	void* buffer = *output;
+
+	if( fileFormat != format && !cudaAllocMappedPooled(&buffer, fileSize) )
+	{
+		LogError(LOG_IMAGE "loadImage() -- failed to allocate %zu bytes for image '%s'\n", fileSize, filename);
+		fclose(file);
+		return false;
+	}
+
+	#define release_return(x) \
+		if( buffer != *output ) \
+			cudaFreePooled(buffer); \
+		return x;
+
+	// PFM's store the rows from the bottom of the image up
+	bool result = true;
+
+	if( pfm )
+	{
+		const size_t pitch = fileSize / imgHeight;
+
+		for( int y=imgHeight-1; y >= 0 && result; y-- )
+			result = (fread((uint8_t*)buffer + y * pitch, 1, pitch, file) == pitch);
+	}
+	else
+	{
+		result = (fread(buffer, 1, fileSize, file) == fileSize);
+	}
+
+	fclose(file);
+
+	if( !result )
+	{
+		LogError(LOG_IMAGE "loadImage() -- '%s' is truncated (expected %zu bytes of %ix%i %s)\n", path.c_str(), fileSize, imgWidth, imgHeight, imageFormatToStr(fileFormat));
+		release_return(false);
+	}
+
+	if( bigEndian )
+	{
+		uint32_t* words = (uint32_t*)buffer;
+
+		for( size_t n=0; n < fileSize / sizeof(uint32_t); n++ )
+			words[n] = __builtin_bswap32(words[n]);
+	}
+
+	if( buffer != *output )
+	{
+		if( CUDA_FAILED(cudaConvertColor(buffer, fileFormat, *output, format, imgWidth, imgHeight)) )
+		{
+			LogError(LOG_IMAGE "loadImage() -- failed to convert image from %s to %s ('%s')\n", imageFormatToStr(fileFormat), imageFormatToStr(format), filename);
+			release_return(false);
+		}
+
+		CUDA(cudaDeviceSynchronize());
+	}
+
+	*width  = imgWidth;
+	*height = imgHeight;
+
+	release_return(true);
+	#undef release_return
+}
+
+
+// loadImage16 (internal, load 16-bit PNG's without truncating them to 8 bits)
+static bool loadImage16( const char* filename, void** output, size_t* outputSize, int* width, int* height, imageFormat format )
+{
+	const std::string path = locateFile(filename);
+
+	if( path.length() == 0 )
+	{
+		LogError(LOG_IMAGE "failed to find file '%s'\n", filename);
+		return false;
 	}
 
+	int imgWidth = 0;
+	int imgHeight = 0;
+	int imgChannels = 0;
+
+	stbi_us* img = stbi_load_16(path.c_str(), &imgWidth, &imgHeight, &imgChannels, imageFormatChannels(format));
+
+	if( !img )
+	{
+		LogError(LOG_IMAGE "failed to load '%s'\n", path.c_str());
+		LogError(LOG_IMAGE "(error:  %s)\n", stbi_failure_reason());
+		return false;
+	}
+
+	const size_t imgSize = imageFormatSize(format, imgWidth, imgHeight);
+
+	if( !allocImage(output, outputSize, imgSize) )
+	{
+		LogError(LOG_IMAGE "loadImage() -- failed to allocate %zu bytes for image '%s'\n", imgSize, filename);
+		stbi_image_free(img);
+		return false;
+	}
+
+	memcpy(*output, img, imgSize);
+	stbi_image_free(img);
+
+	*width  = imgWidth;
+	*height = imgHeight;
+
+	return true;
+}
+
+
+// loadImage
+bool loadImage( const char* filename, void** output, int* width, int* height, imageFormat format )
+{
+	if( !output )
+	{
+		LogError(LOG_IMAGE "loadImage() - invalid parameter(s)\n");
+		return false;
+	}
+
+	size_t outputSize = 0;
+	*output = NULL;
+
+	return loadImage(filename, output, &outputSize, width, height, format);
+}
+
+
+// loadImage
+bool loadImage( const char* filename, void** output, size_t* outputSize, int* width, int* height, imageFormat format )
+{
+	// validate parameters
+	if( !filename || !output || !outputSize || !width || !height )
+	{
+		LogError(LOG_IMAGE "loadImage() - invalid parameter(s)\n");
+		return NULL;
+	}
+
+	// .npy and .pfm files hold the raw pixels, which get read straight into the output
+	if( fileHasExtension(filename, "npy") || fileHasExtension(filename, "pfm") )
+		return loadImageRaw(filename, output, outputSize, width, height, format);
+
+	// 16-bit PNG's (like depth maps) can be loaded without losing precision
+	if( (format == IMAGE_GRAY16 || format == IMAGE_RGB16 || format == IMAGE_RGBA16) && fileHasExtension(filename, "png") )
+		return loadImage16(filename, output, outputSize, width, height, format);
+
+	// check that the requested format is supported
+	if( !imageFormatIsRGB(format) )
+	{
+		LogError(LOG_IMAGE "loadImage() -- unsupported output image format requested (%s)\n", imageFormatToStr(format));
+		LogError(LOG_IMAGE "               supported output formats are:\n");
+		LogError(LOG_IMAGE "                   * rgb8\n");		
+		LogError(LOG_IMAGE "                   * rgba8\n");		
+		LogError(LOG_IMAGE "                   * rgb32\n");		
+		LogError(LOG_IMAGE "                   * rgba32\n");
+
+		return NULL;
+	}
+
+	// decode JPEG's on the GPU when possible (unless they need to be resized),
+	// otherwise fall back to decoding them on the CPU with stb_image below
+	if( !(*width > 0 && *height > 0) && loadImageGPU(filename, output, outputSize, width, height, format) )
+		return true;
+
+	// attempt to load the data from disk
+	int imgWidth = *width;
+	int imgHeight = *height;
+	int imgChannels = imageFormatChannels(format);
+
+	auto img = loadImageIO(filename, &imgWidth, &imgHeight, &imgChannels);
+	
+	if( !img )
+		return false;	
+
+	if( !uploadImage(filename, img.get(), imgWidth, imgHeight, imgChannels, output, outputSize, format) )
+		return false;
+
 	*width  = imgWidth;
 	*height = imgHeight;
 	
@@ -212,6 +502,58 @@ bool loadImage( const char* filename, void** output, int* width, int* height, im
 }
 
 
+// loadImageScaled
+bool loadImageScaled( const char* filename, void** output, size_t* outputSize, int* width, int* height, int min_width, int min_height, imageFormat format )
+{
+	if( !filename || !output || !outputSize || !width || !height )
+	{
+		LogError(LOG_IMAGE "loadImageScaled() - invalid parameter(s)\n");
+		return false;
+	}
+
+	*width  = 0;
+	*height = 0;
+
+	// decode JPEG's at a reduced resolution on the CPU if they can be scaled down by at least 1/2
+	// (if nvJPEG is available and they can't be, they're decoded on the GPU by loadImage() instead)
+	if( min_width > 0 && min_height > 0 && imageFormatIsRGB(format) && jpegScaledAvailable() && fileHasExtension(filename, jpegExtensions) )
+	{
+		std::vector<unsigned char> data;
+
+		if( readImageFile(filename, data) )
+		{
+			int imgWidth = 0;
+			int imgHeight = 0;
+
+			const bool scaled = !jpegHardwareAvailable() || !jpegHardwareInfo(data.data(), data.size(), &imgWidth, &imgHeight)
+						 || jpegScaleDenom(imgWidth, imgHeight, min_width, min_height) > 1;
+
+			const int imgChannels = imageFormatChannels(format);
+			unsigned char* img = scaled ? jpegDecodeScaled(data.data(), data.size(), min_width, min_height, imgChannels, &imgWidth, &imgHeight) : NULL;
+
+			if( img != NULL )
+			{
+				LogVerbose(LOG_IMAGE "loaded '%s'  (%ix%i, decoded at reduced resolution)\n", filename, imgWidth, imgHeight);
+
+				const bool result = uploadImage(filename, img, imgWidth, imgHeight, imgChannels, output, outputSize, format);
+				free(img);
+
+				if( !result )
+					return false;
+
+				*width  = imgWidth;
+				*height = imgHeight;
+
+				return true;
+			}
+		}
+	}
+
+	// other images are loaded at their full resolution
+	return loadImage(filename, output, outputSize, width, height, format);
+}
+
+
 // loadImageRGBA
 bool loadImageRGBA( const char* filename, float4** output, int* width, int* height )
 {
@@ -246,6 +588,76 @@ bool loadImageRGBA( const char* filename, float4** cpu, float4** gpu, int* width
 }*/
 
 
+// savePNG16 (internal, stb_image_write only writes 8-bit PNG's)
+static bool savePNG16( const char* filename, const uint16_t* img, int width, int height, int channels, int level )
+{
+	// PNG's are big-endian, and each row is prefixed with its filter type (0 is none)
+	const size_t pitch = width * channels * sizeof(uint16_t) + 1;
+	std::vector<unsigned char> rows(pitch * height);
+
+	for( int y=0; y < height; y++ )
+	{
+		unsigned char* row = rows.data() + y * pitch;
+		const uint16_t* src = img + y * width * channels;
+
+		row[0] = 0;
+
+		for( int x=0; x < width * channels; x++ )
+		{
+			row[1 + x * 2] = src[x] >> 8;
+			row[2 + x * 2] = src[x] & 0xFF;
+		}
+	}
+
+	int zlen = 0;
+	unsigned char* zlib = stbi_zlib_compress(rows.data(), rows.size(), &zlen, level);
+
+	if( !zlib )
+		return false;
+
+	FILE* file = fopen(filename, "wb");
+
+	if( !file )
+	{
+		STBIW_FREE(zlib);
+		return false;
+	}
+
+	// each chunk is its length, type, data, and the CRC of the type and data
+	auto writeChunk = [file]( const char* type, const unsigned char* data, size_t size )
+	{
+		std::vector<unsigned char> chunk(4 + size);
+
+		memcpy(chunk.data(), type, 4);
+
+		if( size > 0 )
+			memcpy(chunk.data() + 4, data, size);
+
+		const unsigned int crc = stbiw__crc32(chunk.data(), chunk.size());
+		const unsigned char len[4] = { (unsigned char)(size >> 24), (unsigned char)(size >> 16), (unsigned char)(size >> 8), (unsigned char)size };
+		const unsigned char tail[4] = { (unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc };
+
+		return fwrite(len, 1, 4, file) == 4 && fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size() && fwrite(tail, 1, 4, file) == 4;
+	};
+
+	// the color type is 0 (gray), 2 (rgb), or 6 (rgba), with a bit depth of 16
+	const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	const unsigned char ihdr[13] = { (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+							   (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+							   16, (unsigned char)((channels == 1) ? 0 : (channels == 3) ? 2 : 6), 0, 0, 0 };
+
+	const bool result = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+					writeChunk("IHDR", ihdr, sizeof(ihdr)) &&
+					writeChunk("IDAT", zlib, zlen) &&
+					writeChunk("IEND", NULL, 0);
+
+	fclose(file);
+	STBIW_FREE(zlib);
+
+	return result;
+}
+
+
 // saveImage
 bool saveImage( const char* filename, void* ptr, int width, int height, imageFormat format, int quality, const float2& pixel_range, bool sync )
 {
@@ -261,7 +673,38 @@ bool saveImage( const char* filename, void* ptr, int width, int height, imageFor
 
 	if( quality > 100 )
 		quality = 100;
-	
+
+	// determine the file extension
+	const std::string ext = fileExtension(filename);
+	const char* extension = ext.c_str();
+
+	// .npy, .pfm, and 16-bit PNG's are written straight from memory without converting to 8 bits
+	const bool png16 = (format == IMAGE_GRAY16 || format == IMAGE_RGB16 || format == IMAGE_RGBA16) && strcasecmp(extension, "png") == 0;
+
+	if( strcasecmp(extension, "npy") == 0 || strcasecmp(extension, "pfm") == 0 || png16 )
+	{
+		if( sync )
+			CUDA(cudaDeviceSynchronize());
+
+		bool result = false;
+
+		if( png16 )
+			result = savePNG16(filename, (uint16_t*)ptr, width, height, imageFormatChannels(format), (100 - quality) / 10);
+		else if( strcasecmp(extension, "pfm") == 0 )
+			result = pfmWrite(filename, ptr, width, height, format);
+		else
+			result = npyWrite(filename, ptr, width, height, format);
+
+		if( !result )
+		{
+			LogError(LOG_IMAGE "failed to save %ix%i image to '%s'\n", width, height, filename);
+			return false;
+		}
+
+		LogVerbose(LOG_IMAGE "saved '%s'  (%ix%i, %s)\n", filename, width, height, imageFormatToStr(format));
+		return true;
+	}
+
 	// check that the requested format is supported
 	if( !imageFormatIsRGB(format) && !imageFormatIsGray(format) )
 	{
@@ -272,6 +715,7 @@ bool saveImage( const char* filename, void* ptr, int width, int height, imageFor
 		LogError(LOG_IMAGE "                   * rgb32f\n");		
 		LogError(LOG_IMAGE "                   * rgba32f\n");
 		LogError(LOG_IMAGE "                   * gray8\n");
+		LogError(LOG_IMAGE "                   * gray16\n");
 		LogError(LOG_IMAGE "                   * gray32\n");
 
 		return false;
@@ -283,10 +727,10 @@ bool saveImage( const char* filename, void* ptr, int width, int height, imageFor
 	const size_t size     = stride * height;
 	unsigned char* img    = (unsigned char*)ptr;
 
-	// if needed, convert from float to uint8
-	const imageBaseType baseType = imageFormatBaseType(format);
+	// if needed, convert from float/uint16 to uint8
+	const bool convert = (imageFormatBaseType(format) == IMAGE_FLOAT || format == IMAGE_GRAY16);
 
-	if( baseType == IMAGE_FLOAT )
+	if( convert )
 	{
 		imageFormat outputFormat = IMAGE_UNKNOWN;
 
@@ -297,7 +741,7 @@ bool saveImage( const char* filename, void* ptr, int width, int height, imageFor
 		else if( channels == 4 )
 			outputFormat = IMAGE_RGBA8;
 
-		if( !cudaAllocMapped((void**)&img, size) )
+		if( !cudaAllocMappedPooled((void**)&img, size) )
 		{
 			LogError(LOG_IMAGE "saveImage() -- failed to allocate %zu bytes for image '%s'\n", size, filename);
 			return false;
@@ -306,6 +750,7 @@ bool saveImage( const char* filename, void* ptr, int width, int height, imageFor
 		if( CUDA_FAILED(cudaConvertColor(ptr, format, img, outputFormat, width, height, pixel_range)) )  // TODO limit pixel
 		{
 			LogError(LOG_IMAGE "saveImage() -- failed to convert image from %s to %s ('%s')\n", imageFormatToStr(format), imageFormatToStr(outputFormat), filename);
+			cudaFreePooled(img);
 			return false;
 		}
 		
@@ -316,14 +761,10 @@ bool saveImage( const char* filename, void* ptr, int width, int height, imageFor
 		CUDA(cudaDeviceSynchronize());
 	
 	#define release_return(x) 	\
-		if( baseType == IMAGE_FLOAT ) \
-			CUDA(cudaFreeHost(img)); \
+		if( convert ) \
+			cudaFreePooled(img); \
 		return x;
 	
-	// determine the file extension
-	const std::string ext = fileExtension(filename);
-	const char* extension = ext.c_str();
-
 	if( ext.size() == 0 )
 	{
 		LogError(LOG_IMAGE "invalid filename or extension, '%s'\n", filename);
@@ -335,7 +776,23 @@ bool saveImage( const char* filename, void* ptr, int width, int height, imageFor
 
 	if( strcasecmp(extension, "jpg") == 0 || strcasecmp(extension, "jpeg") == 0 )
 	{
-		save_result = stbi_write_jpg(filename, width, height, channels, img, quality);
+		// encode color images on the GPU with nvJPEG if it's available
+		std::vector<unsigned char> jpeg;
+
+		if( channels >= 3 && jpegHardwareEncode(img, width, height, (channels == 4) ? IMAGE_RGBA8 : IMAGE_RGB8, quality, jpeg) )
+		{
+			FILE* file = fopen(filename, "wb");
+
+			if( file != NULL )
+			{
+				save_result = (fwrite(jpeg.data(), 1, jpeg.size(), file) == jpeg.size());
+				fclose(file);
+			}
+		}
+		else
+		{
+			save_result = stbi_write_jpg(filename, width, height, channels, img, quality);
+		}
 	}
 	else if( strcasecmp(extension, "png") == 0 )
 	{
@@ -368,7 +825,7 @@ bool saveImage( const char* filename, void* ptr, int width, int height, imageFor
 	else
 	{
 		LogError(LOG_IMAGE "invalid extension format '.%s' saving image '%s'\n", extension, filename);
-		LogError(LOG_IMAGE "valid extensions are:  JPG/JPEG, PNG, TGA, BMP.\n");
+		LogError(LOG_IMAGE "valid extensions are:  JPG/JPEG, PNG, TGA, BMP, NPY, PFM.\n");
 		
 		release_return(false);
 	}
@@ -42,6 +42,12 @@
  *   - HDR
  *   - PIC
  *   - PNM (PPM/PGM binary)
+ *   - NPY (NumPy arrays of shape HxW or HxWxC, in uint8, uint16, half, or float)
+ *   - PFM (Portable Float Map)
+ *
+ * NPY and PFM files are read directly into the output buffer when it's in the same format
+ * as the file, otherwise they're converted with cudaConvertColor().  16-bit PNG's can be
+ * loaded without losing precision by requesting the gray16, rgb16, or rgba16 formats.
  *
  * This function loads the image into shared CPU/GPU memory, using the functions from cudaMappedMemory.h
  *
@@ -73,6 +79,12 @@ template<typename T> bool loadImage( const char* filename, T** ptr, int* width,
  *   - HDR
  *   - PIC
  *   - PNM (PPM/PGM binary)
+ *   - NPY (NumPy arrays of shape HxW or HxWxC, in uint8, uint16, half, or float)
+ *   - PFM (Portable Float Map)
+ *
+ * NPY and PFM files are read directly into the output buffer when it's in the same format
+ * as the file, otherwise they're converted with cudaConvertColor().  16-bit PNG's can be
+ * loaded without losing precision by requesting the gray16, rgb16, or rgba16 formats.
  *
  * This function loads the image into shared CPU/GPU memory, using the functions from cudaMappedMemory.h
  *
@@ -90,6 +102,40 @@ template<typename T> bool loadImage( const char* filename, T** ptr, int* width,
  */
 bool loadImage( const char* filename, void** output, int* width, int* height, imageFormat format );
 
+/**
+ * Load a color image from disk into an existing buffer in CUDA mapped memory,
+ * so that the same buffer can be re-used when loading a sequence of images.
+ *
+ * If the buffer is NULL or too small for the image, it gets released and a new one
+ * is allocated in its place, with `outputSize` updated to its new size (in bytes).
+ * Otherwise, the image is decoded into the existing buffer without allocating memory.
+ * Buffers passed to this function should be allocated with cudaAllocMapped().
+ *
+ * @see loadImage() for more details about the other parameters and the supported image formats.
+ * @ingroup image
+ */
+bool loadImage( const char* filename, void** output, size_t* outputSize, int* width, int* height, imageFormat format );
+
+/**
+ * Load a color image at a reduced resolution that's still at least `min_width x min_height`,
+ * for when the image is going to be downscaled to that size afterwards anyway (e.g. for a model).
+ *
+ * JPEGs are scaled down by 1/2, 1/4 or 1/8 while they're decoded (in the DCT domain), so only
+ * the needed part of the image is decoded, which cuts the decode time and memory by up to 64x
+ * for large images.  The aspect ratio is kept, and the image isn't resized any further.
+ * Other formats, and JPEGs when jetson-utils was built without libjpeg (see the ENABLE_LIBJPEG
+ * CMake option), are loaded at their full resolution.
+ *
+ * @param[out] width set to the width of the image that was loaded.
+ * @param[out] height set to the height of the image that was loaded.
+ * @param min_width the smallest width needed (if 0, the image is loaded at its full resolution).
+ * @param min_height the smallest height needed (if 0, the image is loaded at its full resolution).
+ *
+ * @see loadImage() for more details about the other parameters and the supported image formats.
+ * @ingroup image
+ */
+bool loadImageScaled( const char* filename, void** output, size_t* outputSize, int* width, int* height, int min_width, int min_height, imageFormat format );
+
 /**
  * Load a color image from disk into CUDA memory with alpha, in float4 RGBA format with pixel values 0-255.
  * @see loadImage() for more details about parameters and supported image formats.
@@ -119,6 +165,12 @@ bool loadImageRGBA( const char* filename, float4** cpu, float4** gpu, int* width
  *   - PNG
  *   - TGA
  *   - BMP
+ *   - NPY (NumPy arrays, from images in uint8, uint16, half, or float)
+ *   - PFM (Portable Float Map, from gray32f, rgb32f, or rgba32f images)
+ *
+ * NPY and PFM are written straight from memory with the original precision (without
+ * rescaling the pixels to 0-255), and so are PNG's of gray16, rgb16, or rgba16 images,
+ * which are saved as 16-bit PNG's (e.g. for depth maps).
  *
  * @param filename Desired path of the image file to save to disk.
  * @param ptr Pointer to the buffer containing the image in shared CPU/GPU zero-copy memory.
@@ -148,6 +200,12 @@ template<typename T> bool saveImage( const char* filename, T* ptr, int width, in
  *   - PNG
  *   - TGA
  *   - BMP
+ *   - NPY (NumPy arrays, from images in uint8, uint16, half, or float)
+ *   - PFM (Portable Float Map, from gray32f, rgb32f, or rgba32f images)
+ *
+ * NPY and PFM are written straight from memory with the original precision (without
+ * rescaling the pixels to 0-255), and so are PNG's of gray16, rgb16, or rgba16 images,
+ * which are saved as 16-bit PNG's (e.g. for depth maps).
  *
  * @param filename Desired path of the image file to save to disk.
  * @param ptr Pointer to the buffer containing the image in shared CPU/GPU zero-copy memory.
@@ -22,8 +22,11 @@
  
 #include "imageLoader.h"
 #include "imageIO.h"
+#include "cudaDevice.h"
+#include "cudaMappedMemory.h"
 
 #include "filesystem.h"
+#include "timespec.h"
 #include "logging.h"
 
 #include <strings.h>
@@ -63,8 +66,42 @@ imageLoader::imageLoader( const videoOptions& options ) : videoSource(options)
 {
 	mEOS = false;
 	mNextFile = 0;
+	mStreamLoop = 0;
+	mScaleWidth  = options.width;
+	mScaleHeight = options.height;
+	mStreamFiles = options.streamFiles || dirStream::IsManifest(options.resource.location);
+	mNextBuffer = 0;
+	mLoopCount = 0;
+	mFlipCapture = true;
+
+	mPrefetchFormat = IMAGE_UNKNOWN;
+	mPrefetchDepth  = 0;
+	mPrefetchEnd    = -1;
+	mNextDecode     = 0;
+	mNextCapture    = 0;
+	mPrefetchStop   = false;
+	mPrefetchTasks  = 0;
+	mPrefetchStarted = false;
+	mRetiredCaptures = 0;
+
+	mCallbackThread = NULL;
+	mCallbackStop   = false;
+
+	mBuffers.resize(options.numBuffers > 0 ? options.numBuffers : 1, NULL);
+	mBufferSizes.resize(mBuffers.size(), 0);
+
+	// enumerate the files lazily, starting with the first image
+	if( mStreamFiles )
+	{
+		if( !mDirStream.Open(options.resource.location, FILE_REGULAR) || !nextStreamFile() )
+		{
+			LogError(LOG_IMAGE "imageLoader -- failed to find any image files under '%s'\n", options.resource.location.c_str());
+			return;
+		}
 
-	mBuffers.reserve(options.numBuffers);
+		LogVerbose(LOG_IMAGE "imageLoader -- streaming the images from '%s'\n", options.resource.location.c_str());
+		return;
+	}
 
 	// list files to use
 	std::vector<std::string> files;
@@ -92,18 +129,43 @@ imageLoader::imageLoader( const videoOptions& options ) : videoSource(options)
 		LogError(LOG_IMAGE "imageLoader -- failed to find any image files under '%s'\n", options.resource.location.c_str());
 		return;
 	}
+
+	mNextPath = mFiles[0];
 }
 
 
 // destructor
 imageLoader::~imageLoader()
 {
+	stopCallback();
+	stopPrefetch();
+
+	cudaDeviceScope device(mOptions.cudaDevice);
+
 	const size_t numBuffers = mBuffers.size();
 
 	for( size_t n=0; n < numBuffers; n++ )
-		CUDA(cudaFreeHost(mBuffers[n]));
+	{
+		if( mBuffers[n] != NULL )
+			cudaFreeMapped(mBuffers[n]);
+	}
 
 	mBuffers.clear();
+	mBufferSizes.clear();
+
+	freeRetiredBuffers();
+}
+
+
+// freeRetiredBuffers
+void imageLoader::freeRetiredBuffers()
+{
+	const size_t numBuffers = mRetiredBuffers.size();
+
+	for( size_t n=0; n < numBuffers; n++ )
+		cudaFreeMapped(mRetiredBuffers[n]);
+
+	mRetiredBuffers.clear();
 }
 
 
@@ -112,7 +174,7 @@ imageLoader* imageLoader::Create( const videoOptions& options )
 {
 	imageLoader* loader = new imageLoader(options);
 
-	if( loader->mFiles.size() == 0 )
+	if( loader->mNextPath.size() == 0 )
 	{
 		delete loader;
 		return NULL;
@@ -133,6 +195,25 @@ imageLoader* imageLoader::Create( const char* resource, const videoOptions& opti
 
 // Capture
 bool imageLoader::Capture( void** output, imageFormat format, uint64_t timeout )
+{
+	// the callback thread is already loading the images
+	if( mCallback != NULL )
+	{
+		LogError(LOG_IMAGE "imageLoader -- Capture() can't be used while a frame callback is set\n");
+		return false;
+	}
+
+	cudaDeviceScope device(mOptions.cudaDevice);
+
+	if( !captureNext(output, format, timeout) )
+		return false;
+
+	return flipCapture(output, format);
+}
+
+
+// captureNext
+bool imageLoader::captureNext( void** output, imageFormat format, uint64_t timeout )
 {
 	// verify the output pointer exists
 	if( !output )
@@ -145,53 +226,475 @@ bool imageLoader::Capture( void** output, imageFormat format, uint64_t timeout )
 			return false;
 	}
 
-	// reclaim old buffers
-	if( mBuffers.size() >= mOptions.numBuffers )
+	// decode the images ahead of time on the worker threads
+	if( mOptions.decodeThreads > 0 )
+		return capturePrefetch(output, format, timeout);
+
+	// get the next file to load
+	const std::string currFile = mNextPath;
+
+	if( !advanceFile() )
 	{
-		CUDA(cudaFreeHost(mBuffers[0]));
-		mBuffers.erase(mBuffers.begin());
+		mEOS = true;
+		mStreaming = false;
+	}
+
+	// load the next image into the oldest buffer (which only
+	// gets re-allocated if this image is larger than it is)
+	const size_t bufferIndex = mNextBuffer;
+
+	int imgWidth  = 0;
+	int imgHeight = 0;
+
+	if( !loadImageScaled(currFile.c_str(), &mBuffers[bufferIndex], &mBufferSizes[bufferIndex], &imgWidth, &imgHeight, mScaleWidth, mScaleHeight, format) )
+	{
+		LogError(LOG_IMAGE "imageLoader -- failed to load '%s'\n", currFile.c_str());
+		return captureNext(output, format, timeout);
+	}
+
+	mNextBuffer = (mNextBuffer + 1) % mBuffers.size();
+
+	// set outputs
+	mOptions.width = imgWidth;
+	mOptions.height = imgHeight;
+
+	*output = mBuffers[bufferIndex];
+	return true;
+}
+
+
+// advanceFile (returns false when there are no more files)
+bool imageLoader::advanceFile()
+{
+	if( mStreamFiles )
+	{
+		// images that were decoded ahead before the prefetch restarted come first
+		if( mReplay.size() > 0 )
+		{
+			mNextPath  = mReplay.front().first;
+			mLoopCount = mReplay.front().second;
+			mReplay.pop_front();
+			return true;
+		}
+
+		mLoopCount = mStreamLoop;
+
+		if( nextStreamFile() )
+			return true;
+
+		if( !isLooping() || !mDirStream.Rewind() )
+			return false;
+
+		mStreamLoop++;
+		mLoopCount = mStreamLoop;
+
+		return nextStreamFile();
 	}
 
-	// get the next file to load
-	const size_t currFile = mNextFile;
 	mNextFile++;
 	
-	if( mNextFile >= mFiles.size() )
+	if( mNextFile < mFiles.size() )
+	{
+		mNextPath = mFiles[mNextFile];
+		return true;
+	}
+
+	if( !isLooping() )
+		return false;
+
+	mNextFile = 0;
+	mLoopCount++;
+	mNextPath = mFiles[0];
+
+	return true;
+}
+
+
+// nextStreamFile (skips over files that aren't images)
+bool imageLoader::nextStreamFile()
+{
+	std::string path;
+
+	while( mDirStream.Next(path) )
 	{
-		if( isLooping() )
+		if( fileHasExtension(path, SupportedExtensions) )
 		{
-			mNextFile = 0;
-			mLoopCount++;
+			mNextPath = path;
+			return true;
 		}
-		else
+	}
+
+	return false;
+}
+
+
+// startPrefetch
+bool imageLoader::startPrefetch( imageFormat format )
+{
+	const size_t numThreads = mOptions.decodeThreads;
+
+	// keep the last numBuffers images valid like before, plus a couple per thread in flight
+	mPrefetchDepth  = numThreads * 2;
+	mPrefetchFormat = format;
+	mPrefetchEnd    = -1;
+	mPrefetchStop   = false;
+	mPrefetchTasks  = 0;
+	mNextDecode     = 0;
+	mNextCapture    = 0;
+
+	const size_t numBuffers = mOptions.numBuffers + mPrefetchDepth;
+
+	mBuffers.resize(numBuffers, NULL);
+	mBufferSizes.resize(numBuffers, 0);
+
+	PrefetchSlot slot = PrefetchSlot();
+	slot.sequence = -1;
+
+	mPrefetchSlots.assign(numBuffers, slot);
+
+	if( !ThreadPool::Global() )
+	{
+		LogError(LOG_IMAGE "imageLoader -- failed to create the thread pool for decoding\n");
+		return false;
+	}
+
+	mPrefetchStarted = true;
+
+	mPrefetchMutex.Lock();
+	submitPrefetch();
+	mPrefetchMutex.Unlock();
+
+	LogVerbose(LOG_IMAGE "imageLoader -- prefetching up to %zu images with %zu decoding tasks\n", mPrefetchDepth, numThreads);
+	return true;
+}
+
+
+// stopPrefetch
+void imageLoader::stopPrefetch()
+{
+	if( !mPrefetchStarted )
+		return;
+
+	// wait for the tasks that are decoding to finish
+	mPrefetchMutex.Lock();
+	mPrefetchStop = true;
+
+	while( mPrefetchTasks > 0 )
+	{
+		mPrefetchMutex.Unlock();
+		mDecodeEvent.Wait(100);
+		mPrefetchMutex.Lock();
+	}
+
+	mPrefetchMutex.Unlock();
+	mPrefetchStarted = false;
+}
+
+
+// submitPrefetch (the mutex should be locked)
+void imageLoader::submitPrefetch()
+{
+	// each task keeps decoding images until it gets far enough ahead of Capture()
+	while( !mPrefetchStop && mPrefetchTasks < mOptions.decodeThreads &&
+		  mNextDecode < mNextCapture + (int64_t)mPrefetchDepth && 
+		  (mPrefetchEnd < 0 || mNextDecode < mPrefetchEnd) )
+	{
+		if( !ThreadPool::Global()->Submit(&imageLoader::prefetchTask, this) )
+			break;
+
+		mPrefetchTasks++;
+	}
+}
+
+
+// prefetchTask
+void imageLoader::prefetchTask( void* param )
+{
+	imageLoader* loader = (imageLoader*)param;
+
+	// the pool threads are shared, so the device only stays pinned while decoding
+	cudaDeviceScope device(loader->mOptions.cudaDevice);
+
+	while( loader->decodePrefetch() );
+}
+
+
+// decodePrefetch (returns false once the task should exit)
+bool imageLoader::decodePrefetch()
+{
+	mPrefetchMutex.Lock();
+
+	// exit if there isn't an image to decode or a free buffer to decode it into
+	// (Capture() submits the task again once it has returned an image)
+	if( mPrefetchStop || (mPrefetchEnd >= 0 && mNextDecode >= mPrefetchEnd) ||
+	    mNextDecode >= mNextCapture + (int64_t)mPrefetchDepth )
+	{
+		mPrefetchTasks--;
+		mPrefetchMutex.Unlock();
+		mDecodeEvent.Wake();
+		return false;
+	}
+
+	// claim the next image in the sequence
+	const int64_t sequence = mNextDecode++;
+	const size_t bufferIndex = sequence % mBuffers.size();
+	const imageFormat format = mPrefetchFormat;
+
+	PrefetchSlot& slot = mPrefetchSlots[bufferIndex];
+
+	slot.sequence = sequence;
+	slot.file     = mNextFile;
+	slot.loop     = mLoopCount;
+	slot.path     = mNextPath;
+	slot.ready    = false;
+	slot.failed   = false;
+
+	if( !advanceFile() )
+		mPrefetchEnd = mNextDecode;
+
+	const std::string file = slot.path;
+
+	// the buffer isn't touched by Capture() until the slot is ready
+	void* buffer = mBuffers[bufferIndex];
+	size_t bufferSize = mBufferSizes[bufferIndex];
+
+	mPrefetchMutex.Unlock();
+
+	int imgWidth  = 0;
+	int imgHeight = 0;
+
+	const bool result = loadImageScaled(file.c_str(), &buffer, &bufferSize, &imgWidth, &imgHeight, mScaleWidth, mScaleHeight, format);
+
+	if( !result )
+		LogError(LOG_IMAGE "imageLoader -- failed to load '%s'\n", file.c_str());
+
+	mPrefetchMutex.Lock();
+
+	mBuffers[bufferIndex]     = buffer;
+	mBufferSizes[bufferIndex] = bufferSize;
+
+	slot.width  = imgWidth;
+	slot.height = imgHeight;
+	slot.failed = !result;
+	slot.ready  = true;
+
+	mPrefetchMutex.Unlock();
+	mReadyEvent.Wake();
+
+	return true;
+}
+
+
+// capturePrefetch
+bool imageLoader::capturePrefetch( void** output, imageFormat format, uint64_t timeout )
+{
+	if( !mPrefetchStarted )
+	{
+		if( !startPrefetch(format) )
+			return false;
+	}
+	else if( format != mPrefetchFormat )
+	{
+		// restart the decoders in the new format, from the next image that hasn't been returned
+		LogVerbose(LOG_IMAGE "imageLoader -- restarting prefetch with format %s\n", imageFormatToStr(format));
+
+		stopPrefetch();
+
+		const PrefetchSlot& slot = mPrefetchSlots[mNextCapture % mPrefetchSlots.size()];
+
+		if( slot.sequence == mNextCapture && mStreamFiles )
+		{
+			// the stream can't seek back, so queue the images that weren't returned to be loaded again
+			std::deque< std::pair<std::string, size_t> > replay;
+
+			for( int64_t seq=mNextCapture; seq < mNextDecode; seq++ )
+			{
+				const PrefetchSlot& pending = mPrefetchSlots[seq % mPrefetchSlots.size()];
+
+				if( pending.sequence == seq )
+					replay.push_back(std::make_pair(pending.path, pending.loop));
+			}
+
+			if( mPrefetchEnd < 0 )
+				replay.push_back(std::make_pair(mNextPath, mLoopCount));
+
+			replay.insert(replay.end(), mReplay.begin(), mReplay.end());
+			mReplay.swap(replay);
+
+			advanceFile();
+		}
+		else if( slot.sequence == mNextCapture )
+		{
+			mNextFile  = slot.file;
+			mLoopCount = slot.loop;
+			mNextPath  = mFiles[mNextFile];
+		}
+
+		// the images that were already returned have to stay valid for numBuffers more frames,
+		// so the new format is decoded into new buffers and the old ones are retired until then
+		for( size_t n=0; n < mBuffers.size(); n++ )
+		{
+			if( mBuffers[n] != NULL )
+				mRetiredBuffers.push_back(mBuffers[n]);
+		}
+
+		mBuffers.assign(mBuffers.size(), NULL);
+		mBufferSizes.assign(mBufferSizes.size(), 0);
+		mRetiredCaptures = 0;
+
+		if( !startPrefetch(format) )
+			return false;
+	}
+
+	while( true )
+	{
+		mPrefetchMutex.Lock();
+
+		if( mPrefetchEnd >= 0 && mNextCapture >= mPrefetchEnd )
 		{
+			// the last images all failed to load
 			mEOS = true;
 			mStreaming = false;
+			mPrefetchMutex.Unlock();
+			return false;
 		}
+
+		const size_t bufferIndex = mNextCapture % mBuffers.size();
+		const PrefetchSlot& slot = mPrefetchSlots[bufferIndex];
+
+		if( slot.sequence == mNextCapture && slot.ready )
+		{
+			mNextCapture++;
+
+			const bool failed = slot.failed;
+
+			if( !failed )
+			{
+				mOptions.width  = slot.width;
+				mOptions.height = slot.height;
+				*output = mBuffers[bufferIndex];
+			}
+
+			if( mPrefetchEnd >= 0 && mNextCapture >= mPrefetchEnd )
+			{
+				mEOS = true;
+				mStreaming = false;
+			}
+
+			// a buffer was freed up, so decode another image
+			submitPrefetch();
+			mPrefetchMutex.Unlock();
+
+			// once the last numBuffers images returned are all from the new buffers
+			if( !failed && mRetiredBuffers.size() > 0 && ++mRetiredCaptures >= mOptions.numBuffers )
+				freeRetiredBuffers();
+
+			// skip over images that failed to load
+			if( failed )
+			{
+				if( mEOS )
+					return false;
+
+				continue;
+			}
+
+			return true;
+		}
+
+		mPrefetchMutex.Unlock();
+
+		if( !mReadyEvent.Wait(timeout) )
+			return false;
 	}
+}
 
-	// load the next image
-	void* imgPtr  = NULL;
-	int imgWidth  = 0;
-	int imgHeight = 0;
 
-	if( !loadImage(mFiles[currFile].c_str(), &imgPtr, &imgWidth, &imgHeight, format) )
+// SetCallback
+bool imageLoader::SetCallback( videoSourceCallback callback, imageFormat format, void* user )
+{
+	stopCallback();
+
+	// images are always loaded into an RGB format
+	mCallbackFormat = (format != IMAGE_UNKNOWN) ? format : IMAGE_RGB8;
+	mCallbackUser   = user;
+	mCallback       = callback;
+
+	if( !callback )
+		return true;
+
+	mCallbackStop   = false;
+	mCallbackThread = new Thread();
+
+	if( !mCallbackThread->Start(&imageLoader::callbackThread, this) )
 	{
-		LogError(LOG_IMAGE "imageLoader -- failed to load '%s'\n", mFiles[currFile].c_str());
-		return Capture(output, format, timeout);
-	}
+		LogError(LOG_IMAGE "imageLoader -- failed to start callback thread\n");
 
-	// set outputs
-	mOptions.width = imgWidth;
-	mOptions.height = imgHeight;
+		delete mCallbackThread;
+		mCallbackThread = NULL;
+		mCallback = NULL;
 
-	*output = imgPtr;
-	mBuffers.push_back(imgPtr);
+		return false;
+	}
 
 	return true;
 }
 
 
+// stopCallback
+void imageLoader::stopCallback()
+{
+	if( !mCallbackThread )
+		return;
+
+	mCallbackStop = true;
+	mCallbackThread->Stop(true);
+
+	delete mCallbackThread;
+	mCallbackThread = NULL;
+}
+
+
+// callbackThread
+void* imageLoader::callbackThread( void* param )
+{
+	imageLoader* loader = (imageLoader*)param;
+	cudaDeviceScope device(loader->mOptions.cudaDevice);
+
+	while( !loader->mCallbackStop && loader->deliverFrame() );
+
+	return NULL;
+}
+
+
+// deliverFrame (returns false once the end of the sequence was reached)
+bool imageLoader::deliverFrame()
+{
+	const double begin = timeDouble();
+
+	void* image = NULL;
+
+	if( !captureNext(&image, mCallbackFormat, DEFAULT_TIMEOUT) )
+		return !mEOS;
+
+	if( !flipCapture(&image, mCallbackFormat) )
+		return false;
+
+	mCallback(this, image, GetWidth(), GetHeight(), mCallbackFormat, mLastTimestamp, mCallbackUser);
+
+	// limit the rate that the images get pushed at
+	if( mOptions.frameRate > 0 )
+	{
+		const double elapsed = timeDouble() - begin;
+		const double interval = 1000.0 / mOptions.frameRate;
+
+		if( elapsed < interval )
+			sleepUs((interval - elapsed) * 1000.0);
+	}
+
+	return !mEOS;
+}
+
+
 // Open
 bool imageLoader::Open()
 {
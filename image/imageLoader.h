@@ -26,8 +26,16 @@
 
 #include "videoSource.h"
 
+#include "Thread.h"
+#include "Event.h"
+#include "Mutex.h"
+#include "ThreadPool.h"
+
+#include "filesystem.h"
+
 #include <string>
 #include <vector>
+#include <deque>
 
 
 /**
@@ -42,6 +50,27 @@
  * When given just the path to a directory, it will load all valid images from
  * that directory.
  *
+ * Normally the files are all listed and sorted alphanumerically before the first
+ * image is loaded.  For huge datasets, videoOptions::streamFiles (`--input-stream-files`)
+ * instead enumerates the directory lazily as the images are loaded (in the order that the
+ * filesystem returns them), so Capture() can start right away and the memory used stays
+ * constant.  A manifest file (`.txt` or `.lst`) with one image path per line can also be
+ * given as the path, and is always read lazily (in the order that it lists the images).
+ *
+ * If a width and height are set in the videoOptions (`--input-width` and `--input-height`),
+ * they're used as a hint for the smallest size that's needed, and JPEGs are decoded at a
+ * reduced resolution that's still at least that size (see loadImageScaled()).
+ *
+ * By default, each image is decoded when it's requested by Capture().  When the
+ * videoOptions::decodeThreads setting is non-zero (`--input-threads=N`), up to N
+ * of the upcoming images are decoded in parallel ahead of time instead, by tasks
+ * on the shared ThreadPool (see ThreadPool::Global()), so that Capture() only has
+ * to wait if the decoders haven't caught up yet.
+ *
+ * Instead of calling Capture(), the images can also be pushed to a callback by
+ * SetCallback(), which loads them on a thread of its own until the end of the
+ * sequence is reached (at the rate of videoOptions::frameRate, if it was set).
+ *
  * @note imageLoader implements the videoSource interface and is intended to
  * be used through that as opposed to directly.  videoSource implements
  * additional command-line parsing of videoOptions to construct instances.
@@ -79,6 +108,13 @@ public:
 	 */
 	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT );
 
+	/**
+	 * Push the images to a callback from a loading thread.
+	 * The callback shouldn't call SetCallback() itself.
+	 * @see videoSource::SetCallback()
+	 */
+	virtual bool SetCallback( videoSourceCallback callback, imageFormat format=IMAGE_RGB8, void* user=NULL );
+
 	/**
 	 * Open the stream.
 	 * @see videoSource::Open()
@@ -139,12 +175,77 @@ protected:
 
 	inline bool isLooping() const { return (mOptions.loop < 0) || ((mOptions.loop > 0) && (mLoopCount < mOptions.loop)); }
 
+	bool advanceFile();
+	bool nextStreamFile();
+	bool captureNext( void** output, imageFormat format, uint64_t timeout );
+
+	bool deliverFrame();
+	void stopCallback();
+
+	static void* callbackThread( void* param );
+
+	bool startPrefetch( imageFormat format );
+	void stopPrefetch();
+	void freeRetiredBuffers();
+	bool capturePrefetch( void** output, imageFormat format, uint64_t timeout );
+	bool decodePrefetch();
+	void submitPrefetch();
+
+	static void prefetchTask( void* param );
+
 	bool mEOS;
 	size_t mLoopCount;
+
+	uint32_t mScaleWidth;	// the minimum size requested in the videoOptions (or 0)
+	uint32_t mScaleHeight;
 	size_t mNextFile;
 	
-	std::vector<std::string> mFiles;
-	std::vector<void*> mBuffers;
+	std::string mNextPath;			// path of the next image to load
+	std::vector<std::string> mFiles;	// the sorted list of images (unless they're streamed)
+
+	// lazy enumeration of the images for videoOptions::streamFiles and manifests
+	bool      mStreamFiles;
+	size_t    mStreamLoop;	// the loop that mDirStream is on
+	dirStream mDirStream;
+
+	std::deque< std::pair<std::string, size_t> > mReplay;	// images (and their loop) to load again before streaming more
+
+	std::vector<void*> mBuffers;		// ring of numBuffers images, re-used for each file
+	std::vector<size_t> mBufferSizes;	// size of each buffer (in bytes), grows to the largest image
+	std::vector<void*> mRetiredBuffers;	// buffers from before a prefetch format change, freed once they cycle out
+	size_t mRetiredCaptures;			// images returned since the buffers were retired
+	size_t mNextBuffer;
+
+	// an image that's being decoded ahead of time (one per buffer)
+	struct PrefetchSlot
+	{
+		int64_t sequence;	// order that the image will be returned in
+		size_t  file;
+		size_t  loop;
+		std::string path;
+		int     width;
+		int     height;
+		bool    ready;
+		bool    failed;
+	};
+
+	std::vector<PrefetchSlot> mPrefetchSlots;
+	size_t mPrefetchTasks;	// decoding tasks that were submitted to the ThreadPool
+	bool   mPrefetchStarted;
+
+	imageFormat mPrefetchFormat;
+	size_t  mPrefetchDepth;	// the max number of images decoded ahead of Capture()
+	int64_t mPrefetchEnd;	// sequence after the last image (or -1 if not reached yet)
+	int64_t mNextDecode;	// sequence of the next image to decode
+	int64_t mNextCapture;	// sequence of the next image to return from Capture()
+	bool    mPrefetchStop;
+
+	Mutex mPrefetchMutex;
+	Event mDecodeEvent;		// raised when a decoding task has finished
+	Event mReadyEvent;		// raised when an image has finished decoding
+
+	Thread* mCallbackThread;	// loads the images for SetCallback()
+	bool    mCallbackStop;
 };
 
 #endif
@@ -23,6 +23,8 @@
 #include "imageWriter.h"
 #include "imageIO.h"
 
+#include "cudaMemoryPool.h"
+
 #include "filesystem.h"
 #include "logging.h"
 
@@ -61,6 +63,10 @@ imageWriter::imageWriter( const videoOptions& options ) : videoOutput(options)
 	mFileCount = 0;
 	mStreaming = true;
 
+	mQueuePending = 0;
+	mWriterTasks = 0;
+	mDropCount = 0;
+
 	// replace wildcards with %i
 	const size_t wildcard = mOptions.resource.location.find("*");
 	
@@ -72,7 +78,19 @@ imageWriter::imageWriter( const videoOptions& options ) : videoOutput(options)
 // destructor
 imageWriter::~imageWriter()
 {
+	Flush();
+
+	// wait for the tasks to exit after the queue was emptied
+	mQueueMutex.Lock();
+
+	while( mWriterTasks > 0 )
+	{
+		mQueueMutex.Unlock();
+		mFlushEvent.Wait(100);
+		mQueueMutex.Lock();
+	}
 
+	mQueueMutex.Unlock();
 }
 
 
@@ -94,9 +112,20 @@ imageWriter* imageWriter::Create( const char* resource, const videoOptions& opti
 
 // Render
 bool imageWriter::Render( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	return Render(image, width, height, format, NULL);
+}
+
+
+// Render
+bool imageWriter::Render( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream )
 {
 	const bool substreams_success = videoOutput::Render(image, width, height, format);
 
+	// skip frames that look the same as the last one saved (see videoOptions::dedupFrames)
+	if( isDuplicate(image, width, height, format, stream) )
+		return substreams_success;
+
 	if( mOptions.resource.location.find("%") != std::string::npos )
 	{
 		// path has a format (should be '%u' or '%i')
@@ -115,15 +144,109 @@ bool imageWriter::Render( void* image, uint32_t width, uint32_t height, imageFor
 		strcpy(mFileOut, mOptions.resource.location.c_str());
 	}
 
-	//CUDA(cudaDeviceSynchronize());   // now done in saveImage()
-	
-	// save the image
-	if( !saveImage(mFileOut, image, width, height, format) )
+	// save the image synchronously if there aren't any writer threads
+	if( mOptions.writeThreads == 0 )
+	{
+		if( stream != NULL )
+			CUDA(cudaStreamSynchronize(stream));
+
+		if( !saveImage(mFileOut, image, width, height, format) )
+		{
+			LogError(LOG_IMAGE "imageWriter -- failed to save '%s'\n", mFileOut);
+			return false;
+		}
+
+		mOptions.width  = width;
+		mOptions.height = height;
+
+		mFileCount++;
+		return substreams_success;
+	}
+
+	// apply the drop/block policy when the queue is full
+	if( mOptions.writeQueueSize > 0 )
+	{
+		mQueueMutex.Lock();
+
+		while( mQueue.size() >= mOptions.writeQueueSize )
+		{
+			if( mOptions.writeDropFrames )
+			{
+				mDropCount++;
+				mQueueMutex.Unlock();
+
+				LogWarning(LOG_IMAGE "imageWriter -- queue is full, dropped frame for '%s' (%llu dropped)\n", mFileOut, (unsigned long long)mDropCount);
+				return false;
+			}
+
+			mQueueMutex.Unlock();
+			mFlushEvent.Wait(100);
+			mQueueMutex.Lock();
+		}
+
+		mQueueMutex.Unlock();
+	}
+
+	// copy the image so the caller can re-use it, and queue it to be saved
+	WriteRequest request;
+
+	request.path   = mFileOut;
+	request.image  = NULL;
+	request.width  = width;
+	request.height = height;
+	request.format = format;
+	request.event  = NULL;
+
+	const size_t size = imageFormatSize(format, width, height);
+
+	if( !cudaAllocMappedPooled(&request.image, size) )
+	{
+		LogError(LOG_IMAGE "imageWriter -- failed to allocate %zu bytes to queue '%s'\n", size, mFileOut);
+		return false;
+	}
+
+	if( CUDA_FAILED(cudaMemcpyAsync(request.image, image, size, cudaMemcpyDefault, stream)) ||
+	    CUDA_FAILED(cudaEventCreateWithFlags(&request.event, cudaEventDisableTiming)) ||
+	    CUDA_FAILED(cudaEventRecord(request.event, stream)) )
 	{
-		LogError(LOG_IMAGE "imageWriter -- failed to save '%s'\n", mFileOut);
+		LogError(LOG_IMAGE "imageWriter -- failed to copy '%s' into the queue\n", mFileOut);
+
+		if( request.event != NULL )
+			CUDA(cudaEventDestroy(request.event));
+
+		cudaFreePooled(request.image);
 		return false;
 	}
 
+	mQueueMutex.Lock();
+
+	mQueue.push_back(request);
+	mQueuePending++;
+
+	// each task saves images until the queue is empty
+	if( mWriterTasks < mOptions.writeThreads )
+	{
+		ThreadPool* pool = ThreadPool::Global();
+
+		if( pool != NULL && pool->Submit(&imageWriter::writerTask, this) )
+			mWriterTasks++;
+	}
+
+	// if there aren't any tasks to save it, save it on this thread instead
+	const bool saveNow = (mWriterTasks == 0);
+	mQueueMutex.Unlock();
+
+	if( saveNow )
+	{
+		LogError(LOG_IMAGE "imageWriter -- failed to submit a task to the thread pool, saving '%s' synchronously\n", mFileOut);
+		
+		mQueueMutex.Lock();
+		mWriterTasks++;
+		mQueueMutex.Unlock();
+
+		while( processQueue() );
+	}
+
 	mOptions.width  = width;
 	mOptions.height = height;
 
@@ -132,3 +255,73 @@ bool imageWriter::Render( void* image, uint32_t width, uint32_t height, imageFor
 	return substreams_success;
 }
 
+
+
+// Close
+void imageWriter::Close()
+{
+	Flush();
+	videoOutput::Close();
+}
+
+
+// Flush
+void imageWriter::Flush()
+{
+	while( true )
+	{
+		mQueueMutex.Lock();
+		const size_t pending = mQueuePending;
+		mQueueMutex.Unlock();
+
+		if( pending == 0 )
+			break;
+
+		mFlushEvent.Wait(100);
+	}
+}
+
+
+// writerTask
+void imageWriter::writerTask( void* param )
+{
+	imageWriter* writer = (imageWriter*)param;
+
+	while( writer->processQueue() );
+}
+
+
+// processQueue (returns false once the task should exit)
+bool imageWriter::processQueue()
+{
+	mQueueMutex.Lock();
+
+	if( mQueue.size() == 0 )
+	{
+		mWriterTasks--;
+		mQueueMutex.Unlock();
+		mFlushEvent.Wake();
+		return false;
+	}
+
+	WriteRequest request = mQueue.front();
+	mQueue.pop_front();
+
+	mQueueMutex.Unlock();
+
+	// wait for the copy to finish, then encode and save the image
+	CUDA(cudaEventSynchronize(request.event));
+	CUDA(cudaEventDestroy(request.event));
+
+	if( !saveImage(request.path.c_str(), request.image, request.width, request.height, request.format, 95, make_float2(0,255), false) )
+		LogError(LOG_IMAGE "imageWriter -- failed to save '%s'\n", request.path.c_str());
+
+	cudaFreePooled(request.image);
+
+	mQueueMutex.Lock();
+	mQueuePending--;
+	mQueueMutex.Unlock();
+
+	mFlushEvent.Wake();
+	return true;
+}
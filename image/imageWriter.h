@@ -26,6 +26,15 @@
 
 #include "videoOutput.h"
 
+#include "Thread.h"
+#include "Event.h"
+#include "Mutex.h"
+#include "ThreadPool.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
 
 /**
  * Save an image or set of images to disk.
@@ -40,6 +49,17 @@
  * When given just the path of a directory as output, it will default to
  * incremental `%i.jpg` sequencing and save in JPG format.
  *
+ * Render() doesn't wait for the images to be encoded and written to disk.
+ * Instead, each frame is copied into a queue that tasks on the shared ThreadPool
+ * save from, so that slow encoding or storage doesn't stall the render loop.
+ * The max number of images saved in parallel and the size of the queue are set
+ * by videoOptions (`--output-threads` and `--output-queue`).  When the queue is full, Render()
+ * either blocks until there's room or drops the frame (`--output-drop`).
+ * The queue is flushed when the imageWriter is closed or destroyed.
+ *
+ * When recording datasets, frames that are near-duplicates of the last image saved
+ * can be skipped with a GPU perceptual hash (`--output-dedup`, see videoOptions::dedupFrames).
+ *
  * @note imageWriter implements the videoOutput interface and is intended to
  * be used through that as opposed to directly.  videoOutput implements
  * additional command-line parsing of videoOptions to construct instances.
@@ -71,12 +91,37 @@ public:
 	 */
 	template<typename T> bool Render( T* image, uint32_t width, uint32_t height )		{ return Render((void**)image, width, height, imageFormatFromType<T>()); }
 	
+	/**
+	 * Save the next frame, where the image was produced on the given CUDA stream.
+	 * @see videoOutput::Render()
+	 */
+	template<typename T> bool Render( T* image, uint32_t width, uint32_t height, cudaStream_t stream )	{ return Render((void*)image, width, height, imageFormatFromType<T>(), stream); }
+
 	/**
 	 * Save the next frame.
 	 * @see videoOutput::Render()
 	 */
 	virtual bool Render( void* image, uint32_t width, uint32_t height, imageFormat format );
 
+	/**
+	 * Save the next frame, where the image was produced on the given CUDA stream.
+	 * The copy into the write queue and its completion event are issued on that stream,
+	 * so they're ordered after the work that produced the image without a device sync.
+	 * @see videoOutput::Render()
+	 */
+	bool Render( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream );
+
+	/**
+	 * Close the stream, after waiting for the queued images to be saved.
+	 * @see videoOutput::Close()
+	 */
+	virtual void Close();
+
+	/**
+	 * Wait until all of the queued images have been saved to disk.
+	 */
+	void Flush();
+
 	/**
 	 * Return the interface type (imageWriter::Type)
 	 */
@@ -110,8 +155,31 @@ public:
 protected:
 	imageWriter( const videoOptions& options );
 
+	// an image waiting to be saved by a writer task
+	struct WriteRequest
+	{
+		std::string path;
+		void*       image;
+		uint32_t    width;
+		uint32_t    height;
+		imageFormat format;
+		cudaEvent_t event;	// recorded after the image was copied
+	};
+
+	bool processQueue();
+	static void writerTask( void* param );
+
 	uint32_t mFileCount;
 	char     mFileOut[1024];
+
+	std::deque<WriteRequest> mQueue;
+	size_t mQueuePending;	// requests queued or being saved
+
+	size_t   mWriterTasks;	// tasks that were submitted to the ThreadPool
+	uint64_t mDropCount;
+
+	Mutex mQueueMutex;
+	Event mFlushEvent;		// raised when a request has been saved
 };
 
 #endif
@@ -27,9 +27,14 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
 #include <linux/input.h>
 #include <sys/ioctl.h>
 
+#include "SocketPoller.h"
 #include "logging.h"
 
 
@@ -38,13 +43,21 @@ InputDevices::InputDevices()
 {
 	mKeyboard = NULL;
 	mJoystick = NULL;
+	mPoller   = NULL;
+
+	mCallback     = NULL;
+	mCallbackUser = NULL;
+
+	mQueueHead    = 0;
+	mQueueTail    = 0;
+	mQueueDropped = 0;
 }
 
 
 // destructor
 InputDevices::~InputDevices()
 {
-
+	Stop();
 }
 
 
@@ -70,6 +83,9 @@ bool InputDevices::Poll( uint32_t timeout )
 	if( !mKeyboard && !mJoystick )
 		return false;
 
+	if( mPoller != NULL )
+		return true;
+
 	if( mKeyboard != NULL )
 		mKeyboard->Poll(timeout);
 	
@@ -80,6 +96,177 @@ bool InputDevices::Poll( uint32_t timeout )
 }
 
 
+// Start
+bool InputDevices::Start( InputEventCallback callback, void* user )
+{
+	if( mPoller != NULL )
+		return true;
+
+	if( !mKeyboard && !mJoystick )
+		return false;
+
+	mCallback     = callback;
+	mCallbackUser = user;
+
+	mPoller = SocketPoller::Create();
+
+	if( !mPoller )
+		return false;
+
+	if( (mKeyboard != NULL && !mPoller->AddFD(mKeyboard->GetFD(), onReadable, this)) ||
+	    (mJoystick != NULL && !mPoller->AddFD(mJoystick->GetFD(), onReadable, this)) ||
+	    !mPoller->Start() )
+	{
+		LogError("input -- failed to start polling the input devices\n");
+		Stop();
+		return false;
+	}
+
+	return true;
+}
+
+
+// Stop
+void InputDevices::Stop()
+{
+	if( !mPoller )
+		return;
+
+	delete mPoller;	// stops the thread
+	mPoller = NULL;
+}
+
+
+// onReadable (called from the SocketPoller thread)
+void InputDevices::onReadable( int fd, uint32_t events, void* user )
+{
+	InputDevices* mgr = (InputDevices*)user;
+
+	const int max_ev = 64;
+	InputEvent ev[max_ev];
+
+	// read until the device has no more pending events
+	while( true )
+	{
+		int num_ev = 0;
+
+		if( mgr->mKeyboard != NULL && fd == mgr->mKeyboard->GetFD() )
+			num_ev = mgr->mKeyboard->Read(ev, max_ev);
+		else if( mgr->mJoystick != NULL && fd == mgr->mJoystick->GetFD() )
+			num_ev = mgr->mJoystick->Read(ev, max_ev);
+
+		if( num_ev <= 0 )
+			break;
+
+		mgr->pushEvents(ev, num_ev);
+	}
+
+	// stop polling devices that were unplugged
+	if( events & SocketPoller::HANGUP )
+		mgr->mPoller->RemoveFD(fd);
+}
+
+
+// pushEvents (called from the SocketPoller thread)
+void InputDevices::pushEvents( const InputEvent* events, int count )
+{
+	for( int n=0; n < count; n++ )
+	{
+		// the SYN events only separate the packets of events
+		if( events[n].type == EV_SYN )
+			continue;
+
+		if( mCallback != NULL )
+			mCallback(events[n], mCallbackUser);
+
+		const uint32_t head = mQueueHead.load(std::memory_order_relaxed);
+
+		if( head - mQueueTail.load(std::memory_order_acquire) >= INPUT_EVENT_QUEUE_SIZE )
+		{
+			mQueueDropped++;
+			continue;
+		}
+
+		mQueue[head % INPUT_EVENT_QUEUE_SIZE] = events[n];
+		mQueueHead.store(head + 1, std::memory_order_release);
+	}
+}
+
+
+// GetEvent
+bool InputDevices::GetEvent( InputEvent* event )
+{
+	if( !event )
+		return false;
+
+	const uint32_t tail = mQueueTail.load(std::memory_order_relaxed);
+
+	if( tail == mQueueHead.load(std::memory_order_acquire) )
+		return false;
+
+	*event = mQueue[tail % INPUT_EVENT_QUEUE_SIZE];
+	mQueueTail.store(tail + 1, std::memory_order_release);
+
+	return true;
+}
+
+
+// inputEventClock
+bool inputEventClock( int fd )
+{
+	int clock = CLOCK_MONOTONIC;
+
+	if( ioctl(fd, EVIOCSCLOCKID, &clock) != 0 )
+	{
+		LogWarning("input -- failed to set the event clock to CLOCK_MONOTONIC (errno=%i) (%s)\n", errno, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+
+// inputEventRead
+int inputEventRead( int fd, uint32_t device, InputEvent* events, int maxEvents )
+{
+	if( fd < 0 || !events || maxEvents <= 0 )
+		return -1;
+
+	const int max_ev = 64;
+	struct input_event ev[max_ev];
+
+	const int bytesRead = read(fd, ev, sizeof(struct input_event) * ((maxEvents < max_ev) ? maxEvents : max_ev));
+
+	if( bytesRead < 0 )
+	{
+		if( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR )
+			return 0;
+
+		LogError("input -- read() failed (errno=%i) (%s)\n", errno, strerror(errno));
+		return -1;
+	}
+
+	if( bytesRead < (int)sizeof(struct input_event) ) 
+	{
+		LogError("input -- read() expected %d bytes, got %d\n", (int)sizeof(struct input_event), bytesRead);
+		return -1;
+	}
+
+	const int num_ev = bytesRead / sizeof(struct input_event);
+
+	for( int i = 0; i < num_ev; i++ )
+	{
+		events[i].timestamp = (uint64_t)ev[i].time.tv_sec * uint64_t(1000000000) + (uint64_t)ev[i].time.tv_usec * 1000;
+		events[i].device    = device;
+		events[i].type      = ev[i].type;
+		events[i].code      = ev[i].code;
+		events[i].value     = ev[i].value;
+	}
+
+	return num_ev;
+}
+
+
 // Path used to look for input devices
 #define DEV_PATH "/dev/input"
 //#define DEV_PATH "/dev/input/by-path"
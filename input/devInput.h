@@ -26,10 +26,22 @@
 #include "devKeyboard.h"
 #include "devJoystick.h"
 
+#include <atomic>
 #include <utility>
 #include <vector>
 
 
+/**
+ * The number of events that the InputDevices queue can hold (should be a power of two).
+ * @ingroup input
+ */
+#define INPUT_EVENT_QUEUE_SIZE 256
+
+
+// forward declarations
+class SocketPoller;
+
+
 /**
  * Typedef of device <path, name> pairs
  * @ingroup input
@@ -39,6 +51,13 @@ typedef std::vector< std::pair<std::string, std::string> > DeviceList;
 
 /**
  * Input device manager
+ *
+ * The devices can either be polled from the application's loop with Poll(), or be
+ * serviced by a thread with Start(), which epolls all of them at once and reads each
+ * event as soon as it arrives.  Then the key and axis states are always current, and
+ * the events (with their kernel timestamps) can be retrieved with GetEvent() from a
+ * lock-free queue, or be handled by a callback on the thread as they arrive.
+ *
  * @ingroup input
  */
 class InputDevices
@@ -56,9 +75,39 @@ public:
 
 	/**
 	 * Poll the devices for updates
+	 * (while the thread from Start() is running, the states are already up-to-date)
 	 */
 	bool Poll( uint32_t timeout=0 );
 
+	/**
+	 * Start a thread that epolls the devices and reads their events as they arrive.
+	 * @param callback optional function that gets called from the thread for each event
+	 *                 (it should return quickly).  The events are also queued for GetEvent().
+	 */
+	bool Start( InputEventCallback callback=NULL, void* user=NULL );
+
+	/**
+	 * Stop the thread (and wait for it to exit).
+	 */
+	void Stop();
+
+	/**
+	 * Return true if the thread from Start() is running.
+	 */
+	inline bool IsThreaded() const				{ return mPoller != NULL; }
+
+	/**
+	 * Retrieve the oldest event from the queue, without blocking.
+	 * This should only be called from one thread at a time.
+	 * @returns `true` if an event was retrieved, or `false` if the queue was empty.
+	 */
+	bool GetEvent( InputEvent* event );
+
+	/**
+	 * Get the number of events that were discarded because the queue was full.
+	 */
+	inline uint64_t GetDroppedEvents() const		{ return mQueueDropped; }
+
 	/**
  	 * Retrieve the keyboard device
 	 */
@@ -83,8 +132,23 @@ protected:
 	// constructor
 	InputDevices();
 
+	void pushEvents( const InputEvent* events, int count );
+
+	static void onReadable( int fd, uint32_t events, void* user );
+
 	KeyboardDevice* mKeyboard;
 	JoystickDevice* mJoystick;
+
+	SocketPoller* mPoller;
+
+	InputEventCallback mCallback;
+	void*              mCallbackUser;
+
+	// single-producer (the thread), single-consumer (GetEvent) ring
+	InputEvent            mQueue[INPUT_EVENT_QUEUE_SIZE];
+	std::atomic<uint32_t> mQueueHead;	// next slot to write
+	std::atomic<uint32_t> mQueueTail;	// next slot to read
+	std::atomic<uint64_t> mQueueDropped;
 };
 
 #endif
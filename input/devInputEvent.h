@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __DEV_INPUT_EVENT_H__
+#define __DEV_INPUT_EVENT_H__
+
+#include <stdint.h>
+
+
+/**
+ * The kind of device that an InputEvent came from.
+ * @ingroup input
+ */
+enum InputEventDevice
+{
+	INPUT_KEYBOARD = 0,	/**< The event came from the KeyboardDevice */
+	INPUT_JOYSTICK		/**< The event came from the JoystickDevice */
+};
+
+
+/**
+ * An evdev event (see linux/input-event-codes.h for the types and codes),
+ * along with the time that the kernel recieved it.
+ * @ingroup input
+ */
+struct InputEvent
+{
+	uint64_t timestamp;	/**< Kernel timestamp of the event, in nanoseconds of CLOCK_MONOTONIC */
+	uint32_t device;	/**< The InputEventDevice that the event came from */
+	uint16_t type;		/**< Event type (e.g. EV_KEY or EV_ABS) */
+	uint16_t code;		/**< Event code (e.g. the key or the axis) */
+	int32_t  value;	/**< Event value (e.g. 0/1/2 for key release/press/repeat, or the axis position) */
+};
+
+
+/**
+ * Function pointer typedef of the callback that InputDevices runs on its thread for each event.
+ * @see InputDevices::Start()
+ * @ingroup input
+ */
+typedef void (*InputEventCallback)( const InputEvent& event, void* user );
+
+
+/**
+ * Read the pending evdev events from a device that was opened non-blocking, with up to
+ * `maxEvents` of them copied into `events` (which can be NULL if they're only counted).
+ * The device's clock is expected to be CLOCK_MONOTONIC (see inputEventClock()).
+ * @returns the number of events read, 0 if none were pending, or -1 on error.
+ * @ingroup input
+ */
+int inputEventRead( int fd, uint32_t device, InputEvent* events, int maxEvents );
+
+
+/**
+ * Switch the timestamps of an evdev device to CLOCK_MONOTONIC (from CLOCK_REALTIME),
+ * so they can be compared with the timestamps of frames and other sensors.
+ * @ingroup input
+ */
+bool inputEventClock( int fd );
+
+#endif
+
@@ -62,7 +62,7 @@ JoystickDevice* JoystickDevice::Create( const char* name )
 		return NULL;
 	}
 
-	const int fd = open(path.c_str(), O_RDONLY);
+	const int fd = open(path.c_str(), O_RDONLY|O_NONBLOCK);
 
 	if( fd == -1 )
 	{
@@ -70,6 +70,8 @@ JoystickDevice* JoystickDevice::Create( const char* name )
 		return NULL;
 	}
 
+	inputEventClock(fd);
+
 	JoystickDevice* joy = new JoystickDevice();
 
 	joy->mFD   = fd;
@@ -84,7 +86,7 @@ JoystickDevice* JoystickDevice::Create( const char* name )
 bool JoystickDevice::Poll( uint32_t timeout )
 {
 	const uint32_t max_ev = 64;
-	struct input_event ev[max_ev];
+	InputEvent ev[max_ev];
 
 	fd_set fds;
 	FD_ZERO(&fds);
@@ -110,16 +112,21 @@ bool JoystickDevice::Poll( uint32_t timeout )
 		return false;	// timeout, not necessarily an error (TRY_AGAIN)
 	}
 
-	const int bytesRead = read(mFD, ev, sizeof(struct input_event) * max_ev);
+	return Read(ev, max_ev) > 0;
+}
+
 
-	if( bytesRead < (int)sizeof(struct input_event) ) 
+// Read
+int JoystickDevice::Read( InputEvent* ev, int max_ev )
+{
+	const int num_ev = inputEventRead(mFD, INPUT_JOYSTICK, ev, max_ev);
+
+	if( num_ev < 0 )
 	{
-		LogError("joystick -- read() expected %d bytes, got %d\n", (int)sizeof(struct input_event), bytesRead);
-		return false;
+		LogError("joystick -- failed to read events from %s\n", mPath.c_str());
+		return -1;
 	}
 
-	const int num_ev = bytesRead / sizeof(struct input_event);
-
 	for( int i = 0; i < num_ev; i++ ) 
 	{
 		if( ev[i].type == EV_ABS )
@@ -137,7 +144,7 @@ bool JoystickDevice::Poll( uint32_t timeout )
 		}
 	}
 
-	return true;	
+	return num_ev;
 }
 
 
@@ -28,6 +28,8 @@
 #include <string.h>
 #include <string>
 
+#include "devInputEvent.h"
+
 
 /**
  * Joystick device
@@ -51,6 +53,24 @@ public:
 	 */
 	bool Poll( uint32_t timeout=0 );
 
+	/**
+	 * Read the events that are pending without blocking, and update the state of the axes.
+	 * @param events buffer that the events get copied to
+	 * @param maxEvents the size of the buffer (in events)
+	 * @returns the number of events read, 0 if none were pending, or -1 on error.
+	 */
+	int Read( InputEvent* events, int maxEvents );
+
+	/**
+	 * Get the raw value of an axis (or 0 if it hasn't moved yet)
+	 */
+	inline int GetAxis( uint32_t axis ) const	{ return (axis < MAX_AXIS) ? mAxisRaw[axis] : 0; }
+
+	/**
+	 * Get the file descriptor of the device (which can be polled for readability)
+	 */
+	inline int GetFD() const			{ return mFD; }
+
 protected:
 	// constructor
 	JoystickDevice();
@@ -58,7 +78,7 @@ protected:
 	static const int MAX_AXIS = 256;
 
 	float mAxisNorm[MAX_AXIS];
-	int   mAxisRaw[MAX_AXIS];	
+	int   mAxisRaw[MAX_AXIS];	// updated from the InputDevices thread when it's running
 	int   mFD;
 
 	std::string mPath;
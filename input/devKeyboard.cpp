@@ -52,7 +52,7 @@ KeyboardDevice* KeyboardDevice::Create( const char* path )
 	if( !path )
 		return NULL;
 
-	const int fd = open(path, O_RDONLY);
+	const int fd = open(path, O_RDONLY|O_NONBLOCK);
 
 	if( fd == -1 )
 	{
@@ -60,6 +60,8 @@ KeyboardDevice* KeyboardDevice::Create( const char* path )
 		return NULL;
 	}
 
+	inputEventClock(fd);
+
 	KeyboardDevice* kbd = new KeyboardDevice();
 
 	kbd->mFD   = fd;
@@ -73,7 +75,7 @@ KeyboardDevice* KeyboardDevice::Create( const char* path )
 bool KeyboardDevice::Poll( uint32_t timeout )
 {
 	const uint32_t max_ev = 64;
-	struct input_event ev[max_ev];
+	InputEvent ev[max_ev];
 
 	fd_set fds;
 	FD_ZERO(&fds);
@@ -99,16 +101,21 @@ bool KeyboardDevice::Poll( uint32_t timeout )
 		return false;	// timeout, not necessarily an error (TRY_AGAIN)
 	}
 
-	const int bytesRead = read(mFD, ev, sizeof(struct input_event) * max_ev);
+	return Read(ev, max_ev) > 0;
+}
+
 
-	if( bytesRead < (int)sizeof(struct input_event) ) 
+// Read
+int KeyboardDevice::Read( InputEvent* ev, int max_ev )
+{
+	const int num_ev = inputEventRead(mFD, INPUT_KEYBOARD, ev, max_ev);
+
+	if( num_ev < 0 )
 	{
-		LogError("keyboard -- read() expected %d bytes, got %d\n", (int)sizeof(struct input_event), bytesRead);
-		return false;
+		LogError("keyboard -- failed to read events from %s\n", mPath.c_str());
+		return -1;
 	}
 
-	const int num_ev = bytesRead / sizeof(struct input_event);
-
 	for( int i = 0; i < num_ev; i++ ) 
 	{
 		if( ev[i].type != EV_KEY )
@@ -125,7 +132,7 @@ bool KeyboardDevice::Poll( uint32_t timeout )
 		LogDebug("keyboard -- code %02u  value %i\n", ev[i].code, ev[i].value);
 	}
 
-	return true;	
+	return num_ev;
 }
 
 
@@ -30,6 +30,8 @@
 
 #include <linux/input-event-codes.h>
 
+#include "devInputEvent.h"
+
 
 /**
  * Keyboard device
@@ -53,18 +55,31 @@ public:
 	 */
 	bool Poll( uint32_t timeout=0 );
 
+	/**
+	 * Read the events that are pending without blocking, and update the state of the keys.
+	 * @param events buffer that the events get copied to
+	 * @param maxEvents the size of the buffer (in events)
+	 * @returns the number of events read, 0 if none were pending, or -1 on error.
+	 */
+	int Read( InputEvent* events, int maxEvents );
+
 	/**
 	 * Check if a particular key is pressed
 	 */
 	bool KeyDown( uint32_t code ) const;
 
+	/**
+	 * Get the file descriptor of the device (which can be polled for readability)
+	 */
+	inline int GetFD() const			{ return mFD; }
+
 protected:
 	// constructor
 	KeyboardDevice();
 
 	static const int MAX_KEYS = 256;
 
-	int  mKeyMap[MAX_KEYS];
+	int  mKeyMap[MAX_KEYS];	// updated from the InputDevices thread when it's running
 	int  mFD;
 
 	std::string mPath;
@@ -21,13 +21,190 @@
  */
  
 #include "logging.h"
+
 #include <strings.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
 
 
 // set default logging options
 Log::Level Log::mLevel = Log::DEFAULT;
 FILE* Log::mFile = stdout;
 std::string Log::mFilename = "stdout";
+std::atomic<bool> Log::mAsync(false);
+
+
+//-------------------------------------------------------------------------------
+// single-producer/single-consumer queue of messages from one thread, where each
+// record is the message length followed by the formatted text.  The producer only
+// writes `head` and the consumer (the writer thread) only writes `tail`.
+struct LogQueue
+{
+	char buffer[LOG_ASYNC_QUEUE_SIZE];
+
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+	std::atomic<uint32_t> dropped;
+	std::atomic<bool>     closed;	// the thread exited, so the queue can be reused
+
+	LogQueue* next;
+};
+
+static std::atomic<LogQueue*> gLogQueues(NULL);	// queues are only added, never removed
+
+static pthread_t gLogThread;
+static std::atomic<bool> gLogThreadRunning(false);
+static std::atomic<uint32_t> gLogProducers(0);	// threads inside Log::Write() that may still enqueue
+static bool gLogExitRegistered = false;
+
+
+// LogQueueHandle (marks the queue of an exiting thread as available)
+struct LogQueueHandle
+{
+	LogQueue* queue;
+
+	LogQueueHandle() : queue(NULL) 	{ }
+	~LogQueueHandle()				{ if( queue != NULL ) queue->closed.store(true, std::memory_order_release); }
+};
+
+static thread_local LogQueueHandle gLogQueueHandle;
+
+
+// logGetQueue
+static LogQueue* logGetQueue()
+{
+	if( gLogQueueHandle.queue != NULL )
+		return gLogQueueHandle.queue;
+
+	// reuse the queue of a thread that already exited
+	for( LogQueue* queue = gLogQueues.load(std::memory_order_acquire); queue != NULL; queue = queue->next )
+	{
+		bool closed = true;
+
+		if( queue->closed.compare_exchange_strong(closed, false, std::memory_order_acq_rel) )
+		{
+			gLogQueueHandle.queue = queue;
+			return queue;
+		}
+	}
+
+	// otherwise allocate a new one and push it onto the list
+	LogQueue* queue = new LogQueue();
+
+	if( !queue )
+		return NULL;
+
+	queue->head    = 0;
+	queue->tail    = 0;
+	queue->dropped = 0;
+	queue->closed  = false;
+	queue->next    = gLogQueues.load(std::memory_order_relaxed);
+
+	while( !gLogQueues.compare_exchange_weak(queue->next, queue, std::memory_order_release, std::memory_order_relaxed) );
+
+	gLogQueueHandle.queue = queue;
+	return queue;
+}
+
+
+// logQueueCopy (copies into/out of the queue, wrapping around the end of the buffer)
+static inline void logQueueCopy( char* dst, const char* src, uint32_t offset, uint32_t size, bool write )
+{
+	const uint32_t first = LOG_ASYNC_QUEUE_SIZE - offset;
+
+	if( write )
+	{
+		if( size <= first )
+			memcpy(dst + offset, src, size);
+		else
+		{
+			memcpy(dst + offset, src, first);
+			memcpy(dst, src + first, size - first);
+		}
+	}
+	else
+	{
+		if( size <= first )
+			memcpy(dst, src + offset, size);
+		else
+		{
+			memcpy(dst, src + offset, first);
+			memcpy(dst + first, src, size - first);
+		}
+	}
+}
+
+
+// logDrainQueues (returns the number of bytes that were written)
+static size_t logDrainQueues()
+{
+	FILE* file = Log::GetFile();
+	size_t written = 0;
+
+	char message[1024];
+
+	for( LogQueue* queue = gLogQueues.load(std::memory_order_acquire); queue != NULL; queue = queue->next )
+	{
+		uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+		const uint32_t head = queue->head.load(std::memory_order_acquire);
+
+		while( tail != head )
+		{
+			uint32_t length = 0;
+			logQueueCopy((char*)&length, queue->buffer, tail % LOG_ASYNC_QUEUE_SIZE, sizeof(uint32_t), false);
+			tail += sizeof(uint32_t);
+
+			// copy the message out in chunks, in case it wraps around the buffer
+			for( uint32_t n=0; n < length; n += sizeof(message) )
+			{
+				const uint32_t size = (length - n < sizeof(message)) ? length - n : sizeof(message);
+				logQueueCopy(message, queue->buffer, (tail + n) % LOG_ASYNC_QUEUE_SIZE, size, false);
+				fwrite(message, 1, size, file);
+			}
+
+			tail += length;
+			written += length;
+		}
+
+		queue->tail.store(tail, std::memory_order_release);
+
+		const uint32_t dropped = queue->dropped.exchange(0, std::memory_order_relaxed);
+
+		if( dropped > 0 )
+			written += fprintf(file, "[log]  dropped %u messages (the async queue of a thread was full)\n", dropped);
+	}
+
+	if( written > 0 )
+		fflush(file);
+
+	return written;
+}
+
+
+// logThread
+static void* logThread( void* /*user*/ )
+{
+	while( gLogThreadRunning.load(std::memory_order_acquire) )
+	{
+		if( logDrainQueues() == 0 )
+			usleep(2000);
+	}
+
+	return NULL;
+}
+
+
+// logExit
+static void logExit()
+{
+	Log::SetAsync(false);
+}
 
 
 // ParseCmdLine
@@ -56,6 +233,136 @@ void Log::ParseCmdLine( const commandLine& cmdLine )
 	}
 
 	SetFile(cmdLine.GetString("log-file"));
+
+	if( cmdLine.GetFlag("log-async") )
+		SetAsync(true);
+}
+
+
+// SetAsync
+void Log::SetAsync( bool async )
+{
+	if( async == gLogThreadRunning.load() )
+		return;
+
+	if( async )
+	{
+		gLogThreadRunning = true;
+
+		if( pthread_create(&gLogThread, NULL, logThread, NULL) != 0 )
+		{
+			gLogThreadRunning = false;
+			LogError("failed to create thread for asynchronous logging\n");
+			return;
+		}
+
+		// make sure the queues get written when the process exits
+		if( !gLogExitRegistered )
+		{
+			atexit(logExit);
+			gLogExitRegistered = true;
+		}
+
+		mAsync = true;
+	}
+	else
+	{
+		// new messages get written directly, then the queues are drained
+		mAsync = false;
+		gLogThreadRunning = false;
+
+		pthread_join(gLogThread, NULL);
+
+		// wait for the threads that saw mAsync before it changed to finish enqueueing,
+		// then the final drain picks up everything that was queued
+		while( gLogProducers.load() > 0 )
+			sched_yield();
+
+		logDrainQueues();
+	}
+}
+
+
+// Flush
+void Log::Flush()
+{
+	if( !gLogThreadRunning.load() )
+		return;
+
+	// wait for the writer thread to catch up with the messages queued so far
+	for( LogQueue* queue = gLogQueues.load(std::memory_order_acquire); queue != NULL; queue = queue->next )
+	{
+		const uint32_t head = queue->head.load(std::memory_order_acquire);
+
+		while( gLogThreadRunning.load() && (int32_t)(head - queue->tail.load(std::memory_order_acquire)) > 0 )
+			usleep(1000);
+	}
+}
+
+
+// Write
+void Log::Write( const char* format, ... )
+{
+	char stackBuffer[512];
+	char* message = stackBuffer;
+
+	va_list args;
+	va_start(args, format);
+	const int length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+	va_end(args);
+
+	if( length <= 0 )
+		return;
+
+	// long messages get formatted again into a temporary buffer
+	if( length >= (int)sizeof(stackBuffer) )
+	{
+		message = (char*)malloc(length + 1);
+
+		if( !message )
+			return;
+
+		va_start(args, format);
+		vsnprintf(message, length + 1, format, args);
+		va_end(args);
+	}
+
+	// the producer count is raised before mAsync is checked again, so either SetAsync(false)
+	// waits for this message to be queued, or it's written directly instead
+	gLogProducers.fetch_add(1);
+
+	LogQueue* queue = mAsync.load() ? logGetQueue() : NULL;
+
+	if( !queue )
+	{
+		fwrite(message, 1, length, mFile);
+	}
+	else
+	{
+		const uint32_t head = queue->head.load(std::memory_order_relaxed);
+		const uint32_t tail = queue->tail.load(std::memory_order_acquire);
+		const uint32_t size = sizeof(uint32_t) + length;
+
+		// drop the message instead of blocking when the queue is full
+		if( size > LOG_ASYNC_QUEUE_SIZE - (head - tail) )
+		{
+			queue->dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			const uint32_t messageLength = length;
+
+			logQueueCopy(queue->buffer, (const char*)&messageLength, head % LOG_ASYNC_QUEUE_SIZE, sizeof(uint32_t), true);
+			logQueueCopy(queue->buffer, message, (head + sizeof(uint32_t)) % LOG_ASYNC_QUEUE_SIZE, length, true);
+
+			queue->head.store(head + size, std::memory_order_release);
+		}
+	}
+
+	gLogProducers.fetch_sub(1);
+
+	if( message != stackBuffer )
+		free(message);
 }
 
 
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <string>
+#include <atomic>
 
 
 /**
@@ -44,7 +45,28 @@
 		  "                             * verbose (default)\n"							\
 		  "                             * debug\n"									\
 		  "  --verbose              enable verbose logging (same as --log-level=verbose)\n"  \
-		  "  --debug                enable debug logging   (same as --log-level=debug)\n\n"
+		  "  --debug                enable debug logging   (same as --log-level=debug)\n"	\
+		  "  --log-async            write the log from a background thread, so that slow\n"	\
+		  "                         outputs (like files on SD cards) don't stall the caller\n\n"
+
+
+/**
+ * The most verbose logging level that gets compiled in.
+ * Messages above this level are removed at compile-time, for example
+ * with `-DLOG_MAX_LEVEL=Log::INFO` to drop the verbose and debug messages.
+ * @ingroup log
+ */
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL Log::DEBUG
+#endif
+
+/**
+ * Size (in bytes) of the per-thread queue used in asynchronous mode.
+ * When a thread's queue is full, its messages are dropped (and counted)
+ * instead of blocking the thread.
+ * @ingroup log
+ */
+#define LOG_ASYNC_QUEUE_SIZE (64 * 1024)
 
 
 /**
@@ -104,6 +126,38 @@ public:
 	 */
 	static void SetFile( const char* filename );
 
+	/**
+	 * Enable or disable asynchronous logging.
+	 *
+	 * In asynchronous mode, messages are formatted on the calling thread into
+	 * a lock-free queue that belongs to that thread, and a background thread
+	 * writes them to the log output.  This keeps slow outputs from stalling
+	 * real-time threads like the capture callbacks.  The messages from each
+	 * thread stay in order, but those from different threads may interleave
+	 * differently than they would have in synchronous mode.
+	 *
+	 * Disabling asynchronous mode (or exiting the process) flushes the queues.
+	 */
+	static void SetAsync( bool async );
+
+	/**
+	 * Is asynchronous logging enabled?
+	 */
+	static inline bool IsAsync()				{ return mAsync.load(std::memory_order_acquire); }
+
+	/**
+	 * Wait for the queued messages to be written to the log output
+	 * (this returns immediately when asynchronous logging is disabled).
+	 */
+	static void Flush();
+
+	/**
+	 * Queue a printf-style message for the background thread to write.
+	 * This is called by the logging macros in asynchronous mode.
+	 * @internal
+	 */
+	static void Write( const char* format, ... ) __attribute__((format(printf, 1, 2)));
+
 	/**
 	 * Usage string for command line arguments to Create()
 	 */
@@ -133,15 +187,18 @@ protected:
 	static Level 	    mLevel;
 	static FILE* 	    mFile;
 	static std::string mFilename;
+	static std::atomic<bool> mAsync;
 };
 
 
 /**
  * Log a printf-style message with the provided level.
+ * The level is checked before the arguments are formatted, and levels
+ * above LOG_MAX_LEVEL are compiled out entirely.
  * @ingroup log
  * @internal
  */
-#define GenericLogMessage(level, format, args...) if( level <= Log::GetLevel() ) fprintf(Log::GetFile(), format, ## args)
+#define GenericLogMessage(level, format, args...) if( level <= LOG_MAX_LEVEL && level <= Log::GetLevel() ) Log::IsAsync() ? Log::Write(format, ## args) : (void)fprintf(Log::GetFile(), format, ## args)
 
 /**
  * Log a printf-style error message (Log::ERROR)
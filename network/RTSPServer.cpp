@@ -25,16 +25,39 @@
 #include "gstUtility.h"
 
 #include "Thread.h"
+#include "Event.h"
+#include "Mutex.h"
 #include "logging.h"
 
 #include <gst/rtsp-server/rtsp-server.h>
 
+#include <string>
+
 
 // list of existing server instances
 std::vector<RTSPServer*> gRTSPServers;
 
-// map of media factories to pipeline elements
-std::vector<std::pair<GstRTSPMediaFactory*, GstElement*>> gMediaFactoryMap;
+// the pipeline that each media factory serves
+struct RTSPRoute
+{
+	GstRTSPMediaFactory* factory;
+	GstElement* pipeline;
+	RTSPServer* server;
+	std::string path;
+};
+
+static std::vector<RTSPRoute> gRTSPRoutes;
+static Mutex gRTSPRoutesMutex;	// the factories get looked up from the server thread
+
+// multicast addresses get allocated from one pool, so that routes on different servers don't collide
+static GstRTSPAddressPool* gRTSPAddressPool = NULL;
+
+// the main loop thread that's shared by the servers
+static Thread*       gRTSPThread = NULL;
+static GMainContext* gRTSPContext = NULL;
+static GMainLoop*    gRTSPMainLoop = NULL;
+static Event         gRTSPStarted;
+static volatile bool gRTSPRunning = false;
 
 
 // constructor
@@ -42,9 +65,7 @@ RTSPServer::RTSPServer( uint16_t port )
 {	
 	mPort = port;
 	mRefCount = 1;
-	mThread = new Thread();
-	mRunning = false;
-	mMainLoop = NULL;
+	mSourceID = 0;
 	mServer = NULL;
 }
 
@@ -52,31 +73,40 @@ RTSPServer::RTSPServer( uint16_t port )
 // destructor
 RTSPServer::~RTSPServer()
 {
-	if( mRunning )
+	// release the pipelines of any routes that are left
+	gRTSPRoutesMutex.Lock();
+
+	for( size_t n=0; n < gRTSPRoutes.size(); )
 	{
-		g_main_loop_quit(mMainLoop);
-		
-		while(mRunning)
+		if( gRTSPRoutes[n].server == this )
 		{
-			LogVerbose(LOG_RTSP "waiting for RTSP server to stop...\n");
-			usleep(500 * 1000);
+			gst_object_unref(gRTSPRoutes[n].pipeline);
+			gRTSPRoutes.erase(gRTSPRoutes.begin() + n);
+		}
+		else
+		{
+			n++;
 		}
-		
-		g_main_loop_unref(mMainLoop);
-		mMainLoop = NULL;
 	}
-	
+
+	gRTSPRoutesMutex.Unlock();
+
+	// detach the server from the main loop, which closes the port
+	if( mSourceID != 0 )
+	{
+		GSource* source = g_main_context_find_source_by_id(gRTSPContext, mSourceID);
+
+		if( source != NULL )
+			g_source_destroy(source);
+
+		mSourceID = 0;
+	}
+
 	if( mServer != NULL )
 	{
 		g_object_unref(mServer);
 		mServer = NULL;
 	}
-			
-	if( mThread != NULL )
-	{
-		delete mThread;
-		mThread = NULL;
-	}
 }
 
 
@@ -99,6 +129,10 @@ void RTSPServer::Release()
 		}
 
 		delete this;
+
+		// stop the thread after the last server is gone
+		if( gRTSPServers.size() == 0 )
+			stopThread();
 	}
 }
 		
@@ -118,35 +152,25 @@ RTSPServer* RTSPServer::Create( uint16_t port )
 		}
 	}
 
+	// start the main loop, if this is the first server
+	if( !startThread() )
+	{
+		LogError(LOG_RTSP "failed to start RTSP server on port %hu\n", port);
+		return NULL;
+	}
+
 	// create a new server
 	RTSPServer* server = new RTSPServer(port);
 
-	if( !server )
+	if( !server || !server->init() )
 	{
 		LogError(LOG_RTSP "failed to create RTSP server on port %hu\n", port);
-		return NULL;
-	}
-	
-	// start the thread
-	if( !server->mThread->Start(runThread, server) )
-	{
-		LogError(LOG_RTSP "failed to create thread for running RTSP server\n");
-		return NULL;
-	}
 
-	// wait for initialization to complete
-	for( uint32_t n=0; n < 15; n++ )
-	{
-		if( server->mRunning )
-			break;
-		
-		LogVerbose(LOG_RTSP "waiting for RTSP server to start...\n");
-		usleep(100 * 1000);
-	}
-	
-	if( !server->mRunning )
-	{
-		LogError(LOG_RTSP "failed to start RTSP server on port %hu\n", server->mPort);
+		delete server;
+
+		if( gRTSPServers.size() == 0 )
+			stopThread();
+
 		return NULL;
 	}
 		
@@ -158,22 +182,6 @@ RTSPServer* RTSPServer::Create( uint16_t port )
 // init
 bool RTSPServer::init()
 {
-	// initialize GStreamer libraries
-	if( !gstreamerInit() )
-	{
-		LogError(LOG_GSTREAMER "failed to initialize gstreamer API\n");
-		return false;
-	}
-	
-	// make a main loop for the default context
-	mMainLoop = g_main_loop_new(NULL, false);
-	
-	if( !mMainLoop )
-	{
-		LogError(LOG_RTSP "failed to create GMainLoop instance\n");
-		return false;
-	}
-	
 	// make a server instance
 	mServer = gst_rtsp_server_new();
 	
@@ -188,8 +196,10 @@ bool RTSPServer::init()
 	sprintf(port_str, "%hu", mPort);
 	gst_rtsp_server_set_service(mServer, port_str);
 	
-	// attach the server to the default maincontext
-     if( gst_rtsp_server_attach(mServer, NULL) == 0 )
+	// attach the server to the main loop's context (this is thread-safe)
+	mSourceID = gst_rtsp_server_attach(mServer, gRTSPContext);
+
+	if( mSourceID == 0 )
 	{
 		LogError(LOG_RTSP "failed to attach server to port %hu\n", mPort);
 		return false;
@@ -200,44 +210,150 @@ bool RTSPServer::init()
 }
 
 
-// runThread
-void* RTSPServer::runThread( void* user_data )
+// onLoopStarted (called from inside the main loop once it's running)
+static gboolean onLoopStarted( gpointer user_data )
 {
-	RTSPServer* server = (RTSPServer*)user_data;
+	gRTSPRunning = true;
+	gRTSPStarted.Wake();
+	return G_SOURCE_REMOVE;
+}
+
+
+// startThread
+bool RTSPServer::startThread()
+{
+	if( gRTSPThread != NULL )
+		return gRTSPRunning;
+
+	// initialize GStreamer libraries
+	if( !gstreamerInit() )
+	{
+		LogError(LOG_GSTREAMER "failed to initialize gstreamer API\n");
+		return false;
+	}
 	
-	if( !server )
-		return 0;
+	// make a main loop for a private context, so it doesn't interfere with the default one
+	gRTSPContext = g_main_context_new();
+	gRTSPMainLoop = g_main_loop_new(gRTSPContext, false);
 	
-	// initialize server resources
-	if( !server->init() )
+	if( !gRTSPMainLoop )
 	{
-		LogError(LOG_RTSP "failed to create RTSP server on port %hu\n", server->mPort);
-		return 0;
+		LogError(LOG_RTSP "failed to create GMainLoop instance\n");
+		stopThread();
+		return false;
 	}
+
+	// signal when the loop is running, so that it can't be quit before it starts
+	GSource* source = g_idle_source_new();
+	g_source_set_callback(source, onLoopStarted, NULL, NULL);
+	g_source_attach(source, gRTSPContext);
+	g_source_unref(source);
+
+	// start the thread
+	gRTSPThread = new Thread();
+
+	if( !gRTSPThread->Start(runThread, NULL) )
+	{
+		LogError(LOG_RTSP "failed to create thread for running RTSP server\n");
+		delete gRTSPThread;
+		gRTSPThread = NULL;
+		stopThread();
+		return false;
+	}
+
+	if( !gRTSPStarted.Wait(RTSP_START_TIMEOUT) || !gRTSPRunning )
+	{
+		LogError(LOG_RTSP "timeout waiting for the RTSP server thread to start\n");
+		stopThread();
+		return false;
+	}
+
+	return true;
+}
+
+
+// stopThread
+void RTSPServer::stopThread()
+{
+	if( gRTSPMainLoop != NULL )
+		g_main_loop_quit(gRTSPMainLoop);
+
+	if( gRTSPThread != NULL )
+	{
+		gRTSPThread->Stop(true);	// wait for the thread to exit
+		delete gRTSPThread;
+		gRTSPThread = NULL;
+	}
+
+	if( gRTSPMainLoop != NULL )
+	{
+		g_main_loop_unref(gRTSPMainLoop);
+		gRTSPMainLoop = NULL;
+	}
+
+	if( gRTSPContext != NULL )
+	{
+		g_main_context_unref(gRTSPContext);
+		gRTSPContext = NULL;
+	}
+
+	if( gRTSPAddressPool != NULL )
+	{
+		g_object_unref(gRTSPAddressPool);
+		gRTSPAddressPool = NULL;
+	}
+
+	gRTSPRunning = false;
+}
+
+
+// runThread
+void* RTSPServer::runThread( void* user_data )
+{
+	// make the context the thread's default, for sources that get created while serving clients
+	g_main_context_push_thread_default(gRTSPContext);
+	g_main_loop_run(gRTSPMainLoop);
+	g_main_context_pop_thread_default(gRTSPContext);
 	
-	// run the server's main loop
-	server->mRunning = true;
-	g_main_loop_run(server->mMainLoop);
-	server->mRunning = false;
-	
+	gRTSPRunning = false;
+
 	LogVerbose(LOG_RTSP "RTSP server thread stopped\n");
 	return 0;
 }
 
 
 // custom implementation of GstRTSPMediaFactory::create_element()
+// (the server keeps its own reference to the pipeline, so the media only borrows it)
 static GstElement* gst_rtsp_media_factory_custom_element( GstRTSPMediaFactory* factory, const GstRTSPUrl* url )
 {
-	const uint32_t numFactories = gMediaFactoryMap.size();
-	
-	for( uint32_t n=0; n < numFactories; n++ )
+	GstElement* pipeline = NULL;
+
+	gRTSPRoutesMutex.Lock();
+
+	for( size_t n=0; n < gRTSPRoutes.size(); n++ )
 	{
-		if( factory == gMediaFactoryMap[n].first )
-			return gMediaFactoryMap[n].second;
+		if( factory == gRTSPRoutes[n].factory )
+		{
+			pipeline = gRTSPRoutes[n].pipeline;
+			break;
+		}
 	}
-	
-	LogError(LOG_RTSP "failed to lookup media factory pipeline element\n");
-	return NULL;
+
+	gRTSPRoutesMutex.Unlock();
+
+	if( !pipeline )
+		LogError(LOG_RTSP "failed to lookup media factory pipeline element\n");
+
+	return pipeline;
+}
+
+
+// custom implementation of GstRTSPMediaFactory::gen_key()
+// the default key includes the query string of the client's URL, so clients that used different
+// ones would each get their own media, and the pipeline can only be in one of them at a time.
+static gchar* gst_rtsp_media_factory_custom_key( GstRTSPMediaFactory* factory, const GstRTSPUrl* url )
+{
+	return g_strdup_printf("%p", factory);
 }
     
     
@@ -251,8 +367,11 @@ static void gst_rtsp_media_factory_custom_configure( GstRTSPMediaFactory* factor
 
     
 // AddRoute
-bool RTSPServer::AddRoute( const char* path, GstElement* pipeline )
+bool RTSPServer::AddRoute( const char* path, GstElement* pipeline, bool multicast )
 {
+	if( !path || !pipeline )
+		return false;
+
 	// get the mount points for the server
 	GstRTSPMountPoints* mounts = gst_rtsp_server_get_mount_points(mServer);
 	
@@ -267,7 +386,22 @@ bool RTSPServer::AddRoute( const char* path, GstElement* pipeline )
 	GstRTSPMediaFactoryClass* factoryFunctions = GST_RTSP_MEDIA_FACTORY_GET_CLASS(factory);
 	
 	factoryFunctions->create_element = gst_rtsp_media_factory_custom_element;
-	gMediaFactoryMap.push_back( std::pair<GstRTSPMediaFactory*, GstElement*>(factory, pipeline) );
+	factoryFunctions->gen_key = gst_rtsp_media_factory_custom_key;
+
+	// the caller keeps its reference, and the server holds another one
+	if( g_object_is_floating(pipeline) )
+		gst_object_ref_sink(pipeline);
+
+	RTSPRoute route;
+
+	route.factory  = factory;
+	route.pipeline = (GstElement*)gst_object_ref(pipeline);
+	route.server   = this;
+	route.path     = path;
+
+	gRTSPRoutesMutex.Lock();
+	gRTSPRoutes.push_back(route);
+	gRTSPRoutesMutex.Unlock();
 	
 	// setup media streaming options
 	gst_rtsp_media_factory_set_latency(factory, 0);
@@ -278,6 +412,32 @@ bool RTSPServer::AddRoute( const char* path, GstElement* pipeline )
 	gst_rtsp_media_factory_set_do_retransmission(factory, false);
 	gst_rtsp_media_factory_set_suspend_mode(factory, GST_RTSP_SUSPEND_MODE_NONE);
 	gst_rtsp_media_factory_set_transport_mode(factory, GST_RTSP_TRANSPORT_MODE_PLAY);
+
+	// allow clients to join a multicast group instead of getting their own unicast stream
+	if( multicast )
+	{
+		if( !gRTSPAddressPool )
+		{
+			gRTSPAddressPool = gst_rtsp_address_pool_new();
+
+			if( !gst_rtsp_address_pool_add_range(gRTSPAddressPool, RTSP_MULTICAST_ADDRESS_MIN, RTSP_MULTICAST_ADDRESS_MAX,
+										  RTSP_MULTICAST_PORT_MIN, RTSP_MULTICAST_PORT_MAX, RTSP_MULTICAST_TTL) )
+			{
+				LogError(LOG_RTSP "AddRoute() -- failed to create multicast address pool\n");
+				g_object_unref(gRTSPAddressPool);
+				gRTSPAddressPool = NULL;
+			}
+		}
+
+		if( gRTSPAddressPool != NULL )
+		{
+			gst_rtsp_media_factory_set_address_pool(factory, gRTSPAddressPool);
+			gst_rtsp_media_factory_set_protocols(factory, (GstRTSPLowerTrans)(GST_RTSP_LOWER_TRANS_UDP_MCAST|GST_RTSP_LOWER_TRANS_UDP|GST_RTSP_LOWER_TRANS_TCP));
+		#if GST_CHECK_VERSION(1,16,0)
+			gst_rtsp_media_factory_set_max_mcast_ttl(factory, RTSP_MULTICAST_TTL);
+		#endif
+		}
+	}
 	
 	g_signal_connect(factory, "media-configure", (GCallback)gst_rtsp_media_factory_custom_configure, NULL);
 	 
@@ -285,13 +445,44 @@ bool RTSPServer::AddRoute( const char* path, GstElement* pipeline )
 	gst_rtsp_mount_points_add_factory(mounts, path, factory);
 	g_object_unref(mounts);
 	
-	LogVerbose(LOG_RTSP "RTSP route added %s @ rtsp://%s:%hu\n", path, getHostname().c_str(), mPort);
+	LogVerbose(LOG_RTSP "RTSP route added %s @ rtsp://%s:%hu%s\n", path, getHostname().c_str(), mPort, multicast ? " (multicast)" : "");
 	return true;
 }
 
 
+// RemoveRoute
+void RTSPServer::RemoveRoute( GstElement* pipeline )
+{
+	GstRTSPMountPoints* mounts = gst_rtsp_server_get_mount_points(mServer);
+
+	gRTSPRoutesMutex.Lock();
+
+	for( size_t n=0; n < gRTSPRoutes.size(); )
+	{
+		if( gRTSPRoutes[n].server != this || gRTSPRoutes[n].pipeline != pipeline )
+		{
+			n++;
+			continue;
+		}
+
+		if( mounts != NULL )
+			gst_rtsp_mount_points_remove_factory(mounts, gRTSPRoutes[n].path.c_str());
+
+		LogVerbose(LOG_RTSP "RTSP route removed %s @ rtsp://%s:%hu\n", gRTSPRoutes[n].path.c_str(), getHostname().c_str(), mPort);
+
+		gst_object_unref(gRTSPRoutes[n].pipeline);
+		gRTSPRoutes.erase(gRTSPRoutes.begin() + n);
+	}
+
+	gRTSPRoutesMutex.Unlock();
+
+	if( mounts != NULL )
+		g_object_unref(mounts);
+}
+
+
 // AddRoute
-bool RTSPServer::AddRoute( const char* path, const char* pipeline_str )
+bool RTSPServer::AddRoute( const char* path, const char* pipeline_str, bool multicast )
 {
 	GError* err = NULL;
 	GstElement* pipeline = gst_parse_launch_full(pipeline_str, NULL, GST_PARSE_FLAG_PLACE_IN_BIN, &err);
@@ -305,5 +496,8 @@ bool RTSPServer::AddRoute( const char* path, const char* pipeline_str )
 		return false;
 	}
 	
-	return AddRoute(path, pipeline);
+	// the route holds the only reference afterwards
+	const bool result = AddRoute(path, pipeline, multicast);
+	gst_object_unref(pipeline);
+	return result;
 }
\ No newline at end of file
@@ -27,9 +27,6 @@
 
 
 // forward declarations
-class Thread;
-
-struct _GMainLoop;
 struct _GstRTSPServer;
 struct _GstElement;
 
@@ -47,9 +44,57 @@ struct _GstElement;
 #define LOG_RTSP "[rtsp]   "
 
 
+/**
+ * Maximum time (in milliseconds) to wait for the RTSP server thread to start.
+ * @ingroup network
+ */
+#define RTSP_START_TIMEOUT 1500
+
+/**
+ * Range of multicast addresses that routes with multicast enabled get allocated from.
+ * @ingroup network
+ */
+#define RTSP_MULTICAST_ADDRESS_MIN "224.3.0.1"
+
+/**
+ * Range of multicast addresses that routes with multicast enabled get allocated from.
+ * @ingroup network
+ */
+#define RTSP_MULTICAST_ADDRESS_MAX "224.3.0.254"
+
+/**
+ * Range of UDP ports that multicast streams get sent on.
+ * @ingroup network
+ */
+#define RTSP_MULTICAST_PORT_MIN 5000
+
+/**
+ * Range of UDP ports that multicast streams get sent on.
+ * @ingroup network
+ */
+#define RTSP_MULTICAST_PORT_MAX 5999
+
+/**
+ * The TTL of multicast packets (the number of routers they can cross).
+ * @ingroup network
+ */
+#define RTSP_MULTICAST_TTL 16
+
+
 /**
  * RTSP server for transmitting encoded GStreamer pipelines to client devices.
  * This is integrated into videoOutput/gstEncoder, but can be used standalone (@see rtsp-server example)
+ *
+ * All of the servers (on different ports) share one thread that runs their GMainLoop
+ * on a private GMainContext, which is started when the first server gets created and
+ * stopped when the last one is released.  Each server can serve any number of routes
+ * (mount points) from AddRoute() without needing additional threads.
+ *
+ * Each route is shared between all of its clients:  the pipeline is only ever started
+ * once, and its RTP packets get sent to every client that's connected to it (over unicast
+ * UDP, TCP, or multicast UDP if that was enabled for the route).  So the cost of encoding
+ * doesn't increase with the number of clients, which only add the cost of sending packets.
+ *
  * @ingroup network
  */
 class RTSPServer
@@ -70,14 +115,24 @@ public:
 	/**
 	 * Register a GStreamer pipeline to be served at the specified path.
 	 * It will be able to be viewed from clients at `rtsp://hostname:port/path`
+	 * The server takes a reference to the pipeline, which is released in the destructor.
+	 * @param multicast if true, clients can also request RTP multicast delivery, where one
+	 *                  copy of the stream is sent to a group address shared by all of them.
 	 */
-	bool AddRoute( const char* path, _GstElement* pipeline );
+	bool AddRoute( const char* path, _GstElement* pipeline, bool multicast=false );
 	
 	/**
 	 * Create a GStreamer pipeline and register it to be served at the specified path.
 	 * It will be able to be viewed from clients at `rtsp://hostname:port/path`
+	 * @param multicast if true, clients can also request RTP multicast delivery.
 	 */
-	bool AddRoute( const char* path, const char* pipeline );
+	bool AddRoute( const char* path, const char* pipeline, bool multicast=false );
+
+	/**
+	 * Unregister the routes that serve this pipeline, and release the server's reference to it.
+	 * Clients that are already connected to it keep their session until they disconnect.
+	 */
+	void RemoveRoute( _GstElement* pipeline );
 	
 protected:
 	RTSPServer( uint16_t port );
@@ -85,15 +140,14 @@ protected:
 	
 	bool init();
 	
+	static bool startThread();
+	static void stopThread();
 	static void* runThread( void* user_data );
 	
 	uint16_t mPort;
 	uint32_t mRefCount;
+	uint32_t mSourceID;	// the server's source in the GMainContext
 	
-	Thread* mThread;
-	bool    mRunning;
-	
-	_GMainLoop* mMainLoop;
 	_GstRTSPServer* mServer;
 };
 
@@ -28,7 +28,10 @@
 #include <netinet/in.h>
 #include <cstring>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <alloca.h>
+#include <sys/uio.h>
 
 #include "logging.h"
 
@@ -54,6 +57,7 @@ Socket::Socket( SocketType type ) : mType(type)
 	mListening        = false;
 	mPktInfoEnabled   = false;
 	mBroadcastEnabled = false;
+	mBlocking         = true;
 }
 
 
@@ -187,6 +191,9 @@ bool Socket::Accept( uint64_t timeout )
 
 	const int fd = accept(mSock, (struct sockaddr*)&addr, &addrLen);
 
+	if( fd < 0 && !mBlocking && (errno == EAGAIN || errno == EWOULDBLOCK) )
+		return false;	// no pending connections
+
 	if( fd < 0 )
 	{
 		LogError(LOG_NETWORK "Socket::Accept() failed  (code=%i)\n", fd);
@@ -202,6 +209,13 @@ bool Socket::Accept( uint64_t timeout )
 
 	mSock      = fd;
 	mListening = false;
+
+	// the accepted socket doesn't inherit O_NONBLOCK
+	if( !mBlocking )
+	{
+		mBlocking = true;
+		SetBlocking(false);
+	}
 	
 	return true;
 }	
@@ -473,6 +487,145 @@ bool Socket::Send( void* buffer, size_t size, uint32_t remoteIP, uint16_t remote
 }
 
 
+// RecieveBatch
+int Socket::RecieveBatch( SocketMessage* messages, uint32_t count )
+{
+	if( !messages || count == 0 || mType != SOCKET_UDP )
+		return -1;
+
+	if( count > UIO_MAXIOV )
+		count = UIO_MAXIOV;	// the kernel's limit per call
+
+	mmsghdr*     msgs  = (mmsghdr*)alloca(count * sizeof(mmsghdr));
+	iovec*       iovs  = (iovec*)alloca(count * sizeof(iovec));
+	sockaddr_in* addrs = (sockaddr_in*)alloca(count * sizeof(sockaddr_in));
+
+	memset(msgs, 0, count * sizeof(mmsghdr));
+
+	for( uint32_t n=0; n < count; n++ )
+	{
+		iovs[n].iov_base = messages[n].buffer;
+		iovs[n].iov_len  = messages[n].size;
+
+		msgs[n].msg_hdr.msg_name    = &addrs[n];
+		msgs[n].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		msgs[n].msg_hdr.msg_iov     = &iovs[n];
+		msgs[n].msg_hdr.msg_iovlen  = 1;
+
+		messages[n].length = 0;
+	}
+
+	// in blocking mode, wait for the first packet and then take whatever else is queued
+	const int res = recvmmsg(mSock, msgs, count, MSG_WAITFORONE, NULL);
+
+	if( res < 0 )
+	{
+		if( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR )
+			return 0;	// nothing available, or the recieve timeout expired
+
+		LogError(LOG_NETWORK "Socket::RecieveBatch() failed\n");
+		printErrno();
+		return -1;
+	}
+
+	for( int n=0; n < res; n++ )
+	{
+		messages[n].length     = msgs[n].msg_len;
+		messages[n].remoteIP   = addrs[n].sin_addr.s_addr;
+		messages[n].remotePort = ntohs(addrs[n].sin_port);
+	}
+
+	return res;
+}
+
+
+// SendBatch
+int Socket::SendBatch( SocketMessage* messages, uint32_t count )
+{
+	if( !messages || count == 0 || mType != SOCKET_UDP )
+		return -1;
+
+	if( count > UIO_MAXIOV )
+		count = UIO_MAXIOV;	// the kernel's limit per call
+
+	mmsghdr*     msgs  = (mmsghdr*)alloca(count * sizeof(mmsghdr));
+	iovec*       iovs  = (iovec*)alloca(count * sizeof(iovec));
+	sockaddr_in* addrs = (sockaddr_in*)alloca(count * sizeof(sockaddr_in));
+
+	memset(msgs, 0, count * sizeof(mmsghdr));
+	memset(addrs, 0, count * sizeof(sockaddr_in));
+
+	for( uint32_t n=0; n < count; n++ )
+	{
+		// if sending broadcast, enable broadcasting if not already done so
+		if( messages[n].remoteIP == netswap32(IP_BROADCAST) && !mBroadcastEnabled )
+		{
+			int opt = 1;
+			
+			if( setsockopt(mSock, SOL_SOCKET, SO_BROADCAST, (const char*)&opt, sizeof(int)) != 0 )
+			{
+				LogError(LOG_NETWORK "Socket::SendBatch() failed to enabled broadcasting...\n");
+				printErrno();
+				return -1;
+			}
+			
+			mBroadcastEnabled = true;
+		}
+
+		addrs[n].sin_family 	 = AF_INET;
+		addrs[n].sin_addr.s_addr = messages[n].remoteIP;
+		addrs[n].sin_port		 = htons(messages[n].remotePort);
+
+		iovs[n].iov_base = messages[n].buffer;
+		iovs[n].iov_len  = messages[n].size;
+
+		msgs[n].msg_hdr.msg_name    = &addrs[n];
+		msgs[n].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		msgs[n].msg_hdr.msg_iov     = &iovs[n];
+		msgs[n].msg_hdr.msg_iovlen  = 1;
+
+		messages[n].length = 0;
+	}
+
+	const int res = sendmmsg(mSock, msgs, count, 0);
+
+	if( res < 0 )
+	{
+		if( !mBlocking && (errno == EAGAIN || errno == EWOULDBLOCK) )
+			return 0;	// the send buffer is full
+
+		LogError(LOG_NETWORK "Socket::SendBatch() failed to send %u messages\n", count);
+		printErrno();
+		return -1;
+	}
+
+	for( int n=0; n < res; n++ )
+		messages[n].length = msgs[n].msg_len;
+
+	return res;
+}
+
+
+// SetBlocking
+bool Socket::SetBlocking( bool blocking )
+{
+	if( blocking == mBlocking )
+		return true;
+
+	const int flags = fcntl(mSock, F_GETFL, 0);
+
+	if( flags < 0 || fcntl(mSock, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK)) < 0 )
+	{
+		LogError(LOG_NETWORK "Socket::SetBlocking() failed to %s blocking mode\n", blocking ? "enable" : "disable");
+		printErrno();
+		return false;
+	}
+
+	mBlocking = blocking;
+	return true;
+}
+
+
 // PrintIP
 void Socket::PrintIP() const
 {
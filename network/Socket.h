@@ -45,6 +45,20 @@ enum SocketType
 };
 
 
+/**
+ * Datagram used for batched I/O with Socket::RecieveBatch() and Socket::SendBatch().
+ * @ingroup network
+ */
+struct SocketMessage
+{
+	uint8_t* buffer;		/**< user-allocated packet buffer */
+	size_t   size;		/**< size of the buffer (in bytes), or the number of bytes to send */
+	size_t   length;		/**< number of bytes that were recieved or sent */
+	uint32_t remoteIP;		/**< IPv4 address of the remote host (in network byte order) */
+	uint16_t remotePort;	/**< port of the remote host (in host byte order) */
+};
+
+
 #define IP_ANY			0x00000000
 #define IP_BROADCAST	0xFFFFFFFF
 #define IP_LOOPBACK     0x7F000001
@@ -58,6 +72,11 @@ enum SocketType
  *  2.  Bind() the Socket to a host IP address and port
  *  3.  Exchange data with the Send/Recv functions
  *
+ * By default the socket is blocking.  For high packet rates, SetBlocking(false)
+ * can be used together with RecieveBatch()/SendBatch(), which transfer many
+ * datagrams per system call (recvmmsg/sendmmsg), and SocketPoller can then
+ * serve many non-blocking sockets from one thread.
+ *
  * @ingroup network
  */
 class Socket
@@ -138,6 +157,37 @@ public:
 	 * Send message to remote host.
 	 */
 	bool Send( void* buffer, size_t size, uint32_t remoteIP, uint16_t remotePort );
+
+	/**
+	 * Recieve multiple packets with one system call (UDP only).
+	 * The buffer and size of each message should be set by the user, and the length
+	 * and remote address of each message that was recieved get filled out.
+	 * In blocking mode, this waits until at least one packet has arrived
+	 * (or the recieve timeout expires), and then returns what's queued.
+	 * @returns the number of messages recieved, 0 if none were available,
+	 *          or -1 if an error occurred.
+	 */
+	int RecieveBatch( SocketMessage* messages, uint32_t count );
+
+	/**
+	 * Send multiple packets with one system call (UDP only).
+	 * The buffer, size, and remote address of each message should be set by the user.
+	 * @returns the number of messages sent (which may be fewer than count in
+	 *          non-blocking mode, if the send buffer filled up), or -1 on error.
+	 */
+	int SendBatch( SocketMessage* messages, uint32_t count );
+
+	/**
+	 * Enable or disable blocking mode (the socket is blocking by default).
+	 * In non-blocking mode, Accept(), Recieve() and Send() will return
+	 * immediately instead of waiting, for use with SocketPoller.
+	 */
+	bool SetBlocking( bool blocking );
+
+	/**
+	 * Return true if the socket is in blocking mode (the default).
+	 */
+	inline bool IsBlocking() const										{ return mBlocking; }
 	
 	/**
 	 * Set Receive() timeout (in microseconds).
@@ -185,6 +235,7 @@ private:
 	bool       mListening;
 	bool	   mPktInfoEnabled;
 	bool       mBroadcastEnabled;
+	bool       mBlocking;
 	
 	uint32_t   mLocalIP;
 	uint16_t   mLocalPort;
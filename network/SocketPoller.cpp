@@ -0,0 +1,486 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SocketPoller.h"
+#include "Networking.h"
+#include "logging.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+
+// constructor
+SocketPoller::SocketPoller()
+{
+	mEpoll = -1;
+	mThreadStop = false;
+	mThreadRunning = false;
+	mDispatching = false;
+}
+
+
+// destructor
+SocketPoller::~SocketPoller()
+{
+	Stop();
+
+	for( size_t n=0; n < mEntries.size(); n++ )
+		delete mEntries[n];
+
+	mEntries.clear();
+
+	if( mEpoll >= 0 )
+	{
+		close(mEpoll);
+		mEpoll = -1;
+	}
+}
+
+
+// Create
+SocketPoller* SocketPoller::Create()
+{
+	SocketPoller* poller = new SocketPoller();
+
+	poller->mEpoll = epoll_create1(EPOLL_CLOEXEC);
+
+	if( poller->mEpoll < 0 )
+	{
+		LogError(LOG_NETWORK "SocketPoller -- epoll_create1() failed (errno=%i) (%s)\n", errno, strerror(errno));
+		delete poller;
+		return NULL;
+	}
+
+	return poller;
+}
+
+
+// toEpoll
+uint32_t SocketPoller::toEpoll( uint32_t events )
+{
+	uint32_t flags = 0;
+
+	if( events & READABLE )
+		flags |= EPOLLIN;
+
+	if( events & WRITABLE )
+		flags |= EPOLLOUT;
+
+	return flags;
+}
+
+
+// find (the caller should hold the mutex)
+SocketPoller::Entry* SocketPoller::find( Socket* socket )
+{
+	for( size_t n=0; n < mEntries.size(); n++ )
+	{
+		if( mEntries[n]->socket == socket && !mEntries[n]->removed )
+			return mEntries[n];
+	}
+
+	return NULL;
+}
+
+
+// findFD (the caller should hold the mutex)
+SocketPoller::Entry* SocketPoller::findFD( int fd )
+{
+	for( size_t n=0; n < mEntries.size(); n++ )
+	{
+		if( mEntries[n]->fd == fd && !mEntries[n]->removed )
+			return mEntries[n];
+	}
+
+	return NULL;
+}
+
+
+// add (the caller should hold the mutex)
+bool SocketPoller::add( Entry* entry, uint32_t events )
+{
+	// the entry gets returned by epoll_wait() when the descriptor has events
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+
+	event.events   = toEpoll(events);
+	event.data.ptr = entry;
+
+	if( epoll_ctl(mEpoll, EPOLL_CTL_ADD, entry->fd, &event) < 0 )
+	{
+		LogError(LOG_NETWORK "SocketPoller -- epoll_ctl() failed to add descriptor %i (errno=%i) (%s)\n", entry->fd, errno, strerror(errno));
+		delete entry;
+		return false;
+	}
+
+	mEntries.push_back(entry);
+	return true;
+}
+
+
+// modify (the caller should hold the mutex)
+bool SocketPoller::modify( Entry* entry, uint32_t events )
+{
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+
+	event.events   = toEpoll(events);
+	event.data.ptr = entry;
+
+	if( epoll_ctl(mEpoll, EPOLL_CTL_MOD, entry->fd, &event) < 0 )
+	{
+		LogError(LOG_NETWORK "SocketPoller -- epoll_ctl() failed to modify descriptor %i (errno=%i) (%s)\n", entry->fd, errno, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+
+// remove (the caller should hold the mutex)
+bool SocketPoller::remove( Entry* entry )
+{
+	// the entry is freed later, since Poll() may be dispatching its events right now
+	epoll_ctl(mEpoll, EPOLL_CTL_DEL, entry->fd, NULL);
+	entry->removed = true;
+
+	return true;
+}
+
+
+// Add
+bool SocketPoller::Add( Socket* socket, Callback callback, void* user_data, uint32_t events )
+{
+	if( !socket || !callback )
+		return false;
+
+	mMutex.Lock();
+
+	if( find(socket) != NULL )
+	{
+		mMutex.Unlock();
+		LogError(LOG_NETWORK "SocketPoller -- socket %i was already added\n", socket->GetFD());
+		return false;
+	}
+
+	if( socket->IsBlocking() )
+		LogWarning(LOG_NETWORK "SocketPoller -- socket %i is in blocking mode, its callbacks may stall the other sockets\n", socket->GetFD());
+
+	Entry* entry = new Entry();
+
+	entry->socket     = socket;
+	entry->callback   = callback;
+	entry->fd         = socket->GetFD();
+	entry->fdCallback = NULL;
+	entry->user_data  = user_data;
+	entry->removed    = false;
+
+	const bool result = add(entry, events);
+	mMutex.Unlock();
+
+	return result;
+}
+
+
+// AddFD
+bool SocketPoller::AddFD( int fd, FDCallback callback, void* user_data, uint32_t events )
+{
+	if( fd < 0 || !callback )
+		return false;
+
+	mMutex.Lock();
+
+	if( findFD(fd) != NULL )
+	{
+		mMutex.Unlock();
+		LogError(LOG_NETWORK "SocketPoller -- descriptor %i was already added\n", fd);
+		return false;
+	}
+
+	Entry* entry = new Entry();
+
+	entry->socket     = NULL;
+	entry->callback   = NULL;
+	entry->fd         = fd;
+	entry->fdCallback = callback;
+	entry->user_data  = user_data;
+	entry->removed    = false;
+
+	const bool result = add(entry, events);
+	mMutex.Unlock();
+
+	return result;
+}
+
+
+// Modify
+bool SocketPoller::Modify( Socket* socket, uint32_t events )
+{
+	if( !socket )
+		return false;
+
+	mMutex.Lock();
+
+	Entry* entry = find(socket);
+
+	if( !entry )
+	{
+		mMutex.Unlock();
+		LogError(LOG_NETWORK "SocketPoller -- socket %i hasn't been added\n", socket->GetFD());
+		return false;
+	}
+
+	const bool result = modify(entry, events);
+	mMutex.Unlock();
+
+	return result;
+}
+
+
+// ModifyFD
+bool SocketPoller::ModifyFD( int fd, uint32_t events )
+{
+	mMutex.Lock();
+
+	Entry* entry = findFD(fd);
+
+	if( !entry )
+	{
+		mMutex.Unlock();
+		LogError(LOG_NETWORK "SocketPoller -- descriptor %i hasn't been added\n", fd);
+		return false;
+	}
+
+	const bool result = modify(entry, events);
+	mMutex.Unlock();
+
+	return result;
+}
+
+
+// Remove
+bool SocketPoller::Remove( Socket* socket )
+{
+	if( !socket )
+		return false;
+
+	mMutex.Lock();
+
+	Entry* entry = find(socket);
+
+	if( !entry )
+	{
+		mMutex.Unlock();
+		return false;
+	}
+
+	remove(entry);
+
+	// entries removed while Poll() is dispatching (e.g. from a callback) may still be in
+	// its batch of events, so they're deleted when Poll() finishes instead of now
+	const bool purgeNow = !mThreadRunning && !mDispatching;
+	mMutex.Unlock();
+
+	if( purgeNow )
+		purge();
+
+	return true;
+}
+
+
+// RemoveFD
+bool SocketPoller::RemoveFD( int fd )
+{
+	mMutex.Lock();
+
+	Entry* entry = findFD(fd);
+
+	if( !entry )
+	{
+		mMutex.Unlock();
+		return false;
+	}
+
+	remove(entry);
+
+	// deferred while Poll() is dispatching (see Remove())
+	const bool purgeNow = !mThreadRunning && !mDispatching;
+	mMutex.Unlock();
+
+	if( purgeNow )
+		purge();
+
+	return true;
+}
+
+
+// purge
+void SocketPoller::purge()
+{
+	mMutex.Lock();
+
+	for( size_t n=0; n < mEntries.size(); )
+	{
+		if( mEntries[n]->removed )
+		{
+			delete mEntries[n];
+			mEntries.erase(mEntries.begin() + n);
+		}
+		else
+		{
+			n++;
+		}
+	}
+
+	mMutex.Unlock();
+}
+
+
+// GetNumSockets
+uint32_t SocketPoller::GetNumSockets()
+{
+	uint32_t count = 0;
+
+	mMutex.Lock();
+
+	for( size_t n=0; n < mEntries.size(); n++ )
+	{
+		if( !mEntries[n]->removed )
+			count++;
+	}
+
+	mMutex.Unlock();
+	return count;
+}
+
+
+// Poll
+int SocketPoller::Poll( int timeout )
+{
+	struct epoll_event events[64];
+
+	mMutex.Lock();
+	mDispatching = true;
+	mMutex.Unlock();
+
+	const int numEvents = epoll_wait(mEpoll, events, sizeof(events) / sizeof(events[0]), timeout);
+
+	if( numEvents < 0 )
+	{
+		mDispatching = false;
+
+		if( errno == EINTR )
+			return 0;
+
+		LogError(LOG_NETWORK "SocketPoller -- epoll_wait() failed (errno=%i) (%s)\n", errno, strerror(errno));
+		return -1;
+	}
+
+	int dispatched = 0;
+
+	for( int n=0; n < numEvents; n++ )
+	{
+		Entry* entry = (Entry*)events[n].data.ptr;
+
+		// an earlier callback in this batch may have removed it
+		if( entry->removed )
+			continue;
+
+		uint32_t flags = 0;
+
+		if( events[n].events & EPOLLIN )
+			flags |= READABLE;
+
+		if( events[n].events & EPOLLOUT )
+			flags |= WRITABLE;
+
+		if( events[n].events & (EPOLLERR|EPOLLHUP) )
+			flags |= HANGUP;
+
+		if( entry->socket != NULL )
+			entry->callback(entry->socket, flags, entry->user_data);
+		else
+			entry->fdCallback(entry->fd, flags, entry->user_data);
+
+		dispatched++;
+	}
+
+	mMutex.Lock();
+	mDispatching = false;
+	mMutex.Unlock();
+
+	purge();
+	return dispatched;
+}
+
+
+// pollThread
+void* SocketPoller::pollThread( void* user )
+{
+	SocketPoller* poller = (SocketPoller*)user;
+
+	while( !poller->mThreadStop )
+	{
+		if( poller->Poll(SOCKET_POLLER_TIMEOUT) < 0 )
+			break;
+	}
+
+	poller->mThreadRunning = false;
+	return NULL;
+}
+
+
+// Start
+bool SocketPoller::Start()
+{
+	if( mThreadRunning )
+		return true;
+
+	mThreadStop = false;
+	mThreadRunning = true;
+
+	if( !mThread.Start(pollThread, this) )
+	{
+		LogError(LOG_NETWORK "SocketPoller -- failed to start the polling thread\n");
+		mThreadRunning = false;
+		return false;
+	}
+
+	return true;
+}
+
+
+// Stop
+void SocketPoller::Stop()
+{
+	if( !mThreadRunning )
+		return;
+
+	mThreadStop = true;
+	mThread.Stop(true);
+	mThreadRunning = false;
+
+	purge();
+}
+
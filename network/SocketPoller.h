@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __NETWORK_SOCKET_POLLER_H_
+#define __NETWORK_SOCKET_POLLER_H_
+
+#include "Socket.h"
+#include "Thread.h"
+#include "Mutex.h"
+
+#include <vector>
+
+
+/**
+ * Default timeout (in milliseconds) that the SocketPoller thread waits in epoll_wait(),
+ * before checking if it has been asked to stop.
+ * @ingroup network
+ */
+#define SOCKET_POLLER_TIMEOUT 100
+
+
+/**
+ * Event-driven I/O for many sockets on one thread, using epoll.
+ *
+ * Sockets are registered with Add(), along with a callback that gets run when the
+ * socket becomes readable or writable.  The sockets should be in non-blocking mode
+ * (see Socket::SetBlocking()), and each callback should read or write until the
+ * call would block, for example with Socket::RecieveBatch() for UDP.
+ *
+ * The callbacks are dispatched from Poll(), which can either be called from the
+ * application's own loop, or from an internal thread with Start() and Stop().
+ *
+ * Other file descriptors can be polled too with AddFD(), for example the eventfd
+ * of a videoSource (see videoSource::GetEventFD()) or of an Event (see Event::GetFD()).
+ * That way one thread can act as a reactor that services many cameras, streams and
+ * sockets, without a thread per source blocking in Capture().
+ *
+ * @ingroup network
+ */
+class SocketPoller
+{
+public:
+	/**
+	 * Events that a socket can be polled for.
+	 */
+	enum Events
+	{
+		READABLE = (1 << 0),	/**< Data can be recieved (or a TCP connection accepted) */
+		WRITABLE = (1 << 1),	/**< Data can be sent without blocking */
+		HANGUP   = (1 << 2)		/**< The socket was closed or had an error (always reported) */
+	};
+
+	/**
+	 * Function pointer typedef of the callback that gets run when a socket has events.
+	 * @param socket the socket that has the events
+	 * @param events the Events that occurred (a bitmask of READABLE, WRITABLE, HANGUP)
+	 */
+	typedef void (*Callback)( Socket* socket, uint32_t events, void* user_data );
+
+	/**
+	 * Function pointer typedef of the callback that gets run when a file descriptor has events.
+	 * @param fd the file descriptor that has the events
+	 * @param events the Events that occurred (a bitmask of READABLE, WRITABLE, HANGUP)
+	 */
+	typedef void (*FDCallback)( int fd, uint32_t events, void* user_data );
+
+	/**
+	 * Create a new poller.
+	 */
+	static SocketPoller* Create();
+
+	/**
+	 * Destructor (this will stop the thread, but doesn't delete the sockets)
+	 */
+	~SocketPoller();
+
+	/**
+	 * Register a socket to be polled for the specified events.
+	 * @returns `true` on success, or `false` if an error occurred.
+	 */
+	bool Add( Socket* socket, Callback callback, void* user_data=NULL, uint32_t events=READABLE );
+
+	/**
+	 * Change the events that a socket is polled for (e.g. to add WRITABLE while there's data to send).
+	 */
+	bool Modify( Socket* socket, uint32_t events );
+
+	/**
+	 * Stop polling a socket.  This can be called from within a callback.
+	 */
+	bool Remove( Socket* socket );
+
+	/**
+	 * Register a file descriptor (that isn't a Socket) to be polled for the specified events.
+	 * @returns `true` on success, or `false` if an error occurred.
+	 */
+	bool AddFD( int fd, FDCallback callback, void* user_data=NULL, uint32_t events=READABLE );
+
+	/**
+	 * Change the events that a file descriptor is polled for.
+	 */
+	bool ModifyFD( int fd, uint32_t events );
+
+	/**
+	 * Stop polling a file descriptor.  This can be called from within a callback.
+	 */
+	bool RemoveFD( int fd );
+
+	/**
+	 * Wait for events and dispatch the callbacks on the calling thread.
+	 * This shouldn't be used while the internal thread is running.
+	 * @param timeout the max number of milliseconds to wait (or -1 to wait indefinitely)
+	 * @returns the number of events that were dispatched, or -1 on error.
+	 */
+	int Poll( int timeout=-1 );
+
+	/**
+	 * Start a thread that runs Poll() until Stop() is called.
+	 */
+	bool Start();
+
+	/**
+	 * Stop the thread (and wait for it to exit).
+	 */
+	void Stop();
+
+	/**
+	 * Return true if the internal thread is running.
+	 */
+	inline bool IsThreaded() const			{ return mThreadRunning; }
+
+	/**
+	 * Get the number of sockets (and file descriptors) that are registered.
+	 */
+	uint32_t GetNumSockets();
+
+protected:
+	SocketPoller();
+
+	struct Entry
+	{
+		Socket*  socket;		// NULL for file descriptors added with AddFD()
+		Callback callback;
+		int      fd;
+		FDCallback fdCallback;
+		void*    user_data;
+		bool     removed;	// deleted after the callbacks that are in progress have finished
+	};
+
+	Entry* find( Socket* socket );
+	Entry* findFD( int fd );
+
+	bool add( Entry* entry, uint32_t events );
+	bool modify( Entry* entry, uint32_t events );
+	bool remove( Entry* entry );
+	void purge();
+
+	static uint32_t toEpoll( uint32_t events );
+	static void* pollThread( void* user );
+
+	int   mEpoll;
+	Mutex mMutex;
+	Thread mThread;
+
+	std::vector<Entry*> mEntries;
+
+	volatile bool mThreadStop;
+	volatile bool mThreadRunning;
+	volatile bool mDispatching;	// Poll() is in progress, so removed entries can't be deleted yet
+};
+
+#endif
+
@@ -119,7 +119,7 @@ bool URI::Parse( const char* uri )
 	protocol = toLower(protocol);
 
 	// parse extra info (device ordinals, IP addresses, ect)
-	if( protocol == "v4l2" )
+	if( protocol == "v4l2" || protocol == "v4l2raw" )
 	{
 		if( sscanf(location.c_str(), "/dev/video%i", &port) != 1 )
 		{
@@ -147,6 +147,19 @@ bool URI::Parse( const char* uri )
 	{
 		extension = fileExtension(location);
 	}
+	else if( protocol == "shm" )
+	{
+		// "name" of the shared memory stream
+		if( location.size() == 0 || location.find("/") != std::string::npos )
+		{
+			LogError("URI -- invalid shared memory stream name from %s\n", string.c_str());
+			return false;
+		}
+	}
+	else if( protocol == "test" || protocol == "null" || protocol == "packet" )
+	{
+		// "pattern" name, or options of the null/packet streams (nothing to parse)
+	}
 	else
 	{		
 		// search for ip/port format
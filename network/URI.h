@@ -45,6 +45,9 @@
  *        If no protocol is specified but the string begins with `/dev/video`, then it is
  *        assumed that the protocol is V4L2 (`/dev/video0` -> `v4l2:///dev/video0`)
  *
+ *     - `v4l2raw:///dev/video0` for V4L2 cameras with uncompressed formats (like Bayer or YUYV), 
+ *        captured directly through v4l2Camera instead of GStreamer.
+ *
  *     - `rtp://@:1234` to recieve an RTP network stream, where `1234` is the port and `@` is shorthand
  *        for localhost.  `@` can also be substituted for the IP address of a multicast group.
  *        Note that it is important to manually specify the codec and width/height when using RTP,
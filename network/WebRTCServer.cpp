@@ -25,6 +25,8 @@
 #include "Process.h"
 #include "Thread.h"
 
+#include "videoMetrics.h"
+
 #include "json.hpp"
 #include "logging.h"
 
@@ -136,6 +138,73 @@ const char* html_viewer = " \n \
         websocketConnection.send(JSON.stringify({'type': 'ice', 'data': event.candidate })); \n \
       } \n \
  \n \
+ \n \
+      function onDataChannel(event) { \n \
+        console.log('WebRTC data channel opened:  ' + event.channel.label); \n \
+        if (event.channel.label == 'metadata') \n \
+          event.channel.onmessage = onMetadata; \n \
+      } \n \
+ \n \
+ \n \
+      function onMetadata(event) { \n \
+        var msg; \n \
+ \n \
+        try { \n \
+          msg = JSON.parse(event.data); \n \
+        } catch (e) { \n \
+          return; \n \
+        } \n \
+ \n \
+        if (msg.type == 'detections') \n \
+          drawDetections(msg); \n \
+      } \n \
+ \n \
+ \n \
+      function drawDetections(msg) { \n \
+        var canvas = document.getElementById('overlay'); \n \
+        canvas.width = videoElement.clientWidth; \n \
+        canvas.height = videoElement.clientHeight; \n \
+ \n \
+        var ctx = canvas.getContext('2d'); \n \
+        ctx.clearRect(0, 0, canvas.width, canvas.height); \n \
+ \n \
+        if (!msg.width || !msg.height) \n \
+          return; \n \
+ \n \
+        var scale = Math.min(canvas.width / msg.width, canvas.height / msg.height); \n \
+        var x0 = (canvas.width - msg.width * scale) / 2; \n \
+        var y0 = (canvas.height - msg.height * scale) / 2; \n \
+ \n \
+        ctx.lineWidth = 2; \n \
+        ctx.font = '14px sans-serif'; \n \
+        ctx.strokeStyle = ctx.fillStyle = '#76B900'; \n \
+ \n \
+        msg.objects.forEach((obj) => { \n \
+          var x = x0 + obj.box[0] * scale; \n \
+          var y = y0 + obj.box[1] * scale; \n \
+          ctx.strokeRect(x, y, (obj.box[2] - obj.box[0]) * scale, (obj.box[3] - obj.box[1]) * scale); \n \
+ \n \
+          var text = obj.label; \n \
+          if (obj.confidence >= 0) \n \
+            text += ' ' + (obj.confidence * 100).toFixed(1) + '%%'; \n \
+          if (text.length > 0) \n \
+            ctx.fillText(text, x + 2, (y > 16) ? y - 4 : y + 14); \n \
+        }); \n \
+      } \n \
+ \n \
+ \n \
+      function onRedirect(path) { \n \
+        console.log('Switching to lower-resolution stream ' + path); \n \
+        websocketConnection.close(); \n \
+ \n \
+        if (webrtcPeerConnection) { \n \
+          webrtcPeerConnection.close(); \n \
+          webrtcPeerConnection = null; \n \
+        } \n \
+ \n \
+        playStream(videoElement, null, null, path, webrtcConfiguration, reportError); \n \
+      } \n \
+ \n \
  \n \
       function onServerMessage(event) { \n \
         var msg; \n \
@@ -145,12 +214,18 @@ const char* html_viewer = " \n \
         } catch (e) { \n \
           return; \n \
         } \n \
+ \n \
+        if (msg.type == 'redirect') { \n \
+          onRedirect(msg.data); \n \
+          return; \n \
+        } \n \
  \n \
         if (!webrtcPeerConnection) { \n \
           webrtcPeerConnection = new RTCPeerConnection(webrtcConfiguration); \n \
 		webrtcPeerConnection.onconnectionstatechange = onConnectionStateChange; \n \
           webrtcPeerConnection.ontrack = onAddRemoteStream; \n \
           webrtcPeerConnection.onicecandidate = onIceCandidate; \n \
+          webrtcPeerConnection.ondatachannel = onDataChannel; \n \
         } \n \
  \n \
         switch (msg.type) { \n \
@@ -189,8 +264,9 @@ const char* html_viewer = " \n \
   </head> \n \
  \n \
   <body style='background-color:#333333; color:#FFFFFF;'> \n \
-    <div> \n \
+    <div style='position:relative; display:inline-block;'> \n \
       <video id='stream' autoplay controls playsinline muted>Your browser does not support video</video> \n \
+      <canvas id='overlay' style='position:absolute; left:0; top:0; pointer-events:none;'></canvas> \n \
     </div> \n \
     <pre>%s</pre> \n \
     <pre id='stats'></pre> \n \
@@ -375,6 +451,9 @@ WebRTCServer::WebRTCServer( uint16_t port, const char* stun_server, const char*
 	mPeerCount = 0;
 	mHasHTTPS = false;
 	mSoupServer = NULL;
+	mThread = NULL;
+	mContext = g_main_context_new();
+	mMainLoop = g_main_loop_new(mContext, false);
 	
 	if( stun_server != NULL )
 		mStunServer = stun_server;
@@ -402,7 +481,8 @@ WebRTCServer::~WebRTCServer()
 	
 	if( mThread != NULL )
 	{
-		//mThread->Stop(true);
+		g_main_loop_quit(mMainLoop);
+		mThread->Stop(true);	// wait for the thread to exit
 		delete mThread;
 		mThread = NULL;
 	}
@@ -412,6 +492,18 @@ WebRTCServer::~WebRTCServer()
 		g_object_unref(mSoupServer);
 		mSoupServer = NULL;
 	}
+
+	if( mMainLoop != NULL )
+	{
+		g_main_loop_unref(mMainLoop);
+		mMainLoop = NULL;
+	}
+
+	if( mContext != NULL )
+	{
+		g_main_context_unref(mContext);
+		mContext = NULL;
+	}
 }
 
 
@@ -454,17 +546,30 @@ WebRTCServer* WebRTCServer::Create( uint16_t port, const char* stun_server, cons
 	if( !server || !server->init() )
 	{
 		LogError(LOG_WEBRTC "failed to create WebRTC server on port %hu\n", port);
+		delete server;
 		return NULL;
 	}
 	
 	// start the thread if needed
 	if( server->mThread != NULL )
 	{
+		// signal when the loop is running, so that it can't be quit before it starts
+		GSource* source = g_idle_source_new();
+		g_source_set_callback(source, onThreadStarted, server, NULL);
+		g_source_attach(source, server->mContext);
+		g_source_unref(source);
+		
 		if( !server->mThread->Start(runThread, server) )
 		{
 			LogError(LOG_WEBRTC "failed to start thread for running WebRTC server\n");
+			delete server->mThread;
+			server->mThread = NULL;
+			delete server;
 			return NULL;
 		}
+		
+		if( !server->mThreadStarted.Wait(WEBRTC_START_TIMEOUT) )
+			LogWarning(LOG_WEBRTC "timeout waiting for the WebRTC server thread to start\n");
 	}
 	
 	gWebRTCServers.push_back(server);
@@ -475,6 +580,12 @@ WebRTCServer* WebRTCServer::Create( uint16_t port, const char* stun_server, cons
 // init
 bool WebRTCServer::init()
 {
+	if( !mContext || !mMainLoop )
+	{
+		LogError(LOG_WEBRTC "failed to create GMainContext for the server\n");
+		return false;
+	}
+	
 	// create the soup server
 	mSoupServer = soup_server_new(SOUP_SERVER_SERVER_HEADER, "webrtc-server", NULL);
 	
@@ -512,10 +623,14 @@ bool WebRTCServer::init()
 	
 	AddRoute("/", onHttpDefault, this);  // serve the server-default HTML pages
 	
-	// start the server listening
+	// start the server listening (on the thread-default context, so it runs on the server's context)
 	GError* err = NULL;
 
-	if( !soup_server_listen_all(mSoupServer, mPort, mHasHTTPS ? SOUP_SERVER_LISTEN_HTTPS : (SoupServerListenOptions)0, &err) )
+	g_main_context_push_thread_default(mContext);
+	const bool listening = soup_server_listen_all(mSoupServer, mPort, mHasHTTPS ? SOUP_SERVER_LISTEN_HTTPS : (SoupServerListenOptions)0, &err);
+	g_main_context_pop_thread_default(mContext);
+
+	if( !listening )
 	{
 		LogError(LOG_WEBRTC "SOUP server failed to listen on port %hu\n", mPort);
 		LogError(LOG_WEBRTC "   (%s)\n", err->message);
@@ -542,7 +657,20 @@ void WebRTCServer::AddRoute( const char* path, WebRTCServer::HttpListener callba
 	}
 	
 	if( !callback )
+	{
+		// remove the route for this path
+		for( size_t n=0; n < mHttpRoutes.size(); n++ )
+		{
+			if( mHttpRoutes[n]->path == path )
+			{
+				freeRoute(mHttpRoutes[n]);
+				mHttpRoutes.erase(mHttpRoutes.begin() + n);
+				break;
+			}
+		}
+
 		return;
+	}
 	
 	// if there was an existing root route, remove it
 	if( mHttpRoutes.size() == 1 && mHttpRoutes[0]->path == "/" )
@@ -592,7 +720,20 @@ void WebRTCServer::AddRoute( const char* path, WebRTCServer::WebsocketListener c
 	}
 	
 	if( !callback )
+	{
+		// remove the route for this path
+		for( size_t n=0; n < mWebsocketRoutes.size(); n++ )
+		{
+			if( mWebsocketRoutes[n]->path == path )
+			{
+				freeRoute(mWebsocketRoutes[n]);
+				mWebsocketRoutes.erase(mWebsocketRoutes.begin() + n);
+				break;
+			}
+		}
+
 		return;
+	}
 	
 	// create a new route
 	WebsocketRoute* route = new WebsocketRoute();
@@ -698,6 +839,13 @@ void WebRTCServer::onHttpRequest( SoupServer* soup_server, SoupMessage* message,
 			route = server->mHttpRoutes[0];
 	}
 
+	// the built-in metrics route (unless the application added its own)
+	if( !route && strcmp(path, "/metrics") == 0 )
+	{
+		onHttpMetrics(soup_server, message, path, query, client_context, user_data);
+		return;
+	}
+
 	if( !route )
 	{
 		LogVerbose(LOG_WEBRTC "%s %s %s '%s' -- not found 404\n", server->HasHTTPS() ? "HTTPS" : "HTTP", soup_client_context_get_host(client_context), message->method, path);
@@ -711,7 +859,28 @@ void WebRTCServer::onHttpRequest( SoupServer* soup_server, SoupMessage* message,
 	route->callback(soup_server, message, path, query, client_context, route->user_data);
 }
 
-	
+
+// onHttpMetrics (this serves the metrics in the Prometheus text format)
+void WebRTCServer::onHttpMetrics( SoupServer* soup_server, SoupMessage* message, const char* path, GHashTable* query, SoupClientContext* client_context, void* user_data )
+{
+	if( message->method != SOUP_METHOD_GET && message->method != SOUP_METHOD_HEAD )
+	{
+		soup_message_set_status(message, SOUP_STATUS_NOT_IMPLEMENTED);
+		return;
+	}
+
+	const std::string metrics = videoMetrics::Render();
+
+	SoupBuffer* soup_buffer = soup_buffer_new(SOUP_MEMORY_COPY, metrics.c_str(), metrics.length());
+
+	soup_message_headers_set_content_type(message->response_headers, "text/plain; version=0.0.4", NULL);
+	soup_message_body_append_buffer(message->response_body, soup_buffer);
+	soup_buffer_free(soup_buffer);
+
+	soup_message_set_status(message, SOUP_STATUS_OK);
+}
+
+
 // onHttpDefault (this serves the default site)
 void WebRTCServer::onHttpDefault( SoupServer* soup_server, SoupMessage* message, const char* path, GHashTable* query, SoupClientContext* client_context, void* user_data )
 {
@@ -769,7 +938,7 @@ void WebRTCServer::onHttpDefault( SoupServer* soup_server, SoupMessage* message,
 	}
 
 	// the HTML to serve will be rendered to this buffer
-	char html[8192];
+	char html[16384];
 
 	#define CHECK_SNPRINTF(x) \
 		const int chars_needed = x; \
@@ -1002,11 +1171,56 @@ bool WebRTCServer::ProcessRequests( bool blocking )
 	// https://stackoverflow.com/questions/23737750/glib-usage-without-mainloop
 	// https://www.freedesktop.org/software/gstreamer-sdk/data/docs/2012.5/glib/glib-The-Main-Event-Loop.html#g-main-context-iteration
 	// https://developer-old.gnome.org/programming-guidelines/stable/main-contexts.html.en
-	g_main_context_iteration(NULL, blocking);
+	g_main_context_iteration(mContext, blocking);
 	return true;
 }
 
 
+// SendMessage
+void WebRTCServer::SendMessage( WebRTCPeer* peer, const char* message )
+{
+	if( !peer || !peer->connection || !message )
+		return;
+
+	// keep the connection alive until the message gets sent from the server's thread
+	std::pair<SoupWebsocketConnection*, gchar*>* msg = new std::pair<SoupWebsocketConnection*, gchar*>(peer->connection, g_strdup(message));
+	g_object_ref(msg->first);
+
+	g_main_context_invoke(mContext, onSendMessage, msg);
+}
+
+
+// Invoke
+void WebRTCServer::Invoke( GSourceFunc function, void* user_data )
+{
+	g_main_context_invoke(mContext, function, user_data);
+}
+
+
+// onSendMessage
+gboolean WebRTCServer::onSendMessage( void* user_data )
+{
+	std::pair<SoupWebsocketConnection*, gchar*>* msg = (std::pair<SoupWebsocketConnection*, gchar*>*)user_data;
+
+	if( soup_websocket_connection_get_state(msg->first) == SOUP_WEBSOCKET_STATE_OPEN )
+		soup_websocket_connection_send_text(msg->first, msg->second);
+
+	g_object_unref(msg->first);
+	g_free(msg->second);
+	delete msg;
+
+	return G_SOURCE_REMOVE;
+}
+
+
+// onThreadStarted (called from inside the main loop once it's running)
+gboolean WebRTCServer::onThreadStarted( void* user_data )
+{
+	((WebRTCServer*)user_data)->mThreadStarted.Wake();
+	return G_SOURCE_REMOVE;
+}
+
+
 // runThread
 void* WebRTCServer::runThread( void* user_data )
 {
@@ -1017,8 +1231,10 @@ void* WebRTCServer::runThread( void* user_data )
 	
 	LogVerbose(LOG_WEBRTC "WebRTC server thread running...\n");
 	
-	while( server->mRefCount > 0 )
-		server->ProcessRequests(true);
+	// make the context the thread's default, for sources that get created while serving clients
+	g_main_context_push_thread_default(server->mContext);
+	g_main_loop_run(server->mMainLoop);
+	g_main_context_pop_thread_default(server->mContext);
 	
 	LogVerbose(LOG_WEBRTC "WebRTC server thread stopped\n");
 	return 0;
@@ -25,6 +25,8 @@
 
 #include <libsoup/soup.h>
 
+#include "Event.h"
+
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -54,6 +56,12 @@ class Thread;
  */
 #define LOG_WEBRTC "[webrtc] "
 
+/**
+ * Maximum time (in milliseconds) to wait for the WebRTC server thread to start.
+ * @ingroup network
+ */
+#define WEBRTC_START_TIMEOUT 1500
+
 
 /**
  * Flags for route decorators or peer state.
@@ -108,9 +116,16 @@ struct WebRTCPeer
  * 
  * By default it also serves simple HTML for viewing video streams in browsers, 
  * but for full hosting you'll want to run this alongside an actual webserver. 
+ * The `/metrics` route exports the statistics of the video streams, profiler and
+ * CUDA memory in the Prometheus text format for monitoring (see videoMetrics).
  *
  * multi-stream :: multi-client :: full-duplex
  *
+ * Each server runs on its own GMainContext, so it doesn't depend on (or interfere with)
+ * the default main context of the application.  By default that context gets run in the
+ * server's own thread, where the HTTP requests and websocket messages are handled and
+ * the route callbacks are called from.  Use SendMessage() to reply to peers from other threads.
+ *
  * @ingroup network
  */
 class WebRTCServer
@@ -187,9 +202,27 @@ public:
 	 * Otherwise, ProcessRequests() must be called periodically.
 	 */
 	inline bool IsThreaded() const				{ return (mThread != NULL); }
+
+	/**
+	 * Send a text message to the peer over its websocket.  This is thread-safe, and can
+	 * be called from any thread (like GStreamer's) - the message gets copied and sent
+	 * from the server's thread.  If the peer has disconnected, the message is discarded.
+	 */
+	void SendMessage( WebRTCPeer* peer, const char* message );
+
+	/**
+	 * Call a function from the server's thread (or right away, if called from the server's thread).
+	 * Objects of the soup server, like the messages of HTTP requests, should only be accessed from there.
+	 */
+	void Invoke( GSourceFunc function, void* user_data );
+
+	/**
+	 * Return the soup server (which should only be used from the server's thread, see Invoke()).
+	 */
+	inline SoupServer* GetSoupServer() const		{ return mSoupServer; }
 	
 	/**
-	 * Process incoming requests on the server.
+	 * Process incoming requests on the server, by iterating the server's GMainContext.
 	 * If set to blocking, the function can wait indefinitely for requests.
 	 * This should only be called externally if the server was created with threaded=false
 	 */
@@ -203,8 +236,11 @@ protected:
 	bool init();
 
 	static void* runThread( void* user_data );
+	static gboolean onThreadStarted( void* user_data );
+	static gboolean onSendMessage( void* user_data );
 	
 	static void onHttpRequest( SoupServer* soup_server, SoupMessage* message, const char* path, GHashTable* query, SoupClientContext* client_context, void* user_data );
+	static void onHttpMetrics( SoupServer* soup_server, SoupMessage* message, const char* path, GHashTable* query, SoupClientContext* client_context, void* user_data );
 	static void onHttpDefault( SoupServer* soup_server, SoupMessage* message, const char* path, GHashTable* query, SoupClientContext* client_context, void* user_data );
 	
 	static void onWebsocketOpened( SoupServer* server, SoupWebsocketConnection* connection, const char *path, SoupClientContext* client_context, void* user_data );
@@ -253,6 +289,10 @@ protected:
 	uint32_t mPeerCount;
 	
 	Thread* mThread;
+	Event   mThreadStarted;
+	
+	GMainContext* mContext;		// the context that the soup server runs on
+	GMainLoop*    mMainLoop;	// for running the context in the server's thread
 };
 
 #endif
@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "profiler.h"
+#include "csvWriter.h"
+#include "logging.h"
+#include "Mutex.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+
+// the maximum number of event pairs that can wait to be read back per stage
+#define PROFILER_MAX_PENDING 64
+
+bool Profiler::mEnabled = false;
+
+
+// series of samples (CPU or GPU times)
+struct profilerSeries
+{
+	double   total;
+	float    min;
+	float    max;
+	float    last;
+	uint64_t count;
+	float    history[PROFILER_HISTORY];
+
+	profilerSeries()	{ Reset(); }
+
+	void Reset()
+	{
+		total = 0.0;
+		min   = 0.0f;
+		max   = 0.0f;
+		last  = 0.0f;
+		count = 0;
+	}
+
+	void Add( float time )
+	{
+		if( count == 0 || time < min )
+			min = time;
+
+		if( count == 0 || time > max )
+			max = time;
+
+		history[count % PROFILER_HISTORY] = time;
+
+		total += time;
+		last = time;
+		count++;
+	}
+
+	void GetStats( profilerStats* stats ) const
+	{
+		memset(stats, 0, sizeof(profilerStats));
+
+		if( count == 0 )
+			return;
+
+		stats->min   = min;
+		stats->max   = max;
+		stats->avg   = total / count;
+		stats->last  = last;
+		stats->count = count;
+
+		// p99 over the samples in the history
+		const size_t n = std::min<uint64_t>(count, PROFILER_HISTORY);
+		std::vector<float> sorted(history, history + n);
+		std::vector<float>::iterator p99 = sorted.begin() + (size_t)((n - 1) * 0.99f);
+
+		std::nth_element(sorted.begin(), p99, sorted.end());
+		stats->p99 = *p99;
+	}
+};
+
+
+// profiler stage
+struct profilerStage
+{
+	std::string    name;
+	profilerSeries cpu;
+	profilerSeries gpu;
+
+	std::vector< std::pair<cudaEvent_t, cudaEvent_t> > pending;
+};
+
+static std::vector<profilerStage*> gStages;	// stages are only added, never removed
+static std::vector<cudaEvent_t> gEventPool;
+static Mutex gMutex;
+
+
+// findStage (the mutex should be locked)
+static profilerStage* findStage( const char* name, bool create )
+{
+	const size_t numStages = gStages.size();
+
+	for( size_t n=0; n < numStages; n++ )
+	{
+		if( strcmp(gStages[n]->name.c_str(), name) == 0 )
+			return gStages[n];
+	}
+
+	if( !create )
+		return NULL;
+
+	profilerStage* stage = new profilerStage();
+	stage->name = name;
+	gStages.push_back(stage);
+
+	return stage;
+}
+
+
+// releaseEvent (the mutex should be locked)
+static void releaseEvent( cudaEvent_t event )
+{
+	if( event != NULL )
+		gEventPool.push_back(event);
+}
+
+
+// resolvePending (the mutex should be locked)
+static void resolvePending( profilerStage* stage )
+{
+	size_t n = 0;
+
+	while( n < stage->pending.size() )
+	{
+		const std::pair<cudaEvent_t, cudaEvent_t> events = stage->pending[n];
+		const cudaError_t status = cudaEventQuery(events.second);
+
+		if( status == cudaErrorNotReady )
+		{
+			n++;
+			continue;
+		}
+
+		if( status == cudaSuccess )
+		{
+			float time = 0.0f;
+
+			if( cudaEventElapsedTime(&time, events.first, events.second) == cudaSuccess )
+				stage->gpu.Add(time);
+		}
+
+		releaseEvent(events.first);
+		releaseEvent(events.second);
+
+		stage->pending.erase(stage->pending.begin() + n);
+	}
+}
+
+
+// SetEnabled
+void Profiler::SetEnabled( bool enabled )
+{
+	if( enabled == mEnabled )
+		return;
+
+	LogVerbose(LOG_PROFILER "profiling %s\n", enabled ? "enabled" : "disabled");
+	mEnabled = enabled;
+}
+
+
+// ParseCmdLine
+void Profiler::ParseCmdLine( const int argc, char** argv )
+{
+	ParseCmdLine(commandLine(argc, argv));
+}
+
+
+// ParseCmdLine
+void Profiler::ParseCmdLine( const commandLine& cmdLine )
+{
+	if( cmdLine.GetFlag("profile") )
+		SetEnabled(true);
+}
+
+
+// AllocEvent
+cudaEvent_t Profiler::AllocEvent()
+{
+	cudaEvent_t event = NULL;
+
+	gMutex.Lock();
+
+	if( gEventPool.size() > 0 )
+	{
+		event = gEventPool.back();
+		gEventPool.pop_back();
+	}
+
+	gMutex.Unlock();
+
+	if( event != NULL )
+		return event;
+
+	if( CUDA_FAILED(cudaEventCreate(&event)) )
+		return NULL;
+
+	return event;
+}
+
+
+// FreeEvent
+void Profiler::FreeEvent( cudaEvent_t event )
+{
+	gMutex.Lock();
+	releaseEvent(event);
+	gMutex.Unlock();
+}
+
+
+// AddSample
+void Profiler::AddSample( const char* name, float cpuTime )
+{
+	AddSample(name, cpuTime, NULL, NULL);
+}
+
+
+// AddSample
+void Profiler::AddSample( const char* name, float cpuTime, cudaEvent_t start, cudaEvent_t stop )
+{
+	if( !name )
+		return;
+
+	gMutex.Lock();
+
+	profilerStage* stage = findStage(name, true);
+
+	stage->cpu.Add(cpuTime);
+
+	if( start != NULL && stop != NULL )
+	{
+		// if the stream stalled, drop the oldest events instead of growing forever
+		if( stage->pending.size() >= PROFILER_MAX_PENDING )
+		{
+			releaseEvent(stage->pending[0].first);
+			releaseEvent(stage->pending[0].second);
+			stage->pending.erase(stage->pending.begin());
+		}
+
+		stage->pending.push_back(std::pair<cudaEvent_t, cudaEvent_t>(start, stop));
+	}
+	else
+	{
+		releaseEvent(start);
+		releaseEvent(stop);
+	}
+
+	resolvePending(stage);
+	gMutex.Unlock();
+}
+
+
+// GetStats
+bool Profiler::GetStats( const char* name, profilerStats* cpu, profilerStats* gpu )
+{
+	if( !name )
+		return false;
+
+	gMutex.Lock();
+
+	profilerStage* stage = findStage(name, false);
+
+	if( stage != NULL )
+	{
+		resolvePending(stage);
+
+		if( cpu != NULL )
+			stage->cpu.GetStats(cpu);
+
+		if( gpu != NULL )
+			stage->gpu.GetStats(gpu);
+	}
+
+	gMutex.Unlock();
+	return (stage != NULL);
+}
+
+
+// GetStages
+std::vector<std::string> Profiler::GetStages()
+{
+	std::vector<std::string> names;
+
+	gMutex.Lock();
+
+	for( size_t n=0; n < gStages.size(); n++ )
+		names.push_back(gStages[n]->name);
+
+	gMutex.Unlock();
+	return names;
+}
+
+
+// Print
+void Profiler::Print()
+{
+	const std::vector<std::string> stages = GetStages();
+
+	LogInfo(LOG_PROFILER "%-26s %8s  %8s %8s %8s %8s  %8s %8s %8s %8s\n", "stage", "count",
+		   "cpu min", "cpu avg", "cpu p99", "cpu max", "gpu min", "gpu avg", "gpu p99", "gpu max");
+
+	for( size_t n=0; n < stages.size(); n++ )
+	{
+		profilerStats cpu;
+		profilerStats gpu;
+
+		if( !GetStats(stages[n].c_str(), &cpu, &gpu) )
+			continue;
+
+		if( gpu.count > 0 )
+		{
+			LogInfo(LOG_PROFILER "%-26s %8llu  %8.3f %8.3f %8.3f %8.3f  %8.3f %8.3f %8.3f %8.3f\n", stages[n].c_str(), (unsigned long long)cpu.count,
+				   cpu.min, cpu.avg, cpu.p99, cpu.max, gpu.min, gpu.avg, gpu.p99, gpu.max);
+		}
+		else
+		{
+			LogInfo(LOG_PROFILER "%-26s %8llu  %8.3f %8.3f %8.3f %8.3f  %8s %8s %8s %8s\n", stages[n].c_str(), (unsigned long long)cpu.count,
+				   cpu.min, cpu.avg, cpu.p99, cpu.max, "-", "-", "-", "-");
+		}
+	}
+}
+
+
+// SaveCSV
+bool Profiler::SaveCSV( const char* filename )
+{
+	csvWriter* csv = csvWriter::Open(filename);
+
+	if( !csv )
+	{
+		LogError(LOG_PROFILER "failed to open '%s' for writing\n", filename);
+		return false;
+	}
+
+	csv->WriteLine("stage", "count", "cpu_min", "cpu_avg", "cpu_p99", "cpu_max",
+				"gpu_count", "gpu_min", "gpu_avg", "gpu_p99", "gpu_max");
+
+	const std::vector<std::string> stages = GetStages();
+
+	for( size_t n=0; n < stages.size(); n++ )
+	{
+		profilerStats cpu;
+		profilerStats gpu;
+
+		if( !GetStats(stages[n].c_str(), &cpu, &gpu) )
+			continue;
+
+		csv->WriteLine(stages[n], cpu.count, cpu.min, cpu.avg, cpu.p99, cpu.max,
+					gpu.count, gpu.min, gpu.avg, gpu.p99, gpu.max);
+	}
+
+	delete csv;
+
+	LogVerbose(LOG_PROFILER "saved %zu stages to '%s'\n", stages.size(), filename);
+	return true;
+}
+
+
+// Reset
+void Profiler::Reset()
+{
+	gMutex.Lock();
+
+	for( size_t n=0; n < gStages.size(); n++ )
+	{
+		gStages[n]->cpu.Reset();
+		gStages[n]->gpu.Reset();
+	}
+
+	gMutex.Unlock();
+}
+
+
+// begin
+void profilerScope::begin( const char* stage )
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	mStage = stage;
+	mBegin = (uint64_t)t.tv_sec * uint64_t(1000000000) + (uint64_t)t.tv_nsec;
+}
+
+
+// end
+void profilerScope::end()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	const uint64_t now = (uint64_t)t.tv_sec * uint64_t(1000000000) + (uint64_t)t.tv_nsec;
+	const float cpuTime = (now - mBegin) * 0.000001f;
+
+	cudaEvent_t stop = NULL;
+
+	if( mStart != NULL )
+	{
+		stop = Profiler::AllocEvent();
+
+		if( stop != NULL && cudaEventRecord(stop, mStream) != cudaSuccess )
+		{
+			Profiler::FreeEvent(stop);
+			stop = NULL;
+		}
+	}
+
+	Profiler::AddSample(mStage, cpuTime, mStart, stop);
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __PROFILER_H_
+#define __PROFILER_H_
+
+#include "cudaUtility.h"
+#include "commandLine.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+/**
+ * Number of recent samples that each stage keeps for computing the p99 time.
+ * @ingroup profiler
+ */
+#define PROFILER_HISTORY 1024
+
+/**
+ * Prefix used for log messages from the profiler
+ * @ingroup profiler
+ */
+#define LOG_PROFILER "[profiler] "
+
+
+/**
+ * Timing statistics of one profiler stage, with all of the times in milliseconds.
+ *
+ * The min/max/avg are over every sample since the profiler was last reset,
+ * while the p99 is over the last PROFILER_HISTORY samples.
+ *
+ * @ingroup profiler
+ */
+struct profilerStats
+{
+	float    min;		/**< Minimum time */
+	float    max;		/**< Maximum time */
+	float    avg;		/**< Average time */
+	float    p99;		/**< 99th percentile time */
+	float    last;		/**< The most recent time */
+	uint64_t count;	/**< Number of samples */
+};
+
+
+/**
+ * Per-stage profiler that aggregates CPU times, and GPU times from CUDA events.
+ *
+ * Stages are identified by name, and are timed with a profilerScope, or with the
+ * PROFILER_SCOPE() / PROFILER_SCOPE_CUDA() macros.  jetson-utils itself times:
+ *
+ *   - `gstBufferManager::Dequeue` (colorspace conversion of captured frames)
+ *   - `cudaConvertColor`
+ *   - `gstEncoder::Render`
+ *   - `glDisplay::RenderImage`
+ *   - `cudaFont::OverlayText`
+ *
+ * When a stage is timed on a CUDA stream, a pair of events is recorded around
+ * it on that stream.  The events are read back later with cudaEventQuery(), so
+ * profiling never synchronizes the stream - the GPU times just lag a few frames.
+ *
+ * The profiler is disabled by default, and while it's disabled the scopes
+ * return immediately.  Enable it with Profiler::SetEnabled() or `--profile`.
+ *
+ * @ingroup profiler
+ */
+class Profiler
+{
+public:
+	/**
+	 * Enable or disable profiling.
+	 */
+	static void SetEnabled( bool enabled=true );
+
+	/**
+	 * Return true if profiling is enabled.
+	 */
+	static inline bool IsEnabled()			{ return mEnabled; }
+
+	/**
+	 * Parse the `--profile` command-line option.
+	 */
+	static void ParseCmdLine( const int argc, char** argv );
+
+	/**
+	 * Parse the `--profile` command-line option.
+	 */
+	static void ParseCmdLine( const commandLine& cmdLine );
+
+	/**
+	 * Add a CPU time sample (in milliseconds) to a stage.
+	 */
+	static void AddSample( const char* stage, float cpuTime );
+
+	/**
+	 * Add a CPU time sample (in milliseconds) to a stage, along with a pair of
+	 * CUDA events that were recorded around the stage's GPU work.  The events
+	 * are owned by the profiler afterwards.
+	 */
+	static void AddSample( const char* stage, float cpuTime, cudaEvent_t start, cudaEvent_t stop );
+
+	/**
+	 * Retrieve the statistics of a stage.  Either pointer can be NULL.
+	 * The GPU stats have a count of zero if the stage wasn't timed on a stream.
+	 * @returns false if the stage hasn't been recorded.
+	 */
+	static bool GetStats( const char* stage, profilerStats* cpu, profilerStats* gpu=NULL );
+
+	/**
+	 * Retrieve the names of the stages that have been recorded.
+	 */
+	static std::vector<std::string> GetStages();
+
+	/**
+	 * Print a table of the statistics to the log.
+	 */
+	static void Print();
+
+	/**
+	 * Save the statistics of every stage to a CSV file.
+	 */
+	static bool SaveCSV( const char* filename );
+
+	/**
+	 * Clear the statistics of every stage.
+	 */
+	static void Reset();
+
+	/**
+	 * @internal Retrieve a CUDA event from the pool (or create one).
+	 */
+	static cudaEvent_t AllocEvent();
+
+	/**
+	 * @internal Return a CUDA event to the pool.
+	 */
+	static void FreeEvent( cudaEvent_t event );
+
+protected:
+	static bool mEnabled;
+};
+
+
+/**
+ * Times the scope that it lives in as a profiler stage.
+ *
+ * If a CUDA stream is given, the GPU time of the work that's queued on that stream
+ * from the construction to the destruction of the scope is also measured.
+ * Nothing is done if the profiler is disabled.
+ *
+ * @ingroup profiler
+ */
+class profilerScope
+{
+public:
+	/**
+	 * Time the CPU only.  The stage name should be a string literal.
+	 */
+	inline profilerScope( const char* stage ) : mStage(NULL), mStart(NULL), mStream(NULL)
+	{
+		if( Profiler::IsEnabled() )
+			begin(stage);
+	}
+
+	/**
+	 * Time the CPU and the work queued on `stream`.
+	 */
+	inline profilerScope( const char* stage, cudaStream_t stream ) : mStage(NULL), mStart(NULL), mStream(stream)
+	{
+		if( Profiler::IsEnabled() )
+		{
+			begin(stage);
+			mStart = Profiler::AllocEvent();
+
+			if( mStart != NULL )
+				cudaEventRecord(mStart, mStream);
+		}
+	}
+
+	/**
+	 * Stop timing, and add the sample to the profiler.
+	 */
+	inline ~profilerScope()
+	{
+		if( mStage != NULL )
+			end();
+	}
+
+private:
+	void begin( const char* stage );
+	void end();
+
+	const char*  mStage;
+	cudaEvent_t  mStart;
+	cudaStream_t mStream;
+	uint64_t     mBegin;
+};
+
+
+/**
+ * @internal Concatenate tokens for a unique variable name
+ * @ingroup profiler
+ */
+#define PROFILER_CONCAT_(a, b)  a##b
+#define PROFILER_CONCAT(a, b)   PROFILER_CONCAT_(a, b)
+
+/**
+ * Time the CPU for the rest of the current scope.
+ * @ingroup profiler
+ */
+#define PROFILER_SCOPE(stage)   profilerScope PROFILER_CONCAT(__profilerScope, __LINE__)(stage)
+
+/**
+ * Time the CPU and the work queued on a CUDA stream for the rest of the current scope.
+ * @ingroup profiler
+ */
+#define PROFILER_SCOPE_CUDA(stage, stream)   profilerScope PROFILER_CONCAT(__profilerScope, __LINE__)(stage, stream)
+
+
+#endif
@@ -23,13 +23,19 @@
 #include "PyCUDA.h"
 
 #include "cudaMappedMemory.h"
+#include "cudaMemoryPool.h"
 #include "cudaColorspace.h"
 #include "cudaNormalize.h"
+#include "cudaPreprocess.h"
 #include "cudaOverlay.h"
 #include "cudaResize.h"
 #include "cudaCrop.h"
 #include "cudaFont.h"
 #include "cudaDraw.h"
+#include "cudaWarp.h"
+#include "cudaColormap.h"
+#include "cudaPointCloud.h"
+#include "cudaIpc.h"
 
 #include "logging.h"
 
@@ -53,6 +59,10 @@ static PyObject* PyCudaMemory_New( PyTypeObject *type, PyObject *args, PyObject
 	self->size = 0;
 	self->mapped = false;
 	self->freeOnDelete = true;
+	self->owner = NULL;
+	self->tensorDims = 0;
+	self->tensorType = NULL;
+	self->tensorDescr = NULL;
 
 	return (PyObject*)self;
 }
@@ -64,14 +74,19 @@ static void PyCudaMemory_Dealloc( PyCudaMemory* self )
 	
 	if( self->freeOnDelete && self->ptr != NULL )
 	{
-		if( self->mapped )
-			CUDA(cudaFreeHost(self->ptr));
+		if( cudaFreePooled(self->ptr) )
+			LogDebug(LOG_PY_UTILS "returned memory %p to the pool\n", self->ptr);
+		else if( self->mapped )
+			cudaFreeMapped(self->ptr);
 		else
 			CUDA(cudaFree(self->ptr));
 
 		self->ptr = NULL;
 	}
 
+	Py_CLEAR(self->owner);
+	Py_CLEAR(self->tensorDescr);
+
 	// free the container
 	Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -100,7 +115,7 @@ static int PyCudaMemory_Init( PyCudaMemory* self, PyObject *args, PyObject *kwds
 	// allocate CUDA memory
 	if( mapped > 0 )
 	{
-		if( !cudaAllocMapped(&self->ptr, size) )
+		if( !cudaAllocMappedPooled(&self->ptr, size) )
 		{
 			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMemory.__init()__ failed to allocate CUDA mapped memory");
 			return -1;
@@ -108,7 +123,7 @@ static int PyCudaMemory_Init( PyCudaMemory* self, PyObject *args, PyObject *kwds
 	}
 	else
 	{
-		if( CUDA_FAILED(cudaMalloc(&self->ptr, size)) )
+		if( !cudaMallocPooled(&self->ptr, size) )
 		{
 			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMemory.__init()__ failed to allocate CUDA memory");
 			return -1;
@@ -164,6 +179,44 @@ static PyObject* PyCudaMemory_GetFreeOnDelete( PyCudaMemory* self, void* closure
 	PY_RETURN_BOOL(self->freeOnDelete);
 }
 
+// PyCudaMemory_GetShape
+static PyObject* PyCudaMemory_GetShape( PyCudaMemory* self, void* closure )
+{
+	// plain memory is described as a 1D array of bytes
+	if( self->tensorDims <= 0 )
+		return Py_BuildValue("(n)", (Py_ssize_t)self->size);
+
+	PyObject* shape = PyTuple_New(self->tensorDims);
+
+	for( int n=0; n < self->tensorDims; n++ )
+		PyTuple_SetItem(shape, n, PyLong_FromSsize_t(self->tensorShape[n]));
+
+	return shape;
+}
+
+// PyCudaMemory_GetCudaArrayInterface
+static PyObject* PyCudaMemory_GetCudaArrayInterface( PyCudaMemory* self, void* closure )
+{
+	// https://numba.readthedocs.io/en/stable/cuda/cuda_array_interface.html
+	PyObject* shape = PyCudaMemory_GetShape(self, closure);
+
+	if( !shape )
+		return NULL;
+
+	PyObject* dict = Py_BuildValue("{s:N,s:s,s:(KO),s:i,s:i}",
+							 "shape", shape,
+							 "typestr", (self->tensorDims > 0 && self->tensorType != NULL) ? self->tensorType : "|u1",
+							 "data", (unsigned long long)self->ptr, Py_False,
+							 "version", 3,
+							 "stream", 1);	// the legacy default stream
+
+	// structured tensors also describe their fields
+	if( dict != NULL && self->tensorDims > 0 && self->tensorDescr != NULL )
+		PyDict_SetItemString(dict, "descr", self->tensorDescr);
+
+	return dict;
+}
+
 static PyGetSetDef pyCudaMemory_GetSet[] = 
 {
 	{ "ptr", (getter)PyCudaMemory_GetPtr, NULL, "Address of CUDA memory", NULL},
@@ -171,6 +224,8 @@ static PyGetSetDef pyCudaMemory_GetSet[] =
 	{ "mapped", (getter)PyCudaMemory_GetMapped, NULL, "Is the memory mapped to CPU also? (zeroCopy)", NULL},
 	{ "freeOnDelete", (getter)PyCudaMemory_GetFreeOnDelete, NULL, "Will the CUDA memory be released when the Python object is deleted?", NULL},	
 	{ "gpudata", (getter)PyCudaMemory_GetPtr, NULL, "Address of CUDA memory (PyCUDA interface)", NULL},
+	{ "shape", (getter)PyCudaMemory_GetShape, NULL, "Shape of the tensor stored in the memory (or the size in bytes)", NULL},
+	{ "__cuda_array_interface__", (getter)PyCudaMemory_GetCudaArrayInterface, NULL, "Numba __cuda_array_interface__ dict", NULL},
 	{ NULL } /* Sentinel */
 };
 
@@ -232,6 +287,10 @@ static PyObject* PyCudaImage_New( PyTypeObject *type, PyObject *args, PyObject *
 	self->base.size = 0;
 	self->base.mapped = false;
 	self->base.freeOnDelete = true;
+	self->base.owner = NULL;
+	self->base.tensorDims = 0;
+	self->base.tensorType = NULL;
+	self->base.tensorDescr = NULL;
 	
 	self->width = 0;
 	self->height = 0;
@@ -242,6 +301,7 @@ static PyObject* PyCudaImage_New( PyTypeObject *type, PyObject *args, PyObject *
 	self->format = IMAGE_UNKNOWN;
 	self->timestamp = 0;
 	self->cudaArrayInterfaceDict = NULL;
+	self->stream = NULL;
 	
 	return (PyObject*)self;
 }
@@ -271,6 +331,18 @@ static void PyCudaImage_Config( PyCudaImage* self, void* ptr, uint32_t width, ui
 	self->timestamp = timestamp;
 }
 
+// PyCudaImage_IsContiguous (views created by slicing keep the pitch of their parent)
+static inline bool PyCudaImage_IsContiguous( PyCudaImage* self )
+{
+	return self->strides[0] == (Py_ssize_t)((self->width * imageFormatDepth(self->format)) / 8);
+}
+
+// PyCudaImage_SharedDestructor (frees memory from cudaAllocShared() once the cudaImage is deleted)
+static void PyCudaImage_SharedDestructor( PyObject* capsule )
+{
+	cudaFreeShared(PyCapsule_GetPointer(capsule, PY_UTILS_MODULE_NAME ".shared"));
+}
+
 // PyCudaImage_Init
 static int PyCudaImage_Init( PyCudaImage* self, PyObject *args, PyObject *kwds )
 {
@@ -281,12 +353,13 @@ static int PyCudaImage_Init( PyCudaImage* self, PyObject *args, PyObject *kwds )
 	int height = 0;
 	int mapped = 1;
 	int freeOnDelete = 1;
+	int shared = 0;
 	long long timestamp = 0;
 
 	const char* formatStr = "rgb8";
-	static char* kwlist[] = {"width", "height", "format", "timestamp", "mapped", "freeOnDelete", NULL};
+	static char* kwlist[] = {"width", "height", "format", "timestamp", "mapped", "freeOnDelete", "shared", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "ii|sLii", kwlist, &width, &height, &formatStr, &timestamp, &mapped, &freeOnDelete))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "ii|sLiii", kwlist, &width, &height, &formatStr, &timestamp, &mapped, &freeOnDelete, &shared))
 		return -1;
 
 	if( width < 0 || height < 0 )
@@ -312,9 +385,31 @@ static int PyCudaImage_Init( PyCudaImage* self, PyObject *args, PyObject *kwds )
 	// allocate CUDA memory
 	const size_t size = imageFormatSize(format, width, height);
 
+	if( shared > 0 )
+	{
+		// mapped memory in POSIX shared memory, that other processes can import with from_ipc_handle()
+		if( !cudaAllocShared(&self->base.ptr, size) )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage.__init()__ failed to allocate CUDA shared memory");
+			return -1;
+		}
+
+		self->base.owner = PyCapsule_New(self->base.ptr, PY_UTILS_MODULE_NAME ".shared", PyCudaImage_SharedDestructor);
+
+		if( !self->base.owner )
+		{
+			cudaFreeShared(self->base.ptr);
+			self->base.ptr = NULL;
+			return -1;
+		}
+
+		PyCudaImage_Config(self, self->base.ptr, width, height, format, timestamp, true, false);
+		return 0;
+	}
+
 	if( mapped > 0 )
 	{
-		if( !cudaAllocMapped(&self->base.ptr, size) )
+		if( !cudaAllocMappedPooled(&self->base.ptr, size) )
 		{
 			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage.__init()__ failed to allocate CUDA mapped memory");
 			return -1;
@@ -322,7 +417,7 @@ static int PyCudaImage_Init( PyCudaImage* self, PyObject *args, PyObject *kwds )
 	}
 	else
 	{
-		if( CUDA_FAILED(cudaMalloc(&self->base.ptr, size)) )
+		if( !cudaMallocPooled(&self->base.ptr, size) )
 		{
 			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage.__init()__ failed to allocate CUDA memory");
 			return -1;
@@ -401,6 +496,18 @@ static PyObject* PyCudaImage_GetTimestamp( PyCudaImage* self, void* closure )
 	return PYLONG_FROM_UNSIGNED_LONG_LONG(self->timestamp);
 }
 
+// PyCudaImage_GetPitch
+static PyObject* PyCudaImage_GetPitch( PyCudaImage* self, void* closure )
+{
+	return PYLONG_FROM_UNSIGNED_LONG(self->strides[0]);
+}
+
+// PyCudaImage_GetContiguous
+static PyObject* PyCudaImage_GetContiguous( PyCudaImage* self, void* closure )
+{
+	return PyBool_FromLong(PyCudaImage_IsContiguous(self));
+}
+
 // imageFormatToNumpyTypeStr
 static const char* imageFormatToNumpyTypeStr( imageFormat format )
 {
@@ -409,8 +516,12 @@ static const char* imageFormatToNumpyTypeStr( imageFormat format )
 
 	if( baseType == IMAGE_FLOAT )
 		return "<f4";
+	else if( baseType == IMAGE_HALF )
+		return "<f2";
 	else if( baseType == IMAGE_UINT8 )
 		return "<u1";
+	else if( baseType == IMAGE_UINT16 )
+		return "<u2";
 
 	return "V";
 }
@@ -421,11 +532,22 @@ static const char* imageFormatToNumpyTypeStr( imageFormat format )
 		return PyErr_Format(PyExc_Exception, LOG_PY_UTILS "failed to set key '%s' in dict", key); \
 	Py_DECREF(value)
 	
+// PyCudaImage_GetArrayStream
+static PyObject* PyCudaImage_GetArrayStream( PyCudaImage* self )
+{
+	// work without an explicit stream runs on the legacy default stream (1)
+	return PYLONG_FROM_UNSIGNED_LONG_LONG((self->stream != NULL) ? (uint64_t)self->stream : 1);
+}
+
 // PyCudaImage_GetCudaArrayInterface
 static PyObject* PyCudaImage_GetCudaArrayInterface( PyCudaImage* self, void* closure )
 {
 	if( self->cudaArrayInterfaceDict != NULL )
 	{
+		// the stream changes with the last operation that wrote to the image
+		PyObject* stream = PyCudaImage_GetArrayStream(self);
+		DICT_SET(self->cudaArrayInterfaceDict, "stream", stream);
+
 		Py_INCREF(self->cudaArrayInterfaceDict);
 		return self->cudaArrayInterfaceDict;
 	}
@@ -441,6 +563,7 @@ static PyObject* PyCudaImage_GetCudaArrayInterface( PyCudaImage* self, void* clo
 	
 	PyObject* data_ptr = PYLONG_FROM_UNSIGNED_LONG_LONG((uint64_t)self->base.ptr);
 	PyObject* data_tuple = PyTuple_Pack(2, data_ptr, Py_False);
+	PyObject* stream = PyCudaImage_GetArrayStream(self);
 	
 	Py_DECREF(data_ptr);
 
@@ -449,6 +572,14 @@ static PyObject* PyCudaImage_GetCudaArrayInterface( PyCudaImage* self, void* clo
 	DICT_SET(dict, "typestr", typestr);
 	DICT_SET(dict, "data", data_tuple);
 	DICT_SET(dict, "version", version);
+	DICT_SET(dict, "stream", stream);
+
+	// views with a pitch need strides (otherwise None means C-contiguous)
+	if( !PyCudaImage_IsContiguous(self) )
+	{
+		PyObject* strides = Py_BuildValue("(nnn)", self->strides[0], self->strides[1], self->strides[2]);
+		DICT_SET(dict, "strides", strides);
+	}
 	
 	Py_INCREF(dict);
 	
@@ -515,26 +646,23 @@ static int PyCudaImage_ParseSubscriptTuple(PyCudaImage* self, PyObject* tuple, i
 		}
 	}
 	
-	const size_t pixelDepth = imageFormatDepth(self->format);
-	const size_t baseDepth = pixelDepth / imgChannels;
-	
 	if( tupleSize == 1 )
 	{
 		// pixel index - img[y * img.width + x]
 		*numComponents = imageFormatChannels(self->format);
-		return (dims[0] * pixelDepth) / 8;
+		return (dims[0] / self->width) * self->strides[0] + (dims[0] % self->width) * self->strides[1];
 	}
 	else if( tupleSize == 2 )
 	{
 		// y, x index - img[y,x]
 		*numComponents = imageFormatChannels(self->format);
-		return ((dims[0] * self->width + dims[1]) * pixelDepth) / 8;
+		return dims[0] * self->strides[0] + dims[1] * self->strides[1];
 	}
 	else if( tupleSize == 3 )
 	{
 		// individual component index - img[y,x,channel]
 		*numComponents = 1;
-		return (((dims[0] * self->width + dims[1]) * pixelDepth) + dims[2] * baseDepth) / 8;	// return byte offset
+		return dims[0] * self->strides[0] + dims[1] * self->strides[1] + dims[2] * self->strides[2];	// return byte offset
 	}
 
 	return -1;
@@ -575,13 +703,317 @@ static int PyCudaImage_ParseSubscript(PyCudaImage* self, PyObject* key, int* num
 	}
 
 	*numComponents = imageFormatChannels(self->format);
-	offset = (offset * imageFormatDepth(self->format)) / 8;
+	offset = (offset / self->width) * self->strides[0] + (offset % self->width) * self->strides[1];
 	return offset;
 }
 
+// PyCudaImage_ParseSliceDim
+static bool PyCudaImage_ParseSliceDim( PyObject* key, Py_ssize_t length, int* start, int* count )
+{
+	if( PySlice_Check(key) )
+	{
+		Py_ssize_t begin = 0;
+		Py_ssize_t end = 0;
+		Py_ssize_t step = 0;
+		Py_ssize_t sliceLength = 0;
+
+	#if PY_MAJOR_VERSION >= 3
+		if( PySlice_GetIndicesEx(key, length, &begin, &end, &step, &sliceLength) != 0 )
+	#else
+		if( PySlice_GetIndicesEx((PySliceObject*)key, length, &begin, &end, &step, &sliceLength) != 0 )
+	#endif
+			return false;
+
+		if( step != 1 )
+		{
+			PyErr_SetString(PyExc_IndexError, LOG_PY_UTILS "cudaImage slices only support a step of 1");
+			return false;
+		}
+
+		if( sliceLength <= 0 )
+		{
+			PyErr_SetString(PyExc_IndexError, LOG_PY_UTILS "cudaImage slice was empty");
+			return false;
+		}
+
+		*start = begin;
+		*count = sliceLength;
+		return true;
+	}
+
+	// an integer index selects a single row/column (which stays a dimension of the view)
+	long index = PYLONG_AS_LONG(key);
+
+	if( index == -1 && PyErr_Occurred() != NULL )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaImage subscript had invalid element in key tuple");
+		return false;
+	}
+
+	if( index < 0 )
+		index += length;
+
+	if( index < 0 || index >= length )
+	{
+		PyErr_SetString(PyExc_IndexError, LOG_PY_UTILS "cudaImage subscript was out of range");
+		return false;
+	}
+
+	*start = index;
+	*count = 1;
+	return true;
+}
+
+// PyCudaImage_ParseSlice (returns 1 if the key contains a slice, 0 if it doesn't, or -1 on error)
+static int PyCudaImage_ParseSlice( PyCudaImage* self, PyObject* key, int* x, int* y, int* width, int* height )
+{
+	PyObject* rows = NULL;
+	PyObject* cols = NULL;
+
+	if( PySlice_Check(key) )
+	{
+		// img[y0:y1]
+		rows = key;
+	}
+	else if( PyTuple_Check(key) )
+	{
+		// img[y0:y1, x0:x1] or img[y0:y1, x0:x1, :]
+		const Py_ssize_t tupleSize = PyTuple_Size(key);
+
+		if( tupleSize != 2 && tupleSize != 3 )
+			return 0;
+
+		bool hasSlice = false;
+
+		for( Py_ssize_t n=0; n < tupleSize; n++ )
+		{
+			if( PySlice_Check(PyTuple_GetItem(key, n)) )
+				hasSlice = true;
+		}
+
+		if( !hasSlice )
+			return 0;
+
+		rows = PyTuple_GetItem(key, 0);
+		cols = PyTuple_GetItem(key, 1);
+
+		if( tupleSize == 3 )
+		{
+			int channel = 0;
+			int channels = 0;
+
+			if( !PySlice_Check(PyTuple_GetItem(key, 2)) || !PyCudaImage_ParseSliceDim(PyTuple_GetItem(key, 2), self->shape[2], &channel, &channels) || channels != self->shape[2] )
+			{
+				if( !PyErr_Occurred() )
+					PyErr_SetString(PyExc_IndexError, LOG_PY_UTILS "cudaImage slices can't select a subset of the channels");
+
+				return -1;
+			}
+		}
+	}
+	else
+	{
+		return 0;
+	}
+
+	if( !imageFormatIsRGB(self->format) && !imageFormatIsBGR(self->format) && !imageFormatIsGray(self->format) )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaImage slices are only supported for RGB/BGR/gray formats");
+		return -1;
+	}
+
+	*x = 0;
+	*y = 0;
+	*width = self->width;
+	*height = self->height;
+
+	if( !PyCudaImage_ParseSliceDim(rows, self->height, y, height) )
+		return -1;
+
+	if( cols != NULL && !PyCudaImage_ParseSliceDim(cols, self->width, x, width) )
+		return -1;
+
+	return 1;
+}
+
+// PyCudaImage_CreateView
+static PyObject* PyCudaImage_CreateView( PyCudaImage* self, int x, int y, int width, int height )
+{
+	uint8_t* ptr = ((uint8_t*)self->base.ptr) + y * self->strides[0] + x * self->strides[1];
+	PyObject* object = PyCUDA_RegisterImage(ptr, width, height, self->format, self->timestamp, self->base.mapped, false);
+
+	if( !object )
+		return NULL;
+
+	// the view shares the parent's memory and keeps its row pitch
+	PyCudaImage* view = (PyCudaImage*)object;
+
+	view->strides[0] = self->strides[0];
+	view->base.size = (height - 1) * self->strides[0] + width * self->strides[1];
+	view->stream = self->stream;
+
+	// keep the parent (and its allocation) alive for as long as the view
+	Py_INCREF(self);
+	view->base.owner = (PyObject*)self;
+
+	return object;
+}
+
+// PyCudaImage_Copy2D (copy between two images of the same size and format, either of which can be a view)
+static bool PyCudaImage_Copy2D( PyCudaImage* dst, PyCudaImage* src, cudaStream_t stream, bool async )
+{
+	if( dst->width != src->width || dst->height != src->height || dst->format != src->format )
+	{
+		PyErr_Format(PyExc_Exception, LOG_PY_UTILS "cudaImage copy needs the same dimensions and format (%ux%u %s vs %ux%u %s)",
+				   src->width, src->height, imageFormatToStr(src->format), dst->width, dst->height, imageFormatToStr(dst->format));
+		return false;
+	}
+
+	const size_t rowSize = src->width * src->strides[1];
+
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = async ? cudaMemcpy2DAsync(dst->base.ptr, dst->strides[0], src->base.ptr, src->strides[0], rowSize, src->height, cudaMemcpyDefault, stream)
+			     : cudaMemcpy2D(dst->base.ptr, dst->strides[0], src->base.ptr, src->strides[0], rowSize, src->height, cudaMemcpyDefault);
+	Py_END_ALLOW_THREADS
+
+	if( CUDA_FAILED(result) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage failed to copy the image (cudaMemcpy2D error)");
+		return false;
+	}
+
+	dst->timestamp = src->timestamp;
+	dst->stream = async ? stream : NULL;
+
+	return true;
+}
+
+// PyCudaImage_Fill (set every pixel of the image or view to a value or tuple of channels)
+static bool PyCudaImage_Fill( PyCudaImage* self, PyObject* value, cudaStream_t stream, bool async )
+{
+	const imageBaseType baseType = imageFormatBaseType(self->format);
+
+	if( baseType != IMAGE_FLOAT && baseType != IMAGE_UINT8 )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaImage fill is only supported for uint8 and float32 formats");
+		return false;
+	}
+
+	// parse the pixel value (a scalar is applied to every channel)
+	const int channels = self->shape[2];
+	float pixel[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+	PyObject* tuple = PySequence_Check(value) ? PySequence_Tuple(value) : NULL;
+
+	if( tuple != NULL )
+	{
+		if( PyTuple_Size(tuple) != channels )
+		{
+			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaImage slice was assigned a tuple with a different length than the number of image channels");
+			Py_DECREF(tuple);
+			return false;
+		}
+
+		for( int n=0; n < channels; n++ )
+			pixel[n] = PyFloat_AsDouble(PyTuple_GetItem(tuple, n));
+
+		Py_DECREF(tuple);
+	}
+	else
+	{
+		const float scalar = PyFloat_AsDouble(value);
+
+		for( int n=0; n < channels; n++ )
+			pixel[n] = scalar;
+	}
+
+	if( PyErr_Occurred() != NULL )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaImage slice was assigned an invalid value (int, float, tuple, list, or cudaImage expected)");
+		return false;
+	}
+
+	// fill the first row on the CPU, and upload it
+	const size_t pixelSize = self->strides[1];
+	const size_t rowSize = self->width * pixelSize;
+
+	uint8_t* row = (uint8_t*)malloc(rowSize);
+
+	if( !row )
+	{
+		PyErr_SetString(PyExc_MemoryError, LOG_PY_UTILS "cudaImage fill failed to allocate row buffer");
+		return false;
+	}
+
+	for( uint32_t x=0; x < self->width; x++ )
+	{
+		for( int n=0; n < channels; n++ )
+		{
+			if( baseType == IMAGE_FLOAT )
+				((float*)(row + x * pixelSize))[n] = pixel[n];
+			else
+				row[x * pixelSize + n] = (uint8_t)pixel[n];
+		}
+	}
+
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = cudaMemcpy(self->base.ptr, row, rowSize, cudaMemcpyDefault);
+	Py_END_ALLOW_THREADS
+
+	free(row);
+
+	if( CUDA_FAILED(result) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage fill failed to upload the first row");
+		return false;
+	}
+
+	// then replicate the rows that are already filled, doubling them each time
+	const size_t pitch = self->strides[0];
+	uint8_t* ptr = (uint8_t*)self->base.ptr;
+
+	Py_BEGIN_ALLOW_THREADS
+
+	for( uint32_t filled=1; filled < self->height; )
+	{
+		const uint32_t rows = (filled * 2 <= self->height) ? filled : self->height - filled;
+
+		result = async ? cudaMemcpy2DAsync(ptr + filled * pitch, pitch, ptr, pitch, rowSize, rows, cudaMemcpyDefault, stream)
+			         : cudaMemcpy2D(ptr + filled * pitch, pitch, ptr, pitch, rowSize, rows, cudaMemcpyDefault);
+
+		if( CUDA_FAILED(result) )
+			break;
+
+		filled += rows;
+	}
+
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage fill failed to replicate rows (cudaMemcpy2D error)");
+		return false;
+	}
+
+	self->stream = async ? stream : NULL;
+	return true;
+}
+
 // PyCudaImage_GetItem
 static PyObject* PyCudaImage_GetItem(PyCudaImage *self, PyObject *key)
 {
+	int x, y, width, height;
+	const int slice = PyCudaImage_ParseSlice(self, key, &x, &y, &width, &height);
+
+	if( slice < 0 )
+		return NULL;
+	else if( slice > 0 )
+		return PyCudaImage_CreateView(self, x, y, width, height);
+
 	if( !self->base.mapped )
 	{
 		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage subscript operator can only operate on mapped/zeroCopy memory");
@@ -631,6 +1063,30 @@ static PyObject* PyCudaImage_GetItem(PyCudaImage *self, PyObject *key)
 // PyCudaImage_SetItem
 static int PyCudaImage_SetItem( PyCudaImage* self, PyObject* key, PyObject* value )
 {
+	int x, y, width, height;
+	const int slice = PyCudaImage_ParseSlice(self, key, &x, &y, &width, &height);
+
+	if( slice < 0 )
+		return -1;
+	else if( slice > 0 )
+	{
+		// bulk assignment - img[y0:y1, x0:x1] = (r,g,b) or another cudaImage
+		PyObject* view = PyCudaImage_CreateView(self, x, y, width, height);
+
+		if( !view )
+			return -1;
+
+		bool result = false;
+
+		if( PyCUDA_IsImage(value) )
+			result = PyCudaImage_Copy2D((PyCudaImage*)view, (PyCudaImage*)value, NULL, false);
+		else
+			result = PyCudaImage_Fill((PyCudaImage*)view, value, NULL, false);
+
+		Py_DECREF(view);
+		return result ? 0 : -1;
+	}
+
 	if( !self->base.mapped )
 	{
 		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage subscript operator can only operate on mapped/zeroCopy memory");
@@ -738,10 +1194,42 @@ static int PyCudaImage_GetBuffer(PyCudaImage* self, Py_buffer* view, int flags)
 		return -1;
 	}	
 	
+	if( !PyCudaImage_IsContiguous(self) && (flags & PyBUF_STRIDES) != PyBUF_STRIDES )
+	{
+		PyErr_SetString(PyExc_BufferError, "cudaImage - view isn't contiguous, and the consumer didn't request strides");
+		return -1;
+	}
+
 	view->obj = (PyObject*)self;
 	view->buf = (void*)self->base.ptr;
-	view->len = self->base.size;
+	view->len = (self->width * self->height * imageFormatDepth(self->format)) / 8;
 	view->readonly = 0;
+
+	// the planes of planar formats don't fit an (h,w,c) shape with interleaved strides,
+	// so they're exported as a flat 1D buffer of bytes instead (length imageFormatSize())
+	switch(self->format)
+	{
+		case IMAGE_I420:
+		case IMAGE_YV12:
+		case IMAGE_NV12:
+		case IMAGE_P010:
+		case IMAGE_P016:
+		case IMAGE_RGB32F_PLANAR:
+		case IMAGE_RGB16F_PLANAR:
+			view->len = imageFormatSize(self->format, self->width, self->height);
+			view->itemsize = 1;
+			view->format = "B";
+			view->ndim = 1;
+			view->shape = &view->len;
+			view->strides = &view->itemsize;
+			view->suboffsets = NULL;
+			view->internal = NULL;
+			Py_INCREF(self);
+			return 0;
+		default:
+			break;
+	}
+
 	view->itemsize = (imageFormatDepth(self->format) / 8) / imageFormatChannels(self->format);
 	
 	view->ndim = 3; //(self->shape[2] > 1) ? 3 : 2;
@@ -757,9 +1245,6 @@ static int PyCudaImage_GetBuffer(PyCudaImage* self, Py_buffer* view, int flags)
 		case IMAGE_RGBA8:		
 		case IMAGE_BGRA8:		
 		case IMAGE_GRAY8:				
-		case IMAGE_I420:
-		case IMAGE_YV12:
-		case IMAGE_NV12:		
 		case IMAGE_UYVY:
 		case IMAGE_YUYV:		
 		case IMAGE_BAYER_BGGR:
@@ -768,7 +1253,19 @@ static int PyCudaImage_GetBuffer(PyCudaImage* self, Py_buffer* view, int flags)
 		case IMAGE_BAYER_RGGB:	view->format = "B";	break;
 		case IMAGE_RGB32F:		
 		case IMAGE_RGBA32F: 	
+		case IMAGE_BGR32F:
+		case IMAGE_BGRA32F:
 		case IMAGE_GRAY32F:		view->format = "f"; break;
+		case IMAGE_RGB16F:
+		case IMAGE_RGBA16F:		view->format = "e"; break;
+		case IMAGE_BAYER_BGGR16:
+		case IMAGE_BAYER_GBRG16:
+		case IMAGE_BAYER_GRBG16:
+		case IMAGE_BAYER_RGGB16:
+		case IMAGE_GRAY16:
+		case IMAGE_RGB16:
+		case IMAGE_RGBA16:		view->format = "H"; break;
+		default:				view->format = "B"; break;
 	}
 	
 	Py_INCREF(self);
@@ -783,449 +1280,2224 @@ static PyBufferProcs pyCudaImage_AsBuffer = {
 
 #endif
 
-static PyGetSetDef pyCudaImage_GetSet[] = 
+//-------------------------------------------------------------------------------
+// DLPack ABI (https://github.com/dmlc/dlpack/blob/main/include/dlpack/dlpack.h)
+// these are declared here instead of depending on dlpack.h, because only the
+// unversioned structs are needed and their layout is fixed by the standard.
+enum DLDeviceType
 {
-	{ "width", (getter)PyCudaImage_GetWidth, NULL, "Width of the image (in pixels)", NULL},
-	{ "height", (getter)PyCudaImage_GetHeight, NULL, "Height of the image (in pixels)", NULL},
-	{ "channels", (getter)PyCudaImage_GetChannels, NULL, "Number of color channels in the image", NULL},
-	{ "shape", (getter)PyCudaImage_GetShape, NULL, "Image dimensions in (height, width, channels) tuple", NULL},
-	{ "format", (getter)PyCudaImage_GetFormat, NULL, "Pixel format of the image", NULL},
-	{ "timestamp", (getter)PyCudaImage_GetTimestamp, NULL, "Timestamp of the image (in nanoseconds)", NULL},
-	{ "__array_interface__", (getter)PyCudaImage_GetArrayInterface, NULL, "Numpy __array_interface__ dict", NULL},
-	{ "__cuda_array_interface__", (getter)PyCudaImage_GetCudaArrayInterface, NULL, "Numba __cuda_array_interface__ dict", NULL},
-	{ NULL } /* Sentinel */
+	kDLCPU = 1,
+	kDLCUDA = 2,
+	kDLCUDAHost = 3,
+	kDLCUDAManaged = 13
 };
 
-static PyTypeObject pyCudaImage_Type = 
+enum DLDataTypeCode
 {
-    PyVarObject_HEAD_INIT(NULL, 0)
+	kDLInt = 0,
+	kDLUInt = 1,
+	kDLFloat = 2
 };
 
-// PyCudaImage_RegisterType
-bool PyCudaImage_RegisterType( PyObject* module )
+typedef struct {
+	int32_t device_type;
+	int32_t device_id;
+} DLDevice;
+
+typedef struct {
+	uint8_t code;
+	uint8_t bits;
+	uint16_t lanes;
+} DLDataType;
+
+typedef struct {
+	void* data;
+	DLDevice device;
+	int32_t ndim;
+	DLDataType dtype;
+	int64_t* shape;
+	int64_t* strides;
+	uint64_t byte_offset;
+} DLTensor;
+
+typedef struct DLManagedTensor {
+	DLTensor dl_tensor;
+	void* manager_ctx;
+	void (*deleter)(struct DLManagedTensor* self);
+} DLManagedTensor;
+
+// the exported tensor, with storage for its shape/strides
+struct PyDLPackTensor
 {
-	if( !module )
-		return false;
-	
-	pyCudaImage_Type.tp_name 	= PY_UTILS_MODULE_NAME ".cudaImage";
-	pyCudaImage_Type.tp_basicsize = sizeof(PyCudaImage);
-	pyCudaImage_Type.tp_flags 	= Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
-	pyCudaImage_Type.tp_base      = &pyCudaMemory_Type;
-	pyCudaImage_Type.tp_methods   = NULL;
-	pyCudaImage_Type.tp_getset    = pyCudaImage_GetSet;
-	pyCudaImage_Type.tp_as_mapping = &pyCudaImage_AsMapping;
-	pyCudaImage_Type.tp_new 	     = PyCudaImage_New;
-	pyCudaImage_Type.tp_init	     = (initproc)PyCudaImage_Init;
-	pyCudaImage_Type.tp_dealloc	= NULL; /*(destructor)PyCudaMemory_Dealloc*/;
-	pyCudaImage_Type.tp_str		= (reprfunc)PyCudaImage_ToString;
-	pyCudaImage_Type.tp_doc  	= "CUDA image";
-	
-#if PY_MAJOR_VERSION >= 3
-	pyCudaImage_Type.tp_as_buffer  = &pyCudaImage_AsBuffer;
-#endif
+	DLManagedTensor tensor;
+	int64_t shape[3];
+	int64_t strides[3];
+};
 
-	if( PyType_Ready(&pyCudaImage_Type) < 0 )
-	{
-		LogError(LOG_PY_UTILS "PyCudaImage PyType_Ready() failed\n");
+// PyDLPack_Deleter (called by the consumer when it's done with the tensor)
+static void PyDLPack_Deleter( DLManagedTensor* self )
+{
+	if( !self )
+		return;
+
+	// the consumer may release the tensor from any thread
+	PyGILState_STATE gil = PyGILState_Ensure();
+	Py_XDECREF((PyObject*)self->manager_ctx);
+	PyGILState_Release(gil);
+
+	free(self);
+}
+
+// PyDLPack_CapsuleDestructor (if the capsule was never consumed)
+static void PyDLPack_CapsuleDestructor( PyObject* capsule )
+{
+	if( !PyCapsule_IsValid(capsule, "dltensor") )
+		return;	// renamed to "used_dltensor" by the consumer, who now owns it
+
+	DLManagedTensor* tensor = (DLManagedTensor*)PyCapsule_GetPointer(capsule, "dltensor");
+
+	if( tensor != NULL && tensor->deleter != NULL )
+		tensor->deleter(tensor);
+}
+
+// PyDLPack_ImportDestructor (releases an imported tensor once the cudaImage is deleted)
+static void PyDLPack_ImportDestructor( PyObject* capsule )
+{
+	DLManagedTensor* tensor = (DLManagedTensor*)PyCapsule_GetPointer(capsule, PY_UTILS_MODULE_NAME ".dlpack");
+
+	if( tensor != NULL && tensor->deleter != NULL )
+		tensor->deleter(tensor);
+}
+
+// PyDLPack_GetStream (converts the stream argument of __dlpack__)
+static bool PyDLPack_GetStream( PyObject* object, cudaStream_t* stream, bool* sync )
+{
+	*stream = cudaStreamLegacy;
+	*sync = true;
+
+	if( !object || object == Py_None )
+		return true;
+
+	const long long value = PyLong_AsLongLong(object);
+
+	if( value == -1 && PyErr_Occurred() )
 		return false;
-	}
-	
-	Py_INCREF(&pyCudaImage_Type);
-    
-	if( PyModule_AddObject(module, "cudaImage", (PyObject*)&pyCudaImage_Type) < 0 )
+
+	if( value == -1 )
+		*sync = false;		// the consumer doesn't want synchronization
+	else if( value == 1 )
+		*stream = cudaStreamLegacy;
+	else if( value == 2 )
+		*stream = cudaStreamPerThread;
+	else if( value == 0 )
 	{
-		LogError(LOG_PY_UTILS "PyCudaImage PyModule_AddObject('cudaImage') failed\n");
+		PyErr_SetString(PyExc_ValueError, LOG_PY_UTILS "cudaImage.__dlpack__() stream=0 is ambiguous (use 1 or 2 for the default streams)");
 		return false;
 	}
-	
+	else
+		*stream = (cudaStream_t)value;
+
 	return true;
 }
 
-//-------------------------------------------------------------------------------
-// PyCUDA_RegisterMemory
-PyObject* PyCUDA_RegisterMemory( void* gpuPtr, size_t size, bool mapped, bool freeOnDelete )
+// PyCudaImage_DLPack
+static PyObject* PyCudaImage_DLPack( PyCudaImage* self, PyObject* args, PyObject* kwds )
 {
-	if( !gpuPtr )
+	PyObject* pyStream = NULL;
+	PyObject* pyVersion = NULL;
+	PyObject* pyDevice = NULL;
+	PyObject* pyCopy = NULL;
+
+	static char* kwlist[] = {"stream", "max_version", "dl_device", "copy", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|OOOO", kwlist, &pyStream, &pyVersion, &pyDevice, &pyCopy))
+		return NULL;
+
+	if( !self->base.ptr )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "RegisterMemory() was provided NULL memory pointers");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage.__dlpack__() image has no memory");
 		return NULL;
 	}
 
-	PyCudaMemory* mem = PyObject_New(PyCudaMemory, &pyCudaMemory_Type);
-
-	if( !mem )
+	if( pyCopy != NULL && PyObject_IsTrue(pyCopy) == 1 )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "PyCUDA_RegisterMemory() failed to create a new cudaMemory object");
+		PyErr_SetString(PyExc_BufferError, LOG_PY_UTILS "cudaImage.__dlpack__() doesn't support copy=True");
 		return NULL;
 	}
 
-	mem->ptr = gpuPtr;
-	mem->size = size;
-	mem->mapped = mapped;
-	mem->freeOnDelete = freeOnDelete;
+	// make the consumer's stream wait for the work that last wrote to the image
+	cudaStream_t stream = NULL;
+	bool sync = false;
 
-	return (PyObject*)mem;
-}
+	if( !PyDLPack_GetStream(pyStream, &stream, &sync) )
+		return NULL;
 
-// PyCUDA_RegisterImage
-PyObject* PyCUDA_RegisterImage( void* gpuPtr, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, bool mapped, bool freeOnDelete )
-{
-	if( !gpuPtr )
+	cudaStream_t producer = (self->stream != NULL) ? self->stream : cudaStreamLegacy;
+
+	if( sync && producer != stream )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaRegisterImage() was provided NULL memory pointers");
-		return NULL;
+		cudaEvent_t event = NULL;
+
+		if( CUDA_FAILED(cudaEventCreateWithFlags(&event, cudaEventDisableTiming)) ||
+		    CUDA_FAILED(cudaEventRecord(event, producer)) ||
+		    CUDA_FAILED(cudaStreamWaitEvent(stream, event, 0)) )
+		{
+			if( event != NULL )
+				cudaEventDestroy(event);
+
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage.__dlpack__() failed to synchronize with the consumer's stream");
+			return NULL;
+		}
+
+		CUDA(cudaEventDestroy(event));	// the wait is already queued
 	}
 
-	PyCudaImage* mem = PyObject_New(PyCudaImage, &pyCudaImage_Type);
+	// find the device that the memory is on
+	int device = 0;
+	cudaPointerAttributes attr;
 
-	if( !mem )
+	if( cudaPointerGetAttributes(&attr, self->base.ptr) == cudaSuccess )
+		device = attr.device;
+	else
+		cudaGetLastError();	// clear the error
+
+	// fill out the tensor, which keeps a reference to the image until it's deleted
+	PyDLPackTensor* dlpack = (PyDLPackTensor*)malloc(sizeof(PyDLPackTensor));
+
+	if( !dlpack )
+		return PyErr_NoMemory();
+
+	const imageBaseType baseType = imageFormatBaseType(self->format);
+
+	for( int n=0; n < 3; n++ )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "PyCUDA_RegisterImage() failed to create a new cudaImage object");
-		return NULL;
+		dlpack->shape[n] = self->shape[n];
+		dlpack->strides[n] = (self->strides[2] > 0) ? self->strides[n] / self->strides[2] : 0;	// in elements
 	}
 
-	PyCudaImage_Config(mem, gpuPtr, width, height, format, timestamp, mapped, freeOnDelete);
-	return (PyObject*)mem;
-}
+	DLTensor* tensor = &dlpack->tensor.dl_tensor;
 
-// PyCUDA_IsMemory
-bool PyCUDA_IsMemory( PyObject* object )
-{
-	if( !object )
-		return false;
+	tensor->data = self->base.ptr;
+	tensor->device.device_type = kDLCUDA;	// mapped memory is also device-accessible
+	tensor->device.device_id = device;
+	tensor->ndim = 3;
+	tensor->dtype.code = (baseType == IMAGE_UINT8 || baseType == IMAGE_UINT16) ? kDLUInt : kDLFloat;
+	tensor->dtype.bits = self->strides[2] * 8;
+	tensor->dtype.lanes = 1;
+	tensor->shape = dlpack->shape;
+	tensor->strides = dlpack->strides;
+	tensor->byte_offset = 0;
 
-	if( PyObject_IsInstance(object, (PyObject*)&pyCudaMemory_Type) == 1 || 
-	    PyObject_IsInstance(object, (PyObject*)&pyCudaImage_Type) == 1)
+	dlpack->tensor.manager_ctx = self;
+	dlpack->tensor.deleter = PyDLPack_Deleter;
+
+	Py_INCREF(self);
+
+	PyObject* capsule = PyCapsule_New(&dlpack->tensor, "dltensor", PyDLPack_CapsuleDestructor);
+
+	if( !capsule )
 	{
-		return true;
+		PyDLPack_Deleter(&dlpack->tensor);
+		return NULL;
 	}
 
-	return false;
+	return capsule;
 }
 
-// PyCUDA_IsImage
-bool PyCUDA_IsImage( PyObject* object )
+// PyCudaImage_DLPackDevice
+static PyObject* PyCudaImage_DLPackDevice( PyCudaImage* self )
 {
-	if( !object )
-		return false;
+	int device = 0;
+	cudaPointerAttributes attr;
 
-	if( PyObject_IsInstance(object, (PyObject*)&pyCudaImage_Type) == 1 )
-		return true;
+	if( self->base.ptr != NULL && cudaPointerGetAttributes(&attr, self->base.ptr) == cudaSuccess )
+		device = attr.device;
+	else
+		cudaGetLastError();
 
-	return false;
+	return Py_BuildValue("(ii)", (int)kDLCUDA, device);
 }
 
-// PyCUDA_GetMemory
-PyCudaMemory* PyCUDA_GetMemory( PyObject* object )
+// PyCudaImage_FromDLPack
+static PyObject* PyCudaImage_FromDLPack( PyObject* cls, PyObject* args, PyObject* kwds )
 {
-	if( !object )
-		return NULL;
-
-	if( PyCUDA_IsMemory(object) )
-		return (PyCudaMemory*)object;
+	PyObject* pyObject = NULL;
+	const char* formatStr = NULL;
+	long long timestamp = 0;
 
-	return NULL;
-}
+	static char* kwlist[] = {"tensor", "format", "timestamp", NULL};
 
-// PyCUDA_GetImage
-PyCudaImage* PyCUDA_GetImage( PyObject* object )
-{
-	if( !object )
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O|sL", kwlist, &pyObject, &formatStr, &timestamp))
 		return NULL;
 
-	if( PyCUDA_IsImage(object) )
-		return (PyCudaImage*)object;
+	// get the capsule from the object's __dlpack__() method (or it can be passed directly)
+	PyObject* capsule = NULL;
 
-	return NULL;
-}
+	if( PyCapsule_IsValid(pyObject, "dltensor") )
+	{
+		capsule = pyObject;
+		Py_INCREF(capsule);
+	}
+	else if( PyObject_HasAttrString(pyObject, "__dlpack__") )
+	{
+		// our own operations without a stream are on the legacy default stream
+		capsule = PyObject_CallMethod(pyObject, "__dlpack__", "(i)", 1);
 
-// PyCUDA_GetImage
-void* PyCUDA_GetImage( PyObject* capsule, int* width, int* height, imageFormat* format, uint64_t* timestamp )
-{
-	PyCudaImage* img = PyCUDA_GetImage(capsule);
-	void* ptr = NULL;
+		if( !capsule )
+			return NULL;
+	}
+	else
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaImage.from_dlpack() expects an object with __dlpack__() or a DLPack capsule");
+		return NULL;
+	}
 
-	if( img != NULL )
+	DLManagedTensor* managed = (DLManagedTensor*)PyCapsule_GetPointer(capsule, "dltensor");
+
+	if( !managed )
 	{
-		ptr = img->base.ptr;
-		*width = img->width;
-		*height = img->height;
-		*format = img->format;
-		if ( timestamp )
-			*timestamp = img->timestamp;
+		Py_DECREF(capsule);
+		return NULL;	// already consumed (the exception is set)
 	}
-	else
+
+	const DLTensor* tensor = &managed->dl_tensor;
+
+	#define DLPACK_ERROR(exc, msg) { PyErr_SetString(exc, LOG_PY_UTILS "cudaImage.from_dlpack() " msg); Py_DECREF(capsule); return NULL; }
+
+	// validate the tensor is a compact HW or HWC image in GPU-accessible memory
+	const int32_t deviceType = tensor->device.device_type;
+
+	if( deviceType != kDLCUDA && deviceType != kDLCUDAHost && deviceType != kDLCUDAManaged )
+		DLPACK_ERROR(PyExc_BufferError, "tensor isn't in CUDA memory");
+
+	if( tensor->ndim != 2 && tensor->ndim != 3 )
+		DLPACK_ERROR(PyExc_ValueError, "tensor should have 2 (HW) or 3 (HWC) dimensions");
+
+	if( tensor->dtype.lanes != 1 )
+		DLPACK_ERROR(PyExc_ValueError, "tensor can't have vectorized types (lanes != 1)");
+
+	const int64_t height = tensor->shape[0];
+	const int64_t width = tensor->shape[1];
+	const int64_t channels = (tensor->ndim == 3) ? tensor->shape[2] : 1;
+
+	if( tensor->strides != NULL )
 	{
-		PyCudaMemory* mem = PyCUDA_GetMemory(capsule);
+		const int64_t compact[3] = { width * channels, channels, 1 };
 
-		if( !mem )
+		for( int n=0; n < tensor->ndim; n++ )
 		{
-			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "function wasn't passed a valid cudaImage or cudaMemory object");
-			return NULL;
+			if( tensor->shape[n] > 1 && tensor->strides[n] != compact[n] )
+				DLPACK_ERROR(PyExc_BufferError, "tensor needs to be contiguous (try .contiguous() first)");
 		}
+	}
 
-		ptr = mem->ptr;
+	// pick the image format from the type and number of channels
+	imageFormat format = IMAGE_UNKNOWN;
 
-		if( *width <= 0 || *height <= 0 )
-		{
-			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "image dimensions are invalid");
-			return NULL;
-		}
+	if( tensor->dtype.code == kDLUInt && tensor->dtype.bits == 8 )
+		format = (channels == 1) ? IMAGE_GRAY8 : (channels == 3) ? IMAGE_RGB8 : (channels == 4) ? IMAGE_RGBA8 : IMAGE_UNKNOWN;
+	else if( tensor->dtype.code == kDLFloat && tensor->dtype.bits == 32 )
+		format = (channels == 1) ? IMAGE_GRAY32F : (channels == 3) ? IMAGE_RGB32F : (channels == 4) ? IMAGE_RGBA32F : IMAGE_UNKNOWN;
+	else if( tensor->dtype.code == kDLFloat && tensor->dtype.bits == 16 )
+		format = (channels == 3) ? IMAGE_RGB16F : (channels == 4) ? IMAGE_RGBA16F : IMAGE_UNKNOWN;
 
-		if( *format == IMAGE_UNKNOWN )
+	if( format == IMAGE_UNKNOWN )
+		DLPACK_ERROR(PyExc_ValueError, "tensor has an unsupported data type or number of channels");
+
+	// the format can be overridden with one that has the same layout (e.g. bgr8)
+	if( formatStr != NULL )
+	{
+		const imageFormat requested = imageFormatFromStr(formatStr);
+
+		if( requested == IMAGE_UNKNOWN || imageFormatChannels(requested) != imageFormatChannels(format) ||
+		    imageFormatBaseType(requested) != imageFormatBaseType(format) )
+			DLPACK_ERROR(PyExc_ValueError, "format doesn't match the type and channels of the tensor");
+
+		format = requested;
+	}
+
+	#undef DLPACK_ERROR
+
+	// take ownership of the tensor, and release it when the image is deleted
+	PyObject* owner = PyCapsule_New(managed, PY_UTILS_MODULE_NAME ".dlpack", PyDLPack_ImportDestructor);
+
+	if( !owner )
+	{
+		Py_DECREF(capsule);
+		return NULL;
+	}
+
+	PyCapsule_SetName(capsule, "used_dltensor");
+	Py_DECREF(capsule);
+
+	void* ptr = (uint8_t*)tensor->data + tensor->byte_offset;
+	PyObject* image = PyCUDA_RegisterImage(ptr, width, height, format, timestamp, deviceType != kDLCUDA, false);
+
+	if( !image )
+	{
+		Py_DECREF(owner);
+		return NULL;
+	}
+
+	((PyCudaImage*)image)->base.owner = owner;
+	return image;
+}
+
+// the contents of the bytes object from cudaImage.ipc_handle()
+struct PyCudaImageIpc
+{
+	cudaIpcHandle memory;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	uint64_t timestamp;
+};
+
+// PyCudaImage_IpcHandle
+static PyObject* PyCudaImage_IpcHandle( PyCudaImage* self, PyObject* args, PyObject* kwds )
+{
+	if( !PyCUDA_CheckContiguous(self, "cudaImage.ipc_handle()") )
+		return NULL;
+
+	// the other process needs to see everything that was written to the image
+	if( self->stream != NULL )
+	{
+		cudaError_t result;
+
+		Py_BEGIN_ALLOW_THREADS
+		result = cudaStreamSynchronize(self->stream);
+		Py_END_ALLOW_THREADS
+
+		if( CUDA_FAILED(result) )
 		{
-			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "invalid image format");
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage.ipc_handle() failed to synchronize the image's stream");
 			return NULL;
 		}
 	}
 
-	if( !ptr )
+	PyCudaImageIpc handle;
+	memset(&handle, 0, sizeof(handle));
+
+	if( !cudaIpcExport(self->base.ptr, self->base.size, &handle.memory) )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "image pointer was NULL (should be cudaImage or cudaMemory)");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage.ipc_handle() failed to share the memory (mapped images need to be created with shared=True)");
 		return NULL;
 	}
 
-	return ptr;
+	handle.width     = self->width;
+	handle.height    = self->height;
+	handle.format    = self->format;
+	handle.timestamp = self->timestamp;
+
+	return PyBytes_FromStringAndSize((const char*)&handle, sizeof(handle));
 }
 
+// PyCudaImage_IpcDestructor (closes the imported memory once the cudaImage is deleted)
+static void PyCudaImage_IpcDestructor( PyObject* capsule )
+{
+	cudaIpcRelease(PyCapsule_GetPointer(capsule, PY_UTILS_MODULE_NAME ".ipc"));
+}
 
-//-------------------------------------------------------------------------------
-// PyCUDA_Malloc
-PyObject* PyCUDA_Malloc( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCudaImage_FromIpcHandle
+static PyObject* PyCudaImage_FromIpcHandle( PyObject* cls, PyObject* args, PyObject* kwds )
 {
-	int size = 0;
-	int width = 0;
-	int height = 0;
-	long long timestamp = 0;
+	const char* data = NULL;
+	Py_ssize_t size = 0;
 
-	const char* formatStr = NULL;
-	static char* kwlist[] = {"size", "width", "height", "format", "timestamp", NULL};
+	static char* kwlist[] = {"handle", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|iiisL", kwlist, &size, &width, &height, &formatStr, &timestamp))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "y#", kwlist, &data, &size) )
 		return NULL;
 
-	if( size <= 0 && (width <= 0 || height <= 0) )
+	if( size != sizeof(PyCudaImageIpc) )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMalloc() requested size/dimensions are negative or zero");
+		PyErr_SetString(PyExc_ValueError, LOG_PY_UTILS "cudaImage.from_ipc_handle() was passed an invalid handle (it should be from cudaImage.ipc_handle())");
 		return NULL;
 	}
 
-	if( timestamp < 0 )
+	PyCudaImageIpc handle;
+	memcpy(&handle, data, sizeof(handle));
+
+	if( handle.memory.magic != CUDA_IPC_MAGIC || imageFormatSize((imageFormat)handle.format, handle.width, handle.height) > handle.memory.size )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMalloc() timestamp cannot be negative");
+		PyErr_SetString(PyExc_ValueError, LOG_PY_UTILS "cudaImage.from_ipc_handle() was passed an invalid handle (it should be from cudaImage.ipc_handle())");
 		return NULL;
 	}
 
-	const bool isImage = (width > 0) && (height > 0);
-	const imageFormat format = imageFormatFromStr(formatStr);
+	void* ptr = NULL;
 
-	if( isImage && format == IMAGE_UNKNOWN )
+	Py_BEGIN_ALLOW_THREADS
+	ptr = cudaIpcImport(handle.memory);
+	Py_END_ALLOW_THREADS
+
+	if( !ptr )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMalloc() invalid format string");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaImage.from_ipc_handle() failed to open the shared memory");
 		return NULL;
 	}
 
-	if( isImage )
-		size = imageFormatSize(format, width, height);
+	PyObject* owner = PyCapsule_New(ptr, PY_UTILS_MODULE_NAME ".ipc", PyCudaImage_IpcDestructor);
 
-	// allocate memory
-	void* ptr = NULL;
+	if( !owner )
+	{
+		cudaIpcRelease(ptr);
+		return NULL;
+	}
+
+	PyObject* image = PyCUDA_RegisterImage(ptr, handle.width, handle.height, (imageFormat)handle.format, handle.timestamp, handle.memory.type == CUDA_IPC_HOST, false);
 
-	if( !cudaMalloc(&ptr, size) )
+	if( !image )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMalloc() failed to allocate memory");
+		Py_DECREF(owner);
 		return NULL;
 	}
 
-	return isImage ? PyCUDA_RegisterImage(ptr, width, height, format, timestamp)
-				: PyCUDA_RegisterMemory(ptr, size);
+	((PyCudaImage*)image)->base.owner = owner;
+	return image;
 }
 
-
-// PyCUDA_AllocMapped
-PyObject* PyCUDA_AllocMapped( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCudaImage_Copy
+static PyObject* PyCudaImage_Copy( PyCudaImage* self, PyObject* args, PyObject* kwds )
 {
-	int size = 0;
-	float width = 0;
-	float height = 0;
-	long long timestamp = 0;
-	PyObject* pyImageLike = NULL;
-	
-	const char* formatStr = NULL;
-	static char* kwlist[] = {"size", "width", "height", "format", "timestamp", "like", NULL};
+	PyObject* pyStream = NULL;
+	static char* kwlist[] = {"stream", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|iffsLO", kwlist, &size, &width, &height, &formatStr, &timestamp, &pyImageLike))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &pyStream) )
 		return NULL;
 
-	imageFormat format = imageFormatFromStr(formatStr);
-	
-	if( pyImageLike != NULL )
-	{
-		PyCudaImage* image_like = PyCUDA_GetImage(pyImageLike);
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	// allocate a contiguous image with the same format and memory type
+	const size_t size = imageFormatSize(self->format, self->width, self->height);
+	void* ptr = NULL;
+
+	if( self->base.mapped ? !cudaAllocMappedPooled(&ptr, size) : !cudaMallocPooled(&ptr, size) )
+	{
+		PyErr_SetString(PyExc_MemoryError, LOG_PY_UTILS "cudaImage.copy() failed to allocate CUDA memory");
+		return NULL;
+	}
+
+	PyObject* output = PyCUDA_RegisterImage(ptr, self->width, self->height, self->format, self->timestamp, self->base.mapped, true);
+
+	if( !output )
+	{
+		cudaFreePooled(ptr);
+		return NULL;
+	}
+
+	if( !PyCudaImage_Copy2D((PyCudaImage*)output, self, stream, pyStream != NULL && pyStream != Py_None) )
+	{
+		Py_DECREF(output);
+		return NULL;
+	}
+
+	return output;
+}
+
+// PyCudaImage_FillMethod
+static PyObject* PyCudaImage_FillMethod( PyCudaImage* self, PyObject* args, PyObject* kwds )
+{
+	PyObject* value = NULL;
+	PyObject* pyStream = NULL;
+
+	static char* kwlist[] = {"value", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &value, &pyStream) )
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	if( !PyCudaImage_Fill(self, value, stream, pyStream != NULL && pyStream != Py_None) )
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef pyCudaImage_Methods[] = 
+{
+	{ "copy", (PyCFunction)PyCudaImage_Copy, METH_VARARGS|METH_KEYWORDS, "Copy the image (or a view of it) into a new contiguous cudaImage"},
+	{ "fill", (PyCFunction)PyCudaImage_FillMethod, METH_VARARGS|METH_KEYWORDS, "Set every pixel of the image (or a view of it) to a value or tuple of channels"},
+	{ "__dlpack__", (PyCFunction)PyCudaImage_DLPack, METH_VARARGS|METH_KEYWORDS, "Export the image as a DLPack capsule (without copying)"},
+	{ "__dlpack_device__", (PyCFunction)PyCudaImage_DLPackDevice, METH_NOARGS, "Return the DLPack (device_type, device_id) tuple"},
+	{ "from_dlpack", (PyCFunction)PyCudaImage_FromDLPack, METH_VARARGS|METH_KEYWORDS|METH_CLASS, "Create a cudaImage that shares the memory of a DLPack tensor (e.g. from PyTorch), without copying"},
+	{ "ipc_handle", (PyCFunction)PyCudaImage_IpcHandle, METH_VARARGS|METH_KEYWORDS, "Return a handle (bytes) that another process can pass to cudaImage.from_ipc_handle() to access the image without copying.  The image needs to be in device memory (mapped=False), or created with shared=True (e.g. on Jetson), and must be kept alive while the other processes use it."},
+	{ "from_ipc_handle", (PyCFunction)PyCudaImage_FromIpcHandle, METH_VARARGS|METH_KEYWORDS|METH_CLASS, "Create a cudaImage from a handle that was returned by cudaImage.ipc_handle() in another process, which shares its memory without copying"},
+	{ NULL } /* Sentinel */
+};
+
+static PyGetSetDef pyCudaImage_GetSet[] = 
+{
+	{ "width", (getter)PyCudaImage_GetWidth, NULL, "Width of the image (in pixels)", NULL},
+	{ "height", (getter)PyCudaImage_GetHeight, NULL, "Height of the image (in pixels)", NULL},
+	{ "channels", (getter)PyCudaImage_GetChannels, NULL, "Number of color channels in the image", NULL},
+	{ "shape", (getter)PyCudaImage_GetShape, NULL, "Image dimensions in (height, width, channels) tuple", NULL},
+	{ "format", (getter)PyCudaImage_GetFormat, NULL, "Pixel format of the image", NULL},
+	{ "timestamp", (getter)PyCudaImage_GetTimestamp, NULL, "Timestamp of the image (in nanoseconds)", NULL},
+	{ "pitch", (getter)PyCudaImage_GetPitch, NULL, "Size of each row in bytes (larger than the width for views)", NULL},
+	{ "contiguous", (getter)PyCudaImage_GetContiguous, NULL, "False if the image is a view with a pitch, which needs copy() for most functions", NULL},
+	{ "__array_interface__", (getter)PyCudaImage_GetArrayInterface, NULL, "Numpy __array_interface__ dict", NULL},
+	{ "__cuda_array_interface__", (getter)PyCudaImage_GetCudaArrayInterface, NULL, "Numba __cuda_array_interface__ dict", NULL},
+	{ NULL } /* Sentinel */
+};
+
+static PyTypeObject pyCudaImage_Type = 
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+// PyCudaImage_RegisterType
+bool PyCudaImage_RegisterType( PyObject* module )
+{
+	if( !module )
+		return false;
+	
+	pyCudaImage_Type.tp_name 	= PY_UTILS_MODULE_NAME ".cudaImage";
+	pyCudaImage_Type.tp_basicsize = sizeof(PyCudaImage);
+	pyCudaImage_Type.tp_flags 	= Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+	pyCudaImage_Type.tp_base      = &pyCudaMemory_Type;
+	pyCudaImage_Type.tp_methods   = pyCudaImage_Methods;
+	pyCudaImage_Type.tp_getset    = pyCudaImage_GetSet;
+	pyCudaImage_Type.tp_as_mapping = &pyCudaImage_AsMapping;
+	pyCudaImage_Type.tp_new 	     = PyCudaImage_New;
+	pyCudaImage_Type.tp_init	     = (initproc)PyCudaImage_Init;
+	pyCudaImage_Type.tp_dealloc	= NULL; /*(destructor)PyCudaMemory_Dealloc*/;
+	pyCudaImage_Type.tp_str		= (reprfunc)PyCudaImage_ToString;
+	pyCudaImage_Type.tp_doc  	= "CUDA image";
+	
+#if PY_MAJOR_VERSION >= 3
+	pyCudaImage_Type.tp_as_buffer  = &pyCudaImage_AsBuffer;
+#endif
+
+	if( PyType_Ready(&pyCudaImage_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "PyCudaImage PyType_Ready() failed\n");
+		return false;
+	}
+	
+	Py_INCREF(&pyCudaImage_Type);
+    
+	if( PyModule_AddObject(module, "cudaImage", (PyObject*)&pyCudaImage_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "PyCudaImage PyModule_AddObject('cudaImage') failed\n");
+		return false;
+	}
+	
+	return true;
+}
+
+//-------------------------------------------------------------------------------
+static PyTypeObject pyCudaEvent_Type = 
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+// PyCUDA_IsEvent
+static bool PyCUDA_IsEvent( PyObject* object )
+{
+	if( !object )
+		return false;
+
+	return PyObject_IsInstance(object, (PyObject*)&pyCudaEvent_Type) == 1;
+}
+
+// PyCudaEvent_New
+static PyObject* PyCudaEvent_New( PyTypeObject *type, PyObject *args, PyObject *kwds )
+{
+	LogDebug(LOG_PY_UTILS "PyCudaEvent_New()\n");
+	
+	// allocate a new container
+	PyCudaEvent* self = (PyCudaEvent*)type->tp_alloc(type, 0);
+	
+	if( !self )
+	{
+		PyErr_SetString(PyExc_MemoryError, LOG_PY_UTILS "cudaEvent tp_alloc() failed to allocate a new object");
+		return NULL;
+	}
+	
+	self->event = NULL;
+	return (PyObject*)self;
+}
+
+// PyCudaEvent_Dealloc
+static void PyCudaEvent_Dealloc( PyCudaEvent* self )
+{
+	LogDebug(LOG_PY_UTILS "PyCudaEvent_Dealloc()\n");
+	
+	if( self->event != NULL )
+	{
+		CUDA(cudaEventDestroy(self->event));
+		self->event = NULL;
+	}
+
+	// free the container
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+// PyCudaEvent_Init
+static int PyCudaEvent_Init( PyCudaEvent* self, PyObject *args, PyObject *kwds )
+{
+	LogDebug(LOG_PY_UTILS "PyCudaEvent_Init()\n");
+	
+	// parse arguments
+	int timing = 0;
+	int blocking = 0;
+
+	static char* kwlist[] = {"timing", "blocking", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|ii", kwlist, &timing, &blocking))
+		return -1;
+    
+	// events used only for synchronization are cheaper without timing
+	unsigned int flags = timing ? cudaEventDefault : cudaEventDisableTiming;
+
+	if( blocking )
+		flags |= cudaEventBlockingSync;
+
+	if( CUDA_FAILED(cudaEventCreateWithFlags(&self->event, flags)) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaEvent.__init()__ failed to create CUDA event");
+		return -1;
+	}
+
+	return 0;
+}
+
+// PyCudaEvent_GetPtr
+static PyObject* PyCudaEvent_GetPtr( PyCudaEvent* self, void* closure )
+{
+	return PYLONG_FROM_UNSIGNED_LONG_LONG((uint64_t)self->event);
+}
+
+// PyCudaEvent_Record
+static PyObject* PyCudaEvent_Record( PyCudaEvent* self, PyObject* args, PyObject* kwds )
+{
+	PyObject* pyStream = NULL;
+	static char* kwlist[] = {"stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	if( CUDA_FAILED(cudaEventRecord(self->event, stream)) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaEvent.record() failed");
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+// PyCudaEvent_Synchronize
+static PyObject* PyCudaEvent_Synchronize( PyCudaEvent* self )
+{
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaEventSynchronize(self->event));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaEvent.synchronize() failed");
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+// PyCudaEvent_Query
+static PyObject* PyCudaEvent_Query( PyCudaEvent* self )
+{
+	const cudaError_t result = cudaEventQuery(self->event);
+
+	if( result == cudaErrorNotReady )
+		Py_RETURN_FALSE;
+
+	if( CUDA_FAILED(result) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaEvent.query() failed");
+		return NULL;
+	}
+
+	Py_RETURN_TRUE;
+}
+
+// PyCudaEvent_ElapsedTime
+static PyObject* PyCudaEvent_ElapsedTime( PyCudaEvent* self, PyObject* args, PyObject* kwds )
+{
+	PyObject* pyEnd = NULL;
+	static char* kwlist[] = {"end", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &pyEnd))
+		return NULL;
+
+	if( !PyCUDA_IsEvent(pyEnd) )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaEvent.elapsedTime() expects a cudaEvent object");
+		return NULL;
+	}
+
+	float ms = 0.0f;
+
+	if( CUDA_FAILED(cudaEventElapsedTime(&ms, self->event, ((PyCudaEvent*)pyEnd)->event)) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaEvent.elapsedTime() failed (both events need to be created with timing=True and recorded)");
+		return NULL;
+	}
+
+	return PyFloat_FromDouble(ms);
+}
+
+static PyGetSetDef pyCudaEvent_GetSet[] = 
+{
+	{ "ptr", (getter)PyCudaEvent_GetPtr, NULL, "Address of the cudaEvent_t handle", NULL},
+	{ NULL } /* Sentinel */
+};
+
+static PyMethodDef pyCudaEvent_Methods[] = 
+{
+	{ "record", (PyCFunction)PyCudaEvent_Record, METH_VARARGS|METH_KEYWORDS, "Record the event on a stream (the default stream if none is given)"},
+	{ "synchronize", (PyCFunction)PyCudaEvent_Synchronize, METH_NOARGS, "Wait for the work before the event to complete"},
+	{ "query", (PyCFunction)PyCudaEvent_Query, METH_NOARGS, "Return true if the work before the event has completed"},
+	{ "elapsedTime", (PyCFunction)PyCudaEvent_ElapsedTime, METH_VARARGS|METH_KEYWORDS, "Return the time (in milliseconds) between this event and the end event"},
+	{ NULL } /* Sentinel */
+};
+
+// PyCudaEvent_RegisterType
+bool PyCudaEvent_RegisterType( PyObject* module )
+{
+	if( !module )
+		return false;
+	
+	pyCudaEvent_Type.tp_name 	  = PY_UTILS_MODULE_NAME ".cudaEvent";
+	pyCudaEvent_Type.tp_basicsize  = sizeof(PyCudaEvent);
+	pyCudaEvent_Type.tp_flags 	  = Py_TPFLAGS_DEFAULT;
+	pyCudaEvent_Type.tp_methods    = pyCudaEvent_Methods;
+	pyCudaEvent_Type.tp_getset     = pyCudaEvent_GetSet;
+	pyCudaEvent_Type.tp_new 	  = PyCudaEvent_New;
+	pyCudaEvent_Type.tp_init	  = (initproc)PyCudaEvent_Init;
+	pyCudaEvent_Type.tp_dealloc	  = (destructor)PyCudaEvent_Dealloc;
+	pyCudaEvent_Type.tp_doc  	  = "CUDA event";
+	 
+	if( PyType_Ready(&pyCudaEvent_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "PyCudaEvent PyType_Ready() failed\n");
+		return false;
+	}
+	
+	Py_INCREF(&pyCudaEvent_Type);
+    
+	if( PyModule_AddObject(module, "cudaEvent", (PyObject*)&pyCudaEvent_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "PyCudaEvent PyModule_AddObject('cudaEvent') failed\n");
+		return false;
+	}
+	
+	return true;
+}
+
+//-------------------------------------------------------------------------------
+// PyCudaStream_New
+static PyObject* PyCudaStream_New( PyTypeObject *type, PyObject *args, PyObject *kwds )
+{
+	LogDebug(LOG_PY_UTILS "PyCudaStream_New()\n");
+	
+	// allocate a new container
+	PyCudaStream* self = (PyCudaStream*)type->tp_alloc(type, 0);
+	
+	if( !self )
+	{
+		PyErr_SetString(PyExc_MemoryError, LOG_PY_UTILS "cudaStream tp_alloc() failed to allocate a new object");
+		return NULL;
+	}
+	
+	self->stream = NULL;
+	self->owned = false;
+
+	return (PyObject*)self;
+}
+
+// PyCudaStream_Dealloc
+static void PyCudaStream_Dealloc( PyCudaStream* self )
+{
+	LogDebug(LOG_PY_UTILS "PyCudaStream_Dealloc()\n");
+	
+	if( self->owned && self->stream != NULL )
+	{
+		CUDA(cudaStreamDestroy(self->stream));
+		self->stream = NULL;
+	}
+
+	// free the container
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+// PyCudaStream_Init
+static int PyCudaStream_Init( PyCudaStream* self, PyObject *args, PyObject *kwds )
+{
+	LogDebug(LOG_PY_UTILS "PyCudaStream_Init()\n");
+	
+	// parse arguments
+	int nonBlocking = 0;
+	int priority = 0;
+	PyObject* pyPtr = NULL;
+
+	static char* kwlist[] = {"nonBlocking", "priority", "ptr", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|iiO", kwlist, &nonBlocking, &priority, &pyPtr))
+		return -1;
+    
+	// wrap an existing stream (e.g. from PyTorch or CuPy) without taking ownership
+	if( pyPtr != NULL && pyPtr != Py_None )
+	{
+		if( !PyCUDA_GetStream(pyPtr, &self->stream) )
+			return -1;
+
+		self->owned = false;
+		return 0;
+	}
+
+	// create a new stream
+	if( CUDA_FAILED(cudaStreamCreateWithPriority(&self->stream, nonBlocking ? cudaStreamNonBlocking : cudaStreamDefault, priority)) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaStream.__init()__ failed to create CUDA stream");
+		return -1;
+	}
+
+	self->owned = true;
+	return 0;
+}
+
+// PyCudaStream_ToString
+static PyObject* PyCudaStream_ToString( PyCudaStream* self )
+{
+	char str[1024];
+
+	sprintf(str, 
+		   "<cudaStream object>\n"
+		   "   -- ptr:   %p\n"
+		   "   -- owned: %s\n",
+		   self->stream, self->owned ? "true" : "false");
+
+	return PYSTRING_FROM_STRING(str);
+}
+
+// PyCudaStream_GetPtr
+static PyObject* PyCudaStream_GetPtr( PyCudaStream* self, void* closure )
+{
+	return PYLONG_FROM_UNSIGNED_LONG_LONG((uint64_t)self->stream);
+}
+
+// PyCudaStream_Synchronize
+static PyObject* PyCudaStream_Synchronize( PyCudaStream* self )
+{
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaStreamSynchronize(self->stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaStream.synchronize() failed");
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+// PyCudaStream_Query
+static PyObject* PyCudaStream_Query( PyCudaStream* self )
+{
+	const cudaError_t result = cudaStreamQuery(self->stream);
+
+	if( result == cudaErrorNotReady )
+		Py_RETURN_FALSE;
+
+	if( CUDA_FAILED(result) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaStream.query() failed");
+		return NULL;
+	}
+
+	Py_RETURN_TRUE;
+}
+
+// PyCudaStream_WaitEvent
+static PyObject* PyCudaStream_WaitEvent( PyCudaStream* self, PyObject* args, PyObject* kwds )
+{
+	PyObject* pyEvent = NULL;
+	static char* kwlist[] = {"event", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &pyEvent))
+		return NULL;
+
+	if( !PyCUDA_IsEvent(pyEvent) )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaStream.waitEvent() expects a cudaEvent object");
+		return NULL;
+	}
+
+	if( CUDA_FAILED(cudaStreamWaitEvent(self->stream, ((PyCudaEvent*)pyEvent)->event, 0)) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaStream.waitEvent() failed");
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+static PyGetSetDef pyCudaStream_GetSet[] = 
+{
+	{ "ptr", (getter)PyCudaStream_GetPtr, NULL, "Address of the cudaStream_t handle", NULL},
+	{ "cuda_stream", (getter)PyCudaStream_GetPtr, NULL, "Address of the cudaStream_t handle (PyTorch interface)", NULL},
+	{ NULL } /* Sentinel */
+};
+
+static PyMethodDef pyCudaStream_Methods[] = 
+{
+	{ "synchronize", (PyCFunction)PyCudaStream_Synchronize, METH_NOARGS, "Wait for all the work queued on the stream to complete"},
+	{ "query", (PyCFunction)PyCudaStream_Query, METH_NOARGS, "Return true if all the work queued on the stream has completed"},
+	{ "waitEvent", (PyCFunction)PyCudaStream_WaitEvent, METH_VARARGS|METH_KEYWORDS, "Make future work on the stream wait for a cudaEvent (without blocking the CPU)"},
+	{ NULL } /* Sentinel */
+};
+
+static PyTypeObject pyCudaStream_Type = 
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+// PyCudaStream_RegisterType
+bool PyCudaStream_RegisterType( PyObject* module )
+{
+	if( !module )
+		return false;
+	
+	pyCudaStream_Type.tp_name 	  = PY_UTILS_MODULE_NAME ".cudaStream";
+	pyCudaStream_Type.tp_basicsize  = sizeof(PyCudaStream);
+	pyCudaStream_Type.tp_flags 	  = Py_TPFLAGS_DEFAULT;
+	pyCudaStream_Type.tp_methods    = pyCudaStream_Methods;
+	pyCudaStream_Type.tp_getset     = pyCudaStream_GetSet;
+	pyCudaStream_Type.tp_new 	  = PyCudaStream_New;
+	pyCudaStream_Type.tp_init	  = (initproc)PyCudaStream_Init;
+	pyCudaStream_Type.tp_dealloc	  = (destructor)PyCudaStream_Dealloc;
+	pyCudaStream_Type.tp_str		  = (reprfunc)PyCudaStream_ToString;
+	pyCudaStream_Type.tp_doc  	  = "CUDA stream";
+	 
+	if( PyType_Ready(&pyCudaStream_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "PyCudaStream PyType_Ready() failed\n");
+		return false;
+	}
+	
+	Py_INCREF(&pyCudaStream_Type);
+    
+	if( PyModule_AddObject(module, "cudaStream", (PyObject*)&pyCudaStream_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "PyCudaStream PyModule_AddObject('cudaStream') failed\n");
+		return false;
+	}
+	
+	return true;
+}
+
+//-------------------------------------------------------------------------------
+// PyCUDA_RegisterMemory
+PyObject* PyCUDA_RegisterMemory( void* gpuPtr, size_t size, bool mapped, bool freeOnDelete )
+{
+	if( !gpuPtr )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "RegisterMemory() was provided NULL memory pointers");
+		return NULL;
+	}
+
+	PyCudaMemory* mem = PyObject_New(PyCudaMemory, &pyCudaMemory_Type);
+
+	if( !mem )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "PyCUDA_RegisterMemory() failed to create a new cudaMemory object");
+		return NULL;
+	}
+
+	mem->ptr = gpuPtr;
+	mem->size = size;
+	mem->mapped = mapped;
+	mem->freeOnDelete = freeOnDelete;
+	mem->owner = NULL;
+	mem->tensorDims = 0;
+	mem->tensorType = NULL;
+	mem->tensorDescr = NULL;
+
+	return (PyObject*)mem;
+}
+
+// PyCUDA_RegisterImage
+PyObject* PyCUDA_RegisterImage( void* gpuPtr, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, bool mapped, bool freeOnDelete )
+{
+	if( !gpuPtr )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaRegisterImage() was provided NULL memory pointers");
+		return NULL;
+	}
+
+	PyCudaImage* mem = PyObject_New(PyCudaImage, &pyCudaImage_Type);
+
+	if( !mem )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "PyCUDA_RegisterImage() failed to create a new cudaImage object");
+		return NULL;
+	}
+
+	PyCudaImage_Config(mem, gpuPtr, width, height, format, timestamp, mapped, freeOnDelete);
+
+	mem->cudaArrayInterfaceDict = NULL;
+	mem->stream = NULL;
+	mem->base.owner = NULL;
+	mem->base.tensorDims = 0;
+	mem->base.tensorType = NULL;
+	mem->base.tensorDescr = NULL;
+
+	return (PyObject*)mem;
+}
+
+// PyCUDA_UpdateImage
+bool PyCUDA_UpdateImage( PyObject* object, void* gpuPtr, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, bool mapped )
+{
+	PyCudaImage* img = PyCUDA_GetImage(object);
+
+	if( !img || !gpuPtr )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "PyCUDA_UpdateImage() was provided an invalid image or NULL memory pointer");
+		return false;
+	}
+
+	if( img->base.freeOnDelete || img->base.owner != NULL )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "PyCUDA_UpdateImage() can only update images that don't own their memory");
+		return false;
+	}
+
+	PyCudaImage_Config(img, gpuPtr, width, height, format, timestamp, mapped, false);
+
+	// the cached interface dict has the old data pointer
+	Py_CLEAR(img->cudaArrayInterfaceDict);
+	img->stream = NULL;
+
+	return true;
+}
+
+// PyCUDA_IsMemory
+bool PyCUDA_IsMemory( PyObject* object )
+{
+	if( !object )
+		return false;
+
+	if( PyObject_IsInstance(object, (PyObject*)&pyCudaMemory_Type) == 1 || 
+	    PyObject_IsInstance(object, (PyObject*)&pyCudaImage_Type) == 1)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+// PyCUDA_IsImage
+bool PyCUDA_IsImage( PyObject* object )
+{
+	if( !object )
+		return false;
+
+	if( PyObject_IsInstance(object, (PyObject*)&pyCudaImage_Type) == 1 )
+		return true;
+
+	return false;
+}
+
+// PyCUDA_GetMemory
+PyCudaMemory* PyCUDA_GetMemory( PyObject* object )
+{
+	if( !object )
+		return NULL;
+
+	if( PyCUDA_IsMemory(object) )
+		return (PyCudaMemory*)object;
+
+	return NULL;
+}
+
+// PyCUDA_GetImage
+PyCudaImage* PyCUDA_GetImage( PyObject* object )
+{
+	if( !object )
+		return NULL;
+
+	if( PyCUDA_IsImage(object) )
+		return (PyCudaImage*)object;
+
+	return NULL;
+}
+
+// PyCUDA_CheckContiguous
+bool PyCUDA_CheckContiguous( PyCudaImage* image, const char* function )
+{
+	if( !image || PyCudaImage_IsContiguous(image) )
+		return true;
+
+	PyErr_Format(PyExc_Exception, LOG_PY_UTILS "%s() was passed a cudaImage view that isn't contiguous (use img.copy() first)", function);
+	return false;
+}
+
+// PyCUDA_GetStream
+bool PyCUDA_GetStream( PyObject* object, cudaStream_t* stream )
+{
+	*stream = NULL;
+
+	if( !object || object == Py_None )
+		return true;
+
+	if( PyObject_IsInstance(object, (PyObject*)&pyCudaStream_Type) == 1 )
+	{
+		*stream = ((PyCudaStream*)object)->stream;
+		return true;
+	}
+
+	// PyTorch streams have the handle in 'cuda_stream' and CuPy streams have it in 'ptr'
+	PyObject* handle = NULL;
+
+	if( PyObject_HasAttrString(object, "cuda_stream") )
+		handle = PyObject_GetAttrString(object, "cuda_stream");
+	else if( PyObject_HasAttrString(object, "ptr") && !PyCUDA_IsMemory(object) )
+		handle = PyObject_GetAttrString(object, "ptr");
+	else if( PyIndex_Check(object) )
+		handle = PyNumber_Index(object);
+
+	if( !handle )
+	{
+		if( !PyErr_Occurred() )
+			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "stream argument should be a cudaStream, PyTorch/CuPy stream, or int handle");
+
+		return false;
+	}
+
+	*stream = (cudaStream_t)PyLong_AsVoidPtr(handle);
+	Py_DECREF(handle);
+
+	if( PyErr_Occurred() )
+		return false;
+
+	return true;
+}
+
+// PyCUDA_GetImage
+void* PyCUDA_GetImage( PyObject* capsule, int* width, int* height, imageFormat* format, uint64_t* timestamp )
+{
+	PyCudaImage* img = PyCUDA_GetImage(capsule);
+	void* ptr = NULL;
+
+	if( img != NULL )
+	{
+		if( !PyCudaImage_IsContiguous(img) )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "function was passed a cudaImage view that isn't contiguous (use img.copy() first)");
+			return NULL;
+		}
+
+		ptr = img->base.ptr;
+		*width = img->width;
+		*height = img->height;
+		*format = img->format;
+		if ( timestamp )
+			*timestamp = img->timestamp;
+	}
+	else
+	{
+		PyCudaMemory* mem = PyCUDA_GetMemory(capsule);
+
+		if( !mem )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "function wasn't passed a valid cudaImage or cudaMemory object");
+			return NULL;
+		}
+
+		ptr = mem->ptr;
+
+		if( *width <= 0 || *height <= 0 )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "image dimensions are invalid");
+			return NULL;
+		}
+
+		if( *format == IMAGE_UNKNOWN )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "invalid image format");
+			return NULL;
+		}
+	}
+
+	if( !ptr )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "image pointer was NULL (should be cudaImage or cudaMemory)");
+		return NULL;
+	}
+
+	return ptr;
+}
+
+
+//-------------------------------------------------------------------------------
+// PyCUDA_Malloc
+PyObject* PyCUDA_Malloc( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	int size = 0;
+	int width = 0;
+	int height = 0;
+	long long timestamp = 0;
+
+	const char* formatStr = NULL;
+	static char* kwlist[] = {"size", "width", "height", "format", "timestamp", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|iiisL", kwlist, &size, &width, &height, &formatStr, &timestamp))
+		return NULL;
+
+	if( size <= 0 && (width <= 0 || height <= 0) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMalloc() requested size/dimensions are negative or zero");
+		return NULL;
+	}
+
+	if( timestamp < 0 )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMalloc() timestamp cannot be negative");
+		return NULL;
+	}
+
+	const bool isImage = (width > 0) && (height > 0);
+	const imageFormat format = imageFormatFromStr(formatStr);
+
+	if( isImage && format == IMAGE_UNKNOWN )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMalloc() invalid format string");
+		return NULL;
+	}
+
+	if( isImage )
+		size = imageFormatSize(format, width, height);
+
+	// allocate memory
+	void* ptr = NULL;
+
+	if( !cudaMallocPooled(&ptr, size) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMalloc() failed to allocate memory");
+		return NULL;
+	}
+
+	return isImage ? PyCUDA_RegisterImage(ptr, width, height, format, timestamp)
+				: PyCUDA_RegisterMemory(ptr, size);
+}
+
+
+// PyCUDA_AllocMapped
+PyObject* PyCUDA_AllocMapped( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	int size = 0;
+	float width = 0;
+	float height = 0;
+	long long timestamp = 0;
+	PyObject* pyImageLike = NULL;
+	
+	const char* formatStr = NULL;
+	static char* kwlist[] = {"size", "width", "height", "format", "timestamp", "like", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|iffsLO", kwlist, &size, &width, &height, &formatStr, &timestamp, &pyImageLike))
+		return NULL;
+
+	imageFormat format = imageFormatFromStr(formatStr);
+	
+	if( pyImageLike != NULL )
+	{
+		PyCudaImage* image_like = PyCUDA_GetImage(pyImageLike);
+		
+		width = image_like->width;
+		height = image_like->height;
+		format = image_like->format;
+	}
+	
+	if( size <= 0 && (width <= 0 || height <= 0) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() requested size/dimensions are negative or zero");
+		return NULL;
+	}
+
+	if( timestamp < 0 )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() timestamp cannot be negative");
+		return NULL;
+	}
+
+	const bool isImage = (width > 0) && (height > 0);
+
+	if( isImage && format == IMAGE_UNKNOWN )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() invalid format string");
+		return NULL;
+	}
+
+	if( isImage )
+		size = imageFormatSize(format, width, height);
+
+	// allocate memory
+	void* ptr = NULL;
+
+	if( !cudaAllocMappedPooled(&ptr, size) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() failed to allocate memory");
+		return NULL;
+	}
+
+	return isImage ? PyCUDA_RegisterImage(ptr, width, height, format, timestamp, true)
+				: PyCUDA_RegisterMemory(ptr, size, true);
+}
+
+
+// PyCUDA_Memcpy
+PyObject* PyCUDA_Memcpy( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	PyObject* dst_capsule = NULL;
+	PyObject* src_capsule = NULL;
+	PyObject* pyStream = NULL;
+	
+	static char* kwlist[]  = {"dst", "src", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O|OO", kwlist, &dst_capsule, &src_capsule, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	// check if the args were reversed in the single-arg version
+	if( !src_capsule && dst_capsule != NULL )
+	{
+		src_capsule = dst_capsule;
+		dst_capsule = NULL;
+	}
+	
+	// get the src image
+	int src_width = 0;
+	int src_height = 0;
+	imageFormat src_format = IMAGE_UNKNOWN;
+	uint64_t src_timestamp = 0;
+	
+	void* src_ptr = PyCUDA_GetImage(src_capsule, &src_width, &src_height, &src_format, &src_timestamp);
+	
+	if( !src_ptr ) 
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "failed to get CUDA image from src argument");
+		return NULL;
+	}
+	
+	// allocate the dst image (if needed)
+	void* dst_ptr = NULL;
+	bool dst_allocated = false;
+
+	if( !dst_capsule )
+	{
+		if( !cudaAllocMappedPooled(&dst_ptr, src_width, src_height, src_format) )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMemcpy() failed to allocate memory");
+			return NULL;
+		}
 		
-		width = image_like->width;
-		height = image_like->height;
-		format = image_like->format;
+		dst_capsule = PyCUDA_RegisterImage(dst_ptr, src_width, src_height, src_format, src_timestamp, true);
+		dst_allocated = true;
+	}
+	else
+	{
+		int dst_width = 0;
+		int dst_height = 0;
+		imageFormat dst_format = IMAGE_UNKNOWN;
+
+		dst_ptr = PyCUDA_GetImage(dst_capsule, &dst_width, &dst_height, &dst_format);
+		
+		if( !dst_ptr ) 
+		{
+			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "failed to get CUDA image from dst argument");
+			return NULL;
+		}
+		
+		if( src_width != dst_width || src_height != dst_height || src_format != dst_format )
+		{
+			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "src/dst images need to have matching dimensions and formats");
+			return NULL;
+		}
+
+		PyCudaImage* dst_img = PyCUDA_GetImage(dst_capsule);
+		dst_img->timestamp = src_timestamp;
+	}
+	
+	// without a stream, the copy is synchronous
+	const size_t size = imageFormatSize(src_format, src_width, src_height);
+	const bool async = (pyStream != NULL && pyStream != Py_None);
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = async ? cudaMemcpyAsync(dst_ptr, src_ptr, size, cudaMemcpyDeviceToDevice, stream)
+			     : cudaMemcpy(dst_ptr, src_ptr, size, cudaMemcpyDeviceToDevice);
+	Py_END_ALLOW_THREADS
+
+	if( CUDA_FAILED(result) )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaMemcpy() failed to copy memory");
+		return NULL;
+	}
+
+	PyCUDA_GetImage(dst_capsule)->stream = stream;
+
+	if( dst_allocated )
+		return dst_capsule;
+	
+	Py_RETURN_NONE;
+}
+
+	
+// PyCUDA_DeviceSynchronize
+PyObject* PyCUDA_DeviceSynchronize( PyObject* self )
+{
+	Py_BEGIN_ALLOW_THREADS
+	CUDA(cudaDeviceSynchronize());
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+
+// PyCUDA_PoolStatsToDict
+static PyObject* PyCUDA_PoolStatsToDict( const cudaPoolStats& stats )
+{
+	PyObject* dict = PyDict_New();
+
+	PYDICT_SET_ITEM(dict, "used", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.usedBytes));
+	PYDICT_SET_ITEM(dict, "idle", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.idleBytes));
+	PYDICT_SET_ITEM(dict, "peak", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.peakBytes));
+	PYDICT_SET_ITEM(dict, "hits", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.hits));
+	PYDICT_SET_ITEM(dict, "misses", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.misses));
+
+	return dict;
+}
+
+// PyCUDA_PoolStats
+PyObject* PyCUDA_PoolStats( PyObject* self )
+{
+	cudaPoolStats mapped;
+	cudaPoolStats device;
+
+	cudaPoolGetStats(&mapped, &device);
+
+	PyObject* dict = PyDict_New();
+
+	PYDICT_SET_ITEM(dict, "mapped", PyCUDA_PoolStatsToDict(mapped));
+	PYDICT_SET_ITEM(dict, "device", PyCUDA_PoolStatsToDict(device));
+
+	return dict;
+}
+
+// PyCUDA_PoolTrim
+PyObject* PyCUDA_PoolTrim( PyObject* self )
+{
+	Py_BEGIN_ALLOW_THREADS
+	cudaPoolTrim();
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+// PyCUDA_MemoryUsage
+PyObject* PyCUDA_MemoryUsage( PyObject* self )
+{
+	PyObject* dict = PyDict_New();
+
+	for( int n=0; n < CUDA_MEMORY_CATEGORIES; n++ )
+		PYDICT_SET_ITEM(dict, cudaMemoryCategoryToStr((cudaMemoryCategory)n), PYLONG_FROM_UNSIGNED_LONG_LONG(cudaMemoryUsage((cudaMemoryCategory)n)));
+
+	PYDICT_SET_ITEM(dict, "total", PYLONG_FROM_UNSIGNED_LONG_LONG(cudaMemoryUsage()));
+	PYDICT_SET_ITEM(dict, "peak", PYLONG_FROM_UNSIGNED_LONG_LONG(cudaMemoryPeak()));
+	PYDICT_SET_ITEM(dict, "budget", PYLONG_FROM_UNSIGNED_LONG_LONG(cudaMemoryGetBudget()));
+
+	return dict;
+}
+
+// PyCUDA_MemorySetBudget
+PyObject* PyCUDA_MemorySetBudget( PyObject* self, PyObject* args )
+{
+	unsigned long long bytes = 0;
+
+	if( !PyArg_ParseTuple(args, "K", &bytes) )
+		return NULL;
+
+	cudaMemorySetBudget(bytes);
+	Py_RETURN_NONE;
+}
+
+
+// PyCUDA_AdaptFontSize
+PyObject* PyCUDA_AdaptFontSize( PyObject* self, PyObject* args )
+{
+	int dim = 0;
+
+	if( !PyArg_ParseTuple(args, "i", &dim) )
+		return NULL;
+
+	if( dim <= 0 )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "adaptFontSize() requested size is negative or zero");
+		return NULL;
+	}
+
+	return PyFloat_FromDouble(adaptFontSize(dim));
+}
+
+
+// PyCUDA_ConvertColor
+PyObject* PyCUDA_ConvertColor( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	// parse arguments
+	PyObject* pyInput  = NULL;
+	PyObject* pyOutput = NULL;
+	
+	PyObject* pyStream = NULL;
+	
+	static char* kwlist[] = {"input", "output", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO|O", kwlist, &pyInput, &pyOutput, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+	
+	// get pointers to image data
+	PyCudaImage* input = PyCUDA_GetImage(pyInput);
+	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
+
+	if( !input || !output )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaConvertColor() failed to get input/output image pointers (should be cudaImage)");
+		return NULL;
+	}
+
+	if( !PyCUDA_CheckContiguous(input, "cudaConvertColor") || !PyCUDA_CheckContiguous(output, "cudaConvertColor") )
+		return NULL;
+
+	if( input->width != output->width || input->height != output->height )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaConvertColor() input and output image resolutions are different");
+		return NULL;
+	}
+
+	// run the CUDA function
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaConvertColor(input->base.ptr, input->format, output->base.ptr, output->format, input->width, input->height, make_float2(0,255), stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaConvertColor() failed");
+		return NULL;
+	}
+
+	output->timestamp = input->timestamp;
+	output->stream = stream;
+
+	// return void
+	Py_RETURN_NONE;
+}
+
+
+// PyCUDA_Resize
+PyObject* PyCUDA_Resize( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	// parse arguments
+	PyObject* pyInput  = NULL;
+	PyObject* pyOutput = NULL;
+	
+	PyObject* pyStream = NULL;
+	
+	const char* filter_str = "point";
+	static char* kwlist[] = {"input", "output", "filter", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO|sO", kwlist, &pyInput, &pyOutput, &filter_str, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	const cudaFilterMode filter_mode = cudaFilterModeFromStr(filter_str);
+	
+	// get pointers to image data
+	PyCudaImage* input = PyCUDA_GetImage(pyInput);
+	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
+
+	if( !input || !output )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaResize() failed to get input/output image pointers (should be cudaImage)");
+		return NULL;
+	}
+
+	if( !PyCUDA_CheckContiguous(input, "cudaResize") || !PyCUDA_CheckContiguous(output, "cudaResize") )
+		return NULL;
+
+	if( input->format != output->format )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaResize() input and output image formats are different");
+		return NULL;
+	}
+
+	// run the CUDA function
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaResize(input->base.ptr, input->width, input->height, output->base.ptr, output->width, output->height, output->format, filter_mode, stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaResize() failed");
+		return NULL;
 	}
+
+	output->timestamp = input->timestamp;
+	output->stream = stream;
+
+	// return void
+	Py_RETURN_NONE;
+}
+
+
+// PyCUDA_Crop
+PyObject* PyCUDA_Crop( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	// parse arguments
+	PyObject* pyInput  = NULL;
+	PyObject* pyOutput = NULL;
 	
-	if( size <= 0 && (width <= 0 || height <= 0) )
+	float left, top, right, bottom;
+	PyObject* pyStream = NULL;
+
+	static char* kwlist[] = {"input", "output", "roi", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO(ffff)|O", kwlist, &pyInput, &pyOutput, &left, &top, &right, &bottom, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	// get pointers to image data
+	PyCudaImage* input = PyCUDA_GetImage(pyInput);
+	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
+
+	if( !input || !output )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() requested size/dimensions are negative or zero");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaCrop() failed to get input/output image pointers (should be cudaImage)");
 		return NULL;
 	}
 
-	if( timestamp < 0 )
+	if( !PyCUDA_CheckContiguous(input, "cudaCrop") || !PyCUDA_CheckContiguous(output, "cudaCrop") )
+		return NULL;
+
+	if( input->format != output->format )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaCrop() input and output image formats are different");
+		return NULL;
+	}
+
+	// validate ROI
+	const float roi_width  = right - left;
+	const float roi_height = bottom - top;
+
+	if( left < 0 || top < 0 || right < 0 || bottom < 0 ||
+	    right > input->width || bottom > input->height ||
+	    roi_width <= 0 || roi_height <= 0 || 
+	    roi_width > output->width || roi_height > output->height )
+	{
+		PyErr_SetString(PyExc_ValueError, LOG_PY_UTILS "cudaCrop() had an invalid ROI");
+		return NULL;
+	}
+
+	// run the CUDA function
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaCrop(input->base.ptr, output->base.ptr, make_int4(left, top, right, bottom), input->width, input->height, input->format, stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaCrop() failed");
+		return NULL;
+	}
+
+	output->timestamp = input->timestamp;
+	output->stream = stream;
+
+	// return void
+	Py_RETURN_NONE;
+}
+
+
+// PyCUDA_Normalize
+PyObject* PyCUDA_Normalize( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	// parse arguments
+	PyObject* pyInput  = NULL;
+	PyObject* pyOutput = NULL;
+	
+	float input_min, input_max;
+	float output_min, output_max;
+	
+	PyObject* pyStream = NULL;
+	
+	static char* kwlist[] = {"input", "inputRange", "output", "outputRange", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ff)O(ff)|O", kwlist, &pyInput, &input_min, &input_max, &pyOutput, &output_min, &output_max, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	// get pointers to image data
+	PyCudaImage* input = PyCUDA_GetImage(pyInput);
+	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
+
+	if( !input || !output )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaNormalize() failed to get input/output image pointers (should be cudaImage)");
+		return NULL;
+	}
+
+	if( !PyCUDA_CheckContiguous(input, "cudaNormalize") || !PyCUDA_CheckContiguous(output, "cudaNormalize") )
+		return NULL;
+
+	if( input->format != output->format )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaNormalize() input and output image formats are different");
+		return NULL;
+	}
+
+	if( input->width != output->width || input->height != output->height )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaNormalize() input and output image resolutions are different");
+		return NULL;
+	}
+
+	// run the CUDA function
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaNormalize(input->base.ptr, make_float2(input_min, input_max), output->base.ptr, make_float2(output_min, output_max), output->width, output->height, output->format, stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaNormalize() failed");
+		return NULL;
+	}
+
+	output->timestamp = input->timestamp;
+	output->stream = stream;
+
+	// return void
+	Py_RETURN_NONE;
+}
+
+
+// PyCUDA_TensorFromImages
+PyObject* PyCUDA_TensorFromImages( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	// parse arguments
+	PyObject* pyImages = NULL;
+	PyObject* pyOutput = NULL;
+	PyObject* pyStream = NULL;
+
+	int width = 0;
+	int height = 0;
+
+	float3 mean = make_float3(0,0,0);
+	float3 stdDev = make_float3(1,1,1);
+	float2 range = make_float2(0,1);
+
+	const char* layout_str = "NCHW";
+	const char* dtype_str = "float32";
+	const char* filter_str = "linear";
+
+	static char* kwlist[] = {"images", "size", "mean", "std", "layout", "dtype", "range", "filter", "stream", "out", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ii)|(fff)(fff)ss(ff)sOO", kwlist, &pyImages, &width, &height, 
+							   &mean.x, &mean.y, &mean.z, &stdDev.x, &stdDev.y, &stdDev.z,
+							   &layout_str, &dtype_str, &range.x, &range.y, &filter_str, &pyStream, &pyOutput))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	if( width <= 0 || height <= 0 )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaTensorFromImages() size should be a positive (width, height) tuple");
+		return NULL;
+	}
+
+	// the batched kernel writes planar RGB, so NCHW is the only layout
+	if( strcasecmp(layout_str, "NCHW") != 0 )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaTensorFromImages() only supports layout='NCHW'");
+		return NULL;
+	}
+
+	bool fp16 = false;
+
+	if( strcasecmp(dtype_str, "float16") == 0 || strcasecmp(dtype_str, "half") == 0 )
+		fp16 = true;
+	else if( strcasecmp(dtype_str, "float32") != 0 && strcasecmp(dtype_str, "float") != 0 )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaTensorFromImages() dtype should be 'float32' or 'float16'");
+		return NULL;
+	}
+
+	const cudaFilterMode filter = cudaFilterModeFromStr(filter_str);
+
+	// get the list of images
+	PyObject* images = PySequence_Fast(pyImages, LOG_PY_UTILS "cudaTensorFromImages() images should be a list or tuple of cudaImage");
+
+	if( !images )
+		return NULL;
+
+	const Py_ssize_t batchSize = PySequence_Fast_GET_SIZE(images);
+
+	if( batchSize <= 0 )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaTensorFromImages() was passed an empty list of images");
+		Py_DECREF(images);
+		return NULL;
+	}
+
+	imageFormat format = IMAGE_UNKNOWN;
+
+	for( Py_ssize_t n=0; n < batchSize; n++ )
+	{
+		PyCudaImage* img = PyCUDA_GetImage(PySequence_Fast_GET_ITEM(images, n));
+
+		if( !img )
+		{
+			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaTensorFromImages() images should be a list or tuple of cudaImage");
+			Py_DECREF(images);
+			return NULL;
+		}
+
+		if( !PyCUDA_CheckContiguous(img, "cudaTensorFromImages") )
+		{
+			Py_DECREF(images);
+			return NULL;
+		}
+
+		if( n == 0 )
+			format = img->format;
+		else if( img->format != format )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaTensorFromImages() images should all have the same format");
+			Py_DECREF(images);
+			return NULL;
+		}
+	}
+
+	// get or allocate the output tensor
+	const size_t planeSize = width * height * 3;
+	const size_t size = batchSize * planeSize * (fp16 ? sizeof(__half) : sizeof(float));
+
+	PyCudaMemory* output = NULL;
+
+	if( pyOutput != NULL && pyOutput != Py_None )
+	{
+		output = PyCUDA_GetMemory(pyOutput);
+
+		if( !output || PyCUDA_IsImage(pyOutput) )
+		{
+			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaTensorFromImages() out argument should be a cudaMemory object");
+			Py_DECREF(images);
+			return NULL;
+		}
+
+		if( output->size < size )
+		{
+			PyErr_Format(PyExc_Exception, LOG_PY_UTILS "cudaTensorFromImages() out buffer is %zu bytes, but the tensor needs %zu bytes", output->size, size);
+			Py_DECREF(images);
+			return NULL;
+		}
+
+		Py_INCREF(pyOutput);
+	}
+	else
+	{
+		void* ptr = NULL;
+
+		if( !cudaMallocPooled(&ptr, size) )
+		{
+			PyErr_SetString(PyExc_MemoryError, LOG_PY_UTILS "cudaTensorFromImages() failed to allocate CUDA memory");
+			Py_DECREF(images);
+			return NULL;
+		}
+
+		pyOutput = PyCUDA_RegisterMemory(ptr, size, false, true);
+
+		if( !pyOutput )
+		{
+			cudaFreePooled(ptr);
+			Py_DECREF(images);
+			return NULL;
+		}
+
+		output = (PyCudaMemory*)pyOutput;
+	}
+
+	// launch the batched kernel on up to CUDA_PREPROCESS_MAX_BATCH images at a time
+	cudaPreprocessImage inputs[CUDA_PREPROCESS_MAX_BATCH];
+	cudaError_t result = cudaSuccess;
+
+	for( Py_ssize_t batch=0; batch < batchSize && result == cudaSuccess; batch += CUDA_PREPROCESS_MAX_BATCH )
+	{
+		const uint32_t count = (batchSize - batch < CUDA_PREPROCESS_MAX_BATCH) ? batchSize - batch : CUDA_PREPROCESS_MAX_BATCH;
+
+		for( uint32_t n=0; n < count; n++ )
+		{
+			PyCudaImage* img = (PyCudaImage*)PySequence_Fast_GET_ITEM(images, batch + n);
+
+			inputs[n].image = img->base.ptr;
+			inputs[n].width = img->width;
+			inputs[n].height = img->height;
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+
+		if( fp16 )
+			result = CUDA(cudaPreprocessBatch(inputs, count, format, ((__half*)output->ptr) + batch * planeSize, width, height, range, mean, stdDev, filter, stream));
+		else
+			result = CUDA(cudaPreprocessBatch(inputs, count, format, ((float*)output->ptr) + batch * planeSize, width, height, range, mean, stdDev, filter, stream));
+
+		Py_END_ALLOW_THREADS
+	}
+
+	Py_DECREF(images);
+
+	if( result != cudaSuccess )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaTensorFromImages() failed");
+		Py_DECREF(pyOutput);
+		return NULL;
+	}
+
+	// describe the tensor for __cuda_array_interface__
+	output->tensorDims = 4;
+	output->tensorShape[0] = batchSize;
+	output->tensorShape[1] = 3;
+	output->tensorShape[2] = height;
+	output->tensorShape[3] = width;
+	output->tensorType = fp16 ? "<f2" : "<f4";
+
+	return pyOutput;
+}
+
+
+// PyCUDA_Overlay
+PyObject* PyCUDA_Overlay( PyObject* self, PyObject* args, PyObject* kwds )
+{
+	// parse arguments
+	PyObject* pyInput  = NULL;
+	PyObject* pyOutput = NULL;
+	
+	float x = 0.0f;
+	float y = 0.0f;
+
+	PyObject* pyStream = NULL;
+
+	static char* kwlist[] = {"input", "output", "x", "y", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO|ffO", kwlist, &pyInput, &pyOutput, &x, &y, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	// get pointers to image data
+	PyCudaImage* input = PyCUDA_GetImage(pyInput);
+	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
+
+	if( !input || !output )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() timestamp cannot be negative");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaOverlay() failed to get input/output image pointers (should be cudaImage)");
 		return NULL;
 	}
 
-	const bool isImage = (width > 0) && (height > 0);
+	if( !PyCUDA_CheckContiguous(input, "cudaOverlay") || !PyCUDA_CheckContiguous(output, "cudaOverlay") )
+		return NULL;
 
-	if( isImage && format == IMAGE_UNKNOWN )
+	if( input->format != output->format )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() invalid format string");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaOverlay() input and output image formats are different");
 		return NULL;
 	}
 
-	if( isImage )
-		size = imageFormatSize(format, width, height);
+	// run the CUDA function
+	cudaError_t result = cudaSuccess;
 
-	// allocate memory
-	void* ptr = NULL;
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaOverlay(input->base.ptr, input->width, input->height, output->base.ptr, output->width, output->height, output->format, x, y, stream));
+	Py_END_ALLOW_THREADS
 
-	if( !cudaAllocMapped(&ptr, size) )
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() failed to allocate memory");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaOverlay() failed");
 		return NULL;
 	}
 
-	return isImage ? PyCUDA_RegisterImage(ptr, width, height, format, timestamp, true)
-				: PyCUDA_RegisterMemory(ptr, size, true);
-}
+	output->timestamp = input->timestamp;
+	output->stream = stream;
 
+	// return void
+	Py_RETURN_NONE;
+}
 
-// PyCUDA_Memcpy
-PyObject* PyCUDA_Memcpy( PyObject* self, PyObject* args, PyObject* kwds )
+//-------------------------------------------------------------------------------
+// PyCUDA_DrawCircle
+PyObject* PyCUDA_DrawCircle( PyObject* self, PyObject* args, PyObject* kwds )
 {
-	PyObject* dst_capsule = NULL;
-	PyObject* src_capsule = NULL;
+	// parse arguments
+	PyObject* pyInput  = NULL;
+	PyObject* pyOutput = NULL;
+	PyObject* pyColor  = NULL;
+	
+	float x = 0.0f;
+	float y = 0.0f;
+	float radius = 0.0f;
 	
-	static char* kwlist[]  = {"dst", "src", NULL};
+	PyObject* pyStream = NULL;
+	
+	static char* kwlist[] = {"input", "center", "radius", "color", "output", "stream", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &dst_capsule, &src_capsule))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ff)fO|OO", kwlist, &pyInput, &x, &y, &radius, &pyColor, &pyOutput, &pyStream))
 		return NULL;
 
-	// check if the args were reversed in the single-arg version
-	if( !src_capsule && dst_capsule != NULL )
-	{
-		src_capsule = dst_capsule;
-		dst_capsule = NULL;
-	}
-	
-	// get the src image
-	int src_width = 0;
-	int src_height = 0;
-	imageFormat src_format = IMAGE_UNKNOWN;
-	uint64_t src_timestamp = 0;
-	
-	void* src_ptr = PyCUDA_GetImage(src_capsule, &src_width, &src_height, &src_format, &src_timestamp);
-	
-	if( !src_ptr ) 
-	{
-		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "failed to get CUDA image from src argument");
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
 		return NULL;
-	}
 	
-	// allocate the dst image (if needed)
-	void* dst_ptr = NULL;
-	bool dst_allocated = false;
+	if( !pyOutput )
+		pyOutput = pyInput;
+	
+	// get pointers to image data
+	PyCudaImage* input = PyCUDA_GetImage(pyInput);
+	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
 
-	if( !dst_capsule )
+	if( !input || !output )
 	{
-		if( !cudaAllocMapped(&dst_ptr, src_width, src_height, src_format) )
-		{
-			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaMemcpy() failed to allocate memory");
-			return NULL;
-		}
-		
-		dst_capsule = PyCUDA_RegisterImage(dst_ptr, src_width, src_height, src_format, src_timestamp, true);
-		dst_allocated = true;
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "failed to get input/output CUDA image pointers (should be cudaImage)");
+		return NULL;
 	}
-	else
-	{
-		int dst_width = 0;
-		int dst_height = 0;
-		imageFormat dst_format = IMAGE_UNKNOWN;
 
-		dst_ptr = PyCUDA_GetImage(dst_capsule, &dst_width, &dst_height, &dst_format);
-		
-		if( !dst_ptr ) 
-		{
-			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "failed to get CUDA image from dst argument");
-			return NULL;
-		}
-		
-		if( src_width != dst_width || src_height != dst_height || src_format != dst_format )
-		{
-			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "src/dst images need to have matching dimensions and formats");
-			return NULL;
-		}
+	if( !PyCUDA_CheckContiguous(input, "cudaDrawCircle") || !PyCUDA_CheckContiguous(output, "cudaDrawCircle") )
+		return NULL;
 
-		PyCudaImage* dst_img = PyCUDA_GetImage(dst_capsule);
-		dst_img->timestamp = src_timestamp;
-	}
-	
-	if( CUDA_FAILED(cudaMemcpy(dst_ptr, src_ptr, imageFormatSize(src_format, src_width, src_height), cudaMemcpyDeviceToDevice)) )
+	if( input->width != output->width || input->height != output->height || input->format != output->format )
 	{
-		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaMemcpy() failed to copy memory");
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "input/output images need to have matching dimensions and formats");
 		return NULL;
-	}
-
-	if( dst_allocated )
-		return dst_capsule;
+	}	
 	
-	Py_RETURN_NONE;
-}
-
+	// parse the color
+	float4 color = make_float4(0, 0, 0, 255);
 	
-// PyCUDA_DeviceSynchronize
-PyObject* PyCUDA_DeviceSynchronize( PyObject* self )
-{
-	CUDA(cudaDeviceSynchronize());
-	Py_RETURN_NONE;
-}
+	if( !PyTuple_Check(pyColor) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "color argument isn't a valid tuple");
+		return NULL;
+	}
 
+	if( !PyArg_ParseTuple(pyColor, "fff|f", &color.x, &color.y, &color.z, &color.w) )
+		return NULL;
 
-// PyCUDA_AdaptFontSize
-PyObject* PyCUDA_AdaptFontSize( PyObject* self, PyObject* args )
-{
-	int dim = 0;
+	// run the CUDA function
+	cudaError_t result = cudaSuccess;
 
-	if( !PyArg_ParseTuple(args, "i", &dim) )
-		return NULL;
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaDrawCircle(input->base.ptr, output->base.ptr, input->width, input->height, input->format, 
+							 x, y, radius, color, stream));
+	Py_END_ALLOW_THREADS
 
-	if( dim <= 0 )
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "adaptFontSize() requested size is negative or zero");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaDrawCircle() failed to render");
 		return NULL;
 	}
 
-	return PyFloat_FromDouble(adaptFontSize(dim));
+	output->timestamp = input->timestamp;
+	output->stream = stream;
+
+	Py_RETURN_NONE;
 }
 
 
-// PyCUDA_ConvertColor
-PyObject* PyCUDA_ConvertColor( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCUDA_DrawLine
+PyObject* PyCUDA_DrawLine( PyObject* self, PyObject* args, PyObject* kwds )
 {
 	// parse arguments
 	PyObject* pyInput  = NULL;
 	PyObject* pyOutput = NULL;
+	PyObject* pyColor  = NULL;
+	
+	float x1 = 0.0f;
+	float y1 = 0.0f;
+	float x2 = 0.0f;
+	float y2 = 0.0f;
 	
-	static char* kwlist[] = {"input", "output", NULL};
+	float line_width = 1.0f;
+
+	PyObject* pyStream = NULL;
+
+	static char* kwlist[] = {"input", "a", "b", "color", "line_width", "output", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ff)(ff)O|fOO", kwlist, &pyInput, &x1, &y1, &x2, &y2, &pyColor, &line_width, &pyOutput, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO", kwlist, &pyInput, &pyOutput))
+	if( !PyCUDA_GetStream(pyStream, &stream) )
 		return NULL;
+
+	if( !pyOutput )
+		pyOutput = pyInput;
 	
 	// get pointers to image data
 	PyCudaImage* input = PyCUDA_GetImage(pyInput);
@@ -1233,44 +3505,82 @@ PyObject* PyCUDA_ConvertColor( PyObject* self, PyObject* args, PyObject* kwds )
 
 	if( !input || !output )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaConvertColor() failed to get input/output image pointers (should be cudaImage)");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "failed to get input/output CUDA image pointers (should be cudaImage)");
 		return NULL;
 	}
 
-	if( input->width != output->width || input->height != output->height )
+	if( !PyCUDA_CheckContiguous(input, "cudaDrawLine") || !PyCUDA_CheckContiguous(output, "cudaDrawLine") )
+		return NULL;
+
+	if( input->width != output->width || input->height != output->height || input->format != output->format )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaConvertColor() input and output image resolutions are different");
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "input/output images need to have matching dimensions and formats");
+		return NULL;
+	}	
+	
+	// parse the color
+	float4 color = make_float4(0, 0, 0, 255);
+	
+	if( !PyTuple_Check(pyColor) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "color argument isn't a valid tuple");
 		return NULL;
 	}
 
+	if( !PyArg_ParseTuple(pyColor, "fff|f", &color.x, &color.y, &color.z, &color.w) )
+		return NULL;
+
 	// run the CUDA function
-	if( CUDA_FAILED(cudaConvertColor(input->base.ptr, input->format, output->base.ptr, output->format, input->width, input->height)) )
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaDrawLine(input->base.ptr, output->base.ptr, input->width, input->height, input->format,
+						    x1, y1, x2, y2, color, line_width, stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaConvertColor() failed");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaDrawLine() failed to render");
 		return NULL;
 	}
 
 	output->timestamp = input->timestamp;
+	output->stream = stream;
 
-	// return void
 	Py_RETURN_NONE;
 }
 
 
-// PyCUDA_Resize
-PyObject* PyCUDA_Resize( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCUDA_DrawRect
+PyObject* PyCUDA_DrawRect( PyObject* self, PyObject* args, PyObject* kwds )
 {
 	// parse arguments
 	PyObject* pyInput  = NULL;
 	PyObject* pyOutput = NULL;
+	PyObject* pyColor  = NULL;
+	PyObject* pyLineColor = NULL;
 	
-	const char* filter_str = "point";
-	static char* kwlist[] = {"input", "output", "filter", NULL};
+	float left = 0.0f;
+	float top = 0.0f;
+	float right = 0.0f;
+	float bottom = 0.0f;
+	
+	float line_width = 1.0f;
+	
+	PyObject* pyStream = NULL;
+	
+	static char* kwlist[] = {"input", "rect", "color", "line_color", "line_width", "output", "stream", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO|s", kwlist, &pyInput, &pyOutput, &filter_str))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ffff)|OOfOO", kwlist, &pyInput, &left, &top, &right, &bottom, &pyColor, &pyLineColor, &line_width, &pyOutput, &pyStream))
 		return NULL;
 
-	const cudaFilterMode filter_mode = cudaFilterModeFromStr(filter_str);
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	if( !pyOutput )
+		pyOutput = pyInput;
 	
 	// get pointers to image data
 	PyCudaImage* input = PyCUDA_GetImage(pyInput);
@@ -1278,388 +3588,523 @@ PyObject* PyCUDA_Resize( PyObject* self, PyObject* args, PyObject* kwds )
 
 	if( !input || !output )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaResize() failed to get input/output image pointers (should be cudaImage)");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "failed to get input/output CUDA image pointers (should be cudaImage)");
 		return NULL;
 	}
 
-	if( input->format != output->format )
+	if( !PyCUDA_CheckContiguous(input, "cudaDrawRect") || !PyCUDA_CheckContiguous(output, "cudaDrawRect") )
+		return NULL;
+
+	if( input->width != output->width || input->height != output->height || input->format != output->format )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaResize() input and output image formats are different");
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "input/output images need to have matching dimensions and formats");
+		return NULL;
+	}	
+	
+	// parse the color
+	float4 color = make_float4(0,0,0,0);
+
+	if( pyColor != NULL && PyTuple_Check(pyColor) )
+	{
+		if( !PyArg_ParseTuple(pyColor, "fff|f", &color.x, &color.y, &color.z, &color.w) )
+			return NULL;
+	}
+	else if( pyColor != NULL )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "color argument isn't a valid tuple");
+		return NULL;
+	}
+
+	// parse the line color
+	float4 line_color = make_float4(0,0,0,0);
+	
+	if( pyLineColor != NULL && PyTuple_Check(pyLineColor) )
+	{
+		if( !PyArg_ParseTuple(pyLineColor, "fff|f", &line_color.x, &line_color.y, &line_color.z, &line_color.w) )
+			return NULL;
+	}
+	else if( pyLineColor != NULL )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "line_color argument isn't a valid tuple");
 		return NULL;
 	}
 
 	// run the CUDA function
-	if( CUDA_FAILED(cudaResize(input->base.ptr, input->width, input->height, output->base.ptr, output->width, output->height, output->format, filter_mode)) )
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaDrawRect(input->base.ptr, output->base.ptr, input->width, input->height, input->format,
+						    left, top, right, bottom, color, line_color, line_width, stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaResize() failed");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaDrawRect() failed to render");
 		return NULL;
 	}
 
 	output->timestamp = input->timestamp;
+	output->stream = stream;
 
-	// return void
 	Py_RETURN_NONE;
 }
 
 
-// PyCUDA_Crop
-PyObject* PyCUDA_Crop( PyObject* self, PyObject* args, PyObject* kwds )
-{
-	// parse arguments
-	PyObject* pyInput  = NULL;
-	PyObject* pyOutput = NULL;
-	
-	float left, top, right, bottom;
-	static char* kwlist[] = {"input", "output", "roi", NULL};
+//-------------------------------------------------------------------------------
+// PyCUDA_GetOutputImage (returns a new reference to the output image, allocating it if it wasn't provided)
+static PyCudaImage* PyCUDA_GetOutputImage( PyObject* pyOutput, uint32_t width, uint32_t height, imageFormat format, const char* function )
+{
+	if( !pyOutput || pyOutput == Py_None )
+	{
+		void* ptr = NULL;
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO(ffff)", kwlist, &pyInput, &pyOutput, &left, &top, &right, &bottom))
-		return NULL;
+		if( !cudaAllocMappedPooled(&ptr, width, height, format) )
+		{
+			PyErr_Format(PyExc_MemoryError, LOG_PY_UTILS "%s() failed to allocate the output image", function);
+			return NULL;
+		}
+
+		return (PyCudaImage*)PyCUDA_RegisterImage(ptr, width, height, format, 0, true, true);
+	}
 
-	// get pointers to image data
-	PyCudaImage* input = PyCUDA_GetImage(pyInput);
 	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
 
-	if( !input || !output )
+	if( !output )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaCrop() failed to get input/output image pointers (should be cudaImage)");
+		PyErr_Format(PyExc_TypeError, LOG_PY_UTILS "%s() output argument should be a cudaImage", function);
 		return NULL;
 	}
 
-	if( input->format != output->format )
-	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaCrop() input and output image formats are different");
+	if( !PyCUDA_CheckContiguous(output, function) )
 		return NULL;
-	}
 
-	// validate ROI
-	const float roi_width  = right - left;
-	const float roi_height = bottom - top;
+	Py_INCREF(output);
+	return output;
+}
 
-	if( left < 0 || top < 0 || right < 0 || bottom < 0 ||
-	    right > input->width || bottom > input->height ||
-	    roi_width <= 0 || roi_height <= 0 || 
-	    roi_width > output->width || roi_height > output->height )
+// PyCUDA_ParseMatrix (accepts nested rows or a flat sequence of rows*cols values)
+static bool PyCUDA_ParseMatrix( PyObject* object, float* matrix, int rows, int cols, const char* function )
+{
+	PyObject* seq = object ? PySequence_Fast(object, "") : NULL;
+
+	if( !seq )
 	{
-		PyErr_SetString(PyExc_ValueError, LOG_PY_UTILS "cudaCrop() had an invalid ROI");
-		return NULL;
+		PyErr_Format(PyExc_TypeError, LOG_PY_UTILS "%s() expected a %ix%i matrix (list or tuple)", function, rows, cols);
+		return false;
 	}
 
-	// run the CUDA function
-	if( CUDA_FAILED(cudaCrop(input->base.ptr, output->base.ptr, make_int4(left, top, right, bottom), input->width, input->height, input->format)) )
+	const Py_ssize_t length = PySequence_Fast_GET_SIZE(seq);
+	const bool flat = (length == rows * cols);
+	bool valid = (flat || length == rows);
+
+	for( Py_ssize_t n=0; valid && n < length; n++ )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaCrop() failed");
-		return NULL;
+		PyObject* item = PySequence_Fast_GET_ITEM(seq, n);
+
+		if( flat )
+		{
+			matrix[n] = (float)PyFloat_AsDouble(item);
+			valid = !PyErr_Occurred();
+			continue;
+		}
+
+		PyObject* row = PySequence_Fast(item, "");
+
+		if( !row || PySequence_Fast_GET_SIZE(row) != cols )
+		{
+			Py_XDECREF(row);
+			valid = false;
+			break;
+		}
+
+		for( int c=0; valid && c < cols; c++ )
+		{
+			matrix[n * cols + c] = (float)PyFloat_AsDouble(PySequence_Fast_GET_ITEM(row, c));
+			valid = !PyErr_Occurred();
+		}
+
+		Py_DECREF(row);
 	}
 
-	output->timestamp = input->timestamp;
+	Py_DECREF(seq);
 
-	// return void
-	Py_RETURN_NONE;
-}
+	if( !valid )
+	{
+		PyErr_Clear();
+		PyErr_Format(PyExc_ValueError, LOG_PY_UTILS "%s() expected a %ix%i matrix of numbers", function, rows, cols);
+		return false;
+	}
 
+	return true;
+}
 
-// PyCUDA_Normalize
-PyObject* PyCUDA_Normalize( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCUDA_WarpAffine
+PyObject* PyCUDA_WarpAffine( PyObject* self, PyObject* args, PyObject* kwds )
 {
 	// parse arguments
 	PyObject* pyInput  = NULL;
 	PyObject* pyOutput = NULL;
-	
-	float input_min, input_max;
-	float output_min, output_max;
-	
-	static char* kwlist[] = {"input", "inputRange", "output", "outputRange", NULL};
+	PyObject* pyMatrix = NULL;
+	PyObject* pyStream = NULL;
+
+	int inverted = 0;
+	static char* kwlist[] = {"input", "matrix", "output", "inverted", "stream", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ff)O(ff)", kwlist, &pyInput, &input_min, &input_max, &pyOutput, &output_min, &output_max))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO|OiO", kwlist, &pyInput, &pyMatrix, &pyOutput, &inverted, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	float transform[2][3];
+
+	if( !PyCUDA_ParseMatrix(pyMatrix, &transform[0][0], 2, 3, "cudaWarpAffine") )
 		return NULL;
 
-	// get pointers to image data
 	PyCudaImage* input = PyCUDA_GetImage(pyInput);
-	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
 
-	if( !input || !output )
+	if( !input )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaNormalize() failed to get input/output image pointers (should be cudaImage)");
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaWarpAffine() input argument should be a cudaImage");
 		return NULL;
 	}
 
-	if( input->format != output->format )
+	if( !PyCUDA_CheckContiguous(input, "cudaWarpAffine") )
+		return NULL;
+
+	if( input->format != IMAGE_RGBA8 && input->format != IMAGE_RGBA32F )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaNormalize() input and output image formats are different");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpAffine() only supports rgba8 and rgba32f images");
 		return NULL;
 	}
 
-	if( input->width != output->width || input->height != output->height )
+	PyCudaImage* output = PyCUDA_GetOutputImage(pyOutput, input->width, input->height, input->format, "cudaWarpAffine");
+
+	if( !output )
+		return NULL;
+
+	if( output->width != input->width || output->height != input->height || output->format != input->format )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaNormalize() input and output image resolutions are different");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpAffine() input and output images need to have the same dimensions and format");
+		Py_DECREF(output);
 		return NULL;
 	}
 
 	// run the CUDA function
-	if( CUDA_FAILED(cudaNormalize(input->base.ptr, make_float2(input_min, input_max), output->base.ptr, make_float2(output_min, output_max), output->width, output->height, output->format)) )
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+
+	if( input->format == IMAGE_RGBA8 )
+		result = CUDA(cudaWarpAffine((uchar4*)input->base.ptr, (uchar4*)output->base.ptr, input->width, input->height, transform, inverted > 0, stream));
+	else
+		result = CUDA(cudaWarpAffine((float4*)input->base.ptr, (float4*)output->base.ptr, input->width, input->height, transform, inverted > 0, stream));
+
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaNormalize() failed");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpAffine() failed");
+		Py_DECREF(output);
 		return NULL;
 	}
 
 	output->timestamp = input->timestamp;
+	output->stream = stream;
 
-	// return void
-	Py_RETURN_NONE;
+	return (PyObject*)output;
 }
 
-
-// PyCUDA_Overlay
-PyObject* PyCUDA_Overlay( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCUDA_WarpPerspective
+PyObject* PyCUDA_WarpPerspective( PyObject* self, PyObject* args, PyObject* kwds )
 {
 	// parse arguments
 	PyObject* pyInput  = NULL;
 	PyObject* pyOutput = NULL;
-	
-	float x = 0.0f;
-	float y = 0.0f;
+	PyObject* pyMatrix = NULL;
+	PyObject* pyStream = NULL;
 
-	static char* kwlist[] = {"input", "output", "x", "y", NULL};
+	int inverted = 0;
+	const char* filter_str = "linear";
+	static char* kwlist[] = {"input", "matrix", "output", "inverted", "filter", "stream", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO|ff", kwlist, &pyInput, &pyOutput, &x, &y))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "OO|OisO", kwlist, &pyInput, &pyMatrix, &pyOutput, &inverted, &filter_str, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
+	float transform[3][3];
+
+	if( !PyCUDA_ParseMatrix(pyMatrix, &transform[0][0], 3, 3, "cudaWarpPerspective") )
 		return NULL;
 
-	// get pointers to image data
 	PyCudaImage* input = PyCUDA_GetImage(pyInput);
-	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
 
-	if( !input || !output )
+	if( !input )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaOverlay() failed to get input/output image pointers (should be cudaImage)");
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaWarpPerspective() input argument should be a cudaImage");
 		return NULL;
 	}
 
-	if( input->format != output->format )
-	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaOverlay() input and output image formats are different");
+	if( !PyCUDA_CheckContiguous(input, "cudaWarpPerspective") )
+		return NULL;
+
+	PyCudaImage* output = PyCUDA_GetOutputImage(pyOutput, input->width, input->height, input->format, "cudaWarpPerspective");
+
+	if( !output )
 		return NULL;
-	}
 
 	// run the CUDA function
-	if( CUDA_FAILED(cudaOverlay(input->base.ptr, input->width, input->height, output->base.ptr, output->width, output->height, output->format, x, y)) )
+	const cudaFilterMode filter = cudaFilterModeFromStr(filter_str);
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaWarpPerspective(input->base.ptr, input->width, input->height, input->format,
+							    output->base.ptr, output->width, output->height, output->format,
+							    transform, filter, inverted > 0, stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaOverlay() failed");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpPerspective() failed");
+		Py_DECREF(output);
 		return NULL;
 	}
 
 	output->timestamp = input->timestamp;
+	output->stream = stream;
 
-	// return void
-	Py_RETURN_NONE;
+	return (PyObject*)output;
 }
 
-//-------------------------------------------------------------------------------
-// PyCUDA_DrawCircle
-PyObject* PyCUDA_DrawCircle( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCUDA_WarpIntrinsic
+PyObject* PyCUDA_WarpIntrinsic( PyObject* self, PyObject* args, PyObject* kwds )
 {
 	// parse arguments
 	PyObject* pyInput  = NULL;
 	PyObject* pyOutput = NULL;
-	PyObject* pyColor  = NULL;
-	
-	float x = 0.0f;
-	float y = 0.0f;
-	float radius = 0.0f;
-	
-	static char* kwlist[] = {"input", "center", "radius", "color", "output", NULL};
+	PyObject* pyStream = NULL;
+
+	float2 focalLength = make_float2(0,0);
+	float2 principalPoint = make_float2(0,0);
+	float4 distortion = make_float4(0,0,0,0);
+
+	const char* filter_str = "linear";
+	static char* kwlist[] = {"input", "focalLength", "principalPoint", "distortion", "output", "filter", "stream", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ff)fO|O", kwlist, &pyInput, &x, &y, &radius, &pyColor, &pyOutput))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ff)(ff)(ffff)|OsO", kwlist, &pyInput, &focalLength.x, &focalLength.y,
+							   &principalPoint.x, &principalPoint.y, &distortion.x, &distortion.y, &distortion.z, &distortion.w,
+							   &pyOutput, &filter_str, &pyStream))
 		return NULL;
-	
-	if( !pyOutput )
-		pyOutput = pyInput;
-	
-	// get pointers to image data
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
+		return NULL;
+
 	PyCudaImage* input = PyCUDA_GetImage(pyInput);
-	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
 
-	if( !input || !output )
+	if( !input )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "failed to get input/output CUDA image pointers (should be cudaImage)");
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaWarpIntrinsic() input argument should be a cudaImage");
 		return NULL;
 	}
 
-	if( input->width != output->width || input->height != output->height || input->format != output->format )
-	{
-		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "input/output images need to have matching dimensions and formats");
+	if( !PyCUDA_CheckContiguous(input, "cudaWarpIntrinsic") )
 		return NULL;
-	}	
-	
-	// parse the color
-	float4 color = make_float4(0, 0, 0, 255);
-	
-	if( !PyTuple_Check(pyColor) )
-	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "color argument isn't a valid tuple");
+
+	PyCudaImage* output = PyCUDA_GetOutputImage(pyOutput, input->width, input->height, input->format, "cudaWarpIntrinsic");
+
+	if( !output )
 		return NULL;
-	}
 
-	if( !PyArg_ParseTuple(pyColor, "fff|f", &color.x, &color.y, &color.z, &color.w) )
+	if( output->width != input->width || output->height != input->height || output->format != input->format )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpIntrinsic() input and output images need to have the same dimensions and format");
+		Py_DECREF(output);
 		return NULL;
+	}
 
 	// run the CUDA function
-	if( CUDA_FAILED(cudaDrawCircle(input->base.ptr, output->base.ptr, input->width, input->height, input->format, 
-							 x, y, radius, color)) )
+	const cudaFilterMode filter = cudaFilterModeFromStr(filter_str);
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaWarpIntrinsic(input->base.ptr, output->base.ptr, input->width, input->height, input->format,
+							  focalLength, principalPoint, distortion, filter, stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaDrawCircle() failed to render");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpIntrinsic() failed");
+		Py_DECREF(output);
 		return NULL;
 	}
 
 	output->timestamp = input->timestamp;
+	output->stream = stream;
 
-	Py_RETURN_NONE;
+	return (PyObject*)output;
 }
 
-
-// PyCUDA_DrawLine
-PyObject* PyCUDA_DrawLine( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCUDA_WarpFisheye
+PyObject* PyCUDA_WarpFisheye( PyObject* self, PyObject* args, PyObject* kwds )
 {
 	// parse arguments
 	PyObject* pyInput  = NULL;
 	PyObject* pyOutput = NULL;
-	PyObject* pyColor  = NULL;
-	
-	float x1 = 0.0f;
-	float y1 = 0.0f;
-	float x2 = 0.0f;
-	float y2 = 0.0f;
-	
-	float line_width = 1.0f;
+	PyObject* pyStream = NULL;
 
-	static char* kwlist[] = {"input", "a", "b", "color", "line_width", "output", NULL};
+	float focus = 0.0f;
+	static char* kwlist[] = {"input", "focus", "output", "stream", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ff)(ff)O|fO", kwlist, &pyInput, &x1, &y1, &x2, &y2, &pyColor, &line_width, &pyOutput))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "Of|OO", kwlist, &pyInput, &focus, &pyOutput, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
 		return NULL;
 
-	if( !pyOutput )
-		pyOutput = pyInput;
-	
-	// get pointers to image data
 	PyCudaImage* input = PyCUDA_GetImage(pyInput);
-	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
 
-	if( !input || !output )
+	if( !input )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "failed to get input/output CUDA image pointers (should be cudaImage)");
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaWarpFisheye() input argument should be a cudaImage");
 		return NULL;
 	}
 
-	if( input->width != output->width || input->height != output->height || input->format != output->format )
-	{
-		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "input/output images need to have matching dimensions and formats");
+	if( !PyCUDA_CheckContiguous(input, "cudaWarpFisheye") )
 		return NULL;
-	}	
-	
-	// parse the color
-	float4 color = make_float4(0, 0, 0, 255);
-	
-	if( !PyTuple_Check(pyColor) )
+
+	if( input->format != IMAGE_RGBA8 && input->format != IMAGE_RGBA32F )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "color argument isn't a valid tuple");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpFisheye() only supports rgba8 and rgba32f images");
 		return NULL;
 	}
 
-	if( !PyArg_ParseTuple(pyColor, "fff|f", &color.x, &color.y, &color.z, &color.w) )
+	PyCudaImage* output = PyCUDA_GetOutputImage(pyOutput, input->width, input->height, input->format, "cudaWarpFisheye");
+
+	if( !output )
+		return NULL;
+
+	if( output->width != input->width || output->height != input->height || output->format != input->format )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpFisheye() input and output images need to have the same dimensions and format");
+		Py_DECREF(output);
 		return NULL;
+	}
 
 	// run the CUDA function
-	if( CUDA_FAILED(cudaDrawLine(input->base.ptr, output->base.ptr, input->width, input->height, input->format,
-						    x1, y1, x2, y2, color, line_width)) )
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+
+	if( input->format == IMAGE_RGBA8 )
+		result = CUDA(cudaWarpFisheye((uchar4*)input->base.ptr, (uchar4*)output->base.ptr, input->width, input->height, focus, stream));
+	else
+		result = CUDA(cudaWarpFisheye((float4*)input->base.ptr, (float4*)output->base.ptr, input->width, input->height, focus, stream));
+
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaDrawLine() failed to render");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaWarpFisheye() failed");
+		Py_DECREF(output);
 		return NULL;
 	}
 
 	output->timestamp = input->timestamp;
+	output->stream = stream;
 
-	Py_RETURN_NONE;
+	return (PyObject*)output;
 }
 
-
-// PyCUDA_DrawRect
-PyObject* PyCUDA_DrawRect( PyObject* self, PyObject* args, PyObject* kwds )
+// PyCUDA_Colormap
+PyObject* PyCUDA_Colormap( PyObject* self, PyObject* args, PyObject* kwds )
 {
 	// parse arguments
 	PyObject* pyInput  = NULL;
 	PyObject* pyOutput = NULL;
-	PyObject* pyColor  = NULL;
-	PyObject* pyLineColor = NULL;
-	
-	float left = 0.0f;
-	float top = 0.0f;
-	float right = 0.0f;
-	float bottom = 0.0f;
-	
-	float line_width = 1.0f;
-	
-	static char* kwlist[] = {"input", "rect", "color", "line_color", "line_width", "output", NULL};
+	PyObject* pyStream = NULL;
+
+	float2 range = make_float2(0,255);
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O(ffff)|OOfO", kwlist, &pyInput, &left, &top, &right, &bottom, &pyColor, &pyLineColor, &line_width, &pyOutput))
+	const char* colormap_str = "viridis";
+	const char* layout_str = "hwc";
+	const char* filter_str = "linear";
+
+	static char* kwlist[] = {"input", "output", "range", "colormap", "layout", "filter", "stream", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O|O(ff)sssO", kwlist, &pyInput, &pyOutput, &range.x, &range.y,
+							   &colormap_str, &layout_str, &filter_str, &pyStream))
+		return NULL;
+
+	cudaStream_t stream = NULL;
+
+	if( !PyCUDA_GetStream(pyStream, &stream) )
 		return NULL;
 
-	if( !pyOutput )
-		pyOutput = pyInput;
-	
-	// get pointers to image data
 	PyCudaImage* input = PyCUDA_GetImage(pyInput);
-	PyCudaImage* output = PyCUDA_GetImage(pyOutput);
 
-	if( !input || !output )
+	if( !input )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "failed to get input/output CUDA image pointers (should be cudaImage)");
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaColormap() input argument should be a cudaImage");
 		return NULL;
 	}
 
-	if( input->width != output->width || input->height != output->height || input->format != output->format )
-	{
-		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "input/output images need to have matching dimensions and formats");
+	if( !PyCUDA_CheckContiguous(input, "cudaColormap") )
 		return NULL;
-	}	
-	
-	// parse the color
-	float4 color = make_float4(0,0,0,0);
 
-	if( pyColor != NULL && PyTuple_Check(pyColor) )
+	if( imageFormatBaseType(input->format) != IMAGE_FLOAT )
 	{
-		if( !PyArg_ParseTuple(pyColor, "fff|f", &color.x, &color.y, &color.z, &color.w) )
-			return NULL;
-	}
-	else if( pyColor != NULL )
-	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "color argument isn't a valid tuple");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaColormap() input image should have a floating-point format (e.g. gray32f)");
 		return NULL;
 	}
 
-	// parse the line color
-	float4 line_color = make_float4(0,0,0,0);
-	
-	if( pyLineColor != NULL && PyTuple_Check(pyLineColor) )
-	{
-		if( !PyArg_ParseTuple(pyLineColor, "fff|f", &line_color.x, &line_color.y, &line_color.z, &line_color.w) )
-			return NULL;
-	}
-	else if( pyLineColor != NULL )
+	cudaDataFormat layout = FORMAT_DEFAULT;
+
+	if( strcasecmp(layout_str, "chw") == 0 )
+		layout = FORMAT_CHW;
+	else if( strcasecmp(layout_str, "hwc") != 0 )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "line_color argument isn't a valid tuple");
+		PyErr_SetString(PyExc_ValueError, LOG_PY_UTILS "cudaColormap() layout should be 'hwc' or 'chw'");
 		return NULL;
 	}
 
+	PyCudaImage* output = PyCUDA_GetOutputImage(pyOutput, input->width, input->height, IMAGE_RGB8, "cudaColormap");
+
+	if( !output )
+		return NULL;
+
 	// run the CUDA function
-	if( CUDA_FAILED(cudaDrawRect(input->base.ptr, output->base.ptr, input->width, input->height, input->format,
-						    left, top, right, bottom, color, line_color, line_width)) )
+	const cudaColormapType colormap = cudaColormapFromStr(colormap_str);
+	const cudaFilterMode filter = cudaFilterModeFromStr(filter_str);
+
+	cudaError_t result = cudaSuccess;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = CUDA(cudaColormap((float*)input->base.ptr, input->width, input->height,
+						  output->base.ptr, output->width, output->height,
+						  range, layout, output->format, colormap, filter, stream));
+	Py_END_ALLOW_THREADS
+
+	if( result != cudaSuccess )
 	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaDrawRect() failed to render");
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaColormap() failed");
+		Py_DECREF(output);
 		return NULL;
 	}
 
 	output->timestamp = input->timestamp;
+	output->stream = stream;
 
-	Py_RETURN_NONE;
+	return (PyObject*)output;
 }
 
 
@@ -1766,14 +4211,15 @@ static int PyFont_Init( PyFont_Object* self, PyObject *args, PyObject *kwds )
 	// parse arguments
 	const char* font_name = NULL;
 	float font_size = 32.0f;
+	int sdf = 0;
 
-	static char* kwlist[] = {"font", "size", NULL};
+	static char* kwlist[] = {"font", "size", "sdf", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|sf", kwlist, &font_name, &font_size))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|sfi", kwlist, &font_name, &font_size, &sdf))
 		return -1;
 
 	// create the font
-	cudaFont* font = cudaFont::Create(font_name, font_size);
+	cudaFont* font = cudaFont::Create(font_name, font_size, sdf > 0);
 
 	if( !font )
 	{
@@ -1910,7 +4356,9 @@ static PyObject* PyFont_OverlayText( PyFont_Object* self, PyObject* args, PyObje
 		return NULL;
 
 	// render the font overlay
+	Py_BEGIN_ALLOW_THREADS
 	self->font->OverlayText(ptr, format, width, height, text, x, y, rgba, bg_rgba);
+	Py_END_ALLOW_THREADS
 
 	// return void
 	Py_RETURN_NONE;
@@ -2002,6 +4450,447 @@ bool PyFont_RegisterType( PyObject* module )
 	return true;
 }
 
+//-------------------------------------------------------------------------------
+// PyPointCloud container
+typedef struct {
+	PyObject_HEAD
+	cudaPointCloud* cloud;
+} PyPointCloud_Object;
+
+
+// New
+static PyObject* PyPointCloud_New( PyTypeObject *type, PyObject *args, PyObject *kwds )
+{
+	LogDebug(LOG_PY_UTILS "PyPointCloud_New()\n");
+	
+	// allocate a new container
+	PyPointCloud_Object* self = (PyPointCloud_Object*)type->tp_alloc(type, 0);
+	
+	if( !self )
+	{
+		PyErr_SetString(PyExc_MemoryError, LOG_PY_UTILS "cudaPointCloud tp_alloc() failed to allocate a new object");
+		return NULL;
+	}
+	
+	self->cloud = NULL;
+	return (PyObject*)self;
+}
+
+
+// Init
+static int PyPointCloud_Init( PyPointCloud_Object* self, PyObject *args, PyObject *kwds )
+{
+	LogDebug(LOG_PY_UTILS "PyPointCloud_Init()\n");
+	
+	// parse arguments
+	int maxPoints = 0;
+	static char* kwlist[] = {"maxPoints", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &maxPoints))
+		return -1;
+
+	// create the point cloud
+	cudaPointCloud* cloud = cudaPointCloud::Create();
+
+	if( !cloud )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "failed to create cudaPointCloud object");
+		return -1;
+	}
+
+	if( maxPoints > 0 && !cloud->Reserve(maxPoints) )
+	{
+		PyErr_SetString(PyExc_MemoryError, LOG_PY_UTILS "cudaPointCloud failed to reserve memory for the points");
+		delete cloud;
+		return -1;
+	}
+
+	self->cloud = cloud;
+	return 0;
+}
+
+
+// Deallocate
+static void PyPointCloud_Dealloc( PyPointCloud_Object* self )
+{
+	LogDebug(LOG_PY_UTILS "PyPointCloud_Dealloc()\n");
+
+	if( self->cloud != NULL )
+	{
+		delete self->cloud;
+		self->cloud = NULL;
+	}
+	
+	// free the container
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+
+// PyPointCloud_Check
+#define PyPointCloud_Check(self)															\
+	if( !self || !self->cloud ) {														\
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaPointCloud invalid object instance");	\
+		return NULL;																	\
+	}
+
+
+// Extract
+static PyObject* PyPointCloud_Extract( PyPointCloud_Object* self, PyObject* args, PyObject* kwds )
+{
+	PyPointCloud_Check(self);
+
+	// parse arguments
+	PyObject* pyDepth = NULL;
+	PyObject* pyColor = NULL;
+
+	float depth_scale = 1.0f;
+	static char* kwlist[] = {"depth", "color", "depth_scale", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O|Of", kwlist, &pyDepth, &pyColor, &depth_scale))
+		return NULL;
+
+	PyCudaImage* depth = PyCUDA_GetImage(pyDepth);
+
+	if( !depth || depth->format != IMAGE_GRAY32F )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaPointCloud.Extract() depth argument should be a gray32f cudaImage");
+		return NULL;
+	}
+
+	if( !PyCUDA_CheckContiguous(depth, "cudaPointCloud.Extract") )
+		return NULL;
+
+	PyCudaImage* color = NULL;
+
+	if( pyColor != NULL && pyColor != Py_None )
+	{
+		color = PyCUDA_GetImage(pyColor);
+
+		if( !color )
+		{
+			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaPointCloud.Extract() color argument should be a cudaImage");
+			return NULL;
+		}
+
+		if( !PyCUDA_CheckContiguous(color, "cudaPointCloud.Extract") )
+			return NULL;
+	}
+
+	// extract the points
+	bool result = false;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = self->cloud->Extract((float*)depth->base.ptr, depth->width, depth->height,
+							color ? color->base.ptr : NULL, color ? color->width : 0, color ? color->height : 0,
+							color ? color->format : IMAGE_UNKNOWN, depth_scale);
+	Py_END_ALLOW_THREADS
+
+	if( !result )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaPointCloud.Extract() failed");
+		return NULL;
+	}
+
+	return PYLONG_FROM_UNSIGNED_LONG(self->cloud->GetNumPoints());
+}
+
+
+// Compact
+static PyObject* PyPointCloud_Compact( PyPointCloud_Object* self )
+{
+	PyPointCloud_Check(self);
+
+	bool result = false;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = self->cloud->Compact();
+	Py_END_ALLOW_THREADS
+
+	if( !result )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaPointCloud.Compact() failed");
+		return NULL;
+	}
+
+	return PYLONG_FROM_UNSIGNED_LONG(self->cloud->GetNumPoints());
+}
+
+
+// Downsample
+static PyObject* PyPointCloud_Downsample( PyPointCloud_Object* self, PyObject* args, PyObject* kwds )
+{
+	PyPointCloud_Check(self);
+
+	float voxelSize = 0.0f;
+	static char* kwlist[] = {"voxelSize", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "f", kwlist, &voxelSize))
+		return NULL;
+
+	bool result = false;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = self->cloud->Downsample(voxelSize);
+	Py_END_ALLOW_THREADS
+
+	if( !result )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaPointCloud.Downsample() failed");
+		return NULL;
+	}
+
+	return PYLONG_FROM_UNSIGNED_LONG(self->cloud->GetNumPoints());
+}
+
+
+// SetCalibration
+static PyObject* PyPointCloud_SetCalibration( PyPointCloud_Object* self, PyObject* args )
+{
+	PyPointCloud_Check(self);
+
+	const Py_ssize_t numArgs = PyTuple_Size(args);
+
+	if( numArgs == 1 && PyUnicode_Check(PyTuple_GetItem(args, 0)) )
+	{
+		const char* filename = PyUnicode_AsUTF8(PyTuple_GetItem(args, 0));
+
+		if( !filename || !self->cloud->SetCalibration(filename) )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaPointCloud.SetCalibration() failed to load the calibration file");
+			return NULL;
+		}
+	}
+	else if( numArgs == 1 )
+	{
+		float K[3][3];
+
+		if( !PyCUDA_ParseMatrix(PyTuple_GetItem(args, 0), &K[0][0], 3, 3, "cudaPointCloud.SetCalibration") )
+			return NULL;
+
+		self->cloud->SetCalibration(K);
+	}
+	else
+	{
+		float2 focalLength;
+		float2 principalPoint;
+
+		if( !PyArg_ParseTuple(args, "(ff)(ff)", &focalLength.x, &focalLength.y, &principalPoint.x, &principalPoint.y) )
+			return NULL;
+
+		self->cloud->SetCalibration(focalLength, principalPoint);
+	}
+
+	Py_RETURN_NONE;
+}
+
+
+// GetPoints
+static PyObject* PyPointCloud_GetPoints( PyPointCloud_Object* self )
+{
+	PyPointCloud_Check(self);
+
+	cudaPointCloud::Vertex* points = NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	points = self->cloud->GetData();
+	Py_END_ALLOW_THREADS
+
+	if( !points )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaPointCloud.GetPoints() called before any points were extracted");
+		return NULL;
+	}
+
+	// the vertex buffer is mapped memory owned by the point cloud, so keep it alive
+	PyCudaMemory* mem = (PyCudaMemory*)PyCUDA_RegisterMemory(points, self->cloud->GetSize(), true, false);
+
+	if( !mem )
+		return NULL;
+
+	mem->tensorDims = 1;
+	mem->tensorShape[0] = self->cloud->GetNumPoints();
+	mem->tensorType = "|V16";
+	mem->tensorDescr = Py_BuildValue("[(ss(i)),(ss(i)),(ss)]", "pos", "<f4", 3, "color", "|u1", 3, "classID", "|u1");
+	mem->owner = (PyObject*)self;
+
+	Py_INCREF(self);
+	return (PyObject*)mem;
+}
+
+
+// parse the file format of a point cloud
+static bool PyPointCloud_ParseFormat( const char* str, cudaPointCloud::FileFormat* format )
+{
+	if( !str || strcasecmp(str, "default") == 0 )
+		*format = cudaPointCloud::FORMAT_DEFAULT;
+	else if( strcasecmp(str, "ascii") == 0 )
+		*format = cudaPointCloud::PCD_ASCII;
+	else if( strcasecmp(str, "binary") == 0 )
+		*format = cudaPointCloud::PCD_BINARY;
+	else if( strcasecmp(str, "binary_compressed") == 0 )
+		*format = cudaPointCloud::PCD_BINARY_COMPRESSED;
+	else if( strcasecmp(str, "ply") == 0 )
+		*format = cudaPointCloud::PLY_BINARY;
+	else
+	{
+		PyErr_Format(PyExc_ValueError, LOG_PY_UTILS "cudaPointCloud.Save() invalid format '%s' (should be 'ascii', 'binary', 'binary_compressed', or 'ply')", str);
+		return false;
+	}
+
+	return true;
+}
+
+
+// Save
+static PyObject* PyPointCloud_Save( PyPointCloud_Object* self, PyObject* args, PyObject* kwds )
+{
+	PyPointCloud_Check(self);
+
+	const char* filename = NULL;
+	const char* formatStr = NULL;
+	int wait = 1;
+
+	static char* kwlist[] = {"filename", "format", "wait", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "s|zp", kwlist, &filename, &formatStr, &wait))
+		return NULL;
+
+	cudaPointCloud::FileFormat format;
+
+	if( !PyPointCloud_ParseFormat(formatStr, &format) )
+		return NULL;
+
+	bool result = false;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = wait ? self->cloud->Save(filename, format) : self->cloud->SaveAsync(filename, format);
+	Py_END_ALLOW_THREADS
+
+	if( !result )
+	{
+		PyErr_Format(PyExc_IOError, LOG_PY_UTILS "cudaPointCloud.Save() failed to save '%s'", filename);
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+
+// WaitSaves
+static PyObject* PyPointCloud_WaitSaves( PyPointCloud_Object* self )
+{
+	PyPointCloud_Check(self);
+
+	Py_BEGIN_ALLOW_THREADS
+	self->cloud->WaitSaves();
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+
+// Render
+static PyObject* PyPointCloud_Render( PyPointCloud_Object* self )
+{
+	PyPointCloud_Check(self);
+
+	bool result = false;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = self->cloud->Render();
+	Py_END_ALLOW_THREADS
+
+	PY_RETURN_BOOL(result);
+}
+
+
+// Clear
+static PyObject* PyPointCloud_Clear( PyPointCloud_Object* self )
+{
+	PyPointCloud_Check(self);
+	self->cloud->Clear();
+	Py_RETURN_NONE;
+}
+
+
+// GetNumPoints
+static PyObject* PyPointCloud_GetNumPoints( PyPointCloud_Object* self )
+{
+	PyPointCloud_Check(self);
+	return PYLONG_FROM_UNSIGNED_LONG(self->cloud->GetNumPoints());
+}
+
+
+// GetMaxPoints
+static PyObject* PyPointCloud_GetMaxPoints( PyPointCloud_Object* self )
+{
+	PyPointCloud_Check(self);
+	return PYLONG_FROM_UNSIGNED_LONG(self->cloud->GetMaxPoints());
+}
+
+
+// HasRGB
+static PyObject* PyPointCloud_HasRGB( PyPointCloud_Object* self )
+{
+	PyPointCloud_Check(self);
+	PY_RETURN_BOOL(self->cloud->HasRGB());
+}
+
+
+static PyTypeObject pyPointCloud_Type = 
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+static PyMethodDef pyPointCloud_Methods[] = 
+{
+	{ "Extract", (PyCFunction)PyPointCloud_Extract, METH_VARARGS|METH_KEYWORDS, "Extract points from a gray32f depth image (and optional color image), returning the number of points"},
+	{ "Compact", (PyCFunction)PyPointCloud_Compact, METH_NOARGS, "Remove the invalid points on the GPU, returning the number of points left"},
+	{ "Downsample", (PyCFunction)PyPointCloud_Downsample, METH_VARARGS|METH_KEYWORDS, "Merge the points that fall in the same voxel, returning the number of points left"},
+	{ "SetCalibration", (PyCFunction)PyPointCloud_SetCalibration, METH_VARARGS, "Set the camera intrinsics from a filename, a 3x3 K matrix, or the (fx,fy) focal length and (cx,cy) principal point"},
+	{ "GetPoints", (PyCFunction)PyPointCloud_GetPoints, METH_NOARGS, "Return the Vertex buffer as cudaMemory with a structured __cuda_array_interface__ (pos, color, classID), valid until capacity changes"},
+	{ "GetNumPoints", (PyCFunction)PyPointCloud_GetNumPoints, METH_NOARGS, "Return the number of points"},
+	{ "GetMaxPoints", (PyCFunction)PyPointCloud_GetMaxPoints, METH_NOARGS, "Return the maximum number of points that are allocated"},
+	{ "HasRGB", (PyCFunction)PyPointCloud_HasRGB, METH_NOARGS, "Return true if the points have color data"},
+	{ "Clear", (PyCFunction)PyPointCloud_Clear, METH_NOARGS, "Remove the points (without freeing the memory)"},
+	{ "Save", (PyCFunction)PyPointCloud_Save, METH_VARARGS|METH_KEYWORDS, "Save the points to a PCD or PLY file (in the background if wait=False)"},
+	{ "WaitSaves", (PyCFunction)PyPointCloud_WaitSaves, METH_NOARGS, "Wait until the files saved with wait=False have been written"},
+	{ "Render", (PyCFunction)PyPointCloud_Render, METH_NOARGS, "Render the points with OpenGL (requires a glDisplay context)"},
+	{NULL}  /* Sentinel */
+};
+
+bool PyPointCloud_RegisterType( PyObject* module )
+{
+	if( !module )
+		return false;
+
+	pyPointCloud_Type.tp_name 	= PY_UTILS_MODULE_NAME ".cudaPointCloud";
+	pyPointCloud_Type.tp_basicsize = sizeof(PyPointCloud_Object);
+	pyPointCloud_Type.tp_flags 	= Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+	pyPointCloud_Type.tp_methods   = pyPointCloud_Methods;
+	pyPointCloud_Type.tp_new 	     = PyPointCloud_New;
+	pyPointCloud_Type.tp_init	     = (initproc)PyPointCloud_Init;
+	pyPointCloud_Type.tp_dealloc	= (destructor)PyPointCloud_Dealloc;
+	pyPointCloud_Type.tp_doc  	= "Point cloud extraction from depth images with CUDA";
+	 
+	if( PyType_Ready(&pyPointCloud_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "cudaPointCloud PyType_Ready() failed\n");
+		return false;
+	}
+	
+	Py_INCREF(&pyPointCloud_Type);
+    
+	if( PyModule_AddObject(module, "cudaPointCloud", (PyObject*)&pyPointCloud_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "cudaPointCloud PyModule_AddObject('cudaPointCloud') failed\n");
+		return false;
+	}
+
+	return true;
+}
+
+
 // PyLog_Usage
 PyObject* PyLog_Usage( PyObject* self )
 {
@@ -2013,16 +4902,26 @@ static PyMethodDef pyCUDA_Functions[] =
 {
 	{ "cudaMalloc", (PyCFunction)PyCUDA_Malloc, METH_VARARGS|METH_KEYWORDS, "Allocated CUDA memory on the GPU with cudaMalloc()" },
 	{ "cudaAllocMapped", (PyCFunction)PyCUDA_AllocMapped, METH_VARARGS|METH_KEYWORDS, "Allocate CUDA ZeroCopy mapped memory" },
-	{ "cudaMemcpy", (PyCFunction)PyCUDA_Memcpy, METH_VARARGS|METH_KEYWORDS, "Copy src image to dst image (or if dst is not provided, return a new image with the contents of src)" },
-	{ "cudaDeviceSynchronize", (PyCFunction)PyCUDA_DeviceSynchronize, METH_NOARGS, "Wait for the GPU to complete all work" },
+	{ "cudaMemcpy", (PyCFunction)PyCUDA_Memcpy, METH_VARARGS|METH_KEYWORDS, "Copy src image to dst image (or if dst is not provided, return a new image with the contents of src), asynchronously if a stream is given" },
+	{ "cudaPoolStats", (PyCFunction)PyCUDA_PoolStats, METH_NOARGS, "Return a dict with the 'mapped' and 'device' memory pool statistics (used/idle/peak bytes and hits/misses)" },
+	{ "cudaPoolTrim", (PyCFunction)PyCUDA_PoolTrim, METH_NOARGS, "Release the idle blocks cached by the memory pools back to the driver" },
+	{ "cudaMemoryUsage", (PyCFunction)PyCUDA_MemoryUsage, METH_NOARGS, "Return a dict with the bytes allocated by each category (mapped, ringbuffer, pool, texture, font), the total, peak and budget" },
+	{ "cudaMemorySetBudget", (PyCFunction)PyCUDA_MemorySetBudget, METH_VARARGS, "Set a budget (in bytes) for the total memory allocated by jetson-utils, or 0 for no budget" },
+	{ "cudaDeviceSynchronize", (PyCFunction)PyCUDA_DeviceSynchronize, METH_NOARGS, "Wait for the GPU to complete all work (use cudaStream.synchronize() to only wait for one stream)" },
 	{ "cudaConvertColor", (PyCFunction)PyCUDA_ConvertColor, METH_VARARGS|METH_KEYWORDS, "Perform colorspace conversion on the GPU" },
 	{ "cudaCrop", (PyCFunction)PyCUDA_Crop, METH_VARARGS|METH_KEYWORDS, "Crop an image on the GPU" },		
 	{ "cudaResize", (PyCFunction)PyCUDA_Resize, METH_VARARGS|METH_KEYWORDS, "Resize an image on the GPU" },
 	{ "cudaNormalize", (PyCFunction)PyCUDA_Normalize, METH_VARARGS|METH_KEYWORDS, "Normalize the pixel intensities of an image between two ranges" },
+	{ "cudaTensorFromImages", (PyCFunction)PyCUDA_TensorFromImages, METH_VARARGS|METH_KEYWORDS, "Resize and normalize a list of images into one NCHW tensor, with a batched kernel" },
 	{ "cudaOverlay", (PyCFunction)PyCUDA_Overlay, METH_VARARGS|METH_KEYWORDS, "Overlay the input image onto the composite output image at position (x,y)" },
 	{ "cudaDrawCircle", (PyCFunction)PyCUDA_DrawCircle, METH_VARARGS|METH_KEYWORDS, "Draw a circle with the specified radius and color centered at position (x,y)" },
 	{ "cudaDrawLine", (PyCFunction)PyCUDA_DrawLine, METH_VARARGS|METH_KEYWORDS, "Draw a line with the specified color and line width from (x1,y1) to (x2,y2)" },
 	{ "cudaDrawRect", (PyCFunction)PyCUDA_DrawRect, METH_VARARGS|METH_KEYWORDS, "Draw a rect with the specified color at (left, top, right, bottom)" },
+	{ "cudaWarpAffine", (PyCFunction)PyCUDA_WarpAffine, METH_VARARGS|METH_KEYWORDS, "Apply a 2x3 affine warp to an rgba8/rgba32f image, returning the output image" },
+	{ "cudaWarpPerspective", (PyCFunction)PyCUDA_WarpPerspective, METH_VARARGS|METH_KEYWORDS, "Apply a 3x3 perspective warp to an image, returning the output image" },
+	{ "cudaWarpIntrinsic", (PyCFunction)PyCUDA_WarpIntrinsic, METH_VARARGS|METH_KEYWORDS, "Apply lens distortion correction from the camera intrinsics, returning the output image" },
+	{ "cudaWarpFisheye", (PyCFunction)PyCUDA_WarpFisheye, METH_VARARGS|METH_KEYWORDS, "Apply fisheye lens dewarping to an rgba8/rgba32f image, returning the output image" },
+	{ "cudaColormap", (PyCFunction)PyCUDA_Colormap, METH_VARARGS|METH_KEYWORDS, "Apply a colormap to a floating-point image over the given (min,max) range, returning the output image" },
 	{ "adaptFontSize", (PyCFunction)PyCUDA_AdaptFontSize, METH_VARARGS, "Determine an appropriate font size for the given image dimension" },
 	{ "logUsage", (PyCFunction)PyLog_Usage, METH_NOARGS, "Return help text describing the command line arguments of the logging interface" },
 	{NULL}  /* Sentinel */
@@ -2046,9 +4945,18 @@ bool PyCUDA_RegisterTypes( PyObject* module )
 	if( !PyCudaImage_RegisterType(module) )
 		return false;
 
+	if( !PyCudaStream_RegisterType(module) )
+		return false;
+
+	if( !PyCudaEvent_RegisterType(module) )
+		return false;
+
 	if( !PyFont_RegisterType(module) )
 		return false;
 
+	if( !PyPointCloud_RegisterType(module) )
+		return false;
+
 	return true;
 }
 
@@ -33,6 +33,11 @@ typedef struct {
 	size_t size;
 	bool mapped;
 	bool freeOnDelete;
+	PyObject* owner;	// keeps memory from another library alive (e.g. an imported DLPack tensor)
+	int tensorDims;		// optional tensor shape for __cuda_array_interface__ (0 for plain bytes)
+	Py_ssize_t tensorShape[4];
+	const char* tensorType;	// numpy typestr of the tensor elements (e.g. "<f4")
+	PyObject* tensorDescr;	// optional field list of structured tensors (e.g. the point cloud vertices)
 } PyCudaMemory;
 
 // PyCudaImage object
@@ -45,8 +50,22 @@ typedef struct {
 	Py_ssize_t  shape[3];
 	Py_ssize_t  strides[3];
 	PyObject*   cudaArrayInterfaceDict;  // https://numba.readthedocs.io/en/stable/cuda/cuda_array_interface.html
+	cudaStream_t stream;	// the stream that last wrote to the image (for __cuda_array_interface__)
 } PyCudaImage;
 
+// PyCudaStream object
+typedef struct {
+	PyObject_HEAD
+	cudaStream_t stream;
+	bool owned;		// destroy the stream when the object is deleted
+} PyCudaStream;
+
+// PyCudaEvent object
+typedef struct {
+	PyObject_HEAD
+	cudaEvent_t event;
+} PyCudaEvent;
+
 // Create memory objects
 PyObject* PyCUDA_RegisterMemory( void* ptr, size_t size, bool mapped=false, bool freeOnDelete=true );
 //PyObject* PyCUDA_RegisterMappedMemory( void* ptr, size_t size, bool freeOnDelete=true );
@@ -55,10 +74,16 @@ PyObject* PyCUDA_RegisterMemory( void* ptr, size_t size, bool mapped=false, bool
 PyObject* PyCUDA_RegisterImage( void* ptr, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp=0, bool mapped=false, bool freeOnDelete=true );
 //PyObject* PyCUDA_RegisterMappedImage( void* ptr, uint32_t width, uint32_t height, imageFormat format, bool freeOnDelete=true );
 
+// Re-point an image that doesn't own its memory at a new buffer (used to recycle image objects)
+bool PyCUDA_UpdateImage( PyObject* image, void* ptr, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp=0, bool mapped=false );
+
 // type checks
 bool PyCUDA_IsMemory( PyObject* object );
 bool PyCUDA_IsImage( PyObject* object );
 
+// check that an image isn't a view with a pitch (otherwise sets the Python exception)
+bool PyCUDA_CheckContiguous( PyCudaImage* image, const char* function );
+
 // cast operators
 PyCudaMemory* PyCUDA_GetMemory( PyObject* object );
 PyCudaImage* PyCUDA_GetImage( PyObject* object );
@@ -66,6 +91,10 @@ PyCudaImage* PyCUDA_GetImage( PyObject* object );
 // retrieve from capsule
 void* PyCUDA_GetImage( PyObject* object, int* width, int* height, imageFormat* format, uint64_t* timestamp=NULL );
 
+// retrieve a stream from None, cudaStream, an int handle, or a PyTorch/CuPy stream object
+// (returns false and sets the Python exception if the object isn't one of those)
+bool PyCUDA_GetStream( PyObject* object, cudaStream_t* stream );
+
 // Register functions
 PyMethodDef* PyCUDA_RegisterFunctions();
 
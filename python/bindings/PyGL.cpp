@@ -115,7 +115,9 @@ static PyObject* PyDisplay_BeginRender( PyDisplay_Object* self, PyObject* args,
 	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &userEvents))
 		return NULL;
 
+	Py_BEGIN_ALLOW_THREADS
 	self->display->BeginRender( userEvents > 0 ? true : false );
+	Py_END_ALLOW_THREADS
 	Py_RETURN_NONE; 
 }
 
@@ -129,7 +131,9 @@ static PyObject* PyDisplay_EndRender( PyDisplay_Object* self )
 		return NULL;
 	}
 
+	Py_BEGIN_ALLOW_THREADS
 	self->display->EndRender();
+	Py_END_ALLOW_THREADS
 	Py_RETURN_NONE; 
 }
 
@@ -169,7 +173,9 @@ static PyObject* PyDisplay_Render( PyDisplay_Object* self, PyObject* args, PyObj
 		return NULL;
 
 	// render the image
+	Py_BEGIN_ALLOW_THREADS
 	self->display->RenderImage(ptr, width, height, format, x, y, norm > 0 ? true : false);
+	Py_END_ALLOW_THREADS
 
 	// return void
 	Py_RETURN_NONE;
@@ -211,7 +217,9 @@ static PyObject* PyDisplay_RenderOnce( PyDisplay_Object* self, PyObject* args, P
 		return NULL;
 
 	// render the image
+	Py_BEGIN_ALLOW_THREADS
 	self->display->RenderOnce(ptr, width, height, format, x, y, norm > 0 ? true : false);
+	Py_END_ALLOW_THREADS
 
 	// return void
 	Py_RETURN_NONE;
@@ -401,7 +409,9 @@ static PyObject* PyDisplay_ProcessEvents( PyDisplay_Object* self )
 		return NULL;
 	}
 
+	Py_BEGIN_ALLOW_THREADS
 	self->display->ProcessEvents();
+	Py_END_ALLOW_THREADS
 	Py_RETURN_NONE; 
 }
 
@@ -152,6 +152,9 @@ PyObject* PyImageIO_Save( PyObject* self, PyObject* args, PyObject* kwds )
 		return NULL;
 	}
 
+	if( !PyCUDA_CheckContiguous(img, "saveImage") )
+		return NULL;
+
 	if( !img->base.mapped )
 	{
 		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "saveImage() needs to be passed a cudaImage that was allocated in mapped/zeroCopy memory");
@@ -194,6 +197,9 @@ PyObject* PyImageIO_SaveRGBA( PyObject* self, PyObject* args, PyObject* kwds )
 
 	if( img != NULL )
 	{
+		if( !PyCUDA_CheckContiguous(img, "saveImageRGBA") )
+			return NULL;
+
 		if( !img->base.mapped )
 		{
 			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "saveImageRGBA() needs to be passed a cudaImage that was allocated in mapped/zeroCopy memory");
@@ -166,6 +166,39 @@ static PyObject* PyLogging_SetFilename( PyObject* cls, PyObject* args )
 }
 
 
+// SetAsync()
+static PyObject* PyLogging_SetAsync( PyObject* cls, PyObject* args )
+{
+	// parse arguments
+	int async = 1;
+
+	if( !PyArg_ParseTuple(args, "|i", &async) )
+		return NULL;
+
+	Log::SetAsync(async > 0);
+	
+	Py_RETURN_NONE;
+}
+
+
+// IsAsync()
+static PyObject* PyLogging_IsAsync( PyObject* cls )
+{
+	PY_RETURN_BOOL(Log::IsAsync());
+}
+
+
+// Flush()
+static PyObject* PyLogging_Flush( PyObject* cls )
+{
+	Py_BEGIN_ALLOW_THREADS
+	Log::Flush();
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+
 // Usage
 static PyObject* PyLogging_Usage( PyObject* cls )
 {
@@ -192,6 +225,9 @@ static PyMethodDef pyLogging_Methods[] =
 	{ "SetLevel", (PyCFunction)PyLogging_SetLevel, METH_VARARGS | METH_CLASS, "Set the current logging level (as a string)"},
 	{ "GetFilename", (PyCFunction)PyLogging_GetFilename, METH_NOARGS | METH_CLASS, "Get the current logging level (as a string)"},
 	{ "SetFilename", (PyCFunction)PyLogging_SetFilename, METH_VARARGS | METH_CLASS, "Set the current logging level (as a string)"},
+	{ "SetAsync", (PyCFunction)PyLogging_SetAsync, METH_VARARGS | METH_CLASS, "Enable or disable writing the log from a background thread"},
+	{ "IsAsync", (PyCFunction)PyLogging_IsAsync, METH_NOARGS | METH_CLASS, "Return true if asynchronous logging is enabled"},
+	{ "Flush", (PyCFunction)PyLogging_Flush, METH_NOARGS | METH_CLASS, "Wait for the queued log messages to be written"},
 	{ "Usage", (PyCFunction)PyLogging_Usage, METH_NOARGS | METH_CLASS, "Get the command-line usage string"},
 	{NULL}  /* Sentinel */
 };
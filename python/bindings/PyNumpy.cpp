@@ -24,6 +24,7 @@
 #include "PyCUDA.h"
 
 #include "cudaMappedMemory.h"
+#include "cudaMemoryPool.h"
 #include "logging.h"
 
 #ifdef HAS_NUMPY
@@ -42,8 +43,12 @@ static int PyNumpy_ConvertFormat( imageFormat format )
 
 	if( baseType == IMAGE_FLOAT )
 		return NPY_FLOAT32;
+	else if( baseType == IMAGE_HALF )
+		return NPY_FLOAT16;
 	else if( baseType == IMAGE_UINT8 )
 		return NPY_UINT8;
+	else if( baseType == IMAGE_UINT16 )
+		return NPY_UINT16;
 
 	return NPY_VOID;
 }
@@ -77,6 +82,7 @@ PyObject* PyNumpy_FromCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 	void* src = NULL;
 	int type = NPY_FLOAT32;	// float is assumed for PyCudaMemory case, but inferred for PyCudaImage case
 	bool mapped = false;
+	npy_intp* strides = NULL;	// views of an image keep its pitch
 	
 	if( !img )
 	{
@@ -110,6 +116,7 @@ PyObject* PyNumpy_FromCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 			height = img->height;
 			depth  = imageFormatChannels(img->format);
 			type   = PyNumpy_ConvertFormat(img->format);
+			strides = (npy_intp*)img->strides;
 		}
 	}
 	
@@ -123,7 +130,7 @@ PyObject* PyNumpy_FromCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 	npy_intp dims[] = { height, width, depth };
 
 	// create numpy array
-	PyObject* array = PyArray_SimpleNewFromData(3, dims, type, src);
+	PyObject* array = PyArray_New(&PyArray_Type, 3, dims, type, strides, src, 0, NPY_ARRAY_CARRAY, NULL);
 
 	if( !array )
 	{
@@ -141,16 +148,91 @@ PyObject* PyNumpy_FromCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 }
 
 
+// PyNumpy_UnregisterHost (capsule destructor for zeroCopy arrays)
+static void PyNumpy_UnregisterHost( PyObject* capsule )
+{
+	void* ptr = PyCapsule_GetPointer(capsule, PY_UTILS_MODULE_NAME ".numpy");
+	PyObject* array = (PyObject*)PyCapsule_GetContext(capsule);
+
+	if( ptr != NULL )
+		CUDA(cudaHostUnregister(ptr));
+
+	Py_XDECREF(array);
+}
+
+
+// PyNumpy_RegisterHost (map an existing numpy buffer into the GPU's address space)
+static void* PyNumpy_RegisterHost( PyArrayObject* array, size_t size, PyObject** owner )
+{
+	void* cpuPtr = PyArray_DATA(array);
+	void* gpuPtr = NULL;
+
+	*owner = NULL;
+
+	if( !PyArray_ISWRITEABLE(array) )
+	{
+		LogVerbose(LOG_PY_UTILS "cudaFromNumpy() ndarray is read-only, falling back to copying it (zeroCopy=True)\n");
+		return NULL;
+	}
+
+	const cudaError_t result = cudaHostRegister(cpuPtr, size, cudaHostRegisterMapped);
+
+	if( result == cudaErrorHostMemoryAlreadyRegistered )
+	{
+		// the buffer is already pinned (e.g. an ndarray from cudaToNumpy()),
+		// so it just needs the device pointer, and isn't unregistered later
+		cudaGetLastError();
+
+		if( CUDA_FAILED(cudaHostGetDevicePointer(&gpuPtr, cpuPtr, 0)) )
+			return NULL;
+
+		*owner = (PyObject*)array;
+		Py_INCREF(array);
+		return gpuPtr;
+	}
+	else if( result != cudaSuccess )
+	{
+		cudaGetLastError();
+		LogVerbose(LOG_PY_UTILS "cudaFromNumpy() failed to register ndarray with cudaHostRegister() (error %i), falling back to copying it\n", (int)result);
+		return NULL;
+	}
+
+	if( CUDA_FAILED(cudaHostGetDevicePointer(&gpuPtr, cpuPtr, 0)) )
+	{
+		CUDA(cudaHostUnregister(cpuPtr));
+		return NULL;
+	}
+
+	// the capsule keeps the ndarray alive, and unregisters it when the image is deleted
+	PyObject* capsule = PyCapsule_New(cpuPtr, PY_UTILS_MODULE_NAME ".numpy", PyNumpy_UnregisterHost);
+
+	if( !capsule )
+	{
+		PyErr_Clear();
+		CUDA(cudaHostUnregister(cpuPtr));
+		return NULL;
+	}
+
+	Py_INCREF(array);
+	PyCapsule_SetContext(capsule, array);
+
+	*owner = capsule;
+	return gpuPtr;
+}
+
+
 // cudaFromNumpy()
 PyObject* PyNumpy_ToCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 {
 	PyObject* object = NULL;
+	PyObject* pyOutput = NULL;
 
 	int pyBGR=0;
-	static char* kwlist[] = {"array", "isBGR", "timestamp", NULL};
+	int pyZeroCopy=0;
+	static char* kwlist[] = {"array", "isBGR", "timestamp", "zeroCopy", "out", NULL};
 	long long timestamp = 0;
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O|iL", kwlist, &object, &pyBGR, &timestamp) )
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "O|iLiO", kwlist, &object, &pyBGR, &timestamp, &pyZeroCopy, &pyOutput) )
 		return NULL;
 
 	if( !PyArray_Check(object) )
@@ -165,6 +247,21 @@ PyObject* PyNumpy_ToCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 		return NULL;
 	}
 
+	if( pyOutput == Py_None )
+		pyOutput = NULL;
+
+	if( pyOutput != NULL && !PyCUDA_IsMemory(pyOutput) )
+	{
+		PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "cudaFromNumpy() out argument should be a cudaImage or cudaMemory object");
+		return NULL;
+	}
+
+	if( pyOutput != NULL && pyZeroCopy > 0 )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaFromNumpy() zeroCopy and out arguments can't be used together");
+		return NULL;
+	}
+
 	const bool isBGR = (pyBGR > 0);
 
 	// detect uint8 array - otherwise cast to float
@@ -178,7 +275,7 @@ PyObject* PyNumpy_ToCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 		typeSize = sizeof(uint8_t);
 	}
 	
-	// cast to numpy array
+	// cast to numpy array (this returns the same object if no cast/copy was needed)
 	PyArrayObject* array = (PyArrayObject*)PyArray_FROM_OTF(object, outputType, NPY_ARRAY_IN_ARRAY|NPY_ARRAY_FORCECAST);
 
 	if( !array )
@@ -219,17 +316,6 @@ PyObject* PyNumpy_ToCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 		return NULL;
 	}
 
-	// allocate CUDA memory for the array
-	void* cpuPtr = NULL;
-	void* gpuPtr = NULL;
-
-	if( !cudaAllocMapped(&cpuPtr, &gpuPtr, size) )
-	{
-		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMapped() failed");
-		Py_DECREF(array);
-		return NULL;
-	}	
-
 	// detect the image format
 	imageFormat format = IMAGE_UNKNOWN;
 
@@ -266,6 +352,107 @@ PyObject* PyNumpy_ToCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 		}
 	}
 
+	// copy into the caller's existing buffer
+	if( pyOutput != NULL )
+	{
+		PyCudaMemory* output = PyCUDA_GetMemory(pyOutput);
+
+		if( !PyCUDA_CheckContiguous(PyCUDA_GetImage(pyOutput), "cudaFromNumpy") )
+		{
+			Py_DECREF(array);
+			return NULL;
+		}
+
+		if( output->size != size )
+		{
+			PyErr_Format(PyExc_Exception, LOG_PY_UTILS "cudaFromNumpy() out buffer has size of %zu bytes, but the ndarray is %zu bytes", output->size, size);
+			Py_DECREF(array);
+			return NULL;
+		}
+
+		if( PyCUDA_IsImage(pyOutput) )
+		{
+			PyCudaImage* image = PyCUDA_GetImage(pyOutput);
+
+			if( format != IMAGE_UNKNOWN && (image->format != format || image->width != dims[1] || image->height != dims[0]) )
+			{
+				PyErr_Format(PyExc_Exception, LOG_PY_UTILS "cudaFromNumpy() out image (%ux%u %s) doesn't match the ndarray (%lix%li %s)",
+						   image->width, image->height, imageFormatToStr(image->format), dims[1], dims[0], imageFormatToStr(format));
+				Py_DECREF(array);
+				return NULL;
+			}
+
+			image->timestamp = timestamp;
+		}
+
+		cudaError_t result = cudaSuccess;
+
+		Py_BEGIN_ALLOW_THREADS
+
+		if( output->mapped )
+			memcpy(output->ptr, arrayPtr, size);
+		else
+			result = CUDA(cudaMemcpy(output->ptr, arrayPtr, size, cudaMemcpyHostToDevice));
+
+		Py_END_ALLOW_THREADS
+
+		if( result != cudaSuccess )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaFromNumpy() failed to copy the ndarray to the out buffer");
+			Py_DECREF(array);
+			return NULL;
+		}
+
+		Py_DECREF(array);
+		Py_INCREF(pyOutput);
+		return pyOutput;
+	}
+
+	// wrap the ndarray's own buffer, if it wasn't cast or made contiguous
+	PyObject* owner = NULL;
+	void* gpuPtr = NULL;
+
+	if( pyZeroCopy > 0 )
+	{
+		if( (PyObject*)array == object )
+		{
+			gpuPtr = PyNumpy_RegisterHost(array, size, &owner);
+		}
+		else
+		{
+			LogVerbose(LOG_PY_UTILS "cudaFromNumpy() ndarray needed to be cast or made contiguous, falling back to copying it (zeroCopy=True)\n");
+		}
+	}
+
+	if( gpuPtr != NULL )
+	{
+		PyObject* capsule = NULL;
+
+		if( format != IMAGE_UNKNOWN )	
+			capsule = PyCUDA_RegisterImage(gpuPtr, dims[1], dims[0], format, timestamp, true, false);
+		else
+			capsule = PyCUDA_RegisterMemory(gpuPtr, size, true, false);
+
+		if( !capsule )
+		{
+			Py_DECREF(owner);
+			Py_DECREF(array);
+			return NULL;
+		}
+
+		PyCUDA_GetMemory(capsule)->owner = owner;
+		Py_DECREF(array);
+		return capsule;
+	}
+
+	// allocate CUDA memory for the array (mapped memory has the same CPU/GPU address)
+	if( !cudaAllocMappedPooled(&gpuPtr, size) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "cudaAllocMappedPooled() failed");
+		Py_DECREF(array);
+		return NULL;
+	}	
+
 	// register CUDA memory capsule
 	PyObject* capsule = NULL;
 
@@ -281,7 +468,9 @@ PyObject* PyNumpy_ToCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 	}
 
 	// copy array into CUDA memory
-	memcpy(cpuPtr, arrayPtr, size);
+	Py_BEGIN_ALLOW_THREADS
+	memcpy(gpuPtr, arrayPtr, size);
+	Py_END_ALLOW_THREADS
 
 	// return capsule container
 	Py_DECREF(array);
@@ -294,7 +483,7 @@ PyObject* PyNumpy_ToCUDA( PyObject* self, PyObject* args, PyObject* kwds )
 
 static PyMethodDef pyImageIO_Functions[] = 
 {
-	{ "cudaFromNumpy", (PyCFunction)PyNumpy_ToCUDA, METH_VARARGS|METH_KEYWORDS, "Copy a numpy ndarray to CUDA memory" },
+	{ "cudaFromNumpy", (PyCFunction)PyNumpy_ToCUDA, METH_VARARGS|METH_KEYWORDS, "Copy a numpy ndarray to CUDA memory (or map it without copying with zeroCopy=True, or copy into an existing image with out=img)" },
 	{ "cudaToNumpy", (PyCFunction)PyNumpy_FromCUDA, METH_VARARGS|METH_KEYWORDS, "Create a numpy ndarray wrapping the CUDA memory, without copying it" },	
 	{NULL}  /* Sentinel */
 };
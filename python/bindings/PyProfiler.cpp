@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+ 
+
+#include "PyProfiler.h"
+#include "profiler.h"
+#include "logging.h"
+
+
+// PyProfiler container
+typedef struct {
+    PyObject_HEAD
+} PyProfiler_Object;
+
+
+
+// SetEnabled()
+static PyObject* PyProfiler_SetEnabled( PyObject* cls, PyObject* args )
+{
+	// parse arguments
+	int enabled = 1;
+
+	if( !PyArg_ParseTuple(args, "|i", &enabled) )
+		return NULL;
+
+	Profiler::SetEnabled(enabled > 0);
+	
+	Py_RETURN_NONE;
+}
+
+
+// IsEnabled()
+static PyObject* PyProfiler_IsEnabled( PyObject* cls )
+{
+	PY_RETURN_BOOL(Profiler::IsEnabled());
+}
+
+
+// PyProfiler_StatsToDict
+static PyObject* PyProfiler_StatsToDict( const profilerStats& stats )
+{
+	PyObject* dict = PyDict_New();
+
+	PYDICT_SET_ITEM(dict, "count", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.count));
+	PYDICT_SET_FLOAT(dict, "min", stats.min);
+	PYDICT_SET_FLOAT(dict, "max", stats.max);
+	PYDICT_SET_FLOAT(dict, "avg", stats.avg);
+	PYDICT_SET_FLOAT(dict, "p99", stats.p99);
+	PYDICT_SET_FLOAT(dict, "last", stats.last);
+
+	return dict;
+}
+
+
+// GetStats()
+static PyObject* PyProfiler_GetStats( PyObject* cls, PyObject* args )
+{
+	// parse arguments
+	const char* stage = NULL;
+
+	if( !PyArg_ParseTuple(args, "|s", &stage) )
+		return NULL;
+
+	// return the stats of all stages if one wasn't specified
+	std::vector<std::string> stages;
+
+	if( stage != NULL )
+		stages.push_back(stage);
+	else
+		stages = Profiler::GetStages();
+
+	PyObject* dict = PyDict_New();
+
+	for( size_t n=0; n < stages.size(); n++ )
+	{
+		profilerStats cpu;
+		profilerStats gpu;
+
+		if( !Profiler::GetStats(stages[n].c_str(), &cpu, &gpu) )
+		{
+			if( stage != NULL )
+			{
+				Py_DECREF(dict);
+				PyErr_Format(PyExc_KeyError, LOG_PY_UTILS "Profiler.GetStats() -- stage '%s' hasn't been recorded", stage);
+				return NULL;
+			}
+
+			continue;
+		}
+
+		PyObject* stageDict = PyDict_New();
+
+		PYDICT_SET_ITEM(stageDict, "cpu", PyProfiler_StatsToDict(cpu));
+		PYDICT_SET_ITEM(stageDict, "gpu", PyProfiler_StatsToDict(gpu));
+
+		if( stage != NULL )
+		{
+			Py_DECREF(dict);
+			return stageDict;
+		}
+
+		PYDICT_SET_ITEM(dict, stages[n].c_str(), stageDict);
+	}
+
+	return dict;
+}
+
+
+// GetStages()
+static PyObject* PyProfiler_GetStages( PyObject* cls )
+{
+	const std::vector<std::string> stages = Profiler::GetStages();
+
+	PyObject* list = PyList_New(stages.size());
+
+	for( size_t n=0; n < stages.size(); n++ )
+		PyList_SET_ITEM(list, n, PYSTRING_FROM_STRING(stages[n].c_str()));
+
+	return list;
+}
+
+
+// Print()
+static PyObject* PyProfiler_Print( PyObject* cls )
+{
+	Profiler::Print();
+	Py_RETURN_NONE;
+}
+
+
+// SaveCSV()
+static PyObject* PyProfiler_SaveCSV( PyObject* cls, PyObject* args )
+{
+	// parse arguments
+	const char* filename = NULL;
+
+	if( !PyArg_ParseTuple(args, "s", &filename) )
+		return NULL;
+
+	if( !Profiler::SaveCSV(filename) )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "Profiler.SaveCSV() failed to save the file");
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+
+// Reset()
+static PyObject* PyProfiler_Reset( PyObject* cls )
+{
+	Profiler::Reset();
+	Py_RETURN_NONE;
+}
+
+
+
+//-------------------------------------------------------------------------------
+static PyTypeObject pyProfiler_Type = 
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+static PyMethodDef pyProfiler_Methods[] = 
+{
+	{ "SetEnabled", (PyCFunction)PyProfiler_SetEnabled, METH_VARARGS | METH_CLASS, "Enable or disable the profiler"},
+	{ "IsEnabled", (PyCFunction)PyProfiler_IsEnabled, METH_NOARGS | METH_CLASS, "Return true if the profiler is enabled"},
+	{ "GetStats", (PyCFunction)PyProfiler_GetStats, METH_VARARGS | METH_CLASS, "Get a dict with the 'cpu' and 'gpu' timing statistics of a stage (or of every stage, keyed by name)"},
+	{ "GetStages", (PyCFunction)PyProfiler_GetStages, METH_NOARGS | METH_CLASS, "Get a list of the names of the recorded stages"},
+	{ "Print", (PyCFunction)PyProfiler_Print, METH_NOARGS | METH_CLASS, "Log a table of the timing statistics"},
+	{ "SaveCSV", (PyCFunction)PyProfiler_SaveCSV, METH_VARARGS | METH_CLASS, "Save the timing statistics to a CSV file"},
+	{ "Reset", (PyCFunction)PyProfiler_Reset, METH_NOARGS | METH_CLASS, "Clear the timing statistics"},
+	{NULL}  /* Sentinel */
+};
+
+// Register types
+bool PyProfiler_RegisterTypes( PyObject* module )
+{
+	if( !module )
+		return false;
+
+	pyProfiler_Type.tp_name 	    = PY_UTILS_MODULE_NAME ".Profiler";
+	pyProfiler_Type.tp_basicsize = sizeof(PyProfiler_Object);
+	pyProfiler_Type.tp_flags 	    = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+	pyProfiler_Type.tp_methods   = pyProfiler_Methods;
+	pyProfiler_Type.tp_doc  	    = "Per-stage CPU/GPU timing profiler";
+	 
+	if( PyType_Ready(&pyProfiler_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "Profiler PyType_Ready() failed\n");
+		return false;
+	}
+	
+	Py_INCREF(&pyProfiler_Type);
+    
+	if( PyModule_AddObject(module, "Profiler", (PyObject*)&pyProfiler_Type) < 0 )
+	{
+		LogError(LOG_PY_UTILS "Profiler PyModule_AddObject('Profiler') failed\n");
+		return false;
+	}
+
+	return true;
+}
+
+static PyMethodDef pyProfiler_Functions[] = 
+{
+	{NULL}  /* Sentinel */
+};
+
+// Register functions
+PyMethodDef* PyProfiler_RegisterFunctions()
+{
+	return pyProfiler_Functions;
+}
+
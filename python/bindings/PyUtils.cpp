@@ -29,6 +29,7 @@
 #include "PyImageIO.h"
 #include "PyNumpy.h"
 #include "PyLogging.h"
+#include "PyProfiler.h"
 
 #include "logging.h"
 
@@ -82,6 +83,7 @@ bool PyUtils_RegisterFunctions()
 	PyUtils_AddFunctions(PyImageIO_RegisterFunctions());
 	PyUtils_AddFunctions(PyNumpy_RegisterFunctions());
 	PyUtils_AddFunctions(PyLogging_RegisterFunctions());
+	PyUtils_AddFunctions(PyProfiler_RegisterFunctions());
 	
 	LogDebug(LOG_PY_UTILS "done registering module functions\n");
 	return true;
@@ -113,6 +115,9 @@ bool PyUtils_RegisterTypes( PyObject* module )
 
 	if( !PyLogging_RegisterTypes(module) )
 		LogError(LOG_PY_UTILS "failed to register Logging types\n");
+
+	if( !PyProfiler_RegisterTypes(module) )
+		LogError(LOG_PY_UTILS "failed to register Profiler types\n");
 	
 	LogDebug(LOG_PY_UTILS "done registering module types\n");
 	return true;
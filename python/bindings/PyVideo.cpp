@@ -26,13 +26,43 @@
 #include "videoSource.h"
 #include "videoOutput.h"
 
+#include "cudaMemoryPool.h"
 #include "logging.h"
+#include "Mutex.h"
 
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+
+// number of cudaImage objects that Capture() recycles
+#define PY_VIDEO_SOURCE_POOL 4
+
+// a frame that was pushed from the stream's thread, waiting to be picked up by Python
+typedef struct {
+    void*       ptr;
+    uint32_t    width;
+    uint32_t    height;
+    imageFormat format;
+    uint64_t    timestamp;
+} PyVideoSource_Frame;
 
 // object containers
 typedef struct {
     PyObject_HEAD
     videoSource* source;
+    PyObject* pool[PY_VIDEO_SOURCE_POOL];	// images returned by Capture() that are re-used once released
+
+    // push-based delivery for iterators and asyncio (see PyVideoSource_EnableEvents())
+    int eventFD;						// eventfd that gets signalled when a frame is queued
+    Mutex* queueMutex;					// protects the queue (the stream's thread pushes to it)
+    PyVideoSource_Frame queue[PY_VIDEO_SOURCE_POOL];
+    uint32_t queueHead;
+    uint32_t queueCount;
+
+    PyObject* loop;						// the asyncio event loop that's waiting on eventFD
+    PyObject* pending;					// the future returned by __anext__()
+    PyObject* timer;					// periodic check for the end of the stream
 } PyVideoSource_Object;
 
 typedef struct {
@@ -68,18 +98,33 @@ static PyObject* PyVideoOptions_ToDict( const videoOptions& options )
 	PYDICT_SET_UINT(dict, "height", options.height);
 	PYDICT_SET_FLOAT(dict, "frameRate", options.frameRate);
 	PYDICT_SET_STRING(dict, "codec", videoOptions::CodecToStr(options.codec));
+	PYDICT_SET_STRING(dict, "converter", videoOptions::ConverterToStr(options.converter));
 	
 	if( options.ioType == videoOptions::OUTPUT )
+	{
 		PYDICT_SET_UINT(dict, "bitRate", options.bitRate);
+		PYDICT_SET_UINT(dict, "writeThreads", options.writeThreads);
+		PYDICT_SET_UINT(dict, "writeQueueSize", options.writeQueueSize);
+		PYDICT_SET_BOOL(dict, "writeDropFrames", options.writeDropFrames);
+		PYDICT_SET_BOOL(dict, "dedupFrames", options.dedupFrames);
+		PYDICT_SET_UINT(dict, "dedupDistance", options.dedupDistance);
+		PYDICT_SET_UINT(dict, "intraRefresh", options.intraRefresh);
+		PYDICT_SET_BOOL(dict, "multicast", options.multicast);
+	}
 	
 	if( options.ioType == videoOptions::INPUT )
 	{
 		PYDICT_SET_INT(dict, "loop", options.loop);
+		PYDICT_SET_UINT(dict, "decodeThreads", options.decodeThreads);
+		PYDICT_SET_BOOL(dict, "streamFiles", options.streamFiles);
 		PYDICT_SET_STRING(dict, "flipMethod", videoOptions::FlipMethodToStr(options.flipMethod));
+		PYDICT_SET_STRING(dict, "memory", videoOptions::MemoryToStr(options.memory));
 	}
 
+	PYDICT_SET_BOOL(dict, "lowLatency", options.lowLatency);
 	PYDICT_SET_UINT(dict, "numBuffers", options.numBuffers);
 	PYDICT_SET_BOOL(dict, "zeroCopy", options.zeroCopy);
+	PYDICT_SET_INT(dict, "cudaDevice", options.cudaDevice);
 	
 	PYDICT_SET_STRING(dict, "deviceType", videoOptions::DeviceTypeToStr(options.deviceType));
 	PYDICT_SET_STRING(dict, "ioType", videoOptions::IoTypeToStr(options.ioType));
@@ -113,6 +158,19 @@ static PyObject* PyVideoSource_New( PyTypeObject *type, PyObject *args, PyObject
 	}
 	
     self->source = NULL;
+
+    for( int n=0; n < PY_VIDEO_SOURCE_POOL; n++ )
+        self->pool[n] = NULL;
+
+    self->eventFD = -1;
+    self->queueMutex = new Mutex();
+    self->queueHead = 0;
+    self->queueCount = 0;
+
+    self->loop = NULL;
+    self->pending = NULL;
+    self->timer = NULL;
+
     return (PyObject*)self;
 }
 
@@ -198,7 +256,15 @@ static void PyVideoSource_Dealloc( PyVideoSource_Object* self )
 {
 	LogDebug(LOG_PY_UTILS "PyVideoSource_Dealloc()\n");
 
-	// free the network
+	// release the recycled images (they don't own the memory)
+	for( int n=0; n < PY_VIDEO_SOURCE_POOL; n++ )
+		Py_CLEAR(self->pool[n]);
+
+	Py_CLEAR(self->timer);
+	Py_CLEAR(self->pending);
+	Py_CLEAR(self->loop);
+
+	// free the network (this stops the thread that pushes frames to the queue)
 	Py_BEGIN_ALLOW_THREADS
 	
 	if( self->source != NULL )
@@ -208,6 +274,22 @@ static void PyVideoSource_Dealloc( PyVideoSource_Object* self )
 	}
 	
 	Py_END_ALLOW_THREADS
+
+	// release the frames that were never picked up
+	for( uint32_t n=0; n < self->queueCount; n++ )
+		cudaFreePooled(self->queue[(self->queueHead + n) % PY_VIDEO_SOURCE_POOL].ptr);
+
+	if( self->eventFD >= 0 )
+	{
+		close(self->eventFD);
+		self->eventFD = -1;
+	}
+
+	if( self->queueMutex != NULL )
+	{
+		delete self->queueMutex;
+		self->queueMutex = NULL;
+	}
 	
 	// free the container
 	Py_TYPE(self)->tp_free((PyObject*)self);
@@ -262,11 +344,28 @@ static PyObject* PyVideoSource_Capture( PyVideoSource_Object* self, PyObject* ar
 	// parse arguments
 	const char* pyFormat = "rgb8";
 	int pyTimeout = videoSource::DEFAULT_TIMEOUT;
-	static char* kwlist[] = {"format", "timeout", NULL};
+	PyObject* pyOutput = NULL;
+	static char* kwlist[] = {"format", "timeout", "out", NULL};
 
-	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|si", kwlist, &pyFormat, &pyTimeout))
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|siO", kwlist, &pyFormat, &pyTimeout, &pyOutput))
 		return NULL;
 
+	PyCudaImage* output = NULL;
+
+	if( pyOutput != NULL && pyOutput != Py_None )
+	{
+		output = PyCUDA_GetImage(pyOutput);
+
+		if( !output )
+		{
+			PyErr_SetString(PyExc_TypeError, LOG_PY_UTILS "videoSource.Capture() out argument should be a cudaImage");
+			return NULL;
+		}
+
+		if( !PyCUDA_CheckContiguous(output, "videoSource.Capture") )
+			return NULL;
+	}
+
 	// convert signed timeout to unsigned long
 	uint64_t timeout = videoSource::DEFAULT_TIMEOUT;
 
@@ -293,16 +392,548 @@ static PyObject* PyVideoSource_Capture( PyVideoSource_Object* self, PyObject* ar
 	}
 
 	// expect raw image if conversion format is unknown
-	if (format == IMAGE_UNKNOWN)
+	const imageFormat imgFormat = (format == IMAGE_UNKNOWN) ? self->source->GetRawFormat() : format;
+
+	const uint32_t width = self->source->GetWidth();
+	const uint32_t height = self->source->GetHeight();
+	const uint64_t timestamp = self->source->GetLastTimestamp();
+	const bool mapped = self->source->GetOptions().zeroCopy;
+
+	// copy into the caller's image, so it stays valid after the ring buffer wraps around
+	if( output != NULL )
 	{
-		// register memory capsule (videoSource will free the underlying memory when source is deleted)
-		return PyCUDA_RegisterImage(ptr, self->source->GetWidth(), self->source->GetHeight(), self->source->GetRawFormat(), self->source->GetLastTimestamp(), self->source->GetOptions().zeroCopy, false);
+		if( output->width != width || output->height != height || output->format != imgFormat )
+		{
+			PyErr_Format(PyExc_Exception, LOG_PY_UTILS "videoSource.Capture() out image (%ux%u %s) doesn't match the captured frame (%ux%u %s)",
+					   output->width, output->height, imageFormatToStr(output->format), width, height, imageFormatToStr(imgFormat));
+			return NULL;
+		}
+
+		cudaError_t copyResult = cudaSuccess;
+
+		Py_BEGIN_ALLOW_THREADS
+		copyResult = cudaMemcpy(output->base.ptr, ptr, imageFormatSize(imgFormat, width, height), cudaMemcpyDeviceToDevice);
+		Py_END_ALLOW_THREADS
+
+		if( CUDA_FAILED(copyResult) )
+		{
+			PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "videoSource.Capture() failed to copy the frame into the out image");
+			return NULL;
+		}
+
+		output->timestamp = timestamp;
+		output->stream = NULL;
+
+		Py_INCREF(pyOutput);
+		return pyOutput;
+	}
+
+	// re-use an image from the pool that the caller has already released
+	for( int n=0; n < PY_VIDEO_SOURCE_POOL; n++ )
+	{
+		if( self->pool[n] != NULL && Py_REFCNT(self->pool[n]) == 1 )
+		{
+			if( !PyCUDA_UpdateImage(self->pool[n], ptr, width, height, imgFormat, timestamp, mapped) )
+				return NULL;
+
+			Py_INCREF(self->pool[n]);
+			return self->pool[n];
+		}
 	}
 
 	// register memory capsule (videoSource will free the underlying memory when source is deleted)
-	return PyCUDA_RegisterImage(ptr, self->source->GetWidth(), self->source->GetHeight(), format, self->source->GetLastTimestamp(), self->source->GetOptions().zeroCopy, false);
+	PyObject* image = PyCUDA_RegisterImage(ptr, width, height, imgFormat, timestamp, mapped, false);
+
+	if( !image )
+		return NULL;
+
+	// keep a reference to it in the pool if there's space
+	for( int n=0; n < PY_VIDEO_SOURCE_POOL; n++ )
+	{
+		if( self->pool[n] == NULL )
+		{
+			Py_INCREF(image);
+			self->pool[n] = image;
+			break;
+		}
+	}
+
+	return image;
+}
+
+
+// PyVideoSource_OnFrame (called from the stream's own thread, without the GIL)
+static void PyVideoSource_OnFrame( videoSource* source, void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, void* user )
+{
+	PyVideoSource_Object* self = (PyVideoSource_Object*)user;
+
+	// the frame is only valid until the callback returns, so copy it into pooled memory
+	const size_t size = imageFormatSize(format, width, height);
+	void* ptr = NULL;
+
+	if( source->GetOptions().zeroCopy ? !cudaAllocMappedPooled(&ptr, size) : !cudaMallocPooled(&ptr, size) )
+	{
+		LogError(LOG_PY_UTILS "videoSource failed to allocate memory for pushed frame\n");
+		return;
+	}
+
+	if( CUDA_FAILED(cudaMemcpy(ptr, image, size, cudaMemcpyDeviceToDevice)) )
+	{
+		cudaFreePooled(ptr);
+		return;
+	}
+
+	self->queueMutex->Lock();
+
+	// if Python isn't keeping up with the stream, drop the oldest frame
+	if( self->queueCount >= PY_VIDEO_SOURCE_POOL )
+	{
+		cudaFreePooled(self->queue[self->queueHead].ptr);
+
+		self->queueHead = (self->queueHead + 1) % PY_VIDEO_SOURCE_POOL;
+		self->queueCount--;
+	}
+
+	PyVideoSource_Frame* frame = &self->queue[(self->queueHead + self->queueCount) % PY_VIDEO_SOURCE_POOL];
+
+	frame->ptr = ptr;
+	frame->width = width;
+	frame->height = height;
+	frame->format = format;
+	frame->timestamp = timestamp;
+
+	self->queueCount++;
+	self->queueMutex->Unlock();
+
+	// wake up the event loop
+	const uint64_t value = 1;
+
+	if( write(self->eventFD, &value, sizeof(value)) != sizeof(value) )
+		LogDebug(LOG_PY_UTILS "videoSource failed to signal eventfd\n");
+}
+
+// PyVideoSource_ResetEvent (clear the eventfd counter)
+static void PyVideoSource_ResetEvent( PyVideoSource_Object* self )
+{
+	uint64_t value = 0;
+
+	if( self->eventFD >= 0 && read(self->eventFD, &value, sizeof(value)) < 0 && errno != EAGAIN )
+		LogDebug(LOG_PY_UTILS "videoSource failed to read eventfd\n");
 }
 
+// PyVideoSource_PopFrame (returns NULL without setting an exception when the queue is empty)
+static PyObject* PyVideoSource_PopFrame( PyVideoSource_Object* self )
+{
+	PyVideoSource_Frame frame;
+	bool found = false;
+
+	self->queueMutex->Lock();
+
+	if( self->queueCount > 0 )
+	{
+		frame = self->queue[self->queueHead];
+
+		self->queueHead = (self->queueHead + 1) % PY_VIDEO_SOURCE_POOL;
+		self->queueCount--;
+
+		found = true;
+	}
+
+	// the eventfd stays readable until the queue is empty (frames pushed after this signal it again)
+	if( self->queueCount == 0 )
+		PyVideoSource_ResetEvent(self);
+
+	self->queueMutex->Unlock();
+
+	if( !found )
+		return NULL;
+
+	// the image returns the memory to the pool when it's deleted
+	PyObject* image = PyCUDA_RegisterImage(frame.ptr, frame.width, frame.height, frame.format, frame.timestamp, self->source->GetOptions().zeroCopy, true);
+
+	if( !image )
+		cudaFreePooled(frame.ptr);
+
+	return image;
+}
+
+// PyVideoSource_EnableEvents (switch the source over to pushing frames into the queue)
+static bool PyVideoSource_EnableEvents( PyVideoSource_Object* self, imageFormat format )
+{
+	if( !self || !self->source )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "videoSource invalid object instance");
+		return false;
+	}
+
+	if( self->eventFD >= 0 )
+		return true;
+
+	self->eventFD = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+
+	if( self->eventFD < 0 )
+	{
+		PyErr_SetFromErrno(PyExc_OSError);
+		return false;
+	}
+
+	bool result = false;
+
+	Py_BEGIN_ALLOW_THREADS
+	result = self->source->SetCallback(PyVideoSource_OnFrame, format, self);
+
+	if( result && !self->source->IsStreaming() )
+		result = self->source->Open();
+	Py_END_ALLOW_THREADS
+
+	if( !result )
+	{
+		self->source->SetCallback(NULL);
+
+		close(self->eventFD);
+		self->eventFD = -1;
+
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "videoSource doesn't support push-based frame delivery (or failed to open)");
+		return false;
+	}
+
+	return true;
+}
+
+// PyVideoSource_GetEventFD
+static PyObject* PyVideoSource_GetEventFD( PyVideoSource_Object* self, PyObject* args, PyObject* kwds )
+{
+	const char* pyFormat = "rgb8";
+	static char* kwlist[] = {"format", NULL};
+
+	if( !PyArg_ParseTupleAndKeywords(args, kwds, "|s", kwlist, &pyFormat))
+		return NULL;
+
+	if( !PyVideoSource_EnableEvents(self, imageFormatFromStr(pyFormat)) )
+		return NULL;
+
+	return PYLONG_FROM_LONG(self->eventFD);
+}
+
+// PyVideoSource_Poll
+static PyObject* PyVideoSource_Poll( PyVideoSource_Object* self )
+{
+	if( !PyVideoSource_EnableEvents(self, IMAGE_RGB8) )
+		return NULL;
+
+	PyObject* image = PyVideoSource_PopFrame(self);
+
+	if( image != NULL || PyErr_Occurred() != NULL )
+		return image;
+
+	Py_RETURN_NONE;
+}
+
+// PyVideoSource_Next (iterator protocol)
+static PyObject* PyVideoSource_Next( PyVideoSource_Object* self )
+{
+	if( !self || !self->source )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "videoSource invalid object instance");
+		return NULL;
+	}
+
+	while( true )
+	{
+		if( self->eventFD >= 0 )
+		{
+			// frames are being pushed, so wait on the eventfd instead of Capture()
+			PyObject* image = PyVideoSource_PopFrame(self);
+
+			if( image != NULL || PyErr_Occurred() != NULL )
+				return image;
+
+			if( !self->source->IsStreaming() )
+				return NULL;	// StopIteration
+
+			Py_BEGIN_ALLOW_THREADS
+			struct pollfd fd = { self->eventFD, POLLIN, 0 };
+
+			poll(&fd, 1, videoSource::DEFAULT_TIMEOUT);	// PopFrame() clears it once the queue is empty
+			Py_END_ALLOW_THREADS
+		}
+		else
+		{
+			PyObject* args = PyTuple_New(0);
+			PyObject* image = PyVideoSource_Capture(self, args, NULL);
+			Py_DECREF(args);
+
+			if( image != NULL )
+				return image;
+
+			PyErr_Clear();
+
+			// the stream ended (or couldn't be opened), otherwise it was a timeout
+			if( !self->source->IsStreaming() )
+				return NULL;	// StopIteration
+		}
+
+		if( PyErr_CheckSignals() != 0 )
+			return NULL;
+	}
+}
+
+#if PY_VERSION_HEX >= 0x03050000
+
+// how often a pending __anext__() checks if the stream has ended (in seconds)
+#define PY_VIDEO_SOURCE_EOS_CHECK 0.25
+
+static PyObject* PyVideoSource_AsyncEvent( PyVideoSource_Object* self, PyObject* unused );
+static PyObject* PyVideoSource_AsyncTimer( PyVideoSource_Object* self, PyObject* unused );
+
+static PyMethodDef pyVideoSource_AsyncEventDef = { "_event", (PyCFunction)PyVideoSource_AsyncEvent, METH_NOARGS, NULL };
+static PyMethodDef pyVideoSource_AsyncTimerDef = { "_timer", (PyCFunction)PyVideoSource_AsyncTimer, METH_NOARGS, NULL };
+
+// PyVideoSource_AsyncSchedule (check for the end of the stream again after a while)
+static bool PyVideoSource_AsyncSchedule( PyVideoSource_Object* self )
+{
+	PyObject* callback = PyCFunction_New(&pyVideoSource_AsyncTimerDef, (PyObject*)self);
+
+	if( !callback )
+		return false;
+
+	Py_CLEAR(self->timer);
+	self->timer = PyObject_CallMethod(self->loop, "call_later", "dO", PY_VIDEO_SOURCE_EOS_CHECK, callback);
+	Py_DECREF(callback);
+
+	return (self->timer != NULL);
+}
+
+// PyVideoSource_AsyncFinish (stop waiting on the event loop)
+static void PyVideoSource_AsyncFinish( PyVideoSource_Object* self )
+{
+	PyObject* result = NULL;
+
+	if( self->loop != NULL )
+	{
+		result = PyObject_CallMethod(self->loop, "remove_reader", "i", self->eventFD);
+		Py_XDECREF(result);
+	}
+
+	if( self->timer != NULL )
+	{
+		result = PyObject_CallMethod(self->timer, "cancel", NULL);
+		Py_XDECREF(result);
+	}
+
+	Py_CLEAR(self->timer);
+	Py_CLEAR(self->pending);
+	Py_CLEAR(self->loop);
+}
+
+// PyVideoSource_AsyncComplete (resolve the pending future with a frame, an exception, or the end of the stream)
+static void PyVideoSource_AsyncComplete( PyVideoSource_Object* self )
+{
+	if( !self->pending )
+		return;
+
+	PyObject* cancelled = PyObject_CallMethod(self->pending, "cancelled", NULL);
+	const bool isCancelled = (cancelled != NULL && PyObject_IsTrue(cancelled) == 1);
+	Py_XDECREF(cancelled);
+
+	if( isCancelled )
+	{
+		PyVideoSource_AsyncFinish(self);
+		return;
+	}
+
+	PyObject* image = PyVideoSource_PopFrame(self);
+	PyObject* result = NULL;
+
+	if( image != NULL )
+	{
+		result = PyObject_CallMethod(self->pending, "set_result", "O", image);
+		Py_DECREF(image);
+	}
+	else if( PyErr_Occurred() != NULL )
+	{
+		PyObject* type = NULL;
+		PyObject* value = NULL;
+		PyObject* traceback = NULL;
+
+		PyErr_Fetch(&type, &value, &traceback);
+		PyErr_NormalizeException(&type, &value, &traceback);
+
+		result = PyObject_CallMethod(self->pending, "set_exception", "O", value);
+
+		Py_XDECREF(type);
+		Py_XDECREF(value);
+		Py_XDECREF(traceback);
+	}
+	else if( !self->source->IsStreaming() )
+	{
+		result = PyObject_CallMethod(self->pending, "set_exception", "O", PyExc_StopAsyncIteration);
+	}
+	else
+	{
+		return;		// keep waiting
+	}
+
+	Py_XDECREF(result);
+	PyVideoSource_AsyncFinish(self);
+}
+
+// PyVideoSource_AsyncEvent (event loop reader callback, when the eventfd was signalled)
+static PyObject* PyVideoSource_AsyncEvent( PyVideoSource_Object* self, PyObject* unused )
+{
+	PyVideoSource_AsyncComplete(self);
+
+	if( PyErr_Occurred() != NULL )
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+// PyVideoSource_AsyncTimer (event loop timer callback, that checks for the end of the stream)
+static PyObject* PyVideoSource_AsyncTimer( PyVideoSource_Object* self, PyObject* unused )
+{
+	PyVideoSource_AsyncComplete(self);
+
+	if( self->pending != NULL && !PyVideoSource_AsyncSchedule(self) )
+		return NULL;
+
+	if( PyErr_Occurred() != NULL )
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+// PyVideoSource_AsyncIter (__aiter__)
+static PyObject* PyVideoSource_AsyncIter( PyVideoSource_Object* self )
+{
+	if( !PyVideoSource_EnableEvents(self, IMAGE_RGB8) )
+		return NULL;
+
+	Py_INCREF(self);
+	return (PyObject*)self;
+}
+
+// PyVideoSource_AsyncNext (__anext__)
+static PyObject* PyVideoSource_AsyncNext( PyVideoSource_Object* self )
+{
+	if( !PyVideoSource_EnableEvents(self, IMAGE_RGB8) )
+		return NULL;
+
+	if( self->pending != NULL )
+	{
+		PyErr_SetString(PyExc_RuntimeError, LOG_PY_UTILS "videoSource is already waiting on the next frame");
+		return NULL;
+	}
+
+	// create a future on the current event loop
+	PyObject* asyncio = PyImport_ImportModule("asyncio");
+
+	if( !asyncio )
+		return NULL;
+
+	PyObject* loop = PyObject_CallMethod(asyncio, "get_event_loop", NULL);
+	Py_DECREF(asyncio);
+
+	if( !loop )
+		return NULL;
+
+	PyObject* future = PyObject_CallMethod(loop, "create_future", NULL);
+
+	if( !future )
+	{
+		Py_DECREF(loop);
+		return NULL;
+	}
+
+	// return right away if a frame is already queued
+	PyObject* image = PyVideoSource_PopFrame(self);
+
+	if( image != NULL || PyErr_Occurred() != NULL || !self->source->IsStreaming() )
+	{
+		Py_DECREF(loop);
+
+		if( !image )
+		{
+			Py_DECREF(future);
+
+			if( PyErr_Occurred() == NULL )
+				PyErr_SetNone(PyExc_StopAsyncIteration);
+
+			return NULL;
+		}
+
+		PyObject* result = PyObject_CallMethod(future, "set_result", "O", image);
+		Py_DECREF(image);
+
+		if( !result )
+		{
+			Py_DECREF(future);
+			return NULL;
+		}
+
+		Py_DECREF(result);
+		return future;
+	}
+
+	// otherwise wait for the stream's thread to signal the eventfd
+	PyObject* callback = PyCFunction_New(&pyVideoSource_AsyncEventDef, (PyObject*)self);
+	PyObject* result = (callback != NULL) ? PyObject_CallMethod(loop, "add_reader", "iO", self->eventFD, callback) : NULL;
+
+	Py_XDECREF(callback);
+
+	if( !result )
+	{
+		Py_DECREF(future);
+		Py_DECREF(loop);
+		return NULL;
+	}
+
+	Py_DECREF(result);
+
+	self->loop = loop;
+	self->pending = future;
+	Py_INCREF(future);
+
+	if( !PyVideoSource_AsyncSchedule(self) )
+	{
+		PyVideoSource_AsyncFinish(self);
+		Py_DECREF(future);
+		return NULL;
+	}
+
+	return future;
+}
+
+static PyAsyncMethods pyVideoSource_AsAsync = {
+	0,
+	(unaryfunc)PyVideoSource_AsyncIter,
+	(unaryfunc)PyVideoSource_AsyncNext,
+};
+
+#endif
+
+static PyObject* PyVideoSource_GetLastTimestamp( PyVideoSource_Object* self )
+{
+	if( !self || !self->source )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "videoSource invalid object instance");
+		return NULL;
+	}
+
+	return PYLONG_FROM_UNSIGNED_LONG_LONG(self->source->GetLastTimestamp());
+}
+
+// PyVideoSource_GetFrameCount
+static PyObject* PyVideoSource_GetFrameCount( PyVideoSource_Object* self )
+{
+	if( !self || !self->source )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "videoSource invalid object instance");
+		return NULL;
+	}
+
+	return PYLONG_FROM_UNSIGNED_LONG_LONG(self->source->GetFrameCount());
+}
 
 // PyVideoSource_GetWidth
 static PyObject* PyVideoSource_GetWidth( PyVideoSource_Object* self )
@@ -340,6 +971,39 @@ static PyObject* PyVideoSource_GetFrameRate( PyVideoSource_Object* self )
 	return PYLONG_FROM_UNSIGNED_LONG(self->source->GetFrameRate());
 }
 
+// PyVideoSource_GetStats
+static PyObject* PyVideoSource_GetStats( PyVideoSource_Object* self )
+{
+	if( !self || !self->source )
+	{
+		PyErr_SetString(PyExc_Exception, LOG_PY_UTILS "videoSource invalid object instance");
+		return NULL;
+	}
+
+	videoSourceStats stats;
+
+	if( !self->source->GetStats(&stats) )
+		Py_RETURN_NONE;
+
+	PyObject* dict = PyDict_New();
+
+	PYDICT_SET_ITEM(dict, "framesReceived", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.framesReceived));
+	PYDICT_SET_ITEM(dict, "framesCaptured", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.framesCaptured));
+	PYDICT_SET_ITEM(dict, "framesDropped", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.framesDropped));
+	PYDICT_SET_ITEM(dict, "framesSkipped", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.framesSkipped));
+	PYDICT_SET_ITEM(dict, "queueDepth", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.queueDepth));
+	PYDICT_SET_ITEM(dict, "maxQueueDepth", PYLONG_FROM_UNSIGNED_LONG_LONG(stats.maxQueueDepth));
+	PYDICT_SET_FLOAT(dict, "frameRate", stats.frameRate);
+	PYDICT_SET_FLOAT(dict, "interval", stats.interval);
+	PYDICT_SET_FLOAT(dict, "maxInterval", stats.maxInterval);
+	PYDICT_SET_FLOAT(dict, "jitter", stats.jitter);
+	PYDICT_SET_FLOAT(dict, "convertTime", stats.convertTime);
+	PYDICT_SET_FLOAT(dict, "maxConvertTime", stats.maxConvertTime);
+	PYDICT_SET_FLOAT(dict, "captureInterval", stats.captureInterval);
+
+	return dict;
+}
+
 // PyVideoSource_GetOptions
 static PyObject* PyVideoSource_GetOptions( PyVideoSource_Object* self )
 {
@@ -383,8 +1047,13 @@ static PyMethodDef pyVideoSource_Methods[] =
 	{ "GetWidth", (PyCFunction)PyVideoSource_GetWidth, METH_NOARGS, "Return the width of the video source (in pixels)"},
 	{ "GetHeight", (PyCFunction)PyVideoSource_GetHeight, METH_NOARGS, "Return the height of the video source (in pixels)"},
 	{ "GetFrameRate", (PyCFunction)PyVideoSource_GetFrameRate, METH_NOARGS, "Return the frames per second of the video source"},	
+	{ "GetLastTimestamp", (PyCFunction)PyVideoSource_GetLastTimestamp, METH_NOARGS, "Return the timestamp of the last captured frame (in nanoseconds)"},
+	{ "GetFrameCount", (PyCFunction)PyVideoSource_GetFrameCount, METH_NOARGS, "Return the number of frames in the video source (0 if it's unknown)"},
 	{ "GetOptions", (PyCFunction)PyVideoSource_GetOptions, METH_NOARGS, "Return a dict representing the videoOptions of the source"},	
+	{ "GetStats", (PyCFunction)PyVideoSource_GetStats, METH_NOARGS, "Return a dict with the statistics of the frames that were received, captured and dropped (the times are in milliseconds), or None if the source doesn't keep them"},
 	{ "IsStreaming", (PyCFunction)PyVideoSource_IsStreaming, METH_NOARGS, "Return true if the stream is open, return false if closed"},
+	{ "GetEventFD", (PyCFunction)PyVideoSource_GetEventFD, METH_VARARGS|METH_KEYWORDS, "Switch to push-based delivery and return an eventfd that becomes readable when frames are queued for Poll()"},
+	{ "Poll", (PyCFunction)PyVideoSource_Poll, METH_NOARGS, "Return the next frame that was pushed from the stream, or None if there isn't one queued"},
 	{ "Usage", (PyCFunction)PyVideoSource_Usage, METH_NOARGS|METH_STATIC, "Return help text describing the command line options"},		
 	{NULL}  /* Sentinel */
 };
@@ -398,6 +1067,11 @@ static bool PyVideoSource_RegisterType( PyObject* module )
 	pyVideoSource_Type.tp_new 	  = PyVideoSource_New;
 	pyVideoSource_Type.tp_init	  = (initproc)PyVideoSource_Init;
 	pyVideoSource_Type.tp_dealloc	  = (destructor)PyVideoSource_Dealloc;
+	pyVideoSource_Type.tp_iter	  = PyObject_SelfIter;
+	pyVideoSource_Type.tp_iternext  = (iternextfunc)PyVideoSource_Next;
+#if PY_VERSION_HEX >= 0x03050000
+	pyVideoSource_Type.tp_as_async  = &pyVideoSource_AsAsync;
+#endif
 	pyVideoSource_Type.tp_doc  	  = "videoSource interface for cameras, video streams, and images";
 	 
 	if( PyType_Ready(&pyVideoSource_Type) < 0 )
@@ -611,6 +1285,9 @@ static PyObject* PyVideoOutput_Render( PyVideoOutput_Object* self, PyObject* arg
 		return NULL;
 	}
 
+	if( !PyCUDA_CheckContiguous(img, "videoOutput.Render") )
+		return NULL;
+
 	// render the image
 	bool result = false;
 	Py_BEGIN_ALLOW_THREADS
@@ -28,6 +28,14 @@
 
 /**
  * Event object for signalling other threads.
+ *
+ * Events can also be waited on with poll(), select() or epoll alongside sockets and
+ * other file descriptors, by getting an eventfd with GetFD() that's readable while
+ * the event is raised.  That enables a single thread to service many cameras, streams
+ * and sockets (see videoSource::GetEventFD() and SocketPoller::AddFD()).  Once the
+ * descriptor is readable, call Wait() with a timeout of 0 (or the non-blocking
+ * function that uses the event, like videoSource::Capture()) to consume the event.
+ *
  * @ingroup threads
  */
 class Event
@@ -95,13 +103,25 @@ public:
 	 */
 	inline pthread_cond_t* GetID();
 
+	/**
+	 * Get a file descriptor (eventfd) that's readable while the event is raised,
+	 * for waiting on the event with poll(), select() or epoll.  The descriptor is
+	 * created the first time this is called, and is owned by the event.
+	 * @returns the file descriptor, or -1 if it couldn't be created.
+	 */
+	inline int GetFD();
+
 protected:
 
+	inline void signalFD();
+	inline void clearFD();
+
 	pthread_cond_t mID;
 
 	Mutex mQueryMutex;
 	bool  mQuery;
 	bool  mAutoReset;
+	int   mFD;
 };
 
 // inline implementations
@@ -24,6 +24,8 @@
 #define __MULTITHREAD_EVENT_INLINE_H
 
 #include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 
 // constructor
@@ -31,6 +33,7 @@ inline Event::Event( bool autoReset )
 {
 	mAutoReset = autoReset;
 	mQuery     = false;
+	mFD        = -1;
 	
 	pthread_cond_init(&mID, NULL);
 }
@@ -40,6 +43,9 @@ inline Event::Event( bool autoReset )
 inline Event::~Event()
 {
 	pthread_cond_destroy(&mID);
+
+	if( mFD >= 0 )
+		close(mFD);
 }
 
 
@@ -58,6 +64,10 @@ inline bool Event::Query()
 inline void Event::Wake()
 {
 	mQueryMutex.Lock();
+
+	if( !mQuery )
+		signalFD();
+
 	mQuery = true;
 	pthread_cond_signal(&mID);
 	mQueryMutex.Unlock();
@@ -68,6 +78,10 @@ inline void Event::Wake()
 inline void Event::Reset()
 { 
 	mQueryMutex.Lock(); 
+
+	if( mQuery )
+		clearFD();
+
 	mQuery = false; 
 	mQueryMutex.Unlock(); 
 }
@@ -82,7 +96,10 @@ inline bool Event::Wait()
 		pthread_cond_wait(&mID, mQueryMutex.GetID());
 
 	if( mAutoReset )
+	{
+		clearFD();
 		mQuery = false;
+	}
 
 	mQueryMutex.Unlock();
 	return true;
@@ -108,7 +125,10 @@ inline bool Event::Wait( const timespec& timeout )
 	}
 	
 	if( mAutoReset )
+	{
+		clearFD();
 		mQuery = false;
+	}
 
 	mQueryMutex.Unlock();
 	return true;
@@ -142,5 +162,52 @@ inline pthread_cond_t* Event::GetID()
 	return &mID; 
 }
 
+
+// GetFD
+inline int Event::GetFD()
+{
+	mQueryMutex.Lock();
+
+	if( mFD < 0 )
+	{
+		mFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+		// start out readable if the event is already raised
+		if( mFD >= 0 && mQuery )
+			signalFD();
+	}
+
+	const int fd = mFD;
+	mQueryMutex.Unlock();
+
+	return fd;
+}
+
+
+// signalFD (the mutex should be locked)
+inline void Event::signalFD()
+{
+	if( mFD < 0 )
+		return;
+
+	const uint64_t value = 1;
+
+	if( write(mFD, &value, sizeof(value)) != sizeof(value) )
+		return;
+}
+
+
+// clearFD (the mutex should be locked)
+inline void Event::clearFD()
+{
+	if( mFD < 0 )
+		return;
+
+	uint64_t value = 0;
+
+	if( read(mFD, &value, sizeof(value)) != sizeof(value) )
+		return;
+}
+
 	
 #endif
@@ -25,9 +25,28 @@
 
 #include "Mutex.h"
 
+#include <atomic>
+
 
 /**
  * Thread-safe circular ring buffer queue
+ *
+ * By default, the queue indices are protected by a mutex (the Threaded flag).
+ * When there's a single producer thread and a single consumer thread, the
+ * LockFree flag can be set instead, which uses atomic indices with
+ * acquire/release ordering so that neither side ever blocks on the other.
+ *
+ * Consumers that need to hold onto a buffer for longer than the producer takes
+ * to wrap around the queue (for example across an asynchronous inference) can
+ * lease it with Acquire() and return it with Release().  While a buffer is leased,
+ * the producer skips over it instead of overwriting it.  Leases require the
+ * mutex, so they aren't available in LockFree mode.
+ *
+ * On discrete GPUs, reading mapped zeroCopy memory from a kernel goes over PCIe,
+ * so buffers that the CPU fills can be allocated with the Staged flag instead.
+ * Then the CPU writes to GetStaging() and the frame is copied to the GPU buffer
+ * with Upload() (using cudaMemcpyAsync() from pinned memory).
+ *
  * @ingroup threads
  */
 class RingBuffer
@@ -45,6 +64,8 @@ public:
 		Write          = (1 << 4),				/**< Write the next buffer. */
 		Threaded       = (1 << 5),      			/**< Buffers should be thread-safe (enabled by default). */
 		ZeroCopy       = (1 << 6),				/**< Buffers should be allocated in mapped CPU/GPU zeroCopy memory (otherwise GPU only) */
+		LockFree       = (1 << 7),				/**< Single-producer/single-consumer mode using atomics instead of the mutex (overrides Threaded). */
+		Staged         = (1 << 8),				/**< Buffers are allocated in GPU memory, each with a pinned CPU staging buffer for Upload() (for discrete GPUs) */
 	};
 	
 	/**
@@ -64,6 +85,10 @@ public:
 	 * this will return `true` without performing additional allocations.
 	 * Otherwise, the previous buffers are released and new ones are allocated.
 	 *
+	 * If a memory budget was set with cudaMemorySetBudget(), fewer buffers may be
+	 * allocated so that they fit in it (down to 2), and the memory is accounted for
+	 * in the CUDA_MEMORY_RINGBUFFER category of cudaMemoryUsage().
+	 *
 	 * @returns `true` if the allocations succeeded or was previously done.
 	 *          `false` if a memory allocation error occurred.
 	 */
@@ -84,6 +109,45 @@ public:
 	 */
 	inline void* Next( uint32_t flags );
 
+	/**
+	 * Get the next read buffer and advance the position in the queue (like Next()),
+	 * while also leasing the buffer so that the producer won't overwrite it until
+	 * it gets returned with Release().  A buffer can be leased multiple times, and
+	 * the producer will skip it until every lease has been released.
+	 *
+	 * @param flags the Read flags to use (ReadLatest by default)
+	 * @returns pointer to the leased buffer, or NULL if no buffer was available
+	 *          (for example with the ReadOnce flag, or in LockFree mode)
+	 */
+	inline void* Acquire( uint32_t flags=ReadLatest );
+
+	/**
+	 * Release a lease on a buffer that was previously returned by Acquire().
+	 */
+	inline void Release( void* buffer );
+
+	/**
+	 * Get the pinned CPU staging buffer that belongs to a buffer (only with the Staged flag).
+	 * @returns pointer to the staging buffer, or NULL if the buffer isn't staged
+	 */
+	inline void* GetStaging( void* buffer );
+
+	/**
+	 * Copy a buffer's staging memory to the GPU with cudaMemcpyAsync() (only with the Staged flag).
+	 * The staging buffer shouldn't be written again until the copy on the stream has completed.
+	 */
+	inline cudaError_t Upload( void* buffer, cudaStream_t stream=NULL );
+
+	/**
+	 * Get the number of buffers that are currently leased with Acquire().
+	 */
+	inline uint32_t GetLeased();
+
+	/**
+	 * Get the size (in bytes) of each buffer, as allocated by Alloc().
+	 */
+	inline size_t GetBufferSize() const		{ return mBufferSize; }
+
 	/**
 	 * Get the flags of the ring buffer.
 	 */
@@ -99,16 +163,32 @@ public:
 	 */
 	inline void SetThreaded( bool threaded );
 
+	/**
+	 * Enable or disable the lock-free single-producer/single-consumer mode.
+	 * In this mode, only one thread may write and only one thread may read.
+	 */
+	inline void SetLockFree( bool lockFree );
+
 protected:
 
+	inline int nextRead( uint32_t flags );
+	inline int nextWrite();
+
 	uint32_t mNumBuffers;
-	uint32_t mLatestRead;
-	uint32_t mLatestWrite;
+	uint32_t mRequestedBuffers;	// the number of buffers passed to Alloc() (before the budget)
 	uint32_t mFlags;
 
+	std::atomic<uint32_t> mLatestRead;	// only modified by the consumer
+	std::atomic<uint32_t> mLatestWrite;	// only modified by the producer
+	std::atomic<bool>     mReadOnce;	// set by the consumer, cleared by the producer
+
 	void** mBuffers;
+	void** mStaging;		// pinned CPU buffers (only with the Staged flag)
 	size_t mBufferSize;
-	bool   mReadOnce;
+
+	uint32_t* mLeases;		// lease count of each buffer (protected by the mutex)
+	int       mPendingWrite;	// buffer returned by Peek(Write), to be published by Next(Write)
+
 	Mutex  mMutex;
 };
 
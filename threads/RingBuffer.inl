@@ -33,11 +33,15 @@ RingBuffer::RingBuffer( uint32_t flags )
 {
 	mFlags = flags;
 	mBuffers = NULL;
+	mStaging = NULL;
 	mBufferSize = 0;
 	mNumBuffers = 0;
+	mRequestedBuffers = 0;
 	mReadOnce = false;
 	mLatestRead = 0;
 	mLatestWrite = 0;
+	mLeases = NULL;
+	mPendingWrite = -1;
 }
 
 
@@ -51,21 +55,60 @@ RingBuffer::~RingBuffer()
 		free(mBuffers);
 		mBuffers = NULL;
 	}
+
+	if( mLeases != NULL )
+	{
+		free(mLeases);
+		mLeases = NULL;
+	}
+
+	if( mStaging != NULL )
+	{
+		free(mStaging);
+		mStaging = NULL;
+	}
 }
 
 
 // Alloc
 inline bool RingBuffer::Alloc( uint32_t numBuffers, size_t size, uint32_t flags )
 {
-	if( numBuffers == mNumBuffers && size == mBufferSize && (flags & ZeroCopy) == (mFlags & ZeroCopy) )
+	const uint32_t memoryFlags = ZeroCopy | Staged;
+
+	if( numBuffers == mRequestedBuffers && size == mBufferSize && (flags & memoryFlags) == (mFlags & memoryFlags) )
 		return true;
 	
 	Free();
+
+	mRequestedBuffers = 0;	// retry next time if the allocation fails
+
+	// shrink the number of buffers to fit in the memory budget
+	const uint32_t requestedBuffers = numBuffers;
+	const size_t   bufferSize = (flags & Staged) ? size * 2 : size;
+
+	while( numBuffers > 2 && !cudaMemoryFits(numBuffers * bufferSize) )
+		numBuffers--;
+
+	if( !cudaMemoryFits(numBuffers * bufferSize) )
+	{
+		LogError("RingBuffer -- allocating %u buffers of %zu bytes would exceed the memory budget\n", numBuffers, size);
+		cudaMemoryReport();
+		return false;
+	}
+
+	if( numBuffers < requestedBuffers )
+		LogWarning("RingBuffer -- allocating %u buffers instead of %u to fit in the memory budget\n", numBuffers, requestedBuffers);
 	
 	if( mBuffers != NULL && mNumBuffers != numBuffers )
 	{
 		free(mBuffers);
 		mBuffers = NULL;
+
+		free(mLeases);
+		mLeases = NULL;
+
+		free(mStaging);
+		mStaging = NULL;
 	}
 	
 	if( mBuffers == NULL )
@@ -74,12 +117,23 @@ inline bool RingBuffer::Alloc( uint32_t numBuffers, size_t size, uint32_t flags
 		mBuffers = (void**)malloc(bufferListSize);
 		memset(mBuffers, 0, bufferListSize);
 	}
+
+	if( mLeases == NULL )
+		mLeases = (uint32_t*)malloc(numBuffers * sizeof(uint32_t));
+
+	if( mStaging == NULL )
+		mStaging = (void**)calloc(numBuffers, sizeof(void*));
+
+	memset(mLeases, 0, numBuffers * sizeof(uint32_t));
+	mPendingWrite = -1;
+	mNumBuffers = numBuffers;	// so that Free() releases a partial allocation
+	mFlags      = (mFlags & ~memoryFlags) | (flags & memoryFlags);
 	
 	for( uint32_t n=0; n < numBuffers; n++ )
 	{
 		if( flags & ZeroCopy )
 		{
-			if( !cudaAllocMapped(&mBuffers[n], size) )
+			if( !cudaAllocMapped(&mBuffers[n], size, CUDA_MEMORY_RINGBUFFER) )
 			{
 				LogError("RingBuffer -- failed to allocate zero-copy buffer of %zu bytes\n", size);
 				return false;
@@ -87,19 +141,28 @@ inline bool RingBuffer::Alloc( uint32_t numBuffers, size_t size, uint32_t flags
 		}
 		else
 		{
-			mBuffers[n] = malloc(size);
-			
 			if( CUDA_FAILED(cudaMalloc(&mBuffers[n], size)) )
 			{
 				LogError("RingBuffer -- failed to allocate CUDA buffer of %zu bytes\n", size);
 				return false;
 			}
+
+			cudaMemoryTrack(mBuffers[n], size, CUDA_MEMORY_RINGBUFFER);
+
+			if( (flags & Staged) && CUDA_FAILED(cudaHostAlloc(&mStaging[n], size, cudaHostAllocDefault)) )
+			{
+				LogError("RingBuffer -- failed to allocate pinned staging buffer of %zu bytes\n", size);
+				return false;
+			}
+
+			if( flags & Staged )
+				cudaMemoryTrack(mStaging[n], size, CUDA_MEMORY_RINGBUFFER);
 		}
 	}
 		
 	LogVerbose("RingBuffer -- allocated %u buffers (%zu bytes each, %zu bytes total)\n", numBuffers, size, size * numBuffers);
 	
-	mNumBuffers = numBuffers;
+	mRequestedBuffers = requestedBuffers;
 	mBufferSize = size;
 	mFlags     |= flags;
 	
@@ -116,10 +179,21 @@ inline void RingBuffer::Free()
 	for( uint32_t n=0; n < mNumBuffers; n++ )
 	{
 		if( mFlags & ZeroCopy )
-			CUDA(cudaFreeHost(mBuffers[n]));
+		{
+			cudaFreeMapped(mBuffers[n]);
+		}
 		else
+		{
+			cudaMemoryUntrack(mBuffers[n]);
 			CUDA(cudaFree(mBuffers[n]));
+		}
 		
+		if( mStaging != NULL && mStaging[n] != NULL )
+		{
+			cudaFreeMapped(mStaging[n]);
+			mStaging[n] = NULL;
+		}
+
 		mBuffers[n] = NULL;
 	}
 }
@@ -136,24 +210,35 @@ inline void* RingBuffer::Peek( uint32_t flags )
 		return NULL;
 	}
 
-	if( flags & Threaded )
+	const bool locked = (flags & Threaded) && !(flags & LockFree);
+
+	if( locked )
 		mMutex.Lock();
 
 	int bufferIndex = -1;
 
 	if( flags & Write )
-		bufferIndex = (mLatestWrite + 1) % mNumBuffers;
+	{
+		if( flags & LockFree )
+			bufferIndex = (mLatestWrite.load(std::memory_order_relaxed) + 1) % mNumBuffers;
+		else
+			bufferIndex = mPendingWrite = nextWrite();
+	}
 	else if( flags & ReadLatest )
-		bufferIndex = mLatestWrite;
+		bufferIndex = mLatestWrite.load(std::memory_order_acquire);
 	else if( flags & Read )
-		bufferIndex = mLatestRead;
+		bufferIndex = mLatestRead.load(std::memory_order_relaxed);
 	
-	if( flags & Threaded )
+	if( locked )
 		mMutex.Unlock();
 
 	if( bufferIndex < 0 )
 	{
-		LogError("RingBuffer::Peek() -- error, invalid flags (must be Write or Read flags)\n");
+		if( flags & Write )
+			LogError("RingBuffer::Peek() -- error, all buffers are currently leased\n");
+		else
+			LogError("RingBuffer::Peek() -- error, invalid flags (must be Write or Read flags)\n");
+
 		return NULL;
 	}
 
@@ -172,47 +257,238 @@ inline void* RingBuffer::Next( uint32_t flags )
 		return NULL;
 	}
 
-	if( flags & Threaded )
+	const bool locked = (flags & Threaded) && !(flags & LockFree);
+
+	if( locked )
 		mMutex.Lock();
 
 	int bufferIndex = -1;
 
 	if( flags & Write )
 	{
-		mLatestWrite = (mLatestWrite + 1) % mNumBuffers;
-		bufferIndex  = mLatestWrite;
-		mReadOnce    = false;
+		// publish the buffer that Peek(Write) returned (or else the next unleased one)
+		if( flags & LockFree )
+			bufferIndex = (mLatestWrite.load(std::memory_order_relaxed) + 1) % mNumBuffers;
+		else
+			bufferIndex = (mPendingWrite >= 0) ? mPendingWrite : nextWrite();
+
+		mPendingWrite = -1;
+
+		// the release pairs with the consumer's acquire, so the contents
+		// written to the buffer are visible before its index is
+		if( bufferIndex >= 0 )
+		{
+			mLatestWrite.store(bufferIndex, std::memory_order_release);
+			mReadOnce.store(false, std::memory_order_release);
+		}
+	}
+	else if( flags & Read )
+	{
+		bufferIndex = nextRead(flags);
+
+		if( bufferIndex < 0 )
+		{
+			if( locked )
+				mMutex.Unlock();
+
+			return NULL;
+		}
 	}
-	else if( (flags & ReadOnce) && mReadOnce )
+	
+	if( locked )
+		mMutex.Unlock();
+
+	if( bufferIndex < 0 )
 	{
-		if( flags & Threaded )
-			mMutex.Unlock();
+		if( flags & Write )
+			LogError("RingBuffer::Next() -- error, all buffers are currently leased\n");
+		else
+			LogError("RingBuffer::Next() -- error, invalid flags (must be Write or Read flags)\n");
 
 		return NULL;
 	}
-	else if( flags & ReadLatest )
+
+	return mBuffers[bufferIndex];
+}
+
+
+// Acquire
+inline void* RingBuffer::Acquire( uint32_t flags )
+{
+	flags |= mFlags;
+
+	if( !mBuffers || mNumBuffers == 0 )
 	{
-		mLatestRead = mLatestWrite;
-		bufferIndex = mLatestWrite;
-		mReadOnce   = true;
+		LogError("RingBuffer::Acquire() -- error, must call RingBuffer::Alloc() first\n");
+		return NULL;
 	}
-	else if( flags & Read )
+
+	if( flags & LockFree )
 	{
-		mLatestRead = (mLatestRead + 1) % mNumBuffers;
-		bufferIndex = mLatestRead;
-		mReadOnce   = true;
+		LogError("RingBuffer::Acquire() -- error, leases aren't supported in LockFree mode\n");
+		return NULL;
 	}
-	
-	if( flags & Threaded )
+
+	if( !(flags & Read) || (flags & Write) )
+	{
+		LogError("RingBuffer::Acquire() -- error, invalid flags (must be Read flags)\n");
+		return NULL;
+	}
+
+	const bool locked = (flags & Threaded);
+
+	if( locked )
+		mMutex.Lock();
+
+	int bufferIndex = nextRead(flags);
+
+	// the producer may already be writing to the slot it returned from Peek()
+	if( bufferIndex >= 0 && bufferIndex == mPendingWrite )
+		bufferIndex = -1;
+
+	if( bufferIndex >= 0 )
+		mLeases[bufferIndex]++;
+
+	if( locked )
 		mMutex.Unlock();
 
 	if( bufferIndex < 0 )
+		return NULL;
+
+	return mBuffers[bufferIndex];
+}
+
+
+// Release
+inline void RingBuffer::Release( void* buffer )
+{
+	if( !buffer || !mBuffers )
+		return;
+
+	const bool locked = (mFlags & Threaded);
+
+	if( locked )
+		mMutex.Lock();
+
+	bool found = false;
+
+	for( uint32_t n=0; n < mNumBuffers; n++ )
+	{
+		if( mBuffers[n] != buffer )
+			continue;
+
+		if( mLeases[n] > 0 )
+			mLeases[n]--;
+
+		found = true;
+		break;
+	}
+
+	if( locked )
+		mMutex.Unlock();
+
+	if( !found )
+		LogError("RingBuffer::Release() -- error, %p isn't one of the ring buffer's buffers\n", buffer);
+}
+
+
+// GetLeased
+inline uint32_t RingBuffer::GetLeased()
+{
+	if( !mLeases || mNumBuffers == 0 )
+		return 0;
+
+	const bool locked = (mFlags & Threaded);
+
+	if( locked )
+		mMutex.Lock();
+
+	uint32_t leased = 0;
+
+	for( uint32_t n=0; n < mNumBuffers; n++ )
+	{
+		if( mLeases[n] > 0 )
+			leased++;
+	}
+
+	if( locked )
+		mMutex.Unlock();
+
+	return leased;
+}
+
+
+// nextRead (the caller should hold the mutex, if needed)
+inline int RingBuffer::nextRead( uint32_t flags )
+{
+	// mark the latest buffer as read, and check if it already was
+	const bool wasRead = mReadOnce.exchange(true, std::memory_order_acq_rel);
+
+	if( (flags & ReadOnce) && wasRead )
+		return -1;
+
+	int bufferIndex = 0;
+
+	if( flags & ReadLatest )
+		bufferIndex = mLatestWrite.load(std::memory_order_acquire);
+	else
+		bufferIndex = (mLatestRead.load(std::memory_order_relaxed) + 1) % mNumBuffers;
+
+	mLatestRead.store(bufferIndex, std::memory_order_relaxed);
+	return bufferIndex;
+}
+
+
+// nextWrite (the caller should hold the mutex, if needed)
+inline int RingBuffer::nextWrite()
+{
+	const uint32_t latest = mLatestWrite.load(std::memory_order_relaxed);
+
+	// never write into the latest buffer, since readers may lease it at any time
+	// (unless there's only the one buffer, which is the original behavior)
+	const uint32_t count = (mNumBuffers > 1) ? mNumBuffers - 1 : 1;
+
+	// skip over any buffers that are currently leased by consumers
+	for( uint32_t n=1; n <= count; n++ )
 	{
-		LogError("RingBuffer::Next() -- error, invalid flags (must be Write or Read flags)\n");
+		const uint32_t bufferIndex = (latest + n) % mNumBuffers;
+
+		if( mLeases[bufferIndex] == 0 )
+			return bufferIndex;
+	}
+
+	return -1;
+}
+
+
+// GetStaging
+inline void* RingBuffer::GetStaging( void* buffer )
+{
+	if( !mStaging || !buffer )
 		return NULL;
+
+	for( uint32_t n=0; n < mNumBuffers; n++ )
+	{
+		if( mBuffers[n] == buffer )
+			return mStaging[n];
 	}
 
-	return mBuffers[bufferIndex];
+	return NULL;
+}
+
+
+// Upload
+inline cudaError_t RingBuffer::Upload( void* buffer, cudaStream_t stream )
+{
+	void* staging = GetStaging(buffer);
+
+	if( !staging )
+	{
+		LogError("RingBuffer::Upload() -- the buffer doesn't have a staging buffer (it needs the Staged flag)\n");
+		return cudaErrorInvalidValue;
+	}
+
+	return CUDA(cudaMemcpyAsync(buffer, staging, mBufferSize, cudaMemcpyHostToDevice, stream));
 }
 
 
@@ -240,4 +516,14 @@ inline void RingBuffer::SetThreaded( bool threaded )
 }
 
 
+// SetLockFree
+inline void RingBuffer::SetLockFree( bool lockFree )
+{
+	if( lockFree )
+		mFlags |= LockFree;
+	else
+		mFlags &= ~LockFree;
+}
+
+
 #endif
@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+ 
+#include "ThreadPool.h"
+#include "logging.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+
+// the worker that the current thread is (or NULL if it isn't one)
+static __thread void* gCurrentWorker = NULL;
+
+// the settings of the global pool (from ParseCmdLine)
+static uint32_t gGlobalThreads  = 0;
+static int      gGlobalPriority = 0;
+static int      gGlobalAffinity = -1;
+
+static ThreadPool* gGlobalPool = NULL;
+static Mutex       gGlobalMutex;
+
+
+// constructor
+ThreadPool::ThreadPool()
+{
+	mPending    = 0;
+	mActive     = 0;
+	mNextWorker = 0;
+	mStop       = false;
+	mPriority   = 0;
+	mAffinity   = -1;
+
+	pthread_cond_init(&mWorkCond, NULL);
+	pthread_cond_init(&mIdleCond, NULL);
+}
+
+
+// destructor
+ThreadPool::~ThreadPool()
+{
+	mMutex.Lock();
+	mStop = true;
+	pthread_cond_broadcast(&mWorkCond);
+	mMutex.Unlock();
+
+	// the workers exit once the queues are empty
+	for( size_t n=0; n < mWorkers.size(); n++ )
+	{
+		mWorkers[n]->thread.Stop(true);
+		delete mWorkers[n];
+	}
+
+	mWorkers.clear();
+
+	pthread_cond_destroy(&mWorkCond);
+	pthread_cond_destroy(&mIdleCond);
+}
+
+
+// Create
+ThreadPool* ThreadPool::Create( uint32_t numThreads, int priority, int cpuAffinity )
+{
+	ThreadPool* pool = new ThreadPool();
+
+	if( !pool->init(numThreads, priority, cpuAffinity) )
+	{
+		delete pool;
+		return NULL;
+	}
+
+	return pool;
+}
+
+
+// Global
+ThreadPool* ThreadPool::Global()
+{
+	gGlobalMutex.Lock();
+
+	if( !gGlobalPool )
+		gGlobalPool = Create(gGlobalThreads, gGlobalPriority, gGlobalAffinity);
+
+	ThreadPool* pool = gGlobalPool;
+	gGlobalMutex.Unlock();
+
+	return pool;
+}
+
+
+// ParseCmdLine
+void ThreadPool::ParseCmdLine( const commandLine& cmdLine )
+{
+	gGlobalMutex.Lock();
+
+	gGlobalThreads  = cmdLine.GetUnsignedInt("pool-threads", gGlobalThreads);
+	gGlobalPriority = cmdLine.GetInt("pool-priority", gGlobalPriority);
+	gGlobalAffinity = cmdLine.GetInt("pool-affinity", gGlobalAffinity);
+
+	if( gGlobalPool != NULL && (cmdLine.GetFlag("pool-threads") || cmdLine.GetFlag("pool-priority") || cmdLine.GetFlag("pool-affinity")) )
+		LogWarning("ThreadPool -- the global pool was already created, ignoring the --pool-* options\n");
+
+	gGlobalMutex.Unlock();
+}
+
+
+// init
+bool ThreadPool::init( uint32_t numThreads, int priority, int cpuAffinity )
+{
+	const long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if( numThreads == 0 )
+		numThreads = (numCPUs > 0) ? numCPUs : 1;
+
+	mPriority = priority;
+	mAffinity = cpuAffinity;
+
+	// the workers don't access the list until tasks get submitted after Create()
+	mWorkers.reserve(numThreads);
+
+	for( uint32_t n=0; n < numThreads; n++ )
+	{
+		Worker* worker = new Worker();
+
+		worker->pool  = this;
+		worker->index = n;
+
+		if( !worker->thread.Start(&ThreadPool::workerThread, worker) )
+		{
+			LogError("ThreadPool -- failed to start worker thread %u\n", n);
+			delete worker;
+			break;
+		}
+
+		mWorkers.push_back(worker);
+
+		if( cpuAffinity >= 0 && numCPUs > 0 )
+			worker->thread.LockAffinity((cpuAffinity + n) % numCPUs);
+
+		if( priority > 0 )
+			worker->thread.SetPriorityLevel(priority);
+	}
+
+	if( mWorkers.size() == 0 )
+		return false;
+
+	LogVerbose("ThreadPool -- started %zu worker threads (priority %i, affinity %i)\n", mWorkers.size(), priority, cpuAffinity);
+	return true;
+}
+
+
+// Submit
+bool ThreadPool::Submit( ThreadTask task, void* user_param )
+{
+	if( !task )
+		return false;
+
+	Task t;
+
+	t.func = task;
+	t.user = user_param;
+
+	// tasks submitted from a worker stay on its own queue
+	Worker* worker = (Worker*)gCurrentWorker;
+
+	mMutex.Lock();
+
+	if( mStop )
+	{
+		mMutex.Unlock();
+		return false;
+	}
+
+	if( !worker || worker->pool != this )
+		worker = mWorkers[mNextWorker++ % mWorkers.size()];
+
+	// the task is queued before it's counted, so a worker that reserves it will find it
+	worker->mutex.Lock();
+	worker->tasks.push_back(t);
+	worker->mutex.Unlock();
+
+	mPending++;
+	mActive++;
+
+	pthread_cond_signal(&mWorkCond);
+	mMutex.Unlock();
+
+	return true;
+}
+
+
+// take (returns false if there weren't any tasks to run)
+bool ThreadPool::take( Worker* worker, Task* task )
+{
+	// run the newest task from its own queue
+	worker->mutex.Lock();
+
+	if( worker->tasks.size() > 0 )
+	{
+		*task = worker->tasks.back();
+		worker->tasks.pop_back();
+		worker->mutex.Unlock();
+		return true;
+	}
+
+	worker->mutex.Unlock();
+
+	// steal the oldest task from another queue
+	const uint32_t numWorkers = mWorkers.size();
+
+	for( uint32_t n=1; n < numWorkers; n++ )
+	{
+		Worker* victim = mWorkers[(worker->index + n) % numWorkers];
+
+		victim->mutex.Lock();
+
+		if( victim->tasks.size() > 0 )
+		{
+			*task = victim->tasks.front();
+			victim->tasks.pop_front();
+			victim->mutex.Unlock();
+			return true;
+		}
+
+		victim->mutex.Unlock();
+	}
+
+	return false;
+}
+
+
+// workerThread
+void* ThreadPool::workerThread( void* param )
+{
+	Worker* worker = (Worker*)param;
+	ThreadPool* pool = worker->pool;
+
+	gCurrentWorker = worker;
+
+	while( true )
+	{
+		// wait until there's a task that hasn't been reserved by another worker
+		pool->mMutex.Lock();
+
+		while( pool->mPending == 0 && !pool->mStop )
+			pthread_cond_wait(&pool->mWorkCond, pool->mMutex.GetID());
+
+		if( pool->mPending == 0 )
+		{
+			pool->mMutex.Unlock();
+			break;
+		}
+
+		pool->mPending--;
+		pool->mMutex.Unlock();
+
+		// find the task that was reserved (it's on one of the queues)
+		Task task;
+
+		while( !pool->take(worker, &task) )
+			sched_yield();
+
+		task.func(task.user);
+
+		pool->mMutex.Lock();
+
+		if( --pool->mActive == 0 )
+			pthread_cond_broadcast(&pool->mIdleCond);
+
+		pool->mMutex.Unlock();
+	}
+
+	gCurrentWorker = NULL;
+	return NULL;
+}
+
+
+// Wait
+void ThreadPool::Wait()
+{
+	mMutex.Lock();
+
+	while( mActive > 0 )
+		pthread_cond_wait(&mIdleCond, mMutex.GetID());
+
+	mMutex.Unlock();
+}
+
+
+// state of a ParallelFor() loop (freed by whichever of the caller or helpers finishes last)
+struct parallelJob
+{
+	ThreadParallelTask task;
+	void*  user;
+	size_t count;
+	size_t next;		// the next index to run
+	size_t completed;	// the number of indices that have finished
+	size_t refs;
+
+	Mutex  mutex;
+	pthread_cond_t done;
+};
+
+
+// runParallel (returns false if the job has been released)
+static bool runParallel( parallelJob* job )
+{
+	while( true )
+	{
+		job->mutex.Lock();
+
+		if( job->next >= job->count )
+		{
+			const bool release = (--job->refs == 0);
+			job->mutex.Unlock();
+
+			if( release )
+			{
+				pthread_cond_destroy(&job->done);
+				delete job;
+				return false;
+			}
+
+			return true;
+		}
+
+		const size_t index = job->next++;
+		job->mutex.Unlock();
+
+		job->task(index, job->user);
+
+		job->mutex.Lock();
+
+		if( ++job->completed == job->count )
+			pthread_cond_broadcast(&job->done);
+
+		job->mutex.Unlock();
+	}
+}
+
+
+// parallelTask
+void ThreadPool::parallelTask( void* param )
+{
+	runParallel((parallelJob*)param);
+}
+
+
+// ParallelFor
+void ThreadPool::ParallelFor( size_t count, ThreadParallelTask task, void* user_param )
+{
+	if( count == 0 || !task )
+		return;
+
+	parallelJob* job = new parallelJob();
+
+	job->task      = task;
+	job->user      = user_param;
+	job->count     = count;
+	job->next      = 0;
+	job->completed = 0;
+	job->refs      = 1;
+
+	pthread_cond_init(&job->done, NULL);
+
+	// helpers that only start after the loop has finished exit right away
+	const size_t numHelpers = std::min<size_t>(count, mWorkers.size()) - 1;
+
+	for( size_t n=0; n < numHelpers; n++ )
+	{
+		job->mutex.Lock();
+		job->refs++;
+		job->mutex.Unlock();
+
+		if( !Submit(&ThreadPool::parallelTask, job) )
+		{
+			job->mutex.Lock();
+			job->refs--;
+			job->mutex.Unlock();
+			break;
+		}
+	}
+
+	// run iterations on this thread until they've all started, then wait for the rest
+	job->mutex.Lock();
+	job->refs++;
+	job->mutex.Unlock();
+
+	runParallel(job);
+
+	job->mutex.Lock();
+
+	while( job->completed < job->count )
+		pthread_cond_wait(&job->done, job->mutex.GetID());
+
+	const bool release = (--job->refs == 0);
+	job->mutex.Unlock();
+
+	if( release )
+	{
+		pthread_cond_destroy(&job->done);
+		delete job;
+	}
+}
+
+
+// GetNumTasks
+uint32_t ThreadPool::GetNumTasks()
+{
+	mMutex.Lock();
+	const uint32_t tasks = mActive;
+	mMutex.Unlock();
+
+	return tasks;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+ 
+#ifndef __MULTITHREAD_POOL_H_
+#define __MULTITHREAD_POOL_H_
+
+#include "Thread.h"
+#include "Mutex.h"
+#include "commandLine.h"
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+
+/**
+ * Function pointer typedef of a task that gets run by a ThreadPool.
+ * @ingroup threads
+ */
+typedef void (*ThreadTask)( void* user_param );
+
+/**
+ * Function pointer typedef of the body of a loop that's run by ThreadPool::ParallelFor().
+ * @ingroup threads
+ */
+typedef void (*ThreadParallelTask)( size_t index, void* user_param );
+
+
+/**
+ * Work-stealing pool of threads for running CPU tasks in parallel,
+ * like decoding or encoding images and formatting files.
+ *
+ * Each worker thread has its own queue of tasks.  Tasks that are submitted from
+ * one of the workers go on that worker's queue (where they're run newest-first,
+ * while the data is still in its cache), and tasks submitted from other threads
+ * are spread across the workers.  Idle workers steal the oldest tasks from the
+ * other queues, so the load stays balanced without a shared queue to contend on.
+ *
+ * The workers can be locked to CPU cores (see Thread::SetAffinity()), and run
+ * with realtime SCHED_FIFO priority (see Thread::SetPriority()).
+ *
+ * Most code shares the pool from ThreadPool::Global(), which has one thread per
+ * CPU core by default.  It can be configured before it's first used with the
+ * `--pool-threads`, `--pool-priority` and `--pool-affinity` command-line options.
+ *
+ * @ingroup threads
+ */
+class ThreadPool
+{
+public:
+	/**
+	 * Create a new pool of threads.
+	 * @param numThreads the number of worker threads (or 0 for one per CPU core)
+	 * @param priority the SCHED_FIFO priority of the workers (or 0 for the default scheduling)
+	 * @param cpuAffinity if >= 0, worker N is locked to CPU core `(cpuAffinity + N) % cores`
+	 */
+	static ThreadPool* Create( uint32_t numThreads=0, int priority=0, int cpuAffinity=-1 );
+
+	/**
+	 * Get the pool that's shared by the library (it gets created on first use).
+	 */
+	static ThreadPool* Global();
+
+	/**
+	 * Parse the `--pool-threads`, `--pool-priority` and `--pool-affinity` options,
+	 * which configure the global pool (if it hasn't been created yet).
+	 */
+	static void ParseCmdLine( const commandLine& cmdLine );
+
+	/**
+	 * Destructor (this runs the tasks that are still queued, and then stops the threads).
+	 */
+	~ThreadPool();
+
+	/**
+	 * Queue a task to be run by one of the workers.
+	 * @returns `true` on success, or `false` if the pool is being destroyed.
+	 */
+	bool Submit( ThreadTask task, void* user_param=NULL );
+
+	/**
+	 * Wait until every task that's been submitted has finished.
+	 * This shouldn't be called from within a task.
+	 */
+	void Wait();
+
+	/**
+	 * Run `task` for every index from 0 to `count-1` in parallel, and wait for them to finish.
+	 * The calling thread runs some of the iterations too, so this can be called from a task.
+	 */
+	void ParallelFor( size_t count, ThreadParallelTask task, void* user_param=NULL );
+
+	/**
+	 * Get the number of worker threads.
+	 */
+	inline uint32_t GetNumThreads() const		{ return mWorkers.size(); }
+
+	/**
+	 * Get the number of tasks that are queued or running.
+	 */
+	uint32_t GetNumTasks();
+
+protected:
+	ThreadPool();
+
+	struct Task
+	{
+		ThreadTask  func;
+		void*       user;
+	};
+
+	struct Worker
+	{
+		ThreadPool* pool;
+		uint32_t    index;
+		Thread      thread;
+		Mutex       mutex;
+		std::deque<Task> tasks;
+	};
+
+	bool init( uint32_t numThreads, int priority, int cpuAffinity );
+	bool take( Worker* worker, Task* task );
+
+	static void* workerThread( void* param );
+	static void parallelTask( void* param );
+
+	std::vector<Worker*> mWorkers;
+	
+	Mutex          mMutex;
+	pthread_cond_t mWorkCond;	// signalled when a task is submitted
+	pthread_cond_t mIdleCond;	// signalled when all the tasks have finished
+
+	uint32_t mPending;		// tasks that are queued and haven't been taken by a worker
+	uint32_t mActive;		// tasks that are queued or running
+	uint32_t mNextWorker;	// round-robin for tasks submitted from outside the pool
+	bool     mStop;
+
+	int mPriority;
+	int mAffinity;
+};
+
+#endif
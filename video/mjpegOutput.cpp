@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "mjpegOutput.h"
+#include "imageIO-jpeg.h"
+
+#include "cudaColorspace.h"
+#include "cudaMappedMemory.h"
+#include "logging.h"
+
+#include "../image/stb/stb_image_write.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+
+// constructor
+mjpegOutput::mjpegOutput( const videoOptions& options ) : videoOutput(options)
+{
+	mServer     = NULL;
+	mNumClients = 0;
+	mFrame      = NULL;
+	mRGB        = NULL;
+	mRGBSize    = 0;
+}
+
+
+// destructor
+mjpegOutput::~mjpegOutput()
+{
+	if( mServer != NULL )
+	{
+		mServer->AddRoute(mPath.c_str(), (WebRTCServer::HttpListener)NULL);
+
+		// close the connections from the server's thread (after any frames that are still queued)
+		mServer->Invoke(onDestroy, this);
+		mDestroyEvent.Wait();
+
+		mServer->Release();
+		mServer = NULL;
+	}
+
+	if( mFrame != NULL )
+	{
+		soup_buffer_free(mFrame);
+		mFrame = NULL;
+	}
+
+	CUDA_FREE_HOST(mRGB);
+}
+
+
+// Create
+mjpegOutput* mjpegOutput::Create( const videoOptions& options )
+{
+	mjpegOutput* output = new mjpegOutput(options);
+
+	if( !output->init() )
+	{
+		delete output;
+		return NULL;
+	}
+
+	return output;
+}
+
+
+// Create
+mjpegOutput* mjpegOutput::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// init
+bool mjpegOutput::init()
+{
+	const URI& uri = mOptions.resource;
+
+	const uint16_t port = (uri.port > 0) ? uri.port : MJPEG_OUTPUT_DEFAULT_PORT;
+
+	mPath = (uri.path.size() > 0 && uri.path[0] == '/') ? uri.path : MJPEG_OUTPUT_DEFAULT_PATH;
+	mServer = WebRTCServer::Create(port, mOptions.stunServer.c_str(), mOptions.sslCert.c_str(), mOptions.sslKey.c_str());
+
+	if( !mServer )
+	{
+		LogError(LOG_VIDEO "mjpegOutput -- failed to create the HTTP server on port %hu\n", port);
+		return false;
+	}
+
+	mServer->AddRoute(mPath.c_str(), onRequest, this);
+
+	mOptions.codec = videoOptions::CODEC_MJPEG;
+	mStreaming = true;
+
+	LogSuccess(LOG_VIDEO "mjpegOutput -- serving MJPEG @ %s://%s:%hu%s\n", mServer->HasHTTPS() ? "https" : "http", (uri.location.size() > 0 && uri.location != "@") ? uri.location.c_str() : "0.0.0.0", port, mPath.c_str());
+	return true;
+}
+
+
+// appendJPEG (stb_image_write callback)
+static void appendJPEG( void* context, void* data, int size )
+{
+	std::vector<unsigned char>* jpeg = (std::vector<unsigned char>*)context;
+	jpeg->insert(jpeg->end(), (unsigned char*)data, (unsigned char*)data + size);
+}
+
+
+// encode
+bool mjpegOutput::encode( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	// nvJPEG can compress rgb8/rgba8 directly, other formats get converted first
+	bool encoded = false;
+
+	if( format == IMAGE_RGB8 || format == IMAGE_RGBA8 )
+		encoded = jpegHardwareEncode(image, width, height, format, MJPEG_OUTPUT_QUALITY, mJPEG);
+
+	if( !encoded )
+	{
+		const size_t size = imageFormatSize(IMAGE_RGB8, width, height);
+
+		if( size != mRGBSize )
+		{
+			CUDA_FREE_HOST(mRGB);
+			mRGBSize = 0;
+
+			if( !cudaAllocMapped(&mRGB, size) )
+				return false;
+
+			mRGBSize = size;
+		}
+
+		if( CUDA_FAILED(cudaConvertColor(image, format, mRGB, IMAGE_RGB8, width, height)) )
+			return false;
+
+		if( CUDA_FAILED(cudaStreamSynchronize(NULL)) )
+			return false;
+
+		if( format != IMAGE_RGB8 && format != IMAGE_RGBA8 )
+			encoded = jpegHardwareEncode(mRGB, width, height, IMAGE_RGB8, MJPEG_OUTPUT_QUALITY, mJPEG);
+	}
+
+	// fall back to compressing on the CPU
+	if( !encoded )
+	{
+		mJPEG.clear();
+
+		if( !stbi_write_jpg_to_func(appendJPEG, &mJPEG, width, height, 3, mRGB, MJPEG_OUTPUT_QUALITY) )
+		{
+			LogError(LOG_VIDEO "mjpegOutput -- failed to compress %ux%u frame\n", width, height);
+			return false;
+		}
+	}
+
+	// replace the latest frame that gets sent to the clients
+	SoupBuffer* frame = soup_buffer_new(SOUP_MEMORY_COPY, mJPEG.data(), mJPEG.size());
+
+	mFrameMutex.Lock();
+
+	if( mFrame != NULL )
+		soup_buffer_free(mFrame);
+
+	mFrame = frame;
+	mFrameMutex.Unlock();
+
+	return true;
+}
+
+
+// Render
+bool mjpegOutput::Render( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !image || width == 0 || height == 0 )
+		return false;
+
+	const bool substreams_success = videoOutput::Render(image, width, height, format);
+
+	if( !mServer )
+		return false;
+
+	// only compress the frames while somebody is watching
+	if( mNumClients > 0 )
+	{
+		if( !encode(image, width, height, format) )
+			return false;
+
+		mServer->Invoke(onFrame, this);
+	}
+
+	mOptions.width  = width;
+	mOptions.height = height;
+	mOptions.frameCount++;
+
+	return substreams_success;
+}
+
+
+// sendFrame (called from the server's thread)
+void mjpegOutput::sendFrame( Client* client, SoupBuffer* frame )
+{
+	// skip the frame if the client is still busy with the previous one
+	if( client->pending > 0 )
+		return;
+
+	char header[128];
+	const int headerLength = snprintf(header, sizeof(header), "--" MJPEG_OUTPUT_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n", frame->length);
+
+	soup_message_body_append(client->message->response_body, SOUP_MEMORY_COPY, header, headerLength);
+	soup_message_body_append_buffer(client->message->response_body, frame);
+	soup_message_body_append(client->message->response_body, SOUP_MEMORY_STATIC, "\r\n", 2);
+
+	client->pending += 3;
+	soup_server_unpause_message(client->output->mServer->GetSoupServer(), client->message);
+}
+
+
+// onFrame (called from the server's thread)
+gboolean mjpegOutput::onFrame( void* user_data )
+{
+	mjpegOutput* output = (mjpegOutput*)user_data;
+
+	output->mFrameMutex.Lock();
+	SoupBuffer* frame = (output->mFrame != NULL) ? soup_buffer_copy(output->mFrame) : NULL;
+	output->mFrameMutex.Unlock();
+
+	if( !frame )
+		return G_SOURCE_REMOVE;
+
+	// every client gets a reference to the same buffer
+	for( size_t n=0; n < output->mClients.size(); n++ )
+		output->sendFrame(output->mClients[n], frame);
+
+	soup_buffer_free(frame);
+	return G_SOURCE_REMOVE;
+}
+
+
+// onRequest (called from the server's thread)
+void mjpegOutput::onRequest( SoupServer* soup_server, SoupMessage* message, const char* path, GHashTable* query, SoupClientContext* client_context, void* user_data )
+{
+	mjpegOutput* output = (mjpegOutput*)user_data;
+
+	if( !output )
+	{
+		soup_message_set_status(message, SOUP_STATUS_INTERNAL_SERVER_ERROR);
+		return;
+	}
+
+	if( message->method != SOUP_METHOD_GET )
+	{
+		soup_message_set_status(message, SOUP_STATUS_NOT_IMPLEMENTED);
+		return;
+	}
+
+	// stream the frames as a never-ending multipart response
+	soup_message_set_status(message, SOUP_STATUS_OK);
+	soup_message_headers_set_content_type(message->response_headers, "multipart/x-mixed-replace; boundary=" MJPEG_OUTPUT_BOUNDARY, NULL);
+	soup_message_headers_set_encoding(message->response_headers, SOUP_ENCODING_CHUNKED);
+	soup_message_headers_replace(message->response_headers, "Cache-Control", "no-cache, no-store");
+	soup_message_body_set_accumulate(message->response_body, FALSE);
+
+	Client* client = new Client();
+
+	client->output  = output;
+	client->message = message;
+	client->pending = 0;
+
+	g_signal_connect(message, "wrote-chunk", G_CALLBACK(onWroteChunk), client);
+	g_signal_connect(message, "finished", G_CALLBACK(onFinished), client);
+
+	output->mClients.push_back(client);
+	output->mNumClients = output->mClients.size();
+
+	LogVerbose(LOG_VIDEO "mjpegOutput -- %s connected to %s (%zu clients)\n", soup_client_context_get_host(client_context), output->mPath.c_str(), output->mClients.size());
+
+	// send the latest frame right away (if there is one)
+	soup_server_pause_message(soup_server, message);
+
+	output->mFrameMutex.Lock();
+
+	if( output->mFrame != NULL )
+		output->sendFrame(client, output->mFrame);
+
+	output->mFrameMutex.Unlock();
+}
+
+
+// onWroteChunk (called from the server's thread)
+void mjpegOutput::onWroteChunk( SoupMessage* message, void* user_data )
+{
+	Client* client = (Client*)user_data;
+
+	if( client->pending > 0 )
+		client->pending--;
+}
+
+
+// onFinished (called from the server's thread when the client disconnects)
+void mjpegOutput::onFinished( SoupMessage* message, void* user_data )
+{
+	Client* client = (Client*)user_data;
+	mjpegOutput* output = client->output;
+
+	output->mClients.erase(std::remove(output->mClients.begin(), output->mClients.end(), client), output->mClients.end());
+	output->mNumClients = output->mClients.size();
+
+	LogVerbose(LOG_VIDEO "mjpegOutput -- client disconnected from %s (%zu clients)\n", output->mPath.c_str(), output->mClients.size());
+	delete client;
+}
+
+
+// onDestroy (called from the server's thread)
+gboolean mjpegOutput::onDestroy( void* user_data )
+{
+	mjpegOutput* output = (mjpegOutput*)user_data;
+
+	for( size_t n=0; n < output->mClients.size(); n++ )
+	{
+		Client* client = output->mClients[n];
+
+		g_signal_handlers_disconnect_by_data(client->message, client);
+
+		soup_message_body_complete(client->message->response_body);
+		soup_server_unpause_message(output->mServer->GetSoupServer(), client->message);
+
+		delete client;
+	}
+
+	output->mClients.clear();
+	output->mNumClients = 0;
+
+	output->mDestroyEvent.Wake();
+	return G_SOURCE_REMOVE;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __MJPEG_OUTPUT_H_
+#define __MJPEG_OUTPUT_H_
+
+
+#include "videoOutput.h"
+#include "WebRTCServer.h"
+#include "Event.h"
+#include "Mutex.h"
+
+#include <atomic>
+#include <vector>
+
+
+/**
+ * The port that mjpegOutput serves on if the URI doesn't have one.
+ * @ingroup video
+ */
+#define MJPEG_OUTPUT_DEFAULT_PORT 8080
+
+/**
+ * The path that mjpegOutput serves on if the URI doesn't have one.
+ * @ingroup video
+ */
+#define MJPEG_OUTPUT_DEFAULT_PATH "/mjpeg"
+
+/**
+ * The JPEG quality level (between 1 and 100) of the frames sent by mjpegOutput.
+ * @ingroup video
+ */
+#define MJPEG_OUTPUT_QUALITY 75
+
+/**
+ * The boundary string that separates the frames in the multipart response.
+ * @ingroup video
+ */
+#define MJPEG_OUTPUT_BOUNDARY "mjpegframe"
+
+
+/**
+ * Serve a live preview of the frames as Motion JPEG over HTTP (`mjpeg://@:<port>/<path>`
+ * or `http://@:<port>/<path>`), which can be viewed directly in a browser or with tools
+ * like VLC and ffplay, and is lighter-weight than WebRTC for debugging from many clients.
+ *
+ * The HTTP server is the one from WebRTCServer, so it can share a port with WebRTC streams
+ * (and their viewer pages).  Each frame is compressed once with the GPU (nvJPEG) if it's
+ * available, or else on the CPU, and only when there are clients connected.  The latest
+ * JPEG is shared by every client as a `multipart/x-mixed-replace` response, and a client
+ * whose connection is still busy sending the previous frame skips the new one, so slow
+ * clients don't hold back the others (or the application).
+ *
+ * @note mjpegOutput implements the videoOutput interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see videoOutput
+ * @ingroup video
+ */
+class mjpegOutput : public videoOutput
+{
+public:
+	/**
+	 * Create an mjpegOutput instance from a resource URI and optional videoOptions.
+	 */
+	static mjpegOutput* Create( const char* resource, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Create an mjpegOutput instance from the provided video options.
+	 */
+	static mjpegOutput* Create( const videoOptions& options );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~mjpegOutput();
+
+	/**
+	 * Compress and serve the next frame.
+	 * @see videoOutput::Render()
+	 */
+	template<typename T> bool Render( T* image, uint32_t width, uint32_t height )		{ return Render((void*)image, width, height, imageFormatFromType<T>()); }
+	
+	/**
+	 * Compress and serve the next frame.
+	 * @see videoOutput::Render()
+	 */
+	virtual bool Render( void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	/**
+	 * Return the number of clients that are connected.
+	 */
+	inline uint32_t GetNumClients() const		{ return mNumClients; }
+
+	/**
+	 * Return the interface type (mjpegOutput::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of mjpegOutput class.
+	 */
+	static const uint32_t Type = (1 << 16);
+
+protected:
+	mjpegOutput( const videoOptions& options );
+
+	bool init();
+	bool encode( void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	struct Client
+	{
+		mjpegOutput*  output;
+		SoupMessage*  message;
+		uint32_t      pending;	// chunks that were queued but not written yet
+	};
+
+	void sendFrame( Client* client, SoupBuffer* frame );
+
+	static void onRequest( SoupServer* soup_server, SoupMessage* message, const char* path, GHashTable* query, SoupClientContext* client_context, void* user_data );
+	static void onWroteChunk( SoupMessage* message, void* user_data );
+	static void onFinished( SoupMessage* message, void* user_data );
+	static gboolean onFrame( void* user_data );
+	static gboolean onDestroy( void* user_data );
+
+	WebRTCServer* mServer;
+	std::string   mPath;
+
+	std::vector<Client*> mClients;	// only accessed from the server's thread
+	std::atomic<uint32_t> mNumClients;
+
+	SoupBuffer*  mFrame;		// the latest JPEG (protected by mFrameMutex)
+	Mutex        mFrameMutex;
+	Event        mDestroyEvent;
+
+	void*    mRGB;			// mapped memory that the frames get converted into for compression
+	size_t   mRGBSize;
+
+	std::vector<unsigned char> mJPEG;
+};
+
+#endif
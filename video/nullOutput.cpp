@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nullOutput.h"
+
+#include "cudaUtility.h"
+#include "logging.h"
+
+#include <time.h>
+
+
+// constructor
+nullOutput::nullOutput( const videoOptions& options ) : videoOutput(options)
+{
+	mSync       = (mOptions.resource.location == "sync");
+	mFrameCount = 0;
+	mLastTime   = 0;
+	mStreaming  = true;
+
+	mOptions.frameRate = 0;
+}
+
+
+// destructor
+nullOutput::~nullOutput()
+{
+
+}
+
+
+// Create
+nullOutput* nullOutput::Create( const videoOptions& options )
+{
+	return new nullOutput(options);
+}
+
+
+// Create
+nullOutput* nullOutput::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// Render
+bool nullOutput::Render( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !image || width == 0 || height == 0 )
+		return false;
+
+	if( mSync )
+		CUDA(cudaDeviceSynchronize());
+
+	// update the framerate (smoothed over the recent frames)
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	const uint64_t now = (uint64_t)t.tv_sec * uint64_t(1000000000) + (uint64_t)t.tv_nsec;
+
+	if( mLastTime != 0 && now > mLastTime )
+	{
+		const float fps = 1.0e9f / (now - mLastTime);
+		mOptions.frameRate = (mOptions.frameRate > 0) ? mOptions.frameRate * 0.9f + fps * 0.1f : fps;
+	}
+
+	mLastTime = now;
+	mOptions.width  = width;
+	mOptions.height = height;
+	mFrameCount++;
+
+	// render sub-streams
+	return videoOutput::Render(image, width, height, format);
+}
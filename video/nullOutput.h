@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __NULL_OUTPUT_H_
+#define __NULL_OUTPUT_H_
+
+
+#include "videoOutput.h"
+
+
+/**
+ * Video output that consumes frames and discards them (`null://`), for benchmarking
+ * capture, decoding and processing in isolation from any real output.
+ *
+ * Each call to Render() counts the frame and updates the framerate that's returned
+ * by GetFrameRate().  With `null://sync`, Render() also synchronizes the GPU so that
+ * the measured rate includes the processing that was queued for the frame.
+ *
+ * Unlike videoOutput::CreateNullOutput(), this is created from a resource URI,
+ * so it can be selected from the command line like any other output.
+ *
+ * @note nullOutput implements the videoOutput interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see videoOutput
+ * @ingroup video
+ */
+class nullOutput : public videoOutput
+{
+public:
+	/**
+	 * Create a nullOutput instance from a resource URI and optional videoOptions.
+	 */
+	static nullOutput* Create( const char* resource="null://", const videoOptions& options=videoOptions() );
+
+	/**
+	 * Create a nullOutput instance from the provided video options.
+	 */
+	static nullOutput* Create( const videoOptions& options );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~nullOutput();
+
+	/**
+	 * Consume the next frame.
+	 * @see videoOutput::Render()
+	 */
+	template<typename T> bool Render( T* image, uint32_t width, uint32_t height )		{ return Render((void*)image, width, height, imageFormatFromType<T>()); }
+	
+	/**
+	 * Consume the next frame.
+	 * @see videoOutput::Render()
+	 */
+	virtual bool Render( void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	/**
+	 * Return the number of frames that have been consumed.
+	 */
+	inline uint64_t GetFrameCount() const		{ return mFrameCount; }
+
+	/**
+	 * Return the interface type (nullOutput::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of nullOutput class.
+	 */
+	static const uint32_t Type = (1 << 15);
+
+protected:
+	nullOutput( const videoOptions& options );
+
+	bool     mSync;		// synchronize the GPU on each frame
+	uint64_t mFrameCount;
+	uint64_t mLastTime;		// CLOCK_MONOTONIC time of the last frame
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __RAW_FRAME_FORMAT_H_
+#define __RAW_FRAME_FORMAT_H_
+
+
+#include <stdint.h>
+#include <string.h>
+
+
+/**
+ * File extension of the raw frame container used by rawFrameLoader and rawFrameWriter.
+ * @ingroup video
+ */
+#define RAW_FRAME_EXTENSION "jraw"
+
+/**
+ * Magic identifier at the start of raw frame container files.
+ * @ingroup video
+ */
+#define RAW_FRAME_MAGIC "JRAW"
+
+/**
+ * Version of the raw frame container format.
+ * @ingroup video
+ */
+#define RAW_FRAME_VERSION 1
+
+/**
+ * Alignment (in bytes) of the frames in the raw frame container, which is the
+ * page size so that each frame in the memory-mapped file starts on a new page.
+ * @ingroup video
+ */
+#define RAW_FRAME_ALIGNMENT 4096
+
+
+/**
+ * Header at the beginning of raw frame container files.
+ *
+ * The layout of the file is as follows:
+ *
+ *   - the header, padded to `dataOffset` bytes (RAW_FRAME_ALIGNMENT)
+ *   - `frameCount` uncompressed frames, each of `frameSize` bytes and starting
+ *     every `frameStride` bytes (the frames are padded to RAW_FRAME_ALIGNMENT)
+ *   - the index of `frameCount` uint64 timestamps (in nanoseconds) at `indexOffset`
+ *
+ * The header is written again with the frame count and the index offset
+ * when the file is closed.  If that didn't happen (for example, if the
+ * recording was interrupted), `indexOffset` is 0 and the frames can still
+ * be recovered from the size of the file.
+ *
+ * @ingroup video
+ */
+struct rawFrameHeader
+{
+	char     magic[4];		/**< RAW_FRAME_MAGIC */
+	uint32_t version;		/**< RAW_FRAME_VERSION */
+	uint32_t width;		/**< Width of the frames (in pixels) */
+	uint32_t height;		/**< Height of the frames (in pixels) */
+	uint32_t format;		/**< imageFormat of the frames */
+	float    frameRate;		/**< Framerate of the recording (in Hz) */
+	uint64_t frameSize;		/**< Size of each frame (in bytes) */
+	uint64_t frameStride;	/**< Distance between the start of each frame (in bytes) */
+	uint64_t frameCount;	/**< Number of frames in the file */
+	uint64_t dataOffset;	/**< Offset of the first frame from the start of the file (in bytes) */
+	uint64_t indexOffset;	/**< Offset of the timestamp index (in bytes), or 0 if missing */
+
+	/**
+	 * Check the magic identifier and version.
+	 */
+	inline bool IsValid() const	{ return (memcmp(magic, RAW_FRAME_MAGIC, 4) == 0) && (version == RAW_FRAME_VERSION); }
+};
+
+#endif
+
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rawFrameLoader.h"
+
+#include "cudaColorspace.h"
+#include "cudaMemoryPool.h"
+
+#include "filesystem.h"
+#include "logging.h"
+
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// IsSupportedExtension
+bool rawFrameLoader::IsSupportedExtension( const char* ext )
+{
+	if( !ext )
+		return false;
+
+	return (strcasecmp(ext, RAW_FRAME_EXTENSION) == 0);
+}
+
+
+// constructor
+rawFrameLoader::rawFrameLoader( const videoOptions& options ) : videoSource(options), mBuffers(0)
+{
+	mMapping     = NULL;
+	mMappingSize = 0;
+	mFrames      = NULL;
+	mFlipCapture = true;
+	mTimestamps  = NULL;
+	mNumFrames   = 0;
+	mNextFrame   = 0;
+	mLoopCount   = 0;
+	mEOS         = false;
+	mStaging     = NULL;
+
+	memset(&mHeader, 0, sizeof(rawFrameHeader));
+}
+
+
+// destructor
+rawFrameLoader::~rawFrameLoader()
+{
+	if( mStaging != NULL )
+		cudaFreePooled(mStaging);
+
+	if( mMapping != NULL )
+		munmap(mMapping, mMappingSize);
+}
+
+
+// Create
+rawFrameLoader* rawFrameLoader::Create( const videoOptions& options )
+{
+	rawFrameLoader* loader = new rawFrameLoader(options);
+
+	if( !loader->init() )
+	{
+		delete loader;
+		return NULL;
+	}
+
+	return loader;
+}
+
+
+// Create
+rawFrameLoader* rawFrameLoader::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// init
+bool rawFrameLoader::init()
+{
+	const std::string path = locateFile(mOptions.resource.location);
+
+	if( path.length() == 0 )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- failed to find '%s'\n", mOptions.resource.location.c_str());
+		return false;
+	}
+
+	// map the entire file into memory
+	const int fd = open(path.c_str(), O_RDONLY);
+
+	if( fd < 0 )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- failed to open '%s'\n", path.c_str());
+		return false;
+	}
+
+	struct stat fileStat;
+
+	if( fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(rawFrameHeader) )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- '%s' is too small to be a raw frame file\n", path.c_str());
+		close(fd);
+		return false;
+	}
+
+	mMappingSize = fileStat.st_size;
+	mMapping = (uint8_t*)mmap(NULL, mMappingSize, PROT_READ, MAP_SHARED, fd, 0);
+
+	close(fd);	// the mapping stays valid after the file is closed
+
+	if( mMapping == MAP_FAILED )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- failed to memory-map '%s'\n", path.c_str());
+		mMapping = NULL;
+		return false;
+	}
+
+	// validate the header
+	memcpy(&mHeader, mMapping, sizeof(rawFrameHeader));
+
+	if( !mHeader.IsValid() || mHeader.frameSize == 0 || mHeader.frameStride < mHeader.frameSize ||
+	    mHeader.frameSize != imageFormatSize((imageFormat)mHeader.format, mHeader.width, mHeader.height) )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- '%s' has an invalid header\n", path.c_str());
+		return false;
+	}
+
+	if( mHeader.dataOffset < sizeof(rawFrameHeader) || mHeader.dataOffset >= mMappingSize )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- '%s' has an invalid data offset (%llu)\n", path.c_str(), (unsigned long long)mHeader.dataOffset);
+		return false;
+	}
+
+	mFrames = mMapping + mHeader.dataOffset;
+
+	// use the index if the file was finalized, otherwise recover the frames from its size
+	// (the checks are divided through by the sizes so that a malformed header can't overflow them)
+	if( mHeader.indexOffset > 0 )
+	{
+		if( mHeader.indexOffset < mHeader.dataOffset || mHeader.indexOffset > mMappingSize ||
+		    mHeader.frameCount > (mHeader.indexOffset - mHeader.dataOffset) / mHeader.frameStride ||
+		    mHeader.frameCount > (mMappingSize - mHeader.indexOffset) / sizeof(uint64_t) )
+		{
+			LogError(LOG_VIDEO "rawFrameLoader -- '%s' is truncated or its index is invalid (%llu frames at offset %llu, file is %zu bytes)\n",
+					path.c_str(), (unsigned long long)mHeader.frameCount, (unsigned long long)mHeader.indexOffset, mMappingSize);
+			return false;
+		}
+
+		mNumFrames  = mHeader.frameCount;
+		mTimestamps = (const uint64_t*)(mMapping + mHeader.indexOffset);
+	}
+	else
+	{
+		mNumFrames = (mMappingSize - mHeader.dataOffset) / mHeader.frameStride;
+		LogWarning(LOG_VIDEO "rawFrameLoader -- '%s' is missing its index, recovered %llu frames\n", path.c_str(), (unsigned long long)mNumFrames);
+	}
+
+	if( mNumFrames == 0 )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- '%s' doesn't contain any frames\n", path.c_str());
+		return false;
+	}
+
+	mOptions.width     = mHeader.width;
+	mOptions.height    = mHeader.height;
+	mOptions.frameRate = mHeader.frameRate;
+	mOptions.codec     = videoOptions::CODEC_RAW;
+	mRawFormat         = (imageFormat)mHeader.format;
+
+	LogVerbose(LOG_VIDEO "rawFrameLoader -- opened '%s' (%llu frames, %ux%u %s)\n", path.c_str(), (unsigned long long)mNumFrames, 
+			 mHeader.width, mHeader.height, imageFormatToStr(mRawFormat));
+
+	return true;
+}
+
+
+// GetTimestamp
+uint64_t rawFrameLoader::GetTimestamp( uint64_t frame ) const
+{
+	if( !mTimestamps || frame >= mNumFrames )
+		return 0;
+
+	return mTimestamps[frame];
+}
+
+
+// Seek
+bool rawFrameLoader::Seek( uint64_t frame )
+{
+	if( frame >= mNumFrames )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader::Seek() -- frame %llu is out of range (%llu frames)\n", (unsigned long long)frame, (unsigned long long)mNumFrames);
+		return false;
+	}
+
+	mNextFrame = frame;
+	mEOS = false;
+
+	return true;
+}
+
+
+// Capture
+bool rawFrameLoader::Capture( void** output, imageFormat format, uint64_t timeout )
+{
+	// verify the output pointer exists
+	if( !output )
+		return false;
+
+	// confirm the stream is open
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	const uint32_t width  = mHeader.width;
+	const uint32_t height = mHeader.height;
+
+	const imageFormat frameFormat = (imageFormat)mHeader.format;
+	const size_t outputSize = imageFormatSize(format, width, height);
+
+	// allocate the ring buffers for the requested format
+	if( !mBuffers.Alloc(mOptions.numBuffers, outputSize, mOptions.zeroCopy ? RingBuffer::ZeroCopy : 0) )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- failed to allocate %u buffers (%zu bytes each)\n", mOptions.numBuffers, outputSize);
+		return false;
+	}
+
+	void* nextBuffer = mBuffers.Next(RingBuffer::Write);
+
+	if( !nextBuffer )
+		return false;
+
+	// copy the frame out of the mapping, converting it if needed
+	const uint64_t frameOffset = mHeader.dataOffset + mNextFrame * mHeader.frameStride;
+
+	if( frameOffset + mHeader.frameStride > mMappingSize )
+	{
+		LogError(LOG_VIDEO "rawFrameLoader -- frame %llu is past the end of the file\n", (unsigned long long)mNextFrame);
+		return false;
+	}
+
+	const uint8_t* frame = mFrames + mNextFrame * mHeader.frameStride;
+
+	if( mNextFrame + 1 < mNumFrames )
+		madvise((void*)(frame + mHeader.frameStride), mHeader.frameStride, MADV_WILLNEED);	// start reading ahead
+
+	if( format == frameFormat )
+	{
+		if( CUDA_FAILED(cudaMemcpy(nextBuffer, frame, mHeader.frameSize, cudaMemcpyHostToDevice)) )
+			return false;
+	}
+	else
+	{
+		if( !mStaging && !cudaAllocMappedPooled(&mStaging, mHeader.frameSize) )
+			return false;
+
+		memcpy(mStaging, frame, mHeader.frameSize);
+
+		if( CUDA_FAILED(cudaConvertColor(mStaging, frameFormat, nextBuffer, format, width, height)) )
+		{
+			LogError(LOG_VIDEO "rawFrameLoader -- unsupported image format conversion (%s -> %s)\n", imageFormatToStr(frameFormat), imageFormatToStr(format));
+			return false;
+		}
+
+		// the staging buffer gets re-used by the next frame
+		CUDA(cudaStreamSynchronize(NULL));
+	}
+
+	mLastTimestamp = GetTimestamp(mNextFrame);
+
+	// advance to the next frame
+	mNextFrame++;
+
+	if( mNextFrame >= mNumFrames )
+	{
+		if( isLooping() )
+		{
+			mNextFrame = 0;
+			mLoopCount++;
+		}
+		else
+		{
+			mEOS = true;
+			mStreaming = false;
+		}
+	}
+
+	*output = nextBuffer;
+	mOptions.frameCount++;
+
+	return flipCapture(output, format);
+}
+
+
+// Open
+bool rawFrameLoader::Open()
+{
+	if( mEOS )
+	{
+		LogWarning(LOG_VIDEO "rawFrameLoader -- End of Stream (EOS) has been reached, stream has been closed\n");
+		return false;
+	}
+
+	mStreaming = true;
+	return true;
+}
+
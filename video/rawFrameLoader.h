@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __RAW_FRAME_LOADER_H_
+#define __RAW_FRAME_LOADER_H_
+
+
+#include "videoSource.h"
+#include "rawFrameFormat.h"
+
+#include "RingBuffer.h"
+
+
+/**
+ * Replay uncompressed frames from a raw frame container file (`.jraw`)
+ * that was recorded with rawFrameWriter.
+ *
+ * The file is memory-mapped, so there's no decoding involved and frames
+ * are copied straight from the page cache into the CUDA ring buffers.
+ * The frames can also be accessed randomly by index with Seek().
+ *
+ * Looping is supported with the videoOptions::loop setting (`--input-loop`),
+ * and frames are converted with cudaConvertColor() if Capture() requests
+ * a different format than they were recorded in.
+ *
+ * @note rawFrameLoader implements the videoSource interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see rawFrameFormat.h for the layout of the container.
+ * @see videoSource
+ * @ingroup video
+ */
+class rawFrameLoader : public videoSource
+{
+public:
+	/**
+	 * Create a rawFrameLoader instance from a path and optional videoOptions.
+	 */
+	static rawFrameLoader* Create( const char* path, const videoOptions& options=videoOptions() );
+	
+	/**
+	 * Create a rawFrameLoader instance from the provided video options.
+	 */
+	static rawFrameLoader* Create( const videoOptions& options );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~rawFrameLoader();
+
+	/**
+	 * Load the next frame.
+	 * @see videoSource::Capture()
+	 */
+	template<typename T> bool Capture( T** image, uint64_t timeout=DEFAULT_TIMEOUT )		{ return Capture((void**)image, imageFormatFromType<T>(), timeout); }
+	
+	/**
+	 * Load the next frame.
+	 * @see videoSource::Capture()
+	 */
+	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT );
+
+	/**
+	 * Open the stream.
+	 * @see videoSource::Open()
+	 */
+	virtual bool Open();
+
+	/**
+	 * Seek so that the next call to Capture() returns the specified frame.
+	 * @returns `false` if the frame index was out of range, otherwise `true`.
+	 */
+	bool Seek( uint64_t frame );
+
+	/**
+	 * Return the number of frames in the file.
+	 */
+	inline uint64_t GetNumFrames() const		{ return mNumFrames; }
+
+	/**
+	 * Return the timestamp (in nanoseconds) that a frame was recorded at,
+	 * or 0 if the file doesn't have a timestamp index.
+	 */
+	uint64_t GetTimestamp( uint64_t frame ) const;
+
+	/**
+	 * Return true if End Of Stream (EOS) has been reached.
+	 */
+	inline bool IsEOS() const				{ return mEOS; }
+
+	/**
+	 * Return the interface type (rawFrameLoader::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of rawFrameLoader class.
+	 */
+	static const uint32_t Type = (1 << 6);
+
+	/**
+	 * Return true if the extension is the raw frame container (RAW_FRAME_EXTENSION).
+	 * @param ext string containing the extension to be checked (should not contain leading dot)
+	 */
+	static bool IsSupportedExtension( const char* ext );
+
+protected:
+	rawFrameLoader( const videoOptions& options );
+
+	bool init();
+
+	inline bool isLooping() const { return (mOptions.loop < 0) || ((mOptions.loop > 0) && (mLoopCount < mOptions.loop)); }
+
+	uint8_t* mMapping;
+	size_t   mMappingSize;
+
+	const uint8_t*  mFrames;
+	const uint64_t* mTimestamps;
+
+	uint64_t mNumFrames;
+	uint64_t mNextFrame;
+	size_t   mLoopCount;
+	bool     mEOS;
+
+	rawFrameHeader mHeader;
+	RingBuffer     mBuffers;
+	void*          mStaging;	// for converting formats
+};
+
+#endif
+
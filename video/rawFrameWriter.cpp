@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rawFrameWriter.h"
+
+#include "cudaMemoryPool.h"
+#include "timespec.h"
+#include "logging.h"
+
+#include <strings.h>
+
+
+// IsSupportedExtension
+bool rawFrameWriter::IsSupportedExtension( const char* ext )
+{
+	if( !ext )
+		return false;
+
+	return (strcasecmp(ext, RAW_FRAME_EXTENSION) == 0);
+}
+
+
+// constructor
+rawFrameWriter::rawFrameWriter( const videoOptions& options ) : videoOutput(options)
+{
+	mFile    = NULL;
+	mStaging = NULL;
+
+	memset(&mHeader, 0, sizeof(rawFrameHeader));
+}
+
+
+// destructor
+rawFrameWriter::~rawFrameWriter()
+{
+	Close();
+
+	if( mStaging != NULL )
+	{
+		cudaFreePooled(mStaging);
+		mStaging = NULL;
+	}
+}
+
+
+// Create
+rawFrameWriter* rawFrameWriter::Create( const videoOptions& options )
+{
+	rawFrameWriter* writer = new rawFrameWriter(options);
+
+	writer->mFile = fopen(options.resource.location.c_str(), "wb");
+
+	if( !writer->mFile )
+	{
+		LogError(LOG_VIDEO "rawFrameWriter -- failed to open '%s' for writing\n", options.resource.location.c_str());
+		delete writer;
+		return NULL;
+	}
+
+	writer->mStreaming = true;
+	return writer;
+}
+
+
+// Create
+rawFrameWriter* rawFrameWriter::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// writeHeader
+bool rawFrameWriter::writeHeader()
+{
+	std::vector<uint8_t> header(RAW_FRAME_ALIGNMENT, 0);
+	memcpy(header.data(), &mHeader, sizeof(rawFrameHeader));
+
+	if( fseek(mFile, 0, SEEK_SET) != 0 || fwrite(header.data(), 1, header.size(), mFile) != header.size() )
+	{
+		LogError(LOG_VIDEO "rawFrameWriter -- failed to write header to '%s'\n", mOptions.resource.location.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+// Render
+bool rawFrameWriter::Render( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !image || width == 0 || height == 0 )
+		return false;
+
+	const bool substreams_success = videoOutput::Render(image, width, height, format);
+
+	if( !mFile )
+		return false;
+
+	const size_t frameSize = imageFormatSize(format, width, height);
+
+	// the first frame determines the layout of the file
+	if( mHeader.frameSize == 0 )
+	{
+		memcpy(mHeader.magic, RAW_FRAME_MAGIC, 4);
+
+		mHeader.version     = RAW_FRAME_VERSION;
+		mHeader.width       = width;
+		mHeader.height      = height;
+		mHeader.format      = format;
+		mHeader.frameRate   = mOptions.frameRate;
+		mHeader.frameSize   = frameSize;
+		mHeader.frameStride = ((frameSize + RAW_FRAME_ALIGNMENT - 1) / RAW_FRAME_ALIGNMENT) * RAW_FRAME_ALIGNMENT;
+		mHeader.dataOffset  = RAW_FRAME_ALIGNMENT;
+
+		if( !writeHeader() )
+			return false;
+
+		if( !cudaAllocMappedPooled(&mStaging, mHeader.frameStride) )
+			return false;
+	}
+	else if( width != mHeader.width || height != mHeader.height || format != (imageFormat)mHeader.format )
+	{
+		LogError(LOG_VIDEO "rawFrameWriter -- frame (%ux%u %s) doesn't match the stream (%ux%u %s)\n", width, height, imageFormatToStr(format),
+			    mHeader.width, mHeader.height, imageFormatToStr((imageFormat)mHeader.format));
+		return false;
+	}
+
+	// copy the frame into CPU-accessible memory (this waits for it to be ready)
+	if( CUDA_FAILED(cudaMemcpy(mStaging, image, frameSize, cudaMemcpyDefault)) )
+		return false;
+
+	if( fwrite(mStaging, 1, mHeader.frameStride, mFile) != mHeader.frameStride )
+	{
+		LogError(LOG_VIDEO "rawFrameWriter -- failed to write frame %zu to '%s'\n", mTimestamps.size(), mOptions.resource.location.c_str());
+		return false;
+	}
+
+	const timespec time = timestamp();
+	mTimestamps.push_back((uint64_t)time.tv_sec * 1000000000ull + time.tv_nsec);
+
+	mOptions.width  = width;
+	mOptions.height = height;
+	mOptions.frameCount++;
+
+	return substreams_success;
+}
+
+
+// Close
+void rawFrameWriter::Close()
+{
+	if( !mFile )
+		return;
+
+	// append the timestamp index and finalize the header
+	if( mHeader.frameSize > 0 )
+	{
+		mHeader.frameCount  = mTimestamps.size();
+		mHeader.indexOffset = mHeader.dataOffset + mHeader.frameCount * mHeader.frameStride;
+
+		if( fseek(mFile, mHeader.indexOffset, SEEK_SET) != 0 || fwrite(mTimestamps.data(), sizeof(uint64_t), mTimestamps.size(), mFile) != mTimestamps.size() )
+			LogError(LOG_VIDEO "rawFrameWriter -- failed to write timestamp index to '%s'\n", mOptions.resource.location.c_str());
+		else
+			writeHeader();
+
+		LogVerbose(LOG_VIDEO "rawFrameWriter -- wrote %zu frames to '%s'\n", mTimestamps.size(), mOptions.resource.location.c_str());
+	}
+
+	fclose(mFile);
+	mFile = NULL;
+
+	videoOutput::Close();
+}
+
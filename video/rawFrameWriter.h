@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __RAW_FRAME_WRITER_H_
+#define __RAW_FRAME_WRITER_H_
+
+
+#include "videoOutput.h"
+#include "rawFrameFormat.h"
+
+#include <stdio.h>
+#include <vector>
+
+
+/**
+ * Record uncompressed frames to a raw frame container file on disk (`.jraw`),
+ * which can be replayed at memory speed by rawFrameLoader.
+ *
+ * The frames are stored in the format that they were rendered in, along with
+ * the timestamp of when each one was received.  All of the frames in the file
+ * must have the same dimensions and format as the first frame.
+ *
+ * @note rawFrameWriter implements the videoOutput interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see rawFrameFormat.h for the layout of the container.
+ * @see videoOutput
+ * @ingroup video
+ */
+class rawFrameWriter : public videoOutput
+{
+public:
+	/**
+	 * Create a rawFrameWriter instance from a path and optional videoOptions.
+	 */
+	static rawFrameWriter* Create( const char* path, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Create a rawFrameWriter instance from the provided video options.
+	 */
+	static rawFrameWriter* Create( const videoOptions& options );
+
+	/**
+	 * Destructor (finalizes the file)
+	 */
+	virtual ~rawFrameWriter();
+
+	/**
+	 * Save the next frame.
+	 * @see videoOutput::Render()
+	 */
+	template<typename T> bool Render( T* image, uint32_t width, uint32_t height )		{ return Render((void*)image, width, height, imageFormatFromType<T>()); }
+	
+	/**
+	 * Save the next frame.
+	 * @see videoOutput::Render()
+	 */
+	virtual bool Render( void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	/**
+	 * Close the stream, and write the timestamp index and final header to the file.
+	 * @see videoOutput::Close()
+	 */
+	virtual void Close();
+
+	/**
+	 * Return the interface type (rawFrameWriter::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of rawFrameWriter class.
+	 */
+	static const uint32_t Type = (1 << 7);
+
+	/**
+	 * Return true if the extension is the raw frame container (RAW_FRAME_EXTENSION).
+	 * @param ext string containing the extension to be checked (should not contain leading dot)
+	 */
+	static bool IsSupportedExtension( const char* ext );
+
+protected:
+	rawFrameWriter( const videoOptions& options );
+
+	bool writeHeader();
+
+	FILE* mFile;
+	void* mStaging;
+
+	rawFrameHeader mHeader;
+	std::vector<uint64_t> mTimestamps;
+};
+
+#endif
+
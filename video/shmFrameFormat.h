@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __SHM_FRAME_FORMAT_H_
+#define __SHM_FRAME_FORMAT_H_
+
+
+#include <cuda_runtime.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <atomic>
+#include <string>
+
+
+/**
+ * Protocol of shared-memory frame streams (`shm://name`) used by shmFrameWriter and shmFrameReader.
+ * @ingroup video
+ */
+#define SHM_FRAME_PROTOCOL "shm"
+
+/**
+ * Prefix of the POSIX shared memory objects (under `/dev/shm`) that are created for each stream.
+ * @ingroup video
+ */
+#define SHM_FRAME_PREFIX "/jetson-utils.shm."
+
+/**
+ * Magic identifier at the start of the shared memory.
+ * @ingroup video
+ */
+#define SHM_FRAME_MAGIC 0x4A53484D	// 'JSHM'
+
+/**
+ * Version of the shared memory layout.
+ * @ingroup video
+ */
+#define SHM_FRAME_VERSION 1
+
+/**
+ * Maximum number of slots in the ring (the number used is videoOptions::numBuffers).
+ * @ingroup video
+ */
+#define SHM_FRAME_MAX_SLOTS 16
+
+/**
+ * Alignment (in bytes) of the frames that are stored in the shared memory.
+ * @ingroup video
+ */
+#define SHM_FRAME_ALIGNMENT 4096
+
+
+/**
+ * Where the frames of a shared memory stream are stored.
+ * @ingroup video
+ */
+enum shmFrameMemory
+{
+	SHM_FRAME_HOST = 0,		/**< The frames follow the header in the shared memory, which each process maps into CUDA (Jetson) */
+	SHM_FRAME_IPC  = 1		/**< The frames are in device memory of the writer process, exported with CUDA IPC handles (dGPU) */
+};
+
+
+/**
+ * Slot of the shared memory ring that holds one frame.
+ *
+ * A slot is being written while its sequence is 0.  Readers increment `readers`
+ * before checking the sequence, and the writer clears the sequence before checking
+ * `readers`, so that the writer never overwrites a slot that a reader has acquired.
+ *
+ * @ingroup video
+ */
+struct shmFrameSlot
+{
+	std::atomic<uint64_t> sequence;	/**< Sequence number of the frame in the slot (starting at 1), or 0 while it's being written */
+	std::atomic<uint32_t> readers;	/**< Number of readers that currently have the frame acquired */
+	uint64_t timestamp;			/**< Time that the frame was written (in nanoseconds) */
+	cudaIpcMemHandle_t handle;		/**< CUDA IPC handle of the frame (SHM_FRAME_IPC) */
+};
+
+
+/**
+ * Header at the beginning of the shared memory of a stream.
+ *
+ * The writer creates the shared memory when the first frame is rendered, and readers
+ * attach to it when they're opened.  With SHM_FRAME_HOST, the frames are stored after
+ * the header at `dataOffset`, every `frameStride` bytes.
+ *
+ * The `futex` word gets incremented (and the readers woken) each time a frame is published,
+ * and `closed` is set when the writer exits so that readers can detach and wait for it to restart.
+ *
+ * @ingroup video
+ */
+struct shmFrameHeader
+{
+	uint32_t magic;		/**< SHM_FRAME_MAGIC */
+	uint32_t version;		/**< SHM_FRAME_VERSION */
+	uint32_t width;		/**< Width of the frames (in pixels) */
+	uint32_t height;		/**< Height of the frames (in pixels) */
+	uint32_t format;		/**< imageFormat of the frames */
+	uint32_t memory;		/**< shmFrameMemory type */
+	uint32_t numSlots;		/**< Number of slots in use */
+	int32_t  device;		/**< CUDA device of the writer */
+	uint64_t frameSize;		/**< Size of each frame (in bytes) */
+	uint64_t frameStride;	/**< Distance between the start of each frame (in bytes) */
+	uint64_t dataOffset;	/**< Offset of the first frame from the start of the shared memory (in bytes) */
+
+	std::atomic<uint32_t> latest;	/**< Index of the slot with the latest frame */
+	std::atomic<uint32_t> futex;		/**< Incremented each time a frame is published */
+	std::atomic<uint32_t> closed;	/**< Set when the writer has exited */
+
+	shmFrameSlot slots[SHM_FRAME_MAX_SLOTS];
+
+	/**
+	 * Check the magic identifier and version.
+	 */
+	inline bool IsValid() const	{ return (magic == SHM_FRAME_MAGIC) && (version == SHM_FRAME_VERSION) && (numSlots <= SHM_FRAME_MAX_SLOTS); }
+};
+
+
+/**
+ * Get the name of the shared memory object used by a stream.
+ * @ingroup video
+ */
+inline std::string shmFrameName( const std::string& stream )	{ return std::string(SHM_FRAME_PREFIX) + stream; }
+
+/**
+ * Wait for the futex word to change from `value`, or until the timeout (in milliseconds) expires.
+ * @returns `true` if the value may have changed, or `false` on timeout.
+ * @ingroup video
+ */
+inline bool shmFrameWait( std::atomic<uint32_t>* futex, uint32_t value, uint64_t timeout )
+{
+	const timespec ts = { (time_t)(timeout / 1000), (long)((timeout % 1000) * 1000000) };
+	const long result = syscall(SYS_futex, (uint32_t*)futex, FUTEX_WAIT, value, &ts, NULL, 0);
+	return (result == 0) || (errno != ETIMEDOUT);
+}
+
+/**
+ * Wake all of the processes waiting on the futex word.
+ * @ingroup video
+ */
+inline void shmFrameWake( std::atomic<uint32_t>* futex )
+{
+	syscall(SYS_futex, (uint32_t*)futex, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+#endif
+
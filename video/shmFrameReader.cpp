@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "shmFrameReader.h"
+
+#include "cudaColorspace.h"
+#include "timespec.h"
+#include "logging.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// how often to check for the writer, while waiting for it to create the stream
+#define SHM_ATTACH_INTERVAL 10
+
+
+// constructor
+shmFrameReader::shmFrameReader( const videoOptions& options ) : videoSource(options)
+{
+	mHeader      = NULL;
+	mMappingSize = 0;
+	mSequence    = 0;
+	mFlipCapture = true;
+	mAcquired    = -1;
+	mName        = shmFrameName(options.resource.location);
+
+	memset(mSlots, 0, sizeof(mSlots));
+
+	mBufferRGB.SetThreaded(false);
+}
+
+
+// destructor
+shmFrameReader::~shmFrameReader()
+{
+	Close();
+}
+
+
+// Create
+shmFrameReader* shmFrameReader::Create( const videoOptions& options )
+{
+	if( options.resource.location.size() == 0 )
+	{
+		LogError(LOG_VIDEO "shmFrameReader -- the stream name is missing (expected %s://name)\n", SHM_FRAME_PROTOCOL);
+		return NULL;
+	}
+
+	shmFrameReader* reader = new shmFrameReader(options);
+
+	reader->mOptions.codec = videoOptions::CODEC_RAW;
+
+	// the writer may not have started yet, so this isn't an error
+	if( !reader->attach() )
+		LogVerbose(LOG_VIDEO "shmFrameReader -- waiting for '%s' to be created\n", reader->mName.c_str());
+
+	return reader;
+}
+
+
+// Create
+shmFrameReader* shmFrameReader::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// attach
+bool shmFrameReader::attach()
+{
+	const int fd = shm_open(mName.c_str(), O_RDWR, 0);
+
+	if( fd < 0 )
+		return false;
+
+	struct stat info;
+
+	if( fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(shmFrameHeader) )
+	{
+		close(fd);
+		return false;
+	}
+
+	void* mapping = mmap(NULL, info.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if( mapping == MAP_FAILED )
+	{
+		LogError(LOG_VIDEO "shmFrameReader -- failed to map shared memory '%s'\n", mName.c_str());
+		return false;
+	}
+
+	shmFrameHeader* header = (shmFrameHeader*)mapping;
+
+	// the writer sets the magic once the header is complete
+	const bool valid = header->IsValid() && !header->closed;
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	if( !valid || (header->memory == SHM_FRAME_HOST && (size_t)info.st_size < header->dataOffset + header->numSlots * header->frameStride) )
+	{
+		munmap(mapping, info.st_size);
+		return false;
+	}
+
+	mHeader = header;
+	mMappingSize = info.st_size;
+
+	// map the frames into CUDA
+	if( mHeader->memory == SHM_FRAME_HOST )
+	{
+		uint8_t* frames = (uint8_t*)mapping + mHeader->dataOffset;
+
+		if( CUDA_FAILED(cudaHostRegister(frames, mHeader->numSlots * mHeader->frameStride, cudaHostRegisterMapped)) )
+		{
+			LogError(LOG_VIDEO "shmFrameReader -- failed to register shared memory '%s' with CUDA\n", mName.c_str());
+			detach();
+			return false;
+		}
+
+		for( uint32_t n=0; n < mHeader->numSlots; n++ )
+		{
+			if( CUDA_FAILED(cudaHostGetDevicePointer(&mSlots[n], frames + n * mHeader->frameStride, 0)) )
+			{
+				detach();
+				return false;
+			}
+		}
+	}
+	else
+	{
+		for( uint32_t n=0; n < mHeader->numSlots; n++ )
+		{
+			if( CUDA_FAILED(cudaIpcOpenMemHandle(&mSlots[n], mHeader->slots[n].handle, cudaIpcMemLazyEnablePeerAccess)) )
+			{
+				LogError(LOG_VIDEO "shmFrameReader -- failed to open CUDA IPC memory of '%s'\n", mName.c_str());
+				detach();
+				return false;
+			}
+		}
+	}
+
+	mRawFormat = (imageFormat)mHeader->format;
+
+	mOptions.width  = mHeader->width;
+	mOptions.height = mHeader->height;
+	mSequence = 0;
+
+	LogVerbose(LOG_VIDEO "shmFrameReader -- attached to '%s' (%ux%u %s, %s)\n", mName.c_str(), mHeader->width, mHeader->height, 
+			 imageFormatToStr(mRawFormat), (mHeader->memory == SHM_FRAME_HOST) ? "mapped memory" : "CUDA IPC");
+
+	return true;
+}
+
+
+// release
+void shmFrameReader::release()
+{
+	if( !mHeader || mAcquired < 0 )
+		return;
+
+	mHeader->slots[mAcquired].readers--;
+	mAcquired = -1;
+}
+
+
+// detach
+void shmFrameReader::detach()
+{
+	if( !mHeader )
+		return;
+
+	release();
+
+	if( mHeader->memory == SHM_FRAME_HOST )
+	{
+		if( mSlots[0] != NULL )
+			CUDA(cudaHostUnregister((uint8_t*)mHeader + mHeader->dataOffset));
+	}
+	else
+	{
+		for( uint32_t n=0; n < mHeader->numSlots; n++ )
+		{
+			if( mSlots[n] != NULL )
+				CUDA(cudaIpcCloseMemHandle(mSlots[n]));
+		}
+	}
+
+	munmap(mHeader, mMappingSize);
+
+	mHeader = NULL;
+	mMappingSize = 0;
+
+	memset(mSlots, 0, sizeof(mSlots));
+}
+
+
+// Close
+void shmFrameReader::Close()
+{
+	detach();
+	videoSource::Close();
+}
+
+
+// Capture
+bool shmFrameReader::Capture( void** output, imageFormat format, uint64_t timeout )
+{
+	// verify the output pointer exists
+	if( !output )
+		return false;
+
+	// confirm the stream is open
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	const double deadline = timeDouble() + timeout;
+
+	// acquire the latest frame, once there's a new one
+	int index = -1;
+
+	while( index < 0 )
+	{
+		// detach if the writer exited, and (re-)attach when it starts
+		if( mHeader != NULL && mHeader->closed )
+		{
+			LogVerbose(LOG_VIDEO "shmFrameReader -- the writer of '%s' has exited\n", mName.c_str());
+			detach();
+		}
+
+		if( !mHeader && !attach() )
+		{
+			if( timeDouble() >= deadline )
+				return false;
+
+			sleepMs(SHM_ATTACH_INTERVAL);
+			continue;
+		}
+
+		const uint32_t futex = mHeader->futex.load();
+		const uint32_t latest = mHeader->latest.load();
+
+		shmFrameSlot& slot = mHeader->slots[latest];
+		const uint64_t sequence = slot.sequence.load();
+
+		if( sequence != 0 && sequence != mSequence )
+		{
+			// the writer clears the sequence before checking the readers
+			slot.readers++;
+
+			if( slot.sequence.load() == sequence )
+			{
+				release();
+
+				index = latest;
+				mAcquired = latest;
+				mSequence = sequence;
+				break;
+			}
+
+			slot.readers--;
+			continue;
+		}
+
+		// wait for the writer to publish the next frame
+		const double remaining = deadline - timeDouble();
+
+		if( remaining <= 0 || !shmFrameWait(&mHeader->futex, futex, remaining) )
+			return false;
+	}
+
+	mLastTimestamp = mHeader->slots[index].timestamp;
+
+	if( format == mRawFormat )
+	{
+		*output = mSlots[index];
+		mOptions.frameCount++;
+		return flipCapture(output, format);
+	}
+
+	// convert the frame to the requested format
+	const size_t outputSize = imageFormatSize(format, mOptions.width, mOptions.height);
+
+	if( !mBufferRGB.Alloc(mOptions.numBuffers, outputSize, mOptions.zeroCopy ? RingBuffer::ZeroCopy : 0) )
+	{
+		LogError(LOG_VIDEO "shmFrameReader -- failed to allocate %u buffers (%zu bytes each)\n", mOptions.numBuffers, outputSize);
+		return false;
+	}
+
+	void* nextBuffer = mBufferRGB.Next(RingBuffer::Write);
+
+	if( !nextBuffer )
+		return false;
+
+	if( CUDA_FAILED(cudaConvertColor(mSlots[index], mRawFormat, nextBuffer, format, mOptions.width, mOptions.height)) )
+	{
+		LogError(LOG_VIDEO "shmFrameReader -- unsupported image format conversion (%s -> %s)\n", imageFormatToStr(mRawFormat), imageFormatToStr(format));
+		return false;
+	}
+
+	*output = nextBuffer;
+	mOptions.frameCount++;
+
+	return flipCapture(output, format);
+}
+
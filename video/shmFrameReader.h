@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __SHM_FRAME_READER_H_
+#define __SHM_FRAME_READER_H_
+
+
+#include "videoSource.h"
+#include "shmFrameFormat.h"
+
+#include "RingBuffer.h"
+
+
+/**
+ * Capture frames that another process shares through shared memory (`shm://name`) with shmFrameWriter.
+ *
+ * Capture() acquires the latest frame in the writer's lock-free slot ring and returns it
+ * without any copies, if it's requested in the same format that the frames were written in
+ * (otherwise the frame gets converted with cudaConvertColor()).  The frame stays acquired,
+ * so the writer won't overwrite it, until the next call to Capture() or Close().
+ * Any number of shmFrameReader's (in any number of processes) can read the same stream.
+ *
+ * The reader can be started before the writer, in which case Capture() times out until
+ * the writer publishes its first frame.  If the writer exits, the reader detaches and
+ * waits for a new writer of the stream, which can have different dimensions or format.
+ *
+ * @note shmFrameReader implements the videoSource interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see shmFrameFormat.h for the layout of the shared memory.
+ * @see videoSource
+ * @ingroup video
+ */
+class shmFrameReader : public videoSource
+{
+public:
+	/**
+	 * Create a shmFrameReader instance from a resource URI and optional videoOptions.
+	 */
+	static shmFrameReader* Create( const char* resource, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Create a shmFrameReader instance from the provided video options.
+	 */
+	static shmFrameReader* Create( const videoOptions& options );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~shmFrameReader();
+
+	/**
+	 * Capture the next frame.
+	 * @see videoSource::Capture()
+	 */
+	template<typename T> bool Capture( T** image, uint64_t timeout=DEFAULT_TIMEOUT )		{ return Capture((void**)image, imageFormatFromType<T>(), timeout); }
+	
+	/**
+	 * Capture the next frame.
+	 * @see videoSource::Capture()
+	 */
+	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT );
+
+	/**
+	 * Detach from the stream, releasing the frame that's currently acquired.
+	 * @see videoSource::Close()
+	 */
+	virtual void Close();
+
+	/**
+	 * Return the interface type (shmFrameReader::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of shmFrameReader class.
+	 */
+	static const uint32_t Type = (1 << 12);
+
+protected:
+	shmFrameReader( const videoOptions& options );
+
+	bool attach();
+	void detach();
+	void release();
+
+	std::string mName;		// name of the shared memory object
+
+	shmFrameHeader* mHeader;	// the mapped shared memory
+	size_t   mMappingSize;
+	uint64_t mSequence;		// sequence of the last frame that was captured
+	int      mAcquired;		// slot that's currently acquired
+
+	void* mSlots[SHM_FRAME_MAX_SLOTS];	// CUDA pointers to the frames
+
+	RingBuffer mBufferRGB;	// converted frames
+};
+
+#endif
+
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "shmFrameWriter.h"
+
+#include "cudaUtility.h"
+#include "timespec.h"
+#include "logging.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+
+// constructor
+shmFrameWriter::shmFrameWriter( const videoOptions& options ) : videoOutput(options)
+{
+	mHeader      = NULL;
+	mMappingSize = 0;
+	mSequence    = 0;
+	mName        = shmFrameName(options.resource.location);
+
+	memset(mSlots, 0, sizeof(mSlots));
+}
+
+
+// destructor
+shmFrameWriter::~shmFrameWriter()
+{
+	Close();
+}
+
+
+// Create
+shmFrameWriter* shmFrameWriter::Create( const videoOptions& options )
+{
+	if( options.resource.location.size() == 0 )
+	{
+		LogError(LOG_VIDEO "shmFrameWriter -- the stream name is missing (expected %s://name)\n", SHM_FRAME_PROTOCOL);
+		return NULL;
+	}
+
+	shmFrameWriter* writer = new shmFrameWriter(options);
+
+	writer->mOptions.codec = videoOptions::CODEC_RAW;
+	writer->mStreaming = true;
+
+	return writer;
+}
+
+
+// Create
+shmFrameWriter* shmFrameWriter::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// init
+bool shmFrameWriter::init( uint32_t width, uint32_t height, imageFormat format )
+{
+	int device = 0;
+	cudaDeviceProp props;
+
+	if( CUDA_FAILED(cudaGetDevice(&device)) || CUDA_FAILED(cudaGetDeviceProperties(&props, device)) )
+		return false;
+
+	// integrated GPUs share the physical memory, so the frames can live in the shared memory
+	const shmFrameMemory memory = props.integrated ? SHM_FRAME_HOST : SHM_FRAME_IPC;
+
+	const uint32_t numSlots = std::max(2u, std::min<uint32_t>(mOptions.numBuffers, SHM_FRAME_MAX_SLOTS));
+	const size_t frameSize = imageFormatSize(format, width, height);
+	const size_t frameStride = ((frameSize + SHM_FRAME_ALIGNMENT - 1) / SHM_FRAME_ALIGNMENT) * SHM_FRAME_ALIGNMENT;
+	const size_t dataOffset = ((sizeof(shmFrameHeader) + SHM_FRAME_ALIGNMENT - 1) / SHM_FRAME_ALIGNMENT) * SHM_FRAME_ALIGNMENT;
+
+	mMappingSize = dataOffset + ((memory == SHM_FRAME_HOST) ? numSlots * frameStride : 0);
+
+	// tell any readers that were attached to a stale stream (e.g. from a crashed writer) to detach
+	int fd = shm_open(mName.c_str(), O_RDWR, 0);
+
+	if( fd >= 0 )
+	{
+		LogWarning(LOG_VIDEO "shmFrameWriter -- replacing existing shared memory '%s'\n", mName.c_str());
+
+		shmFrameHeader* stale = (shmFrameHeader*)mmap(NULL, sizeof(shmFrameHeader), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+
+		if( stale != MAP_FAILED )
+		{
+			stale->closed = 1;
+			stale->futex++;
+			shmFrameWake(&stale->futex);
+			munmap(stale, sizeof(shmFrameHeader));
+		}
+
+		close(fd);
+		shm_unlink(mName.c_str());
+	}
+
+	// create the shared memory
+	fd = shm_open(mName.c_str(), O_CREAT|O_EXCL|O_RDWR, 0666);
+
+	if( fd < 0 )
+	{
+		LogError(LOG_VIDEO "shmFrameWriter -- failed to create shared memory '%s' (error %i)\n", mName.c_str(), errno);
+		return false;
+	}
+
+	if( ftruncate(fd, mMappingSize) != 0 )
+	{
+		LogError(LOG_VIDEO "shmFrameWriter -- failed to allocate %zu bytes of shared memory '%s'\n", mMappingSize, mName.c_str());
+		close(fd);
+		shm_unlink(mName.c_str());
+		return false;
+	}
+
+	void* mapping = mmap(NULL, mMappingSize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if( mapping == MAP_FAILED )
+	{
+		LogError(LOG_VIDEO "shmFrameWriter -- failed to map shared memory '%s'\n", mName.c_str());
+		shm_unlink(mName.c_str());
+		return false;
+	}
+
+	// the new shared memory is zeroed, so the slots start out empty
+	mHeader = (shmFrameHeader*)mapping;
+
+	mHeader->version     = SHM_FRAME_VERSION;
+	mHeader->width       = width;
+	mHeader->height      = height;
+	mHeader->format      = format;
+	mHeader->memory      = memory;
+	mHeader->numSlots    = numSlots;
+	mHeader->device      = device;
+	mHeader->frameSize   = frameSize;
+	mHeader->frameStride = frameStride;
+	mHeader->dataOffset  = dataOffset;
+
+	// map the frames into CUDA
+	if( memory == SHM_FRAME_HOST )
+	{
+		uint8_t* frames = (uint8_t*)mapping + dataOffset;
+
+		if( CUDA_FAILED(cudaHostRegister(frames, numSlots * frameStride, cudaHostRegisterMapped)) )
+		{
+			LogError(LOG_VIDEO "shmFrameWriter -- failed to register shared memory '%s' with CUDA\n", mName.c_str());
+			Close();
+			return false;
+		}
+
+		for( uint32_t n=0; n < numSlots; n++ )
+		{
+			if( CUDA_FAILED(cudaHostGetDevicePointer(&mSlots[n], frames + n * frameStride, 0)) )
+			{
+				Close();
+				return false;
+			}
+		}
+	}
+	else
+	{
+		for( uint32_t n=0; n < numSlots; n++ )
+		{
+			if( CUDA_FAILED(cudaMalloc(&mSlots[n], frameStride)) || CUDA_FAILED(cudaIpcGetMemHandle(&mHeader->slots[n].handle, mSlots[n])) )
+			{
+				LogError(LOG_VIDEO "shmFrameWriter -- failed to allocate CUDA IPC memory for shared memory '%s'\n", mName.c_str());
+				Close();
+				return false;
+			}
+		}
+	}
+
+	// readers wait for the magic before attaching
+	std::atomic_thread_fence(std::memory_order_release);
+	mHeader->magic = SHM_FRAME_MAGIC;
+
+	LogVerbose(LOG_VIDEO "shmFrameWriter -- sharing %ux%u %s frames in '%s' (%u slots, %s)\n", width, height, imageFormatToStr(format), 
+			 mName.c_str(), numSlots, (memory == SHM_FRAME_HOST) ? "mapped memory" : "CUDA IPC");
+
+	return true;
+}
+
+
+// nextSlot
+int shmFrameWriter::nextSlot()
+{
+	const uint32_t numSlots = mHeader->numSlots;
+	const uint32_t latest = mHeader->latest.load();
+
+	// never overwrite the latest frame, or frames that readers have acquired.
+	// the sequence is cleared before checking the readers, and readers check
+	// the sequence after incrementing, so one of the two always backs off.
+	for( uint32_t n=1; n < numSlots; n++ )
+	{
+		const uint32_t index = (latest + n) % numSlots;
+		shmFrameSlot& slot = mHeader->slots[index];
+
+		slot.sequence.store(0);
+
+		if( slot.readers.load() == 0 )
+			return index;
+	}
+
+	return -1;
+}
+
+
+// Render
+bool shmFrameWriter::Render( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !image || width == 0 || height == 0 )
+		return false;
+
+	const bool substreams_success = videoOutput::Render(image, width, height, format);
+
+	// the first frame determines the layout of the stream
+	if( !mHeader )
+	{
+		if( !init(width, height, format) )
+			return false;
+	}
+	else if( width != mHeader->width || height != mHeader->height || format != (imageFormat)mHeader->format )
+	{
+		LogError(LOG_VIDEO "shmFrameWriter -- frame (%ux%u %s) doesn't match the stream (%ux%u %s)\n", width, height, imageFormatToStr(format),
+			    mHeader->width, mHeader->height, imageFormatToStr((imageFormat)mHeader->format));
+		return false;
+	}
+
+	const int index = nextSlot();
+
+	if( index < 0 )
+	{
+		LogVerbose(LOG_VIDEO "shmFrameWriter -- all slots of '%s' are acquired by readers, dropping frame\n", mName.c_str());
+		return substreams_success;
+	}
+
+	// the frame must be complete before other processes can see it
+	if( CUDA_FAILED(cudaMemcpyAsync(mSlots[index], image, mHeader->frameSize, cudaMemcpyDeviceToDevice)) )
+		return false;
+
+	if( CUDA_FAILED(cudaStreamSynchronize(NULL)) )
+		return false;
+
+	// publish the frame and wake the readers
+	const timespec time = timestamp();
+	shmFrameSlot& slot = mHeader->slots[index];
+
+	slot.timestamp = (uint64_t)time.tv_sec * 1000000000ull + time.tv_nsec;
+	slot.sequence.store(++mSequence);
+
+	mHeader->latest.store(index);
+	mHeader->futex++;
+
+	shmFrameWake(&mHeader->futex);
+
+	mOptions.width  = width;
+	mOptions.height = height;
+	mOptions.frameCount++;
+
+	return substreams_success;
+}
+
+
+// Close
+void shmFrameWriter::Close()
+{
+	if( mHeader != NULL )
+	{
+		// tell the readers to detach
+		mHeader->closed = 1;
+		mHeader->futex++;
+		shmFrameWake(&mHeader->futex);
+
+		if( mHeader->memory == SHM_FRAME_HOST )
+		{
+			if( mSlots[0] != NULL )
+				CUDA(cudaHostUnregister((uint8_t*)mHeader + mHeader->dataOffset));
+		}
+		else
+		{
+			for( uint32_t n=0; n < mHeader->numSlots; n++ )
+			{
+				if( mSlots[n] != NULL )
+					CUDA(cudaFree(mSlots[n]));
+			}
+		}
+
+		munmap(mHeader, mMappingSize);
+		shm_unlink(mName.c_str());
+
+		mHeader = NULL;
+		mSequence = 0;
+		memset(mSlots, 0, sizeof(mSlots));
+	}
+
+	videoOutput::Close();
+}
+
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __SHM_FRAME_WRITER_H_
+#define __SHM_FRAME_WRITER_H_
+
+
+#include "videoOutput.h"
+#include "shmFrameFormat.h"
+
+
+/**
+ * Share frames with other processes through shared memory (`shm://name`),
+ * where they can be captured without any copies by shmFrameReader.
+ *
+ * The shared memory holds a lock-free ring of videoOptions::numBuffers slots
+ * (see shmFrameFormat.h).  Each call to Render() copies the frame into the next
+ * slot that isn't the latest one and isn't acquired by any readers, and then
+ * publishes it and wakes the readers.  Readers acquire the latest slot directly,
+ * so they get the frames zero-copy.
+ *
+ * On Jetson (integrated GPU), the frames are stored in the shared memory itself,
+ * which each process maps into CUDA.  On discrete GPUs, the frames are kept in
+ * device memory and shared with CUDA IPC handles instead, so they stay on the GPU.
+ *
+ * The stream's dimensions and format are set by the first frame.  The shared
+ * memory is removed when the shmFrameWriter is destroyed.
+ *
+ * @note shmFrameWriter implements the videoOutput interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see shmFrameFormat.h for the layout of the shared memory.
+ * @see videoOutput
+ * @ingroup video
+ */
+class shmFrameWriter : public videoOutput
+{
+public:
+	/**
+	 * Create a shmFrameWriter instance from a resource URI and optional videoOptions.
+	 */
+	static shmFrameWriter* Create( const char* resource, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Create a shmFrameWriter instance from the provided video options.
+	 */
+	static shmFrameWriter* Create( const videoOptions& options );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~shmFrameWriter();
+
+	/**
+	 * Publish the next frame.
+	 * @see videoOutput::Render()
+	 */
+	template<typename T> bool Render( T* image, uint32_t width, uint32_t height )		{ return Render((void*)image, width, height, imageFormatFromType<T>()); }
+	
+	/**
+	 * Publish the next frame.
+	 * @see videoOutput::Render()
+	 */
+	virtual bool Render( void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	/**
+	 * Stop sharing frames, and remove the shared memory.
+	 * @see videoOutput::Close()
+	 */
+	virtual void Close();
+
+	/**
+	 * Return the interface type (shmFrameWriter::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of shmFrameWriter class.
+	 */
+	static const uint32_t Type = (1 << 13);
+
+protected:
+	shmFrameWriter( const videoOptions& options );
+
+	bool init( uint32_t width, uint32_t height, imageFormat format );
+	int  nextSlot();
+
+	std::string mName;		// name of the shared memory object
+
+	shmFrameHeader* mHeader;	// the mapped shared memory
+	size_t   mMappingSize;
+	uint64_t mSequence;
+
+	void* mSlots[SHM_FRAME_MAX_SLOTS];	// CUDA pointers to the frames
+};
+
+#endif
+
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "testPatternSource.h"
+
+#include "cudaColorspace.h"
+#include "cudaMemoryPool.h"
+#include "cudaNVTX.h"
+
+#include "logging.h"
+
+#include <time.h>
+
+
+// current time in nanoseconds of CLOCK_MONOTONIC
+static inline uint64_t monotonicTime()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * uint64_t(1000000000) + (uint64_t)t.tv_nsec;
+}
+
+
+// constructor
+testPatternSource::testPatternSource( const videoOptions& options ) : videoSource(options), mBuffers(0)
+{
+	mPattern  = cudaTestPatternFromStr(mOptions.resource.location.c_str());
+	mInterval = 0;
+	mNextTime = 0;
+
+	mFlipCapture = true;
+	mStaging  = NULL;
+
+	if( mOptions.width == 0 || mOptions.height == 0 )
+	{
+		mOptions.width  = 1280;
+		mOptions.height = 720;
+	}
+
+	if( mOptions.frameRate < 0 )
+		mOptions.frameRate = 0;	// unthrottled
+	else if( mOptions.frameRate == 0 )
+		mOptions.frameRate = 30;
+
+	if( mOptions.frameRate > 0 )
+		mInterval = (uint64_t)(1.0e9 / mOptions.frameRate);
+
+	mOptions.codec = videoOptions::CODEC_RAW;
+}
+
+
+// destructor
+testPatternSource::~testPatternSource()
+{
+	if( mStaging != NULL )
+		cudaFreePooled(mStaging);
+}
+
+
+// Create
+testPatternSource* testPatternSource::Create( const videoOptions& options )
+{
+	const char* location = options.resource.location.c_str();
+
+	if( options.resource.location.size() > 0 && cudaTestPatternFromStr(location, (cudaTestPatternType)-1) == (cudaTestPatternType)-1 )
+	{
+		LogError(LOG_VIDEO "testPatternSource -- unknown pattern '%s' (valid patterns are bars, gradient, checkerboard, noise, solid)\n", location);
+		return NULL;
+	}
+
+	testPatternSource* src = new testPatternSource(options);
+
+	LogVerbose(LOG_VIDEO "testPatternSource -- generating '%s' pattern at %ux%u, %g FPS\n", cudaTestPatternToStr(src->mPattern),
+			 src->mOptions.width, src->mOptions.height, src->mOptions.frameRate);
+
+	return src;
+}
+
+
+// Create
+testPatternSource* testPatternSource::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// Capture
+bool testPatternSource::Capture( void** output, imageFormat format, uint64_t timeout )
+{
+	// verify the output pointer exists
+	if( !output )
+		return false;
+
+	// confirm the stream is open
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	NVTX_RANGE("testPatternSource::Capture");
+
+	// wait until the next frame is due
+	if( mInterval > 0 )
+	{
+		uint64_t now = monotonicTime();
+
+		if( mNextTime > now )
+		{
+			if( timeout != UINT64_MAX && mNextTime - now > timeout * 1000000ULL )
+				return false;
+
+			timespec wakeup;
+			wakeup.tv_sec  = mNextTime / 1000000000ULL;
+			wakeup.tv_nsec = mNextTime % 1000000000ULL;
+
+			while( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) != 0 ) {}
+
+			mNextTime += mInterval;
+		}
+		else
+		{
+			// don't try to catch up if Capture() fell behind
+			mNextTime = now + mInterval;
+		}
+	}
+
+	const uint32_t width  = mOptions.width;
+	const uint32_t height = mOptions.height;
+
+	// allocate the ring buffers for the requested format
+	if( !mBuffers.Alloc(mOptions.numBuffers, imageFormatSize(format, width, height), mOptions.zeroCopy ? RingBuffer::ZeroCopy : 0) )
+	{
+		LogError(LOG_VIDEO "testPatternSource -- failed to allocate %u buffers for %ux%u %s\n", mOptions.numBuffers, width, height, imageFormatToStr(format));
+		return false;
+	}
+
+	void* nextBuffer = mBuffers.Next(RingBuffer::Write);
+
+	if( !nextBuffer )
+		return false;
+
+	// generate the frame
+	const uint64_t frame = mOptions.frameCount;
+
+	if( imageFormatIsRGB(format) || imageFormatIsBGR(format) || imageFormatIsGray(format) )
+	{
+		if( CUDA_FAILED(cudaTestPattern(nextBuffer, width, height, format, mPattern, frame)) )
+			return false;
+
+		mRawFormat = format;
+	}
+	else
+	{
+		if( !mStaging && !cudaAllocMappedPooled(&mStaging, width, height, IMAGE_RGBA8) )
+			return false;
+
+		if( CUDA_FAILED(cudaTestPattern(mStaging, width, height, IMAGE_RGBA8, mPattern, frame)) )
+			return false;
+
+		if( CUDA_FAILED(cudaConvertColor(mStaging, IMAGE_RGBA8, nextBuffer, format, width, height)) )
+		{
+			LogError(LOG_VIDEO "testPatternSource -- unsupported image format conversion (rgba8 -> %s)\n", imageFormatToStr(format));
+			return false;
+		}
+
+		mRawFormat = IMAGE_RGBA8;
+	}
+
+	mLastCaptureTime = monotonicTime();
+	mLastTimestamp   = mLastCaptureTime;
+
+	*output = nextBuffer;
+	mOptions.frameCount++;
+
+	if( !flipCapture(output, format) )
+		return false;
+
+	stampCapture(*output, format);
+	return true;
+}
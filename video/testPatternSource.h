@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __TEST_PATTERN_SOURCE_H_
+#define __TEST_PATTERN_SOURCE_H_
+
+
+#include "videoSource.h"
+#include "cudaTestPattern.h"
+
+#include "RingBuffer.h"
+
+
+/**
+ * Synthetic video source that generates animated test patterns on the GPU (`test://pattern`),
+ * for benchmarking processing, encoding and outputs without any real media or cameras.
+ *
+ * The pattern is selected by the location of the URI (see cudaTestPatternType):
+ *
+ *   - `test://bars` (or `test://pattern`)
+ *   - `test://gradient`
+ *   - `test://checkerboard`
+ *   - `test://noise`
+ *   - `test://solid`
+ *
+ * The resolution is set with `--input-width` and `--input-height` (default 1280x720),
+ * and frames are generated at `--input-rate` (default 30 FPS).  Use `--input-rate=-1`
+ * to generate frames as fast as Capture() is called.  Frames are generated directly
+ * in the format requested from Capture(), or generated in rgba8 and converted with
+ * cudaConvertColor() for the other formats (like YUV).
+ *
+ * @note testPatternSource implements the videoSource interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see videoSource
+ * @ingroup video
+ */
+class testPatternSource : public videoSource
+{
+public:
+	/**
+	 * Create a testPatternSource instance from a resource URI and optional videoOptions.
+	 */
+	static testPatternSource* Create( const char* resource, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Create a testPatternSource instance from the provided video options.
+	 */
+	static testPatternSource* Create( const videoOptions& options );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~testPatternSource();
+
+	/**
+	 * Generate the next frame.
+	 * @see videoSource::Capture()
+	 */
+	template<typename T> bool Capture( T** image, uint64_t timeout=DEFAULT_TIMEOUT )		{ return Capture((void**)image, imageFormatFromType<T>(), timeout); }
+	
+	/**
+	 * Generate the next frame.
+	 * @see videoSource::Capture()
+	 */
+	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT );
+
+	/**
+	 * Return the pattern being generated.
+	 */
+	inline cudaTestPatternType GetPattern() const	{ return mPattern; }
+
+	/**
+	 * Return the interface type (testPatternSource::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of testPatternSource class.
+	 */
+	static const uint32_t Type = (1 << 14);
+
+protected:
+	testPatternSource( const videoOptions& options );
+
+	cudaTestPatternType mPattern;
+	
+	uint64_t   mInterval;	// nanoseconds between frames (0 if unthrottled)
+	uint64_t   mNextTime;	// CLOCK_MONOTONIC time of the next frame
+	
+	RingBuffer mBuffers;
+	void*      mStaging;	// rgba8 frame for formats that are converted
+};
+
+#endif
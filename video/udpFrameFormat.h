@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __UDP_FRAME_FORMAT_H_
+#define __UDP_FRAME_FORMAT_H_
+
+
+#include <stdint.h>
+#include <string.h>
+
+
+/**
+ * Protocol of uncompressed UDP frame streams (`udp-raw://`) used by udpFrameSender and udpFrameReceiver.
+ * @ingroup video
+ */
+#define UDP_FRAME_PROTOCOL "udp-raw"
+
+/**
+ * Magic identifier at the start of each UDP frame packet.
+ * @ingroup video
+ */
+#define UDP_FRAME_MAGIC 0x4A554450	// 'JUDP'
+
+/**
+ * Size of each UDP frame packet (in bytes), including the udpFrameHeader.
+ * This fits within the 9000 byte MTU of jumbo frames (minus the IP/UDP headers),
+ * so jumbo frames should be enabled on the network interfaces to avoid IP fragmentation.
+ * @ingroup video
+ */
+#define UDP_FRAME_PACKET_SIZE 8960
+
+/**
+ * Number of packets that are sent or recieved per system call.
+ * @ingroup video
+ */
+#define UDP_FRAME_BATCH_SIZE 64
+
+
+/**
+ * Header at the beginning of each UDP frame packet.
+ *
+ * Each frame gets split into `numPackets` packets, which carry up to
+ * UDP_FRAME_PACKET_SIZE - sizeof(udpFrameHeader) bytes of the frame each.
+ * The packets of a frame share the same sequence number, and the receiver
+ * drops frames that are incomplete when the packets of a newer frame arrive.
+ *
+ * @ingroup video
+ */
+struct udpFrameHeader
+{
+	uint32_t magic;		/**< UDP_FRAME_MAGIC */
+	uint32_t sequence;		/**< Sequence number of the frame */
+	uint32_t packet;		/**< Index of this packet within the frame */
+	uint32_t numPackets;	/**< Number of packets that make up the frame */
+	uint32_t width;		/**< Width of the frame (in pixels) */
+	uint32_t height;		/**< Height of the frame (in pixels) */
+	uint32_t format;		/**< imageFormat of the frame */
+	uint32_t payloadSize;	/**< Number of bytes of the frame in this packet */
+	uint64_t frameSize;		/**< Size of the frame (in bytes) */
+	uint64_t timestamp;		/**< Time that the frame was sent (in nanoseconds) */
+
+	/**
+	 * Check the magic identifier.
+	 */
+	inline bool IsValid() const	{ return (magic == UDP_FRAME_MAGIC) && (packet < numPackets); }
+};
+
+/**
+ * Number of bytes of the frame that fit in each UDP frame packet.
+ * @ingroup video
+ */
+#define UDP_FRAME_PAYLOAD_SIZE (UDP_FRAME_PACKET_SIZE - sizeof(udpFrameHeader))
+
+#endif
+
@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "udpFrameReceiver.h"
+
+#include "cudaColorspace.h"
+#include "logging.h"
+
+#include <algorithm>
+
+
+// constructor
+udpFrameReceiver::udpFrameReceiver( const videoOptions& options ) : videoSource(options)
+{
+	mSocket          = NULL;
+	mThreadStop      = false;
+	mAllocated       = false;
+	mPartial         = NULL;
+	mPartialSequence = 0;
+	mPartialPackets  = 0;
+	mPartialValid    = false;
+	mPackets         = NULL;
+	mDropped         = 0;
+	mBadPackets      = 0;
+	mTimestamp       = 0;
+	mFlipCapture     = true;
+
+	memset(&mHeader, 0, sizeof(udpFrameHeader));
+
+	mFrames.SetThreaded(true);
+	mBufferRGB.SetThreaded(false);
+}
+
+
+// destructor
+udpFrameReceiver::~udpFrameReceiver()
+{
+	Close();
+
+	if( mSocket != NULL )
+	{
+		delete mSocket;
+		mSocket = NULL;
+	}
+
+	if( mPackets != NULL )
+	{
+		free(mPackets);
+		mPackets = NULL;
+	}
+}
+
+
+// Create
+udpFrameReceiver* udpFrameReceiver::Create( const videoOptions& options )
+{
+	udpFrameReceiver* receiver = new udpFrameReceiver(options);
+
+	if( !receiver->init() )
+	{
+		delete receiver;
+		return NULL;
+	}
+
+	return receiver;
+}
+
+
+// Create
+udpFrameReceiver* udpFrameReceiver::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// init
+bool udpFrameReceiver::init()
+{
+	const URI& uri = mOptions.resource;
+
+	if( uri.port <= 0 )
+	{
+		LogError(LOG_VIDEO "udpFrameReceiver -- the port is missing from '%s' (expected %s://@:<port>)\n", uri.string.c_str(), UDP_FRAME_PROTOCOL);
+		return false;
+	}
+
+	mSocket = Socket::Create(SOCKET_UDP);
+
+	if( !mSocket )
+	{
+		LogError(LOG_VIDEO "udpFrameReceiver -- failed to create socket\n");
+		return false;
+	}
+
+	if( !mSocket->Bind(uri.location.c_str(), uri.port) )
+	{
+		LogError(LOG_VIDEO "udpFrameReceiver -- failed to bind socket to %s:%i\n", uri.location.c_str(), uri.port);
+		return false;
+	}
+
+	// the packets of a whole frame arrive at once, so the socket needs deep buffers
+	if( !mSocket->EnableJumboBuffer() )
+		LogWarning(LOG_VIDEO "udpFrameReceiver -- failed to increase the socket buffer size, frames may be dropped\n");
+
+	// wake up periodically so the thread can be stopped
+	mSocket->SetRecieveTimeout(100 * 1000);
+
+	// allocate a batch of packets to recieve into
+	mPackets = (uint8_t*)malloc(UDP_FRAME_BATCH_SIZE * UDP_FRAME_PACKET_SIZE);
+
+	if( !mPackets )
+		return false;
+
+	mMessages.resize(UDP_FRAME_BATCH_SIZE);
+
+	for( uint32_t n=0; n < UDP_FRAME_BATCH_SIZE; n++ )
+	{
+		mMessages[n].buffer = mPackets + n * UDP_FRAME_PACKET_SIZE;
+		mMessages[n].size   = UDP_FRAME_PACKET_SIZE;
+	}
+
+	mOptions.deviceType = videoOptions::DEVICE_IP;
+	mOptions.codec = videoOptions::CODEC_RAW;
+
+	LogVerbose(LOG_VIDEO "udpFrameReceiver -- listening on %s:%i\n", uri.location.c_str(), uri.port);
+	return true;
+}
+
+
+// Open
+bool udpFrameReceiver::Open()
+{
+	if( mStreaming )
+		return true;
+
+	mThreadStop = false;
+
+	if( !mThread.Start(recvThread, this) )
+	{
+		LogError(LOG_VIDEO "udpFrameReceiver -- failed to start the recieve thread\n");
+		return false;
+	}
+
+	mStreaming = true;
+	return true;
+}
+
+
+// Close
+void udpFrameReceiver::Close()
+{
+	if( !mStreaming )
+		return;
+
+	mThreadStop = true;
+	mThread.Stop(true);
+
+	mStreaming = false;
+}
+
+
+// Capture
+bool udpFrameReceiver::Capture( void** output, imageFormat format, uint64_t timeout )
+{
+	// verify the output pointer exists
+	if( !output )
+		return false;
+
+	// confirm the stream is open
+	if( !mStreaming )
+	{
+		if( !Open() )
+			return false;
+	}
+
+	// return the latest frame if it hasn't been read yet
+	void* latest = mAllocated ? mFrames.Next(RingBuffer::ReadLatestOnce) : NULL;
+
+	while( !latest )
+	{
+		if( !mEvent.Wait(timeout) )
+			return false;
+
+		latest = mFrames.Next(RingBuffer::ReadLatestOnce);
+	}
+
+	mLastTimestamp = mTimestamp;
+
+	if( format == mRawFormat )
+	{
+		*output = latest;
+		mOptions.frameCount++;
+		return flipCapture(output, format);
+	}
+
+	// convert the frame to the requested format
+	const size_t outputSize = imageFormatSize(format, mOptions.width, mOptions.height);
+
+	if( !mBufferRGB.Alloc(mOptions.numBuffers, outputSize, mOptions.zeroCopy ? RingBuffer::ZeroCopy : 0) )
+	{
+		LogError(LOG_VIDEO "udpFrameReceiver -- failed to allocate %u buffers (%zu bytes each)\n", mOptions.numBuffers, outputSize);
+		return false;
+	}
+
+	void* nextBuffer = mBufferRGB.Next(RingBuffer::Write);
+
+	if( !nextBuffer )
+		return false;
+
+	if( CUDA_FAILED(cudaConvertColor(latest, mRawFormat, nextBuffer, format, mOptions.width, mOptions.height)) )
+	{
+		LogError(LOG_VIDEO "udpFrameReceiver -- unsupported image format conversion (%s -> %s)\n", imageFormatToStr(mRawFormat), imageFormatToStr(format));
+		return false;
+	}
+
+	*output = nextBuffer;
+	mOptions.frameCount++;
+
+	return flipCapture(output, format);
+}
+
+
+// recvPacket
+void udpFrameReceiver::recvPacket( const uint8_t* packet, size_t size )
+{
+	if( size < sizeof(udpFrameHeader) )
+		return;
+
+	const udpFrameHeader* header = (const udpFrameHeader*)packet;
+
+	// the packet index gets used to write into the frame, so the layout needs to be consistent
+	if( !header->IsValid() || header->payloadSize > UDP_FRAME_PAYLOAD_SIZE || sizeof(udpFrameHeader) + header->payloadSize > size ||
+	    header->numPackets != (header->frameSize + UDP_FRAME_PAYLOAD_SIZE - 1) / UDP_FRAME_PAYLOAD_SIZE )
+	{
+		mBadPackets++;
+		return;
+	}
+
+	// the first frame determines the layout of the stream
+	if( !mAllocated )
+	{
+		if( header->frameSize != imageFormatSize((imageFormat)header->format, header->width, header->height) )
+		{
+			mBadPackets++;
+			return;
+		}
+
+		if( !mFrames.Alloc(mOptions.numBuffers, header->frameSize, RingBuffer::ZeroCopy) )
+		{
+			LogError(LOG_VIDEO "udpFrameReceiver -- failed to allocate %u buffers (%zu bytes each)\n", mOptions.numBuffers, (size_t)header->frameSize);
+			mThreadStop = true;
+			return;
+		}
+
+		mHeader = *header;
+		mPartialMask.resize(mHeader.numPackets);
+
+		mRawFormat = (imageFormat)mHeader.format;
+		mOptions.width  = mHeader.width;
+		mOptions.height = mHeader.height;
+
+		LogVerbose(LOG_VIDEO "udpFrameReceiver -- recieving %ux%u %s frames in %u packets each\n", mHeader.width, mHeader.height, imageFormatToStr(mRawFormat), mHeader.numPackets);
+		mAllocated = true;
+	}
+	else if( header->width != mHeader.width || header->height != mHeader.height || header->format != mHeader.format ||
+		    header->frameSize != mHeader.frameSize || header->numPackets != mHeader.numPackets )
+	{
+		mBadPackets++;
+		return;	// frames that don't match the stream get ignored
+	}
+
+	const int32_t age = (int32_t)(header->sequence - mPartialSequence);
+
+	if( !mPartialValid || age > 0 )
+	{
+		// a newer frame started, so drop the current one if it's incomplete
+		if( mPartialValid && mPartial != NULL && mPartialPackets < mHeader.numPackets )
+			mDropped++;
+
+		mPartial = (uint8_t*)mFrames.Peek(RingBuffer::Write);
+		mPartialSequence = header->sequence;
+		mPartialPackets = 0;
+		mPartialValid = true;
+
+		std::fill(mPartialMask.begin(), mPartialMask.end(), false);
+	}
+	else if( age < 0 )
+	{
+		return;	// the packet is from an older frame
+	}
+
+	if( header->packet >= mPartialMask.size() )
+	{
+		mBadPackets++;
+		return;
+	}
+
+	if( !mPartial || mPartialMask[header->packet] || mPartialPackets >= mHeader.numPackets )
+		return;	// duplicate packet
+
+	const size_t offset = (size_t)header->packet * UDP_FRAME_PAYLOAD_SIZE;
+
+	if( offset + header->payloadSize > mHeader.frameSize )
+		return;
+
+	memcpy(mPartial + offset, packet + sizeof(udpFrameHeader), header->payloadSize);
+
+	mPartialMask[header->packet] = true;
+	mPartialPackets++;
+
+	// publish the frame once all of its packets have arrived
+	if( mPartialPackets == mHeader.numPackets )
+	{
+		mTimestamp = header->timestamp;
+		mFrames.Next(RingBuffer::Write);
+		mEvent.Wake();
+	}
+}
+
+
+// recvThread
+void* udpFrameReceiver::recvThread( void* user )
+{
+	udpFrameReceiver* receiver = (udpFrameReceiver*)user;
+
+	while( !receiver->mThreadStop )
+	{
+		const int count = receiver->mSocket->RecieveBatch(receiver->mMessages.data(), receiver->mMessages.size());
+
+		if( count < 0 )
+		{
+			LogError(LOG_VIDEO "udpFrameReceiver -- failed to recieve packets, stopping the stream\n");
+			break;
+		}
+
+		for( int n=0; n < count; n++ )
+			receiver->recvPacket(receiver->mMessages[n].buffer, receiver->mMessages[n].length);
+	}
+
+	return NULL;
+}
+
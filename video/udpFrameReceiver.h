@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __UDP_FRAME_RECEIVER_H_
+#define __UDP_FRAME_RECEIVER_H_
+
+
+#include "videoSource.h"
+#include "udpFrameFormat.h"
+#include "Socket.h"
+
+#include "RingBuffer.h"
+#include "Thread.h"
+#include "Event.h"
+
+#include <atomic>
+#include <vector>
+
+
+/**
+ * Receive uncompressed frames over UDP (`udp-raw://@:<port>` or `udp-raw://<local-ip>:<port>`)
+ * from a udpFrameSender.
+ *
+ * The packets get recieved in batches on a background thread and reassembled into
+ * a RingBuffer of mapped memory.  When the packets of a newer frame arrive before the
+ * current frame is complete, the incomplete frame gets dropped (see GetDroppedFrames()).
+ * The dimensions and format of the stream are taken from the first frame that arrives.
+ *
+ * If Capture() requests the same format that the frames were sent in, the reassembled
+ * frames are returned without any copies, otherwise they're converted with cudaConvertColor().
+ *
+ * @note udpFrameReceiver implements the videoSource interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see udpFrameFormat.h for the packet layout.
+ * @see videoSource
+ * @ingroup video
+ */
+class udpFrameReceiver : public videoSource
+{
+public:
+	/**
+	 * Create a udpFrameReceiver instance from a resource URI and optional videoOptions.
+	 */
+	static udpFrameReceiver* Create( const char* resource, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Create a udpFrameReceiver instance from the provided video options.
+	 */
+	static udpFrameReceiver* Create( const videoOptions& options );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~udpFrameReceiver();
+
+	/**
+	 * Capture the next frame.
+	 * @see videoSource::Capture()
+	 */
+	template<typename T> bool Capture( T** image, uint64_t timeout=DEFAULT_TIMEOUT )		{ return Capture((void**)image, imageFormatFromType<T>(), timeout); }
+	
+	/**
+	 * Capture the next frame.
+	 * @see videoSource::Capture()
+	 */
+	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT );
+
+	/**
+	 * Start recieving the stream.
+	 * @see videoSource::Open()
+	 */
+	virtual bool Open();
+
+	/**
+	 * Stop recieving the stream.
+	 * @see videoSource::Close()
+	 */
+	virtual void Close();
+
+	/**
+	 * Return the number of frames that were dropped because they were incomplete.
+	 */
+	inline uint64_t GetDroppedFrames() const		{ return mDropped; }
+
+	/**
+	 * Return the number of packets that were ignored because they were malformed
+	 * or didn't match the layout of the frames being reassembled.
+	 */
+	inline uint64_t GetBadPackets() const			{ return mBadPackets; }
+
+	/**
+	 * Get a file descriptor that becomes readable when a new frame can be captured.
+	 * @see videoSource::GetEventFD()
+	 */
+	virtual int GetEventFD()					{ return mEvent.GetFD(); }
+
+	/**
+	 * Return the interface type (udpFrameReceiver::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of udpFrameReceiver class.
+	 */
+	static const uint32_t Type = (1 << 10);
+
+protected:
+	udpFrameReceiver( const videoOptions& options );
+
+	bool init();
+	void recvPacket( const uint8_t* packet, size_t size );
+
+	static void* recvThread( void* user );
+
+	Socket*  mSocket;
+	Thread   mThread;
+	Event    mEvent;
+
+	volatile bool mThreadStop;
+	volatile bool mAllocated;
+
+	udpFrameHeader mHeader;	// the layout of the stream, from the first frame
+
+	// the frame that's currently being reassembled
+	uint8_t* mPartial;
+	uint32_t mPartialSequence;
+	uint32_t mPartialPackets;
+	bool     mPartialValid;
+
+	std::vector<bool> mPartialMask;
+
+	uint8_t* mPackets;		// batch of recieved packets
+	std::vector<SocketMessage> mMessages;
+
+	std::atomic<uint64_t> mDropped;
+	std::atomic<uint64_t> mBadPackets;
+	std::atomic<uint64_t> mTimestamp;
+
+	RingBuffer mFrames;		// reassembled frames
+	RingBuffer mBufferRGB;	// converted frames
+};
+
+#endif
+
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "udpFrameSender.h"
+#include "IPv4.h"
+
+#include "cudaMappedMemory.h"
+#include "timespec.h"
+#include "logging.h"
+
+#include <algorithm>
+
+
+// constructor
+udpFrameSender::udpFrameSender( const videoOptions& options ) : videoOutput(options)
+{
+	mSocket      = NULL;
+	mRemoteIP    = 0;
+	mRemotePort  = 0;
+	mSequence    = 0;
+	mPackets     = NULL;
+	mPacketsSize = 0;
+
+	memset(&mHeader, 0, sizeof(udpFrameHeader));
+}
+
+
+// destructor
+udpFrameSender::~udpFrameSender()
+{
+	if( mSocket != NULL )
+	{
+		delete mSocket;
+		mSocket = NULL;
+	}
+
+	CUDA_FREE_HOST(mPackets);
+}
+
+
+// Create
+udpFrameSender* udpFrameSender::Create( const videoOptions& options )
+{
+	udpFrameSender* sender = new udpFrameSender(options);
+
+	if( !sender->init() )
+	{
+		delete sender;
+		return NULL;
+	}
+
+	return sender;
+}
+
+
+// Create
+udpFrameSender* udpFrameSender::Create( const char* resource, const videoOptions& options )
+{
+	videoOptions opt = options;
+	opt.resource = resource;
+	return Create(opt);
+}
+
+
+// init
+bool udpFrameSender::init()
+{
+	const URI& uri = mOptions.resource;
+
+	if( uri.port <= 0 )
+	{
+		LogError(LOG_VIDEO "udpFrameSender -- the port is missing from '%s' (expected %s://<remote-ip>:<port>)\n", uri.string.c_str(), UDP_FRAME_PROTOCOL);
+		return false;
+	}
+
+	if( !IPv4AddressFromStr(uri.location.c_str(), &mRemoteIP) )
+	{
+		LogError(LOG_VIDEO "udpFrameSender -- invalid remote IP address '%s'\n", uri.location.c_str());
+		return false;
+	}
+
+	mRemotePort = uri.port;
+	mSocket = Socket::Create(SOCKET_UDP);
+
+	if( !mSocket )
+	{
+		LogError(LOG_VIDEO "udpFrameSender -- failed to create socket\n");
+		return false;
+	}
+
+	// a whole frame gets queued at once, so the socket needs deep buffers
+	if( !mSocket->EnableJumboBuffer() )
+		LogWarning(LOG_VIDEO "udpFrameSender -- failed to increase the socket buffer size, packets may be dropped\n");
+
+	mOptions.codec = videoOptions::CODEC_RAW;
+	mStreaming = true;
+
+	LogVerbose(LOG_VIDEO "udpFrameSender -- streaming to %s:%hu\n", uri.location.c_str(), mRemotePort);
+	return true;
+}
+
+
+// Render
+bool udpFrameSender::Render( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !image || width == 0 || height == 0 )
+		return false;
+
+	const bool substreams_success = videoOutput::Render(image, width, height, format);
+
+	if( !mSocket )
+		return false;
+
+	const size_t frameSize = imageFormatSize(format, width, height);
+
+	// the first frame determines the layout of the stream
+	if( mHeader.frameSize == 0 )
+	{
+		mHeader.magic      = UDP_FRAME_MAGIC;
+		mHeader.width      = width;
+		mHeader.height     = height;
+		mHeader.format     = format;
+		mHeader.frameSize  = frameSize;
+		mHeader.numPackets = (frameSize + UDP_FRAME_PAYLOAD_SIZE - 1) / UDP_FRAME_PAYLOAD_SIZE;
+
+		mPacketsSize = mHeader.numPackets * UDP_FRAME_PACKET_SIZE;
+
+		if( !cudaAllocMapped(&mPackets, mPacketsSize) )
+			return false;
+
+		mMessages.resize(mHeader.numPackets);
+
+		LogVerbose(LOG_VIDEO "udpFrameSender -- sending %ux%u %s frames in %u packets each\n", width, height, imageFormatToStr(format), mHeader.numPackets);
+	}
+	else if( width != mHeader.width || height != mHeader.height || format != (imageFormat)mHeader.format )
+	{
+		LogError(LOG_VIDEO "udpFrameSender -- frame (%ux%u %s) doesn't match the stream (%ux%u %s)\n", width, height, imageFormatToStr(format),
+			    mHeader.width, mHeader.height, imageFormatToStr((imageFormat)mHeader.format));
+		return false;
+	}
+
+	// packetize the frame on the GPU, by copying it into the payloads with the packet stride
+	const uint32_t fullPackets = frameSize / UDP_FRAME_PAYLOAD_SIZE;
+	const size_t   remainder   = frameSize - fullPackets * UDP_FRAME_PAYLOAD_SIZE;
+
+	if( fullPackets > 0 )
+	{
+		if( CUDA_FAILED(cudaMemcpy2DAsync(mPackets + sizeof(udpFrameHeader), UDP_FRAME_PACKET_SIZE, image, UDP_FRAME_PAYLOAD_SIZE,
+								    UDP_FRAME_PAYLOAD_SIZE, fullPackets, cudaMemcpyDefault)) )
+			return false;
+	}
+
+	if( remainder > 0 )
+	{
+		if( CUDA_FAILED(cudaMemcpyAsync(mPackets + fullPackets * UDP_FRAME_PACKET_SIZE + sizeof(udpFrameHeader),
+								  (uint8_t*)image + fullPackets * UDP_FRAME_PAYLOAD_SIZE, remainder, cudaMemcpyDefault)) )
+			return false;
+	}
+
+	if( CUDA_FAILED(cudaStreamSynchronize(NULL)) )
+		return false;
+
+	// fill out the packet headers
+	const timespec time = timestamp();
+
+	mHeader.sequence  = mSequence++;
+	mHeader.timestamp = (uint64_t)time.tv_sec * 1000000000ull + time.tv_nsec;
+
+	for( uint32_t n=0; n < mHeader.numPackets; n++ )
+	{
+		udpFrameHeader* header = (udpFrameHeader*)(mPackets + n * UDP_FRAME_PACKET_SIZE);
+
+		*header = mHeader;
+		header->packet      = n;
+		header->payloadSize = (n < fullPackets) ? UDP_FRAME_PAYLOAD_SIZE : remainder;
+
+		mMessages[n].buffer     = (uint8_t*)header;
+		mMessages[n].size       = sizeof(udpFrameHeader) + header->payloadSize;
+		mMessages[n].remoteIP   = mRemoteIP;
+		mMessages[n].remotePort = mRemotePort;
+	}
+
+	// send the packets in batches
+	for( uint32_t n=0; n < mHeader.numPackets; )
+	{
+		const uint32_t count = std::min<uint32_t>(UDP_FRAME_BATCH_SIZE, mHeader.numPackets - n);
+		const int sent = mSocket->SendBatch(mMessages.data() + n, count);
+
+		if( sent <= 0 )
+		{
+			LogError(LOG_VIDEO "udpFrameSender -- failed to send frame %u (packet %u of %u)\n", mHeader.sequence, n, mHeader.numPackets);
+			return false;
+		}
+
+		n += sent;
+	}
+
+	mOptions.width  = width;
+	mOptions.height = height;
+	mOptions.frameCount++;
+
+	return substreams_success;
+}
+
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __UDP_FRAME_SENDER_H_
+#define __UDP_FRAME_SENDER_H_
+
+
+#include "videoOutput.h"
+#include "udpFrameFormat.h"
+#include "Socket.h"
+
+#include <vector>
+
+
+/**
+ * Stream uncompressed frames to a remote host over UDP (`udp-raw://<remote-ip>:<port>`),
+ * to be received by udpFrameReceiver.  This is for sending data that shouldn't be
+ * compressed (like depth maps) to a neighboring device on a fast local network.
+ *
+ * Each frame is split into packets of UDP_FRAME_PACKET_SIZE bytes that carry a udpFrameHeader.
+ * The frame gets packetized by one strided GPU copy into mapped memory, where the CPU
+ * fills out the headers and the packets are sent from directly, UDP_FRAME_BATCH_SIZE at a time.
+ * All of the frames must have the same dimensions and format as the first frame.
+ *
+ * @note udpFrameSender implements the videoOutput interface and is intended to
+ * be used through that as opposed to directly.
+ *
+ * @see udpFrameFormat.h for the packet layout.
+ * @see videoOutput
+ * @ingroup video
+ */
+class udpFrameSender : public videoOutput
+{
+public:
+	/**
+	 * Create a udpFrameSender instance from a resource URI and optional videoOptions.
+	 */
+	static udpFrameSender* Create( const char* resource, const videoOptions& options=videoOptions() );
+
+	/**
+	 * Create a udpFrameSender instance from the provided video options.
+	 */
+	static udpFrameSender* Create( const videoOptions& options );
+
+	/**
+	 * Destructor
+	 */
+	virtual ~udpFrameSender();
+
+	/**
+	 * Send the next frame.
+	 * @see videoOutput::Render()
+	 */
+	template<typename T> bool Render( T* image, uint32_t width, uint32_t height )		{ return Render((void*)image, width, height, imageFormatFromType<T>()); }
+	
+	/**
+	 * Send the next frame.
+	 * @see videoOutput::Render()
+	 */
+	virtual bool Render( void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	/**
+	 * Return the interface type (udpFrameSender::Type)
+	 */
+	virtual inline uint32_t GetType() const		{ return Type; }
+
+	/**
+	 * Unique type identifier of udpFrameSender class.
+	 */
+	static const uint32_t Type = (1 << 11);
+
+protected:
+	udpFrameSender( const videoOptions& options );
+
+	bool init();
+
+	Socket*  mSocket;
+	uint32_t mRemoteIP;
+	uint16_t mRemotePort;
+	uint32_t mSequence;
+
+	uint8_t* mPackets;		// mapped memory that the frames get packetized into
+	size_t   mPacketsSize;
+
+	udpFrameHeader mHeader;	// the layout of the stream, from the first frame
+
+	std::vector<SocketMessage> mMessages;
+};
+
+#endif
+
@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "videoSource.h"
+#include "videoOutput.h"
+
+#include "cudaColorspace.h"
+#include "csvWriter.h"
+#include "logging.h"
+#include "commandLine.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+bool signal_recieved = false;
+
+void sig_handler(int signo)
+{
+	if( signo == SIGINT )
+	{
+		LogInfo("received SIGINT\n");
+		signal_recieved = true;
+	}
+}
+
+int usage()
+{
+	printf("usage: video-bench [--help] [--duration=SECONDS] [--warmup=SECONDS] [--format=FORMAT]\n");
+	printf("                   [--convert=FORMAT] [--csv=FILE] input_URI [output_URI]\n\n");
+	printf("Measure the throughput of a videoSource -> convert -> videoOutput pipeline.\n");
+	printf("Nothing is displayed, and if no output is given the frames are discarded.\n");
+	printf("See below for additional arguments that may not be shown above.\n\n");
+	printf("positional arguments:\n");
+	printf("    input_URI       resource URI of input stream  (see videoSource below)\n");
+	printf("    output_URI      resource URI of output stream (see videoOutput below)\n\n");
+	printf("optional arguments:\n");
+	printf("  --help            show this help message and exit\n");
+	printf("  --duration=N      number of seconds to measure for (default 30)\n");
+	printf("  --warmup=N        number of seconds to run before measuring (default 2)\n");
+	printf("  --format=FORMAT   image format that frames are captured in (default rgb8)\n");
+	printf("  --convert=FORMAT  convert the captured frames to this format before output\n");
+	printf("  --csv=FILE        save the results to a CSV file\n\n");
+
+	printf("%s", videoSource::Usage());
+	printf("%s", videoOutput::Usage());
+	printf("%s", Log::Usage());
+
+	return 0;
+}
+
+
+// current time in nanoseconds of CLOCK_MONOTONIC
+static uint64_t timeNow()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * uint64_t(1000000000) + (uint64_t)t.tv_nsec;
+}
+
+
+// CPU time used by one thread of this process
+struct threadUsage
+{
+	int         tid;
+	std::string name;
+	uint64_t    ticks;	// utime + stime, in clock ticks
+};
+
+
+// read the CPU time of every thread of this process from /proc
+static std::vector<threadUsage> readThreadUsage()
+{
+	std::vector<threadUsage> threads;
+	DIR* dir = opendir("/proc/self/task");
+
+	if( !dir )
+		return threads;
+
+	dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		if( entry->d_name[0] == '.' )
+			continue;
+
+		char path[256];
+		snprintf(path, sizeof(path), "/proc/self/task/%s/stat", entry->d_name);
+
+		FILE* file = fopen(path, "r");
+
+		if( !file )
+			continue;
+
+		char line[1024];
+		const bool ok = (fgets(line, sizeof(line), file) != NULL);
+		fclose(file);
+
+		if( !ok )
+			continue;
+
+		// the thread name is in parentheses and can contain spaces
+		char* nameBegin = strchr(line, '(');
+		char* nameEnd = strrchr(line, ')');
+
+		if( !nameBegin || !nameEnd || nameEnd < nameBegin )
+			continue;
+
+		threadUsage usage;
+
+		usage.tid = atoi(entry->d_name);
+		usage.name = std::string(nameBegin + 1, nameEnd - nameBegin - 1);
+
+		// utime and stime are the 14th and 15th fields (12th and 13th after the name)
+		unsigned long long utime = 0;
+		unsigned long long stime = 0;
+
+		if( sscanf(nameEnd + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2 )
+			continue;
+
+		usage.ticks = utime + stime;
+		threads.push_back(usage);
+	}
+
+	closedir(dir);
+	return threads;
+}
+
+
+// read the GPU load (0-100%) from sysfs on Jetson, or return -1 if it's unavailable
+static float readGpuLoad()
+{
+	static const char* paths[] = { "/sys/devices/gpu.0/load", 
+							 "/sys/devices/platform/gpu.0/load",
+							 "/sys/devices/17000000.ga10b/load",
+							 "/sys/devices/17000000.gv11b/load" };
+
+	for( uint32_t n=0; n < sizeof(paths) / sizeof(paths[0]); n++ )
+	{
+		FILE* file = fopen(paths[n], "r");
+
+		if( !file )
+			continue;
+
+		int load = 0;
+		const bool ok = (fscanf(file, "%d", &load) == 1);
+		fclose(file);
+
+		if( ok )
+			return load * 0.1f;	// reported in units of 0.1%
+	}
+
+	return -1.0f;
+}
+
+
+// compute a percentile of a set of samples
+static float percentile( std::vector<float>& samples, float p )
+{
+	if( samples.size() == 0 )
+		return 0.0f;
+
+	std::vector<float>::iterator n = samples.begin() + (size_t)((samples.size() - 1) * p);
+	std::nth_element(samples.begin(), n, samples.end());
+	return *n;
+}
+
+
+int main( int argc, char** argv )
+{
+	/*
+	 * parse command line
+	 */
+	commandLine cmdLine(argc, argv);
+
+	if( cmdLine.GetFlag("help") )
+		return usage();
+
+	const float duration = cmdLine.GetFloat("duration", 30.0f);
+	const float warmup = cmdLine.GetFloat("warmup", 2.0f);
+
+	const imageFormat captureFormat = imageFormatFromStr(cmdLine.GetString("format", "rgb8"));
+	const imageFormat convertFormat = imageFormatFromStr(cmdLine.GetString("convert", imageFormatToStr(captureFormat)));
+
+	if( captureFormat == IMAGE_UNKNOWN || convertFormat == IMAGE_UNKNOWN )
+	{
+		LogError("video-bench:  invalid --format or --convert\n");
+		return 1;
+	}
+
+
+	/*
+	 * attach signal handler
+	 */	
+	if( signal(SIGINT, sig_handler) == SIG_ERR )
+		LogError("can't catch SIGINT\n");
+
+
+	/*
+	 * create input video stream
+	 */
+	videoSource* inputStream = videoSource::Create(cmdLine, ARG_POSITION(0));
+
+	if( !inputStream )
+	{
+		LogError("video-bench:  failed to create input stream\n");
+		return 1;
+	}
+
+
+	/*
+	 * create output video stream (without the display substream)
+	 */
+	videoOutput* outputStream = NULL;
+
+	if( cmdLine.GetPositionArgs() > ARG_POSITION(1) )
+	{
+		videoOptions outputOptions;
+
+		if( outputOptions.Parse(cmdLine, videoOptions::OUTPUT, ARG_POSITION(1)) )
+			outputStream = videoOutput::Create(outputOptions);
+	}
+	else
+	{
+		outputStream = videoOutput::CreateNullOutput();
+	}
+
+	if( !outputStream )
+	{
+		LogError("video-bench:  failed to create output stream\n");
+		return 1;
+	}
+
+
+	/*
+	 * benchmark loop
+	 */
+	void* convertBuffer = NULL;
+	size_t convertSize = 0;
+
+	std::vector<float> latencies;	// capture -> output, in ms
+	std::vector<threadUsage> threadsBegin;
+
+	uint64_t numFrames = 0;
+	uint64_t numTimeouts = 0;
+	uint64_t numDropped = 0;
+	uint64_t lastCaptureTime = 0;
+
+	double gpuLoad = 0.0;
+	uint32_t gpuSamples = 0;
+	uint64_t gpuSampleTime = 0;
+
+	const uint64_t startTime = timeNow();
+	const uint64_t measureTime = startTime + (uint64_t)(warmup * 1.0e9f);
+	const uint64_t endTime = measureTime + (uint64_t)(duration * 1.0e9f);
+
+	bool measuring = false;
+
+	while( !signal_recieved )
+	{
+		const uint64_t now = timeNow();
+
+		if( now >= endTime )
+			break;
+
+		if( !measuring && now >= measureTime )
+		{
+			threadsBegin = readThreadUsage();
+			measuring = true;
+		}
+
+		void* image = NULL;
+
+		if( !inputStream->Capture(&image, captureFormat, 1000) )
+		{
+			if( !inputStream->IsStreaming() )
+			{
+				LogWarning("video-bench:  end of stream\n");
+				break;
+			}
+
+			if( measuring )
+				numTimeouts++;
+
+			continue;
+		}
+
+		const uint32_t width = inputStream->GetWidth();
+		const uint32_t height = inputStream->GetHeight();
+		const uint64_t captureTime = inputStream->GetLastCaptureTime();
+
+		// convert
+		imageFormat outputFormat = captureFormat;
+
+		if( convertFormat != captureFormat )
+		{
+			const size_t size = imageFormatSize(convertFormat, width, height);
+
+			if( size > convertSize )
+			{
+				CUDA_FREE(convertBuffer);
+
+				if( CUDA_FAILED(cudaMalloc(&convertBuffer, size)) )
+					break;
+
+				convertSize = size;
+			}
+
+			if( CUDA_FAILED(cudaConvertColor(image, captureFormat, convertBuffer, convertFormat, width, height)) )
+				break;
+
+			image = convertBuffer;
+			outputFormat = convertFormat;
+		}
+
+		// output
+		outputStream->Render(image, width, height, outputFormat);
+
+		if( !outputStream->IsStreaming() )
+			break;
+
+		if( !measuring )
+		{
+			lastCaptureTime = captureTime;
+			continue;
+		}
+
+		numFrames++;
+
+		// latency from capture to after the frame was submitted to the output
+		if( captureTime != 0 )
+		{
+			latencies.push_back((timeNow() - captureTime) * 0.000001f);
+
+			// frames are counted as dropped when the gap between capture times
+			// is more than 1.5x the frame interval of the source
+			const uint32_t frameRate = inputStream->GetFrameRate();
+
+			if( lastCaptureTime != 0 && frameRate > 0 && captureTime > lastCaptureTime )
+			{
+				const double interval = 1.0e9 / frameRate;
+				const double gap = captureTime - lastCaptureTime;
+
+				if( gap > interval * 1.5 )
+					numDropped += (uint64_t)(gap / interval + 0.5) - 1;
+			}
+
+			lastCaptureTime = captureTime;
+		}
+
+		// sample the GPU load a few times per second
+		if( now - gpuSampleTime > 250000000 )
+		{
+			const float load = readGpuLoad();
+
+			if( load >= 0.0f )
+			{
+				gpuLoad += load;
+				gpuSamples++;
+			}
+
+			gpuSampleTime = now;
+		}
+	}
+
+	const uint64_t stopTime = timeNow();
+	const std::vector<threadUsage> threadsEnd = readThreadUsage();
+
+
+	/*
+	 * report results
+	 */
+	const double elapsed = measuring ? (stopTime - measureTime) * 1.0e-9 : 0.0;
+
+	if( elapsed > 0.0 && numFrames > 0 )
+	{
+		const double fps = numFrames / elapsed;
+		const double ticksPerSec = sysconf(_SC_CLK_TCK);
+
+		printf("\n");
+		printf("video-bench:  %s -> %s -> %s\n", inputStream->GetResource().string.c_str(), 
+			  imageFormatToStr(convertFormat), outputStream->GetResource().string.size() > 0 ? outputStream->GetResource().string.c_str() : "null");
+		printf("video-bench:  %ux%u  %llu frames in %.2f seconds\n", inputStream->GetWidth(), inputStream->GetHeight(), (unsigned long long)numFrames, elapsed);
+		printf("video-bench:  %.2f FPS (source rate %u FPS)\n", fps, inputStream->GetFrameRate());
+		printf("video-bench:  %llu dropped, %llu timeouts\n", (unsigned long long)numDropped, (unsigned long long)numTimeouts);
+
+		float latencyMin = 0.0f, latencyP50 = 0.0f, latencyP90 = 0.0f, latencyP99 = 0.0f, latencyMax = 0.0f;
+
+		if( latencies.size() > 0 )
+		{
+			latencyMin = *std::min_element(latencies.begin(), latencies.end());
+			latencyMax = *std::max_element(latencies.begin(), latencies.end());
+			latencyP50 = percentile(latencies, 0.50f);
+			latencyP90 = percentile(latencies, 0.90f);
+			latencyP99 = percentile(latencies, 0.99f);
+
+			printf("video-bench:  latency (ms)  min %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", 
+				  latencyMin, latencyP50, latencyP90, latencyP99, latencyMax);
+		}
+		else
+		{
+			printf("video-bench:  latency (ms)  n/a (the source doesn't track capture times)\n");
+		}
+
+		if( gpuSamples > 0 )
+			printf("video-bench:  GPU load %.1f%%\n", gpuLoad / gpuSamples);
+		else
+			printf("video-bench:  GPU load n/a\n");
+
+		// CPU usage of each thread over the measurement
+		double cpuTotal = 0.0;
+
+		printf("video-bench:  %-8s %-16s %6s\n", "tid", "thread", "cpu");
+
+		for( size_t n=0; n < threadsEnd.size(); n++ )
+		{
+			uint64_t ticks = threadsEnd[n].ticks;
+
+			for( size_t m=0; m < threadsBegin.size(); m++ )
+			{
+				if( threadsBegin[m].tid == threadsEnd[n].tid )
+				{
+					ticks -= threadsBegin[m].ticks;
+					break;
+				}
+			}
+
+			const double cpu = ticks / ticksPerSec / elapsed * 100.0;
+
+			if( cpu < 0.05 )
+				continue;
+
+			printf("video-bench:  %-8i %-16s %5.1f%%\n", threadsEnd[n].tid, threadsEnd[n].name.c_str(), cpu);
+			cpuTotal += cpu;
+		}
+
+		printf("video-bench:  %-8s %-16s %5.1f%%\n", "", "total", cpuTotal);
+
+		// save the results to CSV
+		const char* csvPath = cmdLine.GetString("csv");
+
+		if( csvPath != NULL )
+		{
+			csvWriter* csvFile = csvWriter::Open(csvPath);
+
+			if( csvFile != NULL )
+			{
+				csvFile->WriteLine("input", "output", "format", "width", "height", "frames", "seconds", "fps", "dropped", "timeouts",
+							    "latency_min", "latency_p50", "latency_p90", "latency_p99", "latency_max", "cpu", "gpu");
+
+				csvFile->WriteLine(inputStream->GetResource().string, outputStream->GetResource().string, imageFormatToStr(convertFormat),
+							    inputStream->GetWidth(), inputStream->GetHeight(), numFrames, elapsed, fps, numDropped, numTimeouts,
+							    latencyMin, latencyP50, latencyP90, latencyP99, latencyMax, cpuTotal, (gpuSamples > 0) ? gpuLoad / gpuSamples : -1.0);
+
+				delete csvFile;
+			}
+		}
+	}
+	else
+	{
+		LogError("video-bench:  no frames were measured\n");
+	}
+
+
+	/*
+	 * destroy resources
+	 */
+	printf("video-bench:  shutting down...\n");
+	
+	CUDA_FREE(convertBuffer);
+
+	SAFE_DELETE(inputStream);
+	SAFE_DELETE(outputStream);
+
+	printf("video-bench:  shutdown complete\n");
+	return 0;
+}
@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "videoLatency.h"
+#include "videoOutput.h"
+
+#include "cudaDraw.h"
+#include "cudaMappedMemory.h"
+
+#include "logging.h"
+#include "Mutex.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+
+// the timestamp pattern is a row of cells, an 8-bit marker followed by the 64-bit capture time
+#define PATTERN_MAGIC      0xA5
+#define PATTERN_MAGIC_BITS 8
+#define PATTERN_CELLS      (PATTERN_MAGIC_BITS + 64)
+#define PATTERN_MAX_CELL   8
+#define PATTERN_MIN_CELL   2
+
+bool videoLatency::mEnabled = false;
+bool videoLatency::mPattern = false;
+
+
+// capture time of an image
+struct latencyFrame
+{
+	const void* image;
+	uint64_t    captureTime;
+};
+
+// latency statistics of an output
+struct latencyOutput
+{
+	videoOutput*      output;
+	std::string       name;
+	videoLatencyStats stats;
+	double            total;
+};
+
+static latencyFrame gFrames[VIDEO_LATENCY_FRAMES];
+static uint32_t gNextFrame = 0;
+
+static std::vector<latencyOutput*> gOutputs;
+static cudaDrawPrimitive* gPatternCells = NULL;
+
+static Mutex gMutex;
+
+
+// the current time in CLOCK_MONOTONIC
+static inline uint64_t monotonicTime()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * uint64_t(1000000000) + (uint64_t)t.tv_nsec;
+}
+
+
+// the size of the pattern cells for an image (or 0 if the image is too small)
+static inline int patternCellSize( uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !imageFormatIsRGB(format) )
+		return 0;
+
+	const int cell = std::min<int>(PATTERN_MAX_CELL, width / PATTERN_CELLS);
+
+	if( cell < PATTERN_MIN_CELL || height < (uint32_t)cell )
+		return 0;
+
+	return cell;
+}
+
+
+// SetEnabled
+void videoLatency::SetEnabled( bool enabled )
+{
+	if( enabled == mEnabled )
+		return;
+
+	LogVerbose(LOG_VIDEO "videoLatency -- latency measurement %s\n", enabled ? "enabled" : "disabled");
+	mEnabled = enabled;
+}
+
+
+// SetPattern
+void videoLatency::SetPattern( bool enabled )
+{
+	mPattern = enabled;
+
+	if( enabled )
+		SetEnabled(true);
+}
+
+
+// ParseCmdLine
+void videoLatency::ParseCmdLine( const commandLine& cmdLine )
+{
+	if( cmdLine.GetFlag("latency") )
+		SetEnabled(true);
+
+	if( cmdLine.GetFlag("latency-pattern") )
+		SetPattern(true);
+}
+
+
+// drawPattern (the mutex should be locked)
+static void drawPattern( void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t captureTime )
+{
+	const int cell = patternCellSize(width, height, format);
+
+	if( cell == 0 )
+		return;
+
+	if( !gPatternCells && !cudaAllocMapped((void**)&gPatternCells, (PATTERN_CELLS + 1) * sizeof(cudaDrawPrimitive)) )
+		return;
+
+	// black background, with white rects for the 1 bits
+	uint32_t count = 0;
+
+	gPatternCells[count].type  = CUDA_DRAW_RECT;
+	gPatternCells[count].color = make_float4(0,0,0,255);
+	gPatternCells[count].x1    = 0;
+	gPatternCells[count].y1    = 0;
+	gPatternCells[count].x2    = PATTERN_CELLS * cell;
+	gPatternCells[count].y2    = cell;
+	gPatternCells[count].size  = 0;
+	count++;
+
+	for( int n=0; n < PATTERN_CELLS; n++ )
+	{
+		const bool bit = (n < PATTERN_MAGIC_BITS) ? (PATTERN_MAGIC >> (PATTERN_MAGIC_BITS - 1 - n)) & 1
+										  : (captureTime >> (63 - (n - PATTERN_MAGIC_BITS))) & 1;
+		if( !bit )
+			continue;
+
+		gPatternCells[count].type  = CUDA_DRAW_RECT;
+		gPatternCells[count].color = make_float4(255,255,255,255);
+		gPatternCells[count].x1    = n * cell;
+		gPatternCells[count].y1    = 0;
+		gPatternCells[count].x2    = (n + 1) * cell;
+		gPatternCells[count].y2    = cell;
+		gPatternCells[count].size  = 0;
+		count++;
+	}
+
+	if( CUDA_FAILED(cudaDrawPrimitives(image, image, width, height, format, gPatternCells, count)) )
+		return;
+
+	// the cells get overwritten by the next frame
+	CUDA(cudaStreamSynchronize(NULL));
+}
+
+
+// decodePattern
+static uint64_t decodePattern( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	const int cell = patternCellSize(width, height, format);
+
+	if( cell == 0 )
+		return 0;
+
+	// read the middle row of the cells
+	const size_t pixelSize = imageFormatSize(format, 1, 1);
+	const size_t rowOffset = (cell / 2) * width * pixelSize;
+	const size_t rowSize = PATTERN_CELLS * cell * pixelSize;
+
+	uint8_t row[PATTERN_CELLS * PATTERN_MAX_CELL * sizeof(float4)];
+
+	if( CUDA_FAILED(cudaMemcpy(row, (uint8_t*)image + rowOffset, rowSize, cudaMemcpyDefault)) )
+		return 0;
+
+	const bool isFloat = (imageFormatBaseType(format) == IMAGE_FLOAT);
+
+	uint32_t magic = 0;
+	uint64_t captureTime = 0;
+
+	for( int n=0; n < PATTERN_CELLS; n++ )
+	{
+		const uint8_t* pixel = row + (n * cell + cell / 2) * pixelSize;
+		const float value = isFloat ? *(float*)pixel : *pixel;
+		const uint32_t bit = (value > 127.0f) ? 1 : 0;
+
+		if( n < PATTERN_MAGIC_BITS )
+			magic = (magic << 1) | bit;
+		else
+			captureTime = (captureTime << 1) | bit;
+	}
+
+	if( magic != PATTERN_MAGIC )
+		return 0;
+
+	return captureTime;
+}
+
+
+// Stamp
+void videoLatency::Stamp( void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t captureTime )
+{
+	if( !mEnabled || !image )
+		return;
+
+	// streams that don't track the capture time get the time they were dequeued
+	if( captureTime == 0 )
+		captureTime = monotonicTime();
+
+	gMutex.Lock();
+
+	uint32_t index = gNextFrame;
+
+	for( uint32_t n=0; n < VIDEO_LATENCY_FRAMES; n++ )
+	{
+		if( gFrames[n].image == image )
+		{
+			index = n;
+			break;
+		}
+	}
+
+	if( index == gNextFrame )
+		gNextFrame = (gNextFrame + 1) % VIDEO_LATENCY_FRAMES;
+
+	gFrames[index].image = image;
+	gFrames[index].captureTime = captureTime;
+
+	if( mPattern )
+		drawPattern(image, width, height, format, captureTime);
+
+	gMutex.Unlock();
+}
+
+
+// Propagate
+void videoLatency::Propagate( const void* input, void* output )
+{
+	if( !mEnabled || !input || !output || input == output )
+		return;
+
+	uint64_t captureTime = 0;
+
+	gMutex.Lock();
+
+	for( uint32_t n=0; n < VIDEO_LATENCY_FRAMES; n++ )
+	{
+		if( gFrames[n].image == input )
+		{
+			captureTime = gFrames[n].captureTime;
+			break;
+		}
+	}
+
+	gMutex.Unlock();
+
+	if( captureTime != 0 )
+		Stamp(output, 0, 0, IMAGE_UNKNOWN, captureTime);
+}
+
+
+// GetCaptureTime
+uint64_t videoLatency::GetCaptureTime( void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !image )
+		return 0;
+
+	gMutex.Lock();
+
+	for( uint32_t n=0; n < VIDEO_LATENCY_FRAMES; n++ )
+	{
+		if( gFrames[n].image == image )
+		{
+			const uint64_t captureTime = gFrames[n].captureTime;
+			gMutex.Unlock();
+			return captureTime;
+		}
+	}
+
+	gMutex.Unlock();
+
+	if( mPattern )
+		return decodePattern(image, width, height, format);
+
+	return 0;
+}
+
+
+// findOutput (the mutex should be locked)
+static latencyOutput* findOutput( videoOutput* output )
+{
+	for( size_t n=0; n < gOutputs.size(); n++ )
+	{
+		if( gOutputs[n]->output == output )
+			return gOutputs[n];
+	}
+
+	return NULL;
+}
+
+
+// Report
+void videoLatency::Report( videoOutput* output, void* image, uint32_t width, uint32_t height, imageFormat format )
+{
+	if( !mEnabled || !output )
+		return;
+
+	const uint64_t captureTime = GetCaptureTime(image, width, height, format);
+
+	if( captureTime == 0 )
+		return;
+
+	const uint64_t now = monotonicTime();
+
+	if( now < captureTime )
+		return;
+
+	const float latency = (now - captureTime) * 0.000001f;
+
+	gMutex.Lock();
+
+	latencyOutput* entry = findOutput(output);
+
+	if( !entry )
+	{
+		entry = new latencyOutput();
+		memset(&entry->stats, 0, sizeof(videoLatencyStats));
+
+		entry->output = output;
+		entry->name   = std::string(output->TypeToStr()) + " (" + output->GetResource().string + ")";
+		entry->total  = 0.0;
+
+		gOutputs.push_back(entry);
+	}
+
+	videoLatencyStats& stats = entry->stats;
+
+	if( stats.count == 0 || latency < stats.min )
+		stats.min = latency;
+
+	if( stats.count == 0 || latency > stats.max )
+		stats.max = latency;
+
+	const uint32_t bin = std::min<uint32_t>((uint32_t)latency, VIDEO_LATENCY_BINS - 1);
+
+	stats.histogram[bin]++;
+	stats.count++;
+	stats.last = latency;
+
+	entry->total += latency;
+	stats.avg = entry->total / stats.count;
+
+	// p99 is the upper edge of the bin that reaches 99% of the frames
+	const uint64_t p99Count = (stats.count * 99 + 99) / 100;
+	uint64_t sum = 0;
+
+	for( uint32_t n=0; n < VIDEO_LATENCY_BINS; n++ )
+	{
+		sum += stats.histogram[n];
+
+		if( sum >= p99Count )
+		{
+			stats.p99 = std::min<float>(n + 1, stats.max);
+			break;
+		}
+	}
+
+	gMutex.Unlock();
+}
+
+
+// GetStats
+bool videoLatency::GetStats( videoOutput* output, videoLatencyStats* stats )
+{
+	if( !stats )
+		return false;
+
+	gMutex.Lock();
+
+	latencyOutput* entry = findOutput(output);
+
+	if( entry != NULL )
+		memcpy(stats, &entry->stats, sizeof(videoLatencyStats));
+
+	gMutex.Unlock();
+	return (entry != NULL);
+}
+
+
+// Print
+void videoLatency::Print()
+{
+	gMutex.Lock();
+
+	for( size_t n=0; n < gOutputs.size(); n++ )
+	{
+		const videoLatencyStats& stats = gOutputs[n]->stats;
+
+		LogInfo(LOG_VIDEO "latency of %s over %llu frames\n", gOutputs[n]->name.c_str(), (unsigned long long)stats.count);
+		LogInfo(LOG_VIDEO "   min %.2f ms   avg %.2f ms   p99 %.2f ms   max %.2f ms\n", stats.min, stats.avg, stats.p99, stats.max);
+
+		for( uint32_t b=0; b < VIDEO_LATENCY_BINS; b++ )
+		{
+			if( stats.histogram[b] == 0 )
+				continue;
+
+			if( b == VIDEO_LATENCY_BINS - 1 )
+				LogInfo(LOG_VIDEO "   >= %3u ms   %u\n", b, stats.histogram[b]);
+			else
+				LogInfo(LOG_VIDEO "   %3u-%3u ms   %u\n", b, b + 1, stats.histogram[b]);
+		}
+	}
+
+	gMutex.Unlock();
+}
+
+
+// Reset
+void videoLatency::Reset()
+{
+	gMutex.Lock();
+
+	for( size_t n=0; n < gOutputs.size(); n++ )
+	{
+		memset(&gOutputs[n]->stats, 0, sizeof(videoLatencyStats));
+		gOutputs[n]->total = 0.0;
+	}
+
+	gMutex.Unlock();
+}
+
+
+// Remove
+void videoLatency::Remove( videoOutput* output )
+{
+	gMutex.Lock();
+
+	for( size_t n=0; n < gOutputs.size(); n++ )
+	{
+		if( gOutputs[n]->output == output )
+		{
+			delete gOutputs[n];
+			gOutputs.erase(gOutputs.begin() + n);
+			break;
+		}
+	}
+
+	gMutex.Unlock();
+}
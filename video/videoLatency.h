@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __VIDEO_LATENCY_H_
+#define __VIDEO_LATENCY_H_
+
+
+#include "imageFormat.h"
+#include "commandLine.h"
+
+#include <stdint.h>
+
+
+/**
+ * The number of 1ms bins in the latency histograms (the last bin counts everything above that).
+ * @ingroup video
+ */
+#define VIDEO_LATENCY_BINS 250
+
+/**
+ * The number of captured frames whose capture time is remembered by videoLatency.
+ * @ingroup video
+ */
+#define VIDEO_LATENCY_FRAMES 64
+
+
+class videoOutput;
+
+
+/**
+ * Latency statistics of one videoOutput, with the times in milliseconds.
+ * @ingroup video
+ */
+struct videoLatencyStats
+{
+	float    min;		/**< Minimum latency */
+	float    max;		/**< Maximum latency */
+	float    avg;		/**< Average latency */
+	float    p99;		/**< 99th percentile latency (estimated from the histogram) */
+	float    last;		/**< Latency of the most recent frame */
+	uint64_t count;	/**< Number of frames measured */
+
+	uint32_t histogram[VIDEO_LATENCY_BINS];	/**< Number of frames with a latency of N to N+1 ms */
+};
+
+
+/**
+ * Measures the latency from capture to output of each frame.
+ *
+ * While enabled, the videoSource implementations stamp every captured image with
+ * its capture time (see videoSource::GetLastCaptureTime()), and each videoOutput
+ * compares that against CLOCK_MONOTONIC when the image has been submitted to it.
+ * The per-output results are aggregated into histograms.
+ *
+ * Frames are matched by their image pointer, so processing that's done in-place
+ * is tracked automatically.  If processing writes to a new image, call Propagate()
+ * to carry over the capture time.  Alternatively, with the timestamp pattern enabled,
+ * the capture time is drawn into the top rows of the image as a strip of black and
+ * white cells, which videoOutput decodes again when the image isn't found (and which
+ * can be read from a recording of the screen for glass-to-glass measurements).
+ *
+ * For gstEncoder outputs the latency is measured when the frame is submitted to the
+ * encoder, so it doesn't include encoding and transmission.
+ *
+ * Enable it with videoLatency::SetEnabled() or the `--latency` and `--latency-pattern`
+ * command-line flags.
+ *
+ * @ingroup video
+ */
+class videoLatency
+{
+public:
+	/**
+	 * Enable or disable latency measurement.
+	 */
+	static void SetEnabled( bool enabled=true );
+
+	/**
+	 * Return true if latency measurement is enabled.
+	 */
+	static inline bool IsEnabled()				{ return mEnabled; }
+
+	/**
+	 * Enable or disable drawing the timestamp pattern into captured images.
+	 * This also enables latency measurement.
+	 */
+	static void SetPattern( bool enabled=true );
+
+	/**
+	 * Return true if the timestamp pattern is drawn into captured images.
+	 */
+	static inline bool IsPatternEnabled()			{ return mPattern; }
+
+	/**
+	 * Parse the `--latency` and `--latency-pattern` command-line options.
+	 */
+	static void ParseCmdLine( const commandLine& cmdLine );
+
+	/**
+	 * Record the capture time (in nanoseconds of CLOCK_MONOTONIC) of an image.
+	 * This is called by the videoSource implementations after they capture a frame.
+	 */
+	static void Stamp( void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t captureTime );
+
+	/**
+	 * Carry the capture time of one image over to another one
+	 * (for when processing writes its results to a different image).
+	 */
+	static void Propagate( const void* input, void* output );
+
+	/**
+	 * Look up the capture time of an image (or decode it from the timestamp pattern).
+	 * @returns the capture time in nanoseconds of CLOCK_MONOTONIC, or 0 if it's unknown.
+	 */
+	static uint64_t GetCaptureTime( void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	/**
+	 * Measure the latency of an image that was submitted to an output.
+	 * This is called by videoOutput::Render().
+	 */
+	static void Report( videoOutput* output, void* image, uint32_t width, uint32_t height, imageFormat format );
+
+	/**
+	 * Retrieve the latency statistics of an output.
+	 * @returns false if no frames have been measured from that output.
+	 */
+	static bool GetStats( videoOutput* output, videoLatencyStats* stats );
+
+	/**
+	 * Log the latency statistics of every output.
+	 */
+	static void Print();
+
+	/**
+	 * Clear the statistics of every output.
+	 */
+	static void Reset();
+
+	/**
+	 * Forget the statistics of an output (called when it's destroyed).
+	 */
+	static void Remove( videoOutput* output );
+
+protected:
+	static bool mEnabled;
+	static bool mPattern;
+};
+
+
+#endif
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "videoMetrics.h"
+#include "videoSource.h"
+#include "videoOutput.h"
+#include "videoLatency.h"
+
+#include "cudaMemoryStats.h"
+#include "profiler.h"
+#include "Mutex.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+
+static std::vector<videoSource*> gSources;
+static std::vector<videoOutput*> gOutputs;
+
+static Mutex gMutex;
+
+
+// statistics of a source, copied while the lock is held
+struct metricsSource
+{
+	std::string      labels;
+	videoSourceStats stats;
+};
+
+// statistics of an output, copied while the lock is held
+struct metricsOutput
+{
+	std::string       labels;
+	uint64_t          frames;
+	uint32_t          bitrate;
+	bool              latency;
+	videoLatencyStats latencyStats;
+};
+
+
+// Add
+void videoMetrics::Add( videoSource* source )
+{
+	gMutex.Lock();
+	gSources.push_back(source);
+	gMutex.Unlock();
+}
+
+
+// Add
+void videoMetrics::Add( videoOutput* output )
+{
+	gMutex.Lock();
+	gOutputs.push_back(output);
+	gMutex.Unlock();
+}
+
+
+// Remove
+void videoMetrics::Remove( videoSource* source )
+{
+	gMutex.Lock();
+	gSources.erase(std::remove(gSources.begin(), gSources.end(), source), gSources.end());
+	gMutex.Unlock();
+}
+
+
+// Remove
+void videoMetrics::Remove( videoOutput* output )
+{
+	gMutex.Lock();
+	gOutputs.erase(std::remove(gOutputs.begin(), gOutputs.end(), output), gOutputs.end());
+	gMutex.Unlock();
+}
+
+
+// escape a label value (backslashes, quotes and newlines)
+static std::string escapeLabel( const std::string& value )
+{
+	std::string str;
+
+	for( size_t n=0; n < value.length(); n++ )
+	{
+		if( value[n] == '\\' || value[n] == '"' )
+			str += '\\';
+		else if( value[n] == '\n' )
+		{
+			str += "\\n";
+			continue;
+		}
+
+		str += value[n];
+	}
+
+	return str;
+}
+
+
+// the labels that identify a stream
+static std::string streamLabels( const std::string& resource, const char* type )
+{
+	return "stream=\"" + escapeLabel(resource) + "\",type=\"" + escapeLabel(type) + "\"";
+}
+
+
+// the HELP and TYPE lines of a metric
+static void metricHeader( std::ostringstream& ss, const char* name, const char* type, const char* help )
+{
+	ss << "# HELP " << name << " " << help << "\n";
+	ss << "# TYPE " << name << " " << type << "\n";
+}
+
+
+// a summary from min/p99/max/avg (the sum is reconstructed from the average)
+static void metricSummary( std::ostringstream& ss, const char* name, const std::string& labels, float min, float p99, float max, float avg, uint64_t count )
+{
+	ss << name << "{" << labels << ",quantile=\"0\"} " << min << "\n";
+	ss << name << "{" << labels << ",quantile=\"0.99\"} " << p99 << "\n";
+	ss << name << "{" << labels << ",quantile=\"1\"} " << max << "\n";
+	ss << name << "_sum{" << labels << "} " << (double(avg) * count) << "\n";
+	ss << name << "_count{" << labels << "} " << count << "\n";
+}
+
+
+// Render
+std::string videoMetrics::Render()
+{
+	std::vector<metricsSource> sources;
+	std::vector<metricsOutput> outputs;
+
+	// copy the statistics, so the streams can't be destroyed while they're read
+	gMutex.Lock();
+
+	for( size_t n=0; n < gSources.size(); n++ )
+	{
+		metricsSource source;
+
+		if( !gSources[n]->GetStats(&source.stats) )
+			continue;
+
+		source.labels = streamLabels(gSources[n]->GetResource().string, gSources[n]->TypeToStr());
+		sources.push_back(source);
+	}
+
+	for( size_t n=0; n < gOutputs.size(); n++ )
+	{
+		const videoOptions& options = gOutputs[n]->GetOptions();
+
+		metricsOutput output;
+
+		output.labels  = streamLabels(options.resource.string, gOutputs[n]->TypeToStr());
+		output.frames  = options.frameCount;
+		output.bitrate = options.bitRate;
+		output.latency = videoLatency::GetStats(gOutputs[n], &output.latencyStats);
+
+		outputs.push_back(output);
+	}
+
+	gMutex.Unlock();
+
+	std::ostringstream ss;
+
+	// sources
+	#define SOURCE_METRIC(name, type, help, value) \
+		if( sources.size() > 0 ) { \
+			metricHeader(ss, name, type, help); \
+			for( size_t n=0; n < sources.size(); n++ ) \
+				ss << name << "{" << sources[n].labels << "} " << sources[n].stats.value << "\n"; \
+		}
+
+	SOURCE_METRIC("jetson_source_frames_received_total", "counter", "Frames that arrived from the stream", framesReceived);
+	SOURCE_METRIC("jetson_source_frames_captured_total", "counter", "Frames that were captured by the application", framesCaptured);
+	SOURCE_METRIC("jetson_source_frames_dropped_total", "counter", "Frames that were replaced by a newer one before they were captured", framesDropped);
+	SOURCE_METRIC("jetson_source_frames_skipped_total", "counter", "Frames that were skipped without being converted by the adaptive rate", framesSkipped);
+	SOURCE_METRIC("jetson_source_queue_depth", "gauge", "Frames that arrived since the last capture", queueDepth);
+	SOURCE_METRIC("jetson_source_max_queue_depth", "gauge", "The largest queue depth so far", maxQueueDepth);
+	SOURCE_METRIC("jetson_source_fps", "gauge", "Framerate that the frames arrive at", frameRate);
+	SOURCE_METRIC("jetson_source_frame_interval_ms", "gauge", "Average time between the frames arriving", interval);
+	SOURCE_METRIC("jetson_source_max_frame_interval_ms", "gauge", "Longest time between two frames arriving", maxInterval);
+	SOURCE_METRIC("jetson_source_jitter_ms", "gauge", "Average deviation of the time between frames from the average", jitter);
+	SOURCE_METRIC("jetson_source_convert_ms", "gauge", "Average time to map and convert a captured frame", convertTime);
+	SOURCE_METRIC("jetson_source_max_convert_ms", "gauge", "Longest time to map and convert a captured frame", maxConvertTime);
+	SOURCE_METRIC("jetson_source_capture_interval_ms", "gauge", "Average time between the application's captures", captureInterval);
+
+	#undef SOURCE_METRIC
+
+	// outputs
+	if( outputs.size() > 0 )
+	{
+		metricHeader(ss, "jetson_output_frames_total", "counter", "Frames that were rendered to the output");
+
+		for( size_t n=0; n < outputs.size(); n++ )
+			ss << "jetson_output_frames_total{" << outputs[n].labels << "} " << outputs[n].frames << "\n";
+
+		metricHeader(ss, "jetson_output_bitrate_bps", "gauge", "Target bitrate of the encoder (including adjustments from congestion control)");
+
+		for( size_t n=0; n < outputs.size(); n++ )
+		{
+			if( outputs[n].bitrate > 0 )
+				ss << "jetson_output_bitrate_bps{" << outputs[n].labels << "} " << outputs[n].bitrate << "\n";
+		}
+
+		metricHeader(ss, "jetson_output_latency_ms", "summary", "Latency from the capture of a frame to its output");
+
+		for( size_t n=0; n < outputs.size(); n++ )
+		{
+			const videoLatencyStats& stats = outputs[n].latencyStats;
+
+			if( outputs[n].latency )
+				metricSummary(ss, "jetson_output_latency_ms", outputs[n].labels, stats.min, stats.p99, stats.max, stats.avg, stats.count);
+		}
+	}
+
+	// profiler
+	const std::vector<std::string> stages = Profiler::GetStages();
+
+	if( stages.size() > 0 )
+	{
+		std::vector<profilerStats> cpu(stages.size());
+		std::vector<profilerStats> gpu(stages.size());
+
+		for( size_t n=0; n < stages.size(); n++ )
+		{
+			if( !Profiler::GetStats(stages[n].c_str(), &cpu[n], &gpu[n]) )
+				cpu[n].count = gpu[n].count = 0;
+		}
+
+		metricHeader(ss, "jetson_profiler_cpu_ms", "summary", "CPU time of the profiler stage");
+
+		for( size_t n=0; n < stages.size(); n++ )
+		{
+			if( cpu[n].count > 0 )
+				metricSummary(ss, "jetson_profiler_cpu_ms", "stage=\"" + escapeLabel(stages[n]) + "\"", cpu[n].min, cpu[n].p99, cpu[n].max, cpu[n].avg, cpu[n].count);
+		}
+
+		metricHeader(ss, "jetson_profiler_gpu_ms", "summary", "GPU time of the profiler stage");
+
+		for( size_t n=0; n < stages.size(); n++ )
+		{
+			if( gpu[n].count > 0 )
+				metricSummary(ss, "jetson_profiler_gpu_ms", "stage=\"" + escapeLabel(stages[n]) + "\"", gpu[n].min, gpu[n].p99, gpu[n].max, gpu[n].avg, gpu[n].count);
+		}
+	}
+
+	// memory
+	metricHeader(ss, "jetson_cuda_memory_bytes", "gauge", "CUDA memory allocated by jetson-utils");
+
+	for( uint32_t n=0; n < CUDA_MEMORY_CATEGORIES; n++ )
+		ss << "jetson_cuda_memory_bytes{category=\"" << cudaMemoryCategoryToStr((cudaMemoryCategory)n) << "\"} " << cudaMemoryUsage((cudaMemoryCategory)n) << "\n";
+
+	metricHeader(ss, "jetson_cuda_memory_peak_bytes", "gauge", "The most CUDA memory that was allocated by jetson-utils at once");
+	ss << "jetson_cuda_memory_peak_bytes " << cudaMemoryPeak() << "\n";
+
+	const size_t budget = cudaMemoryGetBudget();
+
+	if( budget > 0 )
+	{
+		metricHeader(ss, "jetson_cuda_memory_budget_bytes", "gauge", "The budget of CUDA memory (see cudaMemorySetBudget())");
+		ss << "jetson_cuda_memory_budget_bytes " << budget << "\n";
+	}
+
+	return ss.str();
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __VIDEO_METRICS_H_
+#define __VIDEO_METRICS_H_
+
+
+#include <string>
+
+
+class videoSource;
+class videoOutput;
+
+
+/**
+ * Exports the statistics of the video streams, the Profiler, and the CUDA memory accounting
+ * in the Prometheus text format, so they can be scraped by fleet monitoring.
+ *
+ * Every videoSource and videoOutput registers itself when it's created, and Render() reports
+ * the frame statistics of each source (see videoSource::GetStats()), the frames, bitrate and
+ * latency of each output (see videoLatency), the time taken by each profiler stage, and the
+ * memory usage by category (see cudaMemoryUsage()).  The streams are labelled with their
+ * resource URI and type.  The latency and profiler times are exported as summaries with
+ * the min (quantile 0), 99th percentile, and max (quantile 1), and the times are in milliseconds.
+ *
+ * WebRTCServer serves this from the `/metrics` route (unless the application replaced it).
+ *
+ * @ingroup video
+ */
+class videoMetrics
+{
+public:
+	/**
+	 * Register a source (called by the videoSource constructor).
+	 */
+	static void Add( videoSource* source );
+
+	/**
+	 * Register an output (called by the videoOutput constructor).
+	 */
+	static void Add( videoOutput* output );
+
+	/**
+	 * Unregister a source.  This is called by the videoSource destructor, and by the destructors
+	 * of the sources that keep their own statistics before those are released.
+	 */
+	static void Remove( videoSource* source );
+
+	/**
+	 * Unregister an output (called by the videoOutput destructor).
+	 */
+	static void Remove( videoOutput* output );
+
+	/**
+	 * Render the metrics in the Prometheus text exposition format (version 0.0.4).
+	 */
+	static std::string Render();
+};
+
+
+#endif
@@ -21,9 +21,15 @@
  */
  
 #include "videoOptions.h"
+#include "cudaMappedMemory.h"
+
+#include "gstUtility.h"
+#include "gstDecoder.h"
+#include "gstEncoder.h"
 
 #include "logging.h"
 #include <strings.h>
+#include <sstream>
 
 
 // constructor
@@ -35,13 +41,47 @@ videoOptions::videoOptions()
 	frameCount  = 0;
 	bitRate     = 0;
 	numBuffers  = 4;
+	segmentTime = 0;
+	segmentSize = 0;
+	simulcast   = 1;
+	multicast   = false;
+	decodeThreads = 0;
+	streamFiles = false;
+	writeThreads = 1;
+	writeQueueSize = 16;
+	writeDropFrames = false;
+	dedupFrames = false;
+	dedupDistance = 5;
 	loop        = 0;
 	latency     = 10;
+	lowLatency  = false;
+	intraRefresh = 0;
+	motionDetect = false;
+	adaptiveRate = false;
+	motionThreshold = 20.0f;
+	transport   = TRANSPORT_AUTO;
+	reconnect   = 0;
 	zeroCopy    = true;
 	ioType      = INPUT;
 	deviceType  = DEVICE_DEFAULT;
 	flipMethod  = FLIP_DEFAULT;
 	codec       = CODEC_UNKNOWN;
+	decoder     = DECODER_AUTO;
+	converter   = CONVERTER_CUDA;
+	memory      = MEMORY_AUTO;
+	cudaDevice  = -1;
+}
+
+
+// ResolveMemory
+void videoOptions::ResolveMemory()
+{
+	if( memory == MEMORY_MAPPED )
+		zeroCopy = true;
+	else if( memory == MEMORY_DEVICE )
+		zeroCopy = false;
+	else if( zeroCopy && !cudaIsIntegrated(cudaDevice) )
+		zeroCopy = false;	// discrete GPUs would read mapped memory over PCIe
 }
 
 
@@ -64,8 +104,26 @@ void videoOptions::Print( const char* prefix ) const
 	if( save.path.length() > 0 )
 		LogInfo("  -- save:       %s\n", save.path.c_str());
 
+	for( size_t n=0; n < extraOutputs.size(); n++ )
+		LogInfo("  -- extra:      %s\n", extraOutputs[n].string.c_str());
+
+	if( segmentTime > 0 || segmentSize > 0 )
+		LogInfo("  -- segments:   %us, %uMB\n", segmentTime, segmentSize);
+
+	if( simulcast > 1 )
+		LogInfo("  -- simulcast:  %u layers\n", simulcast);
+
+	if( ioType == OUTPUT && multicast )
+		LogInfo("  -- multicast:  true\n");
+
 	if( deviceType != DEVICE_CSI && deviceType != DEVICE_DISPLAY )
 		LogInfo("  -- codec:      %s\n", CodecToStr(codec));
+
+	if( ioType == INPUT && (codec == CODEC_MJPEG || decoder != DECODER_AUTO) )
+		LogInfo("  -- decoder:    %s\n", DecoderToStr(decoder));
+
+	if( converter != CONVERTER_CUDA )
+		LogInfo("  -- converter:  %s\n", ConverterToStr(converter));
 	
 	if( width != 0 )
 		LogInfo("  -- width:      %u\n", width);
@@ -79,7 +137,29 @@ void videoOptions::Print( const char* prefix ) const
 		LogInfo("  -- bitRate:    %u\n", bitRate);
 	
 	LogInfo("  -- numBuffers: %u\n", numBuffers);
+
+	if( ioType == INPUT && decodeThreads > 0 )
+		LogInfo("  -- decodeThreads: %u\n", decodeThreads);
+
+	if( ioType == INPUT && streamFiles )
+		LogInfo("  -- streamFiles: true\n");
+
+	if( ioType == OUTPUT && deviceType == DEVICE_FILE )
+	{
+		LogInfo("  -- writeThreads: %u\n", writeThreads);
+		LogInfo("  -- writeQueue:   %u (%s when full)\n", writeQueueSize, writeDropFrames ? "drop" : "block");
+	}
+
+	if( ioType == OUTPUT && dedupFrames )
+		LogInfo("  -- dedup:      true (distance %u)\n", dedupDistance);
+
 	LogInfo("  -- zeroCopy:   %s\n", zeroCopy ? "true" : "false");	
+
+	if( ioType == INPUT && memory != MEMORY_AUTO )
+		LogInfo("  -- memory:     %s\n", MemoryToStr(memory));
+
+	if( cudaDevice >= 0 )
+		LogInfo("  -- cudaDevice: %i\n", cudaDevice);
 	
 	if( ioType == INPUT )
 	{
@@ -91,6 +171,26 @@ void videoOptions::Print( const char* prefix ) const
 	
 	if( deviceType == DEVICE_IP )
 		LogInfo("  -- latency     %i\n", latency);
+
+	if( lowLatency )
+		LogInfo("  -- lowLatency: true\n");
+
+	if( ioType == OUTPUT && lowLatency && intraRefresh > 0 )
+		LogInfo("  -- intraRefresh: %u frames\n", intraRefresh);
+
+	if( ioType == INPUT && motionDetect )
+		LogInfo("  -- motion:     true (threshold %g)\n", motionThreshold);
+
+	if( ioType == INPUT && adaptiveRate )
+		LogInfo("  -- adaptiveRate: true\n");
+
+	if( ioType == INPUT && resource.protocol == "rtsp" )
+	{
+		LogInfo("  -- transport:  %s\n", TransportToStr(transport));
+
+		if( reconnect > 0 )
+			LogInfo("  -- reconnect:  %ums\n", reconnect);
+	}
 	
 	if( stunServer.length() > 0 )
 		LogInfo("  -- stunServer  %s\n", stunServer.c_str());
@@ -134,6 +234,10 @@ bool videoOptions::Parse( const char* URI, const commandLine& cmdLine, videoOpti
 	
 	deviceType = DeviceTypeFromStr(resource.protocol.c_str());
 	
+	// start loading GStreamer in the background, while the app creates its other streams
+	if( usesGStreamer(resource, type) )
+		gstreamerInitAsync();
+
 	// parse 'save' URI
 	const char* save_path = (type == INPUT) ? cmdLine.GetString("input-save")
 	                                        : cmdLine.GetString("output-save");
@@ -152,11 +256,85 @@ bool videoOptions::Parse( const char* URI, const commandLine& cmdLine, videoOpti
 			return false;
 		}
 	}
+
+	// parse extra output URIs
+	const char* extra_str = (type == OUTPUT) ? cmdLine.GetString("output-extra") : NULL;
+
+	if( extra_str != NULL )
+	{
+		std::istringstream extra_stream(extra_str);
+		std::string extra_uri;
+
+		while( std::getline(extra_stream, extra_uri, ',') )
+		{
+			if( extra_uri.length() == 0 )
+				continue;
+
+			extraOutputs.push_back(::URI());
+
+			if( !extraOutputs.back().Parse(extra_uri.c_str()) )
+			{
+				LogError(LOG_VIDEO "videoOptions -- failed to parse --output-extra URI (%s)\n", extra_uri.c_str());
+				return false;
+			}
+		}
+	}
+
+	// recording segments
+	segmentTime = (type == INPUT) ? cmdLine.GetUnsignedInt("input-segment-time", segmentTime)
+						     : cmdLine.GetUnsignedInt("output-segment-time", segmentTime);
+
+	segmentSize = (type == INPUT) ? cmdLine.GetUnsignedInt("input-segment-size", segmentSize)
+						     : cmdLine.GetUnsignedInt("output-segment-size", segmentSize);
+
+	if( type == OUTPUT )
+		simulcast = cmdLine.GetUnsignedInt("output-simulcast", simulcast);
+
+	if( type == OUTPUT && cmdLine.GetFlag("output-multicast") )
+		multicast = true;
 	
 	// parse stream settings
 	numBuffers = cmdLine.GetUnsignedInt("num-buffers", numBuffers);
+
+	if( type == INPUT )
+	{
+		decodeThreads = cmdLine.GetUnsignedInt("input-threads", decodeThreads);
+		streamFiles = cmdLine.GetFlag("input-stream-files");
+	}
+
+	if( type == OUTPUT )
+	{
+		writeThreads = cmdLine.GetUnsignedInt("output-threads", writeThreads);
+		writeQueueSize = cmdLine.GetUnsignedInt("output-queue", writeQueueSize);
+		writeDropFrames = cmdLine.GetFlag("output-drop");
+
+		if( cmdLine.GetFlag("output-dedup") )
+			dedupFrames = true;
+
+		dedupDistance = cmdLine.GetUnsignedInt("output-dedup-distance", dedupDistance);
+	}
+
 	//zeroCopy = cmdLine.GetFlag("zero-copy");	// no default returned, so disable this for now
 
+	// memory policy
+	if( type == INPUT )
+	{
+		const char* memoryStr = cmdLine.GetString("input-memory");
+
+		if( memoryStr != NULL )
+			memory = videoOptions::MemoryFromStr(memoryStr);
+	}
+
+	// memory budget (shared by all the streams)
+	const float memoryBudget = cmdLine.GetFloat("memory-budget", 0.0f);
+
+	if( memoryBudget > 0.0f )
+		cudaMemorySetBudget(memoryBudget * 1024 * 1024);
+
+	// CUDA device
+	cudaDevice = (type == INPUT) ? cmdLine.GetInt("input-gpu", cudaDevice)
+						    : cmdLine.GetInt("output-gpu", cudaDevice);
+
 	// width
 	width = (type == INPUT) ? cmdLine.GetUnsignedInt("input-width")
 					    : cmdLine.GetUnsignedInt("output-width");
@@ -202,6 +380,22 @@ bool videoOptions::Parse( const char* URI, const commandLine& cmdLine, videoOpti
 
 	if( codecStr != NULL )	
 		codec = videoOptions::CodecFromStr(codecStr);
+
+	// decoder
+	if( type == INPUT )
+	{
+		const char* decoderStr = cmdLine.GetString("input-decoder");
+
+		if( decoderStr != NULL )
+			decoder = videoOptions::DecoderFromStr(decoderStr);
+	}
+
+	// converter
+	const char* converterStr = (type == INPUT) ? cmdLine.GetString("input-converter")
+									   : cmdLine.GetString("output-converter");
+
+	if( converterStr != NULL )
+		converter = videoOptions::ConverterFromStr(converterStr);
 		
 	// bitrate
 	if( type == OUTPUT )
@@ -219,6 +413,36 @@ bool videoOptions::Parse( const char* URI, const commandLine& cmdLine, videoOpti
 	// latency
 	latency = (type == INPUT) ? cmdLine.GetUnsignedInt("input-latency", cmdLine.GetUnsignedInt("input-rtsp-latency", latency))
 						 : cmdLine.GetUnsignedInt("output-latency", latency);
+
+	if( cmdLine.GetFlag((type == INPUT) ? "input-low-latency" : "output-low-latency") )
+		lowLatency = true;
+
+	if( type == OUTPUT )
+		intraRefresh = cmdLine.GetUnsignedInt("output-intra-refresh", intraRefresh);
+
+	// motion detection
+	if( type == INPUT )
+	{
+		if( cmdLine.GetFlag("input-motion") )
+			motionDetect = true;
+
+		motionThreshold = cmdLine.GetFloat("input-motion-threshold", motionThreshold);
+	}
+
+	// adaptive frame skipping
+	if( type == INPUT && cmdLine.GetFlag("input-adaptive-rate") )
+		adaptiveRate = true;
+
+	// RTSP transport/reconnection
+	if( type == INPUT )
+	{
+		const char* transportStr = cmdLine.GetString("input-rtsp-transport");
+
+		if( transportStr != NULL )
+			transport = videoOptions::TransportFromStr(transportStr);
+
+		reconnect = cmdLine.GetUnsignedInt("input-reconnect", reconnect);
+	}
 	
 	// STUN server
 	const char* stunStr = cmdLine.GetString("stun-server");
@@ -329,6 +553,18 @@ const char* videoOptions::DeviceTypeToStr( videoOptions::DeviceType type )
 }
 
 
+// returns true if the stream will be backed by a GStreamer pipeline
+static bool usesGStreamer( const URI& uri, videoOptions::IoType type )
+{
+	if( uri.protocol == "file" )
+		return (type == videoOptions::INPUT) ? gstDecoder::IsSupportedExtension(uri.extension.c_str())
+									  : gstEncoder::IsSupportedExtension(uri.extension.c_str());
+
+	return uri.protocol == "csi" || uri.protocol == "v4l2" || uri.protocol == "rtp" || uri.protocol == "rtsp" 
+		|| uri.protocol == "rtmp" || uri.protocol == "rtpmp2ts" || uri.protocol == "webrtc" || uri.protocol == "packet";
+}
+
+
 // DeviceTypeFromStr
 videoOptions::DeviceType videoOptions::DeviceTypeFromStr( const char* str )
 {
@@ -343,7 +579,7 @@ videoOptions::DeviceType videoOptions::DeviceTypeFromStr( const char* str )
 			return value;
 	}
 
-	if( strcasecmp(str, "rtp") == 0 || strcasecmp(str, "rtsp") == 0 || strcasecmp(str, "rtmp") == 0 || strcasecmp(str, "rtpmp2ts") == 0 || strcasecmp(str, "webrtc") == 0 )
+	if( strcasecmp(str, "rtp") == 0 || strcasecmp(str, "rtsp") == 0 || strcasecmp(str, "rtmp") == 0 || strcasecmp(str, "rtpmp2ts") == 0 || strcasecmp(str, "webrtc") == 0 || strcasecmp(str, "udp-raw") == 0 )
 		return DEVICE_IP;
 
 	return DEVICE_DEFAULT;
@@ -422,5 +658,125 @@ videoOptions::Codec videoOptions::CodecFromStr( const char* str )
 }
 
 
+// DecoderToStr
+const char* videoOptions::DecoderToStr( videoOptions::Decoder decoder )
+{
+	switch(decoder)
+	{
+		case DECODER_AUTO:		return "auto";
+		case DECODER_CPU:		return "cpu";
+		case DECODER_V4L2:		return "v4l2";
+		case DECODER_NVJPEG:	return "nvjpeg";
+	}
+	return nullptr;
+}
+
+
+// DecoderFromStr
+videoOptions::Decoder videoOptions::DecoderFromStr( const char* str )
+{
+	if( !str )
+		return DECODER_AUTO;
+
+	for( int n=0; n <= DECODER_NVJPEG; n++ )
+	{
+		const Decoder value = (Decoder)n;
+
+		if( strcasecmp(str, DecoderToStr(value)) == 0 )
+			return value;
+	}
+	return DECODER_AUTO;
+}
+
+
+// MemoryToStr
+const char* videoOptions::MemoryToStr( videoOptions::Memory memory )
+{
+	switch(memory)
+	{
+		case MEMORY_AUTO:	return "auto";
+		case MEMORY_MAPPED:	return "mapped";
+		case MEMORY_DEVICE:	return "device";
+	}
+	return nullptr;
+}
+
+
+// MemoryFromStr
+videoOptions::Memory videoOptions::MemoryFromStr( const char* str )
+{
+	if( !str )
+		return MEMORY_AUTO;
+
+	for( int n=0; n <= MEMORY_DEVICE; n++ )
+	{
+		const Memory value = (Memory)n;
+
+		if( strcasecmp(str, MemoryToStr(value)) == 0 )
+			return value;
+	}
+	return MEMORY_AUTO;
+}
+
+
+// ConverterToStr
+const char* videoOptions::ConverterToStr( videoOptions::Converter converter )
+{
+	switch(converter)
+	{
+		case CONVERTER_CUDA:	return "cuda";
+		case CONVERTER_VIC:		return "vic";
+	}
+	return nullptr;
+}
+
+
+// ConverterFromStr
+videoOptions::Converter videoOptions::ConverterFromStr( const char* str )
+{
+	if( !str )
+		return CONVERTER_CUDA;
+
+	for( int n=0; n <= CONVERTER_VIC; n++ )
+	{
+		const Converter value = (Converter)n;
+
+		if( strcasecmp(str, ConverterToStr(value)) == 0 )
+			return value;
+	}
+	return CONVERTER_CUDA;
+}
+
+
+// TransportToStr
+const char* videoOptions::TransportToStr( videoOptions::Transport transport )
+{
+	switch(transport)
+	{
+		case TRANSPORT_AUTO:	return "auto";
+		case TRANSPORT_UDP:		return "udp";
+		case TRANSPORT_TCP:		return "tcp";
+	}
+	return nullptr;
+}
+
+
+// TransportFromStr
+videoOptions::Transport videoOptions::TransportFromStr( const char* str )
+{
+	if( !str )
+		return TRANSPORT_AUTO;
+
+	for( int n=0; n <= TRANSPORT_TCP; n++ )
+	{
+		const Transport value = (Transport)n;
+
+		if( strcasecmp(str, TransportToStr(value)) == 0 )
+			return value;
+	}
+	return TRANSPORT_AUTO;
+}
+
+
 
 
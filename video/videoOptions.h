@@ -28,6 +28,8 @@
 
 #include "URI.h"	
 
+#include <vector>
+
 
 /**
  * The videoOptions struct contains common settings that are used
@@ -55,6 +57,57 @@ public:
 	 * for videoSource streams, or `--output-save` for videoOutput streams.
 	 */
 	URI save;
+
+	/**
+	 * Additional output URIs that the same compressed stream gets sent to, for example
+	 * a file and an RTSP server alongside the primary WebRTC output.  gstEncoder encodes
+	 * the video once and splits the bitstream between all of them, so the encoding cost
+	 * doesn't increase with the number of outputs (it's ignored by other videoOutputs).
+	 * This option can be set from the command-line using `--output-extra=URI[,URI...]`
+	 * @note at most one RTSP and one WebRTC output are supported per gstEncoder.
+	 */
+	std::vector<URI> extraOutputs;
+
+	/**
+	 * If non-zero, the video files that are recorded (the `save` file, or the resource
+	 * of a gstEncoder file output) are split into segments of this many seconds.
+	 * The segments are split on keyframes, and each one is a complete MKV file or
+	 * fragmented MP4 file, so at most the last fragment is lost if power is lost.
+	 * The path can contain a printf-style index (e.g. `video_%05d.mp4`), otherwise
+	 * `_%05d` gets inserted before the extension.  This option can be set from the
+	 * command-line using `--input-segment-time=N` or `--output-segment-time=N`.
+	 * @note the default is 0 (don't split by time).
+	 */
+	uint32_t segmentTime;
+
+	/**
+	 * If non-zero, the video files that are recorded are split into segments of up to
+	 * this many megabytes.  This can be combined with segmentTime, in which case whichever
+	 * limit is hit first starts the next segment.  This option can be set from the
+	 * command-line using `--input-segment-size=N` or `--output-segment-size=N`.
+	 * @note the default is 0 (don't split by size).
+	 */
+	uint32_t segmentSize;
+
+	/**
+	 * The number of simulcast layers that gstEncoder encodes for RTSP and WebRTC outputs
+	 * (up to 3).  Each additional layer is half the resolution of the previous one, with a
+	 * quarter of the bitrate, and gets served at the same path with `_N` appended (for example
+	 * `rtsp://@:8554/my_stream_1`).  WebRTC viewers that are congested get moved to the next layer.
+	 * This option can be set from the command-line using `--output-simulcast=N`
+	 * @note the default is 1 (no simulcast).
+	 */
+	uint32_t simulcast;
+
+	/**
+	 * If true, RTSP outputs also offer RTP multicast delivery, so that any number of clients on the
+	 * local network can receive one copy of the stream (the addresses are allocated from the range
+	 * between RTSP_MULTICAST_ADDRESS_MIN and RTSP_MULTICAST_ADDRESS_MAX).  Clients that don't request
+	 * multicast still get unicast UDP or TCP, and either way all of them share the same encode.
+	 * This option can be set from the command-line using `--output-multicast`
+	 * @note the default is false (unicast only).
+	 */
+	bool multicast;
 	
 	/**
 	 * The width of the stream (in pixels).
@@ -96,12 +149,105 @@ public:
 	 */
 	uint32_t numBuffers;
 
+	/**
+	 * The number of worker threads used to decode images ahead of time for
+	 * imageLoader inputs (other types of streams will ignore it).  When non-zero,
+	 * the upcoming images are prefetched in parallel so Capture() can return a
+	 * frame that's already been decoded.  This option can be set from the command
+	 * line using `--input-threads=N`.
+	 * @note the default is 0 (images are decoded synchronously in Capture()).
+	 */
+	uint32_t decodeThreads;
+
+	/**
+	 * For imageLoader inputs, enumerate the directory lazily while the images are loaded,
+	 * instead of listing and sorting all of the files before the first one is loaded.
+	 * This keeps startup instant and memory constant for huge datasets, but the images
+	 * are loaded in the order the filesystem returns them (i.e. unsorted).  This option
+	 * can be set from the command line using `--input-stream-files`.
+	 * @note the default is false.  Manifest files (`.txt` or `.lst`) are always streamed.
+	 */
+	bool streamFiles;
+
+	/**
+	 * The number of background threads that imageWriter outputs use to encode and
+	 * save images (other types of streams will ignore it).  If set to 0, images are
+	 * saved synchronously inside Render().  This option can be set from the command
+	 * line using `--output-threads=N`.
+	 * @note the default is 1 writer thread.
+	 */
+	uint32_t writeThreads;
+
+	/**
+	 * The maximum number of images that imageWriter outputs can have queued to
+	 * be saved before the writeDropFrames policy applies (0 means unbounded).
+	 * This option can be set from the command line using `--output-queue=N`.
+	 * @note the default queue size is 16 images.
+	 */
+	uint32_t writeQueueSize;
+
+	/**
+	 * If true, imageWriter outputs drop new frames while their queue is full.
+	 * Otherwise, Render() blocks until there's room in the queue.
+	 * This option can be enabled from the command line using `--output-drop`.
+	 * @note the default is false (block until space is available).
+	 */
+	bool writeDropFrames;
+
+	/**
+	 * If true, imageWriter and gstEncoder outputs skip the frames that are near-duplicates of the
+	 * last frame they kept, using a cudaDedup filter on the GPU.  This saves storage and upload
+	 * bandwidth when recording datasets from cameras, where most consecutive frames look the same.
+	 * This option can be enabled from the command line using `--output-dedup`.
+	 * @note the default is false (every frame is saved or encoded).
+	 */
+	bool dedupFrames;
+
+	/**
+	 * The Hamming distance between perceptual hashes (between 0 and 64) that a frame needs to
+	 * exceed to be kept when dedupFrames is enabled.  It can be set from the command line
+	 * using `--output-dedup-distance=N`.
+	 * @note the default is 5.
+	 */
+	uint32_t dedupDistance;
+
 	/**
 	 * If true, indicates the buffers are allocated in zeroCopy memory that is mapped to
 	 * both the CPU and GPU.  Otherwise, the buffers are only accessible from the GPU.
 	 * @note the default is true (zeroCopy CPU/GPU access enabled).
 	 */
 	bool zeroCopy;
+
+	/**
+	 * Memory policies for the frames of videoSource streams.
+	 */
+	enum Memory
+	{
+		MEMORY_AUTO = 0,	/**< Mapped memory on integrated GPUs (Jetson), and GPU memory on discrete GPUs */
+		MEMORY_MAPPED,		/**< Mapped zeroCopy memory that can be accessed from both the CPU and GPU */
+		MEMORY_DEVICE		/**< GPU memory (frames from the CPU get uploaded through pinned staging buffers) */
+	};
+
+	/**
+	 * Selects where the frames of videoSource streams are kept, and is resolved into `zeroCopy`
+	 * when the stream gets created.  Mapped memory is ideal on Jetson, but on discrete GPUs
+	 * every kernel that reads it goes over PCIe, so by default those use GPU memory instead.
+	 * Frames in GPU memory can't be accessed from the CPU (e.g. with cudaToNumpy()) without copying them.
+	 *
+	 * This option can be set from the command line using `--input-memory=xyz`, where `xyz`
+	 * is `auto`, `mapped`, or `device`.
+	 */
+	Memory memory;
+
+	/**
+	 * The CUDA device that the stream's buffers, color conversions and interop are
+	 * pinned to on multi-GPU systems.  Frames that are rendered to an output from a
+	 * different device get copied peer-to-peer.  The default of -1 uses the device
+	 * that's current when the stream is created (or used).
+	 *
+	 * This option can be set from the command line using `--input-gpu=N` or `--output-gpu=N`.
+	 */
+	int cudaDevice;
 	
 	/**
 	 * Control the number of loops for videoSource disk-based inputs (for example,
@@ -126,6 +272,88 @@ public:
 	 */
 	int latency;
 
+	/**
+	 * If true, live input streams are configured so that Capture() always gets the newest frame,
+	 * instead of frames queueing up in the pipeline while the application is busy.  The appsink
+	 * keeps at most one buffer (`max-buffers=1 drop=true sync=false`) behind a leaky queue,
+	 * and RTSP sources drop packets that arrive later than the latency (`drop-on-latency=true`).
+	 * Compressed data is never dropped before the decoder, because that would corrupt the frames
+	 * that refer to it.  Video files don't have their clock sync disabled, so they still play in realtime.
+	 * This option can be enabled from the command line using `--input-low-latency`.
+	 *
+	 * For output streams, the encoder is configured for the lowest latency instead:  no B-frames,
+	 * a one second GOP with SPS/PPS repeated on every IDR, maximum clocks and the fastest preset on
+	 * the Jetson encoders (or `tune=zerolatency` with x264/x265 on desktop, and realtime for VPx).
+	 * This option can be enabled from the command line using `--output-low-latency`.
+	 * @note the default is false (every frame is delivered, and buffered as needed).
+	 */
+	bool lowLatency;
+
+	/**
+	 * For low-latency output streams, the number of frames over which the encoder refreshes the whole
+	 * picture with intra-coded slices, instead of sending large periodic I-frames (which cause spikes
+	 * in the bitrate and latency).  It's only used when `lowLatency` is enabled, and can be set from
+	 * the command line using `--output-intra-refresh=N`.
+	 * @note the default is 0 (disabled, periodic I-frames are used).
+	 */
+	uint32_t intraRefresh;
+
+	/**
+	 * If true, input streams run a cudaMotion detector on each frame as it's captured, so that
+	 * applications can skip processing the frames where nothing moved (with videoSource::HasMotion())
+	 * or only process the regions that changed (from videoSource::GetMotion()).  The detector works on
+	 * a downsampled copy of the frame, so its cost is a small fraction of the capture.
+	 * This option can be enabled from the command line using `--input-motion`.
+	 * @note the default is false (disabled).
+	 */
+	bool motionDetect;
+
+	/**
+	 * If true, input streams measure how often the application captures frames, and skip the
+	 * frames that arrive faster than that before they're uploaded and converted, so the GPU
+	 * doesn't spend time converting frames that would get dropped when inference can't keep up.
+	 * A frame is never skipped while Capture() is waiting for one.  Only gstCamera and gstDecoder
+	 * support this, and the frames that get skipped are counted in videoSourceStats::framesSkipped.
+	 * This option can be enabled from the command line using `--input-adaptive-rate`.
+	 * @note the default is false (every frame is converted as it arrives).
+	 */
+	bool adaptiveRate;
+
+	/**
+	 * The difference in average luminance (between 0 and 255) for a region of the frame to count as motion.
+	 * It can be set from the command line using `--input-motion-threshold=N`.
+	 * @note the default is 20.
+	 */
+	float motionThreshold;
+
+	/**
+	 * RTSP lower transport protocols.
+	 */
+	enum Transport
+	{
+		TRANSPORT_AUTO = 0,		/**< Let the server pick (UDP is tried first, then TCP) */
+		TRANSPORT_UDP,			/**< RTP over UDP, which has lower latency but packets can be lost */
+		TRANSPORT_TCP			/**< RTP interleaved into the RTSP TCP connection, which gets through firewalls/NAT */
+	};
+
+	/**
+	 * Selects the lower transport protocol of RTSP input streams (other types of streams ignore it).
+	 * This option can be set from the command line using `--input-rtsp-transport=xyz`,
+	 * where `xyz` is `auto`, `udp`, or `tcp`.
+	 * @note the default is `TRANSPORT_AUTO`.
+	 */
+	Transport transport;
+
+	/**
+	 * If non-zero, RTSP input streams are reconnected when they error out, end, or stop receiving
+	 * packets for this many milliseconds, and the reconnection is retried at this interval until
+	 * it succeeds.  Only the RTSP source gets restarted, so the rest of the pipeline (including
+	 * the decoder and its NVMM buffers) stays up, and Capture() resumes once frames arrive again.
+	 * This option can be set from the command line using `--input-reconnect=N`
+	 * @note the default is 0 (disabled, the stream stays stopped after an error or EOS).
+	 */
+	uint32_t reconnect;
+
 	/**
 	 * Device interface types.
 	 */
@@ -159,7 +387,7 @@ public:
 	IoType ioType;
 
 	/**
-	 * Settings of the flip method used by MIPI CSI cameras and compressed video inputs.
+	 * Settings of the flip method used by the input streams.
 	 */
 	enum FlipMethod
 	{
@@ -175,8 +403,10 @@ public:
 	};
 
 	/**
-	 * The flip method controls if and how an input frame is flipped/rotated in pre-processing
-	 * from a MIPI CSI camera or compressed video input. Other types of streams will ignore this.
+	 * The flip method controls if and how an input frame is flipped/rotated in pre-processing.
+	 * The MIPI CSI cameras and GStreamer inputs flip the frames in their pipelines, and the other
+	 * types of inputs (V4L2 cameras, images, raw files, ect) flip them with cudaFlip() after
+	 * they're captured.  The packed 4:2:2 YUV formats can't be rotated by 90 degrees.
 	 *
 	 * This option can be set from the command line using `--flip-method=xyz`, where `xyz` is one
 	 * of the strings below:
@@ -221,6 +451,51 @@ public:
 	 */
 	Codec codec;
 
+	/**
+	 * Video decoder types.
+	 */
+	enum Decoder
+	{
+		DECODER_AUTO = 0,		/**< Use the hardware decoder when it's available, otherwise fall back to the CPU */
+		DECODER_CPU,			/**< Software decoder on the CPU (e.g. `jpegdec`) */
+		DECODER_V4L2,			/**< Hardware decoder through V4L2 (`nvv4l2decoder`), which outputs NVMM memory */
+		DECODER_NVJPEG			/**< Hardware JPEG decoder engine (`nvjpegdec`) */
+	};
+
+	/**
+	 * Selects the decoder used for MJPEG V4L2 cameras (other types of streams will ignore it).
+	 *
+	 * With the default `DECODER_AUTO`, the hardware decoders are tried first (`v4l2`, then `nvjpeg`),
+	 * and the CPU decoder is used if neither of them is available or the pipeline fails to launch.
+	 * This option can be set from the command line using `--input-decoder=xyz`, where `xyz` is
+	 * `auto`, `cpu`, `v4l2`, or `nvjpeg`.
+	 */
+	Decoder decoder;
+
+	/**
+	 * Backends for the colorspace conversion and scaling of video streams.
+	 */
+	enum Converter
+	{
+		CONVERTER_CUDA = 0,		/**< CUDA kernels on the GPU */
+		CONVERTER_VIC			/**< The VIC engine on Jetson (with `NvBufferTransform()` or `nvvidconv`) */
+	};
+
+	/**
+	 * Selects where the conversions between YUV and RGB happen for GStreamer streams.
+	 *
+	 * By default they run as CUDA kernels, which compete with the inference for the GPU.
+	 * With `CONVERTER_VIC` they're done by the VIC engine on Jetson instead:  videoSource streams
+	 * that use NVMM memory have the decoded frames converted to RGBA (and scaled) with
+	 * `NvBufferTransform()`, and videoOutput encoders are passed RGBA that `nvvidconv` converts.
+	 * Other formats than `rgba8` still get converted from RGBA with CUDA, which is much cheaper.
+	 * When the VIC isn't available, the streams fall back to CUDA.
+	 *
+	 * This option can be set from the command line using `--input-converter=xyz` or
+	 * `--output-converter=xyz`, where `xyz` is `cuda` or `vic`.
+	 */
+	Converter converter;
+
 	/**
 	 * URL of STUN server used for WebRTC.  This can be set using the `--stun-server` command-line argument.
 	 * STUN servers are used during ICE/NAT and allow a local device to determine its public IP address.
@@ -246,6 +521,11 @@ public:
 	 */
 	std::string sslKey;
 	
+	/**
+	 * @internal Resolve the memory policy into the `zeroCopy` setting, based on the type of GPU.
+	 */
+	void ResolveMemory();
+
 	/**
 	 * Log the video settings, with an optional prefix label.
 	 */
@@ -310,6 +590,46 @@ public:
 	 * Parse a Codec enum from a string.
 	 */
 	static Codec CodecFromStr( const char* str );
+
+	/**
+	 * Convert a Decoder enum to a string.
+	 */
+	static const char* DecoderToStr( Decoder decoder );
+
+	/**
+	 * Parse a Decoder enum from a string.
+	 */
+	static Decoder DecoderFromStr( const char* str );
+
+	/**
+	 * Convert a Converter enum to a string.
+	 */
+	static const char* ConverterToStr( Converter converter );
+
+	/**
+	 * Parse a Converter enum from a string.
+	 */
+	static Converter ConverterFromStr( const char* str );
+
+	/**
+	 * Convert a Memory enum to a string.
+	 */
+	static const char* MemoryToStr( Memory memory );
+
+	/**
+	 * Parse a Memory enum from a string.
+	 */
+	static Memory MemoryFromStr( const char* str );
+
+	/**
+	 * Convert a Transport enum to a string.
+	 */
+	static const char* TransportToStr( Transport transport );
+
+	/**
+	 * Parse a Transport enum from a string.
+	 */
+	static Transport TransportFromStr( const char* str );
 };
 
 
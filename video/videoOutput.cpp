@@ -22,10 +22,18 @@
  
 #include "videoOutput.h"
 #include "imageWriter.h"
+#include "rawFrameWriter.h"
+#include "udpFrameSender.h"
+#include "shmFrameWriter.h"
+#include "nullOutput.h"
+#include "mjpegOutput.h"
 
 #include "glDisplay.h"
 #include "gstEncoder.h"
 
+#include "videoLatency.h"
+#include "videoMetrics.h"
+#include "cudaPerceptualHash.h"
 #include "logging.h"
 
 
@@ -33,6 +41,9 @@
 videoOutput::videoOutput( const videoOptions& options ) : mOptions(options)
 {
 	mStreaming = false;
+	mDedup = NULL;
+
+	videoMetrics::Add(this);
 }
 
 
@@ -43,6 +54,33 @@ videoOutput::~videoOutput()
 
 	for( uint32_t n=0; n < numOutputs; n++ )
 		SAFE_DELETE(mOutputs[n]);
+
+	videoLatency::Remove(this);
+	videoMetrics::Remove(this);
+
+	SAFE_DELETE(mDedup);
+}
+
+
+// isDuplicate
+bool videoOutput::isDuplicate( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream )
+{
+	if( !mOptions.dedupFrames )
+		return false;
+
+	if( !mDedup )
+		mDedup = new cudaDedup(mOptions.dedupDistance);
+
+	if( mDedup->Process(image, width, height, format, stream) != cudaSuccess )
+	{
+		LogError(LOG_VIDEO "videoOutput -- disabling dedup, it failed on a %s frame\n", imageFormatToStr(format));
+
+		SAFE_DELETE(mDedup);
+		mOptions.dedupFrames = false;
+		return false;
+	}
+
+	return mDedup->IsDuplicate();
 }
 
 
@@ -51,7 +89,7 @@ static videoOutput* createDisplaySubstream( videoOutput* output, videoOptions& o
 {
 	const bool headless = cmdLine.GetFlag("no-display") | cmdLine.GetFlag("headless");
 
-	if( options.resource.protocol != "display" && !headless )
+	if( options.resource.protocol != "display" && options.resource.protocol != "null" && !headless )
 	{
 		options.resource = "display://0";
 		videoOutput* display = videoOutput::Create(options);
@@ -97,12 +135,14 @@ videoOutput* videoOutput::Create( const videoOptions& options )
 	
 	if( uri.protocol == "file" )
 	{
-		if( gstEncoder::IsSupportedExtension(uri.extension.c_str()) )
+		if( rawFrameWriter::IsSupportedExtension(uri.extension.c_str()) )
+			output = rawFrameWriter::Create(options);
+		else if( gstEncoder::IsSupportedExtension(uri.extension.c_str()) )
 			output = gstEncoder::Create(options);
 		else
 			output = imageWriter::Create(options);
 	}
-	else if( uri.protocol == "rtp" || uri.protocol == "rtsp" || uri.protocol == "rtmp" || uri.protocol == "rtpmp2ts" || uri.protocol == "webrtc" )
+	else if( uri.protocol == "rtp" || uri.protocol == "rtsp" || uri.protocol == "rtmp" || uri.protocol == "rtpmp2ts" || uri.protocol == "webrtc" || uri.protocol == "packet" )
 	{
 		output = gstEncoder::Create(options);
 	}
@@ -110,6 +150,22 @@ videoOutput* videoOutput::Create( const videoOptions& options )
 	{
 		output = glDisplay::Create(options);
 	}
+	else if( uri.protocol == UDP_FRAME_PROTOCOL )
+	{
+		output = udpFrameSender::Create(options);
+	}
+	else if( uri.protocol == SHM_FRAME_PROTOCOL )
+	{
+		output = shmFrameWriter::Create(options);
+	}
+	else if( uri.protocol == "null" )
+	{
+		output = nullOutput::Create(options);
+	}
+	else if( uri.protocol == "mjpeg" || uri.protocol == "http" )
+	{
+		output = mjpegOutput::Create(options);
+	}
 	else
 	{
 		LogError(LOG_VIDEO "videoOutput -- unsupported protocol (%s)\n", uri.protocol.size() > 0 ? uri.protocol.c_str() : "null");
@@ -228,6 +284,9 @@ void videoOutput::Close()
 // Render
 bool videoOutput::Render( void* image, uint32_t width, uint32_t height, imageFormat format )
 {	
+	// the subclasses call this after they've submitted the image
+	videoLatency::Report(this, image, width, height, format);
+
 	const uint32_t numOutputs = mOutputs.size();
 	bool result = true;
 
@@ -257,6 +316,16 @@ const char* videoOutput::TypeToStr( uint32_t type )
 		return "gstEncoder";
 	else if( type == imageWriter::Type )
 		return "imageWriter";
+	else if( type == rawFrameWriter::Type )
+		return "rawFrameWriter";
+	else if( type == udpFrameSender::Type )
+		return "udpFrameSender";
+	else if( type == shmFrameWriter::Type )
+		return "shmFrameWriter";
+	else if( type == nullOutput::Type )
+		return "nullOutput";
+	else if( type == mjpegOutput::Type )
+		return "mjpegOutput";
 
 	LogWarning(LOG_VIDEO "unknown videoOutput type - %u\n", type);
 	return "(unknown)";
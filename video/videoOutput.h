@@ -31,6 +31,10 @@
 #include <vector>
 
 
+// forward declarations
+class cudaDedup;
+
+
 /**
  * Standard command-line options able to be passed to videoOutput::Create()
  * @ingroup video
@@ -43,16 +47,39 @@
 		  "                             * rtp://<remote-ip>:1234    (RTP stream)\n"		\
 		  "                             * rtsp://@:8554/my_stream   (RTSP stream)\n"		\
 		  "                             * webrtc://@:1234/my_stream (WebRTC stream)\n"      	\
+		  "                             * mjpeg://@:8080/my_stream  (MJPEG over HTTP for browsers)\n" \
+		  "                             * udp-raw://<remote-ip>:1234 (uncompressed UDP stream)\n" \
+		  "                             * shm://my_stream           (shared memory for other processes)\n" \
+		  "                             * packet://                 (encoded packets for the application)\n" \
 		  "                             * display://0               (OpenGL window)\n" 		\
+		  "                             * null://                   (discard the frames)\n" 	\
 		  "  --output-codec=CODEC   desired codec for compressed output streams:\n"		\
 		  "                            * h264 (default), h265\n"						\
 		  "                            * vp8, vp9\n"									\
 		  "                            * mpeg2, mpeg4\n"								\
 		  "                            * mjpeg\n"        								\
+		  "  --output-converter=TYPE converts the frames to encode with cuda (default) or vic\n" \
 		  "  --output-save=FILE     path to a video file for saving the compressed stream\n" \
 		  "                         to disk, in addition to the primary output above\n"      \
+		  "  --output-extra=URI     comma-separated list of additional outputs that share\n" \
+		  "                         the same encoded stream as the primary output above\n"   \
+		  "  --output-simulcast=N   number of RTSP/WebRTC resolution layers to encode, each\n" \
+		  "                         half the size of the previous one (default 1, max 3)\n" \
+		  "  --output-multicast     offer RTP multicast to RTSP clients (in addition to unicast)\n" \
 		  "  --bitrate=BITRATE      desired target VBR bitrate for compressed streams,\n"    \
 		  "                         in bits per second. The default is 4000000 (4 Mbps)\n"	\
+		  "  --output-low-latency   configure the encoder for realtime streaming (no B-frames,\n" \
+		  "                         1 second GOP, fastest preset and maximum clocks)\n"     \
+		  "  --output-intra-refresh=N with --output-low-latency, refresh the picture over N\n" \
+		  "                         frames instead of sending periodic I-frames\n"         \
+		  "  --output-threads=N     number of threads saving image sequences (default 1)\n"	\
+		  "  --output-queue=N       max number of images queued to be saved (default 16)\n"	\
+		  "  --output-drop          drop frames when the queue is full (instead of blocking)\n" \
+		  "  --output-dedup         skip saving/encoding frames that are near-duplicates\n"   \
+		  "  --output-dedup-distance=N perceptual hash distance for a frame to be new (default 5)\n" \
+		  "  --output-gpu=N         CUDA device to encode/display from (default is current)\n" \
+		  "  --latency              measure the latency from capture to output of each frame\n" \
+		  "  --latency-pattern      also draw the capture time into the frames as a pattern\n" \
 		  "  --headless             don't create a default OpenGL GUI window\n\n"
 
 
@@ -60,7 +87,7 @@
  * The videoOutput API is for rendering and transmitting frames to video input devices such as display windows, 
  * broadcasting RTP network streams to remote hosts over UDP/IP, and saving videos/images/directories to disk. 
  *
- * videoOutput interfaces are implemented by glDisplay, gstEncoder, and imageWriter.  
+ * videoOutput interfaces are implemented by glDisplay, gstEncoder, imageWriter, and rawFrameWriter.  
  * The specific implementation is selected at runtime based on the type of resource URI.
  * An instance can have multiple sub-streams, for example simultaneously outputting to 
  * a display and encoded video on disk or RTP stream.
@@ -83,6 +110,18 @@
  *        `http://<hostname>:1234/my_stream` and view a rudimentary video player that plays the stream.
  *        More advanced web front-ends can be created by using standard client-side Javascript WebRTC APIs.
  *
+ *     - `mjpeg://@:8080/my_stream` (or `http://`) to serve a Motion JPEG preview over HTTP that any number
+ *        of browsers can view at `http://<hostname>:8080/my_stream` without WebRTC (see mjpegOutput).
+ *
+ *     - `udp-raw://<remote-ip>:1234` to send uncompressed frames over UDP to a remote host,
+ *        where they can be recieved with `udp-raw://@:1234` (see udpFrameSender).
+ *
+ *     - `shm://my_stream` to share frames with other processes on the same device, which can
+ *        capture them zero-copy from `shm://my_stream` (see shmFrameWriter).
+ *
+ *     - `packet://` to encode the frames and pass the compressed access units to a callback
+ *        (see gstEncoder::SetPacketCallback()), for sending them over the application's own transport.
+ *
  *     - `file:///home/user/my_video.mp4` for saving videos, images, and directories of images to disk.
  *        You can leave off the `file://` protocol identifier and it will be deduced from the path.
  *        It can be a relative or absolute path.  You can output a sequence of images using a path of
@@ -91,7 +130,8 @@
  *        specified, then by default it will create a sequence of the form `%i.jpg` in that directory.
  *        Supported video formats for saving include MKV, MP4, AVI, and FLV. Supported codecs for 
  *        encoding include H.264, H.265, VP8, VP9, and MJPEG. Supported image formats for saving 
- *        include JPG, PNG, TGA, and BMP.
+ *        include JPG, PNG, TGA, and BMP.  Saving to a `.jraw` file records the uncompressed frames
+ *        with rawFrameWriter, so they can be replayed later with random access.
  *
  * @see URI for info about resource URI formats.
  * @see videoOptions for additional options and command-line arguments.
@@ -270,6 +310,12 @@ public:
 	 */
 	inline videoOutput* GetOutput( uint32_t index ) const		{ return mOutputs[index]; }
 
+	/**
+	 * Return the filter that skips near-duplicate frames, or NULL if it's disabled
+	 * (see videoOptions::dedupFrames).  It keeps count of the frames that were skipped.
+	 */
+	inline cudaDedup* GetDedup() const						{ return mDedup; }
+
 	/**
 	 * Set a status string (i.e. status bar text on display window).
 	 * Other types of interfaces may ignore the status text.
@@ -283,6 +329,7 @@ public:
 	 *    - glDisplay::Type
 	 *    - gstEncoder::Type
 	 *    - imageWriter::Type
+	 *    - rawFrameWriter::Type
 	 */
 	virtual inline uint32_t GetType() const			{ return 0; }
 
@@ -314,9 +361,17 @@ public:
 protected:
 	videoOutput( const videoOptions& options );
 
+	/**
+	 * Return true if the frame is a near-duplicate of the last frame that was kept and should be
+	 * skipped, when videoOptions::dedupFrames is enabled.  This waits for the hash to be computed.
+	 */
+	bool isDuplicate( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream=0 );
+
 	bool         mStreaming;
 	videoOptions mOptions;
 
+	cudaDedup*   mDedup;
+
 	std::vector<videoOutput*> mOutputs;
 };
 
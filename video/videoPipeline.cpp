@@ -0,0 +1,641 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "videoPipeline.h"
+#include "videoLatency.h"
+
+#include "cudaMappedMemory.h"
+#include "profiler.h"
+#include "logging.h"
+
+#include <strings.h>
+
+
+// how long the threads sleep while waiting on a queue before checking if they should stop (in ms)
+#define PIPELINE_POLL_TIMEOUT 10
+
+
+// videoPipelinePolicyFromStr
+videoPipelinePolicy videoPipelinePolicyFromStr( const char* str, videoPipelinePolicy default_value )
+{
+	if( !str )
+		return default_value;
+
+	if( strcasecmp(str, "block") == 0 )
+		return PIPELINE_BLOCK;
+	else if( strcasecmp(str, "drop-oldest") == 0 || strcasecmp(str, "drop_oldest") == 0 )
+		return PIPELINE_DROP_OLDEST;
+	else if( strcasecmp(str, "drop-newest") == 0 || strcasecmp(str, "drop_newest") == 0 )
+		return PIPELINE_DROP_NEWEST;
+
+	return default_value;
+}
+
+
+// videoPipelinePolicyToStr
+const char* videoPipelinePolicyToStr( videoPipelinePolicy policy )
+{
+	switch(policy)
+	{
+		case PIPELINE_BLOCK:		return "block";
+		case PIPELINE_DROP_OLDEST:	return "drop-oldest";
+		case PIPELINE_DROP_NEWEST:	return "drop-newest";
+	}
+
+	return "unknown";
+}
+
+
+// constructor
+videoPipeline::videoPipeline( videoSource* source, imageFormat format, uint32_t queueDepth, videoPipelinePolicy policy )
+{
+	mSource     = source;
+	mFormat     = format;
+	mQueueDepth = (queueDepth > 0) ? queueDepth : 1;
+	mPolicy     = policy;
+	mRunning    = false;
+	mStop       = false;
+	mEOS        = false;
+
+	mSourceNode = new Node();
+	mOutputNode = new Node();
+
+	mSourceNode->index = -1;
+	mOutputNode->index = 0;
+	mSourceNode->name  = "pipeline::source";
+	mOutputNode->name  = "pipeline::output";
+
+	Node* nodes[] = { mSourceNode, mOutputNode };
+
+	for( uint32_t n=0; n < 2; n++ )
+	{
+		nodes[n]->pipeline = this;
+		nodes[n]->func     = NULL;
+		nodes[n]->user     = NULL;
+		nodes[n]->stream   = NULL;
+		nodes[n]->input    = NULL;
+		nodes[n]->output   = NULL;
+		nodes[n]->done     = false;
+		nodes[n]->frames   = 0;
+		nodes[n]->drops    = 0;
+	}
+}
+
+
+// destructor
+videoPipeline::~videoPipeline()
+{
+	Stop();
+
+	for( size_t n=0; n < mStages.size(); n++ )
+		delete mStages[n];
+
+	delete mSourceNode;
+	delete mOutputNode;
+}
+
+
+// AddStage
+int videoPipeline::AddStage( const char* name, videoPipelineStage stage, void* user )
+{
+	if( !stage )
+		return -1;
+
+	if( mRunning )
+	{
+		LogError(LOG_PIPELINE "stages can't be added while the pipeline is running\n");
+		return -1;
+	}
+
+	Node* node = new Node();
+
+	node->pipeline = this;
+	node->index    = mStages.size();
+	node->name     = (name != NULL) ? name : "pipeline::stage";
+	node->func     = stage;
+	node->user     = user;
+	node->stream   = NULL;
+	node->input    = NULL;
+	node->output   = NULL;
+	node->done     = false;
+	node->frames   = 0;
+	node->drops    = 0;
+
+	mStages.push_back(node);
+	mOutputNode->index = mStages.size();
+
+	return node->index;
+}
+
+
+// AddOutput
+int videoPipeline::AddOutput( videoOutput* output )
+{
+	if( !output )
+		return -1;
+
+	if( mRunning )
+	{
+		LogError(LOG_PIPELINE "outputs can't be added while the pipeline is running\n");
+		return -1;
+	}
+
+	mOutputs.push_back(output);
+	return mOutputs.size() - 1;
+}
+
+
+// Start
+bool videoPipeline::Start()
+{
+	if( mRunning )
+		return true;
+
+	if( !mSource )
+	{
+		LogError(LOG_PIPELINE "the pipeline doesn't have a source\n");
+		return false;
+	}
+
+	if( !mSource->Open() )
+	{
+		LogError(LOG_PIPELINE "failed to open the source\n");
+		return false;
+	}
+
+	// from here on, Stop() cleans up after a failure
+	mStop    = false;
+	mEOS     = false;
+	mRunning = true;
+
+	// chain the nodes together with queues
+	std::vector<Node*> nodes;
+
+	nodes.push_back(mSourceNode);
+	nodes.insert(nodes.end(), mStages.begin(), mStages.end());
+	nodes.push_back(mOutputNode);
+
+	for( size_t n=0; n < nodes.size() - 1; n++ )
+	{
+		Queue* queue = new Queue();
+
+		queue->slots.resize(mQueueDepth);
+		queue->head     = 0;
+		queue->tail     = 0;
+		queue->producer = nodes[n];
+		queue->consumer = nodes[n+1];
+
+		nodes[n]->output  = queue;
+		nodes[n+1]->input = queue;
+
+		mQueues.push_back(queue);
+	}
+
+	for( size_t n=0; n < nodes.size(); n++ )
+	{
+		nodes[n]->done = false;
+
+		if( CUDA_FAILED(cudaStreamCreateWithFlags(&nodes[n]->stream, cudaStreamNonBlocking)) )
+		{
+			Stop();
+			return false;
+		}
+	}
+
+	// every queue can be full while each thread also holds a frame
+	const size_t numFrames = mQueues.size() * mQueueDepth + nodes.size() + 1;
+
+	for( size_t n=0; n < numFrames; n++ )
+	{
+		Frame* frame = new Frame();
+
+		frame->image  = NULL;
+		frame->size   = 0;
+		frame->width  = 0;
+		frame->height = 0;
+		frame->ready  = NULL;
+
+		mFrames.push_back(frame);
+		mFreeFrames.push_back(frame);
+
+		if( CUDA_FAILED(cudaEventCreateWithFlags(&frame->ready, cudaEventDisableTiming)) )
+		{
+			Stop();
+			return false;
+		}
+	}
+
+	// start the threads from the output back to the source
+	if( !mOutputNode->thread.Start(outputThread, mOutputNode) )
+	{
+		LogError(LOG_PIPELINE "failed to start the output thread\n");
+		Stop();
+		return false;
+	}
+
+	for( int n=mStages.size()-1; n >= 0; n-- )
+	{
+		if( !mStages[n]->thread.Start(stageThread, mStages[n]) )
+		{
+			LogError(LOG_PIPELINE "failed to start the thread of stage '%s'\n", mStages[n]->name.c_str());
+			Stop();
+			return false;
+		}
+	}
+
+	if( !mSourceNode->thread.Start(sourceThread, mSourceNode) )
+	{
+		LogError(LOG_PIPELINE "failed to start the source thread\n");
+		Stop();
+		return false;
+	}
+
+	LogVerbose(LOG_PIPELINE "started %zu stages (queue depth %u, policy %s, %zu frames)\n",
+			 mStages.size(), mQueueDepth, videoPipelinePolicyToStr(mPolicy), mFrames.size());
+
+	return true;
+}
+
+
+// Stop
+void videoPipeline::Stop()
+{
+	if( !mRunning )
+		return;
+
+	mStop = true;
+
+	// wake up any thread that's waiting on a queue
+	for( size_t n=0; n < mQueues.size(); n++ )
+	{
+		mQueues[n]->pushed.Wake();
+		mQueues[n]->popped.Wake();
+	}
+
+	mFreeEvent.Wake();
+
+	// wait for the threads to exit
+	std::vector<Node*> nodes;
+
+	nodes.push_back(mSourceNode);
+	nodes.insert(nodes.end(), mStages.begin(), mStages.end());
+	nodes.push_back(mOutputNode);
+
+	for( size_t n=0; n < nodes.size(); n++ )
+		nodes[n]->thread.Stop(true);
+
+	for( size_t n=0; n < nodes.size(); n++ )
+	{
+		if( nodes[n]->stream != NULL )
+		{
+			CUDA(cudaStreamSynchronize(nodes[n]->stream));
+			CUDA(cudaStreamDestroy(nodes[n]->stream));
+			nodes[n]->stream = NULL;
+		}
+
+		nodes[n]->input  = NULL;
+		nodes[n]->output = NULL;
+	}
+
+	// free the queues and the frames
+	for( size_t n=0; n < mQueues.size(); n++ )
+		delete mQueues[n];
+
+	for( size_t n=0; n < mFrames.size(); n++ )
+	{
+		if( mFrames[n]->image != NULL )
+			cudaFreeMapped(mFrames[n]->image);
+
+		if( mFrames[n]->ready != NULL )
+			CUDA(cudaEventDestroy(mFrames[n]->ready));
+
+		delete mFrames[n];
+	}
+
+	mQueues.clear();
+	mFrames.clear();
+	mFreeFrames.clear();
+
+	mRunning = false;
+}
+
+
+// push
+bool videoPipeline::push( Node* node, Frame* frame )
+{
+	Queue* queue = node->output;
+
+	while( true )
+	{
+		size_t tail = queue->tail.load(std::memory_order_acquire);
+		const size_t head = queue->head.load(std::memory_order_relaxed);
+
+		if( head - tail < mQueueDepth )
+		{
+			queue->slots[head % mQueueDepth] = frame;
+			queue->head.store(head + 1, std::memory_order_release);
+			queue->pushed.Wake();
+			return true;
+		}
+
+		if( mStop )
+			break;
+
+		if( mPolicy == PIPELINE_BLOCK )
+		{
+			queue->popped.Wait(PIPELINE_POLL_TIMEOUT);
+		}
+		else if( mPolicy == PIPELINE_DROP_NEWEST )
+		{
+			break;
+		}
+		else if( mPolicy == PIPELINE_DROP_OLDEST )
+		{
+			// race the consumer for the oldest frame - whoever advances the tail owns it
+			Frame* oldest = queue->slots[tail % mQueueDepth];
+
+			if( queue->tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel) )
+			{
+				queue->consumer->drops++;
+				freeFrame(oldest);
+			}
+		}
+	}
+
+	queue->consumer->drops++;
+	freeFrame(frame);
+
+	return false;
+}
+
+
+// pop
+videoPipeline::Frame* videoPipeline::pop( Node* node )
+{
+	Queue* queue = node->input;
+
+	while( !mStop )
+	{
+		size_t tail = queue->tail.load(std::memory_order_acquire);
+		const size_t head = queue->head.load(std::memory_order_acquire);
+
+		if( tail != head )
+		{
+			Frame* frame = queue->slots[tail % mQueueDepth];
+
+			// the producer may have dropped this frame in the meantime
+			if( queue->tail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel) )
+			{
+				queue->popped.Wake();
+				return frame;
+			}
+
+			continue;
+		}
+
+		// the queue is empty and nothing else is coming
+		if( queue->producer->done )
+			break;
+
+		queue->pushed.Wait(PIPELINE_POLL_TIMEOUT);
+	}
+
+	return NULL;
+}
+
+
+// allocFrame
+videoPipeline::Frame* videoPipeline::allocFrame()
+{
+	while( !mStop )
+	{
+		Frame* frame = NULL;
+
+		mFreeMutex.Lock();
+
+		if( mFreeFrames.size() > 0 )
+		{
+			frame = mFreeFrames.back();
+			mFreeFrames.pop_back();
+		}
+
+		mFreeMutex.Unlock();
+
+		if( frame != NULL || mPolicy != PIPELINE_BLOCK )
+			return frame;
+
+		mFreeEvent.Wait(PIPELINE_POLL_TIMEOUT);
+	}
+
+	return NULL;
+}
+
+
+// freeFrame
+void videoPipeline::freeFrame( Frame* frame )
+{
+	if( !frame )
+		return;
+
+	mFreeMutex.Lock();
+	mFreeFrames.push_back(frame);
+	mFreeMutex.Unlock();
+
+	mFreeEvent.Wake();
+}
+
+
+// sourceThread
+void* videoPipeline::sourceThread( void* param )
+{
+	Node* node = (Node*)param;
+	videoPipeline* pipeline = node->pipeline;
+	videoSource* source = pipeline->mSource;
+
+	while( !pipeline->mStop )
+	{
+		void* image = NULL;
+
+		if( !source->Capture(&image, pipeline->mFormat, videoSource::DEFAULT_TIMEOUT) )
+		{
+			if( !source->IsStreaming() )
+			{
+				LogVerbose(LOG_PIPELINE "the source has stopped streaming\n");
+				break;
+			}
+
+			continue;	// timeout
+		}
+
+		Frame* frame = pipeline->allocFrame();
+
+		if( !frame )
+		{
+			node->drops++;
+			continue;
+		}
+
+		const uint32_t width  = source->GetWidth();
+		const uint32_t height = source->GetHeight();
+		const size_t   size   = imageFormatSize(pipeline->mFormat, width, height);
+
+		// the previous user of the frame may still be working on it
+		CUDA(cudaEventSynchronize(frame->ready));
+
+		if( frame->size < size )
+		{
+			if( frame->image != NULL )
+				cudaFreeMapped(frame->image);
+
+			frame->image = NULL;
+			frame->size  = 0;
+
+			if( !cudaAllocMapped(&frame->image, size) )
+			{
+				LogError(LOG_PIPELINE "failed to allocate %zu bytes for a frame\n", size);
+				pipeline->freeFrame(frame);
+				break;
+			}
+
+			frame->size = size;
+		}
+
+		// copy the frame out of the source's ring buffer, which it will re-use
+		CUDA(cudaMemcpyAsync(frame->image, image, size, cudaMemcpyDeviceToDevice, node->stream));
+		CUDA(cudaEventRecord(frame->ready, node->stream));
+		CUDA(cudaStreamSynchronize(node->stream));
+
+		videoLatency::Propagate(image, frame->image);
+
+		frame->width  = width;
+		frame->height = height;
+
+		node->frames++;
+		pipeline->push(node, frame);
+	}
+
+	node->done = true;
+	node->output->pushed.Wake();
+
+	return NULL;
+}
+
+
+// stageThread
+void* videoPipeline::stageThread( void* param )
+{
+	Node* node = (Node*)param;
+	videoPipeline* pipeline = node->pipeline;
+
+	while( Frame* frame = pipeline->pop(node) )
+	{
+		// wait on the GPU for the upstream stage to finish with the frame
+		CUDA(cudaStreamWaitEvent(node->stream, frame->ready, 0));
+
+		bool keep = false;
+
+		{
+			profilerScope scope(node->name.c_str(), node->stream);
+			keep = node->func(frame->image, frame->width, frame->height, pipeline->mFormat, node->stream, node->user);
+		}
+
+		CUDA(cudaEventRecord(frame->ready, node->stream));
+
+		if( !keep )
+		{
+			node->drops++;
+			pipeline->freeFrame(frame);
+			continue;
+		}
+
+		node->frames++;
+		pipeline->push(node, frame);
+	}
+
+	node->done = true;
+	node->output->pushed.Wake();
+
+	return NULL;
+}
+
+
+// outputThread
+void* videoPipeline::outputThread( void* param )
+{
+	Node* node = (Node*)param;
+	videoPipeline* pipeline = node->pipeline;
+
+	while( Frame* frame = pipeline->pop(node) )
+	{
+		CUDA(cudaEventSynchronize(frame->ready));
+
+		for( size_t n=0; n < pipeline->mOutputs.size(); n++ )
+			pipeline->mOutputs[n]->Render(frame->image, frame->width, frame->height, pipeline->mFormat);
+
+		node->frames++;
+		pipeline->freeFrame(frame);
+	}
+
+	node->done = true;
+	pipeline->mEOS = true;
+
+	return NULL;
+}
+
+
+// findNode
+const videoPipeline::Node* videoPipeline::findNode( int stage ) const
+{
+	if( stage < 0 )
+		return mSourceNode;
+	else if( stage >= (int)mStages.size() )
+		return mOutputNode;
+
+	return mStages[stage];
+}
+
+
+// GetFrameCount
+uint64_t videoPipeline::GetFrameCount( int stage ) const
+{
+	return findNode(stage)->frames;
+}
+
+
+// GetDropCount
+uint64_t videoPipeline::GetDropCount( int stage ) const
+{
+	return findNode(stage)->drops;
+}
+
+
+// PrintStats
+void videoPipeline::PrintStats() const
+{
+	LogInfo(LOG_PIPELINE "%-26s %10s %10s\n", "stage", "frames", "dropped");
+
+	for( int n=-1; n <= (int)mStages.size(); n++ )
+	{
+		const Node* node = findNode(n);
+		LogInfo(LOG_PIPELINE "%-26s %10llu %10llu\n", node->name.c_str(), (unsigned long long)node->frames.load(), (unsigned long long)node->drops.load());
+	}
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __VIDEO_PIPELINE_H_
+#define __VIDEO_PIPELINE_H_
+
+
+#include "videoSource.h"
+#include "videoOutput.h"
+
+#include "Thread.h"
+#include "Event.h"
+#include "Mutex.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+
+/**
+ * Prefix used for log messages from videoPipeline
+ * @ingroup video
+ */
+#define LOG_PIPELINE "[pipeline] "
+
+
+/**
+ * Function pointer typedef of a processing stage in a videoPipeline.
+ *
+ * The stage processes the image in-place, and should queue its CUDA work on `stream`
+ * (it doesn't need to synchronize the stream, the next stage waits for it on the GPU).
+ *
+ * @returns true to pass the frame on to the next stage, or false to drop it.
+ * @ingroup video
+ */
+typedef bool (*videoPipelineStage)( void* image, uint32_t width, uint32_t height, imageFormat format, cudaStream_t stream, void* user );
+
+
+/**
+ * What a videoPipeline does when a stage produces frames faster than the next one consumes them.
+ * @ingroup video
+ */
+enum videoPipelinePolicy
+{
+	PIPELINE_BLOCK = 0,		/**< Wait for room in the queue, which slows down the upstream stages (and the source) */
+	PIPELINE_DROP_OLDEST,	/**< Drop the oldest frame in the queue to make room, so the newest frames get through */
+	PIPELINE_DROP_NEWEST	/**< Drop the new frame when the queue is full */
+};
+
+/**
+ * Parse a videoPipelinePolicy from a string (`block`, `drop-oldest` or `drop-newest`).
+ * @ingroup video
+ */
+videoPipelinePolicy videoPipelinePolicyFromStr( const char* str, videoPipelinePolicy default_value=PIPELINE_BLOCK );
+
+/**
+ * Convert a videoPipelinePolicy to a string.
+ * @ingroup video
+ */
+const char* videoPipelinePolicyToStr( videoPipelinePolicy policy );
+
+
+/**
+ * Runs a videoSource, a chain of user-supplied CUDA stages, and any number of videoOutputs
+ * concurrently, so that the throughput is limited by the slowest stage instead of the sum
+ * of all of them (like it is in a single-threaded Capture -> process -> Render loop).
+ *
+ * The source, each stage, and the outputs get their own thread and CUDA stream, and are
+ * connected by bounded lock-free queues.  Captured frames are copied into a pool of
+ * buffers owned by the pipeline, so that they aren't overwritten by the source while
+ * they're still being processed downstream.  The stages wait on each other with CUDA
+ * events, so the CPU threads don't synchronize their streams until the output.
+ *
+ * When a queue fills up, the videoPipelinePolicy decides whether the upstream stage waits
+ * (the default) or a frame gets dropped.  Each stage is recorded with the Profiler under
+ * its name, and the number of frames processed and dropped is kept by the pipeline.
+ *
+ * @ingroup video
+ */
+class videoPipeline
+{
+public:
+	/**
+	 * Create a pipeline that captures frames from `source` in the given format.
+	 * The pipeline doesn't take ownership of the source or the outputs.
+	 *
+	 * @param queueDepth the number of frames that can wait between two stages.
+	 */
+	videoPipeline( videoSource* source, imageFormat format=IMAGE_RGB8, uint32_t queueDepth=2, videoPipelinePolicy policy=PIPELINE_BLOCK );
+
+	/**
+	 * Destructor (stops the pipeline).
+	 */
+	~videoPipeline();
+
+	/**
+	 * Append a processing stage, which runs on its own thread.
+	 * Stages can only be added while the pipeline is stopped.
+	 * @returns the index of the stage, or -1 on error.
+	 */
+	int AddStage( const char* name, videoPipelineStage stage, void* user=NULL );
+
+	/**
+	 * Add an output that the processed frames get rendered to.
+	 * Outputs can only be added while the pipeline is stopped.
+	 * @returns the index of the output, or -1 on error.
+	 */
+	int AddOutput( videoOutput* output );
+
+	/**
+	 * Start the threads.
+	 */
+	bool Start();
+
+	/**
+	 * Stop the threads, and wait for them to exit.
+	 * Frames that are still in the queues are discarded.
+	 */
+	void Stop();
+
+	/**
+	 * Return true if the pipeline is running (it stops by itself when the source reaches EOS).
+	 */
+	inline bool IsRunning() const					{ return mRunning && !mStop && !mEOS; }
+
+	/**
+	 * Return the number of stages.
+	 */
+	inline uint32_t GetNumStages() const			{ return mStages.size(); }
+
+	/**
+	 * Return the number of frames that made it through a stage.
+	 * The source is stage -1, and the outputs are stage GetNumStages().
+	 */
+	uint64_t GetFrameCount( int stage ) const;
+
+	/**
+	 * Return the number of frames that were dropped by the queue in front of a stage,
+	 * or by the stage itself (the source is stage -1, and the outputs are stage GetNumStages()).
+	 */
+	uint64_t GetDropCount( int stage ) const;
+
+	/**
+	 * Log the frame and drop counts of each stage.
+	 */
+	void PrintStats() const;
+
+protected:
+	struct Frame
+	{
+		void*       image;
+		size_t      size;
+		uint32_t    width;
+		uint32_t    height;
+		cudaEvent_t ready;	// recorded after the last stage that processed the frame
+	};
+
+	struct Node;
+
+	// bounded single-producer/single-consumer queue (the producer can also drop the oldest frame)
+	struct Queue
+	{
+		std::vector<Frame*> slots;
+		std::atomic<size_t> head;	// only modified by the producer
+		std::atomic<size_t> tail;	// modified by the consumer, or by the producer when dropping
+		Event pushed;
+		Event popped;
+		Node* producer;
+		Node* consumer;
+	};
+
+	struct Node
+	{
+		videoPipeline*     pipeline;
+		int                index;	// -1 for the source, mStages.size() for the outputs
+		std::string        name;
+		videoPipelineStage func;
+		void*              user;
+		cudaStream_t       stream;
+		Thread             thread;
+		Queue*             input;
+		Queue*             output;
+		volatile bool      done;	// the thread has exited
+
+		std::atomic<uint64_t> frames;
+		std::atomic<uint64_t> drops;
+	};
+
+	static void* sourceThread( void* param );
+	static void* stageThread( void* param );
+	static void* outputThread( void* param );
+
+	bool push( Node* node, Frame* frame );
+	Frame* pop( Node* node );
+
+	Frame* allocFrame();
+	void freeFrame( Frame* frame );
+
+	const Node* findNode( int stage ) const;
+
+	videoSource* mSource;
+	imageFormat  mFormat;
+	uint32_t     mQueueDepth;
+
+	videoPipelinePolicy mPolicy;
+
+	std::vector<Node*> mStages;
+	std::vector<videoOutput*> mOutputs;
+
+	Node* mSourceNode;
+	Node* mOutputNode;
+
+	std::vector<Queue*> mQueues;
+	std::vector<Frame*> mFrames;	// every frame in the pool
+	std::vector<Frame*> mFreeFrames;
+
+	Mutex mFreeMutex;
+	Event mFreeEvent;
+
+	volatile bool mRunning;
+	volatile bool mStop;
+	volatile bool mEOS;
+};
+
+#endif
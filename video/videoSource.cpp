@@ -22,26 +22,160 @@
  
 #include "videoSource.h"
 #include "imageLoader.h"
+#include "rawFrameLoader.h"
+#include "udpFrameReceiver.h"
+#include "shmFrameReader.h"
+#include "testPatternSource.h"
 
 #include "gstCamera.h"
+#include "v4l2Camera.h"
 #include "gstDecoder.h"
 
+#include "glDisplayCapture.h"
+
+#include "cudaMotion.h"
+#include "cudaFlip.h"
+#include "cudaMemoryStats.h"
+#include "videoMetrics.h"
+
 #include "logging.h"
 
 
 // constructor
 videoSource::videoSource( const videoOptions& options ) : mOptions(options)
 {
+	mOptions.ResolveMemory();
+
 	mStreaming = false;
 	mLastTimestamp = 0;
+	mLastCaptureTime = 0;
 	mRawFormat = IMAGE_UNKNOWN;
+
+	mCallback       = NULL;
+	mCallbackFormat = IMAGE_RGB8;
+	mCallbackUser   = NULL;
+
+	mMotion = NULL;
+	mFlipCapture = false;
+	mFlipFormat  = IMAGE_UNKNOWN;
+
+	videoMetrics::Add(this);
 }
 
 
 // destructor
 videoSource::~videoSource()
 {
+	videoMetrics::Remove(this);
+
+	if( mMotion != NULL )
+	{
+		delete mMotion;
+		mMotion = NULL;
+	}
+}
+
+
+// detectMotion
+void videoSource::detectMotion( void* image, imageFormat format )
+{
+	if( !mMotion )
+		mMotion = new cudaMotion(mOptions.motionThreshold);
+
+	if( mMotion->Process(image, GetWidth(), GetHeight(), format) != cudaSuccess )
+	{
+		LogError(LOG_VIDEO "videoSource -- disabling motion detection, it failed on a %s frame\n", imageFormatToStr(format));
+
+		delete mMotion;
+		mMotion = NULL;
+		mOptions.motionDetect = false;
+	}
+}
+
 
+// flipCapture
+bool videoSource::flipCapture( void** image, imageFormat format )
+{
+	if( !mFlipCapture || mOptions.flipMethod == videoOptions::FLIP_NONE )
+		return true;
+
+	if( format == IMAGE_UNKNOWN )
+		format = mRawFormat;
+
+	// the buffers only get re-allocated when the frames grow (or the format changes)
+	size_t size = imageFormatSize(format, mOptions.width, mOptions.height);
+
+	if( size < mFlipBuffers.GetBufferSize() && format == mFlipFormat )
+		size = mFlipBuffers.GetBufferSize();
+
+	mFlipFormat = format;
+
+	if( !mFlipBuffers.Alloc(mOptions.numBuffers, size, mOptions.zeroCopy ? RingBuffer::ZeroCopy : 0) )
+	{
+		LogError(LOG_VIDEO "videoSource -- failed to allocate %u buffers (%zu bytes each) for flipping\n", mOptions.numBuffers, size);
+		return false;
+	}
+
+	void* output = mFlipBuffers.Next(RingBuffer::Write);
+
+	if( CUDA_FAILED(cudaFlip(*image, output, mOptions.width, mOptions.height, format, (cudaFlipMethod)mOptions.flipMethod)) )
+	{
+		LogError(LOG_VIDEO "videoSource -- failed to apply flip-method=%s to %s frame\n", videoOptions::FlipMethodToStr(mOptions.flipMethod), imageFormatToStr(format));
+		return false;
+	}
+
+	*image = output;
+	return true;
+}
+
+
+// flipTransposed
+bool videoSource::flipTransposed() const
+{
+	return mFlipCapture && cudaFlipTransposes((cudaFlipMethod)mOptions.flipMethod);
+}
+
+
+// HasMotion
+bool videoSource::HasMotion() const
+{
+	if( !mMotion )
+		return true;
+
+	return mMotion->HasMotion();
+}
+
+
+// SetCallback
+bool videoSource::SetCallback( videoSourceCallback callback, imageFormat format, void* user )
+{
+	LogError(LOG_VIDEO "videoSource -- %s doesn't support frame callbacks\n", TypeToStr());
+	return false;
+}
+
+
+// GetStats
+bool videoSource::GetStats( videoSourceStats* stats ) const
+{
+	if( stats != NULL )
+		*stats = videoSourceStats();
+
+	return false;
+}
+
+
+// Convert
+bool videoSource::Convert( void** image, imageFormat format )
+{
+	LogError(LOG_VIDEO "videoSource -- %s doesn't support deferred conversion with Convert()\n", TypeToStr());
+	return false;
+}
+
+
+// GetEventFD
+int videoSource::GetEventFD()
+{
+	return -1;
 }
 
 // Create
@@ -50,14 +184,24 @@ videoSource* videoSource::Create( const videoOptions& options )
 	videoSource* src = NULL;
 	const URI& uri = options.resource;
 
+	// fail early if there isn't room left in the memory budget for at least 2 frames
+	if( !cudaMemoryFits(2 * imageFormatSize(IMAGE_RGB8, options.width, options.height)) )
+	{
+		LogError(LOG_VIDEO "videoSource -- not enough memory left in the budget to create %s\n", uri.string.c_str());
+		cudaMemoryReport();
+		return NULL;
+	}
+
 	if( uri.protocol == "file" )
 	{
-		if( gstDecoder::IsSupportedExtension(uri.extension.c_str()) )
+		if( rawFrameLoader::IsSupportedExtension(uri.extension.c_str()) )
+			src = rawFrameLoader::Create(options);
+		else if( gstDecoder::IsSupportedExtension(uri.extension.c_str()) )
 			src = gstDecoder::Create(options);
 		else
 			src = imageLoader::Create(options);
 	}
-	else if( uri.protocol == "rtp" || uri.protocol == "rtsp" || uri.protocol == "webrtc" )
+	else if( uri.protocol == "rtp" || uri.protocol == "rtsp" || uri.protocol == "webrtc" || uri.protocol == "packet" )
 	{
 		src = gstDecoder::Create(options);
 	}
@@ -65,6 +209,26 @@ videoSource* videoSource::Create( const videoOptions& options )
 	{
 		src = gstCamera::Create(options);
 	}
+	else if( uri.protocol == "v4l2raw" )
+	{
+		src = v4l2Camera::Create(options);
+	}
+	else if( uri.protocol == "display" )
+	{
+		src = glDisplayCapture::Create(options);
+	}
+	else if( uri.protocol == UDP_FRAME_PROTOCOL )
+	{
+		src = udpFrameReceiver::Create(options);
+	}
+	else if( uri.protocol == SHM_FRAME_PROTOCOL )
+	{
+		src = shmFrameReader::Create(options);
+	}
+	else if( uri.protocol == "test" )
+	{
+		src = testPatternSource::Create(options);
+	}
 	else
 	{
 		LogError(LOG_VIDEO "videoSource -- unsupported protocol (%s)\n", uri.protocol.size() > 0 ? uri.protocol.c_str() : "null");
@@ -153,6 +317,18 @@ const char* videoSource::TypeToStr( uint32_t type )
 		return "gstDecoder";
 	else if( type == imageLoader::Type )
 		return "imageLoader";
+	else if( type == rawFrameLoader::Type )
+		return "rawFrameLoader";
+	else if( type == glDisplayCapture::Type )
+		return "glDisplayCapture";
+	else if( type == v4l2Camera::Type )
+		return "v4l2Camera";
+	else if( type == udpFrameReceiver::Type )
+		return "udpFrameReceiver";
+	else if( type == shmFrameReader::Type )
+		return "shmFrameReader";
+	else if( type == testPatternSource::Type )
+		return "testPatternSource";
 
 	return "(unknown)";
 }
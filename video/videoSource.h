@@ -27,6 +27,60 @@
 #include "videoOptions.h"
 #include "imageFormat.h"		
 #include "commandLine.h"
+#include "videoLatency.h"
+#include "RingBuffer.h"
+
+
+// forward declarations
+class videoSource;
+class cudaMotion;
+
+
+/**
+ * Callback that recieves the frames pushed from a videoSource (see videoSource::SetCallback())
+ *
+ * @param source the stream that the frame came from
+ * @param image the image in CUDA memory (in the format that was passed to SetCallback()).
+ *              The frame belongs to the callback until it returns, after which
+ *              the stream may re-use the memory for subsequent frames.
+ * @param width the width of the image (in pixels)
+ * @param height the height of the image (in pixels)
+ * @param format the format of the image
+ * @param timestamp the timestamp of the frame (in nanoseconds)
+ * @param user the user pointer that was passed to SetCallback()
+ *
+ * @ingroup video
+ */
+typedef void (*videoSourceCallback)( videoSource* source, void* image, uint32_t width, uint32_t height, imageFormat format, uint64_t timestamp, void* user );
+
+
+/**
+ * Statistics of the frames that a videoSource recieved from the stream and the ones that
+ * were captured from it (see videoSource::GetStats()), with the times in milliseconds.
+ *
+ * Frames get dropped when newer ones arrive before they're captured (Capture() always
+ * returns the latest frame), so a growing number of dropped frames or a high queue depth
+ * means that the application isn't keeping up with the stream, while a drop in the framerate
+ * or high jitter (and long maximum intervals) point to problems with the camera or network.
+ *
+ * @ingroup video
+ */
+struct videoSourceStats
+{
+	uint64_t framesReceived;	/**< Frames that arrived from the stream */
+	uint64_t framesCaptured;	/**< Frames that were captured (or delivered to the callback) */
+	uint64_t framesDropped;	/**< Frames that were replaced by a newer one before they were captured */
+	uint64_t framesSkipped;	/**< Frames that were skipped without being converted (see videoOptions::adaptiveRate) */
+	uint64_t queueDepth;		/**< Frames that arrived since the last capture */
+	uint64_t maxQueueDepth;	/**< The largest queue depth so far */
+	float    frameRate;		/**< Framerate that the frames actually arrive at (in FPS) */
+	float    interval;		/**< Average time between the frames arriving */
+	float    maxInterval;		/**< Longest time between two frames arriving */
+	float    jitter;		/**< Average deviation of the time between frames from the average */
+	float    convertTime;		/**< Average time to capture a frame once it arrived (mapping and conversion) */
+	float    maxConvertTime;	/**< Longest time to capture a frame once it arrived */
+	float    captureInterval;	/**< Average time between the application's captures */
+};
 
 
 /**
@@ -39,9 +93,15 @@
 		  "                             * csi://0                  (MIPI CSI camera #0)\n"		\
 		  "                             * rtp://@:1234             (RTP stream)\n"				\
 		  "                             * rtsp://user:pass@ip:1234 (RTSP stream)\n"			\
+		  "                             * udp-raw://@:1234         (uncompressed UDP stream)\n"	\
+		  "                             * shm://my_stream          (shared memory from another process)\n" \
+		  "                             * packet://                (encoded packets from the application)\n" \
 		  "                             * file://my_image.jpg      (image file)\n"				\
 		  "                             * file://my_video.mp4      (video file)\n"				\
 		  "                             * file://my_directory/     (directory of images)\n"		\
+		  "                             * display://0              (frames rendered by glDisplay #0)\n" \
+		  "                             * test://bars              (generated test pattern, or gradient,\n" \
+		  "                                                         checkerboard, noise, solid)\n" \
 		  "  --input-width=WIDTH    explicitly request a width of the stream (optional)\n"   	\
 		  "  --input-height=HEIGHT  explicitly request a height of the stream (optional)\n"  	\
 		  "  --input-rate=RATE      explicitly request a framerate of the stream (optional)\n"	\
@@ -51,6 +111,13 @@
 		  "                             * vp8, vp9\n"									\
 		  "                             * mpeg2, mpeg4\n"									\
 		  "                             * mjpeg\n"        								\
+		  "  --input-decoder=TYPE   decoder to use for MJPEG cameras, one of these:\n"		\
+		  "                             * auto (default, hardware when available)\n"		\
+		  "                             * cpu, v4l2, nvjpeg\n"							\
+		  "  --input-converter=TYPE converts NVMM frames with cuda (default) or vic\n"		\
+		  "  --input-memory=TYPE    memory for the frames: auto (default), mapped, device\n"	\
+		  "  --input-gpu=N          CUDA device to use for the stream (default is current)\n" \
+		  "  --memory-budget=MB     limit the memory used by all the streams (in megabytes)\n" \
 		  "  --input-flip=FLIP      flip method to apply to input:\n" 						\
 		  "                             * none (default)\n" 								\
 		  "                             * counterclockwise\n" 								\
@@ -63,7 +130,22 @@
 		  "  --input-loop=LOOP      for file-based inputs, the number of loops to run:\n"		\
 		  "                             * -1 = loop forever\n"								\
 		  "                             *  0 = don't loop (default)\n"						\
-		  "                             * >0 = set number of loops\n\n"
+		  "                             * >0 = set number of loops\n"						\
+		  "  --input-threads=N      for image sequences, the number of threads decoding\n"	\
+		  "                         images ahead of time (default is 0, disabled)\n"		\
+		  "  --input-stream-files   for image directories, load the files as they're found\n"	\
+		  "                         instead of listing and sorting them all first\n"	\
+		  "  --input-low-latency    for live streams, drop old frames so that the newest\n"	\
+		  "                         frame is always the one captured\n"					\
+		  "  --input-motion         detect motion in each frame, so that static frames\n"	\
+		  "                         can be skipped (see videoSource::HasMotion())\n"		\
+		  "  --input-motion-threshold=N  luminance difference that counts as motion\n"	\
+		  "                         (between 0 and 255, the default is 20)\n"			\
+		  "  --input-adaptive-rate  skip converting the frames that arrive faster than\n"	\
+		  "                         the application captures them (saves GPU time)\n"	\
+		  "  --input-rtsp-transport=PROTO  RTSP transport (auto (default), udp, or tcp)\n"	\
+		  "  --input-reconnect=MS   reconnect RTSP streams after errors or MS milliseconds\n"	\
+		  "                         without packets (default is 0, disabled)\n\n"
 
 
 /**
@@ -71,7 +153,7 @@
  * V4L2 cameras, video/images files from disk, directories containing a sequence of images, 
  * and from RTP/RTSP network video streams over UDP/IP.
  *
- * videoSource interfaces are implemented by gstCamera, gstDecoder, and imageLoader.
+ * videoSource interfaces are implemented by gstCamera, gstDecoder, imageLoader, and rawFrameLoader.
  * The specific implementation is selected at runtime based on the type of resource URI.
  *
  * videoSource supports the following protocols and resource URI's:
@@ -96,6 +178,16 @@
  *        `1234` is the port.  For example, `rtsp://192.168.1.2:5000`.  The `username` and `password` 
  *        are optional, and are only used for RTSP streams that require authentication.
  *
+ *     - `udp-raw://@:1234` to recieve uncompressed frames sent over UDP by another videoOutput
+ *        (see udpFrameReceiver).  This is intended for fast local networks with jumbo frames.
+ *
+ *     - `shm://my_stream` to capture frames zero-copy from another process on the same device,
+ *        that's outputting them to the same `shm://my_stream` (see shmFrameReader).
+ *
+ *     - `packet://` to decode a compressed stream that the application pushes into the decoder
+ *        (see gstDecoder::Push()), for example from its own network transport.  Set the codec with
+ *        `--input-codec` (the default is H.264).
+ *
  *     - `file:///home/user/my_video.mp4` for disk-based videos, images, and directories of images.
  *        You can leave off the `file://` protocol identifier and it will be deduced from the path.
  *        It can be a relative or absolute path.  If a directory is specified that contains images,
@@ -105,6 +197,7 @@
  *        Supported video formats for loading include MKV, MP4, AVI, and FLV. Supported codecs for 
  *        decoding include H.264, H.265, VP8, VP9, MPEG-2, MPEG-4, and MJPEG. Supported image formats
  *        for loading include JPG, PNG, TGA, BMP, GIF, PSD, HDR, PIC, and PNM (PPM/PGM binary).
+ *        Uncompressed recordings from rawFrameWriter (`.jraw`) are replayed by rawFrameLoader.
  *  
  * @see URI for info about resource URI formats.
  * @see videoOptions for additional options and command-line arguments.
@@ -213,6 +306,57 @@ public:
 	 * @returns `true` if a frame was captured, `false` if there was an error or a timeout occurred.
 	 */
 	virtual bool Capture( void** image, imageFormat format, uint64_t timeout=DEFAULT_TIMEOUT ) = 0;
+
+	/**
+	 * Set a callback that frames get pushed to as they arrive, instead of pulling them with Capture().
+	 *
+	 * The callback is invoked from the stream's own thread (for example the appsink thread of
+	 * gstCamera and gstDecoder) after the frame has been converted into the requested format,
+	 * so the application doesn't need a thread of its own that blocks in Capture().  Capture()
+	 * shouldn't be called while a callback is set.  Pass NULL to remove the callback again.
+	 *
+	 * Callbacks are supported by gstCamera, gstDecoder, and imageLoader.
+	 *
+	 * @param callback the function that the frames get pushed to (or NULL to disable)
+	 * @param format the format that the frames get converted to (or `IMAGE_UNKNOWN` for the raw format)
+	 * @param user pointer that gets passed to the callback
+	 *
+	 * @returns `true` if the callback was set, or `false` if the stream doesn't support callbacks.
+	 */
+	virtual bool SetCallback( videoSourceCallback callback, imageFormat format=IMAGE_RGB8, void* user=NULL );
+
+	/**
+	 * Convert the last captured frame into another format.
+	 *
+	 * gstCamera and gstDecoder can return their native YUV buffer from Capture() without any
+	 * copies or colorspace conversion, when `IMAGE_UNKNOWN` or the raw format of the stream
+	 * (see GetRawFormat(), typically `IMAGE_NV12` or `IMAGE_I420`) is requested.  Consumers that
+	 * only need an RGB image some of the time can then call Convert(), which converts the frame
+	 * the first time that a format is requested, and returns that same image after that.
+	 *
+	 * @param[out] image output pointer that will be set to the memory containing the converted image.
+	 * @param[in] format the format to convert the frame to.
+	 *
+	 * @returns `true` if the frame was converted, or `false` if there was an error or if
+	 *          the stream doesn't support deferred conversion.
+	 */
+	virtual bool Convert( void** image, imageFormat format );
+
+	/**
+	 * Get a file descriptor that becomes readable when a new frame can be captured,
+	 * so that many sources (and sockets) can be waited on from one thread with
+	 * poll() or epoll (see SocketPoller::AddFD()), instead of a thread per source
+	 * blocking in Capture().  When it's readable, call Capture() with a timeout of 0.
+	 *
+	 * This is supported by gstCamera, gstDecoder and udpFrameReceiver.
+	 * @returns the file descriptor (owned by the source), or -1 if it's unsupported.
+	 */
+	virtual int GetEventFD();
+
+	/**
+	 * Return true if a callback has been set with SetCallback().
+	 */
+	inline bool HasCallback() const				{ return (mCallback != NULL); }
 	
 	/**
 	 * Begin streaming the device.
@@ -244,14 +388,14 @@ public:
 	inline bool IsStreaming() const	   			{ return mStreaming; }
 
 	/**
-	 * Return the width of the stream, in pixels.
+	 * Return the width of the stream, in pixels (after it gets rotated by the flip method).
 	 */
-	inline uint32_t GetWidth() const				{ return mOptions.width; }
+	inline uint32_t GetWidth() const				{ return flipTransposed() ? mOptions.height : mOptions.width; }
 
 	/**
-	 * Return the height of the stream, in pixels.
+	 * Return the height of the stream, in pixels (after it gets rotated by the flip method).
 	 */
-	inline uint32_t GetHeight() const				{ return mOptions.height; }
+	inline uint32_t GetHeight() const				{ return flipTransposed() ? mOptions.width : mOptions.height; }
 	
 	/**
 	 * Return the framerate, in Hz or FPS.
@@ -262,12 +406,31 @@ public:
 	 * Return the number of frames captured.
 	 */
 	inline uint64_t GetFrameCount() const			{ return mOptions.frameCount; }
+
+	/**
+	 * Get the statistics of the frames that were recieved and captured, like the number of frames
+	 * that were dropped and the jitter of their arrival times.  They're updated without locking,
+	 * so this can be polled from any thread (e.g. to monitor the health of cameras).
+	 * @returns `false` if the stream doesn't keep statistics (only gstCamera and gstDecoder do).
+	 */
+	virtual bool GetStats( videoSourceStats* stats ) const;
 	
 	/**
 	 * Get timestamp of the last captured frame, in nanoseconds.
  	 */
 	uint64_t GetLastTimestamp() const { return mLastTimestamp; }
 
+	/**
+	 * Get the time that the last frame was captured, in nanoseconds of CLOCK_MONOTONIC.
+	 *
+	 * For GStreamer streams, this is the sensor timestamp if the camera provides one,
+	 * or else the buffer's PTS mapped through the pipeline clock, or else the time that the
+	 * buffer arrived.  Because it's in CLOCK_MONOTONIC, it can be compared between streams
+	 * (e.g. to synchronize cameras) and against the current time (e.g. to measure latency).
+	 * It will be 0 for streams that don't track the capture time.
+	 */
+	inline uint64_t GetLastCaptureTime() const		{ return mLastCaptureTime; }
+
 	/**
 	 * Get raw image format.
  	 */
@@ -283,6 +446,20 @@ public:
 	 */
 	inline const videoOptions& GetOptions() const	{ return mOptions; }
 
+	/**
+	 * Return the motion detector that runs on the captured frames, or NULL if
+	 * motion detection is disabled (see videoOptions::motionDetect).
+	 * Its results, like the regions that changed, are for the last frame that was captured.
+	 */
+	inline cudaMotion* GetMotion() const			{ return mMotion; }
+
+	/**
+	 * Return true if there was motion in the last frame that was captured, or if motion
+	 * detection is disabled (see videoOptions::motionDetect).  Applications can use this
+	 * to skip processing the frames where nothing moved.  This waits for the detector to finish.
+	 */
+	bool HasMotion() const;
+
 	/**
 	 * Return the interface type of the stream.
 	 * This could be one of the following values:
@@ -290,6 +467,8 @@ public:
 	 *    - gstCamera::Type
 	 *    - gstDecoder::Type
 	 *    - imageLoader::Type
+	 *    - rawFrameLoader::Type
+	 *    - v4l2Camera::Type
 	 */
 	virtual inline uint32_t GetType() const			{ return 0; }
 
@@ -327,11 +506,54 @@ protected:
 	//videoSource();
 	videoSource( const videoOptions& options );
 
+	/**
+	 * Record the capture time of a frame that was just captured, for latency measurement.
+	 * @see videoLatency
+	 */
+	inline void stampCapture( void* image, imageFormat format )
+	{
+		if( videoLatency::IsEnabled() )
+			videoLatency::Stamp(image, GetWidth(), GetHeight(), (format != IMAGE_UNKNOWN) ? format : mRawFormat, mLastCaptureTime);
+
+		if( mOptions.motionDetect )
+			detectMotion(image, (format != IMAGE_UNKNOWN) ? format : mRawFormat);
+	}
+
+	/**
+	 * Run the motion detector on a frame that was just captured (called by stampCapture()).
+	 */
+	void detectMotion( void* image, imageFormat format );
+
+	/**
+	 * Apply the flip method to a frame that was just captured, for sources that can't flip
+	 * it natively (the GStreamer sources do it in their pipelines instead).  The flipped frame
+	 * replaces `image`, and comes from a ringbuffer of `mOptions.numBuffers` images.  These
+	 * sources set mFlipCapture in their constructor, and keep the size of the frames before
+	 * they're flipped in `mOptions.width` and `mOptions.height`.
+	 */
+	bool flipCapture( void** image, imageFormat format );
+
+	/**
+	 * Return true if the frames get transposed by flipCapture() (which swaps the width and height).
+	 */
+	bool flipTransposed() const;
+
 	bool         mStreaming;
 	videoOptions mOptions;
 
 	uint64_t     mLastTimestamp;
+	uint64_t     mLastCaptureTime;
 	imageFormat  mRawFormat;
+
+	videoSourceCallback mCallback;
+	imageFormat         mCallbackFormat;
+	void*               mCallbackUser;
+
+	cudaMotion*         mMotion;
+
+	bool                mFlipCapture;
+	RingBuffer          mFlipBuffers;
+	imageFormat         mFlipFormat;
 };
 
 #endif
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "videoSourceGroup.h"
+
+#include "gstCamera.h"
+#include "gstDecoder.h"
+
+#include "timespec.h"
+#include "logging.h"
+
+
+// constructor
+videoSourceGroup::videoSourceGroup()
+{
+	mCaptureFormat = IMAGE_UNKNOWN;
+}
+
+
+// destructor
+videoSourceGroup::~videoSourceGroup()
+{
+
+}
+
+
+// AddSource
+int videoSourceGroup::AddSource( videoSource* source )
+{
+	if( !source )
+		return -1;
+
+	if( mMembers.size() >= CUDA_PREPROCESS_MAX_BATCH )
+	{
+		LogError("videoSourceGroup -- the group already has the maximum of %i streams\n", CUDA_PREPROCESS_MAX_BATCH);
+		return -1;
+	}
+
+	Member member;
+
+	member.source    = source;
+	member.image     = NULL;
+	member.width     = 0;
+	member.height    = 0;
+	member.format    = IMAGE_UNKNOWN;
+	member.timestamp = 0;
+	member.fresh     = false;
+
+	mMembers.push_back(member);
+	return mMembers.size() - 1;
+}
+
+
+// Open
+bool videoSourceGroup::Open()
+{
+	const uint32_t numSources = mMembers.size();
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		if( !mMembers[n].source->Open() )
+			return false;
+	}
+
+	return true;
+}
+
+
+// Close
+void videoSourceGroup::Close()
+{
+	const uint32_t numSources = mMembers.size();
+
+	for( uint32_t n=0; n < numSources; n++ )
+		mMembers[n].source->Close();
+}
+
+
+// captureFrames
+bool videoSourceGroup::captureFrames( uint64_t timeout )
+{
+	const uint32_t numSources = mMembers.size();
+
+	if( numSources == 0 )
+	{
+		LogError("videoSourceGroup::Capture() -- the group doesn't have any streams\n");
+		return false;
+	}
+
+	// every member waits against the same deadline, so by the time the first (slowest)
+	// member has its frame, the others should already have theirs ready to go
+	const double deadline = (timeout == UINT64_MAX) ? 0.0 : timeDouble() + timeout;
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		Member& member = mMembers[n];
+
+		uint64_t remaining = timeout;
+
+		if( timeout != UINT64_MAX )
+		{
+			const double left = deadline - timeDouble();
+			remaining = (left > 0.0) ? (uint64_t)left : 0;
+		}
+
+		// GStreamer streams can skip their own colorspace conversion
+		imageFormat format = mCaptureFormat;
+
+		if( format == IMAGE_UNKNOWN && !member.source->IsType<gstCamera>() && !member.source->IsType<gstDecoder>() )
+			format = IMAGE_RGB8;
+
+		void* image = NULL;
+
+		member.fresh = member.source->Capture(&image, format, remaining);
+
+		if( member.fresh )
+		{
+			member.image     = image;
+			member.width     = member.source->GetWidth();
+			member.height    = member.source->GetHeight();
+			member.format    = (format == IMAGE_UNKNOWN) ? member.source->GetRawFormat() : format;
+			member.timestamp = member.source->GetLastTimestamp();
+		}
+		else if( !member.image )
+		{
+			LogError("videoSourceGroup::Capture() -- stream %u (%s) hasn't delivered any frames\n", n, member.source->GetResource().string.c_str());
+			return false;
+		}
+		else
+		{
+			LogVerbose("videoSourceGroup::Capture() -- stream %u timed out, re-using its previous frame\n", n);
+		}
+	}
+
+	return true;
+}
+
+
+// captureBatch
+template<typename T>
+bool videoSourceGroup::captureBatch( T* tensor, uint32_t width, uint32_t height, uint64_t timeout,
+							  const float2& range, const float3& mean, const float3& stdDev,
+							  cudaFilterMode filter, cudaStream_t stream )
+{
+	if( !tensor || width == 0 || height == 0 )
+		return false;
+
+	if( !captureFrames(timeout) )
+		return false;
+
+	const uint32_t numSources = mMembers.size();
+
+	// check if all the members share the same format
+	cudaPreprocessImage inputs[CUDA_PREPROCESS_MAX_BATCH];
+	bool sameFormat = true;
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		inputs[n].image  = mMembers[n].image;
+		inputs[n].width  = mMembers[n].width;
+		inputs[n].height = mMembers[n].height;
+
+		if( mMembers[n].format != mMembers[0].format )
+			sameFormat = false;
+	}
+
+	// process the whole batch in one launch, or else fall back to one launch per member
+	if( sameFormat )
+	{
+		if( CUDA_FAILED(cudaPreprocessBatch(inputs, numSources, mMembers[0].format, tensor, width, height,
+									 range, mean, stdDev, filter, stream)) )
+		{
+			LogError("videoSourceGroup::Capture() -- failed to pre-process the batch\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	const size_t elements = width * height * 3;
+
+	for( uint32_t n=0; n < numSources; n++ )
+	{
+		if( CUDA_FAILED(cudaPreprocess(inputs[n].image, inputs[n].width, inputs[n].height, mMembers[n].format,
+								 tensor + elements * n, width, height, range, mean, stdDev, filter, stream)) )
+		{
+			LogError("videoSourceGroup::Capture() -- failed to pre-process stream %u\n", n);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Capture (float)
+bool videoSourceGroup::Capture( float* tensor, uint32_t width, uint32_t height, uint64_t timeout,
+						  const float2& range, const float3& mean, const float3& stdDev,
+						  cudaFilterMode filter, cudaStream_t stream )
+{
+	return captureBatch<float>(tensor, width, height, timeout, range, mean, stdDev, filter, stream);
+}
+
+
+// Capture (half)
+bool videoSourceGroup::Capture( __half* tensor, uint32_t width, uint32_t height, uint64_t timeout,
+						  const float2& range, const float3& mean, const float3& stdDev,
+						  cudaFilterMode filter, cudaStream_t stream )
+{
+	return captureBatch<__half>(tensor, width, height, timeout, range, mean, stdDev, filter, stream);
+}
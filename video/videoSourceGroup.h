@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __VIDEO_SOURCE_GROUP_H_
+#define __VIDEO_SOURCE_GROUP_H_
+
+
+#include "videoSource.h"
+#include "cudaPreprocess.h"
+
+#include <vector>
+
+
+/**
+ * Group of videoSource streams that get captured together into one batch for inference.
+ *
+ * Capture() waits for the latest frame from every member while sharing a single timeout
+ * between them (so the total wait is bounded by the slowest stream, instead of adding up
+ * the timeouts of each stream), and then colorspace converts, resizes and normalizes all
+ * of the frames directly into one contiguous planar tensor (NCHW) in a single kernel
+ * launch with cudaPreprocessBatch().
+ *
+ * By default, frames are captured in the native format of gstCamera and gstDecoder streams
+ * (e.g. NV12), so that the colorspace conversion gets fused into the batched kernel instead
+ * of being performed separately by each stream.  Other types of streams are captured in RGB.
+ *
+ * If a member doesn't deliver a new frame before the timeout expires, its previous frame
+ * is used again and IsFresh() returns false for it.  The timestamps of each member's frame
+ * are available from GetTimestamp() after Capture() returns.
+ *
+ * @ingroup video
+ */
+class videoSourceGroup
+{
+public:
+	/**
+	 * Create an empty group.
+	 */
+	videoSourceGroup();
+
+	/**
+	 * Destructor (the member videoSource streams aren't deleted).
+	 */
+	~videoSourceGroup();
+
+	/**
+	 * Add a stream to the group.  Up to CUDA_PREPROCESS_MAX_BATCH streams can be added.
+	 * The group doesn't take ownership of the stream, so it should outlive the group.
+	 * @returns the index of the stream in the batch, or -1 on error.
+	 */
+	int AddSource( videoSource* source );
+
+	/**
+	 * Capture the latest frame from every member and pre-process them into a batch tensor.
+	 *
+	 * @param[out] tensor planar RGB output tensor in CUDA device memory, that must be at least
+	 *                    `GetNumSources() * width * height * 3` elements in size.
+	 * @param[in] width width of each image in the output tensor (in pixels)
+	 * @param[in] height height of each image in the output tensor (in pixels)
+	 * @param[in] timeout timeout in milliseconds that's shared between all the members.
+	 *                    The default is 1000.  A timeout value of `UINT64_MAX` will wait forever.
+	 *
+	 * @see cudaPreprocess() for a description of the normalization parameters.
+	 *
+	 * @returns `true` if every member has a frame in the tensor (even if some of them weren't fresh),
+	 *          `false` if there was an error or a member hasn't delivered any frames yet.
+	 */
+	bool Capture( float* tensor, uint32_t width, uint32_t height, uint64_t timeout=videoSource::DEFAULT_TIMEOUT,
+			    const float2& range=make_float2(0,1), const float3& mean=make_float3(0,0,0), const float3& stdDev=make_float3(1,1,1),
+			    cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+	/**
+	 * Capture the latest frame from every member and pre-process them into a FP16 batch tensor.
+	 * @see the float version of Capture() for a description of the parameters.
+	 */
+	bool Capture( __half* tensor, uint32_t width, uint32_t height, uint64_t timeout=videoSource::DEFAULT_TIMEOUT,
+			    const float2& range=make_float2(0,1), const float3& mean=make_float3(0,0,0), const float3& stdDev=make_float3(1,1,1),
+			    cudaFilterMode filter=FILTER_LINEAR, cudaStream_t stream=NULL );
+
+	/**
+	 * Open all of the member streams.
+	 */
+	bool Open();
+
+	/**
+	 * Close all of the member streams.
+	 */
+	void Close();
+
+	/**
+	 * Return the number of streams in the group (the batch size).
+	 */
+	inline uint32_t GetNumSources() const					{ return mMembers.size(); }
+
+	/**
+	 * Return a stream from the group.
+	 */
+	inline videoSource* GetSource( uint32_t index ) const		{ return mMembers[index].source; }
+
+	/**
+	 * Return the timestamp (in nanoseconds) of a member's frame from the last Capture().
+	 */
+	inline uint64_t GetTimestamp( uint32_t index ) const		{ return mMembers[index].timestamp; }
+
+	/**
+	 * Return true if a member delivered a new frame during the last Capture(),
+	 * or false if its previous frame was re-used because of a timeout.
+	 */
+	inline bool IsFresh( uint32_t index ) const				{ return mMembers[index].fresh; }
+
+	/**
+	 * Return the image captured from a member during the last Capture().
+	 */
+	inline void* GetImage( uint32_t index ) const				{ return mMembers[index].image; }
+
+	/**
+	 * Return the format that a member's frames are captured in.
+	 */
+	inline imageFormat GetFormat( uint32_t index ) const		{ return mMembers[index].format; }
+
+	/**
+	 * Set the format that the frames are captured in by every member.
+	 * The default is `IMAGE_UNKNOWN`, which uses the native format of GStreamer streams.
+	 */
+	inline void SetCaptureFormat( imageFormat format )		{ mCaptureFormat = format; }
+
+protected:
+
+	bool captureFrames( uint64_t timeout );
+
+	template<typename T>
+	bool captureBatch( T* tensor, uint32_t width, uint32_t height, uint64_t timeout,
+				    const float2& range, const float3& mean, const float3& stdDev,
+				    cudaFilterMode filter, cudaStream_t stream );
+
+	struct Member
+	{
+		videoSource* source;
+		void*        image;
+		uint32_t     width;
+		uint32_t     height;
+		imageFormat  format;
+		uint64_t     timestamp;
+		bool         fresh;
+	};
+
+	std::vector<Member> mMembers;
+	imageFormat mCaptureFormat;
+};
+
+#endif